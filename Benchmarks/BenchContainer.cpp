@@ -0,0 +1,199 @@
+#include "Benchmark.h"
+#include <Utility/HashTable.h>
+#include <Utility/SmallVector.h>
+#include <Utility/RNG.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Benchmark;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    constexpr int NUM_KEYS = 4096;
+
+    // Hashed IDs, similar to how the scene keys its tables
+    void RandomKeys(SmallVector<uint64_t>& keys, uint64_t seed)
+    {
+        RNG rng(seed);
+        keys.resize(NUM_KEYS);
+
+        for (auto& k : keys)
+            k = ((uint64_t)rng.UniformUint() << 32) | rng.UniformUint();
+    }
+}
+
+ZETA_BENCHMARK("HashTable/Insert")
+{
+    SmallVector<uint64_t> keys;
+    RandomKeys(keys, 1);
+
+    state.SetItemsPerIteration(NUM_KEYS);
+    state.Measure([&keys]()
+        {
+            HashTable<uint32_t> table;
+            for (uint32_t i = 0; i < NUM_KEYS; i++)
+                table.try_emplace(keys[i], i);
+
+            DoNotOptimize(table);
+        });
+}
+
+ZETA_BENCHMARK("HashTable/InsertReserved")
+{
+    SmallVector<uint64_t> keys;
+    RandomKeys(keys, 1);
+
+    state.SetItemsPerIteration(NUM_KEYS);
+    state.Measure([&keys]()
+        {
+            HashTable<uint32_t> table;
+            table.resize(NUM_KEYS, true);
+
+            for (uint32_t i = 0; i < NUM_KEYS; i++)
+                table.try_emplace(keys[i], i);
+
+            DoNotOptimize(table);
+        });
+}
+
+ZETA_BENCHMARK("HashTable/FindHit")
+{
+    SmallVector<uint64_t> keys;
+    RandomKeys(keys, 1);
+
+    HashTable<uint32_t> table;
+    for (uint32_t i = 0; i < NUM_KEYS; i++)
+        table.try_emplace(keys[i], i);
+
+    state.SetItemsPerIteration(NUM_KEYS);
+    state.Measure([&keys, &table]()
+        {
+            uint32_t sum = 0;
+            for (uint32_t i = 0; i < NUM_KEYS; i++)
+                sum += *table.find(keys[i]).value();
+
+            DoNotOptimize(sum);
+        });
+}
+
+ZETA_BENCHMARK("HashTable/FindMiss")
+{
+    SmallVector<uint64_t> keys;
+    RandomKeys(keys, 1);
+    SmallVector<uint64_t> missing;
+    RandomKeys(missing, 2);
+
+    HashTable<uint32_t> table;
+    for (uint32_t i = 0; i < NUM_KEYS; i++)
+        table.try_emplace(keys[i], i);
+
+    state.SetItemsPerIteration(NUM_KEYS);
+    state.Measure([&missing, &table]()
+        {
+            uint32_t numFound = 0;
+            for (uint32_t i = 0; i < NUM_KEYS; i++)
+                numFound += (bool)table.find(missing[i]);
+
+            DoNotOptimize(numFound);
+        });
+}
+
+ZETA_BENCHMARK("HashTable/EraseInsert")
+{
+    SmallVector<uint64_t> keys;
+    RandomKeys(keys, 1);
+
+    HashTable<uint32_t> table;
+    for (uint32_t i = 0; i < NUM_KEYS; i++)
+        table.try_emplace(keys[i], i);
+
+    // Steady state with tombstones, e.g. instances that are removed and re-added
+    state.SetItemsPerIteration(NUM_KEYS);
+    state.Measure([&keys, &table]()
+        {
+            for (uint32_t i = 0; i < NUM_KEYS; i++)
+            {
+                table.erase(keys[i]);
+                table.try_emplace(keys[i], i);
+            }
+
+            DoNotOptimize(table);
+        });
+}
+
+ZETA_BENCHMARK("HashTable/Iterate")
+{
+    SmallVector<uint64_t> keys;
+    RandomKeys(keys, 1);
+
+    HashTable<uint32_t> table;
+    for (uint32_t i = 0; i < NUM_KEYS; i++)
+        table.try_emplace(keys[i], i);
+
+    state.SetItemsPerIteration(NUM_KEYS);
+    state.Measure([&table]()
+        {
+            uint32_t sum = 0;
+            for (auto it = table.begin_it(); it < table.end_it(); it = table.next_it(it))
+                sum += it->Val;
+
+            DoNotOptimize(sum);
+        });
+}
+
+ZETA_BENCHMARK("SmallVector/PushBack")
+{
+    state.SetItemsPerIteration(NUM_KEYS);
+    state.Measure([]()
+        {
+            SmallVector<uint32_t> vec;
+            for (uint32_t i = 0; i < NUM_KEYS; i++)
+                vec.push_back(i);
+
+            DoNotOptimize(vec);
+        });
+}
+
+ZETA_BENCHMARK("SmallVector/PushBackReserved")
+{
+    state.SetItemsPerIteration(NUM_KEYS);
+    state.Measure([]()
+        {
+            SmallVector<uint32_t> vec;
+            vec.reserve(NUM_KEYS);
+
+            for (uint32_t i = 0; i < NUM_KEYS; i++)
+                vec.push_back(i);
+
+            DoNotOptimize(vec);
+        });
+}
+
+ZETA_BENCHMARK("SmallVector/PushBackInline")
+{
+    // Fits in the inline storage, no heap allocations
+    constexpr int N = 32;
+
+    state.SetItemsPerIteration(N);
+    state.Measure([]()
+        {
+            SmallVector<uint32_t, Support::SystemAllocator, N> vec;
+            for (uint32_t i = 0; i < N; i++)
+                vec.push_back(i);
+
+            DoNotOptimize(vec);
+        });
+}
+
+ZETA_BENCHMARK("SmallVector/Copy")
+{
+    SmallVector<uint64_t> src;
+    RandomKeys(src, 1);
+
+    state.SetItemsPerIteration(NUM_KEYS);
+    state.Measure([&src]()
+        {
+            SmallVector<uint64_t> dst = src;
+            DoNotOptimize(dst);
+        });
+}
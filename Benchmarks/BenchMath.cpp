@@ -0,0 +1,460 @@
+#include "Benchmark.h"
+#include <Math/BVH.h>
+#include <Math/BatchFuncs.h>
+#include <Math/CollisionFuncs.h>
+#include <Math/Color.h>
+#include <Math/MatrixFuncs.h>
+#include <Math/Sampling.h>
+#include <Math/Surface.h>
+#include <Utility/RNG.h>
+#include <Utility/SmallVector.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Benchmark;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    constexpr int NUM_INSTANCES = 16 * 1024;
+    constexpr int NUM_RAYS = 1024;
+    constexpr int NUM_MATRICES = 1024;
+    constexpr int GRID_DIM = 256;
+
+    // Boxes of varying sizes scattered over a 1 km^2 area, roughly like the instances
+    // of a large scene
+    void RandomInstances(SmallVector<BVH::BVHInput>& instances)
+    {
+        RNG rng(7);
+        instances.resize(NUM_INSTANCES);
+
+        for (int i = 0; i < NUM_INSTANCES; i++)
+        {
+            const float3 center(rng.Uniform() * 1000.0f - 500.0f, rng.Uniform() * 50.0f,
+                rng.Uniform() * 1000.0f - 500.0f);
+            const float3 extents(0.1f + rng.Uniform() * 5.0f, 0.1f + rng.Uniform() * 5.0f,
+                0.1f + rng.Uniform() * 5.0f);
+
+            instances[i].BoundingBox = AABB(center, extents);
+            instances[i].InstanceID = i;
+        }
+    }
+
+    // Grid of GRID_DIM x GRID_DIM quads
+    void GridMesh(SmallVector<Core::Vertex>& vertices, SmallVector<uint32_t>& indices)
+    {
+        constexpr int N = GRID_DIM + 1;
+        vertices.resize(N * N);
+        indices.resize(GRID_DIM * GRID_DIM * 6);
+
+        for (int y = 0; y < N; y++)
+        {
+            for (int x = 0; x < N; x++)
+            {
+                // Some curvature so that normals and tangents vary
+                const float h = sinf(x * 0.1f) * cosf(y * 0.1f);
+                Core::Vertex& v = vertices[y * N + x];
+                v.Position = float3((float)x, h, (float)y);
+                v.TexUV = float2((float)x / GRID_DIM, (float)y / GRID_DIM);
+                v.Normal = oct32(0.0f, 1.0f, 0.0f);
+                v.Tangent = oct32(1.0f, 0.0f, 0.0f);
+            }
+        }
+
+        uint32_t* idx = indices.data();
+        for (int y = 0; y < GRID_DIM; y++)
+        {
+            for (int x = 0; x < GRID_DIM; x++)
+            {
+                const uint32_t v0 = y * N + x;
+                *idx++ = v0;
+                *idx++ = v0 + N;
+                *idx++ = v0 + 1;
+                *idx++ = v0 + 1;
+                *idx++ = v0 + N;
+                *idx++ = v0 + N + 1;
+            }
+        }
+    }
+
+    void RandomTransforms(SmallVector<float4x4a>& matrices)
+    {
+        RNG rng(3);
+        matrices.resize(NUM_MATRICES);
+
+        for (auto& m : matrices)
+        {
+            const v_float4x4 vS = scale(0.5f + rng.Uniform(), 0.5f + rng.Uniform(), 0.5f + rng.Uniform());
+            const v_float4x4 vR = rotateY(rng.Uniform() * TWO_PI);
+            const v_float4x4 vT = translate(rng.Uniform() * 10.0f, rng.Uniform() * 10.0f, rng.Uniform() * 10.0f);
+            m = store(mul(mul(vS, vR), vT));
+        }
+    }
+}
+
+ZETA_BENCHMARK("BVH/Build")
+{
+    SmallVector<BVH::BVHInput> instances;
+    RandomInstances(instances);
+
+    state.SetItemsPerIteration(NUM_INSTANCES);
+    state.Measure([&instances]()
+        {
+            BVH bvh;
+            bvh.Build(instances);
+            DoNotOptimize(bvh);
+
+            // Build allocates its temporaries from the frame allocator
+            App::ResetFrameAllocator();
+        });
+}
+
+ZETA_BENCHMARK("BVH/CastRay")
+{
+    SmallVector<BVH::BVHInput> instances;
+    RandomInstances(instances);
+
+    BVH bvh;
+    bvh.Build(instances);
+    App::ResetFrameAllocator();
+
+    // Rays from above towards the ground, like picking
+    RNG rng(11);
+    SmallVector<Ray> rays;
+    rays.resize(NUM_RAYS);
+
+    for (auto& r : rays)
+    {
+        float3 dir(rng.Uniform() - 0.5f, -1.0f, rng.Uniform() - 0.5f);
+        dir.normalize();
+        r = Ray(float3(rng.Uniform() * 1000.0f - 500.0f, 100.0f, rng.Uniform() * 1000.0f - 500.0f), dir);
+    }
+
+    state.SetItemsPerIteration(NUM_RAYS);
+    state.Measure([&bvh, &rays]()
+        {
+            uint64_t sum = 0;
+            for (int i = 0; i < NUM_RAYS; i++)
+            {
+                Ray r = rays[i];
+                sum += bvh.CastRay(r);
+            }
+
+            DoNotOptimize(sum);
+        });
+}
+
+ZETA_BENCHMARK("Frustum/CullAABBs")
+{
+    SmallVector<BVH::BVHInput> instances;
+    RandomInstances(instances);
+    SmallVector<AABB> boxes;
+    boxes.resize(NUM_INSTANCES);
+
+    for (int i = 0; i < NUM_INSTANCES; i++)
+        boxes[i] = instances[i].BoundingBox;
+
+    ViewFrustum frustum(0.25f * PI, 16.0f / 9.0f, 0.1f, 500.0f);
+    const v_ViewFrustum vFrustum(frustum);
+    SmallVector<uint64_t> visibility;
+    visibility.resize((NUM_INSTANCES + 63) / 64);
+
+    state.SetItemsPerIteration(NUM_INSTANCES);
+    state.Measure([&vFrustum, &boxes, &visibility]()
+        {
+            intersectFrustumVsAABBs(vFrustum, boxes, visibility);
+            DoNotOptimize(visibility);
+        });
+}
+
+ZETA_BENCHMARK("Frustum/CullAABBs_Scalar")
+{
+    SmallVector<BVH::BVHInput> instances;
+    RandomInstances(instances);
+
+    ViewFrustum frustum(0.25f * PI, 16.0f / 9.0f, 0.1f, 500.0f);
+    const v_ViewFrustum vFrustum(frustum);
+
+    state.SetItemsPerIteration(NUM_INSTANCES);
+    state.Measure([&vFrustum, &instances]()
+        {
+            int numVisible = 0;
+            for (int i = 0; i < NUM_INSTANCES; i++)
+            {
+                const v_AABB vBox(instances[i].BoundingBox);
+                numVisible += instersectFrustumVsAABB(vFrustum, vBox) != COLLISION_TYPE::DISJOINT;
+            }
+
+            DoNotOptimize(numVisible);
+        });
+}
+
+ZETA_BENCHMARK("AliasTable/Build")
+{
+    constexpr int N = 64 * 1024;
+    RNG rng(5);
+    SmallVector<float> weights;
+    weights.resize(N);
+
+    for (auto& w : weights)
+        w = rng.Uniform() * 100.0f;
+
+    SmallVector<float> scratch;
+    scratch.resize(N);
+    SmallVector<AliasTableEntry> table;
+    table.resize(N);
+
+    state.SetItemsPerIteration(N);
+    state.Measure([&]()
+        {
+            // Weights are normalized in place, restore them (included in the timing)
+            memcpy(scratch.data(), weights.data(), sizeof(float) * N);
+            AliasTable_Build(scratch, table);
+            DoNotOptimize(table);
+        });
+}
+
+ZETA_BENCHMARK("Mesh/ComputeTangentVectors")
+{
+    SmallVector<Core::Vertex> vertices;
+    SmallVector<uint32_t> indices;
+    GridMesh(vertices, indices);
+
+    state.SetItemsPerIteration(vertices.size());
+    state.Measure([&vertices, &indices]()
+        {
+            ComputeMeshTangentVectors(vertices, indices);
+            DoNotOptimize(vertices);
+
+            App::ResetFrameAllocator();
+        });
+}
+
+ZETA_BENCHMARK("Matrix/Mul")
+{
+    SmallVector<float4x4a> matrices;
+    RandomTransforms(matrices);
+    SmallVector<float4x4a> out;
+    out.resize(NUM_MATRICES);
+
+    state.SetItemsPerIteration(NUM_MATRICES);
+    state.Measure([&matrices, &out]()
+        {
+            for (int i = 0; i < NUM_MATRICES; i++)
+            {
+                const v_float4x4 vM1 = load4x4(matrices[i]);
+                const v_float4x4 vM2 = load4x4(matrices[(i + 1) & (NUM_MATRICES - 1)]);
+                out[i] = store(mul(vM1, vM2));
+            }
+
+            DoNotOptimize(out);
+        });
+}
+
+ZETA_BENCHMARK("Matrix/TransformPoint")
+{
+    SmallVector<float4x4a> matrices;
+    RandomTransforms(matrices);
+    SmallVector<float4a> out;
+    out.resize(NUM_MATRICES);
+
+    state.SetItemsPerIteration(NUM_MATRICES);
+    state.Measure([&matrices, &out]()
+        {
+            for (int i = 0; i < NUM_MATRICES; i++)
+            {
+                const __m128 vP = _mm_setr_ps((float)i, 1.0f, 2.0f, 1.0f);
+                _mm_store_ps(reinterpret_cast<float*>(&out[i]), mul(load4x4(matrices[i]), vP));
+            }
+
+            DoNotOptimize(out);
+        });
+}
+
+ZETA_BENCHMARK("Matrix/InverseSRT")
+{
+    SmallVector<float4x4a> matrices;
+    RandomTransforms(matrices);
+    SmallVector<float4x4a> out;
+    out.resize(NUM_MATRICES);
+
+    state.SetItemsPerIteration(NUM_MATRICES);
+    state.Measure([&matrices, &out]()
+        {
+            for (int i = 0; i < NUM_MATRICES; i++)
+                out[i] = store(inverseSRT(load4x4(matrices[i])));
+
+            DoNotOptimize(out);
+        });
+}
+
+ZETA_BENCHMARK("Matrix/DecomposeSRT")
+{
+    SmallVector<float4x4a> matrices;
+    RandomTransforms(matrices);
+    SmallVector<float4a> out;
+    out.resize(NUM_MATRICES * 3);
+
+    state.SetItemsPerIteration(NUM_MATRICES);
+    state.Measure([&matrices, &out]()
+        {
+            for (int i = 0; i < NUM_MATRICES; i++)
+                decomposeSRT(load4x4(matrices[i]), out[3 * i], out[3 * i + 1], out[3 * i + 2]);
+
+            DoNotOptimize(out);
+        });
+}
+
+ZETA_BENCHMARK("Matrix/AffineTransformation")
+{
+    RNG rng(9);
+    SmallVector<float4a> srt;
+    srt.resize(NUM_MATRICES * 3);
+
+    for (int i = 0; i < NUM_MATRICES; i++)
+    {
+        srt[3 * i] = float4a(0.5f + rng.Uniform(), 0.5f + rng.Uniform(), 0.5f + rng.Uniform(), 0.0f);
+        // Unit quaternion
+        float4 q(rng.Uniform() - 0.5f, rng.Uniform() - 0.5f, rng.Uniform() - 0.5f, rng.Uniform() - 0.5f);
+        q.normalize();
+        srt[3 * i + 1] = float4a(q.x, q.y, q.z, q.w);
+        srt[3 * i + 2] = float4a(rng.Uniform(), rng.Uniform(), rng.Uniform(), 0.0f);
+    }
+
+    SmallVector<float4x4a> out;
+    out.resize(NUM_MATRICES);
+
+    state.SetItemsPerIteration(NUM_MATRICES);
+    state.Measure([&srt, &out]()
+        {
+            for (int i = 0; i < NUM_MATRICES; i++)
+            {
+                const __m128 vS = _mm_load_ps(reinterpret_cast<float*>(&srt[3 * i]));
+                const __m128 vQ = _mm_load_ps(reinterpret_cast<float*>(&srt[3 * i + 1]));
+                const __m128 vT = _mm_load_ps(reinterpret_cast<float*>(&srt[3 * i + 2]));
+                out[i] = store(affineTransformation(vS, vQ, vT));
+            }
+
+            DoNotOptimize(out);
+        });
+}
+
+ZETA_BENCHMARK("Batch/TransformPoints")
+{
+    constexpr int N = 64 * 1024;
+    RNG rng(13);
+    SmallVector<float3> points;
+    points.resize(N);
+
+    for (auto& p : points)
+        p = float3(rng.Uniform() * 10.0f, rng.Uniform() * 10.0f, rng.Uniform() * 10.0f);
+
+    SmallVector<float4x4a> matrices;
+    RandomTransforms(matrices);
+    const float4x3 M(matrices[0]);
+    SmallVector<float3> out;
+    out.resize(N);
+
+    state.SetItemsPerIteration(N);
+    state.Measure([&M, &points, &out]()
+        {
+            TransformPoints(M, points, out);
+            DoNotOptimize(out);
+        });
+}
+
+ZETA_BENCHMARK("Batch/TransformAABBs")
+{
+    SmallVector<BVH::BVHInput> instances;
+    RandomInstances(instances);
+    SmallVector<AABB> boxes;
+    boxes.resize(NUM_INSTANCES);
+
+    for (int i = 0; i < NUM_INSTANCES; i++)
+        boxes[i] = instances[i].BoundingBox;
+
+    SmallVector<float4x4a> matrices;
+    RandomTransforms(matrices);
+    const float4x3 M(matrices[0]);
+    SmallVector<AABB> out;
+    out.resize(NUM_INSTANCES);
+
+    state.SetItemsPerIteration(NUM_INSTANCES);
+    state.Measure([&M, &boxes, &out]()
+        {
+            TransformAABBs(M, boxes, out);
+            DoNotOptimize(out);
+        });
+}
+
+ZETA_BENCHMARK("Batch/MulAffine")
+{
+    // Same work as Matrix/Mul, but with 4x3 matrices
+    SmallVector<float4x4a> matrices;
+    RandomTransforms(matrices);
+    SmallVector<float4x3> A;
+    SmallVector<float4x3> B;
+    SmallVector<float4x3> out;
+    A.resize(NUM_MATRICES);
+    B.resize(NUM_MATRICES);
+    out.resize(NUM_MATRICES);
+
+    for (int i = 0; i < NUM_MATRICES; i++)
+    {
+        A[i] = float4x3(matrices[i]);
+        B[i] = float4x3(matrices[(i + 1) & (NUM_MATRICES - 1)]);
+    }
+
+    state.SetItemsPerIteration(NUM_MATRICES);
+    state.Measure([&A, &B, &out]()
+        {
+            MulAffine(A, B, out);
+            DoNotOptimize(out);
+        });
+}
+
+ZETA_BENCHMARK("Batch/DecomposeSRT")
+{
+    SmallVector<float4x4a> matrices;
+    RandomTransforms(matrices);
+    SmallVector<float4x3> M;
+    M.resize(NUM_MATRICES);
+
+    for (int i = 0; i < NUM_MATRICES; i++)
+        M[i] = float4x3(matrices[i]);
+
+    SmallVector<float3> s;
+    SmallVector<float4> r;
+    SmallVector<float3> t;
+    s.resize(NUM_MATRICES);
+    r.resize(NUM_MATRICES);
+    t.resize(NUM_MATRICES);
+
+    state.SetItemsPerIteration(NUM_MATRICES);
+    state.Measure([&]()
+        {
+            DecomposeSRT(M, s, r, t);
+            DoNotOptimize(r);
+        });
+}
+
+ZETA_BENCHMARK("Color/sRGBToLinear")
+{
+    // RGBA channels of a 512x512 image
+    constexpr int N = 512 * 512 * 4;
+    RNG rng(19);
+    SmallVector<float> in;
+    SmallVector<float> out;
+    in.resize(N);
+    out.resize(N);
+
+    for (auto& f : in)
+        f = rng.Uniform();
+
+    state.SetItemsPerIteration(N);
+    state.Measure([&in, &out]()
+        {
+            sRGBToLinear(in, out);
+            DoNotOptimize(out);
+        });
+}
@@ -0,0 +1,182 @@
+#include "Benchmark.h"
+#include <Support/OffsetAllocator.h>
+#include <Support/MemoryPool.h>
+#include <Support/MemoryArena.h>
+#include <Support/FrameMemory.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Benchmark;
+using namespace ZetaRay::Support;
+
+namespace
+{
+    // Mix of small allocations that are freed out of order, similar to containers that
+    // grow and shrink within a task
+    constexpr int NUM_LIVE = 64;
+    constexpr int NUM_OPS = 1024;
+    constexpr uint32_t SIZES[] = { 8, 24, 64, 100, 256, 1000 };
+
+    template<typename Alloc, typename Free>
+    ZetaInline void RunWorkload(Alloc alloc, Free free)
+    {
+        void* live[NUM_LIVE] = { nullptr };
+        uint32_t liveSize[NUM_LIVE] = { 0 };
+
+        for (int i = 0; i < NUM_OPS; i++)
+        {
+            const int slot = (i * 7) % NUM_LIVE;
+            if (live[slot])
+                free(live[slot], liveSize[slot]);
+
+            const uint32_t size = SIZES[i % ZetaArrayLen(SIZES)];
+            live[slot] = alloc(size);
+            liveSize[slot] = size;
+        }
+
+        for (int i = 0; i < NUM_LIVE; i++)
+        {
+            if (live[i])
+                free(live[i], liveSize[i]);
+        }
+    }
+}
+
+ZETA_BENCHMARK("OffsetAllocator/AllocateFree")
+{
+    // Same pattern as e.g. sub-allocating descriptors or upload buffer ranges
+    OffsetAllocator alloc(64 * 1024 * 1024, NUM_LIVE * 2);
+
+    state.SetItemsPerIteration(NUM_OPS);
+    state.Measure([&alloc]()
+        {
+            OffsetAllocator::Allocation live[NUM_LIVE];
+            for (auto& a : live)
+                a = OffsetAllocator::Allocation::Empty();
+
+            for (int i = 0; i < NUM_OPS; i++)
+            {
+                const int slot = (i * 7) % NUM_LIVE;
+                if (!live[slot].IsEmpty())
+                    alloc.Free(live[slot]);
+
+                live[slot] = alloc.Allocate(SIZES[i % ZetaArrayLen(SIZES)] * 64, 256);
+            }
+
+            for (int i = 0; i < NUM_LIVE; i++)
+            {
+                if (!live[i].IsEmpty())
+                    alloc.Free(live[i]);
+            }
+
+            DoNotOptimize(alloc);
+        });
+}
+
+ZETA_BENCHMARK("MemoryPool/AllocateFree")
+{
+    MemoryPool pool;
+    pool.Init();
+
+    state.SetItemsPerIteration(NUM_OPS);
+    state.Measure([&pool]()
+        {
+            RunWorkload([&pool](uint32_t s) { return pool.AllocateAligned(s); },
+                [&pool](void* p, uint32_t s) { pool.FreeAligned(p, s); });
+        });
+}
+
+ZETA_BENCHMARK("MemoryPool/AllocateFreeThreadCache")
+{
+    MemoryPool pool;
+    pool.Init(true);
+
+    state.SetItemsPerIteration(NUM_OPS);
+    state.Measure([&pool]()
+        {
+            RunWorkload([&pool](uint32_t s) { return pool.AllocateAligned(s); },
+                [&pool](void* p, uint32_t s) { pool.FreeAligned(p, s); });
+        });
+}
+
+ZETA_BENCHMARK("Malloc/AllocateFree")
+{
+    // Reference point for the allocators above
+    state.SetItemsPerIteration(NUM_OPS);
+    state.Measure([]()
+        {
+            RunWorkload([](uint32_t s) { return malloc(s); }, [](void* p, uint32_t) { free(p); });
+        });
+}
+
+ZETA_BENCHMARK("MemoryArena/Allocate")
+{
+    MemoryArena arena(64 * 1024);
+
+    state.SetItemsPerIteration(NUM_OPS);
+    state.Measure([&arena]()
+        {
+            for (int i = 0; i < NUM_OPS; i++)
+                DoNotOptimize(arena.AllocateAligned(SIZES[i % ZetaArrayLen(SIZES)]));
+
+            arena.Reset();
+        });
+}
+
+ZETA_BENCHMARK("MemoryArena/AllocateVirtual")
+{
+    MemoryArena arena(VirtualArenaDesc{ .ReserveSize = 64 * 1024 * 1024 });
+
+    state.SetItemsPerIteration(NUM_OPS);
+    state.Measure([&arena]()
+        {
+            for (int i = 0; i < NUM_OPS; i++)
+                DoNotOptimize(arena.AllocateAligned(SIZES[i % ZetaArrayLen(SIZES)]));
+
+            arena.Reset();
+        });
+}
+
+ZETA_BENCHMARK("FrameMemory/Allocate")
+{
+    // Bump allocation from per-thread blocks as done by App::FrameAllocator, followed by
+    // the start-of-frame reset
+    using FrameMem = FrameMemory<64 * 1024>;
+    static FrameMem frameMemory;
+
+    state.SetItemsPerIteration(NUM_OPS);
+    state.Measure([]()
+        {
+            int blockIdx = 0;
+            auto* block = &frameMemory.GetAndInitIfEmpty(blockIdx);
+
+            for (int i = 0; i < NUM_OPS; i++)
+            {
+                const uint32_t size = SIZES[i % ZetaArrayLen(SIZES)];
+                const uintptr_t start = reinterpret_cast<uintptr_t>(block->Start);
+                uintptr_t ret = Math::AlignUp(start + block->Offset, alignof(std::max_align_t));
+
+                if (ret - start + size >= block->Size)
+                {
+                    block = &frameMemory.GetAndInitIfEmpty(++blockIdx);
+                    ret = Math::AlignUp(reinterpret_cast<uintptr_t>(block->Start), alignof(std::max_align_t));
+                }
+
+                block->Offset = ret - reinterpret_cast<uintptr_t>(block->Start) + size;
+                DoNotOptimize(ret);
+            }
+
+            frameMemory.Reset();
+        });
+}
+
+ZETA_BENCHMARK("FrameAllocator/Allocate")
+{
+    state.SetItemsPerIteration(NUM_OPS);
+    state.Measure([]()
+        {
+            for (int i = 0; i < NUM_OPS; i++)
+                DoNotOptimize(App::AllocateFrameAllocator(SIZES[i % ZetaArrayLen(SIZES)]));
+
+            App::ResetFrameAllocator();
+        });
+}
@@ -0,0 +1,227 @@
+#include "Benchmark.h"
+#include <App/App.h>
+#include <Support/Task.h>
+#include <atomic>
+#include <new>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Benchmark;
+using namespace ZetaRay::Support;
+
+// Scalability of the task system. Every scenario runs with 1 (main thread only) up to
+// MAX_NUM_THREADS threads, by limiting the number of worker threads that are allowed to
+// dequeue new tasks. Throughput is the number of tasks per second, latency is the time
+// from submission until all the (normal-priority) tasks have finished.
+namespace
+{
+    constexpr int NUM_FAN_OUT_TASKS = LargeTaskSet::MAX_NUM_TASKS;
+    constexpr int CHAIN_LENGTH = TaskSet::MAX_NUM_TASKS;
+    constexpr int NUM_CONNECTED_TASKS = TaskSet::MAX_NUM_TASKS / 2;
+    constexpr int NUM_MIXED_TASKS = TaskSet::MAX_NUM_TASKS;
+    // Roughly tens of microseconds per background task
+    constexpr int NUM_BACKGROUND_SPINS = 2048;
+
+    // Limits the worker thread pool to numThreads - 1 active threads (main thread is the
+    // other one) for the lifetime of this object
+    struct ThreadCountScope
+    {
+        explicit ThreadCountScope(int numThreads)
+        {
+            App::SetMaxNumActiveWorkerThreads(numThreads - 1);
+        }
+        ~ThreadCountScope()
+        {
+            App::SetMaxNumActiveWorkerThreads(App::GetNumWorkerThreads() - 1);
+        }
+    };
+
+    ZetaInline bool SkipIfUnavailable(State& state, int numThreads)
+    {
+        if (numThreads > App::GetNumWorkerThreads())
+        {
+            state.Skip("not enough cores");
+            return true;
+        }
+
+        return false;
+    }
+
+    // Waits for the submitted tasks, then releases their signals and frame memory so that
+    // every iteration starts from scratch, same as a new frame
+    ZetaInline double FinishIteration(App::DeltaTimer& timer)
+    {
+        App::FlushWorkerThreadPool();
+        timer.End();
+
+        App::ResetTaskSignals();
+        App::ResetFrameAllocator();
+
+        return timer.DeltaNano();
+    }
+
+    // Many independent empty tasks -- scheduling overhead per task
+    template<int NumThreads>
+    void FanOut(State& state)
+    {
+        if (SkipIfUnavailable(state, NumThreads))
+            return;
+
+        ThreadCountScope threadCount(NumThreads);
+        App::DeltaTimer timer;
+        // Too large for the stack, storage is reused across iterations
+        alignas(LargeTaskSet) static uint8_t storage[sizeof(LargeTaskSet)];
+
+        state.SetItemsPerIteration(NUM_FAN_OUT_TASKS);
+        state.Measure([&state, &timer]()
+            {
+                timer.Start();
+
+                LargeTaskSet* ts = new (storage) LargeTaskSet;
+                for (int i = 0; i < NUM_FAN_OUT_TASKS; i++)
+                    ts->EmplaceTask("Empty", []() {});
+
+                ts->Sort();
+                ts->Finalize();
+                App::Submit(ZetaMove(*ts));
+
+                state.AddLatencySample(FinishIteration(timer));
+                ts->~LargeTaskSet();
+            });
+    }
+
+    // Each task depends on the previous one -- latency of handing a task over to its
+    // dependent
+    template<int NumThreads>
+    void Chain(State& state)
+    {
+        if (SkipIfUnavailable(state, NumThreads))
+            return;
+
+        ThreadCountScope threadCount(NumThreads);
+        App::DeltaTimer timer;
+
+        state.SetItemsPerIteration(CHAIN_LENGTH);
+        state.Measure([&state, &timer]()
+            {
+                timer.Start();
+
+                TaskSet ts;
+                TaskSet::TaskHandle prev = ts.EmplaceTask("Chain", []() {});
+                for (int i = 1; i < CHAIN_LENGTH; i++)
+                {
+                    const TaskSet::TaskHandle curr = ts.EmplaceTask("Chain", []() {});
+                    ts.AddOutgoingEdge(prev, curr);
+                    prev = curr;
+                }
+
+                ts.Sort();
+                ts.Finalize();
+                App::Submit(ZetaMove(ts));
+
+                state.AddLatencySample(FinishIteration(timer));
+            });
+    }
+
+    // Two TaskSets where every task of the second one waits for all the tasks of the
+    // first one, as is the case for render passes that consume the outputs of others
+    template<int NumThreads>
+    void Connected(State& state)
+    {
+        if (SkipIfUnavailable(state, NumThreads))
+            return;
+
+        ThreadCountScope threadCount(NumThreads);
+        App::DeltaTimer timer;
+
+        state.SetItemsPerIteration(NUM_CONNECTED_TASKS * 2);
+        state.Measure([&state, &timer]()
+            {
+                timer.Start();
+
+                TaskSet producers;
+                TaskSet consumers;
+                for (int i = 0; i < NUM_CONNECTED_TASKS; i++)
+                {
+                    producers.EmplaceTask("Producer", []() {});
+                    consumers.EmplaceTask("Consumer", []() {});
+                }
+
+                producers.Sort();
+                consumers.Sort();
+                producers.ConnectTo(consumers);
+                producers.Finalize();
+                consumers.Finalize();
+
+                App::Submit(ZetaMove(producers));
+                App::Submit(ZetaMove(consumers));
+
+                state.AddLatencySample(FinishIteration(timer));
+            });
+    }
+
+    // Empty normal-priority tasks while the background threads are kept busy -- measures
+    // how much background work (e.g. asset loading) interferes with the frame's tasks
+    template<int NumThreads>
+    void Mixed(State& state)
+    {
+        if (SkipIfUnavailable(state, NumThreads))
+            return;
+
+        ThreadCountScope threadCount(NumThreads);
+        App::DeltaTimer timer;
+        std::atomic_int32_t numBackgroundInFlight = 0;
+
+        state.SetItemsPerIteration(NUM_MIXED_TASKS);
+        state.Measure([&state, &timer, &numBackgroundInFlight]()
+            {
+                // Top up the background load so that it stays constant without piling up
+                while (numBackgroundInFlight.load(std::memory_order_relaxed) <
+                    App::GetNumBackgroundThreads())
+                {
+                    numBackgroundInFlight.fetch_add(1, std::memory_order_relaxed);
+
+                    Task t("Spin", TASK_PRIORITY::BACKGROUND, [&numBackgroundInFlight]()
+                        {
+                            for (int i = 0; i < NUM_BACKGROUND_SPINS; i++)
+                                _mm_pause();
+
+                            numBackgroundInFlight.fetch_sub(1, std::memory_order_relaxed);
+                        });
+
+                    App::SubmitBackground(ZetaMove(t));
+                }
+
+                timer.Start();
+
+                TaskSet ts;
+                for (int i = 0; i < NUM_MIXED_TASKS; i++)
+                    ts.EmplaceTask("Empty", []() {});
+
+                ts.Sort();
+                ts.Finalize();
+                App::Submit(ZetaMove(ts));
+
+                state.AddLatencySample(FinishIteration(timer));
+            });
+
+        App::FlushAllThreadPools();
+    }
+
+    static_assert(MAX_NUM_THREADS == 16, "Update the registrations below.");
+
+#define REGISTER_TASK_BENCHMARK(name) \
+    Registration("Task/" #name "/1T", name<1>), \
+    Registration("Task/" #name "/2T", name<2>), \
+    Registration("Task/" #name "/4T", name<4>), \
+    Registration("Task/" #name "/8T", name<8>), \
+    Registration("Task/" #name "/16T", name<16>)
+
+    Registration g_registrations[] = {
+        REGISTER_TASK_BENCHMARK(FanOut),
+        REGISTER_TASK_BENCHMARK(Chain),
+        REGISTER_TASK_BENCHMARK(Connected),
+        REGISTER_TASK_BENCHMARK(Mixed)
+    };
+
+#undef REGISTER_TASK_BENCHMARK
+}
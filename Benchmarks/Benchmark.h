@@ -0,0 +1,166 @@
+#pragma once
+
+#include <App/Timer.h>
+#include <Math/Common.h>
+#include <intrin.h>
+#include <algorithm>
+
+// Minimal harness for CPU micro-benchmarks. Each benchmark does its (untimed) setup and
+// then passes the code to measure to State::Measure(), e.g.
+//
+//      ZETA_BENCHMARK("SmallVector/PushBack")
+//      {
+//          state.SetItemsPerIteration(1024);
+//          state.Measure([]()
+//              {
+//                  ...
+//              });
+//      }
+//
+// Iteration count is calibrated so that every sample takes at least the minimum sample
+// time. Reported time is the median over all the samples. Benchmarks that care about
+// the distribution of individual operations (rather than the average) can also time
+// them and pass the results to State::AddLatencySample(), percentiles of which are
+// reported too.
+namespace ZetaRay::Benchmark
+{
+    namespace Internal
+    {
+        inline const volatile void* g_sink;
+    }
+
+    // Prevents the compiler from optimizing away the computation of val
+    template<typename T>
+    ZetaInline void DoNotOptimize(const T& val)
+    {
+        Internal::g_sink = &val;
+        _ReadWriteBarrier();
+    }
+
+    struct State
+    {
+        static constexpr int NUM_SAMPLES = 7;
+        // Once full, older latency samples are overwritten
+        static constexpr int MAX_NUM_LATENCY_SAMPLES = 4096;
+
+        explicit State(double minSampleTimeMs)
+            : m_minSampleTimeMs(minSampleTimeMs)
+        {}
+
+        // Items (e.g. elements inserted) processed by one call to the measured function.
+        // When set, throughput is reported as well.
+        ZetaInline void SetItemsPerIteration(uint64_t n) { m_itemsPerIter = n; }
+        // Only the samples that are added while measuring (after calibration) are kept
+        ZetaInline void AddLatencySample(double ns)
+        {
+            m_latencySamples[m_numLatencySamples++ % MAX_NUM_LATENCY_SAMPLES] = ns;
+        }
+        // Benchmark doesn't apply to this configuration (e.g. needs more threads than 
+        // there are). Called instead of Measure().
+        ZetaInline void Skip(const char* reason) { m_skipReason = reason; }
+
+        template<typename F>
+        void Measure(F&& fn)
+        {
+            // Warm up caches and find an iteration count that's long enough to time
+            uint64_t numIters = 1;
+            while (true)
+            {
+                const double ms = Time(fn, numIters);
+                if (ms >= m_minSampleTimeMs || numIters >= MAX_NUM_ITERS)
+                    break;
+
+                // Aim a bit past the minimum so that the next run is likely the last one
+                const double scale = ms > 0.0 ? 1.5 * m_minSampleTimeMs / ms : 100.0;
+                numIters = (uint64_t)Math::Min(numIters * Math::Min(scale, 100.0), (double)MAX_NUM_ITERS);
+                numIters = Math::Max(numIters, 2llu);
+            }
+
+            m_numLatencySamples = 0;
+
+            double samples[NUM_SAMPLES];
+            for (int i = 0; i < NUM_SAMPLES; i++)
+                samples[i] = Time(fn, numIters) * 1e6 / numIters;
+
+            // Insertion sort
+            for (int i = 1; i < NUM_SAMPLES; i++)
+            {
+                for (int j = i; j > 0 && samples[j - 1] > samples[j]; j--)
+                {
+                    const double tmp = samples[j];
+                    samples[j] = samples[j - 1];
+                    samples[j - 1] = tmp;
+                }
+            }
+
+            m_nsPerIter = samples[NUM_SAMPLES / 2];
+            m_minNsPerIter = samples[0];
+            m_numIters = numIters;
+
+            std::sort(m_latencySamples, m_latencySamples + NumLatencySamples());
+        }
+
+        ZetaInline double NsPerIteration() const { return m_nsPerIter; }
+        ZetaInline double MinNsPerIteration() const { return m_minNsPerIter; }
+        ZetaInline uint64_t ItemsPerIteration() const { return m_itemsPerIter; }
+        ZetaInline uint64_t NumIterations() const { return m_numIters; }
+        ZetaInline bool WasMeasured() const { return m_numIters > 0; }
+        ZetaInline const char* SkipReason() const { return m_skipReason; }
+        ZetaInline int NumLatencySamples() const
+        {
+            return (int)Math::Min(m_numLatencySamples, (uint64_t)MAX_NUM_LATENCY_SAMPLES);
+        }
+        // p in [0, 1], nearest-rank. Only valid after Measure().
+        ZetaInline double LatencyPercentile(double p) const
+        {
+            const int n = NumLatencySamples();
+            if (n == 0)
+                return 0.0;
+
+            const int idx = (int)(p * n + 0.5) - 1;
+            return m_latencySamples[Math::Max(Math::Min(idx, n - 1), 0)];
+        }
+
+    private:
+        static constexpr uint64_t MAX_NUM_ITERS = 1'000'000'000;
+
+        template<typename F>
+        static double Time(F& fn, uint64_t numIters)
+        {
+            App::DeltaTimer timer;
+            timer.Start();
+
+            for (uint64_t i = 0; i < numIters; i++)
+                fn();
+
+            timer.End();
+
+            return timer.DeltaMicro() / 1000.0;
+        }
+
+        const double m_minSampleTimeMs;
+        double m_nsPerIter = 0.0;
+        double m_minNsPerIter = 0.0;
+        uint64_t m_itemsPerIter = 0;
+        uint64_t m_numIters = 0;
+        uint64_t m_numLatencySamples = 0;
+        const char* m_skipReason = nullptr;
+        double m_latencySamples[MAX_NUM_LATENCY_SAMPLES];
+    };
+
+    using Function = void(*)(State&);
+
+    struct Registration
+    {
+        Registration(const char* name, Function fn);
+    };
+}
+
+#define ZETA_BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define ZETA_BENCHMARK_CONCAT(a, b) ZETA_BENCHMARK_CONCAT_IMPL(a, b)
+
+#define ZETA_BENCHMARK(name) \
+    static void ZETA_BENCHMARK_CONCAT(Benchmark_, __LINE__)(ZetaRay::Benchmark::State& state); \
+    static ZetaRay::Benchmark::Registration ZETA_BENCHMARK_CONCAT(BenchmarkReg_, __LINE__)(name, \
+        ZETA_BENCHMARK_CONCAT(Benchmark_, __LINE__)); \
+    static void ZETA_BENCHMARK_CONCAT(Benchmark_, __LINE__)(ZetaRay::Benchmark::State& state)
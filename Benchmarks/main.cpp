@@ -0,0 +1,291 @@
+#include "Benchmark.h"
+#include <App/App.h>
+#include <App/Filesystem.h>
+#include <Utility/SmallVector.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Benchmark;
+using namespace ZetaRay::Util;
+
+// Usage: Benchmarks [--filter <substring>] [--min-time <ms>] [--out <results.json>]
+//   [--baseline <results.json>]
+//
+// Results are printed as a table. With --baseline, each benchmark is compared against the
+// results of an earlier run (as written by --out) -- differences below the noise threshold
+// are reported as unchanged. Benchmarks that record latency samples get an extra line with
+// the 50th, 90th and 99th percentiles.
+namespace
+{
+    static constexpr int MAX_NUM_BENCHMARKS = 256;
+    static constexpr double DEFAULT_MIN_SAMPLE_TIME_MS = 50.0;
+    // Relative difference that's considered noise
+    static constexpr double NOISE_THRESHOLD = 0.03;
+
+    struct Entry
+    {
+        const char* Name;
+        Function Fn;
+    };
+
+    struct Registry
+    {
+        Entry Benchmarks[MAX_NUM_BENCHMARKS];
+        int NumBenchmarks = 0;
+    };
+
+    // Function-local static so that it's initialized before the first registration,
+    // regardless of the order of static initialization across translation units
+    Registry& GetRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    struct Result
+    {
+        const char* Name;
+        double NsPerIter;
+        double MinNsPerIter;
+        uint64_t ItemsPerIter;
+        uint64_t NumIters;
+        // Zero when there were no latency samples
+        double P50Ns;
+        double P90Ns;
+        double P99Ns;
+    };
+
+    struct BaselineEntry
+    {
+        char Name[128];
+        double NsPerIter;
+    };
+
+    // Parses the file written by WriteResults(), one benchmark per line
+    void LoadBaseline(const char* path, SmallVector<BaselineEntry>& baseline)
+    {
+        SmallVector<uint8_t> file;
+        Filesystem::LoadFromFile(path, file);
+        file.push_back('\0');
+
+        const char* key = "{\"name\": \"";
+        const size_t keyLen = strlen(key);
+        const char* curr = reinterpret_cast<const char*>(file.data());
+
+        while ((curr = strstr(curr, key)) != nullptr)
+        {
+            curr += keyLen;
+            const char* nameEnd = strchr(curr, '"');
+            const char* ns = nameEnd ? strstr(nameEnd, "\"nsPerIter\": ") : nullptr;
+            if (!ns)
+                break;
+
+            BaselineEntry e;
+            const size_t len = Math::Min((size_t)(nameEnd - curr), sizeof(e.Name) - 1);
+            memcpy(e.Name, curr, len);
+            e.Name[len] = '\0';
+            e.NsPerIter = strtod(ns + strlen("\"nsPerIter\": "), nullptr);
+            baseline.push_back(e);
+
+            curr = nameEnd;
+        }
+
+        Check(!baseline.empty(), "%s doesn't contain any benchmark results.", path);
+    }
+
+    void WriteResults(const char* path, const SmallVector<Result>& results)
+    {
+        SmallVector<char> json;
+        auto append = [&json](const char* str, int n)
+            {
+                json.append_range(str, str + n);
+            };
+
+        char line[512];
+        append(line, stbsp_snprintf(line, sizeof(line), "{\n  \"benchmarks\": [\n"));
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result& r = results[i];
+            append(line, stbsp_snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"nsPerIter\": %.3f, "
+                "\"minNsPerIter\": %.3f, \"itemsPerIter\": %llu, \"iterations\": %llu, \"p50Ns\": %.3f, "
+                "\"p90Ns\": %.3f, \"p99Ns\": %.3f}%s\n", r.Name, r.NsPerIter, r.MinNsPerIter, r.ItemsPerIter,
+                r.NumIters, r.P50Ns, r.P90Ns, r.P99Ns, i + 1 < results.size() ? "," : ""));
+        }
+
+        append(line, stbsp_snprintf(line, sizeof(line), "  ]\n}\n"));
+        Filesystem::WriteToFile(path, reinterpret_cast<uint8_t*>(json.data()), (uint32_t)json.size());
+    }
+
+    void PrintTime(char* buff, size_t buffSize, double ns)
+    {
+        if (ns >= 1e6)
+            stbsp_snprintf(buff, (int)buffSize, "%.3f ms", ns * 1e-6);
+        else if (ns >= 1e3)
+            stbsp_snprintf(buff, (int)buffSize, "%.3f us", ns * 1e-3);
+        else
+            stbsp_snprintf(buff, (int)buffSize, "%.2f ns", ns);
+    }
+}
+
+namespace ZetaRay::Benchmark
+{
+    Registration::Registration(const char* name, Function fn)
+    {
+        Registry& registry = GetRegistry();
+        Check(registry.NumBenchmarks < MAX_NUM_BENCHMARKS, "Too many benchmarks.");
+
+        registry.Benchmarks[registry.NumBenchmarks++] = Entry{ .Name = name, .Fn = fn };
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* filter = nullptr;
+    const char* outPath = nullptr;
+    const char* baselinePath = nullptr;
+    double minSampleTimeMs = DEFAULT_MIN_SAMPLE_TIME_MS;
+
+    for (int i = 1; i < argc; i++)
+    {
+        Check(i + 1 < argc, "Missing value for option %s", argv[i]);
+
+        if (strcmp(argv[i], "--filter") == 0)
+            filter = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0)
+            outPath = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0)
+            baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--min-time") == 0)
+            minSampleTimeMs = strtod(argv[++i], nullptr);
+        else
+            Check(false, "Unknown option: %s", argv[i]);
+    }
+
+    SmallVector<BaselineEntry> baseline;
+    if (baselinePath)
+        LoadBaseline(baselinePath, baseline);
+
+    // Worker threads and the frame allocator are used by the BVH and mesh processing and
+    // the task system benchmarks
+    App::InitBasic();
+
+    printf("%-40s %14s %14s %16s", "Benchmark", "Time", "Min", "Items/s");
+    if (baselinePath)
+        printf(" %14s %10s", "Baseline", "Change");
+    printf("\n");
+
+    SmallVector<Result> results;
+    const Registry& registry = GetRegistry();
+    int numFaster = 0;
+    int numSlower = 0;
+    int numSkipped = 0;
+
+    for (int b = 0; b < registry.NumBenchmarks; b++)
+    {
+        const Entry& e = registry.Benchmarks[b];
+        if (filter && !strstr(e.Name, filter))
+            continue;
+
+        State state(minSampleTimeMs);
+        e.Fn(state);
+
+        if (state.SkipReason())
+        {
+            printf("%-40s skipped (%s)\n", e.Name, state.SkipReason());
+            numSkipped++;
+            continue;
+        }
+
+        Check(state.WasMeasured(), "Benchmark %s didn't call State::Measure().", e.Name);
+        const bool hasLatency = state.NumLatencySamples() > 0;
+
+        results.push_back(Result{ .Name = e.Name,
+            .NsPerIter = state.NsPerIteration(),
+            .MinNsPerIter = state.MinNsPerIteration(),
+            .ItemsPerIter = state.ItemsPerIteration(),
+            .NumIters = state.NumIterations(),
+            .P50Ns = state.LatencyPercentile(0.5),
+            .P90Ns = state.LatencyPercentile(0.9),
+            .P99Ns = state.LatencyPercentile(0.99) });
+
+        char time[32];
+        char minTime[32];
+        char throughput[32] = "-";
+        PrintTime(time, sizeof(time), state.NsPerIteration());
+        PrintTime(minTime, sizeof(minTime), state.MinNsPerIteration());
+
+        if (state.ItemsPerIteration())
+        {
+            const double itemsPerSec = state.ItemsPerIteration() * 1e9 / state.NsPerIteration();
+            stbsp_snprintf(throughput, sizeof(throughput), "%.2f M", itemsPerSec * 1e-6);
+        }
+
+        printf("%-40s %14s %14s %16s", e.Name, time, minTime, throughput);
+
+        if (baselinePath)
+        {
+            const BaselineEntry* base = nullptr;
+            for (auto& be : baseline)
+            {
+                if (strcmp(be.Name, e.Name) == 0)
+                {
+                    base = &be;
+                    break;
+                }
+            }
+
+            if (base && base->NsPerIter > 0.0)
+            {
+                char baseTime[32];
+                PrintTime(baseTime, sizeof(baseTime), base->NsPerIter);
+                // Negative is faster
+                const double change = state.NsPerIteration() / base->NsPerIter - 1.0;
+                const char* verdict = change < -NOISE_THRESHOLD ? "faster" :
+                    (change > NOISE_THRESHOLD ? "SLOWER" : "");
+                numFaster += change < -NOISE_THRESHOLD;
+                numSlower += change > NOISE_THRESHOLD;
+
+                printf(" %14s %+9.1f%% %s", baseTime, change * 100.0, verdict);
+            }
+            else
+                printf(" %14s %10s", "-", "new");
+        }
+
+        printf("\n");
+
+        if (hasLatency)
+        {
+            const Result& r = results.back();
+            char p50[32];
+            char p90[32];
+            char p99[32];
+            PrintTime(p50, sizeof(p50), r.P50Ns);
+            PrintTime(p90, sizeof(p90), r.P90Ns);
+            PrintTime(p99, sizeof(p99), r.P99Ns);
+
+            printf("%-40s p50 %s, p90 %s, p99 %s (%d samples)\n", "", p50, p90, p99,
+                state.NumLatencySamples());
+        }
+    }
+
+    if (numSkipped)
+        printf("\n%d benchmark(s) skipped\n", numSkipped);
+
+    if (baselinePath)
+    {
+        printf("\n%d faster, %d slower, %d within %.0f%% of %s\n", numFaster, numSlower,
+            (int)results.size() - numFaster - numSlower, NOISE_THRESHOLD * 100.0, baselinePath);
+    }
+
+    if (outPath)
+    {
+        WriteResults(outPath, results);
+        printf("Results written to %s\n", outPath);
+    }
+
+    App::ShutdownBasic();
+
+    return 0;
+}
@@ -65,6 +65,36 @@ function(CompileHLSL HLSL_PATH RET)
         set(COMMON_ARGS "-Qstrip_reflect" "-nologo" "-all_resources_bound" "-enable-16bit-types" "-WX" "-HV 202x" "-Wdouble-promotion")
     endif()
     
+    # AS-MS-PS. Checked first as mesh and amplification shaders also have [numthreads].
+    # Amplification shader is optional, entry points are mainAS, mainMS and mainPS.
+    string(FIND "${DATA}" "[outputtopology" MS_POS)
+
+    if(${MS_POS} GREATER_EQUAL 0)
+        set(CSO_PATH_MS ${CSO_DIR}/${FILE_NAME_WO_EXT}_ms.cso)
+        set(CSO_PATH_PS ${CSO_DIR}/${FILE_NAME_WO_EXT}_ps.cso)
+        set(CSOS ${CSO_PATH_MS} ${CSO_PATH_PS})
+        set(AS_COMMAND "")
+
+        string(FIND "${DATA}" "mainAS" AS_POS)
+        if(${AS_POS} GREATER_EQUAL 0)
+            set(CSO_PATH_AS ${CSO_DIR}/${FILE_NAME_WO_EXT}_as.cso)
+            set(AS_COMMAND COMMAND ${DXC} ${COMMON_ARGS} -T as_6_7 -E mainAS -Fo ${CSO_PATH_AS} ${HLSL_PATH})
+            set(CSOS ${CSO_PATH_AS} ${CSOS})
+        endif()
+
+        add_custom_command(
+            OUTPUT ${CSOS}
+            ${AS_COMMAND}
+            COMMAND ${DXC} ${COMMON_ARGS} -T ms_6_7 -E mainMS -Fo ${CSO_PATH_MS} ${HLSL_PATH}
+            COMMAND ${DXC} ${COMMON_ARGS} -T ps_6_7 -E mainPS -Fo ${CSO_PATH_PS} ${HLSL_PATH}
+            DEPENDS ${ALL_INCLUDES} "${HLSL_PATH}"
+            COMMENT "Compiling HLSL source file ${FILE_NAME_WO_EXT}.hlsl..."
+            VERBATIM)
+
+        set(${RET} ${CSOS} PARENT_SCOPE)
+        return()
+    endif()
+
     # Compute shader
     set(RE_CS "\\[numthreads.*\\][ \t\r\n]*void[ \t\r\n]+([a-zA-Z][A-Za-z0-9_]*)")
     string(REGEX MATCH ${RE_CS} MATCH ${DATA})
@@ -134,4 +164,65 @@ function(CompileHLSL HLSL_PATH RET)
     endif()
 
     set(${RET} ${CSOS} PARENT_SCOPE)
-endfunction()
\ No newline at end of file
+endfunction()
+
+# Compiles the shader permutations that are listed in the given manifest. Every (non-empty) line 
+# that doesn't start with '#' has the form
+#
+#   <path to base .hlsl relative to manifest> <output name> [define]...
+#
+# where every define is either NAME or NAME=VALUE. Output name should match what 
+# PipelineStateLibrary expects (<stem>[_<suffix>]...), otherwise the permutation is compiled 
+# at runtime on first use instead.
+function(CompileHLSLPermutations MANIFEST_PATH RET)
+    find_program(DXC dxc PATHS "${DXC_BIN_DIR}" REQUIRED NO_DEFAULT_PATH)
+
+    if(COMPILE_SHADERS_WITH_DEBUG_INFO)
+        set(COMMON_ARGS "-Qembed_debug" "-Qstrip_reflect" "-nologo" "-Zi" "-all_resources_bound" "-enable-16bit-types" "-WX" "-HV 202x" "-Wdouble-promotion")
+    else()
+        set(COMMON_ARGS "-Qstrip_reflect" "-nologo" "-all_resources_bound" "-enable-16bit-types" "-WX" "-HV 202x" "-Wdouble-promotion")
+    endif()
+
+    get_filename_component(MANIFEST_DIR "${MANIFEST_PATH}" DIRECTORY)
+    file(STRINGS "${MANIFEST_PATH}" LINES)
+    set(CSOS "")
+
+    foreach(LINE ${LINES})
+        string(STRIP "${LINE}" LINE)
+        if("${LINE}" STREQUAL "" OR "${LINE}" MATCHES "^#")
+            continue()
+        endif()
+
+        separate_arguments(TOKENS NATIVE_COMMAND "${LINE}")
+        list(POP_FRONT TOKENS BASE_HLSL OUT_NAME)
+        get_filename_component(HLSL_PATH "${MANIFEST_DIR}/${BASE_HLSL}" ABSOLUTE)
+
+        set(DEFINES "")
+        foreach(DEFINE ${TOKENS})
+            list(APPEND DEFINES "-D" "${DEFINE}")
+        endforeach()
+
+        file(STRINGS "${HLSL_PATH}" DATA NEWLINE_CONSUME)
+        DFS("${HLSL_PATH}" ${DATA} ALL_INCLUDES)
+
+        set(MAIN_FUNC "main")
+        set(RE_CS "\\[numthreads.*\\][ \t\r\n]*void[ \t\r\n]+([a-zA-Z][A-Za-z0-9_]*)")
+        string(REGEX MATCH ${RE_CS} MATCH ${DATA})
+        if(${CMAKE_MATCH_COUNT} GREATER 0)
+            set(MAIN_FUNC ${CMAKE_MATCH_1})
+        endif()
+
+        set(CSO_PATH "${CSO_DIR}/${OUT_NAME}_cs.cso")
+
+        add_custom_command(
+            OUTPUT ${CSO_PATH}
+            COMMAND ${DXC} ${COMMON_ARGS} -T cs_6_7 -E ${MAIN_FUNC} ${DEFINES} -Fo ${CSO_PATH} ${HLSL_PATH}
+            DEPENDS ${ALL_INCLUDES} "${HLSL_PATH}" "${MANIFEST_PATH}"
+            COMMENT "Compiling shader permutation ${OUT_NAME}..."
+            VERBATIM)
+
+        set(CSOS ${CSOS} ${CSO_PATH})
+    endforeach()
+
+    set(${RET} ${CSOS} PARENT_SCOPE)
+endfunction()
@@ -0,0 +1,34 @@
+function(SetupDirectStorage)
+    set(DSTORAGE_DIR "${EXTERNAL_DIR}/DirectStorage")
+    file(GLOB_RECURSE DLL_PATH "${DSTORAGE_DIR}/*dstorage.dll")
+
+    if(DLL_PATH STREQUAL "")
+        file(MAKE_DIRECTORY ${DSTORAGE_DIR})
+
+        # download from nuget
+        set(URL "https://www.nuget.org/api/v2/package/Microsoft.Direct3D.DirectStorage/1.2.3")
+        message(STATUS "Downloading DirectStorage from ${URL}...")
+        set(ARCHIVE_PATH "${DSTORAGE_DIR}/temp/dstorage.zip")
+        file(DOWNLOAD "${URL}" "${ARCHIVE_PATH}" TIMEOUT 120)
+        file(ARCHIVE_EXTRACT INPUT "${ARCHIVE_PATH}" DESTINATION "${DSTORAGE_DIR}/temp")
+
+        # copy headers
+        file(GLOB_RECURSE DSTORAGE_HEADERS "${DSTORAGE_DIR}/temp/native/include/*.h")
+        file(COPY ${DSTORAGE_HEADERS} DESTINATION ${DSTORAGE_DIR})
+
+        if(DSTORAGE_HEADERS STREQUAL "")
+            message(FATAL_ERROR "Setting up DirectStorage failed.")
+        endif()
+
+        # copy binaries
+        set(BINS
+            "${DSTORAGE_DIR}/temp/native/bin/x64/dstorage.dll"
+            "${DSTORAGE_DIR}/temp/native/bin/x64/dstoragecore.dll"
+            "${DSTORAGE_DIR}/temp/native/lib/x64/dstorage.lib")
+
+        file(COPY ${BINS} DESTINATION ${DSTORAGE_DIR})
+
+        # cleanup
+        file(REMOVE_RECURSE "${DSTORAGE_DIR}/temp")
+    endif()
+endfunction()
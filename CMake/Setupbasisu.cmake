@@ -0,0 +1,28 @@
+function(Setupbasisu)
+    set(BASISU_DIR "${EXTERNAL_DIR}/basisu")
+    file(GLOB_RECURSE HEADER_PATH "${BASISU_DIR}/transcoder/basisu_transcoder.h")
+    set(BASISU_VER "1.16.4")
+
+    if(HEADER_PATH STREQUAL "")
+        file(MAKE_DIRECTORY ${BASISU_DIR})
+
+        # download
+        set(URL "https://github.com/BinomialLLC/basis_universal/archive/refs/tags/${BASISU_VER}.zip")
+        message(STATUS "Downloading Basis Universal ${BASISU_VER} from ${URL}...")
+        set(ARCHIVE_PATH "${BASISU_DIR}/temp/basisu.zip")
+        file(DOWNLOAD "${URL}" "${ARCHIVE_PATH}" TIMEOUT 120)
+        file(ARCHIVE_EXTRACT INPUT "${ARCHIVE_PATH}" DESTINATION "${BASISU_DIR}/temp")
+
+        # only the transcoder and the Zstd decoder are needed
+        set(SRC_DIR "${BASISU_DIR}/temp/basis_universal-${BASISU_VER}")
+        file(COPY "${SRC_DIR}/transcoder" DESTINATION ${BASISU_DIR})
+        file(COPY "${SRC_DIR}/zstd/zstd.h" "${SRC_DIR}/zstd/zstddeclib.c" DESTINATION "${BASISU_DIR}/zstd")
+
+        if(NOT EXISTS "${BASISU_DIR}/transcoder/basisu_transcoder.h")
+            message(FATAL_ERROR "Setting up Basis Universal failed.")
+        endif()
+
+        # cleanup
+        file(REMOVE_RECURSE "${BASISU_DIR}/temp")
+    endif()   
+endfunction()
@@ -0,0 +1,33 @@
+function(Setupmeshoptimizer)
+    set(MESHOPT_DIR "${EXTERNAL_DIR}/meshoptimizer")
+    file(GLOB_RECURSE HEADER_PATH "${MESHOPT_DIR}/meshoptimizer.h")
+    set(MESHOPT_VER "0.21")
+
+    if(HEADER_PATH STREQUAL "")
+        file(MAKE_DIRECTORY ${MESHOPT_DIR})
+
+        # download
+        set(URL "https://github.com/zeux/meshoptimizer/archive/refs/tags/v${MESHOPT_VER}.zip")
+        message(STATUS "Downloading meshoptimizer ${MESHOPT_VER} from ${URL}...")
+        set(ARCHIVE_PATH "${MESHOPT_DIR}/temp/meshoptimizer.zip")
+        file(DOWNLOAD "${URL}" "${ARCHIVE_PATH}" TIMEOUT 120)
+        file(ARCHIVE_EXTRACT INPUT "${ARCHIVE_PATH}" DESTINATION "${MESHOPT_DIR}/temp")
+
+        # only the decoders are needed
+        set(SRC_DIR "${MESHOPT_DIR}/temp/meshoptimizer-${MESHOPT_VER}/src")
+        set(FILES 
+            "${SRC_DIR}/meshoptimizer.h"
+            "${SRC_DIR}/indexcodec.cpp"
+            "${SRC_DIR}/vertexcodec.cpp"
+            "${SRC_DIR}/vertexfilter.cpp")
+
+        file(COPY ${FILES} DESTINATION ${MESHOPT_DIR})
+
+        if(NOT EXISTS "${MESHOPT_DIR}/meshoptimizer.h")
+            message(FATAL_ERROR "Setting up meshoptimizer failed.")
+        endif()
+
+        # cleanup
+        file(REMOVE_RECURSE "${MESHOPT_DIR}/temp")
+    endif()   
+endfunction()
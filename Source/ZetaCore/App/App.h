@@ -9,9 +9,12 @@
 namespace ZetaRay::Support
 {
     struct TaskSet;
+    struct LargeTaskSet;
     struct alignas(64) Task;
     struct ParamVariant;
     struct Stat;
+    struct TaskTimeline;
+    struct LogBuffer;
 
     static constexpr int MAX_NUM_THREADS = 16;
     inline thread_local int g_threadIdx = -1;
@@ -68,7 +71,8 @@ namespace ZetaRay::Scene::Renderer
 
 namespace ZetaRay::App
 {
-    static constexpr int FRAME_ALLOCATOR_MAX_ALLOCATION_SIZE = 512 * 1024;
+    // Frame allocator's block size grows from this value as needed
+    static constexpr int FRAME_ALLOCATOR_BASE_BLOCK_SIZE = 512 * 1024;
 
     struct ShaderReloadHandler
     {
@@ -94,6 +98,7 @@ namespace ZetaRay::App
 
         LogMessage() = default;
         LogMessage(const char* msg, MsgType t);
+        LogMessage(const char* msg, MsgType t, uint32_t frameIdx, uint32_t threadID);
 
         char* Msg;
         MsgType Type;
@@ -103,6 +108,24 @@ namespace ZetaRay::App
     {
         int NumPhysicalCores;
         int NumLogicalCores;
+        // On hybrid CPUs, cores with the highest efficiency class (i.e. fastest) are 
+        // counted as performance cores and the rest as efficiency cores. On other CPUs, 
+        // all the cores are performance cores.
+        int NumPerformanceCores;
+        int NumEfficiencyCores;
+        // Logical processor masks (first processor group only)
+        uint64_t PerformanceCoreMask;
+        uint64_t EfficiencyCoreMask;
+        // One logical processor per physical core
+        uint64_t PerformanceCorePrimaryMask;
+        uint64_t EfficiencyCorePrimaryMask;
+        uint32_t CacheLineSize;
+        // Largest L2 among all the cores
+        uint32_t L2CacheSizeKB;
+        // Sum of all the L3 caches
+        uint32_t L3CacheSizeKB;
+
+        ZetaInline bool IsHybrid() const { return NumEfficiencyCores > 0; }
     };
 
     enum class THREAD_PRIORITY
@@ -111,35 +134,217 @@ namespace ZetaRay::App
         BACKGROUND
     };
 
+    enum class THREAD_PLACEMENT
+    {
+        // Leave it to the OS scheduler
+        OS_DEFAULT,
+        // Sets the ideal processor, scheduler may still move the thread elsewhere
+        PREFERRED,
+        // Restricts the thread to the given core type
+        PINNED,
+        COUNT
+    };
+
+    enum class CORE_TYPE
+    {
+        PERFORMANCE,
+        EFFICIENCY
+    };
+
+    // Offline rendering without a window or swap chain. Path tracer accumulates up to the 
+    // given number of samples per pixel, after which the result is written to disk and 
+    // the app exits.
+    struct HeadlessDesc
+    {
+        // Format is deduced from the extension -- .exr (linear HDR) or .png (tonemapped)
+        const char* OutputPath = nullptr;
+        uint32_t NumSamples = 1024;
+        // When greater than zero, pixels stop being sampled once the relative standard error 
+        // of their estimate falls below this value (adaptive sampling)
+        float TargetRelError = 0.0f;
+        uint16_t Width = 1920;
+        uint16_t Height = 1080;
+        // Default camera is used unless HasCamera is set
+        float CameraPos[3] = { 0.0f, 0.0f, 0.0f };
+        float CameraLookAt[3] = { 0.0f, 0.0f, 1.0f };
+        float FovDegrees = 60.0f;
+        bool HasCamera = false;
+        // When non-zero, image is rendered as a grid of TileSize x TileSize tiles, one after 
+        // the other, so that GPU memory is bounded by tile size rather than output resolution. 
+        // Requires EXR output.
+        uint16_t TileSize = 0;
+        // Extra pixels rendered on each side of a tile and then discarded, so that screen-space 
+        // filters and spatial reuse have valid neighbors across tile boundaries
+        uint16_t TileApron = 32;
+        // GPU to render on, in order of decreasing performance. -1 picks the first one.
+        int AdapterIndex = -1;
+        // Seeds an independent set of random samples, so that several processes (e.g. one 
+        // per GPU) can render the same image and have their results averaged afterwards
+        uint32_t SampleStream = 0;
+        // When non-zero, accumulated image is denoised every DenoiseCheckpoint samples, using 
+        // albedo and normals of primary surfaces as guides. Rendering then stops early once 
+        // the denoised image changes by less than DenoiseThreshold (relative) between two 
+        // consecutive checkpoints, and the denoised image is written instead. Requires a 
+        // build with Open Image Denoise (ZETA_OIDN) and EXR output; ignored otherwise.
+        uint32_t DenoiseCheckpoint = 0;
+        float DenoiseThreshold = 0.005f;
+
+        ZetaInline bool IsTiled() const { return TileSize && (TileSize < Width || TileSize < Height); }
+    };
+
+    // Repeatable performance measurement. Once the scene has loaded, camera is placed at the 
+    // start of the given camera path (see Scene::CameraPath) for NumWarmupFrames frames and 
+    // then follows it, advancing by a fixed timestep every frame. Frame, CPU and GPU times 
+    // along with per-pass GPU timings are recorded for every frame of the path and written
+    // to OutputPath as JSON, after which the app exits.
+    //
+    // When Pass is set, only the render node with that name is measured instead: after 
+    // warm-up, camera stays put and the node is replayed NumPassReps times with its inputs 
+    // captured from a real frame (see Core::RenderGraph::BeginPassBenchmark()). With Sweep, 
+    // that's repeated for every listed value of a parameter -- since shader permutations 
+    // are selected through parameters, this also covers comparing permutations.
+    struct BenchmarkDesc
+    {
+        const char* CameraPath = nullptr;
+        const char* OutputPath = "Benchmark.json";
+        // One of "path_tracing", "restir_gi", "restir_pt" or "probe_volume". Renderer's default when null.
+        const char* Integrator = nullptr;
+        uint32_t NumWarmupFrames = 120;
+        // Simulation time step in seconds, independent of how long frames actually take
+        float Timestep = 1.0f / 60.0f;
+        // When non-zero, only the first NumFrames frames of the camera path are measured
+        uint32_t NumFrames = 0;
+        // Performance tier ("low", "medium" or "high") whose settings are applied before 
+        // Integrator. Tiers aren't used when null, so that results don't depend on calibration.
+        const char* Preset = nullptr;
+        // Random numbers are seeded with the frame number since the start of warm-up, 
+        // offset by this
+        uint32_t Seed = 0;
+        // Size of the window's client area
+        uint16_t Width = 1920;
+        uint16_t Height = 1080;
+        // Render node name. Camera path is optional in this mode, camera is placed at 
+        // its first keyframe when given.
+        const char* Pass = nullptr;
+        uint32_t NumPassReps = 256;
+        // "<group>/<subgroup>/<name>=<v0>,<v1>,..." for a bool, int, enum (index) or 
+        // float parameter
+        const char* Sweep = nullptr;
+        // Results of an earlier run to compare against (see BenchmarkRecorder::
+        // CompareToBaseline()). Run() returns a non-zero exit code when any of the
+        // timings regressed by more than the tolerance (in percent).
+        const char* BaselinePath = nullptr;
+        float TolerancePct = 5.0f;
+    };
+
     CpuInfo GetProcessorInfo();
     void SetThreadPriority(void* handle, THREAD_PRIORITY priority);
+    // Places the thread on the idx'th core of the given type (wrapping around if there 
+    // are fewer cores). Falls back to any core when the CPU has no cores of that type.
+    void SetThreadPlacement(void* handle, THREAD_PLACEMENT placement, CORE_TYPE coreType, int idx);
     void SetThreadDesc(void* handle, wchar_t* buffer);
 
+    // Passing a HeadlessDesc skips window and swap chain creation (see HeadlessDesc). 
+    // Headless and benchmark modes are mutually exclusive. When inputReplay is given, 
+    // the input recording at that path (see Support::InputRecording) drives the app 
+    // instead of the user, which exits when it's over.
     void Init(Scene::Renderer::Interface& rendererInterface, 
-        const char* name = nullptr);
+        const char* name = nullptr, const HeadlessDesc* headless = nullptr,
+        const BenchmarkDesc* benchmark = nullptr, const char* inputReplay = nullptr);
     void InitBasic();
     void ShutdownBasic();
     int Run();
     void Abort();
+    // Thread safe. Run() returns before starting the next frame.
+    void RequestExit();
+    // Returns nullptr when not running in headless mode. Refers to the current job when 
+    // jobs were queued.
+    const HeadlessDesc* GetHeadlessDesc();
+    // Headless only, non-tiled. Queues another render of the same scene that starts once 
+    // the previous one has finished, so that the device, PSOs and loaded scene are reused.
+    // Only the camera, number of samples and output path may differ from the HeadlessDesc 
+    // given to Init(). Strings must outlive the job.
+    void QueueHeadlessJob(const HeadlessDesc& job);
+    // Thread safe. Called once the current headless job's output has been written. Next 
+    // queued job starts in the following frame, app exits when there are none left.
+    void FinishHeadlessJob();
+    // Index of the current headless job, 0 for the HeadlessDesc given to Init()
+    uint32_t GetHeadlessJobIndex();
+    // Returns nullptr when not running in benchmark mode
+    const BenchmarkDesc* GetBenchmarkDesc();
+    // Number of frames since the start of benchmark warm-up, -1 when not benchmarking or 
+    // when the scene is still loading
+    int64_t GetBenchmarkFrame();
+    // Frame number during recording of the frame that's being replayed, -1 when not 
+    // replaying an input recording or when the scene is still loading
+    int64_t GetReplayFrame();
 
     void* AllocateFrameAllocator(size_t size, 
         size_t alignment = alignof(std::max_align_t));
+    // Largest allocation (including the alignment padding) that the frame allocator can 
+    // currently serve
+    size_t GetFrameAllocatorMaxAllocationSize();
+    // Releases everything that was allocated from the frame allocator. Happens automatically 
+    // at the start of every frame -- meant for programs that don't go through Run() (after 
+    // InitBasic()). Must not be called while there are ongoing frame allocations.
+    void ResetFrameAllocator();
+    // Same as ResetFrameAllocator(), but for the per-frame pool of task signals. Must 
+    // not be called while there are unfinished tasks (e.g. after FlushWorkerThreadPool()).
+    void ResetTaskSignals();
+    // Called when a frame allocation was too large and had to fall back to the heap. Used 
+    // for telemetry and for growing the frame allocator's block size.
+    void RecordFrameAllocatorFallback(size_t size, size_t alignment);
 
     int RegisterTask();
     void TaskFinalizedCallback(int handle, int indegree);
     void WaitForAdjacentHeadNodes(int handle);
+    // Non-blocking version of WaitForAdjacentHeadNodes()
+    bool AreAdjacentHeadNodesFinished(int handle);
+    // Keeps the given task aside until all of its dependencies have finished, at which
+    // point the thread that signals the last dependency hands it back to the worker thread 
+    // pool. Returns false if the last dependency finished in the meantime, in which case
+    // the task is left with the caller and can run right away.
+    bool TryParkTask(Support::Task& task);
     void SignalAdjacentTailNodes(Util::Span<int> taskIDs);
 
     // Submits task to priority thread pool
     void Submit(Support::Task&& t);
     void Submit(Support::TaskSet&& ts);
+    void Submit(Support::LargeTaskSet&& ts);
     void SubmitBackground(Support::Task&& t);
     void FlushWorkerThreadPool();
     void FlushAllThreadPools();
+    // The calling thread dequeues and runs at most one task from the worker thread 
+    // pool. Returns true if a task was executed.
+    bool PumpWorkerThreadPoolOnce();
+    // Only the first n worker threads dequeue new tasks, the rest stay idle until the 
+    // limit is raised (see ThreadPool::SetMaxNumActiveThreads()).
+    void SetMaxNumActiveWorkerThreads(int n);
+
+    // Calls fn(begin, end) for chunks of [0, count) in parallel on the worker thread pool 
+    // and returns after all the chunks are processed. Chunks are claimed dynamically -- 
+    // large at first and shrinking down to grainSize as the range is consumed -- so that 
+    // load stays balanced when per-item cost varies. The calling thread processes chunks 
+    // too and helps with other tasks while waiting, so calls can be nested inside tasks.
+    // Before App is initialized, runs everything on the calling thread.
+    template<typename F>
+    void ParallelFor(size_t count, size_t grainSize, F&& fn)
+    {
+        using Fn = std::remove_reference_t<F>;
+        ParallelForImpl(count, grainSize, const_cast<void*>(reinterpret_cast<const void*>(&fn)),
+            [](void* f, size_t begin, size_t end)
+            {
+                (*reinterpret_cast<Fn*>(f))(begin, end);
+            });
+    }
+    void ParallelForImpl(size_t count, size_t grainSize, void* fn, 
+        void (*call)(void* fn, size_t begin, size_t end));
 
     Core::RendererCore& GetRenderer();
     Scene::SceneCore& GetScene();
     const Scene::Camera& GetCamera();
+    // See Camera::SetTile()
+    void SetCameraTile(uint32_t fullWidth, uint32_t fullHeight, int offsetX, int offsetY);
     int GetNumWorkerThreads();
     int GetNumBackgroundThreads();
     uint32_t GetDPI();
@@ -148,10 +353,20 @@ namespace ZetaRay::App
     void SetUpscaleFactor(float f);
     bool IsFullScreen();
     const App::Timer& GetTimer();
+    Support::TaskTimeline& GetTaskTimeline();
+    // Exports the CPU and GPU timeline of the last few frames at the start of next frame
+    void ExportTaskTimeline();
 
+    // Param changes can be queued from any thread without locking and are applied once 
+    // per frame, in the order they were queued. AddParam() replaces an existing param 
+    // with the same ID, TryAddParam() leaves it unchanged.
     void AddParam(Support::ParamVariant& p);
     void TryAddParam(Support::ParamVariant& p);
     void RemoveParam(const char* group, const char* subgroup, const char* name);
+    // Called by ParamVariant setters. Callbacks run with the other param updates.
+    void QueueParamCallback(uint64_t id);
+    // Sorted by group, subgroup, subsubgroup and name, so that each (sub)group is a
+    // contiguous range
     Util::SynchronizedMutableSpan<Support::ParamVariant> GetParams();
 
     void AddShaderReloadHandler(const char* name, fastdelegate::FastDelegate0<> dlg);
@@ -167,7 +382,8 @@ namespace ZetaRay::App
     void AddFrameStat(const char* group, const char* name, uint64_t f);
     void AddFrameStat(const char* group, const char* name, uint32_t num, 
         uint32_t total);
-    Util::SynchronizedSpan<Support::Stat> GetStats();
+    // Stats from the previous frame. Valid until the start of the next frame.
+    Util::Span<Support::Stat> GetStats();
     Util::Span<float> GetFrameTimeHistory();
 
     const char* GetPSOCacheDir();
@@ -180,7 +396,10 @@ namespace ZetaRay::App
     void LockStdOut();
     void UnlockStdOut();
 
+    // Formats right away, prefer LOG_UI() (see Log.h), which defers formatting
     void Log(const char* msg, LogMessage::MsgType t);
+    // Drained once per frame by the main thread
+    Support::LogBuffer& GetLogBuffer();
     Util::RWSynchronizedView<Util::Vector<App::LogMessage, Support::SystemAllocator>> GetLogs();
     // Note: not thread safe.
     void CopyToClipboard(Util::StrView data);
@@ -203,9 +422,10 @@ namespace ZetaRay::App
 #ifndef NDEBUG
             Assert(m_numAllocs++ == 0, "This allocator can't be used more than once.");
 #endif
-            if (size + alignment - 1 < App::FRAME_ALLOCATOR_MAX_ALLOCATION_SIZE)
+            if (size + alignment - 1 <= App::GetFrameAllocatorMaxAllocationSize())
                 return App::AllocateFrameAllocator(size, alignment);
 
+            App::RecordFrameAllocatorFallback(size, alignment);
             m_usedFallback = true;
             return _aligned_malloc(size, alignment);
         }
@@ -12,6 +12,9 @@ namespace ZetaRay::App::Common
         constexpr uint16_t AVX2 = 0x8;
         constexpr uint16_t F16C = 0x10;
         constexpr uint16_t BMI1 = 0x20;
+        constexpr uint16_t FMA = 0x40;
+        // AVX-512 foundation, along with OS support for saving the ZMM registers
+        constexpr uint16_t AVX512 = 0x80;
     };
 
     int WideToCharStr(const wchar_t* wideStr, Util::MutableSpan<char> str);
@@ -7,13 +7,77 @@ namespace ZetaRay::App::Filesystem
 {
     // using a templated function for the allocator would be the obvious choice here, but unfortunately
     // that requires moving the implementation to the header file and exposing Windows.h to the whole codebase
+    // Read-only view of a file's contents
+    struct MappedFile
+    {
+        const uint8_t* Data = nullptr;
+        size_t Size = 0;
+        void* File = nullptr;
+        void* Mapping = nullptr;
+    };
+
     void LoadFromFile(const char* path, Util::Vector<uint8_t, Support::SystemAllocator>& fileData);
     void LoadFromFile(const char* path, Util::Vector<uint8_t, Support::ArenaAllocator>& fileData);
     void WriteToFile(const char* path, uint8_t* data, uint32_t sizeInBytes);
+    // Writes to the end of the file, which is created if it doesn't exist
+    void AppendToFile(const char* path, uint8_t* data, uint32_t sizeInBytes);
     void RemoveFile(const char* path);
     bool Exists(const char* path);
     size_t GetFileSize(const char* path);
+    // Returns 0 if file doesn't exist
+    uint64_t GetLastWriteTime(const char* path);
+    // Returns false if file doesn't exist or is empty
+    bool MapFile(const char* path, MappedFile& f);
+    void UnmapFile(MappedFile& f);
     void CreateDirectoryIfNotExists(const char* path);
     bool Copy(const char* srcPath, const char* dstPath, bool overwrite = false);
     bool IsDirectory(const char* path);
+
+    // Asynchronous reads into caller-provided memory. Requests that are submitted together
+    // are kept in flight at the same time from the calling thread, large ones are split
+    // into multiple reads so that the device queue stays deep. Uses IoRing when available
+    // (Windows 11), overlapped I/O otherwise.
+    struct ReadRequest
+    {
+        const char* Path;
+        void* Dst;
+        uint64_t Offset = 0;
+        size_t Size;
+        // Set after the batch has completed. False if file couldn't be opened or the
+        // range goes past the end of file.
+        bool Succeeded = false;
+    };
+
+    struct ReadBatch
+    {
+        bool IsValid() const { return Impl != nullptr; }
+
+        void* Impl = nullptr;
+    };
+
+    // Requests, paths and destinations must stay valid until Wait() returns
+    ReadBatch SubmitReads(Util::MutableSpan<ReadRequest> requests);
+    // Makes progress without blocking, returns true when all the reads have completed
+    bool IsComplete(ReadBatch& batch);
+    // Blocks until all the reads have completed and releases the batch. Returns true if
+    // all of them succeeded.
+    bool Wait(ReadBatch& batch);
+    // Submits a single read and waits for it
+    bool ReadFileRange(const char* path, void* dst, uint64_t offset, size_t size);
+
+    // Watches a directory and its subdirectories for files that are written to, created 
+    // or renamed. Changes are queued by the OS (overlapped ReadDirectoryChangesW), so 
+    // polling never blocks.
+    struct DirectoryWatcher
+    {
+        bool IsValid() const { return Impl != nullptr; }
+
+        void* Impl = nullptr;
+    };
+
+    // Returns an invalid watcher if directory couldn't be opened
+    DirectoryWatcher WatchDirectory(const char* path);
+    // Returns true if there's been any change since the last call
+    bool PollChanges(DirectoryWatcher& watcher);
+    void StopWatching(DirectoryWatcher& watcher);
 }
\ No newline at end of file
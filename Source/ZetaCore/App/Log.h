@@ -2,6 +2,23 @@
 
 #include "App.h"
 #include "../Utility/Error.h"
+#include "../Support/LogBuffer.h"
+
+namespace ZetaRay::App
+{
+    // Queues the message and its arguments, formatting happens on the main thread at the
+    // beginning of next frame. Format string must outlive the program, e.g. a string 
+    // literal. Falls back to formatting right away when the message can't be queued.
+    template<typename... Args>
+    void LogFormat(LogMessage::MsgType t, const char* fmt, Args... args)
+    {
+        if (!App::GetLogBuffer().Push(t, fmt, args...))
+        {
+            StackStr(msg, n, fmt, args...);
+            App::Log(msg, t);
+        }
+    }
+}
 
 #ifndef NDEBUG
 #define LOG_CONSOLE(formatStr, ...)          \
@@ -16,14 +33,12 @@
 
 #define LOG_UI(TYPE, formatStr, ...) LOG_UI_##TYPE(formatStr, __VA_ARGS__)
 
-#define LOG_UI_INFO(formatStr, ...)                     \
-{                                                       \
-    StackStr(msg, n_, formatStr, __VA_ARGS__);          \
-    App::Log(msg, App::LogMessage::INFO);               \
+#define LOG_UI_INFO(formatStr, ...)                                         \
+{                                                                           \
+    App::LogFormat(App::LogMessage::INFO, formatStr, __VA_ARGS__);          \
 }
 
-#define LOG_UI_WARNING(formatStr, ...)                  \
-{                                                       \
-    StackStr(msg, n_, formatStr, __VA_ARGS__);          \
-    App::Log(msg, App::LogMessage::WARNING);            \
+#define LOG_UI_WARNING(formatStr, ...)                                      \
+{                                                                           \
+    App::LogFormat(App::LogMessage::WARNING, formatStr, __VA_ARGS__);       \
 }
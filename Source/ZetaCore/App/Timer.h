@@ -11,6 +11,14 @@ namespace ZetaRay::App
 
         // Returns elapsed time since the last time Tick() was called
         ZetaInline double GetElapsedTime() const { return m_delta; }
+        // Time step that animation and simulation should advance by. Same as GetElapsedTime() 
+        // unless a fixed time step was set.
+        ZetaInline double GetSimulationDelta() const { return m_fixedDelta > 0.0 ? m_fixedDelta : m_delta; }
+        // Zero restores the default (variable) time step
+        ZetaInline void SetFixedTimestep(double dt) { m_fixedDelta = dt; }
+        // Returns time passed since the last Tick() up to now (in seconds) -- unlike 
+        // GetElapsedTime(), this queries the counter
+        double GetTimeSinceLastTick() const;
 
         // Get total number of updates since start of the program
         ZetaInline uint64_t GetTotalFrameCount() const { return m_frameCount; }
@@ -65,6 +73,8 @@ namespace ZetaRay::App
         int64_t m_elapsedCounts;
         // time passed since the last update
         double m_delta;
+        // when non-zero, replaces m_delta for simulation
+        double m_fixedDelta = 0.0;
     };
 
     struct DeltaTimer
@@ -22,6 +22,8 @@ CommandList::CommandList(D3D12_COMMAND_LIST_TYPE t, ID3D12CommandAllocator* cmdA
 void CommandList::Reset(ID3D12CommandAllocator* cmdAlloc)
 {
     Assert(m_cmdList && !m_cmdAllocator, "bug");
+    Assert(m_numDeferredLegacy + m_numDeferredBuffer + m_numDeferredTexture == 0, 
+        "Command list was reset with pending barriers.");
     m_cmdAllocator = cmdAlloc;
     CheckHR(m_cmdList->Reset(m_cmdAllocator, nullptr));
 
@@ -37,3 +39,146 @@ void CommandList::Reset(ID3D12CommandAllocator* cmdAlloc)
     };
     m_cmdList->SetDescriptorHeaps(ZetaArrayLen(heaps), heaps);
 }
+
+void CommandList::SubmitDeferredBarriers()
+{
+    if (m_numDeferredLegacy)
+        m_cmdList->ResourceBarrier(m_numDeferredLegacy, m_deferredLegacy);
+
+    D3D12_BARRIER_GROUP groups[2];
+    int numGroups = 0;
+
+    if (m_numDeferredBuffer)
+        groups[numGroups++] = Direct3DUtil::BarrierGroup(m_deferredBuffer, m_numDeferredBuffer);
+    if (m_numDeferredTexture)
+        groups[numGroups++] = Direct3DUtil::BarrierGroup(m_deferredTexture, m_numDeferredTexture);
+
+    if (numGroups)
+        m_cmdList->Barrier(numGroups, groups);
+
+    m_numDeferredLegacy = 0;
+    m_numDeferredBuffer = 0;
+    m_numDeferredTexture = 0;
+}
+
+//--------------------------------------------------------------------------------------
+// CopyCmdList
+//--------------------------------------------------------------------------------------
+
+void CopyCmdList::DeferBarrier(ID3D12Resource* res, D3D12_RESOURCE_STATES oldState, 
+    D3D12_RESOURCE_STATES newState, UINT subresource)
+{
+    Assert(oldState != newState, "Invalid barrier states");
+
+    if (m_numDeferredLegacy == MAX_DEFERRED_BARRIERS)
+        SubmitDeferredBarriers();
+
+    m_deferredLegacy[m_numDeferredLegacy++] = Direct3DUtil::TransitionBarrier(res, oldState, 
+        newState, subresource);
+}
+
+void CopyCmdList::DeferBarrier(const D3D12_BUFFER_BARRIER& barrier)
+{
+    const bool uavToUav = barrier.AccessBefore == D3D12_BARRIER_ACCESS_UNORDERED_ACCESS &&
+        barrier.AccessAfter == D3D12_BARRIER_ACCESS_UNORDERED_ACCESS;
+
+    if (uavToUav)
+    {
+        for (int i = 0; i < m_numDeferredBuffer; i++)
+        {
+            auto& b = m_deferredBuffer[i];
+
+            if (b.pResource == barrier.pResource &&
+                b.Offset == barrier.Offset &&
+                b.Size == barrier.Size &&
+                b.AccessBefore == D3D12_BARRIER_ACCESS_UNORDERED_ACCESS &&
+                b.AccessAfter == D3D12_BARRIER_ACCESS_UNORDERED_ACCESS)
+            {
+                b.SyncBefore |= barrier.SyncBefore;
+                b.SyncAfter |= barrier.SyncAfter;
+
+                return;
+            }
+        }
+    }
+
+    if (m_numDeferredBuffer == MAX_DEFERRED_BARRIERS)
+        SubmitDeferredBarriers();
+
+    m_deferredBuffer[m_numDeferredBuffer++] = barrier;
+}
+
+void CopyCmdList::DeferBarrier(const D3D12_TEXTURE_BARRIER& barrier)
+{
+    const bool uavToUav = barrier.AccessBefore == D3D12_BARRIER_ACCESS_UNORDERED_ACCESS &&
+        barrier.AccessAfter == D3D12_BARRIER_ACCESS_UNORDERED_ACCESS &&
+        barrier.LayoutBefore == barrier.LayoutAfter;
+
+    if (uavToUav)
+    {
+        for (int i = 0; i < m_numDeferredTexture; i++)
+        {
+            auto& b = m_deferredTexture[i];
+
+            if (b.pResource == barrier.pResource &&
+                b.AccessBefore == D3D12_BARRIER_ACCESS_UNORDERED_ACCESS &&
+                b.AccessAfter == D3D12_BARRIER_ACCESS_UNORDERED_ACCESS &&
+                b.LayoutBefore == barrier.LayoutBefore &&
+                b.LayoutAfter == barrier.LayoutAfter &&
+                b.Flags == barrier.Flags &&
+                memcmp(&b.Subresources, &barrier.Subresources, sizeof(b.Subresources)) == 0)
+            {
+                b.SyncBefore |= barrier.SyncBefore;
+                b.SyncAfter |= barrier.SyncAfter;
+
+                return;
+            }
+        }
+    }
+
+    if (m_numDeferredTexture == MAX_DEFERRED_BARRIERS)
+        SubmitDeferredBarriers();
+
+    m_deferredTexture[m_numDeferredTexture++] = barrier;
+}
+
+void CopyCmdList::DeferUAVBarrier(ID3D12Resource* res)
+{
+    int numRemaining = 0;
+
+    for (int i = 0; i < m_numDeferredLegacy; i++)
+    {
+        const auto& b = m_deferredLegacy[i];
+
+        if (b.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV)
+        {
+            // Already covered by a pending barrier
+            if (!b.UAV.pResource || b.UAV.pResource == res)
+                return;
+
+            // Subsumed by the new one
+            if (!res)
+                continue;
+        }
+
+        m_deferredLegacy[numRemaining++] = b;
+    }
+
+    m_numDeferredLegacy = numRemaining;
+
+    if (m_numDeferredLegacy == MAX_DEFERRED_BARRIERS)
+        SubmitDeferredBarriers();
+
+    m_deferredLegacy[m_numDeferredLegacy++] = Direct3DUtil::UAVBarrier(res);
+}
+
+//--------------------------------------------------------------------------------------
+// ComputeCmdList
+//--------------------------------------------------------------------------------------
+
+void ComputeCmdList::DispatchIndirect(ID3D12Resource* argBuffer, UINT64 argBufferOffset)
+{
+    FlushBarriers();
+    m_cmdList->ExecuteIndirect(App::GetRenderer().GetDispatchCmdSig(), 1, argBuffer, 
+        argBufferOffset, nullptr, 0);
+}
@@ -45,12 +45,34 @@ namespace ZetaRay::Core
             return m_cmdList.Get();
         }
 
+        // Submits the barriers that were recorded with the Defer*() calls. Called implicitly 
+        // before every command that may depend on them (dispatches, draws, copies, clears, 
+        // immediate barriers, etc.) and before the command list is closed.
+        ZetaInline void FlushBarriers()
+        {
+            if (m_numDeferredLegacy + m_numDeferredBuffer + m_numDeferredTexture)
+                SubmitDeferredBarriers();
+        }
+
     protected:
+        static constexpr int MAX_DEFERRED_BARRIERS = 16;
+
         CommandList(D3D12_COMMAND_LIST_TYPE t, ID3D12CommandAllocator* cmdAlloc);
+        void SubmitDeferredBarriers();
 
         D3D12_COMMAND_LIST_TYPE m_type;
         ComPtr<ID3D12GraphicsCommandList7> m_cmdList;
         ID3D12CommandAllocator* m_cmdAllocator = nullptr;
+        // Index of the thread that requested this command list (-1 when it doesn't have one).
+        // Allocator and command list are returned to that thread's cache after submission.
+        int m_ownerThread = -1;
+
+        D3D12_RESOURCE_BARRIER m_deferredLegacy[MAX_DEFERRED_BARRIERS];
+        D3D12_BUFFER_BARRIER m_deferredBuffer[MAX_DEFERRED_BARRIERS];
+        D3D12_TEXTURE_BARRIER m_deferredTexture[MAX_DEFERRED_BARRIERS];
+        int m_numDeferredLegacy = 0;
+        int m_numDeferredBuffer = 0;
+        int m_numDeferredTexture = 0;
     };
 
     //--------------------------------------------------------------------------------------
@@ -69,40 +91,47 @@ namespace ZetaRay::Core
         {
             Assert(oldState != newState, "Invalid barrier states");
             auto barrier = Direct3DUtil::TransitionBarrier(res, oldState, newState, subresource);
+            FlushBarriers();
             m_cmdList->ResourceBarrier(1, &barrier);
         }
 
         ZetaInline void ResourceBarrier(D3D12_RESOURCE_BARRIER* barriers, UINT numBarriers)
         {
+            FlushBarriers();
             m_cmdList->ResourceBarrier(numBarriers, barriers);
         }
 
         ZetaInline void ResourceBarrier(D3D12_BUFFER_BARRIER& barrier)
         {
             const auto barrierGroup = Direct3DUtil::BarrierGroup(&barrier, 1);
+            FlushBarriers();
             m_cmdList->Barrier(1, &barrierGroup);
         }
 
         ZetaInline void ResourceBarrier(D3D12_BUFFER_BARRIER* barriers, UINT numBarriers)
         {
             const auto barrierGroup = Direct3DUtil::BarrierGroup(barriers, numBarriers);
+            FlushBarriers();
             m_cmdList->Barrier(1, &barrierGroup);
         }
 
         ZetaInline void ResourceBarrier(D3D12_TEXTURE_BARRIER& barrier)
         {
             const auto barrierGroup = Direct3DUtil::BarrierGroup(&barrier, 1);
+            FlushBarriers();
             m_cmdList->Barrier(1, &barrierGroup);
         }
 
         ZetaInline void ResourceBarrier(D3D12_TEXTURE_BARRIER* barriers, UINT numBarriers)
         {
             const auto barrierGroup = Direct3DUtil::BarrierGroup(barriers, numBarriers);
+            FlushBarriers();
             m_cmdList->Barrier(1, &barrierGroup);
         }
 
         ZetaInline void ResourceBarrier(D3D12_BARRIER_GROUP* barrierGroups, UINT numBarrierGroups)
         {
+            FlushBarriers();
             m_cmdList->Barrier(numBarrierGroups, barrierGroups);
         }
 
@@ -110,22 +139,37 @@ namespace ZetaRay::Core
         {
             D3D12_RESOURCE_BARRIER barriers[1];
             barriers[0] = Direct3DUtil::UAVBarrier(res);
+            FlushBarriers();
             m_cmdList->ResourceBarrier(1, barriers);
         }
 
         ZetaInline void UAVBarrier(UINT numBarriers, D3D12_RESOURCE_BARRIER* barriers)
         {
+            FlushBarriers();
             m_cmdList->ResourceBarrier(numBarriers, barriers);
         }
 
+        // Deferred barriers are accumulated and submitted together as one batch (see 
+        // FlushBarriers()). UAV barriers on a resource that already has a pending UAV 
+        // barrier are merged into it. Barriers in the same batch shouldn't refer to the 
+        // same (sub)resource, except for the UAV barriers.
+        void DeferBarrier(ID3D12Resource* res, D3D12_RESOURCE_STATES oldState, D3D12_RESOURCE_STATES newState,
+            UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+        void DeferBarrier(const D3D12_BUFFER_BARRIER& barrier);
+        void DeferBarrier(const D3D12_TEXTURE_BARRIER& barrier);
+        // A null resource means any UAV access and subsumes the other pending UAV barriers
+        void DeferUAVBarrier(ID3D12Resource* res);
+
         ZetaInline void CopyResource(ID3D12Resource* dstResource, ID3D12Resource* srcResource)
         {
+            FlushBarriers();
             m_cmdList->CopyResource(dstResource, srcResource);
         }
 
         ZetaInline void CopyBufferRegion(ID3D12Resource* dstBuffer, UINT64 dstOffset, ID3D12Resource* srcBuffer,
             UINT64 srcOffset, UINT64 numBytes)
         {
+            FlushBarriers();
             m_cmdList->CopyBufferRegion(dstBuffer, dstOffset, srcBuffer, srcOffset, numBytes);
         }
 
@@ -136,6 +180,7 @@ namespace ZetaRay::Core
             const D3D12_TEXTURE_COPY_LOCATION* src,
             const D3D12_BOX* srcBox)
         {
+            FlushBarriers();
             m_cmdList->CopyTextureRegion(dst, dstX, dstY, dstZ, src, srcBox);
         }
     };
@@ -163,6 +208,7 @@ namespace ZetaRay::Core
             ID3D12Resource* destinationBuffer,
             UINT64 alignedDestinationBufferOffset)
         {
+            FlushBarriers();
             m_cmdList->ResolveQueryData(queryHeap, type, startIndex, numQueries, destinationBuffer, alignedDestinationBufferOffset);
         }
 
@@ -180,6 +226,7 @@ namespace ZetaRay::Core
         {
             FLOAT values[4] = { clearX, clearY, clearZ, ClearW };
 
+            FlushBarriers();
             m_cmdList->ClearUnorderedAccessViewFloat(
                 viewGPUHandleInCurrentHeap,
                 viewCPUHandle,
@@ -198,6 +245,7 @@ namespace ZetaRay::Core
         {
             UINT values[4] = { clearX, clearY, clearZ, clearW };
 
+            FlushBarriers();
             m_cmdList->ClearUnorderedAccessViewUint(viewGPUHandleInCurrentHeap,
                 viewCPUHandle,
                 resource,
@@ -261,9 +309,14 @@ namespace ZetaRay::Core
 
         ZetaInline void Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ)
         {
+            FlushBarriers();
             m_cmdList->Dispatch(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
         }
 
+        // Dispatch with thread group counts (D3D12_DISPATCH_ARGUMENTS) that are read from the 
+        // given buffer, which must be in the indirect argument state
+        void DispatchIndirect(ID3D12Resource* argBuffer, UINT64 argBufferOffset = 0);
+
         ZetaInline void SetPredication(ID3D12Resource* buffer, UINT64 bufferOffset, D3D12_PREDICATION_OP op)
         {
             m_cmdList->SetPredication(buffer, bufferOffset, op);
@@ -273,19 +326,44 @@ namespace ZetaRay::Core
             UINT numPostbuildInfoDescs,
             const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC* postbuildInfoDescs)
         {
+            FlushBarriers();
             m_cmdList->BuildRaytracingAccelerationStructure(desc, numPostbuildInfoDescs, postbuildInfoDescs);
         }
 
+        ZetaInline void EmitRaytracingAccelerationStructurePostbuildInfo(
+            const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC* desc,
+            UINT numSourceAccelerationStructures,
+            const D3D12_GPU_VIRTUAL_ADDRESS* sourceAccelerationStructureData)
+        {
+            FlushBarriers();
+            m_cmdList->EmitRaytracingAccelerationStructurePostbuildInfo(desc, 
+                numSourceAccelerationStructures, sourceAccelerationStructureData);
+        }
+
         ZetaInline void CompactAccelerationStructure(D3D12_GPU_VIRTUAL_ADDRESS dest, D3D12_GPU_VIRTUAL_ADDRESS src)
         {
+            FlushBarriers();
             m_cmdList->CopyRaytracingAccelerationStructure(dest, src, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
         }
 
         ZetaInline void CopyAccelerationStructure(D3D12_GPU_VIRTUAL_ADDRESS dest, D3D12_GPU_VIRTUAL_ADDRESS src)
         {
+            FlushBarriers();
             m_cmdList->CopyRaytracingAccelerationStructure(dest, src, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_CLONE);
         }
 
+        ZetaInline void SerializeAccelerationStructure(D3D12_GPU_VIRTUAL_ADDRESS dest, D3D12_GPU_VIRTUAL_ADDRESS src)
+        {
+            FlushBarriers();
+            m_cmdList->CopyRaytracingAccelerationStructure(dest, src, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_SERIALIZE);
+        }
+
+        ZetaInline void DeserializeAccelerationStructure(D3D12_GPU_VIRTUAL_ADDRESS dest, D3D12_GPU_VIRTUAL_ADDRESS src)
+        {
+            FlushBarriers();
+            m_cmdList->CopyRaytracingAccelerationStructure(dest, src, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_DESERIALIZE);
+        }
+
         ZetaInline void ExecuteIndirect(ID3D12CommandSignature* cmdSig,
             UINT maxCmdCount,
             ID3D12Resource* argBuffer,
@@ -293,6 +371,7 @@ namespace ZetaRay::Core
             ID3D12Resource* countBuffer,
             UINT64 countBufferOffset)
         {
+            FlushBarriers();
             m_cmdList->ExecuteIndirect(cmdSig, maxCmdCount, argBuffer, argBufferOffset, countBuffer, countBufferOffset);
         }
 
@@ -319,6 +398,7 @@ namespace ZetaRay::Core
             desc.Height = height;
             desc.Depth = depth;
 
+            FlushBarriers();
             m_cmdList->DispatchRays(&desc);
         }
     };
@@ -374,6 +454,7 @@ namespace ZetaRay::Core
             FLOAT depth = 1.0f, UINT8 stencil = 0,
             UINT numRects = 0, const D3D12_RECT* rects = nullptr)
         {
+            FlushBarriers();
             m_cmdList->ClearDepthStencilView(depthStencilView, clearFlags, depth, stencil, numRects, rects);
         }
 
@@ -382,6 +463,7 @@ namespace ZetaRay::Core
             UINT numRects = 0, const D3D12_RECT* rects = nullptr)
         {
             FLOAT rgb[4] = { r, g, b, a };
+            FlushBarriers();
             m_cmdList->ClearRenderTargetView(renderTargetView, rgb, numRects, rects);
         }
 
@@ -408,6 +490,7 @@ namespace ZetaRay::Core
             UINT startVertexLocation,
             UINT startInstanceLocation)
         {
+            FlushBarriers();
             m_cmdList->DrawInstanced(vertexCountPerInstance, instanceCount, startVertexLocation, startInstanceLocation);
         }
 
@@ -417,9 +500,16 @@ namespace ZetaRay::Core
             INT  baseVertexLocation,
             UINT startInstanceLocation)
         {
+            FlushBarriers();
             m_cmdList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
         }
 
+        ZetaInline void DispatchMesh(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ)
+        {
+            FlushBarriers();
+            m_cmdList->DispatchMesh(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+        }
+
         ZetaInline void OMSetRenderTargets(UINT numRenderTargetDescriptors, 
             const D3D12_CPU_DESCRIPTOR_HANDLE* renderTargetDescriptors,
             BOOL RTsSingleHandleToDescriptorRange, 
@@ -4,6 +4,16 @@
 
 using namespace ZetaRay;
 using namespace ZetaRay::Core;
+using namespace ZetaRay::Support;
+
+namespace
+{
+    ZetaInline bool AllocFenceCompare(const CommandQueue::ReleasedCmdAlloc& lhs,
+        const CommandQueue::ReleasedCmdAlloc& rhs)
+    {
+        return lhs.FenceToWaitFor > rhs.FenceToWaitFor;
+    }
+}
 
 //--------------------------------------------------------------------------------------
 // CommandQueue
@@ -28,6 +38,15 @@ CommandQueue::~CommandQueue()
 
         for (auto& it : m_cmdAllocPool)
             it.CmdAlloc->Release();
+
+        for (auto& cache : m_threadCaches)
+        {
+            for (uint32_t i = cache.AllocHead; i != cache.AllocTail; i++)
+                cache.Allocs[i & (NUM_CACHED_ALLOCS_PER_THREAD - 1)].CmdAlloc->Release();
+
+            for (int i = 0; i < cache.NumCmdLists; i++)
+                delete cache.CmdLists[i];
+        }
     }
 }
 
@@ -51,14 +70,10 @@ void CommandQueue::Init()
 
 uint64_t CommandQueue::ExecuteCommandList(CommandList* context)
 {
+    context->FlushBarriers();
     CheckHR(context->m_cmdList->Close());
 
-    ID3D12GraphicsCommandList* contexts[1] = { context->m_cmdList.Get() };
     m_cmdQueue->ExecuteCommandLists(1, (ID3D12CommandList**)context->m_cmdList.GetAddressOf());
-
-    ReleaseCommandAllocator(context->m_cmdAllocator, m_nextFenceValue);
-    context->m_cmdAllocator = nullptr;
-    App::GetRenderer().ReleaseCmdList(context);
     uint64_t ret;
 
     {
@@ -69,10 +84,52 @@ uint64_t CommandQueue::ExecuteCommandList(CommandList* context)
         ret = m_nextFenceValue++;
     }
 
+    // Fence value has to be the one that was signaled above -- reading m_nextFenceValue 
+    // outside the lock could race with submissions from other threads. Submitting thread
+    // isn't necessarily the one that recorded the command list, allocator goes back to
+    // the latter.
+    ReleaseCommandAllocator(context->m_cmdAllocator, ret, context->m_ownerThread);
+    context->m_cmdAllocator = nullptr;
+    App::GetRenderer().ReleaseCmdList(context);
+
     return ret;
 }
 
 ID3D12CommandAllocator* CommandQueue::GetCommandAllocator()
+{
+    // Try the calling thread's cache first
+    if (g_threadIdx >= 0 && g_threadIdx < MAX_NUM_THREADS)
+    {
+        ThreadCache& cache = m_threadCaches[g_threadIdx];
+        ID3D12CommandAllocator* cmdAlloc = nullptr;
+
+        AcquireSRWLockExclusive(&cache.Lock);
+
+        if (cache.AllocHead != cache.AllocTail)
+        {
+            const ReleasedCmdAlloc& oldest = cache.Allocs[cache.AllocHead & (NUM_CACHED_ALLOCS_PER_THREAD - 1)];
+
+            if (oldest.FenceToWaitFor <= m_lastCompletedFenceVal ||
+                oldest.FenceToWaitFor <= m_fence->GetCompletedValue())
+            {
+                cmdAlloc = oldest.CmdAlloc;
+                cache.AllocHead++;
+            }
+        }
+
+        ReleaseSRWLockExclusive(&cache.Lock);
+
+        if (cmdAlloc)
+        {
+            CheckHR(cmdAlloc->Reset());
+            return cmdAlloc;
+        }
+    }
+
+    return GetCommandAllocatorFromPool();
+}
+
+ID3D12CommandAllocator* CommandQueue::GetCommandAllocatorFromPool()
 {
     // Try to reuse
     {
@@ -85,14 +142,9 @@ ID3D12CommandAllocator* CommandQueue::GetCommandAllocator()
             // only need to compare against the smallest fence in the pool
             if (!m_cmdAllocPool.empty() && m_cmdAllocPool[0].FenceToWaitFor <= m_lastCompletedFenceVal)
             {
-                cmdAlloc = m_cmdAllocPool[0];
-                m_cmdAllocPool.erase_at_index(0);
-
-                std::make_heap(m_cmdAllocPool.begin(), m_cmdAllocPool.end(),
-                    [](const ReleasedCmdAlloc& lhs, const ReleasedCmdAlloc& rhs)
-                    {
-                        return lhs.FenceToWaitFor > rhs.FenceToWaitFor;
-                    });
+                std::pop_heap(m_cmdAllocPool.begin(), m_cmdAllocPool.end(), AllocFenceCompare);
+                cmdAlloc = m_cmdAllocPool.back();
+                m_cmdAllocPool.pop_back();
 
                 found = true;
             }
@@ -114,32 +166,79 @@ ID3D12CommandAllocator* CommandQueue::GetCommandAllocator()
 }
 
 void CommandQueue::ReleaseCommandAllocator(ID3D12CommandAllocator* cmdAllocator, 
-    uint64_t fenceValueToWaitFor)
+    uint64_t fenceValueToWaitFor, int ownerThread)
 {
+    if (ownerThread != -1)
+    {
+        ThreadCache& cache = m_threadCaches[ownerThread];
+        bool cached = false;
+
+        AcquireSRWLockExclusive(&cache.Lock);
+        if (cache.AllocTail - cache.AllocHead < NUM_CACHED_ALLOCS_PER_THREAD)
+        {
+            cache.Allocs[cache.AllocTail++ & (NUM_CACHED_ALLOCS_PER_THREAD - 1)] = ReleasedCmdAlloc{
+                .CmdAlloc = cmdAllocator,
+                .FenceToWaitFor = fenceValueToWaitFor };
+            cached = true;
+        }
+        ReleaseSRWLockExclusive(&cache.Lock);
+
+        if (cached)
+            return;
+    }
+
     std::unique_lock lock(m_poolMtx);
     m_cmdAllocPool.push_back(ReleasedCmdAlloc{ 
         .CmdAlloc = cmdAllocator, 
         .FenceToWaitFor = fenceValueToWaitFor });
+    std::push_heap(m_cmdAllocPool.begin(), m_cmdAllocPool.end(), AllocFenceCompare);
 }
 
 CommandList* CommandQueue::GetCommandList()
 {
     auto* cmdAlloc = GetCommandAllocator();
-    CommandList* ctx;
+    CommandList* ctx = nullptr;
+    const bool hasCache = g_threadIdx >= 0 && g_threadIdx < MAX_NUM_THREADS;
 
-    if (m_contextPool.try_dequeue(ctx))
+    if (hasCache)
     {
-        ctx->Reset(cmdAlloc);
-        return ctx;
+        ThreadCache& cache = m_threadCaches[g_threadIdx];
+
+        AcquireSRWLockExclusive(&cache.Lock);
+        if (cache.NumCmdLists > 0)
+            ctx = cache.CmdLists[--cache.NumCmdLists];
+        ReleaseSRWLockExclusive(&cache.Lock);
     }
 
-    CommandList* context = new(std::nothrow) CommandList(m_type, cmdAlloc);
+    if (ctx || m_contextPool.try_dequeue(ctx))
+        ctx->Reset(cmdAlloc);
+    else
+        ctx = new(std::nothrow) CommandList(m_type, cmdAlloc);
+
+    ctx->m_ownerThread = hasCache ? g_threadIdx : -1;
 
-    return context;
+    return ctx;
 }
 
 void CommandQueue::ReleaseCommandList(CommandList* context)
 {
+    if (context->m_ownerThread != -1)
+    {
+        ThreadCache& cache = m_threadCaches[context->m_ownerThread];
+        bool cached = false;
+
+        AcquireSRWLockExclusive(&cache.Lock);
+        if (cache.NumCmdLists < NUM_CACHED_CMD_LISTS_PER_THREAD)
+        {
+            cache.CmdLists[cache.NumCmdLists++] = context;
+            cached = true;
+        }
+        ReleaseSRWLockExclusive(&cache.Lock);
+
+        if (cached)
+            return;
+    }
+
     m_contextPool.enqueue(context);
 }
 
@@ -22,8 +22,10 @@ namespace ZetaRay::Core
         CommandList* GetCommandList();
 
         // Returns the command allocator for future reuse (once the specified fence value
-        // has passed on this command queue)
-        void ReleaseCommandAllocator(ID3D12CommandAllocator* cmdAlloc, uint64_t fenceValueToWaitFor);
+        // has passed on this command queue). When the owner thread is given, allocator is
+        // returned to that thread's cache.
+        void ReleaseCommandAllocator(ID3D12CommandAllocator* cmdAlloc, uint64_t fenceValueToWaitFor,
+            int ownerThread = -1);
 
         // Releases command list back to the pool of available ones (command lists can be safely reused 
         // after submission, unlike command allocator)
@@ -37,7 +39,14 @@ namespace ZetaRay::Core
         bool IsFenceComplete(uint64_t fenceValue);
 
     public:
+        // Number of allocators and command lists that each thread keeps for itself. Anything
+        // beyond that goes to the shared pools.
+        static constexpr uint32_t NUM_CACHED_ALLOCS_PER_THREAD = 16;
+        static constexpr int NUM_CACHED_CMD_LISTS_PER_THREAD = 8;
+        static_assert(Math::IsPow2(NUM_CACHED_ALLOCS_PER_THREAD), "Ring buffer size must be a power of two.");
+
         ID3D12CommandAllocator* GetCommandAllocator();
+        ID3D12CommandAllocator* GetCommandAllocatorFromPool();
 
         D3D12_COMMAND_LIST_TYPE m_type;
         ComPtr<ID3D12CommandQueue> m_cmdQueue;
@@ -57,6 +66,23 @@ namespace ZetaRay::Core
 
         Util::SmallVector<ReleasedCmdAlloc, Support::SystemAllocator, 8> m_cmdAllocPool;
 
+        // Command allocators and lists that were used by each thread. Recording threads 
+        // mostly reuse their own, so they don't contend on the shared pools. Lock is only 
+        // shared between the owner thread and the thread that submits its command lists.
+        struct alignas(64) ThreadCache
+        {
+            SRWLOCK Lock = SRWLOCK_INIT;
+            // Ring buffer -- allocators are released in roughly increasing fence order, 
+            // so only the oldest one needs to be checked
+            ReleasedCmdAlloc Allocs[NUM_CACHED_ALLOCS_PER_THREAD];
+            uint32_t AllocHead = 0;
+            uint32_t AllocTail = 0;
+            CommandList* CmdLists[NUM_CACHED_CMD_LISTS_PER_THREAD];
+            int NumCmdLists = 0;
+        };
+
+        ThreadCache m_threadCaches[Support::MAX_NUM_THREADS];
+
         struct MyTraits : public moodycamel::ConcurrentQueueDefaultTraits
         {
             static const size_t BLOCK_SIZE = 512;
@@ -4,14 +4,25 @@
 
 namespace ZetaRay::Core::Constants
 {
-    static constexpr int NUM_BACK_BUFFERS = 3;
+    // Number of frames that GPU is allowed to have queued up while CPU records the next
+    // one. Can be changed at runtime within [MIN_FRAMES_IN_FLIGHT, MAX_FRAMES_IN_FLIGHT].
+    static constexpr int MIN_FRAMES_IN_FLIGHT = 2;
+    static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
+    static constexpr int DEFAULT_FRAMES_IN_FLIGHT = 2;
+    // One extra for the frame that is being recorded
+    static constexpr int NUM_BACK_BUFFERS = MAX_FRAMES_IN_FLIGHT + 1;
     static constexpr DXGI_FORMAT BACK_BUFFER_FORMAT = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
 
-    static constexpr int NUM_CBV_SRV_UAV_DESC_HEAP_GPU_DESCRIPTORS = 4096;
-    static constexpr int NUM_CBV_SRV_UAV_DESC_HEAP_CPU_DESCRIPTORS = 128;
+    // Texture streaming publishes new copies of the scene's descriptor tables while the
+    // prior ones might still be in use
+    static constexpr int NUM_CBV_SRV_UAV_DESC_HEAP_GPU_DESCRIPTORS = 8192;
+    // Per frame in flight, in addition to the above
+    static constexpr int NUM_TRANSIENT_GPU_DESCRIPTORS_PER_FRAME = 512;
+    static constexpr int NUM_CBV_SRV_UAV_DESC_HEAP_CPU_DESCRIPTORS = 1024;
+    // Per thread, see DescriptorStagingHeap
+    static constexpr int NUM_STAGING_DESCRIPTORS_PER_THREAD = 128;
     static constexpr int NUM_RTV_DESC_HEAP_DESCRIPTORS = 32;
     static constexpr int NUM_DSV_DESC_HEAP_DESCRIPTORS = 8;
-    static constexpr int MAX_SWAPCHAIN_FRAME_LATENCY = 2;
 
     static constexpr D3D12_RESOURCE_STATES VALID_BUFFER_STATES =
         D3D12_RESOURCE_STATE_COMMON |
@@ -4,6 +4,7 @@
 
 using namespace ZetaRay;
 using namespace ZetaRay::Core;
+using namespace ZetaRay::Support;
 
 //--------------------------------------------------------------------------------------
 // DescriptorTable
@@ -62,7 +63,8 @@ DescriptorTable& DescriptorTable::operator=(DescriptorTable&& other)
 // TODO needs more testing
 void DescriptorTable::Reset()
 {
-    if (m_baseCpuHandle.ptr)
+    // Transient tables are freed in bulk
+    if (m_baseCpuHandle.ptr && m_internal != TRANSIENT)
         m_descHeap->Release(ZetaMove(*this));
 
     m_descHeap = nullptr;
@@ -93,21 +95,26 @@ DescriptorHeap::DescriptorHeap(uint32_t blockSize)
 }
 
 void DescriptorHeap::Init(D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t numDescriptors, 
-    bool isShaderVisible)
+    bool isShaderVisible, uint32_t numTransientDescriptorsPerFrame)
 {
+    const uint32_t numTransient = numTransientDescriptorsPerFrame * NUM_TRANSIENT_SEGMENTS;
+
     Assert(!isShaderVisible || heapType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
         "Shader-visible heap type must be D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV.");
-    Assert(!isShaderVisible || numDescriptors <= 1'000'000,
+    Assert(!isShaderVisible || numDescriptors + numTransient <= 1'000'000,
         "GPU resource heap can't contain more than 1'000'000 elements");
     Assert(numDescriptors >= m_blockSize, "#descriptors=%u is invalid for block size of %u.", 
         numDescriptors, m_blockSize);
+    Assert(!numTransient || isShaderVisible, "Transient ring requires a shader-visible heap.");
 
+    // Free lists only manage the first numDescriptors descriptors
     m_totalHeapSize = numDescriptors;
     m_isShaderVisible = isShaderVisible;
+    m_transientSegmentSize = numTransientDescriptorsPerFrame;
 
     D3D12_DESCRIPTOR_HEAP_DESC desc;
     desc.Type = heapType;
-    desc.NumDescriptors = numDescriptors;
+    desc.NumDescriptors = numDescriptors + numTransient;
     desc.Flags = isShaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : 
         D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
     desc.NodeMask = 0;
@@ -123,6 +130,14 @@ void DescriptorHeap::Init(D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t numDescr
         m_baseGPUHandle = m_heap->GetGPUDescriptorHandleForHeapStart();
 
     CheckHR(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.GetAddressOf())));
+
+    if (numTransient)
+    {
+        CheckHR(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, 
+            IID_PPV_ARGS(m_transientFenceDirect.GetAddressOf())));
+        CheckHR(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, 
+            IID_PPV_ARGS(m_transientFenceCompute.GetAddressOf())));
+    }
 }
 
 bool DescriptorHeap::AllocateNewBlock(uint32_t listIdx)
@@ -243,6 +258,53 @@ DescriptorTable DescriptorHeap::Allocate(uint32_t count)
         arrayOffset);
 }
 
+DescriptorTable DescriptorHeap::AllocateTransient(uint32_t count)
+{
+    Assert(m_transientSegmentSize, "Transient ring hasn't been initialized.");
+    Assert(count, "Invalid allocation count.");
+
+    const uint32_t offset = m_transientHead.fetch_add(count, std::memory_order_relaxed);
+    Check(offset + count <= m_transientSegmentSize, 
+        "Out of transient descriptors for this frame (per-frame size: %u).", m_transientSegmentSize);
+
+    const uint32_t heapOffset = m_totalHeapSize + m_currTransientSegment * m_transientSegmentSize + 
+        offset;
+
+    D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle{ .ptr = 
+        m_baseCPUHandle.ptr + heapOffset * m_descriptorSize };
+    D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle{ .ptr = 
+        m_baseGPUHandle.ptr + heapOffset * m_descriptorSize };
+
+    return DescriptorTable(cpuHandle,
+        gpuHandle,
+        count,
+        m_descriptorSize,
+        this,
+        DescriptorTable::TRANSIENT);
+}
+
+void DescriptorHeap::AdvanceTransientRing()
+{
+    // Descriptors can be referenced from both direct and compute queues
+    auto& renderer = App::GetRenderer();
+    renderer.SignalDirectQueue(m_transientFenceDirect.Get(), m_nextTransientFenceVal);
+    renderer.SignalComputeQueue(m_transientFenceCompute.Get(), m_nextTransientFenceVal);
+    m_transientSegmentFence[m_currTransientSegment] = m_nextTransientFenceVal++;
+
+    const int nextSegment = (m_currTransientSegment + 1) % NUM_TRANSIENT_SEGMENTS;
+    const uint64_t waitVal = m_transientSegmentFence[nextSegment];
+
+    // Rarely blocks -- frame latency is already limited to fewer frames than there are 
+    // segments. Null event blocks until the fence has reached the given value.
+    if (m_transientFenceDirect->GetCompletedValue() < waitVal)
+        CheckHR(m_transientFenceDirect->SetEventOnCompletion(waitVal, nullptr));
+    if (m_transientFenceCompute->GetCompletedValue() < waitVal)
+        CheckHR(m_transientFenceCompute->SetEventOnCompletion(waitVal, nullptr));
+
+    m_currTransientSegment = nextSegment;
+    m_transientHead.store(0, std::memory_order_relaxed);
+}
+
 void DescriptorHeap::Release(DescriptorTable&& table)
 {
     const uint32_t offset = 
@@ -255,6 +317,9 @@ void DescriptorHeap::Release(DescriptorTable&& table)
 
 void DescriptorHeap::Recycle()
 {
+    if (m_transientSegmentSize)
+        AdvanceTransientRing();
+
     if (m_pending.empty())
         return;
 
@@ -316,3 +381,82 @@ void DescriptorHeap::Recycle()
         currPending = m_pending.erase(*currPending);
     }
 }
+
+//--------------------------------------------------------------------------------------
+// DescriptorStagingHeap
+//--------------------------------------------------------------------------------------
+
+void DescriptorStagingHeap::Init(D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t numDescriptorsPerThread)
+{
+    Assert(numDescriptorsPerThread, "Invalid number of descriptors.");
+
+    m_heapType = heapType;
+    m_numDescriptorsPerThread = numDescriptorsPerThread;
+
+    D3D12_DESCRIPTOR_HEAP_DESC desc;
+    desc.Type = heapType;
+    desc.NumDescriptors = numDescriptorsPerThread * MAX_NUM_THREADS;
+    desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    desc.NodeMask = 0;
+
+    auto* device = App::GetRenderer().GetDevice();
+    CheckHR(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(m_heap.GetAddressOf())));
+
+    m_descriptorSize = device->GetDescriptorHandleIncrementSize(heapType);
+    m_baseCPUHandle = m_heap->GetCPUDescriptorHandleForHeapStart();
+
+    for (auto& b : m_batches)
+    {
+        b.DstStarts.reserve(numDescriptorsPerThread);
+        b.DstSizes.reserve(numDescriptorsPerThread);
+    }
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorStagingHeap::Stage(const DescriptorTable& dst, uint32_t offset)
+{
+    Assert(g_threadIdx >= 0 && g_threadIdx < MAX_NUM_THREADS, "Invalid thread index.");
+    const uint32_t threadIdx = (uint32_t)g_threadIdx;
+    ThreadBatch& batch = m_batches[threadIdx];
+
+    if (batch.NumStaged == m_numDescriptorsPerThread)
+        Flush();
+
+    const D3D12_CPU_DESCRIPTOR_HANDLE dstHandle = dst.CPUHandle(offset);
+
+    if (!batch.DstStarts.empty() && 
+        batch.DstStarts.back().ptr + batch.DstSizes.back() * m_descriptorSize == dstHandle.ptr)
+    {
+        batch.DstSizes.back()++;
+    }
+    else
+    {
+        batch.DstStarts.push_back(dstHandle);
+        batch.DstSizes.push_back(1);
+    }
+
+    const uint32_t heapOffset = threadIdx * m_numDescriptorsPerThread + batch.NumStaged++;
+
+    return D3D12_CPU_DESCRIPTOR_HANDLE{ .ptr = m_baseCPUHandle.ptr + heapOffset * m_descriptorSize };
+}
+
+void DescriptorStagingHeap::Flush()
+{
+    Assert(g_threadIdx >= 0 && g_threadIdx < MAX_NUM_THREADS, "Invalid thread index.");
+    const uint32_t threadIdx = (uint32_t)g_threadIdx;
+    ThreadBatch& batch = m_batches[threadIdx];
+
+    if (!batch.NumStaged)
+        return;
+
+    const D3D12_CPU_DESCRIPTOR_HANDLE srcStart{ .ptr = m_baseCPUHandle.ptr + 
+        threadIdx * m_numDescriptorsPerThread * m_descriptorSize };
+    const UINT srcSize = batch.NumStaged;
+
+    auto* device = App::GetRenderer().GetDevice();
+    device->CopyDescriptors((UINT)batch.DstStarts.size(), batch.DstStarts.data(), 
+        batch.DstSizes.data(), 1, &srcStart, &srcSize, m_heapType);
+
+    batch.NumStaged = 0;
+    batch.DstStarts.clear();
+    batch.DstSizes.clear();
+}
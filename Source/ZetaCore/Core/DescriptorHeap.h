@@ -1,7 +1,9 @@
 #pragma once
 
+#include "../App/App.h"
 #include "../Utility/SmallVector.h"
-#include "Device.h"
+#include "Config.h"
+#include <atomic>
 
 namespace ZetaRay::Core
 {
@@ -15,9 +17,19 @@ namespace ZetaRay::Core
         DescriptorHeap(const DescriptorHeap&) = delete;
         DescriptorHeap& operator=(const DescriptorHeap&) = delete;
 
-        void Init(D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t numDescriptors, bool isShaderVisible);
+        // When numTransientDescriptorsPerFrame isn't zero, a ring of that many descriptors per
+        // frame in flight is placed after the first numDescriptors descriptors
+        void Init(D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t numDescriptors, bool isShaderVisible,
+            uint32_t numTransientDescriptorsPerFrame = 0);
         DescriptorTable Allocate(uint32_t count);
+        // Wait-free allocation from the current frame's region of the transient ring -- safe to 
+        // call from any thread that records commands. Returned table is only valid for the 
+        // current frame and doesn't need to be released; the whole region is reused once the
+        // GPU has finished the frame.
+        DescriptorTable AllocateTransient(uint32_t count);
         void Release(DescriptorTable&& descTable);
+        // Must be called once at the end of each frame, after all the command lists that 
+        // reference this heap have been submitted
         void Recycle();
 
         ZetaInline bool IsShaderVisible() const { return m_isShaderVisible; }
@@ -85,6 +97,7 @@ namespace ZetaRay::Core
         }
 
         bool AllocateNewBlock(uint32_t listIdx);
+        void AdvanceTransientRing();
 
         SRWLOCK m_lock = SRWLOCK_INIT;
 
@@ -109,6 +122,58 @@ namespace ZetaRay::Core
 
         uint32_t m_nextHeapIdx = 0;
         Util::SmallVector<ReleasedLargeBlock> m_releasedBlocks;
+
+        // Transient ring -- one segment per frame that can be in flight, plus the one that's 
+        // being recorded
+        static constexpr int NUM_TRANSIENT_SEGMENTS = Constants::MAX_FRAMES_IN_FLIGHT + 1;
+
+        uint32_t m_transientSegmentSize = 0;
+        int m_currTransientSegment = 0;
+        std::atomic_uint32_t m_transientHead = 0;
+        // Fence value that marks GPU completion of the last frame that used each segment
+        uint64_t m_transientSegmentFence[NUM_TRANSIENT_SEGMENTS] = { 0 };
+        uint64_t m_nextTransientFenceVal = 1;
+        ComPtr<ID3D12Fence> m_transientFenceDirect;
+        ComPtr<ID3D12Fence> m_transientFenceCompute;
+    };
+
+    // CPU-only heap that views are created into before they're copied to their destination
+    // descriptor tables (usually in the shader-visible heap, which is slow to write to) in
+    // batches. Each thread (as identified by g_threadIdx) stages into its own region, so
+    // no synchronization is needed.
+    struct DescriptorStagingHeap
+    {
+        DescriptorStagingHeap() = default;
+        ~DescriptorStagingHeap() = default;
+
+        DescriptorStagingHeap(const DescriptorStagingHeap&) = delete;
+        DescriptorStagingHeap& operator=(const DescriptorStagingHeap&) = delete;
+
+        void Init(D3D12_DESCRIPTOR_HEAP_TYPE heapType, uint32_t numDescriptorsPerThread);
+        // Returns the CPU handle that the view for descriptor "offset" of "dst" should be 
+        // created at. The view has to be created before the next call to Stage() or Flush() 
+        // from the same thread. It's copied to "dst" on the calling thread's next Flush(), 
+        // or earlier once its region is full.
+        D3D12_CPU_DESCRIPTOR_HANDLE Stage(const DescriptorTable& dst, uint32_t offset);
+        // Copies the descriptors that were staged by the calling thread with one 
+        // CopyDescriptors() call
+        void Flush();
+
+    private:
+        struct alignas(64) ThreadBatch
+        {
+            uint32_t NumStaged = 0;
+            // Adjacent destinations are merged into one range
+            Util::SmallVector<D3D12_CPU_DESCRIPTOR_HANDLE> DstStarts;
+            Util::SmallVector<UINT> DstSizes;
+        };
+
+        ComPtr<ID3D12DescriptorHeap> m_heap;
+        D3D12_CPU_DESCRIPTOR_HANDLE m_baseCPUHandle = { 0 };
+        D3D12_DESCRIPTOR_HEAP_TYPE m_heapType = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+        uint32_t m_descriptorSize = 0;
+        uint32_t m_numDescriptorsPerThread = 0;
+        ThreadBatch m_batches[Support::MAX_NUM_THREADS];
     };
 
     // A contiguous range of descriptors that are allocated from one DescriptorHeap
@@ -116,6 +181,9 @@ namespace ZetaRay::Core
     {
         friend struct DescriptorHeap;
 
+        // Internal value for tables that are allocated from the transient ring
+        static constexpr uint32_t TRANSIENT = UINT32_MAX - 1;
+
         DescriptorTable() = default;
         DescriptorTable(D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle,
             D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle,
@@ -12,7 +12,7 @@ using namespace ZetaRay;
 using namespace ZetaRay::Core;
 using namespace ZetaRay::App;
 
-void DeviceObjects::InitializeAdapter()
+void DeviceObjects::InitializeAdapter(int adapterIdx)
 {
 #if !defined(NDEBUG) && defined(DIREC3D_DEBUG_LAYER)
     {
@@ -41,8 +41,10 @@ void DeviceObjects::InitializeAdapter()
 #endif
 
     IDXGIAdapter* dxgiAdapter;
-    CheckHR(m_dxgiFactory->EnumAdapterByGpuPreference(0, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, 
-        IID_PPV_ARGS(&dxgiAdapter)));
+    HRESULT hr = m_dxgiFactory->EnumAdapterByGpuPreference(adapterIdx < 0 ? 0 : (UINT)adapterIdx, 
+        DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, IID_PPV_ARGS(&dxgiAdapter));
+    Check(hr != DXGI_ERROR_NOT_FOUND, "Adapter %d was not found.", adapterIdx);
+    CheckHR(hr);
     CheckHR(dxgiAdapter->QueryInterface(IID_PPV_ARGS(m_dxgiAdapter.GetAddressOf())));
     dxgiAdapter->Release();
 
@@ -50,6 +52,9 @@ void DeviceObjects::InitializeAdapter()
     CheckHR(m_dxgiAdapter->GetDesc2(&desc));
 
     Common::WideToCharStr(desc.Description, m_deviceName);
+    m_vendorID = desc.VendorId;
+    m_deviceID = desc.DeviceId;
+    m_dedicatedVideoMemory = desc.DedicatedVideoMemory;
 }
 
 void DeviceObjects::CreateDevice(bool checkFeatureSupport)
@@ -128,6 +133,8 @@ void DeviceObjects::CreateDevice(bool checkFeatureSupport)
         &options1, sizeof(options1)));
     Check(options1.WaveOps, "Wave intrinsics are not supported.");
     Check(options1.WaveLaneCountMin >= 32, "Wave lane count of at least 32 is required.");
+    m_waveLaneCountMin = options1.WaveLaneCountMin;
+    m_waveLaneCountMax = options1.WaveLaneCountMax;
 
     // Enhanced barriers
     D3D12_FEATURE_DATA_D3D12_OPTIONS12 options12{};
@@ -135,6 +142,28 @@ void DeviceObjects::CreateDevice(bool checkFeatureSupport)
         &options12, sizeof(options12)));
     Check(options12.EnhancedBarriersSupported, "Enhanced barriers are not supported.");
 
+    // Reserved resources
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options{};
+    CheckHR(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, 
+        &options, sizeof(options)));
+    m_reservedResourceSupport = options.TiledResourcesTier >= D3D12_TILED_RESOURCES_TIER_2;
+
+    // Mesh shaders
+    D3D12_FEATURE_DATA_D3D12_OPTIONS7 options7{};
+    if (SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS7, 
+        &options7, sizeof(options7))))
+    {
+        m_meshShaderSupport = options7.MeshShaderTier >= D3D12_MESH_SHADER_TIER_1;
+    }
+
+    // GPU upload heaps
+    D3D12_FEATURE_DATA_D3D12_OPTIONS16 options16{};
+    if (SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS16, 
+        &options16, sizeof(options16))))
+    {
+        m_gpuUploadHeapSupport = options16.GPUUploadHeapSupported;
+    }
+
     // RGBE support
     D3D12_FEATURE_DATA_FORMAT_SUPPORT formatSupport{};
     formatSupport.Format = DXGI_FORMAT_R9G9B9E5_SHAREDEXP;
@@ -78,7 +78,8 @@ namespace ZetaRay::Core
     class DeviceObjects
     {
     public:
-        void InitializeAdapter();
+        // Adapters are ordered from highest to lowest performance. -1 picks the first one.
+        void InitializeAdapter(int adapterIdx = -1);
         void CreateDevice(bool checkFeatureSupport);
         void CreateSwapChain(ID3D12CommandQueue* directQueue, HWND hwnd, int w, int h, int numBuffers,
             DXGI_FORMAT format, int maxLatency);
@@ -91,10 +92,23 @@ namespace ZetaRay::Core
 
         bool m_tearingSupport = false;
         bool m_rgbeSupport = false;
+        // Tier 2 or higher -- reads from unmapped tiles return zero
+        bool m_reservedResourceSupport = false;
+        // Mesh and amplification shaders (Tier 1)
+        bool m_meshShaderSupport = false;
+        // CPU-visible video memory (resizable BAR)
+        bool m_gpuUploadHeapSupport = false;
         //UINT m_swapChainFlags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
         UINT m_swapChainFlags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
         HANDLE m_frameLatencyWaitableObj;
 
         char m_deviceName[64] = { '\0' };
+        uint32_t m_vendorID = 0;
+        uint32_t m_deviceID = 0;
+        // In bytes
+        uint64_t m_dedicatedVideoMemory = 0;
+        // Only set when feature support is checked
+        uint32_t m_waveLaneCountMin = 0;
+        uint32_t m_waveLaneCountMax = 0;
     };
 }
\ No newline at end of file
@@ -2,7 +2,10 @@
 #include "dds.h"
 #include "RendererCore.h"
 #include "../Support/MemoryArena.h"
+#include "../App/Filesystem.h"
 #include <xxHash/xxhash.h>
+#include <basisu/transcoder/basisu_transcoder.h>
+#include <basisu/zstd/zstd.h>
 
 using namespace ZetaRay;
 using namespace ZetaRay::Util;
@@ -526,75 +529,31 @@ namespace
     {
         Assert(header && bitData && bitSize, "invalid args.");
 
-        // open the file
-        HANDLE hFile = CreateFileA(fileName,
-            GENERIC_READ,
-            FILE_SHARE_READ,
-            nullptr,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            nullptr);
-
-        if (hFile == INVALID_HANDLE_VALUE)
-        {
-            if (GetLastError() == ERROR_FILE_NOT_FOUND)
-                return LOAD_DDS_RESULT::FILE_NOT_FOUND;
-
-            return LOAD_DDS_RESULT::UNKNOWN;
-        }
-
-        // Get the file size
-        FILE_STANDARD_INFO fileInfo;
-        if (!GetFileInformationByHandleEx(hFile, FileStandardInfo, &fileInfo, sizeof(fileInfo)))
-        {
-            CloseHandle(hFile);
-            CheckWin32(false);
-            return LOAD_DDS_RESULT::UNKNOWN;
-        }
+        const size_t fileSize = Filesystem::GetFileSize(fileName);
+        if (fileSize == size_t(-1))
+            return LOAD_DDS_RESULT::FILE_NOT_FOUND;
 
         // File is too big for 32-bit allocation, so reject read
-        if (fileInfo.EndOfFile.HighPart > 0)
-        {
-            CloseHandle(hFile);
+        if (fileSize > UINT32_MAX)
             return LOAD_DDS_RESULT::FILE_TOO_BIG;
-        }
 
         // Need at least enough data to fill the header and magic number to be a valid DDS
-        if (fileInfo.EndOfFile.LowPart < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
-        {
-            CloseHandle(hFile);
+        if (fileSize < (sizeof(DDS_HEADER) + sizeof(uint32_t)))
             return LOAD_DDS_RESULT::INVALID_DDS;
-        }
 
         // create enough space for the file data
-        //ddsData.reset(new (std::nothrow) uint8_t[fileInfo.EndOfFile.LowPart]);
-        void* ddsData = allocator.AllocateAligned(fileInfo.EndOfFile.LowPart);
+        void* ddsData = allocator.AllocateAligned(fileSize);
         if (!ddsData)
-        {
-            CloseHandle(hFile);
             return LOAD_DDS_RESULT::MEM_ALLOC_FAILED;
-        }
 
-        // read the data in
-        DWORD BytesRead = 0;
-        if (!ReadFile(hFile, ddsData, fileInfo.EndOfFile.LowPart, &BytesRead, nullptr))
-        {
-            CheckWin32(false);
-            CloseHandle(hFile);
+        // Large files are read in multiple chunks that are in flight together
+        if (!Filesystem::ReadFileRange(fileName, ddsData, 0, fileSize))
             return LOAD_DDS_RESULT::UNKNOWN;
-        }
-
-        if (BytesRead < fileInfo.EndOfFile.LowPart)
-        {
-            CloseHandle(hFile);
-            return LOAD_DDS_RESULT::UNKNOWN;
-        }
 
         // DDS files always start with the same magic number ("DDS ")
         uint32_t dwMagicNumber = *reinterpret_cast<const uint32_t*>(ddsData);
         if (dwMagicNumber != DDS_MAGIC)
         {
-            CloseHandle(hFile);
             return LOAD_DDS_RESULT::INVALID_DDS_HEADER;
         }
 
@@ -603,7 +562,6 @@ namespace
         // Verify header to validate DDS file
         if (hdr->size != sizeof(DDS_HEADER) || hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
         {
-            CloseHandle(hFile);
             return LOAD_DDS_RESULT::INVALID_DDS_HEADER;
         }
 
@@ -613,9 +571,8 @@ namespace
             (MAKEFOURCC('D', 'X', '1', '0') == hdr->ddspf.fourCC))
         {
             // Must be long enough for both headers and magic value
-            if (fileInfo.EndOfFile.LowPart < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
+            if (fileSize < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
             {
-                CloseHandle(hFile);
                 return LOAD_DDS_RESULT::INVALID_DDS_HEADER;
             }
 
@@ -626,9 +583,196 @@ namespace
         *header = hdr;
         ptrdiff_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER) + (bDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
         *bitData = reinterpret_cast<uint8_t*>(ddsData) + offset;
-        *bitSize = fileInfo.EndOfFile.LowPart - offset;
+        *bitSize = fileSize - offset;
 
-        CloseHandle(hFile);
+        return LOAD_DDS_RESULT::SUCCESS;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // KTX2
+    //--------------------------------------------------------------------------------------
+
+    struct KTX2_Header
+    {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+
+    struct KTX2_Level
+    {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    static_assert(sizeof(KTX2_Header) == 80, "Invalid KTX2 header size.");
+
+    enum KTX2_SUPERCOMPRESSION : uint32_t
+    {
+        KTX2_SC_NONE = 0,
+        KTX2_SC_BASIS_LZ = 1,
+        KTX2_SC_ZSTD = 2
+    };
+
+    // Block-compressed formats that can be stored in KTX2 as-is, keyed by their Vulkan 
+    // format. VK_FORMAT_UNDEFINED (0) is used for Basis Universal.
+    DXGI_FORMAT KTX2FormatToDXGI(uint32_t vkFormat)
+    {
+        switch (vkFormat)
+        {
+        case 133:
+            return DXGI_FORMAT_BC1_UNORM;
+        case 134:
+            return DXGI_FORMAT_BC1_UNORM_SRGB;
+        case 137:
+            return DXGI_FORMAT_BC3_UNORM;
+        case 138:
+            return DXGI_FORMAT_BC3_UNORM_SRGB;
+        case 139:
+            return DXGI_FORMAT_BC4_UNORM;
+        case 141:
+            return DXGI_FORMAT_BC5_UNORM;
+        case 143:
+            return DXGI_FORMAT_BC6H_UF16;
+        case 145:
+            return DXGI_FORMAT_BC7_UNORM;
+        case 146:
+            return DXGI_FORMAT_BC7_UNORM_SRGB;
+        default:
+            return DXGI_FORMAT_UNKNOWN;
+        }
+    }
+
+    // Raw BCn levels, either stored as-is or Zstd-supercompressed
+    LOAD_DDS_RESULT LoadKTX2BCn(const KTX2_Header& header, const KTX2_Level* levels,
+        Span<uint8_t> file, ArenaAllocator allocator, DXGI_FORMAT format,
+        MutableSpan<D3D12_SUBRESOURCE_DATA> subresources)
+    {
+        if (header.supercompressionScheme != KTX2_SC_NONE && 
+            header.supercompressionScheme != KTX2_SC_ZSTD)
+        {
+            return LOAD_DDS_RESULT::UNSUPPORTED_FORMAT;
+        }
+
+        const size_t blockSize = BitsPerPixel(format) * 16 / 8;
+
+        for (uint32_t i = 0; i < header.levelCount; i++)
+        {
+            const KTX2_Level& level = levels[i];
+            if (level.byteOffset + level.byteLength > file.size())
+                return LOAD_DDS_RESULT::INVALID_KTX2;
+
+            const uint32_t w = Math::Max(header.pixelWidth >> i, 1u);
+            const uint32_t h = Math::Max(header.pixelHeight >> i, 1u);
+            const size_t rowPitch = ((w + 3) / 4) * blockSize;
+            const size_t slicePitch = rowPitch * ((h + 3) / 4);
+
+            if (level.uncompressedByteLength < slicePitch)
+                return LOAD_DDS_RESULT::INVALID_KTX2;
+
+            void* dst = allocator.AllocateAligned(slicePitch, 16);
+            if (!dst)
+                return LOAD_DDS_RESULT::MEM_ALLOC_FAILED;
+
+            const uint8_t* src = file.data() + level.byteOffset;
+
+            if (header.supercompressionScheme == KTX2_SC_ZSTD)
+            {
+                // Level has to be fully decompressed, even though only the first slice 
+                // is used
+                void* decompressed = dst;
+                if (level.uncompressedByteLength > slicePitch)
+                {
+                    decompressed = allocator.AllocateAligned(level.uncompressedByteLength, 16);
+                    if (!decompressed)
+                        return LOAD_DDS_RESULT::MEM_ALLOC_FAILED;
+                }
+
+                const size_t res = ZSTD_decompress(decompressed, level.uncompressedByteLength, 
+                    src, level.byteLength);
+                if (ZSTD_isError(res) || res < slicePitch)
+                    return LOAD_DDS_RESULT::TRANSCODE_FAILED;
+
+                if (decompressed != dst)
+                    memcpy(dst, decompressed, slicePitch);
+            }
+            else
+                memcpy(dst, src, slicePitch);
+
+            subresources[i].pData = dst;
+            subresources[i].RowPitch = rowPitch;
+            subresources[i].SlicePitch = slicePitch;
+        }
+
+        return LOAD_DDS_RESULT::SUCCESS;
+    }
+
+    // Basis Universal (ETC1S or UASTC). Two-channel textures (normal maps) are transcoded 
+    // to BC5, everything else to BC7.
+    LOAD_DDS_RESULT LoadKTX2Basis(const KTX2_Header& header, Span<uint8_t> file, 
+        ArenaAllocator allocator, DXGI_FORMAT& format, 
+        MutableSpan<D3D12_SUBRESOURCE_DATA> subresources)
+    {
+        // Thread-safe one-time initialization of transcoder tables
+        static const bool initialized = []()
+            {
+                basist::basisu_transcoder_init();
+                return true;
+            }();
+        (void)initialized;
+
+        basist::ktx2_transcoder transcoder;
+        if (!transcoder.init(file.data(), (uint32_t)file.size()) || !transcoder.start_transcoding())
+            return LOAD_DDS_RESULT::INVALID_KTX2;
+
+        const uint32_t ch0 = transcoder.get_dfd_channel_id0();
+        const uint32_t ch1 = transcoder.get_dfd_channel_id1();
+        const bool twoChannel = transcoder.is_uastc() ?
+            (ch0 == basist::KTX2_DF_CHANNEL_UASTC_RG || ch0 == basist::KTX2_DF_CHANNEL_UASTC_RRRG) :
+            (ch0 == basist::KTX2_DF_CHANNEL_ETC1S_RRR && ch1 == basist::KTX2_DF_CHANNEL_ETC1S_GGG);
+        const bool srgb = transcoder.get_dfd_transfer_func() == basist::KTX2_KHR_DF_TRANSFER_SRGB;
+
+        const auto targetFmt = twoChannel ? basist::transcoder_texture_format::cTFBC5_RG :
+            basist::transcoder_texture_format::cTFBC7_RGBA;
+        format = twoChannel ? DXGI_FORMAT_BC5_UNORM :
+            (srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM);
+
+        // Both BC5 and BC7 use 16-byte blocks
+        constexpr uint32_t BLOCK_SIZE = 16;
+
+        for (uint32_t i = 0; i < header.levelCount; i++)
+        {
+            basist::ktx2_image_level_info info;
+            if (!transcoder.get_image_level_info(info, i, 0, 0))
+                return LOAD_DDS_RESULT::INVALID_KTX2;
+
+            const size_t rowPitch = info.m_num_blocks_x * BLOCK_SIZE;
+            const size_t slicePitch = rowPitch * info.m_num_blocks_y;
+            void* dst = allocator.AllocateAligned(slicePitch, 16);
+            if (!dst)
+                return LOAD_DDS_RESULT::MEM_ALLOC_FAILED;
+
+            if (!transcoder.transcode_image_level(i, 0, 0, dst, info.m_total_blocks, targetFmt))
+                return LOAD_DDS_RESULT::TRANSCODE_FAILED;
+
+            subresources[i].pData = dst;
+            subresources[i].RowPitch = rowPitch;
+            subresources[i].SlicePitch = slicePitch;
+        }
 
         return LOAD_DDS_RESULT::SUCCESS;
     }
@@ -986,6 +1130,145 @@ LOAD_DDS_RESULT Direct3DUtil::LoadDDSFromFile(const char* path,
     return LOAD_DDS_RESULT::SUCCESS;
 }
 
+LOAD_DDS_RESULT Direct3DUtil::LoadDDSHeaderFromFile(const char* path,
+    MutableSpan<D3D12_SUBRESOURCE_DATA> subresources,
+    DXGI_FORMAT& format,
+    uint32_t& width,
+    uint32_t& height,
+    uint32_t& depth,
+    uint16_t& mipCount,
+    uint32_t& numSubresources)
+{
+    HANDLE hFile = CreateFileA(path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        if (GetLastError() == ERROR_FILE_NOT_FOUND)
+            return LOAD_DDS_RESULT::FILE_NOT_FOUND;
+
+        return LOAD_DDS_RESULT::UNKNOWN;
+    }
+
+    FILE_STANDARD_INFO fileInfo;
+    if (!GetFileInformationByHandleEx(hFile, FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+    {
+        CloseHandle(hFile);
+        CheckWin32(false);
+        return LOAD_DDS_RESULT::UNKNOWN;
+    }
+
+    if (fileInfo.EndOfFile.HighPart > 0)
+    {
+        CloseHandle(hFile);
+        return LOAD_DDS_RESULT::FILE_TOO_BIG;
+    }
+
+    constexpr size_t MIN_SIZE = sizeof(uint32_t) + sizeof(DDS_HEADER);
+    constexpr size_t MAX_HEADER_SIZE = MIN_SIZE + sizeof(DDS_HEADER_DXT10);
+
+    if (fileInfo.EndOfFile.LowPart < MIN_SIZE)
+    {
+        CloseHandle(hFile);
+        return LOAD_DDS_RESULT::INVALID_DDS;
+    }
+
+    // Only the header is read, texel data is left on disk
+    alignas(4) uint8_t headerData[MAX_HEADER_SIZE];
+    const DWORD toRead = (DWORD)Math::Min((size_t)fileInfo.EndOfFile.LowPart, MAX_HEADER_SIZE);
+    DWORD bytesRead = 0;
+    const bool success = ReadFile(hFile, headerData, toRead, &bytesRead, nullptr);
+    CloseHandle(hFile);
+
+    if (!success || bytesRead < toRead)
+        return LOAD_DDS_RESULT::UNKNOWN;
+
+    if (*reinterpret_cast<const uint32_t*>(headerData) != DDS_MAGIC)
+        return LOAD_DDS_RESULT::INVALID_DDS_HEADER;
+
+    auto hdr = reinterpret_cast<const DDS_HEADER*>(headerData + sizeof(uint32_t));
+    if (hdr->size != sizeof(DDS_HEADER) || hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
+        return LOAD_DDS_RESULT::INVALID_DDS_HEADER;
+
+    const bool hasDXT10Header = (hdr->ddspf.flags & DDS_FOURCC) &&
+        (MAKEFOURCC('D', 'X', '1', '0') == hdr->ddspf.fourCC);
+    if (hasDXT10Header && bytesRead < MAX_HEADER_SIZE)
+        return LOAD_DDS_RESULT::INVALID_DDS_HEADER;
+
+    const size_t dataOffset = MIN_SIZE + (hasDXT10Header ? sizeof(DDS_HEADER_DXT10) : 0);
+
+    // Subresource layout is computed as if the file was loaded at address 0, so pData 
+    // ends up being the file offset
+    FillSubresourceData(hdr, subresources, reinterpret_cast<const uint8_t*>(dataOffset),
+        fileInfo.EndOfFile.LowPart - dataOffset, width, height, depth, mipCount,
+        numSubresources, format);
+
+    return LOAD_DDS_RESULT::SUCCESS;
+}
+
+LOAD_DDS_RESULT Direct3DUtil::LoadKTX2FromFile(const char* path,
+    MutableSpan<D3D12_SUBRESOURCE_DATA> subresources,
+    DXGI_FORMAT& format,
+    ArenaAllocator allocator,
+    uint32_t& width,
+    uint32_t& height,
+    uint16_t& mipCount,
+    uint32_t& numSubresources)
+{
+    Filesystem::MappedFile file;
+    if (!Filesystem::MapFile(path, file))
+        return LOAD_DDS_RESULT::FILE_NOT_FOUND;
+
+    auto res = LOAD_DDS_RESULT::INVALID_KTX2;
+    constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    if (file.Size >= sizeof(KTX2_Header) &&
+        memcmp(file.Data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0)
+    {
+        const KTX2_Header& header = *reinterpret_cast<const KTX2_Header*>(file.Data);
+        const size_t levelIndexEnd = sizeof(KTX2_Header) + 
+            Math::Max(header.levelCount, 1u) * sizeof(KTX2_Level);
+
+        // Only single-layer 2D textures are supported
+        if (file.Size < levelIndexEnd || header.pixelHeight == 0 || header.pixelDepth > 1 || 
+            header.layerCount > 1 || header.faceCount != 1)
+        {
+            res = LOAD_DDS_RESULT::UNSUPPORTED_FORMAT;
+        }
+        else if (header.levelCount == 0 || header.levelCount > subresources.size())
+            res = LOAD_DDS_RESULT::UNSUPPORTED_FORMAT;
+        else
+        {
+            const KTX2_Level* levels = reinterpret_cast<const KTX2_Level*>(file.Data + 
+                sizeof(KTX2_Header));
+            Span<uint8_t> data(file.Data, file.Size);
+
+            if (header.vkFormat == 0)
+                res = LoadKTX2Basis(header, data, allocator, format, subresources);
+            else
+            {
+                format = KTX2FormatToDXGI(header.vkFormat);
+                res = format == DXGI_FORMAT_UNKNOWN ? LOAD_DDS_RESULT::UNSUPPORTED_FORMAT :
+                    LoadKTX2BCn(header, levels, data, allocator, format, subresources);
+            }
+
+            width = header.pixelWidth;
+            height = header.pixelHeight;
+            mipCount = (uint16_t)header.levelCount;
+            numSubresources = header.levelCount;
+        }
+    }
+
+    Filesystem::UnmapFile(file);
+
+    return res;
+}
+
 D3D12_GRAPHICS_PIPELINE_STATE_DESC Direct3DUtil::GetPSODesc(const D3D12_INPUT_LAYOUT_DESC* inputLayout,
     int numRenderTargets, 
     DXGI_FORMAT* rtvFormats, 
@@ -1180,6 +1463,23 @@ void Direct3DUtil::CreateRTV(const Texture& t, D3D12_CPU_DESCRIPTOR_HANDLE cpuHa
     device->CreateRenderTargetView(res, &rtvDesc, cpuHandle);
 }
 
+void Direct3DUtil::CreateDSV(const Texture& t, D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle, DXGI_FORMAT f, 
+    UINT mipSlice)
+{
+    Assert(cpuHandle.ptr != 0, "Uninitialized D3D12_CPU_DESCRIPTOR_HANDLE.");
+    auto* device = App::GetRenderer().GetDevice();
+    auto* res = const_cast<Texture&>(t).Resource();
+    auto desc = res->GetDesc();
+
+    D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc{};
+    dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+    dsvDesc.Texture2D.MipSlice = mipSlice;
+    dsvDesc.Format = f == DXGI_FORMAT_UNKNOWN ? desc.Format : f;
+    dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
+
+    device->CreateDepthStencilView(res, &dsvDesc, cpuHandle);
+}
+
 void Direct3DUtil::CreateTexture2DUAV(const Texture& t, D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle, 
     DXGI_FORMAT f, UINT mipSlice, UINT planeSlice)
 {
@@ -38,6 +38,9 @@ namespace ZetaRay::Core::Direct3DUtil
         INVALID_DDS_HEADER,
         MEM_ALLOC_FAILED,
         FILE_TOO_BIG,
+        INVALID_KTX2,
+        UNSUPPORTED_FORMAT,
+        TRANSCODE_FAILED,
         UNKNOWN,
         COUNT
     };
@@ -56,6 +59,19 @@ namespace ZetaRay::Core::Direct3DUtil
         return uploadHeap;
     }
 
+    // Video memory that CPU can write to directly. Requires GPU upload heap support.
+    inline D3D12_HEAP_PROPERTIES GpuUploadHeapProp()
+    {
+        D3D12_HEAP_PROPERTIES gpuUploadHeap{
+            .Type = D3D12_HEAP_TYPE_GPU_UPLOAD,
+            .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
+            .CreationNodeMask = 1,
+            .VisibleNodeMask = 1 };
+
+        return gpuUploadHeap;
+    }
+
     inline D3D12_HEAP_PROPERTIES DefaultHeapProp()
     {
         D3D12_HEAP_PROPERTIES defaultHeap{
@@ -578,6 +594,29 @@ namespace ZetaRay::Core::Direct3DUtil
         uint16_t& mipCount,
         uint32_t& numSubresources);
 
+    // Same as above, except that texel data isn't read. pData of each subresource is 
+    // set to its offset from the start of the file.
+    LOAD_DDS_RESULT LoadDDSHeaderFromFile(const char* path,
+        Util::MutableSpan<D3D12_SUBRESOURCE_DATA> subresources,
+        DXGI_FORMAT& format,
+        uint32_t& width,
+        uint32_t& height,
+        uint32_t& depth,
+        uint16_t& mipCount,
+        uint32_t& numSubresources);
+
+    // Loads a 2D KTX2 texture. Block-compressed formats are used as-is (optionally 
+    // Zstd-supercompressed), while Basis Universal textures are transcoded to BC7, or 
+    // BC5 for two-channel textures. All the mip levels end up in memory from allocator.
+    LOAD_DDS_RESULT LoadKTX2FromFile(const char* path,
+        Util::MutableSpan<D3D12_SUBRESOURCE_DATA> subresources,
+        DXGI_FORMAT& format,
+        Support::ArenaAllocator allocator,
+        uint32_t& width,
+        uint32_t& height,
+        uint16_t& mipCount,
+        uint32_t& numSubresources);
+
     D3D12_GRAPHICS_PIPELINE_STATE_DESC GetPSODesc(const D3D12_INPUT_LAYOUT_DESC* inputLayout,
         int numRenderTargets,
         DXGI_FORMAT* rtvFormats,
@@ -619,4 +658,6 @@ namespace ZetaRay::Core::Direct3DUtil
         UINT firstSliceIdx = 0);
     void CreateRTV(const GpuMemory::Texture& t, D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle, 
         DXGI_FORMAT f = DXGI_FORMAT_UNKNOWN, UINT mipSlice = 0, UINT planeSlice = 0);
+    void CreateDSV(const GpuMemory::Texture& t, D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle, 
+        DXGI_FORMAT f = DXGI_FORMAT_UNKNOWN, UINT mipSlice = 0);
 }
\ No newline at end of file
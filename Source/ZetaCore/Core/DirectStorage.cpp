@@ -0,0 +1,259 @@
+#include "DirectStorage.h"
+#include "RendererCore.h"
+#include "../App/Common.h"
+#include "../App/Log.h"
+#include "../Utility/SmallVector.h"
+
+#ifdef ZETA_DIRECT_STORAGE
+#include <DirectStorage/dstorage.h>
+#endif
+
+using namespace ZetaRay;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Support;
+
+#ifdef ZETA_DIRECT_STORAGE
+
+namespace
+{
+    struct DirectStorageData
+    {
+        // Maximum size of a single (uncompressed) request
+        static constexpr uint32_t STAGING_BUFFER_SIZE = DSTORAGE_STAGING_BUFFER_SIZE_32MB * 2;
+
+        struct OpenFile
+        {
+            ComPtr<IDStorageFile> File;
+            // Batch that the last request for this file belongs to
+            uint64_t Fence;
+        };
+
+        ComPtr<IDStorageFactory> m_factory;
+        ComPtr<IDStorageQueue> m_queue;
+        ComPtr<ID3D12Fence> m_fence;
+        uint64_t m_nextFenceVal = 1;
+        // Files can only be closed once the requests that read from them are done
+        SmallVector<OpenFile> m_openFiles;
+        SRWLOCK m_lock = SRWLOCK_INIT;
+    };
+
+    DirectStorageData* g_data = nullptr;
+
+    // Requires the lock to be held
+    void ReleaseCompletedFiles()
+    {
+        const uint64_t completed = g_data->m_fence->GetCompletedValue();
+        size_t i = 0;
+
+        while (i < g_data->m_openFiles.size())
+        {
+            if (g_data->m_openFiles[i].Fence <= completed)
+            {
+                g_data->m_openFiles[i].File->Close();
+                g_data->m_openFiles.erase_at_index(i);
+            }
+            else
+                i++;
+        }
+    }
+}
+
+void DirectStorage::Init()
+{
+    Assert(!g_data, "DirectStorage has already been initialized.");
+
+    ComPtr<IDStorageFactory> factory;
+    if (FAILED(DStorageGetFactory(IID_PPV_ARGS(factory.GetAddressOf()))))
+    {
+        LOG_UI_WARNING("Initializing DirectStorage failed, falling back to regular file I/O.\n");
+        return;
+    }
+
+    g_data = new DirectStorageData;
+    g_data->m_factory = ZetaMove(factory);
+    CheckHR(g_data->m_factory->SetStagingBufferSize(DirectStorageData::STAGING_BUFFER_SIZE));
+
+    auto* device = App::GetRenderer().GetDevice();
+
+    DSTORAGE_QUEUE_DESC desc{};
+    desc.Capacity = DSTORAGE_MAX_QUEUE_CAPACITY;
+    desc.Priority = DSTORAGE_PRIORITY_NORMAL;
+    desc.SourceType = DSTORAGE_REQUEST_SOURCE_FILE;
+    desc.Device = device;
+    desc.Name = "TextureStreamingQueue";
+    CheckHR(g_data->m_factory->CreateQueue(&desc, IID_PPV_ARGS(g_data->m_queue.GetAddressOf())));
+
+    CheckHR(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, 
+        IID_PPV_ARGS(g_data->m_fence.GetAddressOf())));
+}
+
+void DirectStorage::Shutdown()
+{
+    if (!g_data)
+        return;
+
+    WaitForBatch(Submit());
+
+    AcquireSRWLockExclusive(&g_data->m_lock);
+    ReleaseCompletedFiles();
+    ReleaseSRWLockExclusive(&g_data->m_lock);
+
+    delete g_data;
+    g_data = nullptr;
+}
+
+bool DirectStorage::IsAvailable()
+{
+    return g_data != nullptr;
+}
+
+uint32_t DirectStorage::EnqueueDDS(const char* path, ID3D12Resource* texture, 
+    MutableSpan<D3D12_SUBRESOURCE_DATA> subresources, ArenaAllocator allocator)
+{
+    Assert(g_data, "DirectStorage is not available.");
+
+    wchar_t widePath[MAX_PATH];
+    App::Common::CharToWideStr(path, widePath);
+
+    ComPtr<IDStorageFile> file;
+    CheckHR(g_data->m_factory->OpenFile(widePath, IID_PPV_ARGS(file.GetAddressOf())));
+
+    const auto desc = texture->GetDesc();
+    uint32_t numStreamed = 0;
+
+    for (; numStreamed < (uint32_t)subresources.size(); numStreamed++)
+    {
+        const auto& subres = subresources[numStreamed];
+        if ((subres.RowPitch & (D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1)) != 0 ||
+            subres.SlicePitch > DirectStorageData::STAGING_BUFFER_SIZE)
+        {
+            break;
+        }
+
+        const uint32_t w = Math::Max(1u, (uint32_t)(desc.Width >> numStreamed));
+        const uint32_t h = Math::Max(1u, desc.Height >> numStreamed);
+
+        DSTORAGE_REQUEST request{};
+        request.Options.SourceType = DSTORAGE_REQUEST_SOURCE_FILE;
+        request.Options.DestinationType = DSTORAGE_REQUEST_DESTINATION_TEXTURE_REGION;
+        request.Source.File.Source = file.Get();
+        request.Source.File.Offset = reinterpret_cast<uintptr_t>(subres.pData);
+        request.Source.File.Size = (uint32_t)subres.SlicePitch;
+        request.UncompressedSize = (uint32_t)subres.SlicePitch;
+        request.Destination.Texture.Resource = texture;
+        request.Destination.Texture.SubresourceIndex = numStreamed;
+        request.Destination.Texture.Region = D3D12_BOX{ 0, 0, 0, w, h, 1 };
+
+        g_data->m_queue->EnqueueRequest(&request);
+    }
+
+    // Remaining subresources are contiguous in the file
+    if (numStreamed < (uint32_t)subresources.size())
+    {
+        const uintptr_t tailOffset = reinterpret_cast<uintptr_t>(subresources[numStreamed].pData);
+        const auto& last = subresources[subresources.size() - 1];
+        const size_t tailSize = reinterpret_cast<uintptr_t>(last.pData) + last.SlicePitch - tailOffset;
+        uint8_t* tail = reinterpret_cast<uint8_t*>(allocator.AllocateAligned(tailSize));
+
+        for (size_t curr = 0; curr < tailSize; curr += DirectStorageData::STAGING_BUFFER_SIZE)
+        {
+            const uint32_t size = (uint32_t)Math::Min(tailSize - curr, 
+                (size_t)DirectStorageData::STAGING_BUFFER_SIZE);
+
+            DSTORAGE_REQUEST request{};
+            request.Options.SourceType = DSTORAGE_REQUEST_SOURCE_FILE;
+            request.Options.DestinationType = DSTORAGE_REQUEST_DESTINATION_MEMORY;
+            request.Source.File.Source = file.Get();
+            request.Source.File.Offset = tailOffset + curr;
+            request.Source.File.Size = size;
+            request.UncompressedSize = size;
+            request.Destination.Memory.Buffer = tail + curr;
+            request.Destination.Memory.Size = size;
+
+            g_data->m_queue->EnqueueRequest(&request);
+        }
+
+        for (size_t i = numStreamed; i < subresources.size(); i++)
+        {
+            subresources[i].pData = tail + (reinterpret_cast<uintptr_t>(subresources[i].pData) -
+                tailOffset);
+        }
+    }
+
+    AcquireSRWLockExclusive(&g_data->m_lock);
+    // Requests above are part of the next batch
+    g_data->m_openFiles.push_back({ .File = ZetaMove(file), .Fence = g_data->m_nextFenceVal });
+    ReleaseSRWLockExclusive(&g_data->m_lock);
+
+    return numStreamed;
+}
+
+uint64_t DirectStorage::Submit()
+{
+    Assert(g_data, "DirectStorage is not available.");
+
+    AcquireSRWLockExclusive(&g_data->m_lock);
+
+    const uint64_t fenceVal = g_data->m_nextFenceVal++;
+    g_data->m_queue->EnqueueSignal(g_data->m_fence.Get(), fenceVal);
+    g_data->m_queue->Submit();
+
+    ReleaseSRWLockExclusive(&g_data->m_lock);
+
+    return fenceVal;
+}
+
+void DirectStorage::WaitForBatch(uint64_t fenceVal)
+{
+    Assert(g_data, "DirectStorage is not available.");
+
+    if (g_data->m_fence->GetCompletedValue() < fenceVal)
+    {
+        // Null event blocks until the fence has reached the value -- multiple threads 
+        // may be waiting at the same time
+        CheckHR(g_data->m_fence->SetEventOnCompletion(fenceVal, nullptr));
+    }
+
+    DSTORAGE_ERROR_RECORD errorRecord{};
+    g_data->m_queue->RetrieveErrorRecord(&errorRecord);
+    Check(errorRecord.FailureCount == 0, "DirectStorage request failed with HRESULT 0x%x.",
+        errorRecord.FirstFailure.HResult);
+
+    AcquireSRWLockExclusive(&g_data->m_lock);
+    ReleaseCompletedFiles();
+    ReleaseSRWLockExclusive(&g_data->m_lock);
+}
+
+#else
+
+void DirectStorage::Init()
+{}
+
+void DirectStorage::Shutdown()
+{}
+
+bool DirectStorage::IsAvailable()
+{
+    return false;
+}
+
+uint32_t DirectStorage::EnqueueDDS(const char* path, ID3D12Resource* texture, 
+    MutableSpan<D3D12_SUBRESOURCE_DATA> subresources, ArenaAllocator allocator)
+{
+    Assert(false, "ZetaCore was built without DirectStorage.");
+    return 0;
+}
+
+uint64_t DirectStorage::Submit()
+{
+    Assert(false, "ZetaCore was built without DirectStorage.");
+    return 0;
+}
+
+void DirectStorage::WaitForBatch(uint64_t fenceVal)
+{
+    Assert(false, "ZetaCore was built without DirectStorage.");
+}
+
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Direct3DUtil.h"
+#include "../Support/MemoryArena.h"
+
+namespace ZetaRay::Core::DirectStorage
+{
+    // DirectStorage is only used when ZetaCore is built with ZETA_DIRECT_STORAGE 
+    // and the runtime could be initialized, callers are expected to fall back to 
+    // regular file I/O otherwise.
+    void Init();
+    void Shutdown();
+    bool IsAvailable();
+
+    // Streams the subresources of given DDS file straight into texture, which must be 
+    // in the COMMON state. subresources is expected to be filled by LoadDDSHeaderFromFile().
+    // 
+    // Only subresources whose rows are already laid out as the copyable footprint can 
+    // be written directly. Starting from the first one that isn't (usually the mip tail),
+    // the rest are read into memory that's allocated from the given allocator and their 
+    // pData is updated to point to it -- those have to be uploaded by the caller after 
+    // the batch has completed. Returns the index of the first such subresource.
+    uint32_t EnqueueDDS(const char* path, ID3D12Resource* texture, 
+        Util::MutableSpan<D3D12_SUBRESOURCE_DATA> subresources, 
+        Support::ArenaAllocator allocator);
+
+    // Submits every request that has been enqueued so far (from any thread) as one batch. 
+    // Returns the fence value that is signalled once the batch has completed.
+    uint64_t Submit();
+    void WaitForBatch(uint64_t fenceVal);
+}
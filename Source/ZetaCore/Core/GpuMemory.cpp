@@ -2,8 +2,12 @@
 #include "RendererCore.h"
 #include "CommandList.h"
 #include "../Support/Task.h"
+#include "../Support/CpuEvent.h"
+#include "../Support/ShardedOffsetAllocator.h"
 #include "../App/Filesystem.h"
 #include "../Utility/Utility.h"
+#include "../Utility/HashTable.h"
+#include "../Utility/StringUtil.h"
 #include <thread>
 #include <algorithm>
 #include <bit>
@@ -19,10 +23,123 @@ using namespace ZetaRay::Core::GpuMemory;
 
 namespace
 {
+    // Per-frame upload ring is split into one segment per frame that can be in flight.
+    // Threads claim chunks of the current frame's segment and suballocate from them.
+    constexpr uint32_t FRAME_UPLOAD_SEGMENT_SIZE = 2 * 1024 * 1024;
+    constexpr int NUM_FRAME_UPLOAD_SEGMENTS = Constants::MAX_FRAMES_IN_FLIGHT + 1;
+    constexpr uint32_t FRAME_UPLOAD_CHUNK_SIZE = 64 * 1024;
+    // Chunks are aligned to this, which is also the largest supported alignment
+    constexpr uint32_t FRAME_UPLOAD_MAX_ALIGNMENT = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+
+    // Readback buffers are rounded up to this size so that they can be reused for 
+    // requests of similar sizes
+    constexpr uint32_t READBACK_BUFFER_GRANULARITY = 64 * 1024;
+    constexpr uint32_t MAX_NUM_POOLED_READBACK_BUFFERS = 8;
+
+    // As ratio of current usage to budget
+    constexpr float HIGH_MEMORY_PRESSURE_THRESHOLD = 0.85f;
+    constexpr float CRITICAL_MEMORY_PRESSURE_THRESHOLD = 0.95f;
+    // Pressure level is lowered only after usage falls this much below the threshold 
+    // that raised it, so that usage hovering around a threshold doesn't flip it every frame
+    constexpr float MEMORY_PRESSURE_HYSTERESIS = 0.05f;
+
+    // Written when memory pressure becomes critical
+    constexpr const char* MEMORY_REPORT_PATH = "GpuMemory.txt";
+
+    constexpr const char* CATEGORY_NAMES[] = { "Textures", "Acceleration structures", 
+        "Render targets", "Buffers", "Upload", "Readback" };
+    static_assert(ZetaArrayLen(CATEGORY_NAMES) == (int)MEMORY_CATEGORY::COUNT);
+
+    // Per-frame upload budget (see ReserveUploadBytes()) stays in this range, starting 
+    // from the initial value. It grows by the step size every frame that it's used up.
+    constexpr uint64_t MIN_FRAME_UPLOAD_BUDGET = 4 * 1024 * 1024;
+    constexpr uint64_t MAX_FRAME_UPLOAD_BUDGET = 256 * 1024 * 1024;
+    constexpr uint64_t INITIAL_FRAME_UPLOAD_BUDGET = 32 * 1024 * 1024;
+    constexpr uint64_t FRAME_UPLOAD_BUDGET_STEP = 4 * 1024 * 1024;
+    // Copy queue is considered to be falling behind when a frame's copies take longer 
+    // than this many frames to finish
+    constexpr float MAX_COPY_LATENCY_FRAMES = 2.0f;
+    constexpr int MAX_NUM_PENDING_COPY_FRAMES = 8;
+    // Peak upload heap usage is reset after this many frames
+    constexpr uint32_t STAGING_PEAK_WINDOW_FRAMES = 256;
+    // Arena block scale (in 1/256ths) is clamped to [1, 4]
+    constexpr uint32_t ARENA_BLOCK_SCALE_ONE = 256;
+    constexpr uint32_t MAX_ARENA_BLOCK_SCALE = 4 * ARENA_BLOCK_SCALE_ONE;
+
+    // Reserved textures are backed by tiles from a shared pool of this size
+    constexpr uint32_t TILE_POOL_NUM_TILES = 4096;
+    constexpr uint32_t TILE_SIZE_IN_BYTES = D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+
     //--------------------------------------------------------------------------------------
     // ResourceUploadBatch
     //--------------------------------------------------------------------------------------
 
+    // Copies subresources to (mapped) upload buffer and records a CopyTextureRegion for 
+    // each one
+    void StageAndCopyTexture(CopyCmdList* copyCmdList, ID3D12Resource* uploadBuffer, 
+        void* mapped, uint32_t uploadBuffOffsetInBytes, ID3D12Resource* texture, int numSubresources, 
+        int firstSubresourceIndex, Span<D3D12_SUBRESOURCE_DATA> subResData, 
+        Span<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> subresLayout, Span<UINT> subresNumRows, 
+        Span<UINT64> subresRowSize)
+    {
+        // Notes:
+        // 
+        // 1.
+        //   subresRowSize[i]: #bytes to copy for each row (unpadded)
+        //   subresLayout[i].Footprint.RowPitch: padded size in bytes of each row
+        //
+        // 2. As buffers have a 64 KB alignment, GetCopyableFootprints() returns the padded 
+        //    size. Using subresRowSize[0] as the copy size could lead to access violations 
+        //    since size of the data pointed to by subresData is probably smaller.
+
+        // For each subresource in destination
+        for (int i = 0; i < numSubresources; i++)
+        {
+            size_t destOffset = subresLayout[i].Offset;
+            const size_t destSubresSlicePitch = subresLayout[i].Footprint.RowPitch * subresNumRows[i];
+
+            // For each slice of that subresource
+            for (int slice = 0; slice < (int)subresLayout[i].Footprint.Depth; slice++)
+            {
+                const uintptr_t sourceSubres = reinterpret_cast<uintptr_t>(
+                    subResData[i].pData) + subResData[i].SlicePitch * slice;
+
+                // For each row of that subresource slice
+                for (int row = 0; row < (int)subresNumRows[i]; row++)
+                {
+                    const uintptr_t dest = reinterpret_cast<uintptr_t>(mapped) +
+                        uploadBuffOffsetInBytes +
+                        destOffset +
+                        row * subresLayout[i].Footprint.RowPitch;
+
+                    const uintptr_t src = sourceSubres + subResData[i].RowPitch * row;
+
+                    memcpy(reinterpret_cast<void*>(dest),
+                        reinterpret_cast<void*>(src),
+                        subresRowSize[i]);
+                }
+
+                destOffset += destSubresSlicePitch;
+            }
+        }
+
+        for (int i = 0; i < numSubresources; i++)
+        {
+            D3D12_TEXTURE_COPY_LOCATION dst{};
+            dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+            dst.pResource = texture;
+            dst.SubresourceIndex = firstSubresourceIndex + i;
+
+            D3D12_TEXTURE_COPY_LOCATION src{};
+            src.pResource = uploadBuffer;
+            src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+            src.PlacedFootprint = subresLayout[i];
+            src.PlacedFootprint.Offset += uploadBuffOffsetInBytes;
+
+            copyCmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+        }
+    }
+
     struct ResourceUploadBatch
     {
         ResourceUploadBatch()
@@ -38,7 +155,6 @@ namespace
         {
             Assert(!m_inBeginEndBlock, "Can't Begin: already in a Begin-End block.");
             m_inBeginEndBlock = true;
-            m_hasWorkThisFrame = false;
         }
 
         // Works by:
@@ -56,14 +172,6 @@ namespace
             Assert(m_inBeginEndBlock, "Not in begin-end block.");
             Assert(texture, "Texture was NULL.");
 
-            if (!m_directCmdList)
-            {
-                m_directCmdList = App::GetRenderer().GetGraphicsCmdList();
-#ifndef NDEBUG
-                m_directCmdList->SetName("ResourceUploadBatch");
-#endif
-            }
-
             constexpr int MAX_NUM_SUBRESOURCES = 13;
             Assert(MAX_NUM_SUBRESOURCES >= subResData.size(), 
                 "MAX_NUM_SUBRESOURCES is too small.");
@@ -90,13 +198,12 @@ namespace
                 &totalSize);
 
             const auto uploadBuffer = arena.SubAllocate((uint32_t)totalSize);
+            m_uploadedBytes += totalSize;
 
             CopyTextureFromUploadBuffer(uploadBuffer.Res, uploadBuffer.Mapped, 
                 uploadBuffer.Offset, texture, (uint32_t)subResData.size(), 
                 firstSubresourceIndex, subResData, subresLayout, subresNumRows, 
                 subresRowSize, postCopyState);
-
-            m_hasWorkThisFrame = true;
         }
 
         void UploadTexture(ID3D12Resource* texture, Span<D3D12_SUBRESOURCE_DATA> subResData, 
@@ -106,14 +213,6 @@ namespace
             Assert(m_inBeginEndBlock, "Not in begin-end block.");
             Assert(texture, "Texture was NULL.");
 
-            if (!m_directCmdList)
-            {
-                m_directCmdList = App::GetRenderer().GetGraphicsCmdList();
-#ifndef NDEBUG
-                m_directCmdList->SetName("ResourceUploadBatch");
-#endif
-            }
-
             constexpr int MAX_NUM_SUBRESOURCES = 12;
             Assert(MAX_NUM_SUBRESOURCES >= subResData.size(), 
                 "MAX_NUM_SUBRESOURCES is too small.");
@@ -138,6 +237,7 @@ namespace
                 &totalSize);
 
             UploadHeapBuffer uploadBuffer = GpuMemory::GetUploadHeapBuffer((uint32_t)totalSize);
+            m_uploadedBytes += totalSize;
 
             CopyTextureFromUploadBuffer(uploadBuffer.Resource(), 
                 uploadBuffer.MappedMemory(), uploadBuffer.Offset(), texture, 
@@ -146,22 +246,34 @@ namespace
 
             // Preserve the upload buffer for as long as GPU is using it 
             m_scratchResources.push_back(ZetaMove(uploadBuffer));
-
-            m_hasWorkThisFrame = true;
         }
 
+        // Buffers that GPU might still be reading from (e.g. updates from prior frames) 
+        // are copied on the direct queue so that the copy is ordered after them. Newly 
+        // created buffers are copied on the copy queue.
         void UploadBuffer(ID3D12Resource* buffer, void* data, uint32_t sizeInBytes, 
-            uint32_t destOffset = 0, bool forceSeparate = false)
+            uint32_t destOffset = 0, bool forceSeparate = false, bool isInitialUpload = false)
         {
             Assert(m_inBeginEndBlock, "Not in begin-end block.");
             Assert(buffer, "Buffer was NULL.");
 
-            if (!m_directCmdList)
+            CopyCmdList* cmdList = isInitialUpload ? GetCopyCmdList() : GetDirectCmdList();
+            m_uploadedBytes += sizeInBytes;
+
+            // Small uploads (e.g. per-frame constants) go through the frame upload ring, which
+            // doesn't need to be kept alive or released
+            if (!forceSeparate && sizeInBytes <= FRAME_UPLOAD_CHUNK_SIZE)
             {
-                m_directCmdList = App::GetRenderer().GetGraphicsCmdList();
-#ifndef NDEBUG
-                m_directCmdList->SetName("ResourceUploadBatch");
-#endif
+                FrameUploadAllocation alloc = GpuMemory::AllocateFrameUpload(sizeInBytes, 4);
+                memcpy(alloc.MappedMemory, data, sizeInBytes);
+
+                cmdList->CopyBufferRegion(buffer,
+                    destOffset,
+                    alloc.Res,
+                    alloc.Offset,
+                    sizeInBytes);
+
+                return;
             }
 
             // Note: GetCopyableFootprints() returns the padded size for a standalone 
@@ -172,7 +284,7 @@ namespace
             // Note: can't use CopyResource() since the UploadHeap might not have the 
             // exact same size as the destination resource due to subresource allocations.
 
-            m_directCmdList->CopyBufferRegion(buffer,
+            cmdList->CopyBufferRegion(buffer,
                 destOffset,
                 uploadBuffer.Resource(),
                 uploadBuffer.Offset(),
@@ -180,8 +292,6 @@ namespace
 
             // Preserve the upload buffer for as long as GPU is using it 
             m_scratchResources.push_back(ZetaMove(uploadBuffer));
-
-            m_hasWorkThisFrame = true;
         }
 
         void UploadTexture(ID3D12Resource* dstResource, uint8_t* pixels, 
@@ -189,14 +299,6 @@ namespace
         {
             Assert(m_inBeginEndBlock, "Not in begin-end block.");
 
-            if (!m_directCmdList)
-            {
-                m_directCmdList = App::GetRenderer().GetGraphicsCmdList();
-#ifndef NDEBUG
-                m_directCmdList->SetName("ResourceUploadBatch");
-#endif
-            }
-
             const auto desc = dstResource->GetDesc();
             Assert(desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D, 
                 "This function is for uploading 2D textures.");
@@ -208,6 +310,7 @@ namespace
             const UINT uploadSize = desc.Height * rowPitch;
 
             UploadHeapBuffer uploadBuffer = GpuMemory::GetUploadHeapBuffer(uploadSize);
+            m_uploadedBytes += uploadSize;
 
             for (int y = 0; y < (int)desc.Height; y++)
                 uploadBuffer.Copy(y * rowPitch, rowSizeInBytes, pixels + y * rowSizeInBytes);
@@ -227,29 +330,53 @@ namespace
             dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
             dstLocation.SubresourceIndex = 0;
 
-            m_directCmdList->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, 
+            GetCopyCmdList()->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, 
                 nullptr);
 
-            if (postCopyState != D3D12_RESOURCE_STATE_COPY_DEST)
-            {
-                m_directCmdList->ResourceBarrier(dstResource, D3D12_RESOURCE_STATE_COPY_DEST, 
-                    postCopyState);
-            }
+            TransitionAfterCopy(dstResource, postCopyState);
 
             // Preserve the upload buffer for as long as GPU is using it 
             m_scratchResources.push_back(ZetaMove(uploadBuffer));
+        }
+
+        // Copies that were submitted to the copy queue elsewhere (see TextureUploadRing). 
+        // Direct queue waits for them, followed by the post-copy transitions.
+        void AddCopyDependency(uint64_t copyFenceVal, Span<ID3D12Resource*> textures,
+            D3D12_RESOURCE_STATES postCopyState)
+        {
+            Assert(m_inBeginEndBlock, "Not in begin-end block.");
+            m_copyDependency = Math::Max(m_copyDependency, copyFenceVal);
 
-            m_hasWorkThisFrame = true;
+            for (auto* tex : textures)
+                TransitionAfterCopy(tex, postCopyState);
         }
 
-        // Submits all the uploads
+        // Submits the copy queue uploads. Must be called before End().
+        uint64_t SubmitCopies()
+        {
+            Assert(m_inBeginEndBlock, "Not in begin-end block.");
+            uint64_t ret = m_copyDependency;
+            m_copyDependency = 0;
+
+            if (m_copyCmdList)
+            {
+                ret = App::GetRenderer().ExecuteCmdList(m_copyCmdList);
+                m_copyCmdList = nullptr;
+            }
+
+            return ret;
+        }
+
+        // Submits the direct queue uploads and post-copy transitions. Caller is responsible 
+        // for making the direct queue wait for the copy queue beforehand.
         // No more uploads can happen after this call until Begin is called again.
         uint64_t End()
         {
             Assert(m_inBeginEndBlock, "Not in begin-end block.");
+            Assert(!m_copyCmdList, "Copy queue uploads haven't been submitted.");
             uint64_t ret = 0;
 
-            if (m_hasWorkThisFrame)
+            if (m_directCmdList)
             {
                 ret = App::GetRenderer().ExecuteCmdList(m_directCmdList);
                 m_directCmdList = nullptr;
@@ -260,6 +387,15 @@ namespace
             return ret;
         }
 
+        // Bytes staged since the last call
+        uint64_t TakeUploadedBytes()
+        {
+            const uint64_t ret = m_uploadedBytes;
+            m_uploadedBytes = 0;
+
+            return ret;
+        }
+
         void Recycle()
         {
             //m_scratchResources.free_memory();
@@ -274,66 +410,47 @@ namespace
             Span<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> subresLayout, Span<UINT> subresNumRows, 
             Span<UINT64> subresRowSize, D3D12_RESOURCE_STATES postCopyState)
         {
-            // Notes:
-            // 
-            // 1.
-            //   subresRowSize[i]: #bytes to copy for each row (unpadded)
-            //   subresLayout[i].Footprint.RowPitch: padded size in bytes of each row
-            //
-            // 2. As buffers have a 64 KB alignment, GetCopyableFootprints() returns the padded 
-            //    size. Using subresRowSize[0] as the copy size could lead to access violations 
-            //    since size of the data pointed to by subresData is probably smaller.
-
-            // For each subresource in destination
-            for (int i = 0; i < numSubresources; i++)
-            {
-                size_t destOffset = subresLayout[i].Offset;
-                const size_t destSubresSlicePitch = subresLayout[i].Footprint.RowPitch * subresNumRows[i];
-
-                // For each slice of that subresource
-                for (int slice = 0; slice < (int)subresLayout[i].Footprint.Depth; slice++)
-                {
-                    const uintptr_t sourceSubres = reinterpret_cast<uintptr_t>(
-                        subResData[i].pData) + subResData[i].SlicePitch * slice;
+            StageAndCopyTexture(GetCopyCmdList(), uploadBuffer, mapped, 
+                uploadBuffOffsetInBytes, texture, numSubresources, firstSubresourceIndex, 
+                subResData, subresLayout, subresNumRows, subresRowSize);
 
-                    // For each row of that subresource slice
-                    for (int row = 0; row < (int)subresNumRows[i]; row++)
-                    {
-                        const uintptr_t dest = reinterpret_cast<uintptr_t>(mapped) +
-                            uploadBuffOffsetInBytes +
-                            destOffset +
-                            row * subresLayout[i].Footprint.RowPitch;
-
-                        const uintptr_t src = sourceSubres + subResData[i].RowPitch * row;
-
-                        memcpy(reinterpret_cast<void*>(dest),
-                            reinterpret_cast<void*>(src),
-                            subresRowSize[i]);
-                    }
+            TransitionAfterCopy(texture, postCopyState);
+        }
 
-                    destOffset += destSubresSlicePitch;
-                }
+        CopyCmdList* GetCopyCmdList()
+        {
+            if (!m_copyCmdList)
+            {
+                m_copyCmdList = App::GetRenderer().GetCopyCmdList();
+#ifndef NDEBUG
+                m_copyCmdList->SetName("ResourceUploadBatch_Copy");
+#endif
             }
 
-            for (int i = 0; i < numSubresources; i++)
+            return m_copyCmdList;
+        }
+
+        GraphicsCmdList* GetDirectCmdList()
+        {
+            if (!m_directCmdList)
             {
-                D3D12_TEXTURE_COPY_LOCATION dst{};
-                dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-                dst.pResource = texture;
-                dst.SubresourceIndex = firstSubresourceIndex + i;
-
-                D3D12_TEXTURE_COPY_LOCATION src{};
-                src.pResource = uploadBuffer;
-                src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-                src.PlacedFootprint = subresLayout[i];
-                src.PlacedFootprint.Offset += uploadBuffOffsetInBytes;
-
-                m_directCmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+                m_directCmdList = App::GetRenderer().GetGraphicsCmdList();
+#ifndef NDEBUG
+                m_directCmdList->SetName("ResourceUploadBatch");
+#endif
             }
 
-            if (postCopyState != D3D12_RESOURCE_STATE_COPY_DEST)
+            return m_directCmdList;
+        }
+
+        // Copy queue can't transition to non-copy states and resources that were accessed 
+        // on it decay to COMMON afterwards. Transition is recorded on the direct command list,
+        // which only executes after the direct queue has waited for the copy queue.
+        void TransitionAfterCopy(ID3D12Resource* texture, D3D12_RESOURCE_STATES postCopyState)
+        {
+            if (postCopyState != D3D12_RESOURCE_STATE_COMMON)
             {
-                m_directCmdList->ResourceBarrier(texture, D3D12_RESOURCE_STATE_COPY_DEST, 
+                GetDirectCmdList()->ResourceBarrier(texture, D3D12_RESOURCE_STATE_COMMON, 
                     postCopyState);
             }
         }
@@ -342,9 +459,11 @@ namespace
         MemoryArena m_arena;
         SmallVector<UploadHeapBuffer, Support::ArenaAllocator> m_scratchResources;
 
+        CopyCmdList* m_copyCmdList = nullptr;
         GraphicsCmdList* m_directCmdList = nullptr;
+        uint64_t m_copyDependency = 0;
+        uint64_t m_uploadedBytes = 0;
         bool m_inBeginEndBlock = false;
-        bool m_hasWorkThisFrame = false;
     };
 
     //--------------------------------------------------------------------------------------
@@ -357,6 +476,11 @@ namespace
         // size. If unsuccessful, a new upload heap is created.
         static constexpr uint32_t UPLOAD_HEAP_SIZE = uint32_t(9 * 1024 * 1024);
         static constexpr uint32_t MAX_NUM_UPLOAD_HEAP_ALLOCS = 128;
+        // Additionally, every thread gets a small part of the upload heap for small requests,
+        // so that threads recording uploads in parallel don't contend on the same lock
+        static constexpr uint32_t UPLOAD_HEAP_SHARD_SIZE = uint32_t(256 * 1024);
+        static constexpr uint32_t MAX_NUM_UPLOAD_HEAP_SHARD_ALLOCS = 32;
+        static constexpr uint32_t MAX_UPLOAD_HEAP_SHARD_ALLOC_SIZE = uint32_t(64 * 1024);
 
         struct PendingResource
         {
@@ -371,22 +495,409 @@ namespace
             OffsetAllocator::Allocation Allocation = OffsetAllocator::Allocation::Empty();
         };
 
-        OffsetAllocator m_uploadHeapAllocator;
+        ShardedOffsetAllocator m_uploadHeapAllocator;
         ComPtr<ID3D12Resource> m_uploadHeap;
         void* m_uploadHeapMapped;
-        SRWLOCK m_uploadHeapLock = SRWLOCK_INIT;
 
         Util::SmallVector<PendingResource> m_toRelease;
         SRWLOCK m_pendingResourceLock = SRWLOCK_INIT;
 
         ComPtr<ID3D12Fence> m_fenceDirect;
         ComPtr<ID3D12Fence> m_fenceCompute;
+        ComPtr<ID3D12Fence> m_fenceCopy;
         uint64_t m_nextFenceVal = 1;    // no need to be atomic
 
         ResourceUploadBatch m_uploaders[MAX_NUM_THREADS];
+
+        struct alignas(64) FrameUploadChunk
+        {
+            // Offsets into the upload ring
+            uint32_t Curr = 0;
+            uint32_t End = 0;
+            uint64_t FrameIdx = UINT64_MAX;
+        };
+
+        ComPtr<ID3D12Resource> m_frameUploadRing;
+        uint8_t* m_frameUploadRingMapped;
+        D3D12_GPU_VIRTUAL_ADDRESS m_frameUploadRingVA;
+        // Fence value that marks GPU completion of the last frame that used each segment
+        uint64_t m_frameUploadSegmentFence[NUM_FRAME_UPLOAD_SEGMENTS] = { 0 };
+        // Written by the main thread in BeginFrame(), read by worker tasks that allocate
+        std::atomic_int32_t m_currFrameUploadSegment = -1;
+        std::atomic_uint64_t m_frameUploadFrameIdx = 0;
+        std::atomic_uint32_t m_frameUploadHead = 0;
+        FrameUploadChunk m_frameUploadChunks[MAX_NUM_THREADS];
+        HANDLE m_frameUploadEvent;
+
+        std::atomic_uint64_t m_categoryUsage[(int)MEMORY_CATEGORY::COUNT];
+        DXGI_QUERY_VIDEO_MEMORY_INFO m_vidMemInfo = {};
+        MEMORY_PRESSURE m_memoryPressure = MEMORY_PRESSURE::NONE;
+        SmallVector<MemoryPressureCallback> m_pressureCallbacks;
+        SRWLOCK m_pressureCallbackLock = SRWLOCK_INIT;
+
+        struct ReadbackBuffer
+        {
+            ID3D12Resource* Res;
+            uint32_t SizeInBytes;
+        };
+
+        struct PendingReadback
+        {
+            ReadbackBuffer Buffer;
+            uint32_t DataSizeInBytes;
+            uint64_t Fence;
+            ReadbackCallback Dlg;
+        };
+
+        SmallVector<PendingReadback> m_pendingReadbacks;
+        SmallVector<ReadbackBuffer> m_readbackPool;
+        SRWLOCK m_readbackLock = SRWLOCK_INIT;
+
+        struct PendingTiles
+        {
+            OffsetAllocator::Allocation Allocation;
+            uint64_t ReleaseFence;
+        };
+
+        // Offsets and sizes are in number of tiles
+        ID3D12Heap* m_tilePool = nullptr;
+        OffsetAllocator m_tilePoolAllocator;
+        SmallVector<PendingTiles> m_tilesToRelease;
+        SRWLOCK m_tilePoolLock = SRWLOCK_INIT;
+
+        // Keyed by the D3D object
+        HashTable<ResourceInfo> m_resources;
+        SRWLOCK m_resourceLock = SRWLOCK_INIT;
+
+        struct PendingCopyFrame
+        {
+            uint64_t Fence;
+            uint64_t FrameIdx;
+            double SubmitTime;
+        };
+
+        // Upload bandwidth tuning. Per-frame counters are reset in Recycle().
+        uint64_t m_frameBatchUploadBytes = 0;
+        std::atomic_uint64_t m_frameRingUploadBytes = 0;
+        std::atomic_uint64_t m_frameReservedBytes = 0;
+        std::atomic_bool m_uploadBudgetExhausted = false;
+        std::atomic_uint64_t m_frameUploadBudget = INITIAL_FRAME_UPLOAD_BUDGET;
+        SmallVector<PendingCopyFrame, SystemAllocator, MAX_NUM_PENDING_COPY_FRAMES> m_pendingCopyFrames;
+        uint64_t m_lastBudgetDecreaseFrame = 0;
+        uint64_t m_stagingPeak = 0;
+        uint32_t m_stagingPeakFrames = 0;
+        std::atomic_uint32_t m_arenaBlockScale = ARENA_BLOCK_SCALE_ONE;
+        UploadStats m_uploadStats = {};
     };
 
     GpuMemoryImplData* g_data = nullptr;
+
+    ZetaInline void TrackAllocation(MEMORY_CATEGORY category, uint64_t sizeInBytes)
+    {
+        g_data->m_categoryUsage[(int)category].fetch_add(sizeInBytes, std::memory_order_relaxed);
+    }
+
+    ZetaInline void TrackRelease(MEMORY_CATEGORY category, uint64_t sizeInBytes)
+    {
+        // Some resources are released after the GPU memory system has shut down
+        if (g_data)
+            g_data->m_categoryUsage[(int)category].fetch_sub(sizeInBytes, std::memory_order_relaxed);
+    }
+
+    // Called once per frame from Recycle(), after the copy queue fence has been signalled 
+    // for this frame
+    void UpdateUploadStats(uint64_t completedFenceValCopy)
+    {
+        auto& timer = App::GetTimer();
+        const double now = timer.GetTotalTime() + timer.GetTimeSinceLastTick();
+        const uint64_t frameIdx = timer.GetTotalFrameCount();
+        UploadStats& stats = g_data->m_uploadStats;
+
+        const uint64_t frameBytes = g_data->m_frameBatchUploadBytes + 
+            g_data->m_frameRingUploadBytes.exchange(0, std::memory_order_relaxed);
+        g_data->m_frameBatchUploadBytes = 0;
+        stats.FrameBytes = frameBytes;
+
+        auto& pending = g_data->m_pendingCopyFrames;
+        while (!pending.empty() && pending[0].Fence <= completedFenceValCopy)
+        {
+            stats.CopyLatencyMs = (float)((now - pending[0].SubmitTime) * 1000.0);
+            pending.erase(pending.begin());
+        }
+
+        // When full, the oldest entry still tells whether copies are falling behind
+        if (frameBytes && pending.size() < MAX_NUM_PENDING_COPY_FRAMES)
+        {
+            pending.push_back(GpuMemoryImplData::PendingCopyFrame{ 
+                .Fence = g_data->m_nextFenceVal,
+                .FrameIdx = frameIdx,
+                .SubmitTime = now });
+        }
+
+        const double maxLatency = MAX_COPY_LATENCY_FRAMES * timer.GetElapsedTime();
+        const bool fallingBehind = !pending.empty() && (now - pending[0].SubmitTime) > maxLatency;
+        uint64_t budget = g_data->m_frameUploadBudget.load(std::memory_order_relaxed);
+
+        // Copies that were submitted after the last decrease need to fall behind before 
+        // decreasing again, otherwise the budget would drop every frame while the copy 
+        // queue works through the backlog
+        if (fallingBehind && pending[0].FrameIdx > g_data->m_lastBudgetDecreaseFrame)
+        {
+            budget = Math::Max(budget / 2, MIN_FRAME_UPLOAD_BUDGET);
+            g_data->m_lastBudgetDecreaseFrame = frameIdx;
+        }
+        else if (!fallingBehind && g_data->m_uploadBudgetExhausted.load(std::memory_order_relaxed))
+            budget = Math::Min(budget + FRAME_UPLOAD_BUDGET_STEP, MAX_FRAME_UPLOAD_BUDGET);
+
+        g_data->m_frameUploadBudget.store(budget, std::memory_order_relaxed);
+        g_data->m_frameReservedBytes.store(0, std::memory_order_relaxed);
+        g_data->m_uploadBudgetExhausted.store(false, std::memory_order_relaxed);
+        stats.FrameBudget = budget;
+
+        const uint64_t staging = g_data->m_categoryUsage[(int)MEMORY_CATEGORY::UPLOAD].load(
+            std::memory_order_relaxed);
+        g_data->m_stagingPeak = Math::Max(g_data->m_stagingPeak, staging);
+        stats.StagingPeakBytes = Math::Max(stats.StagingPeakBytes, g_data->m_stagingPeak);
+
+        if (++g_data->m_stagingPeakFrames == STAGING_PEAK_WINDOW_FRAMES)
+        {
+            stats.StagingPeakBytes = g_data->m_stagingPeak;
+            g_data->m_stagingPeak = 0;
+            g_data->m_stagingPeakFrames = 0;
+        }
+
+        stats.ArenaBlockScale = g_data->m_arenaBlockScale.load(std::memory_order_relaxed) / 
+            (float)ARENA_BLOCK_SCALE_ONE;
+    }
+
+    void CopyName(char* dst, const char* src, size_t len)
+    {
+        const size_t n = Math::Min(len, (size_t)ResourceInfo::MAX_NAME_LENGTH - 1);
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+
+    void RegisterResource(ID3D12Pageable* obj, const char* name, uint64_t sizeInBytes, 
+        MEMORY_CATEGORY category, RESOURCE_KIND kind)
+    {
+        if (!g_data)
+            return;
+
+        ResourceInfo info;
+        name = name ? name : "";
+        ZETA_CPU_EVENT_MARKER("GpuMemory::Allocate %s (%llu KB)", name, sizeInBytes >> 10);
+
+        const char* sep = strchr(name, '_');
+        CopyName(info.Name, name, strlen(name));
+        CopyName(info.Owner, name, sep && sep != name ? sep - name : strlen(name));
+        info.SizeInBytes = sizeInBytes;
+        info.Category = category;
+        info.Kind = kind;
+
+        AcquireSRWLockExclusive(&g_data->m_resourceLock);
+        g_data->m_resources.insert_or_assign(reinterpret_cast<uintptr_t>(obj), info);
+        ReleaseSRWLockExclusive(&g_data->m_resourceLock);
+    }
+
+    void UnregisterResource(ID3D12Pageable* obj)
+    {
+        // Some resources are released after the GPU memory system has shut down
+        if (!g_data)
+            return;
+
+        AcquireSRWLockExclusive(&g_data->m_resourceLock);
+        g_data->m_resources.erase(reinterpret_cast<uintptr_t>(obj));
+        ReleaseSRWLockExclusive(&g_data->m_resourceLock);
+    }
+
+    // Placed resources are listed under the heap that they're placed in
+    void SetResourceHeap(ID3D12Resource* res, ID3D12Heap* heap)
+    {
+        AcquireSRWLockExclusive(&g_data->m_resourceLock);
+
+        auto info = g_data->m_resources.find(reinterpret_cast<uintptr_t>(res));
+        auto heapInfo = g_data->m_resources.find(reinterpret_cast<uintptr_t>(heap));
+        if (info && heapInfo)
+            memcpy(info.value()->Owner, heapInfo.value()->Name, ResourceInfo::MAX_NAME_LENGTH);
+
+        ReleaseSRWLockExclusive(&g_data->m_resourceLock);
+    }
+
+    uint64_t CommittedResourceSize(ID3D12Resource* res, MEMORY_CATEGORY& category)
+    {
+        const auto desc = res->GetDesc();
+
+        if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        {
+            category = (desc.Flags & D3D12_RESOURCE_FLAG_RAYTRACING_ACCELERATION_STRUCTURE) ?
+                MEMORY_CATEGORY::RT_AS : MEMORY_CATEGORY::BUFFER;
+
+            return Math::AlignUp(desc.Width, (uint64_t)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+        }
+
+        constexpr D3D12_RESOURCE_FLAGS writableFlags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET |
+            D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+        category = (desc.Flags & writableFlags) ? MEMORY_CATEGORY::RENDER_TARGET : 
+            MEMORY_CATEGORY::TEXTURE;
+
+        auto* device = App::GetRenderer().GetDevice();
+        return device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+    }
+
+    // Returns the smallest pooled buffer that fits or creates a new one
+    GpuMemoryImplData::ReadbackBuffer AcquireReadbackBuffer(uint32_t sizeInBytes)
+    {
+        AcquireSRWLockExclusive(&g_data->m_readbackLock);
+
+        int best = -1;
+        for (int i = 0; i < (int)g_data->m_readbackPool.size(); i++)
+        {
+            const uint32_t s = g_data->m_readbackPool[i].SizeInBytes;
+            if (s >= sizeInBytes && (best == -1 || s < g_data->m_readbackPool[best].SizeInBytes))
+                best = i;
+        }
+
+        if (best != -1)
+        {
+            auto ret = g_data->m_readbackPool[best];
+            g_data->m_readbackPool[best] = g_data->m_readbackPool.back();
+            g_data->m_readbackPool.pop_back();
+
+            ReleaseSRWLockExclusive(&g_data->m_readbackLock);
+
+            return ret;
+        }
+
+        ReleaseSRWLockExclusive(&g_data->m_readbackLock);
+
+        const uint32_t size = Math::AlignUp(sizeInBytes, READBACK_BUFFER_GRANULARITY);
+        D3D12_HEAP_PROPERTIES readbackHeap = Direct3DUtil::ReadbackHeapProp();
+        D3D12_RESOURCE_DESC desc = Direct3DUtil::BufferResourceDesc(size);
+        ID3D12Resource* buffer;
+
+        auto* device = App::GetRenderer().GetDevice();
+        CheckHR(device->CreateCommittedResource(&readbackHeap, D3D12_HEAP_FLAG_NONE,
+            &desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&buffer)));
+
+#ifndef NDEBUG
+        buffer->SetName(L"PooledReadback");
+#endif
+
+        TrackAllocation(MEMORY_CATEGORY::READBACK, size);
+
+        return GpuMemoryImplData::ReadbackBuffer{ .Res = buffer, .SizeInBytes = size };
+    }
+
+    void ReturnReadbackBuffer(const GpuMemoryImplData::ReadbackBuffer& buffer)
+    {
+        // Background tasks might finish after the GPU memory system has shut down
+        if (g_data)
+        {
+            AcquireSRWLockExclusive(&g_data->m_readbackLock);
+
+            if (g_data->m_readbackPool.size() < MAX_NUM_POOLED_READBACK_BUFFERS)
+            {
+                g_data->m_readbackPool.push_back(buffer);
+                ReleaseSRWLockExclusive(&g_data->m_readbackLock);
+
+                return;
+            }
+
+            ReleaseSRWLockExclusive(&g_data->m_readbackLock);
+        }
+
+        TrackRelease(MEMORY_CATEGORY::READBACK, buffer.SizeInBytes);
+        buffer.Res->Release();
+    }
+
+    bool AllocateTiles(uint32_t numTiles, OffsetAllocator::Allocation& alloc)
+    {
+        AcquireSRWLockExclusive(&g_data->m_tilePoolLock);
+        alloc = g_data->m_tilePoolAllocator.Allocate(numTiles);
+        ReleaseSRWLockExclusive(&g_data->m_tilePoolLock);
+
+        return !alloc.IsEmpty();
+    }
+
+    // Tiles might still be accessed by the GPU -- they're returned to the pool once the 
+    // current frame has finished
+    void ReleaseTiles(const OffsetAllocator::Allocation& alloc)
+    {
+        Assert(g_data, "Releasing GPU resources when GPU memory system has shut down.");
+
+        AcquireSRWLockExclusive(&g_data->m_tilePoolLock);
+        g_data->m_tilesToRelease.push_back(GpuMemoryImplData::PendingTiles{
+            .Allocation = alloc,
+            .ReleaseFence = g_data->m_nextFenceVal });
+        ReleaseSRWLockExclusive(&g_data->m_tilePoolLock);
+    }
+
+    void CreateTilePool()
+    {
+        D3D12_HEAP_DESC heapDesc;
+        heapDesc.SizeInBytes = (uint64_t)TILE_POOL_NUM_TILES * TILE_SIZE_IN_BYTES;
+        heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        heapDesc.Properties = Direct3DUtil::DefaultHeapProp();
+        heapDesc.Flags = D3D12_HEAP_FLAG_CREATE_NOT_ZEROED | 
+            D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+
+        auto* device = App::GetRenderer().GetDevice();
+        CheckHR(device->CreateHeap(&heapDesc, IID_PPV_ARGS(&g_data->m_tilePool)));
+        SET_D3D_OBJ_NAME(g_data->m_tilePool, "TilePool");
+
+        g_data->m_tilePoolAllocator.Init(TILE_POOL_NUM_TILES, TILE_POOL_NUM_TILES);
+        TrackAllocation(MEMORY_CATEGORY::TEXTURE, heapDesc.SizeInBytes);
+        RegisterResource(g_data->m_tilePool, "TilePool", heapDesc.SizeInBytes, MEMORY_CATEGORY::TEXTURE,
+            RESOURCE_KIND::HEAP);
+    }
+
+    void UpdateVideoMemoryInfo()
+    {
+        CheckHR(App::GetRenderer().GetAdapter()->QueryVideoMemoryInfo(0, 
+            DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &g_data->m_vidMemInfo));
+
+        const auto& info = g_data->m_vidMemInfo;
+        const float usage = info.Budget ? (float)((double)info.CurrentUsage / info.Budget) : 0.0f;
+        ZETA_CPU_EVENT_COUNTER(L"VRAM Usage (MB)", info.CurrentUsage >> 20);
+        const MEMORY_PRESSURE prev = g_data->m_memoryPressure;
+        MEMORY_PRESSURE curr = usage >= CRITICAL_MEMORY_PRESSURE_THRESHOLD ? MEMORY_PRESSURE::CRITICAL :
+            (usage >= HIGH_MEMORY_PRESSURE_THRESHOLD ? MEMORY_PRESSURE::HIGH : MEMORY_PRESSURE::NONE);
+
+        if (curr < prev)
+        {
+            const float threshold = prev == MEMORY_PRESSURE::CRITICAL ? 
+                CRITICAL_MEMORY_PRESSURE_THRESHOLD : HIGH_MEMORY_PRESSURE_THRESHOLD;
+            if (usage > threshold - MEMORY_PRESSURE_HYSTERESIS)
+                curr = prev;
+        }
+
+        if (curr == prev)
+            return;
+
+        g_data->m_memoryPressure = curr;
+
+        if (curr > prev)
+        {
+            StackStr(msg, n, "VRAM usage (%llu MB) is %s the budget (%llu MB)...", 
+                info.CurrentUsage >> 20, curr == MEMORY_PRESSURE::CRITICAL ? "over" : "close to", 
+                info.Budget >> 20);
+            App::Log(msg, LogMessage::MsgType::WARNING);
+
+            // Breakdown of where the memory went, as it was at this point
+            if (curr == MEMORY_PRESSURE::CRITICAL)
+                GpuMemory::WriteMemoryReport(MEMORY_REPORT_PATH);
+        }
+
+        // Callbacks might (un)register other callbacks
+        SmallVector<MemoryPressureCallback, SystemAllocator, 4> callbacks;
+
+        AcquireSRWLockShared(&g_data->m_pressureCallbackLock);
+        callbacks.append_range(g_data->m_pressureCallbacks.begin(), g_data->m_pressureCallbacks.end());
+        ReleaseSRWLockShared(&g_data->m_pressureCallbackLock);
+
+        for (auto& dlg : callbacks)
+            dlg(curr);
+    }
 }
 
 //--------------------------------------------------------------------------------------
@@ -456,8 +967,13 @@ void UploadHeapBuffer::Copy(uint32_t offset, uint32_t numBytesToCopy, void* data
 //--------------------------------------------------------------------------------------
 
 UploadHeapArena::UploadHeapArena(uint32_t sizeInBytes)
-    : m_size(Math::AlignUp(sizeInBytes, (uint32_t)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT))
-{}
+    : m_requestedSize(sizeInBytes)
+{
+    const uint64_t scaled = ((uint64_t)sizeInBytes * g_data->m_arenaBlockScale.load(
+        std::memory_order_relaxed)) / ARENA_BLOCK_SCALE_ONE;
+    m_size = (uint32_t)Math::AlignUp(Math::Min(scaled, (uint64_t)UINT32_MAX >> 1), 
+        (uint64_t)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+}
 
 UploadHeapArena::~UploadHeapArena()
 {
@@ -466,22 +982,24 @@ UploadHeapArena::~UploadHeapArena()
 }
 
 UploadHeapArena::UploadHeapArena(UploadHeapArena&& other)
-    : m_size(other.m_size)
+    : m_used(other.m_used),
+    m_size(other.m_size),
+    m_requestedSize(other.m_requestedSize)
 {
     m_blocks.swap(other.m_blocks);
     other.m_size = 0;
+    other.m_used = 0;
 }
 
 UploadHeapArena::Allocation UploadHeapArena::SubAllocate(uint32_t size, uint32_t alignment)
 {
-    Check(size <= m_size, "allocations larger than %u MB are not supported.", m_size / (1024 * 1024));
-
     for (auto& block : m_blocks)
     {
         const uint32_t newOffset = (uint32_t)Math::AlignUp(block.Offset, alignment);
 
-        if (newOffset + size <= m_size)
+        if (newOffset + size <= block.Size)
         {
+            m_used += newOffset + size - block.Offset;
             block.Offset = newOffset + size;
 
             return Allocation{ .Res = block.Res,
@@ -490,8 +1008,10 @@ UploadHeapArena::Allocation UploadHeapArena::SubAllocate(uint32_t size, uint32_t
         }
     }
 
+    const uint32_t blockSize = size <= m_size ? m_size : 
+        Math::AlignUp(size, (uint32_t)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
     D3D12_HEAP_PROPERTIES uploadHeap = Direct3DUtil::UploadHeapProp();
-    D3D12_RESOURCE_DESC bufferDesc = Direct3DUtil::BufferResourceDesc(m_size);
+    D3D12_RESOURCE_DESC bufferDesc = Direct3DUtil::BufferResourceDesc(blockSize);
 
     auto* device = App::GetRenderer().GetDevice();
 
@@ -504,6 +1024,7 @@ UploadHeapArena::Allocation UploadHeapArena::SubAllocate(uint32_t size, uint32_t
         IID_PPV_ARGS(&res)));
 
     SET_D3D_OBJ_NAME(res, "UploadHeapArena");
+    TrackAllocation(MEMORY_CATEGORY::UPLOAD, blockSize);
 
     // From MS docs:
     // "Resources on D3D12_HEAP_TYPE_UPLOAD heaps can be persistently mapped, meaning Map 
@@ -516,24 +1037,205 @@ UploadHeapArena::Allocation UploadHeapArena::SubAllocate(uint32_t size, uint32_t
 
     Block newBlock{ .Res = res,
         .Offset = size,
+        .Size = blockSize,
         .Mapped = mapped };
 
     m_blocks.push_front(ZetaMove(newBlock));
+    m_used += size;
 
     return Allocation{ .Res = res,
         .Mapped = mapped };
 }
 
+//--------------------------------------------------------------------------------------
+// TextureUploadRing
+//--------------------------------------------------------------------------------------
+
+TextureUploadRing::TextureUploadRing(uint32_t sizeInBytes)
+    : m_size(Math::AlignUp(sizeInBytes, (uint32_t)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT))
+{
+    D3D12_HEAP_PROPERTIES uploadHeap = Direct3DUtil::UploadHeapProp();
+    D3D12_RESOURCE_DESC bufferDesc = Direct3DUtil::BufferResourceDesc(m_size);
+
+    auto* device = App::GetRenderer().GetDevice();
+    CheckHR(device->CreateCommittedResource(&uploadHeap,
+        D3D12_HEAP_FLAG_CREATE_NOT_ZEROED,
+        &bufferDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&m_buffer)));
+
+    SET_D3D_OBJ_NAME(m_buffer, "TextureUploadRing");
+    TrackAllocation(MEMORY_CATEGORY::UPLOAD, m_size);
+
+    void* mapped;
+    CheckHR(m_buffer->Map(0, nullptr, &mapped));
+    m_mapped = reinterpret_cast<uint8_t*>(mapped);
+
+    m_event = CreateEventA(nullptr, false, false, nullptr);
+    CheckWin32(m_event);
+}
+
+TextureUploadRing::~TextureUploadRing()
+{
+    Assert(!m_cmdList, "Pending copies haven't been flushed.");
+    CloseHandle(m_event);
+
+    // Released once all the queues are past the current frame, which includes the 
+    // (earlier) copies
+    TrackRelease(MEMORY_CATEGORY::UPLOAD, m_size);
+    AcquireSRWLockExclusive(&g_data->m_pendingResourceLock);
+
+    g_data->m_toRelease.emplace_back(
+        GpuMemoryImplData::PendingResource{ .Res = m_buffer,
+            .ReleaseFence = g_data->m_nextFenceVal,
+            .MappedMemory = m_mapped });
+
+    ReleaseSRWLockExclusive(&g_data->m_pendingResourceLock);
+}
+
+void TextureUploadRing::SubmitBatch()
+{
+    if (!m_cmdList)
+        return;
+
+    m_lastFenceVal = App::GetRenderer().ExecuteCmdList(m_cmdList);
+    m_inFlight.push_back(Batch{ .FenceVal = m_lastFenceVal, .SizeInBytes = m_batchSize });
+    m_cmdList = nullptr;
+    m_batchSize = 0;
+}
+
+void TextureUploadRing::RetireOldestBatch()
+{
+    Assert(!m_inFlight.empty(), "No batches in flight.");
+    const Batch oldest = m_inFlight[0];
+    App::GetRenderer().WaitForCopyQueueFenceCPU2(oldest.FenceVal, m_event);
+
+    m_used -= oldest.SizeInBytes;
+    m_inFlight.erase(m_inFlight.begin());
+}
+
+void TextureUploadRing::UploadTexture(ID3D12Resource* texture, Span<D3D12_SUBRESOURCE_DATA> subresources,
+    uint32_t firstSubresourceIndex)
+{
+    constexpr int MAX_NUM_SUBRESOURCES = 13;
+    Assert(MAX_NUM_SUBRESOURCES >= subresources.size(), "MAX_NUM_SUBRESOURCES is too small.");
+
+    // Copies are submitted once this fraction of the ring has been staged, so that GPU 
+    // copies overlap with staging of the following textures
+    constexpr uint32_t NUM_BATCHES_PER_RING = 4;
+
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT subresLayout[MAX_NUM_SUBRESOURCES];
+    UINT subresNumRows[MAX_NUM_SUBRESOURCES];
+    UINT64 subresRowSize[MAX_NUM_SUBRESOURCES];
+
+    const auto destDesc = texture->GetDesc();
+    UINT64 totalSize;
+    App::GetRenderer().GetDevice()->GetCopyableFootprints(&destDesc, firstSubresourceIndex,
+        (uint32_t)subresources.size(), 0, subresLayout, subresNumRows, subresRowSize, &totalSize);
+
+    Check(totalSize <= m_size, "Texture upload (%llu MB) doesn't fit in the upload ring (%u MB).",
+        totalSize / (1024 * 1024), m_size / (1024 * 1024));
+    // Counts against the upload budget too, so that streaming backs off while loading
+    g_data->m_frameRingUploadBytes.fetch_add(totalSize, std::memory_order_relaxed);
+
+    // Staging and recording happen in ring order, so that batches retire in the same 
+    // order as their memory was allocated
+    AcquireSRWLockExclusive(&m_lock);
+
+    auto& renderer = App::GetRenderer();
+    while (!m_inFlight.empty() && renderer.IsCopyQueueFenceComplete(m_inFlight[0].FenceVal))
+        RetireOldestBatch();
+
+    uint32_t offset;
+    uint32_t sizeWithPadding;
+
+    while (true)
+    {
+        if (m_used == 0)
+            m_head = 0;
+
+        offset = (uint32_t)Math::AlignUp(m_head, (uint32_t)D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        // Skip the remainder of the ring and wrap around
+        if (offset + totalSize > m_size)
+            offset = 0;
+
+        sizeWithPadding = (offset == 0 && m_head != 0 ? m_size - m_head : offset - m_head) + 
+            (uint32_t)totalSize;
+
+        if (m_used + sizeWithPadding <= m_size)
+            break;
+
+        // Backpressure -- wait for the GPU to free up space
+        if (m_inFlight.empty())
+            SubmitBatch();
+
+        RetireOldestBatch();
+    }
+
+    m_head = offset + (uint32_t)totalSize;
+    m_used += sizeWithPadding;
+    m_batchSize += sizeWithPadding;
+
+    if (!m_cmdList)
+    {
+        m_cmdList = App::GetRenderer().GetCopyCmdList();
+#ifndef NDEBUG
+        m_cmdList->SetName("TextureUploadRing");
+#endif
+    }
+
+    StageAndCopyTexture(m_cmdList, m_buffer, m_mapped, offset, texture, 
+        (int)subresources.size(), firstSubresourceIndex, subresources, subresLayout, 
+        subresNumRows, subresRowSize);
+
+    if (m_batchSize >= m_size / NUM_BATCHES_PER_RING)
+        SubmitBatch();
+
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void TextureUploadRing::Flush(Span<ID3D12Resource*> textures)
+{
+    Assert(g_threadIdx >= 0 && g_threadIdx < MAX_NUM_THREADS, "Invalid thread index.");
+
+    AcquireSRWLockExclusive(&m_lock);
+    SubmitBatch();
+    const uint64_t fenceVal = m_lastFenceVal;
+    ReleaseSRWLockExclusive(&m_lock);
+
+    if (fenceVal == 0)
+        return;
+
+    g_data->m_uploaders[g_threadIdx].AddCopyDependency(fenceVal, textures,
+        D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+}
+
 //--------------------------------------------------------------------------------------
 // Buffer
 //--------------------------------------------------------------------------------------
 
-Buffer::Buffer(const char* p, ID3D12Resource* r, RESOURCE_HEAP_TYPE heapType)
+Buffer::Buffer(const char* p, ID3D12Resource* r, RESOURCE_HEAP_TYPE heapType, void* mapped)
     : m_resource(r),
+    m_mapped(mapped),
     m_ID(XXH3_64_To_32(XXH3_64bits(p, strlen(p)))),
     m_heapType(heapType)
 {
     SET_D3D_OBJ_NAME(m_resource, p);
+
+    if (m_resource)
+    {
+        const uint64_t size = CommittedResourceSize(m_resource, m_category);
+
+        if (m_heapType == RESOURCE_HEAP_TYPE::COMMITTED)
+        {
+            m_trackedSize = size;
+            TrackAllocation(m_category, m_trackedSize);
+        }
+
+        RegisterResource(m_resource, p, size, m_category, m_heapType == RESOURCE_HEAP_TYPE::COMMITTED ?
+            RESOURCE_KIND::COMMITTED : RESOURCE_KIND::PLACED);
+    }
 }
 
 Buffer::~Buffer()
@@ -543,11 +1245,16 @@ Buffer::~Buffer()
 
 Buffer::Buffer(Buffer&& other)
     : m_resource(other.m_resource),
+    m_mapped(other.m_mapped),
     m_ID(other.m_ID),
-    m_heapType(other.m_heapType)
+    m_heapType(other.m_heapType),
+    m_category(other.m_category),
+    m_trackedSize(other.m_trackedSize)
 {
     other.m_resource = nullptr;
+    other.m_mapped = nullptr;
     other.m_ID = INVALID_ID;
+    other.m_trackedSize = 0;
 }
 
 Buffer& Buffer::operator=(Buffer&& other)
@@ -558,11 +1265,16 @@ Buffer& Buffer::operator=(Buffer&& other)
     Reset();
 
     m_resource = other.m_resource;
+    m_mapped = other.m_mapped;
     m_ID = other.m_ID;
 
     other.m_resource = nullptr;
+    other.m_mapped = nullptr;
     other.m_ID = INVALID_ID;
     m_heapType = other.m_heapType;
+    m_category = other.m_category;
+    m_trackedSize = other.m_trackedSize;
+    other.m_trackedSize = 0;
 
     return *this;
 }
@@ -571,7 +1283,13 @@ void Buffer::Reset(bool waitForGpu)
 {
     if (m_resource)
     {
-        if (waitForGpu && (m_heapType == RESOURCE_HEAP_TYPE::COMMITTED))
+        UnregisterResource(m_resource);
+
+        if (m_trackedSize)
+            TrackRelease(m_category, m_trackedSize);
+
+        // Same as textures, placed buffers are deferred too
+        if (waitForGpu)
             GpuMemory::ReleaseDefaultHeapBuffer(*this);
         else
         {
@@ -583,6 +1301,8 @@ void Buffer::Reset(bool waitForGpu)
 
     m_ID = INVALID_ID;
     m_resource = nullptr;
+    m_mapped = nullptr;
+    m_trackedSize = 0;
 }
 
 //--------------------------------------------------------------------------------------
@@ -591,7 +1311,10 @@ void Buffer::Reset(bool waitForGpu)
 
 ReadbackHeapBuffer::ReadbackHeapBuffer(ID3D12Resource* r)
     : m_resource(r)
-{}
+{
+    if (m_resource)
+        TrackAllocation(MEMORY_CATEGORY::READBACK, m_resource->GetDesc().Width);
+}
 
 ReadbackHeapBuffer::~ReadbackHeapBuffer()
 {
@@ -622,6 +1345,8 @@ void ReadbackHeapBuffer::Reset(bool waitForGpu)
 {
     if (m_resource)
     {
+        TrackRelease(MEMORY_CATEGORY::READBACK, m_resource->GetDesc().Width);
+
         if (waitForGpu)
             GpuMemory::ReleaseReadbackHeapBuffer(*this);
         else
@@ -664,6 +1389,20 @@ Texture::Texture(const char* name, ID3D12Resource* res, RESOURCE_HEAP_TYPE heapT
     m_heapType(heapType)
 {
     SET_D3D_OBJ_NAME(m_resource, name);
+
+    if (m_resource)
+    {
+        const uint64_t size = CommittedResourceSize(m_resource, m_category);
+
+        if (m_heapType == RESOURCE_HEAP_TYPE::COMMITTED)
+        {
+            m_trackedSize = size;
+            TrackAllocation(m_category, m_trackedSize);
+        }
+
+        RegisterResource(m_resource, name, size, m_category, m_heapType == RESOURCE_HEAP_TYPE::COMMITTED ?
+            RESOURCE_KIND::COMMITTED : RESOURCE_KIND::PLACED);
+    }
 }
 
 Texture::Texture(ID_TYPE id, ID3D12Resource* res, RESOURCE_HEAP_TYPE heapType,
@@ -678,6 +1417,17 @@ Texture::Texture(ID_TYPE id, ID3D12Resource* res, RESOURCE_HEAP_TYPE heapType,
     {
         StackStr(name, N, "Tex2D_%u", id);
         SET_D3D_OBJ_NAME(m_resource, dbgName ? dbgName : name);
+
+        const uint64_t size = CommittedResourceSize(m_resource, m_category);
+
+        if (m_heapType == RESOURCE_HEAP_TYPE::COMMITTED)
+        {
+            m_trackedSize = size;
+            TrackAllocation(m_category, m_trackedSize);
+        }
+
+        RegisterResource(m_resource, dbgName ? dbgName : name, size, m_category, 
+            m_heapType == RESOURCE_HEAP_TYPE::COMMITTED ? RESOURCE_KIND::COMMITTED : RESOURCE_KIND::PLACED);
     }
 }
 
@@ -689,10 +1439,13 @@ Texture::~Texture()
 Texture::Texture(Texture&& other)
     : m_resource(other.m_resource),
     m_ID(other.m_ID),
-    m_heapType(other.m_heapType)
+    m_heapType(other.m_heapType),
+    m_category(other.m_category),
+    m_trackedSize(other.m_trackedSize)
 {
     other.m_resource = nullptr;
     other.m_ID = INVALID_ID;
+    other.m_trackedSize = 0;
 }
 
 Texture& Texture::operator=(Texture&& other)
@@ -705,9 +1458,12 @@ Texture& Texture::operator=(Texture&& other)
     m_resource = other.m_resource;
     m_ID = other.m_ID;
     m_heapType = other.m_heapType;
+    m_category = other.m_category;
+    m_trackedSize = other.m_trackedSize;
 
     other.m_resource = nullptr;
     other.m_ID = INVALID_ID;
+    other.m_trackedSize = 0;
 
     return *this;
 }
@@ -716,7 +1472,14 @@ void Texture::Reset(bool waitForGpu, bool checkRefCount)
 {
     if (m_resource)
     {
-        if (waitForGpu && (m_heapType == RESOURCE_HEAP_TYPE::COMMITTED))
+        UnregisterResource(m_resource);
+
+        if (m_trackedSize)
+            TrackRelease(m_category, m_trackedSize);
+
+        // Placed textures are deferred as well -- their heap is kept alive until GPU is done,
+        // but the resource object itself must not be destroyed while it's in use either
+        if (waitForGpu)
             GpuMemory::ReleaseTexture(*this);
         else
         {
@@ -728,15 +1491,24 @@ void Texture::Reset(bool waitForGpu, bool checkRefCount)
 
     m_resource = nullptr;
     m_ID = INVALID_ID;
+    m_trackedSize = 0;
 }
 
 //--------------------------------------------------------------------------------------
 // ResourceHeap
 //--------------------------------------------------------------------------------------
 
-ResourceHeap::ResourceHeap(ID3D12Heap* heap)
-    : m_heap(heap)
-{}
+ResourceHeap::ResourceHeap(const char* name, ID3D12Heap* heap, uint64_t sizeInBytes, 
+    MEMORY_CATEGORY category)
+    : m_heap(heap),
+    m_sizeInBytes(sizeInBytes),
+    m_category(category)
+{
+    name = name ? name : "ResourceHeap";
+    SET_D3D_OBJ_NAME(m_heap, name);
+    TrackAllocation(m_category, m_sizeInBytes);
+    RegisterResource(m_heap, name, m_sizeInBytes, m_category, RESOURCE_KIND::HEAP);
+}
 
 ResourceHeap::~ResourceHeap()
 {
@@ -744,9 +1516,12 @@ ResourceHeap::~ResourceHeap()
 }
 
 ResourceHeap::ResourceHeap(ResourceHeap&& other)
-    : m_heap(other.m_heap)
+    : m_heap(other.m_heap),
+    m_sizeInBytes(other.m_sizeInBytes),
+    m_category(other.m_category)
 {
     other.m_heap = nullptr;
+    other.m_sizeInBytes = 0;
 }
 
 ResourceHeap& ResourceHeap::operator=(ResourceHeap&& other)
@@ -757,7 +1532,10 @@ ResourceHeap& ResourceHeap::operator=(ResourceHeap&& other)
     Reset();
 
     m_heap = other.m_heap;
+    m_sizeInBytes = other.m_sizeInBytes;
+    m_category = other.m_category;
     other.m_heap = nullptr;
+    other.m_sizeInBytes = 0;
 
     return *this;
 }
@@ -765,9 +1543,250 @@ ResourceHeap& ResourceHeap::operator=(ResourceHeap&& other)
 void ResourceHeap::Reset()
 {
     if (m_heap)
+    {
+        UnregisterResource(m_heap);
+        TrackRelease(m_category, m_sizeInBytes);
         GpuMemory::ReleaseResourceHeap(*this);
+    }
 
     m_heap = nullptr;
+    m_sizeInBytes = 0;
+}
+
+//--------------------------------------------------------------------------------------
+// ReservedTexture
+//--------------------------------------------------------------------------------------
+
+ReservedTexture::ReservedTexture(Texture::ID_TYPE id, ID3D12Resource* res, const char* dbgName)
+    : m_resource(res),
+    m_ID(id)
+{
+    Assert(id != Texture::INVALID_ID, "Invalid ID.");
+
+    StackStr(name, N, "ReservedTex2D_%u", id);
+    SET_D3D_OBJ_NAME(m_resource, dbgName ? dbgName : name);
+
+    uint32_t numTiles;
+    uint32_t numTilings = D3D12_REQ_MIP_LEVELS;
+    auto* device = App::GetRenderer().GetDevice();
+    device->GetResourceTiling(m_resource, &numTiles, &m_packedMipInfo, &m_tileShape,
+        &numTilings, 0, m_mipTilings);
+
+    // Standard mips come before the packed ones
+    const uint32_t numStandardTiles = m_packedMipInfo.NumPackedMips ? 
+        m_packedMipInfo.StartTileIndexInOverallResource : numTiles;
+    m_tiles.resize(numStandardTiles, OffsetAllocator::Allocation::Empty());
+}
+
+ReservedTexture::~ReservedTexture()
+{
+    Reset();
+}
+
+ReservedTexture::ReservedTexture(ReservedTexture&& other)
+    : m_resource(other.m_resource),
+    m_ID(other.m_ID),
+    m_packedMipInfo(other.m_packedMipInfo),
+    m_tileShape(other.m_tileShape),
+    m_tiles(ZetaMove(other.m_tiles)),
+    m_packedMips(other.m_packedMips),
+    m_numMappedTiles(other.m_numMappedTiles)
+{
+    memcpy(m_mipTilings, other.m_mipTilings, sizeof(m_mipTilings));
+
+    other.m_resource = nullptr;
+    other.m_ID = Texture::INVALID_ID;
+    other.m_packedMips = OffsetAllocator::Allocation::Empty();
+    other.m_numMappedTiles = 0;
+}
+
+ReservedTexture& ReservedTexture::operator=(ReservedTexture&& other)
+{
+    if (this == &other)
+        return *this;
+
+    Reset();
+
+    m_resource = other.m_resource;
+    m_ID = other.m_ID;
+    m_packedMipInfo = other.m_packedMipInfo;
+    m_tileShape = other.m_tileShape;
+    memcpy(m_mipTilings, other.m_mipTilings, sizeof(m_mipTilings));
+    m_tiles.swap(other.m_tiles);
+    m_packedMips = other.m_packedMips;
+    m_numMappedTiles = other.m_numMappedTiles;
+
+    other.m_resource = nullptr;
+    other.m_ID = Texture::INVALID_ID;
+    other.m_packedMips = OffsetAllocator::Allocation::Empty();
+    other.m_numMappedTiles = 0;
+
+    return *this;
+}
+
+void ReservedTexture::Reset()
+{
+    if (m_resource)
+    {
+        // Resource is released along with its mappings, no need to unmap
+        for (auto& t : m_tiles)
+        {
+            if (!t.IsEmpty())
+                ReleaseTiles(t);
+        }
+
+        if (!m_packedMips.IsEmpty())
+            ReleaseTiles(m_packedMips);
+
+        GpuMemory::ReleaseReservedTexture(*this);
+    }
+
+    m_resource = nullptr;
+    m_ID = Texture::INVALID_ID;
+    m_tiles.free_memory();
+    m_packedMips = OffsetAllocator::Allocation::Empty();
+    m_numMappedTiles = 0;
+}
+
+bool ReservedTexture::MapTiles(uint32_t mip, uint32_t tileX, uint32_t tileY, uint32_t numTilesX,
+    uint32_t numTilesY)
+{
+    Assert(m_resource, "Texture hasn't been initialized.");
+
+    SmallVector<D3D12_TILED_RESOURCE_COORDINATE, SystemAllocator, 64> coords;
+    SmallVector<uint32_t, SystemAllocator, 64> tileIndices;
+
+    for (uint32_t y = tileY; y < tileY + numTilesY; y++)
+    {
+        for (uint32_t x = tileX; x < tileX + numTilesX; x++)
+        {
+            const uint32_t idx = TileIndex(mip, x, y);
+            if (!m_tiles[idx].IsEmpty())
+                continue;
+
+            OffsetAllocator::Allocation alloc;
+            if (!AllocateTiles(1, alloc))
+            {
+                // Roll back -- these haven't been mapped yet, so they can be freed right away
+                AcquireSRWLockExclusive(&g_data->m_tilePoolLock);
+
+                for (auto i : tileIndices)
+                {
+                    g_data->m_tilePoolAllocator.Free(m_tiles[i]);
+                    m_tiles[i] = OffsetAllocator::Allocation::Empty();
+                }
+
+                ReleaseSRWLockExclusive(&g_data->m_tilePoolLock);
+
+                return false;
+            }
+
+            m_tiles[idx] = alloc;
+            tileIndices.push_back(idx);
+            coords.push_back(D3D12_TILED_RESOURCE_COORDINATE{ .X = x, .Y = y, .Z = 0, 
+                .Subresource = mip });
+        }
+    }
+
+    const uint32_t n = (uint32_t)tileIndices.size();
+    if (n == 0)
+        return true;
+
+    SmallVector<D3D12_TILE_REGION_SIZE, SystemAllocator, 64> sizes;
+    SmallVector<uint32_t, SystemAllocator, 64> offsets;
+    SmallVector<uint32_t, SystemAllocator, 64> counts;
+    sizes.resize(n, D3D12_TILE_REGION_SIZE{ .NumTiles = 1, .UseBox = false });
+    counts.resize(n, 1);
+    offsets.resize(n);
+
+    for (uint32_t i = 0; i < n; i++)
+        offsets[i] = m_tiles[tileIndices[i]].Offset;
+
+    App::GetRenderer().UpdateTileMappings(m_resource, n, coords.data(), sizes.data(),
+        g_data->m_tilePool, n, nullptr, offsets.data(), counts.data());
+
+    m_numMappedTiles += n;
+
+    return true;
+}
+
+void ReservedTexture::UnmapTiles(uint32_t mip, uint32_t tileX, uint32_t tileY, uint32_t numTilesX,
+    uint32_t numTilesY)
+{
+    Assert(m_resource, "Texture hasn't been initialized.");
+
+    SmallVector<D3D12_TILED_RESOURCE_COORDINATE, SystemAllocator, 64> coords;
+
+    for (uint32_t y = tileY; y < tileY + numTilesY; y++)
+    {
+        for (uint32_t x = tileX; x < tileX + numTilesX; x++)
+        {
+            const uint32_t idx = TileIndex(mip, x, y);
+            if (m_tiles[idx].IsEmpty())
+                continue;
+
+            ReleaseTiles(m_tiles[idx]);
+            m_tiles[idx] = OffsetAllocator::Allocation::Empty();
+            coords.push_back(D3D12_TILED_RESOURCE_COORDINATE{ .X = x, .Y = y, .Z = 0, 
+                .Subresource = mip });
+        }
+    }
+
+    const uint32_t n = (uint32_t)coords.size();
+    if (n == 0)
+        return;
+
+    SmallVector<D3D12_TILE_REGION_SIZE, SystemAllocator, 64> sizes;
+    sizes.resize(n, D3D12_TILE_REGION_SIZE{ .NumTiles = 1, .UseBox = false });
+    const D3D12_TILE_RANGE_FLAGS rangeFlags = D3D12_TILE_RANGE_FLAG_NULL;
+
+    // A single null range covering all the regions
+    App::GetRenderer().UpdateTileMappings(m_resource, n, coords.data(), sizes.data(),
+        nullptr, 1, &rangeFlags, nullptr, &n);
+
+    Assert(m_numMappedTiles >= n, "Invalid number of mapped tiles.");
+    m_numMappedTiles -= n;
+}
+
+bool ReservedTexture::MapPackedMips()
+{
+    Assert(m_resource, "Texture hasn't been initialized.");
+
+    if (!m_packedMips.IsEmpty() || m_packedMipInfo.NumPackedMips == 0)
+        return true;
+
+    const uint32_t numTiles = m_packedMipInfo.NumTilesForPackedMips;
+    if (!AllocateTiles(numTiles, m_packedMips))
+        return false;
+
+    const D3D12_TILED_RESOURCE_COORDINATE coord{ .X = 0, .Y = 0, .Z = 0, 
+        .Subresource = m_packedMipInfo.NumStandardMips };
+    const D3D12_TILE_REGION_SIZE size{ .NumTiles = numTiles, .UseBox = false };
+
+    App::GetRenderer().UpdateTileMappings(m_resource, 1, &coord, &size,
+        g_data->m_tilePool, 1, nullptr, &m_packedMips.Offset, &numTiles);
+
+    return true;
+}
+
+void ReservedTexture::UnmapPackedMips()
+{
+    Assert(m_resource, "Texture hasn't been initialized.");
+
+    if (m_packedMips.IsEmpty())
+        return;
+
+    const uint32_t numTiles = m_packedMipInfo.NumTilesForPackedMips;
+    const D3D12_TILED_RESOURCE_COORDINATE coord{ .X = 0, .Y = 0, .Z = 0, 
+        .Subresource = m_packedMipInfo.NumStandardMips };
+    const D3D12_TILE_REGION_SIZE size{ .NumTiles = numTiles, .UseBox = false };
+    const D3D12_TILE_RANGE_FLAGS rangeFlags = D3D12_TILE_RANGE_FLAG_NULL;
+
+    App::GetRenderer().UpdateTileMappings(m_resource, 1, &coord, &size,
+        nullptr, 1, &rangeFlags, nullptr, &numTiles);
+
+    ReleaseTiles(m_packedMips);
+    m_packedMips = OffsetAllocator::Allocation::Empty();
 }
 
 //--------------------------------------------------------------------------------------
@@ -779,12 +1798,18 @@ void GpuMemory::Init()
     Assert(!g_data, "attempting to double initialize.");
     g_data = new GpuMemoryImplData;
 
+    const int numUploadHeapShards = Math::Min(App::GetNumWorkerThreads() + 
+        App::GetNumBackgroundThreads(), MAX_NUM_THREADS);
     g_data->m_uploadHeapAllocator.Init(GpuMemoryImplData::UPLOAD_HEAP_SIZE, 
-        GpuMemoryImplData::MAX_NUM_UPLOAD_HEAP_ALLOCS);
+        GpuMemoryImplData::MAX_NUM_UPLOAD_HEAP_ALLOCS,
+        numUploadHeapShards,
+        GpuMemoryImplData::UPLOAD_HEAP_SHARD_SIZE,
+        GpuMemoryImplData::MAX_NUM_UPLOAD_HEAP_SHARD_ALLOCS,
+        GpuMemoryImplData::MAX_UPLOAD_HEAP_SHARD_ALLOC_SIZE);
+    const uint32_t uploadHeapSize = g_data->m_uploadHeapAllocator.TotalSize();
 
     D3D12_HEAP_PROPERTIES uploadHeap = Direct3DUtil::UploadHeapProp();
-    D3D12_RESOURCE_DESC bufferDesc = Direct3DUtil::BufferResourceDesc(
-        GpuMemoryImplData::UPLOAD_HEAP_SIZE);
+    D3D12_RESOURCE_DESC bufferDesc = Direct3DUtil::BufferResourceDesc(uploadHeapSize);
 
     auto* device = App::GetRenderer().GetDevice();
     CheckHR(device->CreateCommittedResource(&uploadHeap,
@@ -801,11 +1826,83 @@ void GpuMemory::Init()
         g_data->m_fenceDirect.GetAddressOf())));
     CheckHR(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(
         g_data->m_fenceCompute.GetAddressOf())));
+    CheckHR(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(
+        g_data->m_fenceCopy.GetAddressOf())));
+
+    D3D12_RESOURCE_DESC ringDesc = Direct3DUtil::BufferResourceDesc(
+        FRAME_UPLOAD_SEGMENT_SIZE * NUM_FRAME_UPLOAD_SEGMENTS);
+
+    // Everything in the ring is written once by CPU and then read by GPU in the same
+    // frame (root CBVs, draw arguments, copy sources, etc.). With resizable BAR, it can
+    // live in video memory, so that GPU reads don't have to go over PCIe.
+    const bool ringInVideoMemory = App::GetRenderer().IsGpuUploadHeapSupported();
+    const D3D12_HEAP_PROPERTIES ringHeap = ringInVideoMemory ? Direct3DUtil::GpuUploadHeapProp() :
+        uploadHeap;
+
+    CheckHR(device->CreateCommittedResource(&ringHeap,
+        D3D12_HEAP_FLAG_CREATE_NOT_ZEROED,
+        &ringDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(g_data->m_frameUploadRing.GetAddressOf())));
+
+    SET_D3D_OBJ_NAME(g_data->m_frameUploadRing, "FrameUploadRing");
+
+    void* mapped;
+    CheckHR(g_data->m_frameUploadRing->Map(0, nullptr, &mapped));
+    g_data->m_frameUploadRingMapped = reinterpret_cast<uint8_t*>(mapped);
+    g_data->m_frameUploadRingVA = g_data->m_frameUploadRing->GetGPUVirtualAddress();
+
+    g_data->m_frameUploadEvent = CreateEventA(nullptr, false, false, nullptr);
+    CheckWin32(g_data->m_frameUploadEvent);
+
+    for (auto& c : g_data->m_categoryUsage)
+        c.store(0, std::memory_order_relaxed);
+
+    // Ring counts against the video memory budget when it's in a GPU upload heap
+    const MEMORY_CATEGORY ringCategory = ringInVideoMemory ? MEMORY_CATEGORY::BUFFER :
+        MEMORY_CATEGORY::UPLOAD;
+
+    TrackAllocation(MEMORY_CATEGORY::UPLOAD, uploadHeapSize);
+    TrackAllocation(ringCategory, FRAME_UPLOAD_SEGMENT_SIZE * NUM_FRAME_UPLOAD_SEGMENTS);
+    RegisterResource(g_data->m_uploadHeap.Get(), "UploadHeap", uploadHeapSize,
+        MEMORY_CATEGORY::UPLOAD, RESOURCE_KIND::COMMITTED);
+    RegisterResource(g_data->m_frameUploadRing.Get(), "FrameUploadRing", 
+        FRAME_UPLOAD_SEGMENT_SIZE * NUM_FRAME_UPLOAD_SEGMENTS, ringCategory, 
+        RESOURCE_KIND::COMMITTED);
+
+    UpdateVideoMemoryInfo();
 }
 
-void GpuMemory::BeginFrame()
-{
-    const int numThreads = App::GetNumWorkerThreads();
+void GpuMemory::BeginFrame()
+{
+    const int numThreads = App::GetNumWorkerThreads();
+
+    // Move to the next segment of the upload ring. Number of frames in flight is always 
+    // smaller than the number of segments, so GPU should already be done with it.
+    const int nextSegment = (g_data->m_currFrameUploadSegment.load(std::memory_order_relaxed) + 1) % 
+        NUM_FRAME_UPLOAD_SEGMENTS;
+    const uint64_t segmentFence = g_data->m_frameUploadSegmentFence[nextSegment];
+    ID3D12Fence* fences[] = { g_data->m_fenceDirect.Get(), g_data->m_fenceCompute.Get(),
+        g_data->m_fenceCopy.Get() };
+
+    for (auto* f : fences)
+    {
+        if (f->GetCompletedValue() < segmentFence)
+        {
+            CheckHR(f->SetEventOnCompletion(segmentFence, g_data->m_frameUploadEvent));
+            WaitForSingleObject(g_data->m_frameUploadEvent, INFINITE);
+        }
+    }
+
+    // Recycle() signals this value at the end of the frame
+    g_data->m_frameUploadSegmentFence[nextSegment] = g_data->m_nextFenceVal;
+    g_data->m_currFrameUploadSegment.store(nextSegment, std::memory_order_relaxed);
+    g_data->m_frameUploadHead.store(0, std::memory_order_relaxed);
+    // Invalidates chunks that threads claimed in prior frames. Release pairs with the acquire 
+    // in AllocateFrameUpload(), so the new segment and head are visible to threads that see 
+    // the new frame index.
+    g_data->m_frameUploadFrameIdx.fetch_add(1, std::memory_order_release);
 
     for (int i = 0; i < numThreads; i++)
         g_data->m_uploaders[i].Begin();
@@ -814,6 +1911,26 @@ void GpuMemory::BeginFrame()
 void GpuMemory::SubmitResourceCopies()
 {
     const int numThreads = App::GetNumWorkerThreads();
+    auto& renderer = App::GetRenderer();
+    uint64_t maxCopyFenceVal = 0;
+
+    // Copies of new resources run on the copy queue, overlapped with the remaining work 
+    // from prior frames
+    for (int i = 0; i < numThreads; i++)
+    {
+        auto f = g_data->m_uploaders[i].SubmitCopies();
+        maxCopyFenceVal = Math::Max(maxCopyFenceVal, f);
+        g_data->m_frameBatchUploadBytes += g_data->m_uploaders[i].TakeUploadedBytes();
+    }
+
+    // Both queues need to wait for the copy queue before using the uploaded resources. 
+    // The wait has to be queued before the post-copy transitions are submitted.
+    if (maxCopyFenceVal != 0)
+    {
+        renderer.WaitForCopyQueueOnDirectQueue(maxCopyFenceVal);
+        renderer.WaitForCopyQueueOnComputeQueue(maxCopyFenceVal);
+    }
+
     uint64_t maxFenceVal = 0;
 
     for (int i = 0; i < numThreads; i++)
@@ -825,7 +1942,7 @@ void GpuMemory::SubmitResourceCopies()
     if (maxFenceVal != 0)
     {
         // Compute queue needs to wait for direct queue
-        App::GetRenderer().WaitForDirectQueueOnComputeQueue(maxFenceVal);
+        renderer.WaitForDirectQueueOnComputeQueue(maxFenceVal);
     }
 }
 
@@ -834,21 +1951,25 @@ void GpuMemory::Recycle()
     auto& renderer = App::GetRenderer();
     renderer.SignalDirectQueue(g_data->m_fenceDirect.Get(), g_data->m_nextFenceVal);
     renderer.SignalComputeQueue(g_data->m_fenceCompute.Get(), g_data->m_nextFenceVal);
+    renderer.SignalCopyQueue(g_data->m_fenceCopy.Get(), g_data->m_nextFenceVal);
 
     for (int i = 0; i < App::GetNumWorkerThreads(); i++)
         g_data->m_uploaders[i].Recycle();
 
     const uint64_t completedFenceValDir = g_data->m_fenceDirect->GetCompletedValue();
     const uint64_t completedFenceValCompute = g_data->m_fenceCompute->GetCompletedValue();
+    const uint64_t completedFenceValCopy = g_data->m_fenceCopy->GetCompletedValue();
 
     SmallVector<GpuMemoryImplData::PendingResource> toDelete;
 
     {
         const auto* first = std::partition(g_data->m_toRelease.begin(), g_data->m_toRelease.end(),
-            [completedFenceValDir, completedFenceValCompute](const GpuMemoryImplData::PendingResource& res)
+            [completedFenceValDir, completedFenceValCompute, completedFenceValCopy](
+                const GpuMemoryImplData::PendingResource& res)
             {
                 return res.ReleaseFence > completedFenceValDir || 
-                    res.ReleaseFence > completedFenceValCompute;
+                    res.ReleaseFence > completedFenceValCompute ||
+                    res.ReleaseFence > completedFenceValCopy;
             });
 
         const auto numToDelete = g_data->m_toRelease.end() - first;
@@ -902,12 +2023,99 @@ void GpuMemory::Recycle()
         App::SubmitBackground(ZetaMove(t));
     }
 
+    const uint64_t completed = Math::Min(completedFenceValDir, 
+        Math::Min(completedFenceValCompute, completedFenceValCopy));
+
+    // Tiles whose last frame of use has finished on all queues
+    {
+        AcquireSRWLockExclusive(&g_data->m_tilePoolLock);
+
+        const auto* first = std::partition(g_data->m_tilesToRelease.begin(), 
+            g_data->m_tilesToRelease.end(),
+            [completed](const GpuMemoryImplData::PendingTiles& t)
+            {
+                return t.ReleaseFence > completed;
+            });
+
+        for (auto it = first; it < g_data->m_tilesToRelease.end(); it++)
+            g_data->m_tilePoolAllocator.Free(it->Allocation);
+
+        g_data->m_tilesToRelease.pop_back(g_data->m_tilesToRelease.end() - first);
+
+        ReleaseSRWLockExclusive(&g_data->m_tilePoolLock);
+    }
+
+    // Readbacks whose frame has finished on all queues
+    SmallVector<GpuMemoryImplData::PendingReadback> readbacks;
+    {
+
+        AcquireSRWLockExclusive(&g_data->m_readbackLock);
+
+        const auto* first = std::partition(g_data->m_pendingReadbacks.begin(), 
+            g_data->m_pendingReadbacks.end(),
+            [completed](const GpuMemoryImplData::PendingReadback& r)
+            {
+                return r.Fence > completed;
+            });
+
+        const auto numCompleted = g_data->m_pendingReadbacks.end() - first;
+        readbacks.append_range(first, g_data->m_pendingReadbacks.end(), true);
+        g_data->m_pendingReadbacks.pop_back(numCompleted);
+
+        ReleaseSRWLockExclusive(&g_data->m_readbackLock);
+    }
+
+    if (!readbacks.empty())
+    {
+        Task t("Readback callbacks", TASK_PRIORITY::BACKGROUND, [Readbacks = ZetaMove(readbacks)]()
+            {
+                for (auto& r : Readbacks)
+                {
+                    const D3D12_RANGE readRange{ .Begin = 0, .End = r.DataSizeInBytes };
+                    void* mapped;
+                    CheckHR(r.Buffer.Res->Map(0, &readRange, &mapped));
+
+                    r.Dlg(Span(reinterpret_cast<uint8_t*>(mapped), r.DataSizeInBytes));
+
+                    const D3D12_RANGE writeRange{ .Begin = 0, .End = 0 };
+                    r.Buffer.Res->Unmap(0, &writeRange);
+
+                    ReturnReadbackBuffer(r.Buffer);
+                }
+            });
+
+        App::SubmitBackground(ZetaMove(t));
+    }
+
+    UpdateVideoMemoryInfo();
+    UpdateUploadStats(completedFenceValCopy);
+
     g_data->m_nextFenceVal++;
 }
 
 void GpuMemory::Shutdown()
 {
     Assert(g_data, "g_data shouldn't be null.");
+
+    // Callbacks of readbacks that are still pending are dropped
+    for (auto& r : g_data->m_pendingReadbacks)
+    {
+        TrackRelease(MEMORY_CATEGORY::READBACK, r.Buffer.SizeInBytes);
+        r.Buffer.Res->Release();
+    }
+    for (auto& r : g_data->m_readbackPool)
+    {
+        TrackRelease(MEMORY_CATEGORY::READBACK, r.SizeInBytes);
+        r.Res->Release();
+    }
+
+    if (g_data->m_tilePool)
+    {
+        TrackRelease(MEMORY_CATEGORY::TEXTURE, (uint64_t)TILE_POOL_NUM_TILES * TILE_SIZE_IN_BYTES);
+        g_data->m_tilePool->Release();
+    }
+
+    CloseHandle(g_data->m_frameUploadEvent);
     delete g_data;
     g_data = nullptr;
 }
@@ -917,9 +2125,7 @@ UploadHeapBuffer GpuMemory::GetUploadHeapBuffer(uint32_t sizeInBytes, uint32_t a
 {
     if (!forceSeparate && sizeInBytes <= GpuMemoryImplData::UPLOAD_HEAP_SIZE)
     {
-        AcquireSRWLockExclusive(&g_data->m_uploadHeapLock);
         const auto alloc = g_data->m_uploadHeapAllocator.Allocate(sizeInBytes, alignment);
-        ReleaseSRWLockExclusive(&g_data->m_uploadHeapLock);
 
         if (alloc.IsEmpty())
         {
@@ -959,14 +2165,75 @@ UploadHeapBuffer GpuMemory::GetUploadHeapBuffer(uint32_t sizeInBytes, uint32_t a
         OffsetAllocator::Allocation alloc = OffsetAllocator::Allocation::Empty();
         alloc.Size = alignedSize;
 
+        TrackAllocation(MEMORY_CATEGORY::UPLOAD, alignedSize);
+
         return UploadHeapBuffer(buffer, mapped, alloc);
     }
 }
 
+FrameUploadAllocation GpuMemory::AllocateFrameUpload(uint32_t sizeInBytes, uint32_t alignment)
+{
+    Assert(g_threadIdx >= 0 && g_threadIdx < MAX_NUM_THREADS, "Invalid thread index.");
+    Assert(Math::IsPow2(alignment) && alignment <= FRAME_UPLOAD_MAX_ALIGNMENT, 
+        "Invalid alignment %u.", alignment);
+
+    auto& chunk = g_data->m_frameUploadChunks[g_threadIdx];
+
+    const uint64_t frameIdx = g_data->m_frameUploadFrameIdx.load(std::memory_order_acquire);
+
+    if (chunk.FrameIdx != frameIdx)
+    {
+        chunk.Curr = 0;
+        chunk.End = 0;
+        chunk.FrameIdx = frameIdx;
+    }
+
+    uint32_t offset = Math::AlignUp(chunk.Curr, alignment);
+
+    if (offset + sizeInBytes > chunk.End)
+    {
+        // Claim a new chunk -- requests that don't fit in a chunk get a dedicated one
+        const uint32_t chunkSize = Math::Max(FRAME_UPLOAD_CHUNK_SIZE,
+            Math::AlignUp(sizeInBytes, FRAME_UPLOAD_MAX_ALIGNMENT));
+        const uint32_t begin = g_data->m_frameUploadHead.fetch_add(chunkSize, 
+            std::memory_order_relaxed);
+
+        // Current segment is full, fall back to the shared upload heap. Buffer is released
+        // right away, but its memory isn't reused until GPU has finished this frame.
+        if (begin + chunkSize > FRAME_UPLOAD_SEGMENT_SIZE)
+        {
+            StackStr(msg, n, "Frame upload ring is full - allocating %u bytes from the upload heap...",
+                sizeInBytes);
+            App::Log(msg, LogMessage::MsgType::WARNING);
+
+            UploadHeapBuffer buffer = GpuMemory::GetUploadHeapBuffer(sizeInBytes, alignment);
+
+            return FrameUploadAllocation{ .Res = buffer.Resource(),
+                .MappedMemory = reinterpret_cast<uint8_t*>(buffer.MappedMemory()) + buffer.Offset(),
+                .GpuVA = buffer.GpuVA(),
+                .Offset = buffer.Offset() };
+        }
+
+        offset = g_data->m_currFrameUploadSegment.load(std::memory_order_relaxed) * 
+            FRAME_UPLOAD_SEGMENT_SIZE + begin;
+        chunk.End = offset + chunkSize;
+    }
+
+    chunk.Curr = offset + sizeInBytes;
+
+    return FrameUploadAllocation{ .Res = g_data->m_frameUploadRing.Get(),
+        .MappedMemory = g_data->m_frameUploadRingMapped + offset,
+        .GpuVA = g_data->m_frameUploadRingVA + offset,
+        .Offset = offset };
+}
+
 void GpuMemory::ReleaseUploadHeapBuffer(UploadHeapBuffer& buffer)
 {
     Assert(g_data, "Releasing GPU resources when GPU memory system has shut down.");
 
+    if (buffer.Resource() != g_data->m_uploadHeap.Get())
+        TrackRelease(MEMORY_CATEGORY::UPLOAD, buffer.Allocation().Size);
+
     AcquireSRWLockExclusive(&g_data->m_pendingResourceLock);
 
     g_data->m_toRelease.emplace_back(
@@ -987,6 +2254,24 @@ void GpuMemory::ReleaseUploadHeapArena(UploadHeapArena& arena)
     if (blocks.empty())
         return;
 
+    uint64_t releasedSize = 0;
+    for (auto& block : blocks)
+        releasedSize += block.Size;
+
+    TrackRelease(MEMORY_CATEGORY::UPLOAD, releasedSize);
+
+    // Moves the block scale of future arenas 1/8th of the way towards this arena's 
+    // usage. Concurrent updates might overwrite each other, which is fine.
+    if (arena.RequestedSize())
+    {
+        const uint64_t usage = (arena.UsedBytes() * ARENA_BLOCK_SCALE_ONE) / arena.RequestedSize();
+        const int64_t target = (int64_t)Math::Min(Math::Max(usage, (uint64_t)ARENA_BLOCK_SCALE_ONE), 
+            (uint64_t)MAX_ARENA_BLOCK_SCALE);
+        const int64_t curr = g_data->m_arenaBlockScale.load(std::memory_order_relaxed);
+        g_data->m_arenaBlockScale.store((uint32_t)(curr + (target - curr) / 8), 
+            std::memory_order_relaxed);
+    }
+
     AcquireSRWLockExclusive(&g_data->m_pendingResourceLock);
 
     for (auto& block : blocks)
@@ -1002,6 +2287,224 @@ void GpuMemory::ReleaseUploadHeapArena(UploadHeapArena& arena)
     ReleaseSRWLockExclusive(&g_data->m_pendingResourceLock);
 }
 
+bool GpuMemory::ReserveUploadBytes(uint64_t sizeInBytes)
+{
+    const uint64_t budget = g_data->m_frameUploadBudget.load(std::memory_order_relaxed);
+    const uint64_t ringBytes = g_data->m_frameRingUploadBytes.load(std::memory_order_relaxed);
+    const uint64_t prev = g_data->m_frameReservedBytes.fetch_add(sizeInBytes, 
+        std::memory_order_relaxed);
+
+    if (prev == 0 || prev + ringBytes + sizeInBytes <= budget)
+        return true;
+
+    g_data->m_frameReservedBytes.fetch_sub(sizeInBytes, std::memory_order_relaxed);
+    g_data->m_uploadBudgetExhausted.store(true, std::memory_order_relaxed);
+
+    return false;
+}
+
+UploadStats GpuMemory::GetUploadStats()
+{
+    return g_data->m_uploadStats;
+}
+
+VideoMemoryInfo GpuMemory::GetVideoMemoryInfo()
+{
+    VideoMemoryInfo ret;
+    ret.Budget = g_data->m_vidMemInfo.Budget;
+    ret.CurrentUsage = g_data->m_vidMemInfo.CurrentUsage;
+    ret.Pressure = g_data->m_memoryPressure;
+
+    for (int i = 0; i < (int)MEMORY_CATEGORY::COUNT; i++)
+        ret.CategoryUsage[i] = g_data->m_categoryUsage[i].load(std::memory_order_relaxed);
+
+    return ret;
+}
+
+void GpuMemory::RegisterMemoryPressureCallback(MemoryPressureCallback dlg)
+{
+    AcquireSRWLockExclusive(&g_data->m_pressureCallbackLock);
+    g_data->m_pressureCallbacks.push_back(dlg);
+    ReleaseSRWLockExclusive(&g_data->m_pressureCallbackLock);
+}
+
+void GpuMemory::UnregisterMemoryPressureCallback(MemoryPressureCallback dlg)
+{
+    AcquireSRWLockExclusive(&g_data->m_pressureCallbackLock);
+
+    for (size_t i = 0; i < g_data->m_pressureCallbacks.size(); i++)
+    {
+        if (g_data->m_pressureCallbacks[i] == dlg)
+        {
+            g_data->m_pressureCallbacks.erase_at_index(i);
+            break;
+        }
+    }
+
+    ReleaseSRWLockExclusive(&g_data->m_pressureCallbackLock);
+}
+
+void GpuMemory::SetResidencyPriority(Span<ID3D12Pageable*> objs, D3D12_RESIDENCY_PRIORITY priority)
+{
+    if (objs.empty())
+        return;
+
+    SmallVector<D3D12_RESIDENCY_PRIORITY, SystemAllocator, 16> priorities;
+    priorities.resize(objs.size(), priority);
+
+    auto* device = App::GetRenderer().GetDevice();
+    CheckHR(device->SetResidencyPriority((UINT)objs.size(), objs.data(), priorities.data()));
+}
+
+void GpuMemory::GetResourceInfos(Vector<ResourceInfo>& infos)
+{
+    AcquireSRWLockShared(&g_data->m_resourceLock);
+
+    infos.reserve(infos.size() + g_data->m_resources.size());
+    for (auto it = g_data->m_resources.begin_it(); it < g_data->m_resources.end_it(); 
+        it = g_data->m_resources.next_it(it))
+    {
+        infos.push_back(it->Val);
+    }
+
+    ReleaseSRWLockShared(&g_data->m_resourceLock);
+
+    std::sort(infos.begin(), infos.end(), [](const ResourceInfo& a, const ResourceInfo& b)
+        {
+            return a.SizeInBytes > b.SizeInBytes;
+        });
+}
+
+void GpuMemory::GetOwnerInfos(Span<ResourceInfo> infos, Vector<OwnerInfo>& owners)
+{
+    for (auto& r : infos)
+    {
+        OwnerInfo* owner = nullptr;
+        for (auto& o : owners)
+        {
+            if (strcmp(o.Name, r.Owner) == 0)
+            {
+                owner = &o;
+                break;
+            }
+        }
+
+        if (!owner)
+        {
+            OwnerInfo o;
+            memcpy(o.Name, r.Owner, ResourceInfo::MAX_NAME_LENGTH);
+            o.SizeInBytes = 0;
+            o.NumResources = 0;
+            owners.push_back(o);
+            owner = &owners.back();
+        }
+
+        owner->SizeInBytes += r.Kind != RESOURCE_KIND::PLACED ? r.SizeInBytes : 0;
+        owner->NumResources++;
+    }
+
+    std::sort(owners.begin(), owners.end(), [](const OwnerInfo& a, const OwnerInfo& b)
+        {
+            return a.SizeInBytes > b.SizeInBytes;
+        });
+}
+
+void GpuMemory::GetAllocatorInfos(Vector<AllocatorInfo>& infos)
+{
+    const auto uploadReport = g_data->m_uploadHeapAllocator.GetStorageReport();
+
+    infos.push_back(AllocatorInfo{ .Name = "Shared upload heap",
+        .Unit = "bytes",
+        .Size = g_data->m_uploadHeapAllocator.TotalSize(),
+        .Free = uploadReport.TotalFreeSpace,
+        .LargestFreeRegion = uploadReport.LargestFreeRegion });
+
+    AcquireSRWLockExclusive(&g_data->m_tilePoolLock);
+    if (g_data->m_tilePool)
+    {
+        const auto tileReport = g_data->m_tilePoolAllocator.GetStorageReport();
+        infos.push_back(AllocatorInfo{ .Name = "Tile pool",
+            .Unit = "tiles",
+            .Size = TILE_POOL_NUM_TILES,
+            .Free = tileReport.TotalFreeSpace,
+            .LargestFreeRegion = tileReport.LargestFreeRegion });
+    }
+    ReleaseSRWLockExclusive(&g_data->m_tilePoolLock);
+
+    auto& renderer = App::GetRenderer();
+    auto addHeap = [&infos](const char* name, DescriptorHeap& heap)
+        {
+            infos.push_back(AllocatorInfo{ .Name = name,
+                .Unit = "descriptors",
+                .Size = heap.GetHeapSize(),
+                .Free = heap.GetNumFreeDescriptors(),
+                .LargestFreeRegion = 0 });
+        };
+
+    addHeap("CBV/SRV/UAV descriptor heap (shader visible)", renderer.GetGpuDescriptorHeap());
+    addHeap("CBV/SRV/UAV descriptor heap", renderer.GetCbvSrvUavDescriptorHeapCpu());
+    addHeap("RTV descriptor heap", renderer.GetRtvDescriptorHeap());
+}
+
+const char* GpuMemory::GetMemoryCategoryName(MEMORY_CATEGORY category)
+{
+    Assert(category < MEMORY_CATEGORY::COUNT, "Invalid category.");
+    return CATEGORY_NAMES[(int)category];
+}
+
+void GpuMemory::WriteMemoryReport(const char* path)
+{
+    const VideoMemoryInfo memInfo = GetVideoMemoryInfo();
+    SmallVector<ResourceInfo> resources;
+    GetResourceInfos(resources);
+    SmallVector<OwnerInfo> owners;
+    GetOwnerInfos(resources, owners);
+    SmallVector<AllocatorInfo> allocators;
+    GetAllocatorInfos(allocators);
+
+    constexpr double MB = 1024.0 * 1024.0;
+    SmallVector<char> report;
+    AppendFormat(report, "Frame %llu, VRAM usage: %.1f MB, budget: %.1f MB\n\nBy category (MB):\n",
+        App::GetTimer().GetTotalFrameCount(), memInfo.CurrentUsage / MB, memInfo.Budget / MB);
+
+    for (int i = 0; i < (int)MEMORY_CATEGORY::COUNT; i++)
+        AppendFormat(report, "    %-32s %10.2f\n", CATEGORY_NAMES[i], memInfo.CategoryUsage[i] / MB);
+
+    AppendFormat(report, "\nBy owner (MB):\n");
+    for (auto& o : owners)
+        AppendFormat(report, "    %-32s %10.2f  (%u resources)\n", o.Name, o.SizeInBytes / MB, o.NumResources);
+
+    constexpr const char* KIND_NAMES[] = { "committed", "placed", "heap" };
+    AppendFormat(report, "\nResources:\n    %-32s %-24s %-24s %-10s %10s\n", "Name", "Owner", "Category", 
+        "Kind", "Size (MB)");
+
+    for (auto& r : resources)
+    {
+        AppendFormat(report, "    %-32s %-24s %-24s %-10s %10.3f\n", r.Name, r.Owner, 
+            CATEGORY_NAMES[(int)r.Category], KIND_NAMES[(int)r.Kind], r.SizeInBytes / MB);
+    }
+
+    AppendFormat(report, "\nAllocators:\n");
+    for (auto& a : allocators)
+    {
+        AppendFormat(report, "    %s: %u of %u %s used", a.Name, a.Size - a.Free, a.Size, a.Unit);
+
+        // Fraction of free space that can't be used for an allocation of the largest free size
+        if (a.LargestFreeRegion && a.Free)
+        {
+            AppendFormat(report, ", largest free region: %u %s (fragmentation: %.1f%%)", 
+                a.LargestFreeRegion, a.Unit, (1.0 - (double)a.LargestFreeRegion / a.Free) * 100.0);
+        }
+
+        AppendFormat(report, "\n");
+    }
+
+    Filesystem::WriteToFile(path, reinterpret_cast<uint8_t*>(report.data()), (uint32_t)report.size());
+
+    StackStr(msg, n, "GPU memory report written to %s.", path);
+    App::Log(msg, LogMessage::MsgType::INFO);
+}
+
 ReadbackHeapBuffer GpuMemory::GetReadbackHeapBuffer(uint32_t sizeInBytes)
 {
     auto* device = App::GetRenderer().GetDevice();
@@ -1037,6 +2540,39 @@ void GpuMemory::ReleaseReadbackHeapBuffer(ReadbackHeapBuffer& buffer)
     ReleaseSRWLockExclusive(&g_data->m_pendingResourceLock);
 }
 
+ReadbackTicket GpuMemory::EnqueueReadback(CopyCmdList& cmdList, ID3D12Resource* srcBuffer,
+    uint64_t srcOffsetInBytes, uint32_t sizeInBytes, ReadbackCallback dlg)
+{
+    Assert(sizeInBytes, "Readback size must be greater than zero.");
+    Assert(!dlg.empty(), "Invalid callback.");
+
+    auto buffer = AcquireReadbackBuffer(sizeInBytes);
+    cmdList.CopyBufferRegion(buffer.Res, 0, srcBuffer, srcOffsetInBytes, sizeInBytes);
+
+    AcquireSRWLockExclusive(&g_data->m_readbackLock);
+
+    // Fence is signalled at the end of this frame, after all of its command lists
+    const uint64_t fence = g_data->m_nextFenceVal;
+    g_data->m_pendingReadbacks.push_back(GpuMemoryImplData::PendingReadback{
+        .Buffer = buffer,
+        .DataSizeInBytes = sizeInBytes,
+        .Fence = fence,
+        .Dlg = dlg });
+
+    ReleaseSRWLockExclusive(&g_data->m_readbackLock);
+
+    return fence;
+}
+
+bool GpuMemory::IsReadbackComplete(ReadbackTicket ticket)
+{
+    Assert(ticket, "Invalid ticket.");
+
+    return g_data->m_fenceDirect->GetCompletedValue() >= ticket &&
+        g_data->m_fenceCompute->GetCompletedValue() >= ticket &&
+        g_data->m_fenceCopy->GetCompletedValue() >= ticket;
+}
+
 Buffer GpuMemory::GetDefaultHeapBuffer(const char* name, uint32_t sizeInBytes,
     D3D12_RESOURCE_STATES initState, bool allowUAV, bool initToZero)
 {
@@ -1092,6 +2628,29 @@ Buffer GpuMemory::GetDefaultHeapBuffer(const char* name, uint32_t sizeInBytes,
     return Buffer(name, r, RESOURCE_HEAP_TYPE::COMMITTED);
 }
 
+Buffer GpuMemory::GetGpuUploadHeapBuffer(const char* name, uint32_t sizeInBytes)
+{
+    Assert(App::GetRenderer().IsGpuUploadHeapSupported(), "GPU upload heaps are not supported.");
+
+    const D3D12_HEAP_PROPERTIES heapDesc = Direct3DUtil::GpuUploadHeapProp();
+    const D3D12_RESOURCE_DESC bufferDesc = Direct3DUtil::BufferResourceDesc(sizeInBytes);
+
+    auto* device = App::GetRenderer().GetDevice();
+    ID3D12Resource* r;
+    CheckHR(device->CreateCommittedResource(&heapDesc,
+        D3D12_HEAP_FLAG_CREATE_NOT_ZEROED,
+        &bufferDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&r)));
+
+    // Write-combined -- CPU should only write to it, sequentially
+    void* mapped;
+    CheckHR(r->Map(0, nullptr, &mapped));
+
+    return Buffer(name, r, RESOURCE_HEAP_TYPE::COMMITTED, mapped);
+}
+
 Buffer GpuMemory::GetPlacedHeapBuffer(const char* name, uint32_t sizeInBytes, ID3D12Heap* heap,
     uint64_t offsetInBytes, bool allowUAV, bool isRtAs)
 {
@@ -1112,7 +2671,10 @@ Buffer GpuMemory::GetPlacedHeapBuffer(const char* name, uint32_t sizeInBytes, ID
         nullptr,
         IID_PPV_ARGS(&r)));
 
-    return Buffer(name, r, RESOURCE_HEAP_TYPE::PLACED);
+    Buffer buffer(name, r, RESOURCE_HEAP_TYPE::PLACED);
+    SetResourceHeap(r, heap);
+
+    return buffer;
 }
 
 Buffer GpuMemory::GetDefaultHeapBufferAndInit(const char* name, uint32_t sizeInBytes, 
@@ -1127,7 +2689,7 @@ Buffer GpuMemory::GetDefaultHeapBufferAndInit(const char* name, uint32_t sizeInB
         false);
 
     g_data->m_uploaders[g_threadIdx].UploadBuffer(buffer.Resource(), initData.Data,
-        (uint32)initData.SizeInBytes, 0, forceSeparateUploadBuffer);
+        (uint32)initData.SizeInBytes, 0, forceSeparateUploadBuffer, true);
 
     return buffer;
 }
@@ -1146,7 +2708,7 @@ Buffer GpuMemory::GetPlacedHeapBufferAndInit(const char* name, uint32_t sizeInBy
         false);
 
     g_data->m_uploaders[g_threadIdx].UploadBuffer(buffer.Resource(), initData.Data,
-        (uint32)initData.SizeInBytes, 0, forceSeparateUploadBuffer);
+        (uint32)initData.SizeInBytes, 0, forceSeparateUploadBuffer, true);
 
     return buffer;
 }
@@ -1160,8 +2722,8 @@ void GpuMemory::UploadToDefaultHeapBuffer(Buffer& buffer, uint32_t sizeInBytes,
         destOffsetInBytes);
 }
 
-ResourceHeap GpuMemory::GetResourceHeap(uint64_t sizeInBytes, uint64_t alignment, 
-    bool createZeroed)
+ResourceHeap GpuMemory::GetResourceHeap(const char* name, uint64_t sizeInBytes, MEMORY_CATEGORY category,
+    uint64_t alignment, bool createZeroed)
 {
     D3D12_HEAP_DESC heapDesc;
     heapDesc.SizeInBytes = Math::AlignUp(sizeInBytes, alignment);
@@ -1169,11 +2731,13 @@ ResourceHeap GpuMemory::GetResourceHeap(uint64_t sizeInBytes, uint64_t alignment
     heapDesc.Properties = Direct3DUtil::DefaultHeapProp();
     heapDesc.Flags = !createZeroed ? D3D12_HEAP_FLAG_CREATE_NOT_ZEROED : D3D12_HEAP_FLAG_NONE;
 
+    ZETA_CPU_EVENT_SCOPE("GpuMemory::CreateHeap %s", name);
+
     ID3D12Heap* heap;
     auto* device = App::GetRenderer().GetDevice();
     CheckHR(device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap)));
 
-    return ResourceHeap(heap);
+    return ResourceHeap(name, heap, heapDesc.SizeInBytes, category);
 }
 
 void GpuMemory::ReleaseDefaultHeapBuffer(Buffer& buffer)
@@ -1215,6 +2779,19 @@ void GpuMemory::ReleaseResourceHeap(ResourceHeap& heap)
     ReleaseSRWLockExclusive(&g_data->m_pendingResourceLock);
 }
 
+void GpuMemory::ReleaseReservedTexture(ReservedTexture& texture)
+{
+    Assert(g_data, "Releasing GPU resources when GPU memory system has shut down.");
+
+    AcquireSRWLockExclusive(&g_data->m_pendingResourceLock);
+
+    g_data->m_toRelease.emplace_back(
+        GpuMemoryImplData::PendingResource{ .Res = texture.Resource(),
+            .ReleaseFence = g_data->m_nextFenceVal });
+
+    ReleaseSRWLockExclusive(&g_data->m_pendingResourceLock);
+}
+
 Texture GpuMemory::GetTexture2D(const char* name, uint64_t width, uint32_t height, DXGI_FORMAT format,
     D3D12_RESOURCE_STATES initialState, uint32_t flags, uint16_t mipLevels, D3D12_CLEAR_VALUE* clearVal)
 {
@@ -1293,7 +2870,10 @@ Texture GpuMemory::GetPlacedTexture2D(const char* name, uint64_t width, uint32_t
         clearVal,
         IID_PPV_ARGS(&texture)));
 
-    return Texture(name, texture, RESOURCE_HEAP_TYPE::PLACED);
+    Texture t(name, texture, RESOURCE_HEAP_TYPE::PLACED);
+    SetResourceHeap(texture, heap);
+
+    return t;
 }
 
 Texture GpuMemory::GetPlacedTexture2D(const char* name, uint64_t width, uint32_t height,
@@ -1329,7 +2909,10 @@ Texture GpuMemory::GetPlacedTexture2D(const char* name, uint64_t width, uint32_t
         nullptr,
         IID_PPV_ARGS(&texture)));
 
-    return Texture(name, texture, RESOURCE_HEAP_TYPE::PLACED);
+    Texture t(name, texture, RESOURCE_HEAP_TYPE::PLACED);
+    SetResourceHeap(texture, heap);
+
+    return t;
 }
 
 Texture GpuMemory::GetTexture2D(const char* name, uint64_t width, uint32_t height, DXGI_FORMAT format,
@@ -1382,6 +2965,35 @@ Texture GpuMemory::GetTexture2D(Texture::ID_TYPE id, uint64_t width, uint32_t he
     return Texture(id, texture, RESOURCE_HEAP_TYPE::COMMITTED, dbgName);
 }
 
+ReservedTexture GpuMemory::GetReservedTexture2D(Texture::ID_TYPE id, uint64_t width, uint32_t height,
+    DXGI_FORMAT format, D3D12_BARRIER_LAYOUT initialLayout, uint16_t mipLevels, const char* dbgName)
+{
+    Assert(App::GetRenderer().IsReservedResourceSupported(), "Reserved resources aren't supported.");
+    Assert(width < D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION, "Invalid width.");
+    Assert(height < D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION, "Invalid height.");
+    Assert(mipLevels <= D3D12_REQ_MIP_LEVELS, "Invalid number of mip levels.");
+
+    AcquireSRWLockExclusive(&g_data->m_tilePoolLock);
+    if (!g_data->m_tilePool)
+        CreateTilePool();
+    ReleaseSRWLockExclusive(&g_data->m_tilePoolLock);
+
+    D3D12_RESOURCE_DESC desc = Direct3DUtil::Tex2D(format, width, height, 1, mipLevels, 
+        D3D12_RESOURCE_FLAG_NONE, D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE);
+
+    ID3D12Resource* texture;
+    auto* device = App::GetRenderer().GetDevice();
+    CheckHR(device->CreateReservedResource2(&desc,
+        initialLayout,
+        nullptr,
+        nullptr,
+        0,
+        nullptr,
+        IID_PPV_ARGS(&texture)));
+
+    return ReservedTexture(id, texture, dbgName);
+}
+
 Texture GpuMemory::GetTexture3D(const char* name, uint64_t width, uint32_t height, uint16_t depth,
     DXGI_FORMAT format, D3D12_RESOURCE_STATES initialState, uint32_t flags, uint16_t mipLevels)
 {
@@ -1466,7 +3078,7 @@ LOAD_DDS_RESULT GpuMemory::GetTexture2DFromDisk(const char* texPath,
 }
 
 LOAD_DDS_RESULT GpuMemory::GetDDSDataFromDisk(const char* texPath,
-    DDS_Data& dds, UploadHeapArena& heapArena, Support::ArenaAllocator allocator)
+    DDS_Data& dds, Support::ArenaAllocator allocator)
 {
     return Direct3DUtil::LoadDDSFromFile(texPath, dds.subresources, 
         dds.format, allocator, dds.width, dds.height, dds.depth, dds.mipCount, 
@@ -1515,7 +3127,36 @@ Texture GpuMemory::GetPlacedTexture2DAndInit(Texture::ID_TYPE ID, const D3D12_RE
 
     g_data->m_uploaders[g_threadIdx].UploadTexture(heapArena, texture, subresources);
 
-    return Texture(ID, texture, RESOURCE_HEAP_TYPE::PLACED, dbgName);
+    Texture t(ID, texture, RESOURCE_HEAP_TYPE::PLACED, dbgName);
+    SetResourceHeap(texture, heap);
+
+    return t;
+}
+
+Texture GpuMemory::GetPlacedTexture2D(Texture::ID_TYPE ID, const D3D12_RESOURCE_DESC1& desc,
+    ID3D12Heap* heap, uint64_t offsetInBytes, D3D12_RESOURCE_STATES initialState, 
+    const char* dbgName)
+{
+    ID3D12Resource* texture;
+    auto* device = App::GetRenderer().GetDevice();
+    CheckHR(device->CreatePlacedResource1(heap,
+        offsetInBytes,
+        &desc,
+        initialState,
+        nullptr,
+        IID_PPV_ARGS(&texture)));
+
+    Texture t(ID, texture, RESOURCE_HEAP_TYPE::PLACED, dbgName);
+    SetResourceHeap(texture, heap);
+
+    return t;
+}
+
+void GpuMemory::UploadToTexture(Texture& tex, UploadHeapArena& heapArena,
+    Span<D3D12_SUBRESOURCE_DATA> subresources, uint32_t firstSubresourceIndex)
+{
+    g_data->m_uploaders[g_threadIdx].UploadTexture(heapArena, tex.Resource(), subresources,
+        firstSubresourceIndex);
 }
 
 Texture GpuMemory::GetTexture2DAndInit(const char* name, uint64_t width, uint32_t height, 
@@ -3,6 +3,13 @@
 #include "Direct3DUtil.h"
 #include "../Utility/Span.h"
 #include "../Support/OffsetAllocator.h"
+#include "../Utility/SmallVector.h"
+#include <FastDelegate/FastDelegate.h>
+
+namespace ZetaRay::Core
+{
+    class CopyCmdList;
+}
 
 namespace ZetaRay::Core::GpuMemory
 {
@@ -26,6 +33,106 @@ namespace ZetaRay::Core::GpuMemory
         COUNT
     };
 
+    // Categories for memory accounting. Committed resources are categorized from their 
+    // description, while placed resources are counted through the heap that they're 
+    // placed in.
+    enum class MEMORY_CATEGORY
+    {
+        TEXTURE,
+        RT_AS,
+        // Textures that allow render target, depth-stencil or UAV access
+        RENDER_TARGET,
+        BUFFER,
+        // Might reside in system memory depending on the platform
+        UPLOAD,
+        READBACK,
+        COUNT
+    };
+
+    enum class MEMORY_PRESSURE
+    {
+        NONE,
+        // Usage is approaching the budget
+        HIGH,
+        // Usage is at or over the budget -- OS has started (or is about to start) paging
+        CRITICAL
+    };
+
+    struct VideoMemoryInfo
+    {
+        // As reported by the OS for the local segment group
+        uint64_t Budget;
+        uint64_t CurrentUsage;
+        uint64_t CategoryUsage[(int)MEMORY_CATEGORY::COUNT];
+        MEMORY_PRESSURE Pressure;
+    };
+
+    struct UploadStats
+    {
+        // Bytes that went through the upload heaps in the last frame
+        uint64_t FrameBytes;
+        // See ReserveUploadBytes()
+        uint64_t FrameBudget;
+        // Time from submission of a frame's copies until the copy queue had finished them. 
+        // Completion is checked at the end of every frame, so this is an upper bound.
+        float CopyLatencyMs;
+        // Peak upload heap usage over the last few seconds
+        uint64_t StagingPeakBytes;
+        // Ratio of used bytes to requested block size of recently released arenas, which 
+        // new arenas scale their block size by
+        float ArenaBlockScale;
+    };
+
+    using MemoryPressureCallback = fastdelegate::FastDelegate1<MEMORY_PRESSURE>;
+
+    enum class RESOURCE_KIND : uint8_t
+    {
+        COMMITTED,
+        // Memory is accounted for by the heap that it's placed in
+        PLACED,
+        HEAP
+    };
+
+    // A live buffer, texture or resource heap (see GetResourceInfos())
+    struct ResourceInfo
+    {
+        static constexpr int MAX_NAME_LENGTH = 32;
+
+        char Name[MAX_NAME_LENGTH];
+        // Name of the heap for placed resources, otherwise the name up to the first 
+        // underscore (e.g. "GBuffer" for "GBuffer_Normal_0")
+        char Owner[MAX_NAME_LENGTH];
+        uint64_t SizeInBytes;
+        MEMORY_CATEGORY Category;
+        RESOURCE_KIND Kind;
+    };
+
+    struct OwnerInfo
+    {
+        char Name[ResourceInfo::MAX_NAME_LENGTH];
+        // Placed resources are excluded, their heap is counted instead
+        uint64_t SizeInBytes;
+        uint32_t NumResources;
+    };
+
+    // Usage of a fixed-size allocator (e.g. a descriptor heap). Units depend on the 
+    // allocator -- bytes, tiles or descriptors.
+    struct AllocatorInfo
+    {
+        const char* Name;
+        const char* Unit;
+        uint32_t Size;
+        uint32_t Free;
+        // Zero when unknown
+        uint32_t LargestFreeRegion;
+    };
+
+    // Invoked on a background thread once the copied data is available. Given memory is 
+    // only valid for the duration of the call.
+    using ReadbackCallback = fastdelegate::FastDelegate1<Util::Span<uint8_t>>;
+    // Zero is never returned for a valid readback
+    using ReadbackTicket = uint64_t;
+
     template<int N = 1>
     struct PlacedResourceList
     {
@@ -108,19 +215,86 @@ namespace ZetaRay::Core::GpuMemory
         {
             ID3D12Resource* Res;
             uint32_t Offset;
+            uint32_t Size;
             void* Mapped;
         };
 
+        // Block size is sizeInBytes scaled by how much arenas have actually used relative 
+        // to their requested size (see UploadStats::ArenaBlockScale), so that callers 
+        // that underestimate don't end up with an extra block every time. Allocations 
+        // that don't fit in a block get a dedicated one.
         explicit UploadHeapArena(uint32_t sizeInBytes);
         ~UploadHeapArena();
         UploadHeapArena(UploadHeapArena&& rhs);
 
         Util::Span<Block> Blocks() { return m_blocks; }
+        ZetaInline uint32_t BlockSize() const { return m_size; }
+        ZetaInline uint32_t RequestedSize() const { return m_requestedSize; }
+        // Including the alignment padding
+        ZetaInline uint64_t UsedBytes() const { return m_used; }
         Allocation SubAllocate(uint32_t size, uint32_t alignment = 1);
 
     private:
         Util::SmallVector<Block, Support::SystemAllocator, 4> m_blocks;
+        uint64_t m_used = 0;
         uint32_t m_size;
+        uint32_t m_requestedSize;
+    };
+
+    // Fixed-size upload ring for streaming large amounts of texture data through the copy 
+    // queue. Copies are submitted in batches as the ring fills up, while staging blocks 
+    // until the GPU has consumed enough of the ring, so upload memory never exceeds the 
+    // ring size no matter how much data goes through it. Thread-safe.
+    struct TextureUploadRing
+    {
+        explicit TextureUploadRing(uint32_t sizeInBytes);
+        ~TextureUploadRing();
+        TextureUploadRing(const TextureUploadRing&) = delete;
+        TextureUploadRing& operator=(const TextureUploadRing&) = delete;
+
+        // Stages subresources [firstSubresourceIndex, firstSubresourceIndex + subresources.size())
+        // and records the copies. Texture is expected to be in the COMMON state.
+        void UploadTexture(ID3D12Resource* texture, Util::Span<D3D12_SUBRESOURCE_DATA> subresources,
+            uint32_t firstSubresourceIndex = 0);
+        // Submits the pending copies. Given textures (which must have been uploaded through 
+        // this ring) are transitioned to the shader resource state once the copies have 
+        // finished. Must be called from a thread with a valid thread index.
+        void Flush(Util::Span<ID3D12Resource*> textures);
+
+    private:
+        struct Batch
+        {
+            uint64_t FenceVal;
+            uint32_t SizeInBytes;
+        };
+
+        // Both must be called with the lock held
+        void SubmitBatch();
+        void RetireOldestBatch();
+
+        ID3D12Resource* m_buffer = nullptr;
+        uint8_t* m_mapped = nullptr;
+        CopyCmdList* m_cmdList = nullptr;
+        HANDLE m_event;
+        SRWLOCK m_lock = SRWLOCK_INIT;
+        Util::SmallVector<Batch, Support::SystemAllocator, 8> m_inFlight;
+        uint64_t m_lastFenceVal = 0;
+        uint32_t m_size;
+        uint32_t m_head = 0;
+        // In-flight bytes (including the current batch); wrapped around when zero
+        uint32_t m_used = 0;
+        uint32_t m_batchSize = 0;
+    };
+
+    // Upload heap memory that is only valid until GPU has finished executing the frame 
+    // that it was allocated in (e.g. root CBVs and small per-frame buffers). Nothing needs
+    // to be released.
+    struct FrameUploadAllocation
+    {
+        ID3D12Resource* Res;
+        void* MappedMemory;
+        D3D12_GPU_VIRTUAL_ADDRESS GpuVA;
+        uint32_t Offset;
     };
 
     struct ReadbackHeapBuffer
@@ -173,7 +347,8 @@ namespace ZetaRay::Core::GpuMemory
         static constexpr ID_TYPE INVALID_ID = UINT32_MAX;
 
         Buffer() = default;
-        Buffer(const char* p, ID3D12Resource* r, RESOURCE_HEAP_TYPE heapType);
+        Buffer(const char* p, ID3D12Resource* r, RESOURCE_HEAP_TYPE heapType, 
+            void* mapped = nullptr);
         ~Buffer();
         Buffer(Buffer&&);
         Buffer& operator=(Buffer&&);
@@ -200,11 +375,21 @@ namespace ZetaRay::Core::GpuMemory
             Assert(m_resource, "Buffer hasn't been initialized.");
             return m_ID;
         }
+        // Only for buffers in GPU upload heaps, which stay mapped
+        ZetaInline void* MappedMemory() const
+        {
+            Assert(m_mapped, "Buffer isn't CPU-writable.");
+            return m_mapped;
+        }
 
     private:
         ID3D12Resource* m_resource = nullptr;
+        void* m_mapped = nullptr;
         ID_TYPE m_ID = INVALID_ID;
         RESOURCE_HEAP_TYPE m_heapType;
+        MEMORY_CATEGORY m_category = MEMORY_CATEGORY::BUFFER;
+        // Zero for placed resources
+        uint64_t m_trackedSize = 0;
     };
 
     struct Texture
@@ -245,12 +430,15 @@ namespace ZetaRay::Core::GpuMemory
         ID3D12Resource* m_resource = nullptr;
         ID_TYPE m_ID = INVALID_ID;
         RESOURCE_HEAP_TYPE m_heapType;
+        MEMORY_CATEGORY m_category = MEMORY_CATEGORY::TEXTURE;
+        // Zero for placed resources
+        uint64_t m_trackedSize = 0;
     };
 
     struct ResourceHeap
     {
         ResourceHeap() = default;
-        explicit ResourceHeap(ID3D12Heap* heap);
+        ResourceHeap(const char* name, ID3D12Heap* heap, uint64_t sizeInBytes, MEMORY_CATEGORY category);
         ~ResourceHeap();
         ResourceHeap(ResourceHeap&&);
         ResourceHeap& operator=(ResourceHeap&&);
@@ -265,6 +453,82 @@ namespace ZetaRay::Core::GpuMemory
 
     private:
         ID3D12Heap* m_heap = nullptr;
+        uint64_t m_sizeInBytes = 0;
+        MEMORY_CATEGORY m_category = MEMORY_CATEGORY::RENDER_TARGET;
+    };
+
+    // Texture without backing memory of its own -- its tiles (64 KB each) are mapped on 
+    // demand to tiles from a shared tile pool. Reads from unmapped tiles return zero. Mapping
+    // updates are issued on the copy queue, so uploads to newly-mapped tiles that are 
+    // submitted afterwards are ordered after them.
+    struct ReservedTexture
+    {
+        ReservedTexture() = default;
+        ReservedTexture(Texture::ID_TYPE id, ID3D12Resource* res, const char* dbgName = nullptr);
+        ~ReservedTexture();
+        ReservedTexture(ReservedTexture&&);
+        ReservedTexture& operator=(ReservedTexture&&);
+
+        // Unmaps all the tiles
+        void Reset();
+        ZetaInline bool IsInitialized() const { return m_resource != nullptr; }
+        ZetaInline ID3D12Resource* Resource()
+        {
+            Assert(m_resource, "Texture hasn't been initialized.");
+            return m_resource;
+        }
+        ZetaInline Texture::ID_TYPE ID() const { return m_ID; }
+        ZetaInline D3D12_RESOURCE_DESC Desc() const
+        {
+            Assert(m_resource, "Texture hasn't been initialized.");
+            return m_resource->GetDesc();
+        }
+        // Mips that are smaller than a tile are packed together and can only be mapped 
+        // as a whole
+        ZetaInline uint32_t NumStandardMips() const { return m_packedMipInfo.NumStandardMips; }
+        ZetaInline D3D12_TILE_SHAPE TileShape() const { return m_tileShape; }
+        ZetaInline D3D12_SUBRESOURCE_TILING MipTiling(uint32_t mip) const
+        {
+            Assert(mip < m_packedMipInfo.NumStandardMips, "Invalid mip.");
+            return m_mipTilings[mip];
+        }
+        ZetaInline bool IsTileMapped(uint32_t mip, uint32_t tileX, uint32_t tileY) const
+        {
+            return !m_tiles[TileIndex(mip, tileX, tileY)].IsEmpty();
+        }
+        ZetaInline bool ArePackedMipsMapped() const { return !m_packedMips.IsEmpty(); }
+        ZetaInline uint32_t NumMappedTiles() const { return m_numMappedTiles; }
+
+        // Maps tiles [tileX, tileX + numTilesX) x [tileY, tileY + numTilesY) of the given 
+        // standard mip. Tiles that are already mapped are skipped. Returns false when the tile
+        // pool doesn't have enough free tiles, in which case nothing is mapped.
+        bool MapTiles(uint32_t mip, uint32_t tileX, uint32_t tileY, uint32_t numTilesX, 
+            uint32_t numTilesY);
+        // Tiles are returned to the pool once the GPU has finished the current frame
+        void UnmapTiles(uint32_t mip, uint32_t tileX, uint32_t tileY, uint32_t numTilesX, 
+            uint32_t numTilesY);
+        bool MapPackedMips();
+        void UnmapPackedMips();
+
+    private:
+        ZetaInline uint32_t TileIndex(uint32_t mip, uint32_t tileX, uint32_t tileY) const
+        {
+            Assert(mip < m_packedMipInfo.NumStandardMips, "Invalid mip.");
+            Assert(tileX < m_mipTilings[mip].WidthInTiles && tileY < m_mipTilings[mip].HeightInTiles, 
+                "Tile is out of bounds.");
+            return m_mipTilings[mip].StartTileIndexInOverallResource + 
+                tileY * m_mipTilings[mip].WidthInTiles + tileX;
+        }
+
+        ID3D12Resource* m_resource = nullptr;
+        Texture::ID_TYPE m_ID = Texture::INVALID_ID;
+        D3D12_PACKED_MIP_INFO m_packedMipInfo = {};
+        D3D12_TILE_SHAPE m_tileShape = {};
+        D3D12_SUBRESOURCE_TILING m_mipTilings[D3D12_REQ_MIP_LEVELS];
+        // Tile pool allocation for every tile of the standard mips (empty when unmapped)
+        Util::SmallVector<Support::OffsetAllocator::Allocation> m_tiles;
+        Support::OffsetAllocator::Allocation m_packedMips = Support::OffsetAllocator::Allocation::Empty();
+        uint32_t m_numMappedTiles = 0;
     };
 
     //
@@ -283,13 +547,62 @@ namespace ZetaRay::Core::GpuMemory
     void ReleaseUploadHeapBuffer(UploadHeapBuffer& buffer);
     void ReleaseUploadHeapArena(UploadHeapArena& arena);
 
+    // Linear allocation from the current frame's upload ring -- each thread bumps a pointer
+    // into its own chunk, so this is lock-free except for claiming a new chunk. Must be 
+    // called from a thread with a valid thread index.
+    FrameUploadAllocation AllocateFrameUpload(uint32_t sizeInBytes, 
+        uint32_t alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+    // Budget is queried once per frame in Recycle(). Callbacks are invoked from there 
+    // whenever the pressure level changes.
+    VideoMemoryInfo GetVideoMemoryInfo();
+    void RegisterMemoryPressureCallback(MemoryPressureCallback dlg);
+    void UnregisterMemoryPressureCallback(MemoryPressureCallback dlg);
+    // When over budget, OS demotes the lower-priority objects to system memory first
+    void SetResidencyPriority(Util::Span<ID3D12Pageable*> objs, D3D12_RESIDENCY_PRIORITY priority);
+    // Uploads that can be deferred (e.g. texture streaming) should reserve their size 
+    // first and try again in a later frame when this returns false. Per-frame budget 
+    // grows while it's being used up and the copy queue keeps up, and is halved once 
+    // the copies of a frame take longer than a couple of frames to finish. First 
+    // reservation of every frame always succeeds, so that uploads larger than the 
+    // budget still make progress. Thread-safe.
+    bool ReserveUploadBytes(uint64_t sizeInBytes);
+    // Updated once per frame in Recycle()
+    UploadStats GetUploadStats();
+
+    // Snapshot of all the live buffers, textures and resource heaps, largest first. Upload 
+    // and readback memory (other than the shared heaps) and reserved textures aren't 
+    // included.
+    void GetResourceInfos(Util::Vector<ResourceInfo>& infos);
+    // Groups the resources returned by GetResourceInfos() by owner, largest first
+    void GetOwnerInfos(Util::Span<ResourceInfo> infos, Util::Vector<OwnerInfo>& owners);
+    void GetAllocatorInfos(Util::Vector<AllocatorInfo>& infos);
+    const char* GetMemoryCategoryName(MEMORY_CATEGORY category);
+    // Writes usage per category and per owner, followed by every resource and allocator, 
+    // as a text file. Also happens automatically when memory pressure becomes critical.
+    void WriteMemoryReport(const char* path);
+
     ReadbackHeapBuffer GetReadbackHeapBuffer(uint32_t sizeInBytes);
     void ReleaseReadbackHeapBuffer(ReadbackHeapBuffer& buffer);
 
+    // Records a copy of the given buffer region into (pooled) readback memory. Command list
+    // must be submitted in the current frame and the source has to be in a state that allows 
+    // copying. Callback is invoked once the GPU has finished the frame -- its target must 
+    // stay alive until then.
+    ReadbackTicket EnqueueReadback(CopyCmdList& cmdList, ID3D12Resource* srcBuffer, 
+        uint64_t srcOffsetInBytes, uint32_t sizeInBytes, ReadbackCallback dlg);
+    // Returns true once the GPU copy for the given ticket has finished. Callback might 
+    // still be pending.
+    bool IsReadbackComplete(ReadbackTicket ticket);
+
     Buffer GetDefaultHeapBuffer(const char* name, uint32_t sizeInBytes,
         D3D12_RESOURCE_STATES initialState, bool allowUAV, bool initToZero = false);
     Buffer GetDefaultHeapBuffer(const char* name, uint32_t sizeInBytes,
         bool isRtAs, bool allowUAV, bool initToZero = false);
+    // Buffer in video memory that CPU writes to directly (rather than through an upload 
+    // heap and a copy). Contents are undefined and it must not be written to while GPU 
+    // might be reading from it. Requires Renderer::IsGpuUploadHeapSupported().
+    Buffer GetGpuUploadHeapBuffer(const char* name, uint32_t sizeInBytes);
     Buffer GetPlacedHeapBuffer(const char* name, uint32_t sizeInBytes,
         ID3D12Heap* heap, uint64_t offsetInBytes, bool allowUAV, bool isRtAs);
     Buffer GetDefaultHeapBufferAndInit(const char* name,
@@ -306,12 +619,14 @@ namespace ZetaRay::Core::GpuMemory
         bool forceSeparateUploadBuffer = false);
     void UploadToDefaultHeapBuffer(Buffer& buffer, uint32_t sizeInBytes, 
         Util::MemoryRegion sourceData, uint32_t destOffsetInBytes = 0);
-    ResourceHeap GetResourceHeap(uint64_t sizeInBytes, 
+    ResourceHeap GetResourceHeap(const char* name, uint64_t sizeInBytes, 
+        MEMORY_CATEGORY category = MEMORY_CATEGORY::RENDER_TARGET,
         uint64_t alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
         bool createZeroed = false);
     void ReleaseDefaultHeapBuffer(Buffer& buffer);
     void ReleaseTexture(Texture& textue);
     void ReleaseResourceHeap(ResourceHeap& heap);
+    void ReleaseReservedTexture(ReservedTexture& texture);
 
     Texture GetTexture2D(const char* name, uint64_t width, uint32_t height, DXGI_FORMAT format,
         D3D12_RESOURCE_STATES initialState, uint32_t flags = 0, uint16_t mipLevels = 1,
@@ -331,6 +646,11 @@ namespace ZetaRay::Core::GpuMemory
     Texture GetTexture2D(Texture::ID_TYPE id, uint64_t width, uint32_t height, DXGI_FORMAT format,
         D3D12_BARRIER_LAYOUT initialLayout, uint32_t flags = 0, uint16_t mipLevels = 1,
         D3D12_CLEAR_VALUE* clearVal = nullptr, const char* dbgName = nullptr);
+    // Requires tiled resources tier 2. Tile pool is created on first use and is 
+    // shared by all reserved textures.
+    ReservedTexture GetReservedTexture2D(Texture::ID_TYPE id, uint64_t width, uint32_t height, 
+        DXGI_FORMAT format, D3D12_BARRIER_LAYOUT initialLayout, uint16_t mipLevels = 1, 
+        const char* dbgName = nullptr);
     Texture GetTexture3D(const char* name, uint64_t width, uint32_t height, uint16_t depth,
         DXGI_FORMAT format, D3D12_RESOURCE_STATES initialState,
         uint32_t flags = 0, uint16_t mipLevels = 1);
@@ -355,7 +675,7 @@ namespace ZetaRay::Core::GpuMemory
     Core::Direct3DUtil::LOAD_DDS_RESULT GetTexture2DFromDisk(const char* texPath,
         Texture::ID_TYPE ID, Texture& tex, UploadHeapArena& heapArena, Support::ArenaAllocator allocator);
     Core::Direct3DUtil::LOAD_DDS_RESULT GetDDSDataFromDisk(const char* texPath,
-        DDS_Data& dds, UploadHeapArena& heapArena, Support::ArenaAllocator allocator);
+        DDS_Data& dds, Support::ArenaAllocator allocator);
     Core::Direct3DUtil::LOAD_DDS_RESULT GetTexture3DFromDisk(const char* texPath,
         Texture& tex);
     Texture GetTexture2DAndInit(const char* name, uint64_t width, uint32_t height, DXGI_FORMAT format,
@@ -363,4 +683,11 @@ namespace ZetaRay::Core::GpuMemory
     Texture GetPlacedTexture2DAndInit(Texture::ID_TYPE ID, const D3D12_RESOURCE_DESC1& desc,
         ID3D12Heap* heap, uint64_t offsetInBytes, UploadHeapArena& heapArena,
         Util::Span<D3D12_SUBRESOURCE_DATA> subresources, const char* dbgName = nullptr);
+    Texture GetPlacedTexture2D(Texture::ID_TYPE ID, const D3D12_RESOURCE_DESC1& desc,
+        ID3D12Heap* heap, uint64_t offsetInBytes, D3D12_RESOURCE_STATES initialState,
+        const char* dbgName = nullptr);
+    // Uploads subresources [firstSubresourceIndex, firstSubresourceIndex + subresources.size()).
+    // Texture is expected to be in the COMMON state.
+    void UploadToTexture(Texture& tex, UploadHeapArena& heapArena,
+        Util::Span<D3D12_SUBRESOURCE_DATA> subresources, uint32_t firstSubresourceIndex);
 }
\ No newline at end of file
@@ -1,11 +1,13 @@
 #include "RendererCore.h"
 #include "CommandList.h"
 #include "../App/Timer.h"
+#include "../Support/TaskTimeline.h"
 
 using namespace ZetaRay;
 using namespace ZetaRay::Core;
 using namespace ZetaRay::Core::GpuMemory;
 using namespace ZetaRay::Util;
+using namespace ZetaRay::Support;
 
 void GpuTimer::Init()
 {
@@ -20,16 +22,25 @@ void GpuTimer::Init()
 
     D3D12_QUERY_HEAP_DESC desc{};
     desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
-    desc.Count = MAX_NUM_QUERIES * 2 * Constants::NUM_BACK_BUFFERS;
+    desc.Count = NUM_TIMESTAMP_QUERIES;
     desc.NodeMask = 0;
 
     auto* device = renderer.GetDevice();
-    CheckHR(device->CreateQueryHeap(&desc, IID_PPV_ARGS(m_queryHeap.GetAddressOf())));
+    for (int i = 0; i < QUEUE::NUM_QUEUES; i++)
+        CheckHR(device->CreateQueryHeap(&desc, IID_PPV_ARGS(m_queryHeaps[i].GetAddressOf())));
+
+    D3D12_QUERY_HEAP_DESC statsDesc{};
+    statsDesc.Type = D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS;
+    statsDesc.Count = MAX_NUM_QUERIES * Constants::NUM_BACK_BUFFERS;
+    statsDesc.NodeMask = 0;
+
+    CheckHR(device->CreateQueryHeap(&statsDesc, IID_PPV_ARGS(m_statsQueryHeap.GetAddressOf())));
 
     for (int i = 0; i < ZetaArrayLen(m_timings); i++)
         m_timings[i].resize(MAX_NUM_QUERIES);
 
-    m_readbackBuff = GpuMemory::GetReadbackHeapBuffer(sizeof(uint64_t) * desc.Count);
+    m_readbackBuff = GpuMemory::GetReadbackHeapBuffer(sizeof(uint64_t) * desc.Count * QUEUE::NUM_QUEUES + 
+        sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS) * statsDesc.Count);
 
 #ifndef NDEBUG
     m_readbackBuff.Resource()->SetName(L"Timing_Buffer");
@@ -90,22 +101,83 @@ void GpuTimer::BeginFrame()
 
             m_readbackBuff.Map();
             uint8_t* data = reinterpret_cast<uint8_t*>(m_readbackBuff.MappedMemory());
-
-            for (int i = 0; i < m_queryCounts[lastCompletedFrameIdx]; i++)
+            const uint8_t* stats = data + StatsReadbackOffset(lastCompletedFrameIdx);
+
+            // Sampled now rather than at startup, as the clocks may drift apart. Every queue 
+            // has its own clock, so timestamps from different queues are only comparable 
+            // after being converted to CPU time.
+            ClockCalibration calib[QUEUE::NUM_QUEUES];
+            calib[QUEUE::DIRECT].GpuFreq = (double)m_directQueueFreq;
+            calib[QUEUE::COMPUTE].GpuFreq = (double)m_computeQueueFreq;
+            App::GetRenderer().GetCommandQueueClockCalibration(D3D12_COMMAND_LIST_TYPE_DIRECT,
+                calib[QUEUE::DIRECT].GpuTimestamp, calib[QUEUE::DIRECT].CpuTimestamp);
+            App::GetRenderer().GetCommandQueueClockCalibration(D3D12_COMMAND_LIST_TYPE_COMPUTE,
+                calib[QUEUE::COMPUTE].GpuTimestamp, calib[QUEUE::COMPUTE].CpuTimestamp);
+
+            auto readTimestamp = [data](int queue, uint32_t heapIdx)
+                {
+                    uint64_t t;
+                    memcpy(&t, data + TimestampReadbackOffset(queue, heapIdx), sizeof(uint64_t));
+                    return t;
+                };
+
+            const int prevFrameIdx = lastCompletedFrameIdx > 0 ? lastCompletedFrameIdx - 1 :
+                Constants::NUM_BACK_BUFFERS - 1;
+            m_lastCompletion.FrameNum = m_frameNums[lastCompletedFrameIdx];
+            m_lastCompletion.CpuTicks = ToCpuTicks(readTimestamp(QUEUE::DIRECT, 
+                FRAME_END_QUERY_OFFSET + lastCompletedFrameIdx), calib[QUEUE::DIRECT]);
+            // Previous frame index has either finished earlier or hasn't been used yet
+            m_lastCompletion.PrevCpuTicks = m_frameNums[prevFrameIdx] + 1 == m_lastCompletion.FrameNum ?
+                ToCpuTicks(readTimestamp(QUEUE::DIRECT, FRAME_END_QUERY_OFFSET + prevFrameIdx), 
+                    calib[QUEUE::DIRECT]) : -1;
+
+            auto& timeline = App::GetTaskTimeline();
+            timeline.RecordGpu("Frame End", TaskTimeline::EVENT_TYPE::GPU_FRAME_END, 
+                TaskTimeline::GPU_QUEUE::DIRECT, m_lastCompletion.CpuTicks, m_lastCompletion.CpuTicks,
+                m_lastCompletion.FrameNum);
+
+            const int queryCount = m_queryCounts[lastCompletedFrameIdx];
+            auto& timings = m_timings[lastCompletedFrameIdx];
+            int64_t frameBeg = INT64_MAX;
+
+            for (int i = 0; i < queryCount; i++)
             {
-                uint8_t* currPtr = data + sizeof(uint64_t) * i * 2;
-                uint64_t beg, end;
+                Timing& t = timings[i];
+                const int queue = QueueIdx(t.ExecutionQueue);
+                const uint32_t heapIdx = MAX_NUM_QUERIES * 2 * lastCompletedFrameIdx + i * 2;
+                const uint64_t beg = readTimestamp(queue, heapIdx);
+                const uint64_t end = readTimestamp(queue, heapIdx + 1);
+
+                t.Delta = (end - beg) / calib[queue].GpuFreq;
+                // CPU ticks for now, converted to ms below
+                t.Begin = (double)ToCpuTicks(beg, calib[queue]);
+                t.End = (double)ToCpuTicks(end, calib[queue]);
+                frameBeg = Math::Min(frameBeg, (int64_t)t.Begin);
+
+                timeline.RecordGpu(t.Name, TaskTimeline::EVENT_TYPE::GPU, 
+                    queue == QUEUE::DIRECT ? TaskTimeline::GPU_QUEUE::DIRECT : TaskTimeline::GPU_QUEUE::COMPUTE,
+                    (int64_t)t.Begin, (int64_t)t.End, m_lastCompletion.FrameNum);
+
+                if (t.HasPipelineStats)
+                {
+                    memcpy(&t.PipelineStats, stats + sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS) * i, 
+                        sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS));
+                }
+            }
 
-                memcpy(&beg, currPtr, sizeof(uint64_t));
-                memcpy(&end, currPtr + sizeof(uint64_t), sizeof(uint64_t));
+            m_readbackBuff.Unmap();
+
+            const double cpuFreqMs = App::GetTimer().GetCounterFreq() / 1000.0;
 
-                uint64_t freq = 
-                    m_timings[lastCompletedFrameIdx][i].ExecutionQueue == D3D12_COMMAND_LIST_TYPE_DIRECT ?
-                    m_directQueueFreq : m_computeQueueFreq;
-                m_timings[lastCompletedFrameIdx][i].Delta = (end - beg) / (double)freq;
+            for (int i = 0; i < queryCount; i++)
+            {
+                Timing& t = timings[i];
+                t.Begin = (t.Begin - (double)frameBeg) / cpuFreqMs;
+                t.End = (t.End - (double)frameBeg) / cpuFreqMs;
             }
 
-            m_readbackBuff.Unmap();
+            if (queryCount)
+                UpdateAsyncComputeOverlap(Span(timings.data(), queryCount));
 
             if (m_queryCounts[lastCompletedFrameIdx])
             {
@@ -123,6 +195,7 @@ void GpuTimer::BeginFrame()
             }
 
             m_queryCounts[Constants::NUM_BACK_BUFFERS] = m_queryCounts[lastCompletedFrameIdx];
+            m_numResolvedFrames++;
         }
     }
 
@@ -130,7 +203,7 @@ void GpuTimer::BeginFrame()
     //    m_timings[m_currFrameIdx][i].Reset();
 }
 
-uint32_t GpuTimer::BeginQuery(ComputeCmdList& cmdList, const char* name)
+uint32_t GpuTimer::BeginQuery(ComputeCmdList& cmdList, const char* name, bool pipelineStats)
 {
     const uint32_t queryIdx = m_frameQueryCount.fetch_add(1, std::memory_order_relaxed);
     Assert(queryIdx < MAX_NUM_QUERIES, "Number of queries exceeded maximum allowed.");
@@ -139,11 +212,21 @@ uint32_t GpuTimer::BeginQuery(ComputeCmdList& cmdList, const char* name)
     memcpy(&m_timings[m_currFrameIdx][queryIdx].Name, name, n);
     m_timings[m_currFrameIdx][queryIdx].Name[n] = '\0';
     m_timings[m_currFrameIdx][queryIdx].Delta = 0.0;
+    m_timings[m_currFrameIdx][queryIdx].Begin = 0.0;
+    m_timings[m_currFrameIdx][queryIdx].End = 0.0;
     m_timings[m_currFrameIdx][queryIdx].ExecutionQueue = cmdList.GetType();
+    m_timings[m_currFrameIdx][queryIdx].HasPipelineStats = pipelineStats;
 
     const uint32_t heapIdx = MAX_NUM_QUERIES * 2 * m_currFrameIdx + queryIdx * 2;
     Assert((heapIdx & 0x1) == 0, "Invalid query index.");
-    cmdList.EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, heapIdx);
+    cmdList.EndQuery(m_queryHeaps[QueueIdx(cmdList.GetType())].Get(), D3D12_QUERY_TYPE_TIMESTAMP, 
+        heapIdx);
+
+    if (pipelineStats)
+    {
+        cmdList.BeginQuery(m_statsQueryHeap.Get(), D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 
+            MAX_NUM_QUERIES * m_currFrameIdx + queryIdx);
+    }
 
     return heapIdx;
 }
@@ -156,7 +239,18 @@ void GpuTimer::EndQuery(ComputeCmdList& cmdList, uint32_t begHeapIdx)
     Assert(endHeapIdx < MAX_NUM_QUERIES * 2 * Constants::NUM_BACK_BUFFERS, 
         "Invalid query index.");
 
-    cmdList.EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, endHeapIdx);
+    const uint32_t queryIdx = (begHeapIdx - MAX_NUM_QUERIES * 2 * m_currFrameIdx) / 2;
+    Assert(m_timings[m_currFrameIdx][queryIdx].ExecutionQueue == cmdList.GetType(),
+        "Query must begin and end on the same queue.");
+
+    cmdList.EndQuery(m_queryHeaps[QueueIdx(cmdList.GetType())].Get(), D3D12_QUERY_TYPE_TIMESTAMP, 
+        endHeapIdx);
+
+    if (m_timings[m_currFrameIdx][queryIdx].HasPipelineStats)
+    {
+        cmdList.EndQuery(m_statsQueryHeap.Get(), D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 
+            MAX_NUM_QUERIES * m_currFrameIdx + queryIdx);
+    }
 }
 
 void GpuTimer::EndFrame(ComputeCmdList& cmdList)
@@ -165,23 +259,157 @@ void GpuTimer::EndFrame(ComputeCmdList& cmdList)
         "Readback buffer shouldn't be mapped while in use by the GPU.");
     const int queryCount = m_frameQueryCount.load(std::memory_order_acquire);
     m_queryCounts[m_currFrameIdx] = queryCount;
+    m_frameNums[m_currFrameIdx] = App::GetTimer().GetTotalFrameCount();
 
-    if (queryCount == 0)
-        return;
+    cmdList.PIXBeginEvent("GpuTimer");
 
-    uint32_t heapStartIdx = m_currFrameIdx * MAX_NUM_QUERIES * 2;
-    uint64_t bufferOffsetBeg = heapStartIdx * sizeof(uint64_t);
+    // Called from the last render node, so this is (roughly) when GPU finishes the frame
+    const uint32_t frameEndIdx = FRAME_END_QUERY_OFFSET + m_currFrameIdx;
+    Assert(cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_DIRECT, 
+        "Frame end timestamp is expected on the direct queue.");
+    cmdList.EndQuery(m_queryHeaps[QUEUE::DIRECT].Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameEndIdx);
+    cmdList.ResolveQueryData(m_queryHeaps[QUEUE::DIRECT].Get(),
+        D3D12_QUERY_TYPE_TIMESTAMP,
+        frameEndIdx,
+        1,
+        m_readbackBuff.Resource(),
+        TimestampReadbackOffset(QUEUE::DIRECT, frameEndIdx));
 
-    cmdList.PIXBeginEvent("GpuTimer");
+    if (queryCount == 0)
+    {
+        cmdList.PIXEndEvent();
+        return;
+    }
 
-    cmdList.ResolveQueryData(m_queryHeap.Get(), 
-        D3D12_QUERY_TYPE_TIMESTAMP, 
-        heapStartIdx, 
-        queryCount * 2,
-        m_readbackBuff.Resource(), 
-        bufferOffsetBeg);
+    // Compute queue's queries are resolved here as well. Render graph ends the frame from 
+    // the last node, by which point all the async compute work has been waited on.
+    ResolveRuns(cmdList, m_queryHeaps[QUEUE::DIRECT].Get(), D3D12_QUERY_TYPE_TIMESTAMP, 
+        queryCount, false, QUEUE::DIRECT);
+    ResolveRuns(cmdList, m_queryHeaps[QUEUE::COMPUTE].Get(), D3D12_QUERY_TYPE_TIMESTAMP, 
+        queryCount, false, QUEUE::COMPUTE);
+    ResolveRuns(cmdList, m_statsQueryHeap.Get(), D3D12_QUERY_TYPE_PIPELINE_STATISTICS, 
+        queryCount, true, -1);
 
     cmdList.PIXEndEvent();
 
     m_frameQueryCount.store(0, std::memory_order_relaxed);
 }
+
+void GpuTimer::ResolveRuns(ComputeCmdList& cmdList, ID3D12QueryHeap* heap, D3D12_QUERY_TYPE type, 
+    int queryCount, bool stats, int queue)
+{
+    const auto& timings = m_timings[m_currFrameIdx];
+    auto isValid = [&timings, stats, queue](int i)
+        {
+            return stats ? timings[i].HasPipelineStats : 
+                QueueIdx(timings[i].ExecutionQueue) == queue;
+        };
+
+    int runBeg = 0;
+
+    while (runBeg < queryCount)
+    {
+        if (!isValid(runBeg))
+        {
+            runBeg++;
+            continue;
+        }
+
+        int runEnd = runBeg + 1;
+        while (runEnd < queryCount && isValid(runEnd))
+            runEnd++;
+
+        if (stats)
+        {
+            cmdList.ResolveQueryData(heap,
+                type,
+                MAX_NUM_QUERIES * m_currFrameIdx + runBeg,
+                runEnd - runBeg,
+                m_readbackBuff.Resource(),
+                StatsReadbackOffset(m_currFrameIdx) + sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS) * runBeg);
+        }
+        else
+        {
+            const uint32_t heapIdx = MAX_NUM_QUERIES * 2 * m_currFrameIdx + runBeg * 2;
+
+            cmdList.ResolveQueryData(heap,
+                type,
+                heapIdx,
+                (runEnd - runBeg) * 2,
+                m_readbackBuff.Resource(),
+                TimestampReadbackOffset(queue, heapIdx));
+        }
+
+        runBeg = runEnd;
+    }
+}
+
+int64_t GpuTimer::ToCpuTicks(uint64_t gpuTimestamp, const ClockCalibration& calib) const
+{
+    // Usually negative, work finished before calibration
+    const double deltaMs = ((double)gpuTimestamp - (double)calib.GpuTimestamp) / calib.GpuFreq;
+    const double cpuFreqMs = App::GetTimer().GetCounterFreq() / 1000.0;
+
+    return (int64_t)calib.CpuTimestamp + (int64_t)(deltaMs * cpuFreqMs);
+}
+
+void GpuTimer::UpdateAsyncComputeOverlap(Span<Timing> timings)
+{
+    struct Interval
+    {
+        double Beg;
+        double End;
+    };
+
+    Interval intervals[QUEUE::NUM_QUEUES][MAX_NUM_QUERIES];
+    int numIntervals[QUEUE::NUM_QUEUES] = { 0, 0 };
+
+    for (auto& t : timings)
+    {
+        const int queue = QueueIdx(t.ExecutionQueue);
+        intervals[queue][numIntervals[queue]++] = { t.Begin, t.End };
+    }
+
+    // Union of busy intervals per queue. Nested queries (e.g. a pass timed inside another) 
+    // are merged rather than counted twice.
+    for (int q = 0; q < QUEUE::NUM_QUEUES; q++)
+    {
+        Interval* curr = intervals[q];
+        std::sort(curr, curr + numIntervals[q], [](const Interval& i0, const Interval& i1)
+            {
+                return i0.Beg < i1.Beg;
+            });
+
+        int n = 0;
+        for (int i = 0; i < numIntervals[q]; i++)
+        {
+            if (n > 0 && curr[i].Beg <= curr[n - 1].End)
+                curr[n - 1].End = Math::Max(curr[n - 1].End, curr[i].End);
+            else
+                curr[n++] = curr[i];
+        }
+
+        numIntervals[q] = n;
+    }
+
+    // Intersection of the two (sorted and disjoint) sets
+    const Interval* direct = intervals[QUEUE::DIRECT];
+    const Interval* compute = intervals[QUEUE::COMPUTE];
+    int i = 0;
+    int j = 0;
+    double overlap = 0.0;
+
+    while (i < numIntervals[QUEUE::DIRECT] && j < numIntervals[QUEUE::COMPUTE])
+    {
+        const double beg = Math::Max(direct[i].Beg, compute[j].Beg);
+        const double end = Math::Min(direct[i].End, compute[j].End);
+        overlap += Math::Max(end - beg, 0.0);
+
+        if (direct[i].End < compute[j].End)
+            i++;
+        else
+            j++;
+    }
+
+    m_asyncComputeOverlap = overlap;
+}
\ No newline at end of file
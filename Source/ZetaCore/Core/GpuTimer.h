@@ -16,7 +16,23 @@ namespace ZetaRay::Core
 
             char Name[MAX_NAME_LENGTH];
             double Delta;
+            // Start and end (ms) on a timeline that is shared by all queues, relative to the 
+            // first query of the frame
+            double Begin;
+            double End;
             D3D12_COMMAND_LIST_TYPE ExecutionQueue;
+            // Only valid when HasPipelineStats is true
+            D3D12_QUERY_DATA_PIPELINE_STATISTICS PipelineStats;
+            bool HasPipelineStats;
+        };
+
+        // When the GPU finished a frame, in CPU (QueryPerformanceCounter) ticks
+        struct FrameCompletion
+        {
+            uint64_t FrameNum = UINT64_MAX;
+            int64_t CpuTicks;
+            // Frame before FrameNum, -1 when not available
+            int64_t PrevCpuTicks;
         };
 
         GpuTimer() = default;
@@ -28,9 +44,16 @@ namespace ZetaRay::Core
         void Init();
         void Shutdown();
         Util::Span<Timing> GetFrameTimings();
+        // Incremented every time GetFrameTimings() is updated with a newly completed frame
+        ZetaInline uint64_t GetNumResolvedFrames() const { return m_numResolvedFrames; }
+        // Last frame that GPU has finished, as of the last BeginFrame()
+        ZetaInline const FrameCompletion& GetLastFrameCompletion() const { return m_lastCompletion; }
+        // Time (ms) that direct and compute queues were both busy in the last resolved frame
+        ZetaInline double GetAsyncComputeOverlap() const { return m_asyncComputeOverlap; }
 
-        // Call before recording commands for a particular command list
-        uint32_t BeginQuery(ComputeCmdList& cmdList, const char* name);
+        // Call before recording commands for a particular command list. Pipeline statistics 
+        // queries can't span multiple command lists and shouldn't overlap.
+        uint32_t BeginQuery(ComputeCmdList& cmdList, const char* name, bool pipelineStats = false);
 
         // Call after all commands for a particular command list are recorded
         void EndQuery(ComputeCmdList& cmdList, uint32_t idx);
@@ -42,9 +65,57 @@ namespace ZetaRay::Core
         void EndFrame(ComputeCmdList& cmdList);
 
     private:
-        static constexpr uint32_t MAX_NUM_QUERIES = 32;
+        // Render graph may time every render node as well
+        static constexpr uint32_t MAX_NUM_QUERIES = 64;
+
+        // Query pairs for all frames are followed by one end-of-frame timestamp per frame 
+        // (direct queue only)
+        static constexpr uint32_t FRAME_END_QUERY_OFFSET = MAX_NUM_QUERIES * 2 * Constants::NUM_BACK_BUFFERS;
+        static constexpr uint32_t NUM_TIMESTAMP_QUERIES = FRAME_END_QUERY_OFFSET + Constants::NUM_BACK_BUFFERS;
+
+        // Each queue has its own timestamp heap, frequency and clock calibration
+        enum QUEUE
+        {
+            DIRECT,
+            COMPUTE,
+            NUM_QUEUES
+        };
+
+        ZetaInline static int QueueIdx(D3D12_COMMAND_LIST_TYPE t)
+        {
+            Assert(t == D3D12_COMMAND_LIST_TYPE_DIRECT || t == D3D12_COMMAND_LIST_TYPE_COMPUTE,
+                "Invalid command list type.");
+            return t == D3D12_COMMAND_LIST_TYPE_DIRECT ? QUEUE::DIRECT : QUEUE::COMPUTE;
+        }
+        ZetaInline static uint64_t TimestampReadbackOffset(int queue, uint32_t heapIdx)
+        {
+            return sizeof(uint64_t) * (NUM_TIMESTAMP_QUERIES * queue + heapIdx);
+        }
+        ZetaInline static uint64_t StatsReadbackOffset(int frameIdx)
+        {
+            return sizeof(uint64_t) * NUM_TIMESTAMP_QUERIES * QUEUE::NUM_QUEUES +
+                sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS) * MAX_NUM_QUERIES * frameIdx;
+        }
+
+        struct ClockCalibration
+        {
+            uint64_t GpuTimestamp;
+            uint64_t CpuTimestamp;
+            // Ticks/ms
+            double GpuFreq;
+        };
 
-        ComPtr<ID3D12QueryHeap> m_queryHeap;
+        // Converts a GPU timestamp from given queue to CPU (QueryPerformanceCounter) ticks
+        int64_t ToCpuTicks(uint64_t gpuTimestamp, const ClockCalibration& calib) const;
+        // Only the queries that were issued on the given queue (or had pipeline statistics 
+        // enabled) are valid, so they're resolved as consecutive runs
+        void ResolveRuns(ComputeCmdList& cmdList, ID3D12QueryHeap* heap, D3D12_QUERY_TYPE type, 
+            int queryCount, bool stats, int queue);
+        void UpdateAsyncComputeOverlap(Util::Span<Timing> timings);
+
+        ComPtr<ID3D12QueryHeap> m_queryHeaps[QUEUE::NUM_QUEUES];
+        ComPtr<ID3D12QueryHeap> m_statsQueryHeap;
+        // Timestamps for all frames (per queue), followed by pipeline statistics for all frames
         GpuMemory::ReadbackHeapBuffer m_readbackBuff;
 
         Util::SmallVector<Timing, Support::SystemAllocator, MAX_NUM_QUERIES> m_timings[Constants::NUM_BACK_BUFFERS + 1];
@@ -57,7 +128,12 @@ namespace ZetaRay::Core
         int m_currFrameIdx = 0;
         int m_nextCompletedFrameIdx = 0;
         uint64_t m_fenceVals[Constants::NUM_BACK_BUFFERS] = { 0 };
+        // App frame that each frame index was last used for
+        uint64_t m_frameNums[Constants::NUM_BACK_BUFFERS] = { 0 };
+        FrameCompletion m_lastCompletion;
+        double m_asyncComputeOverlap = 0.0;
         uint64_t m_nextFenceVal = 1;
+        uint64_t m_numResolvedFrames = 0;
         ComPtr<ID3D12Fence> m_fence;
     };
 }
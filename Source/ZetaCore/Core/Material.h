@@ -256,6 +256,11 @@ namespace ZetaRay
                 CoatColor_Flags &= ~(1 << FLAG_BITS::THIN_WALLED);
         }
 
+        ZetaInline ALPHA_MODE GetAlphaMode() const
+        {
+            return (ALPHA_MODE)((CoatColor_Flags >> FLAG_BITS::ALPHA_1) & 0x3);
+        }
+
         bool Emissive() const
         {
             if (GetEmissiveTex() != INVALID_ID)
@@ -1,10 +1,15 @@
 #include "PipelineStateLibrary.h"
 #include "RendererCore.h"
+#include "ShaderCompiler.h"
 #include "../App/Log.h"
+#include "../Math/Common.h"
 #include <App/Common.h>
 #include <App/Timer.h>
 #include <Support/Task.h>
+#include <Support/CpuEvent.h>
 #include <Scene/SceneCore.h>
+#include <xxHash/xxhash.h>
+#include <algorithm>
 
 using namespace ZetaRay;
 using namespace ZetaRay::Core;
@@ -31,20 +36,345 @@ namespace
     {
         CloseHandle(writePipe);
 
+        // Called from background threads, so frame allocator can't be used
         constexpr int MAX_TO_READ = 1024;
-        void* buffer = App::AllocateFrameAllocator(MAX_TO_READ, alignof(char));
+        char buffer[MAX_TO_READ + 1];
         DWORD numToRead;
         if (ReadFile(readPipe, buffer, MAX_TO_READ, &numToRead, nullptr))
         {
             if (numToRead)
             {
-                reinterpret_cast<char*>(buffer)[numToRead] = '\0';
-                App::Log(reinterpret_cast<char*>(buffer), App::LogMessage::WARNING);
+                buffer[numToRead] = '\0';
+                App::Log(buffer, App::LogMessage::WARNING);
             }
         }
 
         CloseHandle(readPipe);
     }
+
+    void CompileWithDXCExe(const char* hlslPath, Span<const char*> defines, const char* csoPath)
+    {
+        char defineArgs[256] = { '\0' };
+        int curr = 0;
+
+        for (auto d : defines)
+        {
+            curr += stbsp_snprintf(defineArgs + curr, (int)sizeof(defineArgs) - curr, " -D %s", d);
+            Check(curr < (int)sizeof(defineArgs), "Buffer size exceeded.");
+        }
+
+#if !defined(NDEBUG) && defined(HAS_DEBUG_SHADERS)
+        StackStr(cmdLine, n, "%s -T cs_6_7 -Fo %s -E main -Zi -Od -all_resources_bound -nologo -enable-16bit-types -Qembed_debug -Qstrip_reflect -WX -HV 202x%s %s", App::GetDXCPath(), csoPath, defineArgs, hlslPath);
+#else
+        StackStr(cmdLine, n, "%s -T cs_6_7 -Fo %s -E main -all_resources_bound -nologo -enable-16bit-types -Qstrip_reflect -WX -HV 202x%s %s", App::GetDXCPath(), csoPath, defineArgs, hlslPath);
+#endif
+
+        HANDLE readPipe;
+        HANDLE writePipe;
+        InitPipe(readPipe, writePipe);
+
+        PROCESS_INFORMATION pi;
+        STARTUPINFO si{};
+        si.cb = sizeof(si);
+        si.hStdOutput = writePipe;
+        si.hStdError = writePipe;
+        si.dwFlags = STARTF_USESTDHANDLES;
+        CheckWin32(CreateProcessA(nullptr, cmdLine, nullptr, nullptr, true, CREATE_NO_WINDOW, 
+            nullptr, nullptr, &si, &pi));
+
+        WaitForSingleObject(pi.hProcess, INFINITE);
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+
+        ReleasePipe(readPipe, writePipe);
+    }
+
+    // Compiles the given compute shader (path is relative to render pass directory) into 
+    // bytecode and writes it to disk so that the next run picks up the changes. Returns
+    // false on compile errors.
+    bool CompileShader(const char* pathToHlsl, Span<const char*> defines, const char* csoFilename,
+        SmallVector<uint8_t>& bytecode)
+    {
+        ZETA_CPU_EVENT_SCOPE("Shader::Compile %s", pathToHlsl);
+
+        Filesystem::Path hlsl(App::GetRenderPassDir());
+        hlsl.Append(pathToHlsl);
+        Assert(Filesystem::Exists(hlsl.Get()), "Path doesn't exist: %s", hlsl.Get());
+
+        Filesystem::Path csoPath(App::GetCompileShadersDir());
+        csoPath.Append(csoFilename);
+
+        if (ShaderCompiler::IsAvailable())
+        {
+            if (!ShaderCompiler::CompileComputeShader(hlsl.Get(), defines, bytecode))
+                return false;
+
+            Filesystem::WriteToFile(csoPath.Get(), bytecode.data(), (uint32_t)bytecode.size());
+        }
+        else
+        {
+            CompileWithDXCExe(hlsl.Get(), defines, csoPath.Get());
+
+            if (!Filesystem::Exists(csoPath.Get()))
+                return false;
+
+            Filesystem::LoadFromFile(csoPath.Get(), bytecode);
+        }
+
+        return true;
+    }
+
+    // Compiled shader -- either a view into the shader archive or loaded from its .cso file
+    // when archive doesn't have it (e.g. permutations that were compiled at runtime)
+    struct ShaderBlob
+    {
+        ZetaInline D3D12_SHADER_BYTECODE Bytecode() const
+        {
+            return D3D12_SHADER_BYTECODE{ .pShaderBytecode = Data.data(), 
+                .BytecodeLength = Data.size() };
+        }
+
+        Span<const uint8_t> Data = Span<const uint8_t>(nullptr, 0);
+        uint64_t Hash = 0;
+        SmallVector<uint8_t> Loaded;
+    };
+
+    void LoadShader(const char* csoFilename, ShaderBlob& blob)
+    {
+        if (App::GetRenderer().GetShaderArchive().Find(csoFilename, blob.Data, blob.Hash))
+            return;
+
+        Filesystem::Path csoPath(App::GetCompileShadersDir());
+        csoPath.Append(csoFilename);
+        Filesystem::LoadFromFile(csoPath.Get(), blob.Loaded);
+
+        blob.Data = Span<const uint8_t>(blob.Loaded.data(), blob.Loaded.size());
+        blob.Hash = ShaderArchive::HashBytecode(blob.Data);
+    }
+
+    // Permutation key -> defines
+    uint32_t GetPermutationDefines(const ShaderPermutationDesc& desc, uint32_t key, 
+        const char* (&defines)[ShaderPermutationDesc::MAX_NUM_DEFINES])
+    {
+        uint32_t n = 0;
+
+        for (uint32_t i = 0; i < desc.NumDefines; i++)
+        {
+            if (key & (1u << i))
+                defines[n++] = desc.Defines[i];
+        }
+
+        return n;
+    }
+
+    // Reductions and scans take fewer steps with wider waves, so the widest supported wave 
+    // size is used, e.g. 64 on AMD and 32 on NVIDIA. Wave size has to be in the device's
+    // [WaveLaneCountMin, WaveLaneCountMax] range for PSO creation to succeed either way.
+    uint32_t WaveSizePermutationBit(const ShaderPermutationDesc& desc)
+    {
+        if (desc.Wave64DefineIdx < 0)
+            return 0;
+
+        Assert((uint32_t)desc.Wave64DefineIdx < desc.NumDefines, "Invalid wave-size define index.");
+        const auto& renderer = App::GetRenderer();
+        const bool wave64 = renderer.GetWaveLaneCountMin() <= 64 && renderer.GetWaveLaneCountMax() >= 64;
+
+        return wave64 ? 1u << desc.Wave64DefineIdx : 0;
+    }
+
+    // <hlsl stem>[_<suffix> for every set bit]_cs.cso
+    void GetPermutationCsoFilename(const ShaderPermutationDesc& desc, uint32_t key,
+        MutableSpan<char> out)
+    {
+        Filesystem::Path hlsl(desc.PathToHlsl);
+        char stem[MAX_PATH];
+        hlsl.Stem(stem);
+
+        int curr = stbsp_snprintf(out.data(), (int)out.size(), "%s", stem);
+
+        for (uint32_t i = 0; i < desc.NumDefines; i++)
+        {
+            if (key & (1u << i))
+                curr += stbsp_snprintf(out.data() + curr, (int)out.size() - curr, "_%s", desc.Suffixes[i]);
+        }
+
+        curr += stbsp_snprintf(out.data() + curr, (int)out.size() - curr, "_cs.cso");
+        Check(curr < (int)out.size(), "Buffer size exceeded.");
+    }
+
+    struct QueuedPSO
+    {
+        static constexpr int MAX_NUM_INPUT_ELEMENTS = 8;
+
+        PipelineStateLibrary* Lib;
+        ID3D12RootSignature* RootSig;
+        // CS for compute, VS for graphics
+        const char* PathToCompiledShader;
+        // NULL for compute
+        const char* PathToCompiledPS;
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC GraphicsDesc;
+        D3D12_INPUT_ELEMENT_DESC InputElements[MAX_NUM_INPUT_ELEMENTS];
+        uint32_t Idx;
+        float BuildTimeMs;
+    };
+
+    struct ReloadedPSO
+    {
+        PipelineStateLibrary* Lib;
+        ID3D12PipelineState* PSO;
+        uint64_t Hash;
+        uint32_t Idx;
+        bool FlushGpu;
+    };
+
+    struct DeferredRequest
+    {
+        PipelineStateLibrary* Lib;
+        uint32_t Idx;
+    };
+
+    // PSO requests from all the render passes, so that they can be compiled together
+    // rather than one pass at a time
+    struct PSOQueue
+    {
+        SmallVector<QueuedPSO> Pending;
+        // Hot-reloaded PSOs that are waiting to replace the current ones
+        SmallVector<ReloadedPSO> Reloaded;
+        // Deferred PSOs that background task hasn't gotten to yet
+        SmallVector<DeferredRequest> Deferred;
+        // Whether there's a background task that's building the deferred PSOs
+        bool DeferredTaskRunning = false;
+        SRWLOCK Lock = SRWLOCK_INIT;
+    };
+
+    PSOQueue g_psoQueue;
+
+    // Precedes the serialized library in the cache file
+    struct CacheHeader
+    {
+        static constexpr uint32_t MAGIC = 0x43534f50;   // "PSOC"
+        static constexpr uint32_t VERSION = 2;
+
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t NumEntries;
+        uint32_t Pad;
+    };
+
+    // {6D1C8C61-4F0E-4C0B-9B4B-3E9F3A6E2D17}
+    static constexpr GUID ROOT_SIG_HASH_GUID = { 0x6d1c8c61, 0x4f0e, 0x4c0b,
+        { 0x9b, 0x4b, 0x3e, 0x9f, 0x3a, 0x6e, 0x2d, 0x17 } };
+
+    ZetaInline uint64_t GetRootSignatureHash(ID3D12RootSignature* rootSig)
+    {
+        uint64_t hash = 0;
+        UINT size = sizeof(hash);
+
+        // Untagged root signatures always hash to zero. Library still validates the root 
+        // signature on lookup, so worst case is a miss.
+        if (FAILED(rootSig->GetPrivateData(ROOT_SIG_HASH_GUID, &size, &hash)))
+            return 0;
+
+        return hash;
+    }
+
+    ZetaInline void GetPSOName(uint64_t hash, wchar_t (&name)[17])
+    {
+        StackStr(str, n, "%016llx", hash);
+        Common::CharToWideStr(str, name);
+    }
+
+    // Shaders are identified by the hash of their bytecode (see ShaderArchive::HashBytecode())
+    uint64_t HashComputePSO(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t csHash,
+        uint64_t driverVersion)
+    {
+        XXH3_state_t state;
+        XXH3_64bits_reset(&state);
+        XXH3_64bits_update(&state, &csHash, sizeof(csHash));
+
+        const uint64_t rootSigHash = GetRootSignatureHash(desc.pRootSignature);
+        XXH3_64bits_update(&state, &rootSigHash, sizeof(rootSigHash));
+        XXH3_64bits_update(&state, &desc.Flags, sizeof(desc.Flags));
+        XXH3_64bits_update(&state, &driverVersion, sizeof(driverVersion));
+
+        return XXH3_64bits_digest(&state);
+    }
+
+    uint64_t HashGraphicsPSO(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t vsHash,
+        uint64_t psHash, uint64_t driverVersion)
+    {
+        XXH3_state_t state;
+        XXH3_64bits_reset(&state);
+        XXH3_64bits_update(&state, &vsHash, sizeof(vsHash));
+        XXH3_64bits_update(&state, &psHash, sizeof(psHash));
+
+        const uint64_t rootSigHash = GetRootSignatureHash(desc.pRootSignature);
+        XXH3_64bits_update(&state, &rootSigHash, sizeof(rootSigHash));
+
+        // Hash the fixed-function state member by member, desc itself contains pointers
+        XXH3_64bits_update(&state, &desc.BlendState, sizeof(desc.BlendState));
+        XXH3_64bits_update(&state, &desc.SampleMask, sizeof(desc.SampleMask));
+        XXH3_64bits_update(&state, &desc.RasterizerState, sizeof(desc.RasterizerState));
+        XXH3_64bits_update(&state, &desc.DepthStencilState, sizeof(desc.DepthStencilState));
+        XXH3_64bits_update(&state, &desc.IBStripCutValue, sizeof(desc.IBStripCutValue));
+        XXH3_64bits_update(&state, &desc.PrimitiveTopologyType, sizeof(desc.PrimitiveTopologyType));
+        XXH3_64bits_update(&state, &desc.NumRenderTargets, sizeof(desc.NumRenderTargets));
+        XXH3_64bits_update(&state, desc.RTVFormats, sizeof(desc.RTVFormats));
+        XXH3_64bits_update(&state, &desc.DSVFormat, sizeof(desc.DSVFormat));
+        XXH3_64bits_update(&state, &desc.SampleDesc, sizeof(desc.SampleDesc));
+        XXH3_64bits_update(&state, &desc.Flags, sizeof(desc.Flags));
+
+        for (uint32_t i = 0; i < desc.InputLayout.NumElements; i++)
+        {
+            const D3D12_INPUT_ELEMENT_DESC& e = desc.InputLayout.pInputElementDescs[i];
+            XXH3_64bits_update(&state, e.SemanticName, strlen(e.SemanticName));
+            XXH3_64bits_update(&state, &e.SemanticIndex, sizeof(e.SemanticIndex));
+            XXH3_64bits_update(&state, &e.Format, sizeof(e.Format));
+            XXH3_64bits_update(&state, &e.InputSlot, sizeof(e.InputSlot));
+            XXH3_64bits_update(&state, &e.AlignedByteOffset, sizeof(e.AlignedByteOffset));
+            XXH3_64bits_update(&state, &e.InputSlotClass, sizeof(e.InputSlotClass));
+            XXH3_64bits_update(&state, &e.InstanceDataStepRate, sizeof(e.InstanceDataStepRate));
+        }
+
+        XXH3_64bits_update(&state, &driverVersion, sizeof(driverVersion));
+
+        return XXH3_64bits_digest(&state);
+    }
+
+    // Pipeline state stream subobject, same layout as CD3DX12_PIPELINE_STATE_STREAM_SUBOBJECT
+    template<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE Type, typename T>
+    struct alignas(void*) StreamSubobject
+    {
+        D3D12_PIPELINE_STATE_SUBOBJECT_TYPE SubobjType = Type;
+        T Inner;
+    };
+
+    struct MeshPSOStream
+    {
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_ROOT_SIGNATURE, ID3D12RootSignature*> RootSig;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_AS, D3D12_SHADER_BYTECODE> AS;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS, D3D12_SHADER_BYTECODE> MS;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS, D3D12_SHADER_BYTECODE> PS;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_BLEND, D3D12_BLEND_DESC> Blend;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_MASK, UINT> SampleMask;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER, D3D12_RASTERIZER_DESC> Rasterizer;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL, D3D12_DEPTH_STENCIL_DESC> DepthStencil;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PRIMITIVE_TOPOLOGY, D3D12_PRIMITIVE_TOPOLOGY_TYPE> Topology;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS, D3D12_RT_FORMAT_ARRAY> RTVFormats;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT, DXGI_FORMAT> DSVFormat;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_SAMPLE_DESC, DXGI_SAMPLE_DESC> SampleDesc;
+        StreamSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_FLAGS, D3D12_PIPELINE_STATE_FLAGS> Flags;
+    };
+
+    // Mesh shader takes the place of the vertex shader in the graphics desc. asHash is 
+    // ignored when there's no amplification shader.
+    uint64_t HashMeshPSO(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, 
+        const D3D12_SHADER_BYTECODE& as, uint64_t asHash, uint64_t msHash, uint64_t psHash,
+        uint64_t driverVersion)
+    {
+        const uint64_t hash = HashGraphicsPSO(desc, msHash, psHash, driverVersion);
+        return as.BytecodeLength ? XXH3_64bits_withSeed(&asHash, sizeof(asHash), hash) : hash;
+    }
 }
 
 //--------------------------------------------------------------------------------------
@@ -53,10 +383,14 @@ namespace
 
 PipelineStateLibrary::PipelineStateLibrary(MutableSpan<ID3D12PipelineState*> psoCache)
     : m_compiledPSOs(psoCache)
-{}
+{
+    m_psoHashes.resize(psoCache.size(), 0);
+    m_deferred.resize(psoCache.size());
+}
 
 PipelineStateLibrary::~PipelineStateLibrary()
 {
+    CancelDeferredPSOs();
     ClearAndFlushToDisk();
 }
 
@@ -66,17 +400,38 @@ void PipelineStateLibrary::Init(const char* name)
     m_psoLibPath1.Reset(App::GetPSOCacheDir());
     m_psoLibPath1.Append(filename);
 
-    m_foundOnDisk = Filesystem::Exists(m_psoLibPath1.Get()) && 
-        Filesystem::GetFileSize(m_psoLibPath1.Get()) > 0;
+    m_numEntriesOnDisk = 0;
+    m_numLoaded.store(0, std::memory_order_relaxed);
+    m_numStored.store(0, std::memory_order_relaxed);
+
+    // Part of every PSO hash, so that the entries from a different driver never match
+    LARGE_INTEGER umdVersion;
+    m_driverVersion = SUCCEEDED(App::GetRenderer().GetAdapter()->CheckInterfaceSupport(
+        __uuidof(IDXGIDevice), &umdVersion)) ? (uint64_t)umdVersion.QuadPart : 0;
+
+    const bool foundOnDisk = Filesystem::Exists(m_psoLibPath1.Get()) && 
+        Filesystem::GetFileSize(m_psoLibPath1.Get()) > sizeof(CacheHeader);
 
     // PSO cache exists on disk, reload it
-    if (m_foundOnDisk)
+    if (foundOnDisk)
     {
         Filesystem::LoadFromFile(m_psoLibPath1.Get(), m_cachedBlob);
 
+        CacheHeader header;
+        memcpy(&header, m_cachedBlob.data(), sizeof(header));
+
+        if (header.Magic != CacheHeader::MAGIC || header.Version != CacheHeader::VERSION)
+        {
+            LOG_UI_INFO("PSO cache %s is from an older version.\n", m_psoLibPath1.Get());
+            ResetToEmptyPsoLib();
+
+            return;
+        }
+
+        // Note: library doesn't make a copy, so blob has to stay alive while it's in use
         auto* device = App::GetRenderer().GetDevice();
-        HRESULT hr = device->CreatePipelineLibrary(m_cachedBlob.data(), m_cachedBlob.size(),
-            IID_PPV_ARGS(m_psoLibrary.GetAddressOf()));
+        HRESULT hr = device->CreatePipelineLibrary(m_cachedBlob.data() + sizeof(CacheHeader), 
+            m_cachedBlob.size() - sizeof(CacheHeader), IID_PPV_ARGS(m_psoLibrary.GetAddressOf()));
 
         if (FAILED(hr))
         {
@@ -94,6 +449,8 @@ void PipelineStateLibrary::Init(const char* name)
 
             ResetToEmptyPsoLib();
         }
+        else
+            m_numEntriesOnDisk = header.NumEntries;
     }
     else
         ResetToEmptyPsoLib();
@@ -101,10 +458,10 @@ void PipelineStateLibrary::Init(const char* name)
 
 void PipelineStateLibrary::Reset()
 {
+    CancelDeferredPSOs();
     ClearAndFlushToDisk();
     m_psoWasReset = false;
 
-    m_cachedBlob.free_memory();
     memset(m_compiledPSOs.data(), 0, m_compiledPSOs.size() * sizeof(ID3D12PipelineState*));
 }
 
@@ -117,61 +474,77 @@ void PipelineStateLibrary::ResetToEmptyPsoLib()
         CheckHR(device->CreatePipelineLibrary(nullptr, 0, 
             IID_PPV_ARGS(m_psoLibrary.ReleaseAndGetAddressOf())));
 
+        m_cachedBlob.free_memory();
+        m_numEntriesOnDisk = 0;
         m_psoWasReset = true;
     }
-
-    m_needsRebuild.store(true, std::memory_order_relaxed);
 }
 
 void PipelineStateLibrary::ClearAndFlushToDisk()
 {
-    // Needed when:
-    //  1. Cached library was invalid (e.g. driver mismatch)
-    //  2. One of the PSOs didn't match (e.g. modification after library was written to disk)
-    //  3. Shader hot-reload
-    if (m_needsRebuild.load(std::memory_order_relaxed))
+    if (m_psoLibrary)
     {
-        // Create an empty PSO and release the existing one
-        ResetToEmptyPsoLib();
-
-        if (m_foundOnDisk)
+        const uint32_t numLoaded = Math::Min(m_numLoaded.load(std::memory_order_relaxed), 
+            m_numEntriesOnDisk);
+        uint32_t numEntries = m_numEntriesOnDisk + m_numStored.load(std::memory_order_relaxed);
+        // Entries that weren't looked up this time are either stale (e.g. shader was 
+        // modified) or belong to PSOs that weren't needed (e.g. unused shader permutations)
+        const uint32_t numUnused = m_numEntriesOnDisk - numLoaded;
+        bool needsWrite = numEntries != m_numEntriesOnDisk;
+
+        // Library entries can't be removed one by one. Once the unused ones outnumber the 
+        // rest, evict them by storing the live PSOs in a new library.
+        if (numUnused > numEntries - numUnused)
         {
-            Filesystem::RemoveFile(m_psoLibPath1.Get());
-            m_cachedBlob.free_memory();
-            m_foundOnDisk = false;
-        }
+            auto* device = App::GetRenderer().GetDevice();
+            CheckHR(device->CreatePipelineLibrary(nullptr, 0, 
+                IID_PPV_ARGS(m_psoLibrary.ReleaseAndGetAddressOf())));
 
-        // Store all the compiled PSOs in the new library
-        for (int idx = 0; idx < (int)m_compiledPSOs.size(); idx++)
-        {
-            if (!m_compiledPSOs[idx])
-                continue;
+            numEntries = 0;
 
-            wchar_t nameWide[8];
-            StackStr(name, n, "%d", idx);
-            Common::CharToWideStr(name, nameWide);
+            for (int idx = 0; idx < (int)m_compiledPSOs.size(); idx++)
+            {
+                if (!m_compiledPSOs[idx])
+                    continue;
 
-            CheckHR(m_psoLibrary->StorePipeline(nameWide, m_compiledPSOs[idx]));
-        }
+                wchar_t nameWide[17];
+                GetPSOName(m_psoHashes[idx], nameWide);
 
-        m_needsRebuild.store(false, std::memory_order_relaxed);
-    }
+                // Same PSO may be in multiple slots
+                HRESULT hr = m_psoLibrary->StorePipeline(nameWide, m_compiledPSOs[idx]);
+                Check(SUCCEEDED(hr) || hr == E_INVALIDARG, "StorePipeline() failed with HRESULT %d", hr);
+                numEntries += SUCCEEDED(hr);
+            }
 
-    if (m_psoLibrary)
-    {
-        if (!m_foundOnDisk)
+            needsWrite = true;
+
+#if LOGGING == 1
+            LOG_UI_INFO("Evicted %u stale entries from PSO cache %s.", numUnused, m_psoLibPath1.Get());
+#endif
+        }
+
+        if (needsWrite)
         {
             const size_t serializedSize = m_psoLibrary->GetSerializedSize();
             Assert(serializedSize > 0, "Serialized size was invalid.");
-            uint8_t* psoLib = (uint8_t*)malloc(serializedSize);
+            uint8_t* psoLib = (uint8_t*)malloc(sizeof(CacheHeader) + serializedSize);
+
+            CacheHeader header{ .Magic = CacheHeader::MAGIC,
+                .Version = CacheHeader::VERSION,
+                .NumEntries = numEntries,
+                .Pad = 0 };
+            memcpy(psoLib, &header, sizeof(header));
 
-            CheckHR(m_psoLibrary->Serialize(psoLib, serializedSize));
-            Filesystem::WriteToFile(m_psoLibPath1.Get(), psoLib, (uint32_t)serializedSize);
+            CheckHR(m_psoLibrary->Serialize(psoLib + sizeof(CacheHeader), serializedSize));
+            Filesystem::WriteToFile(m_psoLibPath1.Get(), psoLib, 
+                (uint32_t)(sizeof(CacheHeader) + serializedSize));
 
             free(psoLib);
         }
 
+        // Release the library before the blob that it points to
         m_psoLibrary = nullptr;
+        m_cachedBlob.free_memory();
     }
 
     for (auto pso : m_compiledPSOs)
@@ -183,72 +556,242 @@ void PipelineStateLibrary::ClearAndFlushToDisk()
     }
 }
 
-void PipelineStateLibrary::Reload(uint64_t idx, ID3D12RootSignature* rootSig, 
-    const char* pathToHlsl, bool flushGpu)
+ID3D12PipelineState* PipelineStateLibrary::LoadComputeFromLibrary(uint64_t hash,
+    const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc)
 {
-    Filesystem::Path hlsl(App::GetRenderPassDir());
-    hlsl.Append(pathToHlsl);
-    Assert(Filesystem::Exists(hlsl.Get()), "Path doesn't exist: %s", hlsl.Get());
+    if (m_psoWasReset)
+        return nullptr;
 
-    char filename[MAX_PATH];
-    hlsl.Stem(filename);
+    wchar_t nameWide[17];
+    GetPSOName(hash, nameWide);
 
-    StackStr(csoFilename, N, "%s_cs.cso", filename);
-    Filesystem::Path csoPath(App::GetCompileShadersDir());
-    csoPath.Append(csoFilename);
+    // MS docs: "The pipeline library is thread-safe to use, and will internally synchronize 
+    // as necessary, with one exception: multiple threads loading the same PSO (via LoadComputePipeline, 
+    // LoadGraphicsPipeline, or LoadPipeline) should synchronize themselves, as this act may modify 
+    // the state of that pipeline within the library in a non-thread-safe manner."
+    ID3D12PipelineState* pso = nullptr;
+    HRESULT hr = m_psoLibrary->LoadComputePipeline(nameWide, &desc, IID_PPV_ARGS(&pso));
 
-#if !defined(NDEBUG) && defined(HAS_DEBUG_SHADERS)
-    StackStr(cmdLine, n, "%s -T cs_6_7 -Fo %s -E main -Zi -Od -all_resources_bound -nologo -enable-16bit-types -Qembed_debug -Qstrip_reflect -WX -HV 202x %s", App::GetDXCPath(), csoPath.Get(), hlsl.Get());
-#else
-    StackStr(cmdLine, n, "%s -T cs_6_7 -Fo %s -E main -all_resources_bound -nologo -enable-16bit-types -Qstrip_reflect -WX -HV 202x %s", App::GetDXCPath(), csoPath.Get(), hlsl.Get());
+    // A PSO with the specified name doesn’t exist, or the input desc doesn’t match the data in
+    // the library
+    if (FAILED(hr))
+    {
+        Check(hr == E_INVALIDARG, "LoadComputePipeline() failed with HRESULT %d", hr);
+        return nullptr;
+    }
+
+    m_numLoaded.fetch_add(1, std::memory_order_relaxed);
+
+    return pso;
+}
+
+ID3D12PipelineState* PipelineStateLibrary::LoadGraphicsFromLibrary(uint64_t hash,
+    const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    if (m_psoWasReset)
+        return nullptr;
+
+    wchar_t nameWide[17];
+    GetPSOName(hash, nameWide);
+
+    ID3D12PipelineState* pso = nullptr;
+    HRESULT hr = m_psoLibrary->LoadGraphicsPipeline(nameWide, &desc, IID_PPV_ARGS(&pso));
+
+    if (FAILED(hr))
+    {
+        Check(hr == E_INVALIDARG, "LoadGraphicsPipeline() failed with HRESULT %d", hr);
+        return nullptr;
+    }
+
+    m_numLoaded.fetch_add(1, std::memory_order_relaxed);
+
+    return pso;
+}
+
+ID3D12PipelineState* PipelineStateLibrary::LoadStreamFromLibrary(uint64_t hash,
+    const D3D12_PIPELINE_STATE_STREAM_DESC& desc)
+{
+    if (m_psoWasReset)
+        return nullptr;
+
+    ComPtr<ID3D12PipelineLibrary1> psoLibrary1;
+    if (FAILED(m_psoLibrary.As(&psoLibrary1)))
+        return nullptr;
+
+    wchar_t nameWide[17];
+    GetPSOName(hash, nameWide);
+
+    ID3D12PipelineState* pso = nullptr;
+    HRESULT hr = psoLibrary1->LoadPipeline(nameWide, &desc, IID_PPV_ARGS(&pso));
+
+    if (FAILED(hr))
+    {
+        Check(hr == E_INVALIDARG, "LoadPipeline() failed with HRESULT %d", hr);
+        return nullptr;
+    }
+
+    m_numLoaded.fetch_add(1, std::memory_order_relaxed);
+
+    return pso;
+}
+
+void PipelineStateLibrary::StoreInLibrary(uint64_t hash, ID3D12PipelineState* pso)
+{
+    wchar_t nameWide[17];
+    GetPSOName(hash, nameWide);
+
+    // Appended to the existing entries, E_INVALIDARG means another slot (or thread) has 
+    // already stored an identical PSO
+    HRESULT hr = m_psoLibrary->StorePipeline(nameWide, pso);
+    Check(SUCCEEDED(hr) || hr == E_INVALIDARG, "StorePipeline() failed with HRESULT %d", hr);
+
+    if (SUCCEEDED(hr))
+        m_numStored.fetch_add(1, std::memory_order_relaxed);
+}
+
+ID3D12PipelineState* PipelineStateLibrary::LoadOrCreateComputePSO(uint64_t hash,
+    const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const char* nameForLog)
+{
+    ID3D12PipelineState* pso = LoadComputeFromLibrary(hash, desc);
+
+    // Missing or stale -- compile the PSO and then store it in the library for next time
+    if (!pso)
+    {
+        ZETA_CPU_EVENT_SCOPE("PSO::Compile %s", nameForLog ? nameForLog : "");
+
+#if LOGGING == 1
+        App::DeltaTimer timer;
+        timer.Start();
 #endif
 
+        auto* device = App::GetRenderer().GetDevice();
+        CheckHR(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso)));
+        StoreInLibrary(hash, pso);
+
 #if LOGGING == 1
-    App::DeltaTimer timer;
-    timer.Start();
+        timer.End();
+        if (nameForLog)
+            LOG_UI_INFO("Compiled shader %s in %u [ms].", nameForLog, (uint32_t)timer.DeltaMilli());
 #endif
+    }
 
-    HANDLE readPipe;
-    HANDLE writePipe;
-    InitPipe(readPipe, writePipe);
+    return pso;
+}
 
-    PROCESS_INFORMATION pi;
-    STARTUPINFO si{};
-    si.cb = sizeof(si);
-    si.hStdOutput = writePipe;
-    si.hStdError = writePipe;
-    si.dwFlags = STARTF_USESTDHANDLES;
-    CheckWin32(CreateProcessA(nullptr, cmdLine, nullptr, nullptr, true, CREATE_NO_WINDOW, 
-        nullptr, nullptr, &si, &pi));
+void PipelineStateLibrary::TagRootSignature(ID3D12RootSignature* rootSig, const void* serialized,
+    size_t size)
+{
+    const uint64_t hash = XXH3_64bits(serialized, size);
+    CheckHR(rootSig->SetPrivateData(ROOT_SIG_HASH_GUID, sizeof(hash), &hash));
+}
 
-    WaitForSingleObject(pi.hProcess, INFINITE);
-    CloseHandle(pi.hThread);
-    CloseHandle(pi.hProcess);
+void PipelineStateLibrary::Reload(uint64_t idx, ID3D12RootSignature* rootSig, 
+    const char* pathToHlsl, bool flushGpu)
+{
+    Assert(m_compiledPSOs[idx], "Reload was called for a shader that hasn't been loaded yet.");
+    const uint32_t psoIdx = (uint32_t)idx;
 
-    ReleasePipe(readPipe, writePipe);
+    // Compile in the background, the new PSO is swapped in by the next BuildQueuedPSOs() call
+    Task t("ReloadShader", TASK_PRIORITY::BACKGROUND, [this, rootSig, pathToHlsl, psoIdx, flushGpu]()
+        {
+            Filesystem::Path hlsl(pathToHlsl);
+            char filename[MAX_PATH];
+            hlsl.Stem(filename);
+
+            StackStr(csoFilename, N, "%s_cs.cso", filename);
+            ReloadCompiled(psoIdx, rootSig, pathToHlsl, Span<const char*>(nullptr, 0), 
+                csoFilename, flushGpu);
+        });
+
+    App::SubmitBackground(ZetaMove(t));
+}
+
+void PipelineStateLibrary::ReloadPermutations(uint32_t baseIdx, ID3D12RootSignature* rootSig,
+    const ShaderPermutationDesc& desc, bool flushGpu)
+{
+    // Permutations that haven't been used so far are compiled on their first use anyway
+    for (uint32_t key = 0; key < desc.NumPermutations(); key++)
+    {
+        if (!m_compiledPSOs[baseIdx + key])
+            continue;
+
+        // Keep the captures within Function's inline storage
+        const uint16_t psoIdx = (uint16_t)(baseIdx + key);
+        const uint16_t permutationKey = (uint16_t)key;
+        const ShaderPermutationDesc* pDesc = &desc;
+
+        Task t("ReloadShader", TASK_PRIORITY::BACKGROUND, [this, rootSig, pDesc, psoIdx, 
+            permutationKey, flushGpu]()
+            {
+                const char* defines[ShaderPermutationDesc::MAX_NUM_DEFINES];
+                const uint32_t numDefines = GetPermutationDefines(*pDesc, permutationKey, defines);
+
+                char csoFilename[MAX_PATH];
+                GetPermutationCsoFilename(*pDesc, permutationKey, csoFilename);
+
+                ReloadCompiled(psoIdx, rootSig, pDesc->PathToHlsl, 
+                    Span<const char*>(defines, numDefines), csoFilename, flushGpu);
+            });
+
+        App::SubmitBackground(ZetaMove(t));
+    }
+}
+
+void PipelineStateLibrary::ReloadCompiled(uint32_t idx, ID3D12RootSignature* rootSig,
+    const char* pathToHlsl, Span<const char*> defines, const char* csoFilename, bool flushGpu)
+{
+#if LOGGING == 1
+    App::DeltaTimer timer;
+    timer.Start();
+#endif
 
-    // Recreate the PSO
     SmallVector<uint8_t> bytecode;
-    Filesystem::LoadFromFile(csoPath.Get(), bytecode);
+
+    // Leave the previous PSO in place until the errors are fixed
+    if (!CompileShader(pathToHlsl, defines, csoFilename, bytecode))
+    {
+        LOG_UI_WARNING("Reloading shader %s failed.", csoFilename);
+        return;
+    }
 
     D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
     desc.pRootSignature = rootSig;
     desc.CS.BytecodeLength = bytecode.size();
     desc.CS.pShaderBytecode = bytecode.data();
 
-    auto* device = App::GetRenderer().GetDevice();
-    ID3D12PipelineState* pso = nullptr;
-    CheckHR(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso)));
+    // Shader might not have changed since it was last stored
+    const uint64_t csHash = ShaderArchive::HashBytecode(Span<const uint8_t>(bytecode.data(), 
+        bytecode.size()));
+    const uint64_t hash = HashComputePSO(desc, csHash, m_driverVersion);
+    ID3D12PipelineState* pso = LoadOrCreateComputePSO(hash, desc, nullptr);
 
 #if LOGGING == 1
     timer.End();
-    LOG_UI_INFO("Reloaded shader %s in %u [ms].", pathToHlsl, (uint32_t)timer.DeltaMilli());
+    LOG_UI_INFO("Reloaded shader %s in %u [ms].", csoFilename, (uint32_t)timer.DeltaMilli());
 #endif
 
-    m_needsRebuild.store(true, std::memory_order_relaxed);
+    ReloadedPSO reloaded{ .Lib = this,
+        .PSO = pso,
+        .Hash = hash,
+        .Idx = idx,
+        .FlushGpu = flushGpu };
+
+    AcquireSRWLockExclusive(&g_psoQueue.Lock);
+    g_psoQueue.Reloaded.push_back(reloaded);
+    ReleaseSRWLockExclusive(&g_psoQueue.Lock);
+}
 
+void PipelineStateLibrary::SwapReloadedPSO(uint32_t idx, ID3D12PipelineState* pso, 
+    uint64_t hash, bool flushGpu)
+{
     ID3D12PipelineState* oldPSO = m_compiledPSOs[idx];
-    Assert(oldPSO, "Reload was called for a shader that hasn't been loaded yet.");
+
+    // Library was reset while the shader was being compiled
+    if (!oldPSO)
+    {
+        pso->Release();
+        return;
+    }
 
     // GPU has to be finished with the old PSO before it can be released
     if (flushGpu)
@@ -286,6 +829,7 @@ void PipelineStateLibrary::Reload(uint64_t idx, ID3D12RootSignature* rootSig,
 
     // Replace the old PSO
     m_compiledPSOs[idx] = pso;
+    m_psoHashes[idx] = hash;
     
     App::GetScene().SceneModified();
 }
@@ -295,144 +839,137 @@ ID3D12PipelineState* PipelineStateLibrary::CompileGraphicsPSO(uint32_t idx,
     const char* pathToCompiledVS,
     const char* pathToCompiledPS)
 {
-    SmallVector<uint8_t> vsBytecode;
-    SmallVector<uint8_t> psBytecode;
-
-    {
-        Filesystem::Path pVs(App::GetCompileShadersDir());
-        pVs.Append(pathToCompiledVS);
-        Filesystem::LoadFromFile(pVs.Get(), vsBytecode);
-    }
-
-    {
-        Filesystem::Path pPs(App::GetCompileShadersDir());
-        pPs.Append(pathToCompiledPS);
-        Filesystem::LoadFromFile(pPs.Get(), psBytecode);
-    }
+    ShaderBlob vs;
+    ShaderBlob ps;
+    LoadShader(pathToCompiledVS, vs);
+    LoadShader(pathToCompiledPS, ps);
 
-    psoDesc.VS.BytecodeLength = vsBytecode.size();
-    psoDesc.VS.pShaderBytecode = vsBytecode.data();
-    psoDesc.PS.BytecodeLength = psBytecode.size();
-    psoDesc.PS.pShaderBytecode = psBytecode.data();
+    psoDesc.VS = vs.Bytecode();
+    psoDesc.PS = ps.Bytecode();
     psoDesc.pRootSignature = rootSig;
 
-    wchar_t nameWide[8];
-    StackStr(name, n, "%u", idx);
-    Common::CharToWideStr(name, nameWide);
+    const uint64_t hash = HashGraphicsPSO(psoDesc, vs.Hash, ps.Hash, m_driverVersion);
+    ID3D12PipelineState* pso = LoadGraphicsFromLibrary(hash, psoDesc);
 
-    ID3D12PipelineState* pso = nullptr;
-    HRESULT hr = m_psoWasReset ? E_INVALIDARG :
-        m_psoLibrary->LoadGraphicsPipeline(nameWide, &psoDesc, IID_PPV_ARGS(&pso));
-
-    if (hr == E_INVALIDARG)
+    if (!pso)
     {
-        m_needsRebuild.store(true, std::memory_order_relaxed);
+        ZETA_CPU_EVENT_SCOPE("PSO::Compile %s", pathToCompiledPS);
 
         auto* device = App::GetRenderer().GetDevice();
         CheckHR(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)));
+        StoreInLibrary(hash, pso);
     }
 
+    // May be called from multiple threads when building the queued PSOs
+    AcquireSRWLockExclusive(&m_mapLock);
     Assert(m_compiledPSOs[idx] == nullptr, "It's assumed that every PSO is loaded at most one time.");
     m_compiledPSOs[idx] = pso;
+    m_psoHashes[idx] = hash;
+    ReleaseSRWLockExclusive(&m_mapLock);
 
     return pso;
 }
 
-ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO(uint32_t idx, 
-    ID3D12RootSignature* rootSig, const char* pathToCompiledCS)
+ID3D12PipelineState* PipelineStateLibrary::CompileMeshPSO(uint32_t idx,
+    const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc, ID3D12RootSignature* rootSig,
+    const char* pathToCompiledAS,
+    const char* pathToCompiledMS,
+    const char* pathToCompiledPS)
 {
-    Filesystem::Path pCs(App::GetCompileShadersDir());
-    pCs.Append(pathToCompiledCS);
+    ShaderBlob asBlob;
+    ShaderBlob ms;
+    ShaderBlob ps;
 
-    SmallVector<uint8_t> bytecode;
-    Filesystem::LoadFromFile(pCs.Get(), bytecode);
-
-    D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
-    desc.pRootSignature = rootSig;
-    desc.CS.BytecodeLength = bytecode.size();
-    desc.CS.pShaderBytecode = bytecode.data();
+    if (pathToCompiledAS)
+        LoadShader(pathToCompiledAS, asBlob);
 
-    wchar_t nameWide[8];
-    StackStr(name, n, "%u", idx);
-    Common::CharToWideStr(name, nameWide);
+    LoadShader(pathToCompiledMS, ms);
+    LoadShader(pathToCompiledPS, ps);
 
-    ID3D12PipelineState* pso = nullptr;
-    HRESULT hr = m_psoWasReset ? E_INVALIDARG :
-        m_psoLibrary->LoadComputePipeline(nameWide, &desc, IID_PPV_ARGS(&pso));
-
-    if (hr == E_INVALIDARG)
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = psoDesc;
+    desc.InputLayout = D3D12_INPUT_LAYOUT_DESC{ .pInputElementDescs = nullptr, .NumElements = 0 };
+    desc.VS = ms.Bytecode();
+    desc.PS = ps.Bytecode();
+    desc.pRootSignature = rootSig;
+    const D3D12_SHADER_BYTECODE as = asBlob.Bytecode();
+
+    MeshPSOStream stream;
+    stream.RootSig.Inner = rootSig;
+    stream.AS.Inner = as;
+    stream.MS.Inner = desc.VS;
+    stream.PS.Inner = desc.PS;
+    stream.Blend.Inner = desc.BlendState;
+    stream.SampleMask.Inner = desc.SampleMask;
+    stream.Rasterizer.Inner = desc.RasterizerState;
+    stream.DepthStencil.Inner = desc.DepthStencilState;
+    stream.Topology.Inner = desc.PrimitiveTopologyType;
+    stream.RTVFormats.Inner.NumRenderTargets = desc.NumRenderTargets;
+    memcpy(stream.RTVFormats.Inner.RTFormats, desc.RTVFormats, sizeof(desc.RTVFormats));
+    stream.DSVFormat.Inner = desc.DSVFormat;
+    stream.SampleDesc.Inner = desc.SampleDesc;
+    stream.Flags.Inner = desc.Flags;
+
+    const D3D12_PIPELINE_STATE_STREAM_DESC streamDesc{ .SizeInBytes = sizeof(stream), 
+        .pPipelineStateSubobjectStream = &stream };
+
+    const uint64_t hash = HashMeshPSO(desc, as, asBlob.Hash, ms.Hash, ps.Hash, m_driverVersion);
+    ID3D12PipelineState* pso = LoadStreamFromLibrary(hash, streamDesc);
+
+    if (!pso)
     {
-        m_needsRebuild.store(true, std::memory_order_relaxed);
-
-#if LOGGING == 1
-        App::DeltaTimer timer;
-        timer.Start();
-#endif
+        ZETA_CPU_EVENT_SCOPE("PSO::Compile %s", pathToCompiledMS);
 
         auto* device = App::GetRenderer().GetDevice();
-        CheckHR(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso)));
-
-#if LOGGING == 1
-        timer.End();
-        LOG_UI_INFO("Compiled shader %s in %u [ms].", pathToCompiledCS, (uint32_t)timer.DeltaMilli());
-#endif
+        CheckHR(device->CreatePipelineState(&streamDesc, IID_PPV_ARGS(&pso)));
+        StoreInLibrary(hash, pso);
     }
 
+    AcquireSRWLockExclusive(&m_mapLock);
     Assert(m_compiledPSOs[idx] == nullptr, "It's assumed that every PSO is loaded at most one time.");
     m_compiledPSOs[idx] = pso;
+    m_psoHashes[idx] = hash;
+    ReleaseSRWLockExclusive(&m_mapLock);
 
     return pso;
 }
 
-ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO_MT(uint32_t idx, 
+ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO(uint32_t idx, 
     ID3D12RootSignature* rootSig, const char* pathToCompiledCS)
 {
-    Filesystem::Path pCs(App::GetCompileShadersDir());
-    pCs.Append(pathToCompiledCS);
-
-    SmallVector<uint8_t> bytecode;
-    Filesystem::LoadFromFile(pCs.Get(), bytecode);
+    ShaderBlob cs;
+    LoadShader(pathToCompiledCS, cs);
 
     D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
     desc.pRootSignature = rootSig;
-    desc.CS.BytecodeLength = bytecode.size();
-    desc.CS.pShaderBytecode = bytecode.data();
+    desc.CS = cs.Bytecode();
 
-    wchar_t nameWide[8];
-    StackStr(name, n, "%u", idx);
-    Common::CharToWideStr(name, nameWide);
+    const uint64_t hash = HashComputePSO(desc, cs.Hash, m_driverVersion);
+    ID3D12PipelineState* pso = LoadOrCreateComputePSO(hash, desc, pathToCompiledCS);
 
-    // MS docs: "The pipeline library is thread-safe to use, and will internally synchronize 
-    // as necessary, with one exception: multiple threads loading the same PSO (via LoadComputePipeline, 
-    // LoadGraphicsPipeline, or LoadPipeline) should synchronize themselves, as this act may modify 
-    // the state of that pipeline within the library in a non-thread-safe manner."
-    ID3D12PipelineState* pso = nullptr;
-    HRESULT hr = m_psoWasReset ? E_INVALIDARG :
-        m_psoLibrary->LoadComputePipeline(nameWide, &desc, IID_PPV_ARGS(&pso));
+    Assert(m_compiledPSOs[idx] == nullptr, "It's assumed that every PSO is loaded at most one time.");
+    m_compiledPSOs[idx] = pso;
+    m_psoHashes[idx] = hash;
 
-    // A PSO with the specified name doesn’t exist, or the input desc doesn’t match the data in
-    // the library. Compile the PSO and then store it in the library for next time.
-    if (hr == E_INVALIDARG)
-    {
-        // If some PSO is modified or not found, then the PSO library needs to be recreated.
-        m_needsRebuild.store(true, std::memory_order_relaxed);
+    return pso;
+}
 
-        auto* device = App::GetRenderer().GetDevice();
-#if LOGGING == 1
-        App::DeltaTimer timer;
-        timer.Start();
-#endif
-        CheckHR(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso)));
+ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO_MT(uint32_t idx, 
+    ID3D12RootSignature* rootSig, const char* pathToCompiledCS)
+{
+    ShaderBlob cs;
+    LoadShader(pathToCompiledCS, cs);
 
-#if LOGGING == 1
-        timer.End();
-        LOG_UI_INFO("Compiled shader %s in %u [ms].", pathToCompiledCS, (uint32_t)timer.DeltaMilli());
-#endif
-    }
+    D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
+    desc.pRootSignature = rootSig;
+    desc.CS = cs.Bytecode();
+
+    const uint64_t hash = HashComputePSO(desc, cs.Hash, m_driverVersion);
+    ID3D12PipelineState* pso = LoadOrCreateComputePSO(hash, desc, pathToCompiledCS);
 
     AcquireSRWLockExclusive(&m_mapLock);
     Assert(m_compiledPSOs[idx] == nullptr, "It's assumed that every PSO is loaded at most one time.");
     m_compiledPSOs[idx] = pso;
+    m_psoHashes[idx] = hash;
     ReleaseSRWLockExclusive(&m_mapLock);
 
     return pso;
@@ -446,24 +983,321 @@ ID3D12PipelineState* PipelineStateLibrary::CompileComputePSO(uint32_t idx,
     desc.CS.BytecodeLength = compiledBlob.size();
     desc.CS.pShaderBytecode = compiledBlob.data();
 
-    wchar_t nameWide[8];
-    StackStr(name, n, "%u", idx);
-    Common::CharToWideStr(name, nameWide);
+    const uint64_t hash = HashComputePSO(desc, ShaderArchive::HashBytecode(compiledBlob), 
+        m_driverVersion);
+    ID3D12PipelineState* pso = LoadOrCreateComputePSO(hash, desc, nullptr);
 
-    ID3D12PipelineState* pso = nullptr;
-    HRESULT hr = m_psoWasReset ? E_INVALIDARG : 
-        m_psoLibrary->LoadComputePipeline(nameWide, &desc, IID_PPV_ARGS(&pso));
+    Assert(m_compiledPSOs[idx] == nullptr, "It's assumed that every PSO is loaded at most one time.");
+    m_compiledPSOs[idx] = pso;
+    m_psoHashes[idx] = hash;
+
+    return pso;
+}
+
+void PipelineStateLibrary::EnqueueComputePSO(uint32_t idx, ID3D12RootSignature* rootSig,
+    const char* pathToCompiledCS)
+{
+    QueuedPSO pso;
+    pso.Lib = this;
+    pso.RootSig = rootSig;
+    pso.PathToCompiledShader = pathToCompiledCS;
+    pso.PathToCompiledPS = nullptr;
+    pso.Idx = idx;
+    pso.BuildTimeMs = 0.0f;
+
+    AcquireSRWLockExclusive(&g_psoQueue.Lock);
+    g_psoQueue.Pending.push_back(pso);
+    ReleaseSRWLockExclusive(&g_psoQueue.Lock);
+}
+
+void PipelineStateLibrary::EnqueueGraphicsPSO(uint32_t idx, 
+    const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc, ID3D12RootSignature* rootSig, 
+    const char* pathToCompiledVS, const char* pathToCompiledPS)
+{
+    Assert(psoDesc.InputLayout.NumElements <= QueuedPSO::MAX_NUM_INPUT_ELEMENTS,
+        "Number of input elements exceeded maximum.");
+    Assert(psoDesc.StreamOutput.NumEntries == 0 && psoDesc.CachedPSO.CachedBlobSizeInBytes == 0,
+        "Queued graphics PSOs can't reference external stream output or cached blob.");
+
+    QueuedPSO pso;
+    pso.Lib = this;
+    pso.RootSig = rootSig;
+    pso.PathToCompiledShader = pathToCompiledVS;
+    pso.PathToCompiledPS = pathToCompiledPS;
+    pso.GraphicsDesc = psoDesc;
+    pso.Idx = idx;
+    pso.BuildTimeMs = 0.0f;
+
+    // Input layout is pointed to by the desc, which usually refers to caller's stack. 
+    // The pointer is fixed up right before compilation as the queue may reallocate.
+    for (uint32_t i = 0; i < psoDesc.InputLayout.NumElements; i++)
+        pso.InputElements[i] = psoDesc.InputLayout.pInputElementDescs[i];
+
+    AcquireSRWLockExclusive(&g_psoQueue.Lock);
+    g_psoQueue.Pending.push_back(pso);
+    ReleaseSRWLockExclusive(&g_psoQueue.Lock);
+}
 
-    if (hr == E_INVALIDARG)
+void PipelineStateLibrary::DeferComputePSO(uint32_t idx, ID3D12RootSignature* rootSig,
+    const char* pathToCompiledCS)
+{
+    AcquireSRWLockExclusive(&m_mapLock);
+    Assert(m_compiledPSOs[idx] == nullptr, "It's assumed that every PSO is loaded at most one time.");
+    m_deferred[idx] = DeferredPSO{ .RootSig = rootSig, .PathToCompiledCS = pathToCompiledCS };
+    ReleaseSRWLockExclusive(&m_mapLock);
+
+    AcquireSRWLockExclusive(&g_psoQueue.Lock);
+    g_psoQueue.Deferred.push_back(DeferredRequest{ .Lib = this, .Idx = idx });
+    ReleaseSRWLockExclusive(&g_psoQueue.Lock);
+}
+
+ID3D12PipelineState* PipelineStateLibrary::BuildDeferredPSO(uint32_t idx)
+{
+    AcquireSRWLockShared(&m_mapLock);
+    ID3D12PipelineState* pso = m_compiledPSOs[idx];
+    const DeferredPSO deferred = m_deferred[idx];
+    ReleaseSRWLockShared(&m_mapLock);
+
+    if (pso)
+        return pso;
+
+    Assert(deferred.PathToCompiledCS, "PSO in slot %u wasn't deferred.", idx);
+
+    ShaderBlob cs;
+    LoadShader(deferred.PathToCompiledCS, cs);
+
+    D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
+    desc.pRootSignature = deferred.RootSig;
+    desc.CS = cs.Bytecode();
+
+    // Compile without holding the lock, so that lookups of other PSOs aren't blocked
+    const uint64_t hash = HashComputePSO(desc, cs.Hash, m_driverVersion);
+    ID3D12PipelineState* newPSO = LoadOrCreateComputePSO(hash, desc, deferred.PathToCompiledCS);
+
+    AcquireSRWLockExclusive(&m_mapLock);
+
+    // Background task and a render pass might've both requested it at the same time
+    if (!m_compiledPSOs[idx])
     {
-        m_needsRebuild.store(true, std::memory_order_relaxed);
+        m_compiledPSOs[idx] = newPSO;
+        m_psoHashes[idx] = hash;
+    }
+    else
+        newPSO->Release();
 
-        auto* device = App::GetRenderer().GetDevice();
-        CheckHR(device->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso)));
+    pso = m_compiledPSOs[idx];
+    ReleaseSRWLockExclusive(&m_mapLock);
+
+    return pso;
+}
+
+bool PipelineStateLibrary::IsPSOReady(uint32_t idx)
+{
+    AcquireSRWLockShared(&m_mapLock);
+    const bool ready = m_compiledPSOs[idx] != nullptr;
+    ReleaseSRWLockShared(&m_mapLock);
+
+    return ready;
+}
+
+void PipelineStateLibrary::CancelDeferredPSOs()
+{
+    AcquireSRWLockExclusive(&g_psoQueue.Lock);
+
+    for (size_t i = 0; i < g_psoQueue.Deferred.size();)
+    {
+        if (g_psoQueue.Deferred[i].Lib == this)
+            g_psoQueue.Deferred.erase_at_index(i);
+        else
+            i++;
     }
 
-    Assert(m_compiledPSOs[idx] == nullptr, "It's assumed that every PSO is loaded at most one time.");
-    m_compiledPSOs[idx] = pso;
+    ReleaseSRWLockExclusive(&g_psoQueue.Lock);
+
+    // Wait for the PSO that's being built, if any, before its slot is released
+    while (m_numDeferredInFlight.load(std::memory_order_acquire))
+        _mm_pause();
+
+    for (auto& d : m_deferred)
+        d = DeferredPSO();
+}
+
+void PipelineStateLibrary::SubmitDeferredPSOs()
+{
+    AcquireSRWLockExclusive(&g_psoQueue.Lock);
+    const bool submit = !g_psoQueue.Deferred.empty() && !g_psoQueue.DeferredTaskRunning;
+    g_psoQueue.DeferredTaskRunning = g_psoQueue.DeferredTaskRunning || submit;
+    ReleaseSRWLockExclusive(&g_psoQueue.Lock);
+
+    if (!submit)
+        return;
+
+    // Build one PSO at a time to leave the background threads for e.g. texture streaming
+    Task t("BuildDeferredPSOs", TASK_PRIORITY::BACKGROUND, []()
+        {
+            while (true)
+            {
+                AcquireSRWLockExclusive(&g_psoQueue.Lock);
+
+                if (g_psoQueue.Deferred.empty())
+                {
+                    g_psoQueue.DeferredTaskRunning = false;
+                    ReleaseSRWLockExclusive(&g_psoQueue.Lock);
+
+                    break;
+                }
+
+                const DeferredRequest r = g_psoQueue.Deferred.back();
+                g_psoQueue.Deferred.pop_back();
+                // Incremented while the queue is locked, so that the library can't be reset 
+                // in between
+                r.Lib->m_numDeferredInFlight.fetch_add(1, std::memory_order_relaxed);
+
+                ReleaseSRWLockExclusive(&g_psoQueue.Lock);
+
+                r.Lib->BuildDeferredPSO(r.Idx);
+                r.Lib->m_numDeferredInFlight.fetch_sub(1, std::memory_order_release);
+            }
+        });
+
+    App::SubmitBackground(ZetaMove(t));
+}
+
+void PipelineStateLibrary::BuildQueuedPSOs()
+{
+    SmallVector<QueuedPSO> psos;
+    SmallVector<ReloadedPSO> reloaded;
+
+    AcquireSRWLockExclusive(&g_psoQueue.Lock);
+    psos.swap(g_psoQueue.Pending);
+    reloaded.swap(g_psoQueue.Reloaded);
+    ReleaseSRWLockExclusive(&g_psoQueue.Lock);
+
+    for (auto& r : reloaded)
+        r.Lib->SwapReloadedPSO(r.Idx, r.PSO, r.Hash, r.FlushGpu);
+
+    if (psos.empty())
+    {
+        SubmitDeferredPSOs();
+        return;
+    }
+
+    App::DeltaTimer timer;
+    timer.Start();
+
+    // Every PSO is independent -- the pipeline libraries already synchronize internally and
+    // each request writes to a distinct slot
+    App::ParallelFor(psos.size(), 1, [&psos](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                QueuedPSO& pso = psos[i];
+
+                App::DeltaTimer psoTimer;
+                psoTimer.Start();
+
+                if (pso.PathToCompiledPS)
+                {
+                    if (pso.GraphicsDesc.InputLayout.NumElements)
+                        pso.GraphicsDesc.InputLayout.pInputElementDescs = pso.InputElements;
+
+                    pso.Lib->CompileGraphicsPSO(pso.Idx, pso.GraphicsDesc, pso.RootSig,
+                        pso.PathToCompiledShader, pso.PathToCompiledPS);
+                }
+                else
+                {
+                    pso.Lib->CompileComputePSO_MT(pso.Idx, pso.RootSig, 
+                        pso.PathToCompiledShader);
+                }
+
+                psoTimer.End();
+                pso.BuildTimeMs = (float)psoTimer.DeltaMilli();
+            }
+        });
+
+    timer.End();
+
+#if LOGGING == 1
+    std::sort(psos.begin(), psos.end(), [](const QueuedPSO& a, const QueuedPSO& b)
+        {
+            return a.BuildTimeMs > b.BuildTimeMs;
+        });
+
+    float serialMs = 0.0f;
+
+    for (auto& pso : psos)
+    {
+        const char* name = pso.PathToCompiledPS ? pso.PathToCompiledPS : pso.PathToCompiledShader;
+        LOG_UI_INFO("PSO %s: %.2f [ms]", name, pso.BuildTimeMs);
+        serialMs += pso.BuildTimeMs;
+    }
+
+    LOG_UI_INFO("Built %u PSOs in %u [ms] (sum of per-PSO times: %u [ms]).", (uint32_t)psos.size(),
+        (uint32_t)timer.DeltaMilli(), (uint32_t)serialMs);
+#endif
+
+    SubmitDeferredPSOs();
+}
+
+ID3D12PipelineState* PipelineStateLibrary::GetPermutation(uint32_t baseIdx, uint32_t key, 
+    ID3D12RootSignature* rootSig, const ShaderPermutationDesc& desc)
+{
+    Assert(key < desc.NumPermutations(), "Invalid permutation key.");
+
+    if (desc.Wave64DefineIdx >= 0)
+        key = (key & ~(1u << desc.Wave64DefineIdx)) | WaveSizePermutationBit(desc);
+
+    const uint32_t idx = baseIdx + key;
+
+    AcquireSRWLockShared(&m_mapLock);
+    ID3D12PipelineState* pso = m_compiledPSOs[idx];
+    ReleaseSRWLockShared(&m_mapLock);
+
+    if (pso)
+        return pso;
+
+    char csoFilename[MAX_PATH];
+    GetPermutationCsoFilename(desc, key, csoFilename);
+
+    AcquireSRWLockExclusive(&m_mapLock);
+
+    // Some other thread might've beaten us to it
+    if (!m_compiledPSOs[idx])
+    {
+        Filesystem::Path csoPath(App::GetCompileShadersDir());
+        csoPath.Append(csoFilename);
+
+        // Precompiled permutations (see ShaderPermutations.txt manifests) go through the 
+        // PSO library as usual
+        if (App::GetRenderer().GetShaderArchive().Contains(csoFilename) || 
+            Filesystem::Exists(csoPath.Get()))
+            CompileComputePSO(idx, rootSig, csoFilename);
+        else
+        {
+#if LOGGING == 1
+            App::DeltaTimer timer;
+            timer.Start();
+#endif
+            const char* defines[ShaderPermutationDesc::MAX_NUM_DEFINES];
+            const uint32_t numDefines = GetPermutationDefines(desc, key, defines);
+
+            SmallVector<uint8_t> bytecode;
+            const bool success = CompileShader(desc.PathToHlsl, Span<const char*>(defines, numDefines),
+                csoFilename, bytecode);
+            Check(success, "Compiling shader permutation %s failed.", csoFilename);
+
+            CompileComputePSO(idx, rootSig, Span<const uint8_t>(bytecode.data(), bytecode.size()));
+
+#if LOGGING == 1
+            timer.End();
+            LOG_UI_INFO("Compiled shader permutation %s on first use in %u [ms].", csoFilename, 
+                (uint32_t)timer.DeltaMilli());
+#endif
+        }
+    }
+
+    pso = m_compiledPSOs[idx];
+    ReleaseSRWLockExclusive(&m_mapLock);
 
     return pso;
 }
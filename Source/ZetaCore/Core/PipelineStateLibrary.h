@@ -6,6 +6,36 @@
 
 namespace ZetaRay::Core
 {
+    // Compute shader that's compiled with different combinations of defines. Every define 
+    // is an axis that's either on or off, so a permutation is identified by a bitmask (the
+    // permutation key) where bit i enables Defines[i]. Its compiled shader is named
+    // <hlsl stem>[_<Suffixes[i]> for every set bit i]_cs.cso.
+    //
+    // Shaders with a wave-size specialization take "WAVE_SIZE=64" as one of their defines 
+    // (wave size is 32 otherwise) and set Wave64DefineIdx to its index. Its bit is then 
+    // picked by GetPermutation() from the device's supported wave sizes, rather than by 
+    // the caller's key.
+    struct ShaderPermutationDesc
+    {
+        static constexpr int MAX_NUM_DEFINES = 4;
+
+        constexpr uint32_t NumPermutations() const { return 1u << NumDefines; }
+
+        // Relative to render pass directory
+        const char* PathToHlsl;
+        // NAME or NAME=VALUE
+        const char* Defines[MAX_NUM_DEFINES];
+        const char* Suffixes[MAX_NUM_DEFINES];
+        uint32_t NumDefines;
+        // -1 when shader isn't specialized for wave size
+        int Wave64DefineIdx = -1;
+    };
+
+    // PSOs are stored in the library under a hash of everything that affects them -- 
+    // shader bytecode, root signature, pipeline desc and driver version. A shader that's 
+    // modified after the library was written to disk then simply misses and only that PSO 
+    // is recreated (and appended to the library), rather than the whole library being 
+    // thrown away.
     class PipelineStateLibrary
     {
     public:
@@ -17,14 +47,29 @@ namespace ZetaRay::Core
 
         void Init(const char* name);
         void Reset();
+        // Recompiles the given compute shader on a background thread. Once it's ready, new 
+        // PSO replaces the current one during the next BuildQueuedPSOs() call. pathToHlsl 
+        // must outlive the compilation (e.g. a string literal).
         void Reload(uint64_t idx, ID3D12RootSignature* rootSig, const char* pathToHlsl, 
             bool flushGpu = false);
+        // Same as above for every permutation of the given shader that's been used so far. 
+        // desc must outlive the compilation.
+        void ReloadPermutations(uint32_t baseIdx, ID3D12RootSignature* rootSig,
+            const ShaderPermutationDesc& desc, bool flushGpu = false);
 
         ID3D12PipelineState* CompileGraphicsPSO(uint32_t idx,
             D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc,
             ID3D12RootSignature* rootSig,
             const char* pathToCompiledVS,
             const char* pathToCompiledPS);
+        // Fixed-function state is taken from psoDesc, its input layout and shaders are 
+        // ignored. Amplification shader is optional.
+        ID3D12PipelineState* CompileMeshPSO(uint32_t idx,
+            const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc,
+            ID3D12RootSignature* rootSig,
+            const char* pathToCompiledAS,
+            const char* pathToCompiledMS,
+            const char* pathToCompiledPS);
         ID3D12PipelineState* CompileComputePSO(uint32_t idx,
             ID3D12RootSignature* rootSig,
             const char* pathToCompiledCS);
@@ -35,23 +80,102 @@ namespace ZetaRay::Core
             ID3D12RootSignature* rootSig,
             Util::Span<const uint8_t> compiledBlob);
 
+        // Queue the PSO to be built by the next call to BuildQueuedPSOs() rather than 
+        // compiling it on the calling thread. Graphics desc, including the input layout, 
+        // is copied, so it doesn't need to outlive the call.
+        void EnqueueComputePSO(uint32_t idx,
+            ID3D12RootSignature* rootSig,
+            const char* pathToCompiledCS);
+        void EnqueueGraphicsPSO(uint32_t idx,
+            const D3D12_GRAPHICS_PIPELINE_STATE_DESC& psoDesc,
+            ID3D12RootSignature* rootSig,
+            const char* pathToCompiledVS,
+            const char* pathToCompiledPS);
+        // For PSOs that might not be needed at all, e.g. an integrator or feature that 
+        // isn't active at startup. Rather than blocking the next BuildQueuedPSOs() call, 
+        // they're built afterwards on a background thread. GetPSO() builds the PSO on the 
+        // calling thread if it's requested before the background build gets to it.
+        void DeferComputePSO(uint32_t idx,
+            ID3D12RootSignature* rootSig,
+            const char* pathToCompiledCS);
+
+        // Builds every PSO that's been queued so far -- across all the libraries -- in 
+        // parallel on the worker thread pool. Returns after all of them are ready. Also 
+        // swaps in the PSOs whose reload has finished since the last call, so it should be 
+        // called when no command lists that use these PSOs are being recorded. Deferred 
+        // PSOs are then handed off to a background task.
+        static void BuildQueuedPSOs();
+
+        // Root signatures are opaque, so the ones that PSOs are created with should be tagged
+        // with a hash of their serialized blob for the PSO lookups to hit.
+        static void TagRootSignature(ID3D12RootSignature* rootSig, const void* serialized, 
+            size_t size);
+
         ZetaInline ID3D12PipelineState* GetPSO(uint32_t idx)
         {
-            return m_compiledPSOs[idx];
+            ID3D12PipelineState* pso = m_compiledPSOs[idx];
+            return pso || !m_deferred[idx].PathToCompiledCS ? pso : BuildDeferredPSO(idx);
         }
+        // Whether GetPSO() would return without blocking
+        bool IsPSOReady(uint32_t idx);
+
+        // Permutations take up consecutive PSO slots, with the given key in slot baseIdx + key.
+        // PSO for a permutation is only created the first time it's requested -- from its 
+        // precompiled shader if there is one, otherwise the shader is compiled first. Wave-size
+        // bit of the key (if any) is ignored and replaced with the device's.
+        ID3D12PipelineState* GetPermutation(uint32_t baseIdx, uint32_t key,
+            ID3D12RootSignature* rootSig,
+            const ShaderPermutationDesc& desc);
 
     private:
+        struct DeferredPSO
+        {
+            ID3D12RootSignature* RootSig = nullptr;
+            // NULL when slot isn't deferred
+            const char* PathToCompiledCS = nullptr;
+        };
+
         void ResetToEmptyPsoLib();
+        // Returns the existing PSO when it's already been built (by another thread)
+        ID3D12PipelineState* BuildDeferredPSO(uint32_t idx);
+        // Drops the deferred PSOs that haven't been built yet and waits for the ones that 
+        // are being built
+        void CancelDeferredPSOs();
+        // Starts a background task for the deferred PSOs unless there's one running already
+        static void SubmitDeferredPSOs();
+        // Returns NULL when library doesn't have a PSO with the given hash
+        ID3D12PipelineState* LoadComputeFromLibrary(uint64_t hash, 
+            const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc);
+        ID3D12PipelineState* LoadGraphicsFromLibrary(uint64_t hash,
+            const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+        ID3D12PipelineState* LoadStreamFromLibrary(uint64_t hash,
+            const D3D12_PIPELINE_STATE_STREAM_DESC& desc);
+        void StoreInLibrary(uint64_t hash, ID3D12PipelineState* pso);
+        ID3D12PipelineState* LoadOrCreateComputePSO(uint64_t hash,
+            const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, const char* nameForLog);
+        void SwapReloadedPSO(uint32_t idx, ID3D12PipelineState* pso, uint64_t hash, 
+            bool flushGpu);
+        void ReloadCompiled(uint32_t idx, ID3D12RootSignature* rootSig, const char* pathToHlsl,
+            Util::Span<const char*> defines, const char* csoFilename, bool flushGpu);
         void ClearAndFlushToDisk();
 
         App::Filesystem::Path m_psoLibPath1;
         ComPtr<ID3D12PipelineLibrary> m_psoLibrary;
         Util::MutableSpan<ID3D12PipelineState*> m_compiledPSOs;
+        // Hash of the PSO in each slot
+        Util::SmallVector<uint64_t> m_psoHashes;
+        Util::SmallVector<DeferredPSO> m_deferred;
         Util::SmallVector<uint8_t> m_cachedBlob;
+        uint64_t m_driverVersion = 0;
 
         SRWLOCK m_mapLock = SRWLOCK_INIT;
-        std::atomic_bool m_needsRebuild = false;
-        bool m_foundOnDisk = false;
+        // Number of entries in the library that was loaded from disk
+        uint32_t m_numEntriesOnDisk = 0;
+        // Number of library lookups that hit and number of newly stored PSOs
+        std::atomic_uint32_t m_numLoaded = 0;
+        std::atomic_uint32_t m_numStored = 0;
+        // Number of deferred PSOs of this library that background task is building
+        std::atomic_uint32_t m_numDeferredInFlight = 0;
         bool m_psoWasReset = false;
     };
 }
\ No newline at end of file
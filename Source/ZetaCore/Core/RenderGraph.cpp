@@ -5,14 +5,16 @@
 #include "RendererCore.h"
 #include "CommandList.h"
 #include "../Support/Task.h"
+#include "../Support/TaskTimeline.h"
+#include "../Support/CpuEvent.h"
 #include "../App/Timer.h"
 #include "../Utility/Utility.h"
+#include "../App/Log.h"
 #include <algorithm>
 #include <xxHash/xxhash.h>
 #include <ImGui/imnodes.h>
 
 #ifndef NDEBUG
-#include "../App/Log.h"
 #include <string>
 #endif
 
@@ -24,43 +26,154 @@ using namespace ZetaRay::Core::Direct3DUtil;
 
 namespace
 {
-    const char* GetResStateName(D3D12_RESOURCE_STATES s)
+    const char* GetLayoutName(D3D12_BARRIER_LAYOUT l)
     {
-        switch (s)
+        switch (l)
         {
-        case D3D12_RESOURCE_STATE_COMMON:
+        case D3D12_BARRIER_LAYOUT_COMMON:
             return "COMMON_OR_PRESENT";
-        case D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER:
-            return "VERTEX_AND_CONSTANT_BUFFER";
-        case D3D12_RESOURCE_STATE_INDEX_BUFFER:
-            return "INDEX_BUFFER";
-        case D3D12_RESOURCE_STATE_RENDER_TARGET:
+        case D3D12_BARRIER_LAYOUT_GENERIC_READ:
+            return "GENERIC_READ";
+        case D3D12_BARRIER_LAYOUT_RENDER_TARGET:
             return "RENDER_TARGET";
-        case D3D12_RESOURCE_STATE_UNORDERED_ACCESS:
+        case D3D12_BARRIER_LAYOUT_UNORDERED_ACCESS:
             return "UNORDERED_ACCESS";
-        case D3D12_RESOURCE_STATE_DEPTH_WRITE:
-            return "DEPTH_WRITE";
-        case D3D12_RESOURCE_STATE_DEPTH_READ:
-            return "DEPTH_READ";
-        case D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE:
-            return "NON_PIXEL_SHADER_RESOURCE";
-        case D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE:
-            return "PIXEL_SHADER_RESOURCE";
-        case D3D12_RESOURCE_STATE_COPY_DEST:
-            return "COPY_DEST";
-        case D3D12_RESOURCE_STATE_COPY_SOURCE:
+        case D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE:
+            return "DEPTH_STENCIL_WRITE";
+        case D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_READ:
+            return "DEPTH_STENCIL_READ";
+        case D3D12_BARRIER_LAYOUT_SHADER_RESOURCE:
+            return "SHADER_RESOURCE";
+        case D3D12_BARRIER_LAYOUT_COPY_SOURCE:
             return "COPY_SOURCE";
-        case D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE:
-            return "RAYTRACING_ACCELERATION_STRUCTURE";
-        case D3D12_RESOURCE_STATE_GENERIC_READ:
-            return "GENERIC_READ";
-        case D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE:
-            return "ALL_SHADER_RESOURCE";
+        case D3D12_BARRIER_LAYOUT_COPY_DEST:
+            return "COPY_DEST";
+        case D3D12_BARRIER_LAYOUT_RESOLVE_SOURCE:
+            return "RESOLVE_SOURCE";
+        case D3D12_BARRIER_LAYOUT_RESOLVE_DEST:
+            return "RESOLVE_DEST";
         default:
             return "UNKNOWN";
         }
     }
 
+    // Enhanced barrier equivalent of a legacy resource state
+    struct BarrierScope
+    {
+        D3D12_BARRIER_SYNC Sync;
+        D3D12_BARRIER_ACCESS Access;
+        D3D12_BARRIER_LAYOUT Layout;
+        // Whether sync and access can be used in barriers recorded on the compute queue
+        bool ValidOnComputeQueue;
+    };
+
+    constexpr D3D12_RESOURCE_STATES WRITE_STATES = D3D12_RESOURCE_STATE_RENDER_TARGET |
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS |
+        D3D12_RESOURCE_STATE_DEPTH_WRITE |
+        D3D12_RESOURCE_STATE_STREAM_OUT |
+        D3D12_RESOURCE_STATE_COPY_DEST |
+        D3D12_RESOURCE_STATE_RESOLVE_DEST;
+
+    // Layouts are the ones that are compatible with legacy states, so that resources can 
+    // still be tracked (and created) with legacy states
+    BarrierScope GetBarrierScope(D3D12_RESOURCE_STATES s, bool computeQueue)
+    {
+        const D3D12_BARRIER_SYNC allShading = computeQueue ? D3D12_BARRIER_SYNC_COMPUTE_SHADING :
+            D3D12_BARRIER_SYNC_ALL_SHADING;
+
+        // Common state could've been the result of decay after any kind of access
+        if (s == D3D12_RESOURCE_STATE_COMMON)
+        {
+            return { D3D12_BARRIER_SYNC_ALL, D3D12_BARRIER_ACCESS_COMMON, 
+                D3D12_BARRIER_LAYOUT_COMMON, true };
+        }
+
+        // Write states can't be combined with other states
+        switch (s)
+        {
+        case D3D12_RESOURCE_STATE_RENDER_TARGET:
+            return { D3D12_BARRIER_SYNC_RENDER_TARGET, D3D12_BARRIER_ACCESS_RENDER_TARGET, 
+                D3D12_BARRIER_LAYOUT_RENDER_TARGET, false };
+        case D3D12_RESOURCE_STATE_UNORDERED_ACCESS:
+            return { allShading, D3D12_BARRIER_ACCESS_UNORDERED_ACCESS, 
+                D3D12_BARRIER_LAYOUT_UNORDERED_ACCESS, true };
+        case D3D12_RESOURCE_STATE_DEPTH_WRITE:
+            return { D3D12_BARRIER_SYNC_DEPTH_STENCIL, D3D12_BARRIER_ACCESS_DEPTH_STENCIL_WRITE, 
+                D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE, false };
+        case D3D12_RESOURCE_STATE_COPY_DEST:
+            return { D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_DEST, 
+                D3D12_BARRIER_LAYOUT_COPY_DEST, true };
+        case D3D12_RESOURCE_STATE_RESOLVE_DEST:
+            return { D3D12_BARRIER_SYNC_RESOLVE, D3D12_BARRIER_ACCESS_RESOLVE_DEST, 
+                D3D12_BARRIER_LAYOUT_RESOLVE_DEST, false };
+        default:
+            break;
+        }
+
+        Assert(!(s & WRITE_STATES), "Unsupported resource state %u.", s);
+
+        // Read states
+        BarrierScope ret = { D3D12_BARRIER_SYNC_NONE, D3D12_BARRIER_ACCESS_COMMON, 
+            D3D12_BARRIER_LAYOUT_GENERIC_READ, true };
+
+        auto add = [&ret](D3D12_BARRIER_SYNC sync, D3D12_BARRIER_ACCESS access, bool validOnCompute)
+            {
+                ret.Sync |= sync;
+                ret.Access |= access;
+                ret.ValidOnComputeQueue = ret.ValidOnComputeQueue && validOnCompute;
+            };
+
+        if (s & D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER)
+        {
+            add(allShading, computeQueue ? D3D12_BARRIER_ACCESS_CONSTANT_BUFFER :
+                D3D12_BARRIER_ACCESS_VERTEX_BUFFER | D3D12_BARRIER_ACCESS_CONSTANT_BUFFER, true);
+        }
+        if (s & D3D12_RESOURCE_STATE_INDEX_BUFFER)
+            add(D3D12_BARRIER_SYNC_INDEX_INPUT, D3D12_BARRIER_ACCESS_INDEX_BUFFER, false);
+        if (s & D3D12_RESOURCE_STATE_DEPTH_READ)
+            add(D3D12_BARRIER_SYNC_DEPTH_STENCIL, D3D12_BARRIER_ACCESS_DEPTH_STENCIL_READ, false);
+        if (s & D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
+        {
+            add(computeQueue ? D3D12_BARRIER_SYNC_COMPUTE_SHADING : D3D12_BARRIER_SYNC_NON_PIXEL_SHADING, 
+                D3D12_BARRIER_ACCESS_SHADER_RESOURCE, true);
+        }
+        if (s & D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+            add(D3D12_BARRIER_SYNC_PIXEL_SHADING, D3D12_BARRIER_ACCESS_SHADER_RESOURCE, false);
+        if (s & D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT)
+            add(D3D12_BARRIER_SYNC_EXECUTE_INDIRECT, D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT, true);
+        if (s & D3D12_RESOURCE_STATE_COPY_SOURCE)
+            add(D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_SOURCE, true);
+        if (s & D3D12_RESOURCE_STATE_RESOLVE_SOURCE)
+            add(D3D12_BARRIER_SYNC_RESOLVE, D3D12_BARRIER_ACCESS_RESOLVE_SOURCE, false);
+        if (s & D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE)
+        {
+            add(allShading | D3D12_BARRIER_SYNC_RAYTRACING, 
+                D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ, true);
+        }
+
+        // Use the most specific layout that allows all the accesses
+        if (s & D3D12_RESOURCE_STATE_DEPTH_READ)
+            ret.Layout = D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_READ;
+        else if (ret.Access == D3D12_BARRIER_ACCESS_SHADER_RESOURCE)
+            ret.Layout = D3D12_BARRIER_LAYOUT_SHADER_RESOURCE;
+        else if (ret.Access == D3D12_BARRIER_ACCESS_COPY_SOURCE)
+            ret.Layout = D3D12_BARRIER_LAYOUT_COPY_SOURCE;
+        else if (ret.Access == D3D12_BARRIER_ACCESS_RESOLVE_SOURCE)
+            ret.Layout = D3D12_BARRIER_LAYOUT_RESOLVE_SOURCE;
+
+        return ret;
+    }
+
+    ZetaInline bool IsComputeQueueLayout(D3D12_BARRIER_LAYOUT l)
+    {
+        return l == D3D12_BARRIER_LAYOUT_COMMON ||
+            l == D3D12_BARRIER_LAYOUT_GENERIC_READ ||
+            l == D3D12_BARRIER_LAYOUT_UNORDERED_ACCESS ||
+            l == D3D12_BARRIER_LAYOUT_SHADER_RESOURCE ||
+            l == D3D12_BARRIER_LAYOUT_COPY_SOURCE ||
+            l == D3D12_BARRIER_LAYOUT_COPY_DEST;
+    }
+
     struct Edge
     {
         int E0;
@@ -84,8 +197,12 @@ void RenderGraph::AggregateRenderNode::Append(const RenderNode& node, int mapped
     Assert(!node.HasUnsupportedBarrier || node.Type == RENDER_NODE_TYPE::ASYNC_COMPUTE, 
         "Invalid condition.");
 
-    Barriers.append_range(node.Barriers.begin(), node.Barriers.end());
+    TextureBarriers.append_range(node.TextureBarriers.begin(), node.TextureBarriers.end());
+    BufferBarriers.append_range(node.BufferBarriers.begin(), node.BufferBarriers.end());
     Dlgs.push_back(node.Dlg);
+    DlgNames.push_back(node.Name);
+    SubDlg = node.SubDlg;
+    NumSubCmdLists = node.NumSubCmdLists;
     BatchIdx = node.NodeBatchIdx;
     ForceSeparate = forceSeparate;
     GpuDepIdx.Val = Math::Max(GpuDepIdx.Val, mappedGpeDepIdx);
@@ -118,8 +235,21 @@ void RenderGraph::Shutdown()
     {
         m_renderNodes[i].Inputs.free_memory();
         m_renderNodes[i].Outputs.free_memory();
-        m_renderNodes[i].Barriers.free_memory();
+        m_renderNodes[i].TextureBarriers.free_memory();
+        m_renderNodes[i].BufferBarriers.free_memory();
+    }
+
+    for (auto& g : m_compiledGraphs)
+    {
+        g.NumNodes = 0;
+        g.AggregateNodes.free_memory();
+        g.TextureBarriers.free_memory();
+        g.BufferBarriers.free_memory();
     }
+
+    m_nodeTimings.free_memory();
+    m_asyncNodes.free_memory();
+    EndPassBenchmark();
 }
 
 void RenderGraph::Reset()
@@ -156,6 +286,12 @@ void RenderGraph::Reset()
 
     m_aggregateNodes.free_memory();
     m_currRenderPassIdx.store(0, std::memory_order_relaxed);
+
+    // Resources are about to be recreated
+    for (auto& g : m_compiledGraphs)
+        g.NumNodes = 0;
+
+    m_taskGraph.Reset();
 }
 
 void RenderGraph::RemoveResource(uint64_t path)
@@ -249,6 +385,31 @@ RenderNodeHandle RenderGraph::RegisterRenderPass(const char* name, RENDER_NODE_T
     return RenderNodeHandle(h);
 }
 
+RenderNodeHandle RenderGraph::RegisterRenderPass(const char* name, RENDER_NODE_TYPE t, 
+    fastdelegate::FastDelegate2<CommandList&, int> dlg, int numSubCmdLists)
+{
+    Assert(m_inBeginEndBlock && m_inPreRegister, "Invalid call.");
+    Assert(numSubCmdLists > 0 && numSubCmdLists <= MAX_NUM_SUB_CMD_LISTS, 
+        "Number of sub command lists must be in [1, MAX_NUM_SUB_CMD_LISTS].");
+    int h = m_currRenderPassIdx.fetch_add(1, std::memory_order_relaxed);
+    Assert(h < MAX_NUM_RENDER_PASSES, "Number of render passes exceeded MAX_NUM_RENDER_PASSES");
+
+    fastdelegate::FastDelegate1<CommandList&> empty;
+    m_renderNodes[h].Reset(name, t, empty, true);
+    m_renderNodes[h].SubDlg = dlg;
+    m_renderNodes[h].NumSubCmdLists = numSubCmdLists;
+
+    return RenderNodeHandle(h);
+}
+
+void RenderGraph::KeepAlive(RenderNodeHandle h)
+{
+    Assert(m_inBeginEndBlock, "Invalid call.");
+    Assert(h.IsValid() && h.Val < m_currRenderPassIdx.load(std::memory_order_relaxed), "Invalid handle");
+
+    m_renderNodes[h.Val].KeepAlive = true;
+}
+
 void RenderGraph::RegisterResource(ID3D12Resource* res, uint64_t path, 
     D3D12_RESOURCE_STATES initState, bool isWindowSizeDependent)
 {
@@ -272,6 +433,8 @@ void RenderGraph::RegisterResource(ID3D12Resource* res, uint64_t path,
     Assert(pos < MAX_NUM_RESOURCES, "Number of resources exceeded MAX_NUM_RESOURCES");
 
     m_frameResources[pos].Reset(path, res, initState, isWindowSizeDependent);
+    // Give new resources a chance to be read before their producers are culled
+    m_frameResources[pos].LastReadBuild = m_numBuilds + 1;
 }
 
 void RenderGraph::MoveToPostRegister()
@@ -343,11 +506,46 @@ void RenderGraph::AddOutput(RenderNodeHandle h, uint64_t pathID,
 
 void RenderGraph::Build(TaskSet& ts)
 {
+    ZETA_CPU_EVENT_SCOPE("RenderGraph::Build");
+
     Assert(m_inBeginEndBlock && !m_inPreRegister, "Invalid call.");
     m_inBeginEndBlock = false;
 
     const int numNodes = m_currRenderPassIdx.load(std::memory_order_relaxed);
     Assert(numNodes > 0, "no render nodes");
+    m_numBuilds++;
+
+    CullNodes();
+
+    // Replays would skew the node timings
+    const bool timeNodes = !m_passBenchmark.Active;
+
+    if (timeNodes && (m_profileNodes || m_autoAsyncCompute))
+        AccumulateNodeTimings();
+
+    if (timeNodes && m_profileNodes)
+        ReportNodeStats();
+
+    if (m_passBenchmark.Active)
+        CollectPassBenchmarkTimings();
+
+    // Node types have to be final before fingerprinting
+    if (m_autoAsyncCompute)
+        ApplyAsyncComputePlacement();
+
+    // Pass set rarely changes between frames
+    const uint64_t fingerprint = Fingerprint();
+    if (ReplayCompiledGraph(fingerprint))
+    {
+        if (timeNodes && m_autoAsyncCompute)
+            UpdateAsyncComputePlacement();
+
+        if (m_passBenchmark.Active)
+            PreparePassBenchmark();
+
+        BuildTaskGraph(ts, fingerprint);
+        return;
+    }
 
     for (int i = 0; i < numNodes; i++)
         m_renderNodes[i].Indegree = (int16)m_renderNodes[i].Inputs.size();
@@ -417,15 +615,124 @@ void RenderGraph::Build(TaskSet& ts)
     InsertResourceBarriers();
     JoinRenderNodes();
     MergeSmallNodes();
-    BuildTaskGraph(ts);
+    CacheCompiledGraph(fingerprint);
+
+    if (timeNodes && m_autoAsyncCompute)
+        UpdateAsyncComputePlacement();
+
+    if (m_passBenchmark.Active)
+        PreparePassBenchmark();
+
+    BuildTaskGraph(ts, fingerprint);
 
 #ifndef NDEBUG
     //Log();
 #endif
 }
 
-void RenderGraph::BuildTaskGraph(Support::TaskSet& ts)
+void RenderGraph::CullNodes()
+{
+    ZETA_CPU_EVENT_SCOPE("RenderGraph::Cull");
+
+    const int numNodes = m_currRenderPassIdx.load(std::memory_order_relaxed);
+    const int numResources = m_lastResIdx.load(std::memory_order_relaxed);
+    const uint64_t backBufferID = App::GetRenderer().GetCurrentBackBuffer().ID();
+
+    bool live[MAX_NUM_RENDER_PASSES] = { false };
+    int stack[MAX_NUM_RENDER_PASSES];
+    int stackSize = 0;
+
+    // Roots: nodes that write to the backbuffer, nodes with side effects and producers
+    // of resources that are read across frames
+    for (int currNode = 0; currNode < numNodes; currNode++)
+    {
+        const RenderNode& node = m_renderNodes[currNode];
+        bool isRoot = node.KeepAlive;
+
+        for (const Dependency& d : node.Outputs)
+        {
+            const int idx = FindFrameResource(d.ResID);
+            Assert(idx != -1, "Resource %llu was not found.", d.ResID);
+
+            isRoot = isRoot || (d.ResID == backBufferID) || 
+                (m_numBuilds - m_frameResources[idx].LastReadBuild <= MAX_BUILDS_SINCE_READ);
+        }
+
+        if (isRoot)
+        {
+            live[currNode] = true;
+            stack[stackSize++] = currNode;
+        }
+    }
+
+    // Walk back through the producers
+    while (stackSize)
+    {
+        const RenderNode& node = m_renderNodes[stack[--stackSize]];
+
+        for (const Dependency& d : node.Inputs)
+        {
+            const int idx = FindFrameResource(d.ResID);
+            Assert(idx != -1, "Resource %llu was not found.", d.ResID);
+            ResourceMetadata& res = m_frameResources[idx];
+            res.LastReadBuild = m_numBuilds;
+
+            const int numProducers = res.CurrProdIdx.load(std::memory_order_relaxed);
+
+            for (int i = 0; i < numProducers; i++)
+            {
+                const int prod = res.Producers[i].Val;
+
+                if (!live[prod])
+                {
+                    live[prod] = true;
+                    stack[stackSize++] = prod;
+                }
+            }
+        }
+    }
+
+    bool anyCulled = false;
+
+    for (int currNode = 0; currNode < numNodes; currNode++)
+    {
+        if (live[currNode])
+            continue;
+
+        // Without any dependencies, culled nodes don't affect the rest of the graph
+        RenderNode& node = m_renderNodes[currNode];
+        node.Culled = true;
+        node.Inputs.clear();
+        node.Outputs.clear();
+        anyCulled = true;
+    }
+
+    if (!anyCulled)
+        return;
+
+    for (int i = 0; i < numResources; i++)
+    {
+        ResourceMetadata& res = m_frameResources[i];
+        const int numProducers = res.CurrProdIdx.load(std::memory_order_relaxed);
+        int numLive = 0;
+
+        for (int j = 0; j < numProducers; j++)
+        {
+            if (live[res.Producers[j].Val])
+                res.Producers[numLive++] = res.Producers[j];
+        }
+
+        for (int j = numLive; j < numProducers; j++)
+            res.Producers[j] = RenderNodeHandle(INVALID_NODE_HANDLE);
+
+        res.CurrProdIdx.store((uint16_t)numLive, std::memory_order_relaxed);
+    }
+}
+
+void RenderGraph::BuildTaskGraph(Support::TaskSet& ts, uint64_t fingerprint)
 {
+    ZETA_CPU_EVENT_SCOPE("RenderGraph::BuildTaskGraph");
+
     // Task-level dependency cases:
     // 
     // 1. From nodes with batchIdx i to nodes with batchIdx i + 1
@@ -437,129 +744,244 @@ void RenderGraph::BuildTaskGraph(Support::TaskSet& ts)
     // the tasks from batch index B where B = C.batchIdx
     //  - Remove C's GPU dependency (if any), then add a GPU dependency from T to C
 
-    for (int i = 0; i < m_aggregateNodes.size(); i++)
+    m_timeNodes = (m_profileNodes || m_autoAsyncCompute) && !m_passBenchmark.Active;
+
+    // Aggregate nodes and their batches are the same for the same compiled graph, so 
+    // the task graph only needs to be rebuilt when the graph changes
+    if (!m_taskGraph.IsBuilt() || m_taskGraphFingerprint != fingerprint)
     {
-        m_aggregateNodes[i].TaskH = ts.EmplaceTask(m_aggregateNodes[i].Name, [this, i]()
+        m_taskGraph.Reset();
+
+        // Handles match the aggregate node indices
+        for (int i = 0; i < m_aggregateNodes.size(); i++)
+        {
+            m_taskGraph.AddTask(m_aggregateNodes[i].Name, [](void* ctx, int idx, void*)
+                {
+                    reinterpret_cast<RenderGraph*>(ctx)->RecordAggregateNode(idx);
+                }, this, i);
+        }
+
+        for (int i = 0; i < (int)m_aggregateNodes.size() - 1; i++)
+        {
+            const int currBatchIdx = m_aggregateNodes[i].BatchIdx;
+
+            for (int j = i + 1; j < (int)m_aggregateNodes.size(); j++)
             {
-                auto& renderer = App::GetRenderer();
+                const int nextBatchIdx = m_aggregateNodes[j].BatchIdx;
 
-                ComputeCmdList* cmdList = nullptr;
-                AggregateRenderNode& aggregateNode = m_aggregateNodes[i];
+                if (nextBatchIdx > currBatchIdx + 1)
+                    break;
 
-                if (aggregateNode.MergeStart)
-                {
-                    Assert(m_mergedCmdLists[aggregateNode.MergedCmdListIdx] == nullptr, 
-                        "Merged command list should be initially NULL.");
-                    m_mergedCmdLists[aggregateNode.MergedCmdListIdx] = 
-                        static_cast<ComputeCmdList*>(renderer.GetGraphicsCmdList());;
-                    cmdList = m_mergedCmdLists[aggregateNode.MergedCmdListIdx];
-                }
-                else if (aggregateNode.MergedCmdListIdx != -1)
-                {
-                    cmdList = m_mergedCmdLists[aggregateNode.MergedCmdListIdx];
-                    Assert(cmdList, "Merged command list should've been initializeda at this point.");
-                }
-                else
-                {
-                    if (!aggregateNode.IsAsyncCompute)
-                        cmdList = static_cast<ComputeCmdList*>(renderer.GetGraphicsCmdList());
-                    else
-                        cmdList = renderer.GetComputeCmdList();
-                }
+                if (nextBatchIdx == currBatchIdx + 1)
+                    m_taskGraph.AddOutgoingEdge(i, j);
+
+                if(nextBatchIdx == currBatchIdx && m_aggregateNodes[j].ForceSeparate)
+                    m_taskGraph.AddOutgoingEdge(i, j);
+            }
+        }
+
+        m_taskGraph.Build();
+        m_taskGraphFingerprint = fingerprint;
+    }
+
+    m_taskGraph.Instantiate(ts);
+}
+
+void RenderGraph::RecordAggregateNode(int i)
+    {
+        auto& renderer = App::GetRenderer();
+        auto& gpuTimer = renderer.GetGpuTimer();
+        char queryName[GpuTimer::Timing::MAX_NAME_LENGTH];
+
+        ComputeCmdList* cmdList = nullptr;
+        AggregateRenderNode& aggregateNode = m_aggregateNodes[i];
+
+        if (aggregateNode.MergeStart)
+        {
+            Assert(m_mergedCmdLists[aggregateNode.MergedCmdListIdx] == nullptr, 
+                "Merged command list should be initially NULL.");
+            m_mergedCmdLists[aggregateNode.MergedCmdListIdx] = 
+                static_cast<ComputeCmdList*>(renderer.GetGraphicsCmdList());;
+            cmdList = m_mergedCmdLists[aggregateNode.MergedCmdListIdx];
+        }
+        else if (aggregateNode.MergedCmdListIdx != -1)
+        {
+            cmdList = m_mergedCmdLists[aggregateNode.MergedCmdListIdx];
+            Assert(cmdList, "Merged command list should've been initializeda at this point.");
+        }
+        else
+        {
+            if (!aggregateNode.IsAsyncCompute)
+                cmdList = static_cast<ComputeCmdList*>(renderer.GetGraphicsCmdList());
+            else
+                cmdList = renderer.GetComputeCmdList();
+        }
 
 #ifndef NDEBUG
-                cmdList->SetName(aggregateNode.Name);
+        cmdList->SetName(aggregateNode.Name);
 #endif
 
-                if (aggregateNode.HasUnsupportedBarrier)
-                {
-                    CommandList* barrierCmdList = renderer.GetGraphicsCmdList();
-                    GraphicsCmdList& directCmdList = static_cast<GraphicsCmdList&>(*barrierCmdList);
+        if (aggregateNode.HasUnsupportedBarrier)
+        {
+            CommandList* barrierCmdList = renderer.GetGraphicsCmdList();
+            GraphicsCmdList& directCmdList = static_cast<GraphicsCmdList&>(*barrierCmdList);
 #ifndef NDEBUG
-                    directCmdList.SetName("Barrier");
+            directCmdList.SetName("Barrier");
 #endif
-                    directCmdList.ResourceBarrier(aggregateNode.Barriers.data(), 
-                        (UINT)aggregateNode.Barriers.size());
-                    uint64_t f = renderer.ExecuteCmdList(barrierCmdList);
+            RecordBarriers(aggregateNode, directCmdList);
+            uint64_t f = renderer.ExecuteCmdList(barrierCmdList);
 
-                    renderer.WaitForDirectQueueOnComputeQueue(f);
-                }
-                else if (!aggregateNode.Barriers.empty())
-                {
-                    cmdList->ResourceBarrier(aggregateNode.Barriers.begin(), 
-                        (UINT)aggregateNode.Barriers.size());
-                }
+            renderer.WaitForDirectQueueOnComputeQueue(f);
+        }
+        else
+            RecordBarriers(aggregateNode, *cmdList);
+
+        // Record
+        ComputeCmdList* subCmdLists[MAX_NUM_SUB_CMD_LISTS];
+        const int numSubCmdLists = aggregateNode.NumSubCmdLists;
+
+        if (aggregateNode.SubDlg)
+        {
+            Assert(aggregateNode.Dlgs.size() == 1 && aggregateNode.MergedCmdListIdx == -1, 
+                "Nodes with sub command lists can't be merged with other nodes.");
 
-                // Record
-                for(auto dlg : aggregateNode.Dlgs)
-                    dlg(*cmdList);
+            // First one also contains the barriers
+            subCmdLists[0] = cmdList;
 
-                // Wait for possible GPU fence
-                if (!aggregateNode.HasUnsupportedBarrier && aggregateNode.GpuDepIdx.Val != -1)
+            for (int j = 1; j < numSubCmdLists; j++)
+            {
+                subCmdLists[j] = !aggregateNode.IsAsyncCompute ? 
+                    static_cast<ComputeCmdList*>(renderer.GetGraphicsCmdList()) :
+                    renderer.GetComputeCmdList();
+#ifndef NDEBUG
+                subCmdLists[j]->SetName(aggregateNode.Name);
+#endif
+            }
+
+            uint32_t queryIdx = UINT32_MAX;
+
+            if (m_timeNodes)
+            {
+                stbsp_snprintf(queryName, sizeof(queryName), "%s%s", NODE_TIMING_PREFIX, 
+                    aggregateNode.DlgNames[0]);
+                // Pipeline statistics queries can't span command lists
+                queryIdx = gpuTimer.BeginQuery(*cmdList, queryName);
+            }
+
+            aggregateNode.SubDlg(*cmdList, 0);
+
+            App::ParallelFor(numSubCmdLists - 1, 1, [&aggregateNode, &subCmdLists](size_t begin, size_t end)
                 {
-                    uint64_t f = m_aggregateNodes[aggregateNode.GpuDepIdx.Val].CompletionFence;
-                    Assert(f != UINT64_MAX, "GPU hasn't finished executing.");
+                    for (size_t j = begin + 1; j < end + 1; j++)
+                        aggregateNode.SubDlg(*subCmdLists[j], (int)j);
+                });
 
-                    if (aggregateNode.IsAsyncCompute)
-                        renderer.WaitForDirectQueueOnComputeQueue(f);
-                    else
-                        renderer.WaitForComputeQueueOnDirectQueue(f);
-                }
+            // Sub command lists are submitted in order, so the last one ends the timing
+            if (m_timeNodes)
+                gpuTimer.EndQuery(*subCmdLists[numSubCmdLists - 1], queryIdx);
+        }
+        else
+        {
+            for (int j = 0; j < (int)aggregateNode.Dlgs.size(); j++)
+            {
+                uint32_t queryIdx = UINT32_MAX;
 
-                if (aggregateNode.IsLast)
+                if (m_timeNodes)
                 {
-                    auto& gpuTimer = renderer.GetGpuTimer();
-                    gpuTimer.EndFrame(*cmdList);
+                    stbsp_snprintf(queryName, sizeof(queryName), "%s%s", NODE_TIMING_PREFIX, 
+                        aggregateNode.DlgNames[j]);
+                    queryIdx = gpuTimer.BeginQuery(*cmdList, queryName, true);
                 }
 
-                // submit
-                if (aggregateNode.MergedCmdListIdx == -1 || aggregateNode.MergeEnd)
-                {
-                    aggregateNode.CompletionFence = renderer.ExecuteCmdList(cmdList);
+                if (aggregateNode.DlgNames[j] == m_passBenchmark.Node)
+                    RecordPassBenchmark(*cmdList, aggregateNode.Dlgs[j]);
+                else
+                    aggregateNode.Dlgs[j](*cmdList);
 
-                    if (aggregateNode.MergeEnd)
-                    {
-                        m_mergedCmdLists[aggregateNode.MergedCmdListIdx] = nullptr;
+                if (m_timeNodes)
+                    gpuTimer.EndQuery(*cmdList, queryIdx);
+            }
+        }
 
-                        int curr = i - 1;
-                        while (m_aggregateNodes[curr].MergedCmdListIdx == aggregateNode.MergedCmdListIdx)
-                        {
-                            m_aggregateNodes[curr].CompletionFence = aggregateNode.CompletionFence;
-                            curr--;
-                        }
-                    }
-                }
+        // Wait for possible GPU fence
+        if (!aggregateNode.HasUnsupportedBarrier && aggregateNode.GpuDepIdx.Val != -1)
+        {
+            uint64_t f = m_aggregateNodes[aggregateNode.GpuDepIdx.Val].CompletionFence;
+            Assert(f != UINT64_MAX, "GPU hasn't finished executing.");
 
-                if (m_submissionWaitObj && aggregateNode.IsLast)
-                {
-                    m_submissionWaitObj->Notify();
-                    m_submissionWaitObj = nullptr;
-                }
-            });
-    }
+            if (aggregateNode.IsAsyncCompute)
+                renderer.WaitForDirectQueueOnComputeQueue(f);
+            else
+                renderer.WaitForComputeQueueOnDirectQueue(f);
+        }
 
-    for (int i = 0; i < (int)m_aggregateNodes.size() - 1; i++)
-    {
-        const int currBatchIdx = m_aggregateNodes[i].BatchIdx;
+        // Submit all but the last sub command list in order -- the last one is
+        // submitted below like a regular node, so that completion fence covers all
+        if (aggregateNode.SubDlg)
+        {
+            for (int j = 0; j < numSubCmdLists - 1; j++)
+                renderer.ExecuteCmdList(subCmdLists[j]);
+
+            cmdList = subCmdLists[numSubCmdLists - 1];
+        }
+
+        if (aggregateNode.IsLast)
+            gpuTimer.EndFrame(*cmdList);
 
-        for (int j = i + 1; j < (int)m_aggregateNodes.size(); j++)
+        // submit
+        if (aggregateNode.MergedCmdListIdx == -1 || aggregateNode.MergeEnd)
         {
-            const int nextBatchIdx = m_aggregateNodes[j].BatchIdx;
+            aggregateNode.CompletionFence = renderer.ExecuteCmdList(cmdList);
+            App::GetTaskTimeline().RecordSubmit(aggregateNode.Name, 
+                aggregateNode.IsAsyncCompute ? TaskTimeline::GPU_QUEUE::COMPUTE : 
+                TaskTimeline::GPU_QUEUE::DIRECT, aggregateNode.CompletionFence);
 
-            if (nextBatchIdx > currBatchIdx + 1)
-                break;
+            if (aggregateNode.MergeEnd)
+            {
+                m_mergedCmdLists[aggregateNode.MergedCmdListIdx] = nullptr;
 
-            if (nextBatchIdx == currBatchIdx + 1)
-                ts.AddOutgoingEdge(m_aggregateNodes[i].TaskH, m_aggregateNodes[j].TaskH);
+                int curr = i - 1;
+                while (m_aggregateNodes[curr].MergedCmdListIdx == aggregateNode.MergedCmdListIdx)
+                {
+                    m_aggregateNodes[curr].CompletionFence = aggregateNode.CompletionFence;
+                    curr--;
+                }
+            }
+        }
 
-            if(nextBatchIdx == currBatchIdx && m_aggregateNodes[j].ForceSeparate)
-                ts.AddOutgoingEdge(m_aggregateNodes[i].TaskH, m_aggregateNodes[j].TaskH);
+        if (m_submissionWaitObj && aggregateNode.IsLast)
+        {
+            m_submissionWaitObj->Notify();
+            m_submissionWaitObj = nullptr;
         }
+}
+
+void RenderGraph::RecordBarriers(AggregateRenderNode& node, ComputeCmdList& cmdList)
+{
+    // All the transitions are batched into one call
+    D3D12_BARRIER_GROUP groups[2];
+    int numGroups = 0;
+
+    if (!node.TextureBarriers.empty())
+    {
+        groups[numGroups++] = BarrierGroup(node.TextureBarriers.data(),
+            (uint32_t)node.TextureBarriers.size());
     }
+
+    if (!node.BufferBarriers.empty())
+    {
+        groups[numGroups++] = BarrierGroup(node.BufferBarriers.data(),
+            (uint32_t)node.BufferBarriers.size());
+    }
+
+    if (numGroups)
+        cmdList.ResourceBarrier(groups, numGroups);
 }
 
 void RenderGraph::Sort(Span<SmallVector<RenderNodeHandle, App::FrameAllocator>> adjacentTailNodes)
 {
+    ZETA_CPU_EVENT_SCOPE("RenderGraph::Sort");
+
     const int numNodes = m_currRenderPassIdx.load(std::memory_order_relaxed);
     RenderNodeHandle sorted[MAX_NUM_RENDER_PASSES];
     int currIdx = 0;
@@ -643,7 +1065,10 @@ void RenderGraph::Sort(Span<SmallVector<RenderNodeHandle, App::FrameAllocator>>
 
 void RenderGraph::InsertResourceBarriers()
 {
+    ZETA_CPU_EVENT_SCOPE("RenderGraph::InsertResourceBarriers");
+
     const int numNodes = m_currRenderPassIdx.load(std::memory_order_relaxed);
+    const int numResources = m_lastResIdx.load(std::memory_order_relaxed);
 
     // Using ordering imposed by sorted, largest index of the node on the Direct/Compute queue with which 
     // a compute/Direct node has already synced (see case b below). Note that this is an index into "sorted"
@@ -658,19 +1083,52 @@ void RenderGraph::InsertResourceBarriers()
             &lastComputeQueueHandle;
     };
 
+    // Last node (in execution order) on each queue that accessed each resource in this frame,
+    // -1 when there wasn't any
+    SmallVector<int16, App::FrameAllocator> lastAccess[2];
+    lastAccess[0].resize(numResources, -1);
+    lastAccess[1].resize(numResources, -1);
+
+    struct Transition
+    {
+        int ResIdx;
+        D3D12_RESOURCE_STATES Before;
+        D3D12_RESOURCE_STATES After;
+        // All prior accesses in this frame were on the other queue and were covered by GPU sync
+        bool Handoff;
+        // When not -1, node that begins this transition as a split barrier
+        int16 SplitBeginNode;
+    };
+
+    // Transitions for all the nodes, range for node i is [transitionOffsets[i], transitionOffsets[i + 1])
+    SmallVector<Transition, App::FrameAllocator> transitions;
+    SmallVector<int, App::FrameAllocator> transitionOffsets;
+    transitionOffsets.resize(numNodes + 1, 0);
+
     // Workflow:
     // 
     // 1. For each input resource R:
     // 
-    //     - if R.state != expected --> add a barrier (e.g. RTV to SRV)
-    //     - if stateBefore(== R.state) is unsupported --> set hasUnsupportedBarriers
+    //     - if R.state != expected --> add a transition (e.g. RTV to SRV)
     //     - if producer is on a different queue, add a gpu sync, but only if an earlier
     //       task hasn't synced already (see cases below)
     //
     // 2. For each output resource R:
     // 
-    //         - if R.state != expected --> add a barrier (e.g. SRV to UAV)
-    //         - if stateBefore(== R.state) is unsupported --> set hasUnsupportedBarriers
+    //         - if R.state != expected --> add a transition (e.g. SRV to UAV)
+    //
+    // 3. Convert the transitions to enhanced barriers:
+    //
+    //         - read to read transitions that don't change the layout are skipped
+    //         - if all the prior accesses in this frame were on the other queue and the GPU
+    //           sync covers them, there's nothing to synchronize with -- only the layout (if
+    //           any) changes. Such handoffs don't need queue-specific stages and can be
+    //           recorded on the compute queue.
+    //         - if a barrier can't be recorded on the compute queue --> set hasUnsupportedBarriers
+    //           for all the async. compute nodes in that batch as they're recorded together
+    //         - if there are other batches on the direct queue between the last access and
+    //           current node, begin the transition as a split barrier right after the last
+    //           access so that the work in between hides its latency
 
     // Iterate by execution order (i.e. sorted by batch index)
     for (int currNode = 0; currNode < numNodes; currNode++)
@@ -678,6 +1136,8 @@ void RenderGraph::InsertResourceBarriers()
         RenderNode& node = m_renderNodes[currNode];
         const bool isAsyncCompute = node.Type == RENDER_NODE_TYPE::ASYNC_COMPUTE;
         RenderNodeHandle largestProducerSortedHandle;    // i.e. index in sorted (execution) order
+        const int firstTransition = (int)transitions.size();
+        transitionOffsets[currNode] = firstTransition;
 
         //
         // Inputs
@@ -693,12 +1153,7 @@ void RenderGraph::InsertResourceBarriers()
 
             if (!(inputResState & currInputRes.ExpectedState))
             {
-                // Unsupported stateAfter should've been caught earlier
-                node.HasUnsupportedBarrier = node.HasUnsupportedBarrier || 
-                    (isAsyncCompute && (inputResState & Constants::INVALID_COMPUTE_STATES));
-                node.Barriers.push_back(TransitionBarrier(m_frameResources[inputFrameResIdx].Res,
-                    inputResState,
-                    currInputRes.ExpectedState));
+                transitions.push_back({ (int)inputFrameResIdx, inputResState, currInputRes.ExpectedState, false, -1 });
 
                 // Update resource state
                 m_frameResources[inputFrameResIdx].State = currInputRes.ExpectedState;
@@ -769,36 +1224,183 @@ void RenderGraph::InsertResourceBarriers()
             Assert(outputFrameResIdx != size_t(-1), "Resource %llu was not found.", currOutputRes.ResID);
             const D3D12_RESOURCE_STATES outputResState = m_frameResources[outputFrameResIdx].State;
 
-            if (!skipBarrier && !(m_frameResources[outputFrameResIdx].State & currOutputRes.ExpectedState))
-            {
-                // Unsupported resourceAfter should've been caught earlier
-                node.HasUnsupportedBarrier = node.HasUnsupportedBarrier || 
-                    (isAsyncCompute && (outputResState & Constants::INVALID_COMPUTE_STATES));
-                node.Barriers.push_back(TransitionBarrier(m_frameResources[outputFrameResIdx].Res,
-                    outputResState,
-                    currOutputRes.ExpectedState));
-            }
+            if (!skipBarrier && !(outputResState & currOutputRes.ExpectedState))
+                transitions.push_back({ (int)outputFrameResIdx, outputResState, currOutputRes.ExpectedState, false, -1 });
 
             // Update the resource state
             m_frameResources[outputFrameResIdx].State = currOutputRes.ExpectedState;
         }
-    }
 
-    // Temporary solution; assumes that "someone" will transition backbuffer to Present state
-    int idx = FindFrameResource(App::GetRenderer().GetCurrentBackBuffer().ID());
-    //Assert(idx != -1, "Current backbuffer was not found in frame resources");
-    if(idx != -1)
-        m_frameResources[idx].State = D3D12_RESOURCE_STATE_PRESENT;
-}
+        const int queue = isAsyncCompute ? 1 : 0;
+        // Zero is the initial value, which doesn't necessarily mean a sync took place
+        const int lastSyncedOnOtherQueue = node.GpuDepSourceIdx.Val != -1 || *getLastSyncedIdx(node.Type) > 0 ?
+            *getLastSyncedIdx(node.Type) : -1;
 
-void RenderGraph::JoinRenderNodes()
-{
-    const int numNodes = m_currRenderPassIdx.load(std::memory_order_relaxed);
-    m_aggregateNodes.reserve(numNodes);
+        for (int t = firstTransition; t < (int)transitions.size(); t++)
+        {
+            const int resIdx = transitions[t].ResIdx;
+            const int prevOnOtherQueue = lastAccess[1 - queue][resIdx];
+            transitions[t].Handoff = lastAccess[queue][resIdx] == -1 && prevOnOtherQueue != -1 &&
+                prevOnOtherQueue <= lastSyncedOnOtherQueue;
+
+            // Split barriers are limited to the direct queue; the resource shouldn't be accessed
+            // by the other queue in between
+            const int prevOnThisQueue = lastAccess[queue][resIdx];
+            if (isAsyncCompute || prevOnThisQueue == -1 || prevOnOtherQueue > prevOnThisQueue)
+                continue;
 
-    int currBatchIdx = 0;
-    SmallVector<int, App::FrameAllocator, 16> nonAsyncComputeNodes;
-    SmallVector<int, App::FrameAllocator, 16> asyncComputeNodes;
+            // First node on the direct queue that comes after the last access's batch (barriers 
+            // are recorded before the work of each batch) and before current node's batch
+            const int prevBatchIdx = m_renderNodes[prevOnThisQueue].NodeBatchIdx;
+
+            for (int n = prevOnThisQueue + 1; n < currNode; n++)
+            {
+                const RenderNode& candidate = m_renderNodes[n];
+
+                if (candidate.Type != RENDER_NODE_TYPE::ASYNC_COMPUTE &&
+                    candidate.NodeBatchIdx > prevBatchIdx &&
+                    candidate.NodeBatchIdx < node.NodeBatchIdx)
+                {
+                    transitions[t].SplitBeginNode = (int16)n;
+                    break;
+                }
+            }
+        }
+
+        // Barriers for async. compute nodes are recorded on the direct queue when any of 
+        // them can't be expressed on the compute queue
+        if (isAsyncCompute)
+        {
+            for (int t = firstTransition; t < (int)transitions.size(); t++)
+            {
+                const BarrierScope before = GetBarrierScope(transitions[t].Before, true);
+                const BarrierScope after = GetBarrierScope(transitions[t].After, true);
+                Assert(after.ValidOnComputeQueue, "Unsupported stateAfter should've been caught earlier.");
+
+                const bool isBuffer = m_frameResources[transitions[t].ResIdx].IsBuffer;
+                const bool supported = (before.ValidOnComputeQueue || transitions[t].Handoff) &&
+                    (isBuffer || (IsComputeQueueLayout(before.Layout) && IsComputeQueueLayout(after.Layout)));
+
+                node.HasUnsupportedBarrier = node.HasUnsupportedBarrier || !supported;
+            }
+        }
+
+        for (Dependency& d : node.Inputs)
+        {
+            if (d.ResID >= DUMMY_RES::COUNT)
+                lastAccess[queue][FindFrameResource(d.ResID)] = (int16)currNode;
+        }
+
+        for (Dependency& d : node.Outputs)
+        {
+            if (d.ResID >= DUMMY_RES::COUNT)
+                lastAccess[queue][FindFrameResource(d.ResID)] = (int16)currNode;
+        }
+    }
+
+    transitionOffsets[numNodes] = (int)transitions.size();
+
+    // Async. compute nodes in the same batch end up in the same aggregate node (see JoinRenderNodes())
+    auto sharesAggregateNode = [](const RenderNode& a, const RenderNode& b)
+        {
+            return a.Type == RENDER_NODE_TYPE::ASYNC_COMPUTE && b.Type == RENDER_NODE_TYPE::ASYNC_COMPUTE &&
+                a.NodeBatchIdx == b.NodeBatchIdx && !a.ForceSeparateCmdList && !b.ForceSeparateCmdList;
+        };
+
+    for (int currNode = 0; currNode < numNodes; currNode++)
+    {
+        const RenderNode& node = m_renderNodes[currNode];
+        if (!node.HasUnsupportedBarrier)
+            continue;
+
+        for (int n = 0; n < numNodes; n++)
+        {
+            if (sharesAggregateNode(node, m_renderNodes[n]))
+                m_renderNodes[n].HasUnsupportedBarrier = true;
+        }
+    }
+
+    //
+    // Enhanced barriers
+    //
+    for (int currNode = 0; currNode < numNodes; currNode++)
+    {
+        RenderNode& node = m_renderNodes[currNode];
+        const bool onComputeQueue = node.Type == RENDER_NODE_TYPE::ASYNC_COMPUTE && 
+            !node.HasUnsupportedBarrier;
+
+        for (int i = transitionOffsets[currNode]; i < transitionOffsets[currNode + 1]; i++)
+        {
+            const Transition& t = transitions[i];
+            const BarrierScope before = GetBarrierScope(t.Before, onComputeQueue);
+            const BarrierScope after = GetBarrierScope(t.After, onComputeQueue);
+            const ResourceMetadata& res = m_frameResources[t.ResIdx];
+            const bool layoutChange = !res.IsBuffer && (before.Layout != after.Layout);
+
+            // No hazard and nothing to change
+            if (!(t.Before & WRITE_STATES) && !(t.After & WRITE_STATES) && !layoutChange)
+                continue;
+
+            // When recorded on the direct queue, prior accesses of async. compute nodes
+            // are on the same queue
+            const bool handoff = t.Handoff && (node.Type != RENDER_NODE_TYPE::ASYNC_COMPUTE || onComputeQueue);
+            const D3D12_BARRIER_SYNC syncBefore = handoff ? D3D12_BARRIER_SYNC_NONE : before.Sync;
+            const D3D12_BARRIER_ACCESS accessBefore = handoff ? D3D12_BARRIER_ACCESS_NO_ACCESS : before.Access;
+
+            // Access and layout for both halves of a split barrier have to match
+            if (t.SplitBeginNode != -1)
+            {
+                Assert(!handoff, "Split barriers are only used when there's a prior access on the same queue.");
+                RenderNode& beginNode = m_renderNodes[t.SplitBeginNode];
+
+                if (res.IsBuffer)
+                {
+                    beginNode.BufferBarriers.push_back(BufferBarrier(res.Res, before.Sync, 
+                        D3D12_BARRIER_SYNC_SPLIT, before.Access, after.Access));
+                    node.BufferBarriers.push_back(BufferBarrier(res.Res, D3D12_BARRIER_SYNC_SPLIT, 
+                        after.Sync, before.Access, after.Access));
+                }
+                else
+                {
+                    beginNode.TextureBarriers.push_back(TextureBarrier(res.Res, before.Sync, 
+                        D3D12_BARRIER_SYNC_SPLIT, before.Layout, after.Layout, before.Access, after.Access));
+                    node.TextureBarriers.push_back(TextureBarrier(res.Res, D3D12_BARRIER_SYNC_SPLIT, 
+                        after.Sync, before.Layout, after.Layout, before.Access, after.Access));
+                }
+
+                continue;
+            }
+
+            if (res.IsBuffer)
+            {
+                node.BufferBarriers.push_back(BufferBarrier(res.Res, syncBefore, after.Sync,
+                    accessBefore, after.Access));
+            }
+            else
+            {
+                node.TextureBarriers.push_back(TextureBarrier(res.Res, syncBefore, after.Sync,
+                    before.Layout, after.Layout, accessBefore, after.Access));
+            }
+        }
+    }
+
+    // Temporary solution; assumes that "someone" will transition backbuffer to Present state
+    int idx = FindFrameResource(App::GetRenderer().GetCurrentBackBuffer().ID());
+    //Assert(idx != -1, "Current backbuffer was not found in frame resources");
+    if(idx != -1)
+        m_frameResources[idx].State = D3D12_RESOURCE_STATE_PRESENT;
+}
+
+void RenderGraph::JoinRenderNodes()
+{
+    ZETA_CPU_EVENT_SCOPE("RenderGraph::JoinRenderNodes");
+
+    const int numNodes = m_currRenderPassIdx.load(std::memory_order_relaxed);
+    m_aggregateNodes.reserve(numNodes);
+
+    int currBatchIdx = 0;
+    SmallVector<int, App::FrameAllocator, 16> nonAsyncComputeNodes;
+    SmallVector<int, App::FrameAllocator, 16> asyncComputeNodes;
 
     auto insertAggRndrNode = [this, &nonAsyncComputeNodes, &asyncComputeNodes]()
     {
@@ -870,6 +1472,9 @@ void RenderGraph::JoinRenderNodes()
             currBatchIdx = m_renderNodes[currNode].NodeBatchIdx;
         }
 
+        if (m_renderNodes[currNode].Culled)
+            continue;
+
         if (m_renderNodes[currNode].ForceSeparateCmdList)
         {
             m_aggregateNodes.emplace_back(m_renderNodes[currNode].Type == RENDER_NODE_TYPE::ASYNC_COMPUTE);
@@ -891,13 +1496,17 @@ void RenderGraph::JoinRenderNodes()
             nonAsyncComputeNodes.push_back(currNode);
     }
 
-    insertAggRndrNode();
+    if (!nonAsyncComputeNodes.empty() || !asyncComputeNodes.empty())
+        insertAggRndrNode();
 
+    Assert(!m_aggregateNodes.empty(), "All the render nodes were culled.");
     m_aggregateNodes.back().IsLast = true;
 }
 
 void RenderGraph::MergeSmallNodes()
 {
+    ZETA_CPU_EVENT_SCOPE("RenderGraph::MergeSmallNodes");
+
     int currOffset = -1;
     int cmdListIdx = 0;
     int currCount = 0;
@@ -1006,6 +1615,468 @@ void RenderGraph::MergeSmallNodes()
 #endif
 }
 
+uint64_t RenderGraph::Fingerprint()
+{
+    const int numNodes = m_currRenderPassIdx.load(std::memory_order_relaxed);
+    const int numResources = m_lastResIdx.load(std::memory_order_relaxed);
+
+    SmallVector<uint64_t, App::FrameAllocator, 512> data;
+    data.push_back(numNodes);
+    data.push_back(numResources);
+    data.push_back(App::GetRenderer().GetCurrentBackBuffer().ID());
+
+    for (int currNode = 0; currNode < numNodes; currNode++)
+    {
+        const RenderNode& node = m_renderNodes[currNode];
+        data.push_back(XXH3_64bits(node.Name, strlen(node.Name)));
+        data.push_back(((uint64_t)node.Culled << 56) | ((uint64_t)node.Type << 48) | 
+            ((uint64_t)node.ForceSeparateCmdList << 32) | (node.Inputs.size() << 16) | node.Outputs.size());
+
+        for (const Dependency& d : node.Inputs)
+        {
+            data.push_back(d.ResID);
+            data.push_back(d.ExpectedState);
+        }
+
+        for (const Dependency& d : node.Outputs)
+        {
+            data.push_back(d.ResID);
+            data.push_back(d.ExpectedState);
+        }
+    }
+
+    // Includes the states at the start of this frame, which determine the barriers
+    for (int i = 0; i < numResources; i++)
+    {
+        const ResourceMetadata& res = m_frameResources[i];
+        data.push_back(res.ID);
+        data.push_back(reinterpret_cast<uint64_t>(res.Res));
+        data.push_back(res.State);
+    }
+
+    return XXH3_64bits(data.data(), data.size() * sizeof(uint64_t));
+}
+
+bool RenderGraph::ReplayCompiledGraph(uint64_t fingerprint)
+{
+    CompiledGraph* graph = nullptr;
+
+    for (auto& g : m_compiledGraphs)
+    {
+        if (g.NumNodes && g.Fingerprint == fingerprint)
+        {
+            graph = &g;
+            break;
+        }
+    }
+
+    if (!graph)
+        return false;
+
+    graph->LastUsed = m_numBuilds;
+    const int numNodes = graph->NumNodes;
+    Assert(numNodes == m_currRenderPassIdx.load(std::memory_order_relaxed), "Invalid compiled graph.");
+    Assert(graph->NumResources == m_lastResIdx.load(std::memory_order_relaxed), "Invalid compiled graph.");
+
+    // Shuffle into execution order (see Sort())
+    RenderNode tempRenderNodes[MAX_NUM_RENDER_PASSES];
+
+    for (int currNode = 0; currNode < numNodes; currNode++)
+    {
+        const int h = graph->Nodes[currNode].Handle.Val;
+        m_mapping[h] = RenderNodeHandle(currNode);
+        tempRenderNodes[currNode] = ZetaMove(m_renderNodes[h]);
+    }
+
+    for (int currNode = 0; currNode < numNodes; currNode++)
+    {
+        const CompiledRenderNode& compiled = graph->Nodes[currNode];
+        RenderNode& node = m_renderNodes[currNode];
+        node = ZetaMove(tempRenderNodes[currNode]);
+
+        node.NodeBatchIdx = compiled.NodeBatchIdx;
+        node.GpuDepSourceIdx = compiled.GpuDepSourceIdx;
+        node.OutputMask = compiled.OutputMask;
+        node.AggNodeIdx = compiled.AggNodeIdx;
+        node.HasUnsupportedBarrier = compiled.HasUnsupportedBarrier;
+        node.TextureBarriers.append_range(graph->TextureBarriers.begin() + compiled.TextureBarrierOffset,
+            graph->TextureBarriers.begin() + compiled.TextureBarrierOffset + compiled.NumTextureBarriers);
+        node.BufferBarriers.append_range(graph->BufferBarriers.begin() + compiled.BufferBarrierOffset,
+            graph->BufferBarriers.begin() + compiled.BufferBarrierOffset + compiled.NumBufferBarriers);
+    }
+
+    m_aggregateNodes.reserve(graph->AggregateNodes.size());
+
+    for (const CompiledAggregateNode& compiled : graph->AggregateNodes)
+    {
+        m_aggregateNodes.emplace_back(compiled.IsAsyncCompute);
+        AggregateRenderNode& aggNode = m_aggregateNodes.back();
+        aggNode.GpuDepIdx = compiled.GpuDepIdx;
+        aggNode.BatchIdx = compiled.BatchIdx;
+        aggNode.MergedCmdListIdx = compiled.MergedCmdListIdx;
+        aggNode.MergeStart = compiled.MergeStart;
+        aggNode.MergeEnd = compiled.MergeEnd;
+        aggNode.HasUnsupportedBarrier = compiled.HasUnsupportedBarrier;
+        aggNode.IsLast = compiled.IsLast;
+        aggNode.ForceSeparate = compiled.ForceSeparate;
+        memcpy(aggNode.Name, compiled.Name, AggregateRenderNode::MAX_NAME_LENGTH);
+    }
+
+    // Nodes were appended to their aggregate nodes in execution order. Delegates
+    // are taken from this frame's registration.
+    for (int currNode = 0; currNode < numNodes; currNode++)
+    {
+        const RenderNode& node = m_renderNodes[currNode];
+        if (node.Culled)
+            continue;
+
+        AggregateRenderNode& aggNode = m_aggregateNodes[node.AggNodeIdx];
+
+        aggNode.TextureBarriers.append_range(node.TextureBarriers.begin(), node.TextureBarriers.end());
+        aggNode.BufferBarriers.append_range(node.BufferBarriers.begin(), node.BufferBarriers.end());
+        aggNode.Dlgs.push_back(node.Dlg);
+        aggNode.DlgNames.push_back(node.Name);
+        aggNode.SubDlg = node.SubDlg;
+        aggNode.NumSubCmdLists = node.NumSubCmdLists;
+    }
+
+    for (int i = 0; i < graph->NumResources; i++)
+        m_frameResources[i].State = graph->FinalStates[i];
+
+    if (graph->NumMergedCmdLists)
+        m_mergedCmdLists.resize(graph->NumMergedCmdLists, nullptr);
+
+    return true;
+}
+
+void RenderGraph::CacheCompiledGraph(uint64_t fingerprint)
+{
+    // Replace the least recently used one
+    CompiledGraph* graph = &m_compiledGraphs[0];
+
+    for (auto& g : m_compiledGraphs)
+    {
+        if (g.LastUsed < graph->LastUsed)
+            graph = &g;
+    }
+
+    const int numNodes = m_currRenderPassIdx.load(std::memory_order_relaxed);
+    const int numResources = m_lastResIdx.load(std::memory_order_relaxed);
+
+    graph->Fingerprint = fingerprint;
+    graph->LastUsed = m_numBuilds;
+    graph->NumNodes = numNodes;
+    graph->NumResources = numResources;
+    graph->NumMergedCmdLists = 0;
+    graph->AggregateNodes.clear();
+    graph->TextureBarriers.clear();
+    graph->BufferBarriers.clear();
+
+    for (int h = 0; h < numNodes; h++)
+        graph->Nodes[m_mapping[h].Val].Handle = RenderNodeHandle(h);
+
+    for (int currNode = 0; currNode < numNodes; currNode++)
+    {
+        const RenderNode& node = m_renderNodes[currNode];
+        CompiledRenderNode& compiled = graph->Nodes[currNode];
+
+        compiled.GpuDepSourceIdx = node.GpuDepSourceIdx;
+        compiled.NodeBatchIdx = node.NodeBatchIdx;
+        compiled.OutputMask = node.OutputMask;
+        compiled.TextureBarrierOffset = (uint32_t)graph->TextureBarriers.size();
+        compiled.NumTextureBarriers = (uint16_t)node.TextureBarriers.size();
+        compiled.BufferBarrierOffset = (uint32_t)graph->BufferBarriers.size();
+        compiled.NumBufferBarriers = (uint16_t)node.BufferBarriers.size();
+        compiled.AggNodeIdx = node.AggNodeIdx;
+        compiled.HasUnsupportedBarrier = node.HasUnsupportedBarrier;
+
+        graph->TextureBarriers.append_range(node.TextureBarriers.begin(), node.TextureBarriers.end());
+        graph->BufferBarriers.append_range(node.BufferBarriers.begin(), node.BufferBarriers.end());
+    }
+
+    graph->AggregateNodes.reserve(m_aggregateNodes.size());
+
+    for (const AggregateRenderNode& aggNode : m_aggregateNodes)
+    {
+        graph->AggregateNodes.emplace_back();
+        CompiledAggregateNode& compiled = graph->AggregateNodes.back();
+        compiled.GpuDepIdx = aggNode.GpuDepIdx;
+        compiled.BatchIdx = aggNode.BatchIdx;
+        compiled.MergedCmdListIdx = aggNode.MergedCmdListIdx;
+        compiled.MergeStart = aggNode.MergeStart;
+        compiled.MergeEnd = aggNode.MergeEnd;
+        compiled.IsAsyncCompute = aggNode.IsAsyncCompute;
+        compiled.HasUnsupportedBarrier = aggNode.HasUnsupportedBarrier;
+        compiled.IsLast = aggNode.IsLast;
+        compiled.ForceSeparate = aggNode.ForceSeparate;
+        memcpy(compiled.Name, aggNode.Name, AggregateRenderNode::MAX_NAME_LENGTH);
+
+        graph->NumMergedCmdLists = Math::Max(graph->NumMergedCmdLists, aggNode.MergedCmdListIdx + 1);
+    }
+
+    for (int i = 0; i < numResources; i++)
+        graph->FinalStates[i] = m_frameResources[i].State;
+}
+
+void RenderGraph::ApplyAsyncComputePlacement()
+{
+    const int numNodes = m_currRenderPassIdx.load(std::memory_order_relaxed);
+
+    for (int currNode = 0; currNode < numNodes; currNode++)
+    {
+        RenderNode& node = m_renderNodes[currNode];
+        if (node.Type != RENDER_NODE_TYPE::COMPUTE || node.Culled)
+            continue;
+
+        // Resources that can't be accessed on the compute queue rule out the async. 
+        // compute queue
+        auto isEligible = [](const Dependency& d)
+            {
+                return d.ResID < DUMMY_RES::COUNT || 
+                    !(d.ExpectedState & Constants::INVALID_COMPUTE_STATES);
+            };
+
+        node.IsAsyncCandidate = true;
+
+        for (const Dependency& d : node.Inputs)
+            node.IsAsyncCandidate = node.IsAsyncCandidate && isEligible(d);
+
+        for (const Dependency& d : node.Outputs)
+            node.IsAsyncCandidate = node.IsAsyncCandidate && isEligible(d);
+
+        if (!node.IsAsyncCandidate)
+            continue;
+
+        const uint64_t h = XXH3_64bits(node.Name, strlen(node.Name));
+
+        for (uint64_t asyncNode : m_asyncNodes)
+        {
+            if (asyncNode == h)
+            {
+                node.Type = RENDER_NODE_TYPE::ASYNC_COMPUTE;
+                break;
+            }
+        }
+    }
+}
+
+void RenderGraph::AccumulateNodeTimings()
+{
+    auto& gpuTimer = App::GetRenderer().GetGpuTimer();
+    auto timings = gpuTimer.GetFrameTimings();
+    const uint64_t resolvedFrame = gpuTimer.GetNumResolvedFrames();
+    const size_t prefixLen = strlen(NODE_TIMING_PREFIX);
+
+    // Nothing new since last time
+    if (timings.empty() || resolvedFrame == m_lastTimedFrame)
+        return;
+
+    m_lastTimedFrame = resolvedFrame;
+
+    for (const GpuTimer::Timing& t : timings)
+    {
+        if (strncmp(t.Name, NODE_TIMING_PREFIX, prefixLen) != 0)
+            continue;
+
+        const char* nodeName = t.Name + prefixLen;
+        const uint64_t h = XXH3_64bits(nodeName, strlen(nodeName));
+        NodeTiming* timing = nullptr;
+
+        for (auto& nt : m_nodeTimings)
+        {
+            if (nt.NameHash == h)
+            {
+                timing = &nt;
+                break;
+            }
+        }
+
+        if (!timing)
+        {
+            m_nodeTimings.emplace_back();
+            timing = &m_nodeTimings.back();
+            memset(timing, 0, sizeof(NodeTiming));
+            timing->NameHash = h;
+
+            const int n = Math::Min((int)strlen(nodeName), RenderNode::MAX_NAME_LENGTH - 1);
+            memcpy(timing->Name, nodeName, n);
+            timing->Name[n] = '\0';
+        }
+
+        timing->History[timing->NextHistIdx] = (float)t.Delta;
+        timing->NextHistIdx = (timing->NextHistIdx + 1) % NodeTiming::HISTORY_LEN;
+        timing->NumHist = Math::Min(timing->NumHist + 1, NodeTiming::HISTORY_LEN);
+        timing->LastSeen = resolvedFrame;
+        timing->Sum += t.Delta;
+        timing->Count++;
+
+        if (t.HasPipelineStats)
+        {
+            timing->CSInvocations = t.PipelineStats.CSInvocations;
+            timing->PSInvocations = t.PipelineStats.PSInvocations;
+        }
+    }
+
+    m_numTimedFrames++;
+}
+
+void RenderGraph::ReportNodeStats()
+{
+    for (const NodeTiming& nt : m_nodeTimings)
+    {
+        // Node wasn't part of the last resolved frame
+        if (nt.LastSeen != m_lastTimedFrame || nt.NumHist == 0)
+            continue;
+
+        float sorted[NodeTiming::HISTORY_LEN];
+        memcpy(sorted, nt.History, sizeof(float) * nt.NumHist);
+        std::sort(sorted, sorted + nt.NumHist);
+
+        float sum = 0.0f;
+        for (int i = 0; i < nt.NumHist; i++)
+            sum += sorted[i];
+
+        const int p95Idx = Math::Max((int)ceilf(0.95f * nt.NumHist) - 1, 0);
+        char name[48];
+
+        stbsp_snprintf(name, sizeof(name), "%s min (ms)", nt.Name);
+        App::AddFrameStat("Render Graph", name, sorted[0]);
+        stbsp_snprintf(name, sizeof(name), "%s avg (ms)", nt.Name);
+        App::AddFrameStat("Render Graph", name, sum / nt.NumHist);
+        stbsp_snprintf(name, sizeof(name), "%s p95 (ms)", nt.Name);
+        App::AddFrameStat("Render Graph", name, sorted[p95Idx]);
+
+        if (nt.CSInvocations)
+        {
+            stbsp_snprintf(name, sizeof(name), "%s CS invocations", nt.Name);
+            App::AddFrameStat("Render Graph", name, nt.CSInvocations);
+        }
+
+        if (nt.PSInvocations)
+        {
+            stbsp_snprintf(name, sizeof(name), "%s PS invocations", nt.Name);
+            App::AddFrameStat("Render Graph", name, nt.PSInvocations);
+        }
+    }
+}
+
+void RenderGraph::UpdateAsyncComputePlacement()
+{
+    if (m_numTimedFrames < ASYNC_PLACEMENT_WINDOW)
+        return;
+
+    const int numNodes = m_currRenderPassIdx.load(std::memory_order_relaxed);
+
+    // Average GPU duration of each node (in execution order) in ms, -1 when unknown
+    float duration[MAX_NUM_RENDER_PASSES];
+
+    for (int currNode = 0; currNode < numNodes; currNode++)
+    {
+        const RenderNode& node = m_renderNodes[currNode];
+        const uint64_t h = XXH3_64bits(node.Name, strlen(node.Name));
+        duration[currNode] = -1.0f;
+
+        for (auto& nt : m_nodeTimings)
+        {
+            if (nt.NameHash == h && nt.Count)
+            {
+                duration[currNode] = float(nt.Sum / nt.Count);
+                break;
+            }
+        }
+    }
+
+    // Nodes in each batch don't depend on each other, so roughly, each batch takes as long 
+    // as the busier queue, while every node on the async. compute queue adds a cross-queue
+    // sync. Candidates are greedily moved to the async. compute queue (largest first) as 
+    // long as that shortens the batch.
+    float currFrameEstimate = 0.0f;
+    float newFrameEstimate = 0.0f;
+    SmallVector<uint64_t> newAsyncNodes;
+
+    int batchBeg = 0;
+
+    while (batchBeg < numNodes)
+    {
+        const int batchIdx = m_renderNodes[batchBeg].NodeBatchIdx;
+        int batchEnd = batchBeg;
+
+        while (batchEnd < numNodes && m_renderNodes[batchEnd].NodeBatchIdx == batchIdx)
+            batchEnd++;
+
+        float currDirect = 0.0f;
+        float currAsync = 0.0f;
+        float fixedDirect = 0.0f;
+        float fixedAsync = 0.0f;
+        int candidates[MAX_NUM_RENDER_PASSES];
+        int numCandidates = 0;
+
+        for (int n = batchBeg; n < batchEnd; n++)
+        {
+            const RenderNode& node = m_renderNodes[n];
+            const float d = Math::Max(duration[n], 0.0f);
+            const bool isAsync = node.Type == RENDER_NODE_TYPE::ASYNC_COMPUTE;
+
+            currDirect += !isAsync ? d : 0.0f;
+            currAsync += isAsync ? d + (node.IsAsyncCandidate ? CROSS_QUEUE_SYNC_COST : 0.0f) : 0.0f;
+
+            if (node.IsAsyncCandidate && duration[n] > 0.0f)
+                candidates[numCandidates++] = n;
+            else if (isAsync)
+                fixedAsync += d;
+            else
+                fixedDirect += d;
+        }
+
+        std::sort(candidates, candidates + numCandidates, [&duration](int lhs, int rhs)
+            {
+                return duration[lhs] > duration[rhs];
+            });
+
+        float newDirect = fixedDirect;
+        for (int c = 0; c < numCandidates; c++)
+            newDirect += duration[candidates[c]];
+
+        float newAsync = fixedAsync;
+
+        for (int c = 0; c < numCandidates; c++)
+        {
+            const float d = duration[candidates[c]];
+            const float movedDirect = newDirect - d;
+            const float movedAsync = newAsync + d + CROSS_QUEUE_SYNC_COST;
+
+            if (Math::Max(movedDirect, movedAsync) < Math::Max(newDirect, newAsync))
+            {
+                newDirect = movedDirect;
+                newAsync = movedAsync;
+
+                const RenderNode& node = m_renderNodes[candidates[c]];
+                newAsyncNodes.push_back(XXH3_64bits(node.Name, strlen(node.Name)));
+            }
+        }
+
+        currFrameEstimate += Math::Max(currDirect, currAsync);
+        newFrameEstimate += Math::Max(newDirect, newAsync);
+        batchBeg = batchEnd;
+    }
+
+    // Avoid flip-flopping between placements with similar costs
+    if (newFrameEstimate < currFrameEstimate - ASYNC_PLACEMENT_HYSTERESIS)
+    {
+        m_asyncNodes.clear();
+        m_asyncNodes.append_range(newAsyncNodes.begin(), newAsyncNodes.end());
+    }
+
+    // Durations change after moving between queues
+    for (auto& nt : m_nodeTimings)
+    {
+        nt.Sum = 0.0;
+        nt.Count = 0;
+    }
+
+    m_numTimedFrames = 0;
+}
+
 uint64_t RenderGraph::GetCompletionFence(RenderNodeHandle h)
 {
     Assert(h.IsValid(), "invalid handle.");
@@ -1031,6 +2102,315 @@ void RenderGraph::SetFrameSubmissionWaitObj(Support::WaitObject& waitObj)
     m_submissionWaitObj = &waitObj;
 }
 
+void RenderGraph::SetNodeProfiling(bool enable)
+{
+    m_profileNodes = enable;
+}
+
+void RenderGraph::SetAutoAsyncCompute(bool enable)
+{
+    m_autoAsyncCompute = enable;
+
+    // Start over with the registered node types
+    for (auto& nt : m_nodeTimings)
+    {
+        nt.Sum = 0.0;
+        nt.Count = 0;
+    }
+
+    m_asyncNodes.clear();
+    m_numTimedFrames = 0;
+}
+
+void RenderGraph::BeginPassBenchmark(const char* nodeName, int numRepsPerFrame)
+{
+    Assert(!m_inBeginEndBlock, "Invalid call.");
+    Assert(numRepsPerFrame > 0 && numRepsPerFrame <= MAX_PASS_BENCHMARK_REPS_PER_FRAME, 
+        "Invalid number of replays per frame.");
+
+    PassBenchmark& pb = m_passBenchmark;
+    const int n = Math::Min((int)strlen(nodeName), RenderNode::MAX_NAME_LENGTH - 1);
+    memcpy(pb.NodeName, nodeName, n);
+    pb.NodeName[n] = '\0';
+
+    pb.Node = nullptr;
+    pb.NumRepsPerFrame = numRepsPerFrame;
+    pb.Samples.clear();
+    pb.LastResolvedFrame = App::GetRenderer().GetGpuTimer().GetNumResolvedFrames();
+    pb.NumFramesToSkip = Constants::NUM_BACK_BUFFERS + 1;
+    pb.Active = true;
+    pb.Captured = false;
+    pb.Warned = false;
+}
+
+void RenderGraph::EndPassBenchmark()
+{
+    Assert(!m_inBeginEndBlock, "Invalid call.");
+
+    PassBenchmark& pb = m_passBenchmark;
+    pb.Active = false;
+    pb.Captured = false;
+    pb.Node = nullptr;
+    pb.NumResources = 0;
+
+    for (auto& r : pb.Resources)
+    {
+        r.SnapshotBuffer.Reset();
+        r.SnapshotTexture.Reset();
+    }
+}
+
+void RenderGraph::PreparePassBenchmark()
+{
+    PassBenchmark& pb = m_passBenchmark;
+    pb.Node = nullptr;
+
+    const int numNodes = m_currRenderPassIdx.load(std::memory_order_relaxed);
+    const RenderNode* node = nullptr;
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        if (!m_renderNodes[i].Culled && strcmp(m_renderNodes[i].Name, pb.NodeName) == 0)
+        {
+            node = &m_renderNodes[i];
+            break;
+        }
+    }
+
+    if (!node || node->NumSubCmdLists > 1)
+    {
+        if (!pb.Warned)
+        {
+            if (node)
+            {
+                LOG_UI_WARNING("Pass benchmark: render node %s records into multiple command lists, "
+                    "which isn't supported.", pb.NodeName);
+            }
+            else
+                LOG_UI_WARNING("Pass benchmark: render node %s wasn't found or was culled.", pb.NodeName);
+
+            pb.Warned = true;
+        }
+
+        return;
+    }
+
+    // Declared resources of this frame, in declaration order
+    ID3D12Resource* resources[MAX_NUM_PASS_BENCHMARK_RESOURCES];
+    D3D12_RESOURCE_STATES states[MAX_NUM_PASS_BENCHMARK_RESOURCES];
+    int numResources = 0;
+
+    auto add = [this, &resources, &states, &numResources](const Dependency& dep)
+        {
+            const int idx = FindFrameResource(dep.ResID);
+            ID3D12Resource* res = idx != -1 ? m_frameResources[idx].Res : nullptr;
+
+            // Acceleration structures can't be copied
+            if (!res || (dep.ExpectedState & D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE))
+                return;
+
+            const D3D12_RESOURCE_DESC desc = res->GetDesc();
+            const bool supported = desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ||
+                desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ||
+                (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D && desc.DepthOrArraySize == 1 && 
+                    desc.SampleDesc.Count == 1);
+            if (!supported)
+                return;
+
+            // Resources that are both input and output keep their input state, see Build()
+            for (int i = 0; i < numResources; i++)
+            {
+                if (resources[i] == res)
+                    return;
+            }
+
+            Check(numResources < MAX_NUM_PASS_BENCHMARK_RESOURCES, "Pass benchmark: number of "
+                "resources exceeded MAX_NUM_PASS_BENCHMARK_RESOURCES.");
+            resources[numResources] = res;
+            states[numResources++] = dep.ExpectedState;
+        };
+
+    for (const Dependency& dep : node->Inputs)
+        add(dep);
+    for (const Dependency& dep : node->Outputs)
+        add(dep);
+
+    auto sameDesc = [](const D3D12_RESOURCE_DESC& a, const D3D12_RESOURCE_DESC& b)
+        {
+            return a.Dimension == b.Dimension && a.Width == b.Width && a.Height == b.Height &&
+                a.DepthOrArraySize == b.DepthOrArraySize && a.MipLevels == b.MipLevels && 
+                a.Format == b.Format;
+        };
+
+    // Resources were recreated (e.g. after a resize) or the declarations changed
+    if (pb.Captured && numResources != pb.NumResources)
+        pb.Captured = false;
+
+    for (int i = 0; i < numResources && pb.Captured; i++)
+    {
+        if (!sameDesc(resources[i]->GetDesc(), pb.Resources[i].Snapshot()->GetDesc()))
+            pb.Captured = false;
+    }
+
+    if (!pb.Captured)
+    {
+        for (int i = 0; i < numResources; i++)
+        {
+            PassBenchmarkResource& r = pb.Resources[i];
+            const D3D12_RESOURCE_DESC desc = resources[i]->GetDesc();
+
+            if (r.Snapshot() && sameDesc(desc, r.Snapshot()->GetDesc()))
+                continue;
+
+            r.SnapshotBuffer.Reset();
+            r.SnapshotTexture.Reset();
+            r.SnapshotIsCopySource = false;
+
+            StackStr(name, n, "PassBenchmark_%d", i);
+
+            if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+            {
+                Check(desc.Width <= UINT32_MAX, "Pass benchmark: buffer is too large.");
+                r.SnapshotBuffer = GpuMemory::GetDefaultHeapBuffer(name, (uint32_t)desc.Width,
+                    D3D12_RESOURCE_STATE_COPY_DEST, false);
+            }
+            else if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D)
+            {
+                r.SnapshotTexture = GpuMemory::GetTexture2D(name, desc.Width, desc.Height, desc.Format,
+                    D3D12_RESOURCE_STATE_COPY_DEST, 0, desc.MipLevels);
+            }
+            else
+            {
+                r.SnapshotTexture = GpuMemory::GetTexture3D(name, desc.Width, desc.Height, 
+                    desc.DepthOrArraySize, desc.Format, D3D12_RESOURCE_STATE_COPY_DEST, 0, desc.MipLevels);
+            }
+        }
+
+        for (int i = numResources; i < pb.NumResources; i++)
+        {
+            pb.Resources[i].SnapshotBuffer.Reset();
+            pb.Resources[i].SnapshotTexture.Reset();
+        }
+    }
+
+    for (int i = 0; i < numResources; i++)
+    {
+        pb.Resources[i].Res = resources[i];
+        pb.Resources[i].State = states[i];
+    }
+
+    pb.NumResources = numResources;
+    pb.Node = node->Name;
+}
+
+void RenderGraph::RecordPassBenchmark(ComputeCmdList& cmdList, fastdelegate::FastDelegate1<CommandList&>& dlg)
+{
+    PassBenchmark& pb = m_passBenchmark;
+    D3D12_RESOURCE_BARRIER barriers[MAX_NUM_PASS_BENCHMARK_RESOURCES * 2];
+    int numBarriers = 0;
+
+    // Legacy barriers are fine here since render graph only uses layouts that are 
+    // compatible with legacy states
+    auto transition = [&barriers, &numBarriers](ID3D12Resource* res, D3D12_RESOURCE_STATES before,
+        D3D12_RESOURCE_STATES after)
+        {
+            if (before != after)
+                barriers[numBarriers++] = Direct3DUtil::TransitionBarrier(res, before, after);
+        };
+
+    auto flush = [&cmdList, &barriers, &numBarriers]()
+        {
+            if (numBarriers)
+                cmdList.ResourceBarrier(barriers, numBarriers);
+
+            numBarriers = 0;
+        };
+
+    if (!pb.Captured)
+    {
+        for (int i = 0; i < pb.NumResources; i++)
+        {
+            transition(pb.Resources[i].Res, pb.Resources[i].State, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+            // Snapshot is being reused from an earlier capture
+            if (pb.Resources[i].SnapshotIsCopySource)
+            {
+                transition(pb.Resources[i].Snapshot(), D3D12_RESOURCE_STATE_COPY_SOURCE, 
+                    D3D12_RESOURCE_STATE_COPY_DEST);
+            }
+        }
+        flush();
+
+        for (int i = 0; i < pb.NumResources; i++)
+            cmdList.CopyResource(pb.Resources[i].Snapshot(), pb.Resources[i].Res);
+
+        // Snapshots stay in copy source state from here on
+        for (int i = 0; i < pb.NumResources; i++)
+        {
+            transition(pb.Resources[i].Res, D3D12_RESOURCE_STATE_COPY_SOURCE, pb.Resources[i].State);
+            transition(pb.Resources[i].Snapshot(), D3D12_RESOURCE_STATE_COPY_DEST, 
+                D3D12_RESOURCE_STATE_COPY_SOURCE);
+            pb.Resources[i].SnapshotIsCopySource = true;
+        }
+        flush();
+
+        pb.Captured = true;
+    }
+
+    auto& gpuTimer = App::GetRenderer().GetGpuTimer();
+    char queryName[GpuTimer::Timing::MAX_NAME_LENGTH];
+    stbsp_snprintf(queryName, sizeof(queryName), "%s%s", PASS_BENCHMARK_TIMING_PREFIX, pb.NodeName);
+
+    for (int rep = 0; rep < pb.NumRepsPerFrame; rep++)
+    {
+        for (int i = 0; i < pb.NumResources; i++)
+            transition(pb.Resources[i].Res, pb.Resources[i].State, D3D12_RESOURCE_STATE_COPY_DEST);
+        flush();
+
+        for (int i = 0; i < pb.NumResources; i++)
+            cmdList.CopyResource(pb.Resources[i].Res, pb.Resources[i].Snapshot());
+
+        for (int i = 0; i < pb.NumResources; i++)
+            transition(pb.Resources[i].Res, D3D12_RESOURCE_STATE_COPY_DEST, pb.Resources[i].State);
+        flush();
+
+        // Restore is excluded from the timing
+        const uint32_t queryIdx = gpuTimer.BeginQuery(cmdList, queryName);
+        dlg(cmdList);
+        gpuTimer.EndQuery(cmdList, queryIdx);
+    }
+}
+
+void RenderGraph::CollectPassBenchmarkTimings()
+{
+    PassBenchmark& pb = m_passBenchmark;
+    auto& gpuTimer = App::GetRenderer().GetGpuTimer();
+    const uint64_t resolvedFrame = gpuTimer.GetNumResolvedFrames();
+
+    if (resolvedFrame == pb.LastResolvedFrame)
+        return;
+
+    pb.LastResolvedFrame = resolvedFrame;
+
+    // Frames that were in flight when the benchmark (re)started
+    if (pb.NumFramesToSkip > 0)
+    {
+        pb.NumFramesToSkip--;
+        return;
+    }
+
+    const size_t prefixLen = strlen(PASS_BENCHMARK_TIMING_PREFIX);
+
+    for (const GpuTimer::Timing& t : gpuTimer.GetFrameTimings())
+    {
+        if (strncmp(t.Name, PASS_BENCHMARK_TIMING_PREFIX, prefixLen) == 0 && 
+            strcmp(t.Name + prefixLen, pb.NodeName) == 0)
+        {
+            pb.Samples.push_back((float)t.Delta);
+        }
+    }
+}
+
 uint64_t RenderGraph::GetFrameCompletionFence()
 {
     Assert(!m_inBeginEndBlock, "Invalid call.");
@@ -1113,24 +2493,40 @@ void RenderGraph::DebugDrawGraph()
         ImNodes::BeginNodeTitleBar();
         ImGui::Text("\t%d. %s, Batch: %d, (GPU dep %d) %s", currNode, m_renderNodes[currNode].Name,
             m_renderNodes[currNode].NodeBatchIdx, m_renderNodes[currNode].GpuDepSourceIdx.Val, 
-            m_renderNodes[currNode].Type == RENDER_NODE_TYPE::ASYNC_COMPUTE ? "[Async Compute]" : "");
+            m_renderNodes[currNode].Culled ? "[Culled]" : 
+            (m_renderNodes[currNode].Type == RENDER_NODE_TYPE::ASYNC_COMPUTE ? "[Async Compute]" : ""));
         ImNodes::EndNodeTitleBar();
 
 #ifndef NDEBUG
-        if(m_renderNodes[currNode].Barriers.empty())
+        const RenderNode& n = m_renderNodes[currNode];
+
+        if(n.TextureBarriers.empty() && n.BufferBarriers.empty())
             ImGui::Text("");
         else
         {
-            for (auto b : m_renderNodes[currNode].Barriers)
+            auto getName = [](ID3D12Resource* res, char* buff, UINT n)
+                {
+                    CheckHR(res->GetPrivateData(WKPDID_D3DDebugObjectName, &n, buff));
+                };
+
+            for (auto& b : n.TextureBarriers)
             {
                 char buff[64] = { '\0' };
-                UINT n = sizeof(buff);
-                CheckHR(b.Transition.pResource->GetPrivateData(WKPDID_D3DDebugObjectName, &n, buff));
+                getName(b.pResource, buff, sizeof(buff));
 
                 ImGui::Text("\t\tRes: %s\n\tBefore: %s\nAfter: %s",
                     buff,
-                    GetResStateName(b.Transition.StateBefore),
-                    GetResStateName(b.Transition.StateAfter));
+                    GetLayoutName(b.LayoutBefore),
+                    GetLayoutName(b.LayoutAfter));
+            }
+
+            for (auto& b : n.BufferBarriers)
+            {
+                char buff[64] = { '\0' };
+                getName(b.pResource, buff, sizeof(buff));
+
+                ImGui::Text("\t\tRes: %s\n\tBefore: 0x%x\nAfter: 0x%x",
+                    buff, b.AccessBefore, b.AccessAfter);
             }
         }
 #else
@@ -1173,7 +2569,8 @@ void RenderGraph::DebugDrawGraph()
 
             ImNodes::SetNodeEditorSpacePos(currNode, ImVec2(x, y));
 
-            numBarriersInBatch += (int)m_renderNodes[currNode].Barriers.size();
+            numBarriersInBatch += (int)(m_renderNodes[currNode].TextureBarriers.size() + 
+                m_renderNodes[currNode].BufferBarriers.size());
         }
             //ImNodes::SetNodeScreenSpacePos(currNode, ImVec2(currBatchIdx * 400.0f, 50.0f + idxInBatch++ * 150.0f));
             //ImNodes::SetNodeGridSpacePos(currNode, ImVec2(currBatchIdx * 400.0f, 50.0f + idxInBatch++ * 150.0f));
@@ -1252,16 +2649,28 @@ void RenderGraph::Log()
             node.GpuDepIdx.Val != -1 ? m_aggregateNodes[node.GpuDepIdx.Val].Name : "None");
         formattedRenderGraph += temp;
 
-        for (auto& b : node.Barriers)
+        for (auto& b : node.TextureBarriers)
         {
             char buff[64] = { '\0' };
             UINT n = sizeof(buff);
-            CheckHR(b.Transition.pResource->GetPrivateData(WKPDID_D3DDebugObjectName, &n, buff));
+            CheckHR(b.pResource->GetPrivateData(WKPDID_D3DDebugObjectName, &n, buff));
 
             stbsp_snprintf(temp, sizeof(temp), "\t\tRes: %s, Before: %s, After: %s\n",
                 buff,
-                GetResStateName(b.Transition.StateBefore),
-                GetResStateName(b.Transition.StateAfter));
+                GetLayoutName(b.LayoutBefore),
+                GetLayoutName(b.LayoutAfter));
+
+            formattedRenderGraph += temp;
+        }
+
+        for (auto& b : node.BufferBarriers)
+        {
+            char buff[64] = { '\0' };
+            UINT n = sizeof(buff);
+            CheckHR(b.pResource->GetPrivateData(WKPDID_D3DDebugObjectName, &n, buff));
+
+            stbsp_snprintf(temp, sizeof(temp), "\t\tRes: %s, Access before: 0x%x, Access after: 0x%x\n",
+                buff, b.AccessBefore, b.AccessAfter);
 
             formattedRenderGraph += temp;
         }
@@ -1,16 +1,12 @@
 #pragma once
 
 #include "Direct3DUtil.h"
+#include "GpuMemory.h"
 #include "../Utility/Span.h"
+#include "../Support/Task.h"
 #include <FastDelegate/FastDelegate.h>
 #include <atomic>
 
-namespace ZetaRay::Support
-{
-    struct TaskSet;
-    struct WaitObject;
-}
-
 namespace ZetaRay::Core
 {
     class CommandList;
@@ -52,6 +48,10 @@ namespace ZetaRay::Core
     // 5. Barrier
     // 6. Build a DAG based on the resource dependencies
     // 7. Submit command lists to GPU
+    //
+    // Step 6 only runs when the registered nodes, resources and dependencies (along 
+    // with the resource states at the start of the frame) differ from those of the recently 
+    // compiled graphs. Otherwise, the cached schedule is replayed.
 
     class RenderGraph
     {
@@ -81,6 +81,21 @@ namespace ZetaRay::Core
         RenderNodeHandle RegisterRenderPass(const char* name, RENDER_NODE_TYPE t, 
             fastdelegate::FastDelegate1<CommandList&> dlg,
             bool forceSeparateCmdList = false);
+        // Adds a node whose recording is split among numSubCmdLists command lists. The
+        // delegate is called once for each index in [0, numSubCmdLists) -- index 0 is
+        // recorded first (and may be used to set up per-frame state), after which the rest
+        // are recorded in parallel from worker threads. Command lists are submitted in index
+        // order. Such nodes always get a separate command list.
+        RenderNodeHandle RegisterRenderPass(const char* name, RENDER_NODE_TYPE t, 
+            fastdelegate::FastDelegate2<CommandList&, int> dlg,
+            int numSubCmdLists);
+
+        // Nodes whose outputs aren't consumed -- directly or indirectly -- by the node that 
+        // writes to the backbuffer are culled: they're not recorded and get no barriers or 
+        // GPU syncs. Resources that were read in the last few frames (e.g. temporal history)
+        // count as consumed. Nodes with side effects that aren't visible to render graph 
+        // (e.g. readbacks) should be excluded from culling by calling this after registration.
+        void KeepAlive(RenderNodeHandle h);
 
         // Registers a new resource. This must be called prior to declaring resource 
         // dependencies in each frame.
@@ -117,18 +132,72 @@ namespace ZetaRay::Core
 
         void SetFrameSubmissionWaitObj(Support::WaitObject& waitObj);
 
+        // When enabled (default), every render node is wrapped in timestamp and pipeline 
+        // statistics queries. Min/average/95th percentile GPU durations over the recent 
+        // frames are reported as frame stats.
+        void SetNodeProfiling(bool enable);
+        ZetaInline bool IsNodeProfilingEnabled() const { return m_profileNodes; }
+        // GpuTimer queries of render nodes are named <NODE_TIMING_PREFIX><node name>
+        static constexpr const char* NODE_TIMING_PREFIX = "RG_";
+
+        // When enabled, GPU duration of every render node is measured and compute nodes
+        // are moved to the async. compute queue whenever that's estimated to shorten the
+        // frame. Placement is reevaluated every ASYNC_PLACEMENT_WINDOW frames.
+        void SetAutoAsyncCompute(bool enable);
+        ZetaInline bool IsAutoAsyncComputeEnabled() const { return m_autoAsyncCompute; }
+
+        // Replays the render node with the given name numRepsPerFrame times in every frame 
+        // with fixed inputs, so that its GPU cost can be measured in isolation. On the first 
+        // frame, resources that the node declared with AddInput() and AddOutput() are copied
+        // into snapshots, which are then copied back before every replay. Resources are 
+        // matched by declaration order, so double-buffered resources that swap every frame 
+        // still see the captured contents. Resources that aren't declared (e.g. scene 
+        // buffers and acceleration structures) aren't captured and should stay unchanged. 
+        // Nodes with sub command lists aren't supported. Node timing is paused meanwhile.
+        void BeginPassBenchmark(const char* nodeName, int numRepsPerFrame);
+        void EndPassBenchmark();
+        ZetaInline bool IsPassBenchmarkActive() const { return m_passBenchmark.Active; }
+        // GPU durations (ms) of the replays that have been resolved so far
+        ZetaInline Util::Span<float> GetPassBenchmarkSamples() const { return m_passBenchmark.Samples; }
+        // GpuTimer queries of replays are named <PASS_BENCHMARK_TIMING_PREFIX><node name>
+        static constexpr const char* PASS_BENCHMARK_TIMING_PREFIX = "PB_";
+        static constexpr int MAX_PASS_BENCHMARK_REPS_PER_FRAME = 16;
+
     private:
         static constexpr uint16_t INVALID_NODE_HANDLE = UINT16_MAX;
         static constexpr int MAX_NUM_RENDER_PASSES = 32;
         static constexpr int MAX_NUM_RESOURCES = 64;
         static constexpr int MAX_NUM_PRODUCERS = 5;
+        // Double-buffered resources and back buffers alternate between a few graphs
+        static constexpr int MAX_NUM_CACHED_GRAPHS = 8;
+        static constexpr int MAX_NUM_SUB_CMD_LISTS = 8;
+        // Automatic async. compute placement
+        static constexpr int ASYNC_PLACEMENT_WINDOW = 64;
+        // Rough cost of a cross-queue sync in ms
+        static constexpr float CROSS_QUEUE_SYNC_COST = 0.02f;
+        // Placement only changes when the estimated frame time improves by this much (ms)
+        static constexpr float ASYNC_PLACEMENT_HYSTERESIS = 0.05f;
+        // Producers of resources that were read within this many frames aren't culled
+        static constexpr uint64_t MAX_BUILDS_SINCE_READ = 2;
 
         int FindFrameResource(uint64_t key, int beg = 0, int end = -1);
-        void BuildTaskGraph(Support::TaskSet& ts);
+        void BuildTaskGraph(Support::TaskSet& ts, uint64_t fingerprint);
+        void RecordAggregateNode(int i);
+        void CullNodes();
         void Sort(Util::Span<Util::SmallVector<RenderNodeHandle, App::FrameAllocator>> adjacentTailNodes);
         void InsertResourceBarriers();
         void JoinRenderNodes();
         void MergeSmallNodes();
+        uint64_t Fingerprint();
+        bool ReplayCompiledGraph(uint64_t fingerprint);
+        void CacheCompiledGraph(uint64_t fingerprint);
+        void ApplyAsyncComputePlacement();
+        void AccumulateNodeTimings();
+        void ReportNodeStats();
+        void UpdateAsyncComputePlacement();
+        void PreparePassBenchmark();
+        void CollectPassBenchmarkTimings();
+        void RecordPassBenchmark(ComputeCmdList& cmdList, fastdelegate::FastDelegate1<CommandList&>& dlg);
 #ifndef NDEBUG
         void Log();
 #endif
@@ -143,7 +212,9 @@ namespace ZetaRay::Core
                 : ID(other.ID),
                 Res(other.Res),
                 State(other.State),
-                IsWindowSizeDependent(other.IsWindowSizeDependent)
+                IsWindowSizeDependent(other.IsWindowSizeDependent),
+                LastReadBuild(other.LastReadBuild),
+                IsBuffer(other.IsBuffer)
             {
                 memcpy(Producers, other.Producers, MAX_NUM_PRODUCERS * sizeof(RenderNodeHandle));
                 CurrProdIdx = other.CurrProdIdx.load(std::memory_order_relaxed);
@@ -159,6 +230,8 @@ namespace ZetaRay::Core
                 memcpy(Producers, rhs.Producers, MAX_NUM_PRODUCERS * sizeof(RenderNodeHandle));
                 CurrProdIdx = rhs.CurrProdIdx.load(std::memory_order_relaxed);
                 IsWindowSizeDependent = rhs.IsWindowSizeDependent;
+                LastReadBuild = rhs.LastReadBuild;
+                IsBuffer = rhs.IsBuffer;
 
                 return *this;
             }
@@ -168,6 +241,7 @@ namespace ZetaRay::Core
                 Res = r;
                 ID = id;
                 IsWindowSizeDependent = isWindowSizeDependent;
+                IsBuffer = r && (r->GetDesc().Dimension == D3D12_RESOURCE_DIMENSION_BUFFER);
 
                 if(State == D3D12_RESOURCE_STATES(-1))
                     State = s;
@@ -178,6 +252,8 @@ namespace ZetaRay::Core
                 Res = nullptr;
                 CurrProdIdx = 0;
                 State = State = D3D12_RESOURCE_STATES(-1);
+                LastReadBuild = 0;
+                IsBuffer = false;
 
                 for (int i = 0; i < MAX_NUM_PRODUCERS; i++)
                     Producers[i] = RenderNodeHandle(INVALID_NODE_HANDLE);
@@ -191,6 +267,10 @@ namespace ZetaRay::Core
             RenderNodeHandle Producers[MAX_NUM_PRODUCERS] = { RenderNodeHandle(INVALID_NODE_HANDLE) };
             D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATES(-1);
             bool IsWindowSizeDependent = false;
+            // Last build in which a (non-culled) node read this resource
+            uint64_t LastReadBuild = 0;
+            // Buffers don't have layouts
+            bool IsBuffer = false;
         };
 
         // Make sure this doesn't get reset between frames as some states carry over to the
@@ -223,7 +303,8 @@ namespace ZetaRay::Core
             {
                 Inputs.free_memory();
                 Outputs.free_memory();
-                Barriers.free_memory();
+                TextureBarriers.free_memory();
+                BufferBarriers.free_memory();
 #if 0
                 Indegree = 0;
                 NodeBatchIdx = -1;
@@ -241,16 +322,22 @@ namespace ZetaRay::Core
             {
                 Type = t;
                 Dlg = dlg;
+                SubDlg.clear();
+                NumSubCmdLists = 1;
                 Indegree = 0;
                 NodeBatchIdx = -1;
                 Inputs.free_memory();
                 Outputs.free_memory();
-                Barriers.free_memory();
+                TextureBarriers.free_memory();
+                BufferBarriers.free_memory();
                 HasUnsupportedBarrier = false;
                 GpuDepSourceIdx = RenderNodeHandle(-1);
                 OutputMask = 0;
                 AggNodeIdx = -1;
                 ForceSeparateCmdList = forceSeparateCmdList;
+                IsAsyncCandidate = false;
+                KeepAlive = false;
+                Culled = false;
 
                 const int n = Math::Min((int)strlen(name), MAX_NAME_LENGTH - 1);
                 memcpy(Name, name, n);
@@ -260,6 +347,9 @@ namespace ZetaRay::Core
             static constexpr int MAX_NAME_LENGTH = 16;
 
             fastdelegate::FastDelegate1<CommandList&> Dlg;
+            // Only used when NumSubCmdLists > 1
+            fastdelegate::FastDelegate2<CommandList&, int> SubDlg;
+            int NumSubCmdLists = 1;
             int NodeBatchIdx = -1;
             RENDER_NODE_TYPE Type;
             bool HasUnsupportedBarrier = false;
@@ -270,12 +360,18 @@ namespace ZetaRay::Core
             int16 Indegree = 0;
             int16 AggNodeIdx = -1;
             bool ForceSeparateCmdList = false;
+            // Compute node that may run on the async. compute queue (automatic placement)
+            bool IsAsyncCandidate = false;
+            bool KeepAlive = false;
+            bool Culled = false;
 
             // Due to usage of FrameAllocator, capacity must be set to zero manually
             // in each frame, otherwise it might reuse previous frame's temp memory.
             Util::SmallVector<Dependency, App::FrameAllocator, 2> Inputs;
             Util::SmallVector<Dependency, App::FrameAllocator, 1> Outputs;
-            Util::SmallVector<D3D12_RESOURCE_BARRIER, App::FrameAllocator> Barriers;
+            // Transitions are expressed as enhanced barriers
+            Util::SmallVector<D3D12_TEXTURE_BARRIER, App::FrameAllocator> TextureBarriers;
+            Util::SmallVector<D3D12_BUFFER_BARRIER, App::FrameAllocator> BufferBarriers;
         };
 
         struct AggregateRenderNode
@@ -288,12 +384,10 @@ namespace ZetaRay::Core
 #if 0
             void Reset()
             {
-                Barriers.free_memory();
                 Dlgs.free_memory();
                 HasUnsupportedBarrier = false;
                 CompletionFence = UINT64_MAX;
                 GpuDepIdx = RenderNodeHandle(-1);
-                TaskH = UINT32_MAX;
                 IsAsyncCompute = false;
                 IsLast = false;
                 ForceSeparate = false;
@@ -305,10 +399,14 @@ namespace ZetaRay::Core
 
             static constexpr int MAX_NAME_LENGTH = 64;
 
-            Util::SmallVector<D3D12_RESOURCE_BARRIER, App::FrameAllocator, 8> Barriers;
+            Util::SmallVector<D3D12_TEXTURE_BARRIER, App::FrameAllocator, 8> TextureBarriers;
+            Util::SmallVector<D3D12_BUFFER_BARRIER, App::FrameAllocator, 4> BufferBarriers;
             Util::SmallVector<fastdelegate::FastDelegate1<CommandList&>, App::FrameAllocator, 8> Dlgs;
+            // Name of the render node for each delegate (used for timing)
+            Util::SmallVector<const char*, App::FrameAllocator, 8> DlgNames;
+            fastdelegate::FastDelegate2<CommandList&, int> SubDlg;
+            int NumSubCmdLists = 1;
             uint64_t CompletionFence = UINT64_MAX;
-            uint32_t TaskH;
             int BatchIdx = -1;
             int MergedCmdListIdx = -1;
             bool MergeStart = false;
@@ -325,11 +423,143 @@ namespace ZetaRay::Core
         static_assert(std::is_move_constructible_v<RenderNode>);
         static_assert(std::is_swappable_v<RenderNode>);
 
+        static void RecordBarriers(AggregateRenderNode& node, ComputeCmdList& cmdList);
+
+        //
+        // Compiled graphs
+        //
+        struct CompiledRenderNode
+        {
+            // Handle at registration time
+            RenderNodeHandle Handle;
+            RenderNodeHandle GpuDepSourceIdx;
+            int NodeBatchIdx;
+            uint32_t OutputMask;
+            uint32_t TextureBarrierOffset;
+            uint32_t BufferBarrierOffset;
+            uint16_t NumTextureBarriers;
+            uint16_t NumBufferBarriers;
+            int16 AggNodeIdx;
+            bool HasUnsupportedBarrier;
+        };
+
+        struct CompiledAggregateNode
+        {
+            RenderNodeHandle GpuDepIdx;
+            int BatchIdx;
+            int MergedCmdListIdx;
+            bool MergeStart;
+            bool MergeEnd;
+            bool IsAsyncCompute;
+            bool HasUnsupportedBarrier;
+            bool IsLast;
+            bool ForceSeparate;
+            char Name[AggregateRenderNode::MAX_NAME_LENGTH];
+        };
+
+        struct CompiledGraph
+        {
+            uint64_t Fingerprint = 0;
+            uint64_t LastUsed = 0;
+            int NumNodes = 0;
+            int NumResources = 0;
+            int NumMergedCmdLists = 0;
+            // In execution order
+            CompiledRenderNode Nodes[MAX_NUM_RENDER_PASSES];
+            // Resource states at the end of the frame
+            D3D12_RESOURCE_STATES FinalStates[MAX_NUM_RESOURCES];
+            Util::SmallVector<CompiledAggregateNode> AggregateNodes;
+            Util::SmallVector<D3D12_TEXTURE_BARRIER> TextureBarriers;
+            Util::SmallVector<D3D12_BUFFER_BARRIER> BufferBarriers;
+        };
+
         RenderNode m_renderNodes[MAX_NUM_RENDER_PASSES];
         RenderNodeHandle m_mapping[MAX_NUM_RENDER_PASSES];
         Util::SmallVector<AggregateRenderNode, App::FrameAllocator> m_aggregateNodes;
         Util::SmallVector<ComputeCmdList*, Support::SystemAllocator, 4> m_mergedCmdLists;
         int m_numPassesLastTimeDrawn = -1;
         Support::WaitObject* m_submissionWaitObj = nullptr;
+        CompiledGraph m_compiledGraphs[MAX_NUM_CACHED_GRAPHS];
+        uint64_t m_numBuilds = 0;
+        // Task graph for the aggregate nodes, reused for as long as the compiled graph 
+        // doesn't change
+        Support::TaskSetTemplate m_taskGraph;
+        uint64_t m_taskGraphFingerprint = 0;
+        // Whether GPU timings are recorded for the nodes in the current frame
+        bool m_timeNodes = false;
+
+        //
+        // Automatic async. compute placement
+        //
+        struct NodeTiming
+        {
+            static constexpr int HISTORY_LEN = 64;
+
+            uint64_t NameHash;
+            char Name[RenderNode::MAX_NAME_LENGTH];
+            // Ring buffer of GPU durations (ms)
+            float History[HISTORY_LEN];
+            int NextHistIdx;
+            int NumHist;
+            uint64_t CSInvocations;
+            uint64_t PSInvocations;
+            // Last resolved frame of GpuTimer that included this node
+            uint64_t LastSeen;
+            // Current async. compute placement window
+            double Sum;
+            int Count;
+        };
+
+        Util::SmallVector<NodeTiming> m_nodeTimings;
+        // Name hashes of compute nodes that currently run on the async. compute queue
+        Util::SmallVector<uint64_t> m_asyncNodes;
+        int m_numTimedFrames = 0;
+        uint64_t m_lastTimedFrame = 0;
+        bool m_autoAsyncCompute = false;
+        // Off by default, as it adds queries and their readback to every node in every frame
+        bool m_profileNodes = false;
+
+        //
+        // Pass benchmark
+        //
+        static constexpr int MAX_NUM_PASS_BENCHMARK_RESOURCES = 16;
+
+        struct PassBenchmarkResource
+        {
+            // Declared resource in current frame along with its state during the node
+            ID3D12Resource* Res;
+            D3D12_RESOURCE_STATES State;
+            GpuMemory::Buffer SnapshotBuffer;
+            GpuMemory::Texture SnapshotTexture;
+            // Created in copy destination state
+            bool SnapshotIsCopySource = false;
+
+            ZetaInline ID3D12Resource* Snapshot()
+            {
+                if (SnapshotBuffer.IsInitialized())
+                    return SnapshotBuffer.Resource();
+
+                return SnapshotTexture.IsInitialized() ? SnapshotTexture.Resource() : nullptr;
+            }
+        };
+
+        struct PassBenchmark
+        {
+            char NodeName[RenderNode::MAX_NAME_LENGTH];
+            // Name of the matching render node in current frame, null when not found
+            const char* Node = nullptr;
+            int NumRepsPerFrame = 1;
+            int NumResources = 0;
+            PassBenchmarkResource Resources[MAX_NUM_PASS_BENCHMARK_RESOURCES];
+            Util::SmallVector<float> Samples;
+            uint64_t LastResolvedFrame = 0;
+            // Skips timings of frames that were recorded before (re)starting
+            int NumFramesToSkip = 0;
+            bool Active = false;
+            bool Captured = false;
+            bool Warned = false;
+        };
+
+        PassBenchmark m_passBenchmark;
     };
 }
\ No newline at end of file
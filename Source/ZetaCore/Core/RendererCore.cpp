@@ -1,9 +1,14 @@
 #include "RendererCore.h"
 #include "CommandList.h"
 #include "Direct3DUtil.h"
+#include "DirectStorage.h"
+#include "ShaderCompiler.h"
 #include "../Support/Task.h"
 #include "../Support/Param.h"
+#include "../Support/TaskTimeline.h"
 #include "../App/Timer.h"
+#include "../App/Log.h"
+#include "../App/Path.h"
 #include "../Assets/Font/IconsFontAwesome6.h"
 
 using namespace ZetaRay;
@@ -20,7 +25,8 @@ RendererCore::RendererCore()
     m_cbvSrvUavDescHeapCpu(32),
     m_rtvDescHeap(8),
     m_directQueue(D3D12_COMMAND_LIST_TYPE_DIRECT),
-    m_computeQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE)
+    m_computeQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE),
+    m_copyQueue(D3D12_COMMAND_LIST_TYPE_COPY)
 {}
 
 RendererCore::~RendererCore()
@@ -31,9 +37,12 @@ void RendererCore::Init(HWND hwnd, uint16_t renderWidth, uint16_t renderHeight,
 {
     m_hwnd = hwnd;
 
-    m_deviceObjs.InitializeAdapter();
+    const App::HeadlessDesc* headless = App::GetHeadlessDesc();
+    m_deviceObjs.InitializeAdapter(headless ? headless->AdapterIndex : -1);
     m_deviceObjs.CreateDevice(true);
     InitStaticSamplers();
+    CreateDispatchCmdSig();
+    OpenShaderArchive();
 
     CheckHR(m_deviceObjs.m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, 
         IID_PPV_ARGS(m_fence.GetAddressOf())));
@@ -47,19 +56,23 @@ void RendererCore::Init(HWND hwnd, uint16_t renderWidth, uint16_t renderHeight,
 
     GpuMemory::Init();
     GpuMemory::BeginFrame();
+    DirectStorage::Init();
 
     m_cbvSrvUavDescHeapGpu.Init(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
         Constants::NUM_CBV_SRV_UAV_DESC_HEAP_GPU_DESCRIPTORS,
-        true);
+        true,
+        Constants::NUM_TRANSIENT_GPU_DESCRIPTORS_PER_FRAME);
     m_cbvSrvUavDescHeapCpu.Init(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
         Constants::NUM_CBV_SRV_UAV_DESC_HEAP_CPU_DESCRIPTORS,
         false);
+    m_descStagingHeap.Init(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+        Constants::NUM_STAGING_DESCRIPTORS_PER_THREAD);
     m_rtvDescHeap.Init(D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
         Constants::NUM_RTV_DESC_HEAP_DESCRIPTORS,
         false);
-    //m_dsvDescHeap.Init(D3D12_DESCRIPTOR_HEAP_TYPE_DSV,
-    //    Constants::NUM_DSV_DESC_HEAP_DESCRIPTORS,
-    //    false);
+    m_dsvDescHeap.Init(D3D12_DESCRIPTOR_HEAP_TYPE_DSV,
+        Constants::NUM_DSV_DESC_HEAP_DESCRIPTORS,
+        false);
 
     // Reserve descriptor index 0
     m_reserved = m_cbvSrvUavDescHeapGpu.Allocate(1);
@@ -67,7 +80,7 @@ void RendererCore::Init(HWND hwnd, uint16_t renderWidth, uint16_t renderHeight,
 
     m_directQueue.Init();
     m_computeQueue.Init();
-    //m_copyQueue.Init();
+    m_copyQueue.Init();
 
     m_backbuffDescTable = m_rtvDescHeap.Allocate(Constants::NUM_BACK_BUFFERS);
     //m_depthBuffDescTable = m_dsvDescHeap.Allocate(1);
@@ -86,6 +99,10 @@ void RendererCore::Init(HWND hwnd, uint16_t renderWidth, uint16_t renderHeight,
     m_renderScissor.right = m_renderWidth;
     m_renderScissor.bottom = m_renderHeight;
 
+    // Frame times shouldn't be quantized to the display's refresh rate
+    if (App::GetBenchmarkDesc())
+        m_vsyncInterval = 0;
+
     if (m_vsyncInterval == 0 && m_deviceObjs.m_tearingSupport)
     {
         m_presentFlags |= DXGI_PRESENT_ALLOW_TEARING;
@@ -94,10 +111,35 @@ void RendererCore::Init(HWND hwnd, uint16_t renderWidth, uint16_t renderHeight,
 
     m_gpuTimer.Init();
 
+    // Nothing is presented in headless mode
+    if (IsHeadless())
+        return;
+
     ParamVariant p0;
     p0.InitBool(ICON_FA_FILM " Renderer", "Display", "VSync",
         fastdelegate::MakeDelegate(this, &RendererCore::SetVSync), m_vsyncInterval > 0);
     App::AddParam(p0);
+
+    ParamVariant p1;
+    p1.InitInt(ICON_FA_FILM " Renderer", "Display", "Frames In Flight",
+        fastdelegate::MakeDelegate(this, &RendererCore::SetFramesInFlight), m_framesInFlight,
+        Constants::MIN_FRAMES_IN_FLIGHT, Constants::MAX_FRAMES_IN_FLIGHT, 1);
+    App::AddParam(p1);
+
+    ParamVariant p2;
+    p2.InitBool(ICON_FA_FILM " Renderer", "Display", "Frame Interpolation",
+        fastdelegate::MakeDelegate(this, &RendererCore::SetFrameInterpolation), m_frameInterpolation);
+    App::AddParam(p2);
+
+    ParamVariant p3;
+    p3.InitBool(ICON_FA_FILM " Renderer", "Display", "Just-In-Time Frame Start",
+        fastdelegate::MakeDelegate(this, &RendererCore::SetJustInTime), m_justInTime);
+    App::AddParam(p3);
+
+    // Sleep() has a granularity of about a millisecond or worse
+    m_jitTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, 
+        TIMER_ALL_ACCESS);
+    CheckWin32(m_jitTimer);
 }
 
 void RendererCore::InitBasic()
@@ -105,12 +147,45 @@ void RendererCore::InitBasic()
     m_deviceObjs.InitializeAdapter();
     m_deviceObjs.CreateDevice(false);
     InitStaticSamplers();
+    OpenShaderArchive();
+}
+
+void RendererCore::ShutdownBasic()
+{
+    m_shaderArchive.Close();
+}
+
+void RendererCore::OpenShaderArchive()
+{
+    App::Filesystem::Path path(App::GetCompileShadersDir());
+    path.Append(ShaderArchive::FILENAME);
+
+    // Shaders are then loaded from their .cso files
+    if (!m_shaderArchive.Open(path.Get()))
+    {
+        LOG_UI_WARNING("Shader archive %s wasn't found, loading individual shaders instead.",
+            path.Get());
+    }
 }
 
 void RendererCore::ResizeBackBuffers(HWND hwnd)
 {
-    // Ff back buffers already exist, resize them
-    if (m_backBuffers[0].IsInitialized())
+    // Headless -- render targets that are never presented. Window size never changes, so 
+    // this only runs once.
+    if (!hwnd)
+    {
+        for (int i = 0; i < Constants::NUM_BACK_BUFFERS; i++)
+        {
+            StackStr(buff, n, "Backbuffer_%d", i);
+            m_backBuffers[i] = GpuMemory::GetTexture2D(buff, m_displayWidth, m_displayHeight,
+                Constants::BACK_BUFFER_FORMAT, D3D12_RESOURCE_STATE_PRESENT, 
+                TEXTURE_FLAGS::ALLOW_RENDER_TARGET);
+        }
+
+        UpdateBackBufferIndices();
+    }
+    // If back buffers already exist, resize them
+    else if (m_backBuffers[0].IsInitialized())
     {
         // GPU is flushed, no need to wait
         for (int i = 0; i < Constants::NUM_BACK_BUFFERS; i++)
@@ -123,7 +198,7 @@ void RendererCore::ResizeBackBuffers(HWND hwnd)
         }
 
         m_deviceObjs.ResizeSwapChain(m_displayWidth, m_displayHeight, 
-            Constants::MAX_SWAPCHAIN_FRAME_LATENCY);
+            m_framesInFlight);
     }
     else
     {
@@ -132,20 +207,23 @@ void RendererCore::ResizeBackBuffers(HWND hwnd)
             m_displayWidth, m_displayHeight,
             Constants::NUM_BACK_BUFFERS,
             Direct3DUtil::NoSRGB(Constants::BACK_BUFFER_FORMAT),
-            Constants::MAX_SWAPCHAIN_FRAME_LATENCY);
+            m_framesInFlight);
     }
 
-    m_currBackBuffIdx = (uint16_t)m_deviceObjs.m_dxgiSwapChain->GetCurrentBackBufferIndex();
-
-    // Obtain the back buffers
-    for (int i = 0; i < Constants::NUM_BACK_BUFFERS; i++)
+    if (hwnd)
     {
-        ID3D12Resource* backbuff;
-        CheckHR(m_deviceObjs.m_dxgiSwapChain->GetBuffer(i, IID_PPV_ARGS(&backbuff)));
+        UpdateBackBufferIndices();
 
-        StackStr(buff, n, "Backbuffer_%d", i);
-        m_backBuffers[i] = ZetaMove(Texture(buff, ZetaMove(backbuff), 
-            RESOURCE_HEAP_TYPE::COMMITTED));
+        // Obtain the back buffers
+        for (int i = 0; i < Constants::NUM_BACK_BUFFERS; i++)
+        {
+            ID3D12Resource* backbuff;
+            CheckHR(m_deviceObjs.m_dxgiSwapChain->GetBuffer(i, IID_PPV_ARGS(&backbuff)));
+
+            StackStr(buff, n, "Backbuffer_%d", i);
+            m_backBuffers[i] = ZetaMove(Texture(buff, ZetaMove(backbuff), 
+                RESOURCE_HEAP_TYPE::COMMITTED));
+        }
     }
 
     for (int i = 0; i < Constants::NUM_BACK_BUFFERS; i++)
@@ -173,7 +251,7 @@ void RendererCore::ResizeBackBuffers(HWND hwnd)
 
 void RendererCore::Shutdown()
 {
-    if (!m_deviceObjs.m_tearingSupport)
+    if (!IsHeadless() && !m_deviceObjs.m_tearingSupport)
     {
         // Ref: https://docs.microsoft.com/en-us/windows/win32/direct3ddxgi/d3d10-graphics-programming-guide-dxgi
         // "You may not release a swap chain in full-screen mode because doing so may create thread contention"
@@ -189,16 +267,26 @@ void RendererCore::Shutdown()
     // is deleted after this point.
     m_gpuTimer.Shutdown();
 
+    if (m_jitTimer)
+        CloseHandle(m_jitTimer);
+
+    DirectStorage::Shutdown();
+    ShaderCompiler::Shutdown();
+    m_shaderArchive.Close();
     GpuMemory::Shutdown();
 }
 
 void RendererCore::OnWindowSizeChanged(HWND hwnd, uint16_t renderWidth, uint16_t renderHeight, 
     uint16_t displayWidth, uint16_t displayHeight)
 {
-    FlushAllCommandQueues();
-
     const bool resizeNeeded = displayWidth != m_displayWidth || displayHeight != m_displayHeight;
 
+    // Swap chain buffers can only be resized once GPU is done with them. When only the 
+    // render resolution changes (e.g. dynamic resolution), render passes allocate new 
+    // descriptors and the old resources are released after GPU has finished with them.
+    if (resizeNeeded)
+        FlushAllCommandQueues();
+
     m_renderWidth = renderWidth;
     m_renderHeight = renderHeight;
     m_displayWidth = displayWidth;
@@ -231,16 +319,88 @@ void RendererCore::OnWindowSizeChanged(HWND hwnd, uint16_t renderWidth, uint16_t
 
 void RendererCore::WaitForSwapChainWaitableObject()
 {
+    if (IsHeadless())
+        return;
+
     // Blocks until eariliest queued present is completed
     WaitForSingleObject(m_deviceObjs.m_frameLatencyWaitableObj, 16);
 }
 
+void RendererCore::LatencySleep()
+{
+    if (!m_justInTime || m_jitSleepMs <= 0.0f)
+        return;
+
+    // Negative means relative, in 100-nanosecond units
+    LARGE_INTEGER dueTime;
+    dueTime.QuadPart = -(LONGLONG)(m_jitSleepMs * 10000.0f);
+    CheckWin32(SetWaitableTimerEx(m_jitTimer, &dueTime, 0, nullptr, nullptr, nullptr, 0));
+    WaitForSingleObject(m_jitTimer, INFINITE);
+}
+
+void RendererCore::SetLatencyMarker(LATENCY_MARKER m, int64_t cpuTicks)
+{
+    if (cpuTicks == -1)
+    {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        cpuTicks = now.QuadPart;
+    }
+
+    const uint64_t frame = App::GetTimer().GetTotalFrameCount();
+    LatencyFrame& f = m_latencyFrames[frame % NUM_LATENCY_FRAMES];
+
+    if (f.FrameNum != frame)
+    {
+        f.FrameNum = frame;
+
+        for (int i = 0; i < (int)LATENCY_MARKER::COUNT; i++)
+            f.Markers[i] = -1;
+    }
+
+    f.Markers[(int)m] = cpuTicks;
+}
+
 void RendererCore::BeginFrame()
 {
     if (App::GetTimer().GetTotalFrameCount() > 0)
         GpuMemory::BeginFrame();
 
     m_gpuTimer.BeginFrame();
+    UpdateLatency();
+}
+
+void RendererCore::UpdateLatency()
+{
+    const GpuTimer::FrameCompletion& completion = m_gpuTimer.GetLastFrameCompletion();
+    if (completion.FrameNum == UINT64_MAX || completion.FrameNum == m_lastLatencyFrame)
+        return;
+
+    const LatencyFrame& f = m_latencyFrames[completion.FrameNum % NUM_LATENCY_FRAMES];
+    const int64_t input = f.Markers[(int)LATENCY_MARKER::INPUT_SAMPLE];
+    const int64_t submit = f.Markers[(int)LATENCY_MARKER::RENDER_SUBMIT];
+
+    if (f.FrameNum != completion.FrameNum || input == -1 || submit == -1)
+        return;
+
+    m_lastLatencyFrame = completion.FrameNum;
+
+    const double ticksToMs = 1000.0 / App::GetTimer().GetCounterFreq();
+    m_inputToGpuDoneMs = (float)((completion.CpuTicks - input) * ticksToMs);
+    m_inputToSubmitMs = (float)((submit - input) * ticksToMs);
+    m_submitToGpuDoneMs = (float)((completion.CpuTicks - submit) * ticksToMs);
+
+    if (!m_justInTime || completion.PrevCpuTicks == -1)
+        return;
+
+    // How long this frame's work waited on the GPU for the previous frame to finish. 
+    // Negative when GPU went idle waiting for this frame instead.
+    const float queuedMs = (float)((completion.PrevCpuTicks - submit) * ticksToMs);
+
+    // Measurements lag behind by the number of frames in flight, so step slowly towards 
+    // the sleep that leaves work waiting for JIT_MARGIN_MS
+    const float sleepMs = m_jitSleepMs + 0.25f * (queuedMs - JIT_MARGIN_MS);
+    m_jitSleepMs = Math::Min(Math::Max(sleepMs, 0.0f), JIT_MAX_SLEEP_MS);
 }
 
 void RendererCore::SubmitResourceCopies()
@@ -253,47 +413,89 @@ void RendererCore::SubmitResourceCopies()
     App::AddFrameStat("Renderer", "Gpu Desc. Heap", 
         m_cbvSrvUavDescHeapGpu.GetHeapSize() - m_cbvSrvUavDescHeapGpu.GetNumFreeDescriptors(), 
         m_cbvSrvUavDescHeapGpu.GetHeapSize());
+    App::AddFrameStat("Renderer", "Async Compute Overlap (ms)", 
+        (float)m_gpuTimer.GetAsyncComputeOverlap());
+
+    const GpuMemory::UploadStats uploadStats = GpuMemory::GetUploadStats();
+    App::AddFrameStat("Renderer", "Upload (KB)", (uint32_t)(uploadStats.FrameBytes >> 10), 
+        (uint32_t)(uploadStats.FrameBudget >> 10));
+    App::AddFrameStat("Renderer", "Copy Latency (ms)", uploadStats.CopyLatencyMs);
+    App::AddFrameStat("Renderer", "Staging Peak (MB)", (uint32_t)(uploadStats.StagingPeakBytes >> 20));
+
+    if (m_lastLatencyFrame != UINT64_MAX)
+    {
+        App::AddFrameStat("Latency", "Input to GPU done (ms)", m_inputToGpuDoneMs);
+        App::AddFrameStat("Latency", "Input to submit (ms)", m_inputToSubmitMs);
+        App::AddFrameStat("Latency", "Submit to GPU done (ms)", m_submitToGpuDoneMs);
+
+        if (m_justInTime)
+            App::AddFrameStat("Latency", "Just-in-time sleep (ms)", m_jitSleepMs);
+    }
 }
 
 void RendererCore::EndFrame(TaskSet& endFrameTS)
 {
     auto h0 = endFrameTS.EmplaceTask("Present", [this]()
         {
-            auto hr = m_deviceObjs.m_dxgiSwapChain->Present(m_vsyncInterval, m_presentFlags);
-            if (FAILED(hr))
+            // Both presents are queued behind the same GPU work. To keep them from flipping 
+            // back to back, interpolated frame is always synced to the next vblank, which 
+            // shows it for at least one refresh interval (tearing requires sync interval 0).
+            // All the command lists for this frame have been submitted at this point
+            SetLatencyMarker(LATENCY_MARKER::RENDER_SUBMIT);
+            const int64_t presentBeg = TaskTimeline::Now();
+
+            if (m_frameInterpolation)
             {
-                if (hr == DXGI_ERROR_DEVICE_REMOVED)
-                {
-                    //ComPtr<ID3D12DeviceRemovedExtendedData1> pDred;
-                    //CheckHR(m_deviceObjs.m_device->QueryInterface(IID_PPV_ARGS(&pDred)));
-
-                    //D3D12_DRED_AUTO_BREADCRUMBS_OUTPUT1 DredAutoBreadcrumbsOutput;
-                    //D3D12_DRED_PAGE_FAULT_OUTPUT DredPageFaultOutput;
-                    //CheckHR(pDred->GetAutoBreadcrumbsOutput1(&DredAutoBreadcrumbsOutput));
-                    //CheckHR(pDred->GetPageFaultAllocationOutput(&DredPageFaultOutput));
-                }
-
-                CheckHR(hr);
+                m_fenceVals[m_interpBackBuffIdx] = m_nextFenceVal;
+                Present(1, 0);
             }
 
+            if (!IsHeadless())
+                Present(m_vsyncInterval, m_presentFlags);
+
+            SetLatencyMarker(LATENCY_MARKER::PRESENT);
+            App::GetTaskTimeline().Record("Present", TaskTimeline::EVENT_TYPE::PRESENT, presentBeg, 
+                TaskTimeline::Now());
+
             // Schedule a Signal command in the queue.
             // Set the fence value for the next frame.
             m_fenceVals[m_currBackBuffIdx] = m_nextFenceVal;
             CheckHR(m_directQueue.GetCommandQueue()->Signal(m_fence.Get(), m_nextFenceVal++));
 
+            if (m_queuedFramesInFlight != m_framesInFlight)
+            {
+                m_framesInFlight = m_queuedFramesInFlight;
+
+                if (!IsHeadless())
+                    CheckHR(m_deviceObjs.m_dxgiSwapChain->SetMaximumFrameLatency(m_framesInFlight));
+            }
+
+            m_frameInterpolation = m_queuedFrameInterpolation;
+
             // Update the back buffer index.
-            const uint16_t nextBackBuffidx = (uint16_t)m_deviceObjs.m_dxgiSwapChain->GetCurrentBackBufferIndex();
+            UpdateBackBufferIndices();
             const uint64_t completed = m_fence->GetCompletedValue();
 
-            if (completed < m_fenceVals[nextBackBuffidx])
+            // Besides the next back buffer(s) being available, at most m_framesInFlight frames 
+            // (including the one that was just submitted) can be queued on the GPU while 
+            // the next one is recorded. Other per-frame resources (upload memory, descriptors, 
+            // readbacks, timestamp queries) are recycled based on fences and don't depend on 
+            // this number.
+            const uint64_t lastSubmitted = m_nextFenceVal - 1;
+            uint64_t waitVal = Math::Max(m_fenceVals[m_currBackBuffIdx],
+                lastSubmitted > m_framesInFlight ? lastSubmitted - m_framesInFlight : 0);
+
+            if (m_frameInterpolation)
+                waitVal = Math::Max(waitVal, m_fenceVals[m_interpBackBuffIdx]);
+
+            if (completed < waitVal)
             {
-                CheckHR(m_fence->SetEventOnCompletion(m_fenceVals[nextBackBuffidx], m_event));
+                CheckHR(m_fence->SetEventOnCompletion(waitVal, m_event));
                 //uint64_t f = App::GetTimer().GetTotalFrameCount();
                 //printf("Frame %llu, CPU waiting for GPU...\n", f);
                 WaitForSingleObject(m_event, INFINITE);
             }
 
-            m_currBackBuffIdx = nextBackBuffidx;
             m_globalDoubleBuffIdx = (m_globalDoubleBuffIdx + 1) & 0x1;
         });
 
@@ -307,7 +509,7 @@ void RendererCore::EndFrame(TaskSet& endFrameTS)
             m_cbvSrvUavDescHeapGpu.Recycle();
             m_cbvSrvUavDescHeapCpu.Recycle();
             m_rtvDescHeap.Recycle();
-            //m_dsvDescHeap.Recycle();
+            m_dsvDescHeap.Recycle();
         });
 }
 
@@ -334,6 +536,9 @@ uint64_t RendererCore::GetCommandQueueTimeStampFrequency(D3D12_COMMAND_LIST_TYPE
     case D3D12_COMMAND_LIST_TYPE_COMPUTE:
         CheckHR(m_computeQueue.m_cmdQueue->GetTimestampFrequency(&freq));
         break;
+    case D3D12_COMMAND_LIST_TYPE_COPY:
+        CheckHR(m_copyQueue.m_cmdQueue->GetTimestampFrequency(&freq));
+        break;
     default:
         break;
     }
@@ -341,6 +546,26 @@ uint64_t RendererCore::GetCommandQueueTimeStampFrequency(D3D12_COMMAND_LIST_TYPE
     return freq;
 }
 
+void RendererCore::GetCommandQueueClockCalibration(D3D12_COMMAND_LIST_TYPE t, uint64_t& gpuTimestamp,
+    uint64_t& cpuTimestamp) const
+{
+    switch (t)
+    {
+    case D3D12_COMMAND_LIST_TYPE_DIRECT:
+        CheckHR(m_directQueue.m_cmdQueue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp));
+        break;
+    case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+        CheckHR(m_computeQueue.m_cmdQueue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp));
+        break;
+    case D3D12_COMMAND_LIST_TYPE_COPY:
+        CheckHR(m_copyQueue.m_cmdQueue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp));
+        break;
+    default:
+        Assert(false, "Invalid command list type.");
+        break;
+    }
+}
+
 GraphicsCmdList* RendererCore::GetGraphicsCmdList()
 {
     CommandList* ctx = m_directQueue.GetCommandList();
@@ -358,13 +583,13 @@ ComputeCmdList* RendererCore::GetComputeCmdList()
 }
 
 // There is another "CopyContext" defined in WinBase.h!
-//CopyCmdList* RendererCore::GetCopyCmdList()
-//{
-//    auto* ctx = m_copyQueue->GetCommandList();
-//    Assert(ctx->CommandListType() == D3D12_COMMAND_LIST_TYPE_COPY, "Invalid downcast.");
-//
-//    return static_cast<ZetaRay::CopyCmdList*>(ctx);
-//}
+CopyCmdList* RendererCore::GetCopyCmdList()
+{
+    CommandList* ctx = m_copyQueue.GetCommandList();
+    Assert(ctx->GetType() == D3D12_COMMAND_LIST_TYPE_COPY, "Invalid downcast.");
+
+    return static_cast<ZetaRay::CopyCmdList*>(ctx);
+}
 
 void RendererCore::ReleaseCmdList(CommandList* ctx)
 {
@@ -372,6 +597,8 @@ void RendererCore::ReleaseCmdList(CommandList* ctx)
         m_directQueue.ReleaseCommandList(ctx);    
     else if (ctx->GetType() == D3D12_COMMAND_LIST_TYPE_COMPUTE)
         m_computeQueue.ReleaseCommandList(ctx);
+    else if (ctx->GetType() == D3D12_COMMAND_LIST_TYPE_COPY)
+        m_copyQueue.ReleaseCommandList(ctx);
 }
 
 uint64_t RendererCore::ExecuteCmdList(CommandList* ctx)
@@ -380,6 +607,8 @@ uint64_t RendererCore::ExecuteCmdList(CommandList* ctx)
         return m_directQueue.ExecuteCommandList(ctx);
     else if (ctx->GetType() == D3D12_COMMAND_LIST_TYPE_COMPUTE)
         return m_computeQueue.ExecuteCommandList(ctx);
+    else if (ctx->GetType() == D3D12_COMMAND_LIST_TYPE_COPY)
+        return m_copyQueue.ExecuteCommandList(ctx);
 
     return UINT64_MAX;
 }
@@ -396,6 +625,11 @@ void RendererCore::SignalComputeQueue(ID3D12Fence* f, uint64_t v)
     m_computeQueue.GetCommandQueue()->Signal(f, v);
 }
 
+void RendererCore::SignalCopyQueue(ID3D12Fence* f, uint64_t v)
+{
+    m_copyQueue.GetCommandQueue()->Signal(f, v);
+}
+
 bool RendererCore::IsDirectQueueFenceComplete(uint64_t fenceValue)
 {
     return m_directQueue.IsFenceComplete(fenceValue);
@@ -406,6 +640,11 @@ bool RendererCore::IsComputeQueueFenceComplete(uint64_t fenceValue)
     return m_computeQueue.IsFenceComplete(fenceValue);
 }
 
+bool RendererCore::IsCopyQueueFenceComplete(uint64_t fenceValue)
+{
+    return m_copyQueue.IsFenceComplete(fenceValue);
+}
+
 void RendererCore::WaitForDirectQueueFenceCPU(uint64_t fenceValue)
 {
     m_directQueue.WaitForFenceCPU(fenceValue);
@@ -425,6 +664,15 @@ void RendererCore::WaitForComputeQueueFenceCPU(uint64_t fenceValue)
     m_computeQueue.WaitForFenceCPU(fenceValue);
 }
 
+void RendererCore::WaitForCopyQueueFenceCPU2(uint64_t fenceValue, HANDLE e)
+{
+    if (m_copyQueue.IsFenceComplete(fenceValue))
+        return;
+
+    CheckHR(m_copyQueue.m_fence->SetEventOnCompletion(fenceValue, e));
+    WaitForSingleObject(e, INFINITE);
+}
+
 void RendererCore::WaitForDirectQueueOnComputeQueue(uint64_t v)
 {
     // MS Docs:
@@ -436,15 +684,40 @@ void RendererCore::WaitForDirectQueueOnComputeQueue(uint64_t v)
     CheckHR(m_computeQueue.m_cmdQueue->Wait(m_directQueue.m_fence.Get(), v));
 }
 
+void RendererCore::WaitForFrameOnComputeQueue(uint64_t frameFenceValue)
+{
+    CheckHR(m_computeQueue.m_cmdQueue->Wait(m_fence.Get(), frameFenceValue));
+}
+
 void RendererCore::WaitForComputeQueueOnDirectQueue(uint64_t v)
 {
     CheckHR(m_directQueue.m_cmdQueue->Wait(m_computeQueue.m_fence.Get(), v));
 }
 
+void RendererCore::WaitForCopyQueueOnDirectQueue(uint64_t v)
+{
+    CheckHR(m_directQueue.m_cmdQueue->Wait(m_copyQueue.m_fence.Get(), v));
+}
+
+void RendererCore::WaitForCopyQueueOnComputeQueue(uint64_t v)
+{
+    CheckHR(m_computeQueue.m_cmdQueue->Wait(m_copyQueue.m_fence.Get(), v));
+}
+
+void RendererCore::UpdateTileMappings(ID3D12Resource* res, uint32_t numRegions,
+    const D3D12_TILED_RESOURCE_COORDINATE* regionCoords, const D3D12_TILE_REGION_SIZE* regionSizes,
+    ID3D12Heap* heap, uint32_t numRanges, const D3D12_TILE_RANGE_FLAGS* rangeFlags,
+    const uint32_t* heapRangeOffsets, const uint32_t* rangeTileCounts)
+{
+    m_copyQueue.GetCommandQueue()->UpdateTileMappings(res, numRegions, regionCoords, regionSizes,
+        heap, numRanges, rangeFlags, heapRangeOffsets, rangeTileCounts, D3D12_TILE_MAPPING_FLAG_NONE);
+}
+
 void RendererCore::FlushAllCommandQueues()
 {
     m_directQueue.WaitForIdle();
     m_computeQueue.WaitForIdle();
+    m_copyQueue.WaitForIdle();
 }
 
 void RendererCore::InitStaticSamplers()
@@ -590,6 +863,19 @@ void RendererCore::InitStaticSamplers()
     }
 }
 
+void RendererCore::CreateDispatchCmdSig()
+{
+    D3D12_INDIRECT_ARGUMENT_DESC arg{ .Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH };
+
+    D3D12_COMMAND_SIGNATURE_DESC desc{ .ByteStride = sizeof(D3D12_DISPATCH_ARGUMENTS),
+        .NumArgumentDescs = 1,
+        .pArgumentDescs = &arg,
+        .NodeMask = 0 };
+
+    CheckHR(m_deviceObjs.m_device->CreateCommandSignature(&desc, nullptr, 
+        IID_PPV_ARGS(m_dispatchCmdSig.GetAddressOf())));
+}
+
 void RendererCore::SetVSync(const ParamVariant& p)
 {
     m_vsyncInterval = p.GetBool() ? 1 : 0;
@@ -601,4 +887,55 @@ void RendererCore::SetVSync(const ParamVariant& p)
     }
     else
         m_presentFlags = 0;
+}
+
+void RendererCore::SetFramesInFlight(const ParamVariant& p)
+{
+    m_queuedFramesInFlight = (uint16_t)p.GetInt().m_value;
+}
+
+void RendererCore::SetFrameInterpolation(const ParamVariant& p)
+{
+    m_queuedFrameInterpolation = p.GetBool();
+}
+
+void RendererCore::SetJustInTime(const ParamVariant& p)
+{
+    m_justInTime = p.GetBool();
+    m_jitSleepMs = 0.0f;
+}
+
+void RendererCore::UpdateBackBufferIndices()
+{
+    // Without a swap chain, back buffers are simply used round robin
+    const uint16_t nextBackBuffIdx = IsHeadless() ? 
+        (uint16_t)((m_currBackBuffIdx + 1) % Constants::NUM_BACK_BUFFERS) :
+        (uint16_t)m_deviceObjs.m_dxgiSwapChain->GetCurrentBackBufferIndex();
+
+    // Flip-model swap chains present back buffers in order, so the interpolated frame 
+    // takes the next back buffer and current frame the one after
+    m_interpBackBuffIdx = nextBackBuffIdx;
+    m_currBackBuffIdx = m_frameInterpolation ? 
+        (nextBackBuffIdx + 1) % Constants::NUM_BACK_BUFFERS : 
+        nextBackBuffIdx;
+}
+
+void RendererCore::Present(UINT syncInterval, UINT flags)
+{
+    auto hr = m_deviceObjs.m_dxgiSwapChain->Present(syncInterval, flags);
+    if (FAILED(hr))
+    {
+        if (hr == DXGI_ERROR_DEVICE_REMOVED)
+        {
+            //ComPtr<ID3D12DeviceRemovedExtendedData1> pDred;
+            //CheckHR(m_deviceObjs.m_device->QueryInterface(IID_PPV_ARGS(&pDred)));
+
+            //D3D12_DRED_AUTO_BREADCRUMBS_OUTPUT1 DredAutoBreadcrumbsOutput;
+            //D3D12_DRED_PAGE_FAULT_OUTPUT DredPageFaultOutput;
+            //CheckHR(pDred->GetAutoBreadcrumbsOutput1(&DredAutoBreadcrumbsOutput));
+            //CheckHR(pDred->GetPageFaultAllocationOutput(&DredPageFaultOutput));
+        }
+
+        CheckHR(hr);
+    }
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "GpuTimer.h"
 #include "CommandQueue.h"
 #include "SharedShaderResources.h"
+#include "ShaderArchive.h"
 
 namespace ZetaRay::Support
 {
@@ -21,6 +22,17 @@ namespace ZetaRay::Core
     class CopyCmdList;
     class SharedShaderResources;
 
+    // Points in a frame's lifetime that input-to-GPU-completion latency is measured from. 
+    // Same as the markers that NVIDIA Reflex (NvAPI_D3D_SetLatencyMarker) expects.
+    enum class LATENCY_MARKER
+    {
+        INPUT_SAMPLE,
+        SIMULATION_START,
+        RENDER_SUBMIT,
+        PRESENT,
+        COUNT
+    };
+
     class RendererCore
     {
     public:
@@ -34,10 +46,16 @@ namespace ZetaRay::Core
             uint16_t displayWidth, uint16_t displayHeight);
         void Shutdown();
         void InitBasic();
-        void ShutdownBasic() {};
+        void ShutdownBasic();
         void OnWindowSizeChanged(HWND hwnd, uint16_t renderWidth, uint16_t renderHeight, 
             uint16_t displayWidth, uint16_t displayHeight);
         void WaitForSwapChainWaitableObject();
+        // In just-in-time mode, delays start of the next CPU frame by the time that its GPU 
+        // work would otherwise have waited behind the previous frame, so that input is sampled 
+        // as late as possible without starving the GPU
+        void LatencySleep();
+        // Records the given marker for the current frame. Time defaults to now.
+        void SetLatencyMarker(LATENCY_MARKER m, int64_t cpuTicks = -1);
         void BeginFrame();
         void SubmitResourceCopies();
         void EndFrame(Support::TaskSet& endFrameTS);
@@ -45,38 +63,60 @@ namespace ZetaRay::Core
         ZetaInline ID3D12Device10* GetDevice() { return m_deviceObjs.m_device.Get(); };
         ZetaInline const char* GetDeviceDescription() { return m_deviceObjs.m_deviceName; }
         ZetaInline IDXGIAdapter3* GetAdapter() { return m_deviceObjs.m_dxgiAdapter.Get(); }
+        ZetaInline const DeviceObjects& GetDeviceObjects() const { return m_deviceObjs; }
         DXGI_OUTPUT_DESC GetOutputMonitorDesc() const;
         uint64_t GetCommandQueueTimeStampFrequency(D3D12_COMMAND_LIST_TYPE t) const;
+        // GPU timestamp and CPU (QueryPerformanceCounter) time sampled at the same moment
+        void GetCommandQueueClockCalibration(D3D12_COMMAND_LIST_TYPE t, uint64_t& gpuTimestamp, 
+            uint64_t& cpuTimestamp) const;
 
         ZetaInline uint16_t GetRenderWidth() const { return m_renderWidth; }
         ZetaInline uint16_t GetRenderHeight() const { return m_renderHeight; }
         ZetaInline uint16_t GetDisplayWidth() const { return m_displayWidth; }
         ZetaInline uint16_t GetDisplayHeight() const { return m_displayHeight; }
         ZetaInline float GetAspectRatio() const { return (float)m_renderWidth / m_renderHeight; }
+        // No window or swap chain -- back buffers are offscreen render targets that are never 
+        // presented (see App::HeadlessDesc)
+        ZetaInline bool IsHeadless() const { return m_hwnd == nullptr; }
         ZetaInline int GetCurrentBackBufferIndex() const { return m_currBackBuffIdx; }
         ZetaInline const GpuMemory::Texture& GetCurrentBackBuffer() { return m_backBuffers[m_currBackBuffIdx]; }
         ZetaInline D3D12_CPU_DESCRIPTOR_HANDLE GetCurrBackBufferRTV() const { return m_backbuffDescTable.CPUHandle(m_currBackBuffIdx); }
 
+        // When frame interpolation is enabled, every frame presents two back buffers -- an 
+        // interpolated frame, followed by the current frame (GetCurrentBackBuffer()). Changes 
+        // take effect after the next present.
+        ZetaInline bool IsFrameInterpolationEnabled() const { return m_frameInterpolation; }
+        ZetaInline const GpuMemory::Texture& GetInterpolatedBackBuffer() { return m_backBuffers[m_interpBackBuffIdx]; }
+        ZetaInline D3D12_CPU_DESCRIPTOR_HANDLE GetInterpolatedBackBufferRTV() const { return m_backbuffDescTable.CPUHandle(m_interpBackBuffIdx); }
+
         ZetaInline SharedShaderResources& GetSharedShaderResources() { return m_sharedShaderRes; }
         ZetaInline DescriptorHeap& GetGpuDescriptorHeap() { return m_cbvSrvUavDescHeapGpu; };
         ZetaInline ID3D12DescriptorHeap* GetSamplerDescriptorHeap() { return m_samplerDescHeap.Get(); };
         ZetaInline DescriptorHeap& GetCbvSrvUavDescriptorHeapCpu() { return m_cbvSrvUavDescHeapCpu; };
+        ZetaInline DescriptorStagingHeap& GetDescriptorStagingHeap() { return m_descStagingHeap; };
+        ZetaInline const ShaderArchive& GetShaderArchive() const { return m_shaderArchive; }
         ZetaInline DescriptorHeap& GetRtvDescriptorHeap() { return m_rtvDescHeap; };
-        //ZetaInline DescriptorHeap& GetDsvDescriptorHeap() { return m_dsvDescHeap; };
+        ZetaInline DescriptorHeap& GetDsvDescriptorHeap() { return m_dsvDescHeap; };
         ZetaInline GpuTimer& GetGpuTimer() { return m_gpuTimer; }
 
         GraphicsCmdList* GetGraphicsCmdList();
         ComputeCmdList* GetComputeCmdList();
-        //CopyCmdList* GetCopyCmdList();
+        CopyCmdList* GetCopyCmdList();
         void ReleaseCmdList(CommandList* ctx);
         uint64_t ExecuteCmdList(CommandList* ctx);
 
         void SignalDirectQueue(ID3D12Fence* f, uint64_t v);
         void SignalComputeQueue(ID3D12Fence* f, uint64_t v);
-        // void SignalCopyQueue(ID3D12Fence* f, uint64_t v);
+        void SignalCopyQueue(ID3D12Fence* f, uint64_t v);
 
         bool IsDirectQueueFenceComplete(uint64_t fenceValue);
         bool IsComputeQueueFenceComplete(uint64_t fenceValue);
+        bool IsCopyQueueFenceComplete(uint64_t fenceValue);
+
+        // Value that the frame fence reaches once GPU has finished the frame that is 
+        // currently being recorded
+        ZetaInline uint64_t GetCurrentFrameFenceValue() const { return m_nextFenceVal; }
+        ZetaInline uint64_t GetCompletedFrameFenceValue() { return m_fence->GetCompletedValue(); }
 
         // Waits (CPU side) for the fence on Direct Queue to reach the 
         // specified value (blocking)
@@ -87,11 +127,19 @@ namespace ZetaRay::Core
         // specified value (blocking)
         void WaitForComputeQueueFenceCPU(uint64_t fenceValue);
 
+        // Same as above for the Copy Queue, using the given event so that multiple 
+        // threads can wait at the same time
+        void WaitForCopyQueueFenceCPU2(uint64_t fenceValue, HANDLE e);
+
         // Issues a GPU-side wait on the Compute Queue for the fence on the 
         // Direct Queue. Corresponding fence
         // can only be signalled through ExecuteCmdList() calls.
         void WaitForDirectQueueOnComputeQueue(uint64_t v);
 
+        // Issues a GPU-side wait on the Compute Queue for the frame fence (see
+        // GetCurrentFrameFenceValue()) to reach the specified value.
+        void WaitForFrameOnComputeQueue(uint64_t frameFenceValue);
+
         // Issues a GPU-side wait on the Direct Queue for the Fence on the 
         // Compute Queue. Corresponding fence
         // can only be signalled through ExecuteCmdList() calls.
@@ -100,47 +148,73 @@ namespace ZetaRay::Core
         // Issue a GPU-side wait on the Direct/Compute Queue for the Fence 
         // on the copy queue. That fence
         // can only signalled through ExecuteCmdList() calls.
-        //void WaitForCopyQueueOnDirectQueue(uint64_t v);
-        //void WaitForCopyQueueOnComputeQueue(uint64_t v);
+        void WaitForCopyQueueOnDirectQueue(uint64_t v);
+        void WaitForCopyQueueOnComputeQueue(uint64_t v);
         void FlushAllCommandQueues();
 
+        // Issued on the copy queue -- see GpuMemory::ReservedTexture
+        void UpdateTileMappings(ID3D12Resource* res, uint32_t numRegions,
+            const D3D12_TILED_RESOURCE_COORDINATE* regionCoords, const D3D12_TILE_REGION_SIZE* regionSizes,
+            ID3D12Heap* heap, uint32_t numRanges, const D3D12_TILE_RANGE_FLAGS* rangeFlags,
+            const uint32_t* heapRangeOffsets, const uint32_t* rangeTileCounts);
+
         ZetaInline D3D12_VIEWPORT GetDisplayViewport() const { return m_displayViewport; }
         ZetaInline D3D12_RECT GetDisplayScissor() const { return m_displayScissor; }
         ZetaInline D3D12_VIEWPORT GetRenderViewport() const { return m_renderViewport; }
         ZetaInline D3D12_RECT GetRenderScissor() const { return m_renderScissor; }
 
         ZetaInline bool IsRGBESupported() const { return m_deviceObjs.m_rgbeSupport; };
+        ZetaInline bool IsReservedResourceSupported() const { return m_deviceObjs.m_reservedResourceSupport; };
+        ZetaInline bool IsMeshShaderSupported() const { return m_deviceObjs.m_meshShaderSupport; };
+        ZetaInline bool IsGpuUploadHeapSupported() const { return m_deviceObjs.m_gpuUploadHeapSupport; };
+        ZetaInline uint32_t GetWaveLaneCountMin() const { return m_deviceObjs.m_waveLaneCountMin; };
+        ZetaInline uint32_t GetWaveLaneCountMax() const { return m_deviceObjs.m_waveLaneCountMax; };
         ZetaInline bool IsTearingSupported() const { return m_vsyncInterval == 0 && m_deviceObjs.m_tearingSupport; };
         ZetaInline int GetVSyncInterval() const { return m_vsyncInterval; }
 
         ZetaInline Util::Span<D3D12_STATIC_SAMPLER_DESC> GetStaticSamplers() { return m_staticSamplers; };
+        // Command signature with a single dispatch argument, shared by all the passes that 
+        // size their dispatches on the GPU
+        ZetaInline ID3D12CommandSignature* GetDispatchCmdSig() { return m_dispatchCmdSig.Get(); }
         ZetaInline int GlobalIdxForDoubleBufferedResources() const { return m_globalDoubleBuffIdx; }
         ZetaInline const DescriptorTable& ReservedDescTable() const { return m_reserved; }
 
     private:
         void ResizeBackBuffers(HWND hwnd);
         void InitStaticSamplers();
+        void OpenShaderArchive();
+        void CreateDispatchCmdSig();
         void SetVSync(const Support::ParamVariant& p);
+        void SetFramesInFlight(const Support::ParamVariant& p);
+        void SetFrameInterpolation(const Support::ParamVariant& p);
+        void SetJustInTime(const Support::ParamVariant& p);
+        void UpdateLatency();
+        void UpdateBackBufferIndices();
+        void Present(UINT syncInterval, UINT flags);
 
         DeviceObjects m_deviceObjs;
 
         SharedShaderResources m_sharedShaderRes;
+        ShaderArchive m_shaderArchive;
         DescriptorHeap m_cbvSrvUavDescHeapGpu;
         DescriptorHeap m_cbvSrvUavDescHeapCpu;
+        DescriptorStagingHeap m_descStagingHeap;
         DescriptorHeap m_rtvDescHeap;
         ComPtr<ID3D12DescriptorHeap> m_samplerDescHeap;
-        //DescriptorHeap m_dsvDescHeap;
+        DescriptorHeap m_dsvDescHeap;
         CommandQueue m_directQueue;
         CommandQueue m_computeQueue;
-        //CommandQueue m_copyQueue;
+        CommandQueue m_copyQueue;
 
         DescriptorTable m_backbuffDescTable;
         DescriptorTable m_depthBuffDescTable;
         DescriptorTable m_reserved;
 
-        HWND m_hwnd;
+        HWND m_hwnd = nullptr;
         GpuMemory::Texture m_backBuffers[Constants::NUM_BACK_BUFFERS];
         uint16_t m_currBackBuffIdx = 0;
+        // Back buffer that's presented before the current one when frame interpolation is enabled
+        uint16_t m_interpBackBuffIdx = 0;
         uint16_t m_displayWidth;
         uint16_t m_displayHeight;
         uint16_t m_renderWidth;
@@ -148,6 +222,12 @@ namespace ZetaRay::Core
         UINT m_presentFlags = 0;
         uint16_t m_vsyncInterval = 1;
         uint16_t m_globalDoubleBuffIdx = 0;
+        uint16_t m_framesInFlight = Constants::DEFAULT_FRAMES_IN_FLIGHT;
+        // Applied right after the next present, written by the param callback
+        uint16_t m_queuedFramesInFlight = Constants::DEFAULT_FRAMES_IN_FLIGHT;
+        bool m_frameInterpolation = false;
+        // Same as above
+        bool m_queuedFrameInterpolation = false;
 
         D3D12_VIEWPORT m_displayViewport;
         D3D12_RECT m_displayScissor;
@@ -155,6 +235,7 @@ namespace ZetaRay::Core
         D3D12_RECT m_renderScissor;
 
         D3D12_STATIC_SAMPLER_DESC m_staticSamplers[9];
+        ComPtr<ID3D12CommandSignature> m_dispatchCmdSig;
 
         ComPtr<ID3D12Fence> m_fence;
         uint64_t m_fenceVals[Constants::NUM_BACK_BUFFERS] = { 0 };
@@ -162,5 +243,27 @@ namespace ZetaRay::Core
         HANDLE m_event;
 
         GpuTimer m_gpuTimer;
+
+        // Latency markers of the last few frames, indexed by frame number
+        struct LatencyFrame
+        {
+            uint64_t FrameNum = UINT64_MAX;
+            int64_t Markers[(int)LATENCY_MARKER::COUNT];
+        };
+
+        static constexpr int NUM_LATENCY_FRAMES = 8;
+        // Safety margin for just-in-time mode, so that GPU doesn't go idle from small 
+        // variations in CPU frame time
+        static constexpr float JIT_MARGIN_MS = 1.0f;
+        static constexpr float JIT_MAX_SLEEP_MS = 33.0f;
+
+        LatencyFrame m_latencyFrames[NUM_LATENCY_FRAMES];
+        uint64_t m_lastLatencyFrame = UINT64_MAX;
+        float m_inputToGpuDoneMs = 0.0f;
+        float m_inputToSubmitMs = 0.0f;
+        float m_submitToGpuDoneMs = 0.0f;
+        float m_jitSleepMs = 0.0f;
+        HANDLE m_jitTimer = nullptr;
+        bool m_justInTime = false;
     };
 }
\ No newline at end of file
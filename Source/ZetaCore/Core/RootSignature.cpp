@@ -2,6 +2,8 @@
 #include "RendererCore.h"
 #include "CommandList.h"
 #include "SharedShaderResources.h"
+#include "PipelineStateLibrary.h"
+#include "../Math/Common.h"
 #include <xxHash/xxhash.h>
 
 using namespace ZetaRay;
@@ -14,14 +16,21 @@ namespace
     requires std::same_as<T, GraphicsCmdList> || std::same_as<T, ComputeCmdList>
     void End_Internal(T& ctx, uint32_t rootCBVBitMap, uint32_t rootSRVBitMap, uint32_t rootUAVBitMap, 
         uint32_t globalsBitMap, uint32_t& modifiedBitMap, uint32_t& modifiedGlobalsBitMap, uint32_t optionalBitMap,
-        int rootConstantsIdx, Span<uint32_t> rootConstants, Span<D3D12_GPU_VIRTUAL_ADDRESS> rootDescriptors,
-        Span<uint64_t> globals)
+        int rootConstantsIdx, Span<uint32_t> rootConstants, uint32_t& dirtyConstantsBegin, 
+        uint32_t& dirtyConstantsEnd, Span<D3D12_GPU_VIRTUAL_ADDRESS> rootDescriptors, Span<uint64_t> globals,
+        Span<SharedResourceHandle<GpuMemory::Buffer>> globalBuffs)
     {
-        // Root constants
+        // Root constants (only the range that changed since last time)
         if (rootConstantsIdx != -1 && (modifiedBitMap & (1 << rootConstantsIdx)))
         {
-            ctx.SetRoot32BitConstants(rootConstantsIdx, (uint32_t)rootConstants.size(), rootConstants.data(), 0);
+            Assert(dirtyConstantsBegin < dirtyConstantsEnd && dirtyConstantsEnd <= rootConstants.size(), 
+                "Invalid dirty range.");
+            ctx.SetRoot32BitConstants(rootConstantsIdx, dirtyConstantsEnd - dirtyConstantsBegin, 
+                rootConstants.data() + dirtyConstantsBegin, dirtyConstantsBegin);
+
             modifiedBitMap ^= (1 << rootConstantsIdx);
+            dirtyConstantsBegin = UINT32_MAX;
+            dirtyConstantsEnd = 0;
         }
 
         uint32_t mask;
@@ -95,9 +104,13 @@ namespace
             uint32_t rootBitMap = (1 << nextParam);
             modifiedGlobalsBitMap ^= rootBitMap;
 
+            // Handle is acquired on first use, after that there's no lookup
+            if (!globalBuffs[nextParam].IsValid())
+                globalBuffs[nextParam] = shared.GetDefaultHeapBufferHandle(globals[nextParam]);
+
             if (rootBitMap & rootCBVBitMap)
             {
-                auto* defaultHeapBuff = shared.GetDefaultHeapBuffer(globals[nextParam]);
+                auto* defaultHeapBuff = globalBuffs[nextParam].Get();
                 if (defaultHeapBuff)
                     ctx.SetRootConstantBufferView(nextParam, defaultHeapBuff->GpuVA());
                 else
@@ -111,7 +124,7 @@ namespace
             }
             else if (rootBitMap & rootSRVBitMap)
             {
-                auto* defaultHeapBuff = shared.GetDefaultHeapBuffer(globals[nextParam]);
+                auto* defaultHeapBuff = globalBuffs[nextParam].Get();
                 if (defaultHeapBuff)
                     ctx.SetRootShaderResourceView(nextParam, defaultHeapBuff->GpuVA());
                 else
@@ -126,7 +139,7 @@ namespace
             else if (rootBitMap & rootUAVBitMap)
             {
                 // UAV must be a default heap buffer
-                auto* defaultHeapBuff = shared.GetDefaultHeapBuffer(globals[nextParam]);
+                auto* defaultHeapBuff = globalBuffs[nextParam].Get();
                 if (defaultHeapBuff)
                     ctx.SetRootUnorderedAccessView(nextParam, defaultHeapBuff->GpuVA());
                 else
@@ -281,6 +294,9 @@ void RootSignature::Finalize(const char* name, ComPtr<ID3D12RootSignature>& root
         pOutBlob->GetBufferSize(),
         IID_PPV_ARGS(rootSig.GetAddressOf())));
 
+    PipelineStateLibrary::TagRootSignature(rootSig.Get(), pOutBlob->GetBufferPointer(),
+        pOutBlob->GetBufferSize());
+
     Assert(name, "name was NULL");
     rootSig->SetPrivateData(WKPDID_D3DDebugObjectName, (UINT)strlen(name), name);
 
@@ -301,13 +317,34 @@ void RootSignature::Begin()
     m_modifiedGlobalsBitMap = m_globalsBitMap;
 
     memset(m_rootDescriptors, 0, sizeof(D3D12_GPU_VIRTUAL_ADDRESS) * MAX_NUM_PARAMS);
+
+    // Root arguments are undefined after root signature is set
+    m_dirtyConstantsBegin = 0;
+    m_dirtyConstantsEnd = m_numRootConstants;
 }
 
 void RootSignature::SetRootConstants(uint32_t offset, uint32_t num, const void* data)
 {
     Assert(offset + num <= m_numRootConstants, "Out-of-bound write.");
-    memcpy(&m_rootConstants[offset], data, sizeof(uint32_t) * num);
 
+    // m_rootConstants always matches what was last set on the command list plus the
+    // pending dirty range, so unchanged constants at either end can be skipped
+    const uint32_t* src = reinterpret_cast<const uint32_t*>(data);
+    uint32_t first = 0;
+    uint32_t last = num;
+
+    while (first < last && m_rootConstants[offset + first] == src[first])
+        first++;
+    while (last > first && m_rootConstants[offset + last - 1] == src[last - 1])
+        last--;
+
+    if (first == last)
+        return;
+
+    memcpy(&m_rootConstants[offset + first], src + first, sizeof(uint32_t) * (last - first));
+
+    m_dirtyConstantsBegin = Math::Min(m_dirtyConstantsBegin, offset + first);
+    m_dirtyConstantsEnd = Math::Max(m_dirtyConstantsEnd, offset + last);
     m_modifiedBitMap |= (1 << m_rootConstantsIdx);
 }
 
@@ -318,6 +355,10 @@ void RootSignature::SetRootCBV(uint32_t rootIdx, D3D12_GPU_VIRTUAL_ADDRESS va)
     Assert(!((1 << rootIdx) & m_globalsBitMap), "Root parameter %u was set as global.", 
         rootIdx);
 
+    // Skip if it's already bound
+    if (m_rootDescriptors[rootIdx] == va)
+        return;
+
     m_rootDescriptors[rootIdx] = va;
     m_modifiedBitMap |= (1 << rootIdx);
 }
@@ -329,6 +370,10 @@ void RootSignature::SetRootSRV(uint32_t rootIdx, D3D12_GPU_VIRTUAL_ADDRESS va)
     Assert(!((1 << rootIdx) & m_globalsBitMap), "Root parameter %u was set as global.", 
         rootIdx);
 
+    // Skip if it's already bound
+    if (m_rootDescriptors[rootIdx] == va)
+        return;
+
     m_rootDescriptors[rootIdx] = va;
     m_modifiedBitMap |= (1 << rootIdx);
 }
@@ -340,6 +385,10 @@ void RootSignature::SetRootUAV(uint32_t rootIdx, D3D12_GPU_VIRTUAL_ADDRESS va)
     Assert(!((1 << rootIdx) & m_globalsBitMap), "Root parameter %u was set as global.", 
         rootIdx);
 
+    // Skip if it's already bound
+    if (m_rootDescriptors[rootIdx] == va)
+        return;
+
     m_rootDescriptors[rootIdx] = va;
     m_modifiedBitMap |= (1 << rootIdx);
 }
@@ -348,12 +397,14 @@ void RootSignature::End(GraphicsCmdList& ctx)
 {
     End_Internal(ctx, m_rootCBVBitMap, m_rootSRVBitMap, m_rootUAVBitMap, m_globalsBitMap, 
         m_modifiedBitMap, m_modifiedGlobalsBitMap, m_optionalBitMap, m_rootConstantsIdx, 
-        Span(m_rootConstants, m_numRootConstants), m_rootDescriptors, m_globals);
+        Span(m_rootConstants, m_numRootConstants), m_dirtyConstantsBegin, m_dirtyConstantsEnd, 
+        m_rootDescriptors, m_globals, m_globalBuffs);
 }
 
 void RootSignature::End(ComputeCmdList& ctx)
 {
     End_Internal(ctx, m_rootCBVBitMap, m_rootSRVBitMap, m_rootUAVBitMap, m_globalsBitMap,
         m_modifiedBitMap, m_modifiedGlobalsBitMap, m_optionalBitMap, m_rootConstantsIdx,
-        Span(m_rootConstants, m_numRootConstants), m_rootDescriptors, m_globals);
+        Span(m_rootConstants, m_numRootConstants), m_dirtyConstantsBegin, m_dirtyConstantsEnd, 
+        m_rootDescriptors, m_globals, m_globalBuffs);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Device.h"
+#include "SharedShaderResources.h"
 
 namespace ZetaRay::Util
 {
@@ -52,7 +53,9 @@ namespace ZetaRay::Core
         RootSignature(int nCBV, int nSRV, int nUAV, int nGlobs, int nConsts);
         ~RootSignature() = default;
 
-        RootSignature(const RootSignature&) = delete;
+        // Copies have their own root parameter state, so that different copies can be used
+        // for recording into different command lists in parallel
+        RootSignature(const RootSignature&) = default;
         RootSignature& operator=(const RootSignature&) = delete;
 
         void InitAsConstants(uint32_t rootIdx, uint32_t numDwords, uint32_t registerNum,
@@ -77,7 +80,16 @@ namespace ZetaRay::Core
 
         void Begin();
 
+        // Root parameters are only marked as modified (and subsequently set by End()) when 
+        // they differ from the currently bound ones. For root constants, only the changed 
+        // range is updated.
         void SetRootConstants(uint32_t offset, uint32_t num, const void* data);
+        template<typename T>
+        ZetaInline void SetRootConstants(const T& data, uint32_t offset = 0)
+        {
+            static_assert(sizeof(T) % sizeof(uint32_t) == 0, "Root constants must be 32-bit values.");
+            SetRootConstants(offset, sizeof(T) / sizeof(uint32_t), &data);
+        }
         void SetRootCBV(uint32_t rootIdx, D3D12_GPU_VIRTUAL_ADDRESS va);
         void SetRootSRV(uint32_t rootIdx, D3D12_GPU_VIRTUAL_ADDRESS va);
         void SetRootUAV(uint32_t rootIdx, D3D12_GPU_VIRTUAL_ADDRESS va);
@@ -100,6 +112,8 @@ namespace ZetaRay::Core
 
         // Buffer IDs
         uint64_t m_globals[MAX_NUM_PARAMS];
+        // Default heap buffers for the IDs above, acquired by the first End() call
+        SharedResourceHandle<GpuMemory::Buffer> m_globalBuffs[MAX_NUM_PARAMS];
 
         // Bitmaps indicating the type of each root parameter
         uint32_t m_rootCBVBitMap = 0;
@@ -118,7 +132,10 @@ namespace ZetaRay::Core
         D3D12_GPU_VIRTUAL_ADDRESS m_rootDescriptors[MAX_NUM_PARAMS] = { 0 };
 
         // Root constants data
-        uint32_t m_rootConstants[MAX_NUM_ROOT_CONSTANTS];
+        uint32_t m_rootConstants[MAX_NUM_ROOT_CONSTANTS] = { 0 };
+        // Range of root constants that need to be set in next End() call
+        uint32_t m_dirtyConstantsBegin = 0;
+        uint32_t m_dirtyConstantsEnd = 0;
 
         // Ref: https://www.intel.com/content/www/us/en/developer/articles/technical/introduction-to-resource-binding-in-microsoft-directx-12.html
         // "All the root parameters like descriptor tables, root descriptors, and root constants 
@@ -0,0 +1,182 @@
+#include "ShaderArchive.h"
+#include "../Math/Common.h"
+#include <xxHash/xxhash.h>
+#include <algorithm>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+
+namespace
+{
+    struct ArchiveHeader
+    {
+        static constexpr uint32_t MAGIC = 0x53484152;   // "SHAR"
+        static constexpr uint32_t VERSION = 1;
+
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t NumEntries;
+        uint32_t Pad;
+    };
+
+    // Bytecode is handed to D3D as is
+    static constexpr uint32_t BYTECODE_ALIGNMENT = 16;
+
+    ZetaInline uint64_t HashName(const char* name)
+    {
+        return XXH3_64bits(name, strlen(name));
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// ShaderArchive
+//--------------------------------------------------------------------------------------
+
+ShaderArchive::~ShaderArchive()
+{
+    Close();
+}
+
+bool ShaderArchive::Open(const char* path)
+{
+    Assert(!IsOpen(), "Archive is already open.");
+
+    if (!Filesystem::MapFile(path, m_file))
+        return false;
+
+    if (!Open(Span<const uint8_t>(m_file.Data, m_file.Size)))
+    {
+        Filesystem::UnmapFile(m_file);
+        return false;
+    }
+
+    return true;
+}
+
+bool ShaderArchive::Open(Span<const uint8_t> data)
+{
+    Assert(!IsOpen(), "Archive is already open.");
+
+    if (data.size() < sizeof(ArchiveHeader))
+        return false;
+
+    ArchiveHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+
+    if (header.Magic != ArchiveHeader::MAGIC || header.Version != ArchiveHeader::VERSION)
+        return false;
+
+    const size_t tocEnd = sizeof(ArchiveHeader) + (size_t)header.NumEntries * sizeof(TocEntry);
+    if (tocEnd > data.size())
+        return false;
+
+    const TocEntry* toc = reinterpret_cast<const TocEntry*>(data.data() + sizeof(ArchiveHeader));
+
+    // Validate once here, so that lookups can't go out of bounds
+    for (uint32_t i = 0; i < header.NumEntries; i++)
+    {
+        if (toc[i].Offset < tocEnd || (size_t)toc[i].Offset + toc[i].Size > data.size())
+            return false;
+    }
+
+    m_data = data.data();
+    m_toc = toc;
+    m_numEntries = header.NumEntries;
+
+    return true;
+}
+
+void ShaderArchive::Close()
+{
+    Filesystem::UnmapFile(m_file);
+
+    m_data = nullptr;
+    m_toc = nullptr;
+    m_numEntries = 0;
+}
+
+bool ShaderArchive::Find(const char* name, Span<const uint8_t>& bytecode, uint64_t& hash) const
+{
+    if (!m_toc)
+        return false;
+
+    const uint64_t nameHash = HashName(name);
+    const TocEntry* end = m_toc + m_numEntries;
+    const TocEntry* it = std::lower_bound(m_toc, end, nameHash,
+        [](const TocEntry& e, uint64_t key)
+        {
+            return e.NameHash < key;
+        });
+
+    if (it == end || it->NameHash != nameHash)
+        return false;
+
+    bytecode = Span<const uint8_t>(m_data + it->Offset, it->Size);
+    hash = it->BytecodeHash;
+
+    return true;
+}
+
+bool ShaderArchive::Build(Span<const Shader> shaders, Vector<uint8_t, Support::SystemAllocator>& archive)
+{
+    SmallVector<TocEntry> toc;
+    toc.resize(shaders.size());
+
+    const size_t tocEnd = sizeof(ArchiveHeader) + shaders.size() * sizeof(TocEntry);
+    size_t curr = Math::AlignUp(tocEnd, (size_t)BYTECODE_ALIGNMENT);
+
+    for (size_t i = 0; i < shaders.size(); i++)
+    {
+        const Shader& s = shaders[i];
+        Check(curr + s.Bytecode.size() <= UINT32_MAX, "Shader archive exceeded maximum size.");
+
+        toc[i] = TocEntry{ .NameHash = HashName(s.Name),
+            .BytecodeHash = HashBytecode(s.Bytecode),
+            .Offset = (uint32_t)curr,
+            .Size = (uint32_t)s.Bytecode.size() };
+
+        curr = Math::AlignUp(curr + s.Bytecode.size(), (size_t)BYTECODE_ALIGNMENT);
+    }
+
+    std::sort(toc.begin(), toc.end(), [](const TocEntry& a, const TocEntry& b)
+        {
+            return a.NameHash < b.NameHash;
+        });
+
+    for (size_t i = 1; i < toc.size(); i++)
+    {
+        if (toc[i].NameHash == toc[i - 1].NameHash)
+            return false;
+    }
+
+    archive.clear();
+    archive.resize(curr, 0);
+
+    const ArchiveHeader header{ .Magic = ArchiveHeader::MAGIC,
+        .Version = ArchiveHeader::VERSION,
+        .NumEntries = (uint32_t)shaders.size(),
+        .Pad = 0 };
+
+    memcpy(archive.data(), &header, sizeof(header));
+    if (!toc.empty())
+        memcpy(archive.data() + sizeof(header), toc.data(), toc.size() * sizeof(TocEntry));
+
+    // Offsets were assigned in input order
+    size_t offset = Math::AlignUp(tocEnd, (size_t)BYTECODE_ALIGNMENT);
+    for (auto& s : shaders)
+    {
+        if (!s.Bytecode.empty())
+            memcpy(archive.data() + offset, s.Bytecode.data(), s.Bytecode.size());
+
+        offset = Math::AlignUp(offset + s.Bytecode.size(), (size_t)BYTECODE_ALIGNMENT);
+    }
+
+    return true;
+}
+
+uint64_t ShaderArchive::HashBytecode(Span<const uint8_t> bytecode)
+{
+    return XXH3_64bits(bytecode.data(), bytecode.size());
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../App/Filesystem.h"
+
+namespace ZetaRay::Core
+{
+    // All the compiled shaders packed into one file (by the PackShaders build step), so
+    // that startup doesn't have to open and read hundreds of small .cso files. Archive is
+    // memory mapped and bytecode is returned as a view into the mapping, which stays valid
+    // until Close(). Layout:
+    //
+    //      | header | TOC -- one entry per shader, sorted by name hash | bytecode... |
+    //
+    // Every entry stores the hash of its bytecode, so that PSO lookups don't have to hash
+    // the bytecode again. Lookups are read-only and can be called from multiple threads.
+    class ShaderArchive
+    {
+    public:
+        static constexpr const char* FILENAME = "Shaders.zsa";
+
+        // Input to Build()
+        struct Shader
+        {
+            // Filename of the compiled shader, e.g. Compositing_cs.cso
+            const char* Name;
+            Util::Span<const uint8_t> Bytecode;
+        };
+
+        ShaderArchive() = default;
+        ~ShaderArchive();
+
+        ShaderArchive(ShaderArchive&&) = delete;
+        ShaderArchive& operator=(ShaderArchive&&) = delete;
+
+        // Returns false if file doesn't exist or isn't a valid archive
+        bool Open(const char* path);
+        // Same as above for an archive that's already in memory. Data must outlive the archive.
+        bool Open(Util::Span<const uint8_t> data);
+        void Close();
+        ZetaInline bool IsOpen() const { return m_toc != nullptr; }
+        ZetaInline uint32_t NumShaders() const { return m_numEntries; }
+
+        // Returns false if archive doesn't have a shader with the given name
+        bool Find(const char* name, Util::Span<const uint8_t>& bytecode, uint64_t& hash) const;
+        ZetaInline bool Contains(const char* name) const
+        {
+            Util::Span<const uint8_t> bytecode(nullptr, 0);
+            uint64_t hash;
+            return Find(name, bytecode, hash);
+        }
+
+        // Returns false if two names have the same hash
+        static bool Build(Util::Span<const Shader> shaders,
+            Util::Vector<uint8_t, Support::SystemAllocator>& archive);
+        // Same hash as what's stored in the archive
+        static uint64_t HashBytecode(Util::Span<const uint8_t> bytecode);
+
+    private:
+        struct TocEntry
+        {
+            uint64_t NameHash;
+            uint64_t BytecodeHash;
+            // From start of the archive
+            uint32_t Offset;
+            uint32_t Size;
+        };
+
+        const uint8_t* m_data = nullptr;
+        const TocEntry* m_toc = nullptr;
+        uint32_t m_numEntries = 0;
+        App::Filesystem::MappedFile m_file;
+    };
+}
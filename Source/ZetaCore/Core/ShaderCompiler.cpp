@@ -0,0 +1,297 @@
+#include "ShaderCompiler.h"
+#include "Device.h"
+#include "../App/Common.h"
+#include "../App/Log.h"
+#include "../App/Path.h"
+#include "../Utility/HashTable.h"
+#include <xxHash/xxhash.h>
+#include <dxcapi.h>
+#include <atomic>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Support;
+
+namespace
+{
+    struct CachedSource
+    {
+        // Owning reference
+        IDxcBlobEncoding* Blob;
+        uint64_t LastWriteTime;
+    };
+
+    struct ShaderCompilerData
+    {
+        HMODULE m_dxcLib = nullptr;
+        DxcCreateInstanceProc m_fpCreateInstance = nullptr;
+        // Keyed by hash of the full path. Shared by all the compilations, so that common
+        // includes (e.g. Common/*.hlsli) are only read from disk after they've changed.
+        HashTable<CachedSource> m_sourceCache;
+        SRWLOCK m_cacheLock = SRWLOCK_INIT;
+        INIT_ONCE m_initOnce = INIT_ONCE_STATIC_INIT;
+    };
+
+    ShaderCompilerData g_compilerData;
+
+    BOOL CALLBACK LoadDXC(PINIT_ONCE, PVOID, PVOID*)
+    {
+        // dxcompiler.dll (and dxil.dll) ship next to the DXC executable
+        Filesystem::Path dxcDir(App::GetDXCPath());
+        dxcDir.ToParent();
+        dxcDir.Append("dxcompiler.dll");
+
+        // LOAD_LIBRARY_SEARCH_DLL_LOAD_DIR requires an absolute path
+        char fullPath[MAX_PATH];
+        const DWORD len = GetFullPathNameA(dxcDir.Get(), MAX_PATH, fullPath, nullptr);
+
+        if (len > 0 && len < MAX_PATH)
+        {
+            g_compilerData.m_dxcLib = LoadLibraryExA(fullPath, nullptr,
+                LOAD_LIBRARY_SEARCH_DLL_LOAD_DIR | LOAD_LIBRARY_SEARCH_DEFAULT_DIRS);
+        }
+
+        if (g_compilerData.m_dxcLib)
+        {
+            g_compilerData.m_fpCreateInstance = reinterpret_cast<DxcCreateInstanceProc>(
+                GetProcAddress(g_compilerData.m_dxcLib, "DxcCreateInstance"));
+        }
+
+        if (!g_compilerData.m_fpCreateInstance)
+            LOG_UI_WARNING("Loading %s failed, falling back to DXC executable.", dxcDir.Get());
+
+        return true;
+    }
+
+    ZetaInline bool EnsureLoaded()
+    {
+        InitOnceExecuteOnce(&g_compilerData.m_initOnce, LoadDXC, nullptr, nullptr);
+        return g_compilerData.m_fpCreateInstance != nullptr;
+    }
+
+    // Returns false if file doesn't exist
+    bool GetLastWriteTime(const wchar_t* path, uint64_t& t)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA attr;
+        if (!GetFileAttributesExW(path, GetFileExInfoStandard, &attr))
+            return false;
+
+        t = ((uint64_t)attr.ftLastWriteTime.dwHighDateTime << 32) | attr.ftLastWriteTime.dwLowDateTime;
+        return true;
+    }
+
+    // Note: IDxcUtils isn't thread-safe, so every compilation creates its own handler
+    // (which lives on the stack), whereas loaded files go through the shared cache.
+    struct IncludeHandler final : public IDxcIncludeHandler
+    {
+        explicit IncludeHandler(IDxcUtils* utils)
+            : m_utils(utils)
+        {}
+
+        HRESULT STDMETHODCALLTYPE LoadSource(LPCWSTR pFilename, IDxcBlob** ppIncludeSource) override
+        {
+            *ppIncludeSource = nullptr;
+
+            wchar_t fullPath[MAX_PATH];
+            const DWORD len = GetFullPathNameW(pFilename, MAX_PATH, fullPath, nullptr);
+            if (len == 0 || len >= MAX_PATH)
+                return E_INVALIDARG;
+
+            uint64_t lastWriteTime;
+            if (!GetLastWriteTime(fullPath, lastWriteTime))
+                return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+
+            // Paths are case-insensitive
+            CharLowerBuffW(fullPath, len);
+            const uint64_t key = XXH3_64bits(fullPath, len * sizeof(wchar_t));
+
+            AcquireSRWLockShared(&g_compilerData.m_cacheLock);
+            auto cached = g_compilerData.m_sourceCache.find(key);
+            if (cached && cached.value()->LastWriteTime == lastWriteTime)
+            {
+                IDxcBlobEncoding* blob = cached.value()->Blob;
+                blob->AddRef();
+                ReleaseSRWLockShared(&g_compilerData.m_cacheLock);
+
+                *ppIncludeSource = blob;
+                return S_OK;
+            }
+            ReleaseSRWLockShared(&g_compilerData.m_cacheLock);
+
+            // New or modified since last time
+            IDxcBlobEncoding* blob = nullptr;
+            HRESULT hr = m_utils->LoadFile(fullPath, nullptr, &blob);
+            if (FAILED(hr))
+                return hr;
+
+            // One reference for the cache
+            blob->AddRef();
+
+            AcquireSRWLockExclusive(&g_compilerData.m_cacheLock);
+            auto& e = g_compilerData.m_sourceCache.insert_or_assign(key,
+                CachedSource{ .Blob = nullptr, .LastWriteTime = 0 });
+            // Some other thread might have loaded it in the meantime
+            if (e.Val.Blob)
+                e.Val.Blob->Release();
+            e.Val.Blob = blob;
+            e.Val.LastWriteTime = lastWriteTime;
+            ReleaseSRWLockExclusive(&g_compilerData.m_cacheLock);
+
+            *ppIncludeSource = blob;
+            return S_OK;
+        }
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+        {
+            if (riid == __uuidof(IDxcIncludeHandler) || riid == __uuidof(IUnknown))
+            {
+                *ppvObject = static_cast<IDxcIncludeHandler*>(this);
+                AddRef();
+                return S_OK;
+            }
+
+            *ppvObject = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        // Lifetime is tied to the scope of compilation, refcount is only tracked for DXC's sake
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return m_refCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            return m_refCount.fetch_sub(1, std::memory_order_relaxed) - 1;
+        }
+
+    private:
+        IDxcUtils* m_utils;
+        std::atomic_uint32_t m_refCount = 1;
+    };
+}
+
+namespace ZetaRay::Core::ShaderCompiler
+{
+    bool IsAvailable()
+    {
+        return EnsureLoaded();
+    }
+
+    void Shutdown()
+    {
+        AcquireSRWLockExclusive(&g_compilerData.m_cacheLock);
+
+        for (auto it = g_compilerData.m_sourceCache.begin_it(); it != g_compilerData.m_sourceCache.end_it();
+            it = g_compilerData.m_sourceCache.next_it(it))
+        {
+            it->Val.Blob->Release();
+        }
+
+        g_compilerData.m_sourceCache.free_memory();
+        ReleaseSRWLockExclusive(&g_compilerData.m_cacheLock);
+
+        if (g_compilerData.m_dxcLib)
+        {
+            FreeLibrary(g_compilerData.m_dxcLib);
+            g_compilerData.m_dxcLib = nullptr;
+            g_compilerData.m_fpCreateInstance = nullptr;
+        }
+    }
+
+    bool CompileComputeShader(const char* pathToHlsl, Span<const char*> defines, 
+        Vector<uint8_t, SystemAllocator>& dxil)
+    {
+        if (!EnsureLoaded())
+            return false;
+
+        ComPtr<IDxcUtils> utils;
+        ComPtr<IDxcCompiler3> compiler;
+        CheckHR(g_compilerData.m_fpCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(utils.GetAddressOf())));
+        CheckHR(g_compilerData.m_fpCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(compiler.GetAddressOf())));
+
+        // Relative includes are resolved against the directory of the main file, so use
+        // the full path for its name
+        wchar_t hlslWide[MAX_PATH];
+        {
+            char fullPath[MAX_PATH];
+            const DWORD len = GetFullPathNameA(pathToHlsl, MAX_PATH, fullPath, nullptr);
+            Check(len > 0 && len < MAX_PATH, "GetFullPathNameA() for %s failed.", pathToHlsl);
+            Common::CharToWideStr(fullPath, hlslWide);
+        }
+
+        IncludeHandler includeHandler(utils.Get());
+
+        // Main file goes through the cache too
+        ComPtr<IDxcBlob> source;
+        if (FAILED(includeHandler.LoadSource(hlslWide, source.GetAddressOf())))
+        {
+            LOG_UI_WARNING("Failed to read %s.", pathToHlsl);
+            return false;
+        }
+
+        static constexpr int MAX_NUM_DEFINES = 8;
+        static constexpr int MAX_DEFINE_LEN = 64;
+        Check(defines.size() <= MAX_NUM_DEFINES, "Number of defines exceeded maximum.");
+
+        wchar_t definesWide[MAX_NUM_DEFINES][MAX_DEFINE_LEN];
+        for (size_t i = 0; i < defines.size(); i++)
+            Common::CharToWideStr(defines[i], definesWide[i]);
+
+        // Should match the arguments in CompileHLSL.cmake
+        const wchar_t* args[] =
+        {
+            hlslWide,
+            L"-T", L"cs_6_7",
+            L"-E", L"main",
+            L"-all_resources_bound",
+            L"-enable-16bit-types",
+            L"-Qstrip_reflect",
+            L"-WX",
+            L"-HV", L"202x",
+#if !defined(NDEBUG) && defined(HAS_DEBUG_SHADERS)
+            L"-Zi",
+            L"-Od",
+            L"-Qembed_debug",
+#endif
+        };
+
+        SmallVector<const wchar_t*, SystemAllocator, ZetaArrayLen(args) + 2 * MAX_NUM_DEFINES> allArgs;
+        allArgs.append_range(args, args + ZetaArrayLen(args));
+
+        for (size_t i = 0; i < defines.size(); i++)
+        {
+            allArgs.push_back(L"-D");
+            allArgs.push_back(definesWide[i]);
+        }
+
+        DxcBuffer sourceBuffer;
+        sourceBuffer.Ptr = source->GetBufferPointer();
+        sourceBuffer.Size = source->GetBufferSize();
+        sourceBuffer.Encoding = DXC_CP_ACP;
+
+        ComPtr<IDxcResult> result;
+        CheckHR(compiler->Compile(&sourceBuffer, allArgs.data(), (UINT32)allArgs.size(), &includeHandler,
+            IID_PPV_ARGS(result.GetAddressOf())));
+
+        ComPtr<IDxcBlobUtf8> errors;
+        if (SUCCEEDED(result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(errors.GetAddressOf()), nullptr)) &&
+            errors && errors->GetStringLength())
+        {
+            App::Log(errors->GetStringPointer(), App::LogMessage::WARNING);
+        }
+
+        HRESULT status;
+        CheckHR(result->GetStatus(&status));
+        if (FAILED(status))
+            return false;
+
+        ComPtr<IDxcBlob> object;
+        CheckHR(result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(object.GetAddressOf()), nullptr));
+
+        dxil.resize(object->GetBufferSize());
+        memcpy(dxil.data(), object->GetBufferPointer(), object->GetBufferSize());
+
+        return true;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "../Utility/SmallVector.h"
+#include "../Utility/Span.h"
+
+namespace ZetaRay::Core::ShaderCompiler
+{
+    // In-process DXC for shader hot-reload. dxcompiler.dll is loaded from the directory
+    // of the DXC executable the first time it's needed, callers are expected to fall back
+    // to the DXC executable when it's not available.
+    bool IsAvailable();
+    void Shutdown();
+
+    // Compiles the compute shader at given path (entry point "main") into dxil. Every define
+    // is of the form NAME or NAME=VALUE. Included files are cached and only read again after 
+    // they've been modified on disk. Compiler output, if any, is logged. Can be called from 
+    // multiple threads.
+    bool CompileComputeShader(const char* pathToHlsl, Util::Span<const char*> defines,
+        Util::Vector<uint8_t, Support::SystemAllocator>& dxil);
+}
@@ -5,103 +5,164 @@ using namespace ZetaRay;
 using namespace ZetaRay::Core;
 using namespace ZetaRay::Core::GpuMemory;
 
+namespace
+{
+    ZetaInline uint64_t HashID(std::string_view id)
+    {
+        return XXH3_64bits(id.data(), id.size());
+    }
+}
+
 //--------------------------------------------------------------------------------------
-// SharedShaderResources
+// SharedShaderResources::Registry
 //--------------------------------------------------------------------------------------
 
-const UploadHeapBuffer* SharedShaderResources::GetUploadHeapBuffer(uint64_t id)
+template<typename T, int N>
+const SharedResourceSlot<T>* SharedShaderResources::Registry<T, N>::Find(uint64_t id)
 {
-    std::shared_lock<std::shared_mutex> lock(m_uploadHeapMtx);
-    auto buff = m_uploadHeapBuffs.find(id);
-    if(buff)
-        return *buff.value();
+    std::shared_lock<std::shared_mutex> lock(m_mtx);
+    if (auto it = m_idToSlot.find(id); it)
+        return &m_slots[*it.value()];
 
     return nullptr;
 }
 
+template<typename T, int N>
+SharedResourceSlot<T>& SharedShaderResources::Registry<T, N>::FindOrAdd(uint64_t id)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mtx);
+        if (auto it = m_idToSlot.find(id); it)
+            return m_slots[*it.value()];
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mtx);
+
+    // Might've been added in the meantime
+    if (auto it = m_idToSlot.find(id); it)
+        return m_slots[*it.value()];
+
+    Check(m_numSlots < N, "Number of shared resources exceeded maximum allowed (%d).", N);
+    const uint32_t idx = m_numSlots++;
+    m_idToSlot.insert_or_assign(id, idx);
+
+    return m_slots[idx];
+}
+
+template<typename T, int N>
+void SharedShaderResources::Registry<T, N>::Assign(uint64_t id, const T* res)
+{
+    SharedResourceSlot<T>& slot = FindOrAdd(id);
+    slot.m_res.store(res, std::memory_order_release);
+    slot.m_version.fetch_add(1, std::memory_order_acq_rel);
+}
+
+//--------------------------------------------------------------------------------------
+// SharedShaderResources
+//--------------------------------------------------------------------------------------
+
+const UploadHeapBuffer* SharedShaderResources::GetUploadHeapBuffer(uint64_t id)
+{
+    auto* slot = m_uploadHeapBuffs.Find(id);
+    return slot ? slot->Get() : nullptr;
+}
+
 const UploadHeapBuffer* SharedShaderResources::GetUploadHeapBuffer(std::string_view id)
 {
-    uint64_t h = XXH3_64bits(id.data(), id.size());
-    return GetUploadHeapBuffer(h);
+    return GetUploadHeapBuffer(HashID(id));
+}
+
+SharedResourceHandle<UploadHeapBuffer> SharedShaderResources::GetUploadHeapBufferHandle(uint64_t id)
+{
+    return SharedResourceHandle<UploadHeapBuffer>(m_uploadHeapBuffs.FindOrAdd(id));
+}
+
+SharedResourceHandle<UploadHeapBuffer> SharedShaderResources::GetUploadHeapBufferHandle(std::string_view id)
+{
+    return GetUploadHeapBufferHandle(HashID(id));
 }
 
 void SharedShaderResources::InsertOrAssignUploadHeapBuffer(std::string_view id, UploadHeapBuffer& buf)
 {
-    uint64_t h = XXH3_64bits(id.data(), id.size());
-    InsertOrAssignUploadHeapBuffer(h, buf);
+    InsertOrAssignUploadHeapBuffer(HashID(id), buf);
 }
 
 void SharedShaderResources::InsertOrAssignUploadHeapBuffer(uint64_t id, const UploadHeapBuffer& buf)
 {
-    std::unique_lock<std::shared_mutex> lock(m_uploadHeapMtx);
-    m_uploadHeapBuffs[id] = &buf;
+    m_uploadHeapBuffs.Assign(id, &buf);
 }
 
 const Buffer* SharedShaderResources::GetDefaultHeapBuffer(uint64_t id)
 {
-    std::shared_lock<std::shared_mutex> lock(m_defaultHeapMtx);
-    auto it = m_defaultHeapBuffs.find(id);
-    if (!it)
-        return nullptr;
-
-    return *it.value();
+    auto* slot = m_defaultHeapBuffs.Find(id);
+    return slot ? slot->Get() : nullptr;
 }
 
 const Buffer* SharedShaderResources::GetDefaultHeapBuffer(std::string_view id)
 {
-    uint64_t h = XXH3_64bits(id.data(), id.size());
-    return GetDefaultHeapBuffer(h);
+    return GetDefaultHeapBuffer(HashID(id));
+}
+
+SharedResourceHandle<Buffer> SharedShaderResources::GetDefaultHeapBufferHandle(uint64_t id)
+{
+    return SharedResourceHandle<Buffer>(m_defaultHeapBuffs.FindOrAdd(id));
+}
+
+SharedResourceHandle<Buffer> SharedShaderResources::GetDefaultHeapBufferHandle(std::string_view id)
+{
+    return GetDefaultHeapBufferHandle(HashID(id));
 }
 
 void SharedShaderResources::InsertOrAssignDefaultHeapBuffer(uint64_t id, const Buffer& buf)
 {
-    std::unique_lock<std::shared_mutex> lock(m_defaultHeapMtx);
-    m_defaultHeapBuffs[id] = &buf;
+    m_defaultHeapBuffs.Assign(id, &buf);
 }
 
 void SharedShaderResources::InsertOrAssignDefaultHeapBuffer(std::string_view id, const Buffer& buf)
 {
-    uint64_t h = XXH3_64bits(id.data(), id.size());
-    InsertOrAssignDefaultHeapBuffer(h, buf);
+    InsertOrAssignDefaultHeapBuffer(HashID(id), buf);
 }
 
 void SharedShaderResources::RemoveDefaultHeapBuffer(uint64_t id, const Buffer& buf)
 {
-    std::unique_lock<std::shared_mutex> lock(m_defaultHeapMtx);
-    auto numDeleted = m_defaultHeapBuffs.erase(id);
-    Assert(numDeleted == 1, "Buffer with ID %llu was not found.", id);
+    Assert(GetDefaultHeapBuffer(id), "Buffer with ID %llu was not found.", id);
+
+    // Slot is kept around for existing handles
+    m_defaultHeapBuffs.Assign(id, nullptr);
 }
 
 void SharedShaderResources::RemoveDefaultHeapBuffer(std::string_view id, const Buffer& buf)
 {
-    uint64_t h = XXH3_64bits(id.data(), id.size());
-    auto numDeleted = m_defaultHeapBuffs.erase(h);
-    Assert(numDeleted == 1, "Buffer with ID %llu was not found.", id);
+    RemoveDefaultHeapBuffer(HashID(id), buf);
 }
 
 const DescriptorTable* SharedShaderResources::GetDescriptorTable(uint64_t id)
 {
-    std::shared_lock<std::shared_mutex> lock(m_descTableMtx);
-    if (auto it = m_descTables.find(id); it)
-        return *it.value();
-
-    return nullptr;
+    auto* slot = m_descTables.Find(id);
+    return slot ? slot->Get() : nullptr;
 }
 
 const DescriptorTable* SharedShaderResources::GetDescriptorTable(std::string_view id)
 {
-    uint64_t h = XXH3_64bits(id.data(), id.size());
-    return GetDescriptorTable(h);
+    return GetDescriptorTable(HashID(id));
+}
+
+SharedResourceHandle<DescriptorTable> SharedShaderResources::GetDescriptorTableHandle(uint64_t id)
+{
+    return SharedResourceHandle<DescriptorTable>(m_descTables.FindOrAdd(id));
+}
+
+SharedResourceHandle<DescriptorTable> SharedShaderResources::GetDescriptorTableHandle(std::string_view id)
+{
+    return GetDescriptorTableHandle(HashID(id));
 }
 
 void SharedShaderResources::InsertOrAssignDescriptorTable(uint64_t id, const DescriptorTable& t)
 {
-    std::unique_lock<std::shared_mutex> lock(m_descTableMtx);
-    m_descTables[id] = &t;
+    m_descTables.Assign(id, &t);
 }
 
 void SharedShaderResources::InsertOrAssignDescriptorTable(std::string_view id, const DescriptorTable& t)
 {
-    uint64_t h = XXH3_64bits(id.data(), id.size());
-    InsertOrAssignDescriptorTable(h, t);
-}
\ No newline at end of file
+    InsertOrAssignDescriptorTable(HashID(id), t);
+}
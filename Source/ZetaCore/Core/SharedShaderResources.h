@@ -2,6 +2,7 @@
 
 #include "../Utility/HashTable.h"
 #include <shared_mutex>
+#include <atomic>
 
 namespace ZetaRay::Core::GpuMemory
 {
@@ -12,9 +13,56 @@ namespace ZetaRay::Core::GpuMemory
 namespace ZetaRay::Core
 {
     struct DescriptorTable;
+    class SharedShaderResources;
 
-    // Allows sharing buffers (in upload and default heaps), descriptor tables, and other resources 
-    // that are shared between various shaders. Access is synchronized.
+    // Stable location of a shared resource. Stays valid for the lifetime of
+    // SharedShaderResources, even before the resource is inserted or after it's removed.
+    template<typename T>
+    struct SharedResourceSlot
+    {
+        ZetaInline const T* Get() const { return m_res.load(std::memory_order_acquire); }
+        // Incremented every time the resource is assigned or removed
+        ZetaInline uint32_t Version() const { return m_version.load(std::memory_order_acquire); }
+
+    private:
+        friend class SharedShaderResources;
+
+        std::atomic<const T*> m_res = nullptr;
+        std::atomic<uint32_t> m_version = 0;
+    };
+
+    // Cached reference to a shared resource. Reading it doesn't involve hashing or locking.
+    template<typename T>
+    struct SharedResourceHandle
+    {
+        SharedResourceHandle() = default;
+        explicit SharedResourceHandle(const SharedResourceSlot<T>& slot)
+            : m_slot(&slot),
+            m_version(slot.Version())
+        {}
+
+        ZetaInline bool IsValid() const { return m_slot != nullptr; }
+        // Null if the resource hasn't been inserted yet or was removed
+        ZetaInline const T* Get() const { return m_slot->Get(); }
+        // Returns true if the resource was assigned or removed since the last call (or
+        // since this handle was created)
+        ZetaInline bool Changed()
+        {
+            const uint32_t v = m_slot->Version();
+            const bool changed = v != m_version;
+            m_version = v;
+
+            return changed;
+        }
+
+    private:
+        const SharedResourceSlot<T>* m_slot = nullptr;
+        uint32_t m_version = 0;
+    };
+
+    // Allows sharing buffers (in upload and default heaps), descriptor tables, and other resources
+    // that are shared between various shaders. Access is synchronized. For resources that are
+    // looked up every frame, prefer caching a handle.
     class SharedShaderResources
     {
     public:
@@ -23,16 +71,20 @@ namespace ZetaRay::Core
 
         SharedShaderResources(SharedShaderResources&&) = delete;
         SharedShaderResources& operator==(SharedShaderResources&&) = delete;
-        
+
         // Upload heap buffers
         const GpuMemory::UploadHeapBuffer* GetUploadHeapBuffer(uint64_t id);
         const GpuMemory::UploadHeapBuffer* GetUploadHeapBuffer(std::string_view id);
+        SharedResourceHandle<GpuMemory::UploadHeapBuffer> GetUploadHeapBufferHandle(uint64_t id);
+        SharedResourceHandle<GpuMemory::UploadHeapBuffer> GetUploadHeapBufferHandle(std::string_view id);
         void InsertOrAssignUploadHeapBuffer(uint64_t, const GpuMemory::UploadHeapBuffer& buffer);
         void InsertOrAssignUploadHeapBuffer(std::string_view id, GpuMemory::UploadHeapBuffer& buffer);
 
         // Default heap buffers
         const GpuMemory::Buffer* GetDefaultHeapBuffer(uint64_t id);
         const GpuMemory::Buffer* GetDefaultHeapBuffer(std::string_view id);
+        SharedResourceHandle<GpuMemory::Buffer> GetDefaultHeapBufferHandle(uint64_t id);
+        SharedResourceHandle<GpuMemory::Buffer> GetDefaultHeapBufferHandle(std::string_view id);
         void InsertOrAssignDefaultHeapBuffer(uint64_t id, const GpuMemory::Buffer& buffer);
         void InsertOrAssignDefaultHeapBuffer(std::string_view id, const GpuMemory::Buffer& buffer);
         void RemoveDefaultHeapBuffer(uint64_t id, const GpuMemory::Buffer& buffer);
@@ -41,16 +93,28 @@ namespace ZetaRay::Core
         // Descriptor tables
         const DescriptorTable* GetDescriptorTable(uint64_t id);
         const DescriptorTable* GetDescriptorTable(std::string_view id);
+        SharedResourceHandle<DescriptorTable> GetDescriptorTableHandle(uint64_t id);
+        SharedResourceHandle<DescriptorTable> GetDescriptorTableHandle(std::string_view id);
         void InsertOrAssignDescriptorTable(uint64_t id, const DescriptorTable& table);
         void InsertOrAssignDescriptorTable(std::string_view id, const DescriptorTable& table);
 
     private:
-        Util::HashTable<const DescriptorTable*> m_descTables;
-        Util::HashTable<const GpuMemory::UploadHeapBuffer*> m_uploadHeapBuffs;
-        Util::HashTable<const GpuMemory::Buffer*> m_defaultHeapBuffs;
+        // Slots are never freed, so that handles to them remain valid
+        template<typename T, int N>
+        struct Registry
+        {
+            const SharedResourceSlot<T>* Find(uint64_t id);
+            SharedResourceSlot<T>& FindOrAdd(uint64_t id);
+            void Assign(uint64_t id, const T* res);
 
-        std::shared_mutex m_descTableMtx;
-        std::shared_mutex m_uploadHeapMtx;
-        std::shared_mutex m_defaultHeapMtx;
+            Util::HashTable<uint32_t> m_idToSlot;
+            SharedResourceSlot<T> m_slots[N];
+            uint32_t m_numSlots = 0;
+            std::shared_mutex m_mtx;
+        };
+
+        Registry<DescriptorTable, 32> m_descTables;
+        Registry<GpuMemory::UploadHeapBuffer, 32> m_uploadHeapBuffs;
+        Registry<GpuMemory::Buffer, 64> m_defaultHeapBuffs;
     };
-}
\ No newline at end of file
+}
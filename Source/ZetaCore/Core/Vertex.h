@@ -12,4 +12,37 @@ namespace ZetaRay::Core
         Math::oct32 Normal;
         Math::oct32 Tangent;
     };
-}
\ No newline at end of file
+
+    // 16 bytes. GPU layout of the scene vertex buffer when COMPACT_VERTEX is enabled 
+    // (see RayTracing/RtCommon.h), must match the one in Common/RT.hlsli.
+    struct CompactVertex
+    {
+        CompactVertex() = default;
+        // Position is mapped to [-1, 1] relative to the mesh AABB
+        CompactVertex(const Vertex& v, const Math::float3& center, const Math::float3& extents)
+            : TexUV(v.TexUV.x, v.TexUV.y),
+            Normal(v.Normal)
+        {
+            const float p[3] = { (v.Position.x - center.x) / extents.x, 
+                (v.Position.y - center.y) / extents.y, 
+                (v.Position.z - center.z) / extents.z };
+
+            for (int i = 0; i < 3; i++)
+            {
+                const float q = p[i] < -1.0f ? -1.0f : (p[i] > 1.0f ? 1.0f : p[i]);
+                PosQ_TangentU[i] = (int16_t)roundf(q * INT16_MAX);
+            }
+
+            // Tangents are only used for normal mapping, 8 bits per component is enough
+            const uint16_t tx = (uint16_t)((v.Tangent.v.x + 128u) >> 8);
+            const uint16_t ty = (uint16_t)((v.Tangent.v.y + 128u) >> 8);
+            const uint16_t t = (tx > 255 ? 255 : tx) | ((ty > 255 ? 255 : ty) << 8);
+            PosQ_TangentU[3] = (int16_t)t;
+        }
+
+        // xyz: Position as SNORM16, w: tangent (octahedral encoding with two UNORM8s)
+        int16_t PosQ_TangentU[4];
+        Math::half2 TexUV;
+        Math::oct32 Normal;
+    };
+}
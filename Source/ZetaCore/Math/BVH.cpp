@@ -4,6 +4,8 @@
 #include "../App/Log.h"
 #include "../Scene/SceneCommon.h"
 #include <algorithm>
+#include <intrin.h>
+#include <atomic>
 
 using namespace ZetaRay::Util;
 using namespace ZetaRay::Math;
@@ -27,6 +29,13 @@ namespace
         v_AABB Box = v_AABB(float3(0.0f), float3(-FLT_MAX));
         uint32_t NumEntries = 0;
     };
+
+    // Proportional to the surface area, which is all that's needed for SAH
+    ZetaInline float SurfaceArea(const AABB& box)
+    {
+        const float3 e = box.Extents;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
 }
 
 //--------------------------------------------------------------------------------------
@@ -59,6 +68,47 @@ void BVH::Node::InitAsInternal(Span<BVH::BVHInput> instances, int base, int coun
     Parent = parent;
 }
 
+//--------------------------------------------------------------------------------------
+// WideNode
+//--------------------------------------------------------------------------------------
+
+BVH::WideNode::WideNode()
+{
+    for (int i = 0; i < 4; i++)
+    {
+        MinX[i] = FLT_MAX;
+        MinY[i] = FLT_MAX;
+        MinZ[i] = FLT_MAX;
+        MaxX[i] = -FLT_MAX;
+        MaxY[i] = -FLT_MAX;
+        MaxZ[i] = -FLT_MAX;
+        Child[i] = -1;
+        Count[i] = 0;
+    }
+}
+
+void BVH::WideNode::SetChild(int slot, int child, int count, const Math::AABB& box)
+{
+    MinX[slot] = box.Center.x - box.Extents.x;
+    MinY[slot] = box.Center.y - box.Extents.y;
+    MinZ[slot] = box.Center.z - box.Extents.z;
+    MaxX[slot] = box.Center.x + box.Extents.x;
+    MaxY[slot] = box.Center.y + box.Extents.y;
+    MaxZ[slot] = box.Center.z + box.Extents.z;
+    Child[slot] = child;
+    Count[slot] = count;
+}
+
+void BVH::WideNode::Extend(int slot, const Math::AABB& box)
+{
+    MinX[slot] = Math::Min(MinX[slot], box.Center.x - box.Extents.x);
+    MinY[slot] = Math::Min(MinY[slot], box.Center.y - box.Extents.y);
+    MinZ[slot] = Math::Min(MinZ[slot], box.Center.z - box.Extents.z);
+    MaxX[slot] = Math::Max(MaxX[slot], box.Center.x + box.Extents.x);
+    MaxY[slot] = Math::Max(MaxY[slot], box.Center.y + box.Extents.y);
+    MaxZ[slot] = Math::Max(MaxZ[slot], box.Center.z + box.Extents.z);
+}
+
 //--------------------------------------------------------------------------------------
 // BVH
 //--------------------------------------------------------------------------------------
@@ -66,7 +116,8 @@ void BVH::Node::InitAsInternal(Span<BVH::BVHInput> instances, int base, int coun
 BVH::BVH()
     : m_arena(4 * 1096),
     m_instances(m_arena),
-    m_nodes(m_arena)
+    m_nodes(m_arena),
+    m_wideNodes(m_arena)
 {}
 
 void BVH::Build(Span<BVHInput> instances)
@@ -76,6 +127,38 @@ void BVH::Build(Span<BVHInput> instances)
 
     //m_instances.swap(instances);
     m_instances.append_range(instances.begin(), instances.end(), true);
+
+    BuildTree();
+    BuildWideTree();
+
+    m_internalNodeArea = ComputeInternalNodeArea();
+    m_builtSAHCost = SAHCost();
+}
+
+void BVH::Rebuild()
+{
+    // Drop the removed instances
+    size_t numValid = 0;
+    for (size_t i = 0; i < m_instances.size(); i++)
+    {
+        if (m_instances[i].InstanceID != Scene::INVALID_INSTANCE)
+            m_instances[numValid++] = m_instances[i];
+    }
+
+    if (numValid == 0)
+        return;
+
+    m_instances.resize(numValid);
+
+    BuildTree();
+    BuildWideTree();
+
+    m_internalNodeArea = ComputeInternalNodeArea();
+    m_builtSAHCost = SAHCost();
+}
+
+void BVH::BuildTree()
+{
     Check(m_instances.size() < UINT32_MAX, "#Instances can't exceed UINT32_MAX.");
     const uint32_t numInstances = (uint32_t)m_instances.size();
 
@@ -93,44 +176,111 @@ void BVH::Build(Span<BVHInput> instances)
         m_nodes[0].Base = 0;
         m_nodes[0].Count = (int)m_instances.size();
         m_nodes[0].RightChild = -1;
+        m_numNodes = 1;
 
         return;
     }
 
     // TODO check this computation
     const uint32_t MAX_NUM_NODES = Math::CeilUnsignedIntDiv(4 * numInstances, MAX_NUM_INSTANCES_PER_LEAF) + 1;
+    m_nodes.clear();
     m_nodes.resize(MAX_NUM_NODES);
+    m_numNodes = 0;
 
-    BuildSubtree(0, numInstances, -1);
-}
-
-int BVH::BuildSubtree(int base, int count, int parent)
-{
-    Assert(count > 0, "Number of nodes to build a subtree for must be greater than 0.");
-    const uint32_t currNodeIdx = m_numNodes++;
-    Assert(!m_nodes[currNodeIdx].IsInitialized(), "invalid index");
+    const int numThreads = App::GetNumWorkerThreads() + 1;
 
-    // Create a leaf node and return
-    if (count <= MAX_NUM_INSTANCES_PER_LEAF)
+    if (numInstances < MIN_NUM_INSTANCES_PARALLEL_BUILD || numThreads == 1)
     {
-        m_nodes[currNodeIdx].InitAsLeaf(base, count, parent);
-        return currNodeIdx;
+        BuildSubtree(0, numInstances, -1, m_nodes, m_numNodes);
+        return;
     }
 
-    // Compute union AABB of all centroids
-    __m128 vMinPoint = _mm_set_ps1(FLT_MAX);
-    __m128 vMaxPoint = _mm_set_ps1(-FLT_MAX);
-    // Union AABB of all nodes in this subtree
-    v_AABB vNodeBox(m_instances[base].BoundingBox);
+    // Split the top levels on this thread (with parallel binning), then build the 
+    // resulting subtrees independently. Assembling them in depth-first order gives the 
+    // same node layout as a serial build.
+    const uint32_t maxSubtreeSize = Math::Max(MIN_NUM_INSTANCES_PARALLEL_BUILD,
+        Math::CeilUnsignedIntDiv(numInstances, 4u * numThreads));
+
+    SmallVector<TopLevelNode, App::FrameAllocator> topLevelNodes;
+    SmallVector<Subtree, App::FrameAllocator> subtrees;
+    BuildTopLevels(0, numInstances, maxSubtreeSize, topLevelNodes, subtrees);
+
+    App::ParallelFor(subtrees.size(), 1, [this, &subtrees](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                Subtree& s = subtrees[i];
+                // Every leaf contains at least one instance
+                s.Nodes.resize(2 * s.Count - 1);
+                BuildSubtree(s.Base, s.Count, -1, s.Nodes, s.NumNodes);
+            }
+        });
 
-    for (int i = base; i < base + count; i++)
+    AssembleTopLevels(0, -1, topLevelNodes, subtrees);
+}
+
+uint32_t BVH::FindSplit(int base, int count, bool parallelBinning)
+{
+    // Union AABB of all centroids and union AABB of all nodes in this subtree
+    struct BoundsResult
     {
-        v_AABB vInstanceBox(m_instances[i].BoundingBox);
+        __m128 vMinPoint = _mm_set_ps1(FLT_MAX);
+        __m128 vMaxPoint = _mm_set_ps1(-FLT_MAX);
+        v_AABB vNodeBox;
+    };
+
+    // Work is split into a fixed number of ranges, so that results can be reduced 
+    // without synchronization
+    const int numJobs = parallelBinning ? 
+        Math::Min(App::GetNumWorkerThreads() + 1, MAX_NUM_BINNING_JOBS) : 1;
+    auto jobRange = [base, count, numJobs](int job, int& begin, int& end)
+        {
+            begin = base + (int)(((int64_t)count * job) / numJobs);
+            end = base + (int)(((int64_t)count * (job + 1)) / numJobs);
+        };
+    auto forEachJob = [numJobs](auto&& fn)
+        {
+            if (numJobs == 1)
+                fn(0);
+            else
+            {
+                App::ParallelFor(numJobs, 1, [&fn](size_t begin, size_t end)
+                    {
+                        for (size_t job = begin; job < end; job++)
+                            fn((int)job);
+                    });
+            }
+        };
+
+    BoundsResult bounds[MAX_NUM_BINNING_JOBS];
 
-        vMinPoint = _mm_min_ps(vMinPoint, vInstanceBox.vCenter);
-        vMaxPoint = _mm_max_ps(vMaxPoint, vInstanceBox.vCenter);
+    forEachJob([&](int job)
+        {
+            int begin, end;
+            jobRange(job, begin, end);
+            BoundsResult& r = bounds[job];
+            r.vNodeBox = v_AABB(m_instances[begin].BoundingBox);
+
+            for (int i = begin; i < end; i++)
+            {
+                v_AABB vInstanceBox(m_instances[i].BoundingBox);
+
+                r.vMinPoint = _mm_min_ps(r.vMinPoint, vInstanceBox.vCenter);
+                r.vMaxPoint = _mm_max_ps(r.vMaxPoint, vInstanceBox.vCenter);
+
+                r.vNodeBox = unionAABB(r.vNodeBox, vInstanceBox);
+            }
+        });
 
-        vNodeBox = unionAABB(vNodeBox, v_AABB(m_instances[i].BoundingBox));
+    __m128 vMinPoint = bounds[0].vMinPoint;
+    __m128 vMaxPoint = bounds[0].vMaxPoint;
+    v_AABB vNodeBox = bounds[0].vNodeBox;
+
+    for (int job = 1; job < numJobs; job++)
+    {
+        vMinPoint = _mm_min_ps(vMinPoint, bounds[job].vMinPoint);
+        vMaxPoint = _mm_max_ps(vMaxPoint, bounds[job].vMaxPoint);
+        vNodeBox = unionAABB(vNodeBox, bounds[job].vNodeBox);
     }
 
     v_AABB vCentroidAABB;
@@ -140,10 +290,7 @@ int BVH::BuildSubtree(int base, int count, int parent)
 
     // All centroids are (almost) the same point, no point in splitting further
     if (centroidAABB.Extents.x + centroidAABB.Extents.y + centroidAABB.Extents.z <= 1e-5f)
-    {
-        m_nodes[currNodeIdx].InitAsLeaf(base, count, parent);
-        return currNodeIdx;
-    }
+        return 0;
 
     // Axis along which partitioning should be performed
     const float* extArr = reinterpret_cast<float*>(&centroidAABB.Extents);
@@ -165,19 +312,33 @@ int BVH::BuildSubtree(int base, int count, int parent)
     // Split using SAH
     if (count >= MIN_NUM_INSTANCES_SPLIT_SAH)
     {
-        Bin bins[NUM_SAH_BINS];
+        Bin jobBins[MAX_NUM_BINNING_JOBS][NUM_SAH_BINS];
         const float leftMostPlane = reinterpret_cast<float*>(&centroidAABB.Center)[splitAxis] - maxExtent;
         const float rcpStepSize = NUM_SAH_BINS / (2.0f * maxExtent);
 
         // Assign each instance to one bin
-        for (int i = base; i < base + count; i++)
-        {
-            const float* center = reinterpret_cast<float*>(&m_instances[i].BoundingBox.Center);
-            float numBinWidthsFromLeftMostPlane = (center[splitAxis] - leftMostPlane) * rcpStepSize;
-            int bin = Math::Min((int)numBinWidthsFromLeftMostPlane, (int)NUM_SAH_BINS - 1);
+        forEachJob([&](int job)
+            {
+                int begin, end;
+                jobRange(job, begin, end);
+
+                for (int i = begin; i < end; i++)
+                {
+                    const float* center = reinterpret_cast<float*>(&m_instances[i].BoundingBox.Center);
+                    float numBinWidthsFromLeftMostPlane = (center[splitAxis] - leftMostPlane) * rcpStepSize;
+                    int bin = Math::Min((int)numBinWidthsFromLeftMostPlane, (int)NUM_SAH_BINS - 1);
 
-            v_AABB box(m_instances[i].BoundingBox);
-            bins[bin].Extend(box);
+                    v_AABB box(m_instances[i].BoundingBox);
+                    jobBins[job][bin].Extend(box);
+                }
+            });
+
+        Bin* bins = jobBins[0];
+
+        for (int job = 1; job < numJobs; job++)
+        {
+            for (int bin = 0; bin < NUM_SAH_BINS; bin++)
+                bins[bin].Extend(jobBins[job][bin]);
         }
 
         Assert(bins[0].NumEntries > 0 && bins[NUM_SAH_BINS - 1].NumEntries > 0, "first & last bin must contain at least 1 instance.");
@@ -231,10 +392,7 @@ int BVH::BuildSubtree(int base, int count, int parent)
 
         const float noSplitCost = (float)count;
         if (noSplitCost <= lowestCost)
-        {
-            m_nodes[currNodeIdx].InitAsLeaf(base, count, parent);
-            return currNodeIdx;
-        }
+            return 0;
 
         Assert(lowestCostPlane != -1, "bug");
         const float splitPlane = leftMostPlane + (lowestCostPlane + 1) / rcpStepSize;    // == * StepSize
@@ -270,15 +428,224 @@ int BVH::BuildSubtree(int base, int count, int parent)
     }
 
     Assert(splitCount > 0, "bug");
-    uint32_t left = BuildSubtree(base, splitCount, currNodeIdx);
-    uint32_t right = BuildSubtree(base + splitCount, count - splitCount, currNodeIdx);
+
+    return splitCount;
+}
+
+int BVH::BuildSubtree(int base, int count, int parent, MutableSpan<Node> nodes, uint32_t& numNodes)
+{
+    Assert(count > 0, "Number of nodes to build a subtree for must be greater than 0.");
+    const uint32_t currNodeIdx = numNodes++;
+    Assert(!nodes[currNodeIdx].IsInitialized(), "invalid index");
+
+    // Create a leaf node and return
+    if (count <= MAX_NUM_INSTANCES_PER_LEAF)
+    {
+        nodes[currNodeIdx].InitAsLeaf(base, count, parent);
+        return currNodeIdx;
+    }
+
+    const uint32_t splitCount = FindSplit(base, count, false);
+    if (splitCount == 0)
+    {
+        nodes[currNodeIdx].InitAsLeaf(base, count, parent);
+        return currNodeIdx;
+    }
+
+    uint32_t left = BuildSubtree(base, splitCount, currNodeIdx, nodes, numNodes);
+    uint32_t right = BuildSubtree(base + splitCount, count - splitCount, currNodeIdx, nodes, numNodes);
     Assert(left == currNodeIdx + 1, "Index of left child should be equal to current parent's index plus one");
 
-    m_nodes[currNodeIdx].InitAsInternal(m_instances, base, count, right, parent);
+    nodes[currNodeIdx].InitAsInternal(m_instances, base, count, right, parent);
+
+    return currNodeIdx;
+}
+
+int BVH::BuildTopLevels(int base, int count, uint32_t maxSubtreeSize, 
+    Vector<TopLevelNode, App::FrameAllocator>& topLevelNodes, 
+    Vector<Subtree, App::FrameAllocator>& subtrees)
+{
+    const int currIdx = (int)topLevelNodes.size();
+    topLevelNodes.push_back(TopLevelNode{ .Base = base, .Count = count });
+
+    if ((uint32_t)count <= maxSubtreeSize)
+    {
+        topLevelNodes[currIdx].SubtreeIdx = (int)subtrees.size();
+        subtrees.emplace_back(base, count);
+
+        return currIdx;
+    }
+
+    // Note: count > maxSubtreeSize > MAX_NUM_INSTANCES_PER_LEAF
+    const uint32_t splitCount = FindSplit(base, count, 
+        (uint32_t)count >= MIN_NUM_INSTANCES_PARALLEL_BINNING);
+    if (splitCount == 0)
+        return currIdx;
+
+    const int left = BuildTopLevels(base, splitCount, maxSubtreeSize, topLevelNodes, subtrees);
+    const int right = BuildTopLevels(base + splitCount, count - splitCount, maxSubtreeSize, 
+        topLevelNodes, subtrees);
+
+    topLevelNodes[currIdx].Left = left;
+    topLevelNodes[currIdx].Right = right;
+
+    return currIdx;
+}
+
+int BVH::AssembleTopLevels(int topLevelIdx, int parent, 
+    Span<TopLevelNode> topLevelNodes, Span<Subtree> subtrees)
+{
+    const TopLevelNode& topLevelNode = topLevelNodes[topLevelIdx];
+    const uint32_t currNodeIdx = m_numNodes;
+
+    if (topLevelNode.SubtreeIdx != -1)
+    {
+        const Subtree& s = subtrees[topLevelNode.SubtreeIdx];
+        Assert(m_numNodes + s.NumNodes <= m_nodes.size(), "Out-of-bounds write.");
+
+        for (uint32_t i = 0; i < s.NumNodes; i++)
+        {
+            Node n = s.Nodes[i];
+            n.RightChild = n.IsLeaf() ? -1 : n.RightChild + (int)currNodeIdx;
+            n.Parent = i == 0 ? parent : n.Parent + (int)currNodeIdx;
+
+            m_nodes[currNodeIdx + i] = n;
+        }
+
+        m_numNodes += s.NumNodes;
+
+        return currNodeIdx;
+    }
+
+    m_numNodes++;
+
+    if (topLevelNode.Left == -1)
+    {
+        m_nodes[currNodeIdx].InitAsLeaf(topLevelNode.Base, topLevelNode.Count, parent);
+        return currNodeIdx;
+    }
+
+    AssembleTopLevels(topLevelNode.Left, currNodeIdx, topLevelNodes, subtrees);
+    const int right = AssembleTopLevels(topLevelNode.Right, currNodeIdx, topLevelNodes, subtrees);
+
+    m_nodes[currNodeIdx].InitAsInternal(m_instances, topLevelNode.Base, topLevelNode.Count, 
+        right, parent);
 
     return currNodeIdx;
 }
 
+float BVH::ComputeInternalNodeArea()
+{
+    float area = 0.0f;
+
+    for (uint32_t i = 0; i < m_numNodes; i++)
+    {
+        if (!m_nodes[i].IsLeaf())
+            area += SurfaceArea(m_nodes[i].BoundingBox);
+    }
+
+    return area;
+}
+
+float BVH::SAHCost()
+{
+    // Cost of traversing the internal nodes relative to the root. Leaves are left out 
+    // as their instances have to be tested regardless of the tree quality.
+    const float rootArea = SurfaceArea(m_nodes[0].BoundingBox);
+    return rootArea > 0.0f ? m_internalNodeArea / rootArea : 0.0f;
+}
+
+float BVH::SAHCostGrowth()
+{
+    return m_builtSAHCost > 0.0f ? SAHCost() / m_builtSAHCost : 1.0f;
+}
+
+void BVH::BuildWideTree()
+{
+    for (uint32_t i = 0; i < m_numNodes; i++)
+        m_nodes[i].WideSlot = -1;
+
+    m_wideNodes.clear();
+    // Every wide node other than the root replaces at least one internal binary node
+    m_wideNodes.reserve(m_numNodes / 2 + 1);
+
+    CollapseNode(0);
+}
+
+int BVH::CollapseNode(int nodeIdx)
+{
+    const int wideIdx = (int)m_wideNodes.size();
+    m_wideNodes.emplace_back();
+
+    int children[4];
+    int numChildren = 0;
+    const Node& node = m_nodes[nodeIdx];
+
+    // Only happens for the root
+    if (node.IsLeaf())
+        children[numChildren++] = nodeIdx;
+    else
+    {
+        children[numChildren++] = nodeIdx + 1;
+        children[numChildren++] = node.RightChild;
+
+        // Keep replacing the internal child with the largest surface area by its two 
+        // children until there are four
+        while (numChildren < 4)
+        {
+            int largest = -1;
+            float largestArea = -1.0f;
+
+            for (int c = 0; c < numChildren; c++)
+            {
+                const Node& child = m_nodes[children[c]];
+                if (child.IsLeaf())
+                    continue;
+
+                const float area = SurfaceArea(child.BoundingBox);
+
+                if (area > largestArea)
+                {
+                    largestArea = area;
+                    largest = c;
+                }
+            }
+
+            if (largest == -1)
+                break;
+
+            const int opened = children[largest];
+            children[largest] = opened + 1;
+            children[numChildren++] = m_nodes[opened].RightChild;
+        }
+    }
+
+    for (int c = 0; c < numChildren; c++)
+    {
+        Node& child = m_nodes[children[c]];
+        child.WideSlot = wideIdx * 4 + c;
+
+        if (child.IsLeaf())
+        {
+            // Leaves don't store an AABB
+            v_AABB vBox(m_instances[child.Base].BoundingBox);
+
+            for (int i = child.Base + 1; i < child.Base + child.Count; i++)
+                vBox = unionAABB(vBox, v_AABB(m_instances[i].BoundingBox));
+
+            m_wideNodes[wideIdx].SetChild(c, child.Base, child.Count, store(vBox));
+        }
+        else
+        {
+            // Recursion may reallocate m_wideNodes, index it afterwards
+            const int wideChild = CollapseNode(children[c]);
+            m_wideNodes[wideIdx].SetChild(c, wideChild, WideNode::INTERNAL, child.BoundingBox);
+        }
+    }
+
+    return wideIdx;
+}
+
 int BVH::Find(uint64_t instanceID, const Math::AABB& queryBox, int& nodeIdx)
 {
     nodeIdx = -1;
@@ -376,6 +743,9 @@ void BVH::Update(Span<BVHUpdateInput> instances)
         // If the old AABB contains the new one, keep using the old one
         if (res != COLLISION_TYPE::CONTAINS)
         {
+            const int leafSlot = node.WideSlot;
+            m_wideNodes[leafSlot / 4].Extend(leafSlot % 4, newBox);
+
             int currParent = node.Parent;
 
             // Following the parent indices, keep going up the tree and merge the AABBs. Break once a parent node's
@@ -388,8 +758,14 @@ void BVH::Update(Span<BVHUpdateInput> instances)
                 if (Math::intersectAABBvsAABB(vParentBox, vNewBox) == COLLISION_TYPE::CONTAINS)
                     break;
 
+                const float oldArea = SurfaceArea(parentNode.BoundingBox);
                 vParentBox = Math::unionAABB(vParentBox, vNewBox);
                 parentNode.BoundingBox = Math::store(vParentBox);
+                m_internalNodeArea += SurfaceArea(parentNode.BoundingBox) - oldArea;
+
+                // Keep the wide tree in sync, unless this node was collapsed into its parent
+                if (parentNode.WideSlot != -1)
+                    m_wideNodes[parentNode.WideSlot / 4].Extend(parentNode.WideSlot % 4, newBox);
 
                 currParent = m_nodes[currParent].Parent;
             }
@@ -399,6 +775,10 @@ void BVH::Update(Span<BVHUpdateInput> instances)
         // remove and then reinsert the update Node. That requires modifying the range of
         // all the leaves, which is expensive
     }
+
+    // Refitting only ever grows the AABBs, rebuild once the tree has degraded too much
+    if (SAHCostGrowth() > MAX_SAH_COST_GROWTH)
+        Rebuild();
 }
 
 void BVH::Remove(uint64_t ID, const Math::AABB& box)
@@ -416,62 +796,127 @@ void BVH::Remove(uint64_t ID, const Math::AABB& box)
     const uint32_t swapIdx = m_nodes[nodeIdx].Base + m_nodes[nodeIdx].Count - 1;
     std::swap(m_instances[instanceIdx], m_instances[swapIdx]);
     m_nodes[nodeIdx].Count--;
+
+    const int leafSlot = m_nodes[nodeIdx].WideSlot;
+    m_wideNodes[leafSlot / 4].Count[leafSlot % 4]--;
 }
 
-void BVH::DoFrustumCulling(const Math::ViewFrustum& viewFrustum, 
-    const Math::float4x4a& viewToWorld, 
-    Vector<uint64_t, App::FrameAllocator>& visibleInstanceIDs)
+template<typename VisitFunc>
+void BVH::CullWideTree(const v_ViewFrustum& vFrustum, int child, int count, VisitFunc visit)
 {
-    // Transform view frustum from view space into world space
-    v_float4x4 vM = load4x4(const_cast<float4x4a&>(viewToWorld));
-    v_ViewFrustum vFrustum(const_cast<ViewFrustum&>(viewFrustum));
-    vFrustum = Math::transform(vM, vFrustum);
+    // Tests the instances in a leaf 8 at a time. Leaves have up to MAX_NUM_INSTANCES_PER_LEAF
+    // instances unless no split was found.
+    auto visitLeaf = [this, &vFrustum, &visit](int base, int n)
+    {
+        for (int j = base; j < base + n; j += 8)
+        {
+            unsigned long mask = Math::intersectFrustumVsAABB8(vFrustum, &m_instances[j].BoundingBox,
+                Math::Min(base + n - j, 8), sizeof(BVHInput));
+            unsigned long i;
 
-    v_AABB vBox(m_nodes[0].BoundingBox);
+            while (_BitScanForward(&i, mask))
+            {
+                mask ^= (1 << i);
+                visit(j + (int)i);
+            }
+        }
+    };
 
-    // root doesn't intersect camera
-    if (Math::instersectFrustumVsAABB(vFrustum, vBox) == COLLISION_TYPE::DISJOINT)
+    if (count != WideNode::INTERNAL)
+    {
+        visitLeaf(child, count);
         return;
+    }
+
+    constexpr int NUM_PLANES = 6;
+
+    alignas(32) float N_x[8];
+    alignas(32) float N_y[8];
+    alignas(32) float N_z[8];
+    alignas(32) float d[8];
+    _mm256_store_ps(N_x, vFrustum.vN_x);
+    _mm256_store_ps(N_y, vFrustum.vN_y);
+    _mm256_store_ps(N_z, vFrustum.vN_z);
+    _mm256_store_ps(d, vFrustum.vd);
+
+    // An AABB is outside the frustum if its corner that is farthest along the normal 
+    // of some plane (the "positive vertex") is in the negative half space of that plane. 
+    // Per axis, that corner comes from either the min or the max array depending on 
+    // the sign of normal, so it can be found for all four children at once.
+    __m128 vN_x[NUM_PLANES];
+    __m128 vN_y[NUM_PLANES];
+    __m128 vN_z[NUM_PLANES];
+    __m128 vD[NUM_PLANES];
+
+    for (int p = 0; p < NUM_PLANES; p++)
+    {
+        vN_x[p] = _mm_set1_ps(N_x[p]);
+        vN_y[p] = _mm_set1_ps(N_y[p]);
+        vN_z[p] = _mm_set1_ps(N_z[p]);
+        vD[p] = _mm_set1_ps(d[p]);
+    }
 
     // Manual stack
     constexpr int STACK_SIZE = 64;
     int stack[STACK_SIZE];
     int currStackIdx = 0;
 
-    // Insert root
-    stack[currStackIdx] = 0;
-    int currNode = -1;
+    // Insert subtree root
+    stack[currStackIdx] = child;
 
     while (currStackIdx >= 0)
     {
-        Assert(currStackIdx < 64, "Stack size exceeded maximum allowed.");
-
-        currNode = stack[currStackIdx--];
-        const Node& node = m_nodes[currNode];
+        const WideNode& node = m_wideNodes[stack[currStackIdx--]];
+        __m128 vInside = _mm_castsi128_ps(_mm_set1_epi32(-1));
 
-        if (node.IsLeaf())
+        for (int p = 0; p < NUM_PLANES; p++)
         {
-            for (int i = node.Base; i < node.Base + node.Count; i++)
-            {
-                vBox.Reset(m_instances[i].BoundingBox);
+            const __m128 vPx = _mm_load_ps(N_x[p] >= 0.0f ? node.MaxX : node.MinX);
+            const __m128 vPy = _mm_load_ps(N_y[p] >= 0.0f ? node.MaxY : node.MinY);
+            const __m128 vPz = _mm_load_ps(N_z[p] >= 0.0f ? node.MaxZ : node.MinZ);
 
-                if (Math::instersectFrustumVsAABB(vFrustum, vBox) != COLLISION_TYPE::DISJOINT)
-                    visibleInstanceIDs.push_back(m_instances[i].InstanceID);
-            }
+            __m128 vDist = _mm_fmadd_ps(vN_x[p], vPx, vD[p]);
+            vDist = _mm_fmadd_ps(vN_y[p], vPy, vDist);
+            vDist = _mm_fmadd_ps(vN_z[p], vPz, vDist);
+
+            vInside = _mm_and_ps(vInside, _mm_cmpge_ps(vDist, _mm_setzero_ps()));
         }
-        else
+
+        unsigned long mask = _mm_movemask_ps(vInside);
+        unsigned long c;
+
+        while (_BitScanForward(&c, mask))
         {
-            vBox.Reset(node.BoundingBox);
+            mask ^= (1 << c);
 
-            if (Math::instersectFrustumVsAABB(vFrustum, vBox) != COLLISION_TYPE::DISJOINT)
+            if (node.Count[c] == WideNode::INTERNAL)
             {
-                stack[++currStackIdx] = node.RightChild;
-                stack[++currStackIdx] = currNode + 1;
+                Assert(currStackIdx + 1 < STACK_SIZE, "Stack size exceeded maximum allowed.");
+                stack[++currStackIdx] = node.Child[c];
+
+                continue;
             }
+
+            visitLeaf(node.Child[c], node.Count[c]);
         }
     }
 }
 
+void BVH::DoFrustumCulling(const Math::ViewFrustum& viewFrustum, 
+    const Math::float4x4a& viewToWorld, 
+    Vector<uint64_t, App::FrameAllocator>& visibleInstanceIDs)
+{
+    // Transform view frustum from view space into world space
+    v_float4x4 vM = load4x4(const_cast<float4x4a&>(viewToWorld));
+    v_ViewFrustum vFrustum(const_cast<ViewFrustum&>(viewFrustum));
+    vFrustum = Math::transform(vM, vFrustum);
+
+    CullWideTree(vFrustum, 0, WideNode::INTERNAL, [this, &visibleInstanceIDs](int i)
+        {
+            visibleInstanceIDs.push_back(m_instances[i].InstanceID);
+        });
+}
+
 void BVH::DoFrustumCulling(const Math::ViewFrustum& viewFrustum,
     const Math::float4x4a& viewToWorld,
     Vector<BVHInput, App::FrameAllocator>& visibleInstanceIDs)
@@ -481,91 +926,175 @@ void BVH::DoFrustumCulling(const Math::ViewFrustum& viewFrustum,
     v_ViewFrustum vFrustum(const_cast<ViewFrustum&>(viewFrustum));
     vFrustum = Math::transform(vM, vFrustum);
 
-    v_AABB vBox(m_nodes[0].BoundingBox);
+    CullWideTree(vFrustum, 0, WideNode::INTERNAL, [this, &visibleInstanceIDs](int i)
+        {
+            visibleInstanceIDs.emplace_back(BVH::BVHInput{
+                .BoundingBox = m_instances[i].BoundingBox,
+                .InstanceID = m_instances[i].InstanceID });
+        });
+}
 
-    // Root doesn't intersect camera
-    if (Math::instersectFrustumVsAABB(vFrustum, vBox) == COLLISION_TYPE::DISJOINT)
-        return;
+uint32_t BVH::DoFrustumCulling(const Math::ViewFrustum& viewFrustum,
+    const Math::float4x4a& viewToWorld,
+    MutableSpan<uint64_t> visibleInstanceIDs)
+{
+    // Transform view frustum from view space into world space
+    v_float4x4 vM = load4x4(const_cast<float4x4a&>(viewToWorld));
+    v_ViewFrustum vFrustum(const_cast<ViewFrustum&>(viewFrustum));
+    vFrustum = Math::transform(vM, vFrustum);
 
-    // Manual stack
-    constexpr int STACK_SIZE = 64;
-    int stack[STACK_SIZE];
-    int currStackIdx = 0;
+    const int numThreads = App::GetNumWorkerThreads() + 1;
 
-    // Insert root
-    stack[currStackIdx] = 0;
-    int currNode = -1;
+    if (m_instances.size() < MIN_NUM_INSTANCES_PARALLEL_CULLING || numThreads == 1)
+    {
+        uint32_t numVisible = 0;
 
-    while (currStackIdx >= 0)
+        CullWideTree(vFrustum, 0, WideNode::INTERNAL, [this, visibleInstanceIDs, &numVisible](int i)
+            {
+                if (numVisible < visibleInstanceIDs.size())
+                    visibleInstanceIDs[numVisible] = m_instances[i].InstanceID;
+
+                numVisible++;
+            });
+
+        return numVisible;
+    }
+
+    struct SubtreeRoot
     {
-        Assert(currStackIdx < 64, "Stack size exceeded maximum allowed.");
+        int Child;
+        int Count;
+    };
 
-        currNode = stack[currStackIdx--];
-        const Node& node = m_nodes[currNode];
+    // Expand the top levels on this thread until there are enough subtrees to keep all the 
+    // workers busy. Expanded nodes aren't culled, which only makes the traversal more 
+    // conservative as instances are always tested individually.
+    SmallVector<SubtreeRoot, App::FrameAllocator> roots;
+    roots.push_back(SubtreeRoot{ .Child = 0, .Count = WideNode::INTERNAL });
+    const size_t targetNumRoots = 4 * numThreads;
+    size_t curr = 0;
 
-        if (node.IsLeaf())
+    while (curr < roots.size() && roots.size() < targetNumRoots)
+    {
+        if (roots[curr].Count != WideNode::INTERNAL)
         {
-            for (int i = node.Base; i < node.Base + node.Count; i++)
-            {
-                vBox.Reset(m_instances[i].BoundingBox);
+            curr++;
+            continue;
+        }
 
-                if (Math::instersectFrustumVsAABB(vFrustum, vBox) != COLLISION_TYPE::DISJOINT)
-                {
-                    visibleInstanceIDs.emplace_back(BVH::BVHInput{
-                        .BoundingBox = m_instances[i].BoundingBox,
-                        .InstanceID = m_instances[i].InstanceID });
-                }
-            }
+        // Replace with its children
+        const WideNode& node = m_wideNodes[roots[curr].Child];
+        int numChildren = 0;
+
+        for (int c = 0; c < 4; c++)
+        {
+            // Unused slot
+            if (node.Child[c] == -1)
+                continue;
+
+            const SubtreeRoot r{ .Child = node.Child[c], .Count = node.Count[c] };
+
+            if (numChildren++ == 0)
+                roots[curr] = r;
+            else
+                roots.push_back(r);
         }
-        else
+    }
+
+    std::atomic_uint32_t numVisible = 0;
+
+    App::ParallelFor(roots.size(), 1, [this, &roots, &vFrustum, visibleInstanceIDs, &numVisible]
+        (size_t begin, size_t end)
         {
-            vBox.Reset(node.BoundingBox);
+            // Gather results locally and then copy them to the output in chunks to reduce 
+            // contention
+            constexpr uint32_t CHUNK_SIZE = 64;
+            uint64_t chunk[CHUNK_SIZE];
+            uint32_t chunkSize = 0;
+
+            auto flush = [visibleInstanceIDs, &numVisible, &chunk, &chunkSize]()
+                {
+                    const uint32_t offset = numVisible.fetch_add(chunkSize, std::memory_order_relaxed);
+
+                    for (uint32_t j = 0; j < chunkSize; j++)
+                    {
+                        if (offset + j < visibleInstanceIDs.size())
+                            visibleInstanceIDs[offset + j] = chunk[j];
+                    }
+
+                    chunkSize = 0;
+                };
 
-            if (Math::instersectFrustumVsAABB(vFrustum, vBox) != COLLISION_TYPE::DISJOINT)
+            for (size_t i = begin; i < end; i++)
             {
-                stack[++currStackIdx] = node.RightChild;
-                stack[++currStackIdx] = currNode + 1;
+                CullWideTree(vFrustum, roots[i].Child, roots[i].Count, 
+                    [this, &chunk, &chunkSize, &flush](int idx)
+                    {
+                        chunk[chunkSize++] = m_instances[idx].InstanceID;
+
+                        if (chunkSize == CHUNK_SIZE)
+                            flush();
+                    });
             }
-        }
-    }
+
+            flush();
+        });
+
+    return numVisible.load(std::memory_order_relaxed);
 }
 
 uint64_t BVH::CastRay(v_Ray& vRay)
 {
-    v_AABB vBox(m_nodes[0].BoundingBox);
-    float t;
-
-    const __m128 vIsParallel = _mm_cmpge_ps(_mm_set1_ps(FLT_EPSILON), abs(vRay.vDir));
-     const __m128 vDirRcp = _mm_div_ps(_mm_set1_ps(1.0f), vRay.vDir);
+    const __m128 vEps = _mm_set1_ps(FLT_EPSILON);
+    const __m128 vIsParallel = _mm_cmpge_ps(vEps, abs(vRay.vDir));
+    const __m128 vDirRcp = _mm_div_ps(_mm_set1_ps(1.0f), vRay.vDir);
     const __m128 vDirIsPos = _mm_cmpge_ps(vRay.vDir, _mm_setzero_ps());
 
-    // Can return early if ray doesn't intersect root AABB
-    if (!Math::intersectRayVsAABB(vRay, vDirRcp, vDirIsPos, vIsParallel, vBox, t))
-        return Scene::INVALID_INSTANCE;
+    // For the 4-wide slab test, replace near-zero direction components with a tiny value 
+    // of the same sign, so that reciprocals stay finite and no NaNs are produced
+    const __m128 vSignedEps = _mm_or_ps(_mm_and_ps(vRay.vDir, _mm_set1_ps(-0.0f)), vEps);
+    const __m128 vSafeDirRcp = _mm_div_ps(_mm_set1_ps(1.0f),
+        _mm_blendv_ps(vRay.vDir, vSignedEps, vIsParallel));
+
+    const __m128 vO_x = _mm_shuffle_ps(vRay.vOrigin, vRay.vOrigin, V_SHUFFLE_XYZW(0, 0, 0, 0));
+    const __m128 vO_y = _mm_shuffle_ps(vRay.vOrigin, vRay.vOrigin, V_SHUFFLE_XYZW(1, 1, 1, 1));
+    const __m128 vO_z = _mm_shuffle_ps(vRay.vOrigin, vRay.vOrigin, V_SHUFFLE_XYZW(2, 2, 2, 2));
+    const __m128 vRcp_x = _mm_shuffle_ps(vSafeDirRcp, vSafeDirRcp, V_SHUFFLE_XYZW(0, 0, 0, 0));
+    const __m128 vRcp_y = _mm_shuffle_ps(vSafeDirRcp, vSafeDirRcp, V_SHUFFLE_XYZW(1, 1, 1, 1));
+    const __m128 vRcp_z = _mm_shuffle_ps(vSafeDirRcp, vSafeDirRcp, V_SHUFFLE_XYZW(2, 2, 2, 2));
+
+    struct StackEntry
+    {
+        int Child;
+        int Count;
+        // Distance to AABB entry point
+        float T;
+    };
 
     // Manual stack
     constexpr int STACK_SIZE = 64;
-    int stack[STACK_SIZE];
+    StackEntry stack[STACK_SIZE];
     int currStackIdx = 0;
 
     // Insert root
-    stack[currStackIdx] = 0;
-    int currNode = -1;
+    stack[currStackIdx] = StackEntry{ .Child = 0, .Count = WideNode::INTERNAL, .T = 0.0f };
     float minT = FLT_MAX;
     uint64_t closestID = Scene::INVALID_INSTANCE;
 
     while (currStackIdx >= 0)
     {
-        Assert(currStackIdx < STACK_SIZE, "Stack size exceeded 64.");
+        const StackEntry e = stack[currStackIdx--];
 
-        currNode = stack[currStackIdx--];
-        const Node& node = m_nodes[currNode];
+        // A closer hit was found after this entry was pushed
+        if (e.T >= minT)
+            continue;
 
-        if (node.IsLeaf())
+        if (e.Count != WideNode::INTERNAL)
         {
-            for (int i = node.Base; i < node.Base + node.Count; i++)
+            for (int i = e.Child; i < e.Child + e.Count; i++)
             {
-                vBox.Reset(m_instances[i].BoundingBox);
+                const v_AABB vBox(m_instances[i].BoundingBox);
+                float t;
 
                 if (Math::intersectRayVsAABB(vRay, vDirRcp, vDirIsPos, vIsParallel, vBox, t))
                 {
@@ -574,32 +1103,61 @@ uint64_t BVH::CastRay(v_Ray& vRay)
                     closestID = tLtTmin ? m_instances[i].InstanceID : closestID;
                 }
             }
+
+            continue;
         }
-        else
-        {
-            const Node& leftChild = m_nodes[currNode + 1];
-            const Node& rightChild = m_nodes[node.RightChild];
-            const v_AABB vLeftBox(leftChild.BoundingBox);
-            const v_AABB vRightBox(rightChild.BoundingBox);
-            float leftT;
-            float rightT;
 
-            const bool hitLeftChild = Math::intersectRayVsAABB(vRay, vDirRcp, vDirIsPos, vIsParallel, vLeftBox, leftT);
-            const bool hitRightChild = Math::intersectRayVsAABB(vRay, vDirRcp, vDirIsPos, vIsParallel, vRightBox, rightT);
+        // Slab test against all four children
+        const WideNode& node = m_wideNodes[e.Child];
 
-            int sortedByT[2] = { currNode + 1, node.RightChild };
-            const int numChildren = hitLeftChild + hitRightChild;
+        const __m128 vT0_x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinX), vO_x), vRcp_x);
+        const __m128 vT1_x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxX), vO_x), vRcp_x);
+        const __m128 vT0_y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinY), vO_y), vRcp_y);
+        const __m128 vT1_y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxY), vO_y), vRcp_y);
+        const __m128 vT0_z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MinZ), vO_z), vRcp_z);
+        const __m128 vT1_z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.MaxZ), vO_z), vRcp_z);
 
-            // Make sure subtree closer to camera is searched first
-            if (numChildren == 2 && leftT < rightT)
-                std::swap(sortedByT[0], sortedByT[1]);
+        // Farthest entry and nearest exit
+        __m128 vTmin = _mm_max_ps(_mm_min_ps(vT0_x, vT1_x), _mm_min_ps(vT0_y, vT1_y));
+        vTmin = _mm_max_ps(vTmin, _mm_max_ps(_mm_min_ps(vT0_z, vT1_z), _mm_setzero_ps()));
+        __m128 vTmax = _mm_min_ps(_mm_max_ps(vT0_x, vT1_x), _mm_max_ps(vT0_y, vT1_y));
+        vTmax = _mm_min_ps(vTmax, _mm_min_ps(_mm_max_ps(vT0_z, vT1_z), _mm_set1_ps(minT)));
 
-            for (int c = 0; c < numChildren; c++)
+        unsigned long mask = _mm_movemask_ps(_mm_cmple_ps(vTmin, vTmax));
+        if (!mask)
+            continue;
+
+        alignas(16) float tEntry[4];
+        _mm_store_ps(tEntry, vTmin);
+
+        // Sort the hit children by decreasing distance, so that the closest one is 
+        // popped first
+        int sortedByT[4];
+        int numHits = 0;
+        unsigned long c;
+
+        while (_BitScanForward(&c, mask))
+        {
+            mask ^= (1 << c);
+
+            int j = numHits++;
+            while (j > 0 && tEntry[sortedByT[j - 1]] < tEntry[c])
             {
-                // No need to search this subtree as earlier hits are necessarily closer to camera
-                if(sortedByT[c] < minT)
-                    stack[++currStackIdx] = sortedByT[c];
+                sortedByT[j] = sortedByT[j - 1];
+                j--;
             }
+
+            sortedByT[j] = (int)c;
+        }
+
+        Assert(currStackIdx + numHits < STACK_SIZE, "Stack size exceeded maximum allowed.");
+
+        for (int h = 0; h < numHits; h++)
+        {
+            const int slot = sortedByT[h];
+            stack[++currStackIdx] = StackEntry{ .Child = node.Child[slot], 
+                .Count = node.Count[slot], 
+                .T = tEntry[slot] };
         }
     }
 
@@ -611,3 +1169,110 @@ uint64_t BVH::CastRay(Math::Ray& r)
     v_Ray vRay(r);
     return CastRay(vRay);
 }
+
+void BVH::CastRays(Span<Math::Ray> rays, MutableSpan<uint64_t> closestIDs)
+{
+    Assert(closestIDs.size() >= rays.size(), "Output span is too small.");
+
+    auto castRange = [this, rays, closestIDs](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                v_Ray vRay(const_cast<Ray&>(rays[i]));
+                closestIDs[i] = CastRay(vRay);
+            }
+        };
+
+    if (rays.size() < MIN_NUM_QUERIES_PARALLEL || App::GetNumWorkerThreads() == 0)
+        castRange(0, rays.size());
+    else
+        App::ParallelFor(rays.size(), QUERY_GRAIN_SIZE, castRange);
+}
+
+uint32_t BVH::FindOverlaps(const Math::AABB& queryBox, MutableSpan<uint64_t> overlappingIDs)
+{
+    const v_AABB vQueryBox(queryBox);
+
+    const __m128 vQueryMin_x = _mm_set1_ps(queryBox.Center.x - queryBox.Extents.x);
+    const __m128 vQueryMin_y = _mm_set1_ps(queryBox.Center.y - queryBox.Extents.y);
+    const __m128 vQueryMin_z = _mm_set1_ps(queryBox.Center.z - queryBox.Extents.z);
+    const __m128 vQueryMax_x = _mm_set1_ps(queryBox.Center.x + queryBox.Extents.x);
+    const __m128 vQueryMax_y = _mm_set1_ps(queryBox.Center.y + queryBox.Extents.y);
+    const __m128 vQueryMax_z = _mm_set1_ps(queryBox.Center.z + queryBox.Extents.z);
+
+    // Manual stack
+    constexpr int STACK_SIZE = 64;
+    int stack[STACK_SIZE];
+    int currStackIdx = 0;
+
+    // Insert root
+    stack[currStackIdx] = 0;
+    uint32_t numOverlaps = 0;
+
+    while (currStackIdx >= 0)
+    {
+        const WideNode& node = m_wideNodes[stack[currStackIdx--]];
+
+        // Two AABBs overlap if their intervals overlap along all three axes
+        __m128 vOverlaps = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.MinX), vQueryMax_x),
+            _mm_cmpge_ps(_mm_load_ps(node.MaxX), vQueryMin_x));
+        vOverlaps = _mm_and_ps(vOverlaps, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.MinY), vQueryMax_y),
+            _mm_cmpge_ps(_mm_load_ps(node.MaxY), vQueryMin_y)));
+        vOverlaps = _mm_and_ps(vOverlaps, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.MinZ), vQueryMax_z),
+            _mm_cmpge_ps(_mm_load_ps(node.MaxZ), vQueryMin_z)));
+
+        unsigned long mask = _mm_movemask_ps(vOverlaps);
+        unsigned long c;
+
+        while (_BitScanForward(&c, mask))
+        {
+            mask ^= (1 << c);
+
+            if (node.Count[c] == WideNode::INTERNAL)
+            {
+                Assert(currStackIdx + 1 < STACK_SIZE, "Stack size exceeded maximum allowed.");
+                stack[++currStackIdx] = node.Child[c];
+
+                continue;
+            }
+
+            for (int i = node.Child[c]; i < node.Child[c] + node.Count[c]; i++)
+            {
+                const v_AABB vBox(m_instances[i].BoundingBox);
+
+                if (Math::intersectAABBvsAABB(vQueryBox, vBox) != COLLISION_TYPE::DISJOINT)
+                {
+                    if (numOverlaps < overlappingIDs.size())
+                        overlappingIDs[numOverlaps] = m_instances[i].InstanceID;
+
+                    numOverlaps++;
+                }
+            }
+        }
+    }
+
+    return numOverlaps;
+}
+
+void BVH::FindOverlaps(Span<Math::AABB> queryBoxes, uint32_t maxNumOverlapsPerQuery,
+    MutableSpan<uint64_t> overlappingIDs, MutableSpan<uint32_t> numOverlaps)
+{
+    Assert(overlappingIDs.size() >= queryBoxes.size() * maxNumOverlapsPerQuery, "Output span is too small.");
+    Assert(numOverlaps.size() >= queryBoxes.size(), "Output span is too small.");
+
+    auto queryRange = [this, queryBoxes, maxNumOverlapsPerQuery, overlappingIDs, numOverlaps]
+        (size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                MutableSpan<uint64_t> ids(overlappingIDs.data() + i * maxNumOverlapsPerQuery, 
+                    maxNumOverlapsPerQuery);
+                numOverlaps[i] = FindOverlaps(queryBoxes[i], ids);
+            }
+        };
+
+    if (queryBoxes.size() < MIN_NUM_QUERIES_PARALLEL || App::GetNumWorkerThreads() == 0)
+        queryRange(0, queryBoxes.size());
+    else
+        App::ParallelFor(queryBoxes.size(), QUERY_GRAIN_SIZE, queryRange);
+}
@@ -39,6 +39,11 @@ namespace ZetaRay::Math
         void Build(Util::Span<BVHInput> instances);
         void Update(Util::Span<BVHUpdateInput> instances);
         void Remove(uint64_t ID, const Math::AABB& AABB);
+        // Rebuilds the tree from the current instance AABBs. Called by Update() once 
+        // refitting has degraded the tree by more than MAX_SAH_COST_GROWTH.
+        void Rebuild();
+        // Ratio of the current SAH cost to the cost right after the last (re)build
+        float SAHCostGrowth();
 
         // Returns ID of instances that at least partially overlap the view frustum. Assumes 
         // the view frustum is in view space.
@@ -52,11 +57,34 @@ namespace ZetaRay::Math
             const Math::float4x4a& viewToWorld,
             Util::Vector<BVHInput, App::FrameAllocator>& visibleInstanceIDs);
 
+        // Writes IDs of instances that at least partially overlap the view frustum into the 
+        // given span and returns their total number. When the span is too small, only the 
+        // first visibleInstanceIDs.size() are written. Order of the results is unspecified. 
+        // Assumes the view frustum is in view space.
+        uint32_t DoFrustumCulling(const Math::ViewFrustum& viewFrustum,
+            const Math::float4x4a& viewToWorld,
+            Util::MutableSpan<uint64_t> visibleInstanceIDs);
+
         // Casts a ray into the BVH and returns the closest intersection. Ray is assumed to 
         // be in world space.
         uint64_t CastRay(Math::Ray& r);
         uint64_t CastRay(Math::v_Ray& r);
 
+        // Casts every ray and writes the ID of the closest instance (or INVALID_INSTANCE) 
+        // to the corresponding element of closestIDs
+        void CastRays(Util::Span<Math::Ray> rays, Util::MutableSpan<uint64_t> closestIDs);
+
+        // Writes IDs of instances whose AABB overlaps the given AABB into the given span and 
+        // returns their total number. When the span is too small, only the first 
+        // overlappingIDs.size() are written.
+        uint32_t FindOverlaps(const Math::AABB& queryBox, Util::MutableSpan<uint64_t> overlappingIDs);
+
+        // Batched version of above. Results for query i are written to 
+        // overlappingIDs[i * maxNumOverlapsPerQuery, (i + 1) * maxNumOverlapsPerQuery) and their 
+        // total number to numOverlaps[i].
+        void FindOverlaps(Util::Span<Math::AABB> queryBoxes, uint32_t maxNumOverlapsPerQuery,
+            Util::MutableSpan<uint64_t> overlappingIDs, Util::MutableSpan<uint32_t> numOverlaps);
+
         // Returns AABB that contains the scene
         Math::AABB GetWorldAABB() 
         {
@@ -69,6 +97,19 @@ namespace ZetaRay::Math
         static constexpr uint32_t MAX_NUM_INSTANCES_PER_LEAF = 8;
         static constexpr uint32_t MIN_NUM_INSTANCES_SPLIT_SAH = 10;
         static constexpr uint32_t NUM_SAH_BINS = 6;
+        // Builds with fewer instances run on the calling thread
+        static constexpr uint32_t MIN_NUM_INSTANCES_PARALLEL_BUILD = 4 * 1024;
+        // Nodes with at least this many instances are binned in parallel
+        static constexpr uint32_t MIN_NUM_INSTANCES_PARALLEL_BINNING = 64 * 1024;
+        static constexpr int MAX_NUM_BINNING_JOBS = 32;
+        // Maximum allowed growth of SAH cost due to refitting before the tree is rebuilt
+        static constexpr float MAX_SAH_COST_GROWTH = 1.5f;
+        // Batched queries with fewer rays or boxes run on the calling thread
+        static constexpr uint32_t MIN_NUM_QUERIES_PARALLEL = 256;
+        static constexpr uint32_t QUERY_GRAIN_SIZE = 64;
+        // Frustum culling is split across worker threads for BVHs with at least this many 
+        // instances
+        static constexpr uint32_t MIN_NUM_INSTANCES_PARALLEL_CULLING = 16 * 1024;
 
         struct alignas(64) Node
         {
@@ -103,10 +144,91 @@ namespace ZetaRay::Math
             int RightChild;
 
             int Parent = -1;
+
+            // Location of this node in the wide tree as (4 * wide node index + slot), -1 
+            // if it was collapsed into its parent
+            int WideSlot = -1;
         };
 
+        // 4-wide node that is collapsed from the binary tree. Child AABBs are stored as 
+        // SoA so that all of them can be tested against a ray or frustum at once.
+        struct alignas(64) WideNode
+        {
+            static constexpr int INTERNAL = -1;
+
+            WideNode();
+            void SetChild(int slot, int child, int count, const Math::AABB& box);
+            // Grows the child AABB to include the given AABB
+            void Extend(int slot, const Math::AABB& box);
+
+            float MinX[4];
+            float MinY[4];
+            float MinZ[4];
+            float MaxX[4];
+            float MaxY[4];
+            float MaxZ[4];
+
+            // For internal children, index of the child wide node. For leaves, index of 
+            // the first instance.
+            int Child[4];
+            // Number of instances for leaves, INTERNAL otherwise. Unused slots are empty
+            // leaves with an inverted AABB, which never passes any test.
+            int Count[4];
+        };
+
+        // Node of the top levels of the tree that are split on the calling thread
+        struct TopLevelNode
+        {
+            int Base;
+            int Count;
+            int Left = -1;
+            int Right = -1;
+            // Index into subtrees that are built in parallel, -1 otherwise
+            int SubtreeIdx = -1;
+        };
+
+        struct Subtree
+        {
+            Subtree(int base, int count)
+                : Base(base),
+                Count(count)
+            {}
+
+            int Base;
+            int Count;
+            // Indices are relative to the subtree root
+            Util::SmallVector<Node, Support::SystemAllocator> Nodes;
+            uint32_t NumNodes = 0;
+        };
+
+        // Partitions the given range and returns the number of instances in the left 
+        // subtree, or zero when range should become a leaf
+        uint32_t FindSplit(int base, int count, bool parallelBinning);
         // Recursively builds a BVH (subtree) for the given range
-        int BuildSubtree(int base, int count, int parent);
+        int BuildSubtree(int base, int count, int parent, Util::MutableSpan<Node> nodes, 
+            uint32_t& numNodes);
+        int BuildTopLevels(int base, int count, uint32_t maxSubtreeSize, 
+            Util::Vector<TopLevelNode, App::FrameAllocator>& topLevelNodes,
+            Util::Vector<Subtree, App::FrameAllocator>& subtrees);
+        // Copies top-level nodes and subtrees in depth-first order into the node array
+        int AssembleTopLevels(int topLevelIdx, int parent, Util::Span<TopLevelNode> topLevelNodes,
+            Util::Span<Subtree> subtrees);
+
+        // Builds the binary tree for m_instances
+        void BuildTree();
+        // Sum of surface areas of internal nodes
+        float ComputeInternalNodeArea();
+        float SAHCost();
+
+        // Collapses the binary tree into the wide tree
+        void BuildWideTree();
+        int CollapseNode(int nodeIdx);
+        // Calls visit(i) for every instance i in the given subtree that at least partially 
+        // overlaps the given (world-space) view frustum. (child, count) has the same meaning
+        // as in WideNode.
+        template<typename VisitFunc>
+        void CullWideTree(const Math::v_ViewFrustum& vFrustum, int child, int count, 
+            VisitFunc visit);
 
         // Finds the leaf node that contains the given instance. Returns -1 otherwise.
         int Find(uint64_t instanceID, const Math::AABB& AABB, int& modelIdx);
@@ -115,10 +237,16 @@ namespace ZetaRay::Math
 
         // Tree hierarchy is stored as an array
         Util::SmallVector<Node, Support::ArenaAllocator> m_nodes;
+        // Used for traversal, binary nodes are kept for updates
+        Util::SmallVector<WideNode, Support::ArenaAllocator> m_wideNodes;
 
         // Array of inputs to build a BVH for. During BVH build, elements are moved around.
         Util::SmallVector<BVHInput, Support::ArenaAllocator> m_instances;
 
         uint32_t m_numNodes = 0;
+
+        // Kept up to date during refits
+        float m_internalNodeArea = 0.0f;
+        float m_builtSAHCost = 0.0f;
     };
 }
@@ -0,0 +1,156 @@
+#include "BatchFuncs.h"
+#include "BatchKernels.h"
+#include "MatrixFuncs.h"
+#include "CollisionFuncs.h"
+#include "../App/Common.h"
+
+using namespace ZetaRay;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+
+namespace
+{
+    struct VecAVX2
+    {
+        static constexpr int WIDTH = 8;
+        using Type = __m256;
+
+        static ZetaInline __m256 Set1(float f) { return _mm256_set1_ps(f); }
+        static ZetaInline __m256 Add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+        static ZetaInline __m256 Sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+        static ZetaInline __m256 Mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+        static ZetaInline __m256 Div(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+        // a * b + c
+        static ZetaInline __m256 Fmadd(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+        static ZetaInline __m256 Sqrt(__m256 a) { return _mm256_sqrt_ps(a); }
+        static ZetaInline __m256 Abs(__m256 a) { return Math::abs(a); }
+        static ZetaInline __m256 GreaterEqual(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+        static ZetaInline __m256 Select(__m256 mask, __m256 a, __m256 b) { return _mm256_blendv_ps(b, a, mask); }
+
+        // Offsets of WIDTH consecutive elements with the given stride (in floats)
+        static ZetaInline __m256i Indices(int stride)
+        {
+            return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                _mm256_set1_epi32(stride));
+        }
+        static ZetaInline __m256 Gather(const float* base, __m256i vIdx)
+        {
+            return _mm256_i32gather_ps(base, vIdx, 4);
+        }
+        // No scatter instruction in AVX2
+        static ZetaInline void Scatter(float* base, __m256i vIdx, __m256 v)
+        {
+            alignas(32) float vals[8];
+            alignas(32) int32_t idx[8];
+            _mm256_store_ps(vals, v);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(idx), vIdx);
+
+            for (int i = 0; i < 8; i++)
+                base[idx[i]] = vals[i];
+        }
+    };
+
+    const BatchKernels::Table& Kernels()
+    {
+        static const BatchKernels::Table table =
+            (Common::CheckIntrinsicSupport() & Common::CPU_Intrinsic::AVX512) ?
+            BatchKernels::GetAVX512() : BatchKernels::GetAVX2();
+
+        return table;
+    }
+}
+
+BatchKernels::Table BatchKernels::GetAVX2()
+{
+    return Table{ .TransformPoints = BatchKernels::TransformPoints<VecAVX2>,
+        .TransformAABBs = BatchKernels::TransformAABBs<VecAVX2>,
+        .MulAffine = BatchKernels::MulAffine<VecAVX2>,
+        .DecomposeSRT = BatchKernels::DecomposeSRT<VecAVX2>,
+        .Width = VecAVX2::WIDTH };
+}
+
+void Math::TransformPoints(const float4x3& M, Span<float3> points, MutableSpan<float3> out)
+{
+    Assert(out.size() >= points.size(), "Output is too small.");
+    static_assert(sizeof(float3) == 3 * sizeof(float), "Unexpected layout.");
+    static_assert(sizeof(float4x3) == 12 * sizeof(float), "Unexpected layout.");
+
+    size_t i = Kernels().TransformPoints(reinterpret_cast<const float*>(&M),
+        reinterpret_cast<const float*>(points.data()), reinterpret_cast<float*>(out.data()),
+        points.size());
+
+    if (i == points.size())
+        return;
+
+    const v_float4x4 vM = load4x3(M);
+
+    for (; i < points.size(); i++)
+    {
+        const __m128 vP = _mm_setr_ps(points[i].x, points[i].y, points[i].z, 1.0f);
+        out[i] = storeFloat3(mul(vM, vP));
+    }
+}
+
+void Math::TransformAABBs(const float4x3& M, Span<AABB> boxes, MutableSpan<AABB> out)
+{
+    Assert(out.size() >= boxes.size(), "Output is too small.");
+    static_assert(sizeof(AABB) == 6 * sizeof(float), "Unexpected layout.");
+
+    size_t i = Kernels().TransformAABBs(reinterpret_cast<const float*>(&M),
+        reinterpret_cast<const float*>(boxes.data()), reinterpret_cast<float*>(out.data()),
+        boxes.size());
+
+    if (i == boxes.size())
+        return;
+
+    const v_float4x4 vM = load4x3(M);
+
+    for (; i < boxes.size(); i++)
+    {
+        const v_AABB vBox(boxes[i]);
+        out[i] = store(transform(vM, vBox));
+    }
+}
+
+void Math::MulAffine(Span<float4x3> A, Span<float4x3> B, MutableSpan<float4x3> out)
+{
+    Assert(A.size() == B.size(), "Sizes must match.");
+    Assert(out.size() >= A.size(), "Output is too small.");
+
+    size_t i = Kernels().MulAffine(reinterpret_cast<const float*>(A.data()),
+        reinterpret_cast<const float*>(B.data()), reinterpret_cast<float*>(out.data()),
+        A.size());
+
+    for (; i < A.size(); i++)
+        out[i] = float4x3(store(mul(load4x3(A[i]), load4x3(B[i]))));
+}
+
+void Math::DecomposeSRT(Span<float4x3> M, MutableSpan<float3> s, MutableSpan<float4> r,
+    MutableSpan<float3> t)
+{
+    Assert(s.size() >= M.size() && r.size() >= M.size() && t.size() >= M.size(),
+        "Output is too small.");
+    static_assert(sizeof(float4) == 4 * sizeof(float), "Unexpected layout.");
+
+    size_t i = Kernels().DecomposeSRT(reinterpret_cast<const float*>(M.data()),
+        reinterpret_cast<float*>(s.data()), reinterpret_cast<float*>(r.data()),
+        reinterpret_cast<float*>(t.data()), M.size());
+
+    for (; i < M.size(); i++)
+    {
+        float4a vs;
+        float4a vr;
+        float4a vt;
+        decomposeSRT(load4x3(M[i]), vs, vr, vt);
+
+        s[i] = vs.xyz();
+        r[i] = float4(vr.x, vr.y, vr.z, vr.w);
+        t[i] = vt.xyz();
+    }
+}
+
+int Math::BatchWidth()
+{
+    return Kernels().Width;
+}
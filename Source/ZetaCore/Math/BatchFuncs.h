@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Matrix.h"
+#include "CollisionTypes.h"
+#include "../Utility/Span.h"
+
+// Kernels that apply the same operation to arrays of points, bounding boxes or
+// transformations. Inputs are transposed into SoA so that every instruction processes
+// 8 (AVX2) or 16 (AVX-512) elements. AVX2 and FMA are required (see App::Init()), the
+// AVX-512 variants are selected at runtime when both the CPU and OS support them.
+// Outputs can be the same arrays as the inputs, otherwise they must not overlap.
+namespace ZetaRay::Math
+{
+    // out[i] = points[i] * M, with w = 1
+    void TransformPoints(const float4x3& M, Util::Span<float3> points, Util::MutableSpan<float3> out);
+    // Bounding box of each transformed AABB, same as transform(v_float4x4, v_AABB)
+    void TransformAABBs(const float4x3& M, Util::Span<AABB> boxes, Util::MutableSpan<AABB> out);
+    // out[i] = A[i] * B[i], e.g. local transformations times world transformations of parents
+    void MulAffine(Util::Span<float4x3> A, Util::Span<float4x3> B, Util::MutableSpan<float4x3> out);
+    // Decomposes M[i] = S * R * T into scale factors, rotation quaternion and translation.
+    // Same as decomposeSRT() -- doesn't support negative scaling.
+    void DecomposeSRT(Util::Span<float4x3> M, Util::MutableSpan<float3> s, Util::MutableSpan<float4> r,
+        Util::MutableSpan<float3> t);
+
+    // Width of the selected kernels, either 8 or 16
+    int BatchWidth();
+}
@@ -0,0 +1,52 @@
+// Compiled with AVX-512 enabled (see CMakeLists.txt), only called after a runtime check.
+// See notes in BatchKernels.h about what can be included here.
+
+#include "../App/ZetaRay.h"
+#include "BatchKernels.h"
+
+using namespace ZetaRay::Math;
+
+namespace
+{
+    struct VecAVX512
+    {
+        static constexpr int WIDTH = 16;
+        using Type = __m512;
+
+        static ZetaInline __m512 Set1(float f) { return _mm512_set1_ps(f); }
+        static ZetaInline __m512 Add(__m512 a, __m512 b) { return _mm512_add_ps(a, b); }
+        static ZetaInline __m512 Sub(__m512 a, __m512 b) { return _mm512_sub_ps(a, b); }
+        static ZetaInline __m512 Mul(__m512 a, __m512 b) { return _mm512_mul_ps(a, b); }
+        static ZetaInline __m512 Div(__m512 a, __m512 b) { return _mm512_div_ps(a, b); }
+        // a * b + c
+        static ZetaInline __m512 Fmadd(__m512 a, __m512 b, __m512 c) { return _mm512_fmadd_ps(a, b, c); }
+        static ZetaInline __m512 Sqrt(__m512 a) { return _mm512_sqrt_ps(a); }
+        static ZetaInline __m512 Abs(__m512 a) { return _mm512_abs_ps(a); }
+        static ZetaInline __mmask16 GreaterEqual(__m512 a, __m512 b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+        static ZetaInline __m512 Select(__mmask16 mask, __m512 a, __m512 b) { return _mm512_mask_blend_ps(mask, b, a); }
+
+        // Offsets of WIDTH consecutive elements with the given stride (in floats)
+        static ZetaInline __m512i Indices(int stride)
+        {
+            return _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                _mm512_set1_epi32(stride));
+        }
+        static ZetaInline __m512 Gather(const float* base, __m512i vIdx)
+        {
+            return _mm512_i32gather_ps(vIdx, base, 4);
+        }
+        static ZetaInline void Scatter(float* base, __m512i vIdx, __m512 v)
+        {
+            _mm512_i32scatter_ps(base, vIdx, v, 4);
+        }
+    };
+}
+
+BatchKernels::Table BatchKernels::GetAVX512()
+{
+    return Table{ .TransformPoints = BatchKernels::TransformPoints<VecAVX512>,
+        .TransformAABBs = BatchKernels::TransformAABBs<VecAVX512>,
+        .MulAffine = BatchKernels::MulAffine<VecAVX512>,
+        .DecomposeSRT = BatchKernels::DecomposeSRT<VecAVX512>,
+        .Width = VecAVX512::WIDTH };
+}
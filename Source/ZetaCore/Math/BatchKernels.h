@@ -0,0 +1,225 @@
+#pragma once
+
+// Internal to BatchFuncs.cpp and BatchFuncsAVX512.cpp. The kernels are written once in
+// terms of a vector type (see VecAVX2 and VecAVX512) and instantiated in both files.
+// Since BatchFuncsAVX512.cpp is compiled with AVX-512 enabled, only raw pointers and
+// intrinsics are used here -- including e.g. VectorFuncs.h would let the linker pick the
+// AVX-512 copy of an inline function for the rest of the program.
+
+#include <immintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ZetaRay::Math::BatchKernels
+{
+    // Every kernel processes the largest multiple of the vector width that's <= n
+    // elements and returns that count, caller handles the remainder
+    struct Table
+    {
+        size_t (*TransformPoints)(const float* M, const float* points, float* out, size_t n);
+        size_t (*TransformAABBs)(const float* M, const float* boxes, float* out, size_t n);
+        size_t (*MulAffine)(const float* A, const float* B, float* out, size_t n);
+        size_t (*DecomposeSRT)(const float* M, float* s, float* r, float* t, size_t n);
+        int Width;
+    };
+
+    Table GetAVX2();
+    Table GetAVX512();
+
+    // Layouts are float3 (3 floats), AABB (center followed by extents, 6 floats) and
+    // float4x3 (4 rows of float3, 12 floats)
+
+    template<typename V>
+    size_t TransformPoints(const float* M, const float* points, float* out, size_t n)
+    {
+        using T = typename V::Type;
+
+        T vM[12];
+        for (int k = 0; k < 12; k++)
+            vM[k] = V::Set1(M[k]);
+
+        const auto vIdx = V::Indices(3);
+        size_t i = 0;
+
+        for (; i + V::WIDTH <= n; i += V::WIDTH)
+        {
+            const float* p = points + i * 3;
+            const T vX = V::Gather(p, vIdx);
+            const T vY = V::Gather(p + 1, vIdx);
+            const T vZ = V::Gather(p + 2, vIdx);
+
+            for (int c = 0; c < 3; c++)
+            {
+                T vRes = V::Fmadd(vX, vM[c], vM[9 + c]);
+                vRes = V::Fmadd(vY, vM[3 + c], vRes);
+                vRes = V::Fmadd(vZ, vM[6 + c], vRes);
+                V::Scatter(out + i * 3 + c, vIdx, vRes);
+            }
+        }
+
+        return i;
+    }
+
+    // Ref: J. Arvo, "Transforming axis-aligned bounding boxes," Graphics Gems, 1990.
+    template<typename V>
+    size_t TransformAABBs(const float* M, const float* boxes, float* out, size_t n)
+    {
+        using T = typename V::Type;
+
+        T vM[12];
+        T vAbsM[9];
+        for (int k = 0; k < 12; k++)
+            vM[k] = V::Set1(M[k]);
+        for (int k = 0; k < 9; k++)
+            vAbsM[k] = V::Abs(vM[k]);
+
+        const auto vIdx = V::Indices(6);
+        size_t i = 0;
+
+        for (; i + V::WIDTH <= n; i += V::WIDTH)
+        {
+            const float* b = boxes + i * 6;
+            const T vCx = V::Gather(b, vIdx);
+            const T vCy = V::Gather(b + 1, vIdx);
+            const T vCz = V::Gather(b + 2, vIdx);
+            const T vEx = V::Gather(b + 3, vIdx);
+            const T vEy = V::Gather(b + 4, vIdx);
+            const T vEz = V::Gather(b + 5, vIdx);
+
+            for (int c = 0; c < 3; c++)
+            {
+                T vCenter = V::Fmadd(vCx, vM[c], vM[9 + c]);
+                vCenter = V::Fmadd(vCy, vM[3 + c], vCenter);
+                vCenter = V::Fmadd(vCz, vM[6 + c], vCenter);
+                V::Scatter(out + i * 6 + c, vIdx, vCenter);
+
+                // Translation doesn't apply to extents
+                T vExtents = V::Mul(vEx, vAbsM[c]);
+                vExtents = V::Fmadd(vEy, vAbsM[3 + c], vExtents);
+                vExtents = V::Fmadd(vEz, vAbsM[6 + c], vExtents);
+                V::Scatter(out + i * 6 + 3 + c, vIdx, vExtents);
+            }
+        }
+
+        return i;
+    }
+
+    template<typename V>
+    size_t MulAffine(const float* A, const float* B, float* out, size_t n)
+    {
+        using T = typename V::Type;
+
+        const auto vIdx = V::Indices(12);
+        size_t i = 0;
+
+        for (; i + V::WIDTH <= n; i += V::WIDTH)
+        {
+            T vA[12];
+            T vB[12];
+
+            for (int k = 0; k < 12; k++)
+            {
+                vA[k] = V::Gather(A + i * 12 + k, vIdx);
+                vB[k] = V::Gather(B + i * 12 + k, vIdx);
+            }
+
+            // Last column of both is (0, 0, 0, 1)
+            for (int r = 0; r < 4; r++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    T vRes = r == 3 ? V::Fmadd(vA[9], vB[c], vB[9 + c]) : V::Mul(vA[3 * r], vB[c]);
+                    vRes = V::Fmadd(vA[3 * r + 1], vB[3 + c], vRes);
+                    vRes = V::Fmadd(vA[3 * r + 2], vB[6 + c], vRes);
+                    V::Scatter(out + i * 12 + 3 * r + c, vIdx, vRes);
+                }
+            }
+        }
+
+        return i;
+    }
+
+    // Scalar version is in decomposeSRT() and quaternionFromRotationMat1()
+    template<typename V>
+    size_t DecomposeSRT(const float* M, float* s, float* r, float* t, size_t n)
+    {
+        using T = typename V::Type;
+
+        const auto vIdx = V::Indices(12);
+        const auto vIdx3 = V::Indices(3);
+        const auto vIdx4 = V::Indices(4);
+        const T vOne = V::Set1(1.0f);
+        size_t i = 0;
+
+        for (; i + V::WIDTH <= n; i += V::WIDTH)
+        {
+            T vM[12];
+            for (int k = 0; k < 12; k++)
+                vM[k] = V::Gather(M + i * 12 + k, vIdx);
+
+            // For "row" matrices, scale factors are the lengths of the rows and dividing
+            // each row by its length gives R
+            for (int row = 0; row < 3; row++)
+            {
+                T vLenSq = V::Mul(vM[3 * row], vM[3 * row]);
+                vLenSq = V::Fmadd(vM[3 * row + 1], vM[3 * row + 1], vLenSq);
+                vLenSq = V::Fmadd(vM[3 * row + 2], vM[3 * row + 2], vLenSq);
+
+                const T vLen = V::Sqrt(vLenSq);
+                V::Scatter(s + i * 3 + row, vIdx3, vLen);
+
+                const T vInvLen = V::Div(vOne, vLen);
+                vM[3 * row] = V::Mul(vM[3 * row], vInvLen);
+                vM[3 * row + 1] = V::Mul(vM[3 * row + 1], vInvLen);
+                vM[3 * row + 2] = V::Mul(vM[3 * row + 2], vInvLen);
+            }
+
+            for (int c = 0; c < 3; c++)
+                V::Scatter(t + i * 3 + c, vIdx3, vM[9 + c]);
+
+            // Ref: "Converting a Rotation Matrix to a Quaternion", Mike Day, Insomniac Games.
+            const T m00 = vM[0], m01 = vM[1], m02 = vM[2];
+            const T m10 = vM[3], m11 = vM[4], m12 = vM[5];
+            const T m20 = vM[6], m21 = vM[7], m22 = vM[8];
+
+            const T v01p10 = V::Add(m01, m10);
+            const T v20p02 = V::Add(m20, m02);
+            const T v12p21 = V::Add(m12, m21);
+            const T v12m21 = V::Sub(m12, m21);
+            const T v20m02 = V::Sub(m20, m02);
+            const T v01m10 = V::Sub(m01, m10);
+
+            const T t0 = V::Sub(V::Sub(V::Add(vOne, m00), m11), m22);
+            const T t1 = V::Sub(V::Add(V::Sub(vOne, m00), m11), m22);
+            const T t2 = V::Add(V::Sub(V::Sub(vOne, m00), m11), m22);
+            const T t3 = V::Add(V::Add(V::Add(vOne, m00), m11), m22);
+
+            const T q0[4] = { t0, v01p10, v20p02, v12m21 };
+            const T q1[4] = { v01p10, t1, v12p21, v20m02 };
+            const T q2[4] = { v20p02, v12p21, t2, v01m10 };
+            const T q3[4] = { v12m21, v20m02, v01m10, t3 };
+
+            // i = m22 >= 0 ? (m00 >= -m11 ? 3 : 2) : (m11 >= m00 ? 1 : 0)
+            const auto vPos = V::GreaterEqual(m22, V::Set1(0.0f));
+            const auto vA = V::GreaterEqual(m00, V::Sub(V::Set1(0.0f), m11));
+            const auto vB = V::GreaterEqual(m11, m00);
+
+            // Scaling by 0.5 / sqrt(t_i) is positive, so it's subsumed by the normalization
+            T vQ[4];
+            T vLenSq = V::Set1(0.0f);
+
+            for (int c = 0; c < 4; c++)
+            {
+                vQ[c] = V::Select(vPos, V::Select(vA, q3[c], q2[c]), V::Select(vB, q1[c], q0[c]));
+                vLenSq = V::Fmadd(vQ[c], vQ[c], vLenSq);
+            }
+
+            const T vInvLen = V::Div(vOne, V::Sqrt(vLenSq));
+
+            for (int c = 0; c < 4; c++)
+                V::Scatter(r + i * 4 + c, vIdx4, V::Mul(vQ[c], vInvLen));
+        }
+
+        return i;
+    }
+}
@@ -3,6 +3,7 @@
 #include "CollisionTypes.h"
 #include "VectorFuncs.h"
 #include "MatrixFuncs.h"
+#include "../Utility/Span.h"
 
 namespace ZetaRay::Math
 {
@@ -447,4 +448,151 @@ namespace ZetaRay::Math
 
         return aabb;
     }
+
+    //--------------------------------------------------------------------------------------
+    // Batch functions
+    //
+    // Same tests and transformations as above, but for many AABBs at a time. Boxes are
+    // gathered into SoA form so that each instruction processes 8 of them. Outputs are
+    // written per element, so disjoint ranges can be processed independently from e.g.
+    // App::ParallelFor().
+    //--------------------------------------------------------------------------------------
+
+    // Tests (up to) 8 AABBs against the view frustum. Boxes are stride bytes apart, which
+    // allows testing AABBs that are members of larger structs. Bit i of the returned mask
+    // is set when box i is contained in or intersects the frustum. Same results as
+    // instersectFrustumVsAABB() -- plane normals must be normalized.
+    ZetaInline uint32_t __vectorcall intersectFrustumVsAABB8(const v_ViewFrustum& vFrustum, const AABB* boxes,
+        int n = 8, int stride = sizeof(AABB))
+    {
+        Assert(n > 0 && n <= 8, "Invalid number of boxes.");
+        Assert(stride % sizeof(float) == 0, "Stride must be a multiple of 4.");
+
+        const int strideInFloats = stride / sizeof(float);
+        const __m256i vIdx = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+            _mm256_set1_epi32(strideInFloats));
+
+        // Only load the first n boxes
+        const __m256 vValid = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(n),
+            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+        const float* base = reinterpret_cast<const float*>(boxes);
+        const __m256 vZero = _mm256_setzero_ps();
+
+        const __m256 vCx = _mm256_mask_i32gather_ps(vZero, base, vIdx, vValid, 4);
+        const __m256 vCy = _mm256_mask_i32gather_ps(vZero, base + 1, vIdx, vValid, 4);
+        const __m256 vCz = _mm256_mask_i32gather_ps(vZero, base + 2, vIdx, vValid, 4);
+        const __m256 vEx = _mm256_mask_i32gather_ps(vZero, base + 3, vIdx, vValid, 4);
+        const __m256 vEy = _mm256_mask_i32gather_ps(vZero, base + 4, vIdx, vValid, 4);
+        const __m256 vEz = _mm256_mask_i32gather_ps(vZero, base + 5, vIdx, vValid, 4);
+
+        const __m256 vN_x_abs = abs(vFrustum.vN_x);
+        const __m256 vN_y_abs = abs(vFrustum.vN_y);
+        const __m256 vN_z_abs = abs(vFrustum.vN_z);
+        __m256 vInside = vValid;
+
+        for (int p = 0; p < 6; p++)
+        {
+            const __m256i vP = _mm256_set1_epi32(p);
+
+            // Distance of the AABB center from the plane
+            __m256 vDist = _mm256_fmadd_ps(vCx, _mm256_permutevar8x32_ps(vFrustum.vN_x, vP),
+                _mm256_permutevar8x32_ps(vFrustum.vd, vP));
+            vDist = _mm256_fmadd_ps(vCy, _mm256_permutevar8x32_ps(vFrustum.vN_y, vP), vDist);
+            vDist = _mm256_fmadd_ps(vCz, _mm256_permutevar8x32_ps(vFrustum.vN_z, vP), vDist);
+
+            // Projection of farthest corner on the plane normal
+            __m256 vProj = _mm256_mul_ps(vEx, _mm256_permutevar8x32_ps(vN_x_abs, vP));
+            vProj = _mm256_fmadd_ps(vEy, _mm256_permutevar8x32_ps(vN_y_abs, vP), vProj);
+            vProj = _mm256_fmadd_ps(vEz, _mm256_permutevar8x32_ps(vN_z_abs, vP), vProj);
+
+            // Either in the positive half space or intersects the plane
+            vInside = _mm256_and_ps(vInside, _mm256_cmp_ps(_mm256_add_ps(vDist, vProj), vZero, _CMP_GE_OQ));
+        }
+
+        return (uint32_t)_mm256_movemask_ps(vInside);
+    }
+
+    // Tests every box against the view frustum. Bit i of visibility (in 64-bit words) is set
+    // when boxes[i] is contained in or intersects the frustum. When splitting the work, give
+    // each range of boxes a start index that's a multiple of 64 so that ranges don't share words.
+    ZetaInline void __vectorcall intersectFrustumVsAABBs(const v_ViewFrustum& vFrustum, Util::Span<AABB> boxes,
+        Util::MutableSpan<uint64_t> visibility)
+    {
+        Assert(visibility.size() * 64 >= boxes.size(), "Visibility mask is too small.");
+        const size_t n = boxes.size();
+
+        for (size_t w = 0; w < (n + 63) / 64; w++)
+        {
+            uint64_t mask = 0;
+            const size_t end = Math::Min(w * 64 + 64, n);
+
+            for (size_t i = w * 64; i < end; i += 8)
+            {
+                const int count = (int)Math::Min(end - i, size_t(8));
+                mask |= uint64_t(intersectFrustumVsAABB8(vFrustum, &boxes[i], count)) << (i & 63);
+            }
+
+            visibility[w] = mask;
+        }
+    }
+
+    // Transforms 8 AABBs, each with its own transformation, e.g. local-space bounding boxes
+    // of instances into world space. Same results as transform(v_float4x4, v_AABB).
+    ZetaInline void __vectorcall transformAABB8(const float4x3* M, const AABB* boxes, AABB* out)
+    {
+        static_assert(sizeof(AABB) == 6 * sizeof(float), "Unexpected layout.");
+        static_assert(sizeof(float4x3) == 12 * sizeof(float), "Unexpected layout.");
+
+        const __m256i vIdxM = _mm256_setr_epi32(0, 12, 24, 36, 48, 60, 72, 84);
+        const __m256i vIdxBox = _mm256_setr_epi32(0, 6, 12, 18, 24, 30, 36, 42);
+        const float* baseM = reinterpret_cast<const float*>(M);
+        const float* baseBox = reinterpret_cast<const float*>(boxes);
+
+        __m256 vM[12];
+        for (int k = 0; k < 12; k++)
+            vM[k] = _mm256_i32gather_ps(baseM + k, vIdxM, 4);
+
+        __m256 vBox[6];
+        for (int k = 0; k < 6; k++)
+            vBox[k] = _mm256_i32gather_ps(baseBox + k, vIdxBox, 4);
+
+        // Transpose back to AoS while storing -- there's no scatter in AVX2
+        alignas(32) float res[6][8];
+
+        for (int c = 0; c < 3; c++)
+        {
+            __m256 vCenter = _mm256_fmadd_ps(vBox[0], vM[c], vM[9 + c]);
+            vCenter = _mm256_fmadd_ps(vBox[1], vM[3 + c], vCenter);
+            vCenter = _mm256_fmadd_ps(vBox[2], vM[6 + c], vCenter);
+            _mm256_store_ps(res[c], vCenter);
+
+            // Translation doesn't apply to extents
+            __m256 vExtents = _mm256_mul_ps(vBox[3], abs(vM[c]));
+            vExtents = _mm256_fmadd_ps(vBox[4], abs(vM[3 + c]), vExtents);
+            vExtents = _mm256_fmadd_ps(vBox[5], abs(vM[6 + c]), vExtents);
+            _mm256_store_ps(res[3 + c], vExtents);
+        }
+
+        for (int i = 0; i < 8; i++)
+        {
+            out[i].Center = float3(res[0][i], res[1][i], res[2][i]);
+            out[i].Extents = float3(res[3][i], res[4][i], res[5][i]);
+        }
+    }
+
+    // out[i] = bounding box of boxes[i] transformed by M[i]. out can be the same as boxes.
+    // For many boxes with the same transformation, see TransformAABBs() in BatchFuncs.h.
+    ZetaInline void __vectorcall transformAABBs(Util::Span<float4x3> M, Util::Span<AABB> boxes,
+        Util::MutableSpan<AABB> out)
+    {
+        Assert(M.size() == boxes.size(), "Sizes must match.");
+        Assert(out.size() >= boxes.size(), "Output is too small.");
+        size_t i = 0;
+
+        for (; i + 8 <= boxes.size(); i += 8)
+            transformAABB8(&M[i], &boxes[i], &out[i]);
+
+        for (; i < boxes.size(); i++)
+            out[i] = store(transform(load4x3(M[i]), v_AABB(boxes[i])));
+    }
 }
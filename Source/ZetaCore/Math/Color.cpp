@@ -6,6 +6,173 @@ using namespace ZetaRay;
 using namespace ZetaRay::Math;
 using namespace ZetaRay::Util;
 
+namespace
+{
+    // Lanes [0, n) are set
+    ZetaInline __m256i LaneMask(size_t n)
+    {
+        return _mm256_cmpgt_epi32(_mm256_set1_epi32((int)n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    }
+
+    // Offsets of 8 consecutive elements with the given stride (in floats)
+    ZetaInline __m256i Indices(int stride)
+    {
+        return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+    }
+
+    // No scatter in AVX2
+    ZetaInline void __vectorcall StoreStrided(float* dst, int stride, size_t n, __m256 v)
+    {
+        alignas(32) float vals[8];
+        _mm256_store_ps(vals, v);
+
+        for (size_t i = 0; i < n; i++)
+            dst[i * stride] = vals[i];
+    }
+
+    ZetaInline __m128i LoadHalf8(const uint16_t* src, size_t n)
+    {
+        if (n == 8)
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+
+        alignas(16) uint16_t vals[8] = { 0 };
+        memcpy(vals, src, n * sizeof(uint16_t));
+
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(vals));
+    }
+
+    ZetaInline void __vectorcall StoreHalf8(uint16_t* dst, size_t n, __m256 v)
+    {
+        // Round to nearest even, same as FloatToHalf()
+        const __m128i vH = _mm256_cvtps_ph(v, 0);
+
+        if (n == 8)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), vH);
+            return;
+        }
+
+        alignas(16) uint16_t vals[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(vals), vH);
+        memcpy(dst, vals, n * sizeof(uint16_t));
+    }
+
+    // Natural logarithm for x > 0
+    // Ref: Cephes Math Library, logf()
+    ZetaInline __m256 __vectorcall Log(__m256 x)
+    {
+        const __m256 vOne = _mm256_set1_ps(1.0f);
+        const __m256i vX = _mm256_castps_si256(x);
+
+        // x = m * 2^e, where 0.5 <= m < 1
+        __m256 vE = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(vX, 23), _mm256_set1_epi32(126)));
+        __m256 vM = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(vX, _mm256_set1_epi32(0x7fffff)),
+            _mm256_set1_epi32(0x3f000000)));
+
+        // Move m to [sqrt(0.5), sqrt(2)) and subtract 1
+        const __m256 vLess = _mm256_cmp_ps(vM, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+        vE = _mm256_sub_ps(vE, _mm256_and_ps(vLess, vOne));
+        vM = _mm256_sub_ps(_mm256_add_ps(vM, _mm256_and_ps(vLess, vM)), vOne);
+
+        const __m256 vZ = _mm256_mul_ps(vM, vM);
+        __m256 vY = _mm256_set1_ps(7.0376836292e-2f);
+        vY = _mm256_fmadd_ps(vY, vM, _mm256_set1_ps(-1.1514610310e-1f));
+        vY = _mm256_fmadd_ps(vY, vM, _mm256_set1_ps(1.1676998740e-1f));
+        vY = _mm256_fmadd_ps(vY, vM, _mm256_set1_ps(-1.2420140846e-1f));
+        vY = _mm256_fmadd_ps(vY, vM, _mm256_set1_ps(1.4249322787e-1f));
+        vY = _mm256_fmadd_ps(vY, vM, _mm256_set1_ps(-1.6668057665e-1f));
+        vY = _mm256_fmadd_ps(vY, vM, _mm256_set1_ps(2.0000714765e-1f));
+        vY = _mm256_fmadd_ps(vY, vM, _mm256_set1_ps(-2.4999993993e-1f));
+        vY = _mm256_fmadd_ps(vY, vM, _mm256_set1_ps(3.3333331174e-1f));
+        vY = _mm256_mul_ps(vY, _mm256_mul_ps(vM, vZ));
+
+        // ln(2) is split into two constants for more precision
+        vY = _mm256_fmadd_ps(vE, _mm256_set1_ps(-2.12194440e-4f), vY);
+        vY = _mm256_fnmadd_ps(vZ, _mm256_set1_ps(0.5f), vY);
+
+        return _mm256_fmadd_ps(vE, _mm256_set1_ps(0.693359375f), _mm256_add_ps(vM, vY));
+    }
+
+    // Ref: Cephes Math Library, expf()
+    ZetaInline __m256 __vectorcall Exp(__m256 x)
+    {
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.3f)), _mm256_set1_ps(88.3f));
+
+        // e^x = 2^n * e^r, where n = round(x / ln(2))
+        const __m256 vN = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)),
+            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 vR = _mm256_fnmadd_ps(vN, _mm256_set1_ps(0.693359375f), x);
+        vR = _mm256_fnmadd_ps(vN, _mm256_set1_ps(-2.12194440e-4f), vR);
+
+        const __m256 vZ = _mm256_mul_ps(vR, vR);
+        __m256 vY = _mm256_set1_ps(1.9875691500e-4f);
+        vY = _mm256_fmadd_ps(vY, vR, _mm256_set1_ps(1.3981999507e-3f));
+        vY = _mm256_fmadd_ps(vY, vR, _mm256_set1_ps(8.3334519073e-3f));
+        vY = _mm256_fmadd_ps(vY, vR, _mm256_set1_ps(4.1665795894e-2f));
+        vY = _mm256_fmadd_ps(vY, vR, _mm256_set1_ps(1.6666665459e-1f));
+        vY = _mm256_fmadd_ps(vY, vR, _mm256_set1_ps(5.0000001201e-1f));
+        vY = _mm256_fmadd_ps(vY, vZ, _mm256_add_ps(vR, _mm256_set1_ps(1.0f)));
+
+        // 2^n
+        const __m256i vPow2n = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(vN),
+            _mm256_set1_epi32(127)), 23);
+
+        return _mm256_mul_ps(vY, _mm256_castsi256_ps(vPow2n));
+    }
+
+    // x^p for x >= 0, x = 0 returns 0
+    ZetaInline __m256 __vectorcall Pow(__m256 x, float p)
+    {
+        const __m256 vRes = Exp(_mm256_mul_ps(Log(_mm256_max_ps(x, _mm256_set1_ps(FLT_MIN))), _mm256_set1_ps(p)));
+        return _mm256_and_ps(vRes, _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ));
+    }
+
+    ZetaInline __m256 __vectorcall sRGBToLinear8(__m256 vColor)
+    {
+        const __m256 vLo = _mm256_div_ps(vColor, _mm256_set1_ps(12.92f));
+        const __m256 vTmp = _mm256_div_ps(_mm256_add_ps(vColor, _mm256_set1_ps(0.055f)), _mm256_set1_ps(1.055f));
+        const __m256 vHi = Pow(vTmp, 2.4f);
+        const __m256 vIsLo = _mm256_cmp_ps(vColor, _mm256_set1_ps(0.0404499993f), _CMP_LE_OQ);
+
+        return _mm256_blendv_ps(vHi, vLo, vIsLo);
+    }
+
+    ZetaInline __m256 __vectorcall LinearTosRGB8(__m256 vColor)
+    {
+        const __m256 vLo = _mm256_mul_ps(vColor, _mm256_set1_ps(12.92f));
+        const __m256 vSaturated = _mm256_min_ps(_mm256_max_ps(vColor, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+        const __m256 vHi = _mm256_fmsub_ps(Pow(vSaturated, 1.0f / 2.4f), _mm256_set1_ps(1.055f),
+            _mm256_set1_ps(0.055f));
+        const __m256 vIsLo = _mm256_cmp_ps(vColor, _mm256_set1_ps(0.0031308f), _CMP_LE_OQ);
+
+        return _mm256_blendv_ps(vHi, vLo, vIsLo);
+    }
+
+    template<int Stride>
+    void LuminanceStrided(const float* in, size_t n, float* out)
+    {
+        const __m256i vIdx = Indices(Stride);
+        const __m256 vZero = _mm256_setzero_ps();
+
+        for (size_t i = 0; i < n; i += 8)
+        {
+            const size_t count = Min(n - i, size_t(8));
+            const __m256i vMask = LaneMask(count);
+            const float* p = in + i * Stride;
+
+            const __m256 vR = _mm256_mask_i32gather_ps(vZero, p, vIdx, _mm256_castsi256_ps(vMask), 4);
+            const __m256 vG = _mm256_mask_i32gather_ps(vZero, p + 1, vIdx, _mm256_castsi256_ps(vMask), 4);
+            const __m256 vB = _mm256_mask_i32gather_ps(vZero, p + 2, vIdx, _mm256_castsi256_ps(vMask), 4);
+
+            __m256 vL = _mm256_mul_ps(vR, _mm256_set1_ps(0.2126f));
+            vL = _mm256_fmadd_ps(vG, _mm256_set1_ps(0.7152f), vL);
+            vL = _mm256_fmadd_ps(vB, _mm256_set1_ps(0.0722f), vL);
+
+            _mm256_maskstore_ps(out + i, vMask, vL);
+        }
+    }
+}
+
 float3 Math::sRGBToLinear(const float3& color)
 {
     float3 linearLo = color / 12.92f;
@@ -55,3 +222,177 @@ float3 Math::ColorTemperatureTosRGB(float temperature)
 
     return ret;
 }
+
+void Math::sRGBToLinear(Span<float> in, MutableSpan<float> out)
+{
+    Assert(out.size() >= in.size(), "Output is too small.");
+
+    for (size_t i = 0; i < in.size(); i += 8)
+    {
+        const __m256i vMask = LaneMask(Min(in.size() - i, size_t(8)));
+        const __m256 vColor = _mm256_maskload_ps(in.data() + i, vMask);
+        _mm256_maskstore_ps(out.data() + i, vMask, sRGBToLinear8(vColor));
+    }
+}
+
+void Math::LinearTosRGB(Span<float> in, MutableSpan<float> out)
+{
+    Assert(out.size() >= in.size(), "Output is too small.");
+
+    for (size_t i = 0; i < in.size(); i += 8)
+    {
+        const __m256i vMask = LaneMask(Min(in.size() - i, size_t(8)));
+        const __m256 vColor = _mm256_maskload_ps(in.data() + i, vMask);
+        _mm256_maskstore_ps(out.data() + i, vMask, LinearTosRGB8(vColor));
+    }
+}
+
+void Math::FloatToHalf(Span<float> in, MutableSpan<uint16_t> out)
+{
+    Assert(out.size() >= in.size(), "Output is too small.");
+
+    for (size_t i = 0; i < in.size(); i += 8)
+    {
+        const size_t count = Min(in.size() - i, size_t(8));
+        const __m256 vF = _mm256_maskload_ps(in.data() + i, LaneMask(count));
+        StoreHalf8(out.data() + i, count, vF);
+    }
+}
+
+void Math::HalfToFloat(Span<uint16_t> in, MutableSpan<float> out)
+{
+    Assert(out.size() >= in.size(), "Output is too small.");
+
+    for (size_t i = 0; i < in.size(); i += 8)
+    {
+        const size_t count = Min(in.size() - i, size_t(8));
+        const __m256 vF = _mm256_cvtph_ps(LoadHalf8(in.data() + i, count));
+        _mm256_maskstore_ps(out.data() + i, LaneMask(count), vF);
+    }
+}
+
+void Math::RGBAToPlanarHalf(Span<float4> in, MutableSpan<uint16_t> r, MutableSpan<uint16_t> g,
+    MutableSpan<uint16_t> b)
+{
+    Assert(r.size() >= in.size() && g.size() >= in.size() && b.size() >= in.size(), "Output is too small.");
+    const __m256i vIdx = Indices(4);
+    const __m256 vZero = _mm256_setzero_ps();
+
+    for (size_t i = 0; i < in.size(); i += 8)
+    {
+        const size_t count = Min(in.size() - i, size_t(8));
+        const __m256 vMask = _mm256_castsi256_ps(LaneMask(count));
+        const float* p = reinterpret_cast<const float*>(in.data() + i);
+
+        StoreHalf8(r.data() + i, count, _mm256_mask_i32gather_ps(vZero, p, vIdx, vMask, 4));
+        StoreHalf8(g.data() + i, count, _mm256_mask_i32gather_ps(vZero, p + 1, vIdx, vMask, 4));
+        StoreHalf8(b.data() + i, count, _mm256_mask_i32gather_ps(vZero, p + 2, vIdx, vMask, 4));
+    }
+}
+
+void Math::AccumulatePlanarHalf(Span<uint16_t> r, Span<uint16_t> g, Span<uint16_t> b, float weight,
+    MutableSpan<float4> out)
+{
+    Assert(r.size() == g.size() && r.size() == b.size(), "Sizes must match.");
+    Assert(out.size() >= r.size(), "Output is too small.");
+    const __m256i vIdx = Indices(4);
+    const __m256 vWeight = _mm256_set1_ps(weight);
+    const __m256 vZero = _mm256_setzero_ps();
+    const uint16_t* channels[3] = { r.data(), g.data(), b.data() };
+
+    for (size_t i = 0; i < r.size(); i += 8)
+    {
+        const size_t count = Min(r.size() - i, size_t(8));
+        const __m256 vMask = _mm256_castsi256_ps(LaneMask(count));
+        float* p = reinterpret_cast<float*>(out.data() + i);
+
+        for (int c = 0; c < 3; c++)
+        {
+            const __m256 vH = _mm256_cvtph_ps(LoadHalf8(channels[c] + i, count));
+            const __m256 vCurr = _mm256_mask_i32gather_ps(vZero, p + c, vIdx, vMask, 4);
+            StoreStrided(p + c, 4, count, _mm256_fmadd_ps(vH, vWeight, vCurr));
+        }
+    }
+}
+
+void Math::FloatToRGBE(Span<float3> in, MutableSpan<uint32_t> out)
+{
+    Assert(out.size() >= in.size(), "Output is too small.");
+    const __m256i vIdx = Indices(3);
+    const __m256 vZero = _mm256_setzero_ps();
+
+    for (size_t i = 0; i < in.size(); i += 8)
+    {
+        const __m256i vMask = LaneMask(Min(in.size() - i, size_t(8)));
+        const float* p = reinterpret_cast<const float*>(in.data() + i);
+
+        // Negative values aren't representable
+        const __m256 vR = _mm256_max_ps(_mm256_mask_i32gather_ps(vZero, p, vIdx, _mm256_castsi256_ps(vMask), 4), vZero);
+        const __m256 vG = _mm256_max_ps(_mm256_mask_i32gather_ps(vZero, p + 1, vIdx, _mm256_castsi256_ps(vMask), 4), vZero);
+        const __m256 vB = _mm256_max_ps(_mm256_mask_i32gather_ps(vZero, p + 2, vIdx, _mm256_castsi256_ps(vMask), 4), vZero);
+        const __m256 vMax = _mm256_max_ps(_mm256_max_ps(vR, vG), vB);
+
+        // With max = m * 2^e, 0.5 <= m < 1 (same as frexp()), biased IEEE exponent is 
+        // e + 126. Every channel is scaled by 256 / 2^e so that max maps to [128, 256).
+        __m256i vBiasedExp = _mm256_srli_epi32(_mm256_castps_si256(vMax), 23);
+        vBiasedExp = _mm256_min_epi32(vBiasedExp, _mm256_set1_epi32(253));
+        const __m256 vScale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_sub_epi32(_mm256_set1_epi32(261),
+            vBiasedExp), 23));
+
+        const __m256i vRi = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(vR, vScale)), _mm256_set1_epi32(255));
+        const __m256i vGi = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(vG, vScale)), _mm256_set1_epi32(255));
+        const __m256i vBi = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(vB, vScale)), _mm256_set1_epi32(255));
+        // Shared exponent is e + 128
+        const __m256i vE = _mm256_add_epi32(vBiasedExp, _mm256_set1_epi32(2));
+
+        __m256i vRGBE = _mm256_or_si256(vRi, _mm256_slli_epi32(vGi, 8));
+        vRGBE = _mm256_or_si256(vRGBE, _mm256_slli_epi32(vBi, 16));
+        vRGBE = _mm256_or_si256(vRGBE, _mm256_slli_epi32(vE, 24));
+
+        // Too small to represent
+        const __m256 vIsZero = _mm256_cmp_ps(vMax, _mm256_set1_ps(1e-32f), _CMP_LT_OQ);
+        vRGBE = _mm256_andnot_si256(_mm256_castps_si256(vIsZero), vRGBE);
+
+        _mm256_maskstore_epi32(reinterpret_cast<int*>(out.data() + i), vMask, vRGBE);
+    }
+}
+
+void Math::RGBEToFloat(Span<uint32_t> in, MutableSpan<float3> out)
+{
+    Assert(out.size() >= in.size(), "Output is too small.");
+    const __m256i vByteMask = _mm256_set1_epi32(0xff);
+
+    for (size_t i = 0; i < in.size(); i += 8)
+    {
+        const size_t count = Min(in.size() - i, size_t(8));
+        const __m256i vRGBE = _mm256_maskload_epi32(reinterpret_cast<const int*>(in.data() + i),
+            LaneMask(count));
+        const __m256i vE = _mm256_srli_epi32(vRGBE, 24);
+
+        // 2^(E - 136), or zero when E = 0
+        const __m256i vScaleExp = _mm256_max_epi32(_mm256_sub_epi32(vE, _mm256_set1_epi32(9)),
+            _mm256_setzero_si256());
+        const __m256 vScale = _mm256_castsi256_ps(_mm256_slli_epi32(vScaleExp, 23));
+        const __m256 vHalf = _mm256_set1_ps(0.5f);
+        float* p = reinterpret_cast<float*>(out.data() + i);
+
+        for (int c = 0; c < 3; c++)
+        {
+            const __m256i vC = _mm256_and_si256(_mm256_srli_epi32(vRGBE, 8 * c), vByteMask);
+            const __m256 vF = _mm256_mul_ps(_mm256_add_ps(_mm256_cvtepi32_ps(vC), vHalf), vScale);
+            StoreStrided(p + c, 3, count, vF);
+        }
+    }
+}
+
+void Math::Luminance(Span<float3> in, MutableSpan<float> out)
+{
+    Assert(out.size() >= in.size(), "Output is too small.");
+    LuminanceStrided<3>(reinterpret_cast<const float*>(in.data()), in.size(), out.data());
+}
+
+void Math::Luminance(Span<float4> in, MutableSpan<float> out)
+{
+    Assert(out.size() >= in.size(), "Output is too small.");
+    LuminanceStrided<4>(reinterpret_cast<const float*>(in.data()), in.size(), out.data());
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "VectorFuncs.h"
+#include "../Utility/Span.h"
 
 namespace ZetaRay::Math
 {
@@ -68,4 +69,32 @@ namespace ZetaRay::Math
 
     Math::float3 sRGBToLinear(const Math::float3& color);
     Math::float3 ColorTemperatureTosRGB(float temperature);
+
+    //--------------------------------------------------------------------------------------
+    // Batch conversions for whole images, 8 elements at a time. Output sizes must be at
+    // least the input size. Outputs can be the same as inputs when element types match.
+    //--------------------------------------------------------------------------------------
+
+    // Per channel, so for RGBA data alpha is converted too
+    void sRGBToLinear(Util::Span<float> in, Util::MutableSpan<float> out);
+    void LinearTosRGB(Util::Span<float> in, Util::MutableSpan<float> out);
+
+    void FloatToHalf(Util::Span<float> in, Util::MutableSpan<uint16_t> out);
+    void HalfToFloat(Util::Span<uint16_t> in, Util::MutableSpan<float> out);
+
+    // RGB channels of RGBA pixels to separate half-float planes, e.g. OpenEXR scanlines
+    void RGBAToPlanarHalf(Util::Span<Math::float4> in, Util::MutableSpan<uint16_t> r,
+        Util::MutableSpan<uint16_t> g, Util::MutableSpan<uint16_t> b);
+    // out[i].xyz += weight * (r[i], g[i], b[i]), alpha is unchanged
+    void AccumulatePlanarHalf(Util::Span<uint16_t> r, Util::Span<uint16_t> g, Util::Span<uint16_t> b,
+        float weight, Util::MutableSpan<Math::float4> out);
+
+    // Radiance RGBE, i.e. 8-bit mantissas with a shared exponent in the last byte
+    // Ref: G. Ward, "Real Pixels," Graphics Gems II, 1991.
+    void FloatToRGBE(Util::Span<Math::float3> in, Util::MutableSpan<uint32_t> out);
+    void RGBEToFloat(Util::Span<uint32_t> in, Util::MutableSpan<Math::float3> out);
+
+    // Relative luminance of linear Rec. 709 colors, same as Luminance() in Math.hlsli
+    void Luminance(Util::Span<Math::float3> in, Util::MutableSpan<float> out);
+    void Luminance(Util::Span<Math::float4> in, Util::MutableSpan<float> out);
 }
\ No newline at end of file
@@ -101,6 +101,23 @@ namespace ZetaRay::Math
         return (temp & 0x7fffffff) > 0x7f800000;
     }
 
+    // Inserts two zero bits between each of the lower 10 bits
+    ZetaInline constexpr uint32_t ExpandBits(uint32_t v)
+    {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+
+        return v;
+    }
+
+    // Interleaves the lower 10 bits of x, y and z (x takes the most significant bit)
+    ZetaInline constexpr uint32_t Morton3D(uint32_t x, uint32_t y, uint32_t z)
+    {
+        return (ExpandBits(x) << 2) | (ExpandBits(y) << 1) | ExpandBits(z);
+    }
+
     // Solves quadratic equation a * x^2 + b * x + c = 0
     bool SolveQuadratic(float a, float b, float c, float& x1, float& x2);
 
@@ -1,11 +1,61 @@
 #include "Sampling.h"
 #include <Utility/RNG.h>
+#include <Utility/SmallVector.h>
+#include <App/App.h>
 #include <cmath>
 
 using namespace ZetaRay;
 using namespace ZetaRay::Util;
 using namespace ZetaRay::Math;
 
+namespace
+{
+    // Large distributions are normalized and split into light and heavy items in 
+    // parallel over chunks of this many weights
+    constexpr size_t ALIAS_TABLE_WEIGHTS_PER_CHUNK = 64 * 1024;
+    constexpr size_t MAX_NUM_ALIAS_TABLE_CHUNKS = 256;
+
+    struct AliasTableChunk
+    {
+        double Sum;
+        // Total amount by which light items fall short of 1 and heavy items exceed 1
+        double Deficit;
+        double Surplus;
+        uint32_t NumLight;
+        uint32_t NumHeavy;
+    };
+
+    void Scale(float* data, int64_t N, float s)
+    {
+        // Align to 32 bytes
+        float* curr = data;
+        float* const dataEnd = data + N;
+        while ((reinterpret_cast<uintptr_t>(curr) & 31) != 0 && curr < dataEnd)
+        {
+            *curr *= s;
+            curr++;
+        }
+
+        // Largest multiple of 8 that is smaller than remaining
+        int64_t numSIMD = dataEnd - curr;
+        numSIMD -= numSIMD & 7;
+
+        const float* end = curr + numSIMD;
+        __m256 vS = _mm256_broadcast_ss(&s);
+
+        for (; curr < end; curr += 8)
+        {
+            __m256 V = _mm256_load_ps(curr);
+            V = _mm256_mul_ps(V, vS);
+
+            _mm256_store_ps(curr, V);
+        }
+
+        for (; curr < dataEnd; curr++)
+            *curr *= s;
+    }
+}
+
 //--------------------------------------------------------------------------------------
 // Sampling
 //--------------------------------------------------------------------------------------
@@ -19,34 +69,7 @@ void Math::AliasTable_Normalize(MutableSpan<float> weights)
 
     // Multiply each probability by N so that mean becomes 1 instead of 1 / N
     const float sumRcp = N / sum;
-
-    // Align to 32 bytes
-    float* curr = weights.data();
-    while ((reinterpret_cast<uintptr_t>(curr) & 31) != 0)
-    {
-        *curr *= sumRcp;
-        curr++;
-    }
-
-    const int64_t startOffset = curr - weights.data();
-
-    // Largest multiple of 8 that is smaller than N
-    int64_t numToSumSIMD = N - startOffset;
-    numToSumSIMD -= numToSumSIMD & 7;
-
-    const float* end = curr + numToSumSIMD;
-    __m256 vSumRcp = _mm256_broadcast_ss(&sumRcp);
-
-    for (; curr < end; curr += 8)
-    {
-        __m256 V = _mm256_load_ps(curr);
-        V = _mm256_mul_ps(V, vSumRcp);
-
-        _mm256_store_ps(curr, V);
-    }
-
-    for (int64_t i = startOffset + numToSumSIMD; i < N; i++)
-        weights[i] *= sumRcp;
+    Scale(weights.data(), N, sumRcp);
 }
 
 void Math::AliasTable_Build(MutableSpan<float> probs, MutableSpan<AliasTableEntry> table)
@@ -142,6 +165,212 @@ void Math::AliasTable_Build(MutableSpan<float> probs, MutableSpan<AliasTableEntr
     Assert(numInsertions == N, "Some elements were not inserted.");
 }
 
+void Math::AliasTable_BuildParallel(MutableSpan<float> probs, MutableSpan<AliasTableEntry> table)
+{
+    // Parallel version of the sweeping construction from [Hübschle-Schneider & Sanders, 
+    // "Parallel Weighted Random Sampling", 2019]. Light (< 1) and heavy (>= 1) items 
+    // are visited in their original order. The current heavy item fills light items 
+    // until its residual drops below 1, at which point it becomes light itself and is 
+    // filled by the next heavy item. With prefix sums of deficits (1 - w) of light 
+    // items, dL, and surpluses (w - 1) of heavy items, dH, the residual of heavy j 
+    // after filling the first i light items is
+    //
+    //      w_j - (dL[i] - dH[j])
+    //
+    // and light i is taken before heavy j iff dL[i] <= dH[j + 1]. So the sweep is a merge 
+    // of two sorted sequences, which is split into equal pieces with binary searches 
+    // that each piece then sweeps independently.
+    const int64_t N = probs.size();
+    if (N == 0)
+        return;
+
+    const size_t numChunks = Min(CeilUnsignedIntDiv((size_t)N, ALIAS_TABLE_WEIGHTS_PER_CHUNK),
+        MAX_NUM_ALIAS_TABLE_CHUNKS);
+    const size_t weightsPerChunk = CeilUnsignedIntDiv((size_t)N, numChunks);
+    AliasTableChunk chunks[MAX_NUM_ALIAS_TABLE_CHUNKS];
+
+    // Normalize
+    App::ParallelFor(numChunks, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t c = begin; c < end; c++)
+            {
+                const size_t beginIdx = c * weightsPerChunk;
+                const size_t endIdx = Min((c + 1) * weightsPerChunk, (size_t)N);
+                chunks[c].Sum = KahanSum(Span<float>(probs.data() + beginIdx, endIdx - beginIdx));
+            }
+        });
+
+    double sum = 0.0;
+    for (size_t c = 0; c < numChunks; c++)
+        sum += chunks[c].Sum;
+    Assert(!IsNaN((float)sum), "sum of weights was NaN.");
+
+    const float sumRcp = (float)(N / sum);
+    const float oneDivN = 1.0f / N;
+
+    // Scale, then count light and heavy items
+    App::ParallelFor(numChunks, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t c = begin; c < end; c++)
+            {
+                const size_t beginIdx = c * weightsPerChunk;
+                const size_t endIdx = Min((c + 1) * weightsPerChunk, (size_t)N);
+                Scale(probs.data() + beginIdx, endIdx - beginIdx, sumRcp);
+
+                AliasTableChunk& chunk = chunks[c];
+                chunk.Deficit = 0.0;
+                chunk.Surplus = 0.0;
+                chunk.NumLight = 0;
+
+                for (size_t i = beginIdx; i < endIdx; i++)
+                {
+                    const float p = probs[i];
+                    table[i].P_Orig = p * oneDivN;
+
+                    if (p < 1.0f)
+                    {
+                        chunk.Deficit += 1.0 - p;
+                        chunk.NumLight++;
+                    }
+                    else
+                        chunk.Surplus += p - 1.0;
+                }
+
+                chunk.NumHeavy = (uint32_t)(endIdx - beginIdx) - chunk.NumLight;
+            }
+        });
+
+    // Exclusive scan over chunks
+    size_t numLight = 0;
+    size_t numHeavy = 0;
+    double deficit = 0.0;
+    double surplus = 0.0;
+
+    for (size_t c = 0; c < numChunks; c++)
+    {
+        AliasTableChunk& chunk = chunks[c];
+        const uint32_t nl = chunk.NumLight;
+        const uint32_t nh = chunk.NumHeavy;
+        const double d = chunk.Deficit;
+        const double s = chunk.Surplus;
+
+        chunk.NumLight = (uint32_t)numLight;
+        chunk.NumHeavy = (uint32_t)numHeavy;
+        chunk.Deficit = deficit;
+        chunk.Surplus = surplus;
+
+        numLight += nl;
+        numHeavy += nh;
+        deficit += d;
+        surplus += s;
+    }
+
+    // Maintain an index buffer since original ordering of elements must be preserved
+    SmallVector<uint32_t> light;
+    light.resize(numLight);
+    SmallVector<uint32_t> heavy;
+    heavy.resize(numHeavy);
+
+    // Prefix sums of deficits and surpluses. Last element is the total.
+    SmallVector<double> deficitSum;
+    deficitSum.resize(numLight + 1);
+    SmallVector<double> surplusSum;
+    surplusSum.resize(numHeavy + 1);
+    deficitSum[numLight] = deficit;
+    surplusSum[numHeavy] = surplus;
+
+    App::ParallelFor(numChunks, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t c = begin; c < end; c++)
+            {
+                const size_t beginIdx = c * weightsPerChunk;
+                const size_t endIdx = Min((c + 1) * weightsPerChunk, (size_t)N);
+                const AliasTableChunk& chunk = chunks[c];
+
+                size_t l = chunk.NumLight;
+                size_t h = chunk.NumHeavy;
+                double d = chunk.Deficit;
+                double s = chunk.Surplus;
+
+                for (size_t i = beginIdx; i < endIdx; i++)
+                {
+                    const float p = probs[i];
+
+                    if (p < 1.0f)
+                    {
+                        light[l] = (uint32_t)i;
+                        deficitSum[l++] = d;
+                        d += 1.0 - p;
+                    }
+                    else
+                    {
+                        heavy[h] = (uint32_t)i;
+                        surplusSum[h++] = s;
+                        s += p - 1.0;
+                    }
+                }
+            }
+        });
+
+    // Every step of the sweep finalizes exactly one (light or heavy) item
+    const size_t numSteps = (size_t)N;
+    const size_t numPieces = numChunks;
+    const size_t stepsPerPiece = CeilUnsignedIntDiv(numSteps, numPieces);
+
+    App::ParallelFor(numPieces, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t k = begin; k < end; k++)
+            {
+                const size_t firstStep = Min(k * stepsPerPiece, numSteps);
+                const size_t lastStep = Min((k + 1) * stepsPerPiece, numSteps);
+
+                // Number of light items among the first firstStep steps of the merge
+                size_t lo = firstStep > numHeavy ? firstStep - numHeavy : 0;
+                size_t hi = Min(firstStep, numLight);
+
+                while (lo < hi)
+                {
+                    const size_t mid = (lo + hi) >> 1;
+                    if (deficitSum[mid] <= surplusSum[firstStep - mid])
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+
+                size_t i = lo;
+                size_t j = firstStep - lo;
+
+                for (size_t step = firstStep; step < lastStep; step++)
+                {
+                    if (i < numLight && (j == numHeavy || deficitSum[i] <= surplusSum[j + 1]))
+                    {
+                        const uint32_t idx = light[i];
+                        AliasTableEntry& e = table[idx];
+                        Assert(e.Alias == UINT32_MAX, "Every element must be inserted exactly one time.");
+
+                        // Only possible due to round-off errors
+                        const bool noneLeft = j == numHeavy;
+                        e.Alias = noneLeft ? idx : heavy[j];
+                        e.P_Curr = noneLeft ? 1.0f : probs[idx];
+                        i++;
+                    }
+                    else
+                    {
+                        const uint32_t idx = heavy[j];
+                        AliasTableEntry& e = table[idx];
+                        Assert(e.Alias == UINT32_MAX, "Every element must be inserted exactly one time.");
+
+                        const double residual = probs[idx] - (deficitSum[i] - surplusSum[j]);
+                        const bool isLast = j + 1 == numHeavy;
+                        e.Alias = isLast ? idx : heavy[j + 1];
+                        e.P_Curr = isLast ? 1.0f : Min(Max((float)residual, 0.0f), 1.0f);
+                        j++;
+                    }
+                }
+            }
+        });
+}
+
 uint32_t Math::SampleAliasTable(Span<AliasTableEntry> table, RNG& rng, float& pdf)
 {
     uint32_t idx = rng.UniformUintBounded((uint32_t)table.size());
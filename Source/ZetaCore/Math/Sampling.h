@@ -29,6 +29,10 @@ namespace ZetaRay::Math
     void AliasTable_Normalize(Util::MutableSpan<float> weights);
     // Generates an alias table for the given distribution.
     void AliasTable_Build(Util::MutableSpan<float> weights, Util::MutableSpan<AliasTableEntry> table);
+    // Same as above, but splits the work over the worker threads. Meant for large 
+    // distributions (e.g. millions of emissive triangles). Entries of table are expected 
+    // to be default initialized.
+    void AliasTable_BuildParallel(Util::MutableSpan<float> weights, Util::MutableSpan<AliasTableEntry> table);
     // Draws sample from the given alias table
     uint32_t SampleAliasTable(Util::Span<AliasTableEntry> table, Util::RNG& rng, float& pdf);
 }
@@ -1,10 +1,43 @@
 #include "Surface.h"
 #include "../App/Log.h"
 #include <Math/VectorFuncs.h>
+#include "../Utility/SmallVector.h"
+#include "../Support/MemoryArena.h"
+#include "../App/App.h"
+#include <algorithm>
 
 using namespace ZetaRay::Core;
 using namespace ZetaRay::Util;
 using namespace ZetaRay::Math;
+using namespace ZetaRay::Support;
+
+namespace
+{
+    // Tangents of larger meshes are accumulated in parallel over chunks of this many 
+    // triangles
+    constexpr size_t TANGENT_TRIS_PER_CHUNK = 64 * 1024;
+    constexpr int MAX_NUM_TANGENT_CHUNKS = 16;
+    constexpr size_t TANGENT_VERTICES_PER_CHUNK = 32 * 1024;
+
+    struct TangentChunk
+    {
+        // Accumulated tangents for vertices [BaseVtx, BaseVtx + NumVertices)
+        float4a* Tangents;
+        uint32_t BaseVtx;
+        uint32_t NumVertices;
+        uint32_t NumCollinearTris;
+    };
+
+    // Expects p in [0, 1]^3
+    ZetaInline uint32_t Morton3D(float3 p)
+    {
+        const uint32_t x = (uint32_t)Min(Max(p.x * 1024.0f, 0.0f), 1023.0f);
+        const uint32_t y = (uint32_t)Min(Max(p.y * 1024.0f, 0.0f), 1023.0f);
+        const uint32_t z = (uint32_t)Min(Max(p.z * 1024.0f, 0.0f), 1023.0f);
+
+        return Math::Morton3D(x, y, z);
+    }
+}
 
 //--------------------------------------------------------------------------------------
 // Surfaces
@@ -12,12 +45,6 @@ using namespace ZetaRay::Math;
 
 void ZetaRay::Math::ComputeMeshTangentVectors(MutableSpan<Vertex> vertices, Span<uint32_t> indices, bool rhsIndices)
 {
-    float3* tangents = new float3[vertices.size()];
-    memset(tangents, 0, sizeof(float3) * vertices.size());
-
-//    for (auto& v : vertices)
-//        v.Tangent = half3(0.0f, 0.0f, 0.0f);
-
     // Given triangle with vertices v0, v1, v2 (in clockwise order) and corresponding texture coords
     // (u0, v0), (u1, v1) and (u2, v2) we have:
     // 
@@ -37,75 +64,204 @@ void ZetaRay::Math::ComputeMeshTangentVectors(MutableSpan<Vertex> vertices, Span
     // |     |              |                  |     | v0 - v1  u1 - u0 |           
     //
     // where D = (u1 - u0) * (v2 - v0) - (u2 - u0) * (v1 - v0)
+    //
+    // Triangles are split into chunks that are processed in parallel. Each chunk 
+    // accumulates into its own buffer that covers the range of vertices it references,
+    // which are then summed up per vertex.
 
-    uint32_t numCollinearTris = 0;
+    const size_t numTris = indices.size() / 3;
+    const size_t numChunks = Max(Min(CeilUnsignedIntDiv(numTris, TANGENT_TRIS_PER_CHUNK), 
+        (size_t)MAX_NUM_TANGENT_CHUNKS), 1llu);
+    const size_t trisPerChunk = CeilUnsignedIntDiv(Max(numTris, 1llu), numChunks);
+    TangentChunk chunks[MAX_NUM_TANGENT_CHUNKS];
 
-    for (size_t i = 0; i < indices.size(); i += 3)
+    // Vertex range of each chunk
+    App::ParallelFor(numChunks, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t c = begin; c < end; c++)
+            {
+                const size_t beginIdx = Min(c * trisPerChunk, numTris) * 3;
+                const size_t endIdx = Min((c + 1) * trisPerChunk, numTris) * 3;
+                uint32_t minVtx = UINT32_MAX;
+                uint32_t maxVtx = 0;
+
+                for (size_t i = beginIdx; i < endIdx; i++)
+                {
+                    minVtx = Min(minVtx, indices[i]);
+                    maxVtx = Max(maxVtx, indices[i]);
+                }
+
+                chunks[c].BaseVtx = minVtx <= maxVtx ? minVtx : 0;
+                chunks[c].NumVertices = minVtx <= maxVtx ? maxVtx - minVtx + 1 : 0;
+                chunks[c].NumCollinearTris = 0;
+            }
+        });
+
+    MemoryArena arena(1024 * 1024);
+
+    for (size_t c = 0; c < numChunks; c++)
     {
-        uint32_t i0 = indices[i];
-        uint32_t i1 = indices[i + 1];
-        uint32_t i2 = indices[i + 2];
+        chunks[c].Tangents = reinterpret_cast<float4a*>(arena.AllocateAligned(
+            Max(chunks[c].NumVertices, 1u) * sizeof(float4a), alignof(float4a)));
+    }
 
-        // swap i1 & i2
-        if (rhsIndices)
+    App::ParallelFor(numChunks, 1, [&](size_t begin, size_t end)
         {
-            uint32_t temp = i1;
-            i1 = i2;
-            i2 = temp;
-        }
+            for (size_t c = begin; c < end; c++)
+            {
+                TangentChunk& chunk = chunks[c];
+                memset(chunk.Tangents, 0, chunk.NumVertices * sizeof(float4a));
 
-        float2 uv0 = vertices[i0].TexUV;
-        float3 pos0 = vertices[i0].Position;
+                const size_t beginTri = Min(c * trisPerChunk, numTris);
+                const size_t endTri = Min((c + 1) * trisPerChunk, numTris);
 
-        float2 uv1 = vertices[i1].TexUV;
-        float3 pos1 = vertices[i1].Position;
+                for (size_t t = beginTri; t < endTri; t++)
+                {
+                    const uint32_t i0 = indices[t * 3];
+                    // swap i1 & i2
+                    const uint32_t i1 = indices[t * 3 + (rhsIndices ? 2 : 1)];
+                    const uint32_t i2 = indices[t * 3 + (rhsIndices ? 1 : 2)];
 
-        float2 uv2 = vertices[i2].TexUV;
-        float3 pos2 = vertices[i2].Position;
+                    const float2 uv1Minuv0 = vertices[i1].TexUV - vertices[i0].TexUV;
+                    const float2 uv2Minuv0 = vertices[i2].TexUV - vertices[i0].TexUV;
 
-        float2 uv1Minuv0 = uv1 - uv0;
-        float2 uv2Minuv0 = uv2 - uv0;
+                    const float det = uv1Minuv0.x * uv2Minuv0.y - uv1Minuv0.y * uv2Minuv0.x;
+                    if (det == 0)
+                    {
+                        chunk.NumCollinearTris++;
+                        continue;
+                    }
 
-        float det = uv1Minuv0.x * uv2Minuv0.y - uv1Minuv0.y * uv2Minuv0.x;
-        if (det == 0)
+                    const float oneDivDet = 1.0f / det;
+                    const __m128 vP0 = loadFloat3(vertices[i0].Position);
+                    const __m128 vP1Minp0 = _mm_sub_ps(loadFloat3(vertices[i1].Position), vP0);
+                    const __m128 vP2Minp0 = _mm_sub_ps(loadFloat3(vertices[i2].Position), vP0);
+
+                    // T = ((p1 - p0) * (v2 - v0) - (p2 - p0) * (v1 - v0)) / D
+                    __m128 vT = _mm_mul_ps(vP1Minp0, _mm_set1_ps(uv2Minuv0.y * oneDivDet));
+                    vT = _mm_fnmadd_ps(vP2Minp0, _mm_set1_ps(uv1Minuv0.y * oneDivDet), vT);
+
+                    float* t0 = reinterpret_cast<float*>(&chunk.Tangents[i0 - chunk.BaseVtx]);
+                    float* t1 = reinterpret_cast<float*>(&chunk.Tangents[i1 - chunk.BaseVtx]);
+                    float* t2 = reinterpret_cast<float*>(&chunk.Tangents[i2 - chunk.BaseVtx]);
+                    _mm_store_ps(t0, _mm_add_ps(_mm_load_ps(t0), vT));
+                    _mm_store_ps(t1, _mm_add_ps(_mm_load_ps(t1), vT));
+                    _mm_store_ps(t2, _mm_add_ps(_mm_load_ps(t2), vT));
+                }
+            }
+        });
+
+    // Sum up the chunks, then Gram-Schmidt orthonormalization. Assumes vertex normals 
+    // are normalized.
+    App::ParallelFor(vertices.size(), TANGENT_VERTICES_PER_CHUNK, [&](size_t begin, size_t end)
         {
-            numCollinearTris++;
-            continue;
-        }
+            for (size_t i = begin; i < end; i++)
+            {
+                __m128 vT = _mm_setzero_ps();
 
-        float oneDivDet = 1.0f / det;
+                for (size_t c = 0; c < numChunks; c++)
+                {
+                    const size_t local = i - chunks[c].BaseVtx;
+                    if (i >= chunks[c].BaseVtx && local < chunks[c].NumVertices)
+                        vT = _mm_add_ps(vT, _mm_load_ps(reinterpret_cast<float*>(&chunks[c].Tangents[local])));
+                }
 
-        float3 p1Minp0 = pos1 - pos0;
-        float3 p2Minp0 = pos2 - pos0;
+                float3 n = vertices[i].Normal.decode();
+                const __m128 vN = loadFloat3(n);
+                // t - (n.t) n
+                vT = _mm_fnmadd_ps(_mm_dp_ps(vN, vT, 0x7f), vN, vT);
+                vT = normalize(vT);
+                vT = encode_octahedral(vT);
 
-        float3 T(p1Minp0.x * uv2Minuv0.y + p2Minp0.x * -uv1Minuv0.y,
-                 p1Minp0.y * uv2Minuv0.y + p2Minp0.y * -uv1Minuv0.y,
-                 p1Minp0.z * uv2Minuv0.y + p2Minp0.z * -uv1Minuv0.y);
+                vertices[i].Tangent.v = unorm2::FromNormalized(vT);
+            }
+        });
 
-        T *= oneDivDet;
+    uint32_t numCollinearTris = 0;
+    for (size_t c = 0; c < numChunks; c++)
+        numCollinearTris += chunks[c].NumCollinearTris;
 
-        tangents[i0] += T;
-        tangents[i1] += T;
-        tangents[i2] += T;
+    if (numCollinearTris)
+    {
+        LOG_UI_WARNING("Mesh had %u/%u collinear triangles, vertex tangents might be missing.\n",
+            numCollinearTris, (uint32_t)numTris);
     }
+}
 
-    // Gram-Schmidt Orthonormalization
-    // Assumes vertex normala are normalized
-    for(size_t i = 0; i < vertices.size(); i++)
+void ZetaRay::Math::OptimizeMeshLocality(MutableSpan<Vertex> vertices, MutableSpan<uint32_t> indices)
+{
+    const uint32_t numTris = (uint32_t)(indices.size() / 3);
+    if (numTris < 2)
+        return;
+
+    // Bounds of triangle centroids
+    float3 lo(FLT_MAX);
+    float3 hi(-FLT_MAX);
+
+    for (uint32_t t = 0; t < numTris; t++)
     {
-        float3 n = vertices[i].Normal.decode();
-        float3 tangProjectedOnNormal = n.dot(tangents[i]) * n;
-        tangents[i] -= tangProjectedOnNormal;
-        tangents[i].normalize();
+        const float3 c = (vertices[indices[t * 3]].Position + 
+            vertices[indices[t * 3 + 1]].Position + 
+            vertices[indices[t * 3 + 2]].Position) / 3.0f;
 
-        vertices[i].Tangent = oct32(tangents[i]);
+        lo = float3(Min(lo.x, c.x), Min(lo.y, c.y), Min(lo.z, c.z));
+        hi = float3(Max(hi.x, c.x), Max(hi.y, c.y), Max(hi.z, c.z));
     }
 
-    if (numCollinearTris)
+    const float3 extents = hi - lo;
+    const float3 scale(extents.x > 0 ? 1.0f / extents.x : 0.0f,
+        extents.y > 0 ? 1.0f / extents.y : 0.0f,
+        extents.z > 0 ? 1.0f / extents.z : 0.0f);
+
+    // Morton code in high bits, triangle index in low bits
+    SmallVector<uint64_t> keys;
+    keys.resize_uninitialized(numTris);
+
+    for (uint32_t t = 0; t < numTris; t++)
     {
-        LOG_UI_WARNING("Mesh had %u/%u collinear triangles, vertex tangents might be missing.\n",
-            numCollinearTris, (uint32_t)indices.size() / 3);
+        const float3 c = (vertices[indices[t * 3]].Position + 
+            vertices[indices[t * 3 + 1]].Position + 
+            vertices[indices[t * 3 + 2]].Position) / 3.0f;
+
+        keys[t] = ((uint64_t)Morton3D((c - lo) * scale) << 32) | t;
     }
 
-    delete[] tangents;
+    std::sort(keys.begin(), keys.end());
+
+    // Reorder triangles. Vertices are renumbered in order of first use, while the 
+    // unreferenced ones (if any) go last.
+    SmallVector<uint32_t> newIndices;
+    newIndices.resize_uninitialized(indices.size());
+    SmallVector<uint32_t> remap;
+    remap.resize(vertices.size(), UINT32_MAX);
+    uint32_t nextVtx = 0;
+
+    for (uint32_t t = 0; t < numTris; t++)
+    {
+        const uint32_t oldTri = (uint32_t)(keys[t] & UINT32_MAX);
+
+        for (int j = 0; j < 3; j++)
+        {
+            const uint32_t oldIdx = indices[oldTri * 3 + j];
+            if (remap[oldIdx] == UINT32_MAX)
+                remap[oldIdx] = nextVtx++;
+
+            newIndices[t * 3 + j] = remap[oldIdx];
+        }
+    }
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        if (remap[i] == UINT32_MAX)
+            remap[i] = nextVtx++;
+    }
+
+    SmallVector<Vertex> newVertices;
+    newVertices.resize_uninitialized(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++)
+        newVertices[remap[i]] = vertices[i];
+
+    memcpy(vertices.data(), newVertices.data(), vertices.size() * sizeof(Vertex));
+    memcpy(indices.data(), newIndices.data(), numTris * 3 * sizeof(uint32_t));
 }
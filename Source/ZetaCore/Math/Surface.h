@@ -9,6 +9,11 @@ namespace ZetaRay::Math
     void ComputeMeshTangentVectors(Util::MutableSpan<Core::Vertex> vertices, Util::Span<uint32_t> indices,
         bool rhsIndices = false);
 
+    // Reorders triangles along a Morton curve over their centroids and then vertices 
+    // in order of first use, so that nearby triangles are also adjacent in memory. 
+    // Winding order and the set of triangles are preserved.
+    void OptimizeMeshLocality(Util::MutableSpan<Core::Vertex> vertices, Util::MutableSpan<uint32_t> indices);
+
     // Returns barrycentric coordinates (u, v, w) of point p relative to triangle v0v1v2 (ordered clockwise)
     // such that p = V0 + v(V1 - V0) + w(V2 - V0) or alternatively,
     //           p = uV0 + vV1 + wV2
@@ -1,6 +1,8 @@
 #include "Mesh.h"
 #include "../Math/Surface.h"
 #include "../Math/MatrixFuncs.h"
+#include "../Utility/HashTable.h"
+#include <xxHash/xxhash.h>
 
 using namespace ZetaRay;
 using namespace ZetaRay::Core;
@@ -805,3 +807,271 @@ void PrimitiveMesh::ComputeTeapot(Vector<Vertex>& vertices, Vector<uint32_t>& in
         }
     }
 }
+
+//--------------------------------------------------------------------------------------
+// MeshSimplification
+//--------------------------------------------------------------------------------------
+
+void MeshSimplification::VertexClustering(Span<Vertex> vertices, Span<uint32_t> indices,
+    const AABB& aabb, uint32_t gridRes, Vector<uint32_t>& outIndices)
+{
+    Assert(gridRes > 0, "Invalid grid resolution.");
+    Assert(indices.size() % 3 == 0, "Invalid number of indices.");
+    outIndices.clear();
+
+    const float maxExtent = Max(aabb.Extents.x, Max(aabb.Extents.y, aabb.Extents.z));
+    if (maxExtent <= 0)
+        return;
+
+    // Cells are cubes, shorter axes get fewer of them
+    const float cellSize = 2.0f * maxExtent / gridRes;
+    const float3 lower = aabb.Center - aabb.Extents;
+    uint32_t dim[3];
+    dim[0] = Min((uint32_t)(2.0f * aabb.Extents.x / cellSize) + 1, gridRes);
+    dim[1] = Min((uint32_t)(2.0f * aabb.Extents.y / cellSize) + 1, gridRes);
+    dim[2] = Min((uint32_t)(2.0f * aabb.Extents.z / cellSize) + 1, gridRes);
+
+    struct Cluster
+    {
+        float3 PosSum;
+        uint32_t NumVertices;
+        uint32_t Rep;
+        float RepDistSq;
+    };
+
+    SmallVector<Cluster> clusters;
+    SmallVector<uint32_t> vtxToCluster;
+    vtxToCluster.resize(vertices.size());
+    HashTable<uint32_t> keyToCluster;
+    keyToCluster.resize(vertices.size(), true);
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const float3 p = vertices[i].Position;
+        const uint32_t x = Min((uint32_t)Max((p.x - lower.x) / cellSize, 0.0f), dim[0] - 1);
+        const uint32_t y = Min((uint32_t)Max((p.y - lower.y) / cellSize, 0.0f), dim[1] - 1);
+        const uint32_t z = Min((uint32_t)Max((p.z - lower.z) / cellSize, 0.0f), dim[2] - 1);
+
+        oct32 encoded = vertices[i].Normal;
+        const float3 n = encoded.decode();
+        const uint32_t octant = (n.x < 0) | ((n.y < 0) << 1) | ((n.z < 0) << 2);
+        const uint64_t key = ((((uint64_t)z * dim[1] + y) * dim[0] + x) << 3) | octant;
+
+        uint32_t clusterIdx;
+        if (auto it = keyToCluster.find(key); it)
+            clusterIdx = *it.value();
+        else
+        {
+            clusterIdx = (uint32_t)clusters.size();
+            keyToCluster.insert_or_assign(key, clusterIdx);
+            clusters.push_back(Cluster{ .PosSum = float3(0, 0, 0),
+                .NumVertices = 0,
+                .Rep = UINT32_MAX,
+                .RepDistSq = FLT_MAX });
+        }
+
+        clusters[clusterIdx].PosSum += p;
+        clusters[clusterIdx].NumVertices++;
+        vtxToCluster[i] = clusterIdx;
+    }
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        Cluster& c = clusters[vtxToCluster[i]];
+        const float3 avg = c.PosSum / (float)c.NumVertices;
+        const float3 d = vertices[i].Position - avg;
+        const float distSq = d.dot(d);
+
+        if (distSq < c.RepDistSq)
+        {
+            c.RepDistSq = distSq;
+            c.Rep = (uint32_t)i;
+        }
+    }
+
+    // Triangles whose corners land in the same three clusters are kept once
+    HashTable<bool> seen;
+    seen.resize(indices.size() / 3, true);
+    outIndices.reserve(indices.size() / 2);
+
+    for (size_t t = 0; t < indices.size(); t += 3)
+    {
+        const uint32_t a = clusters[vtxToCluster[indices[t]]].Rep;
+        const uint32_t b = clusters[vtxToCluster[indices[t + 1]]].Rep;
+        const uint32_t c = clusters[vtxToCluster[indices[t + 2]]].Rep;
+
+        if (a == b || b == c || a == c)
+            continue;
+
+        // Rotate so that the smallest index comes first, keeping the winding order
+        uint32_t tri[3] = { a, b, c };
+        while (tri[0] > tri[1] || tri[0] > tri[2])
+        {
+            const uint32_t first = tri[0];
+            tri[0] = tri[1];
+            tri[1] = tri[2];
+            tri[2] = first;
+        }
+
+        const uint64_t key = XXH3_64bits(tri, sizeof(tri));
+        if (!seen.try_emplace(key, true))
+            continue;
+
+        outIndices.append_range(tri, tri + 3);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Meshlets
+//--------------------------------------------------------------------------------------
+
+void Meshlets::Build(Span<Vertex> vertices, Span<uint32_t> indices, Vector<RT::Meshlet>& meshlets,
+    Vector<uint32_t>& data)
+{
+    Assert(indices.size() % 3 == 0, "Invalid number of indices.");
+    const uint32_t numTris = (uint32_t)(indices.size() / 3);
+
+    uint32_t localVerts[MESHLET_MAX_VERTICES];
+    uint32_t localTris[MESHLET_MAX_TRIANGLES];
+    uint32_t numVerts = 0;
+    uint32_t numMeshletTris = 0;
+    uint32_t firstTri = 0;
+
+    auto emit = [&]()
+    {
+        float3 lower(FLT_MAX, FLT_MAX, FLT_MAX);
+        float3 upper(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+        for (uint32_t i = 0; i < numVerts; i++)
+        {
+            const float3 p = vertices[localVerts[i]].Position;
+            lower = float3(Min(lower.x, p.x), Min(lower.y, p.y), Min(lower.z, p.z));
+            upper = float3(Max(upper.x, p.x), Max(upper.y, p.y), Max(upper.z, p.z));
+        }
+
+        const float3 center = (lower + upper) * 0.5f;
+        float radius = 0;
+
+        for (uint32_t i = 0; i < numVerts; i++)
+        {
+            const float3 d = vertices[localVerts[i]].Position - center;
+            radius = Max(radius, d.length());
+        }
+
+        // Face normals, oriented to agree with the shading normals
+        float3 faceNormals[MESHLET_MAX_TRIANGLES];
+        uint32_t numValid = 0;
+        float3 axis(0, 0, 0);
+
+        for (uint32_t t = 0; t < numMeshletTris; t++)
+        {
+            const uint32_t i0 = indices[(firstTri + t) * 3];
+            const uint32_t i1 = indices[(firstTri + t) * 3 + 1];
+            const uint32_t i2 = indices[(firstTri + t) * 3 + 2];
+            const float3 v0 = vertices[i0].Position;
+            float3 n = (vertices[i1].Position - v0).cross(vertices[i2].Position - v0);
+            const float len = n.length();
+            if (len <= FLT_EPSILON)
+                continue;
+
+            n /= len;
+            oct32 n0 = vertices[i0].Normal;
+            oct32 n1 = vertices[i1].Normal;
+            oct32 n2 = vertices[i2].Normal;
+            const float3 shadingNormal = n0.decode() + n1.decode() + n2.decode();
+            if (n.dot(shadingNormal) < 0)
+                n *= -1.0f;
+
+            faceNormals[numValid++] = n;
+            axis += n;
+        }
+
+        // Cone is disabled (cutoff of 1) when normals are too spread out
+        float cutoff = 1.0f;
+        const float axisLen = axis.length();
+
+        if (numValid && axisLen > FLT_EPSILON)
+        {
+            axis /= axisLen;
+            float minDot = 1.0f;
+
+            for (uint32_t t = 0; t < numValid; t++)
+                minDot = Min(minDot, axis.dot(faceNormals[t]));
+
+            if (minDot > 0.1f)
+                cutoff = sqrtf(1.0f - minDot * minDot);
+        }
+        else
+            axis = float3(0, 0, 1);
+
+        RT::Meshlet m;
+        m.Center = center;
+        m.Radius = radius;
+        m.ConeAxis = oct32(axis).v;
+        m.ConeCutoff = cutoff;
+        m.DataOffset = (uint32_t)data.size();
+        m.FirstTri = firstTri;
+        m.NumVerts = (uint16_t)numVerts;
+        m.NumTris = (uint16_t)numMeshletTris;
+        meshlets.push_back(m);
+
+        data.append_range(localVerts, localVerts + numVerts);
+        data.append_range(localTris, localTris + numMeshletTris);
+
+        firstTri += numMeshletTris;
+        numVerts = 0;
+        numMeshletTris = 0;
+    };
+
+    // Returns the number of triangle vertices that aren't in the current meshlet yet
+    auto findLocal = [&](uint32_t t, uint32_t local[3])
+    {
+        uint32_t numNew = 0;
+
+        for (int j = 0; j < 3; j++)
+        {
+            const uint32_t idx = indices[t * 3 + j];
+            local[j] = UINT32_MAX;
+
+            for (uint32_t k = 0; k < numVerts; k++)
+            {
+                if (localVerts[k] == idx)
+                {
+                    local[j] = k;
+                    break;
+                }
+            }
+
+            numNew += local[j] == UINT32_MAX;
+        }
+
+        return numNew;
+    };
+
+    for (uint32_t t = 0; t < numTris; t++)
+    {
+        uint32_t local[3];
+        const uint32_t numNew = findLocal(t, local);
+
+        if (numVerts + numNew > MESHLET_MAX_VERTICES || numMeshletTris == MESHLET_MAX_TRIANGLES)
+        {
+            emit();
+            findLocal(t, local);
+        }
+
+        // Vertices that repeat within a degenerate triangle just take up an extra slot
+        for (int j = 0; j < 3; j++)
+        {
+            if (local[j] == UINT32_MAX)
+            {
+                local[j] = numVerts;
+                localVerts[numVerts++] = indices[t * 3 + j];
+            }
+        }
+
+        localTris[numMeshletTris++] = local[0] | (local[1] << 8) | (local[2] << 16);
+    }
+
+    if (numMeshletTris)
+        emit();
+}
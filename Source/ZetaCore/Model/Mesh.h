@@ -2,6 +2,7 @@
 
 #include "../Math/CollisionFuncs.h"
 #include "../Core/Vertex.h"
+#include "../RayTracing/RtCommon.h"
 #include "../Utility/Span.h"
 
 namespace ZetaRay::Model
@@ -39,16 +40,78 @@ namespace ZetaRay::Model
             m_AABB = Math::store(vBox);
         }
 
+        // Scale for mapping positions relative to AABB center into [-1, 1] (with 
+        // COMPACT_VERTEX). Flat dimensions use 1 to avoid division by zero.
+        ZetaInline Math::float3 QuantizationExtents() const
+        {
+            return Math::float3(m_AABB.Extents.x > 0 ? m_AABB.Extents.x : 1.0f,
+                m_AABB.Extents.y > 0 ? m_AABB.Extents.y : 1.0f,
+                m_AABB.Extents.z > 0 ? m_AABB.Extents.z : 1.0f);
+        }
+
+        // Meshes with fewer than 2^16 vertices use 16-bit indices in the GPU index buffer
+        ZetaInline bool Uses16BitIndices() const
+        {
+            return m_numVertices <= UINT16_MAX;
+        }
+
+        ZetaInline uint32_t IndexSizeInBytes() const
+        {
+            return Uses16BitIndices() ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
+
+        // Offset into the CPU vertex buffer until the mesh is uploaded, then into the 
+        // GPU vertex buffer
         uint32_t m_vtxBuffStartOffset;
+        // Offset into the CPU index buffer (always 32-bit), only valid until upload
         uint32_t m_idxBuffStartOffset;
         uint32_t m_materialID;
         uint32_t m_numVertices;
         uint32_t m_numIndices;
         Math::AABB m_AABB;
+        // Index of this mesh's dequantization transform (with COMPACT_VERTEX), assigned 
+        // in MeshContainer::UploadToGPU()
+        uint32_t m_quantTransformIdx;
+        // Offset into the GPU index buffer in units of this mesh's index format, assigned 
+        // in MeshContainer::UploadToGPU()
+        uint32_t m_gpuIdxBuffOffset;
+        // Offset into the GPU meshlet buffer, number of meshlets and offset of their 
+        // data in the meshlet data buffer, assigned in MeshContainer::UploadToGPU()
+        uint32_t m_meshletOffset;
+        uint32_t m_numMeshlets;
+        uint32_t m_meshletDataOffset;
     };
 
     static_assert(std::is_trivially_default_constructible_v<TriangleMesh>);
 
+    // Including the source mesh (LOD 0)
+    static constexpr int MAX_NUM_MESH_LODS = 4;
+
+    namespace MeshSimplification
+    {
+        // Simplifies a mesh by vertex clustering. Vertices are snapped to a uniform grid
+        // with "gridRes" cells along the longest axis of "aabb" and each cell collapses to
+        // its vertex that's closest to the cell's average position. Vertices with normals
+        // in different octants go to different clusters, so that thin two-sided geometry
+        // (e.g. leaves) doesn't collapse. Since clusters are represented by vertices of the
+        // source mesh, output indices refer to the same vertex range. Degenerate and
+        // duplicate triangles are removed.
+        void VertexClustering(Util::Span<Core::Vertex> vertices, Util::Span<uint32_t> indices,
+            const Math::AABB& aabb, uint32_t gridRes,
+            Util::Vector<uint32_t, Support::SystemAllocator>& outIndices);
+    }
+
+    namespace Meshlets
+    {
+        // Partitions the mesh into meshlets of consecutive triangles, so that triangle i 
+        // of a meshlet is triangle FirstTri + i of the mesh. Meshlet-local vertex indices 
+        // and triangles are appended to "data" (see RT::Meshlet) and DataOffset is 
+        // relative to its size before the call.
+        void Build(Util::Span<Core::Vertex> vertices, Util::Span<uint32_t> indices,
+            Util::Vector<RT::Meshlet, Support::SystemAllocator>& meshlets,
+            Util::Vector<uint32_t, Support::SystemAllocator>& data);
+    }
+
     // Ref: DirectXTK12 library (MIT License), available from:
     // https://github.com/microsoft/DirectXTK12
     namespace PrimitiveMesh
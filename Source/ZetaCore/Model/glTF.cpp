@@ -1,15 +1,20 @@
 #include "glTF.h"
+#include "glTFParser.h"
 #include "../Math/MatrixFuncs.h"
 #include "../Math/Surface.h"
 #include "../Math/Quaternion.h"
 #include "../Scene/SceneCore.h"
 #include "../Support/Task.h"
+#include "../Support/CpuEvent.h"
+#include "../Core/DirectStorage.h"
 #include "../App/Log.h"
+#include "../App/Timer.h"
 #include "../Utility/Utility.h"
 #include <algorithm>
 
 #define CGLTF_IMPLEMENTATION
 #include <cgltf/cgltf.h>
+#include <meshoptimizer/meshoptimizer.h>
 
 using namespace ZetaRay;
 using namespace ZetaRay::Scene;
@@ -25,6 +30,13 @@ using namespace ZetaRay::Core::Direct3DUtil;
 
 #define CHECK_QUATERNION_VALID 0
 
+// Reorder triangles and vertices of each mesh primitive for spatial locality
+#define OPTIMIZE_MESH_LOCALITY 1
+
+// Upper bound on upload memory used for loading textures, shared by all the glTF files 
+// that are loaded together. Largest texture (after dropping the streamed mips) has to fit.
+#define TEXTURE_UPLOAD_BUDGET_MB 128
+
 //--------------------------------------------------------------------------------------
 // glTF
 //--------------------------------------------------------------------------------------
@@ -87,6 +99,36 @@ namespace
         int MaterialIdx;
     };
 
+    struct WatchedImage
+    {
+        Texture::ID_TYPE ID;
+        // Offset into WatchedScene::ImagePaths
+        uint32_t PathOffset;
+        uint64_t LastWriteTime;
+    };
+
+    // What's needed to tell which parts of a loaded glTF file have changed on disk
+    struct WatchedScene
+    {
+        explicit WatchedScene(StrView path)
+            : Path(path)
+        {}
+
+        Filesystem::Path Path;
+        Filesystem::Path BufferPath;
+        Filesystem::DirectoryWatcher Watcher;
+        bool WatchFailed = false;
+        uint32_t SceneID;
+        uint64_t LastWriteTime;
+        uint64_t BufferLastWriteTime;
+        size_t NumMeshes;
+        // Indexed by glTF material index
+        SmallVector<glTF::Asset::MaterialDesc> Materials;
+        // DDS images only, KTX2 textures aren't streamed
+        SmallVector<WatchedImage> Images;
+        SmallVector<char> ImagePaths;
+    };
+
     struct ThreadContext
     {
         const App::Filesystem::Path* glTFPath;
@@ -98,16 +140,17 @@ namespace
         SmallVector<Mesh> Meshes;
         // All unique textures that need to be loaded from disk
         SmallVector<Texture> DDSImages;
+        TextureUploadRing* UploadRing;
         SmallVector<EmissiveMeshPrim> EmissiveMeshPrims;
         SmallVector<EmissiveInstance> EmissiveInstances;
         SmallVector<RT::EmissiveTriangle> RTEmissives;
+        // Scene graph nodes, parents before children
+        SmallVector<InstanceDesc> Instances;
+        WatchedScene* Watched;
 
         int NumMeshWorkers;
-        int NumImgWorkers;
         size_t* MeshThreadOffsets;
         size_t* MeshThreadSizes;
-        size_t* ImgThreadOffsets;
-        size_t* ImgThreadSizes;
         uint32_t* EmissiveMeshPrimCountPerWorker;
 
         std::atomic_uint32_t CurrVtxOffset = 0;
@@ -118,6 +161,132 @@ namespace
         uint32_t NumEmissiveTris = 0;
     };
 
+    // Outputs of the mesh workers -- vertex and index buffers, mesh primitives and the 
+    // sorted emissive mesh primitives -- so that warm loads can skip loading the glTF 
+    // buffers and processing the meshes. Every section starts at a multiple of 
+    // SECTION_ALIGNMENT and is read directly from a mapped view of the file.
+    struct SceneCacheHeader
+    {
+        static constexpr uint32_t MAGIC = 0x46544c47;   // "GLTF"
+        static constexpr uint32_t VERSION = 3;
+        static constexpr size_t SECTION_ALIGNMENT = 64;
+
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t Key;
+        uint64_t FileSize;
+        uint64_t NumVertices;
+        uint64_t NumIndices;
+        uint64_t NumMeshes;
+        uint64_t NumEmissiveMeshPrims;
+        uint64_t VerticesOffset;
+        uint64_t IndicesOffset;
+        uint64_t MeshesOffset;
+        uint64_t EmissiveMeshPrimsOffset;
+    };
+
+    void SceneCachePath(uint64_t key, Filesystem::Path& path)
+    {
+        StackStr(filename, n, "Scene_%016llx.cache", key);
+        path.Reset(App::GetPSOCacheDir());
+        path.Append(filename);
+    }
+
+    // Hashing the (potentially multi-GB) buffer would defeat the purpose, so the key 
+    // is derived from path, size and last write time of both the glTF and its buffer.
+    uint64_t SceneCacheKey(const Filesystem::Path& glTFPath, const Filesystem::Path& bufferPath)
+    {
+        const uint64_t data[] = { SceneCacheHeader::VERSION,
+            Filesystem::GetFileSize(glTFPath.Get()),
+            Filesystem::GetLastWriteTime(glTFPath.Get()),
+            Filesystem::GetFileSize(bufferPath.Get()),
+            Filesystem::GetLastWriteTime(bufferPath.Get()) };
+
+        const uint64_t pathHash = XXH3_64bits(glTFPath.GetView().data(), glTFPath.Length());
+        return XXH3_64bits_withSeed(data, sizeof(data), pathHash);
+    }
+
+    // Reads the cache header and validates it against the counts from the json
+    bool ReadSceneCacheHeader(const Filesystem::Path& path, uint64_t key, size_t numVertices, 
+        size_t numIndices, size_t numMeshes, SceneCacheHeader& header)
+    {
+        const size_t fileSize = Filesystem::GetFileSize(path.Get());
+        if (fileSize == size_t(-1) || fileSize < sizeof(SceneCacheHeader))
+            return false;
+
+        auto sectionFits = [fileSize](uint64_t offset, uint64_t size)
+            {
+                return offset <= fileSize && size <= fileSize - offset;
+            };
+
+        bool valid = Filesystem::ReadFileRange(path.Get(), &header, 0, sizeof(header));
+        valid = valid && header.Magic == SceneCacheHeader::MAGIC &&
+            header.Version == SceneCacheHeader::VERSION &&
+            header.Key == key &&
+            header.FileSize == fileSize &&
+            // Duplicate meshes were removed
+            header.NumVertices <= numVertices &&
+            header.NumIndices <= numIndices &&
+            header.NumMeshes == numMeshes &&
+            header.NumEmissiveMeshPrims <= numMeshes &&
+            sectionFits(header.VerticesOffset, header.NumVertices * sizeof(Vertex)) &&
+            sectionFits(header.IndicesOffset, header.NumIndices * sizeof(uint32_t)) &&
+            sectionFits(header.MeshesOffset, header.NumMeshes * sizeof(Mesh)) &&
+            sectionFits(header.EmissiveMeshPrimsOffset, header.NumEmissiveMeshPrims * sizeof(EmissiveMeshPrim));
+
+        if (!valid)
+            LOG_UI_WARNING("Scene cache %s is stale or corrupted, ignoring.", path.Get());
+
+        return valid;
+    }
+
+    void WriteSceneCache(uint64_t key, Span<Vertex> vertices, Span<uint32_t> indices, 
+        Span<Mesh> meshes, Span<EmissiveMeshPrim> emissiveMeshPrims)
+    {
+        constexpr size_t ALIGNMENT = SceneCacheHeader::SECTION_ALIGNMENT;
+
+        SceneCacheHeader header{ .Magic = SceneCacheHeader::MAGIC,
+            .Version = SceneCacheHeader::VERSION,
+            .Key = key,
+            .NumVertices = vertices.size(),
+            .NumIndices = indices.size(),
+            .NumMeshes = meshes.size(),
+            .NumEmissiveMeshPrims = emissiveMeshPrims.size() };
+
+        size_t offset = Math::AlignUp(sizeof(SceneCacheHeader), ALIGNMENT);
+        header.VerticesOffset = offset;
+        offset = Math::AlignUp(offset + vertices.size() * sizeof(Vertex), ALIGNMENT);
+        header.IndicesOffset = offset;
+        offset = Math::AlignUp(offset + indices.size() * sizeof(uint32_t), ALIGNMENT);
+        header.MeshesOffset = offset;
+        offset = Math::AlignUp(offset + meshes.size() * sizeof(Mesh), ALIGNMENT);
+        header.EmissiveMeshPrimsOffset = offset;
+        offset += emissiveMeshPrims.size() * sizeof(EmissiveMeshPrim);
+        header.FileSize = offset;
+
+        if (offset > UINT32_MAX)
+        {
+            LOG_UI_WARNING("Scene is too large for the scene cache (%llu MB).", offset / (1024 * 1024));
+            return;
+        }
+
+        Vector<uint8_t, SystemAllocator> file;
+        file.resize(offset, 0);
+
+        memcpy(file.data(), &header, sizeof(header));
+        memcpy(file.data() + header.VerticesOffset, vertices.data(), vertices.size() * sizeof(Vertex));
+        memcpy(file.data() + header.IndicesOffset, indices.data(), indices.size() * sizeof(uint32_t));
+        memcpy(file.data() + header.MeshesOffset, meshes.data(), meshes.size() * sizeof(Mesh));
+        memcpy(file.data() + header.EmissiveMeshPrimsOffset, emissiveMeshPrims.data(), 
+            emissiveMeshPrims.size() * sizeof(EmissiveMeshPrim));
+
+        Filesystem::Path path;
+        SceneCachePath(key, path);
+        Filesystem::WriteToFile(path.Get(), file.data(), (uint32_t)file.size());
+
+        LOG_UI_INFO("Wrote scene cache %s (%llu MB).", path.Get(), offset / (1024 * 1024));
+    }
+
     void ResetEmissiveSubsets(MutableSpan<EmissiveMeshPrim> subsets)
     {
         if (subsets.empty())
@@ -142,26 +311,61 @@ namespace
             subsets[subsets.size() - 1 - i].MeshID = Scene::INVALID_MESH;
     }
 
+    // Start of accessor's data. Buffer views that were meshopt-compressed point to their 
+    // decoded copy rather than the buffer.
+    ZetaInline const uint8_t* AccessorData(const cgltf_accessor& accessor)
+    {
+        Check(accessor.buffer_view, "Accessor without a buffer view is not supported.");
+        const uint8_t* data = cgltf_buffer_view_data(accessor.buffer_view);
+        Check(data, "Buffer view data hasn't been loaded.");
+
+        return data + accessor.offset;
+    }
+
+    // Reads N-component float attributes. Besides float, accepts the (normalized) integer 
+    // component types allowed by KHR_mesh_quantization, which are converted to float.
+    template<int N>
+    struct AttributeReader
+    {
+        explicit AttributeReader(const cgltf_accessor& accessor, const char* attrib)
+            : m_accessor(accessor),
+            m_data(AccessorData(accessor))
+        {
+            Check(accessor.component_type != cgltf_component_type_invalid &&
+                accessor.component_type != cgltf_component_type_r_32u,
+                "Invalid component type for %s attribute.", attrib);
+            Check(!accessor.is_sparse, "Sparse accessors are not supported.");
+
+            m_tightFloat = accessor.component_type == cgltf_component_type_r_32f &&
+                accessor.stride == sizeof(float) * N;
+        }
+
+        ZetaInline void Read(size_t i, float* out) const
+        {
+            if (m_tightFloat)
+                memcpy(out, m_data + i * sizeof(float) * N, sizeof(float) * N);
+            else
+                cgltf_accessor_read_float(&m_accessor, i, out, N);
+        }
+
+        const cgltf_accessor& m_accessor;
+        const uint8_t* m_data;
+        bool m_tightFloat;
+    };
+
     void ProcessPositions(const cgltf_data& model, const cgltf_accessor& accessor, 
         MutableSpan<Vertex> vertices, uint32_t baseOffset)
     {
         Check(accessor.type == cgltf_type_vec3, "Invalid type for POSITION attribute.");
-        Check(accessor.component_type == cgltf_component_type_r_32f,
-            "Invalid component type for POSITION attribute.");
-
-        const cgltf_buffer_view& bufferView = *accessor.buffer_view;
-        Check(accessor.stride == sizeof(float3), "Invalid stride for POSITION attribute.");
-
-        const cgltf_buffer& buffer = *bufferView.buffer;
-        const float3* start = reinterpret_cast<float3*>(reinterpret_cast<uintptr_t>(
-            buffer.data) + bufferView.offset + accessor.offset);
+        AttributeReader<3> reader(accessor, "POSITION");
 
         for (size_t i = 0; i < accessor.count; i++)
         {
-            const float3* curr = start + i;
+            float curr[3];
+            reader.Read(i, curr);
 
             // glTF uses a right-handed coordinate system with +Y as up
-            vertices[baseOffset + i].Position = float3(curr->x, curr->y, -curr->z);
+            vertices[baseOffset + i].Position = float3(curr[0], curr[1], -curr[2]);
         }
     }
 
@@ -169,22 +373,16 @@ namespace
         MutableSpan<Vertex> vertices, uint32_t baseOffset)
     {
         Check(accessor.type == cgltf_type_vec3, "Invalid type for NORMAL attribute.");
-        Check(accessor.component_type == cgltf_component_type_r_32f,
-            "Invalid component type for NORMAL attribute.");
-
-        const cgltf_buffer_view& bufferView = *accessor.buffer_view;
-        Check(accessor.stride == sizeof(float3), "Invalid stride for NORMAL attribute.");
-
-        const cgltf_buffer& buffer = *bufferView.buffer;
-        const float3* start = reinterpret_cast<float3*>(reinterpret_cast<uintptr_t>(
-            buffer.data) + bufferView.offset + accessor.offset);
+        AttributeReader<3> reader(accessor, "NORMAL");
 
         for (size_t i = 0; i < accessor.count; i++)
         {
-            const float3* curr = start + i;
+            float curr[3];
+            reader.Read(i, curr);
 
-            // glTF uses a right-handed coordinate system with +Y as up
-            vertices[baseOffset + i].Normal = oct32(curr->x, curr->y, -curr->z);
+            // glTF uses a right-handed coordinate system with +Y as up. Octahedral 
+            // encoding normalizes, so quantized normals don't need to be renormalized.
+            vertices[baseOffset + i].Normal = oct32(curr[0], curr[1], -curr[2]);
         }
     }
 
@@ -192,20 +390,13 @@ namespace
         MutableSpan<Vertex> vertices, uint32_t baseOffset)
     {
         Check(accessor.type == cgltf_type_vec2, "Invalid type for TEXCOORD_0 attribute.");
-        Check(accessor.component_type == cgltf_component_type_r_32f,
-            "Invalid component type for TEXCOORD_0 attribute.");
-
-        const cgltf_buffer_view& bufferView = *accessor.buffer_view;
-        Check(accessor.stride == sizeof(float2), "Invalid stride for TEXCOORD_0 attribute.");
-
-        const cgltf_buffer& buffer = *bufferView.buffer;
-        const float2* start = reinterpret_cast<float2*>(reinterpret_cast<uintptr_t>(
-            buffer.data) + bufferView.offset + accessor.offset);
+        AttributeReader<2> reader(accessor, "TEXCOORD_0");
 
         for (size_t i = 0; i < accessor.count; i++)
         {
-            const float2* curr = start + i;
-            vertices[baseOffset + i].TexUV = float2(curr->x, curr->y);
+            float curr[2];
+            reader.Read(i, curr);
+            vertices[baseOffset + i].TexUV = float2(curr[0], curr[1]);
         }
     }
 
@@ -213,21 +404,15 @@ namespace
         MutableSpan<Vertex> vertices, uint32_t baseOffset)
     {
         Check(accessor.type == cgltf_type_vec4, "Invalid type for TANGENT attribute.");
-        Check(accessor.component_type == cgltf_component_type_r_32f,
-            "Invalid component type for TANGENT attribute.");
-
-        const cgltf_buffer_view& bufferView = *accessor.buffer_view;
-
-        const cgltf_buffer& buffer = *bufferView.buffer;
-        const float4* start = reinterpret_cast<float4*>(reinterpret_cast<uintptr_t>(
-            buffer.data) + bufferView.offset + accessor.offset);
+        AttributeReader<4> reader(accessor, "TANGENT");
 
         for (size_t i = 0; i < accessor.count; i++)
         {
-            const float4* curr = start + i;
+            float curr[4];
+            reader.Read(i, curr);
 
             // glTF uses a right-handed coordinate system with +Y as up
-            vertices[baseOffset + i].Tangent = oct32(curr->x, curr->y, -curr->z);
+            vertices[baseOffset + i].Tangent = oct32(curr[0], curr[1], -curr[2]);
         }
     }
 
@@ -238,11 +423,8 @@ namespace
         Check(accessor.stride != -1, "Invalid index stride.");
         Check(accessor.count % 3 == 0, "Invalid number of indices.");
 
-        const cgltf_buffer_view& bufferView = *accessor.buffer_view;
-        const cgltf_buffer& buffer = *bufferView.buffer;
-
         // Populate the mesh indices
-        uint8_t* curr = reinterpret_cast<uint8_t*>(reinterpret_cast<uintptr_t>(buffer.data) + bufferView.offset + accessor.offset);
+        const uint8_t* curr = AccessorData(accessor);
         const size_t numFaces = accessor.count / 3;
         const size_t indexStrideInBytes = accessor.stride;
         size_t currIdxOffset = 0;
@@ -387,6 +569,12 @@ namespace
                     }
                 }
 
+#if OPTIMIZE_MESH_LOCALITY == 1
+                // Needs to happen after all the vertex attributes are known
+                Math::OptimizeMeshLocality(MutableSpan(vertices.begin() + currVtxOffset, numVertices),
+                    MutableSpan(indices.begin() + currIdxOffset, numIndices));
+#endif
+
                 meshes[currMeshPrimOffset++] = Mesh
                     {
                         .SceneID = sceneID,
@@ -430,52 +618,129 @@ namespace
         emissivePrimCount = numEmissiveMeshPrims;
     }
 
+    // Textures with KHR_texture_basisu point to their KTX2 image through the extension, 
+    // with image as an optional fallback
+    ZetaInline const cgltf_image* TextureImage(const cgltf_texture& texture)
+    {
+        return texture.has_basisu && texture.basisu_image ? texture.basisu_image : texture.image;
+    }
+
+    // Three stages: headers are read first so that one heap can be allocated for all the 
+    // textures. Then each texture is read from disk and staged into the (shared) upload 
+    // ring, which submits the copies in batches and blocks when it's full. Since this runs
+    // on multiple threads, reads overlap with staging and the GPU copies while upload 
+    // memory stays bounded by the ring size.
     void LoadDDSImages(uint32_t sceneID, const Filesystem::Path& modelDir, const cgltf_data& model,
-        size_t offset, size_t num, MutableSpan<Texture> ddsImages)
+        size_t offset, size_t num, MutableSpan<Texture> ddsImages, TextureUploadRing& uploadRing)
     {
-        // For loading DDS data from disk
-        MemoryArena memArena(64 * 1024 * 1024);
-        // For uploading texture to GPU 
-        UploadHeapArena heapArena(64 * 1024 * 1024);
+        auto getPath = [&modelDir, &model](size_t imageIdx, Filesystem::Path& path)
+            {
+                const cgltf_image& image = model.images[imageIdx];
+                Check(image.uri, "Image has no URI.");
+
+                path.Reset(modelDir.GetView());
+                path.Append(image.uri);
+            };
+
+        // With DirectStorage, texel data is streamed directly into the placed textures 
+        // once they've been created.
+        const bool useDirectStorage = DirectStorage::IsAvailable();
+
+        // Size the reservations from the files in this range. Texel data that ends up in 
+        // memory is bounded by the file size, except for KTX2, which is transcoded (at 
+        // most 8x for ETC1S -> BC7). Allocations that don't fit fall back to heap blocks.
+        constexpr size_t SCRATCH_RESET_THRESHOLD = 64 * 1024 * 1024;
+        constexpr size_t KTX2_EXPANSION = 8;
+        size_t memArenaSize = num * (sizeof(DDS_Data) + sizeof(D3D12_RESOURCE_DESC1) + 
+            sizeof(D3D12_RESOURCE_ALLOCATION_INFO1) + 64);
+        size_t largestDDS = 0;
+
+        for (size_t m = offset; m != offset + num; m++)
+        {
+            Filesystem::Path path;
+            getPath(m, path);
+
+            // Missing files are reported when they're loaded below
+            size_t fileSize = Filesystem::GetFileSize(path.Get());
+            fileSize = fileSize == size_t(-1) ? 0 : fileSize;
+
+            char ext[8];
+            path.Extension(ext);
+            if (strcmp(ext, "ktx2") == 0)
+                memArenaSize += fileSize * KTX2_EXPANSION;
+            else if (strcmp(ext, "dds") == 0)
+            {
+                largestDDS = Math::Max(largestDDS, fileSize);
+                // Mips that DirectStorage can't stream directly are read into memArena
+                memArenaSize += useDirectStorage ? fileSize : 0;
+            }
+        }
+
+        constexpr size_t COMMIT_GRANULARITY = 16 * 1024 * 1024;
+
+        // Holds the headers and KTX2 textures, which are decoded up front
+        MemoryArena memArena(VirtualArenaDesc{ .ReserveSize = memArenaSize,
+            .CommitGranularity = COMMIT_GRANULARITY });
+        // For reading DDS texel data. It's reset once it grows past the threshold, so 
+        // the threshold plus one texture is enough.
+        MemoryArena scratchArena(VirtualArenaDesc{ 
+            .ReserveSize = largestDDS ? SCRATCH_RESET_THRESHOLD + largestDDS : COMMIT_GRANULARITY,
+            .CommitGranularity = COMMIT_GRANULARITY });
+
+        struct DDSImage
+        {
+            DDS_Data Data;
+            uint32_t ImageIdx;
+            // KTX2 textures are always loaded (and transcoded) on the CPU and stay fully 
+            // resident
+            bool KTX2;
+        };
 
         // Since constructor is not called
-        static_assert(std::is_trivially_default_constructible_v<DDS_Data>,
-            "DDS_Data is not trivially-default-constructible.");
-        DDS_Data* ddsTextures = reinterpret_cast<DDS_Data*>(memArena.AllocateAligned(
-            num * sizeof(DDS_Data)));
+        static_assert(std::is_trivially_default_constructible_v<DDSImage>,
+            "DDSImage is not trivially-default-constructible.");
+        DDSImage* ddsTextures = reinterpret_cast<DDSImage*>(memArena.AllocateAligned(
+            num * sizeof(DDSImage)));
         bool hasInvalid = false;
 
-        // Two passes:
-        // 1. Load DDS data from disk
-        // 2. Allocate a heap large enough for all the textures, then create a placed 
-        //    texture for each
-
         for (size_t m = offset; m != offset + num; m++)
         {
-            const cgltf_image& image = model.images[m];
             const size_t idx = m - offset;
-            Check(image.uri, "Image has no URI.");
-
-            Filesystem::Path path(modelDir.GetView());
-            path.Append(image.uri);
+            Filesystem::Path path;
+            getPath(m, path);
+            ddsTextures[idx].ImageIdx = (uint32_t)m;
 
             char ext[8];
             path.Extension(ext);
-            if (strcmp(ext, "dds") != 0)
+            const bool isKTX2 = strcmp(ext, "ktx2") == 0;
+            if (strcmp(ext, "dds") != 0 && !isKTX2)
             {
                 LOG_UI_WARNING(
-                    "Texture in path %s either hasn't been converted to DDS format or is not referenced by any materials. Skipping...\n",
+                    "Texture in path %s either hasn't been converted to DDS/KTX2 format or is not referenced by any materials. Skipping...\n",
                     path.Get());
 
-                ddsTextures[idx].ID = Texture::INVALID_ID;
+                ddsTextures[idx].Data.ID = Texture::INVALID_ID;
                 hasInvalid = true;
 
                 continue;
             }
 
-            ddsTextures[idx].ID = IDFromTexturePath(path);
-            auto err = GpuMemory::GetDDSDataFromDisk(path.Get(), ddsTextures[idx], heapArena,
-                ArenaAllocator(memArena));
+            DDS_Data& dds = ddsTextures[idx].Data;
+            dds.ID = IDFromTexturePath(path);
+            ddsTextures[idx].KTX2 = isKTX2;
+
+            if (isKTX2)
+            {
+                dds.depth = 1;
+                auto err = Direct3DUtil::LoadKTX2FromFile(path.Get(), dds.subresources, dds.format,
+                    ArenaAllocator(memArena), dds.width, dds.height, dds.mipCount, dds.numSubresources);
+
+                Check(err == LOAD_DDS_RESULT::SUCCESS, "Error loading KTX2 texture from path %s: %d", path.Get(), err);
+                continue;
+            }
+
+            auto err = Direct3DUtil::LoadDDSHeaderFromFile(path.Get(), dds.subresources, dds.format, 
+                dds.width, dds.height, dds.depth, dds.mipCount, dds.numSubresources);
 
             Check(err == LOAD_DDS_RESULT::SUCCESS, "Error loading DDS texture from path %s: %d", path.Get(), err);
         }
@@ -483,8 +748,8 @@ namespace
         size_t numValid = num;
         if (hasInvalid)
         {
-            DDS_Data* firstInvalid = std::partition(ddsTextures, ddsTextures + num,
-                [](const DDS_Data& dds) {return dds.ID != Texture::INVALID_ID; });
+            DDSImage* firstInvalid = std::partition(ddsTextures, ddsTextures + num,
+                [](const DDSImage& dds) {return dds.Data.ID != Texture::INVALID_ID; });
             numValid = firstInvalid - ddsTextures;
         }
 
@@ -495,33 +760,137 @@ namespace
             numValid * sizeof(D3D12_RESOURCE_DESC1)));
         D3D12_RESOURCE_ALLOCATION_INFO1* allocInfos = reinterpret_cast<D3D12_RESOURCE_ALLOCATION_INFO1*>(memArena.AllocateAligned(
             numValid * sizeof(D3D12_RESOURCE_ALLOCATION_INFO1)));
+        // Only the lower-resolution mips are loaded here, the rest are streamed in as needed
+        uint16_t* topMips = reinterpret_cast<uint16_t*>(memArena.AllocateAligned(
+            numValid * sizeof(uint16_t)));
+        // Textures that went through the upload ring and need to be transitioned afterwards
+        ID3D12Resource** uploaded = reinterpret_cast<ID3D12Resource**>(memArena.AllocateAligned(
+            numValid * sizeof(ID3D12Resource*)));
+        uint32_t numUploaded = 0;
 
         for (size_t i = 0; i < numValid; i++)
         {
-            texDescs[i] = Direct3DUtil::Tex2D1(ddsTextures[i].format, ddsTextures[i].width, 
-                ddsTextures[i].height, 1, ddsTextures[i].mipCount);
+            const DDS_Data& dds = ddsTextures[i].Data;
+            const uint16_t topMip = ddsTextures[i].KTX2 ? 0 : 
+                Scene::Internal::TextureStreamer::InitialTopMip(dds.width, dds.height, dds.mipCount);
+            topMips[i] = topMip;
+
+            texDescs[i] = Direct3DUtil::Tex2D1(dds.format, Math::Max(dds.width >> topMip, 1u), 
+                Math::Max(dds.height >> topMip, 1u), 1, (uint16_t)(dds.mipCount - topMip));
         }
 
         D3D12_RESOURCE_ALLOCATION_INFO info = Direct3DUtil::AllocationInfo(Span(texDescs, numValid),
             MutableSpan(allocInfos, numValid));
-        auto heap = GpuMemory::GetResourceHeap(info.SizeInBytes);
+        auto heap = GpuMemory::GetResourceHeap("SceneTextures", info.SizeInBytes, MEMORY_CATEGORY::TEXTURE);
+
+        // Placed textures start out in the COMMON state, as required by both DirectStorage 
+        // and the upload ring. Invalid texture were default-constructed to have INVALID_ID.
+        for (size_t i = 0; i < numValid; i++)
+        {
+            ddsImages[offset + i] = GpuMemory::GetPlacedTexture2D(ddsTextures[i].Data.ID, 
+                texDescs[i], heap.Heap(), allocInfos[i].Offset, D3D12_RESOURCE_STATE_COMMON);
+        }
+
+        // KTX2 textures are already in memory
+        for (size_t i = 0; i < numValid; i++)
+        {
+            const DDS_Data& dds = ddsTextures[i].Data;
+            if (!ddsTextures[i].KTX2)
+                continue;
+
+            ID3D12Resource* res = ddsImages[offset + i].Resource();
+            uploadRing.UploadTexture(res, Span(dds.subresources, dds.numSubresources));
+            uploaded[numUploaded++] = res;
+        }
+
+        if (!useDirectStorage)
+        {
+            for (size_t i = 0; i < numValid; i++)
+            {
+                if (ddsTextures[i].KTX2)
+                    continue;
+
+                Filesystem::Path path;
+                getPath(ddsTextures[i].ImageIdx, path);
+
+                DDS_Data& dds = ddsTextures[i].Data;
+                auto err = GpuMemory::GetDDSDataFromDisk(path.Get(), dds, ArenaAllocator(scratchArena));
+                Check(err == LOAD_DDS_RESULT::SUCCESS, "Error loading DDS texture from path %s: %d", path.Get(), err);
+
+                ID3D12Resource* res = ddsImages[offset + i].Resource();
+                uploadRing.UploadTexture(res, Span(dds.subresources + topMips[i], 
+                    dds.numSubresources - topMips[i]));
+                uploaded[numUploaded++] = res;
+
+                // Staged data has been copied to the ring
+                if (scratchArena.TotalSize() >= SCRATCH_RESET_THRESHOLD)
+                    scratchArena.Reset();
+            }
+        }
+        else
+        {
+            uint32_t* numStreamed = reinterpret_cast<uint32_t*>(memArena.AllocateAligned(
+                numValid * sizeof(uint32_t)));
+
+            for (size_t i = 0; i < numValid; i++)
+            {
+                numStreamed[i] = 0;
+                if (ddsTextures[i].KTX2)
+                    continue;
+
+                DDS_Data& dds = ddsTextures[i].Data;
+                Filesystem::Path path;
+                getPath(ddsTextures[i].ImageIdx, path);
+                numStreamed[i] = DirectStorage::EnqueueDDS(path.Get(), ddsImages[offset + i].Resource(), 
+                    MutableSpan(dds.subresources + topMips[i], dds.numSubresources - topMips[i]), 
+                    ArenaAllocator(memArena));
+            }
+
+            // One batch for all the textures in this range
+            DirectStorage::WaitForBatch(DirectStorage::Submit());
+
+            // Mips that couldn't be streamed directly have been read into memory by now
+            for (size_t i = 0; i < numValid; i++)
+            {
+                DDS_Data& dds = ddsTextures[i].Data;
+                const uint32_t numLoaded = dds.numSubresources - topMips[i];
+                if (ddsTextures[i].KTX2 || numStreamed[i] == numLoaded)
+                    continue;
+
+                ID3D12Resource* res = ddsImages[offset + i].Resource();
+                uploadRing.UploadTexture(res, 
+                    Span(dds.subresources + topMips[i] + numStreamed[i], numLoaded - numStreamed[i]),
+                    numStreamed[i]);
+                uploaded[numUploaded++] = res;
+            }
+        }
+
+        uploadRing.Flush(Span(uploaded, numUploaded));
 
-        // Invalid texture were default-constructed to have INVALID_ID
         for (size_t i = 0; i < numValid; i++)
         {
-            Texture tex = GpuMemory::GetPlacedTexture2DAndInit(ddsTextures[i].ID, 
-                texDescs[i], heap.Heap(), allocInfos[i].Offset, heapArena, 
-                Span(ddsTextures[i].subresources, ddsTextures[i].numSubresources));
+            if (topMips[i] == 0)
+                continue;
 
-            // Order of textures is not important
-            ddsImages[offset + i] = ZetaMove(tex);
+            const DDS_Data& dds = ddsTextures[i].Data;
+            Filesystem::Path path;
+            getPath(ddsTextures[i].ImageIdx, path);
+
+            App::GetScene().AddStreamingTexture(Scene::Internal::TextureStreamer::TextureDesc{
+                .ID = dds.ID,
+                .Path = path.Get(),
+                .Width = dds.width,
+                .Height = dds.height,
+                .Format = dds.format,
+                .MipCount = dds.mipCount,
+                .ResidentMip = topMips[i] });
         }
 
         App::GetScene().AddTextureHeap(ZetaMove(heap));
     }
 
-    void ProcessMaterials(uint32_t sceneID, const Filesystem::Path& modelDir, const cgltf_data& model,
-        int offset, int size, MutableSpan<Texture> ddsImages)
+    void BuildMaterialDesc(uint32_t sceneID, const Filesystem::Path& modelDir, const cgltf_data& model,
+        int m, glTF::Asset::MaterialDesc& desc)
     {
         auto getAlphaMode = [](cgltf_alpha_mode m)
             {
@@ -541,105 +910,340 @@ namespace
                 return Material::ALPHA_MODE::OPAQUE_;
             };
 
-        for (int m = offset; m != offset + size; m++)
+        const auto& mat = model.materials[m];
+        Check(mat.has_pbr_metallic_roughness, "Material is not supported.");
+
+        desc.ID = Scene::MaterialID(sceneID, m);
+        desc.AlphaMode = getAlphaMode(mat.alpha_mode);
+        desc.AlphaCutoff = (float)mat.alpha_cutoff;
+        desc.DoubleSided = mat.double_sided;
+
+        // Base Color map
         {
-            const auto& mat = model.materials[m];
-            Check(mat.has_pbr_metallic_roughness, "Material is not supported.");
+            const cgltf_texture_view& baseColView = mat.pbr_metallic_roughness.base_color_texture;
+            if (baseColView.texture)
+            {
+                Check(TextureImage(*baseColView.texture), "textureView doesn't point to any image.");
 
-            glTF::Asset::MaterialDesc desc;
-            desc.ID = Scene::MaterialID(sceneID, m);
-            desc.AlphaMode = getAlphaMode(mat.alpha_mode);
-            desc.AlphaCutoff = (float)mat.alpha_cutoff;
-            desc.DoubleSided = mat.double_sided;
+                Filesystem::Path path(modelDir.GetView());
+                path.Append(TextureImage(*baseColView.texture)->uri);
+                desc.BaseColorTexID = IDFromTexturePath(path);
+            }
+
+            auto& f = mat.pbr_metallic_roughness.base_color_factor;
+            desc.BaseColorFactor = float4(f[0], f[1], f[2], f[3]);
+        }
 
-            // Base Color map
+        // Normal map
+        {
+            const cgltf_texture_view& normalView = mat.normal_texture;
+            if (normalView.texture)
             {
-                const cgltf_texture_view& baseColView = mat.pbr_metallic_roughness.base_color_texture;
-                if (baseColView.texture)
-                {
-                    Check(baseColView.texture->image, "textureView doesn't point to any image.");
+                Check(TextureImage(*normalView.texture), "textureView doesn't point to any image.");
 
-                    Filesystem::Path path(modelDir.GetView());
-                    path.Append(baseColView.texture->image->uri);
-                    desc.BaseColorTexID = IDFromTexturePath(path);
-                }
+                Filesystem::Path path(modelDir.GetView());
+                path.Append(TextureImage(*normalView.texture)->uri);
+                desc.NormalTexID = IDFromTexturePath(path);
 
-                auto& f = mat.pbr_metallic_roughness.base_color_factor;
-                desc.BaseColorFactor = float4(f[0], f[1], f[2], f[3]);
+                desc.NormalScale = (float)mat.normal_texture.scale;
             }
+        }
 
-            // Normal map
+        // Metallic-Roughness map
+        {
+            const cgltf_texture_view& metallicRoughnessView = mat.pbr_metallic_roughness.metallic_roughness_texture;
+            if (metallicRoughnessView.texture)
             {
-                const cgltf_texture_view& normalView = mat.normal_texture;
-                if (normalView.texture)
-                {
-                    Check(normalView.texture->image, "textureView doesn't point to any image.");
+                Check(TextureImage(*metallicRoughnessView.texture), 
+                    "textureView doesn't point to any image.");
 
-                    Filesystem::Path path(modelDir.GetView());
-                    path.Append(normalView.texture->image->uri);
-                    desc.NormalTexID = IDFromTexturePath(path);
-
-                    desc.NormalScale = (float)mat.normal_texture.scale;
-                }
+                Filesystem::Path path(modelDir.GetView());
+                path.Append(TextureImage(*metallicRoughnessView.texture)->uri);
+                desc.MetallicRoughnessTexID = IDFromTexturePath(path);
             }
 
-            // Metallic-Roughness map
+            desc.MetallicFactor = (float)mat.pbr_metallic_roughness.metallic_factor;
+            desc.SpecularRoughnessFactor = (float)mat.pbr_metallic_roughness.roughness_factor;
+        }
+
+        // Emissive map
+        {
+            const cgltf_texture_view& emissiveView = mat.emissive_texture;
+            if (emissiveView.texture)
             {
-                const cgltf_texture_view& metallicRoughnessView = mat.pbr_metallic_roughness.metallic_roughness_texture;
-                if (metallicRoughnessView.texture)
-                {
-                    Check(metallicRoughnessView.texture->image, 
-                        "textureView doesn't point to any image.");
+                Check(TextureImage(*emissiveView.texture), "textureView doesn't point to any image.");
 
-                    Filesystem::Path path(modelDir.GetView());
-                    path.Append(metallicRoughnessView.texture->image->uri);
-                    desc.MetallicRoughnessTexID = IDFromTexturePath(path);
-                }
+                Filesystem::Path path(modelDir.GetView());
+                path.Append(TextureImage(*emissiveView.texture)->uri);
+                desc.EmissiveTexID = IDFromTexturePath(path);
+            }
+
+            auto& f = mat.emissive_factor;
+            desc.EmissiveFactor = float3((float)f[0], (float)f[1], (float)f[2]);
+
+            if (mat.has_emissive_strength)
+                desc.EmissiveStrength = mat.emissive_strength.emissive_strength;
+        }
 
-                desc.MetallicFactor = (float)mat.pbr_metallic_roughness.metallic_factor;
-                desc.SpecularRoughnessFactor = (float)mat.pbr_metallic_roughness.roughness_factor;
+        if (mat.has_ior)
+        {
+            if ((mat.ior.ior - 1.0f) < 1e-3f)
+            {
+                LOG_UI_WARNING("IOR value of %.3f for material %s is invalid.\n",
+                    mat.ior.ior, mat.name ? mat.name : "unnamed");
             }
 
-            // Emissive map
+            desc.SpecularIOR = mat.ior.ior;
+        }
+        if (mat.has_transmission)
+            desc.TransmissionWeight = mat.transmission.transmission_factor;
+        if (mat.has_clearcoat)
+        {
+            desc.CoatWeight = mat.clearcoat.clearcoat_factor;
+            desc.CoatRoughness = mat.clearcoat.clearcoat_roughness_factor;
+        }
+    }
+
+    void ProcessMaterials(uint32_t sceneID, const Filesystem::Path& modelDir, const cgltf_data& model,
+        int offset, int size, MutableSpan<Texture> ddsImages, SmallVector<glTF::Asset::MaterialDesc>& descs)
+    {
+        for (int m = offset; m != offset + size; m++)
+        {
+            glTF::Asset::MaterialDesc desc;
+            BuildMaterialDesc(sceneID, modelDir, model, m, desc);
+
+            // Other files might be loading concurrently
+            SceneCore& scene = App::GetScene();
+            scene.AddMaterial(desc, ddsImages, true);
+
+            // For hot reload
+            descs.push_back(desc);
+        }
+    }
+
+    // Records the DDS images that aren't being watched yet along with their last 
+    // write time
+    void WatchImages(const Filesystem::Path& modelDir, const cgltf_data& model, WatchedScene& ws)
+    {
+        for (size_t i = 0; i < model.images_count; i++)
+        {
+            const cgltf_image& image = model.images[i];
+            if (!image.uri)
+                continue;
+
+            Filesystem::Path path(modelDir.GetView());
+            path.Append(image.uri);
+
+            char ext[8];
+            path.Extension(ext);
+            if (strcmp(ext, "dds") != 0)
+                continue;
+
+            const Texture::ID_TYPE ID = IDFromTexturePath(path);
+            auto it = std::find_if(ws.Images.begin(), ws.Images.end(),
+                [ID](const WatchedImage& img) { return img.ID == ID; });
+            if (it != ws.Images.end())
+                continue;
+
+            ws.Images.push_back(WatchedImage{ .ID = ID,
+                .PathOffset = (uint32_t)ws.ImagePaths.size(),
+                .LastWriteTime = Filesystem::GetLastWriteTime(path.Get()) });
+            ws.ImagePaths.append_range(path.Get(), path.Get() + strlen(path.Get()) + 1);
+        }
+    }
+
+    bool SameMaterial(const glTF::Asset::MaterialDesc& a, const glTF::Asset::MaterialDesc& b)
+    {
+        auto eq3 = [](const float3& x, const float3& y) { return x.x == y.x && x.y == y.y && x.z == y.z; };
+
+        return a.BaseColorTexID == b.BaseColorTexID &&
+            a.MetallicRoughnessTexID == b.MetallicRoughnessTexID &&
+            a.NormalTexID == b.NormalTexID &&
+            a.EmissiveTexID == b.EmissiveTexID &&
+            a.BaseColorFactor.x == b.BaseColorFactor.x && a.BaseColorFactor.y == b.BaseColorFactor.y &&
+            a.BaseColorFactor.z == b.BaseColorFactor.z && a.BaseColorFactor.w == b.BaseColorFactor.w &&
+            a.MetallicFactor == b.MetallicFactor &&
+            a.SpecularRoughnessFactor == b.SpecularRoughnessFactor &&
+            a.SpecularIOR == b.SpecularIOR &&
+            a.TransmissionWeight == b.TransmissionWeight &&
+            eq3(a.TransmissionColor, b.TransmissionColor) &&
+            a.TransmissionDepth == b.TransmissionDepth &&
+            a.SubsurfaceWeight == b.SubsurfaceWeight &&
+            a.CoatWeight == b.CoatWeight &&
+            eq3(a.CoatColor, b.CoatColor) &&
+            a.CoatRoughness == b.CoatRoughness &&
+            a.CoatIOR == b.CoatIOR &&
+            a.EmissiveStrength == b.EmissiveStrength &&
+            eq3(a.EmissiveFactor, b.EmissiveFactor) &&
+            a.NormalScale == b.NormalScale &&
+            a.AlphaCutoff == b.AlphaCutoff &&
+            a.AlphaMode == b.AlphaMode &&
+            a.DoubleSided == b.DoubleSided;
+    }
+
+    struct ModifiedTexture
+    {
+        Scene::Internal::TextureStreamer::TextureDesc Desc;
+        // Offset into HotReloadResult::Paths
+        uint32_t PathOffset;
+    };
+
+    // Produced by the background reload task and applied on the main thread
+    struct HotReloadResult
+    {
+        SmallVector<glTF::Asset::MaterialDesc> Materials;
+        // Textures that changed materials reference for the first time
+        SmallVector<Texture> Textures;
+        SmallVector<ModifiedTexture> ModifiedTextures;
+        SmallVector<char> Paths;
+    };
+
+    struct HotReloadState
+    {
+        // Editors usually write a file more than once when saving
+        static constexpr double DEBOUNCE_SECONDS = 0.25;
+
+        // Loads register their scenes from the background threads
+        SmallVector<WatchedScene*> Scenes;
+        SRWLOCK Lock = SRWLOCK_INIT;
+        HotReloadResult Result;
+        double LastChangeTime = 0.0;
+        bool Enabled = false;
+        bool ChangePending = false;
+        bool InFlight = false;
+        std::atomic_bool ResultReady = false;
+    };
+
+    HotReloadState g_hotReload;
+
+    void RegisterForHotReload(WatchedScene* ws)
+    {
+        AcquireSRWLockExclusive(&g_hotReload.Lock);
+        g_hotReload.Scenes.push_back(ws);
+        ReleaseSRWLockExclusive(&g_hotReload.Lock);
+    }
+
+    // Exporters often write out identical geometry as separate mesh primitives. Mesh 
+    // primitives whose vertices and indices match point to the same range of the vertex 
+    // and index buffers, so only one copy is kept. Mesh IDs (and materials) are unchanged, 
+    // thus instances don't need to know about this.
+    void DeduplicateMeshes(ThreadContext& tc)
+    {
+        const size_t numMeshes = tc.Meshes.size();
+        if (numMeshes < 2)
+            return;
+
+        SmallVector<uint64_t> hashes;
+        hashes.resize_uninitialized(numMeshes);
+
+        constexpr size_t MIN_MESHES_PER_CHUNK = 64;
+        App::ParallelFor(numMeshes, MIN_MESHES_PER_CHUNK, [&tc, &hashes](size_t begin, size_t end)
             {
-                const cgltf_texture_view& emissiveView = mat.emissive_texture;
-                if (emissiveView.texture)
+                for (size_t i = begin; i < end; i++)
                 {
-                    Check(emissiveView.texture->image, "textureView doesn't point to any image.");
-
-                    Filesystem::Path path(modelDir.GetView());
-                    path.Append(emissiveView.texture->image->uri);
-                    desc.EmissiveTexID = IDFromTexturePath(path);
+                    const Mesh& m = tc.Meshes[i];
+                    const uint64_t vtxHash = XXH3_64bits(tc.Vertices.data() + m.BaseVtxOffset, 
+                        m.NumVertices * sizeof(Vertex));
+                    hashes[i] = XXH3_64bits_withSeed(tc.Indices.data() + m.BaseIdxOffset,
+                        m.NumIndices * sizeof(uint32_t), vtxHash);
                 }
+            });
+
+        auto sameGeometry = [&tc](const Mesh& lhs, const Mesh& rhs)
+            {
+                return lhs.NumVertices == rhs.NumVertices && lhs.NumIndices == rhs.NumIndices &&
+                    memcmp(tc.Vertices.data() + lhs.BaseVtxOffset, tc.Vertices.data() + rhs.BaseVtxOffset,
+                        lhs.NumVertices * sizeof(Vertex)) == 0 &&
+                    memcmp(tc.Indices.data() + lhs.BaseIdxOffset, tc.Indices.data() + rhs.BaseIdxOffset,
+                        lhs.NumIndices * sizeof(uint32_t)) == 0;
+            };
 
-                auto& f = mat.emissive_factor;
-                desc.EmissiveFactor = float3((float)f[0], (float)f[1], (float)f[2]);
+        // Content hash -> index of the first mesh primitive with that geometry
+        HashTable<uint32_t> unique;
+        unique.resize(numMeshes, true);
+        // Index of mesh primitive that owns the geometry for each mesh primitive
+        SmallVector<uint32_t> canonical;
+        canonical.resize_uninitialized(numMeshes);
+        size_t numUniqueVertices = 0;
+        size_t numUniqueIndices = 0;
 
-                if (mat.has_emissive_strength)
-                    desc.EmissiveStrength = mat.emissive_strength.emissive_strength;
-            }
+        for (uint32_t i = 0; i < (uint32_t)numMeshes; i++)
+        {
+            const Mesh& m = tc.Meshes[i];
+            canonical[i] = i;
 
-            if (mat.has_ior)
+            // Hash collisions (rare) keep their own copy
+            if (!unique.try_emplace(hashes[i], i))
             {
-                if ((mat.ior.ior - 1.0f) < 1e-3f)
+                const uint32_t first = *unique.find(hashes[i]).value();
+                if (sameGeometry(tc.Meshes[first], m))
                 {
-                    LOG_UI_WARNING("IOR value of %.3f for material %s is invalid.\n",
-                        mat.ior.ior, mat.name ? mat.name : "unnamed");
+                    canonical[i] = first;
+                    continue;
                 }
-
-                desc.SpecularIOR = mat.ior.ior;
             }
-            if (mat.has_transmission)
-                desc.TransmissionWeight = mat.transmission.transmission_factor;
-            if (mat.has_clearcoat)
+
+            numUniqueVertices += m.NumVertices;
+            numUniqueIndices += m.NumIndices;
+        }
+
+        if (numUniqueVertices == tc.Vertices.size())
+            return;
+
+        // Compact the vertex and index buffers. Canonical mesh primitive always comes first.
+        SmallVector<Vertex> vertices;
+        SmallVector<uint32_t> indices;
+        vertices.resize_uninitialized(numUniqueVertices);
+        indices.resize_uninitialized(numUniqueIndices);
+        uint32_t currVtxOffset = 0;
+        uint32_t currIdxOffset = 0;
+        int numDuplicates = 0;
+
+        // Mesh ID -> mesh primitive index, for patching the emissive mesh primitives
+        HashTable<uint32_t> meshIDToIdx;
+        meshIDToIdx.resize(numMeshes, true);
+
+        for (uint32_t i = 0; i < (uint32_t)numMeshes; i++)
+        {
+            Mesh& m = tc.Meshes[i];
+            meshIDToIdx.try_emplace(Scene::MeshID(m.SceneID, m.MeshIdx, m.MeshPrimIdx), i);
+
+            if (canonical[i] != i)
             {
-                desc.CoatWeight = mat.clearcoat.clearcoat_factor;
-                desc.CoatRoughness = mat.clearcoat.clearcoat_roughness_factor;
+                const Mesh& c = tc.Meshes[canonical[i]];
+                m.BaseVtxOffset = c.BaseVtxOffset;
+                m.BaseIdxOffset = c.BaseIdxOffset;
+                numDuplicates++;
+
+                continue;
             }
 
-            SceneCore& scene = App::GetScene();
-            scene.AddMaterial(desc, ddsImages, false);
+            memcpy(vertices.data() + currVtxOffset, tc.Vertices.data() + m.BaseVtxOffset,
+                m.NumVertices * sizeof(Vertex));
+            memcpy(indices.data() + currIdxOffset, tc.Indices.data() + m.BaseIdxOffset,
+                m.NumIndices * sizeof(uint32_t));
+
+            m.BaseVtxOffset = currVtxOffset;
+            m.BaseIdxOffset = currIdxOffset;
+            currVtxOffset += m.NumVertices;
+            currIdxOffset += m.NumIndices;
+        }
+
+        for (auto& e : tc.EmissiveMeshPrims)
+        {
+            if (e.MeshID == Scene::INVALID_MESH)
+                continue;
+
+            const Mesh& m = tc.Meshes[*meshIDToIdx.find(e.MeshID).value()];
+            e.BaseVtxOffset = m.BaseVtxOffset;
+            e.BaseIdxOffset = m.BaseIdxOffset;
         }
+
+        LOG_UI_INFO("glTF: %d duplicate mesh primitives, removed %llu vertices and %llu indices.",
+            numDuplicates, tc.Vertices.size() - numUniqueVertices, tc.Indices.size() - numUniqueIndices);
+
+        tc.Vertices = ZetaMove(vertices);
+        tc.Indices = ZetaMove(indices);
     }
 
     void NumEmissiveInstancesAndTrianglesSubtree(const cgltf_node& node, ThreadContext& context)
@@ -730,7 +1334,8 @@ namespace
                                 .InstanceID = currInstanceID,
                                 .BaseTriOffset = currGlobalTriIdx,
                                 .NumTriangles = meshPrimInfo.NumIndices / 3,
-                                .MaterialIdx = meshPrimInfo.MaterialIdx + 1
+                                // Unique across scenes
+                                .MaterialIdx = (int)matID
                             };
 
                         uint32_t currMeshTriIdx = 0;
@@ -782,7 +1387,7 @@ namespace
     }
 
     void ProcessNodeSubtree(const cgltf_node& node, uint32_t sceneID, const cgltf_data& model,
-        uint64_t parentId)
+        uint64_t parentId, SmallVector<InstanceDesc>& instances)
     {
         uint64_t currInstanceID = SceneCore::ROOT_ID;
 
@@ -921,8 +1526,7 @@ namespace
                     .RtInstanceMask = rtInsMask,
                     .IsOpaque = isOpaque };
 
-                SceneCore& scene = App::GetScene();
-                scene.AddInstance(desc, false);
+                instances.push_back(desc);
             }
         }
         else
@@ -940,23 +1544,23 @@ namespace
                     .RtInstanceMask = RT_AS_SUBGROUP::NON_EMISSIVE,
                     .IsOpaque = true };
 
-            SceneCore& scene = App::GetScene();
-            scene.AddInstance(desc, false);
+            instances.push_back(desc);
         }
 
         for (int c = 0; c < node.children_count; c++)
         {
             const cgltf_node& childNode = *node.children[c];
-            ProcessNodeSubtree(childNode, sceneID, model, currInstanceID);
+            ProcessNodeSubtree(childNode, sceneID, model, currInstanceID, instances);
         }
     }
 
-    void ProcessNodes(const cgltf_data& model, uint32_t sceneID)
+    // Instances are added to the scene when the load is committed
+    void ProcessNodes(const cgltf_data& model, uint32_t sceneID, SmallVector<InstanceDesc>& instances)
     {
         for (size_t i = 0; i < model.scene->nodes_count; i++)
         {
             const cgltf_node& node = *model.scene->nodes[i];
-            ProcessNodeSubtree(node, sceneID, model, SceneCore::ROOT_ID);
+            ProcessNodeSubtree(node, sceneID, model, SceneCore::ROOT_ID, instances);
         }
     }
 
@@ -1058,213 +1662,881 @@ namespace
     }
 }
 
-void glTF::Load(const App::Filesystem::Path& pathToglTF)
+namespace
 {
-    // Parse json
-    cgltf_options options{};
-    cgltf_data* model = nullptr;
-    Checkgltf(cgltf_parse_file(&options, pathToglTF.GetView().data(), &model));
-
-    // Load buffers
-    Check(model->buffers_count == 1, "Invalid number of buffers.");
-    Filesystem::Path bufferPath(pathToglTF.GetView());
-    bufferPath.Directory();
-    bufferPath.Append(model->buffers[0].uri);
-    Checkgltf(cgltf_load_buffers(&options, model, bufferPath.Get()));
-
-    Check(model->scene, "glTF model doesn't have a default scene: %s.", pathToglTF.GetView());
-    const uint32_t sceneID = XXH3_64_To_32(XXH3_64bits(pathToglTF.GetView().data(), pathToglTF.Length()));
-    SceneCore& scene = App::GetScene();
-
-    // Figure out total number of vertices and indices
-    size_t totalNumVertices;
-    size_t totalNumIndices;
-    size_t totalNumMeshPrims;
-    TotalNumVerticesAndIndices(model, totalNumVertices, totalNumIndices, totalNumMeshPrims);
-
-    // Height of the node hierarchy
-    const int height = ComputeNodeHierarchyHeight(*model);
+    constexpr size_t MAX_NUM_MESH_WORKERS = 4;
     constexpr int DEFAULT_NUM_LEVELS = 10;
-    SmallVector<int, SystemAllocator, DEFAULT_NUM_LEVELS> levels;
-    levels.resize(height, 0);
 
-    // Precompute number of nodes per level
-    PrecomputeNodeHierarchy(*model, levels);
-
-    size_t total = 0;
-    for (size_t i = 0; i < levels.size(); i++)
-        total += levels[i];
+    // State of loading one glTF file. Every file builds its data privately, which is 
+    // committed to the scene in one batch after all the files have been processed.
+    struct SceneLoad
+    {
+        explicit SceneLoad(StrView path)
+            : Path(path)
+        {}
+
+        Filesystem::Path Path;
+        cgltf_options Options{};
+        ThreadContext TC;
+        Filesystem::Path SceneCachePath;
+        // Sections of the scene cache, read straight into the ThreadContext arrays
+        Filesystem::ReadRequest SceneCacheReads[4];
+        Filesystem::ReadBatch SceneCacheBatch;
+        uint64_t CacheKey;
+        bool CacheHit;
+        uint32_t SceneID;
 
-    // Preallocate
-    scene.ResizeAdditionalMaterials((uint32_t)model->materials_count);
-    scene.ReserveInstances(levels, total);
+        // Number of nodes per level of the node hierarchy
+        SmallVector<int, SystemAllocator, DEFAULT_NUM_LEVELS> Levels;
+        size_t NumInstances;
 
-    // How many meshes are processed by each worker
-    constexpr size_t MAX_NUM_MESH_WORKERS = 4;
-    constexpr size_t MIN_MESHES_PER_WORKER = 20;
-    size_t meshWorkerOffset[MAX_NUM_MESH_WORKERS];
-    size_t meshWorkerCount[MAX_NUM_MESH_WORKERS];
-    uint32_t workerEmissiveCount[MAX_NUM_MESH_WORKERS];
-
-    const int numMeshWorkers = (int)SubdivideRangeWithMin(model->meshes_count,
-        MAX_NUM_MESH_WORKERS,
-        meshWorkerOffset,
-        meshWorkerCount,
-        MIN_MESHES_PER_WORKER);
-
-    // How many images are processed by each worker
-    constexpr size_t MAX_NUM_IMAGE_WORKERS = 5;
-    constexpr size_t MIN_IMAGES_PER_WORKER = 15;
-    size_t imgWorkerOffset[MAX_NUM_IMAGE_WORKERS];
-    size_t imgWorkerCount[MAX_NUM_IMAGE_WORKERS];
-
-    const int numImgWorkers = (int)SubdivideRangeWithMin(model->images_count,
-        MAX_NUM_IMAGE_WORKERS,
-        imgWorkerOffset,
-        imgWorkerCount,
-        MIN_IMAGES_PER_WORKER);
-
-    ThreadContext tc;
-    tc.glTFPath = &pathToglTF;
-    tc.SceneID = sceneID;
-    tc.Model = model;
-    tc.NumMeshWorkers = numMeshWorkers;
-    tc.NumImgWorkers = numImgWorkers;
-    tc.MeshThreadOffsets = meshWorkerOffset;
-    tc.MeshThreadSizes = meshWorkerCount;
-    tc.ImgThreadOffsets = imgWorkerOffset;
-    tc.ImgThreadSizes = imgWorkerCount;
-    tc.EmissiveMeshPrimCountPerWorker = workerEmissiveCount;
-
-    // Preallocate
-    tc.Vertices.resize(totalNumVertices);
-    tc.Indices.resize(totalNumIndices);
-    tc.Meshes.resize(totalNumMeshPrims);
-    tc.DDSImages.resize(model->images_count);
-    tc.EmissiveMeshPrims.resize(totalNumMeshPrims);
-    ResetEmissiveSubsets(tc.EmissiveMeshPrims);
-
-    TaskSet ts;
-
-    auto procEmissiveMeshPrims = ts.EmplaceTask("gltf::EmissivePrims", [&tc]()
-        {
-            // EmissiveMeshPrimCountPerWorker is filled in by mesh workers
-            for (int i = 0; i < tc.NumMeshWorkers; i++)
-                tc.NumEmissiveMeshPrims += tc.EmissiveMeshPrimCountPerWorker[i];
-
-            // For binary search. Also, since non-emissive meshes were assigned the INVALID
-            // ID (= UINT64_MAX), this also partitions the non-null entries before the null
-            // entries.
-            std::sort(tc.EmissiveMeshPrims.begin(), tc.EmissiveMeshPrims.end(),
-                [](const EmissiveMeshPrim& lhs, const EmissiveMeshPrim& rhs)
-                {
-                    return lhs.MeshID < rhs.MeshID;
-                });
+        // How many meshes are processed by each worker
+        size_t MeshWorkerOffset[MAX_NUM_MESH_WORKERS];
+        size_t MeshWorkerCount[MAX_NUM_MESH_WORKERS];
+        uint32_t WorkerEmissiveCount[MAX_NUM_MESH_WORKERS];
 
-            // In order to do only one allocation, number of emissive mesh primitives was assumed
-            // to be the worst case -- total number of mesh primitives. As such, there may be a number 
-            // of "null" entries in the EmissiveMeshPrims. Now that the actual size is known, adjust 
-            // the size accordingly.
-            //tc.EmissiveMeshPrims = MutableSpan(tc.EmissiveMeshPrims.data(), tc.NumEmissiveMeshPrims);
-            tc.EmissiveMeshPrims.resize(tc.NumEmissiveMeshPrims);
-            NumEmissiveInstancesAndTriangles(tc);
-        });
+        WaitObject WaitObj;
+    };
 
-    for (int i = 0; i < tc.NumMeshWorkers; i++)
+    // Starts reading the glTF buffer, which is split into multiple reads that are in 
+    // flight together. Returns an invalid batch for embedded buffers, which are decoded 
+    // right away. Buffer is freed by cgltf_free().
+    Filesystem::ReadBatch LoadBuffers(SceneLoad& load, cgltf_data* model, const Filesystem::Path& bufferPath,
+        Filesystem::ReadRequest& request)
     {
-        StackStr(tname, n, "gltf::Mesh_%d", i);
+        cgltf_buffer& buffer = model->buffers[0];
 
-        auto procMesh = ts.EmplaceTask(tname, [&tc, workerIdx = i]()
-            {
-                ProcessMeshes(*tc.Model, tc.SceneID, tc.MeshThreadOffsets[workerIdx],
-                    tc.MeshThreadSizes[workerIdx],
-                    tc.Vertices, tc.CurrVtxOffset,
-                    tc.Indices, tc.CurrIdxOffset,
-                    tc.Meshes, tc.CurrMeshPrimOffset,
-                    tc.EmissiveMeshPrims, 
-                    tc.EmissiveMeshPrimCountPerWorker[workerIdx]);
-            });
+        // Embedded (base64) buffers are decoded by cgltf
+        if (!buffer.uri || strncmp(buffer.uri, "data:", 5) == 0)
+        {
+            Checkgltf(cgltf_load_buffers(&load.Options, model, bufferPath.Get()));
+            return Filesystem::ReadBatch();
+        }
 
-        ts.AddOutgoingEdge(procMesh, procEmissiveMeshPrims);
+        const size_t fileSize = Filesystem::GetFileSize(bufferPath.Get());
+        Check(fileSize != size_t(-1), "glTF buffer %s was not found.", bufferPath.Get());
+        Check(fileSize >= buffer.size, "glTF buffer %s is smaller than its declared size.",
+            bufferPath.Get());
+
+        // Same allocator that cgltf_load_buffers() would use
+        buffer.data = model->memory.alloc_func(model->memory.user_data, buffer.size);
+        Check(buffer.data, "Allocating %llu bytes for glTF buffer %s failed.", buffer.size, 
+            bufferPath.Get());
+        buffer.data_free_method = cgltf_data_free_method_memory_free;
+
+        request = Filesystem::ReadRequest{ .Path = bufferPath.Get(),
+            .Dst = buffer.data,
+            .Offset = 0,
+            .Size = buffer.size };
+
+        return Filesystem::SubmitReads(MutableSpan(&request, 1));
     }
 
-    auto procMats = ts.EmplaceTask("gltf::Materials", [&tc]()
+    // Decodes EXT_meshopt_compression buffer views. Decoded data is owned by the buffer 
+    // view and freed by cgltf_free().
+    void DecodeMeshoptBufferViews(cgltf_data* model)
+    {
+        SmallVector<cgltf_buffer_view*, SystemAllocator, 32> views;
+
+        for (size_t i = 0; i < model->buffer_views_count; i++)
         {
-            // For binary search
-            std::sort(tc.DDSImages.begin(), tc.DDSImages.end(),
-                [](const Texture& lhs, const Texture& rhs)
+            if (model->buffer_views[i].has_meshopt_compression)
+                views.push_back(&model->buffer_views[i]);
+        }
+
+        if (views.empty())
+            return;
+
+        constexpr size_t MIN_VIEWS_PER_CHUNK = 4;
+        App::ParallelFor(views.size(), MIN_VIEWS_PER_CHUNK, [&views](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
                 {
-                    return lhs.ID() < rhs.ID();
-                });
+                    cgltf_buffer_view& view = *views[i];
+                    const cgltf_meshopt_compression& mc = view.meshopt_compression;
+                    Check(mc.buffer->data, "Buffer for meshopt-compressed view hasn't been loaded.");
 
-            Filesystem::Path parent(tc.glTFPath->GetView());
-            parent.ToParent();
+                    const uint8_t* src = reinterpret_cast<const uint8_t*>(mc.buffer->data) + mc.offset;
+                    void* dst = malloc(mc.count * mc.stride);
+                    Check(dst, "Out of memory.");
+                    int res = -1;
 
-            ProcessMaterials(tc.SceneID, parent, *tc.Model, 0, (int)tc.Model->materials_count, 
-                tc.DDSImages);
-        });
+                    switch (mc.mode)
+                    {
+                    case cgltf_meshopt_compression_mode_attributes:
+                        res = meshopt_decodeVertexBuffer(dst, mc.count, mc.stride, src, mc.size);
+                        break;
+                    case cgltf_meshopt_compression_mode_triangles:
+                        res = meshopt_decodeIndexBuffer(dst, mc.count, mc.stride, src, mc.size);
+                        break;
+                    case cgltf_meshopt_compression_mode_indices:
+                        res = meshopt_decodeIndexSequence(dst, mc.count, mc.stride, src, mc.size);
+                        break;
+                    default:
+                        break;
+                    }
+
+                    Check(res == 0, "Decoding meshopt-compressed buffer view failed (error code: %d).", res);
+
+                    switch (mc.filter)
+                    {
+                    case cgltf_meshopt_compression_filter_octahedral:
+                        meshopt_decodeFilterOct(dst, mc.count, mc.stride);
+                        break;
+                    case cgltf_meshopt_compression_filter_quaternion:
+                        meshopt_decodeFilterQuat(dst, mc.count, mc.stride);
+                        break;
+                    case cgltf_meshopt_compression_filter_exponential:
+                        meshopt_decodeFilterExp(dst, mc.count, mc.stride);
+                        break;
+                    default:
+                        break;
+                    }
+
+                    view.data = dst;
+                }
+            });
+    }
+
+    // Parses the json and sets up everything the loading tasks need, also loads the 
+    // glTF buffers when they're needed. Doesn't modify the scene.
+    void ParseScene(SceneLoad& load)
+    {
+        ZETA_CPU_EVENT_SCOPE("glTF::Parse %s", load.Path.GetView().data());
+
+        // Taken before reading, so that changes made during loading are picked up by 
+        // hot reload
+        const uint64_t glTFWriteTime = Filesystem::GetLastWriteTime(load.Path.Get());
+
+        // Parse json
+        cgltf_data* model = nullptr;
+        Checkgltf(glTF::ParseFile(load.Options, load.Path.GetView().data(), &model));
+
+        // Other than the main buffer, only meshopt fallback buffers (no uri, never 
+        // read) are allowed
+        Check(model->buffers_count >= 1, "Invalid number of buffers.");
+        for (size_t i = 1; i < model->buffers_count; i++)
+            Check(!model->buffers[i].uri, "Invalid number of buffers.");
+
+        Filesystem::Path bufferPath(load.Path.GetView());
+        bufferPath.Directory();
+        bufferPath.Append(model->buffers[0].uri);
+
+        Check(model->scene, "glTF model doesn't have a default scene: %s.", load.Path.GetView());
+        load.SceneID = XXH3_64_To_32(XXH3_64bits(load.Path.GetView().data(), load.Path.Length()));
+
+        // Figure out total number of vertices and indices
+        size_t totalNumVertices;
+        size_t totalNumIndices;
+        size_t totalNumMeshPrims;
+        TotalNumVerticesAndIndices(model, totalNumVertices, totalNumIndices, totalNumMeshPrims);
+
+        // Buffers are only needed for mesh processing, which is skipped when the scene 
+        // cache is valid
+        load.CacheKey = SceneCacheKey(load.Path, bufferPath);
+        SceneCachePath(load.CacheKey, load.SceneCachePath);
+        SceneCacheHeader cacheHeader;
+        load.CacheHit = ReadSceneCacheHeader(load.SceneCachePath, load.CacheKey, totalNumVertices, 
+            totalNumIndices, totalNumMeshPrims, cacheHeader);
+
+        // Node hierarchy is processed while the buffer is being read
+        Filesystem::ReadRequest bufferRead;
+        Filesystem::ReadBatch bufferBatch;
+        if (!load.CacheHit)
+            bufferBatch = LoadBuffers(load, model, bufferPath, bufferRead);
+
+        // Height of the node hierarchy
+        const int height = ComputeNodeHierarchyHeight(*model);
+        load.Levels.resize(height, 0);
+
+        // Precompute number of nodes per level
+        PrecomputeNodeHierarchy(*model, load.Levels);
+
+        load.NumInstances = 0;
+        for (size_t i = 0; i < load.Levels.size(); i++)
+            load.NumInstances += load.Levels[i];
+
+        if (!load.CacheHit)
+        {
+            ZETA_CPU_EVENT_SCOPE("glTF::LoadBuffers");
+            Check(Filesystem::Wait(bufferBatch), "Reading glTF buffer %s failed.", bufferPath.Get());
+            DecodeMeshoptBufferViews(model);
+        }
+
+        constexpr size_t MIN_MESHES_PER_WORKER = 20;
+        const int numMeshWorkers = (int)SubdivideRangeWithMin(model->meshes_count,
+            MAX_NUM_MESH_WORKERS,
+            load.MeshWorkerOffset,
+            load.MeshWorkerCount,
+            MIN_MESHES_PER_WORKER);
+
+        ThreadContext& tc = load.TC;
+        tc.glTFPath = &load.Path;
+        tc.SceneID = load.SceneID;
+        tc.Model = model;
+        tc.NumMeshWorkers = load.CacheHit ? 0 : numMeshWorkers;
+        tc.MeshThreadOffsets = load.MeshWorkerOffset;
+        tc.MeshThreadSizes = load.MeshWorkerCount;
+        tc.EmissiveMeshPrimCountPerWorker = load.WorkerEmissiveCount;
+
+        tc.Watched = new WatchedScene(load.Path.GetView());
+        tc.Watched->BufferPath.Reset(bufferPath.GetView());
+        tc.Watched->SceneID = load.SceneID;
+        tc.Watched->LastWriteTime = glTFWriteTime;
+        tc.Watched->BufferLastWriteTime = Filesystem::GetLastWriteTime(bufferPath.Get());
+        tc.Watched->NumMeshes = model->meshes_count;
 
-    for (int i = 0; i < numImgWorkers; i++)
+        {
+            Filesystem::Path modelDir(load.Path.GetView());
+            modelDir.ToParent();
+            WatchImages(modelDir, *model, *tc.Watched);
+        }
+
+        // Preallocate
+        // Filled in by the mesh workers
+        tc.Meshes.resize(totalNumMeshPrims);
+        tc.DDSImages.resize(model->images_count);
+        tc.Instances.reserve(load.NumInstances);
+
+        if (load.CacheHit)
+        {
+            const auto& header = cacheHeader;
+            // Sizes after deduplication
+            tc.Vertices.resize_uninitialized(header.NumVertices);
+            tc.Indices.resize_uninitialized(header.NumIndices);
+            tc.NumEmissiveMeshPrims = (int)header.NumEmissiveMeshPrims;
+            tc.EmissiveMeshPrims.resize_uninitialized(header.NumEmissiveMeshPrims);
+
+            // Completes while the other loading tasks run, see gltf::SceneCache
+            const char* path = load.SceneCachePath.Get();
+            load.SceneCacheReads[0] = Filesystem::ReadRequest{ .Path = path, 
+                .Dst = tc.Vertices.data(), 
+                .Offset = header.VerticesOffset, 
+                .Size = header.NumVertices * sizeof(Vertex) };
+            load.SceneCacheReads[1] = Filesystem::ReadRequest{ .Path = path, 
+                .Dst = tc.Indices.data(), 
+                .Offset = header.IndicesOffset, 
+                .Size = header.NumIndices * sizeof(uint32_t) };
+            load.SceneCacheReads[2] = Filesystem::ReadRequest{ .Path = path, 
+                .Dst = tc.Meshes.data(), 
+                .Offset = header.MeshesOffset, 
+                .Size = header.NumMeshes * sizeof(Mesh) };
+            load.SceneCacheReads[3] = Filesystem::ReadRequest{ .Path = path, 
+                .Dst = tc.EmissiveMeshPrims.data(), 
+                .Offset = header.EmissiveMeshPrimsOffset, 
+                .Size = header.NumEmissiveMeshPrims * sizeof(EmissiveMeshPrim) };
+
+            load.SceneCacheBatch = Filesystem::SubmitReads(load.SceneCacheReads);
+        }
+        else
+        {
+            tc.Vertices.resize_uninitialized(totalNumVertices);
+            tc.Indices.resize_uninitialized(totalNumIndices);
+            tc.EmissiveMeshPrims.resize(totalNumMeshPrims);
+            ResetEmissiveSubsets(tc.EmissiveMeshPrims);
+        }
+    }
+
+    // Submits the loading tasks for given file, load.WaitObj is notified when they're done
+    void SubmitScene(SceneLoad& load, TextureUploadRing* uploadRing)
     {
-        StackStr(tname, n, "gltf::Img_%d", i);
+        ZETA_CPU_EVENT_SCOPE("glTF::Submit");
+
+        ThreadContext& tc = load.TC;
+        tc.UploadRing = uploadRing;
+        const bool cacheHit = load.CacheHit;
+        TaskSet ts;
 
-        // Loads dds textures from disk and upload them to GPU
-        auto h = ts.EmplaceTask(tname, [&tc, workerIdx = i]()
+        auto procEmissiveMeshPrims = ts.EmplaceTask("gltf::EmissivePrims", [&tc]()
             {
+                // EmissiveMeshPrimCountPerWorker is filled in by mesh workers
+                for (int i = 0; i < tc.NumMeshWorkers; i++)
+                    tc.NumEmissiveMeshPrims += tc.EmissiveMeshPrimCountPerWorker[i];
+
+                // For binary search. Also, since non-emissive meshes were assigned the INVALID
+                // ID (= UINT64_MAX), this also partitions the non-null entries before the null
+                // entries.
+                std::sort(tc.EmissiveMeshPrims.begin(), tc.EmissiveMeshPrims.end(),
+                    [](const EmissiveMeshPrim& lhs, const EmissiveMeshPrim& rhs)
+                    {
+                        return lhs.MeshID < rhs.MeshID;
+                    });
+
+                // In order to do only one allocation, number of emissive mesh primitives was assumed
+                // to be the worst case -- total number of mesh primitives. As such, there may be a number 
+                // of "null" entries in the EmissiveMeshPrims. Now that the actual size is known, adjust 
+                // the size accordingly.
+                //tc.EmissiveMeshPrims = MutableSpan(tc.EmissiveMeshPrims.data(), tc.NumEmissiveMeshPrims);
+                tc.EmissiveMeshPrims.resize(tc.NumEmissiveMeshPrims);
+                NumEmissiveInstancesAndTriangles(tc);
+            });
+
+        TaskSet::TaskHandle dedupMeshes = TaskSet::INVALID_TASK_HANDLE;
+
+        // Cached meshes were already deduplicated
+        if (!cacheHit)
+        {
+            dedupMeshes = ts.EmplaceTask("gltf::DedupMeshes", [&tc]()
+                {
+                    DeduplicateMeshes(tc);
+                });
+
+            ts.AddOutgoingEdge(dedupMeshes, procEmissiveMeshPrims);
+        }
+
+        for (int i = 0; i < tc.NumMeshWorkers; i++)
+        {
+            StackStr(tname, n, "gltf::Mesh_%d", i);
+
+            auto procMesh = ts.EmplaceTask(tname, [&tc, workerIdx = i]()
+                {
+                    ProcessMeshes(*tc.Model, tc.SceneID, tc.MeshThreadOffsets[workerIdx],
+                        tc.MeshThreadSizes[workerIdx],
+                        tc.Vertices, tc.CurrVtxOffset,
+                        tc.Indices, tc.CurrIdxOffset,
+                        tc.Meshes, tc.CurrMeshPrimOffset,
+                        tc.EmissiveMeshPrims, 
+                        tc.EmissiveMeshPrimCountPerWorker[workerIdx]);
+                });
+
+            ts.AddOutgoingEdge(procMesh, dedupMeshes);
+        }
+
+        if (cacheHit)
+        {
+            // Emissive mesh primitives were cached after sorting and resizing, so the sort 
+            // above becomes a no-op
+            auto readCache = ts.EmplaceTask("gltf::SceneCache", [&load]()
+                {
+                    // Reads were submitted by ParseScene()
+                    Check(Filesystem::Wait(load.SceneCacheBatch), "Reading scene cache %s failed.", 
+                        load.SceneCachePath.Get());
+                });
+
+            ts.AddOutgoingEdge(readCache, procEmissiveMeshPrims);
+        }
+        else
+        {
+            // Runs concurrently with emissive processing, which only reads the mesh buffers
+            auto writeCache = ts.EmplaceTask("gltf::WriteSceneCache", [&tc, cacheKey = load.CacheKey]()
+                {
+                    WriteSceneCache(cacheKey, tc.Vertices, tc.Indices, tc.Meshes, tc.EmissiveMeshPrims);
+                });
+
+            ts.AddOutgoingEdge(procEmissiveMeshPrims, writeCache);
+        }
+
+        auto procMats = ts.EmplaceTask("gltf::Materials", [&tc]()
+            {
+                // For binary search
+                std::sort(tc.DDSImages.begin(), tc.DDSImages.end(),
+                    [](const Texture& lhs, const Texture& rhs)
+                    {
+                        return lhs.ID() < rhs.ID();
+                    });
+
                 Filesystem::Path parent(tc.glTFPath->GetView());
                 parent.ToParent();
 
-                LoadDDSImages(tc.SceneID, parent, *tc.Model, tc.ImgThreadOffsets[workerIdx], 
-                    tc.ImgThreadSizes[workerIdx], tc.DDSImages);
+                ProcessMaterials(tc.SceneID, parent, *tc.Model, 0, (int)tc.Model->materials_count, 
+                    tc.DDSImages, tc.Watched->Materials);
             });
 
-        // Material processing should start after textures are loaded
-        ts.AddOutgoingEdge(h, procMats);
+        if (tc.Model->images_count)
+        {
+            // Loads dds textures from disk and upload them to GPU. Every chunk allocates 
+            // one texture heap, so chunks shouldn't be too small.
+            auto h = ts.EmplaceTask("gltf::Images", [&tc]()
+                {
+                    constexpr size_t MIN_IMAGES_PER_CHUNK = 4;
+
+                    Filesystem::Path parent(tc.glTFPath->GetView());
+                    parent.ToParent();
+
+                    App::ParallelFor(tc.Model->images_count, MIN_IMAGES_PER_CHUNK,
+                        [&tc, &parent](size_t begin, size_t end)
+                        {
+                            LoadDDSImages(tc.SceneID, parent, *tc.Model, begin, end - begin, 
+                                tc.DDSImages, *tc.UploadRing);
+                        });
+                });
+
+            // Material processing should start after textures are loaded
+            ts.AddOutgoingEdge(h, procMats);
+        }
+
+        // For each node with an emissive mesh primitive, add all of its triangles to 
+        // the emissives buffer
+        auto procEmissives = ts.EmplaceTask("gltf::Emissives", [&tc]()
+            {
+                tc.EmissiveInstances.resize(tc.NumEmissiveInstances);
+                tc.RTEmissives.resize(tc.NumEmissiveTris);
+
+                ProcessEmissives(tc);
+            });
+
+        // Processing emissives starts after materials are loaded and emissive primitives 
+        // have been processed
+        ts.AddOutgoingEdge(procEmissiveMeshPrims, procEmissives);
+        ts.AddOutgoingEdge(procMats, procEmissives);
+
+        ts.EmplaceTask("gltf::Nodes", [&tc]()
+            {
+                ProcessNodes(*tc.Model, tc.SceneID, tc.Instances);
+            });
+
+        auto last = ts.EmplaceTask("gltf::Final", [&tc]()
+            {
+                // Also frees the glTF buffer
+                cgltf_free(tc.Model);
+                tc.Model = nullptr;
+            });
+
+        // Final task has to run after all the other tasks
+        ts.AddIncomingEdgeFromAll(last);
+
+        ts.Sort();
+        ts.Finalize(&load.WaitObj);
+        App::Submit(ZetaMove(ts));
     }
 
-    // For each node with an emissive mesh primitive, add all of its triangles to 
-    // the emissives buffer
-    auto procEmissives = ts.EmplaceTask("gltf::Emissives", [&tc]()
+    // Transfers ownership of everything that was loaded to the scene
+    void CommitScene(SceneLoad& load)
+    {
+        ZETA_CPU_EVENT_SCOPE("glTF::Commit");
+
+        ThreadContext& tc = load.TC;
+        SceneCore& scene = App::GetScene();
+
+        for (auto& desc : tc.Instances)
+            scene.AddInstance(desc, true);
+
+        scene.AddMeshes(ZetaMove(tc.Meshes), ZetaMove(tc.Vertices), ZetaMove(tc.Indices), true);
+        scene.AddEmissives(ZetaMove(tc.EmissiveInstances), ZetaMove(tc.RTEmissives), true);
+
+        RegisterForHotReload(tc.Watched);
+        tc.Watched = nullptr;
+    }
+
+    void LoadScenes(Span<StrView> paths, bool helpOut)
+    {
+        ZETA_CPU_EVENT_SCOPE("glTF::Load");
+
+        SmallVector<SceneLoad*> loads;
+        loads.resize(paths.size());
+
+        for (size_t i = 0; i < paths.size(); i++)
+            loads[i] = new SceneLoad(paths[i]);
+
+        // Parsing and reading the glTF buffers from disk are independent for each file
+        App::ParallelFor(loads.size(), 1, [&loads](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                    ParseScene(*loads[i]);
+            });
+
+        // Preallocate for all the files at once, so that material and instance storage 
+        // doesn't need to grow while the files are loading
+        SceneCore& scene = App::GetScene();
+        SmallVector<int, SystemAllocator, DEFAULT_NUM_LEVELS> levels;
+        size_t totalNumInstances = 0;
+        uint32_t totalNumMaterials = 0;
+
+        for (auto* l : loads)
         {
-            tc.EmissiveInstances.resize(tc.NumEmissiveInstances);
-            tc.RTEmissives.resize(tc.NumEmissiveTris);
+            if (l->Levels.size() > levels.size())
+                levels.resize(l->Levels.size(), 0);
 
-            ProcessEmissives(tc);
+            for (size_t i = 0; i < l->Levels.size(); i++)
+                levels[i] += l->Levels[i];
 
-            // Transfer ownership of emissives
-            SceneCore& scene = App::GetScene();
-            scene.AddEmissives(ZetaMove(tc.EmissiveInstances), ZetaMove(tc.RTEmissives), false);
-        });
+            totalNumInstances += l->NumInstances;
+            totalNumMaterials += (uint32_t)l->TC.Model->materials_count;
+        }
+
+        scene.ResizeAdditionalMaterials(totalNumMaterials);
+        scene.ReserveInstances(levels, totalNumInstances);
+
+        // One upload ring for all the textures, which caps the upload memory regardless 
+        // of the number of files
+        TextureUploadRing* uploadRing = nullptr;
+        for (auto* l : loads)
+        {
+            if (l->TC.Model->images_count)
+            {
+                uploadRing = new TextureUploadRing(TEXTURE_UPLOAD_BUDGET_MB * 1024 * 1024);
+                break;
+            }
+        }
 
-    // Processing emissives starts after materials are loaded and emissive primitives 
-    // have been processed
-    ts.AddOutgoingEdge(procEmissiveMeshPrims, procEmissives);
-    ts.AddOutgoingEdge(procMats, procEmissives);
+        for (auto* l : loads)
+            SubmitScene(*l, uploadRing);
 
-    ts.EmplaceTask("gltf::Nodes", [&tc]()
+        // Help out with unfinished tasks. Note: This thread might help
+        // with tasks that are not related to loading glTF.
         {
-            ProcessNodes(*tc.Model, tc.SceneID);
+            ZETA_CPU_EVENT_SCOPE("glTF::Wait");
+
+            if (helpOut)
+                App::FlushWorkerThreadPool();
+
+            for (auto* l : loads)
+                l->WaitObj.Wait();
+        }
+
+        delete uploadRing;
+
+        // One batched commit for all the files
+        for (auto* l : loads)
+        {
+            CommitScene(*l);
+            delete l;
+        }
+    }
+}
+
+void glTF::Load(const App::Filesystem::Path& pathToglTF, bool async)
+{
+    const StrView path = pathToglTF.GetView();
+    Load(Span(&path, 1), async);
+}
+
+void glTF::Load(Span<StrView> paths, bool async)
+{
+    if (paths.empty())
+        return;
+
+    if (!async)
+    {
+        LoadScenes(paths, true);
+        return;
+    }
+
+    App::GetScene().BeginLoad();
+
+    // Caller's paths might not outlive the load
+    auto* pathStorage = new SmallVector<Filesystem::Path*>;
+    pathStorage->resize(paths.size());
+
+    for (size_t i = 0; i < paths.size(); i++)
+        (*pathStorage)[i] = new Filesystem::Path(paths[i]);
+
+    // Waits on a background thread while the loading tasks run on the worker threads 
+    // alongside the frame tasks
+    Task t("glTF::LoadAsync", TASK_PRIORITY::BACKGROUND, [pathStorage]()
+        {
+            DeltaTimer timer;
+            timer.Start();
+
+            SmallVector<StrView> views;
+            views.reserve(pathStorage->size());
+
+            for (auto* p : *pathStorage)
+                views.push_back(p->GetView());
+
+            LoadScenes(views, false);
+
+            timer.End();
+            LOG_UI_INFO("%u glTF scene(s) loaded in %u[ms].", (uint32_t)views.size(), 
+                (uint32_t)timer.DeltaMilli());
+
+            for (auto* p : *pathStorage)
+                delete p;
+
+            delete pathStorage;
+            App::GetScene().EndLoad();
         });
 
-    auto last = ts.EmplaceTask("gltf::Final", [&tc]()
+    App::SubmitBackground(ZetaMove(t));
+}
+
+//--------------------------------------------------------------------------------------
+// HotReload
+//--------------------------------------------------------------------------------------
+
+namespace
+{
+    // Loads a newly referenced texture in full. Textures that turn out to be already in 
+    // the descriptor tables are discarded by SceneCore::ReloadMaterial().
+    void LoadReferencedTexture(const Filesystem::Path& modelDir, const cgltf_data& model,
+        Texture::ID_TYPE ID, HotReloadResult& r)
+    {
+        for (auto& t : r.Textures)
         {
-            // Transfer ownership of mesh buffers
-            SceneCore& scene = App::GetScene();
-            scene.AddMeshes(ZetaMove(tc.Meshes), ZetaMove(tc.Vertices), ZetaMove(tc.Indices), false);
+            if (t.ID() == ID)
+                return;
+        }
+
+        for (size_t i = 0; i < model.images_count; i++)
+        {
+            if (!model.images[i].uri)
+                continue;
+
+            Filesystem::Path path(modelDir.GetView());
+            path.Append(model.images[i].uri);
+            if (IDFromTexturePath(path) != ID)
+                continue;
+
+            Texture tex;
+            auto err = GpuMemory::GetTexture2DFromDisk(path.Get(), ID, tex);
+            if (err != LOAD_DDS_RESULT::SUCCESS)
+            {
+                LOG_UI_WARNING("Hot reload: loading texture %s failed: %d.\n", path.Get(), err);
+                return;
+            }
+
+            r.Textures.push_back(ZetaMove(tex));
+            return;
+        }
+    }
+
+    void ReloadScene(WatchedScene& ws, HotReloadResult& r)
+    {
+        Filesystem::Path modelDir(ws.Path.GetView());
+        modelDir.ToParent();
+
+        const uint64_t bufferWriteTime = Filesystem::GetLastWriteTime(ws.BufferPath.Get());
+        bool geometryChanged = bufferWriteTime != ws.BufferLastWriteTime;
+        ws.BufferLastWriteTime = bufferWriteTime;
+
+        const uint64_t writeTime = Filesystem::GetLastWriteTime(ws.Path.Get());
+        if (writeTime != ws.LastWriteTime)
+        {
+            cgltf_options options{};
+            cgltf_data* model = nullptr;
+            const cgltf_result res = glTF::ParseFile(options, ws.Path.Get(), &model);
+
+            // File might still be in the middle of being written, try again after the 
+            // next change
+            if (res != cgltf_result_success)
+            {
+                LOG_UI_WARNING("Hot reload: parsing %s failed: %s.\n", ws.Path.Get(), GetErrorMsg(res));
+                return;
+            }
+
+            ws.LastWriteTime = writeTime;
+            geometryChanged = geometryChanged || model->meshes_count != ws.NumMeshes;
+
+            if (model->materials_count != ws.Materials.size())
+            {
+                LOG_UI_WARNING("Hot reload: materials were added to or removed from %s, which requires reloading the scene.\n",
+                    ws.Path.Get());
+            }
+
+            const size_t numMats = Min(model->materials_count, ws.Materials.size());
+
+            for (size_t m = 0; m < numMats; m++)
+            {
+                glTF::Asset::MaterialDesc desc;
+                BuildMaterialDesc(ws.SceneID, modelDir, *model, (int)m, desc);
+
+                glTF::Asset::MaterialDesc& prev = ws.Materials[m];
+                if (SameMaterial(desc, prev))
+                    continue;
+
+                const Texture::ID_TYPE prevIDs[] = { prev.BaseColorTexID, prev.NormalTexID,
+                    prev.MetallicRoughnessTexID, prev.EmissiveTexID };
+                const Texture::ID_TYPE newIDs[] = { desc.BaseColorTexID, desc.NormalTexID,
+                    desc.MetallicRoughnessTexID, desc.EmissiveTexID };
+
+                for (size_t i = 0; i < ZetaArrayLen(newIDs); i++)
+                {
+                    if (newIDs[i] != Texture::INVALID_ID && newIDs[i] != prevIDs[i])
+                        LoadReferencedTexture(modelDir, *model, newIDs[i], r);
+                }
+
+                prev = desc;
+                r.Materials.push_back(desc);
+            }
+
+            // Images that were added are watched from now on
+            WatchImages(modelDir, *model, ws);
+
+            cgltf_free(model);
+        }
+
+        if (geometryChanged)
+        {
+            LOG_UI_WARNING("Hot reload: geometry of %s has changed, which requires reloading the scene.\n",
+                ws.Path.Get());
+        }
+
+        for (auto& img : ws.Images)
+        {
+            const char* path = ws.ImagePaths.data() + img.PathOffset;
+            const uint64_t imgWriteTime = Filesystem::GetLastWriteTime(path);
+            if (imgWriteTime == img.LastWriteTime)
+                continue;
+
+            DDS_Data dds;
+            auto err = Direct3DUtil::LoadDDSHeaderFromFile(path, dds.subresources, dds.format,
+                dds.width, dds.height, dds.depth, dds.mipCount, dds.numSubresources);
+
+            // Might have been deleted or still being written
+            if (err != LOAD_DDS_RESULT::SUCCESS)
+                continue;
+
+            img.LastWriteTime = imgWriteTime;
+
+            const size_t pathLen = strlen(path);
+            const uint32_t pathOffset = (uint32_t)r.Paths.size();
+            r.Paths.append_range(path, path + pathLen + 1);
+
+            r.ModifiedTextures.push_back(ModifiedTexture{
+                .Desc = Scene::Internal::TextureStreamer::TextureDesc{ .ID = img.ID,
+                    .Path = nullptr,
+                    .Width = dds.width,
+                    .Height = dds.height,
+                    .Format = dds.format,
+                    .MipCount = dds.mipCount,
+                    .ResidentMip = Scene::Internal::TextureStreamer::InitialTopMip(dds.width, 
+                        dds.height, dds.mipCount) },
+                .PathOffset = pathOffset });
+        }
+    }
+
+    void ApplyHotReload(HotReloadResult& r)
+    {
+        SceneCore& scene = App::GetScene();
+
+        std::sort(r.Textures.begin(), r.Textures.end(),
+            [](const Texture& lhs, const Texture& rhs)
+            {
+                return lhs.ID() < rhs.ID();
+            });
+
+        for (auto& desc : r.Materials)
+            scene.ReloadMaterial(desc, r.Textures);
+
+        for (auto& t : r.ModifiedTextures)
+        {
+            t.Desc.Path = r.Paths.data() + t.PathOffset;
+            scene.ReloadTexture(t.Desc);
+        }
+
+        if (!r.Materials.empty() || !r.ModifiedTextures.empty())
+        {
+            LOG_UI_INFO("Hot reload: updated %u material(s) and %u texture(s).",
+                (uint32_t)r.Materials.size(), (uint32_t)r.ModifiedTextures.size());
+        }
+
+        // Textures that no material took have never been used by the GPU
+        for (auto& t : r.Textures)
+            t.Reset(false);
+
+        r.Materials.clear();
+        r.Textures.clear();
+        r.ModifiedTextures.clear();
+        r.Paths.clear();
+    }
+}
+
+void glTF::HotReload::Enable(bool enable)
+{
+    auto& hr = g_hotReload;
+    hr.Enabled = enable;
+
+    if (enable)
+        return;
+
+    AcquireSRWLockShared(&hr.Lock);
+
+    for (auto* ws : hr.Scenes)
+    {
+        Filesystem::StopWatching(ws->Watcher);
+        ws->WatchFailed = false;
+    }
+
+    ReleaseSRWLockShared(&hr.Lock);
+}
+
+void glTF::HotReload::Update()
+{
+    auto& hr = g_hotReload;
 
-            cgltf_free(tc.Model);
+    if (hr.InFlight && hr.ResultReady.load(std::memory_order_acquire))
+    {
+        ApplyHotReload(hr.Result);
+        hr.ResultReady.store(false, std::memory_order_relaxed);
+        hr.InFlight = false;
+    }
+
+    if (!hr.Enabled)
+        return;
+
+    const double now = App::GetTimer().GetTotalTime();
+
+    AcquireSRWLockShared(&hr.Lock);
+
+    for (auto* ws : hr.Scenes)
+    {
+        // Scenes loaded after hot reload was enabled
+        if (!ws->Watcher.IsValid() && !ws->WatchFailed)
+        {
+            Filesystem::Path modelDir(ws->Path.GetView());
+            modelDir.ToParent();
+            ws->Watcher = Filesystem::WatchDirectory(modelDir.Get());
+
+            if (!ws->Watcher.IsValid())
+            {
+                LOG_UI_WARNING("Hot reload: watching directory %s failed.\n", modelDir.Get());
+                ws->WatchFailed = true;
+            }
+        }
+
+        if (Filesystem::PollChanges(ws->Watcher))
+        {
+            hr.ChangePending = true;
+            hr.LastChangeTime = now;
+        }
+    }
+
+    ReleaseSRWLockShared(&hr.Lock);
+
+    if (hr.InFlight || !hr.ChangePending || now - hr.LastChangeTime < HotReloadState::DEBOUNCE_SECONDS)
+        return;
+
+    hr.ChangePending = false;
+    hr.InFlight = true;
+
+    // Parsing and reading textures from disk happen on a background thread
+    Task t("glTF::HotReload", TASK_PRIORITY::BACKGROUND, []()
+        {
+            auto& hr = g_hotReload;
+
+            AcquireSRWLockShared(&hr.Lock);
+
+            for (auto* ws : hr.Scenes)
+                ReloadScene(*ws, hr.Result);
+
+            ReleaseSRWLockShared(&hr.Lock);
+
+            hr.ResultReady.store(true, std::memory_order_release);
         });
 
-    // Final task has to run after all the other tasks
-    ts.AddIncomingEdgeFromAll(last);
+    App::SubmitBackground(ZetaMove(t));
+}
+
+void glTF::HotReload::Shutdown()
+{
+    auto& hr = g_hotReload;
+
+    // Background threads are done by now
+    AcquireSRWLockExclusive(&hr.Lock);
+
+    for (auto* ws : hr.Scenes)
+    {
+        Filesystem::StopWatching(ws->Watcher);
+        delete ws;
+    }
+
+    hr.Scenes.free_memory();
+
+    ReleaseSRWLockExclusive(&hr.Lock);
 
-    WaitObject waitObj;
-    ts.Sort();
-    ts.Finalize(&waitObj);
-    App::Submit(ZetaMove(ts));
+    for (auto& t : hr.Result.Textures)
+        t.Reset(false);
 
-    // Help out with unfinished tasks. Note: This thread might help
-    // with tasks that are not related to loading glTF.
-    App::FlushWorkerThreadPool();
-    waitObj.Wait();
+    hr.Result.Textures.free_memory();
+    hr.Enabled = false;
 }
@@ -1,8 +1,27 @@
 #pragma once
 
 #include "../App/Path.h"
+#include "../Utility/Span.h"
 
 namespace ZetaRay::Model::glTF
 {
-    void Load(const App::Filesystem::Path& p);
+    // In async mode, returns immediately and the scene is loaded in the background while 
+    // rendering continues. Loaded scene shows up at the first frame after loading is done.
+    void Load(const App::Filesystem::Path& p, bool async = false);
+
+    // Loads multiple files concurrently on the worker threads. Each file is processed 
+    // separately and the results are added to the scene together once all of them 
+    // are done.
+    void Load(Util::Span<Util::StrView> paths, bool async = false);
+
+    // Watches the directories of the loaded glTF files. When a file changes, materials 
+    // and textures that were modified are updated in place without reloading the scene. 
+    // Changes to geometry and to the number of materials require a full reload.
+    namespace HotReload
+    {
+        void Enable(bool enable);
+        // Called once per frame on the main thread
+        void Update();
+        void Shutdown();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,746 @@
+#include "glTFParser.h"
+#include "../App/App.h"
+#include "../App/Filesystem.h"
+#include "../Utility/SmallVector.h"
+#include <atomic>
+#include <stdlib.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Model;
+
+namespace
+{
+    // Byte range of one element of the "nodes" array, braces included
+    struct NodeRange
+    {
+        size_t Begin;
+        size_t End;
+    };
+
+    struct Allocator
+    {
+        explicit Allocator(const cgltf_memory_options& mem)
+            : Alloc(mem.alloc_func ? mem.alloc_func : &DefaultAlloc),
+            Free(mem.free_func ? mem.free_func : &DefaultFree),
+            UserData(mem.user_data)
+        {}
+
+        // Same as cgltf's defaults
+        static void* DefaultAlloc(void*, cgltf_size size) { return malloc(size); }
+        static void DefaultFree(void*, void* ptr) { free(ptr); }
+
+        void* (*Alloc)(void*, cgltf_size);
+        void (*Free)(void*, void*);
+        void* UserData;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Scan
+    //--------------------------------------------------------------------------------------
+
+    // Bit i is set when byte i of the 64-byte block equals c
+    ZetaInline uint64_t __vectorcall CmpMask(__m256i vLo, __m256i vHi, char c)
+    {
+        const __m256i vC = _mm256_set1_epi8(c);
+        const uint32_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(vLo, vC));
+        const uint32_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(vHi, vC));
+
+        return lo | ((uint64_t)hi << 32);
+    }
+
+    // Bit i of the result is the xor of bits [0, i] -- carry-less multiplication by all ones
+    ZetaInline uint64_t PrefixXor(uint64_t x)
+    {
+        const __m128i v = _mm_clmulepi64_si128(_mm_set_epi64x(0, (int64_t)x), _mm_set1_epi8(-1), 0);
+        return (uint64_t)_mm_cvtsi128_si64(v);
+    }
+
+    // Characters that are preceded by an odd number of backslashes. Run of backslashes
+    // that ends the block carries over to the next one through prevEscaped.
+    ZetaInline uint64_t EscapedMask(uint64_t backslash, uint64_t& prevEscaped)
+    {
+        if (!backslash)
+        {
+            const uint64_t escaped = prevEscaped;
+            prevEscaped = 0;
+
+            return escaped;
+        }
+
+        constexpr uint64_t EVEN_BITS = 0x5555555555555555ull;
+        backslash &= ~prevEscaped;
+        const uint64_t followsEscape = (backslash << 1) | prevEscaped;
+        const uint64_t oddSequenceStarts = backslash & ~EVEN_BITS & ~followsEscape;
+
+        // Runs that start on an odd bit end on an even bit when their length is odd. Adding
+        // the run's first bit to it carries one past its end.
+        unsigned long long sequencesStartingOnEvenBits;
+        prevEscaped = _addcarry_u64(0, oddSequenceStarts, backslash, &sequencesStartingOnEvenBits);
+        const uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+
+        return (EVEN_BITS ^ invertMask) & followsEscape;
+    }
+
+    // Finds the elements of the top-level "nodes" array. Document is classified 64 bytes
+    // at a time with bit masks (quotes, escapes, string contents), so that only the
+    // structural characters outside strings are visited one by one. Returns false when
+    // there's no such array or when the document looks invalid -- cgltf reports the
+    // error in that case.
+    bool FindNodes(Span<uint8_t> json, SmallVector<NodeRange>& nodes)
+    {
+        const uint8_t* data = json.data();
+        uint64_t prevEscaped = 0;
+        uint64_t prevInString = 0;
+        int depth = 0;
+        bool expectKey = false;
+        bool isNodesKey = false;
+        bool inNodes = false;
+        bool foundNodes = false;
+        size_t nodeBegin = 0;
+
+        for (size_t base = 0; base < json.size(); base += 64)
+        {
+            alignas(32) uint8_t tail[64];
+            const uint8_t* block = data + base;
+
+            // Pad the last block with whitespace
+            if (json.size() - base < 64)
+            {
+                memset(tail, ' ', sizeof(tail));
+                memcpy(tail, block, json.size() - base);
+                block = tail;
+            }
+
+            const __m256i vLo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+            const __m256i vHi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+            const uint64_t escaped = EscapedMask(CmpMask(vLo, vHi, '\\'), prevEscaped);
+            const uint64_t quotes = CmpMask(vLo, vHi, '"') & ~escaped;
+            // Set for opening quotes and string contents, but not for closing quotes
+            const uint64_t inString = PrefixXor(quotes) ^ prevInString;
+            prevInString = (uint64_t)((int64_t)inString >> 63);
+
+            const uint64_t structurals = (CmpMask(vLo, vHi, '{') | CmpMask(vLo, vHi, '}') |
+                CmpMask(vLo, vHi, '[') | CmpMask(vLo, vHi, ']') | CmpMask(vLo, vHi, ',')) & ~inString;
+            uint64_t bits = structurals | (quotes & inString);
+
+            while (bits)
+            {
+                const size_t pos = base + _tzcnt_u64(bits);
+                bits = _blsr_u64(bits);
+                const uint8_t c = data[pos];
+
+                if (c == '"')
+                {
+                    if (depth != 1 || !expectKey)
+                        continue;
+
+                    expectKey = false;
+
+                    if (json.size() - pos > 6 && memcmp(data + pos + 1, "nodes\"", 6) == 0)
+                    {
+                        // Duplicate keys are rejected by cgltf
+                        if (foundNodes)
+                            return false;
+
+                        isNodesKey = true;
+                    }
+                }
+                else if (c == '{' || c == '[')
+                {
+                    depth++;
+
+                    if (depth == 1)
+                    {
+                        if (c != '{')
+                            return false;
+
+                        expectKey = true;
+                    }
+                    else if (depth == 2 && isNodesKey)
+                    {
+                        if (c != '[')
+                            return false;
+
+                        inNodes = true;
+                        isNodesKey = false;
+                    }
+                    else if (depth == 3 && inNodes)
+                    {
+                        if (c != '{')
+                            return false;
+
+                        nodeBegin = pos;
+                    }
+                }
+                else if (c == '}' || c == ']')
+                {
+                    // Mismatched brackets are left as is and caught later (by the node
+                    // parser or by cgltf)
+                    if (depth == 3 && inNodes)
+                        nodes.push_back(NodeRange{ .Begin = nodeBegin, .End = pos + 1 });
+                    else if (depth == 2 && inNodes)
+                    {
+                        inNodes = false;
+                        foundNodes = true;
+                    }
+
+                    if (--depth < 0)
+                        return false;
+                }
+                // Comma
+                else if (depth == 1)
+                {
+                    expectKey = true;
+                    isNodesKey = false;
+                }
+            }
+        }
+
+        return depth == 0 && !prevInString && foundNodes;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Node
+    //--------------------------------------------------------------------------------------
+
+    struct Cursor
+    {
+        const char* P;
+        const char* End;
+    };
+
+    ZetaInline void SkipWhitespace(Cursor& c)
+    {
+        while (c.P < c.End && (*c.P == ' ' || *c.P == '\t' || *c.P == '\n' || *c.P == '\r'))
+            c.P++;
+    }
+
+    ZetaInline bool Consume(Cursor& c, char ch)
+    {
+        SkipWhitespace(c);
+        if (c.P == c.End || *c.P != ch)
+            return false;
+
+        c.P++;
+        return true;
+    }
+
+    ZetaInline bool Peek(Cursor& c, char ch)
+    {
+        SkipWhitespace(c);
+        return c.P < c.End && *c.P == ch;
+    }
+
+    // On success, [begin, end) is the string without its quotes and with escape
+    // sequences as is
+    bool ParseString(Cursor& c, const char*& begin, const char*& end)
+    {
+        if (!Consume(c, '"'))
+            return false;
+
+        begin = c.P;
+        while (c.P < c.End && *c.P != '"')
+        {
+            if (*c.P == '\\')
+                c.P++;
+
+            c.P++;
+        }
+
+        if (c.P >= c.End)
+            return false;
+
+        end = c.P++;
+        return true;
+    }
+
+    // Numbers, true, false and null -- everything up to the next delimiter, same as a
+    // jsmn primitive token. Copied to a null-terminated buffer as is done by cgltf.
+    bool ParsePrimitive(Cursor& c, char (&tmp)[128])
+    {
+        SkipWhitespace(c);
+        const char* begin = c.P;
+
+        while (c.P < c.End && *c.P != ',' && *c.P != ']' && *c.P != '}' && *c.P != ':' &&
+            *c.P != ' ' && *c.P != '\t' && *c.P != '\n' && *c.P != '\r')
+        {
+            if (*c.P == '"' || *c.P == '[' || *c.P == '{')
+                return false;
+
+            c.P++;
+        }
+
+        const size_t len = Math::Min((size_t)(c.P - begin), sizeof(tmp) - 1);
+        if (len == 0)
+            return false;
+
+        memcpy(tmp, begin, len);
+        tmp[len] = '\0';
+
+        return true;
+    }
+
+    bool ParseInt(Cursor& c, int& val)
+    {
+        char tmp[128];
+        if (!ParsePrimitive(c, tmp))
+            return false;
+
+        val = atoi(tmp);
+        return true;
+    }
+
+    bool ParseFloatArray(Cursor& c, cgltf_float* vals, int n)
+    {
+        if (!Consume(c, '['))
+            return false;
+
+        for (int i = 0; i < n; i++)
+        {
+            char tmp[128];
+            if ((i > 0 && !Consume(c, ',')) || !ParsePrimitive(c, tmp))
+                return false;
+
+            vals[i] = (cgltf_float)atof(tmp);
+        }
+
+        // Arrays of a different size are rejected by cgltf
+        return Consume(c, ']');
+    }
+
+    bool SkipValue(Cursor& c)
+    {
+        SkipWhitespace(c);
+        if (c.P == c.End)
+            return false;
+
+        if (*c.P == '"')
+        {
+            const char* begin;
+            const char* end;
+            return ParseString(c, begin, end);
+        }
+
+        if (*c.P != '{' && *c.P != '[')
+        {
+            char tmp[128];
+            return ParsePrimitive(c, tmp);
+        }
+
+        // Objects and arrays, only strings and nesting matter
+        int depth = 0;
+        do
+        {
+            if (c.P == c.End)
+                return false;
+
+            if (*c.P == '"')
+            {
+                const char* begin;
+                const char* end;
+                if (!ParseString(c, begin, end))
+                    return false;
+
+                continue;
+            }
+
+            if (*c.P == '{' || *c.P == '[')
+                depth++;
+            else if (*c.P == '}' || *c.P == ']')
+                depth--;
+
+            c.P++;
+        } while (depth > 0);
+
+        return true;
+    }
+
+    ZetaInline uint32_t Unhex(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+
+        return 0;
+    }
+
+    // Same conversion as cgltf, in place
+    void Unescape(char* str)
+    {
+        char* r = str;
+        char* w = str;
+
+        for (; *r; r++, w++)
+        {
+            if (*r != '\\')
+            {
+                *w = *r;
+                continue;
+            }
+
+            switch (*++r)
+            {
+            case 'u':
+            {
+                uint32_t ch = 0;
+                for (int i = 0; i < 4 && r[1]; i++)
+                    ch = (ch << 4) + Unhex(*++r);
+
+                if (ch <= 0x7f)
+                    *w = (char)ch;
+                else if (ch <= 0x7ff)
+                {
+                    *w++ = (char)(0xc0 | ((ch >> 6) & 0x1f));
+                    *w = (char)(0x80 | (ch & 0x3f));
+                }
+                else
+                {
+                    *w++ = (char)(0xe0 | ((ch >> 12) & 0x0f));
+                    *w++ = (char)(0x80 | ((ch >> 6) & 0x3f));
+                    *w = (char)(0x80 | (ch & 0x3f));
+                }
+                break;
+            }
+            case 'b':
+                *w = '\b';
+                break;
+            case 'f':
+                *w = '\f';
+                break;
+            case 'n':
+                *w = '\n';
+                break;
+            case 'r':
+                *w = '\r';
+                break;
+            case 't':
+                *w = '\t';
+                break;
+            // Trailing backslash
+            case '\0':
+                *w = '\0';
+                return;
+            default:
+                *w = *r;
+            }
+        }
+
+        *w = '\0';
+    }
+
+    ZetaInline bool KeyEquals(const char* begin, const char* end, const char* key)
+    {
+        const size_t len = strlen(key);
+        return (size_t)(end - begin) == len && memcmp(begin, key, len) == 0;
+    }
+
+    ZetaInline void InitNode(cgltf_node& node)
+    {
+        // Same defaults as cgltf
+        memset(&node, 0, sizeof(node));
+        node.rotation[3] = 1.0f;
+        node.scale[0] = 1.0f;
+        node.scale[1] = 1.0f;
+        node.scale[2] = 1.0f;
+        node.matrix[0] = 1.0f;
+        node.matrix[5] = 1.0f;
+        node.matrix[10] = 1.0f;
+        node.matrix[15] = 1.0f;
+    }
+
+    ZetaInline void FreeNode(cgltf_node& node, const Allocator& alloc)
+    {
+        if (node.name)
+            alloc.Free(alloc.UserData, node.name);
+        if (node.children)
+            alloc.Free(alloc.UserData, node.children);
+    }
+
+    // References to other nodes and meshes are stored as (index + 1), same as cgltf does
+    // before resolving them. Fails for invalid json and for properties that aren't
+    // handled here.
+    bool ParseNode(Cursor c, cgltf_node& node, const Allocator& alloc)
+    {
+        if (!Consume(c, '{'))
+            return false;
+
+        if (Consume(c, '}'))
+            return true;
+
+        do
+        {
+            const char* key;
+            const char* keyEnd;
+            if (!ParseString(c, key, keyEnd) || !Consume(c, ':'))
+                return false;
+
+            if (KeyEquals(key, keyEnd, "name"))
+            {
+                const char* begin;
+                const char* end;
+                if (node.name || !ParseString(c, begin, end))
+                    return false;
+
+                const size_t len = end - begin;
+                node.name = reinterpret_cast<char*>(alloc.Alloc(alloc.UserData, len + 1));
+                if (!node.name)
+                    return false;
+
+                memcpy(node.name, begin, len);
+                node.name[len] = '\0';
+                Unescape(node.name);
+            }
+            else if (KeyEquals(key, keyEnd, "children"))
+            {
+                if (node.children || !Consume(c, '['))
+                    return false;
+
+                SmallVector<int, Support::SystemAllocator, 32> children;
+
+                if (!Consume(c, ']'))
+                {
+                    do
+                    {
+                        int idx;
+                        if (!ParseInt(c, idx))
+                            return false;
+
+                        children.push_back(idx);
+                    } while (Consume(c, ','));
+
+                    if (!Consume(c, ']'))
+                        return false;
+                }
+
+                node.children = reinterpret_cast<cgltf_node**>(alloc.Alloc(alloc.UserData,
+                    Math::Max(children.size(), size_t(1)) * sizeof(cgltf_node*)));
+                if (!node.children)
+                    return false;
+
+                for (size_t i = 0; i < children.size(); i++)
+                    node.children[i] = reinterpret_cast<cgltf_node*>((size_t)(children[i] + 1));
+
+                node.children_count = children.size();
+            }
+            else if (KeyEquals(key, keyEnd, "mesh"))
+            {
+                int idx;
+                if (!ParseInt(c, idx))
+                    return false;
+
+                node.mesh = reinterpret_cast<cgltf_mesh*>((size_t)(idx + 1));
+            }
+            else if (KeyEquals(key, keyEnd, "translation"))
+            {
+                if (!ParseFloatArray(c, node.translation, 3))
+                    return false;
+
+                node.has_translation = 1;
+            }
+            else if (KeyEquals(key, keyEnd, "rotation"))
+            {
+                if (!ParseFloatArray(c, node.rotation, 4))
+                    return false;
+
+                node.has_rotation = 1;
+            }
+            else if (KeyEquals(key, keyEnd, "scale"))
+            {
+                if (!ParseFloatArray(c, node.scale, 3))
+                    return false;
+
+                node.has_scale = 1;
+            }
+            else if (KeyEquals(key, keyEnd, "matrix"))
+            {
+                if (!ParseFloatArray(c, node.matrix, 16))
+                    return false;
+
+                node.has_matrix = 1;
+            }
+            // Left to cgltf
+            else if (KeyEquals(key, keyEnd, "skin") || KeyEquals(key, keyEnd, "camera") ||
+                KeyEquals(key, keyEnd, "weights") || KeyEquals(key, keyEnd, "extras") ||
+                KeyEquals(key, keyEnd, "extensions"))
+            {
+                return false;
+            }
+            // Unknown properties are ignored, same as cgltf
+            else if (!SkipValue(c))
+                return false;
+        } while (Consume(c, ','));
+
+        if (!Consume(c, '}'))
+            return false;
+
+        SkipWhitespace(c);
+        return c.P == c.End;
+    }
+
+    // Copies the parsed nodes over the (empty) nodes that cgltf parsed and resolves their
+    // references
+    cgltf_result ResolveNodes(cgltf_data* model, Span<cgltf_node> nodes)
+    {
+        const size_t numNodes = model->nodes_count;
+        if (numNodes != nodes.size())
+            return cgltf_result_invalid_gltf;
+
+        for (size_t i = 0; i < numNodes; i++)
+            model->nodes[i] = nodes[i];
+
+        for (size_t i = 0; i < numNodes; i++)
+        {
+            cgltf_node& node = model->nodes[i];
+
+            if (node.mesh)
+            {
+                const size_t idx = reinterpret_cast<size_t>(node.mesh) - 1;
+                if (idx >= model->meshes_count)
+                    return cgltf_result_invalid_gltf;
+
+                node.mesh = &model->meshes[idx];
+            }
+
+            for (size_t j = 0; j < node.children_count; j++)
+            {
+                const size_t idx = reinterpret_cast<size_t>(node.children[j]) - 1;
+                // Also covers null
+                if (idx >= numNodes)
+                    return cgltf_result_invalid_gltf;
+
+                node.children[j] = &model->nodes[idx];
+            }
+        }
+
+        for (size_t i = 0; i < numNodes; i++)
+        {
+            cgltf_node& node = model->nodes[i];
+
+            for (size_t j = 0; j < node.children_count; j++)
+            {
+                // Nodes can only have one parent
+                if (node.children[j]->parent)
+                    return cgltf_result_invalid_gltf;
+
+                node.children[j]->parent = &node;
+            }
+        }
+
+        return cgltf_result_success;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// glTF
+//--------------------------------------------------------------------------------------
+
+cgltf_result glTF::Parse(const cgltf_options& options, MutableSpan<uint8_t> json,
+    cgltf_data** outData, size_t minNumNodes)
+{
+    SmallVector<NodeRange> ranges;
+    const bool isGLB = json.size() >= 4 && memcmp(json.data(), "glTF", 4) == 0;
+
+    if (isGLB || !FindNodes(json, ranges) || ranges.size() < minNumNodes)
+        return cgltf_parse(&options, json.data(), json.size(), outData);
+
+    const Allocator alloc(options.memory);
+    SmallVector<cgltf_node> nodes;
+    nodes.resize_uninitialized(ranges.size());
+    std::atomic_bool unsupported = false;
+
+    constexpr size_t MIN_NODES_PER_TASK = 1024;
+    App::ParallelFor(ranges.size(), MIN_NODES_PER_TASK,
+        [&ranges, &nodes, &unsupported, &alloc, json](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                InitNode(nodes[i]);
+
+                if (unsupported.load(std::memory_order_relaxed))
+                    continue;
+
+                const char* p = reinterpret_cast<const char*>(json.data());
+                const Cursor c{ .P = p + ranges[i].Begin, .End = p + ranges[i].End };
+
+                if (!ParseNode(c, nodes[i], alloc))
+                    unsupported.store(true, std::memory_order_relaxed);
+            }
+        });
+
+    auto freeNodes = [&nodes, &alloc]()
+        {
+            for (auto& node : nodes)
+                FreeNode(node, alloc);
+        };
+
+    // Document is still unmodified
+    if (unsupported.load(std::memory_order_relaxed))
+    {
+        freeNodes();
+        return cgltf_parse(&options, json.data(), json.size(), outData);
+    }
+
+    for (const NodeRange& r : ranges)
+        memset(json.data() + r.Begin + 1, ' ', r.End - r.Begin - 2);
+
+    cgltf_data* model = nullptr;
+    cgltf_result res = cgltf_parse(&options, json.data(), json.size(), &model);
+    if (res != cgltf_result_success)
+    {
+        freeNodes();
+        return res;
+    }
+
+    // From here on, nodes are owned by the model
+    res = ResolveNodes(model, nodes);
+    if (res != cgltf_result_success)
+    {
+        if (model->nodes_count != nodes.size())
+            freeNodes();
+
+        cgltf_free(model);
+        return res;
+    }
+
+    *outData = model;
+    return cgltf_result_success;
+}
+
+cgltf_result glTF::ParseFile(const cgltf_options& options, const char* path, cgltf_data** outData,
+    size_t minNumNodes)
+{
+    // Custom file callbacks would have to be reimplemented here
+    if (options.file.read)
+        return cgltf_parse_file(&options, path, outData);
+
+    const size_t size = App::Filesystem::GetFileSize(path);
+    if (size == size_t(-1))
+        return cgltf_result_file_not_found;
+
+    // File data is released by cgltf_free() using the same allocator
+    const Allocator alloc(options.memory);
+    uint8_t* data = reinterpret_cast<uint8_t*>(alloc.Alloc(alloc.UserData, Math::Max(size, size_t(1))));
+    if (!data)
+        return cgltf_result_out_of_memory;
+
+    if (!App::Filesystem::ReadFileRange(path, data, 0, size))
+    {
+        alloc.Free(alloc.UserData, data);
+        return cgltf_result_io_error;
+    }
+
+    const cgltf_result res = Parse(options, MutableSpan(data, size), outData, minNumNodes);
+    if (res != cgltf_result_success)
+    {
+        alloc.Free(alloc.UserData, data);
+        return res;
+    }
+
+    (*outData)->file_data = data;
+    return cgltf_result_success;
+}
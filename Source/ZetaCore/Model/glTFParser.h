@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../Utility/Span.h"
+#include <cgltf/cgltf.h>
+
+namespace ZetaRay::Model::glTF
+{
+    // Drop-in replacement for cgltf_parse_file() that produces the same cgltf_data. For
+    // json documents with many nodes, which dominate the parse time of large scenes, the
+    // "nodes" array is parsed on the worker threads:
+    //
+    //  1. A SIMD scan of the document finds the byte range of every element of the
+    //     top-level "nodes" array.
+    //  2. Nodes are parsed in parallel. Then their contents are replaced with whitespace,
+    //     which keeps every other offset into the document (e.g. extras) unchanged.
+    //  3. cgltf parses the rest, which leaves nodes in place as empty objects, so that
+    //     references to them (scenes, skins, animations) are valid.
+    //  4. Parsed nodes are copied over and references from nodes are resolved.
+    //
+    // Documents with nodes that have skins, cameras, morph weights, extras or extensions
+    // aren't handled and are passed to cgltf unmodified, as are GLB files and documents with
+    // fewer than minNumNodes nodes.
+    cgltf_result ParseFile(const cgltf_options& options, const char* path, cgltf_data** outData,
+        size_t minNumNodes = 4096);
+
+    // Same as above, but for a document that's already in memory. Document may be modified
+    // and has to outlive the returned data, same as for cgltf_parse().
+    cgltf_result Parse(const cgltf_options& options, Util::MutableSpan<uint8_t> json,
+        cgltf_data** outData, size_t minNumNodes = 4096);
+}
@@ -2,10 +2,15 @@
 #include "../Core/RendererCore.h"
 #include "../Core/CommandList.h"
 #include "../Scene/SceneCore.h"
+#include "../Scene/Camera.h"
 #include "../Core/SharedShaderResources.h"
 #include "../Core/RenderGraph.h"
+#include "../Core/Config.h"
+#include "../Support/CpuEvent.h"
 #include "../App/Log.h"
 #include "../App/Timer.h"
+#include "../App/Path.h"
+#include <xxHash/xxhash.h>
 #include <algorithm>
 
 using namespace ZetaRay;
@@ -26,16 +31,37 @@ namespace
         float M[3][4];
     };
 
-    struct DynamicBlasBuild
+    // For 4-component formats, the last component is ignored
+#if COMPACT_VERTEX == 1
+    constexpr DXGI_FORMAT VERTEX_POSITION_FORMAT = DXGI_FORMAT_R16G16B16A16_SNORM;
+#else
+    constexpr DXGI_FORMAT VERTEX_POSITION_FORMAT = DXGI_FORMAT_R32G32B32_FLOAT;
+#endif
+
+    ZetaInline DXGI_FORMAT IndexFormat(const TriangleMesh& mesh)
     {
-        D3D12_RAYTRACING_GEOMETRY_DESC GeoDesc;
-        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO BuildInfo;
-        uint32_t BlasBufferOffset;
-        uint32_t ScratchBufferOffset;
-        uint32_t TreeLevel;
-        uint32_t LevelIdx;
+        return mesh.Uses16BitIndices() ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    }
+
+    // Followed by the serialized BLAS, which starts with a 
+    // D3D12_SERIALIZED_RAYTRACING_ACCELERATION_STRUCTURE_HEADER
+    struct StaticBLASCacheHeader
+    {
+        static constexpr uint32_t MAGIC = 0x53414c42;   // "BLAS"
+        static constexpr uint32_t VERSION = 1;
+
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t Key;
     };
 
+    void StaticBLASCachePath(uint64_t key, App::Filesystem::Path& path)
+    {
+        StackStr(filename, n, "StaticBLAS_%016llx.cache", key);
+        path.Reset(App::GetPSOCacheDir());
+        path.Append(filename);
+    }
+
     ZetaInline D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS BuildFlags(RT_MESH_MODE t)
     {
         D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS f = 
@@ -47,58 +73,172 @@ namespace
             f |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION;
         }
         else if (t == RT_MESH_MODE::DYNAMIC_NO_REBUILD)
+        {
+            // Never rebuilt after the first build, so compacting them pays off
             f |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+            f |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION;
+        }
         //else if (t == RT_MESH_MODE::DYNAMIC_REBUILD)
         //    f |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD;
 
         return f;
     }
-}
 
-//--------------------------------------------------------------------------------------
-// StaticBLAS
-//--------------------------------------------------------------------------------------
+    ZetaInline uint64_t DynamicBLASKey(uint32_t treeLevel, uint32_t levelIdx)
+    {
+        return ((uint64_t)treeLevel << 32) | levelIdx;
+    }
 
-void StaticBLAS::FillMeshTransformBufferForBuild(ID3D12Heap* heap, uint32_t heapOffsetInBytes)
-{
-    SceneCore& scene = App::GetScene();
-    Assert(scene.m_numStaticInstances, "Invalid call.");
+    ZetaInline bool DynamicBLASLess(uint32_t lhsLevel, uint32_t lhsIdx, uint32_t rhsLevel, 
+        uint32_t rhsIdx)
+    {
+        if (lhsLevel < rhsLevel)
+            return true;
+        else if (lhsLevel > rhsLevel)
+            return false;
 
-    SmallVector<BLASTransform, App::FrameAllocator> transforms;
-    transforms.resize(scene.m_numStaticInstances);
+        return lhsIdx < rhsIdx;
+    }
 
-    size_t currInstance = 0;
+    // Expects BLASes to be sorted by tree position
+    template<typename Vec>
+    ZetaInline auto& FindDynamicBLAS(Vec& blases, uint64_t key)
+    {
+        auto it = std::lower_bound(blases.begin(), blases.end(), key,
+            [](const auto& lhs, uint64_t k)
+            {
+                return DynamicBLASLess(lhs.TreeLevel, lhs.LevelIdx, (uint32_t)(k >> 32), 
+                    (uint32_t)k);
+            });
 
-    // Skip the first level
-    for (size_t treeLevelIdx = 1; treeLevelIdx < scene.m_sceneGraph.size(); treeLevelIdx++)
+        Assert(it != blases.end() && DynamicBLASKey(it->TreeLevel, it->LevelIdx) == key,
+            "Dynamic BLAS was not found.");
+
+        return *it;
+    }
+
+    // Invokes f(treeLevel, levelIdx, staticIdx) for every static instance with index in 
+    // [base, base + num), where index is based on the spatially sorted static instance 
+    // order (see SceneCore::SortRtStaticInstances())
+    template<typename Func>
+    void ForEachStaticInstance(SceneCore& scene, uint32_t base, uint32_t num, Func f)
     {
-        auto& currTreeLevel = scene.m_sceneGraph[treeLevelIdx];
+        const uint32_t end = base + num;
+        uint32_t staticIdx = 0;
 
-        for (size_t i = 0; i < currTreeLevel.m_rtFlags.size(); i++)
+        for (const uint64_t treePos : scene.m_rtStaticInstanceOrder)
         {
+            auto& currTreeLevel = scene.m_sceneGraph[treePos >> 32];
+            const size_t i = treePos & UINT32_MAX;
+
             if (currTreeLevel.m_meshIDs[i] == Scene::INVALID_MESH)
                 continue;
 
+            // Converted to dynamic
             const auto rtFlags = RT_Flags::Decode(currTreeLevel.m_rtFlags[i]);
+            if (rtFlags.MeshMode != RT_MESH_MODE::STATIC)
+                continue;
 
-            if (rtFlags.MeshMode == RT_MESH_MODE::STATIC)
-            {
-                const float4x3& M = currTreeLevel.m_toWorlds[i];
-
-                for (int j = 0; j < 4; j++)
-                {
-                    transforms[currInstance].M[0][j] = M.m[j].x;
-                    transforms[currInstance].M[1][j] = M.m[j].y;
-                    transforms[currInstance].M[2][j] = M.m[j].z;
-                }
+            if (staticIdx >= base)
+                f(currTreeLevel, i, staticIdx);
 
-                currInstance++;
-            }
+            if (++staticIdx == end)
+                return;
         }
     }
 
+    ZetaInline D3D12_RAYTRACING_GEOMETRY_DESC DynamicBLASGeometryDesc(const TriangleMesh& mesh,
+        D3D12_GPU_VIRTUAL_ADDRESS sceneVBGpuVa, D3D12_GPU_VIRTUAL_ADDRESS sceneIBGpuVa)
+    {
+        D3D12_RAYTRACING_GEOMETRY_DESC desc;
+        desc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+        desc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
+        desc.Triangles.IndexBuffer = sceneIBGpuVa + mesh.m_gpuIdxBuffOffset * mesh.IndexSizeInBytes();
+        desc.Triangles.IndexCount = mesh.m_numIndices;
+        desc.Triangles.IndexFormat = IndexFormat(mesh);
+#if COMPACT_VERTEX == 1
+        // Dequantize positions during the build, so that BLAS is in mesh's local space
+        desc.Triangles.Transform3x4 = App::GetScene().GetMeshQuantTransforms().GpuVA() +
+            mesh.m_quantTransformIdx * sizeof(Scene::Internal::MeshContainer::QuantTransform);
+#else
+        desc.Triangles.Transform3x4 = 0;
+#endif
+        desc.Triangles.VertexBuffer.StartAddress = sceneVBGpuVa +
+            mesh.m_vtxBuffStartOffset * sizeof(RT::GpuVertex);
+        desc.Triangles.VertexBuffer.StrideInBytes = sizeof(RT::GpuVertex);
+        desc.Triangles.VertexCount = mesh.m_numVertices;
+        desc.Triangles.VertexFormat = VERTEX_POSITION_FORMAT;
+
+        return desc;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// StaticBLAS
+//--------------------------------------------------------------------------------------
+
+PlacedResourceList<3> StaticBLAS::RebuildResourceList() const
+{
+    Assert(m_prebuildInfo.ResultDataMaxSizeInBytes != UINT32_MAX,
+        "Invalid prebuild info.");
+
+    const uint32_t compactionInfoStartOffset = (uint32_t)AlignUp(
+        m_prebuildInfo.ScratchDataSizeInBytes,
+        alignof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC));
+    const uint32_t scratchBuffSizeInBytes = compactionInfoStartOffset +
+        sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC);
+
+    PlacedResourceList<3> list;
+    // BLAS (before compaction)
+    list.PushBuffer((uint32_t)m_prebuildInfo.ResultDataMaxSizeInBytes, true, true);
+    // Scratch buffer & compaction info
+    list.PushBuffer(scratchBuffSizeInBytes, true, false);
+    // Transform buffer
+    list.PushBuffer(m_numInstances * sizeof(BLASTransform), true, false);
+    list.End();
+
+    return list;
+}
+
+void StaticBLAS::FillMeshTransformBufferForBuild(ID3D12Heap* heap, uint32_t heapOffsetInBytes)
+{
+    SceneCore& scene = App::GetScene();
+    Assert(m_numInstances, "Invalid call.");
+
+    SmallVector<BLASTransform, App::FrameAllocator> transforms;
+    transforms.resize(m_numInstances);
+
+    ForEachStaticInstance(scene, m_baseInstance, m_numInstances, 
+        [this, &transforms, &scene](const auto& treeLevel, size_t i, uint32_t staticIdx)
+        {
+#if COMPACT_VERTEX == 1
+            // Dequantization comes first: 
+            //      p_w = (q * extents + center) * M
+            const TriangleMesh* mesh = scene.GetMesh(treeLevel.m_meshIDs[i]).value();
+            const float3 e = mesh->QuantizationExtents();
+            const float3 c = mesh->m_AABB.Center;
+            const float4x3& W = treeLevel.m_toWorlds[i];
+
+            float4x3 M;
+            M.m[0] = W.m[0] * e.x;
+            M.m[1] = W.m[1] * e.y;
+            M.m[2] = W.m[2] * e.z;
+            M.m[3] = W.m[0] * c.x + W.m[1] * c.y + W.m[2] * c.z + W.m[3];
+#else
+            const float4x3& M = treeLevel.m_toWorlds[i];
+#endif
+            BLASTransform& t = transforms[staticIdx - m_baseInstance];
+
+            for (int j = 0; j < 4; j++)
+            {
+                t.M[0][j] = M.m[j].x;
+                t.M[1][j] = M.m[j].y;
+                t.M[2][j] = M.m[j].z;
+            }
+        });
+
     Assert(!m_perMeshTransform.IsInitialized(), "Unexpected condition.");
-    const uint32_t sizeInBytes = scene.m_numStaticInstances * sizeof(BLASTransform);
+    const uint32_t sizeInBytes = m_numInstances * sizeof(BLASTransform);
 
     if (heap)
     {
@@ -121,65 +261,43 @@ void StaticBLAS::FillMeshTransformBufferForBuild(ID3D12Heap* heap, uint32_t heap
 void StaticBLAS::Rebuild(ComputeCmdList& cmdList)
 {
     SceneCore& scene = App::GetScene();
-    //Assert(scene.m_numOpaqueInstances + scene.m_numNonOpaqueInstances == 
-    // scene.m_numStaticInstances, "these should match.");
+    Assert(m_numInstances, "Invalid call.");
 
     SmallVector<D3D12_RAYTRACING_GEOMETRY_DESC, App::FrameAllocator> meshDescs;
-    meshDescs.resize(scene.m_numStaticInstances);
+    meshDescs.resize(m_numInstances);
 
-    constexpr int transformMatSize = sizeof(BLASTransform);
     const auto sceneVBGpuVa = scene.GetMeshVB().GpuVA();
     const auto sceneIBGpuVa = scene.GetMeshIB().GpuVA();
     const D3D12_GPU_VIRTUAL_ADDRESS transformGpuVa = m_perMeshTransform.GpuVA();
-    size_t currInstance = 0;
-
-    // Add a triangle mesh to list of BLAS geometries
-    // Following loop should exactly match the one in FillMeshTransformBufferForBuild()
-    for (size_t treeLevelIdx = 1; treeLevelIdx < scene.m_sceneGraph.size(); treeLevelIdx++)
-    {
-        auto& currTreeLevel = scene.m_sceneGraph[treeLevelIdx];
 
-        for (size_t i = 0; i < currTreeLevel.m_rtFlags.size(); i++)
+    // Add a triangle mesh to list of BLAS geometries. Layout should match the one in 
+    // FillMeshTransformBufferForBuild().
+    ForEachStaticInstance(scene, m_baseInstance, m_numInstances,
+        [&](const auto& treeLevel, size_t i, uint32_t staticIdx)
         {
-            const RT_Flags flags = RT_Flags::Decode(currTreeLevel.m_rtFlags[i]);
-
-            if (flags.MeshMode == RT_MESH_MODE::STATIC)
-            {
-                const uint64_t meshID = currTreeLevel.m_meshIDs[i];
-                if (meshID == Scene::INVALID_MESH)
-                    continue;
-
-                const TriangleMesh* mesh = scene.GetMesh(meshID).value();
-
-                meshDescs[currInstance].Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-                // Force mesh to be opaque when possible to avoid invoking any-hit shaders
-                meshDescs[currInstance].Flags = flags.IsOpaque ? 
-                    D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE : 
-                    D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
-                // Elements are tightly packed as size of each element is a multiple 
-                // of required alignment
-                meshDescs[currInstance].Triangles.Transform3x4 = transformGpuVa + 
-                    currInstance * transformMatSize;
-                meshDescs[currInstance].Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
-                meshDescs[currInstance].Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
-                meshDescs[currInstance].Triangles.IndexCount = mesh->m_numIndices;
-                meshDescs[currInstance].Triangles.VertexCount = mesh->m_numVertices;
-                meshDescs[currInstance].Triangles.IndexBuffer = sceneIBGpuVa + 
-                    mesh->m_idxBuffStartOffset * sizeof(uint32_t);
-                meshDescs[currInstance].Triangles.VertexBuffer.StartAddress = sceneVBGpuVa + 
-                    mesh->m_vtxBuffStartOffset * sizeof(Vertex);
-                meshDescs[currInstance].Triangles.VertexBuffer.StrideInBytes = sizeof(Vertex);
-
-                currTreeLevel.m_rtASInfo[i] = RT_AS_Info{
-                    .GeometryIndex = (uint32_t)currInstance,
-                    .InstanceID = 0 };
-
-                currInstance++;
-            }
-        }
-    }
-
-    Assert(currInstance == scene.m_numStaticInstances, "Invalid instance index.");
+            const RT_Flags flags = RT_Flags::Decode(treeLevel.m_rtFlags[i]);
+            const TriangleMesh* mesh = scene.GetMesh(treeLevel.m_meshIDs[i]).value();
+            const uint32_t geoIdx = staticIdx - m_baseInstance;
+            D3D12_RAYTRACING_GEOMETRY_DESC& desc = meshDescs[geoIdx];
+
+            desc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+            // Force mesh to be opaque when possible to avoid invoking any-hit shaders
+            desc.Flags = flags.IsOpaque ? 
+                D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE : 
+                D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
+            // Elements are tightly packed as size of each element is a multiple 
+            // of required alignment
+            desc.Triangles.Transform3x4 = transformGpuVa + geoIdx * sizeof(BLASTransform);
+            desc.Triangles.IndexFormat = IndexFormat(*mesh);
+            desc.Triangles.VertexFormat = VERTEX_POSITION_FORMAT;
+            desc.Triangles.IndexCount = mesh->m_numIndices;
+            desc.Triangles.VertexCount = mesh->m_numVertices;
+            desc.Triangles.IndexBuffer = sceneIBGpuVa + 
+                mesh->m_gpuIdxBuffOffset * mesh->IndexSizeInBytes();
+            desc.Triangles.VertexBuffer.StartAddress = sceneVBGpuVa + 
+                mesh->m_vtxBuffStartOffset * sizeof(RT::GpuVertex);
+            desc.Triangles.VertexBuffer.StrideInBytes = sizeof(RT::GpuVertex);
+        });
 
     D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc;
     buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
@@ -215,7 +333,8 @@ void StaticBLAS::Rebuild(ComputeCmdList& cmdList)
         list.PushBuffer(scratchBuffSizeInBytes, true, false);
         list.End();
 
-        m_resHeap = GpuMemory::GetResourceHeap(list.TotalSizeInBytes());
+        m_resHeap = GpuMemory::GetResourceHeap("StaticBLAS", list.TotalSizeInBytes(), 
+            MEMORY_CATEGORY::RT_AS);
 
         auto allocs = list.AllocInfos();
         m_BLASHeapOffsetInBytes = (uint32)allocs[0].Offset;
@@ -238,10 +357,6 @@ void StaticBLAS::Rebuild(ComputeCmdList& cmdList)
         true,
         false);
 
-    // For reading back the compacted size
-    m_postBuildInfoReadback = GpuMemory::GetReadbackHeapBuffer(
-        sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC));
-
     buildDesc.DestAccelerationStructureData = m_buffer.GpuVA();
     buildDesc.ScratchAccelerationStructureData = m_scratch.GpuVA();
     buildDesc.SourceAccelerationStructureData = 0;
@@ -263,11 +378,10 @@ void StaticBLAS::Rebuild(ComputeCmdList& cmdList)
 
     cmdList.ResourceBarrier(barrier);
 
-    cmdList.CopyBufferRegion(m_postBuildInfoReadback.Resource(),
-        0,
-        m_scratch.Resource(),
-        compactionInfoStartOffset,
-        sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC));
+    m_compactionInfoReady.store(false, std::memory_order_relaxed);
+    GpuMemory::EnqueueReadback(cmdList, m_scratch.Resource(), compactionInfoStartOffset,
+        sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC),
+        fastdelegate::MakeDelegate(this, &StaticBLAS::CompactionInfoReadbackCallback));
 
     cmdList.PIXEndEvent();
 
@@ -275,27 +389,253 @@ void StaticBLAS::Rebuild(ComputeCmdList& cmdList)
     m_scratchHeapOffsetInBytes = UINT32_MAX;
 }
 
-void StaticBLAS::DoCompaction(ComputeCmdList& cmdList)
+void StaticBLAS::CompactionInfoReadbackCallback(Span<uint8_t> data)
 {
     D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC compactDesc;
+    Assert(data.size() == sizeof(compactDesc), "Unexpected readback size.");
+    memcpy(&compactDesc, data.data(), sizeof(compactDesc));
 
-    m_postBuildInfoReadback.Map();
-    memcpy(&compactDesc, m_postBuildInfoReadback.MappedMemory(), sizeof(compactDesc));
+    m_compactedSizeInBytes = compactDesc.CompactedSizeInBytes;
+    m_compactionInfoReady.store(true, std::memory_order_release);
+}
 
-    Check(compactDesc.CompactedSizeInBytes > 0, "Invalid RtAS compacted size.");
+void StaticBLAS::DoCompaction(ComputeCmdList& cmdList)
+{
+    Check(m_compactedSizeInBytes > 0, "Invalid RtAS compacted size.");
     LOG_UI_INFO("Allocated compacted static BLAS (%llu MB -> %llu MB).", 
         m_prebuildInfo.ResultDataMaxSizeInBytes / (1024 * 1024),
-        compactDesc.CompactedSizeInBytes / (1024 * 1024));
+        m_compactedSizeInBytes / (1024 * 1024));
 
     // Allocate a new BLAS with compacted size
     m_bufferCompacted = GpuMemory::GetDefaultHeapBuffer("CompactStaticBLAS",
-        (uint32_t)compactDesc.CompactedSizeInBytes,
+        (uint32_t)m_compactedSizeInBytes,
         true,
         true);
 
     cmdList.PIXBeginEvent("StaticBLAS_Compaction");
     cmdList.CompactAccelerationStructure(m_bufferCompacted.GpuVA(), m_buffer.GpuVA());
+
+    // Ask for the serialized size of the compacted BLAS. Scratch buffer is free at this
+    // point and stays alive until compaction has finished.
+    if (m_cacheKey)
+    {
+        auto barrier = Direct3DUtil::BufferBarrier(m_bufferCompacted.Resource(),
+            D3D12_BARRIER_SYNC_COPY_RAYTRACING_ACCELERATION_STRUCTURE,
+            D3D12_BARRIER_SYNC_EMIT_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO,
+            D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE,
+            D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ);
+
+        cmdList.ResourceBarrier(barrier);
+
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC infoDesc;
+        infoDesc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_SERIALIZATION;
+        infoDesc.DestBuffer = m_scratch.GpuVA();
+        const D3D12_GPU_VIRTUAL_ADDRESS src = m_bufferCompacted.GpuVA();
+
+        cmdList.EmitRaytracingAccelerationStructurePostbuildInfo(&infoDesc, 1, &src);
+
+        barrier = Direct3DUtil::BufferBarrier(m_scratch.Resource(),
+            D3D12_BARRIER_SYNC_EMIT_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO,
+            D3D12_BARRIER_SYNC_COPY,
+            D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+            D3D12_BARRIER_ACCESS_COPY_SOURCE);
+
+        cmdList.ResourceBarrier(barrier);
+
+        m_serializationInfoReady.store(false, std::memory_order_relaxed);
+        GpuMemory::EnqueueReadback(cmdList, m_scratch.Resource(), 0,
+            sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_SERIALIZATION_DESC),
+            fastdelegate::MakeDelegate(this, &StaticBLAS::SerializationInfoReadbackCallback));
+    }
+
+    cmdList.PIXEndEvent();
+}
+
+void StaticBLAS::ComputeCacheKey()
+{
+    SceneCore& scene = App::GetScene();
+
+    XXH3_state_t state;
+    XXH3_64bits_reset(&state);
+
+    const uint64_t meshHash = scene.GetMeshContentHash();
+    XXH3_64bits_update(&state, &meshHash, sizeof(meshHash));
+    const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS flags = BuildFlags(RT_MESH_MODE::STATIC);
+    XXH3_64bits_update(&state, &flags, sizeof(flags));
+
+    // Everything that goes into the geometry descs of Rebuild()
+    ForEachStaticInstance(scene, m_baseInstance, m_numInstances,
+        [&state, &scene](const auto& treeLevel, size_t i, uint32_t)
+        {
+            const TriangleMesh* mesh = scene.GetMesh(treeLevel.m_meshIDs[i]).value();
+            const uint32_t geo[7] = { mesh->m_vtxBuffStartOffset, mesh->m_numVertices, 
+                mesh->m_gpuIdxBuffOffset, mesh->m_numIndices, 
+                RT_Flags::Decode(treeLevel.m_rtFlags[i]).IsOpaque,
+                (uint32_t)VERTEX_POSITION_FORMAT, (uint32_t)IndexFormat(*mesh) };
+
+            XXH3_64bits_update(&state, geo, sizeof(geo));
+            XXH3_64bits_update(&state, &treeLevel.m_toWorlds[i], sizeof(float4x3));
+        });
+
+    // Zero means no caching
+    m_cacheKey = Max(XXH3_64bits_digest(&state), 1llu);
+}
+
+bool StaticBLAS::LoadFromCache()
+{
+    Assert(m_cacheKey, "Invalid call.");
+
+    App::Filesystem::Path path;
+    StaticBLASCachePath(m_cacheKey, path);
+
+    constexpr size_t MIN_SIZE = sizeof(StaticBLASCacheHeader) + 
+        sizeof(D3D12_SERIALIZED_RAYTRACING_ACCELERATION_STRUCTURE_HEADER);
+    if (!App::Filesystem::Exists(path.Get()) || App::Filesystem::GetFileSize(path.Get()) <= MIN_SIZE)
+        return false;
+
+    Vector<uint8_t, SystemAllocator> blob;
+    App::Filesystem::LoadFromFile(path.Get(), blob);
+
+    StaticBLASCacheHeader header;
+    memcpy(&header, blob.data(), sizeof(header));
+
+    D3D12_SERIALIZED_RAYTRACING_ACCELERATION_STRUCTURE_HEADER asHeader;
+    memcpy(&asHeader, blob.data() + sizeof(header), sizeof(asHeader));
+    const uint64_t serializedSizeInBytes = blob.size() - sizeof(header);
+
+    if (header.Magic != StaticBLASCacheHeader::MAGIC || 
+        header.Version != StaticBLASCacheHeader::VERSION ||
+        header.Key != m_cacheKey ||
+        asHeader.SerializedSizeInBytesIncludingHeader != serializedSizeInBytes ||
+        asHeader.NumBottomLevelAccelerationStructurePointersAfterHeader != 0)
+    {
+        LOG_UI_INFO("Static BLAS cache %s is corrupted.", path.Get());
+        return false;
+    }
+
+    auto* device = App::GetRenderer().GetDevice();
+    const D3D12_DRIVER_MATCHING_IDENTIFIER_STATUS status = device->CheckDriverMatchingIdentifier(
+        D3D12_SERIALIZED_DATA_RAYTRACING_ACCELERATION_STRUCTURE, &asHeader.DriverMatchingIdentifier);
+
+    // Rebuilt and written again after compaction
+    if (status != D3D12_DRIVER_MATCHING_IDENTIFIER_COMPATIBLE_WITH_DEVICE)
+    {
+        LOG_UI_INFO("Static BLAS cache %s has driver mismatch.", path.Get());
+        return false;
+    }
+
+    Assert(serializedSizeInBytes < UINT32_MAX && asHeader.DeserializedSizeInBytes < UINT32_MAX,
+        "Allocation size exceeded maximum allowed.");
+
+    m_serialized = GpuMemory::GetDefaultHeapBufferAndInit("StaticBLAS_Serialized",
+        (uint32_t)serializedSizeInBytes, false,
+        MemoryRegion{ .Data = blob.data() + sizeof(header), .SizeInBytes = serializedSizeInBytes });
+    m_buffer = GpuMemory::GetDefaultHeapBuffer("StaticBLAS",
+        (uint32_t)asHeader.DeserializedSizeInBytes,
+        true,
+        true);
+
+    m_loadedFromCache = true;
+
+    return true;
+}
+
+void StaticBLAS::Deserialize(ComputeCmdList& cmdList)
+{
+    Assert(m_loadedFromCache, "Invalid call.");
+
+    cmdList.PIXBeginEvent("StaticBLAS_Deserialize");
+    cmdList.DeserializeAccelerationStructure(m_buffer.GpuVA(), m_serialized.GpuVA());
+    cmdList.PIXEndEvent();
+
+    // Source is released in a later frame (see TLAS::UpdateStaticBLASCache())
+    m_loadedFromCache = false;
+    m_cacheKey = 0;
+    m_compacted = true;
+}
+
+void StaticBLAS::SerializationInfoReadbackCallback(Span<uint8_t> data)
+{
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_SERIALIZATION_DESC desc;
+    Assert(data.size() == sizeof(desc), "Unexpected readback size.");
+    memcpy(&desc, data.data(), sizeof(desc));
+
+    m_serializedSizeInBytes = desc.SerializedSizeInBytes;
+    m_serializationInfoReady.store(true, std::memory_order_release);
+}
+
+void StaticBLAS::Serialize(ComputeCmdList& cmdList)
+{
+    Assert(m_compacted, "Only compacted BLASes are serialized.");
+    Check(m_serializedSizeInBytes > 0, "Invalid RtAS serialized size.");
+    Assert(m_serializedSizeInBytes < UINT32_MAX, "Allocation size exceeded maximum allowed.");
+
+    m_serialized = GpuMemory::GetDefaultHeapBuffer("StaticBLAS_Serialized",
+        (uint32_t)m_serializedSizeInBytes,
+        false,
+        true);
+
+    cmdList.PIXBeginEvent("StaticBLAS_Serialize");
+    cmdList.SerializeAccelerationStructure(m_serialized.GpuVA(), m_buffer.GpuVA());
+
+    auto barrier = Direct3DUtil::BufferBarrier(m_serialized.Resource(),
+        D3D12_BARRIER_SYNC_COPY_RAYTRACING_ACCELERATION_STRUCTURE,
+        D3D12_BARRIER_SYNC_COPY,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+        D3D12_BARRIER_ACCESS_COPY_SOURCE);
+
+    cmdList.ResourceBarrier(barrier);
+
+    m_cacheWritten.store(false, std::memory_order_relaxed);
+    GpuMemory::EnqueueReadback(cmdList, m_serialized.Resource(), 0, 
+        (uint32_t)m_serializedSizeInBytes,
+        fastdelegate::MakeDelegate(this, &StaticBLAS::SerializedReadbackCallback));
+
     cmdList.PIXEndEvent();
+
+    m_serializationInfoReady.store(false, std::memory_order_relaxed);
+}
+
+void StaticBLAS::SerializedReadbackCallback(Span<uint8_t> data)
+{
+    const StaticBLASCacheHeader header{ .Magic = StaticBLASCacheHeader::MAGIC,
+        .Version = StaticBLASCacheHeader::VERSION,
+        .Key = m_cacheKey };
+
+    Vector<uint8_t, SystemAllocator> file;
+    file.resize(sizeof(header) + data.size());
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(header), data.data(), data.size());
+
+    App::Filesystem::Path path;
+    StaticBLASCachePath(m_cacheKey, path);
+    App::Filesystem::WriteToFile(path.Get(), file.data(), (uint32_t)file.size());
+
+    LOG_UI_INFO("Wrote static BLAS cache %s (%llu MB).", path.Get(), 
+        data.size() / (1024 * 1024));
+
+    m_cacheWritten.store(true, std::memory_order_release);
+}
+
+void StaticBLAS::Reset()
+{
+    Assert(!m_heapAllocationInProgress, "Heap allocation is in progress.");
+
+    m_buffer.Reset();
+    m_bufferCompacted.Reset();
+    m_scratch.Reset();
+    m_perMeshTransform.Reset();
+    m_resHeap.Reset();
+    m_prebuildInfo = {};
+    m_compactedSizeInBytes = 0;
+    m_compactionInfoReady.store(false, std::memory_order_relaxed);
+    m_compactionCompleted.store(false, std::memory_order_relaxed);
+    m_heapAllocated.store(false, std::memory_order_relaxed);
+    m_BLASHeapOffsetInBytes = UINT32_MAX;
+    m_scratchHeapOffsetInBytes = UINT32_MAX;
+    m_compacted = false;
+    m_serialized.Reset();
+    m_cacheKey = 0;
 }
 
 void StaticBLAS::CompactionCompletedCallback()
@@ -304,9 +644,7 @@ void StaticBLAS::CompactionCompletedCallback()
     m_heapAllocated.store(false, std::memory_order_relaxed);
 
     // Release resources that are not needed anymore
-    m_postBuildInfoReadback.Unmap();
     m_scratch.Reset();
-    m_postBuildInfoReadback.Reset();
     m_perMeshTransform.Reset();
     m_resHeap.Reset();
 }
@@ -341,11 +679,16 @@ void TLAS::FillMeshInstanceData(uint64_t instanceID, uint64_t meshID, const floa
 
     m_frameInstanceData[currInstance].MatIdx = (uint16_t)matBufferIdx;
     m_frameInstanceData[currInstance].BaseVtxOffset = mesh->m_vtxBuffStartOffset;
-    m_frameInstanceData[currInstance].BaseIdxOffset = mesh->m_idxBuffStartOffset;
+    m_frameInstanceData[currInstance].BaseIdxOffset = mesh->m_gpuIdxBuffOffset |
+        (mesh->Uses16BitIndices() ? MESH_INSTANCE_16BIT_INDICES : 0);
     m_frameInstanceData[currInstance].Rotation = unorm4::FromNormalized(r);
     m_frameInstanceData[currInstance].Scale = half3(s);
     m_frameInstanceData[currInstance].Translation = float3(t.x, t.y, t.z);
     m_frameInstanceData[currInstance].BaseEmissiveTriOffset = emissiveTriOffset;
+#if COMPACT_VERTEX == 1
+    m_frameInstanceData[currInstance].PosCenter = mesh->m_AABB.Center;
+    m_frameInstanceData[currInstance].PosExtents = mesh->QuantizationExtents();
+#endif
 
     const uint32_t texIdx = mat->GetBaseColorTex();
     m_frameInstanceData[currInstance].BaseColorTex = texIdx == Material::INVALID_ID ?
@@ -399,7 +742,8 @@ void TLAS::RebuildFrameMeshInstanceData()
     // | SM 0 | SM 1 | ... | SM N - 1 | DM 0 | DM 1 | ... | DM D - 1 |
     //  -------------------------------------------------------------
     // 
-    //  - TLAS instance for static BLAS has instanceID of 0. 
+    //  - TLAS instance for static BLAS c has InstanceID of its first static instance, and
+    //    static instance i in it has GeometryIndex of i - InstanceID
     //  - TLAS instance for dynamic BLAS d where 0 <= d < D has InstanceID of N + d
     //  - With this setup, every instance can use GeometryIndex() + InstanceID() to index 
     //    into the mesh instance buffer
@@ -407,34 +751,24 @@ void TLAS::RebuildFrameMeshInstanceData()
     // Static meshes
     if (scene.m_numStaticInstances)
     {
-        for (size_t treeLevelIdx = 1; treeLevelIdx < scene.m_sceneGraph.size(); treeLevelIdx++)
-        {
-            auto& currTreeLevel = scene.m_sceneGraph[treeLevelIdx];
-            const auto& rtFlagVec = currTreeLevel.m_rtFlags;
-
-            for (size_t i = 0; i < rtFlagVec.size(); i++)
+        ForEachStaticInstance(scene, 0, scene.m_numStaticInstances,
+            [this, &scene, &currInstance, sceneHasEmissives](const auto& currTreeLevel, size_t i, 
+                uint32_t staticIdx)
             {
                 const auto rtFlags = RT_Flags::Decode(currTreeLevel.m_rtFlags[i]);
-                const uint64_t meshID = currTreeLevel.m_meshIDs[i];
-                if (meshID == Scene::INVALID_MESH)
-                    continue;
-
-                if (rtFlags.MeshMode == RT_MESH_MODE::STATIC)
-                {
-                    const uint64_t instanceID = currTreeLevel.m_IDs[i];
-                    const uint32_t emissiveTriOffset = sceneHasEmissives &&
-                        (rtFlags.InstanceMask & RT_AS_SUBGROUP::EMISSIVE) ?
-                        scene.m_emissives.FindInstance(instanceID).value()->BaseTriOffset :
-                        UINT32_MAX;
+                const uint64_t instanceID = currTreeLevel.m_IDs[i];
+                const uint32_t emissiveTriOffset = sceneHasEmissives &&
+                    (rtFlags.InstanceMask & RT_AS_SUBGROUP::EMISSIVE) ?
+                    scene.m_emissives.FindInstance(instanceID).value()->BaseTriOffset :
+                    UINT32_MAX;
 
-                    FillMeshInstanceData(instanceID, meshID, currTreeLevel.m_toWorlds[i], 
-                        emissiveTriOffset, true, (uint32)currInstance);
+                FillMeshInstanceData(instanceID, currTreeLevel.m_meshIDs[i], 
+                    currTreeLevel.m_toWorlds[i], emissiveTriOffset, true, staticIdx);
 
-                    // Update RT mesh to instance ID map
-                    scene.m_rtMeshInstanceIdxToID[currInstance++] = currTreeLevel.m_IDs[i];
-                }
-            }
-        }
+                // Update RT mesh to instance ID map
+                scene.m_rtMeshInstanceIdxToID[staticIdx] = instanceID;
+                currInstance++;
+            });
     }
 
     Assert(currInstance == scene.m_numStaticInstances, "Invalid instance count.");
@@ -476,25 +810,27 @@ void TLAS::RebuildFrameMeshInstanceData()
 
     const uint32_t sizeInBytes = numInstances * sizeof(RT::MeshInstance);
 
+    // UAV access for transform updates on the GPU
     PlacedResourceList<2> list;
-    list.PushBuffer(sizeInBytes, false, false);
-    list.PushBuffer(sizeInBytes, false, false);
+    list.PushBuffer(sizeInBytes, true, false);
+    list.PushBuffer(sizeInBytes, true, false);
     list.End();
-    m_meshInstanceResHeap = GpuMemory::GetResourceHeap(list.TotalSizeInBytes());
+    m_meshInstanceResHeap = GpuMemory::GetResourceHeap("MeshInstances", list.TotalSizeInBytes(), 
+        MEMORY_CATEGORY::BUFFER);
 
     m_framesMeshInstances[m_frameIdx] = GpuMemory::GetPlacedHeapBufferAndInit(
         GlobalResource::RT_FRAME_MESH_INSTANCES_CURR,
         sizeInBytes,
         m_meshInstanceResHeap.Heap(),
         list.AllocInfos()[0].Offset,
-        false,
+        true,
         MemoryRegion{ .Data = m_frameInstanceData.data(), .SizeInBytes = sizeInBytes });
     m_framesMeshInstances[1 - m_frameIdx] = GpuMemory::GetPlacedHeapBufferAndInit(
         GlobalResource::RT_FRAME_MESH_INSTANCES_PREV,
         sizeInBytes,
         m_meshInstanceResHeap.Heap(),
         list.AllocInfos()[1].Offset,
-        false,
+        true,
         MemoryRegion{ .Data = m_frameInstanceData.data(), .SizeInBytes = sizeInBytes });
 
     // Register the shared resources
@@ -512,19 +848,26 @@ void TLAS::UpdateFrameMeshInstances_StaticToDynamic()
     const bool sceneHasEmissives = scene.NumEmissiveInstances() > 0;
     uint32_t copyStartOffset = UINT32_MAX;
 
+    // Dynamic instances are moved and uploaded below, so their transforms have to  
+    // be up to date (uses the old layout)
+    if (m_frameInstanceDataStale)
+        RefreshDynamicFrameMeshInstances();
+
     // Note: GetInstanceRtASInfo() calls must happen before m_rtASInfo is updated 
-    // (by RebuildTLASInstances() & StaticBLAS::Rebuild())
+    // (by RebuildTLASInstances() & UpdateStaticRtASInfos())
+
+    // For static meshes, GeometryIndex + InstanceID is the index into the frame instance array
+    auto staticIdx = [&scene](uint64_t instance)
+        {
+            const RT_AS_Info asInfo = scene.GetInstanceRtASInfo(instance);
+            return asInfo.GeometryIndex + asInfo.InstanceID;
+        };
 
     // Sort in descending order (see visualization below)
     std::sort(scene.m_pendingRtMeshModeSwitch.begin(), scene.m_pendingRtMeshModeSwitch.end(),
-        [&scene](const uint64_t& lhs, const uint64_t& rhs)
+        [&staticIdx](const uint64_t& lhs, const uint64_t& rhs)
         {
-            RT_AS_Info lhsAsInfo = scene.GetInstanceRtASInfo(lhs);
-            RT_AS_Info rhsAsInfo = scene.GetInstanceRtASInfo(rhs);
-            Assert(lhsAsInfo.InstanceID == 0 && rhsAsInfo.InstanceID == 0, 
-                "InstanceID for static meshes must be zero.");
-
-            return lhsAsInfo.GeometryIndex > rhsAsInfo.GeometryIndex;
+            return staticIdx(lhs) > staticIdx(rhs);
         });
 
     // Shift left
@@ -536,21 +879,20 @@ void TLAS::UpdateFrameMeshInstances_StaticToDynamic()
     //                     | 0 | 1 | 3 | 5 | 6 | 7 | 8 | 8 | 8
     for (size_t i = 0; i < scene.m_pendingRtMeshModeSwitch.size(); i++)
     {
-        const auto instance = scene.m_pendingRtMeshModeSwitch[i];
-        const RT_AS_Info asInfo = scene.GetInstanceRtASInfo(instance);
+        const uint32_t idx = staticIdx(scene.m_pendingRtMeshModeSwitch[i]);
         // One less instance to move per iteration
-        const int64 numToMove = numInstances - asInfo.GeometryIndex - 1 - i;
+        const int64 numToMove = numInstances - idx - 1 - i;
 
-        memmove(m_frameInstanceData.data() + asInfo.GeometryIndex,
-            m_frameInstanceData.data() + asInfo.GeometryIndex + 1,
+        memmove(m_frameInstanceData.data() + idx,
+            m_frameInstanceData.data() + idx + 1,
             numToMove * sizeof(RT::MeshInstance));
-        memmove(scene.m_rtMeshInstanceIdxToID.data() + asInfo.GeometryIndex,
-            scene.m_rtMeshInstanceIdxToID.data() + asInfo.GeometryIndex + 1,
+        memmove(scene.m_rtMeshInstanceIdxToID.data() + idx,
+            scene.m_rtMeshInstanceIdxToID.data() + idx + 1,
             numToMove * sizeof(uint64_t));
 
         // Last element is the smallest
         if (i == scene.m_pendingRtMeshModeSwitch.size() - 1)
-            copyStartOffset = asInfo.GeometryIndex;
+            copyStartOffset = idx;
     }
 
     uint32_t currInstance = numInstances - (uint32)scene.m_pendingRtMeshModeSwitch.size();
@@ -654,14 +996,12 @@ void TLAS::UpdateFrameMeshInstances_NewTransform()
     int64 minIdx = m_dynamicBLASes.size() - 1;
     int64 maxIdx = 0;
 
-    for (auto it = scene.m_instanceUpdates.begin_it(); it != scene.m_instanceUpdates.end_it();
-        it = scene.m_instanceUpdates.next_it(it))
+    for (const auto& u : scene.GetRenderSnapshot().InstanceUpdates)
     {
-        const auto instance = it->Key;
-        const auto treePos = scene.FindTreePosFromID(instance).value();
-        const auto& treeLevel = scene.m_sceneGraph[treePos.Level];
+        const auto instance = u.ID;
+        const SceneCore::TreePos treePos{ .Level = u.TreeLevel, .Offset = u.LevelIdx };
 
-        const auto rtFlags = RT_Flags::Decode(treeLevel.m_rtFlags[treePos.Offset]);
+        const auto rtFlags = RT_Flags::Decode(u.RtFlags);
         const uint32_t emissiveTriOffset = sceneHasEmissives &&
             (rtFlags.InstanceMask & RT_AS_SUBGROUP::EMISSIVE) ?
             scene.m_emissives.FindInstance(instance).value()->BaseTriOffset :
@@ -684,8 +1024,8 @@ void TLAS::UpdateFrameMeshInstances_NewTransform()
             "Dynamic BLAS for instance was not found.");
         const auto idx = vecIt - m_dynamicBLASes.begin();
 
-        FillMeshInstanceData(instance, treeLevel.m_meshIDs[treePos.Offset],
-            treeLevel.m_toWorlds[treePos.Offset], 
+        FillMeshInstanceData(instance, DynamicBLASMeshID(blas),
+            u.ToWorld, 
             emissiveTriOffset, 
             false, 
             blas.InstanceID);
@@ -705,85 +1045,253 @@ void TLAS::UpdateFrameMeshInstances_NewTransform()
         (uint32)(offset * sizeof(RT::MeshInstance)));
 }
 
-void TLAS::Update()
+void TLAS::GatherInstanceTransformUpdates()
 {
     SceneCore& scene = App::GetScene();
-    m_frameIdx = 1 - m_frameIdx;
-    ID3D12Heap* heap = nullptr;
-    uint32_t meshTransformHeapOffsetInBytes = 0;
+    const auto currFrame = App::GetTimer().GetTotalFrameCount();
+    // Skip static instances
+    const uint32_t firstDynamicTLASInstance = NumStaticTLASInstances();
+
+    const auto& snapshot = scene.GetRenderSnapshot();
+    m_transformUpdates.clear();
+    m_transformUpdates.reserve(snapshot.InstanceUpdates.size());
 
-    // Avoid rebuild while compaction is in progress (it'll be queued up for later)
-    if (!scene.m_pendingRtMeshModeSwitch.empty() && m_staticBLASCompacted)
+    for (const auto& update : snapshot.InstanceUpdates)
     {
-        Assert(m_staticBLAS.m_prebuildInfo.ResultDataMaxSizeInBytes != UINT32_MAX,
-            "Unexpected value.");
+        const DynamicBLAS& blas = FindDynamicBLAS(m_dynamicBLASes, 
+            DynamicBLASKey(update.TreeLevel, update.LevelIdx));
+        const uint32_t idx = (uint32_t)(&blas - m_dynamicBLASes.data());
 
-        // Use the same buffer for scratch and compaction info
-        const uint32_t compactionInfoStartOffset = (uint32_t)AlignUp(
-            m_staticBLAS.m_prebuildInfo.ScratchDataSizeInBytes,
-            alignof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC));
-        const uint32_t scratchBufferSizeInBytes = compactionInfoStartOffset +
-            sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC);
+        const float4x3& M = update.ToWorld;
+        const float4x3& M_prev = update.PrevToWorld;
 
-        PlacedResourceList<3> list;
-        // BLAS (before compaction)
-        list.PushBuffer((uint32_t)m_staticBLAS.m_prebuildInfo.ResultDataMaxSizeInBytes, true, true);
-        // Scratch buffer & compaction info
-        list.PushBuffer(scratchBufferSizeInBytes, true, false);
-        // Per mesh transform during BLAS build
-        list.PushBuffer(scene.m_numStaticInstances * sizeof(BLASTransform), true, false);
-        list.End();
+        InstanceTransformUpdate u;
 
-        // Do heap allocation on a background thread to avoid a hitch
-        if (m_staticBLAS.m_heapAllocated.load(std::memory_order_acquire))
+        for (int j = 0; j < 4; j++)
         {
-            Assert(m_staticBLAS.m_resHeap.IsInitialized(), "Unexpected condition.");
-            heap = m_staticBLAS.m_resHeap.Heap();
-
-            auto allocs = list.AllocInfos();
-            m_staticBLAS.m_BLASHeapOffsetInBytes = (uint32)allocs[0].Offset;
-            m_staticBLAS.m_scratchHeapOffsetInBytes = (uint32)allocs[1].Offset;
-            meshTransformHeapOffsetInBytes = (uint32)allocs[2].Offset;
-
-            m_updateType = UPDATE_TYPE::STATIC_TO_DYNAMIC;
-            m_staticBLASCompacted = false;
-            m_staticBLAS.m_heapAllocationInProgress = false;
+            u.M[j] = M.m[j];
+            u.PrevM[j] = M_prev.m[j];
         }
-        else if(!m_staticBLAS.m_heapAllocationInProgress)
-        {
-            const uint64_t heapSizeInBytes = list.TotalSizeInBytes();
-            m_staticBLAS.m_heapAllocationInProgress = true;
 
-            Task t("AllocateHeap", TASK_PRIORITY::BACKGROUND, [this, heapSizeInBytes]()
-                {
-                    m_staticBLAS.m_resHeap = GpuMemory::GetResourceHeap(heapSizeInBytes);
-                    m_staticBLAS.m_heapAllocated.store(true, std::memory_order_release);
-                });
+        // Mesh instances are double buffered and need the update for a few more frames 
+        // (until previous transform catches up), whereas TLAS instances only need the 
+        // new transform (same check as UpdateTLASInstances_NewTransform())
+        u.TLASInstanceIdx = update.Frame < currFrame - 1 ? UINT32_MAX : firstDynamicTLASInstance + idx;
+        u.MeshInstanceIdx = blas.InstanceID;
 
-            App::SubmitBackground(ZetaMove(t));
-        }
-    }
-    // Make sure updates are performed even if compaction is in progress 
-    // (when m_staticBLASCompacted = false)
-    else if (!scene.m_instanceUpdates.empty())
-    {
-        m_updateType = UPDATE_TYPE::INSTANCE_TRANSFORM;
+        m_transformUpdates.push_back(u);
     }
 
-    const bool firstTime = m_frameInstanceData.empty();
+    m_frameInstanceDataStale = true;
+}
 
-    if (firstTime || m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC)
+void TLAS::RefreshDynamicFrameMeshInstances()
+{
+    SceneCore& scene = App::GetScene();
+
+    for (const auto& blas : m_dynamicBLASes)
     {
-        Assert(firstTime || heap, "Invalid condition.");
-        m_staticBLAS.FillMeshTransformBufferForBuild(heap, meshTransformHeapOffsetInBytes);
+        const auto& treeLevel = scene.m_sceneGraph[blas.TreeLevel];
+        const uint64_t instance = scene.m_rtMeshInstanceIdxToID[blas.InstanceID];
+
+        // Emissive offset doesn't change with the transform
+        FillMeshInstanceData(instance, DynamicBLASMeshID(blas), 
+            treeLevel.m_toWorlds[blas.LevelIdx],
+            m_frameInstanceData[blas.InstanceID].BaseEmissiveTriOffset,
+            false,
+            blas.InstanceID);
     }
 
-    if(firstTime)
-        RebuildFrameMeshInstanceData();
+    m_frameInstanceDataStale = false;
+}
+
+void TLAS::OnMemoryPressure(GpuMemory::MEMORY_PRESSURE p)
+{
+    // Dynamic BLASes are updated and traced every frame, so their pages are only demoted 
+    // after the scene textures (see SceneCore), once usage is over the budget
+    const D3D12_RESIDENCY_PRIORITY priority = p == GpuMemory::MEMORY_PRESSURE::CRITICAL ?
+        D3D12_RESIDENCY_PRIORITY_LOW : D3D12_RESIDENCY_PRIORITY_NORMAL;
+
+    // Arena pages are allocated, released and defragmented by Render(), apply it from 
+    // there rather than racing with it
+    m_requestedBLASPagePriority.store(priority, std::memory_order_relaxed);
+}
+
+void TLAS::UpdateBLASPagePriority()
+{
+    const D3D12_RESIDENCY_PRIORITY priority = (D3D12_RESIDENCY_PRIORITY)
+        m_requestedBLASPagePriority.load(std::memory_order_relaxed);
+
+    if (priority == m_blasPagePriority)
+        return;
+
+    SmallVector<ID3D12Pageable*, SystemAllocator, 4> pages;
+    for (auto& page : m_dynamicBLASArenas)
+        pages.push_back(page.Page.Resource());
+
+    GpuMemory::SetResidencyPriority(pages, priority);
+    m_blasPagePriority = priority;
+}
+
+void TLAS::Update()
+{
+    ZETA_CPU_EVENT_SCOPE("TLAS::Update");
+    SceneCore& scene = App::GetScene();
+
+    // Instances are still being added, the first build happens once loading is done
+    if (scene.IsLoading())
+        return;
+
+    m_frameIdx = 1 - m_frameIdx;
+    m_tlasIdx = (m_tlasIdx + 1) % NUM_TLAS_BUFFERS;
+
+    // Runs before the transform updates below, which might upload the same mesh instances
+    for (auto instanceID : m_pendingLODMeshInstances)
+        UploadMeshInstanceIdxOffset(instanceID);
+
+    m_pendingLODMeshInstances.clear();
+
+    // Mesh instances move around during a switch to dynamic, LODs are picked up again 
+    // once it's done
+    if (!m_dynamicBLASes.empty() && scene.m_pendingRtMeshModeSwitch.empty())
+    {
+        CommitDynamicBLASLODs();
+        SelectDynamicBLASLODs();
+    }
+
+    // Avoid rebuild while compaction or writing to cache is in progress (it'll be 
+    // queued up for later)
+    if (!scene.m_pendingRtMeshModeSwitch.empty() && StaticBLASesCompacted() && 
+        !StaticBLASCacheWritesPending())
+    {
+        // Only the static BLASes containing the switched instances need a rebuild
+        const uint32_t rebuildMask = ModeSwitchStaticBLASMask();
+        bool heapsAllocated = true;
+
+        for (int c = 0; c < m_numStaticBLASes; c++)
+        {
+            StaticBLAS& blas = m_staticBLASes[c];
+
+            if (!(rebuildMask & (1u << c)) || blas.m_heapAllocated.load(std::memory_order_acquire))
+                continue;
+
+            // Loaded from cache, Rebuild() queries the prebuild info and allocates the heap
+            if (blas.m_prebuildInfo.ResultDataMaxSizeInBytes == 0)
+                continue;
+
+            heapsAllocated = false;
+
+            // Do heap allocation on a background thread to avoid a hitch
+            if (!blas.m_heapAllocationInProgress)
+            {
+                const uint64_t heapSizeInBytes = blas.RebuildResourceList().TotalSizeInBytes();
+                blas.m_heapAllocationInProgress = true;
+
+                Task t("AllocateHeap", TASK_PRIORITY::BACKGROUND, [&blas, heapSizeInBytes]()
+                    {
+                        blas.m_resHeap = GpuMemory::GetResourceHeap("DynamicBLAS", heapSizeInBytes, 
+                            MEMORY_CATEGORY::RT_AS);
+                        blas.m_heapAllocated.store(true, std::memory_order_release);
+                    });
+
+                App::SubmitBackground(ZetaMove(t));
+            }
+        }
+
+        // Switch once the new dynamic BLASes have been built
+        const bool stagedBLASesReady = m_numUnbuiltStagedBLASes == 0 &&
+            m_stagedBLASes.size() == scene.m_pendingRtMeshModeSwitch.size();
+
+        if (heapsAllocated && stagedBLASesReady)
+        {
+            RemoveModeSwitchInstancesFromStaticBLASes();
+            m_staticBLASRebuildMask = 0;
+
+            for (int c = 0; c < m_numStaticBLASes; c++)
+            {
+                if (!(rebuildMask & (1u << c)))
+                    continue;
+
+                StaticBLAS& blas = m_staticBLASes[c];
+                blas.m_heapAllocationInProgress = false;
+
+                // Every instance in this BLAS became dynamic
+                if (!blas.m_numInstances)
+                {
+                    blas.Reset();
+                    continue;
+                }
+
+                blas.m_compacted = false;
+
+                if (blas.m_resHeap.IsInitialized())
+                {
+                    // Heap was sized for the old instance count, which is an upper bound
+                    auto list = blas.RebuildResourceList();
+                    auto allocs = list.AllocInfos();
+                    blas.m_BLASHeapOffsetInBytes = (uint32)allocs[0].Offset;
+                    blas.m_scratchHeapOffsetInBytes = (uint32)allocs[1].Offset;
+                    blas.FillMeshTransformBufferForBuild(blas.m_resHeap.Heap(), 
+                        (uint32)allocs[2].Offset);
+                }
+                else
+                    blas.FillMeshTransformBufferForBuild();
+
+                m_staticBLASRebuildMask |= (1u << c);
+            }
+
+            m_updateType = UPDATE_TYPE::STATIC_TO_DYNAMIC;
+        }
+    }
+    // Make sure updates are performed even if compaction is in progress 
+    // (when static BLASes aren't compacted yet)
+    else if (!scene.GetRenderSnapshot().InstanceUpdates.empty())
+    {
+        m_updateType = UPDATE_TYPE::INSTANCE_TRANSFORM;
+    }
+
+    const bool firstTime = m_frameInstanceData.empty();
+
+    if (firstTime)
+    {
+        ZETA_CPU_EVENT_SCOPE("TLAS::PartitionStaticBLASes");
+
+        // Normally done by the scene during emissive initialization
+        if (scene.m_rtStaticInstanceOrder.size() != scene.m_numStaticInstances)
+            scene.SortRtStaticInstances();
+
+        PartitionStaticBLASes();
+
+        for (int c = 0; c < m_numStaticBLASes; c++)
+        {
+            StaticBLAS& blas = m_staticBLASes[c];
+            blas.ComputeCacheKey();
+
+            // Transforms are only needed for building
+            if (!blas.LoadFromCache())
+                blas.FillMeshTransformBufferForBuild();
+        }
+    }
+
+    if(firstTime)
+    {
+        RebuildFrameMeshInstanceData();
+        UpdateStaticRtASInfos();
+    }
     else if (m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC)
+    {
         UpdateFrameMeshInstances_StaticToDynamic();
+        // Static instances after the switched ones have moved
+        UpdateStaticRtASInfos();
+    }
     else if (m_updateType == UPDATE_TYPE::INSTANCE_TRANSFORM)
-        UpdateFrameMeshInstances_NewTransform();
+    {
+        // Decomposition and the rest happen on the GPU, just gather the new transforms
+        if (m_transformUpdateDlg)
+            GatherInstanceTransformUpdates();
+        else
+            UpdateFrameMeshInstances_NewTransform();
+    }
 }
 
 void TLAS::Render(CommandList& cmdList)
@@ -792,25 +1300,125 @@ void TLAS::Render(CommandList& cmdList)
         cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_COMPUTE, "Invalid downcast.");
     ComputeCmdList& computeCmdList = static_cast<ComputeCmdList&>(cmdList);
 
+    // See TLAS::Update()
+    if (App::GetScene().IsLoading())
+        return;
+
+    ZETA_CPU_EVENT_SCOPE("TLAS::Render");
+
     auto& gpuTimer = App::GetRenderer().GetGpuTimer();
     computeCmdList.PIXBeginEvent("RtAS");
     const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "RtAS");
 
+    // Checked before UpdateTLASInstances() consumes them
+    const bool gpuTransformUpdates = !m_transformUpdates.empty();
+
     RebuildOrUpdateBLASes(computeCmdList);
     UpdateTLASInstances(computeCmdList);
+
+    // On the async. compute queue, this frame's AS builds overlap with the previous 
+    // frame's remaining work. TLAS that's written to was last used by the frame before
+    // that, so only wait for that one, unless previous frame's TLAS and mesh instances 
+    // are overwritten below, or there was a switch from direct queue (TLAS instance 
+    // and scratch buffers are shared between frames). Same goes for transform updates
+    // on the GPU, as they write to the mesh instance buffer that previous frame reads
+    // as its current one.
+    const bool async = cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_COMPUTE;
+
+    if (async)
+    {
+        auto& renderer = App::GetRenderer();
+        const bool waitForPrevFrame = !m_asyncBuildLastFrame ||
+            gpuTransformUpdates ||
+            m_updateType == UPDATE_TYPE::STATIC_BLAS_COMPACTED ||
+            m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC;
+        const uint64_t currFrameFence = renderer.GetCurrentFrameFenceValue();
+        const uint64_t waitFence = currFrameFence - (waitForPrevFrame ? 1 : 2);
+
+        if (waitFence > 0 && renderer.GetCompletedFrameFenceValue() < waitFence)
+            renderer.WaitForFrameOnComputeQueue(waitFence);
+    }
+
+    m_asyncBuildLastFrame = async;
+
     RebuildTLAS(computeCmdList);
 
     gpuTimer.EndQuery(computeCmdList, queryIdx);
     computeCmdList.PIXEndEvent();
 }
 
-void TLAS::BuildDynamicBLASes(ComputeCmdList& cmdList)
+TLAS::DynamicBLAS TLAS::QueueDynamicBLASBuild(uint64_t meshID, uint32_t treeLevel, 
+    uint32_t levelIdx, uint32_t lod, BLAS_LIST list)
 {
     SceneCore& scene = App::GetScene();
+    const TriangleMesh* mesh = scene.GetMesh(scene.GetMeshLODID(meshID, lod)).value();
+    const D3D12_RAYTRACING_GEOMETRY_DESC geoDesc = DynamicBLASGeometryDesc(*mesh, 
+        scene.GetMeshVB().GpuVA(), scene.GetMeshIB().GpuVA());
+
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs;
+    inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+    inputs.Flags = BuildFlags(RT_MESH_MODE::DYNAMIC_NO_REBUILD);
+    inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+    inputs.NumDescs = 1;
+    inputs.pGeometryDescs = &geoDesc;
+
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO buildInfo;
+    App::GetRenderer().GetDevice()->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, 
+        &buildInfo);
+
+    Assert(buildInfo.ResultDataMaxSizeInBytes > 0,
+        "GetRaytracingAccelerationStructurePrebuildInfo() failed.");
 
-    SmallVector<DynamicBlasBuild, App::FrameAllocator> blasBuilds;
-    blasBuilds.reserve(scene.m_numDynamicInstances);
+    // Memory is allocated right away, build happens once there's room in the budget
+    OffsetAllocator::Allocation alloc;
+    const int pageIdx = AllocateDynamicBLAS((uint32_t)buildInfo.ResultDataMaxSizeInBytes, 
+        true, alloc);
+
+    m_pendingBLASBuilds.push_back(PendingBuild{ .BLAS = DynamicBLASKey(treeLevel, levelIdx),
+        .ScratchSizeInBytes = (uint32_t)buildInfo.ScratchDataSizeInBytes,
+        .NumTriangles = mesh->m_numIndices / 3,
+        .List = list });
+
+    // InstanceID is filled in by RebuildTLASInstances()
+    return DynamicBLAS{ .PageIdx = pageIdx,
+        .Alloc = alloc,
+        .TreeLevel = treeLevel,
+        .LevelIdx = levelIdx,
+        .InstanceID = UINT32_MAX,
+        .BuildFrame = BLAS_NOT_BUILT,
+        .LOD = lod,
+        .Compacted = false };
+}
+
+uint64_t TLAS::DynamicBLASMeshID(const DynamicBLAS& blas) const
+{
+    const SceneCore& scene = App::GetScene();
+    const uint64_t meshID = scene.m_sceneGraph[blas.TreeLevel].m_meshIDs[blas.LevelIdx];
+
+    return scene.GetMeshLODID(meshID, blas.LOD);
+}
+
+uint64_t TLAS::FrameMeshInstanceMeshID(uint32_t idx) const
+{
+    const SceneCore& scene = App::GetScene();
+    Assert(idx < scene.m_rtMeshInstanceIdxToID.size(), "Out-of-bounds access.");
+
+    // Dynamic instances are sorted in the same order as their BLASes
+    if (idx >= scene.m_numStaticInstances)
+    {
+        const size_t blasIdx = idx - scene.m_numStaticInstances;
+        if (blasIdx < m_dynamicBLASes.size() && m_dynamicBLASes[blasIdx].InstanceID == idx)
+            return DynamicBLASMeshID(m_dynamicBLASes[blasIdx]);
+    }
+
+    return scene.GetInstanceMeshID(scene.m_rtMeshInstanceIdxToID[idx]);
+}
+
+void TLAS::QueueDynamicBLASBuilds()
+{
+    SceneCore& scene = App::GetScene();
     m_dynamicBLASes.reserve(scene.m_numDynamicInstances);
+    m_pendingBLASBuilds.reserve(scene.m_numDynamicInstances);
 
     // Skip the first level
     for (size_t treeLevelIdx = 1; treeLevelIdx < scene.m_sceneGraph.size(); treeLevelIdx++)
@@ -818,450 +1426,1139 @@ void TLAS::BuildDynamicBLASes(ComputeCmdList& cmdList)
         auto& currTreeLevel = scene.m_sceneGraph[treeLevelIdx];
         auto& rtFlagVec = currTreeLevel.m_rtFlags;
 
-        for (size_t i = 0; i < rtFlagVec.size(); i++)
+        for (size_t i = 0; i < rtFlagVec.size(); i++)
+        {
+            Scene::RT_Flags flags = RT_Flags::Decode(rtFlagVec[i]);
+            Assert((flags.RebuildFlag & flags.UpdateFlag) == 0,
+                "Rebuild & update flags can't be set at the same time.");
+
+            if (flags.MeshMode != RT_MESH_MODE::STATIC)
+            {
+                m_dynamicBLASes.push_back(QueueDynamicBLASBuild(currTreeLevel.m_meshIDs[i],
+                    (uint32_t)treeLevelIdx, (uint32_t)i, 0, BLAS_LIST::ACTIVE));
+
+                rtFlagVec[i] = RT_Flags::Encode(flags.MeshMode, flags.InstanceMask,
+                    0, 0, flags.IsOpaque);
+
+                currTreeLevel.m_rtASInfo[i] = RT_AS_Info{
+                    .GeometryIndex = 0,
+                    .InstanceID = scene.m_numStaticInstances + (uint32)m_dynamicBLASes.size() - 1 };
+            }
+        }
+    }
+}
+
+void TLAS::StageModeSwitchBLASes()
+{
+    SceneCore& scene = App::GetScene();
+
+    // Pending switches are only appended to until the switch goes through
+    for (size_t i = m_stagedBLASes.size(); i < scene.m_pendingRtMeshModeSwitch.size(); i++)
+    {
+        const auto treePos = scene.FindTreePosFromID(scene.m_pendingRtMeshModeSwitch[i]).value();
+        const auto meshID = scene.m_sceneGraph[treePos.Level].m_meshIDs[treePos.Offset];
+
+        m_stagedBLASes.push_back(QueueDynamicBLASBuild(meshID, treePos.Level, treePos.Offset, 
+            0, BLAS_LIST::STAGED));
+        m_numUnbuiltStagedBLASes++;
+    }
+
+    std::sort(m_stagedBLASes.begin(), m_stagedBLASes.end(),
+        [](const DynamicBLAS& lhs, const DynamicBLAS& rhs)
+        {
+            return DynamicBLASLess(lhs.TreeLevel, lhs.LevelIdx, rhs.TreeLevel, rhs.LevelIdx);
+        });
+}
+
+void TLAS::BuildPendingDynamicBLASes(ComputeCmdList& cmdList, Vector<int>& touchedPages)
+{
+    if (m_pendingBLASBuilds.empty())
+        return;
+
+    // Pool has to fit at least the next build
+    const uint32_t minScratchSize = AlignUp(m_pendingBLASBuilds.back().ScratchSizeInBytes,
+        (uint32_t)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+    if (!m_blasScratchPool.IsInitialized() || m_blasScratchPool.Desc().Width < minScratchSize)
+    {
+        m_blasScratchPool = GpuMemory::GetDefaultHeapBuffer("DynamicBLAS_scratch",
+            (uint32_t)NextPow2(Max(minScratchSize, BLAS_SCRATCH_POOL_SIZE)),
+            D3D12_RESOURCE_STATE_COMMON,
+            true);
+    }
+
+    SceneCore& scene = App::GetScene();
+    const auto sceneVBGpuVa = scene.GetMeshVB().GpuVA();
+    const auto sceneIBGpuVa = scene.GetMeshIB().GpuVA();
+    const uint64_t scratchPoolSize = m_blasScratchPool.Desc().Width;
+    const uint64_t currFrame = App::GetTimer().GetTotalFrameCount();
+    uint32_t numTriangles = 0;
+    uint32_t scratchOffset = 0;
+    int numBuilt = 0;
+
+    cmdList.PIXBeginEvent("DynamicBLASBuild");
+
+    while (!m_pendingBLASBuilds.empty())
+    {
+        const PendingBuild b = m_pendingBLASBuilds.back();
+        scratchOffset = AlignUp(scratchOffset, 
+            (uint32_t)D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+
+        // Leave the rest for the next frames. Always build at least one, so that meshes 
+        // larger than the budget don't get stuck.
+        if (numBuilt && (numTriangles + b.NumTriangles > MAX_BLAS_BUILD_TRIANGLES_PER_FRAME ||
+            scratchOffset + b.ScratchSizeInBytes > scratchPoolSize))
+        {
+            break;
+        }
+
+        DynamicBLAS& blas = FindDynamicBLAS(b.List == BLAS_LIST::STAGED ? m_stagedBLASes : 
+            (b.List == BLAS_LIST::LOD ? m_lodBLASes : m_dynamicBLASes), b.BLAS);
+        const D3D12_RAYTRACING_GEOMETRY_DESC geoDesc = DynamicBLASGeometryDesc(
+            *scene.GetMesh(DynamicBLASMeshID(blas)).value(), sceneVBGpuVa, sceneIBGpuVa);
+
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc;
+        buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+        buildDesc.Inputs.Flags = BuildFlags(RT_MESH_MODE::DYNAMIC_NO_REBUILD);
+        buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+        buildDesc.Inputs.NumDescs = 1;
+        buildDesc.Inputs.pGeometryDescs = &geoDesc;
+        buildDesc.DestAccelerationStructureData = DynamicBLASGpuVA(blas);
+        buildDesc.ScratchAccelerationStructureData = m_blasScratchPool.GpuVA() + scratchOffset;
+        buildDesc.SourceAccelerationStructureData = 0;
+
+        cmdList.BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
+
+        blas.BuildFrame = currFrame;
+        touchedPages.push_back(blas.PageIdx);
+
+        // Staged and LOD BLASes aren't referenced by TLAS instances until the switch
+        if (b.List == BLAS_LIST::STAGED)
+            m_numUnbuiltStagedBLASes--;
+        else if (b.List == BLAS_LIST::ACTIVE)
+            m_tlasInstancesStale = true;
+
+        numTriangles += b.NumTriangles;
+        scratchOffset += b.ScratchSizeInBytes;
+        numBuilt++;
+
+        m_pendingBLASBuilds.pop_back();
+    }
+
+    cmdList.PIXEndEvent();
+}
+
+void TLAS::PartitionStaticBLASes()
+{
+    SceneCore& scene = App::GetScene();
+    const uint32_t numStaticInstances = scene.m_numStaticInstances;
+
+    SmallVector<uint32_t, App::FrameAllocator> numTris;
+    numTris.resize(numStaticInstances);
+    uint64_t totalNumTris = 0;
+
+    ForEachStaticInstance(scene, 0, numStaticInstances,
+        [&](const auto& treeLevel, size_t i, uint32_t staticIdx)
+        {
+            const TriangleMesh* mesh = scene.GetMesh(treeLevel.m_meshIDs[i]).value();
+            numTris[staticIdx] = mesh->m_numIndices / 3;
+            totalNumTris += numTris[staticIdx];
+        });
+
+    // Contiguous ranges of static instances, so that the mesh instance layout (which 
+    // shaders and emissives depend on) doesn't change. Static BLASes are built in the same 
+    // frame, so this only bounds the cost of rebuilding a static BLAS after some of its 
+    // instances are switched to dynamic.
+    const uint64_t budget = Max((uint64_t)STATIC_BLAS_NUM_TRIANGLES,
+        CeilUnsignedIntDiv(totalNumTris, (uint64_t)MAX_NUM_STATIC_BLASES));
+    uint64_t currNumTris = 0;
+    uint32_t base = 0;
+    m_numStaticBLASes = 0;
+
+    for (uint32_t i = 0; i < numStaticInstances; i++)
+    {
+        // Last one takes whatever remains
+        if (currNumTris > 0 && currNumTris + numTris[i] > budget && 
+            m_numStaticBLASes < MAX_NUM_STATIC_BLASES - 1)
+        {
+            m_staticBLASes[m_numStaticBLASes].m_baseInstance = base;
+            m_staticBLASes[m_numStaticBLASes++].m_numInstances = i - base;
+
+            base = i;
+            currNumTris = 0;
+        }
+
+        currNumTris += numTris[i];
+    }
+
+    if (base < numStaticInstances)
+    {
+        m_staticBLASes[m_numStaticBLASes].m_baseInstance = base;
+        m_staticBLASes[m_numStaticBLASes++].m_numInstances = numStaticInstances - base;
+    }
+}
+
+void TLAS::UpdateStaticRtASInfos()
+{
+    SceneCore& scene = App::GetScene();
+
+    for (int c = 0; c < m_numStaticBLASes; c++)
+    {
+        const StaticBLAS& blas = m_staticBLASes[c];
+
+        ForEachStaticInstance(scene, blas.m_baseInstance, blas.m_numInstances,
+            [&blas](auto& treeLevel, size_t i, uint32_t staticIdx)
+            {
+                treeLevel.m_rtASInfo[i] = RT_AS_Info{
+                    .GeometryIndex = staticIdx - blas.m_baseInstance,
+                    .InstanceID = blas.m_baseInstance };
+            });
+    }
+}
+
+int TLAS::FindStaticBLAS(uint64_t instanceID) const
+{
+    // Static instances have InstanceID equal to base instance of their BLAS (empty
+    // BLASes may share the same base, but they don't contain anything)
+    const RT_AS_Info asInfo = App::GetScene().GetInstanceRtASInfo(instanceID);
+
+    for (int c = 0; c < m_numStaticBLASes; c++)
+    {
+        if (m_staticBLASes[c].m_numInstances && m_staticBLASes[c].m_baseInstance == asInfo.InstanceID)
+            return c;
+    }
+
+    Assert(false, "Static BLAS for instance %llu was not found.", instanceID);
+    return -1;
+}
+
+uint32_t TLAS::ModeSwitchStaticBLASMask() const
+{
+    uint32_t mask = 0;
+
+    for (auto instance : App::GetScene().m_pendingRtMeshModeSwitch)
+        mask |= (1u << FindStaticBLAS(instance));
+
+    return mask;
+}
+
+void TLAS::RemoveModeSwitchInstancesFromStaticBLASes()
+{
+    for (auto instance : App::GetScene().m_pendingRtMeshModeSwitch)
+    {
+        const int c = FindStaticBLAS(instance);
+        Assert(m_staticBLASes[c].m_numInstances, "Unexpected value.");
+
+        // Lookups depend on the old bases, so bases are updated after the loop
+        m_staticBLASes[c].m_numInstances--;
+    }
+
+    uint32_t base = 0;
+
+    for (int c = 0; c < m_numStaticBLASes; c++)
+    {
+        m_staticBLASes[c].m_baseInstance = base;
+        base += m_staticBLASes[c].m_numInstances;
+    }
+
+    Assert(base == App::GetScene().m_numStaticInstances, "Static instance count mismatch.");
+}
+
+void TLAS::UpdateStaticBLASCache(ComputeCmdList& cmdList)
+{
+    for (int c = 0; c < m_numStaticBLASes; c++)
+    {
+        StaticBLAS& blas = m_staticBLASes[c];
+
+        // Deserialized in an earlier frame
+        if (!blas.m_cacheKey)
+        {
+            if (blas.m_serialized.IsInitialized())
+                blas.m_serialized.Reset();
+
+            continue;
+        }
+
+        if (blas.m_cacheWritten.load(std::memory_order_acquire))
+        {
+            blas.m_serialized.Reset();
+            blas.m_cacheKey = 0;
+            blas.m_cacheWritten.store(false, std::memory_order_relaxed);
+        }
+        // Serialized size was read back during compaction
+        else if (blas.m_compacted && !blas.m_serialized.IsInitialized() && 
+            blas.m_serializationInfoReady.load(std::memory_order_acquire))
+        {
+            blas.Serialize(cmdList);
+        }
+    }
+}
+
+bool TLAS::StaticBLASCacheWritesPending() const
+{
+    for (int c = 0; c < m_numStaticBLASes; c++)
+    {
+        if (m_staticBLASes[c].m_numInstances && m_staticBLASes[c].m_cacheKey)
+            return true;
+    }
+
+    return false;
+}
+
+bool TLAS::StaticBLASesCompacted() const
+{
+    for (int c = 0; c < m_numStaticBLASes; c++)
+    {
+        if (m_staticBLASes[c].m_numInstances && !m_staticBLASes[c].m_compacted)
+            return false;
+    }
+
+    return true;
+}
+
+uint32_t TLAS::NumStaticTLASInstances() const
+{
+    uint32_t n = 0;
+
+    for (int c = 0; c < m_numStaticBLASes; c++)
+        n += m_staticBLASes[c].m_numInstances > 0;
+
+    return n;
+}
+
+uint32_t TLAS::FillStaticTLASInstances()
+{
+    uint32_t currInstance = 0;
+
+    for (int c = 0; c < m_numStaticBLASes; c++)
+    {
+        const StaticBLAS& blas = m_staticBLASes[c];
+        if (!blas.m_numInstances)
+            continue;
+
+        D3D12_RAYTRACING_INSTANCE_DESC& instance = m_tlasInstances[currInstance++];
+        instance.InstanceID = blas.m_baseInstance;
+        instance.InstanceMask = RT_AS_SUBGROUP::ALL;
+        instance.InstanceContributionToHitGroupIndex = 0;
+        instance.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+        instance.AccelerationStructure = blas.m_buffer.GpuVA();
+
+        // Identity transform for static BLAS instance
+        memset(&instance.Transform, 0, sizeof(BLASTransform));
+        instance.Transform[0][0] = 1.0f;
+        instance.Transform[1][1] = 1.0f;
+        instance.Transform[2][2] = 1.0f;
+    }
+
+    return currInstance;
+}
+
+void TLAS::RebuildOrUpdateBLASes(ComputeCmdList& cmdList)
+{
+    SceneCore& scene = App::GetScene();
+
+    // From Ray Tracing Gems 1 Chapter 19:
+    // "One important optimization is to ensure that any resource transition barriers that
+    // are needed after BLAS updates are deferred to be executed right before the
+    // TLAS build, instead of executing these right after each BLAS update. Deferral is
+    // important because each of these transition barriers is a synchronization step on
+    // the GPU. Having the transitions coalesced into a single point in the command buffer
+    // avoids redundant synchronization that would otherwise cause the GPU to frequently
+    // become idle."
+    SmallVector<D3D12_BUFFER_BARRIER, App::FrameAllocator> uavBarriers;
+
+    UpdateStaticBLASCache(cmdList);
+
+    // Compacting static BLAS requires two CPU-GPU synchronizations that'll likely
+    // span multiple frames and has the following steps:
+    // 
+    // 1. Build static BLAS for the first time and ask the GPU for compaction info
+    // 2. Compaction info is read back asynchronously once GPU has finished step 1
+    // 3. Allocate a new buffer with the compacted size. Then, record a command for 
+    //    compaction operation (on GPU).
+    // 4. Wait for GPU to finish step 3
+    // 5. Replace BLAS from step 1 with the new compacted BLAS 
+    //
+    // Every static BLAS goes through these steps independently. Compactions that become
+    // ready in the same frame share one wait in step 4.
+    if (!StaticBLASesCompacted() || m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC)
+    {
+        const bool modeSwitch = m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC;
+        // Starting another batch while the previous one is waiting in step 4 would reset 
+        // the wait object from under it
+        const bool canCompact = m_staticCompactionMask == 0;
+        uint32_t compactionMask = 0;
+
+        for (int c = 0; c < m_numStaticBLASes; c++)
+        {
+            StaticBLAS& blas = m_staticBLASes[c];
+            const bool rebuild = modeSwitch && (m_staticBLASRebuildMask & (1u << c));
+
+            if (!blas.m_numInstances || (blas.m_compacted && !rebuild))
+                continue;
+
+            // Compacted BLAS was loaded from disk, skip steps 1-5
+            if (blas.m_loadedFromCache && !rebuild)
+            {
+                blas.Deserialize(cmdList);
+
+                const D3D12_BUFFER_BARRIER barrier = Direct3DUtil::BufferBarrier(blas.m_buffer.Resource(),
+                    D3D12_BARRIER_SYNC_COPY_RAYTRACING_ACCELERATION_STRUCTURE,
+                    D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+                    D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE,
+                    D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ);
+
+                uavBarriers.push_back(barrier);
+            }
+            // Step 1
+            else if (!blas.m_buffer.IsInitialized() || rebuild)
+            {
+                blas.Rebuild(cmdList);
+
+                const D3D12_BUFFER_BARRIER barrier = Direct3DUtil::BufferBarrier(blas.m_buffer.Resource(),
+                    D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE,
+                    D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+                    D3D12_BARRIER_ACCESS_UNORDERED_ACCESS | D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE,
+                    D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ);
+
+                uavBarriers.push_back(barrier);
+
+                // Step 2 -- Rebuild() has enqueued a readback for the compacted size
+            }
+            // Step 3
+            else if (canCompact && blas.m_compactionInfoReady.load(std::memory_order_acquire))
+            {
+                // Read compaction info and submit a compaction command
+                blas.DoCompaction(cmdList);
+                blas.m_compactionInfoReady.store(false, std::memory_order_relaxed);
+
+                compactionMask |= (1u << c);
+            }
+            // Step 5
+            else if (blas.m_compactionCompleted.load(std::memory_order_acquire))
+            {
+                blas.m_buffer = ZetaMove(blas.m_bufferCompacted);
+                blas.m_compacted = true;
+                m_updateType = UPDATE_TYPE::STATIC_BLAS_COMPACTED;
+
+                blas.m_compactionCompleted.store(false, std::memory_order_relaxed);
+                m_staticCompactionMask &= ~(1u << c);
+            }
+        }
+
+        if (compactionMask)
+        {
+            m_waitObj.Reset();
+            App::GetScene().GetRenderGraph()->SetFrameSubmissionWaitObj(m_waitObj);
+            m_staticCompactionMask = compactionMask;
+
+            // Step 4
+            Task t("ReleaseRtAsBuffers", TASK_PRIORITY::BACKGROUND, [this, compactionMask]()
+                {
+                    m_waitObj.Wait();
+
+                    const uint64_t fence = App::GetScene().GetRenderGraph()->GetFrameCompletionFence();
+                    Assert(fence != UINT64_MAX, "Invalid fence value.");
+
+                    App::GetRenderer().WaitForDirectQueueFenceCPU(fence);
+
+                    for (int c = 0; c < MAX_NUM_STATIC_BLASES; c++)
+                    {
+                        if (compactionMask & (1u << c))
+                            m_staticBLASes[c].CompactionCompletedCallback();
+                    }
+                });
+
+            App::SubmitBackground(ZetaMove(t));
+        }
+    }
+
+    UpdateBLASPagePriority();
+
+    // Dynamic BLAS pages that were written to this frame
+    SmallVector<int, SystemAllocator, 4> touchedPages;
+
+    if (!m_dynamicBLASes.empty())
+    {
+        ReleaseDynamicBLASMemory();
+        CompactDynamicBLASes(cmdList, touchedPages);
+        DefragmentDynamicBLASes(cmdList, touchedPages);
+    }
+
+    // Once in the first frame
+    if (m_rebuildDynamicBLASes && scene.m_numDynamicInstances)
+        QueueDynamicBLASBuilds();
+    // Instances that are switching to dynamic keep using the static BLAS until their
+    // new BLASes have been built, see Update()
+    else if (scene.m_pendingRtMeshModeSwitch.size() > m_stagedBLASes.size())
+        StageModeSwitchBLASes();
+
+    BuildPendingDynamicBLASes(cmdList, touchedPages);
+
+    if (m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC && scene.m_numDynamicInstances)
+    {
+        Assert(m_numUnbuiltStagedBLASes == 0 && 
+            m_stagedBLASes.size() == scene.m_pendingRtMeshModeSwitch.size(), 
+            "Mode switch before staged BLASes were built.");
+
+        m_dynamicBLASes.append_range(m_stagedBLASes.begin(), m_stagedBLASes.end());
+        m_stagedBLASes.clear();
+
+        std::sort(m_dynamicBLASes.begin(), m_dynamicBLASes.end(),
+            [](const DynamicBLAS& lhs, const DynamicBLAS& rhs)
+            {
+                return DynamicBLASLess(lhs.TreeLevel, lhs.LevelIdx, rhs.TreeLevel, rhs.LevelIdx);
+            });
+    }
+
+    // Insert a barrier for every page that was built into or copied to
+    if(touchedPages.size() > 1)
+        std::sort(touchedPages.begin(), touchedPages.end());
+
+    for (int i = 0; i < (int)touchedPages.size(); i++)
+    {
+        if (i == 0 || touchedPages[i] != touchedPages[i - 1])
+        {
+            D3D12_BUFFER_BARRIER barrier = Direct3DUtil::BufferBarrier(
+                m_dynamicBLASArenas[touchedPages[i]].Page.Resource(),
+                D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE | 
+                    D3D12_BARRIER_SYNC_COPY_RAYTRACING_ACCELERATION_STRUCTURE,
+                D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+                D3D12_BARRIER_ACCESS_UNORDERED_ACCESS | D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE,
+                D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ);
+
+            uavBarriers.push_back(barrier);
+        }
+    }
+
+    if (!uavBarriers.empty())
+        cmdList.ResourceBarrier(uavBarriers.data(), (uint32_t)uavBarriers.size());
+
+    m_rebuildDynamicBLASes = false;
+}
+
+int TLAS::AllocateDynamicBLAS(uint32_t sizeInBytes, bool allowNewPage, 
+    OffsetAllocator::Allocation& alloc)
+{
+    // Pages start at offset zero and every allocation size is a multiple of the 
+    // required alignment, so all the offsets end up aligned
+    sizeInBytes = AlignUp(sizeInBytes, 
+        (uint32_t)D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+    const BLAS_SIZE_CLASS sizeClass = sizeInBytes <= SMALL_BLAS_MAX_SIZE ? BLAS_SIZE_CLASS::SMALL :
+        (sizeInBytes <= BLAS_ARENA_PAGE_SIZE ? BLAS_SIZE_CLASS::LARGE : BLAS_SIZE_CLASS::DEDICATED);
+
+    // Dedicated pages may have room left for another large BLAS
+    for (int i = 0; i < (int)m_dynamicBLASArenas.size(); i++)
+    {
+        auto& page = m_dynamicBLASArenas[i];
+        const bool sameClass = page.SizeClass == sizeClass || 
+            (sizeClass != BLAS_SIZE_CLASS::SMALL && page.SizeClass != BLAS_SIZE_CLASS::SMALL);
+
+        if (!sameClass || page.Retiring || page.Allocator.FreeStorage() < sizeInBytes)
+            continue;
+
+        alloc = page.Allocator.Allocate(sizeInBytes);
+        if (!alloc.IsEmpty())
+            return i;
+    }
+
+    if (!allowNewPage)
+    {
+        alloc = OffsetAllocator::Allocation::Empty();
+        return -1;
+    }
+
+    // Power of two so that the allocator's size classes can fit it exactly
+    const uint32_t pageSize = sizeClass == BLAS_SIZE_CLASS::SMALL ? SMALL_BLAS_ARENA_PAGE_SIZE :
+        (uint32_t)NextPow2(Max(sizeInBytes, BLAS_ARENA_PAGE_SIZE));
+    auto page = GpuMemory::GetDefaultHeapBuffer("BLASArenaPage",
+        pageSize,
+        true,
+        true);
+
+    if (m_blasPagePriority != D3D12_RESIDENCY_PRIORITY_NORMAL)
+    {
+        ID3D12Pageable* res = page.Resource();
+        GpuMemory::SetResidencyPriority(Span<ID3D12Pageable*>(&res, 1), m_blasPagePriority);
+    }
+
+    OffsetAllocator allocator(pageSize, MAX_NUM_BLASES_PER_PAGE);
+    alloc = allocator.Allocate(sizeInBytes);
+    Assert(!alloc.IsEmpty(), "Allocation from a new page failed.");
+
+    m_dynamicBLASArenas.push_back(ArenaPage{ .Page = ZetaMove(page),
+        .Allocator = ZetaMove(allocator),
+        .SizeClass = sizeClass,
+        .Retiring = false });
+
+    LOG_UI_INFO("Allocated dynamic BLAS page (%u KB)...", pageSize / 1024);
+
+    return (int)m_dynamicBLASArenas.size() - 1;
+}
+
+void TLAS::FreeDynamicBLAS(int pageIdx, const OffsetAllocator::Allocation& alloc)
+{
+    m_pendingBLASFrees.push_back(PendingFree{ .PageIdx = pageIdx,
+        .Alloc = alloc,
+        .FrameIdx = App::GetTimer().GetTotalFrameCount() });
+}
+
+void TLAS::ReleaseDynamicBLASMemory()
+{
+    const uint64_t currFrame = App::GetTimer().GetTotalFrameCount();
+
+    // TLAS from the frame that moved a BLAS is still using its old address, but
+    // it's rebuilt by the next frame. Wait until both are retired by the GPU.
+    for (size_t i = 0; i < m_pendingBLASFrees.size();)
+    {
+        const auto& f = m_pendingBLASFrees[i];
+
+        if (f.FrameIdx + Constants::NUM_BACK_BUFFERS + 1 <= currFrame)
+        {
+            m_dynamicBLASArenas[f.PageIdx].Allocator.Free(f.Alloc);
+            m_pendingBLASFrees.erase_at_index(i);
+        }
+        else
+            i++;
+    }
+
+    // Release empty pages. Erase swaps with the last page, so references to it
+    // need to be patched up.
+    for (int i = 0; i < (int)m_dynamicBLASArenas.size();)
+    {
+        auto& page = m_dynamicBLASArenas[i];
+        if (page.Allocator.FreeStorage() != page.Page.Desc().Width)
+        {
+            i++;
+            continue;
+        }
+
+        const int lastIdx = (int)m_dynamicBLASArenas.size() - 1;
+        m_dynamicBLASArenas.erase_at_index(i);
+
+        if (i != lastIdx)
+        {
+            for (auto& blas : m_dynamicBLASes)
+            {
+                Assert(blas.PageIdx != i, "Empty page is still referenced.");
+                blas.PageIdx = blas.PageIdx == lastIdx ? i : blas.PageIdx;
+            }
+
+            for (auto& blas : m_stagedBLASes)
+                blas.PageIdx = blas.PageIdx == lastIdx ? i : blas.PageIdx;
+
+            for (auto& blas : m_lodBLASes)
+                blas.PageIdx = blas.PageIdx == lastIdx ? i : blas.PageIdx;
+
+            for (auto& f : m_pendingBLASFrees)
+                f.PageIdx = f.PageIdx == lastIdx ? i : f.PageIdx;
+        }
+
+        LOG_UI_INFO("Released dynamic BLAS page.");
+    }
+}
+
+void TLAS::CompactDynamicBLASes(ComputeCmdList& cmdList, Vector<int>& touchedPages)
+{
+    // Compacting dynamic BLASes has the following steps:
+    // 
+    // 1. Ask the GPU for compacted sizes of BLASes that haven't been compacted yet and
+    //    were built in a prior frame
+    // 2. Compaction info is read back asynchronously
+    // 3. For every BLAS that gets smaller, allocate the compacted size from the pages
+    //    and record a compaction command. Its old allocation is released once GPU is 
+    //    done with it.
+    if (m_compaction.InFlight)
+    {
+        // Step 3
+        if (!m_compaction.Ready.load(std::memory_order_acquire))
+            return;
+
+        const uint64_t currFrame = App::GetTimer().GetTotalFrameCount();
+        uint64_t sizeBeforeInBytes = 0;
+        uint64_t sizeAfterInBytes = 0;
+        int numCompacted = 0;
+
+        cmdList.PIXBeginEvent("DynamicBLAS_Compaction");
+
+        for (size_t i = 0; i < m_compaction.BLASes.size(); i++)
         {
-            Scene::RT_Flags flags = RT_Flags::Decode(rtFlagVec[i]);
-            Assert((flags.RebuildFlag & flags.UpdateFlag) == 0,
-                "Rebuild & update flags can't be set at the same time.");
+            const uint32_t treeLevel = (uint32_t)(m_compaction.BLASes[i] >> 32);
+            const uint32_t levelIdx = (uint32_t)m_compaction.BLASes[i];
 
-            if (flags.MeshMode != RT_MESH_MODE::STATIC)
-            {
-                const TriangleMesh* mesh = scene.GetMesh(currTreeLevel.m_meshIDs[i]).value();
-                const auto sceneVBGpuVa = scene.GetMeshVB().GpuVA();
-                const auto sceneIBGpuVa = scene.GetMeshIB().GpuVA();
-
-                DynamicBlasBuild buildItem;
-                buildItem.TreeLevel = (uint32_t)treeLevelIdx;
-                buildItem.LevelIdx = (uint32_t)i;
-                buildItem.GeoDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-                buildItem.GeoDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
-                buildItem.GeoDesc.Triangles.IndexBuffer = sceneIBGpuVa + mesh->m_idxBuffStartOffset * sizeof(uint32_t);
-                buildItem.GeoDesc.Triangles.IndexCount = mesh->m_numIndices;
-                buildItem.GeoDesc.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
-                buildItem.GeoDesc.Triangles.Transform3x4 = 0;
-                buildItem.GeoDesc.Triangles.VertexBuffer.StartAddress = sceneVBGpuVa +
-                    mesh->m_vtxBuffStartOffset * sizeof(Vertex);
-                buildItem.GeoDesc.Triangles.VertexBuffer.StrideInBytes = sizeof(Vertex);
-                buildItem.GeoDesc.Triangles.VertexCount = mesh->m_numVertices;
-                buildItem.GeoDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
-
-                blasBuilds.push_back(buildItem);
+            auto it = std::lower_bound(m_dynamicBLASes.begin(), m_dynamicBLASes.end(), 
+                m_compaction.BLASes[i],
+                [](const DynamicBLAS& lhs, uint64_t key)
+                {
+                    return DynamicBLASLess(lhs.TreeLevel, lhs.LevelIdx, 
+                        (uint32_t)(key >> 32), (uint32_t)key);
+                });
 
-                rtFlagVec[i] = RT_Flags::Encode(flags.MeshMode, flags.InstanceMask,
-                    0, 0, flags.IsOpaque);
+            Assert(it != m_dynamicBLASes.end() && it->TreeLevel == treeLevel && 
+                it->LevelIdx == levelIdx, "Dynamic BLAS was not found.");
+            DynamicBLAS& blas = *it;
+            blas.Compacted = true;
 
-                currTreeLevel.m_rtASInfo[i] = RT_AS_Info{
-                    .GeometryIndex = 0,
-                    .InstanceID = scene.m_numStaticInstances + (uint32)blasBuilds.size() - 1 };
-            }
-        }
-    }
+            const uint32_t compactedSize = AlignUp((uint32_t)m_compaction.CompactedSizes[i],
+                (uint32_t)D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
+            if (compactedSize == 0 || compactedSize >= blas.Alloc.Size)
+                continue;
 
-    auto* device = App::GetRenderer().GetDevice();
-    uint32_t currBuildSizeInBytes = 0;
-    uint32_t currScratchSize = 0;
+            OffsetAllocator::Allocation alloc;
+            const int pageIdx = AllocateDynamicBLAS(compactedSize, true, alloc);
 
-    for (auto& b : blasBuilds)
-    {
-        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc;
-        buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-        buildDesc.Inputs.Flags = BuildFlags(RT_MESH_MODE::DYNAMIC_NO_REBUILD);
-        buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-        buildDesc.Inputs.NumDescs = 1;
-        buildDesc.Inputs.pGeometryDescs = &b.GeoDesc;
+            cmdList.CompactAccelerationStructure(m_dynamicBLASArenas[pageIdx].Page.GpuVA() + 
+                alloc.Offset, DynamicBLASGpuVA(blas));
+
+            sizeBeforeInBytes += blas.Alloc.Size;
+            sizeAfterInBytes += alloc.Size;
+            numCompacted++;
 
-        device->GetRaytracingAccelerationStructurePrebuildInfo(&buildDesc.Inputs, &b.BuildInfo);
+            FreeDynamicBLAS(blas.PageIdx, blas.Alloc);
+            blas.PageIdx = pageIdx;
+            blas.Alloc = alloc;
+            blas.BuildFrame = currFrame;
 
-        Assert(b.BuildInfo.ResultDataMaxSizeInBytes > 0,
-            "GetRaytracingAccelerationStructurePrebuildInfo() failed.");
+            touchedPages.push_back(pageIdx);
+        }
+
+        cmdList.PIXEndEvent();
+
+        if (numCompacted)
+        {
+            LOG_UI_INFO("Compacted %d dynamic BLASes (%llu KB -> %llu KB).", numCompacted,
+                sizeBeforeInBytes / 1024, sizeAfterInBytes / 1024);
 
-        currBuildSizeInBytes = AlignUp(currBuildSizeInBytes,
-            uint32_t(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT));
-        b.BlasBufferOffset = currBuildSizeInBytes;
-        currBuildSizeInBytes += (uint32_t)b.BuildInfo.ResultDataMaxSizeInBytes;
+            m_tlasInstancesStale = true;
+        }
 
-        currScratchSize = AlignUp(currScratchSize,
-            uint32_t(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT));
-        b.ScratchBufferOffset = currScratchSize;
-        currScratchSize += (uint32_t)b.BuildInfo.ScratchDataSizeInBytes;
+        m_compaction.InFlight = false;
+        m_compaction.Ready.store(false, std::memory_order_relaxed);
 
-        // InstanceID is filled in by RebuildTLASInstances()
-        m_dynamicBLASes.push_back(DynamicBLAS{ .PageIdx = 0,
-            .PageOffset = b.BlasBufferOffset,
-            .TreeLevel = b.TreeLevel,
-            .LevelIdx = b.LevelIdx,
-            .InstanceID = UINT32_MAX });
+        return;
     }
 
-    Assert(m_dynamicBLASArenas.empty(), "bug");
+    // Step 1
+    const uint64_t currFrame = App::GetTimer().GetTotalFrameCount();
+    SmallVector<D3D12_GPU_VIRTUAL_ADDRESS, App::FrameAllocator> blasVAs;
+    m_compaction.BLASes.clear();
 
-    const uint32_t sizeInBytes = Max(currBuildSizeInBytes, BLAS_ARENA_PAGE_SIZE);
-    auto page = GpuMemory::GetDefaultHeapBuffer("BLASArenaPage",
-        sizeInBytes,
-        true,
-        true);
+    for (auto& blas : m_dynamicBLASes)
+    {
+        if (!blas.Compacted && blas.BuildFrame < currFrame)
+        {
+            m_compaction.BLASes.push_back(DynamicBLASKey(blas.TreeLevel, blas.LevelIdx));
+            blasVAs.push_back(DynamicBLASGpuVA(blas));
+        }
+    }
 
-    const uint32_t offsetInBytes = AlignUp(sizeInBytes,
-        uint32_t(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT));
-    m_dynamicBLASArenas.push_back(ArenaPage{ .Page = ZetaMove(page), .CurrOffset = offsetInBytes });
+    if (blasVAs.empty())
+        return;
 
-    const uint32_t alignedScratchSize = AlignUp(currScratchSize,
-        (uint32_t)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+    using CompactedSizeDesc = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC;
+    const uint32_t sizeInBytes = (uint32_t)(blasVAs.size() * sizeof(CompactedSizeDesc));
 
-    if (!m_scratchBuffer.IsInitialized() ||
-        m_scratchBuffer.Desc().Width < alignedScratchSize)
+    if (!m_compaction.Info.IsInitialized() || m_compaction.Info.Desc().Width < sizeInBytes)
     {
-        m_scratchBuffer = GpuMemory::GetDefaultHeapBuffer("DynamicBLAS_scratch",
-            alignedScratchSize,
+        m_compaction.Info = GpuMemory::GetDefaultHeapBuffer("DynamicBLAS_CompactionInfo",
+            AlignUp(sizeInBytes, (uint32_t)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT),
             D3D12_RESOURCE_STATE_COMMON,
             true);
     }
 
-    for (auto& b : blasBuilds)
-    {
-        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc;
-        buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-        buildDesc.Inputs.Flags = BuildFlags(RT_MESH_MODE::DYNAMIC_NO_REBUILD);
-        buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-        buildDesc.Inputs.NumDescs = 1;
-        buildDesc.Inputs.pGeometryDescs = &b.GeoDesc;
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC compactionDesc;
+    compactionDesc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+    compactionDesc.DestBuffer = m_compaction.Info.GpuVA();
 
-        buildDesc.DestAccelerationStructureData = m_dynamicBLASArenas[0].Page.GpuVA() +
-            b.BlasBufferOffset;
-        buildDesc.ScratchAccelerationStructureData = m_scratchBuffer.GpuVA() +
-            b.ScratchBufferOffset;
-        buildDesc.SourceAccelerationStructureData = 0;
+    cmdList.PIXBeginEvent("DynamicBLAS_CompactionInfo");
+    cmdList.EmitRaytracingAccelerationStructurePostbuildInfo(&compactionDesc, 
+        (UINT)blasVAs.size(), blasVAs.data());
 
-        cmdList.PIXBeginEvent("DynamicBLASBuild");
-        cmdList.BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
-        cmdList.PIXEndEvent();
+    auto barrier = Direct3DUtil::BufferBarrier(m_compaction.Info.Resource(),
+        D3D12_BARRIER_SYNC_EMIT_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO,
+        D3D12_BARRIER_SYNC_COPY,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+        D3D12_BARRIER_ACCESS_COPY_SOURCE);
+
+    cmdList.ResourceBarrier(barrier);
+
+    // Step 2
+    m_compaction.CompactedSizes.resize(blasVAs.size());
+    m_compaction.Ready.store(false, std::memory_order_relaxed);
+    m_compaction.InFlight = true;
+
+    GpuMemory::EnqueueReadback(cmdList, m_compaction.Info.Resource(), 0, sizeInBytes,
+        fastdelegate::MakeDelegate(this, &TLAS::CompactionInfoReadbackCallback));
+
+    cmdList.PIXEndEvent();
+}
+
+void TLAS::CompactionInfoReadbackCallback(Span<uint8_t> data)
+{
+    using CompactedSizeDesc = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC;
+    Assert(data.size() == m_compaction.CompactedSizes.size() * sizeof(CompactedSizeDesc), 
+        "Unexpected readback size.");
+
+    for (size_t i = 0; i < m_compaction.CompactedSizes.size(); i++)
+    {
+        CompactedSizeDesc desc;
+        memcpy(&desc, data.data() + i * sizeof(CompactedSizeDesc), sizeof(desc));
+        m_compaction.CompactedSizes[i] = desc.CompactedSizeInBytes;
     }
+
+    m_compaction.Ready.store(true, std::memory_order_release);
 }
 
-void TLAS::RebuildOrUpdateBLASes(ComputeCmdList& cmdList)
+void TLAS::DefragmentDynamicBLASes(ComputeCmdList& cmdList, Vector<int>& touchedPages)
 {
-    SceneCore& scene = App::GetScene();
+    // BLASes from a batch that's in flight shouldn't move. Same for the ones that 
+    // haven't been built yet.
+    if (m_compaction.InFlight || m_dynamicBLASArenas.size() < 2 || 
+        !m_pendingBLASBuilds.empty() || !m_stagedBLASes.empty() || !m_lodBLASes.empty())
+    {
+        return;
+    }
 
-    // From Ray Tracing Gems 1 Chapter 19:
-    // "One important optimization is to ensure that any resource transition barriers that
-    // are needed after BLAS updates are deferred to be executed right before the
-    // TLAS build, instead of executing these right after each BLAS update. Deferral is
-    // important because each of these transition barriers is a synchronization step on
-    // the GPU. Having the transitions coalesced into a single point in the command buffer
-    // avoids redundant synchronization that would otherwise cause the GPU to frequently
-    // become idle."
-    SmallVector<D3D12_BUFFER_BARRIER, App::FrameAllocator> uavBarriers;
-    const bool staticBLASReady = !scene.m_numStaticInstances || m_staticBLASCompacted;
+    // Pick the least-used page of each size class. BLASes only move within their 
+    // class, except that large ones can also move into (and out of) dedicated pages.
+    constexpr int NUM_CLASSES = (int)BLAS_SIZE_CLASS::COUNT;
+    uint64_t totalFreeSpace[NUM_CLASSES] = { 0 };
+    uint64_t minUsedSpace[NUM_CLASSES];
+    int candidates[NUM_CLASSES];
 
-    // Compacting static BLAS requires two CPU-GPU synchronizations that'll likely
-    // span multiple frames and has the following steps:
-    // 
-    // 1. Build static BLAS for the first time and ask the GPU for compaction info
-    // 2. Wait for GPU to finish step 1
-    // 3. Read back compaction info on CPU and allocate a new buffer with the 
-    //    compacted size. Then, record a command for compaction operation (on GPU).
-    // 4. Wait for GPU to finish step 3
-    // 5. Replace BLAS from step 1 with the new compacted BLAS 
-    if (!staticBLASReady || m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC)
+    for (int c = 0; c < NUM_CLASSES; c++)
     {
-        // Step 1
-        if (!m_staticBLAS.m_buffer.IsInitialized() || m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC)
-        {
-            m_staticBLAS.Rebuild(cmdList);
+        minUsedSpace[c] = UINT64_MAX;
+        candidates[c] = -1;
+    }
 
-            const D3D12_BUFFER_BARRIER barrier = Direct3DUtil::BufferBarrier(m_staticBLAS.m_buffer.Resource(),
-                D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE,
-                D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
-                D3D12_BARRIER_ACCESS_UNORDERED_ACCESS | D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE,
-                D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ);
+    for (int i = 0; i < (int)m_dynamicBLASArenas.size(); i++)
+    {
+        auto& page = m_dynamicBLASArenas[i];
+        if (page.Retiring)
+            return;
 
-            uavBarriers.push_back(barrier);
+        const int c = (int)page.SizeClass;
+        const uint64_t freeSpace = page.Allocator.FreeStorage();
+        const uint64_t usedSpace = page.Page.Desc().Width - freeSpace;
+        totalFreeSpace[c] += freeSpace;
 
-            // Step 2
-            Task t("WaitForRtAsBuild", TASK_PRIORITY::BACKGROUND, [this]()
-                {
-                    m_waitObj.Reset();
-                    App::GetScene().GetRenderGraph()->SetFrameSubmissionWaitObj(m_waitObj);
-                    m_waitObj.Wait();
+        if (usedSpace < minUsedSpace[c])
+        {
+            minUsedSpace[c] = usedSpace;
+            candidates[c] = i;
+        }
+    }
 
-                    const uint64_t fence = App::GetScene().GetRenderGraph()->GetFrameCompletionFence();
-                    Assert(fence != UINT64_MAX, "Invalid fence value.");
+    // Only worth it when the free space across pages that could take its BLASes adds up 
+    // to (at least) the size of the page, so that its contents could fit in the others. 
+    // Also, avoid retrying every frame when the last attempt failed due to fragmentation.
+    int candidate = -1;
+    int candidateClass = -1;
+    uint64_t candidateFreeSpace = 0;
 
-                    App::GetRenderer().WaitForDirectQueueFenceCPU(fence);
-                    m_compactionInfoReady.store(true, std::memory_order_release);
-                });
+    for (int c = 0; c < NUM_CLASSES && candidate == -1; c++)
+    {
+        if (candidates[c] == -1 || minUsedSpace[c] == 0)
+            continue;
 
-            App::SubmitBackground(ZetaMove(t));
-        }
-        // Step 3
-        else if (m_compactionInfoReady.load(std::memory_order_acquire))
+        const uint64_t freeSpace = c == (int)BLAS_SIZE_CLASS::SMALL ? totalFreeSpace[c] :
+            totalFreeSpace[(int)BLAS_SIZE_CLASS::LARGE] + totalFreeSpace[(int)BLAS_SIZE_CLASS::DEDICATED];
+
+        if (freeSpace >= m_dynamicBLASArenas[candidates[c]].Page.Desc().Width &&
+            freeSpace != m_defragFailedFreeSpace[c])
         {
-            // Read compaction info and submit a compaction command
-            m_staticBLAS.DoCompaction(cmdList);
+            candidate = candidates[c];
+            candidateClass = c;
+            candidateFreeSpace = freeSpace;
+        }
+    }
 
-            m_waitObj.Reset();
-            App::GetScene().GetRenderGraph()->SetFrameSubmissionWaitObj(m_waitObj);
+    if (candidate == -1)
+        return;
 
-            // Step 4
-            Task t("ReleaseRtAsBuffers", TASK_PRIORITY::BACKGROUND, [this]()
-                {
-                    m_waitObj.Wait();
+    struct Move
+    {
+        DynamicBLAS* BLAS;
+        int PageIdx;
+        OffsetAllocator::Allocation Alloc;
+    };
 
-                    const uint64_t fence = App::GetScene().GetRenderGraph()->GetFrameCompletionFence();
-                    Assert(fence != UINT64_MAX, "Invalid fence value.");
+    SmallVector<Move, App::FrameAllocator> moves;
+    m_dynamicBLASArenas[candidate].Retiring = true;
+    bool success = true;
 
-                    App::GetRenderer().WaitForDirectQueueFenceCPU(fence);
-                    m_staticBLAS.CompactionCompletedCallback();
-                });
+    for (auto& blas : m_dynamicBLASes)
+    {
+        if (blas.PageIdx != candidate)
+            continue;
 
-            App::SubmitBackground(ZetaMove(t));
-            m_compactionInfoReady.store(false, std::memory_order_relaxed);
-        }
-        // Step 5
-        else if (m_staticBLAS.m_compactionCompleted.load(std::memory_order_acquire))
-        {
-            m_staticBLAS.m_buffer = ZetaMove(m_staticBLAS.m_bufferCompacted);
-            m_staticBLASCompacted = true;
-            m_updateType = UPDATE_TYPE::STATIC_BLAS_COMPACTED;
+        OffsetAllocator::Allocation alloc;
+        const int pageIdx = AllocateDynamicBLAS(blas.Alloc.Size, false, alloc);
 
-            m_staticBLAS.m_compactionCompleted.store(false, std::memory_order_relaxed);
+        if (pageIdx == -1)
+        {
+            success = false;
+            break;
         }
+
+        moves.push_back(Move{ .BLAS = &blas, .PageIdx = pageIdx, .Alloc = alloc });
     }
 
-    // Once in the first frame
-    if (m_rebuildDynamicBLASes && scene.m_numDynamicInstances)
+    // Nothing has been recorded yet, so new allocations can be freed right away
+    if (!success)
     {
-        BuildDynamicBLASes(cmdList);
+        for (auto& m : moves)
+            m_dynamicBLASArenas[m.PageIdx].Allocator.Free(m.Alloc);
 
-        // One barrier covers all of the builds
-        D3D12_BUFFER_BARRIER barrier = Direct3DUtil::BufferBarrier(m_dynamicBLASArenas[0].Page.Resource(),
-            D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE,
-            D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
-            D3D12_BARRIER_ACCESS_UNORDERED_ACCESS | D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE,
-            D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ);
+        m_dynamicBLASArenas[candidate].Retiring = false;
+        m_defragFailedFreeSpace[candidateClass] = candidateFreeSpace;
 
-        uavBarriers.push_back(barrier);
+        return;
     }
 
-    if (m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC && scene.m_numDynamicInstances)
+    const uint64_t currFrame = App::GetTimer().GetTotalFrameCount();
+    cmdList.PIXBeginEvent("DynamicBLAS_Defrag");
+
+    // Copied size is determined by the driver and is at most the source BLAS' current
+    // size, which always fits in its allocation
+    for (auto& m : moves)
     {
-        Assert(!scene.m_pendingRtMeshModeSwitch.empty(), "Unexpected condition.");
+        cmdList.CopyAccelerationStructure(m_dynamicBLASArenas[m.PageIdx].Page.GpuVA() + 
+            m.Alloc.Offset, DynamicBLASGpuVA(*m.BLAS));
 
-        SmallVector<DynamicBlasBuild, SystemAllocator, 3> builds;
-        builds.reserve(scene.m_pendingRtMeshModeSwitch.size());
+        FreeDynamicBLAS(m.BLAS->PageIdx, m.BLAS->Alloc);
+        m.BLAS->PageIdx = m.PageIdx;
+        m.BLAS->Alloc = m.Alloc;
+        m.BLAS->BuildFrame = currFrame;
 
-        for (auto instance : scene.m_pendingRtMeshModeSwitch)
-        {
-            const auto treePos = scene.FindTreePosFromID(instance).value();
-            const auto meshID = scene.m_sceneGraph[treePos.Level].m_meshIDs[treePos.Offset];
+        touchedPages.push_back(m.PageIdx);
+    }
 
-            const TriangleMesh* mesh = scene.GetMesh(meshID).value();
-            const auto sceneVBGpuVa = scene.GetMeshVB().GpuVA();
-            const auto sceneIBGpuVa = scene.GetMeshIB().GpuVA();
-
-            DynamicBlasBuild build;
-            build.GeoDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-            build.GeoDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
-            build.GeoDesc.Triangles.IndexBuffer = sceneIBGpuVa + mesh->m_idxBuffStartOffset * sizeof(uint32_t);
-            build.GeoDesc.Triangles.IndexCount = mesh->m_numIndices;
-            build.GeoDesc.Triangles.IndexFormat = DXGI_FORMAT_R32_UINT;
-            build.GeoDesc.Triangles.Transform3x4 = 0;
-            build.GeoDesc.Triangles.VertexBuffer.StartAddress = sceneVBGpuVa +
-                mesh->m_vtxBuffStartOffset * sizeof(Vertex);
-            build.GeoDesc.Triangles.VertexBuffer.StrideInBytes = sizeof(Vertex);
-            build.GeoDesc.Triangles.VertexCount = mesh->m_numVertices;
-            build.GeoDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
-
-            build.TreeLevel = treePos.Level;
-            build.LevelIdx = treePos.Offset;
-
-            builds.push_back(build);
-        }
+    cmdList.PIXEndEvent();
 
-        uint32_t totalScratchDataSizeInBytes = 0;
+    // Page is released once every pending free for it has gone through
+    LOG_UI_INFO("Moved %d dynamic BLASes out of a fragmented page.", (int)moves.size());
 
-        for (auto& b : builds)
-        {
-            D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc{};
-            buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-            buildDesc.Inputs.Flags = BuildFlags(RT_MESH_MODE::DYNAMIC_NO_REBUILD);
-            buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-            buildDesc.Inputs.NumDescs = 1;
-            buildDesc.Inputs.pGeometryDescs = &b.GeoDesc;
+    m_tlasInstancesStale = true;
+}
 
-            App::GetRenderer().GetDevice()->GetRaytracingAccelerationStructurePrebuildInfo(
-                &buildDesc.Inputs, &b.BuildInfo);
+void TLAS::SelectDynamicBLASLODs()
+{
+    const uint64_t currFrame = App::GetTimer().GetTotalFrameCount();
+    if (currFrame % LOD_UPDATE_INTERVAL != 0)
+        return;
 
-            Assert(b.BuildInfo.ResultDataMaxSizeInBytes > 0,
-                "GetRaytracingAccelerationStructurePrebuildInfo() failed.");
+    SceneCore& scene = App::GetScene();
+    const Camera& camera = App::GetCamera();
+    const float3 camPos = camera.GetPos();
+    const float tanHalfFOV = camera.GetTanHalfFOV();
+    // Switches that are already in progress are left alone
+    const size_t numInProgress = m_lodBLASes.size();
+    uint32_t numQueued = 0;
+
+    for (const auto& blas : m_dynamicBLASes)
+    {
+        if (blas.BuildFrame == BLAS_NOT_BUILT)
+            continue;
 
-            totalScratchDataSizeInBytes = AlignUp(totalScratchDataSizeInBytes,
-                (uint32)D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
-            b.ScratchBufferOffset = totalScratchDataSizeInBytes;
+        const auto& treeLevel = scene.m_sceneGraph[blas.TreeLevel];
+        const uint64_t meshID = treeLevel.m_meshIDs[blas.LevelIdx];
+        const uint32_t numLODs = scene.GetMeshNumLODs(meshID);
+        const auto rtFlags = RT_Flags::Decode(treeLevel.m_rtFlags[blas.LevelIdx]);
 
-            totalScratchDataSizeInBytes += (uint32)b.BuildInfo.ScratchDataSizeInBytes;
-        }
+        // Emissive triangles are looked up by primitive index, which only matches the
+        // source mesh
+        if (numLODs == 1 || (rtFlags.InstanceMask & RT_AS_SUBGROUP::EMISSIVE))
+            continue;
 
-        const uint32_t alignedScratchSize = AlignUp(totalScratchDataSizeInBytes,
-            (uint32_t)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+        uint32_t lod = 0;
 
-        if (!m_scratchBuffer.IsInitialized() ||
-            m_scratchBuffer.Desc().Width < totalScratchDataSizeInBytes)
+        if (scene.m_meshLODs)
         {
-            m_scratchBuffer = GpuMemory::GetDefaultHeapBuffer("DynamicBLAS_scratch",
-                alignedScratchSize,
-                D3D12_RESOURCE_STATE_COMMON,
-                true);
+            const TriangleMesh* mesh = scene.GetMesh(meshID).value();
+            const float4x3& M = treeLevel.m_toWorlds[blas.LevelIdx];
+            const float3 c = mesh->m_AABB.Center;
+            const float3 centerW = c.x * M.m[0] + c.y * M.m[1] + c.z * M.m[2] + M.m[3];
+            const float scale = Max(M.m[0].length(), Max(M.m[1].length(), M.m[2].length()));
+            const float radius = mesh->m_AABB.Extents.length() * scale;
+            const float dist = Max((centerW - camPos).length() - radius, 1e-4f);
+            const float projectedSize = radius / (dist * tanHalfFOV);
+
+            lod = blas.LOD;
+
+            while (lod + 1 < numLODs && projectedSize < LOD_PROJECTED_SIZE[lod] * (1.0f - LOD_HYSTERESIS))
+                lod++;
+            while (lod > 0 && projectedSize > LOD_PROJECTED_SIZE[lod - 1] * (1.0f + LOD_HYSTERESIS))
+                lod--;
         }
 
-        SmallVector<int, App::FrameAllocator, 3> touchedPages;
+        if (lod == blas.LOD)
+            continue;
 
-        for (auto& b : builds)
-        {
-            if (!m_dynamicBLASArenas.empty())
+        const uint64_t key = DynamicBLASKey(blas.TreeLevel, blas.LevelIdx);
+        auto inProgress = std::lower_bound(m_lodBLASes.begin(), m_lodBLASes.begin() + numInProgress, 
+            key,
+            [](const DynamicBLAS& lhs, uint64_t k)
             {
-                m_dynamicBLASArenas.back().CurrOffset = AlignUp(m_dynamicBLASArenas.back().CurrOffset,
-                    (uint32_t)D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
-            }
+                return DynamicBLASLess(lhs.TreeLevel, lhs.LevelIdx, (uint32_t)(k >> 32), 
+                    (uint32_t)k);
+            });
 
-            if (m_dynamicBLASArenas.empty() ||
-                (m_dynamicBLASArenas.back().CurrOffset + b.BuildInfo.ResultDataMaxSizeInBytes >=
-                    m_dynamicBLASArenas.back().Page.Desc().Width))
-            {
-                const uint32_t sizeInBytes = Max((uint32)b.BuildInfo.ResultDataMaxSizeInBytes,
-                    BLAS_ARENA_PAGE_SIZE);
-                auto page = GpuMemory::GetDefaultHeapBuffer("BLASArenaPage",
-                    sizeInBytes,
-                    true,
-                    true);
+        if (inProgress != m_lodBLASes.begin() + numInProgress && 
+            DynamicBLASKey(inProgress->TreeLevel, inProgress->LevelIdx) == key)
+        {
+            continue;
+        }
 
-                m_dynamicBLASArenas.push_back(ArenaPage{ .Page = ZetaMove(page),
-                    .CurrOffset = 0 });
+        m_lodBLASes.push_back(QueueDynamicBLASBuild(meshID, blas.TreeLevel, blas.LevelIdx, lod,
+            BLAS_LIST::LOD));
 
-                LOG_UI_INFO("Allocated dynamic BLAS page (%llu MB)...", sizeInBytes / (1024 * 1024));
-            }
+        if (++numQueued == MAX_LOD_SWITCHES_PER_UPDATE)
+            break;
+    }
 
-            // InstanceID is filled in by RebuildTLASInstances()
-            m_dynamicBLASes.push_back(DynamicBLAS{ .PageIdx = (int)m_dynamicBLASArenas.size() - 1,
-                .PageOffset = m_dynamicBLASArenas.back().CurrOffset,
-                .TreeLevel = b.TreeLevel,
-                .LevelIdx = b.LevelIdx,
-                .InstanceID = UINT32_MAX });
-            m_dynamicBLASArenas.back().CurrOffset += (uint32)b.BuildInfo.ResultDataMaxSizeInBytes;
-
-            touchedPages.push_back((int)(m_dynamicBLASArenas.size() - 1));
-
-            D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc{};
-            buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-            buildDesc.Inputs.Flags = BuildFlags(RT_MESH_MODE::DYNAMIC_NO_REBUILD);
-            buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-            buildDesc.Inputs.NumDescs = 1;
-            buildDesc.Inputs.pGeometryDescs = &b.GeoDesc;
-            buildDesc.DestAccelerationStructureData = m_dynamicBLASArenas.back().Page.GpuVA() +
-                m_dynamicBLASes.back().PageOffset;
-            buildDesc.ScratchAccelerationStructureData = m_scratchBuffer.GpuVA() +
-                b.ScratchBufferOffset;
-            buildDesc.SourceAccelerationStructureData = 0;
-
-            cmdList.PIXBeginEvent("DynamicBLASBuild");
-            cmdList.BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
-            cmdList.PIXEndEvent();
-
-            std::sort(m_dynamicBLASes.begin(), m_dynamicBLASes.end(),
-                [](const DynamicBLAS& lhs, const DynamicBLAS& rhs)
-                {
-                    if (lhs.TreeLevel < rhs.TreeLevel)
-                        return true;
-                    else if (lhs.TreeLevel > rhs.TreeLevel)
-                        return false;
+    if (numQueued)
+    {
+        std::sort(m_lodBLASes.begin(), m_lodBLASes.end(),
+            [](const DynamicBLAS& lhs, const DynamicBLAS& rhs)
+            {
+                return DynamicBLASLess(lhs.TreeLevel, lhs.LevelIdx, rhs.TreeLevel, rhs.LevelIdx);
+            });
+    }
+}
 
-                    return lhs.LevelIdx < rhs.LevelIdx;
-                });
-        }
+void TLAS::CommitDynamicBLASLODs()
+{
+    // Compacted size of a BLAS from the batch that's in flight wouldn't match its 
+    // replacement
+    if (m_lodBLASes.empty() || m_compaction.InFlight)
+        return;
 
-        // Insert a barrier for every used page
-        if(touchedPages.size() > 1)
-            std::sort(touchedPages.begin(), touchedPages.end());
+    SceneCore& scene = App::GetScene();
 
-        for (int i = 0; i < (int)touchedPages.size(); i++)
+    for (auto it = m_lodBLASes.begin(); it != m_lodBLASes.end();)
+    {
+        if (it->BuildFrame == BLAS_NOT_BUILT)
         {
-            if (i == 0 || touchedPages[i] != touchedPages[i - 1])
-            {
-                D3D12_BUFFER_BARRIER barrier = Direct3DUtil::BufferBarrier(
-                    m_dynamicBLASArenas[touchedPages[i]].Page.Resource(),
-                    D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE,
-                    D3D12_BARRIER_SYNC_BUILD_RAYTRACING_ACCELERATION_STRUCTURE | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
-                    D3D12_BARRIER_ACCESS_UNORDERED_ACCESS | D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_WRITE,
-                    D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ);
-
-                uavBarriers.push_back(barrier);
-            }
+            it++;
+            continue;
         }
-    }
 
-    if (!uavBarriers.empty())
-        cmdList.ResourceBarrier(uavBarriers.data(), (uint32_t)uavBarriers.size());
+        DynamicBLAS& blas = FindDynamicBLAS(m_dynamicBLASes,
+            DynamicBLASKey(it->TreeLevel, it->LevelIdx));
 
-    m_rebuildDynamicBLASes = false;
+        // Previous frame's TLAS might still be referencing the old one
+        FreeDynamicBLAS(blas.PageIdx, blas.Alloc);
+        blas.PageIdx = it->PageIdx;
+        blas.Alloc = it->Alloc;
+        blas.BuildFrame = it->BuildFrame;
+        blas.LOD = it->LOD;
+        blas.Compacted = false;
+
+        // LODs share the vertices of their source mesh, only the index range changes
+        const TriangleMesh* mesh = scene.GetMesh(DynamicBLASMeshID(blas)).value();
+        m_frameInstanceData[blas.InstanceID].BaseIdxOffset = mesh->m_gpuIdxBuffOffset |
+            (mesh->Uses16BitIndices() ? MESH_INSTANCE_16BIT_INDICES : 0);
+
+        UploadMeshInstanceIdxOffset(blas.InstanceID);
+        m_pendingLODMeshInstances.push_back(blas.InstanceID);
+        m_tlasInstancesStale = true;
+
+        it = m_lodBLASes.erase(*it);
+    }
+}
+
+void TLAS::UploadMeshInstanceIdxOffset(uint32_t instanceID)
+{
+    // Rest of the mesh instance might be out of date (transforms are updated on the GPU)
+    const uint32_t offset = instanceID * sizeof(RT::MeshInstance) + 
+        offsetof(RT::MeshInstance, BaseIdxOffset);
+
+    GpuMemory::UploadToDefaultHeapBuffer(m_framesMeshInstances[m_frameIdx], sizeof(uint32_t),
+        MemoryRegion{ .Data = &m_frameInstanceData[instanceID].BaseIdxOffset,
+            .SizeInBytes = sizeof(uint32_t) },
+        offset);
 }
 
 void TLAS::UpdateTLASInstances(ComputeCmdList& cmdList)
 {
     // When static BLAS is compacted, the GPU buffer changes and static BLAS instance
     // below also changes, which requires TLAS instance buffer to be updated.
-    if (m_updateType == UPDATE_TYPE::NONE && m_tlasInstanceBuffer.IsInitialized())
+    if (m_updateType == UPDATE_TYPE::NONE && !m_tlasInstancesStale && 
+        m_tlasInstanceBuffer.IsInitialized())
+    {
         return;
+    }
 
     SceneCore& scene = App::GetScene();
-    const uint32_t numInstances = scene.m_numDynamicInstances + (scene.m_numStaticInstances > 0);
+    const uint32_t numInstances = scene.m_numDynamicInstances + NumStaticTLASInstances();
     if (numInstances == 0)
         return;
 
-    // Following order is important, STATIC_TO_DYNAMIC should supercede INSTANCE_TRANSFORM
+    bool rebuilt = false;
+    bool copied = true;
+
+    // Following order is important, STATIC_TO_DYNAMIC should supercede INSTANCE_TRANSFORM.
+    // When dynamic BLASes are built or moved, every instance is rewritten, which also 
+    // covers the other update types.
     if (m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC || !m_tlasInstanceBuffer.IsInitialized())
     {
         RebuildTLASInstances(cmdList);
         scene.m_pendingRtMeshModeSwitch.clear();
+        rebuilt = true;
+    }
+    else if (m_tlasInstancesStale)
+    {
+        RebuildTLASInstances(cmdList);
+        rebuilt = true;
     }
     else if (m_updateType == UPDATE_TYPE::STATIC_BLAS_COMPACTED)
         UpdateTLASInstances_StaticCompacted(cmdList);
     else if (m_updateType == UPDATE_TYPE::INSTANCE_TRANSFORM)
-        UpdateTLASInstances_NewTransform(cmdList);
+    {
+        if (m_transformUpdateDlg)
+            copied = false;
+        else
+            UpdateTLASInstances_NewTransform(cmdList);
+    }
     else
         Assert(false, "Unreachable case.");
 
+    m_tlasInstancesStale = false;
+
+    // Rebuild already wrote the latest transforms
+    const bool gpuTLASWrites = !m_transformUpdates.empty() && !rebuilt;
+
     // Wait for copy to be finished before doing compute work
-    auto barrier = Direct3DUtil::BufferBarrier(m_tlasInstanceBuffer.Resource(),
-        D3D12_BARRIER_SYNC_COPY,
-        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
-        D3D12_BARRIER_ACCESS_COPY_DEST,
-        D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+    if (copied)
+    {
+        auto barrier = Direct3DUtil::BufferBarrier(m_tlasInstanceBuffer.Resource(),
+            D3D12_BARRIER_SYNC_COPY,
+            D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_ACCESS_COPY_DEST,
+            gpuTLASWrites ? D3D12_BARRIER_ACCESS_UNORDERED_ACCESS : 
+                D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+
+        cmdList.ResourceBarrier(barrier);
+    }
 
-    cmdList.ResourceBarrier(barrier);
+    if (!m_transformUpdates.empty())
+        ApplyInstanceTransformUpdates(cmdList, !gpuTLASWrites);
 }
 
 void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
 {
     SceneCore& scene = App::GetScene();
     const uint32_t numStaticInstances = scene.m_numStaticInstances;
-    const uint32_t numInstances = scene.m_numDynamicInstances + (scene.m_numStaticInstances > 0);
+    const uint32_t numStaticTLASInstances = NumStaticTLASInstances();
+    const uint32_t numInstances = scene.m_numDynamicInstances + numStaticTLASInstances;
 
-    m_tlasInstances.resize(numInstances);
-
-    if (numStaticInstances)
-    {
-        m_tlasInstances[0].InstanceID = 0;
-        m_tlasInstances[0].InstanceMask = RT_AS_SUBGROUP::ALL;
-        m_tlasInstances[0].InstanceContributionToHitGroupIndex = 0;
-        m_tlasInstances[0].Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-        m_tlasInstances[0].AccelerationStructure = m_staticBLAS.m_buffer.GpuVA();
-
-        // Identity transform for static BLAS instance
-        memset(&m_tlasInstances[0].Transform, 0, sizeof(BLASTransform));
-        m_tlasInstances[0].Transform[0][0] = 1.0f;
-        m_tlasInstances[0].Transform[1][1] = 1.0f;
-        m_tlasInstances[0].Transform[2][2] = 1.0f;
-    }
+    // Every instance is rewritten below, so there's no need to preserve the old ones 
+    // if storage has to grow
+    m_tlasInstances.clear();
+    m_tlasInstances.resize_uninitialized(numInstances);
+    FillStaticTLASInstances();
 
     // Following traversal order must match the one in RebuildOrUpdateBLASes()
     uint32_t currDynamicInstance = 0;
@@ -1292,9 +2589,7 @@ void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
                     instance.InstanceMask = flags.InstanceMask;
                     instance.InstanceContributionToHitGroupIndex = 0;
                     instance.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-                    instance.AccelerationStructure = 
-                        m_dynamicBLASArenas[blas.PageIdx].Page.GpuVA() +
-                        blas.PageOffset;
+                    instance.AccelerationStructure = DynamicBLASInstanceVA(blas);
 
                     auto& M = currTreeLevel.m_toWorlds[i];
 
@@ -1305,7 +2600,7 @@ void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
                         instance.Transform[2][j] = M.m[j].z;
                     }
 
-                    m_tlasInstances[(numStaticInstances > 0) + currDynamicInstance++] = instance;
+                    m_tlasInstances[numStaticTLASInstances + currDynamicInstance++] = instance;
 
                     // Update RT-AS info
                     currTreeLevel.m_rtASInfo[i].GeometryIndex = 0;
@@ -1315,9 +2610,7 @@ void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
         }
     }
 
-    // When static BLAS is compacted but otherwise no other changes, only the 1st instance
-    // needs to be updated
-    Assert((numStaticInstances > 0) + currDynamicInstance == numInstances, "bug");
+    Assert(numStaticTLASInstances + currDynamicInstance == numInstances, "bug");
     const uint32_t sizeInBytes = sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * numInstances;
 
     const uint32_t alignedSizeInBytes = AlignUp(sizeInBytes,
@@ -1327,7 +2620,7 @@ void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
         (uint64)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) < alignedSizeInBytes)
     {
         m_tlasInstanceBuffer = GpuMemory::GetDefaultHeapBuffer("TLASInstances",
-            alignedSizeInBytes, D3D12_RESOURCE_STATE_COMMON, false);
+            alignedSizeInBytes, D3D12_RESOURCE_STATE_COMMON, true);
     }
 
     UploadHeapBuffer scratchBuff = GpuMemory::GetUploadHeapBuffer(sizeInBytes);
@@ -1342,34 +2635,23 @@ void TLAS::RebuildTLASInstances(ComputeCmdList& cmdList)
 
 void TLAS::UpdateTLASInstances_StaticCompacted(ComputeCmdList& cmdList)
 {
-    SceneCore& scene = App::GetScene();
-    Assert(scene.m_numStaticInstances, "Invalid call.");
-
-    m_tlasInstances.resize(Max(m_tlasInstances.size(), 1llu));
-
-    m_tlasInstances[0].InstanceID = 0;
-    m_tlasInstances[0].InstanceMask = RT_AS_SUBGROUP::ALL;
-    m_tlasInstances[0].InstanceContributionToHitGroupIndex = 0;
-    m_tlasInstances[0].Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-    m_tlasInstances[0].AccelerationStructure = m_staticBLAS.m_buffer.GpuVA();
-
-    // Identity transform for static BLAS instance
-    memset(&m_tlasInstances[0].Transform, 0, sizeof(BLASTransform));
-    m_tlasInstances[0].Transform[0][0] = 1.0f;
-    m_tlasInstances[0].Transform[1][1] = 1.0f;
-    m_tlasInstances[0].Transform[2][2] = 1.0f;
-
-    // When static BLAS is compacted but otherwise no other changes, only the 1st instance
-    // needs to be updated
-    constexpr uint32_t sizeInBytes = sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
-    constexpr uint32_t alignedSizeInBytes = AlignUp(sizeInBytes,
+    const uint32_t numStaticTLASInstances = NumStaticTLASInstances();
+    Assert(numStaticTLASInstances, "Invalid call.");
+
+    m_tlasInstances.resize(Max(m_tlasInstances.size(), (size_t)numStaticTLASInstances));
+    FillStaticTLASInstances();
+
+    // When static BLASes are compacted but otherwise no other changes, only the static 
+    // instances (which come first) need to be updated
+    const uint32_t sizeInBytes = sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * numStaticTLASInstances;
+    const uint32_t alignedSizeInBytes = AlignUp(sizeInBytes,
         (uint32)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
 
     if (!m_tlasInstanceBuffer.IsInitialized() || AlignUp(m_tlasInstanceBuffer.Desc().Width,
         (uint64)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) < alignedSizeInBytes)
     {
         m_tlasInstanceBuffer = GpuMemory::GetDefaultHeapBuffer("TLASInstances",
-            alignedSizeInBytes, D3D12_RESOURCE_STATE_COMMON, false);
+            alignedSizeInBytes, D3D12_RESOURCE_STATE_COMMON, true);
     }
 
     UploadHeapBuffer scratchBuff = GpuMemory::GetUploadHeapBuffer(sizeInBytes);
@@ -1389,27 +2671,22 @@ void TLAS::UpdateTLASInstances_NewTransform(ComputeCmdList& cmdList)
     int64 minIdx = m_dynamicBLASes.size() - 1;
     int64 maxIdx = 0;
     bool hadUpdates = false;
+    // Skip static instances
+    const uint32_t firstDynamicTLASInstance = NumStaticTLASInstances();
 
-    for (auto it = scene.m_instanceUpdates.begin_it(); it != scene.m_instanceUpdates.end_it();
-        it = scene.m_instanceUpdates.next_it(it))
+    for (const auto& u : scene.GetRenderSnapshot().InstanceUpdates)
     {
         // Just need to update current frame's transformation for TLAS instances (same
         // check as SceneCore::UpdateWorldTransformations())
-        if (it->Val < currFrame - 1)
+        if (u.Frame < currFrame - 1)
             continue;
 
-        const auto instance = it->Key;
-        const SceneCore::TreePos treePos = scene.FindTreePosFromID(instance).value();
+        const SceneCore::TreePos treePos{ .Level = u.TreeLevel, .Offset = u.LevelIdx };
 
         auto vecIt = std::lower_bound(m_dynamicBLASes.begin(), m_dynamicBLASes.end(), treePos,
             [](const DynamicBLAS& lhs, const SceneCore::TreePos &key)
             {
-                if (lhs.TreeLevel < key.Level)
-                    return true;
-                else if (lhs.TreeLevel > key.Level)
-                    return false;
-
-                return lhs.LevelIdx < key.Offset;
+                return DynamicBLASLess(lhs.TreeLevel, lhs.LevelIdx, key.Level, key.Offset);
             });
 
         Assert(vecIt != m_dynamicBLASes.end(), "Dynamic BLAS for instance was not found.");
@@ -1425,11 +2702,9 @@ void TLAS::UpdateTLASInstances_NewTransform(ComputeCmdList& cmdList)
         tlasIns.InstanceMask = 0xff;
         tlasIns.InstanceContributionToHitGroupIndex = 0;
         tlasIns.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-        tlasIns.AccelerationStructure =
-            m_dynamicBLASArenas[blas.PageIdx].Page.GpuVA() +
-            blas.PageOffset;
+        tlasIns.AccelerationStructure = DynamicBLASInstanceVA(blas);
 
-        auto& M = scene.GetToWorld(instance);
+        const auto& M = u.ToWorld;
 
         for (int j = 0; j < 4; j++)
         {
@@ -1438,8 +2713,7 @@ void TLAS::UpdateTLASInstances_NewTransform(ComputeCmdList& cmdList)
             tlasIns.Transform[2][j] = M.m[j].z;
         }
 
-        // + 1 to skip static instance
-        m_tlasInstances[idx + 1] = tlasIns;
+        m_tlasInstances[firstDynamicTLASInstance + idx] = tlasIns;
 
         hadUpdates = true;
     }
@@ -1451,8 +2725,7 @@ void TLAS::UpdateTLASInstances_NewTransform(ComputeCmdList& cmdList)
         const size_t sizeInBytes = numInstancesToCopy * sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
 
         UploadHeapBuffer scratchBuff = GpuMemory::GetUploadHeapBuffer((uint32)sizeInBytes);
-        // + 1 to skip static instance
-        minIdx++;
+        minIdx += firstDynamicTLASInstance;
         scratchBuff.Copy(0, (uint32)sizeInBytes, m_tlasInstances.data() + minIdx);
 
         cmdList.CopyBufferRegion(m_tlasInstanceBuffer.Resource(),
@@ -1461,31 +2734,53 @@ void TLAS::UpdateTLASInstances_NewTransform(ComputeCmdList& cmdList)
             scratchBuff.Offset(),
             sizeInBytes);
     }
+}
 
-    for (auto it = scene.m_instanceUpdates.begin_it(); it != scene.m_instanceUpdates.end_it();
-        it = scene.m_instanceUpdates.next_it(it))
+void TLAS::ApplyInstanceTransformUpdates(ComputeCmdList& cmdList, bool skipTLASInstances)
+{
+    if (skipTLASInstances)
     {
-        // TODO For some reason the following check has to be against currFrame - 2 instead
-        // of currFrame - 1. Sequence of actions for world transfrom update from frame T to 
-        // W_new:
-        // T: Update was added at the tail end of frame
-        // T + 1: Scene and RT transforms are updated to W_new, prev transform is changed to W_old
-        // T + 2: Prev transform in scene and then mesh instance buffer are updated to W_new. Motion
-        //        vectors become zero again.
-        // T + 3: ?
-        if (it->Val < currFrame - 2)
-        {
-            scene.m_instanceUpdates.erase(it->Key);
-            //LOG_UI_INFO("Erased frame %llu", it->Val);
-        }
+        for (auto& u : m_transformUpdates)
+            u.TLASInstanceIdx = UINT32_MAX;
     }
+
+    const uint32_t sizeInBytes = (uint32_t)(m_transformUpdates.size() * sizeof(InstanceTransformUpdate));
+    UploadHeapBuffer updates = GpuMemory::GetUploadHeapBuffer(sizeInBytes, 
+        alignof(InstanceTransformUpdate));
+    updates.Copy(0, sizeInBytes, m_transformUpdates.data());
+
+    InstanceTransformUpdateArgs args;
+    args.Updates = updates.GpuVA();
+    args.NumUpdates = (uint32_t)m_transformUpdates.size();
+    args.TLASInstances = m_tlasInstanceBuffer.Resource();
+    args.MeshInstances = m_framesMeshInstances[m_frameIdx].Resource();
+
+    m_transformUpdateDlg(cmdList, args);
+
+    // Wait for the writes to be finished before TLAS build and shading. Mesh instances
+    // might also be copied to previous frame's buffer in RebuildTLAS().
+    D3D12_BUFFER_BARRIER barriers[2];
+    barriers[0] = Direct3DUtil::BufferBarrier(m_framesMeshInstances[m_frameIdx].Resource(),
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_SYNC_ALL_SHADING | D3D12_BARRIER_SYNC_COPY,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+        D3D12_BARRIER_ACCESS_SHADER_RESOURCE | D3D12_BARRIER_ACCESS_COPY_SOURCE);
+    barriers[1] = Direct3DUtil::BufferBarrier(m_tlasInstanceBuffer.Resource(),
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+        D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+
+    cmdList.ResourceBarrier(barriers, skipTLASInstances ? 1 : 2);
+
+    m_transformUpdates.clear();
 }
 
 void TLAS::RebuildTLAS(ComputeCmdList& cmdList)
 {
     SceneCore& scene = App::GetScene();
 
-    const uint32_t numInstances = scene.m_numDynamicInstances + (scene.m_numStaticInstances > 0);
+    const uint32_t numInstances = scene.m_numDynamicInstances + NumStaticTLASInstances();
     if (numInstances == 0)
         return;
 
@@ -1505,36 +2800,35 @@ void TLAS::RebuildTLAS(ComputeCmdList& cmdList)
     const uint32_t alignedBufferSize = AlignUp((uint32_t)prebuildInfo.ResultDataMaxSizeInBytes,
         (uint32_t)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
 
-    if (!m_tlasBuffer[m_frameIdx].IsInitialized() ||
-        m_tlasBuffer[m_frameIdx].Desc().Width < alignedBufferSize)
+    const int prevTlasIdx = (m_tlasIdx + NUM_TLAS_BUFFERS - 1) % NUM_TLAS_BUFFERS;
+    bool reallocated = false;
+
+    if (!m_tlasBuffer[m_tlasIdx].IsInitialized() ||
+        m_tlasBuffer[m_tlasIdx].Desc().Width < alignedBufferSize)
     {
         const size_t offset = AlignUp(alignedBufferSize, 
             (uint32_t)D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT);
-        const size_t totalSize = offset + alignedBufferSize;
-        m_tlasResHeap = GpuMemory::GetResourceHeap(totalSize);
-
-        m_tlasBuffer[m_frameIdx] = GpuMemory::GetPlacedHeapBuffer("TLAS_A",
-            alignedBufferSize,
-            m_tlasResHeap.Heap(),
-            0,
-            true,
-            true);
-        m_tlasBuffer[1 - m_frameIdx] = GpuMemory::GetPlacedHeapBuffer("TLAS_B",
-            alignedBufferSize,
-            m_tlasResHeap.Heap(),
-            offset,
-            true,
-            true);
+        const size_t totalSize = offset * (NUM_TLAS_BUFFERS - 1) + alignedBufferSize;
+        m_tlasResHeap = GpuMemory::GetResourceHeap("TLAS", totalSize, MEMORY_CATEGORY::RT_AS);
 
-        cmdList.UAVBarrier(m_tlasBuffer[m_frameIdx].Resource());
+        const char* names[NUM_TLAS_BUFFERS] = { "TLAS_A", "TLAS_B", "TLAS_C" };
+
+        for (int i = 0; i < NUM_TLAS_BUFFERS; i++)
+        {
+            m_tlasBuffer[i] = GpuMemory::GetPlacedHeapBuffer(names[i],
+                alignedBufferSize,
+                m_tlasResHeap.Heap(),
+                offset * i,
+                true,
+                true);
+        }
 
-        cmdList.CopyAccelerationStructure(m_tlasBuffer[1 - m_frameIdx].GpuVA(), 
-            m_tlasBuffer[m_frameIdx].GpuVA());
+        reallocated = true;
     }
 
     auto& r = App::GetRenderer().GetSharedShaderResources();
-    r.InsertOrAssignDefaultHeapBuffer(GlobalResource::RT_SCENE_BVH_CURR, m_tlasBuffer[m_frameIdx]);
-    r.InsertOrAssignDefaultHeapBuffer(GlobalResource::RT_SCENE_BVH_PREV, m_tlasBuffer[1 - m_frameIdx]);
+    r.InsertOrAssignDefaultHeapBuffer(GlobalResource::RT_SCENE_BVH_CURR, m_tlasBuffer[m_tlasIdx]);
+    r.InsertOrAssignDefaultHeapBuffer(GlobalResource::RT_SCENE_BVH_PREV, m_tlasBuffer[prevTlasIdx]);
     r.InsertOrAssignDefaultHeapBuffer(GlobalResource::RT_FRAME_MESH_INSTANCES_CURR, 
         m_framesMeshInstances[m_frameIdx]);
     r.InsertOrAssignDefaultHeapBuffer(GlobalResource::RT_FRAME_MESH_INSTANCES_PREV, 
@@ -1552,24 +2846,29 @@ void TLAS::RebuildTLAS(ComputeCmdList& cmdList)
             true);
     }
 
-    buildDesc.DestAccelerationStructureData = m_tlasBuffer[m_frameIdx].GpuVA();
-    // Note that scratch buffer is reused for dynamic BLAS builds & TLAS with overlapping
-    // addresses, but due to inserted barrier, it's safe.
+    buildDesc.DestAccelerationStructureData = m_tlasBuffer[m_tlasIdx].GpuVA();
     buildDesc.ScratchAccelerationStructureData = m_scratchBuffer.GpuVA();
     buildDesc.SourceAccelerationStructureData = 0;
 
     cmdList.BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
 
-     if (m_updateType == UPDATE_TYPE::STATIC_BLAS_COMPACTED ||
-         m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC)
-     {
-         cmdList.UAVBarrier(m_tlasBuffer[m_frameIdx].Resource());
+    // Previous TLAS is either out of date or, after reallocation, uninitialized
+    const bool overwritePrev = m_updateType == UPDATE_TYPE::STATIC_BLAS_COMPACTED ||
+        m_updateType == UPDATE_TYPE::STATIC_TO_DYNAMIC;
+
+    if (overwritePrev || reallocated)
+    {
+        cmdList.UAVBarrier(m_tlasBuffer[m_tlasIdx].Resource());
+
+        cmdList.CopyAccelerationStructure(m_tlasBuffer[prevTlasIdx].GpuVA(),
+            m_tlasBuffer[m_tlasIdx].GpuVA());
+    }
 
-         cmdList.CopyAccelerationStructure(m_tlasBuffer[1 - m_frameIdx].GpuVA(),
-             m_tlasBuffer[m_frameIdx].GpuVA());
-         cmdList.CopyResource(m_framesMeshInstances[1 - m_frameIdx].Resource(),
-             m_framesMeshInstances[m_frameIdx].Resource());
-     }
+    if (overwritePrev)
+    {
+        cmdList.CopyResource(m_framesMeshInstances[1 - m_frameIdx].Resource(),
+            m_framesMeshInstances[m_frameIdx].Resource());
+    }
 
     // Even though TLAS was created with an initial stete of 
     // D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, the debug layer 
@@ -3,7 +3,9 @@
 #include "../Core/GpuMemory.h"
 #include "RtCommon.h"
 #include "../Scene/SceneCommon.h"
+#include "../Model/Mesh.h"
 #include "../Support/Task.h"
+#include "../Support/OffsetAllocator.h"
 
 namespace ZetaRay::Core
 {
@@ -23,61 +25,202 @@ namespace ZetaRay::RT
     // Static BLAS
     //--------------------------------------------------------------------------------------
 
+    // Static meshes are split into multiple BLASes, each covering a contiguous range of
+    // static instances in scene traversal order. Static instance i of BLAS with first 
+    // instance b has GeometryIndex = i - b and InstanceID = b, so GeometryIndex + InstanceID
+    // still indexes into the mesh instance buffer.
     struct StaticBLAS
     {
+        Core::GpuMemory::PlacedResourceList<3> RebuildResourceList() const;
         void Rebuild(Core::ComputeCmdList& cmdList);
         void DoCompaction(Core::ComputeCmdList& cmdList);
         void CompactionCompletedCallback();
+        // Called on a background thread once the compacted size has been read back
+        void CompactionInfoReadbackCallback(Util::Span<uint8_t> data);
         void FillMeshTransformBufferForBuild(ID3D12Heap* heap = nullptr, 
             uint32_t heapOffsetInBytes = 0);
+        void Reset();
+
+        // Compacted BLAS is serialized to disk after the first build and loaded in 
+        // later runs, as long as scene and driver match
+        void ComputeCacheKey();
+        bool LoadFromCache();
+        void Deserialize(Core::ComputeCmdList& cmdList);
+        void Serialize(Core::ComputeCmdList& cmdList);
+        void SerializationInfoReadbackCallback(Util::Span<uint8_t> data);
+        void SerializedReadbackCallback(Util::Span<uint8_t> data);
 
         Core::GpuMemory::Buffer m_buffer;
         Core::GpuMemory::Buffer m_bufferCompacted;
         Core::GpuMemory::Buffer m_scratch;
         Core::GpuMemory::ResourceHeap m_resHeap;
 
-        Core::GpuMemory::ReadbackHeapBuffer m_postBuildInfoReadback;
-
         // 3x4 affine transformation matrix for each triangle mesh
         Core::GpuMemory::Buffer m_perMeshTransform;
 
         // Cache the results as it's expensive to compute
         D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO m_prebuildInfo = {};
 
+        uint64_t m_compactedSizeInBytes = 0;
+        std::atomic_bool m_compactionInfoReady = false;
         std::atomic_bool m_compactionCompleted = false;
         std::atomic_bool m_heapAllocated = false;
         bool m_heapAllocationInProgress = false;
         uint32_t m_BLASHeapOffsetInBytes = UINT32_MAX;
         uint32_t m_scratchHeapOffsetInBytes = UINT32_MAX;
+
+        // [m_baseInstance, m_baseInstance + m_numInstances) in scene traversal order
+        uint32_t m_baseInstance = 0;
+        uint32_t m_numInstances = 0;
+        bool m_compacted = false;
+
+        // Zero when caching is disabled or done
+        uint64_t m_cacheKey = 0;
+        // Source of deserialization or destination of serialization
+        Core::GpuMemory::Buffer m_serialized;
+        uint64_t m_serializedSizeInBytes = 0;
+        std::atomic_bool m_serializationInfoReady = false;
+        std::atomic_bool m_cacheWritten = false;
+        bool m_loadedFromCache = false;
     };
 
     //--------------------------------------------------------------------------------------
     // TLAS
     //--------------------------------------------------------------------------------------
 
+    struct InstanceTransformUpdateArgs
+    {
+        // Array of RT::InstanceTransformUpdate
+        D3D12_GPU_VIRTUAL_ADDRESS Updates;
+        uint32_t NumUpdates;
+        // Array of D3D12_RAYTRACING_INSTANCE_DESC, only transforms are written
+        ID3D12Resource* TLASInstances;
+        // Array of RT::MeshInstance, only transform fields are written
+        ID3D12Resource* MeshInstances;
+    };
+
+    // Applies given transform updates using a compute shader. Both buffers are in a UAV
+    // state after the call.
+    using InstanceTransformUpdateDlg = fastdelegate::FastDelegate2<Core::ComputeCmdList&, 
+        const InstanceTransformUpdateArgs&>;
+
     struct TLAS
     {
         void Update();
         void Render(Core::CommandList& cmdList);
-        ZetaInline const Core::GpuMemory::Buffer& GetTLAS() const { return m_tlasBuffer[m_frameIdx];  };
+        ZetaInline const Core::GpuMemory::Buffer& GetTLAS() const { return m_tlasBuffer[m_tlasIdx];  };
         ZetaInline bool IsReady() const { return m_ready; };
+        void OnMemoryPressure(Core::GpuMemory::MEMORY_PRESSURE p);
+        // When set, transform updates are applied to TLAS instances and frame mesh instances 
+        // on the GPU, so that CPU only has to upload the new transforms. Should be set before
+        // the first update and not changed afterwards.
+        ZetaInline void SetInstanceTransformUpdateDlg(InstanceTransformUpdateDlg dlg) { m_transformUpdateDlg = dlg; }
+        ZetaInline uint32_t NumFrameMeshInstances() const { return (uint32_t)m_frameInstanceData.size(); }
+        // Mesh (possibly a LOD) that the given frame mesh instance currently uses
+        uint64_t FrameMeshInstanceMeshID(uint32_t idx) const;
 
     private:
         static constexpr uint32_t BLAS_ARENA_PAGE_SIZE = 4 * 1024 * 1024;
+        // BLASes up to this size go to their own (smaller) pages, so that churn of small 
+        // BLASes doesn't fragment the pages that large ones need
+        static constexpr uint32_t SMALL_BLAS_MAX_SIZE = 64 * 1024;
+        static constexpr uint32_t SMALL_BLAS_ARENA_PAGE_SIZE = 1024 * 1024;
+        // Current and previous frame's TLASes are both read by the direct queue while 
+        // the next frame's AS build might already be running on the async. compute queue,
+        // so it needs a third one to write to
+        static constexpr int NUM_TLAS_BUFFERS = 3;
+        static constexpr uint32_t MAX_NUM_BLASES_PER_PAGE = 1024;
+        // Dynamic BLAS builds are spread over multiple frames when more than this many
+        // triangles (or more than scratch pool's capacity) would be built in one frame
+        static constexpr uint32_t MAX_BLAS_BUILD_TRIANGLES_PER_FRAME = 512 * 1024;
+        static constexpr uint32_t BLAS_SCRATCH_POOL_SIZE = 16 * 1024 * 1024;
+        static constexpr uint64_t BLAS_NOT_BUILT = UINT64_MAX;
+        // Each static BLAS covers about this many triangles, unless that would require
+        // more than the maximum number of static BLASes
+        static constexpr uint32_t STATIC_BLAS_NUM_TRIANGLES = 1024 * 1024;
+        static constexpr int MAX_NUM_STATIC_BLASES = 16;
+        // LODs of dynamic instances are re-evaluated every this many frames
+        static constexpr uint32_t LOD_UPDATE_INTERVAL = 8;
+        // Instance switches to LOD i + 1 once its projected size -- radius of its bounding 
+        // sphere over distance times tan(FOV / 2) -- drops below the i-th value
+        static constexpr float LOD_PROJECTED_SIZE[Model::MAX_NUM_MESH_LODS - 1] = { 0.2f, 0.08f, 0.03f };
+        // Switching back and forth around the thresholds is avoided by requiring the 
+        // projected size to be this (relative) amount past them
+        static constexpr float LOD_HYSTERESIS = 0.2f;
+        static constexpr uint32_t MAX_LOD_SWITCHES_PER_UPDATE = 64;
+
+        enum class BLAS_SIZE_CLASS : uint8_t
+        {
+            SMALL,
+            LARGE,
+            // Larger than BLAS_ARENA_PAGE_SIZE, page is sized to fit 
+            DEDICATED,
+            COUNT
+        };
 
         struct ArenaPage
         {
             Core::GpuMemory::Buffer Page;
-            uint32_t CurrOffset;
+            Support::OffsetAllocator Allocator;
+            BLAS_SIZE_CLASS SizeClass;
+            // Set while its BLASes are being moved to other pages, no new allocations 
+            // are made from it
+            bool Retiring;
         };
 
         struct DynamicBLAS
         {
             int PageIdx;
-            uint32_t PageOffset;
+            Support::OffsetAllocator::Allocation Alloc;
             uint32_t TreeLevel;
             uint32_t LevelIdx;
             uint32_t InstanceID;
+            // Frame when BLAS was last written to, BLAS_NOT_BUILT while its build is queued
+            uint64_t BuildFrame;
+            // Level of detail of the mesh that BLAS was built from
+            uint32_t LOD;
+            bool Compacted;
+        };
+
+        enum class BLAS_LIST : uint8_t
+        {
+            // Referenced by TLAS instances
+            ACTIVE,
+            // Belongs to an instance that's switching from static to dynamic
+            STAGED,
+            // Replaces the BLAS of a dynamic instance that's switching LODs
+            LOD
+        };
+
+        struct PendingBuild
+        {
+            // (TreeLevel, LevelIdx)
+            uint64_t BLAS;
+            uint32_t ScratchSizeInBytes;
+            uint32_t NumTriangles;
+            BLAS_LIST List;
+        };
+
+        // Page memory that might still be referenced by GPU
+        struct PendingFree
+        {
+            int PageIdx;
+            Support::OffsetAllocator::Allocation Alloc;
+            uint64_t FrameIdx;
+        };
+
+        // Dynamic BLASes are compacted in batches -- compacted sizes for every uncompacted
+        // BLAS are emitted and read back asynchronously, then once available in a later 
+        // frame, BLASes are copied to new (smaller) allocations. At most one batch is in
+        // flight at any time.
+        struct CompactionBatch
+        {
+            Core::GpuMemory::Buffer Info;
+            // (TreeLevel, LevelIdx) of each BLAS in the batch
+            Util::SmallVector<uint64_t> BLASes;
+            Util::SmallVector<uint64_t> CompactedSizes;
+            std::atomic_bool Ready = false;
+            bool InFlight = false;
         };
 
         enum class UPDATE_TYPE
@@ -94,40 +237,119 @@ namespace ZetaRay::RT
         void RebuildFrameMeshInstanceData();
         void UpdateFrameMeshInstances_StaticToDynamic();
         void UpdateFrameMeshInstances_NewTransform();
+        void GatherInstanceTransformUpdates();
+        void RefreshDynamicFrameMeshInstances();
+
+        // Static BLASes
+        void PartitionStaticBLASes();
+        void UpdateStaticBLASCache(Core::ComputeCmdList& cmdList);
+        void UpdateStaticRtASInfos();
+        int FindStaticBLAS(uint64_t instanceID) const;
+        uint32_t ModeSwitchStaticBLASMask() const;
+        void RemoveModeSwitchInstancesFromStaticBLASes();
+        bool StaticBLASesCompacted() const;
+        bool StaticBLASCacheWritesPending() const;
+        uint32_t NumStaticTLASInstances() const;
 
         // BLASes
-        void BuildDynamicBLASes(Core::ComputeCmdList& cmdList);
+        // "meshID" is the source mesh (LOD 0)
+        DynamicBLAS QueueDynamicBLASBuild(uint64_t meshID, uint32_t treeLevel, uint32_t levelIdx, 
+            uint32_t lod, BLAS_LIST list);
+        uint64_t DynamicBLASMeshID(const DynamicBLAS& blas) const;
+        void QueueDynamicBLASBuilds();
         void RebuildOrUpdateBLASes(Core::ComputeCmdList& cmdList);
+        int AllocateDynamicBLAS(uint32_t sizeInBytes, bool allowNewPage, 
+            Support::OffsetAllocator::Allocation& alloc);
+        void FreeDynamicBLAS(int pageIdx, const Support::OffsetAllocator::Allocation& alloc);
+        ZetaInline D3D12_GPU_VIRTUAL_ADDRESS DynamicBLASGpuVA(const DynamicBLAS& blas) const
+        {
+            return m_dynamicBLASArenas[blas.PageIdx].Page.GpuVA() + blas.Alloc.Offset;
+        }
+        // TLAS instances with a null BLAS are inactive
+        ZetaInline D3D12_GPU_VIRTUAL_ADDRESS DynamicBLASInstanceVA(const DynamicBLAS& blas) const
+        {
+            return blas.BuildFrame != BLAS_NOT_BUILT ? DynamicBLASGpuVA(blas) : 0;
+        }
+        void StageModeSwitchBLASes();
+        void BuildPendingDynamicBLASes(Core::ComputeCmdList& cmdList, Util::Vector<int>& touchedPages);
+        void ReleaseDynamicBLASMemory();
+        void UpdateBLASPagePriority();
+        void CompactDynamicBLASes(Core::ComputeCmdList& cmdList, Util::Vector<int>& touchedPages);
+        void CompactionInfoReadbackCallback(Util::Span<uint8_t> data);
+        void DefragmentDynamicBLASes(Core::ComputeCmdList& cmdList, Util::Vector<int>& touchedPages);
+
+        // Dynamic BLAS LODs
+        void SelectDynamicBLASLODs();
+        void CommitDynamicBLASLODs();
+        void UploadMeshInstanceIdxOffset(uint32_t instanceID);
 
         // TLAS instances
         void UpdateTLASInstances(Core::ComputeCmdList& cmdList);
+        uint32_t FillStaticTLASInstances();
         void RebuildTLASInstances(Core::ComputeCmdList& cmdList);
         void UpdateTLASInstances_StaticCompacted(Core::ComputeCmdList& cmdList);
         void UpdateTLASInstances_NewTransform(Core::ComputeCmdList& cmdList);
+        void ApplyInstanceTransformUpdates(Core::ComputeCmdList& cmdList, bool skipTLASInstances);
 
         void RebuildTLAS(Core::ComputeCmdList& cmdList);
 
-        StaticBLAS m_staticBLAS;
+        StaticBLAS m_staticBLASes[MAX_NUM_STATIC_BLASES];
+        int m_numStaticBLASes = 0;
+        // Static BLASes that are rebuilt for the current switch to dynamic
+        uint32_t m_staticBLASRebuildMask = 0;
+        // Static BLASes with a compaction in flight, there's at most one batch at a time
+        uint32_t m_staticCompactionMask = 0;
         Core::GpuMemory::Buffer m_framesMeshInstances[2];
-        Core::GpuMemory::Buffer m_tlasBuffer[2];
+        Core::GpuMemory::Buffer m_tlasBuffer[NUM_TLAS_BUFFERS];
         Core::GpuMemory::Buffer m_scratchBuffer;
+        // Reused by dynamic BLAS builds every frame, only grows when a single build
+        // doesn't fit
+        Core::GpuMemory::Buffer m_blasScratchPool;
         Core::GpuMemory::Buffer m_tlasInstanceBuffer;
         Core::GpuMemory::ResourceHeap m_tlasResHeap;
         Core::GpuMemory::ResourceHeap m_meshInstanceResHeap;
 
         // Dynamic BLAS
         Util::SmallVector<ArenaPage> m_dynamicBLASArenas;
+        D3D12_RESIDENCY_PRIORITY m_blasPagePriority = D3D12_RESIDENCY_PRIORITY_NORMAL;
+        // Set by the memory pressure callback, applied to the pages by Render()
+        std::atomic_uint32_t m_requestedBLASPagePriority = D3D12_RESIDENCY_PRIORITY_NORMAL;
         Util::SmallVector<DynamicBLAS> m_dynamicBLASes;
+        Util::SmallVector<PendingFree> m_pendingBLASFrees;
+        Util::SmallVector<PendingBuild> m_pendingBLASBuilds;
+        // BLASes for instances with a pending switch to dynamic, sorted by tree position.
+        // Until all of them are built (possibly over multiple frames), those instances keep 
+        // using the static BLAS.
+        Util::SmallVector<DynamicBLAS> m_stagedBLASes;
+        uint32_t m_numUnbuiltStagedBLASes = 0;
+        // BLASes for instances that are switching LODs, sorted by tree position. Each one
+        // replaces the instance's current BLAS once built.
+        Util::SmallVector<DynamicBLAS> m_lodBLASes;
+        // Mesh instances whose index offset changed in the last frame, the other mesh 
+        // instance buffer needs the same update
+        Util::SmallVector<uint32_t> m_pendingLODMeshInstances;
+        CompactionBatch m_compaction;
+        // Total free page space when defragmentation last failed
+        // Per size class
+        uint64_t m_defragFailedFreeSpace[(int)BLAS_SIZE_CLASS::COUNT] = { 0 };
 
         Util::SmallVector<RT::MeshInstance> m_frameInstanceData;
         Util::SmallVector<D3D12_RAYTRACING_INSTANCE_DESC, Support::SystemAllocator, 1> m_tlasInstances;
+        // Transform updates for this frame, applied on the GPU
+        Util::SmallVector<RT::InstanceTransformUpdate> m_transformUpdates;
+        InstanceTransformUpdateDlg m_transformUpdateDlg;
 
         Support::WaitObject m_waitObj;
-        std::atomic_bool m_compactionInfoReady = false;
-        bool m_staticBLASCompacted = false;
         bool m_rebuildDynamicBLASes = true;
+        // Set when dynamic BLASes were built or moved, every TLAS instance is rewritten
+        bool m_tlasInstancesStale = false;
+        // Set when transform updates were only applied on the GPU -- transforms of dynamic
+        // instances in m_frameInstanceData are out of date
+        bool m_frameInstanceDataStale = false;
         UPDATE_TYPE m_updateType = UPDATE_TYPE::NONE;
         int m_frameIdx = 0;
+        int m_tlasIdx = 0;
+        bool m_asyncBuildLastFrame = false;
 
         bool m_ready = false;
     };
@@ -5,6 +5,7 @@
 
 #ifdef __cplusplus
 #include "../Math/VectorFuncs.h"
+#include "../Core/Vertex.h"
 #else
 #include "../../ZetaRenderPass/Common/Math.hlsli"
 #endif
@@ -26,6 +27,26 @@
 #define EMISSIVE_UV_TYPE float2_
 #endif
 
+// When enabled, scene vertex buffer on the GPU uses the 16-byte CompactVertex layout
+// (see Core/Vertex.h) instead of the 28-byte Vertex. Positions are quantized relative 
+// to the mesh AABB, which is folded into the BLAS geometry transforms and is stored 
+// in each mesh instance for dequantization in shaders.
+#define COMPACT_VERTEX 0
+
+// Set on MeshInstance::BaseIdxOffset for meshes that use 16-bit indices. Remaining bits 
+// give the offset in units of the mesh's index format.
+#define MESH_INSTANCE_16BIT_INDICES (1u << 31)
+
+// Limits for meshlets that are rasterized with mesh shaders. Triangle count is kept 
+// slightly below 128 so that mesh shader output stays within the recommended size.
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// Light voxel grid is made up of this many camera-relative cascades with the same 
+// dimensions, where voxels in each cascade are twice as large as the previous one
+#define LVG_NUM_CASCADES 3
+#define NUM_SAMPLES_PER_VOXEL 64
+
 // From DXR docs:
 // "Meshes present in an acceleration structure can be subdivided into groups
 // based on a specified 8-bit mask value. During ray traversal, instance mask from 
@@ -44,9 +65,18 @@ namespace ZetaRay
 #endif
     namespace RT
     {
+#ifdef __cplusplus
+#if COMPACT_VERTEX == 1
+        using GpuVertex = Core::CompactVertex;
+#else
+        using GpuVertex = Core::Vertex;
+#endif
+#endif
+
         struct MeshInstance
         {
             uint32_t BaseVtxOffset;
+            // See MESH_INSTANCE_16BIT_INDICES
             uint32_t BaseIdxOffset;
             unorm4_ Rotation;
             half3_ Scale;
@@ -61,6 +91,24 @@ namespace ZetaRay
             // inline alpha stuff to avoid loading material data in anyhit shaders
             uint16_t BaseColorTex;
             uint16_t AlphaFactor_Cutoff;
+
+#if COMPACT_VERTEX == 1
+            // Local position = quantized position * PosExtents + PosCenter
+            float3_ PosCenter;
+            float3_ PosExtents;
+#endif
+        };
+
+        // New world transform of a dynamic instance. TLAS instance desc and transform
+        // fields of the corresponding mesh instance are derived from it on the GPU.
+        struct InstanceTransformUpdate
+        {
+            // Rows of the 4x3 affine transformation matrix
+            float3_ M[4];
+            float3_ PrevM[4];
+            // UINT32_MAX when TLAS instance doesn't need to be updated
+            uint32_t TLASInstanceIdx;
+            uint32_t MeshInstanceIdx;
         };
 
         struct EmissiveTriangle
@@ -290,6 +338,30 @@ namespace ZetaRay
 #endif
         };
 
+        // Object-space position of an emissive triangle (same encoding as EmissiveTriangle).
+        // Kept on the GPU so that triangles of moving instances can be transformed there.
+        struct EmissiveTriangleObjSpace
+        {
+            // = CommittedPrimitiveIndex(): "...index of the primitive within the geometry 
+            // inside the bottom-level acceleration structure instance..."
+            uint32_t PrimIdx;
+            float3_ Vtx0;
+            unorm2_ V0V1;
+            unorm2_ V0V2;
+            half2_ EdgeLengths;
+        };
+
+        // Transforms the triangles of one emissive instance from object space to world space
+        struct EmissivePositionUpdate
+        {
+            // Rows of the 4x3 affine transformation matrix
+            float3_ M[4];
+            uint32_t BaseTriOffset;
+            uint32_t NumTriangles;
+            // Used for computing the triangle IDs
+            uint32_t RtInstanceID;
+        };
+
         // Given discrete probability distribution P with N outcomes, such that for outcome i and random variable x,
         //      P[i] = P[x = i],
         // 
@@ -314,6 +386,9 @@ namespace ZetaRay
             float3_ pos;
             unorm2_ normal;
             float pdf;
+            // Pdf of drawing this sample from the alias table. Differs from pdf when
+            // presampling is view dependent.
+            float sourcePdf;
             uint32_t ID;
             uint32_t idx;
             unorm2_ bary;
@@ -321,15 +396,55 @@ namespace ZetaRay
             uint16_t twoSided;
         };
 
+        // Node of the light BVH over emissive triangles. Tree is a complete binary tree that's
+        // stored implicitly -- children of node i are 2i + 1 and 2i + 2.
+        struct LightBVHNode
+        {
+            float3_ BoundsMin;
+            float Flux;
+            float3_ BoundsMax;
+            // Emissive triangle index for leaves, UINT32_MAX otherwise
+            uint32_t TriIdx;
+            // Normal cone. Emissive triangles are Lambertian, so the cone of emission
+            // directions is always the normal cone widened by pi / 2.
+            float3_ Axis;
+            float CosTheta_o;
+        };
+
+        // Light sample that's been resampled for a voxel of the light voxel grid
         struct VoxelSample
         {
             float3_ pos;
             unorm2_ normal;
+            // RIS estimate of the pdf of drawing this sample from the voxel
             float pdf;
+            // Pdf of drawing this sample from the alias table
+            float sourcePdf;
             uint32_t ID;
+            uint32_t idx;
+            unorm2_ bary;
             half3_ le;
             uint16_t twoSided;
         };
+
+        // Contiguous range of triangles of a mesh. Meshlet data buffer, starting at 
+        // DataOffset, holds NumVerts mesh-local vertex indices followed by NumTris 
+        // triangles, each packed as three 8-bit meshlet-local vertex indices.
+        struct Meshlet
+        {
+            // Bounding sphere in mesh-local space
+            float3_ Center;
+            float Radius;
+            // Normal cone for backface culling. Meshlet can be culled when 
+            // dot(normalize(Center - eye), ConeAxis) >= ConeCutoff.
+            unorm2_ ConeAxis;
+            float ConeCutoff;
+            uint32_t DataOffset;
+            // Index of first triangle within the mesh
+            uint32_t FirstTri;
+            uint16_t NumVerts;
+            uint16_t NumTris;
+        };
     }
 #ifdef __cplusplus
 }
@@ -19,23 +19,48 @@ using namespace ZetaRay::Model::glTF;
 // TexSRVDescriptorTable
 //--------------------------------------------------------------------------------------
 
-TexSRVDescriptorTable::TexSRVDescriptorTable(const uint32_t descTableSize)
-    : m_descTableSize(descTableSize),
-    m_numMasks(descTableSize >> 6)
+TexSRVDescriptorTable::TexSRVDescriptorTable(const uint32_t initialSize)
+    : m_initialSize(initialSize),
+    m_descTableSize(initialSize)
 {
-    Assert(Math::IsPow2(descTableSize), "descriptor table size must be a power of two.");
-    Assert(descTableSize < MAX_NUM_DESCRIPTORS, "desc. table size exceeded maximum allowed.");
+    Assert(Math::IsPow2(initialSize), "descriptor table size must be a power of two.");
+    Assert(initialSize <= MAX_NUM_DESCRIPTORS, "desc. table size exceeded maximum allowed.");
 }
 
 void TexSRVDescriptorTable::Init(uint64_t id)
 {
     m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate(m_descTableSize);
     Assert(!m_descTable.IsEmpty(), "Allocating descriptors from the GPU descriptor heap failed.");
+    m_descTableCpu = App::GetRenderer().GetCbvSrvUavDescriptorHeapCpu().Allocate(m_descTableSize);
+    Assert(!m_descTableCpu.IsEmpty(), "Allocating descriptors from the CPU descriptor heap failed.");
+    m_slotIDs.resize(m_descTableSize, Texture::INVALID_ID);
 
     auto& s = App::GetRenderer().GetSharedShaderResources();
     s.InsertOrAssignDescriptorTable(id, m_descTable);
 }
 
+void TexSRVDescriptorTable::Grow()
+{
+    const uint32_t newSize = m_descTableSize << 1;
+    Check(newSize <= MAX_NUM_DESCRIPTORS, "Number of textures exceeded maximum allowed (%u).", 
+        MAX_NUM_DESCRIPTORS);
+
+    DescriptorTable newTable = App::GetRenderer().GetCbvSrvUavDescriptorHeapCpu().Allocate(newSize);
+    Assert(!newTable.IsEmpty(), "Allocating descriptors from the CPU descriptor heap failed.");
+
+    auto* device = App::GetRenderer().GetDevice();
+    device->CopyDescriptorsSimple(m_descTableSize, newTable.CPUHandle(0), m_descTableCpu.CPUHandle(0),
+        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    m_descTableCpu = ZetaMove(newTable);
+    m_slotIDs.resize(newSize, Texture::INVALID_ID);
+    m_descTableSize = newSize;
+
+    // Shader-visible table is too small now, a larger one is published in the next Commit()
+    m_added.Clear();
+    m_stale = true;
+}
+
 uint32_t TexSRVDescriptorTable::Add(Texture&& tex)
 {
     // If texture already exists, just increase the ref count and return it
@@ -50,28 +75,32 @@ uint32_t TexSRVDescriptorTable::Add(Texture&& tex)
 
     Assert(tex.IsInitialized(), "Texture hasn't been initialized.");
 
-    // Find first free slot in table
-    uint32_t freeSlot = UINT32_MAX;
-    int i = 0;
+    uint32_t freeSlot;
 
-    for (; i < (int)m_numMasks; i++)
+    if (!m_freeSlots.empty())
     {
-        freeSlot = (uint32)_tzcnt_u64(~m_inUseBitset[i]);
-        if (freeSlot != 64)
-            break;
+        freeSlot = m_freeSlots.back();
+        m_freeSlots.pop_back();
     }
+    else
+    {
+        if (m_numUsedSlots == m_descTableSize)
+            Grow();
 
-    Assert(freeSlot != UINT32_MAX, "No free slot was found.");
-    m_inUseBitset[i] |= (1llu << freeSlot);    // Set the slot to occupied
+        freeSlot = m_numUsedSlots++;
+    }
 
-    freeSlot += i * 64;        // Each uint64_t covers 64 slots
-    Assert(freeSlot < m_descTableSize, "Invalid table index.");
+    Assert(m_slotIDs[freeSlot] == Texture::INVALID_ID, "Slot %u is in use.", freeSlot);
+    Direct3DUtil::CreateTexture2DSRV(tex, m_descTableCpu.CPUHandle(freeSlot));
 
-    auto descCpuHandle = m_descTable.CPUHandle(freeSlot);
-    Direct3DUtil::CreateTexture2DSRV(tex, descCpuHandle);
+    // Slot is not referenced by any material yet, so the shader-visible table can be 
+    // written to directly. Copies are batched in Commit().
+    if (!m_stale)
+        m_added.Add(freeSlot, freeSlot + 1);
 
     // Remember ID before moving the texture
     const Texture::ID_TYPE id = tex.ID();
+    m_slotIDs[freeSlot] = id;
 
     // Add this texture to cache
     m_cache.insert_or_assign(id, CacheEntry{
@@ -82,6 +111,112 @@ uint32_t TexSRVDescriptorTable::Add(Texture&& tex)
     return freeSlot;
 }
 
+bool TexSRVDescriptorTable::Replace(Texture&& tex, uint64_t fenceVal)
+{
+    Assert(tex.IsInitialized(), "Texture hasn't been initialized.");
+    auto it = m_cache.find(tex.ID());
+    if (!it)
+        return false;
+
+    CacheEntry& entry = *it.value();
+    Direct3DUtil::CreateTexture2DSRV(tex, m_descTableCpu.CPUHandle(entry.DescTableOffset));
+
+    // Descriptor slot remains in use
+    m_pending.push_back(ToBeFreedTexture{ .T = ZetaMove(entry.T),
+        .FenceVal = fenceVal,
+        .DescTableOffset = UINT32_MAX });
+
+    entry.T = ZetaMove(tex);
+    m_added.Clear();
+    m_stale = true;
+
+    return true;
+}
+
+Texture::ID_TYPE TexSRVDescriptorTable::Remove(uint32_t descTableOffset, uint64_t fenceVal)
+{
+    Assert(descTableOffset < m_numUsedSlots, "invalid offset.");
+
+    const Texture::ID_TYPE id = m_slotIDs[descTableOffset];
+    auto it = m_cache.find(id);
+    Assert(it, "Texture at offset %u was not found.", descTableOffset);
+    CacheEntry& entry = *it.value();
+    Assert(entry.RefCount > 0, "Invalid ref count.");
+
+    if (--entry.RefCount > 0)
+        return Texture::INVALID_ID;
+
+    // Descriptor slot is freed in Recycle() once GPU is done with it. Until then, the 
+    // stale descriptor is left in place, so no new table has to be published.
+    m_pending.push_back(ToBeFreedTexture{ .T = ZetaMove(entry.T),
+        .FenceVal = fenceVal,
+        .DescTableOffset = descTableOffset });
+
+    m_slotIDs[descTableOffset] = Texture::INVALID_ID;
+    m_cache.erase(id);
+
+    return id;
+}
+
+Texture::ID_TYPE TexSRVDescriptorTable::FindID(uint32_t descTableOffset)
+{
+    return descTableOffset < m_numUsedSlots ? m_slotIDs[descTableOffset] : Texture::INVALID_ID;
+}
+
+uint32_t TexSRVDescriptorTable::FindOffset(Texture::ID_TYPE ID)
+{
+    if (auto it = m_cache.find(ID); it)
+        return it.value()->DescTableOffset;
+
+    return UINT32_MAX;
+}
+
+void TexSRVDescriptorTable::Commit()
+{
+    auto* device = App::GetRenderer().GetDevice();
+
+    if (!m_stale)
+    {
+        if (m_added.Empty())
+            return;
+
+        // All the added ranges are copied with one call
+        SmallVector<D3D12_CPU_DESCRIPTOR_HANDLE, App::FrameAllocator> dstStarts;
+        SmallVector<D3D12_CPU_DESCRIPTOR_HANDLE, App::FrameAllocator> srcStarts;
+        SmallVector<UINT, App::FrameAllocator> sizes;
+        const auto ranges = m_added.Ranges();
+        dstStarts.reserve(ranges.size());
+        srcStarts.reserve(ranges.size());
+        sizes.reserve(ranges.size());
+
+        for (auto& r : ranges)
+        {
+            dstStarts.push_back(m_descTable.CPUHandle(r.Begin));
+            srcStarts.push_back(m_descTableCpu.CPUHandle(r.Begin));
+            sizes.push_back(r.End - r.Begin);
+        }
+
+        device->CopyDescriptors((UINT)dstStarts.size(), dstStarts.data(), sizes.data(),
+            (UINT)srcStarts.size(), srcStarts.data(), sizes.data(), 
+            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+        m_added.Clear();
+
+        return;
+    }
+
+    DescriptorTable newTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate(m_descTableSize);
+    Assert(!newTable.IsEmpty(), "Allocating descriptors from the GPU descriptor heap failed.");
+
+    device->CopyDescriptorsSimple(m_descTableSize, newTable.CPUHandle(0), m_descTableCpu.CPUHandle(0),
+        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    // Prior table is released after GPU has finished the current frame. Shared shader 
+    // resources point to this member, so they see the new table as well.
+    m_descTable = ZetaMove(newTable);
+    m_stale = false;
+}
+
 void TexSRVDescriptorTable::Recycle(uint64_t completedFenceVal)
 {
     for(auto it = m_pending.begin(); it != m_pending.end();)
@@ -89,11 +224,14 @@ void TexSRVDescriptorTable::Recycle(uint64_t completedFenceVal)
         // GPU is finished with this descriptor
         if (it->FenceVal <= completedFenceVal)
         {
-            // Set the descriptor slot to free
-            const uint32_t idx = it->DescTableOffset >> 6;
-            Assert(idx < m_numMasks, "invalid index.");
-            m_inUseBitset[idx] |= (1llu << (it->DescTableOffset & 63));
-
+            // Return the descriptor slot to the free list (replaced textures keep their slot)
+            if (it->DescTableOffset != UINT32_MAX)
+            {
+                Assert(it->DescTableOffset < m_numUsedSlots, "invalid offset.");
+                m_freeSlots.push_back(it->DescTableOffset);
+            }
+
+            it->T.Reset();
             it = m_pending.erase(*it);
         }
         else
@@ -110,6 +248,58 @@ void TexSRVDescriptorTable::Clear()
         t.T.Reset(false);
 }
 
+//--------------------------------------------------------------------------------------
+// DirtyRanges
+//--------------------------------------------------------------------------------------
+
+void DirtyRanges::Add(uint32_t begin, uint32_t end)
+{
+    if (begin >= end)
+        return;
+
+    // First range that ends at or after begin -- all the ones before it are unaffected
+    auto it = std::lower_bound(m_ranges.begin(), m_ranges.end(), begin,
+        [](const Range& r, uint32_t val) { return r.End < val; });
+
+    // Merge with every range that overlaps or is adjacent to [begin, end)
+    auto last = it;
+    while (last != m_ranges.end() && last->Begin <= end)
+    {
+        begin = Math::Min(begin, last->Begin);
+        end = Math::Max(end, last->End);
+        last++;
+    }
+
+    const size_t pos = it - m_ranges.begin();
+    const size_t numMerged = last - it;
+
+    if (numMerged == 0)
+    {
+        m_ranges.push_back(Range{});
+
+        for (size_t i = m_ranges.size() - 1; i > pos; i--)
+            m_ranges[i] = m_ranges[i - 1];
+    }
+    else if (numMerged > 1)
+    {
+        for (size_t i = pos + numMerged; i < m_ranges.size(); i++)
+            m_ranges[i - numMerged + 1] = m_ranges[i];
+
+        m_ranges.resize(m_ranges.size() - numMerged + 1);
+    }
+
+    m_ranges[pos] = Range{ .Begin = begin, .End = end };
+}
+
+uint32_t DirtyRanges::NumElements() const
+{
+    uint32_t n = 0;
+    for (auto& r : m_ranges)
+        n += r.End - r.Begin;
+
+    return n;
+}
+
 //--------------------------------------------------------------------------------------
 // MaterialBuffer
 //--------------------------------------------------------------------------------------
@@ -134,6 +324,38 @@ void MaterialBuffer::Add(uint32_t ID, const Material& mat)
     Assert(freeIdx < MAX_NUM_MATERIALS, "Invalid table index.");
 
     m_materials[ID] = Entry{ .Mat = mat, .GpuBufferIdx = freeIdx };
+
+    // Materials that are added after the first upload (possibly into the slot of a 
+    // removed one)
+    if (m_buffer.IsInitialized())
+        m_dirty.Add(freeIdx, freeIdx + 1);
+}
+
+void MaterialBuffer::Remove(uint32_t ID, uint64_t fenceVal)
+{
+    auto it = m_materials.find(ID);
+    Assert(it, "Material with ID %u was not found.", ID);
+    const uint32_t idx = it.value()->GpuBufferIdx;
+
+    // Slot is freed in Recycle() once GPU is done with it. Instances that were using 
+    // this material must have been removed or updated beforehand.
+    m_pendingFrees.push_back(PendingFree{ .GpuBufferIdx = idx, .FenceVal = fenceVal });
+    m_materials.erase(ID);
+}
+
+void MaterialBuffer::Recycle(uint64_t completedFenceVal)
+{
+    for (auto it = m_pendingFrees.begin(); it != m_pendingFrees.end();)
+    {
+        // GPU is finished with this slot, it's reused by the next Add()
+        if (it->FenceVal <= completedFenceVal)
+        {
+            m_inUseBitset[it->GpuBufferIdx >> 6] &= ~(1llu << (it->GpuBufferIdx & 63));
+            it = m_pendingFrees.erase(*it);
+        }
+        else
+            it++;
+    }
 }
 
 void MaterialBuffer::UploadToGPU()
@@ -141,8 +363,13 @@ void MaterialBuffer::UploadToGPU()
     // First time
     if (!m_buffer.IsInitialized())
     {
+        // Slots might not be contiguous if some materials were removed
+        uint32_t numSlots = 0;
+        for (auto it = m_materials.begin_it(); it < m_materials.end_it(); it = m_materials.next_it(it))
+            numSlots = Math::Max(numSlots, it->Val.GpuBufferIdx + 1);
+
         SmallVector<Material, FrameAllocator> buffer;
-        buffer.resize(m_materials.size());
+        buffer.resize(numSlots);
 
         // Convert hash table to array
         for (auto it = m_materials.begin_it(); it < m_materials.end_it(); it = m_materials.next_it(it))
@@ -151,26 +378,62 @@ void MaterialBuffer::UploadToGPU()
             buffer[bufferIndex] = it->Val.Mat;
         }
 
+        // Sized for every possible slot, so that later additions don't need to 
+        // recreate it
         auto& renderer = App::GetRenderer();
         const size_t sizeInBytes = buffer.size() * sizeof(Material);
         m_buffer = GpuMemory::GetDefaultHeapBufferAndInit("MaterialBuffer",
-            (uint32_t)sizeInBytes,
+            MAX_NUM_MATERIALS * sizeof(Material),
             false,
             MemoryRegion{.Data = buffer.data(), .SizeInBytes = sizeInBytes });
 
         auto& r = renderer.GetSharedShaderResources();
         r.InsertOrAssignDefaultHeapBuffer(GlobalResource::MATERIAL_BUFFER, m_buffer);
+        m_dirty.Clear();
     }
-    // Update a single material
-    else if (m_staleID != UINT32_MAX)
+    // Upload the modified materials, one copy per dirty range
+    else if (!m_dirty.Empty())
     {
-        auto* entry = m_materials.find(m_staleID).value();
+        auto ranges = m_dirty.Ranges();
+        const uint32_t numDirty = m_dirty.NumElements();
+
+        // Materials are stored in hash table, gather the dirty ones so that each
+        // range is contiguous. Dirty range r starts at offsets[r].
+        SmallVector<Material, FrameAllocator> buffer;
+        buffer.resize(numDirty);
+        SmallVector<uint32_t, FrameAllocator> offsets;
+        offsets.resize(ranges.size());
+        uint32_t currOffset = 0;
 
-        GpuMemory::UploadToDefaultHeapBuffer(m_buffer, sizeof(Material),
-            MemoryRegion{.Data = &entry->Mat, .SizeInBytes = sizeof(Material)}, 
-            sizeof(Material) * entry->GpuBufferIdx);
+        for (size_t r = 0; r < ranges.size(); r++)
+        {
+            offsets[r] = currOffset;
+            currOffset += ranges[r].End - ranges[r].Begin;
+        }
+
+        for (auto it = m_materials.begin_it(); it < m_materials.end_it(); it = m_materials.next_it(it))
+        {
+            const uint32_t bufferIndex = it->Val.GpuBufferIdx;
+            auto r = std::upper_bound(ranges.begin(), ranges.end(), bufferIndex,
+                [](uint32_t val, const DirtyRanges::Range& range) { return val < range.Begin; });
+
+            if (r != ranges.begin() && bufferIndex < (r - 1)->End)
+            {
+                const size_t rIdx = (r - 1) - ranges.begin();
+                buffer[offsets[rIdx] + bufferIndex - ranges[rIdx].Begin] = it->Val.Mat;
+            }
+        }
+
+        for (size_t r = 0; r < ranges.size(); r++)
+        {
+            const uint32_t sizeInBytes = sizeof(Material) * (ranges[r].End - ranges[r].Begin);
+
+            GpuMemory::UploadToDefaultHeapBuffer(m_buffer, sizeInBytes,
+                MemoryRegion{.Data = &buffer[offsets[r]], .SizeInBytes = sizeInBytes }, 
+                sizeof(Material) * ranges[r].Begin);
+        }
 
-        m_staleID = UINT32_MAX;
+        m_dirty.Clear();
     }
 }
 
@@ -183,6 +446,8 @@ void MaterialBuffer::Clear()
 {
     // Assumes CPU-GPU synchronization has been performed, so that GPU is done with the material buffer.
     m_buffer.Reset();
+    m_dirty.Clear();
+    m_pendingFrees.clear();
 }
 
 //--------------------------------------------------------------------------------------
@@ -195,15 +460,19 @@ uint32_t MeshContainer::Add(SmallVector<Core::Vertex>&& vertices, SmallVector<ui
     const uint32_t vtxOffset = (uint32_t)m_vertices.size();
     const uint32_t idxOffset = (uint32_t)m_indices.size();
 
-    const uint32_t meshIdx = (uint32_t)m_meshes.size();
+    // Indices of removed meshes aren't reused
+    const uint32_t meshIdx = m_nextMeshIdx++;
     const uint64_t meshFromSceneID = Scene::MeshID(Scene::DEFAULT_SCENE_ID, meshIdx, 0);
     bool success = m_meshes.try_emplace(meshFromSceneID, vertices, vtxOffset, idxOffset, 
         (uint32_t)indices.size(), matIdx);
     Check(success, "mesh with ID (from mesh index %u) already exists.", meshIdx);
 
+    m_pendingMeshes.push_back(meshFromSceneID);
     m_vertices.append_range(vertices.begin(), vertices.end());
     m_indices.append_range(indices.begin(), indices.end());
 
+    AddLODs(meshFromSceneID);
+
     return meshIdx;
 }
 
@@ -213,6 +482,7 @@ void MeshContainer::AddBatch(SmallVector<Model::glTF::Asset::Mesh>&& meshes,
     const uint32_t vtxOffset = (uint32_t)m_vertices.size();
     const uint32_t idxOffset = (uint32_t)m_indices.size();
     m_meshes.resize(meshes.size(), true);
+    m_pendingMeshes.reserve(m_pendingMeshes.size() + meshes.size());
 
     // Each mesh primitive + material index combo must be unique
     for (auto& mesh : meshes)
@@ -230,6 +500,7 @@ void MeshContainer::AddBatch(SmallVector<Model::glTF::Asset::Mesh>&& meshes,
             matFromSceneID);
 
         Assert(success, "Mesh with ID %llu already exists.", meshFromSceneID);
+        m_pendingMeshes.push_back(meshFromSceneID);
     }
 
     if (m_vertices.empty())
@@ -241,6 +512,118 @@ void MeshContainer::AddBatch(SmallVector<Model::glTF::Asset::Mesh>&& meshes,
         m_indices = ZetaMove(indices);
     else
         m_indices.append_range(indices.begin(), indices.end());
+
+    App::DeltaTimer timer;
+    timer.Start();
+    uint32_t numLODs = 0;
+
+    for (auto& mesh : meshes)
+        numLODs += AddLODs(Scene::MeshID(mesh.SceneID, mesh.MeshIdx, mesh.MeshPrimIdx));
+
+    timer.End();
+
+    if (numLODs)
+        LOG_UI_INFO("Generated %u mesh LODs in %u [ms].", numLODs, (uint32_t)timer.DeltaMilli());
+}
+
+uint32_t MeshContainer::AddLODs(uint64_t id)
+{
+    // Copy as the table might grow below
+    const TriangleMesh mesh = *m_meshes.find(id).value();
+    const uint32_t numTris = mesh.m_numIndices / 3;
+
+    if (numTris < MIN_LOD_NUM_TRIANGLES)
+        return 0;
+
+    LODChain chain;
+    chain.NumLODs = 1;
+    SmallVector<uint32_t> lodIndices;
+    uint32_t prevNumTris = numTris;
+    // For a height field, about a quarter of the triangles
+    uint32_t gridRes = (uint32_t)sqrtf(numTris / 8.0f);
+
+    while (chain.NumLODs < Model::MAX_NUM_MESH_LODS && gridRes >= 2)
+    {
+        // Every LOD is simplified from the source mesh. Index buffer may have been 
+        // reallocated by the previous iteration.
+        Span<Vertex> srcVertices(m_vertices.data() + mesh.m_vtxBuffStartOffset, mesh.m_numVertices);
+        Span<uint32_t> srcIndices(m_indices.data() + mesh.m_idxBuffStartOffset, mesh.m_numIndices);
+
+        MeshSimplification::VertexClustering(srcVertices, srcIndices, mesh.m_AABB, gridRes,
+            lodIndices);
+        const uint32_t lodNumTris = (uint32_t)lodIndices.size() / 3;
+
+        // Closed or curved surfaces occupy more cells than a height field would, try a 
+        // coarser grid
+        if (lodNumTris > prevNumTris * MAX_LOD_TRIANGLE_RATIO)
+        {
+            gridRes /= 2;
+            continue;
+        }
+
+        if (lodNumTris < MIN_LOD_TRIANGLES)
+            break;
+
+        const uint64_t lodID = Scene::MeshLODID(id, chain.NumLODs);
+        const uint32_t idxOffset = (uint32_t)m_indices.size();
+        bool success = m_meshes.try_emplace(lodID, srcVertices, mesh.m_vtxBuffStartOffset,
+            idxOffset, (uint32_t)lodIndices.size(), mesh.m_materialID);
+        Assert(success, "Mesh with ID %llu already exists.", lodID);
+
+        m_pendingMeshes.push_back(lodID);
+        m_indices.append_range(lodIndices.begin(), lodIndices.end());
+
+        chain.MeshIDs[chain.NumLODs++ - 1] = lodID;
+        prevNumTris = lodNumTris;
+        gridRes /= 2;
+    }
+
+    if (chain.NumLODs > 1)
+    {
+        m_lods.insert_or_assign(id, chain);
+        m_numLODMeshes += chain.NumLODs - 1;
+    }
+
+    return chain.NumLODs - 1;
+}
+
+void MeshContainer::Remove(uint64_t id, uint64_t fenceVal)
+{
+    if (auto lods = m_lods.find(id); lods)
+    {
+        const LODChain chain = *lods.value();
+        m_lods.erase(id);
+
+        for (uint32_t i = 0; i < chain.NumLODs - 1; i++)
+            Remove(chain.MeshIDs[i], fenceVal);
+
+        m_numLODMeshes -= chain.NumLODs - 1;
+    }
+
+    auto it = m_meshes.find(id);
+    Assert(it, "Mesh with ID %llu was not found.", id);
+    const TriangleMesh& mesh = *it.value();
+
+    // Not uploaded yet, its CPU data is released after the next upload
+    if (auto pending = std::find(m_pendingMeshes.begin(), m_pendingMeshes.end(), id); 
+        pending != m_pendingMeshes.end())
+    {
+        m_pendingMeshes.erase(*pending);
+    }
+    else
+    {
+        ReleaseRange(BUFFER::VERTEX, mesh.m_vtxBuffStartOffset, fenceVal);
+        ReleaseRange(BUFFER::INDEX, mesh.m_gpuIdxBuffOffset * mesh.IndexSizeInBytes() / sizeof(uint32_t),
+            fenceVal);
+#if COMPACT_VERTEX == 1
+        ReleaseRange(BUFFER::QUANT_TRANSFORM, mesh.m_quantTransformIdx, fenceVal);
+#endif
+        ReleaseRange(BUFFER::MESHLET, mesh.m_meshletOffset, fenceVal);
+        ReleaseRange(BUFFER::MESHLET_DATA, mesh.m_meshletDataOffset, fenceVal);
+        m_contentHash = XXH3_64bits_withSeed(&id, sizeof(id), m_contentHash);
+    }
+
+    m_meshes.erase(id);
 }
 
 void MeshContainer::Reserve(size_t numVertices, size_t numIndices)
@@ -249,44 +632,379 @@ void MeshContainer::Reserve(size_t numVertices, size_t numIndices)
     m_indices.reserve(numIndices);
 }
 
-void MeshContainer::RebuildBuffers()
+void MeshContainer::UploadToGPU()
 {
+    if (m_pendingMeshes.empty())
+    {
+        m_vertices.free_memory();
+        m_indices.free_memory();
+
+        return;
+    }
+
     Assert(m_vertices.size() > 0, "vertex buffer is empty");
     Assert(m_indices.size() > 0, "index buffer is empty");
 
-    const uint32_t vbSizeInBytes = sizeof(Vertex) * (uint32_t)m_vertices.size();
-    const uint32_t ibSizeInBytes = sizeof(uint32_t) * (uint32_t)m_indices.size();
+    // A vertex, index or quantization transform range that was written to staging
+    struct StagedRange
+    {
+        uint32_t SrcOffset;
+        uint32_t Size;
+        uint32_t RefCount;
+        uint32_t DstOffset;
+    };
+
+    SmallVector<RT::GpuVertex> gpuVertices;
+    gpuVertices.reserve(m_vertices.size());
+    // Meshes that qualify use 16-bit indices. Each one starts at a uint boundary.
+    SmallVector<uint32_t> gpuIndices;
+    gpuIndices.reserve(m_indices.size());
+    SmallVector<QuantTransform> quantTransforms;
+    SmallVector<RT::Meshlet> meshlets;
+    SmallVector<uint32_t> meshletData;
+    SmallVector<StagedRange, FrameAllocator> staged[BUFFER::COUNT];
+    // Staged range of every pending mesh in each buffer
+    SmallVector<uint32_t, FrameAllocator> meshRanges[BUFFER::COUNT];
+
+    for (int b = 0; b < BUFFER::COUNT; b++)
+        meshRanges[b].resize(m_pendingMeshes.size());
+
+    // Meshes may share the same vertex or index range, in which case it's only 
+    // uploaded once
+    HashTable<uint32_t, uint64_t, FrameAllocator> vtxRangeToStaged;
+    vtxRangeToStaged.resize(m_pendingMeshes.size(), true);
+    HashTable<uint32_t, uint64_t, FrameAllocator> idxRangeToStaged;
+    idxRangeToStaged.resize(m_pendingMeshes.size(), true);
+    // Meshlets depend on both the vertex and the index range
+    HashTable<uint32_t, uint64_t, FrameAllocator> meshletRangeToStaged;
+    meshletRangeToStaged.resize(m_pendingMeshes.size(), true);
+
+    for (size_t m = 0; m < m_pendingMeshes.size(); m++)
+    {
+        const TriangleMesh& mesh = *m_meshes.find(m_pendingMeshes[m]).value();
+
+        if (auto existing = vtxRangeToStaged.find(mesh.m_vtxBuffStartOffset); existing)
+            meshRanges[BUFFER::VERTEX][m] = *existing.value();
+        else
+        {
+            const uint32_t srcOffset = (uint32_t)gpuVertices.size();
+            const Vertex* src = m_vertices.data() + mesh.m_vtxBuffStartOffset;
+
+#if COMPACT_VERTEX == 1
+            // Quantize every mesh against its own AABB
+            const float3 center = mesh.m_AABB.Center;
+            const float3 extents = mesh.QuantizationExtents();
+
+            for (uint32_t i = 0; i < mesh.m_numVertices; i++)
+                gpuVertices.push_back(CompactVertex(src[i], center, extents));
+#else
+            gpuVertices.append_range(src, src + mesh.m_numVertices);
+#endif
+
+            meshRanges[BUFFER::VERTEX][m] = (uint32_t)staged[BUFFER::VERTEX].size();
+            vtxRangeToStaged[mesh.m_vtxBuffStartOffset] = meshRanges[BUFFER::VERTEX][m];
+            staged[BUFFER::VERTEX].push_back(StagedRange{ .SrcOffset = srcOffset, 
+                .Size = mesh.m_numVertices });
+        }
+
+        staged[BUFFER::VERTEX][meshRanges[BUFFER::VERTEX][m]].RefCount++;
+
+        const uint64_t idxRangeKey = ((uint64_t)mesh.m_idxBuffStartOffset << 1) | mesh.Uses16BitIndices();
+
+        if (auto existing = idxRangeToStaged.find(idxRangeKey); existing)
+            meshRanges[BUFFER::INDEX][m] = *existing.value();
+        else
+        {
+            const uint32_t srcOffset = (uint32_t)gpuIndices.size();
+            const uint32_t numWords = (mesh.m_numIndices * mesh.IndexSizeInBytes() + 
+                sizeof(uint32_t) - 1) / sizeof(uint32_t);
+            gpuIndices.resize(srcOffset + numWords, 0);
+            const uint32_t* src = m_indices.data() + mesh.m_idxBuffStartOffset;
+
+            if (mesh.Uses16BitIndices())
+            {
+                uint16_t* dst = reinterpret_cast<uint16_t*>(gpuIndices.data() + srcOffset);
+
+                for (uint32_t i = 0; i < mesh.m_numIndices; i++)
+                    dst[i] = (uint16_t)src[i];
+            }
+            else
+                memcpy(gpuIndices.data() + srcOffset, src, mesh.m_numIndices * sizeof(uint32_t));
+
+            meshRanges[BUFFER::INDEX][m] = (uint32_t)staged[BUFFER::INDEX].size();
+            idxRangeToStaged[idxRangeKey] = meshRanges[BUFFER::INDEX][m];
+            staged[BUFFER::INDEX].push_back(StagedRange{ .SrcOffset = srcOffset, .Size = numWords });
+        }
+
+        staged[BUFFER::INDEX][meshRanges[BUFFER::INDEX][m]].RefCount++;
 
-    PlacedResourceList<2> list;
+        const uint64_t meshletRangeKey = ((uint64_t)mesh.m_vtxBuffStartOffset << 32) | 
+            mesh.m_idxBuffStartOffset;
+
+        if (auto existing = meshletRangeToStaged.find(meshletRangeKey); existing)
+        {
+            meshRanges[BUFFER::MESHLET][m] = *existing.value();
+            meshRanges[BUFFER::MESHLET_DATA][m] = *existing.value();
+        }
+        else
+        {
+            const uint32_t srcOffset = (uint32_t)meshlets.size();
+            const uint32_t dataSrcOffset = (uint32_t)meshletData.size();
+            Model::Meshlets::Build(Span(m_vertices.data() + mesh.m_vtxBuffStartOffset, mesh.m_numVertices),
+                Span(m_indices.data() + mesh.m_idxBuffStartOffset, mesh.m_numIndices),
+                meshlets, meshletData);
+
+            // Both buffers use the same staged range index
+            meshRanges[BUFFER::MESHLET][m] = (uint32_t)staged[BUFFER::MESHLET].size();
+            meshRanges[BUFFER::MESHLET_DATA][m] = meshRanges[BUFFER::MESHLET][m];
+            meshletRangeToStaged[meshletRangeKey] = meshRanges[BUFFER::MESHLET][m];
+            staged[BUFFER::MESHLET].push_back(StagedRange{ .SrcOffset = srcOffset, 
+                .Size = (uint32_t)meshlets.size() - srcOffset });
+            staged[BUFFER::MESHLET_DATA].push_back(StagedRange{ .SrcOffset = dataSrcOffset, 
+                .Size = (uint32_t)meshletData.size() - dataSrcOffset });
+        }
+
+        staged[BUFFER::MESHLET][meshRanges[BUFFER::MESHLET][m]].RefCount++;
+        staged[BUFFER::MESHLET_DATA][meshRanges[BUFFER::MESHLET_DATA][m]].RefCount++;
+
+#if COMPACT_VERTEX == 1
+        // Dequantization transform of each mesh goes into a separate buffer, which 
+        // is used for building dynamic BLASes
+        const float3 center = mesh.m_AABB.Center;
+        const float3 extents = mesh.QuantizationExtents();
+
+        meshRanges[BUFFER::QUANT_TRANSFORM][m] = (uint32_t)staged[BUFFER::QUANT_TRANSFORM].size();
+        staged[BUFFER::QUANT_TRANSFORM].push_back(StagedRange{ 
+            .SrcOffset = (uint32_t)quantTransforms.size(),
+            .Size = 1,
+            .RefCount = 1 });
+
+        // 3x4 row-major
+        quantTransforms.push_back(QuantTransform{ .M = { 
+            { extents.x, 0, 0, center.x },
+            { 0, extents.y, 0, center.y },
+            { 0, 0, extents.z, center.z } } });
+#endif
+    }
+
+    const bool firstTime = !m_vertexBuffer.IsInitialized();
+
+    if (firstTime)
+    {
+        const uint32_t stagedSizes[BUFFER::COUNT] = { (uint32_t)gpuVertices.size(),
+            (uint32_t)gpuIndices.size(), 
+            (uint32_t)quantTransforms.size(),
+            (uint32_t)meshlets.size(),
+            (uint32_t)meshletData.size() };
+
+        // Leave room for meshes that are added later. Removals fragment the free space, 
+        // hence the extra allocator nodes.
+        for (int b = 0; b < BUFFER::COUNT; b++)
+        {
+            m_capacity[b] = Math::Max(stagedSizes[b] + 
+                (uint32_t)(((uint64_t)stagedSizes[b] * SPARE_CAPACITY) / 100), 1u);
+            m_allocators[b].Init(m_capacity[b], (uint32_t)staged[b].size() * 2 + 1024);
+        }
+    }
+
+    for (int b = 0; b < BUFFER::COUNT; b++)
+    {
+        for (auto& r : staged[b])
+        {
+            const auto alloc = m_allocators[b].Allocate(r.Size);
+            Check(!alloc.IsEmpty(), "Mesh buffer %d is out of space -- meshes that are added after "
+                "the first upload must fit in its spare capacity.", b);
+
+            // Fresh allocators hand out consecutive ranges, so the first upload is one
+            // copy per buffer
+            Assert(!firstTime || alloc.Offset == r.SrcOffset, "Unexpected allocation offset.");
+
+            r.DstOffset = alloc.Offset;
+            m_ranges[b].insert_or_assign(alloc.Offset, GpuRange{ .Alloc = alloc, 
+                .RefCount = r.RefCount });
+        }
+    }
+
+    // Meshlet data offsets were relative to staging
+    for (size_t r = 0; r < staged[BUFFER::MESHLET].size(); r++)
+    {
+        const StagedRange& range = staged[BUFFER::MESHLET][r];
+        const StagedRange& dataRange = staged[BUFFER::MESHLET_DATA][r];
+
+        for (uint32_t i = range.SrcOffset; i < range.SrcOffset + range.Size; i++)
+            meshlets[i].DataOffset = meshlets[i].DataOffset - dataRange.SrcOffset + dataRange.DstOffset;
+    }
+
+    for (size_t m = 0; m < m_pendingMeshes.size(); m++)
+    {
+        TriangleMesh& mesh = *m_meshes.find(m_pendingMeshes[m]).value();
+        mesh.m_vtxBuffStartOffset = staged[BUFFER::VERTEX][meshRanges[BUFFER::VERTEX][m]].DstOffset;
+        mesh.m_gpuIdxBuffOffset = staged[BUFFER::INDEX][meshRanges[BUFFER::INDEX][m]].DstOffset * 
+            sizeof(uint32_t) / mesh.IndexSizeInBytes();
+#if COMPACT_VERTEX == 1
+        mesh.m_quantTransformIdx = staged[BUFFER::QUANT_TRANSFORM][meshRanges[BUFFER::QUANT_TRANSFORM][m]].DstOffset;
+#endif
+        const StagedRange& meshletRange = staged[BUFFER::MESHLET][meshRanges[BUFFER::MESHLET][m]];
+        mesh.m_meshletOffset = meshletRange.DstOffset;
+        mesh.m_numMeshlets = meshletRange.Size;
+        mesh.m_meshletDataOffset = staged[BUFFER::MESHLET_DATA][meshRanges[BUFFER::MESHLET_DATA][m]].DstOffset;
+    }
+
+    if (firstTime)
+    {
+        CreateBuffers(MemoryRegion{ .Data = gpuVertices.data(), 
+                .SizeInBytes = gpuVertices.size() * sizeof(RT::GpuVertex) },
+            MemoryRegion{ .Data = gpuIndices.data(), 
+                .SizeInBytes = gpuIndices.size() * sizeof(uint32_t) },
+            MemoryRegion{ .Data = quantTransforms.data(), 
+                .SizeInBytes = quantTransforms.size() * sizeof(QuantTransform) },
+            MemoryRegion{ .Data = meshlets.data(), 
+                .SizeInBytes = meshlets.size() * sizeof(RT::Meshlet) },
+            MemoryRegion{ .Data = meshletData.data(), 
+                .SizeInBytes = meshletData.size() * sizeof(uint32_t) });
+    }
+    else
+    {
+        auto upload = [](Buffer& buffer, Span<StagedRange> ranges, uint8_t* src, uint32_t elemSize)
+            {
+                for (size_t i = 0; i < ranges.size();)
+                {
+                    // Merge the ranges that are adjacent both in staging and in the GPU buffer
+                    uint32_t size = ranges[i].Size;
+                    size_t j = i + 1;
+
+                    while (j < ranges.size() && ranges[j].SrcOffset == ranges[i].SrcOffset + size &&
+                        ranges[j].DstOffset == ranges[i].DstOffset + size)
+                    {
+                        size += ranges[j++].Size;
+                    }
+
+                    const uint32_t sizeInBytes = size * elemSize;
+                    GpuMemory::UploadToDefaultHeapBuffer(buffer, sizeInBytes,
+                        MemoryRegion{ .Data = src + ranges[i].SrcOffset * elemSize, 
+                            .SizeInBytes = sizeInBytes },
+                        ranges[i].DstOffset * elemSize);
+
+                    i = j;
+                }
+            };
+
+        upload(m_vertexBuffer, staged[BUFFER::VERTEX],
+            reinterpret_cast<uint8_t*>(gpuVertices.data()), sizeof(RT::GpuVertex));
+        upload(m_indexBuffer, staged[BUFFER::INDEX],
+            reinterpret_cast<uint8_t*>(gpuIndices.data()), sizeof(uint32_t));
+#if COMPACT_VERTEX == 1
+        upload(m_quantTransformBuffer, staged[BUFFER::QUANT_TRANSFORM],
+            reinterpret_cast<uint8_t*>(quantTransforms.data()), sizeof(QuantTransform));
+#endif
+        upload(m_meshletBuffer, staged[BUFFER::MESHLET],
+            reinterpret_cast<uint8_t*>(meshlets.data()), sizeof(RT::Meshlet));
+        upload(m_meshletDataBuffer, staged[BUFFER::MESHLET_DATA],
+            reinterpret_cast<uint8_t*>(meshletData.data()), sizeof(uint32_t));
+    }
+
+    // CPU copies are released below, hash them now (used for keying cached data that 
+    // depends on scene geometry). Later uploads are chained to the prior hash.
+    XXH3_state_t state;
+    XXH3_64bits_reset_withSeed(&state, m_contentHash);
+    XXH3_64bits_update(&state, m_vertices.data(), sizeof(RT::GpuVertex) * m_vertices.size());
+    XXH3_64bits_update(&state, m_indices.data(), m_indices.size() * sizeof(uint32_t));
+    m_contentHash = XXH3_64bits_digest(&state);
+
+    m_vertices.free_memory();
+    m_indices.free_memory();
+    m_pendingMeshes.clear();
+}
+
+void MeshContainer::CreateBuffers(MemoryRegion vertices, MemoryRegion indices, 
+    MemoryRegion quantTransforms, MemoryRegion meshlets, MemoryRegion meshletData)
+{
+    const uint32_t vbSizeInBytes = sizeof(RT::GpuVertex) * m_capacity[BUFFER::VERTEX];
+    const uint32_t ibSizeInBytes = sizeof(uint32_t) * m_capacity[BUFFER::INDEX];
+#if COMPACT_VERTEX == 1
+    const uint32_t quantTransformsSizeInBytes = sizeof(QuantTransform) * 
+        m_capacity[BUFFER::QUANT_TRANSFORM];
+#endif
+    const uint32_t meshletsSizeInBytes = sizeof(RT::Meshlet) * m_capacity[BUFFER::MESHLET];
+    const uint32_t meshletDataSizeInBytes = sizeof(uint32_t) * m_capacity[BUFFER::MESHLET_DATA];
+
+    PlacedResourceList<5> list;
     list.PushBuffer(vbSizeInBytes, false, false);
     list.PushBuffer(ibSizeInBytes, false, false);
+    list.PushBuffer(meshletsSizeInBytes, false, false);
+    list.PushBuffer(meshletDataSizeInBytes, false, false);
+#if COMPACT_VERTEX == 1
+    list.PushBuffer(quantTransformsSizeInBytes, false, false);
+#endif
     list.End();
 
-    m_heap = GpuMemory::GetResourceHeap(list.TotalSizeInBytes());
+    m_heap = GpuMemory::GetResourceHeap("SceneGeometry", list.TotalSizeInBytes(), MEMORY_CATEGORY::BUFFER);
     ID3D12Heap* heap = m_heap.Heap();
     auto allocs = list.AllocInfos();
 
     m_vertexBuffer = GpuMemory::GetPlacedHeapBufferAndInit(GlobalResource::SCENE_VERTEX_BUFFER, 
-        vbSizeInBytes, heap, allocs[0].Offset, false, 
-        MemoryRegion{ .Data = m_vertices.data(), .SizeInBytes = vbSizeInBytes }, true);
+        vbSizeInBytes, heap, allocs[0].Offset, false, vertices, true);
 
     m_indexBuffer = GpuMemory::GetPlacedHeapBufferAndInit(GlobalResource::SCENE_INDEX_BUFFER,
-        ibSizeInBytes, heap, allocs[1].Offset, false, 
-        MemoryRegion{ .Data = m_indices.data(), .SizeInBytes = ibSizeInBytes }, true);
+        ibSizeInBytes, heap, allocs[1].Offset, false, indices, true);
+
+    m_meshletBuffer = GpuMemory::GetPlacedHeapBufferAndInit(GlobalResource::SCENE_MESHLETS,
+        meshletsSizeInBytes, heap, allocs[2].Offset, false, meshlets, true);
+
+    m_meshletDataBuffer = GpuMemory::GetPlacedHeapBufferAndInit(GlobalResource::SCENE_MESHLET_DATA,
+        meshletDataSizeInBytes, heap, allocs[3].Offset, false, meshletData, true);
+
+#if COMPACT_VERTEX == 1
+    m_quantTransformBuffer = GpuMemory::GetPlacedHeapBufferAndInit("QuantTransforms",
+        quantTransformsSizeInBytes, heap, allocs[4].Offset, false, quantTransforms, true);
+#endif
 
     auto& r = App::GetRenderer().GetSharedShaderResources();
     r.InsertOrAssignDefaultHeapBuffer(GlobalResource::SCENE_VERTEX_BUFFER, m_vertexBuffer);
     r.InsertOrAssignDefaultHeapBuffer(GlobalResource::SCENE_INDEX_BUFFER, m_indexBuffer);
+    r.InsertOrAssignDefaultHeapBuffer(GlobalResource::SCENE_MESHLETS, m_meshletBuffer);
+    r.InsertOrAssignDefaultHeapBuffer(GlobalResource::SCENE_MESHLET_DATA, m_meshletDataBuffer);
+}
 
-    m_vertices.free_memory();
-    m_indices.free_memory();
+void MeshContainer::ReleaseRange(BUFFER b, uint32_t offset, uint64_t fenceVal)
+{
+    GpuRange* range = m_ranges[b].find(offset).value();
+    Assert(range->RefCount > 0, "Invalid ref count.");
+
+    if (--range->RefCount > 0)
+        return;
+
+    m_pendingFrees.push_back(PendingFree{ .Alloc = range->Alloc,
+        .Buffer = b,
+        .FenceVal = fenceVal });
+
+    m_ranges[b].erase(offset);
+}
+
+void MeshContainer::Recycle(uint64_t completedFenceVal)
+{
+    for (auto it = m_pendingFrees.begin(); it != m_pendingFrees.end();)
+    {
+        // GPU is finished with this range
+        if (it->FenceVal <= completedFenceVal)
+        {
+            m_allocators[it->Buffer].Free(it->Alloc);
+            it = m_pendingFrees.erase(*it);
+        }
+        else
+            it++;
+    }
 }
 
 void MeshContainer::Clear()
 {
     m_vertexBuffer.Reset(false);
     m_indexBuffer.Reset(false);
+    m_quantTransformBuffer.Reset(false);
+    m_meshletBuffer.Reset(false);
+    m_meshletDataBuffer.Reset(false);
     m_heap.Reset();
+    m_pendingFrees.clear();
 }
 
 //--------------------------------------------------------------------------------------
@@ -299,8 +1017,24 @@ void EmissiveBuffer::AddBatch(SmallVector<Asset::EmissiveInstance>&& instances,
     App::DeltaTimer timer;
     timer.Start();
 
-    // TODO implement
-    Check(m_trisCpu.empty(), "Not implemented.");
+    Check(!Initialized(), "Adding emissives after the emissive buffer has been created is not supported.");
+
+    // Merge with the previous batches (if any). New triangles go after the existing ones.
+    SmallVector<RT::EmissiveTriangle> srcTris;
+
+    if (m_trisCpu.empty())
+        srcTris = ZetaMove(tris);
+    else
+    {
+        const uint32_t baseTriOffset = (uint32_t)m_trisCpu.size();
+        for (auto& e : instances)
+            e.BaseTriOffset += baseTriOffset;
+
+        srcTris = ZetaMove(m_trisCpu);
+        srcTris.append_range(tris.begin(), tris.end());
+        instances.append_range(m_instances.begin(), m_instances.end());
+    }
+
     m_instances = instances;
 
     // Map instance ID to index in instances
@@ -317,8 +1051,8 @@ void EmissiveBuffer::AddBatch(SmallVector<Asset::EmissiveInstance>&& instances,
             return a1.MaterialIdx < a2.MaterialIdx;
         });
 
-    m_trisCpu.resize(tris.size());
-    m_triInitialPos.resize(tris.size());
+    m_trisCpu.resize(srcTris.size());
+    m_triInitialPos.resize(srcTris.size());
     uint32_t currNumTris = 0;
 
     // Shuffle triangles according to new sorted order
@@ -328,7 +1062,7 @@ void EmissiveBuffer::AddBatch(SmallVector<Asset::EmissiveInstance>&& instances,
         const uint32_t idx = *idToIdxMap.find(currID).value();
 
         memcpy(&m_trisCpu[currNumTris], 
-            &tris[instances[idx].BaseTriOffset],
+            &srcTris[instances[idx].BaseTriOffset],
             instances[idx].NumTriangles * sizeof(RT::EmissiveTriangle));
 
         m_instances[i].BaseTriOffset = currNumTris;
@@ -352,34 +1086,52 @@ void EmissiveBuffer::UploadToGPU()
         const size_t sizeInBytes = sizeof(RT::EmissiveTriangle) * m_trisCpu.size();
         m_trisGpu = GpuMemory::GetDefaultHeapBufferAndInit(GlobalResource::EMISSIVE_TRIANGLE_BUFFER,
             (uint32)sizeInBytes,
-            false,
+            true,
             MemoryRegion{ .Data = m_trisCpu.data(), .SizeInBytes = sizeInBytes });
 
+        const size_t objSpaceSizeInBytes = sizeof(Triangle) * m_triInitialPos.size();
+        m_objSpaceTrisGpu = GpuMemory::GetDefaultHeapBufferAndInit("EmissiveTrianglesObjSpace",
+            (uint32)objSpaceSizeInBytes,
+            false,
+            MemoryRegion{ .Data = m_triInitialPos.data(), .SizeInBytes = objSpaceSizeInBytes });
+
+        // From now on, positions are only updated on the GPU
+        m_triInitialPos.free_memory();
+
         auto& r = App::GetRenderer().GetSharedShaderResources();
         r.InsertOrAssignDefaultHeapBuffer(GlobalResource::EMISSIVE_TRIANGLE_BUFFER, m_trisGpu);
+        m_dirty.Clear();
     }
-    else if(m_staleNumTris > 0)
+    else if(!m_dirty.Empty())
     {
-        Assert(m_staleBaseOffset != UINT32_MAX, "Invalid base offset.");
-        const size_t numMbytes = sizeof(RT::EmissiveTriangle) * m_staleNumTris / (1024 * 1024);
-        LOG_UI_INFO("Uploading %d emissive triangles (%d MB)...", m_staleNumTris, numMbytes);
+        const uint32_t numDirty = m_dirty.NumElements();
+        const size_t numMbytes = sizeof(RT::EmissiveTriangle) * numDirty / (1024 * 1024);
+        LOG_UI_INFO("Uploading %u emissive triangles in %u ranges (%llu MB)...", numDirty, 
+            (uint32_t)m_dirty.Ranges().size(), numMbytes);
 
-        const size_t sizeInBytes = sizeof(RT::EmissiveTriangle) * m_staleNumTris;
-        GpuMemory::UploadToDefaultHeapBuffer(m_trisGpu, (uint32)sizeInBytes,
-            MemoryRegion{ .Data = &m_trisCpu[m_staleBaseOffset], .SizeInBytes = (uint32)sizeInBytes },
-            m_staleBaseOffset * sizeof(RT::EmissiveTriangle));
+        for (auto& r : m_dirty.Ranges())
+        {
+            Assert(r.End <= m_trisCpu.size(), "Invalid range.");
+            const size_t sizeInBytes = sizeof(RT::EmissiveTriangle) * (r.End - r.Begin);
 
-        m_staleNumTris = 0;
-        m_staleBaseOffset = UINT32_MAX;
+            GpuMemory::UploadToDefaultHeapBuffer(m_trisGpu, (uint32)sizeInBytes,
+                MemoryRegion{ .Data = &m_trisCpu[r.Begin], .SizeInBytes = (uint32)sizeInBytes },
+                r.Begin * sizeof(RT::EmissiveTriangle));
+        }
+
+        m_dirty.Clear();
     }
 }
 
 void EmissiveBuffer::Clear()
 {
     m_trisGpu.Reset(false);
+    m_objSpaceTrisGpu.Reset(false);
+    m_dirty.Clear();
 }
 
-void EmissiveBuffer::UpdateMaterial(uint64_t instanceID, const float3& emissiveFactor, float strength)
+void EmissiveBuffer::UpdateMaterial(uint64_t instanceID, const float3& emissiveFactor, float strength,
+    SmallVector<uint64_t>& modifiedInstances)
 {
     auto& instance = *FindInstance(instanceID).value();
     const int modifiedMatIdx = instance.MaterialIdx;
@@ -392,8 +1144,6 @@ void EmissiveBuffer::UpdateMaterial(uint64_t instanceID, const float3& emissiveF
     const uint32 newEmissiveFactor = Float3ToRGB8(emissiveFactor);
     const half newStrength(strength);
 
-    m_staleBaseOffset = m_instances[idx].BaseTriOffset;
-
     // Find every instance that uses this material
     while (idx < (int64)m_instances.size() && m_instances[idx].MaterialIdx == modifiedMatIdx)
     {
@@ -405,15 +1155,9 @@ void EmissiveBuffer::UpdateMaterial(uint64_t instanceID, const float3& emissiveF
             m_trisCpu[i].SetStrength(newStrength);
         }
 
-        m_staleNumTris += m_instances[idx].NumTriangles;
+        m_dirty.Add(m_instances[idx].BaseTriOffset, 
+            m_instances[idx].BaseTriOffset + m_instances[idx].NumTriangles);
+        modifiedInstances.push_back(m_instances[idx].InstanceID);
         idx++;
     } 
 }
-
-void EmissiveBuffer::UpdateTriPositions(size_t startIdx, size_t endIdx)
-{
-    Assert(endIdx <= m_trisCpu.size(), "Invalid index.");
-
-    m_staleBaseOffset = (uint32)startIdx;
-    m_staleNumTris = (uint32)(endIdx - startIdx);
-}
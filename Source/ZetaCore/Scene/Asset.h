@@ -2,21 +2,48 @@
 
 #include "../Utility/HashTable.h"
 #include "../Core/DescriptorHeap.h"
+#include "../Support/OffsetAllocator.h"
 #include "../Model/glTFAsset.h"
 #include "../RayTracing/RtCommon.h"
 #include <Utility/Optional.h>
 
 namespace ZetaRay::Scene::Internal
 {
+    //--------------------------------------------------------------------------------------
+    // DirtyRanges: Modified [Begin, End) element ranges of a GPU buffer that need to be 
+    // uploaded. Overlapping or adjacent ranges are merged, so each one maps to a single 
+    // copy region.
+    //--------------------------------------------------------------------------------------
+
+    struct DirtyRanges
+    {
+        struct Range
+        {
+            uint32_t Begin;
+            uint32_t End;
+        };
+
+        void Add(uint32_t begin, uint32_t end);
+        ZetaInline void Clear() { m_ranges.clear(); }
+        ZetaInline bool Empty() const { return m_ranges.empty(); }
+        ZetaInline Util::Span<Range> Ranges() const { return m_ranges; }
+        uint32_t NumElements() const;
+
+    private:
+        // Sorted by Begin and disjoint
+        Util::SmallVector<Range> m_ranges;
+    };
+
     //--------------------------------------------------------------------------------------
     // TextureDescriptorTable: A descriptor table containing a contiguous set of textures, 
     // which are to be bound as unbounded descriptor tables in shaders. Each texture index in
-    // a given Material refers to an offset in one such descriptor table
+    // a given Material refers to an offset in one such descriptor table. Table starts at
+    // the given size and doubles whenever it runs out of slots.
     //--------------------------------------------------------------------------------------
 
     struct TexSRVDescriptorTable
     {
-        explicit TexSRVDescriptorTable(const uint32_t descTableSize = 1024);
+        explicit TexSRVDescriptorTable(const uint32_t initialSize = 1024);
         ~TexSRVDescriptorTable() = default;
 
         TexSRVDescriptorTable(const TexSRVDescriptorTable&) = delete;
@@ -28,8 +55,29 @@ namespace ZetaRay::Scene::Internal
         // Returns offset of the given texture in the descriptor table. The texture is then loaded from
         // the disk. "id" is hash of the texture path.
         uint32_t Add(Core::GpuMemory::Texture&& tex);
+        // Swaps the texture that has the same ID as the given one, while its offset in the 
+        // descriptor table stays the same. Prior texture is released once GPU has reached
+        // "fenceVal". Returns false if no such texture was found. Takes effect after the 
+        // next Commit().
+        bool Replace(Core::GpuMemory::Texture&& tex, uint64_t fenceVal);
+        // Releases a reference to the texture at the given offset. Once it's no longer 
+        // referenced, texture and its descriptor slot are freed after GPU has reached 
+        // "fenceVal". Returns ID of the evicted texture or INVALID_ID if it's still in use.
+        Core::GpuMemory::Texture::ID_TYPE Remove(uint32_t descTableOffset, uint64_t fenceVal);
+        // Returns ID of the texture at the given offset or INVALID_ID if there's none
+        Core::GpuMemory::Texture::ID_TYPE FindID(uint32_t descTableOffset);
+        // Returns offset of the texture with the given ID or UINT32_MAX if there's none
+        uint32_t FindOffset(Core::GpuMemory::Texture::ID_TYPE ID);
+        // Copies descriptors that were added since the last call to the shader-visible 
+        // table. If there were any replacements or the table has grown, publishes a new 
+        // copy of the descriptor table instead, so that descriptors that GPU might still 
+        // be reading aren't modified. Must be called before materials that reference the
+        // added textures are uploaded.
+        void Commit();
         void Recycle(uint64_t completedFenceVal);
         ZetaInline uint32_t GPUDescriptorHeapIndex() const { return m_descTable.GPUDescriptorHeapIndex(); }
+        // Offsets below this have texture streaming feedback entries
+        ZetaInline uint32_t InitialSize() const { return m_initialSize; }
 
     private:
         struct ToBeFreedTexture
@@ -46,15 +94,27 @@ namespace ZetaRay::Scene::Internal
             uint32_t RefCount = 0;
         };
 
-        static constexpr int MAX_NUM_DESCRIPTORS = 4096;
-        static constexpr int MAX_NUM_MASKS = MAX_NUM_DESCRIPTORS >> 6;
-        static_assert(MAX_NUM_MASKS * 64 == MAX_NUM_DESCRIPTORS, "these must match.");
+        // Largest power of two that fits in a material's texture index
+        static constexpr uint32_t MAX_NUM_DESCRIPTORS = 1u << (Material::NUM_TEXTURE_BITS - 1);
+        static_assert(MAX_NUM_DESCRIPTORS < Material::INVALID_ID, "Offsets must be valid texture indices.");
+
+        void Grow();
 
         Util::SmallVector<ToBeFreedTexture> m_pending;
-        const uint32_t m_descTableSize;
-        const uint32_t m_numMasks;
-        uint64_t m_inUseBitset[MAX_NUM_MASKS] = { 0 };
+        // Slots that were released and whose descriptors GPU is done with
+        Util::SmallVector<uint32_t> m_freeSlots;
+        // ID of the texture in each slot or INVALID_ID if it's free
+        Util::SmallVector<Core::GpuMemory::Texture::ID_TYPE> m_slotIDs;
+        // Slots at or above this offset have never been used
+        uint32_t m_numUsedSlots = 0;
+        const uint32_t m_initialSize;
+        uint32_t m_descTableSize;
         Core::DescriptorTable m_descTable;
+        // Master copy of the descriptors in a non-shader-visible heap
+        Core::DescriptorTable m_descTableCpu;
+        // Added slots whose descriptors haven't been copied to the shader-visible table yet
+        DirtyRanges m_added;
+        bool m_stale = false;
         // TODO Duplicate texture ID storage as key and texture object member
         Util::HashTable<CacheEntry, Core::GpuMemory::Texture::ID_TYPE> m_cache;
     };
@@ -73,11 +133,15 @@ namespace ZetaRay::Scene::Internal
 
         void Clear();
         void Add(uint32_t ID, const Material& mat);
+        // Frees the material's slot in the GPU buffer for reuse by later additions, once 
+        // GPU has passed the given fence
+        void Remove(uint32_t ID, uint64_t fenceVal);
+        void Recycle(uint64_t completedFenceVal);
         void Update(uint32_t ID, const Material& mat)
         {
-            auto it = m_materials.find(ID);
-            it.value()->Mat = mat;
-            m_staleID = ID;
+            auto* entry = m_materials.find(ID).value();
+            entry->Mat = mat;
+            m_dirty.Add(entry->GpuBufferIdx, entry->GpuBufferIdx + 1);
         }
         void UploadToGPU();
         void ResizeAdditionalMaterials(uint32_t num);
@@ -106,6 +170,12 @@ namespace ZetaRay::Scene::Internal
             uint32_t GpuBufferIdx;
         };
 
+        struct PendingFree
+        {
+            uint32_t GpuBufferIdx;
+            uint64_t FenceVal;
+        };
+
         static constexpr int MAX_NUM_MATERIALS = 4096;
         static constexpr int NUM_MASKS = MAX_NUM_MATERIALS >> 6;
         static_assert(NUM_MASKS * 64 == MAX_NUM_MATERIALS, "these must match.");
@@ -113,7 +183,8 @@ namespace ZetaRay::Scene::Internal
 
         Core::GpuMemory::Buffer m_buffer;
         Util::HashTable<Entry, uint32_t> m_materials;
-        uint32 m_staleID = UINT32_MAX;
+        DirtyRanges m_dirty;
+        Util::SmallVector<PendingFree> m_pendingFrees;
     };
 
     //--------------------------------------------------------------------------------------
@@ -127,8 +198,16 @@ namespace ZetaRay::Scene::Internal
         void AddBatch(Util::SmallVector<Model::glTF::Asset::Mesh>&& meshes, 
             Util::SmallVector<Core::Vertex>&& vertices,
             Util::SmallVector<uint32_t>&& indices);
+        // Caller must make sure that no instance references this mesh anymore. Its ranges 
+        // in the GPU buffers are reused once GPU has reached "fenceVal".
+        void Remove(uint64_t id, uint64_t fenceVal);
         void Reserve(size_t numVertices, size_t numIndices);
-        void RebuildBuffers();
+        // Uploads the meshes that were added since the last call. GPU buffers are created
+        // the first time with some spare capacity, later meshes are sub-allocated from
+        // them (including the ranges of removed meshes).
+        void UploadToGPU();
+        // Returns ranges of removed meshes that GPU is done with to the allocators
+        void Recycle(uint64_t completedFenceVal);
         void Clear();
 
         // Note: not thread safe for reading and writing at the same time
@@ -141,18 +220,118 @@ namespace ZetaRay::Scene::Internal
             return {};
         }
 
+        // Number of LODs of the given mesh, including the mesh itself
+        ZetaInline uint32_t NumLODs(uint64_t id) const
+        {
+            auto it = m_lods.find(id);
+            return it ? it.value()->NumLODs : 1;
+        }
+        // ID of the simplified version of mesh "id" at the given level of detail (LOD 0 is 
+        // the mesh itself). LODs share the vertex range of their source mesh.
+        ZetaInline uint64_t LODMeshID(uint64_t id, uint32_t lod) const
+        {
+            if (lod == 0)
+                return id;
+
+            auto it = m_lods.find(id);
+            Assert(it && lod < it.value()->NumLODs, "Mesh %llu doesn't have LOD %u.", id, lod);
+
+            return it.value()->MeshIDs[lod - 1];
+        }
+
         const Core::GpuMemory::Buffer& GetVB() const { return m_vertexBuffer; }
         const Core::GpuMemory::Buffer& GetIB() const { return m_indexBuffer; }
-        uint32_t NumMeshes() const { return (uint32_t)m_meshes.size(); }
+        // Empty unless COMPACT_VERTEX is enabled, indexed by TriangleMesh::m_quantTransformIdx
+        const Core::GpuMemory::Buffer& GetQuantTransforms() const { return m_quantTransformBuffer; }
+        // Indexed by TriangleMesh::m_meshletOffset, see RT::Meshlet
+        const Core::GpuMemory::Buffer& GetMeshlets() const { return m_meshletBuffer; }
+        const Core::GpuMemory::Buffer& GetMeshletData() const { return m_meshletDataBuffer; }
+        // Excluding the LODs
+        uint32_t NumMeshes() const { return (uint32_t)m_meshes.size() - m_numLODMeshes; }
+        // Hash of vertex and index buffers, updated in UploadToGPU() and Remove()
+        uint64_t ContentHash() const { return m_contentHash; }
+
+        // Same layout as D3D12_RAYTRACING_GEOMETRY_TRIANGLES_DESC::Transform3x4
+        struct QuantTransform
+        {
+            float M[3][4];
+        };
 
     private:
+        // Extra capacity (in percent) of the GPU buffers over the initial upload
+        static constexpr uint32_t SPARE_CAPACITY = 50;
+        // Smaller meshes aren't worth simplifying
+        static constexpr uint32_t MIN_LOD_NUM_TRIANGLES = 4096;
+        // Each LOD should have at most this fraction of the previous one's triangles, 
+        // otherwise the chain ends
+        static constexpr float MAX_LOD_TRIANGLE_RATIO = 0.6f;
+        // Chain ends once a LOD would have fewer triangles
+        static constexpr uint32_t MIN_LOD_TRIANGLES = 64;
+
+        enum BUFFER
+        {
+            VERTEX,
+            // In units of uint32_t, as shaders read the index buffer as uints
+            INDEX,
+            QUANT_TRANSFORM,
+            MESHLET,
+            // In units of uint32_t
+            MESHLET_DATA,
+            COUNT
+        };
+
+        // Range in one of the GPU buffers. Meshes may share vertex and index ranges.
+        struct GpuRange
+        {
+            Support::OffsetAllocator::Allocation Alloc;
+            uint32_t RefCount;
+        };
+
+        struct PendingFree
+        {
+            Support::OffsetAllocator::Allocation Alloc;
+            BUFFER Buffer;
+            uint64_t FenceVal;
+        };
+
+        struct LODChain
+        {
+            uint64_t MeshIDs[Model::MAX_NUM_MESH_LODS - 1];
+            uint32_t NumLODs;
+        };
+
+        // Generates the LOD chain of a mesh that hasn't been uploaded yet. Returns number 
+        // of LODs added.
+        uint32_t AddLODs(uint64_t id);
+        void CreateBuffers(Util::MemoryRegion vertices, Util::MemoryRegion indices, 
+            Util::MemoryRegion quantTransforms, Util::MemoryRegion meshlets, 
+            Util::MemoryRegion meshletData);
+        void ReleaseRange(BUFFER b, uint32_t offset, uint64_t fenceVal);
+
         Util::HashTable<Model::TriangleMesh> m_meshes;
+        // Keyed by ID of the source mesh
+        Util::HashTable<LODChain> m_lods;
+        uint32_t m_numLODMeshes = 0;
+        // CPU copies of meshes that haven't been uploaded yet
         Util::SmallVector<Core::Vertex> m_vertices;
         Util::SmallVector<uint32_t> m_indices;
+        Util::SmallVector<uint64_t> m_pendingMeshes;
+        uint32_t m_nextMeshIdx = 0;
+
+        // Sizes of the GPU buffers in units of their elements
+        uint32_t m_capacity[BUFFER::COUNT] = { 0 };
+        Support::OffsetAllocator m_allocators[BUFFER::COUNT];
+        // Allocated ranges, keyed by their offset
+        Util::HashTable<GpuRange> m_ranges[BUFFER::COUNT];
+        Util::SmallVector<PendingFree> m_pendingFrees;
 
         Core::GpuMemory::Buffer m_vertexBuffer;
         Core::GpuMemory::Buffer m_indexBuffer;
+        Core::GpuMemory::Buffer m_quantTransformBuffer;
+        Core::GpuMemory::Buffer m_meshletBuffer;
+        Core::GpuMemory::Buffer m_meshletDataBuffer;
         Core::GpuMemory::ResourceHeap m_heap;
+        uint64_t m_contentHash = 0;
     };
 
     //--------------------------------------------------------------------------------------
@@ -161,17 +340,7 @@ namespace ZetaRay::Scene::Internal
 
     struct EmissiveBuffer
     {
-        struct Triangle
-        {
-            // = CommittedPrimitiveIndex(): "...index of the primitive within the geometry 
-            // inside the bottom-level acceleration structure instance..."
-            uint32_t PrimIdx;
-            Math::float3 Vtx0;
-            unorm2_ V0V1;
-            unorm2_ V0V2;
-            half2_ EdgeLengths;
-        };
-
+        using Triangle = RT::EmissiveTriangleObjSpace;
         using Instance = Model::glTF::Asset::EmissiveInstance;
 
         EmissiveBuffer() = default;
@@ -185,8 +354,12 @@ namespace ZetaRay::Scene::Internal
         ZetaInline uint32_t NumTriangles() const { return (uint32_t)m_trisCpu.size(); }
         ZetaInline Util::Span<Instance> Instances() { return m_instances; }
         ZetaInline Util::MutableSpan<RT::EmissiveTriangle> Triagnles() { return m_trisCpu; }
+        // Only available until the first upload, afterwards they're kept on the GPU
         ZetaInline Util::MutableSpan<Triangle> InitialTriPositions() { return m_triInitialPos; }
-        ZetaInline bool HasStaleMaterials() const { return m_staleNumTris > 0; }
+        // World-space triangles are written in place whenever instances move
+        ZetaInline const Core::GpuMemory::Buffer& TriangleBuffer() const { return m_trisGpu; }
+        ZetaInline const Core::GpuMemory::Buffer& ObjSpaceTriangleBuffer() const { return m_objSpaceTrisGpu; }
+        ZetaInline bool HasStaleMaterials() const { return !m_dirty.Empty(); }
         ZetaInline Util::Optional<const Instance*> FindInstance(uint64_t ID)
         {
             auto it = m_idToIdxMap.find(ID);
@@ -198,8 +371,9 @@ namespace ZetaRay::Scene::Internal
 
         // Assumes proper GPU synchronization has been performed
         void Clear();
-        void UpdateMaterial(uint64_t instanceID, const Math::float3& emissiveFactor, float strength);
-        void UpdateTriPositions(size_t startIdx, size_t endIdx);
+        // IDs of instances that use the modified material are appended to modifiedInstances
+        void UpdateMaterial(uint64_t instanceID, const Math::float3& emissiveFactor, float strength,
+            Util::SmallVector<uint64_t>& modifiedInstances);
         void AddBatch(Util::SmallVector<Instance>&& instances,
             Util::SmallVector<RT::EmissiveTriangle>&& tris);
         void UploadToGPU();
@@ -211,7 +385,10 @@ namespace ZetaRay::Scene::Internal
         // Maps instance ID to index in m_instances
         Util::HashTable<uint32_t> m_idToIdxMap;
         Core::GpuMemory::Buffer m_trisGpu;
-        uint32_t m_staleBaseOffset = UINT32_MAX;
-        uint32_t m_staleNumTris = 0;
+        Core::GpuMemory::Buffer m_objSpaceTrisGpu;
+        // Triangles whose material changed since the last upload. Positions in m_trisCpu 
+        // are from the initial build, so triangles of instances that have moved since then
+        // need to be transformed again after the upload.
+        DirtyRanges m_dirty;
     };
 }
\ No newline at end of file
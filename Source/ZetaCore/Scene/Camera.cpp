@@ -150,6 +150,14 @@ void Camera::Init(float3 posw, float aspectRatio, float fov, float nearZ, bool j
 
 void Camera::Update(const Motion& m)
 {
+    if (m.HasPose)
+    {
+        SetPose(m.Pos, m.ViewDir);
+        UpdateJitter();
+        PredictPoses(m);
+        return;
+    }
+
     float2 acc = float2(m.dMouse_x, m.dMouse_y) * m_angularAcc - m_angularDamping * m_initialAngularVelocity;
     float2 newVelocity = acc * m.dt + m_initialAngularVelocity;
     float2 dtheta = 0.5f * acc * m.dt * m.dt + m_initialAngularVelocity * m.dt;
@@ -182,9 +190,54 @@ void Camera::Update(const Motion& m)
     m_posW = store(vNewEye);
     m_initialVelocity = store(vInitialVelocity);
 
+    UpdateJitter();
+    PredictPoses(m);
+}
+
+void Camera::PredictPoses(const Motion& m)
+{
+    if (m.HasFuturePoses)
+    {
+        for (int i = 0; i < NUM_PREDICTED_CAMERA_POSES; i++)
+        {
+            m_predictedPos[i] = m.FuturePos[i];
+            m_predictedViewDir[i] = m.FutureViewDir[i];
+        }
+
+        return;
+    }
+
+    // Assuming current input persists, velocity approaches a / k exponentially, where k 
+    // is the friction coefficient:
+    //      p(t) = p0 + (a / k) t + (v0 - a / k) (1 - e^(-kt)) / k
+    const float3 basisZ = GetBasisZ();
+    const float3 acc = m.HasPose ? float3(0.0f) : 
+        GetBasisX() * m.Acceleration.x + basisZ * m.Acceleration.z;
+    const float k = Max(m_frictionCoeff, 1e-4f);
+    const float3 terminalVelocity = acc * (1.0f / k);
+    const float3 v0 = GetVelocity();
+    const float3 p0 = GetPos();
+
+    for (int i = 0; i < NUM_PREDICTED_CAMERA_POSES; i++)
+    {
+        const float t = CAMERA_PREDICTION_TIMES[i];
+        m_predictedPos[i] = p0 + terminalVelocity * t + 
+            (v0 - terminalVelocity) * ((1.0f - expf(-k * t)) / k);
+        m_predictedViewDir[i] = basisZ;
+    }
+}
+
+void Camera::UpdateJitter()
+{
     if (m_jitteringEnabled)
     {
-        const uint32_t frame = App::GetTimer().GetTotalFrameCount() % m_jitterPhaseCount;
+        // Jitter sequence for benchmarks starts at the same phase regardless of load time, 
+        // replays follow the recorded session
+        const int64_t benchFrame = App::GetBenchmarkFrame();
+        const int64_t replayFrame = App::GetReplayFrame();
+        const uint64_t frameNum = benchFrame >= 0 ? (uint64_t)benchFrame : 
+            (replayFrame >= 0 ? (uint64_t)replayFrame : App::GetTimer().GetTotalFrameCount());
+        const uint32_t frame = frameNum % m_jitterPhaseCount;
         m_currJitter.x = Halton(frame + 1, 2) - 0.5f;
         m_currJitter.y = Halton(frame + 1, 3) - 0.5f;
 #if 0
@@ -201,19 +254,38 @@ void Camera::Update(const Motion& m)
 
 void Camera::UpdateProj()
 {
+    const float fov = m_tileFullHeight ? 2.0f * atanf(GetTanHalfFOV()) : m_fov;
     v_float4x4 vP;
 
-    vP = perspectiveReverseZ(m_aspectRatio, m_fov, m_nearZ);
+    vP = perspectiveReverseZ(m_aspectRatio, fov, m_nearZ);
     m_proj = store(vP);
-    vP = perspectiveReverseZ(m_aspectRatio, m_fov, m_nearZ, m_farZNonInfinite);
+    vP = perspectiveReverseZ(m_aspectRatio, fov, m_nearZ, m_farZNonInfinite);
     m_projNonInfinite = store(vP);
 
-    m_viewFrustum = ViewFrustum(m_fov, m_aspectRatio, m_nearZ, m_farZ);
+    if (m_tileFullHeight)
+    {
+        // Shift NDC so that the point seen through (pixel + tile jitter) lands on pixel
+        const float2 ndcOffset = m_tileJitter * float2(-2.0f, 2.0f) / 
+            float2((float)App::GetRenderer().GetRenderWidth(), (float)App::GetRenderer().GetRenderHeight());
+
+        m_proj.m[2].x = ndcOffset.x;
+        m_proj.m[2].y = ndcOffset.y;
+        m_projNonInfinite.m[2].x = ndcOffset.x;
+        m_projNonInfinite.m[2].y = ndcOffset.y;
+
+        // Frustum of the full image, which is conservative for every tile
+        const float fullAspectRatio = (float)m_tileFullWidth / m_tileFullHeight;
+        m_viewFrustum = ViewFrustum(m_fov, fullAspectRatio, m_nearZ, m_farZ);
+    }
+    else
+        m_viewFrustum = ViewFrustum(m_fov, m_aspectRatio, m_nearZ, m_farZ);
 }
 
 void Camera::UpdateFocalLength()
 {
-    float sensorHeight = m_sensorWidth / m_aspectRatio;
+    const float aspectRatio = m_tileFullHeight ? (float)m_tileFullWidth / m_tileFullHeight :
+        m_aspectRatio;
+    float sensorHeight = m_sensorWidth / aspectRatio;
     m_focalLength = (0.5f * sensorHeight) / m_tanHalfFOV;
 }
 
@@ -226,10 +298,65 @@ void Camera::OnWindowSizeChanged()
     UpdateProj();
     UpdateFocalLength();
 
-    m_pixelSpreadAngle = atanf(2 * m_tanHalfFOV / renderfHeight);
+    m_pixelSpreadAngle = atanf(2 * GetTanHalfFOV() / renderfHeight);
     m_jitterPhaseCount = int(BASE_PHASE_COUNT * powf(App::GetUpscalingFactor(), 2.0f));
 }
 
+void Camera::SetTile(uint32_t fullWidth, uint32_t fullHeight, int offsetX, int offsetY)
+{
+    const int renderWidth = App::GetRenderer().GetRenderWidth();
+    const int renderHeight = App::GetRenderer().GetRenderHeight();
+
+    m_tileFullWidth = fullHeight ? fullWidth : 0;
+    m_tileFullHeight = fullWidth ? fullHeight : 0;
+
+    if (m_tileFullHeight)
+    {
+        // Tile spans rows [offsetY, offsetY + renderHeight) of the full image, so it sees 
+        // renderHeight / fullHeight of its vertical extent. Jitter moves the tile center 
+        // to the corresponding point on the image plane.
+        m_tileFOVScale = (float)renderHeight / fullHeight;
+        m_tileJitter = float2(offsetX + 0.5f * (float)(renderWidth - (int)fullWidth),
+            offsetY + 0.5f * (float)(renderHeight - (int)fullHeight));
+    }
+    else
+    {
+        m_tileFOVScale = 1.0f;
+        m_tileJitter = float2(0.0f);
+    }
+
+    m_aspectRatio = (float)renderWidth / renderHeight;
+
+    UpdateProj();
+    UpdateFocalLength();
+
+    // Same as the full image
+    m_pixelSpreadAngle = atanf(2 * GetTanHalfFOV() / renderHeight);
+    App::GetScene().SceneModified();
+}
+
+void Camera::SetPose(const float3& pos, const float3& viewDir)
+{
+    Assert(viewDir.dot(viewDir) > 1e-7, "(0, 0, 0) is not a valid view vector.");
+
+    const __m128 vEye = _mm_insert_ps(loadFloat3(const_cast<float3&>(pos)), _mm_set1_ps(1.0f), 0x30);
+    const __m128 vUp = _mm_load_ps(reinterpret_cast<float*>(&m_upW));
+    const __m128 vBasisZ = normalize(loadFloat3(const_cast<float3&>(viewDir)));
+    const __m128 vBasisX = normalize(cross(vUp, vBasisZ));
+    const __m128 vBasisY = cross(vBasisZ, vBasisX);
+
+    v_float4x4 vNewView = resetViewMatrix(vBasisX, vBasisY, vBasisZ, vEye, m_viewInv);
+    m_view = store(vNewView);
+    m_posW = store(vEye);
+
+    m_basisX = store(vBasisX);
+    m_basisY = store(vBasisY);
+    m_basisZ = store(vBasisZ);
+
+    m_initialVelocity = float4a(0.0f);
+    m_initialAngularVelocity = float2(0.0f);
+}
+
 void Camera::RotateX(float theta)
 {
     __m128 vBasisX = _mm_load_ps(reinterpret_cast<float*>(&m_basisX));
@@ -294,11 +421,10 @@ void Camera::SetFOV(const ParamVariant& p)
 void Camera::SetJitteringEnabled(const ParamVariant& p)
 {
     m_jitteringEnabled = p.GetBool();
-
-    m_proj.m[2].x = 0.0f;
-    m_proj.m[2].y = 0.0f;
-
     m_currJitter = float2(0.0f, 0.0f);
+
+    // Resets the projection offset, except for tiling
+    UpdateProj();
 }
 
 void Camera::SetFrictionCoeff(const Support::ParamVariant& p)
@@ -10,6 +10,10 @@ namespace ZetaRay::Support
 
 namespace ZetaRay::Scene
 {
+    // Camera pose is predicted this many seconds ahead, e.g. for prefetching textures
+    inline constexpr float CAMERA_PREDICTION_TIMES[] = { 0.25f, 0.75f };
+    inline constexpr int NUM_PREDICTED_CAMERA_POSES = ZetaArrayLen(CAMERA_PREDICTION_TIMES);
+
     struct Motion
     {
         void Reset()
@@ -18,12 +22,25 @@ namespace ZetaRay::Scene
             Acceleration = Math::float3(0.0f);
             dMouse_x = 0;
             dMouse_y = 0;
+            HasPose = false;
+            HasFuturePoses = false;
         }
 
         float dt;
         Math::float3 Acceleration;
         int16_t dMouse_x;
         int16_t dMouse_y;
+        // When set, camera is placed at Pos looking along ViewDir (e.g. when playing back a 
+        // camera path) and its velocity is reset. Acceleration and mouse are ignored.
+        bool HasPose = false;
+        Math::float3 Pos;
+        Math::float3 ViewDir;
+        // When set, camera will be at FuturePos[i] looking along FutureViewDir[i] after
+        // CAMERA_PREDICTION_TIMES[i] seconds (e.g. from the camera path that's being played
+        // back). Otherwise, future poses are extrapolated from the camera's velocity.
+        bool HasFuturePoses = false;
+        Math::float3 FuturePos[NUM_PREDICTED_CAMERA_POSES];
+        Math::float3 FutureViewDir[NUM_PREDICTED_CAMERA_POSES];
     };
 
     class Camera
@@ -36,6 +53,12 @@ namespace ZetaRay::Scene
             Math::float3 focusOrViewDir = Math::float3(0.0f), bool lookAt = true);
         void Update(const Motion& m);
         void OnWindowSizeChanged();
+        // Restricts the camera to a tile of a larger image of size fullWidth x fullHeight, where 
+        // (offsetX, offsetY) is the tile's top-left corner in that image and tile dimensions 
+        // are the render dimensions. Projection becomes off-center and camera rays are offset 
+        // using the jitter, so every pixel of every tile sees exactly what it would in the 
+        // full image. Passing fullWidth = 0 disables tiling.
+        void SetTile(uint32_t fullWidth, uint32_t fullHeight, int offsetX, int offsetY);
 
         ZetaInline const Math::float4x4a& GetCurrView() const { return m_view; }
         ZetaInline const Math::float4x4a& GetViewInv() const { return m_viewInv; }
@@ -46,7 +69,7 @@ namespace ZetaRay::Scene
         ZetaInline float GetFOV() const { return m_fov; }
         ZetaInline float GetNearZ() const { return m_nearZ; }
         ZetaInline float GetFarZ() const { return m_farZ; }
-        ZetaInline float GetTanHalfFOV() const { return m_tanHalfFOV; }
+        ZetaInline float GetTanHalfFOV() const { return m_tanHalfFOV * m_tileFOVScale; }
         ZetaInline float GetPixelSpreadAngle() const { return m_pixelSpreadAngle; }
         // Unit is mm
         ZetaInline float GetFocalLength() const { return m_focalLength; }
@@ -58,19 +81,29 @@ namespace ZetaRay::Scene
             // mul by 0.5 to get radius from diameter
             return 0.5f * (m_focalLength / 1000.0f) / m_fStop; 
         }
-        ZetaInline Math::float2 GetCurrJitter() const { return m_currJitter; }
+        ZetaInline Math::float2 GetCurrJitter() const { return m_currJitter + m_tileJitter; }
         ZetaInline Math::float3 GetBasisX() const { return Math::float3(m_basisX.x, m_basisX.y, m_basisX.z); }
         ZetaInline Math::float3 GetBasisY() const { return Math::float3(m_basisY.x, m_basisY.y, m_basisY.z); }
         ZetaInline Math::float3 GetBasisZ() const { return Math::float3(m_basisZ.x, m_basisZ.y, m_basisZ.z); }
         ZetaInline const Math::ViewFrustum& GetCameraFrustumViewSpace() const { return m_viewFrustum; }
+        ZetaInline Math::float3 GetVelocity() const
+        {
+            return Math::float3(m_initialVelocity.x, m_initialVelocity.y, m_initialVelocity.z);
+        }
+        // Predicted pose after CAMERA_PREDICTION_TIMES[i] seconds
+        ZetaInline const Math::float3& GetPredictedPos(int i) const { return m_predictedPos[i]; }
+        ZetaInline const Math::float3& GetPredictedViewDir(int i) const { return m_predictedViewDir[i]; }
 
     private:
         static constexpr int BASE_PHASE_COUNT = 64;
 
         void UpdateProj();
         void UpdateFocalLength();
+        void UpdateJitter();
         void RotateX(float theta);
         void RotateY(float theta);
+        void SetPose(const Math::float3& pos, const Math::float3& viewDir);
+        void PredictPoses(const Motion& m);
 
         // param callbacks
         void SetFOV(const Support::ParamVariant& p);
@@ -89,6 +122,8 @@ namespace ZetaRay::Scene
         Math::float4a m_initialVelocity = Math::float4a(0.0f);
         Math::float2 m_initialAngularVelocity = Math::float2(0.0f);
         Math::ViewFrustum m_viewFrustum;
+        Math::float3 m_predictedPos[NUM_PREDICTED_CAMERA_POSES];
+        Math::float3 m_predictedViewDir[NUM_PREDICTED_CAMERA_POSES];
         Math::float4a m_upW = Math::float4a(0.0f, 1.0f, 0.0f, 0.0f);
 
         Math::float4a m_basisX;
@@ -116,6 +151,12 @@ namespace ZetaRay::Scene
         // The distance that camera is focusing at
         float m_focusDepth = 5.0f;
         Math::float2 m_currJitter = Math::float2(0);
+        // Tiling (see SetTile()) -- offset of tile center from the full image center in 
+        // pixels, and ratio of tile height to full image height
+        Math::float2 m_tileJitter = Math::float2(0);
+        float m_tileFOVScale = 1.0f;
+        uint32_t m_tileFullWidth = 0;
+        uint32_t m_tileFullHeight = 0;
         int m_jitterPhaseCount;
         bool m_jitteringEnabled = false;
         float m_frictionCoeff = 10.0f;
@@ -0,0 +1,150 @@
+#include "CameraPath.h"
+#include "../App/Filesystem.h"
+#include <stdlib.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Scene;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+
+namespace
+{
+    // Uniform Catmull-Rom spline between p1 and p2
+    ZetaInline float3 CatmullRom(const float3& p0, const float3& p1, const float3& p2,
+        const float3& p3, float u)
+    {
+        const float u2 = u * u;
+        const float u3 = u2 * u;
+
+        return 0.5f * ((2.0f * p1) + (p2 - p0) * u +
+            (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 +
+            (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// CameraPath
+//--------------------------------------------------------------------------------------
+
+void CameraPath::Load(const char* path)
+{
+    SmallVector<uint8_t> file;
+    Filesystem::LoadFromFile(path, file);
+    // Null terminate for strtof()
+    file.push_back('\0');
+
+    m_keyframes.clear();
+    char* curr = reinterpret_cast<char*>(file.data());
+    int line = 1;
+
+    while (*curr)
+    {
+        char* lineEnd = strchr(curr, '\n');
+        if (lineEnd)
+            *lineEnd = '\0';
+
+        while (*curr == ' ' || *curr == '\t')
+            curr++;
+
+        if (*curr != '#' && *curr != '\r' && *curr != '\0')
+        {
+            float vals[7];
+            char* next = curr;
+
+            for (int i = 0; i < ZetaArrayLen(vals); i++)
+            {
+                char* end;
+                vals[i] = strtof(next, &end);
+                Check(end != next, "%s, line %d: expected 7 numbers -- <time> <pos> <view dir>.",
+                    path, line);
+                next = end;
+            }
+
+            const float3 viewDir(vals[4], vals[5], vals[6]);
+            Check(viewDir.dot(viewDir) > 1e-7f, "%s, line %d: invalid view direction.", path, line);
+            Check(m_keyframes.empty() || vals[0] > m_keyframes.back().Time,
+                "%s, line %d: keyframe times must be increasing.", path, line);
+
+            Add(vals[0], float3(vals[1], vals[2], vals[3]), viewDir);
+        }
+
+        if (!lineEnd)
+            break;
+
+        curr = lineEnd + 1;
+        line++;
+    }
+
+    Check(!m_keyframes.empty(), "%s: camera path doesn't have any keyframes.", path);
+}
+
+void CameraPath::Save(const char* path) const
+{
+    SmallVector<char> text;
+    const char* header = "# <time (s)> <pos x> <pos y> <pos z> <view dir x> <view dir y> <view dir z>\n";
+    text.append_range(header, header + strlen(header));
+
+    for (auto& k : m_keyframes)
+    {
+        char line[192];
+        const int n = stbsp_snprintf(line, sizeof(line), "%.4f %.5f %.5f %.5f %.5f %.5f %.5f\n",
+            k.Time - m_keyframes[0].Time, k.Pos.x, k.Pos.y, k.Pos.z,
+            k.ViewDir.x, k.ViewDir.y, k.ViewDir.z);
+        text.append_range(line, line + n);
+    }
+
+    Filesystem::WriteToFile(path, reinterpret_cast<uint8_t*>(text.data()), (uint32_t)text.size());
+}
+
+void CameraPath::Add(float time, const float3& pos, const float3& viewDir)
+{
+    Assert(m_keyframes.empty() || time > m_keyframes.back().Time, "Keyframe times must be increasing.");
+
+    float3 dir = viewDir;
+    dir.normalize();
+    m_keyframes.push_back(Keyframe{ .Time = time, .Pos = pos, .ViewDir = dir });
+}
+
+void CameraPath::Sample(float t, float3& pos, float3& viewDir) const
+{
+    Assert(!m_keyframes.empty(), "Camera path is empty.");
+    const int n = (int)m_keyframes.size();
+    t = Math::Min(Math::Max(t, 0.0f), Duration()) + m_keyframes[0].Time;
+
+    // Last keyframe that starts at or before t
+    int i = 0;
+    int j = n - 1;
+    while (i < j)
+    {
+        const int mid = (i + j + 1) >> 1;
+        if (m_keyframes[mid].Time <= t)
+            i = mid;
+        else
+            j = mid - 1;
+    }
+
+    if (i == n - 1)
+    {
+        pos = m_keyframes[i].Pos;
+        viewDir = m_keyframes[i].ViewDir;
+
+        return;
+    }
+
+    const Keyframe& k1 = m_keyframes[i];
+    const Keyframe& k2 = m_keyframes[i + 1];
+    // Endpoints are repeated
+    const Keyframe& k0 = m_keyframes[Math::Max(i - 1, 0)];
+    const Keyframe& k3 = m_keyframes[Math::Min(i + 2, n - 1)];
+    const float u = (t - k1.Time) / (k2.Time - k1.Time);
+
+    pos = CatmullRom(k0.Pos, k1.Pos, k2.Pos, k3.Pos, u);
+
+    // Opposite directions can't be interpolated, stick to the nearest one
+    viewDir = (1.0f - u) * k1.ViewDir + u * k2.ViewDir;
+    if (viewDir.dot(viewDir) > 1e-7f)
+        viewDir.normalize();
+    else
+        viewDir = u < 0.5f ? k1.ViewDir : k2.ViewDir;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../Math/Vector.h"
+#include "../Utility/SmallVector.h"
+
+namespace ZetaRay::Scene
+{
+    // Keyframed camera path, e.g. for repeatable benchmarks. Stored as text with one
+    // keyframe per line:
+    //
+    //      <time (s)> <pos x> <pos y> <pos z> <view dir x> <view dir y> <view dir z>
+    //
+    // Lines that start with '#' are ignored. Keyframe times must be increasing.
+    struct CameraPath
+    {
+        struct Keyframe
+        {
+            float Time;
+            Math::float3 Pos;
+            Math::float3 ViewDir;
+        };
+
+        CameraPath() = default;
+        ~CameraPath() = default;
+
+        void Load(const char* path);
+        void Save(const char* path) const;
+        void Add(float time, const Math::float3& pos, const Math::float3& viewDir);
+        ZetaInline void Clear() { m_keyframes.clear(); }
+
+        // Position is interpolated with a Catmull-Rom spline, so that it passes through the
+        // keyframes, and view direction with normalized linear interpolation. t is clamped
+        // to [0, Duration()].
+        void Sample(float t, Math::float3& pos, Math::float3& viewDir) const;
+        // Time of the first keyframe is treated as zero
+        ZetaInline float Duration() const
+        {
+            return m_keyframes.empty() ? 0.0f : m_keyframes.back().Time - m_keyframes[0].Time;
+        }
+        ZetaInline size_t NumKeyframes() const { return m_keyframes.size(); }
+        ZetaInline bool Empty() const { return m_keyframes.empty(); }
+
+    private:
+        Util::SmallVector<Keyframe> m_keyframes;
+    };
+}
\ No newline at end of file
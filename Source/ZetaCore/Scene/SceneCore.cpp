@@ -1,9 +1,13 @@
 #include "SceneCore.h"
 #include "../Math/CollisionFuncs.h"
+#include "../Core/RendererCore.h"
 #include "../Math/Quaternion.h"
+#include "../Math/BatchFuncs.h"
 #include "../Support/Task.h"
 #include "Camera.h"
+#include "../Model/glTF.h"
 #include <App/Timer.h>
+#include <App/Log.h>
 #include <Support/Param.h>
 #include <algorithm>
 #include "../Assets/Font/IconsFontAwesome6.h"
@@ -34,6 +38,167 @@ namespace
         v.z += v.x * v.y;
         return v;
     }
+
+    // Loads one component of four array elements into a vector
+    ZetaInline __m128 Gather4(const float* base, const uint32_t idx[4], uint32_t stride)
+    {
+        return _mm_setr_ps(base[idx[0] * stride], base[idx[1] * stride], 
+            base[idx[2] * stride], base[idx[3] * stride]);
+    }
+
+    // Same as slerp(), except that quaternions are in SoA layout and every lane has 
+    // its own interpolation parameter
+    void Slerp4(const __m128 vQ1[4], const __m128 vQ2[4], const __m128 vT, __m128 vRes[4])
+    {
+        const __m128 vOne = _mm_set1_ps(1.0f);
+
+        __m128 vCosTheta = _mm_mul_ps(vQ1[0], vQ2[0]);
+        vCosTheta = _mm_fmadd_ps(vQ1[1], vQ2[1], vCosTheta);
+        vCosTheta = _mm_fmadd_ps(vQ1[2], vQ2[2], vCosTheta);
+        vCosTheta = _mm_fmadd_ps(vQ1[3], vQ2[3], vCosTheta);
+
+        // If on opposite hemispheres, negate one of them
+        const __m128 vOnSameHemisphere = _mm_cmpgt_ps(vCosTheta, _mm_setzero_ps());
+        const __m128 vSign = _mm_blendv_ps(_mm_set1_ps(-1.0f), vOne, vOnSameHemisphere);
+        vCosTheta = _mm_min_ps(abs(vCosTheta), vOne);
+
+        const __m128 vTheta = acos(vCosTheta);
+        const __m128 vSinTheta = _mm_sqrt_ps(_mm_fnmadd_ps(vCosTheta, vCosTheta, vOne));
+        const __m128 vOneMinusT = _mm_sub_ps(vOne, vT);
+
+        __m128 vW1 = _mm_div_ps(sin(_mm_mul_ps(vOneMinusT, vTheta)), vSinTheta);
+        __m128 vW2 = _mm_div_ps(sin(_mm_mul_ps(vT, vTheta)), vSinTheta);
+
+        // If theta is near zero, use linear interpolation followed by normalization,
+        // otherwise, there might be a divide-by-zero.
+        const __m128 vIsThetaNearZero = _mm_cmpgt_ps(vCosTheta, _mm_set1_ps(1.0f - FLT_EPSILON));
+        vW1 = _mm_blendv_ps(vW1, vOneMinusT, vIsThetaNearZero);
+        vW2 = _mm_blendv_ps(vW2, vT, vIsThetaNearZero);
+        vW2 = _mm_mul_ps(vW2, vSign);
+
+        __m128 vLengthSq = _mm_setzero_ps();
+
+        for (int c = 0; c < 4; c++)
+        {
+            vRes[c] = _mm_fmadd_ps(vQ2[c], vW2, _mm_mul_ps(vQ1[c], vW1));
+            vLengthSq = _mm_fmadd_ps(vRes[c], vRes[c], vLengthSq);
+        }
+
+        const __m128 vRcpLength = _mm_div_ps(vOne, _mm_sqrt_ps(vLengthSq));
+
+        for (int c = 0; c < 4; c++)
+            vRes[c] = _mm_mul_ps(vRes[c], vRcpLength);
+    }
+
+    // Computes world transformations of 8 consecutive instances from their local 
+    // transformations and world transformations of their parents. Inputs are transposed 
+    // into SoA on load so that every instruction processes all eight instances.
+    void ToWorld8(const AffineTransformation* locals, const float4x3* parents, 
+        const uint32_t* parentIdx, float4x3* toWorlds)
+    {
+        static_assert(sizeof(AffineTransformation) == 10 * sizeof(float), "Unexpected layout.");
+        static_assert(sizeof(float4x3) == 12 * sizeof(float), "Unexpected layout.");
+
+        // Scale, rotation quaternion and translation
+        const float* l = reinterpret_cast<const float*>(locals);
+        const __m256i vLocalIdx = _mm256_setr_epi32(0, 10, 20, 30, 40, 50, 60, 70);
+        const __m256 vSx = _mm256_i32gather_ps(l + 0, vLocalIdx, 4);
+        const __m256 vSy = _mm256_i32gather_ps(l + 1, vLocalIdx, 4);
+        const __m256 vSz = _mm256_i32gather_ps(l + 2, vLocalIdx, 4);
+        const __m256 vQx = _mm256_i32gather_ps(l + 3, vLocalIdx, 4);
+        const __m256 vQy = _mm256_i32gather_ps(l + 4, vLocalIdx, 4);
+        const __m256 vQz = _mm256_i32gather_ps(l + 5, vLocalIdx, 4);
+        const __m256 vQw = _mm256_i32gather_ps(l + 6, vLocalIdx, 4);
+        const __m256 vTx = _mm256_i32gather_ps(l + 7, vLocalIdx, 4);
+        const __m256 vTy = _mm256_i32gather_ps(l + 8, vLocalIdx, 4);
+        const __m256 vTz = _mm256_i32gather_ps(l + 9, vLocalIdx, 4);
+
+        // Rows of parent transformations
+        const float* p = reinterpret_cast<const float*>(parents);
+        const __m256i vParentIdx = _mm256_mullo_epi32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(parentIdx)), _mm256_set1_epi32(12));
+        __m256 vP[12];
+
+        for (int k = 0; k < 12; k++)
+            vP[k] = _mm256_i32gather_ps(p + k, vParentIdx, 4);
+
+        // Scaled rotation matrix, same convention as rotationMatFromQuat()
+        const __m256 vOne = _mm256_set1_ps(1.0f);
+        const __m256 v2 = _mm256_set1_ps(2.0f);
+        const __m256 vXX = _mm256_mul_ps(vQx, vQx);
+        const __m256 vYY = _mm256_mul_ps(vQy, vQy);
+        const __m256 vZZ = _mm256_mul_ps(vQz, vQz);
+        const __m256 vXY = _mm256_mul_ps(vQx, vQy);
+        const __m256 vXZ = _mm256_mul_ps(vQx, vQz);
+        const __m256 vYZ = _mm256_mul_ps(vQy, vQz);
+        const __m256 vXW = _mm256_mul_ps(vQx, vQw);
+        const __m256 vYW = _mm256_mul_ps(vQy, vQw);
+        const __m256 vZW = _mm256_mul_ps(vQz, vQw);
+        const __m256 vMin2 = _mm256_set1_ps(-2.0f);
+
+        __m256 vL[9];
+        vL[0] = _mm256_mul_ps(vSx, _mm256_fmadd_ps(vMin2, _mm256_add_ps(vYY, vZZ), vOne));
+        vL[1] = _mm256_mul_ps(vSx, _mm256_mul_ps(v2, _mm256_add_ps(vXY, vZW)));
+        vL[2] = _mm256_mul_ps(vSx, _mm256_mul_ps(v2, _mm256_sub_ps(vXZ, vYW)));
+        vL[3] = _mm256_mul_ps(vSy, _mm256_mul_ps(v2, _mm256_sub_ps(vXY, vZW)));
+        vL[4] = _mm256_mul_ps(vSy, _mm256_fmadd_ps(vMin2, _mm256_add_ps(vXX, vZZ), vOne));
+        vL[5] = _mm256_mul_ps(vSy, _mm256_mul_ps(v2, _mm256_add_ps(vYZ, vXW)));
+        vL[6] = _mm256_mul_ps(vSz, _mm256_mul_ps(v2, _mm256_add_ps(vXZ, vYW)));
+        vL[7] = _mm256_mul_ps(vSz, _mm256_mul_ps(v2, _mm256_sub_ps(vYZ, vXW)));
+        vL[8] = _mm256_mul_ps(vSz, _mm256_fmadd_ps(vMin2, _mm256_add_ps(vXX, vYY), vOne));
+
+        // W = L * P, where the last column of both is (0, 0, 0, 1)
+        alignas(32) float w[12][8];
+
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                __m256 vW = _mm256_mul_ps(vL[3 * r], vP[c]);
+                vW = _mm256_fmadd_ps(vL[3 * r + 1], vP[3 + c], vW);
+                vW = _mm256_fmadd_ps(vL[3 * r + 2], vP[6 + c], vW);
+                _mm256_store_ps(w[3 * r + c], vW);
+            }
+        }
+
+        for (int c = 0; c < 3; c++)
+        {
+            __m256 vW = _mm256_fmadd_ps(vTx, vP[c], vP[9 + c]);
+            vW = _mm256_fmadd_ps(vTy, vP[3 + c], vW);
+            vW = _mm256_fmadd_ps(vTz, vP[6 + c], vW);
+            _mm256_store_ps(w[9 + c], vW);
+        }
+
+        for (int i = 0; i < 8; i++)
+        {
+            for (int r = 0; r < 4; r++)
+                toWorlds[i].m[r] = float3(w[3 * r][i], w[3 * r + 1][i], w[3 * r + 2][i]);
+        }
+    }
+
+    // Everything except for the textures
+    Material MaterialFromDesc(const Asset::MaterialDesc& matDesc)
+    {
+        Material mat;
+        mat.SetBaseColorFactor(matDesc.BaseColorFactor);
+        mat.SetMetallic(matDesc.MetallicFactor);
+        mat.SetSpecularRoughness(matDesc.SpecularRoughnessFactor);
+        mat.SetSpecularIOR(matDesc.SpecularIOR);
+        mat.SetTransmission(matDesc.TransmissionWeight);
+        mat.SetSubsurface(matDesc.SubsurfaceWeight);
+        mat.SetCoatWeight(matDesc.CoatWeight);
+        mat.SetCoatColor(matDesc.CoatColor);
+        mat.SetCoatRoughness(matDesc.CoatRoughness);
+        mat.SetCoatIOR(matDesc.CoatIOR);
+        mat.SetEmissiveFactor(matDesc.EmissiveFactor);
+        mat.SetEmissiveStrength(matDesc.EmissiveStrength);
+        mat.SetNormalScale(matDesc.NormalScale);
+        mat.SetAlphaCutoff(matDesc.AlphaCutoff);
+        mat.SetAlphaMode(matDesc.AlphaMode);
+        mat.SetDoubleSided(matDesc.DoubleSided);
+
+        return mat;
+    }
 }
 
 //--------------------------------------------------------------------------------------
@@ -92,6 +257,27 @@ void SceneCore::Init(Renderer::Interface& rendererInterface)
         fastdelegate::MakeDelegate(this, &SceneCore::AnimateCallback),
         !m_animate);
     App::AddParam(animation);
+
+    ParamVariant meshLODs;
+    meshLODs.InitBool(ICON_FA_LANDMARK " Scene", "Geometry", "Mesh LODs",
+        fastdelegate::MakeDelegate(this, &SceneCore::ToggleMeshLODsCallback),
+        m_meshLODs);
+    App::AddParam(meshLODs);
+
+    ParamVariant hotReload;
+    hotReload.InitBool(ICON_FA_LANDMARK " Scene", "Assets", "Hot reload",
+        fastdelegate::MakeDelegate(this, &SceneCore::ToggleHotReloadCallback),
+        false);
+    App::AddParam(hotReload);
+
+    ParamVariant texPrefetch;
+    texPrefetch.InitBool(ICON_FA_LANDMARK " Scene", "Assets", "Texture prefetch",
+        fastdelegate::MakeDelegate(this, &SceneCore::ToggleTexturePrefetchCallback),
+        m_texPrefetch);
+    App::AddParam(texPrefetch);
+
+    GpuMemory::RegisterMemoryPressureCallback(fastdelegate::MakeDelegate(this, 
+        &SceneCore::OnMemoryPressure));
 }
 
 void SceneCore::OnWindowSizeChanged()
@@ -101,11 +287,22 @@ void SceneCore::OnWindowSizeChanged()
 
 void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
 {
+    m_loadInProgress = m_numPendingLoads.load(std::memory_order_acquire) > 0;
+
     if (m_isPaused)
         return;
 
+    // Renderer keeps running (with an empty scene) while loading
+    if (IsLoading())
+    {
+        m_rendererInterface.Update(sceneRendererTS);
+        return;
+    }
+
     auto updateWorldTransforms = sceneTS.EmplaceTask("Scene::UpdateWorldTransform", [this]()
         {
+            EraseExpiredInstanceUpdates();
+
             if (m_rebuildBVHFlag)
                 InitWorldTransformations();
 
@@ -116,7 +313,7 @@ void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
                 UpdateLocalTransforms(animUpdates);
             }
 
-            if (!m_instanceUpdates.empty())
+            if (!m_instanceUpdates.empty() || m_hasDirtyTransforms)
             {
                 SmallVector<BVH::BVHUpdateInput, App::FrameAllocator> toUpdateInstances;
                 UpdateWorldTransformations(toUpdateInstances);
@@ -130,6 +327,12 @@ void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
     // Size of m_instanceUpdates may change after async. task above runs, but since it never
     // goes from > 0 to 0, it doesn't matter
     m_staleEmissivePositions = m_staleEmissivePositions || !m_emissives.Initialized();
+    m_emissivePositionsUpdated = false;
+    m_emissivePosUpdates.clear();
+
+    // Moved instances are appended by UpdateEmissivePositions()
+    m_changedEmissives.swap(m_pendingEmissiveMatChanges);
+    m_pendingEmissiveMatChanges.clear();
 
     if (!m_emissives.Initialized() && numInstances)
     {
@@ -164,6 +367,9 @@ void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
                 {
                     ResetRtAsInfos();
                 });
+
+            // Static instance order depends on world transforms
+            sceneTS.AddOutgoingEdge(updateWorldTransforms, resetRtAsInfo);
         }
 
         auto upload = sceneTS.EmplaceTask("UploadEmissiveBuffer", [this]()
@@ -174,102 +380,144 @@ void SceneCore::Update(double dt, TaskSet& sceneTS, TaskSet& sceneRendererTS)
         // Full rebuild of emissive buffer for first time
         if (!m_emissives.Initialized())
         {
-            constexpr size_t MAX_NUM_EMISSIVE_WORKERS = 5;
-            constexpr size_t MIN_EMISSIVE_INSTANCES_PER_WORKER = 35;
-            size_t threadOffsets[MAX_NUM_EMISSIVE_WORKERS];
-            size_t threadSizes[MAX_NUM_EMISSIVE_WORKERS];
-
-            const size_t numEmissiveWorkers = SubdivideRangeWithMin(numInstances,
-                MAX_NUM_EMISSIVE_WORKERS,
-                threadOffsets,
-                threadSizes,
-                MIN_EMISSIVE_INSTANCES_PER_WORKER);
-
-            for (size_t i = 0; i < numEmissiveWorkers; i++)
-            {
-                StackStr(tname, n, "Scene::Emissive_%d", i);
+            constexpr size_t MIN_EMISSIVE_INSTANCES_PER_CHUNK = 8;
 
-                auto h = sceneTS.EmplaceTask(tname, [this, offset = threadOffsets[i], size = threadSizes[i]]()
-                    {
-                        auto emissvies = m_emissives.Instances();
-                        auto tris = m_emissives.Triagnles();
-                        auto triInitialPos = m_emissives.InitialTriPositions();
-                        v_float4x4 I = identity();
+            auto h = sceneTS.EmplaceTask("Scene::InitEmissives", [this, numInstances]()
+                {
+                    auto emissvies = m_emissives.Instances();
+                    auto tris = m_emissives.Triagnles();
+                    auto triInitialPos = m_emissives.InitialTriPositions();
 
-                        // For every emissive instance, apply world transformation to all of its triangles
-                        for (size_t instance = offset; instance < offset + size; instance++)
+                    App::ParallelFor(numInstances, MIN_EMISSIVE_INSTANCES_PER_CHUNK,
+                        [this, emissvies, tris, triInitialPos](size_t begin, size_t end)
                         {
-                            const auto& e = emissvies[instance];
-                            const v_float4x4 vW = load4x3(GetToWorld(e.InstanceID));
-                            const bool skipTransform = equal(vW, I);
+                            v_float4x4 I = identity();
 
-                            const auto rtASInfo = GetInstanceRtASInfo(e.InstanceID);
-
-                            for (size_t t = e.BaseTriOffset; t < e.BaseTriOffset + e.NumTriangles; t++)
+                            // For every emissive instance, apply world transformation to all of its triangles
+                            for (size_t instance = begin; instance < end; instance++)
                             {
-                                if (!skipTransform)
-                                {
-                                    __m128 vV0;
-                                    __m128 vV1;
-                                    __m128 vV2;
-                                    tris[t].LoadVertices(vV0, vV1, vV2);
+                                const auto& e = emissvies[instance];
+                                const v_float4x4 vW = load4x3(GetToWorld(e.InstanceID));
+                                const bool skipTransform = equal(vW, I);
+
+                                const auto rtASInfo = GetInstanceRtASInfo(e.InstanceID);
 
+                                for (size_t t = e.BaseTriOffset; t < e.BaseTriOffset + e.NumTriangles; t++)
+                                {
+                                    // Needed for every instance as any of them may move later
                                     triInitialPos[t].Vtx0 = tris[t].Vtx0;
                                     triInitialPos[t].V0V1 = tris[t].V0V1;
                                     triInitialPos[t].V0V2 = tris[t].V0V2;
                                     triInitialPos[t].EdgeLengths = tris[t].EdgeLengths;
                                     triInitialPos[t].PrimIdx = tris[t].ID;
 
-                                    vV0 = mul(vW, vV0);
-                                    vV1 = mul(vW, vV1);
-                                    vV2 = mul(vW, vV2);
-                                    tris[t].StoreVertices(vV0, vV1, vV2);
+                                    if (!skipTransform)
+                                    {
+                                        __m128 vV0;
+                                        __m128 vV1;
+                                        __m128 vV2;
+                                        tris[t].LoadVertices(vV0, vV1, vV2);
+
+                                        vV0 = mul(vW, vV0);
+                                        vV1 = mul(vW, vV1);
+                                        vV2 = mul(vW, vV2);
+                                        tris[t].StoreVertices(vV0, vV1, vV2);
+                                    }
+
+                                    // Keyed by mesh instance index, which doesn't depend 
+                                    // on how static instances are split between BLASes
+                                    const uint32_t hash = Pcg3d(uint3(rtASInfo.GeometryIndex + 
+                                        rtASInfo.InstanceID, 0,
+                                        tris[t].ID)).x;
+
+                                    Assert(!tris[t].IsIDPatched(), 
+                                        "Rewriting emissive triangle ID after the first assignment is invalid.");
+                                    tris[t].ResetID(hash);
                                 }
-
-                                const uint32_t hash = Pcg3d(uint3(rtASInfo.GeometryIndex, 
-                                    rtASInfo.InstanceID,
-                                    tris[t].ID)).x;
-
-                                Assert(!tris[t].IsIDPatched(), 
-                                    "Rewriting emissive triangle ID after the first assignment is invalid.");
-                                tris[t].ResetID(hash);
                             }
-                        }
-                    });
+                        });
+                });
 
-                sceneTS.AddOutgoingEdge(updateWorldTransforms, h);
+            sceneTS.AddOutgoingEdge(updateWorldTransforms, h);
 
-                Assert(resetRtAsInfo != TaskSet::INVALID_TASK_HANDLE, "Invalid task handle.");
-                sceneTS.AddOutgoingEdge(resetRtAsInfo, h);
+            Assert(resetRtAsInfo != TaskSet::INVALID_TASK_HANDLE, "Invalid task handle.");
+            sceneTS.AddOutgoingEdge(resetRtAsInfo, h);
 
-                sceneTS.AddOutgoingEdge(h, upload);
-            }
+            sceneTS.AddOutgoingEdge(h, upload);
         }
-        else if (m_staleEmissivePositions)
+        // Triangles are transformed on the GPU, just gather the instances that need it
+        else
         {
-            auto h = sceneTS.EmplaceTask("Scene::UpdateEmissivePos", [this]()
+            auto h = sceneTS.EmplaceTask("Scene::UpdateEmissivePos", 
+                [this, moved = m_staleEmissivePositions]()
                 {
-                    UpdateEmissivePositions();
+                    UpdateEmissivePositions(moved);
                 });
 
-            //sceneTS.AddOutgoingEdge(resetRtAsInfo, h);
-            sceneTS.AddOutgoingEdge(h, upload);
+            // Instance updates are added while world transforms are updated
+            sceneTS.AddOutgoingEdge(updateWorldTransforms, h);
         }
 
+        // Stale flag is cleared here, but render passes that are derived from emissive
+        // positions need to know about the update later in the frame
+        m_emissivePositionsUpdated = m_staleEmissivePositions;
         m_staleEmissivePositions = false;
     }
 
+    // Results are used by the texture streamer next frame
+    if (m_texPrefetch && App::GetTimer().GetTotalFrameCount() % TEX_PREDICTION_INTERVAL == 0)
+    {
+        auto h = sceneTS.EmplaceTask("Scene::PredictTextureUsage", [this]()
+            {
+                PredictTextureUsage();
+            });
+
+        // Needs the updated world transforms
+        sceneTS.AddOutgoingEdge(updateWorldTransforms, h);
+    }
+
     if (m_meshBufferStale)
     {
         sceneTS.EmplaceTask("Scene::RebuildMeshBuffers", [this]()
             {
-                m_meshes.RebuildBuffers();
+                m_meshes.UploadToGPU();
             });
 
         m_meshBufferStale = false;
     }
 
-    m_matBuffer.UploadToGPU();
+    // Runs after every other scene update task
+    auto snapshot = sceneTS.EmplaceTask("Scene::PublishRenderSnapshot", [this]()
+        {
+            PublishRenderSnapshot();
+        });
+
+    sceneTS.AddIncomingEdgeFromAll(snapshot);
+
+    {
+        AcquireSRWLockExclusive(&m_meshLock);
+        m_meshes.Recycle(App::GetRenderer().GetCompletedFrameFenceValue());
+        ReleaseSRWLockExclusive(&m_meshLock);
+    }
+
+    // Applies changed materials and textures before the texture streamer runs
+    glTF::HotReload::Update();
+
+    {
+        // Loading threads might be adding textures at the same time
+        AcquireSRWLockExclusive(&m_matLock);
+
+        TexSRVDescriptorTable* tables[] = { &m_baseColorDescTable, &m_normalDescTable,
+            &m_metallicRoughnessDescTable, &m_emissiveDescTable };
+        m_texStreamer.Update(Span(tables, ZetaArrayLen(tables)));
+
+        // Materials can only be uploaded after the descriptors for their textures have 
+        // been committed above
+        m_matBuffer.Recycle(App::GetRenderer().GetCompletedFrameFenceValue());
+        m_matBuffer.UploadToGPU();
+
+        ReleaseSRWLockExclusive(&m_matLock);
+    }
     m_rendererInterface.Update(sceneRendererTS);
 }
 
@@ -278,7 +526,9 @@ void SceneCore::Shutdown()
     // Make sure all GPU resources (texture, buffers, etc) are manually released,
     // as they normally call the GPU memory subsystem upon destruction, which
     // is deleted at that point.
+    glTF::HotReload::Shutdown();
     m_matBuffer.Clear();
+    m_texStreamer.Clear();
     m_baseColorDescTable.Clear();
     m_normalDescTable.Clear();
     m_metallicRoughnessDescTable.Clear();
@@ -286,6 +536,9 @@ void SceneCore::Shutdown()
     m_meshes.Clear();
     m_emissives.Clear();
 
+    GpuMemory::UnregisterMemoryPressureCallback(fastdelegate::MakeDelegate(this, 
+        &SceneCore::OnMemoryPressure));
+
     for (auto& heap : m_textureHeaps)
         heap.Reset();
 
@@ -320,25 +573,23 @@ void SceneCore::AddMeshes(SmallVector<Asset::Mesh>&& meshes, SmallVector<Vertex>
         ReleaseSRWLockExclusive(&m_meshLock);
 }
 
+void SceneCore::RemoveMesh(uint64_t id, bool lock)
+{
+    const uint64_t fenceVal = App::GetRenderer().GetCurrentFrameFenceValue();
+
+    if (lock)
+        AcquireSRWLockExclusive(&m_meshLock);
+
+    m_numTriangles -= m_meshes.GetMesh(id).value()->m_numIndices;
+    m_meshes.Remove(id, fenceVal);
+
+    if (lock)
+        ReleaseSRWLockExclusive(&m_meshLock);
+}
+
 void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, bool lock)
 {
-    Material mat;
-    mat.SetBaseColorFactor(matDesc.BaseColorFactor);
-    mat.SetMetallic(matDesc.MetallicFactor);
-    mat.SetSpecularRoughness(matDesc.SpecularRoughnessFactor);
-    mat.SetSpecularIOR(matDesc.SpecularIOR);
-    mat.SetTransmission(matDesc.TransmissionWeight);
-    mat.SetSubsurface(matDesc.SubsurfaceWeight);
-    mat.SetCoatWeight(matDesc.CoatWeight);
-    mat.SetCoatColor(matDesc.CoatColor);
-    mat.SetCoatRoughness(matDesc.CoatRoughness);
-    mat.SetCoatIOR(matDesc.CoatIOR);
-    mat.SetEmissiveFactor(matDesc.EmissiveFactor);
-    mat.SetEmissiveStrength(matDesc.EmissiveStrength);
-    mat.SetNormalScale(matDesc.NormalScale);
-    mat.SetAlphaCutoff(matDesc.AlphaCutoff);
-    mat.SetAlphaMode(matDesc.AlphaMode);
-    mat.SetDoubleSided(matDesc.DoubleSided);
+    Material mat = MaterialFromDesc(matDesc);
 
     if (lock)
         AcquireSRWLockExclusive(&m_matLock);
@@ -352,32 +603,21 @@ void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, bool lock)
 void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, MutableSpan<Texture> ddsImages,
     bool lock)
 {
-    Material mat;
-    mat.SetBaseColorFactor(matDesc.BaseColorFactor);
-    mat.SetMetallic(matDesc.MetallicFactor);
-    mat.SetSpecularRoughness(matDesc.SpecularRoughnessFactor);
-    mat.SetSpecularIOR(matDesc.SpecularIOR);
-    mat.SetTransmission(matDesc.TransmissionWeight);
-    mat.SetSubsurface(matDesc.SubsurfaceWeight);
-    mat.SetCoatWeight(matDesc.CoatWeight);
-    mat.SetCoatColor(matDesc.CoatColor);
-    mat.SetCoatRoughness(matDesc.CoatRoughness);
-    mat.SetCoatIOR(matDesc.CoatIOR);
-    mat.SetEmissiveFactor(matDesc.EmissiveFactor);
-    mat.SetEmissiveStrength(matDesc.EmissiveStrength);
-    mat.SetNormalScale(matDesc.NormalScale);
-    mat.SetAlphaCutoff(matDesc.AlphaCutoff);
-    mat.SetAlphaMode(matDesc.AlphaMode);
-    mat.SetDoubleSided(matDesc.DoubleSided);
-
-    auto addTex = [](Texture::ID_TYPE ID, const char* type, TexSRVDescriptorTable& table, uint32_t& tableOffset, 
-        MutableSpan<Texture> ddsImages)
+    Material mat = MaterialFromDesc(matDesc);
+
+    auto addTex = [this](Texture::ID_TYPE ID, const char* type, TexSRVDescriptorTable& table, 
+        uint32_t feedbackOffset, uint32_t& tableOffset, MutableSpan<Texture> ddsImages)
         {
             auto idx = BinarySearch(Span(ddsImages), ID, [](const Texture& obj) {return obj.ID(); });
             Check(idx != -1, "%s image with ID %llu was not found.", type, ID);
 
             tableOffset = table.Add(ZetaMove(ddsImages[idx]));
 
+            // Slots past the initial table size don't have feedback entries, those textures
+            // stay at their resident mip
+            if (tableOffset < table.InitialSize())
+                m_texStreamer.SetFeedbackIndex(ID, feedbackOffset + tableOffset);
+
             // HACK Since the texture was moved, ID was changed to -1. Add a dummy texture with the same ID
             // so that binary search continues to work.
             ddsImages[idx] = Texture(ID, nullptr, RESOURCE_HEAP_TYPE::COMMITTED);
@@ -391,7 +631,8 @@ void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, MutableSpan<Text
 
         if (matDesc.BaseColorTexID != Texture::INVALID_ID)
         {
-            addTex(matDesc.BaseColorTexID, "BaseColor", m_baseColorDescTable, tableOffset, ddsImages);
+            addTex(matDesc.BaseColorTexID, "BaseColor", m_baseColorDescTable, 
+                TEX_FEEDBACK_BASE_COLOR_OFFSET, tableOffset, ddsImages);
             mat.SetBaseColorTex(tableOffset);
         }
     }
@@ -400,7 +641,8 @@ void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, MutableSpan<Text
         uint32_t tableOffset = Material::INVALID_ID;
         if (matDesc.NormalTexID != Texture::INVALID_ID)
         {
-            addTex(matDesc.NormalTexID, "NormalMap", m_normalDescTable, tableOffset, ddsImages);
+            addTex(matDesc.NormalTexID, "NormalMap", m_normalDescTable, TEX_FEEDBACK_NORMAL_OFFSET, 
+                tableOffset, ddsImages);
             mat.SetNormalTex(tableOffset);
         }
     }
@@ -410,7 +652,8 @@ void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, MutableSpan<Text
         if (matDesc.MetallicRoughnessTexID != Texture::INVALID_ID)
         {
             addTex(matDesc.MetallicRoughnessTexID, "MetallicRoughnessMap",
-                m_metallicRoughnessDescTable, tableOffset, ddsImages);
+                m_metallicRoughnessDescTable, TEX_FEEDBACK_METALLIC_ROUGHNESS_OFFSET, tableOffset, 
+                ddsImages);
 
             mat.SetMetallicRoughnessTex(tableOffset);
         }
@@ -420,7 +663,8 @@ void SceneCore::AddMaterial(const Asset::MaterialDesc& matDesc, MutableSpan<Text
         uint32_t tableOffset = Material::INVALID_ID;
         if (matDesc.EmissiveTexID != Texture::INVALID_ID)
         {
-            addTex(matDesc.EmissiveTexID, "EmissiveMap", m_emissiveDescTable, tableOffset, ddsImages);
+            addTex(matDesc.EmissiveTexID, "EmissiveMap", m_emissiveDescTable, TEX_FEEDBACK_EMISSIVE_OFFSET, 
+                tableOffset, ddsImages);
             mat.SetEmissiveTex(tableOffset);
         }
     }
@@ -439,6 +683,147 @@ void SceneCore::UpdateMaterial(uint32 ID, const Material& newMat)
     m_rendererInterface.SceneModified();
 }
 
+void SceneCore::RemoveMaterial(uint32_t ID, bool lock)
+{
+    const uint64_t fenceVal = App::GetRenderer().GetCurrentFrameFenceValue();
+
+    if (lock)
+        AcquireSRWLockExclusive(&m_matLock);
+
+    const Material mat = *m_matBuffer.Get(ID).value();
+
+    auto releaseTex = [this, fenceVal](uint32_t tableOffset, TexSRVDescriptorTable& table)
+        {
+            if (tableOffset == Material::INVALID_ID)
+                return;
+
+            const Texture::ID_TYPE evicted = table.Remove(tableOffset, fenceVal);
+            if (evicted != Texture::INVALID_ID)
+                m_texStreamer.Remove(evicted);
+        };
+
+    releaseTex(mat.GetBaseColorTex(), m_baseColorDescTable);
+    releaseTex(mat.GetNormalTex(), m_normalDescTable);
+    releaseTex(mat.GetMetallicRoughnessTex(), m_metallicRoughnessDescTable);
+    releaseTex(mat.GetEmissiveTex(), m_emissiveDescTable);
+
+    m_matBuffer.Remove(ID, fenceVal);
+
+    if (lock)
+        ReleaseSRWLockExclusive(&m_matLock);
+}
+
+void SceneCore::ReloadMaterial(const Asset::MaterialDesc& matDesc, MutableSpan<Texture> textures)
+{
+    const uint64_t fenceVal = App::GetRenderer().GetCurrentFrameFenceValue();
+    Material mat = MaterialFromDesc(matDesc);
+
+    AcquireSRWLockExclusive(&m_matLock);
+
+    auto prev = m_matBuffer.Get(matDesc.ID);
+    if (!prev)
+    {
+        ReleaseSRWLockExclusive(&m_matLock);
+        return;
+    }
+
+    const Material prevMat = *prev.value();
+
+    // Textures that haven't changed keep their descriptor table slots
+    auto reloadTex = [this, fenceVal, textures](Texture::ID_TYPE ID, uint32_t prevOffset, 
+        TexSRVDescriptorTable& table, uint32_t feedbackOffset)
+        {
+            const Texture::ID_TYPE prevID = prevOffset != Material::INVALID_ID ? 
+                table.FindID(prevOffset) : Texture::INVALID_ID;
+            if (ID == prevID)
+                return prevOffset;
+
+            uint32_t tableOffset = Material::INVALID_ID;
+
+            if (ID != Texture::INVALID_ID)
+            {
+                // Already referenced by other materials, add a dummy texture with the 
+                // same ID to increase the ref count
+                if (table.FindOffset(ID) != UINT32_MAX)
+                    tableOffset = table.Add(Texture(ID, nullptr, RESOURCE_HEAP_TYPE::COMMITTED));
+                else
+                {
+                    auto idx = BinarySearch(Span(textures), ID, [](const Texture& obj) {return obj.ID(); });
+
+                    if (idx != -1 && textures[idx].Resource())
+                    {
+                        tableOffset = table.Add(ZetaMove(textures[idx]));
+                        // Keep the ID around for binary search (see AddMaterial())
+                        textures[idx] = Texture(ID, nullptr, RESOURCE_HEAP_TYPE::COMMITTED);
+                    }
+                    else
+                        LOG_UI_WARNING("Texture with ID %u for material %u was not loaded.\n", ID, matDesc.ID);
+                }
+
+                if (tableOffset < table.InitialSize())
+                    m_texStreamer.SetFeedbackIndex(ID, feedbackOffset + tableOffset);
+            }
+
+            if (prevOffset != Material::INVALID_ID)
+            {
+                const Texture::ID_TYPE evicted = table.Remove(prevOffset, fenceVal);
+                if (evicted != Texture::INVALID_ID)
+                    m_texStreamer.Remove(evicted);
+            }
+
+            return tableOffset;
+        };
+
+    mat.SetBaseColorTex(reloadTex(matDesc.BaseColorTexID, prevMat.GetBaseColorTex(), 
+        m_baseColorDescTable, TEX_FEEDBACK_BASE_COLOR_OFFSET));
+    mat.SetNormalTex(reloadTex(matDesc.NormalTexID, prevMat.GetNormalTex(), 
+        m_normalDescTable, TEX_FEEDBACK_NORMAL_OFFSET));
+    mat.SetMetallicRoughnessTex(reloadTex(matDesc.MetallicRoughnessTexID, 
+        prevMat.GetMetallicRoughnessTex(), m_metallicRoughnessDescTable, 
+        TEX_FEEDBACK_METALLIC_ROUGHNESS_OFFSET));
+    mat.SetEmissiveTex(reloadTex(matDesc.EmissiveTexID, prevMat.GetEmissiveTex(), 
+        m_emissiveDescTable, TEX_FEEDBACK_EMISSIVE_OFFSET));
+
+    m_matBuffer.Update(matDesc.ID, mat);
+
+    ReleaseSRWLockExclusive(&m_matLock);
+
+    m_rendererInterface.SceneModified();
+}
+
+void SceneCore::ReloadTexture(const TextureStreamer::TextureDesc& desc)
+{
+    TexSRVDescriptorTable* tables[] = { &m_baseColorDescTable, &m_normalDescTable,
+        &m_metallicRoughnessDescTable, &m_emissiveDescTable };
+    constexpr uint32_t feedbackOffsets[] = { TEX_FEEDBACK_BASE_COLOR_OFFSET, TEX_FEEDBACK_NORMAL_OFFSET,
+        TEX_FEEDBACK_METALLIC_ROUGHNESS_OFFSET, TEX_FEEDBACK_EMISSIVE_OFFSET };
+    uint32_t feedbackIdx = UINT32_MAX;
+    bool found = false;
+
+    AcquireSRWLockExclusive(&m_matLock);
+
+    for (size_t i = 0; i < ZetaArrayLen(tables); i++)
+    {
+        if (const uint32_t offset = tables[i]->FindOffset(desc.ID); offset != UINT32_MAX)
+        {
+            // Slots past the initial table size don't have feedback entries
+            if (offset < tables[i]->InitialSize())
+                feedbackIdx = feedbackOffsets[i] + offset;
+
+            found = true;
+            break;
+        }
+    }
+
+    ReleaseSRWLockExclusive(&m_matLock);
+
+    // Not referenced by any material
+    if (!found)
+        return;
+
+    m_texStreamer.Reload(desc, feedbackIdx);
+}
+
 void SceneCore::ResizeAdditionalMaterials(uint32_t num)
 {
     m_matBuffer.ResizeAdditionalMaterials(num);
@@ -472,7 +857,7 @@ void SceneCore::AddInstance(Asset::InstanceDesc& instance, bool lock)
     // Get parent's index from the hashmap
     if (instance.ParentID != ROOT_ID)
     {
-        const TreePos& p = FindTreePosFromID(instance.ParentID).value();
+        const TreePos p = FindTreePosFromID(instance.ParentID).value();
 
         treeLevel = p.Level + 1;
         parentIdx = p.Offset;
@@ -481,20 +866,26 @@ void SceneCore::AddInstance(Asset::InstanceDesc& instance, bool lock)
     const uint32_t insertIdx = InsertAtLevel(instance.ID, treeLevel, parentIdx, instance.LocalTransform, meshID,
         instance.RtMeshMode, instance.RtInstanceMask, instance.IsOpaque);
 
-    // Update instance "dictionary"
+    // Update instance "dictionary" -- all the changes are made in one write batch
     {
         Assert(!m_IDtoTreePos.find(instance.ID), "instance with id %llu already exists.", instance.ID);
+
+        m_IDtoTreePos.begin_write();
         m_IDtoTreePos.insert_or_assign(instance.ID, TreePos{ .Level = treeLevel, .Offset = insertIdx });
 
         // Adjust tree positions of shifted instances
         for (size_t i = insertIdx + 1; i < m_sceneGraph[treeLevel].m_IDs.size(); i++)
         {
             uint64_t insID = m_sceneGraph[treeLevel].m_IDs[i];
-            auto pos = m_IDtoTreePos.find(insID);
 
             // Shift tree position to right
-            pos.value()->Offset++;
+            m_IDtoTreePos.update(insID, [](TreePos& p)
+                {
+                    p.Offset++;
+                });
         }
+
+        m_IDtoTreePos.end_write();
     }
 
     m_rebuildBVHFlag = true;
@@ -553,42 +944,116 @@ uint32_t SceneCore::InsertAtLevel(uint64_t id, uint32_t treeLevel, uint32_t pare
     auto flags = RT_Flags::Encode(rtMeshMode, rtInstanceMask, 1, 0, isOpaque);
     rearrange(currLevel.m_rtFlags, insertIdx, flags);
     rearrange(currLevel.m_rtASInfo, insertIdx, RT_AS_Info());
+    rearrange(currLevel.m_parents, insertIdx, parentIdx);
+    rearrange(currLevel.m_dirtyFlags, insertIdx, (uint8_t)0);
 
     // Shift base offset of parent's right siblings to right by one
     for (size_t siblingIdx = parentIdx + 1; siblingIdx != parentLevel.m_subtreeRanges.size(); siblingIdx++)
         parentLevel.m_subtreeRanges[siblingIdx].Base++;
 
+    // Same for references to shifted instances
+    for (auto& idx : currLevel.m_dirtyList)
+        idx = idx >= insertIdx ? idx + 1 : idx;
+
+    if (treeLevel + 1 < m_sceneGraph.size())
+    {
+        for (auto& idx : m_sceneGraph[treeLevel + 1].m_parents)
+            idx = idx >= insertIdx ? idx + 1 : idx;
+    }
+
     return insertIdx;
 }
 
-void SceneCore::ResetRtAsInfos()
+void SceneCore::SortRtStaticInstances()
 {
-    // Following must exactly match the iteration order of StaticBLAS::Rebuild().
-    uint32_t currInstance = 0;
+    // Bounds of world-space AABB centroids
+    float3 lo(FLT_MAX);
+    float3 hi(-FLT_MAX);
+
+    SmallVector<float3, App::FrameAllocator> centroids;
+    centroids.reserve(m_numStaticInstances);
+    m_rtStaticInstanceOrder.clear();
+    m_rtStaticInstanceOrder.reserve(m_numStaticInstances);
 
     for (size_t treeLevelIdx = 1; treeLevelIdx < m_sceneGraph.size(); treeLevelIdx++)
     {
-        auto& currTreeLevel = m_sceneGraph[treeLevelIdx];
+        const auto& currTreeLevel = m_sceneGraph[treeLevelIdx];
 
         for (size_t i = 0; i < currTreeLevel.m_rtFlags.size(); i++)
         {
+            const uint64_t meshID = currTreeLevel.m_meshIDs[i];
+            if (meshID == Scene::INVALID_MESH)
+                continue;
+
             const Scene::RT_Flags flags = RT_Flags::Decode(currTreeLevel.m_rtFlags[i]);
+            if (flags.MeshMode != RT_MESH_MODE::STATIC)
+                continue;
 
-            if (flags.MeshMode == RT_MESH_MODE::STATIC)
-            {
-                const uint64_t meshID = currTreeLevel.m_meshIDs[i];
-                if (meshID == Scene::INVALID_MESH)
-                    continue;
+            const TriangleMesh* mesh = m_meshes.GetMesh(meshID).value();
+            const AABB box = store(transform(load4x3(currTreeLevel.m_toWorlds[i]),
+                v_AABB(mesh->m_AABB)));
+            const float3 c = box.Center;
 
-                currTreeLevel.m_rtASInfo[i] = RT_AS_Info{
-                    .GeometryIndex = currInstance,
-                    .InstanceID = 0 };
+            lo = float3(Min(lo.x, c.x), Min(lo.y, c.y), Min(lo.z, c.z));
+            hi = float3(Max(hi.x, c.x), Max(hi.y, c.y), Max(hi.z, c.z));
 
-                currInstance++;
-            }
+            centroids.push_back(c);
+            m_rtStaticInstanceOrder.push_back(((uint64_t)treeLevelIdx << 32) | i);
         }
     }
 
+    const uint32_t numInstances = (uint32_t)centroids.size();
+    if (numInstances == 0)
+        return;
+
+    const float3 extents = hi - lo;
+    const float3 scale(extents.x > 0 ? 1024.0f / extents.x : 0.0f,
+        extents.y > 0 ? 1024.0f / extents.y : 0.0f,
+        extents.z > 0 ? 1024.0f / extents.z : 0.0f);
+
+    // Morton code in high bits, traversal index in low bits (breaks ties deterministically)
+    SmallVector<uint64_t, App::FrameAllocator> keys;
+    keys.resize_uninitialized(numInstances);
+
+    for (uint32_t j = 0; j < numInstances; j++)
+    {
+        const float3 p = (centroids[j] - lo) * scale;
+        const uint32_t code = Morton3D((uint32_t)Min(Max(p.x, 0.0f), 1023.0f),
+            (uint32_t)Min(Max(p.y, 0.0f), 1023.0f),
+            (uint32_t)Min(Max(p.z, 0.0f), 1023.0f));
+
+        keys[j] = ((uint64_t)code << 32) | j;
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    SmallVector<uint64_t, App::FrameAllocator> traversalOrder;
+    traversalOrder.append_range(m_rtStaticInstanceOrder.begin(), m_rtStaticInstanceOrder.end());
+
+    for (uint32_t j = 0; j < numInstances; j++)
+        m_rtStaticInstanceOrder[j] = traversalOrder[keys[j] & UINT32_MAX];
+}
+
+void SceneCore::ResetRtAsInfos()
+{
+    // Following must exactly match the static instance order used by TLAS. Static BLASes
+    // may use a different split of GeometryIndex & InstanceID, but their sum (which is 
+    // all that emissives and shaders use) is the same.
+    SortRtStaticInstances();
+    uint32_t currInstance = 0;
+
+    for (const uint64_t treePos : m_rtStaticInstanceOrder)
+    {
+        auto& currTreeLevel = m_sceneGraph[treePos >> 32];
+        const uint32_t i = (uint32_t)(treePos & UINT32_MAX);
+
+        currTreeLevel.m_rtASInfo[i] = RT_AS_Info{
+            .GeometryIndex = currInstance,
+            .InstanceID = 0 };
+
+        currInstance++;
+    }
+
     if (m_numDynamicInstances == 0)
         return;
 
@@ -623,7 +1088,7 @@ void SceneCore::AddAnimation(uint64_t id, MutableSpan<Keyframe> keyframes, float
     bool loop, bool isSorted)
 {
 #ifndef NDEBUG
-    TreePos& p = FindTreePosFromID(id).value();
+    const TreePos p = FindTreePosFromID(id).value();
     Assert(RT_Flags::Decode(m_sceneGraph[p.Level].m_rtFlags[p.Offset]).MeshMode != RT_MESH_MODE::STATIC,
         "Static instances can't be animated.");
 #endif
@@ -632,7 +1097,7 @@ void SceneCore::AddAnimation(uint64_t id, MutableSpan<Keyframe> keyframes, float
 
     if (!isSorted)
     {
-        std::sort(m_keyframes.begin(), m_keyframes.end(),
+        std::sort(keyframes.begin(), keyframes.end(),
             [](const Keyframe& k1, const Keyframe& k2)
             {
                 return k1.Time < k2.Time;
@@ -640,7 +1105,7 @@ void SceneCore::AddAnimation(uint64_t id, MutableSpan<Keyframe> keyframes, float
     }
 
     // Remember starting offset and number of keyframes
-    const uint32_t currOffset = (uint32_t)m_keyframes.size();
+    const uint32_t currOffset = (uint32_t)m_keyframeTimes.size();
     m_animationMetadata.push_back(AnimationMetadata{
             .InstanceID = id,
             .StartOffset = currOffset,
@@ -649,7 +1114,13 @@ void SceneCore::AddAnimation(uint64_t id, MutableSpan<Keyframe> keyframes, float
             .Loop = loop
         });
 
-    m_keyframes.append_range(keyframes.begin(), keyframes.end());
+    for (auto& k : keyframes)
+    {
+        m_keyframeTimes.push_back(k.Time);
+        m_keyframeScales.push_back(k.Transform.Scale);
+        m_keyframeRotations.push_back(k.Transform.Rotation);
+        m_keyframeTranslations.push_back(k.Transform.Translation);
+    }
 }
 
 void SceneCore::TransformInstance(uint64_t id, const float3& tr, const float3x3& rotation,
@@ -665,8 +1136,7 @@ void SceneCore::TransformInstance(uint64_t id, const float3& tr, const float3x3&
         (rtFlags.InstanceMask & RT_AS_SUBGROUP::EMISSIVE));
 
     ConvertInstanceDynamic(id, treePos, rtFlags);
-    // Updates if instance already exists
-    m_instanceUpdates[id] = App::GetTimer().GetTotalFrameCount();
+    MarkTransformDirty(treePos.Level, treePos.Offset);
 
     m_rendererInterface.SceneModified();
 }
@@ -675,21 +1145,29 @@ void SceneCore::ReserveInstances(Span<int> treeLevels, size_t total)
 {
     Assert(treeLevels.size() > 0, "Invalid tree.");
 
+    // Grows the existing storage, as instances from previous loads might be present
     // +1 for root
-    m_sceneGraph.resize(treeLevels.size() + 1);
+    m_sceneGraph.resize(Max(treeLevels.size() + 1, m_sceneGraph.size()));
     for (size_t i = 0; i < treeLevels.size(); i++)
     {
-        m_sceneGraph[i + 1].m_IDs.reserve(treeLevels[i]);
-        m_sceneGraph[i + 1].m_localTransforms.reserve(treeLevels[i]);
-        m_sceneGraph[i + 1].m_meshIDs.reserve(treeLevels[i]);
-        m_sceneGraph[i + 1].m_rtASInfo.reserve(treeLevels[i]);
-        m_sceneGraph[i + 1].m_rtFlags.reserve(treeLevels[i]);
-        m_sceneGraph[i + 1].m_subtreeRanges.reserve(treeLevels[i]);
-        m_sceneGraph[i + 1].m_toWorlds.reserve(treeLevels[i]);
+        const size_t n = m_sceneGraph[i + 1].m_IDs.size() + treeLevels[i];
+
+        m_sceneGraph[i + 1].m_IDs.reserve(n);
+        m_sceneGraph[i + 1].m_localTransforms.reserve(n);
+        m_sceneGraph[i + 1].m_meshIDs.reserve(n);
+        m_sceneGraph[i + 1].m_rtASInfo.reserve(n);
+        m_sceneGraph[i + 1].m_rtFlags.reserve(n);
+        m_sceneGraph[i + 1].m_subtreeRanges.reserve(n);
+        m_sceneGraph[i + 1].m_toWorlds.reserve(n);
+        m_sceneGraph[i + 1].m_parents.reserve(n);
+        m_sceneGraph[i + 1].m_dirtyFlags.reserve(n);
     }
 
+    total += m_IDtoTreePos.size();
     m_prevToWorlds.resize(total, true);
-    m_IDtoTreePos.resize(total, true);
+    m_IDtoTreePos.begin_write();
+    m_IDtoTreePos.reserve(total);
+    m_IDtoTreePos.end_write();
     m_worldTransformUpdates.resize(Min(total, 32llu));
 }
 
@@ -710,10 +1188,39 @@ void SceneCore::AddEmissives(Util::SmallVector<Asset::EmissiveInstance>&& emissi
 
 void SceneCore::UpdateEmissiveMaterial(uint64_t instanceID, const float3& emissiveFactor, float strength)
 {
-    m_emissives.UpdateMaterial(instanceID, emissiveFactor, strength);
+    m_emissives.UpdateMaterial(instanceID, emissiveFactor, strength, m_pendingEmissiveMatChanges);
     m_rendererInterface.SceneModified();
 }
 
+uint64_t SceneCore::EmissiveCacheKey()
+{
+    auto tris = m_emissives.Triagnles();
+
+    XXH3_state_t state;
+    XXH3_64bits_reset(&state);
+
+    for (const auto& instance : m_emissives.Instances())
+    {
+        // All the triangles of an instance share the same material. Descriptor table 
+        // offset depends on load order, so texture ID (hash of its path) is used instead.
+        const uint32_t emissiveTex = tris[instance.BaseTriOffset].GetTex();
+        const uint64_t texID = emissiveTex == Material::INVALID_ID ? Texture::INVALID_ID :
+            m_emissiveDescTable.FindID(emissiveTex);
+
+        const uint64_t data[] = { GetInstanceMeshID(instance.InstanceID), texID, 
+            instance.NumTriangles };
+        XXH3_64bits_update(&state, data, sizeof(data));
+
+        for (uint32_t t = instance.BaseTriOffset; t < instance.BaseTriOffset + instance.NumTriangles; t++)
+        {
+            const RT::EmissiveTriangle& tri = tris[t];
+            XXH3_64bits_update(&state, &tri.UV0, sizeof(tri.UV0) * 3);
+        }
+    }
+
+    return XXH3_64bits_digest(&state);
+}
+
 void SceneCore::ToggleEmissivesCallback(const Support::ParamVariant& p)
 {
     m_ignoreEmissives = !p.GetBool();
@@ -723,116 +1230,100 @@ void SceneCore::ToggleEmissivesCallback(const Support::ParamVariant& p)
 
 void SceneCore::InitWorldTransformations()
 {
-    const float4x3 I = float4x3(store(identity()));
+    // Levels are processed in order as every level depends on its parent level, but 
+    // instances within a level are independent
+    constexpr size_t MIN_INSTANCES_PER_CHUNK = 256;
 
     // No parent transformation for first level
-    for (size_t i = 0; i < m_sceneGraph[1].m_localTransforms.size(); i++)
-    {
-        AffineTransformation& tr = m_sceneGraph[1].m_localTransforms[i];
-        v_float4x4 vLocal = affineTransformation(tr.Scale, tr.Rotation, tr.Translation);
-        const uint64_t ID = m_sceneGraph[1].m_IDs[i];
-
-        // Set prev = new for 1st frame
-        m_sceneGraph[1].m_toWorlds[i] = float4x3(store(vLocal));
-        m_prevToWorlds[ID] = m_sceneGraph[1].m_toWorlds[i];
-    }
-
+    const float4x3 I = float4x3(store(identity()));
+    SmallVector<uint32_t, App::FrameAllocator> parentIdx;
     const size_t numLevels = m_sceneGraph.size();
 
-    for (size_t level = 1; level < numLevels - 1; ++level)
+    for (size_t level = 1; level < numLevels; level++)
     {
-        for (size_t i = 0; i < m_sceneGraph[level].m_subtreeRanges.size(); i++)
+        auto& currLevel = m_sceneGraph[level];
+        const size_t numInstances = currLevel.m_localTransforms.size();
+        if (numInstances == 0)
+            continue;
+
+        parentIdx.resize(numInstances);
+        const float4x3* parents = &I;
+
+        if (level == 1)
+            memset(parentIdx.data(), 0, numInstances * sizeof(uint32_t));
+        else
         {
-            const v_float4x4 vParentTr = load4x3(m_sceneGraph[level].m_toWorlds[i]);
-            const float4x3 P = float4x3(store(vParentTr));
-            const auto& range = m_sceneGraph[level].m_subtreeRanges[i];
+            const auto& parentLevel = m_sceneGraph[level - 1];
+            parents = parentLevel.m_toWorlds.data();
 
-            for (size_t j = range.Base; j < range.Base + range.Count; j++)
+            for (uint32_t i = 0; i < (uint32_t)parentLevel.m_subtreeRanges.size(); i++)
             {
-                AffineTransformation& tr = m_sceneGraph[level + 1].m_localTransforms[j];
-                v_float4x4 vLocal = affineTransformation(tr.Scale, tr.Rotation, tr.Translation);
-                // Bottom up transformation hierarchy
-                v_float4x4 newW = mul(vLocal, vParentTr);
-                const uint64_t ID = m_sceneGraph[level + 1].m_IDs[j];
-
-                // Set prev = new for 1st frame
-                m_sceneGraph[level + 1].m_toWorlds[j] = float4x3(store(newW));
-                m_prevToWorlds[ID] = m_sceneGraph[level + 1].m_toWorlds[j];
+                const auto& range = parentLevel.m_subtreeRanges[i];
+
+                for (size_t j = range.Base; j < range.Base + range.Count; j++)
+                    parentIdx[j] = i;
             }
         }
+
+        App::ParallelFor(numInstances, MIN_INSTANCES_PER_CHUNK, 
+            [&currLevel, parents, &parentIdx](size_t begin, size_t end)
+            {
+                size_t j = begin;
+
+                for (; j + 8 <= end; j += 8)
+                {
+                    ToWorld8(currLevel.m_localTransforms.data() + j, parents, 
+                        parentIdx.data() + j, currLevel.m_toWorlds.data() + j);
+                }
+
+                for (; j < end; j++)
+                {
+                    AffineTransformation& tr = currLevel.m_localTransforms[j];
+                    v_float4x4 vLocal = affineTransformation(tr.Scale, tr.Rotation, tr.Translation);
+                    const v_float4x4 vParentTr = load4x3(parents[parentIdx[j]]);
+                    // Bottom up transformation hierarchy
+                    v_float4x4 newW = mul(vLocal, vParentTr);
+
+                    currLevel.m_toWorlds[j] = float4x3(store(newW));
+                }
+            });
+
+        // Set prev = new for 1st frame
+        for (size_t j = 0; j < numInstances; j++)
+            m_prevToWorlds[currLevel.m_IDs[j]] = currLevel.m_toWorlds[j];
     }
 }
 
 void SceneCore::UpdateWorldTransformations(Vector<BVH::BVHUpdateInput, App::FrameAllocator>& toUpdateInstances)
 {
-    struct Entry
-    {
-        v_float4x4 W;
-        uint32_t TreeLevel;
-        uint32_t Base;
-        uint32_t Count;
-    };
-
-    SmallVector<Entry, App::FrameAllocator, 10> stack;
     const auto currFrame = App::GetTimer().GetTotalFrameCount();
 
-    // Can't append while iterating
-    SmallVector<uint64, App::FrameAllocator, 3> toAppend;
-
     for (auto it = m_instanceUpdates.begin_it(); it != m_instanceUpdates.end_it(); 
         it = m_instanceUpdates.next_it(it))
     {
-        const auto instance = it->Key;
-        const auto frame = it->Val;
-        const TreePos& p = FindTreePosFromID(instance).value();
-
         // -1 -> update was added at the tail end of last frame
-        if (frame < currFrame - 1)
+        if (it->Val < currFrame - 1)
         {
             // Mesh hasn't moved, just update previous transformation
-            m_prevToWorlds[instance] = m_sceneGraph[p.Level].m_toWorlds[p.Offset];
-            continue;
+            const TreePos p = FindTreePosFromID(it->Key).value();
+            m_prevToWorlds[it->Key] = m_sceneGraph[p.Level].m_toWorlds[p.Offset];
         }
+    }
 
-        // Grab current to world transformation
-        const float4x3& prevW = m_sceneGraph[p.Level].m_toWorlds[p.Offset];
-        v_float4x4 vW = load4x3(prevW);
-
-        float4a t;
-        float4a r;
-        float4a s;
-        decomposeSRT(vW, s, r, t);
-
-        // Apply the update
-        auto& delta = m_tempWorldTransformUpdates[instance];
-        float3 newTr = delta.Tr + t.xyz();
-        float3 newScale = delta.Scale * s.xyz();
-
-        v_float4x4 vR = rotationMatFromQuat(load(r));
+    // Accumulate the new (world-space) updates. Accumulated updates are applied every time 
+    // world transformation of an instance is recomputed from its local transformation.
+    for (auto it = m_tempWorldTransformUpdates.begin_it(); it != m_tempWorldTransformUpdates.end_it();
+        it = m_tempWorldTransformUpdates.next_it(it))
+    {
+        const auto instance = it->Key;
+        auto& delta = it->Val;
         v_float4x4 vNewR = load3x3(delta.Rotation);
-        vR = mul(vR, vNewR);
-
-        v_float4x4 vNewWorld = affineTransformation(vR, newScale, newTr);
 
         float3x3 R = float3x3(store(vNewR));
         Assert(fabsf(R.m[0].length() - 1) < 1e-5, "");
         Assert(fabsf(R.m[1].length() - 1) < 1e-5, "");
         Assert(fabsf(R.m[2].length() - 1) < 1e-5, "");
 
-        // Update previous & current transformations
-        m_prevToWorlds[instance] = prevW;
-        m_sceneGraph[p.Level].m_toWorlds[p.Offset] = float4x3(store(vNewWorld));
-        
-        // Add subtree to stack
-        if (const auto range = m_sceneGraph[p.Level].m_subtreeRanges[p.Offset]; range.Count)
-        {
-            stack.push_back(Entry{ .W = vNewWorld,
-                .TreeLevel = p.Level, 
-                .Base = range.Base, 
-                .Count = range.Count });
-        }
-
-        // Remember transformation update for future
         if (auto existingIt = m_worldTransformUpdates.find(instance); existingIt)
         {
             auto& curr = *existingIt.value();
@@ -854,23 +1345,56 @@ void SceneCore::UpdateWorldTransformations(Vector<BVH::BVHUpdateInput, App::Fram
         }
     }
 
-    while (!stack.empty())
+    m_tempWorldTransformUpdates.clear();
+
+    if (!m_hasDirtyTransforms)
+        return;
+
+    // Can't append while iterating
+    SmallVector<uint64, App::FrameAllocator> updated;
+
+    // Go through the dirty instances top-down, so that world transformation of parents is 
+    // final by the time their children are visited. Children of dirty instances are dirty 
+    // as well, so only subtrees that have changed are visited.
+    for (uint32_t level = 1; level < (uint32_t)m_sceneGraph.size(); level++)
     {
-        Entry e = stack.back();
-        stack.pop_back();
-        auto& currLevel = m_sceneGraph[e.TreeLevel + 1];
+        auto& currLevel = m_sceneGraph[level];
+        const auto& parentLevel = m_sceneGraph[level - 1];
 
-        for (size_t j = e.Base; j < e.Base + e.Count; j++)
-        {
-            Assert(RT_Flags::Decode(currLevel.m_rtFlags[j]).MeshMode ==
-                RT_MESH_MODE::DYNAMIC_NO_REBUILD, "Invalid scene graph.");
+        const size_t numDirty = currLevel.m_dirtyList.size();
+        if (numDirty == 0)
+            continue;
 
-            const uint64_t ID = m_sceneGraph[e.TreeLevel + 1].m_IDs[j];
-            toAppend.push_back(ID);
+        // Bottom up transformation hierarchy, computed for all the dirty instances of this 
+        // level at once
+        SmallVector<float4x3, App::FrameAllocator> locals;
+        SmallVector<float4x3, App::FrameAllocator> parentWorlds;
+        SmallVector<float4x3, App::FrameAllocator> newWorlds;
+        locals.resize(numDirty);
+        parentWorlds.resize(numDirty);
+        newWorlds.resize(numDirty);
 
+        for (size_t d = 0; d < numDirty; d++)
+        {
+            const uint32_t j = currLevel.m_dirtyList[d];
             AffineTransformation& local = currLevel.m_localTransforms[j];
-            v_float4x4 vLocal = affineTransformation(local.Scale, local.Rotation, local.Translation);
-            v_float4x4 vNewWorld = mul(vLocal, e.W);
+            locals[d] = float4x3(store(affineTransformation(local.Scale, local.Rotation, 
+                local.Translation)));
+            parentWorlds[d] = parentLevel.m_toWorlds[currLevel.m_parents[j]];
+        }
+
+        MulAffine(locals, parentWorlds, newWorlds);
+
+        // Children of this level's instances are added to next level's dirty list
+        for (size_t d = 0; d < numDirty; d++)
+        {
+            const uint32_t j = currLevel.m_dirtyList[d];
+            currLevel.m_dirtyFlags[j] = 0;
+
+            const uint64_t ID = currLevel.m_IDs[j];
+            updated.push_back(ID);
+
+            v_float4x4 vNewWorld = load4x3(newWorlds[d]);
 
             // If instance has had updates, apply them
             if (auto updateIt = m_worldTransformUpdates.find(ID); updateIt)
@@ -893,137 +1417,384 @@ void SceneCore::UpdateWorldTransformations(Vector<BVH::BVHUpdateInput, App::Fram
             m_prevToWorlds[ID] = currLevel.m_toWorlds[j];
             currLevel.m_toWorlds[j] = float4x3(store(vNewWorld));
 
-            // Add subtree to stack
+            // Mark subtree
             if (const auto& subtree = currLevel.m_subtreeRanges[j]; subtree.Count)
             {
-                stack.push_back(Entry{ .W = vNewWorld,
-                    .TreeLevel = e.TreeLevel + 2,
-                    .Base = subtree.Base,
-                    .Count = subtree.Count });
+                for (uint32_t c = subtree.Base; c < subtree.Base + subtree.Count; c++)
+                {
+                    Assert(RT_Flags::Decode(m_sceneGraph[level + 1].m_rtFlags[c]).MeshMode ==
+                        RT_MESH_MODE::DYNAMIC_NO_REBUILD, "Invalid scene graph.");
+
+                    MarkTransformDirty(level + 1, c);
+                }
             }
         }
+
+        currLevel.m_dirtyList.clear();
     }
 
-    m_tempWorldTransformUpdates.clear();
-    
-    for(auto id : toAppend)
-        m_instanceUpdates[id] = App::GetTimer().GetTotalFrameCount() - 1;
+    m_hasDirtyTransforms = false;
+
+    for(auto id : updated)
+        m_instanceUpdates[id] = currFrame - 1;
 }
 
-void SceneCore::UpdateEmissivePositions()
+void SceneCore::AddEmissivePositionUpdate(uint64_t instanceID)
 {
-    auto tris = m_emissives.Triagnles();
-    auto triInitialPos = m_emissives.InitialTriPositions();
+    const auto& emissiveInstance = *m_emissives.FindInstance(instanceID).value();
+    const float4x3& M = GetToWorld(instanceID);
+
+    RT::EmissivePositionUpdate u;
+
+    for (int j = 0; j < 4; j++)
+        u.M[j] = M.m[j];
+
+    u.BaseTriOffset = emissiveInstance.BaseTriOffset;
+    u.NumTriangles = emissiveInstance.NumTriangles;
+    // Dynamic instances have geometry index = 0
+    u.RtInstanceID = GetInstanceRtASInfo(instanceID).InstanceID;
 
-    uint32_t minIdx = (uint32_t)tris.size() - 1;
-    uint32_t maxIdx = 0;
+    m_emissivePosUpdates.push_back(u);
+}
+
+void SceneCore::EraseExpiredInstanceUpdates()
+{
+    const auto currFrame = App::GetTimer().GetTotalFrameCount();
 
     for (auto it = m_instanceUpdates.begin_it(); it != m_instanceUpdates.end_it();
         it = m_instanceUpdates.next_it(it))
     {
-        auto instance = it->Key;
-        const auto& emissiveInstance = *m_emissives.FindInstance(instance).value();
-        const v_float4x4 vW = load4x3(GetToWorld(instance));
-        const auto rtASInfo = GetInstanceRtASInfo(instance);
+        // Runs at the start of the frame, before TLAS has consumed this frame's updates,
+        // hence the extra frame. Sequence of actions for world transfrom update from 
+        // frame T to W_new:
+        // T: Update was added at the tail end of frame
+        // T + 1: Scene and RT transforms are updated to W_new, prev transform is changed to W_old
+        // T + 2: Prev transform in scene and then mesh instance buffer are updated to W_new. Motion
+        //        vectors become zero again.
+        if (it->Val + 3 < currFrame)
+            m_instanceUpdates.erase(it->Key);
+    }
+}
 
-        for (size_t t = emissiveInstance.BaseTriOffset; 
-            t < emissiveInstance.BaseTriOffset + emissiveInstance.NumTriangles; t++)
-        {
-            EmissiveBuffer::Triangle& initTri = triInitialPos[t];
-
-            __m128 vV0;
-            __m128 vV1;
-            __m128 vV2;
-            RT::EmissiveTriangle::DecodeVertices(initTri.Vtx0, initTri.V0V1, initTri.V0V2,
-                initTri.EdgeLengths,
-                vV0, vV1, vV2);
-
-            vV0 = mul(vW, vV0);
-            vV1 = mul(vW, vV1);
-            vV2 = mul(vW, vV2);
-            tris[t].StoreVertices(vV0, vV1, vV2);
-
-            // Dynamic instances have geometry index = 0
-            const uint32_t hash = Pcg3d(uint3(0,
-                rtASInfo.InstanceID,
-                initTri.PrimIdx)).x;
-            tris[t].ID = hash;
-        }
+void SceneCore::PublishRenderSnapshot()
+{
+    const auto currFrame = App::GetTimer().GetTotalFrameCount();
+    const int writeIdx = 1 - m_renderSnapshotIdx.load(std::memory_order_relaxed);
+    RenderSnapshot& snapshot = m_renderSnapshots[writeIdx];
 
-        minIdx = Min(minIdx, emissiveInstance.BaseTriOffset);
-        maxIdx = Max(maxIdx, emissiveInstance.BaseTriOffset + emissiveInstance.NumTriangles);
+    snapshot.FrameIdx = currFrame;
+    snapshot.InstancesUpdated = false;
+    snapshot.InstanceUpdates.clear();
+    snapshot.InstanceUpdates.reserve(m_instanceUpdates.size());
+
+    for (auto it = m_instanceUpdates.begin_it(); it != m_instanceUpdates.end_it();
+        it = m_instanceUpdates.next_it(it))
+    {
+        const TreePos p = FindTreePosFromID(it->Key).value();
+        const auto& treeLevel = m_sceneGraph[p.Level];
+
+        snapshot.InstanceUpdates.push_back(RenderSnapshot::InstanceUpdate{
+            .ID = it->Key,
+            .Frame = it->Val,
+            .TreeLevel = p.Level,
+            .LevelIdx = p.Offset,
+            .ToWorld = treeLevel.m_toWorlds[p.Offset],
+            .PrevToWorld = *GetPrevToWorld(it->Key).value(),
+            .RtFlags = treeLevel.m_rtFlags[p.Offset] });
+
+        // Updates from the oldest frame are still needed by TLAS, but render passes 
+        // already consider the instance to be stationary
+        snapshot.InstancesUpdated = snapshot.InstancesUpdated || (it->Val + 2 >= currFrame);
     }
 
-    Assert(minIdx <= maxIdx, "Invalid indices.");
-    m_emissives.UpdateTriPositions(minIdx, maxIdx);
+    snapshot.ChangedEmissives.clear();
+    snapshot.ChangedEmissives.append_range(m_changedEmissives.begin(), m_changedEmissives.end());
+    snapshot.EmissivePosUpdates.clear();
+    snapshot.EmissivePosUpdates.append_range(m_emissivePosUpdates.begin(), 
+        m_emissivePosUpdates.end());
+    snapshot.EmissivePositionsUpdated = m_emissivePositionsUpdated;
+
+    m_renderSnapshotIdx.store(writeIdx, std::memory_order_release);
 }
 
-void SceneCore::UpdateAnimations(float t, Vector<AnimationUpdate, App::FrameAllocator>& animVec)
+void SceneCore::UpdateEmissivePositions(bool moved)
 {
-    for (auto& anim : m_animationMetadata)
+    // Material changes are uploaded from the CPU copy, which only has the positions from
+    // the initial build. Instances that could've moved since then are transformed again.
+    for (auto instance : m_changedEmissives)
     {
-        AffineTransformation vRes;
+        if (GetInstanceRtFlags(instance).MeshMode != RT_MESH_MODE::STATIC)
+            AddEmissivePositionUpdate(instance);
+    }
+
+    if (!moved)
+        return;
 
-        const Keyframe& kStart = m_keyframes[anim.StartOffset];
-        const Keyframe& kEnd = m_keyframes[anim.StartOffset + anim.Length - 1];
-        const float t_start = anim.T0;
+    const auto currFrame = App::GetTimer().GetTotalFrameCount();
+
+    for (auto it = m_instanceUpdates.begin_it(); it != m_instanceUpdates.end_it();
+        it = m_instanceUpdates.next_it(it))
+    {
+        // Only previous transform was updated (same check as UpdateWorldTransformations())
+        if (it->Val < currFrame - 1)
+            continue;
+
+        const auto instance = it->Key;
+        if (!m_emissives.FindInstance(instance))
+            continue;
+
+        AddEmissivePositionUpdate(instance);
+        m_changedEmissives.push_back(instance);
+    }
+}
 
-        // Fast paths
-        if (t <= kStart.Time + t_start)
+void SceneCore::PredictTextureUsage()
+{
+    uint32_t predicted[TEX_FEEDBACK_NUM_ENTRIES] = { 0 };
+    float coverage[TEX_FEEDBACK_NUM_ENTRIES] = { 0 };
+
+    const Camera& camera = App::GetCamera();
+    const float renderWidth = (float)App::GetRenderer().GetRenderWidth();
+    const float renderHeight = (float)App::GetRenderer().GetRenderHeight();
+    const float tanHalfFOV = camera.GetTanHalfFOV();
+    const float aspectRatio = camera.GetAspectRatio();
+    // Half angle of the cone that encloses the view frustum
+    const float halfConeAngle = atanf(tanHalfFOV * sqrtf(1.0f + aspectRatio * aspectRatio));
+    const uint32_t frame = (uint32_t)App::GetTimer().GetTotalFrameCount() & TEX_FEEDBACK_FRAME_MASK;
+
+    // Current pose is included, so that what's visible right now is prioritized as well
+    constexpr int NUM_POSES = NUM_PREDICTED_CAMERA_POSES + 1;
+    float3 pos[NUM_POSES];
+    float3 viewDir[NUM_POSES];
+    pos[0] = camera.GetPos();
+    viewDir[0] = camera.GetBasisZ();
+
+    for (int p = 1; p < NUM_POSES; p++)
+    {
+        pos[p] = camera.GetPredictedPos(p - 1);
+        viewDir[p] = camera.GetPredictedViewDir(p - 1);
+    }
+
+    auto record = [&predicted, &coverage, frame](uint32_t tex, uint32_t tableSize,
+        uint32_t feedbackOffset, uint32_t log2Width, float c)
         {
-            vRes = kStart.Transform;
-        }
-        else if (!anim.Loop && t >= kEnd.Time + t_start)
+            // Slots past the initial descriptor table sizes don't have feedback entries 
+            // (INVALID_ID is out of range as well)
+            if (tex >= tableSize)
+                return;
+
+            const uint32_t value = (frame << TEX_FEEDBACK_NUM_VALUE_BITS) | log2Width;
+            predicted[feedbackOffset + tex] = Max(predicted[feedbackOffset + tex], value);
+            coverage[feedbackOffset + tex] = Min(coverage[feedbackOffset + tex] + c, 1.0f);
+        };
+
+    // Loading threads might be adding materials
+    AcquireSRWLockShared(&m_matLock);
+
+    for (size_t treeLevelIdx = 1; treeLevelIdx < m_sceneGraph.size(); treeLevelIdx++)
+    {
+        const auto& currTreeLevel = m_sceneGraph[treeLevelIdx];
+
+        for (size_t i = 0; i < currTreeLevel.m_meshIDs.size(); i++)
         {
-            vRes = kEnd.Transform;
+            const uint64_t meshID = currTreeLevel.m_meshIDs[i];
+            if (meshID == Scene::INVALID_MESH)
+                continue;
+
+            const TriangleMesh* mesh = m_meshes.GetMesh(meshID).value();
+            auto mat = m_matBuffer.Get(mesh->m_materialID);
+            if (!mat)
+                continue;
+
+            const AABB box = store(transform(load4x3(currTreeLevel.m_toWorlds[i]),
+                v_AABB(mesh->m_AABB)));
+            const float r = box.Extents.length();
+            float maxDiameter = 0.0f;
+            float maxCoverage = 0.0f;
+
+            // Bounding sphere against each pose
+            for (int p = 0; p < NUM_POSES; p++)
+            {
+                const float3 toBox = box.Center - pos[p];
+                const float d = toBox.length();
+                // Camera is inside, could be right next to any part of it
+                float diameter = Max(renderWidth, renderHeight);
+
+                if (d > r)
+                {
+                    const float cosTheta = Min(Max(toBox.dot(viewDir[p]) / d, -1.0f), 1.0f);
+                    if (acosf(cosTheta) > halfConeAngle + asinf(r / d))
+                        continue;
+
+                    // Projected diameter in pixels
+                    diameter = r * renderHeight / (d * tanHalfFOV);
+                }
+
+                maxDiameter = Max(maxDiameter, diameter);
+                maxCoverage = Max(maxCoverage, Min(0.25f * PI * diameter * diameter / 
+                    (renderWidth * renderHeight), 1.0f));
+            }
+
+            if (maxDiameter == 0.0f)
+                continue;
+
+            // Assumes that textures are mapped once across the instance, so that the 
+            // needed width is about its projected size. Tiled textures are refined by 
+            // feedback once they're visible.
+            const uint32_t log2Width = (uint32_t)Min(Max(ceilf(log2f(maxDiameter)), 0.0f), 
+                (float)TEX_FEEDBACK_VALUE_MASK);
+            const Material* m = mat.value();
+
+            record(m->GetBaseColorTex(), BASE_COLOR_DESC_TABLE_SIZE, TEX_FEEDBACK_BASE_COLOR_OFFSET,
+                log2Width, maxCoverage);
+            record(m->GetNormalTex(), NORMAL_DESC_TABLE_SIZE, TEX_FEEDBACK_NORMAL_OFFSET,
+                log2Width, maxCoverage);
+            record(m->GetMetallicRoughnessTex(), METALLIC_ROUGHNESS_DESC_TABLE_SIZE, 
+                TEX_FEEDBACK_METALLIC_ROUGHNESS_OFFSET, log2Width, maxCoverage);
+            record(m->GetEmissiveTex(), EMISSIVE_DESC_TABLE_SIZE, TEX_FEEDBACK_EMISSIVE_OFFSET,
+                log2Width, maxCoverage);
         }
-        else
+    }
+
+    ReleaseSRWLockShared(&m_matLock);
+
+    m_texStreamer.OnPrediction(Span(predicted, TEX_FEEDBACK_NUM_ENTRIES), 
+        Span(coverage, TEX_FEEDBACK_NUM_ENTRIES));
+}
+
+void SceneCore::UpdateAnimations(float t, Vector<AnimationUpdate, App::FrameAllocator>& animVec)
+{
+    constexpr size_t MIN_ANIMATIONS_PER_CHUNK = 64;
+    const size_t numAnims = m_animationMetadata.size();
+    animVec.resize(numAnims);
+
+    App::ParallelFor(numAnims, MIN_ANIMATIONS_PER_CHUNK, [this, t, &animVec](size_t begin, size_t end)
         {
-            if (t >= kEnd.Time + t_start)
+            const float* scales = reinterpret_cast<const float*>(m_keyframeScales.data());
+            const float* rotations = reinterpret_cast<const float*>(m_keyframeRotations.data());
+            const float* translations = reinterpret_cast<const float*>(m_keyframeTranslations.data());
+
+            // Interpolate four animations at a time, each one in a different lane
+            for (size_t i = begin; i < end; i += 4)
             {
-                float numLoops = floorf((t - kStart.Time) / (kEnd.Time - kStart.Time));
-                float excess = numLoops * (kEnd.Time - kStart.Time) + kStart.Time;
-                t -= excess;
-                t += kStart.Time;
-            }
+                const int n = (int)Min(end - i, 4llu);
+                uint32_t k1[4];
+                uint32_t k2[4];
+                alignas(16) float interpolatedT[4];
 
-            auto idx = FindInterval(Span(m_keyframes), t, [](const Keyframe& k) { return k.Time; },
-                anim.StartOffset,
-                anim.StartOffset + anim.Length - 1);
+                // Unused lanes repeat the first one
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    k1[lane] = SampleKeyframes(m_animationMetadata[i + (lane < n ? lane : 0)], t, 
+                        interpolatedT[lane]);
+                    k2[lane] = k1[lane] + 1;
+                }
 
-            Assert(idx != -1, "FindInterval() unexpectedly failed.");
-            Keyframe& k1 = m_keyframes[idx];
-            Keyframe& k2 = m_keyframes[idx + 1];
+                const __m128 vT = _mm_load_ps(interpolatedT);
 
-            Assert(t >= k1.Time + t_start && t <= k2.Time + t_start, "bug");
-            Assert(k1.Time < k2.Time, "divide-by-zero");
+                // Scale & translation
+                __m128 vS[3];
+                __m128 vTr[3];
 
-            float interpolatedT = (t - (k1.Time + t_start)) / (k2.Time - k1.Time);
+                for (int c = 0; c < 3; c++)
+                {
+                    vS[c] = lerp(Gather4(scales + c, k1, 3), Gather4(scales + c, k2, 3), vT);
+                    vTr[c] = lerp(Gather4(translations + c, k1, 3), Gather4(translations + c, k2, 3), vT);
+                }
 
-            // Scale
-            const __m128 vScale1 = loadFloat3(k1.Transform.Scale);
-            const __m128 vScale2 = loadFloat3(k2.Transform.Scale);
-            const __m128 vScaleInt = lerp(vScale1, vScale2, interpolatedT);
+                // Rotation
+                __m128 vQ1[4];
+                __m128 vQ2[4];
 
-            // Translation
-            const __m128 vTranslate1 = loadFloat3(k1.Transform.Translation);
-            const __m128 vTranslate2 = loadFloat3(k2.Transform.Translation);
-            const __m128 vTranslateInt = lerp(vTranslate1, vTranslate2, interpolatedT);
+                for (int c = 0; c < 4; c++)
+                {
+                    vQ1[c] = Gather4(rotations + c, k1, 4);
+                    vQ2[c] = Gather4(rotations + c, k2, 4);
+                }
 
-            // Rotation
-            const __m128 vRot1 = loadFloat4(k1.Transform.Rotation);
-            const __m128 vRot2 = loadFloat4(k2.Transform.Rotation);
-            const __m128 vRotInt = slerp(vRot1, vRot2, interpolatedT);
+                __m128 vQ[4];
+                Slerp4(vQ1, vQ2, vT, vQ);
 
-            vRes.Scale = storeFloat3(vScaleInt);
-            vRes.Rotation = storeFloat4(vRotInt);
-            vRes.Translation = storeFloat3(vTranslateInt);
+                alignas(16) float s[3][4];
+                alignas(16) float tr[3][4];
+                alignas(16) float q[4][4];
+
+                for (int c = 0; c < 3; c++)
+                {
+                    _mm_store_ps(s[c], vS[c]);
+                    _mm_store_ps(tr[c], vTr[c]);
+                }
+
+                for (int c = 0; c < 4; c++)
+                    _mm_store_ps(q[c], vQ[c]);
+
+                for (int lane = 0; lane < n; lane++)
+                {
+                    AnimationUpdate& u = animVec[i + lane];
+                    u.M.Scale = float3(s[0][lane], s[1][lane], s[2][lane]);
+                    u.M.Rotation = float4(q[0][lane], q[1][lane], q[2][lane], q[3][lane]);
+                    u.M.Translation = float3(tr[0][lane], tr[1][lane], tr[2][lane]);
+                    u.InstanceID = m_animationMetadata[i + lane].InstanceID;
+                }
+            }
+        });
+}
+
+uint32_t SceneCore::SampleKeyframes(AnimationMetadata& anim, float t, float& interpolatedT)
+{
+    const uint32_t first = anim.StartOffset;
+    const uint32_t last = anim.StartOffset + anim.Length - 1;
+    const float tStart = m_keyframeTimes[first];
+    const float tEnd = m_keyframeTimes[last];
+
+    // Keyframe times are relative to the start of animation
+    float localT = t - anim.T0;
+
+    // Fast paths
+    if (localT <= tStart)
+    {
+        interpolatedT = 0.0f;
+        return first;
+    }
+
+    if (localT >= tEnd)
+    {
+        if (!anim.Loop)
+        {
+            interpolatedT = 1.0f;
+            return last - 1;
         }
 
-        animVec.push_back(AnimationUpdate{
-            .M = vRes,
-            .InstanceID = anim.InstanceID });
+        localT = tStart + fmodf(localT - tStart, tEnd - tStart);
+    }
+
+    // Playback is sequential, so the cached interval or the one right after it almost
+    // always contain the given time
+    uint32_t k = first + anim.CurrKeyframe;
+    auto contains = [this, last, localT](uint32_t i)
+        {
+            return i < last && m_keyframeTimes[i] <= localT && localT < m_keyframeTimes[i + 1];
+        };
+
+    if (!contains(k))
+    {
+        if (contains(k + 1))
+            k++;
+        else
+        {
+            const int64_t idx = FindInterval(Span(m_keyframeTimes), localT, [](float time) { return time; },
+                first, last);
+            k = idx != -1 ? (uint32_t)idx : first;
+        }
     }
+
+    anim.CurrKeyframe = k - first;
+
+    Assert(m_keyframeTimes[k] < m_keyframeTimes[k + 1], "divide-by-zero");
+    interpolatedT = (localT - m_keyframeTimes[k]) / (m_keyframeTimes[k + 1] - m_keyframeTimes[k]);
+    interpolatedT = Min(Max(interpolatedT, 0.0f), 1.0f);
+
+    return k;
 }
 
 void SceneCore::UpdateLocalTransforms(Span<AnimationUpdate> animVec)
@@ -1032,6 +1803,7 @@ void SceneCore::UpdateLocalTransforms(Span<AnimationUpdate> animVec)
     {
         TreePos t = FindTreePosFromID(update.InstanceID).value();
         m_sceneGraph[t.Level].m_localTransforms[t.Offset] = update.M;
+        MarkTransformDirty(t.Level, t.Offset);
     }
 }
 
@@ -1084,42 +1856,101 @@ void SceneCore::AnimateCallback(const ParamVariant& p)
     m_animate = !p.GetBool();
 }
 
-void SceneCore::ClearPick()
+void SceneCore::ToggleMeshLODsCallback(const ParamVariant& p)
 {
-    m_rendererInterface.ClearPick();
+    m_meshLODs = p.GetBool();
+}
 
-    AcquireSRWLockExclusive(&m_pickLock);
-    m_pickedInstances.clear();
-    ReleaseSRWLockExclusive(&m_pickLock);
+void SceneCore::ToggleHotReloadCallback(const ParamVariant& p)
+{
+    glTF::HotReload::Enable(p.GetBool());
 }
 
-void SceneCore::SetPickedInstance(uint64 instanceID)
+void SceneCore::ToggleTexturePrefetchCallback(const ParamVariant& p)
+{
+    m_texPrefetch = p.GetBool();
+
+    // Clear the last prediction so that it doesn't affect stream-in order anymore
+    if (!m_texPrefetch)
+    {
+        uint32_t predicted[TEX_FEEDBACK_NUM_ENTRIES] = { 0 };
+        float coverage[TEX_FEEDBACK_NUM_ENTRIES] = { 0 };
+        m_texStreamer.OnPrediction(Span(predicted, TEX_FEEDBACK_NUM_ENTRIES), 
+            Span(coverage, TEX_FEEDBACK_NUM_ENTRIES));
+    }
+}
+
+void SceneCore::OnMemoryPressure(GpuMemory::MEMORY_PRESSURE p)
 {
-    AcquireSRWLockExclusive(&m_pickLock);
+    // Scene textures are demoted first -- sampling them from system memory is slower, but
+    // still better than paging render targets and acceleration structures that are 
+    // accessed multiple times every frame
+    const D3D12_RESIDENCY_PRIORITY priority = p == GpuMemory::MEMORY_PRESSURE::NONE ?
+        D3D12_RESIDENCY_PRIORITY_NORMAL : D3D12_RESIDENCY_PRIORITY_LOW;
 
-    if (!m_multiPick)
+    AcquireSRWLockExclusive(&m_textureHeapLock);
+
+    if (priority != m_textureHeapPriority)
     {
-        m_pickedInstances.resize(1);
-        m_pickedInstances[0] = instanceID;
+        SmallVector<ID3D12Pageable*, SystemAllocator, 8> heaps;
+        for (auto& heap : m_textureHeaps)
+            heaps.push_back(heap.Heap());
+
+        GpuMemory::SetResidencyPriority(heaps, priority);
+        m_textureHeapPriority = priority;
     }
-    else
+
+    ReleaseSRWLockExclusive(&m_textureHeapLock);
+}
+
+void SceneCore::AddTextureHeap(GpuMemory::ResourceHeap&& heap)
+{
+    AcquireSRWLockExclusive(&m_textureHeapLock);
+
+    // Match the heaps that were added before
+    if (m_textureHeapPriority != D3D12_RESIDENCY_PRIORITY_NORMAL)
     {
-        // NOTE usually there aren't more than a few objects picked
-        // at the same time, so linear search should be fine
-        bool found = false;
-        for (size_t i = 0; i < m_pickedInstances.size(); i++)
+        ID3D12Pageable* h = heap.Heap();
+        GpuMemory::SetResidencyPriority(Span<ID3D12Pageable*>(&h, 1), m_textureHeapPriority);
+    }
+
+    m_textureHeaps.push_back(ZetaMove(heap));
+
+    ReleaseSRWLockExclusive(&m_textureHeapLock);
+}
+
+void SceneCore::ClearPick()
+{
+    m_rendererInterface.ClearPick();
+    m_pickedInstances.Update([](PickList& picks)
         {
-            if (m_pickedInstances[i] == instanceID)
+            picks.clear();
+        });
+}
+
+void SceneCore::SetPickedInstance(uint64 instanceID)
+{
+    m_pickedInstances.Update([instanceID, multiPick = m_multiPick](PickList& picks)
+        {
+            if (!multiPick)
             {
-                m_pickedInstances.erase_at_index(i);
-                found = true;
-                break;
+                picks.resize(1);
+                picks[0] = instanceID;
+
+                return;
             }
-        }
 
-        if(!found)
-            m_pickedInstances.push_back(instanceID);
-    }
+            // NOTE usually there aren't more than a few objects picked
+            // at the same time, so linear search should be fine
+            for (size_t i = 0; i < picks.size(); i++)
+            {
+                if (picks[i] == instanceID)
+                {
+                    picks.erase_at_index(i);
+                    return;
+                }
+            }
 
-    ReleaseSRWLockExclusive(&m_pickLock);
+            picks.push_back(instanceID);
+        });
 }
@@ -2,10 +2,12 @@
 
 #include "../Math/BVH.h"
 #include "Asset.h"
+#include "TextureStreamer.h"
 #include "SceneRenderer.h"
 #include "SceneCommon.h"
 #include "../Utility/Utility.h"
 #include "../Utility/SynchronizedView.h"
+#include "../Utility/ConcurrentHashTable.h"
 #include <xxHash/xxhash.h>
 #include <atomic>
 
@@ -99,6 +101,14 @@ namespace ZetaRay::Scene
 
         return meshFromSceneID;
     }
+
+    ZetaInline uint64_t MeshLODID(uint64_t meshID, int lod)
+    {
+        StackStr(str, n, "mesh_%llu_lod_%d", meshID, lod);
+        uint64_t lodID = XXH3_64bits(str, n);
+
+        return lodID;
+    }
 }
 
 namespace ZetaRay::Scene
@@ -120,6 +130,51 @@ namespace ZetaRay::Scene
         void Init(Renderer::Interface& rendererInterface);
         void Pause() { m_isPaused = true; }
         void Resume() { m_isPaused = false; }
+        // While there are loads in progress, scene data may be modified by the loading 
+        // threads at any time, so updates are deferred until every load has finished. 
+        // The loaded data is then picked up at the next frame boundary. Must be called 
+        // from the main thread.
+        void BeginLoad()
+        {
+            m_numPendingLoads.fetch_add(1, std::memory_order_relaxed);
+            m_loadInProgress = true;
+        }
+        void EndLoad() { m_numPendingLoads.fetch_sub(1, std::memory_order_release); }
+        // Stays the same for the duration of a frame
+        ZetaInline bool IsLoading() const { return m_loadInProgress; }
+        // Per-frame scene changes that render-side code (TLAS, lighting passes) consumes. 
+        // Captured once the scene update tasks have finished. Double buffered, so that 
+        // render-side reads don't alias the structures that the next frame's simulation 
+        // writes to.
+        struct RenderSnapshot
+        {
+            struct InstanceUpdate
+            {
+                uint64_t ID;
+                // Same as the value in m_instanceUpdates
+                uint64_t Frame;
+                uint32_t TreeLevel;
+                uint32_t LevelIdx;
+                Math::float4x3 ToWorld;
+                Math::float4x3 PrevToWorld;
+                uint8_t RtFlags;
+            };
+
+            Util::SmallVector<InstanceUpdate> InstanceUpdates;
+            Util::SmallVector<uint64_t> ChangedEmissives;
+            Util::SmallVector<RT::EmissivePositionUpdate> EmissivePosUpdates;
+            uint64_t FrameIdx = 0;
+            bool InstancesUpdated = false;
+            bool EmissivePositionsUpdated = false;
+        };
+
+        ZetaInline const RenderSnapshot& GetRenderSnapshot() const
+        {
+            return m_renderSnapshots[m_renderSnapshotIdx.load(std::memory_order_acquire)];
+        }
+        // Whether any instance has moved recently (updates expire once they've reached TLAS 
+        // and previous frame's transforms)
+        ZetaInline bool AreInstancesUpdated() const { return GetRenderSnapshot().InstancesUpdated; }
         void OnWindowSizeChanged();
         void Shutdown();
 
@@ -135,19 +190,30 @@ namespace ZetaRay::Scene
             Util::SmallVector<Core::Vertex>&& vertices,
             Util::SmallVector<uint32_t>&& indices,
             bool lock = true);
+        // Frees the mesh's ranges in the scene vertex and index buffers for meshes that 
+        // are added later. No instance should be referencing it anymore.
+        void RemoveMesh(uint64_t id, bool lock = true);
         ZetaInline Util::Optional<const Model::TriangleMesh*> GetMesh(uint64_t id) const
         {
             return m_meshes.GetMesh(id);
         }
         ZetaInline Util::Optional<const Model::TriangleMesh*> GetInstanceMesh(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            const TreePos p = FindTreePosFromID(id).value();
             const uint64_t meshID = m_sceneGraph[p.Level].m_meshIDs[p.Offset];
 
             return m_meshes.GetMesh(meshID);
         }
+        // Including the mesh itself
+        ZetaInline uint32_t GetMeshNumLODs(uint64_t id) const { return m_meshes.NumLODs(id); }
+        ZetaInline uint64_t GetMeshLODID(uint64_t id, uint32_t lod) const { return m_meshes.LODMeshID(id, lod); }
+        void ToggleMeshLODsCallback(const Support::ParamVariant& p);
+        void ToggleHotReloadCallback(const Support::ParamVariant& p);
+        void ToggleTexturePrefetchCallback(const Support::ParamVariant& p);
         ZetaInline const Core::GpuMemory::Buffer& GetMeshVB() { return m_meshes.GetVB(); }
         ZetaInline const Core::GpuMemory::Buffer& GetMeshIB() { return m_meshes.GetIB(); }
+        ZetaInline const Core::GpuMemory::Buffer& GetMeshQuantTransforms() { return m_meshes.GetQuantTransforms(); }
+        ZetaInline uint64_t GetMeshContentHash() const { return m_meshes.ContentHash(); }
 
         //
         // Material
@@ -160,8 +226,28 @@ namespace ZetaRay::Scene
             return m_matBuffer.Get(ID, bufferIdx);
         }
         void UpdateMaterial(uint32 ID, const Material& newMat);
+        // Frees the material's slot in the material buffer and releases its textures.
+        // Textures that no other material references are evicted from their descriptor 
+        // tables. No instance should be referencing it anymore.
+        void RemoveMaterial(uint32_t ID, bool lock = true);
+        // Replaces the material's properties and textures in place (hot reload). Textures 
+        // that aren't in the descriptor tables yet are taken from "textures", which must be 
+        // sorted by ID.
+        void ReloadMaterial(const Model::glTF::Asset::MaterialDesc& mat,
+            Util::MutableSpan<Core::GpuMemory::Texture> textures);
+        // Streams in the given texture again after it was modified on disk
+        void ReloadTexture(const Internal::TextureStreamer::TextureDesc& desc);
         void ResizeAdditionalMaterials(uint32_t num);
-        ZetaInline void AddTextureHeap(Core::GpuMemory::ResourceHeap&& heap) { m_textureHeaps.push_back(ZetaForward(heap)); }
+        void AddTextureHeap(Core::GpuMemory::ResourceHeap&& heap);
+        // For textures that were loaded with only their lower-resolution mips
+        ZetaInline void AddStreamingTexture(const Internal::TextureStreamer::TextureDesc& desc)
+        {
+            m_texStreamer.Add(desc);
+        }
+        ZetaInline void OnTextureFeedbackReadback(Util::Span<uint8_t> data)
+        {
+            m_texStreamer.OnFeedbackReadback(data);
+        }
 
         ZetaInline uint32_t GetBaseColMapsDescHeapOffset() const { return m_baseColorDescTable.GPUDescriptorHeapIndex(); }
         ZetaInline uint32_t GetNormalMapsDescHeapOffset() const { return m_normalDescTable.GPUDescriptorHeapIndex(); }
@@ -182,7 +268,7 @@ namespace ZetaRay::Scene
         }
         ZetaInline const Math::float4x3& GetToWorld(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            const TreePos p = FindTreePosFromID(id).value();
             return m_sceneGraph[p.Level].m_toWorlds[p.Offset];
         }
         ZetaInline Math::AffineTransformation GetLocalTransform(uint64_t id) const
@@ -195,23 +281,23 @@ namespace ZetaRay::Scene
         }
         ZetaInline const Math::AABB& GetAABB(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            const TreePos p = FindTreePosFromID(id).value();
             const uint64_t meshID = m_sceneGraph[p.Level].m_meshIDs[p.Offset];
             return m_meshes.GetMesh(meshID).value()->m_AABB;
         }
         ZetaInline uint64_t GetInstanceMeshID(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            const TreePos p = FindTreePosFromID(id).value();
             return m_sceneGraph[p.Level].m_meshIDs[p.Offset];
         }
         ZetaInline RT_AS_Info GetInstanceRtASInfo(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            const TreePos p = FindTreePosFromID(id).value();
             return m_sceneGraph[p.Level].m_rtASInfo[p.Offset];
         }
         ZetaInline RT_Flags GetInstanceRtFlags(uint64_t id) const
         {
-            const TreePos& p = FindTreePosFromID(id).value();
+            const TreePos p = FindTreePosFromID(id).value();
             return RT_Flags::Decode(m_sceneGraph[p.Level].m_rtFlags[p.Offset]);
         }
         ZetaInline uint64_t GetIDFromRtMeshIdx(uint32 idx) const
@@ -227,12 +313,37 @@ namespace ZetaRay::Scene
         //
         void AddEmissives(Util::SmallVector<Model::glTF::Asset::EmissiveInstance>&& emissiveInstances,
             Util::SmallVector<RT::EmissiveTriangle>&& emissiveTris, bool lock);
-        ZetaInline bool EmissiveLighting() const { return !m_ignoreEmissives && (m_emissives.NumInstances() > 0); }
-        ZetaInline size_t NumEmissiveInstances() const { return m_emissives.NumInstances(); }
-        ZetaInline size_t NumEmissiveTriangles() const { return m_emissives.NumTriangles(); }
+        ZetaInline bool EmissiveLighting() const { return !m_ignoreEmissives && (NumEmissiveInstances() > 0); }
+        ZetaInline size_t NumEmissiveInstances() const { return IsLoading() ? 0 : m_emissives.NumInstances(); }
+        ZetaInline size_t NumEmissiveTriangles() const { return IsLoading() ? 0 : m_emissives.NumTriangles(); }
         ZetaInline bool AreEmissivePositionsStale() const { return m_staleEmissivePositions; }
         ZetaInline bool AreEmissiveMaterialsStale() const { return m_staleEmissiveMats; }
+        // Whether emissive triangle positions were updated this frame
+        ZetaInline bool AreEmissivePositionsUpdated() const 
+        { 
+            return GetRenderSnapshot().EmissivePositionsUpdated; 
+        }
+        // Emissive instances that moved or whose material changed this frame
+        ZetaInline Util::Span<uint64_t> ChangedEmissiveInstances() const 
+        { 
+            return GetRenderSnapshot().ChangedEmissives; 
+        }
+        // Emissive instances whose triangles have to be transformed on the GPU this frame
+        // (see PreLighting)
+        ZetaInline Util::Span<RT::EmissivePositionUpdate> EmissivePositionUpdates() const 
+        { 
+            return GetRenderSnapshot().EmissivePosUpdates; 
+        }
+        ZetaInline const Core::GpuMemory::Buffer& GetEmissiveTriangleBuffer() const { return m_emissives.TriangleBuffer(); }
+        ZetaInline const Core::GpuMemory::Buffer& GetEmissiveObjSpaceTriangleBuffer() const
+        {
+            return m_emissives.ObjSpaceTriangleBuffer();
+        }
         void UpdateEmissiveMaterial(uint64_t instanceID, const Math::float3& emissiveFactor, float strength);
+        // Identifies the emissive triangles (meshes, UVs and emissive textures, in emissive 
+        // buffer order) independent of load order, so it stays the same across runs. Emissive
+        // factor and strength aren't included.
+        uint64_t EmissiveCacheKey();
         void ToggleEmissivesCallback(const Support::ParamVariant& p);
 
         //
@@ -241,6 +352,7 @@ namespace ZetaRay::Scene
         void AddAnimation(uint64_t id, Util::MutableSpan<Keyframe> keyframes, float t_start,
             bool loop = true, bool isSorted = true);
         void AnimateCallback(const Support::ParamVariant& p);
+        void OnMemoryPressure(Core::GpuMemory::MEMORY_PRESSURE p);
 
         //
         // Misc
@@ -271,17 +383,28 @@ namespace ZetaRay::Scene
         }
         void ClearPick();
         void SetPickedInstance(uint64 instanceID);
-        ZetaInline Util::SynchronizedSpan<uint64_t> GetPickedInstances()
+        using PickList = Util::SmallVector<uint64, Support::SystemAllocator, 4>;
+        // Lock-free, picked instances are read by multiple passes every frame, but 
+        // only change on user input
+        ZetaInline Util::RSnapshotView<PickList> GetPickedInstances()
         { 
-            return Util::SynchronizedSpan<uint64_t>(m_pickedInstances, m_pickLock);
+            return m_pickedInstances.Read();
         }
         ZetaInline void CaptureScreen() { m_rendererInterface.CaptureScreen(); }
 
     private:
+        // Initial sizes -- tables grow as needed, but only these slots get texture feedback
         static constexpr uint32_t BASE_COLOR_DESC_TABLE_SIZE = 256;
         static constexpr uint32_t NORMAL_DESC_TABLE_SIZE = 256;
         static constexpr uint32_t METALLIC_ROUGHNESS_DESC_TABLE_SIZE = 256;
         static constexpr uint32_t EMISSIVE_DESC_TABLE_SIZE = 64;
+        static_assert(TEX_FEEDBACK_NORMAL_OFFSET == BASE_COLOR_DESC_TABLE_SIZE &&
+            TEX_FEEDBACK_METALLIC_ROUGHNESS_OFFSET == TEX_FEEDBACK_NORMAL_OFFSET + NORMAL_DESC_TABLE_SIZE &&
+            TEX_FEEDBACK_EMISSIVE_OFFSET == TEX_FEEDBACK_METALLIC_ROUGHNESS_OFFSET + METALLIC_ROUGHNESS_DESC_TABLE_SIZE &&
+            TEX_FEEDBACK_NUM_ENTRIES == TEX_FEEDBACK_EMISSIVE_OFFSET + EMISSIVE_DESC_TABLE_SIZE,
+            "Texture feedback layout doesn't match the descriptor tables.");
+        // Texture usage is predicted once every this many frames
+        static constexpr uint32_t TEX_PREDICTION_INTERVAL = 4;
 
         struct TreePos
         {
@@ -317,9 +440,15 @@ namespace ZetaRay::Scene
             Util::SmallVector<uint8_t> m_rtFlags;
             // (Also) filled in by TLAS::RebuildTLASInstances()
             Util::SmallVector<RT_AS_Info> m_rtASInfo;
+            // Offset of parent instance in the previous level
+            Util::SmallVector<uint32_t> m_parents;
+            // Instances whose world transformation needs to be recomputed. Flags are used 
+            // to avoid adding the same instance twice.
+            Util::SmallVector<uint8_t> m_dirtyFlags;
+            Util::SmallVector<uint32_t> m_dirtyList;
         };
 
-        // Offset into "m_keyframes" array
+        // Offset into keyframe arrays
         struct AnimationMetadata
         {
             uint64_t InstanceID;
@@ -327,41 +456,73 @@ namespace ZetaRay::Scene
             uint32_t Length;
             float T0;
             bool Loop;
+            // Start of the keyframe interval that was sampled last (relative to StartOffset). 
+            // During playback, it's either still valid or the next one is.
+            uint32_t CurrKeyframe = 0;
         };
 
+        // Lock-free and safe to call from multiple tasks concurrently. Must not overlap with 
+        // scene updates though -- AddInstance() shifts the offsets of siblings (one entry at 
+        // a time) and the scene graph arrays that the returned position indexes into.
         ZetaInline Util::Optional<TreePos> FindTreePosFromID(uint64_t id) const
         {
-            auto pos = m_IDtoTreePos.find(id);
-            if (pos)
-                return *pos.value();
+            return m_IDtoTreePos.find(id);
+        }
 
-            return {};
+        // Marks instance and (during propagation) its subtree for world transformation update
+        ZetaInline void MarkTransformDirty(uint32_t treeLevel, uint32_t offset)
+        {
+            auto& level = m_sceneGraph[treeLevel];
+
+            if (!level.m_dirtyFlags[offset])
+            {
+                level.m_dirtyFlags[offset] = 1;
+                level.m_dirtyList.push_back(offset);
+                m_hasDirtyTransforms = true;
+            }
         }
 
         uint32_t InsertAtLevel(uint64_t id, uint32_t treeLevel, uint32_t parentIdx, 
             Math::AffineTransformation& localTransform, uint64_t meshID, 
             Model::RT_MESH_MODE rtMeshMode, uint8_t rtInstanceMask, bool isOpaque);
+        // Sorts static instances along a Morton curve over their world-space centroids
+        void SortRtStaticInstances();
         void ResetRtAsInfos();
         void InitWorldTransformations();
         void UpdateWorldTransformations(Util::Vector<Math::BVH::BVHUpdateInput, 
             App::FrameAllocator>& toUpdateInstances);
-        void UpdateEmissivePositions();
+        void AddEmissivePositionUpdate(uint64_t instanceID);
+        // Drops instance updates that have reached both TLAS and previous frame's transforms
+        void EraseExpiredInstanceUpdates();
+        void PublishRenderSnapshot();
+        void UpdateEmissivePositions(bool moved);
+        // Estimates the texture resolutions that'll be needed from the camera's predicted 
+        // poses and passes them to the texture streamer
+        void PredictTextureUsage();
         void RebuildBVH();
         void UpdateAnimations(float t, Util::Vector<AnimationUpdate, App::FrameAllocator>& animVec);
+        // Returns the index of the keyframe where the interval that contains time t starts
+        uint32_t SampleKeyframes(AnimationMetadata& anim, float t, float& interpolatedT);
         void UpdateLocalTransforms(Util::Span<AnimationUpdate> animVec);
         bool ConvertInstanceDynamic(uint64_t instanceID, const TreePos& treePos, RT_Flags rtFlags);
         void ConvertSubtreeDynamic(uint32_t treeLevel, Range r);
 
         // Maps instance ID to tree position
-        Util::HashTable<TreePos> m_IDtoTreePos;
+        Util::ConcurrentHashTable<TreePos> m_IDtoTreePos;
         // Maps RT mesh index to instance ID -- filled in by TLAS::BuildFrameMeshInstanceData()
         Util::SmallVector<uint64> m_rtMeshInstanceIdxToID;
+        // Tree positions (level << 32 | offset) of static instances in mesh instance buffer 
+        // order. Computed once, entries for instances that are later converted to dynamic
+        // are skipped so that the remaining ones keep their relative order.
+        Util::SmallVector<uint64_t> m_rtStaticInstanceOrder;
         Util::SmallVector<TreeLevel, Support::SystemAllocator, 3> m_sceneGraph;
         // Previous frame's world transformation
         Util::HashTable<Math::float4x3> m_prevToWorlds;
-        Util::SmallVector<uint64, Support::SystemAllocator, 4> m_pickedInstances;
+        Util::SnapshotBuffer<PickList> m_pickedInstances;
         bool m_multiPick = false;
         bool m_isPaused = false;
+        std::atomic_int32_t m_numPendingLoads = 0;
+        bool m_loadInProgress = false;
 
         //
         // Scene metadata
@@ -374,6 +535,11 @@ namespace ZetaRay::Scene
         bool m_meshBufferStale = false;
         Util::SmallVector<uint64_t, Support::SystemAllocator, 3> m_pendingRtMeshModeSwitch;
         Util::HashTable<uint64_t> m_instanceUpdates;
+        bool m_hasDirtyTransforms = false;
+        // Render side reads m_renderSnapshots[m_renderSnapshotIdx], the other one is 
+        // written by PublishRenderSnapshot()
+        RenderSnapshot m_renderSnapshots[2];
+        std::atomic_int m_renderSnapshotIdx = 0;
         
         struct TransformUpdate
         {
@@ -395,33 +561,49 @@ namespace ZetaRay::Scene
         // Assets
         //
         Internal::MeshContainer m_meshes;
+        // When set, dynamic instances switch to simplified meshes based on their 
+        // projected size (see TLAS)
+        bool m_meshLODs = true;
+        bool m_texPrefetch = true;
         Internal::MaterialBuffer m_matBuffer;
         Internal::TexSRVDescriptorTable m_baseColorDescTable;
         Internal::TexSRVDescriptorTable m_normalDescTable;
         Internal::TexSRVDescriptorTable m_metallicRoughnessDescTable;
         Internal::TexSRVDescriptorTable m_emissiveDescTable;
         Util::SmallVector<Core::GpuMemory::ResourceHeap, Support::SystemAllocator, 8> m_textureHeaps;
+        D3D12_RESIDENCY_PRIORITY m_textureHeapPriority = D3D12_RESIDENCY_PRIORITY_NORMAL;
+        SRWLOCK m_textureHeapLock = SRWLOCK_INIT;
+        Internal::TextureStreamer m_texStreamer;
 
         //
         // Emissives
         //
         Internal::EmissiveBuffer m_emissives;
         Util::SmallVector<uint64_t, App::FrameAllocator> m_toUpdateEmissives;
+        Util::SmallVector<uint64_t> m_changedEmissives;
+        Util::SmallVector<RT::EmissivePositionUpdate> m_emissivePosUpdates;
+        // Material changes are applied to the emissive buffer in the next frame's update
+        Util::SmallVector<uint64_t> m_pendingEmissiveMatChanges;
         bool m_staleEmissiveMats = false;
         bool m_staleEmissivePositions = false;
+        bool m_emissivePositionsUpdated = false;
         bool m_ignoreEmissives = false;
 
         SRWLOCK m_matLock = SRWLOCK_INIT;
         SRWLOCK m_meshLock = SRWLOCK_INIT;
         SRWLOCK m_instanceLock = SRWLOCK_INIT;
         SRWLOCK m_emissiveLock = SRWLOCK_INIT;
-        SRWLOCK m_pickLock = SRWLOCK_INIT;
 
         //
         // Animation
         //
         Util::SmallVector<AnimationMetadata> m_animationMetadata;
-        Util::SmallVector<Keyframe> m_keyframes;
+        // Keyframes of all animations in SoA layout, where each animation occupies a 
+        // contiguous range
+        Util::SmallVector<float> m_keyframeTimes;
+        Util::SmallVector<Math::float3> m_keyframeScales;
+        Util::SmallVector<Math::float4> m_keyframeRotations;
+        Util::SmallVector<Math::float3> m_keyframeTranslations;
         bool m_animate = true;
 
         //
@@ -24,10 +24,14 @@ namespace ZetaRay::Scene::GlobalResource
     inline static constexpr const char* EMISSIVE_TRIANGLE_ALIAS_TABLE = "EmissiveAliasTable";
     inline static constexpr const char* PRESAMPLED_EMISSIVE_SETS = "PresampledEmissiveTris";
     inline static constexpr const char* LIGHT_VOXEL_GRID = "LVG";
+    inline static constexpr const char* LIGHT_BVH = "LightBVH";
+    inline static constexpr const char* LIGHT_BVH_TRI_TO_LEAF = "LightBVHTriToLeaf";
     inline static constexpr const char* RT_SCENE_BVH_PREV = "PrevSceneBVH";
     inline static constexpr const char* RT_SCENE_BVH_CURR = "CurrSceneBVH";
     inline static constexpr const char* SCENE_VERTEX_BUFFER = "SceneVB";
     inline static constexpr const char* SCENE_INDEX_BUFFER = "SceneIB";
+    inline static constexpr const char* SCENE_MESHLETS = "SceneMeshlets";
+    inline static constexpr const char* SCENE_MESHLET_DATA = "SceneMeshletData";
     inline static constexpr const char* RT_FRAME_MESH_INSTANCES_PREV = "PrevRtFrameMeshInstances";
     inline static constexpr const char* RT_FRAME_MESH_INSTANCES_CURR = "CurrRtFrameMeshInstances";
 }
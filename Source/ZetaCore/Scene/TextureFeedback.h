@@ -0,0 +1,28 @@
+#ifndef TEXTURE_FEEDBACK_H
+#define TEXTURE_FEEDBACK_H
+
+#include "../Core/HLSLCompat.h"
+
+// Texture streaming feedback is a buffer with one uint per descriptor table slot. Tables
+// are laid out back-to-back in the following order: base color, normal, metallic-roughness
+// and emissive. Sizes must match the scene's initial descriptor table sizes -- slots that
+// are added after a table has grown don't have feedback entries.
+#define TEX_FEEDBACK_BASE_COLOR_OFFSET 0
+#define TEX_FEEDBACK_NORMAL_OFFSET 256
+#define TEX_FEEDBACK_METALLIC_ROUGHNESS_OFFSET 512
+#define TEX_FEEDBACK_EMISSIVE_OFFSET 768
+#define TEX_FEEDBACK_NUM_ENTRIES 832
+
+// Only one pixel out of every TEX_FEEDBACK_TILE_DIM x TEX_FEEDBACK_TILE_DIM tile writes
+// feedback. The chosen pixel rotates every frame.
+#define TEX_FEEDBACK_TILE_DIM 8
+#define TEX_FEEDBACK_LOG2_TILE_DIM 3
+
+// Each entry is (frame number << TEX_FEEDBACK_NUM_VALUE_BITS) | log2(requested width),
+// so that InterlockedMax() keeps the largest request from the most recent frame and
+// the buffer doesn't need to be cleared.
+#define TEX_FEEDBACK_NUM_VALUE_BITS 4
+#define TEX_FEEDBACK_VALUE_MASK ((1u << TEX_FEEDBACK_NUM_VALUE_BITS) - 1)
+#define TEX_FEEDBACK_FRAME_MASK (0xffffffffu >> TEX_FEEDBACK_NUM_VALUE_BITS)
+
+#endif
@@ -0,0 +1,525 @@
+#include "TextureStreamer.h"
+#include "Asset.h"
+#include "../Core/RendererCore.h"
+#include "../Support/Task.h"
+#include "../Support/MemoryArena.h"
+#include "../App/Path.h"
+#include "../App/Timer.h"
+#include "../App/Log.h"
+
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Core::GpuMemory;
+using namespace ZetaRay::Scene::Internal;
+using namespace ZetaRay::App;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Math;
+
+namespace
+{
+    ZetaInline uint32_t FrameDiff(uint32_t curr, uint32_t prev)
+    {
+        return (curr - prev) & TEX_FEEDBACK_FRAME_MASK;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// TextureStreamer
+//--------------------------------------------------------------------------------------
+
+uint16_t TextureStreamer::InitialTopMip(uint32_t width, uint32_t height, uint16_t mipCount)
+{
+    uint16_t topMip = 0;
+    while (topMip + 1 < mipCount && Max(width >> topMip, height >> topMip) > INITIAL_MAX_DIM)
+        topMip++;
+
+    return ValidTopMip(width, height, topMip);
+}
+
+uint16_t TextureStreamer::ValidTopMip(uint32_t width, uint32_t height, uint16_t topMip)
+{
+    // Mip 0 of the original texture is always valid
+    while (topMip > 0 && (((width >> topMip) & 0x3) || ((height >> topMip) & 0x3)))
+        topMip--;
+
+    return topMip;
+}
+
+uint64_t TextureStreamer::SizeInBytes(const Entry& e, uint16_t topMip)
+{
+    const uint64_t bpp = Direct3DUtil::BitsPerPixel(e.Format);
+    uint64_t size = 0;
+
+    // Rounded up to 4x4 blocks, which only overestimates the smallest mips of
+    // uncompressed formats
+    for (uint32_t m = topMip; m < e.MipCount; m++)
+    {
+        const uint64_t w = AlignUp(Max(e.Width >> m, 1u), 4u);
+        const uint64_t h = AlignUp(Max(e.Height >> m, 1u), 4u);
+        size += (w * h * bpp) >> 3;
+    }
+
+    return size;
+}
+
+uint32_t TextureStreamer::AddPath(const char* path)
+{
+    const size_t pathLen = strlen(path);
+    const uint32_t pathOffset = (uint32_t)m_paths.size();
+    m_paths.resize(pathOffset + pathLen + 1);
+    memcpy(m_paths.data() + pathOffset, path, pathLen + 1);
+
+    return pathOffset;
+}
+
+void TextureStreamer::Add(const TextureDesc& desc)
+{
+    Assert(desc.ResidentMip < desc.MipCount, "Invalid mip level.");
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    const uint32_t pathOffset = AddPath(desc.Path);
+
+    m_idToEntry.insert_or_assign(desc.ID, (uint32_t)m_entries.size());
+    m_entries.push_back(Entry{ .ID = desc.ID,
+        .PathOffset = pathOffset,
+        .Width = desc.Width,
+        .Height = desc.Height,
+        .Format = desc.Format,
+        .MipCount = desc.MipCount,
+        .BaseMip = desc.ResidentMip,
+        .ResidentMip = desc.ResidentMip,
+        .DesiredMip = desc.ResidentMip });
+
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void TextureStreamer::SetFeedbackIndex(Texture::ID_TYPE ID, uint32_t feedbackIdx)
+{
+    Assert(feedbackIdx < TEX_FEEDBACK_NUM_ENTRIES, "Feedback index is out of bounds.");
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    // Textures that are fully resident aren't tracked
+    if (auto it = m_idToEntry.find(ID); it)
+        m_entries[*it.value()].FeedbackIdx = feedbackIdx;
+
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void TextureStreamer::Remove(Texture::ID_TYPE ID)
+{
+    AcquireSRWLockExclusive(&m_lock);
+
+    // Entry is kept so that other indices remain valid, but it's treated as failed so 
+    // that it's never requested again. Loads that are in flight fail to find it when 
+    // swapping and are released.
+    if (auto it = m_idToEntry.find(ID); it)
+    {
+        Entry& e = m_entries[*it.value()];
+        e.FeedbackIdx = UINT32_MAX;
+        e.Failed = true;
+    }
+
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void TextureStreamer::Reload(const TextureDesc& desc, uint32_t feedbackIdx)
+{
+    Assert(desc.ResidentMip < desc.MipCount, "Invalid mip level.");
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    // Applied in Update()
+    m_reloads.push_back(PendingReload{ .ID = desc.ID,
+        .PathOffset = AddPath(desc.Path),
+        .Width = desc.Width,
+        .Height = desc.Height,
+        .Format = desc.Format,
+        .MipCount = desc.MipCount,
+        .TopMip = desc.ResidentMip,
+        .FeedbackIdx = feedbackIdx });
+
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void TextureStreamer::OnFeedbackReadback(Span<uint8_t> data)
+{
+    Assert(data.size() == sizeof(m_feedback), "Unexpected readback size.");
+
+    AcquireSRWLockExclusive(&m_lock);
+    memcpy(m_feedback, data.data(), sizeof(m_feedback));
+    m_hasNewFeedback = true;
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+uint16_t TextureStreamer::MipFromFeedback(const Entry& e, uint32_t f)
+{
+    // Feedback is log2 of the needed width, regardless of the texture dimensions
+    const int log2Dim = 31 - (int)_lzcnt_u32(Max(e.Width, e.Height));
+    const int m = Max(log2Dim - (int)(f & TEX_FEEDBACK_VALUE_MASK), 0);
+
+    return ValidTopMip(e.Width, e.Height, (uint16_t)Min(m, (int)e.BaseMip));
+}
+
+void TextureStreamer::OnPrediction(Span<uint32_t> feedback, Span<float> coverage)
+{
+    Assert(feedback.size() == TEX_FEEDBACK_NUM_ENTRIES && coverage.size() == TEX_FEEDBACK_NUM_ENTRIES,
+        "Unexpected prediction size.");
+
+    AcquireSRWLockExclusive(&m_lock);
+    memcpy(m_predicted, feedback.data(), sizeof(m_predicted));
+    memcpy(m_predictedCoverage, coverage.data(), sizeof(m_predictedCoverage));
+    m_hasNewPrediction = true;
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void TextureStreamer::ProcessFeedback()
+{
+    for (auto& e : m_entries)
+    {
+        if (e.FeedbackIdx == UINT32_MAX)
+            continue;
+
+        const uint32_t f = m_feedback[e.FeedbackIdx];
+        const uint32_t frame = f >> TEX_FEEDBACK_NUM_VALUE_BITS;
+        // Never sampled
+        if (frame == 0)
+            continue;
+
+        e.LastSeenFrame = frame;
+        const uint16_t mip = MipFromFeedback(e, f);
+
+        // Higher resolutions are accepted right away, lower ones once they've persisted
+        // for a while. Feedback is a few frames old, so desired mip may have been confirmed
+        // (e.g. by a prediction) after it was written.
+        const uint32_t age = FrameDiff(frame, e.DesiredFrame);
+        if (mip <= e.DesiredMip || (age > DOWNGRADE_AFTER_NUM_FRAMES && 
+            age < (TEX_FEEDBACK_FRAME_MASK >> 1)))
+        {
+            e.DesiredMip = mip;
+            e.DesiredFrame = frame;
+        }
+    }
+}
+
+void TextureStreamer::ProcessPrediction()
+{
+    for (auto& e : m_entries)
+    {
+        if (e.FeedbackIdx == UINT32_MAX)
+            continue;
+
+        const uint32_t f = m_predicted[e.FeedbackIdx];
+        const uint32_t frame = f >> TEX_FEEDBACK_NUM_VALUE_BITS;
+        e.Coverage = m_predictedCoverage[e.FeedbackIdx];
+
+        if (frame == 0)
+            continue;
+
+        // Counts as seen, otherwise textures that are about to come into view could be 
+        // evicted
+        e.LastSeenFrame = frame;
+
+        const uint16_t mip = MipFromFeedback(e, f);
+        if (mip <= e.DesiredMip)
+        {
+            e.DesiredMip = mip;
+            e.DesiredFrame = frame;
+        }
+    }
+}
+
+void TextureStreamer::Update(Span<TexSRVDescriptorTable*> tables)
+{
+    auto& renderer = App::GetRenderer();
+    const uint64_t completedFenceVal = renderer.GetCompletedFrameFenceValue();
+
+    for (auto* t : tables)
+        t->Recycle(completedFenceVal);
+
+    const uint64_t frame = App::GetTimer().GetTotalFrameCount();
+    const uint32_t currFrame = (uint32_t)frame & TEX_FEEDBACK_FRAME_MASK;
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    if (m_hasNewFeedback)
+    {
+        ProcessFeedback();
+        m_hasNewFeedback = false;
+    }
+
+    if (m_hasNewPrediction)
+    {
+        ProcessPrediction();
+        m_hasNewPrediction = false;
+    }
+
+    // Swap in the loaded textures. Their uploads were recorded before this point, so
+    // they're submitted (and waited on) before this frame's rendering starts. Swaps are
+    // batched to avoid publishing a new descriptor table every frame.
+    if (!m_loaded.empty() && frame >= m_lastSwapFrame + MIN_FRAMES_BETWEEN_SWAPS)
+    {
+        const uint64_t fenceVal = renderer.GetCurrentFrameFenceValue();
+
+        for (auto& l : m_loaded)
+        {
+            Entry& e = m_entries[l.EntryIdx];
+            bool replaced = false;
+
+            for (auto* t : tables)
+            {
+                if (t->Replace(ZetaMove(l.T), fenceVal))
+                {
+                    replaced = true;
+                    break;
+                }
+            }
+
+            // Not referenced by any material
+            if (!replaced)
+                l.T.Reset();
+            else
+                e.ResidentMip = l.TopMip;
+
+            e.RequestedMip = INVALID_MIP;
+        }
+
+        m_loaded.clear();
+        m_lastSwapFrame = frame;
+    }
+
+    // Also publishes textures that were added since the last frame
+    for (auto* t : tables)
+        t->Commit();
+
+    auto request = [this](uint32_t entryIdx, uint16_t topMip)
+        {
+            Entry& e = m_entries[entryIdx];
+            e.RequestedMip = topMip;
+            m_numInFlight++;
+            m_inFlightBytes += SizeInBytes(e, topMip);
+
+            Task t("TextureStreaming", TASK_PRIORITY::BACKGROUND, [this, entryIdx, topMip]()
+                {
+                    Load(entryIdx, topMip);
+                });
+
+            App::SubmitBackground(ZetaMove(t));
+        };
+
+    auto canRequest = [](const Entry& e)
+        {
+            return !e.Failed && e.RequestedMip == INVALID_MIP;
+        };
+
+    // Loads that are in flight were sized for the prior texture, so reloads wait for them
+    for (size_t i = 0; i < m_reloads.size();)
+    {
+        const PendingReload& r = m_reloads[i];
+        uint32_t entryIdx;
+
+        if (auto it = m_idToEntry.find(r.ID); it)
+            entryIdx = *it.value();
+        else
+        {
+            entryIdx = (uint32_t)m_entries.size();
+            m_idToEntry.insert_or_assign(r.ID, entryIdx);
+            m_entries.push_back(Entry{ .ID = r.ID });
+        }
+
+        Entry& e = m_entries[entryIdx];
+        if (e.RequestedMip != INVALID_MIP)
+        {
+            i++;
+            continue;
+        }
+
+        e.PathOffset = r.PathOffset;
+        e.Width = r.Width;
+        e.Height = r.Height;
+        e.Format = r.Format;
+        e.MipCount = r.MipCount;
+        e.BaseMip = r.TopMip;
+        e.ResidentMip = r.TopMip;
+        e.DesiredMip = r.TopMip;
+        e.Failed = false;
+
+        if (r.FeedbackIdx != UINT32_MAX)
+            e.FeedbackIdx = r.FeedbackIdx;
+
+        request(entryIdx, r.TopMip);
+        m_reloads.erase_at_index(i);
+    }
+
+    const VideoMemoryInfo memInfo = GpuMemory::GetVideoMemoryInfo();
+
+    // Under memory pressure, drop one mip level from the textures that have gone the
+    // longest without being seen
+    const int numForcedEvictions = memInfo.Pressure == MEMORY_PRESSURE::CRITICAL ? MAX_NUM_IN_FLIGHT :
+        (memInfo.Pressure == MEMORY_PRESSURE::HIGH ? 1 : 0);
+
+    for (int i = 0; i < numForcedEvictions && m_numInFlight < MAX_NUM_IN_FLIGHT; i++)
+    {
+        uint32_t best = UINT32_MAX;
+        uint32_t bestAge = 0;
+
+        for (uint32_t j = 0; j < (uint32_t)m_entries.size(); j++)
+        {
+            const Entry& e = m_entries[j];
+            if (!canRequest(e) || e.ResidentMip >= e.BaseMip)
+                continue;
+
+            const uint32_t age = FrameDiff(currFrame, e.LastSeenFrame);
+            if (best == UINT32_MAX || age > bestAge)
+            {
+                best = j;
+                bestAge = age;
+            }
+        }
+
+        if (best == UINT32_MAX)
+            break;
+
+        Entry& e = m_entries[best];
+        uint16_t topMip = e.ResidentMip + 1;
+        while (topMip < e.BaseMip && ValidTopMip(e.Width, e.Height, topMip) != topMip)
+            topMip++;
+
+        // Otherwise, feedback would bring it right back once pressure subsides
+        e.DesiredMip = Max(e.DesiredMip, topMip);
+        e.DesiredFrame = currFrame;
+
+        request(best, topMip);
+    }
+
+    // Stream out the textures that need fewer mips or haven't been seen for a while
+    for (uint32_t i = 0; i < (uint32_t)m_entries.size() && m_numInFlight < MAX_NUM_IN_FLIGHT; i++)
+    {
+        Entry& e = m_entries[i];
+        if (!canRequest(e))
+            continue;
+
+        if (FrameDiff(currFrame, e.LastSeenFrame) > EVICT_AFTER_NUM_FRAMES)
+            e.DesiredMip = e.BaseMip;
+
+        if (e.DesiredMip > e.ResidentMip)
+            request(i, e.DesiredMip);
+    }
+
+    // Stream in, starting from the textures that are furthest from their desired resolution,
+    // weighted by how much of the screen they're predicted to cover
+    if (memInfo.Pressure == MEMORY_PRESSURE::NONE)
+    {
+        const uint64_t budget = (uint64_t)(memInfo.Budget * MAX_BUDGET_USAGE);
+
+        while (m_numInFlight < MAX_NUM_IN_FLIGHT)
+        {
+            uint32_t best = UINT32_MAX;
+            float bestPriority = 0.0f;
+
+            for (uint32_t i = 0; i < (uint32_t)m_entries.size(); i++)
+            {
+                const Entry& e = m_entries[i];
+                const int gap = (int)e.ResidentMip - (int)e.DesiredMip;
+                const float priority = (float)gap * (MIN_PRIORITY + e.Coverage);
+
+                if (canRequest(e) && gap > 0 && priority > bestPriority)
+                {
+                    best = i;
+                    bestPriority = priority;
+                }
+            }
+
+            if (best == UINT32_MAX)
+                break;
+
+            // Prior texture remains resident until the new one is swapped in
+            const uint64_t size = SizeInBytes(m_entries[best], m_entries[best].DesiredMip);
+            if (memInfo.CurrentUsage + m_inFlightBytes + size > budget)
+                break;
+
+            // Rest waits for the next frame rather than competing with this frame's copies
+            if (!GpuMemory::ReserveUploadBytes(size))
+                break;
+
+            request(best, m_entries[best].DesiredMip);
+        }
+    }
+
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void TextureStreamer::Load(uint32_t entryIdx, uint16_t topMip)
+{
+    Filesystem::Path path;
+    Texture::ID_TYPE ID;
+
+    // Entries might be reallocated while textures are being added
+    AcquireSRWLockShared(&m_lock);
+    path.Reset(m_paths.data() + m_entries[entryIdx].PathOffset);
+    ID = m_entries[entryIdx].ID;
+    ReleaseSRWLockShared(&m_lock);
+
+    D3D12_SUBRESOURCE_DATA subresources[DDS_Data::MAX_NUM_SUBRESOURCES];
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint16_t mipCount;
+    uint32_t numSubresources;
+    DXGI_FORMAT format;
+    MemoryArena memArena;
+    const auto err = Direct3DUtil::LoadDDSFromFile(path.Get(), subresources, format,
+        ArenaAllocator(memArena), width, height, depth, mipCount, numSubresources);
+
+    Texture tex;
+
+    if (err == Direct3DUtil::LOAD_DDS_RESULT::SUCCESS && topMip < numSubresources)
+    {
+        tex = GpuMemory::GetTexture2D(ID, Max(width >> topMip, 1u), Max(height >> topMip, 1u),
+            format, D3D12_RESOURCE_STATE_COMMON, 0, (uint16_t)(mipCount - topMip));
+
+        // Block size only needs to cover the largest subresource -- arena scales it up by 
+        // how much arenas have been using in practice, so that the smaller mips usually 
+        // fit in the same block
+        const uint32_t rowPitch = AlignUp((uint32_t)subresources[topMip].RowPitch,
+            (uint32_t)D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+        const uint32_t numRows = (uint32_t)(subresources[topMip].SlicePitch / subresources[topMip].RowPitch);
+        UploadHeapArena heapArena(rowPitch * numRows + (uint32_t)D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+        GpuMemory::UploadToTexture(tex, heapArena, Span(subresources + topMip, numSubresources - topMip), 0);
+    }
+    else
+        LOG_UI_WARNING("Streaming texture from path %s failed: %d\n", path.Get(), err);
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    Entry& e = m_entries[entryIdx];
+    m_numInFlight--;
+    m_inFlightBytes -= SizeInBytes(e, topMip);
+
+    if (tex.IsInitialized())
+    {
+        m_loaded.push_back(LoadedTexture{ .T = ZetaMove(tex),
+            .EntryIdx = entryIdx,
+            .TopMip = topMip });
+    }
+    else
+    {
+        e.Failed = true;
+        e.RequestedMip = INVALID_MIP;
+    }
+
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void TextureStreamer::Clear()
+{
+    for (auto& l : m_loaded)
+        l.T.Reset(false);
+
+    m_loaded.free_memory();
+    m_reloads.free_memory();
+    m_entries.free_memory();
+    m_paths.free_memory();
+}
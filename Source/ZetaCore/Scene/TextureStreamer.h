@@ -0,0 +1,149 @@
+#pragma once
+
+#include "../Utility/HashTable.h"
+#include "../Core/GpuMemory.h"
+#include "TextureFeedback.h"
+
+namespace ZetaRay::Scene::Internal
+{
+    struct TexSRVDescriptorTable;
+
+    //--------------------------------------------------------------------------------------
+    // TextureStreamer: Scene textures start out with only their lowest-resolution mips
+    // resident. Every frame, G-Buffer pass writes the needed resolution for each descriptor
+    // table slot into a feedback buffer, which is read back and used to stream higher mips
+    // in (or out) in the background while staying within the VRAM budget. Loaded textures
+    // swap out the resident ones in their descriptor table slots. CPU-side predictions of
+    // where the camera is headed are merged in, so that mips are prefetched ahead of it.
+    //--------------------------------------------------------------------------------------
+
+    struct TextureStreamer
+    {
+        struct TextureDesc
+        {
+            Core::GpuMemory::Texture::ID_TYPE ID;
+            const char* Path;
+            // Dimensions of the full-resolution texture
+            uint32_t Width;
+            uint32_t Height;
+            DXGI_FORMAT Format;
+            uint16_t MipCount;
+            // Most detailed mip level that was loaded
+            uint16_t ResidentMip;
+        };
+
+        TextureStreamer() = default;
+        ~TextureStreamer() = default;
+
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+        // Most detailed mip level that should be loaded initially
+        static uint16_t InitialTopMip(uint32_t width, uint32_t height, uint16_t mipCount);
+
+        // Following are thread-safe
+        void Add(const TextureDesc& desc);
+        // Associates the given texture with an entry in the feedback buffer
+        void SetFeedbackIndex(Core::GpuMemory::Texture::ID_TYPE ID, uint32_t feedbackIdx);
+        // Stops streaming the given texture, e.g. after it was evicted from its descriptor table
+        void Remove(Core::GpuMemory::Texture::ID_TYPE ID);
+        void OnFeedbackReadback(Util::Span<uint8_t> data);
+        // Predicted needs for the near future, same encoding and layout as the feedback 
+        // buffer. Coverage is the predicted fraction of screen (in [0, 1]) that each entry 
+        // covers and orders the stream-in requests. Predictions can only raise the desired 
+        // resolution.
+        void OnPrediction(Util::Span<uint32_t> feedback, Util::Span<float> coverage);
+        // Loads the texture from disk again (e.g. after it was modified), starting from 
+        // desc.ResidentMip. Dimensions, format and number of mips may have changed. 
+        // Textures that were fully resident are streamed from then on.
+        void Reload(const TextureDesc& desc, uint32_t feedbackIdx);
+
+        // Swaps in textures that have been loaded and issues new load requests. Called
+        // once per frame while no textures are being added to given tables.
+        void Update(Util::Span<TexSRVDescriptorTable*> tables);
+        void Clear();
+
+    private:
+        static constexpr uint16_t INVALID_MIP = UINT16_MAX;
+        // Largest dimension of the initially loaded mip chain
+        static constexpr uint32_t INITIAL_MAX_DIM = 256;
+        static constexpr int MAX_NUM_IN_FLIGHT = 4;
+        // Textures that haven't been seen for this many frames go back to the initial mips
+        static constexpr uint32_t EVICT_AFTER_NUM_FRAMES = 600;
+        // Requests for lower resolutions are only accepted after they've persisted for
+        // this many frames
+        static constexpr uint32_t DOWNGRADE_AFTER_NUM_FRAMES = 120;
+        static constexpr uint32_t MIN_FRAMES_BETWEEN_SWAPS = 4;
+        // Fraction of the VRAM budget up to which textures are streamed in
+        static constexpr float MAX_BUDGET_USAGE = 0.85f;
+        // Stream-in priority is gap * (MIN_PRIORITY + coverage), so that textures without
+        // a prediction are still streamed in
+        static constexpr float MIN_PRIORITY = 1.0f / 64;
+
+        struct Entry
+        {
+            Core::GpuMemory::Texture::ID_TYPE ID;
+            uint32_t PathOffset;
+            uint32_t Width;
+            uint32_t Height;
+            DXGI_FORMAT Format;
+            uint16_t MipCount;
+            // Mip level that's resident at minimum
+            uint16_t BaseMip;
+            uint16_t ResidentMip;
+            uint16_t DesiredMip;
+            uint16_t RequestedMip = INVALID_MIP;
+            bool Failed = false;
+            uint32_t FeedbackIdx = UINT32_MAX;
+            uint32_t LastSeenFrame = 0;
+            // Frame when the desired mip was last confirmed
+            uint32_t DesiredFrame = 0;
+            // Predicted screen coverage
+            float Coverage = 0.0f;
+        };
+
+        struct PendingReload
+        {
+            Core::GpuMemory::Texture::ID_TYPE ID;
+            uint32_t PathOffset;
+            uint32_t Width;
+            uint32_t Height;
+            DXGI_FORMAT Format;
+            uint16_t MipCount;
+            uint16_t TopMip;
+            uint32_t FeedbackIdx;
+        };
+
+        struct LoadedTexture
+        {
+            Core::GpuMemory::Texture T;
+            uint32_t EntryIdx;
+            uint16_t TopMip;
+        };
+
+        void ProcessFeedback();
+        void ProcessPrediction();
+        // Mip level that feedback value f asks for
+        static uint16_t MipFromFeedback(const Entry& e, uint32_t f);
+        uint32_t AddPath(const char* path);
+        void Load(uint32_t entryIdx, uint16_t topMip);
+        static uint64_t SizeInBytes(const Entry& e, uint16_t topMip);
+        // Block-compressed textures need dimensions that are multiples of four
+        static uint16_t ValidTopMip(uint32_t width, uint32_t height, uint16_t topMip);
+
+        Util::SmallVector<Entry> m_entries;
+        Util::HashTable<uint32_t, Core::GpuMemory::Texture::ID_TYPE> m_idToEntry;
+        Util::SmallVector<char> m_paths;
+        Util::SmallVector<LoadedTexture> m_loaded;
+        Util::SmallVector<PendingReload> m_reloads;
+        uint32_t m_feedback[TEX_FEEDBACK_NUM_ENTRIES] = { 0 };
+        bool m_hasNewFeedback = false;
+        uint32_t m_predicted[TEX_FEEDBACK_NUM_ENTRIES] = { 0 };
+        float m_predictedCoverage[TEX_FEEDBACK_NUM_ENTRIES] = { 0 };
+        bool m_hasNewPrediction = false;
+        int m_numInFlight = 0;
+        uint64_t m_inFlightBytes = 0;
+        uint64_t m_lastSwapFrame = 0;
+        SRWLOCK m_lock = SRWLOCK_INIT;
+    };
+}
@@ -0,0 +1,462 @@
+#include "BenchmarkRecorder.h"
+#include "../App/App.h"
+#include "../App/Filesystem.h"
+#include "../App/Log.h"
+#include "../Utility/StringUtil.h"
+#include <algorithm>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+
+namespace
+{
+    // Nearest rank, values must be sorted
+    ZetaInline float Percentile(const SmallVector<float>& sorted, float p)
+    {
+        const int n = (int)sorted.size();
+        const int k = (int)ceilf(p * n - 1e-3f) - 1;
+
+        return sorted[Math::Min(Math::Max(k, 0), n - 1)];
+    }
+
+    template<typename F>
+    BenchmarkRecorder::Summary Summarize(uint32_t numFrames, F getValue)
+    {
+        BenchmarkRecorder::Summary ret;
+        SmallVector<float> vals;
+        vals.reserve(numFrames);
+        double sum = 0.0;
+
+        for (uint32_t i = 0; i < numFrames; i++)
+        {
+            const float v = getValue(i);
+            if (v < 0.0f)
+                continue;
+
+            vals.push_back(v);
+            sum += v;
+        }
+
+        if (vals.empty())
+            return ret;
+
+        std::sort(vals.begin(), vals.end());
+
+        ret.Count = (uint32_t)vals.size();
+        ret.Mean = (float)(sum / vals.size());
+        ret.P50 = Percentile(vals, 0.5f);
+        ret.P95 = Percentile(vals, 0.95f);
+        ret.P99 = Percentile(vals, 0.99f);
+        ret.Max = vals.back();
+
+        return ret;
+    }
+
+    // Entries are aggregated by name, T is BenchmarkRecorder::Pass
+    template<typename T>
+    void Accumulate(SmallVector<T>& entries, const char* name, float ms)
+    {
+        // Number of entries is small
+        for (auto& p : entries)
+        {
+            if (strcmp(p.Name, name) == 0)
+            {
+                p.TotalMs += ms;
+                p.MinMs = Math::Min(p.MinMs, ms);
+                p.MaxMs = Math::Max(p.MaxMs, ms);
+                p.Count++;
+
+                return;
+            }
+        }
+
+        T p;
+        const size_t n = Math::Min(strlen(name), (size_t)BenchmarkRecorder::MAX_PASS_NAME_LENGTH - 1);
+        memcpy(p.Name, name, n);
+        p.Name[n] = '\0';
+        p.TotalMs = ms;
+        p.MinMs = ms;
+        p.MaxMs = ms;
+        p.Count = 1;
+
+        entries.push_back(p);
+    }
+
+    template<typename T>
+    void AppendEntries(SmallVector<char>& json, const SmallVector<T>& entries)
+    {
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const T& p = entries[i];
+            AppendFormat(json, "%s\n    {\"name\": ", i == 0 ? "" : ",");
+            AppendJsonString(json, p.Name);
+            AppendFormat(json, ", \"frames\": %u, \"meanMs\": %.4f, \"minMs\": %.4f, \"maxMs\": %.4f}",
+                p.Count, p.TotalMs / p.Count, p.MinMs, p.MaxMs);
+        }
+    }
+
+    struct BaselineEntry
+    {
+        char Name[BenchmarkRecorder::MAX_PASS_NAME_LENGTH];
+        float MeanMs;
+    };
+
+    // Reads a string that was written by AppendJsonString(), curr points past the opening quote.
+    // Returns pointer past the closing quote or nullptr on failure.
+    const char* ParseString(const char* curr, char* out, size_t outSize)
+    {
+        size_t n = 0;
+
+        while (*curr != '\0' && *curr != '"')
+        {
+            char c = *curr;
+
+            if (c == '\\' && curr[1] == 'u' && strnlen(curr + 2, 4) == 4)
+            {
+                // Control characters, \u00XX
+                char hex[5] = { curr[2], curr[3], curr[4], curr[5], '\0' };
+                c = (char)strtoul(hex, nullptr, 16);
+                curr += 5;
+            }
+            else if (c == '\\' && curr[1] != '\0')
+                c = *(++curr);
+
+            if (n + 1 < outSize)
+                out[n++] = c;
+
+            curr++;
+        }
+
+        out[n] = '\0';
+
+        return *curr == '"' ? curr + 1 : nullptr;
+    }
+
+    // Mean of given summary, e.g. "frameMs": {"frames": 1000, "mean": 8.1234, ...}. Returns
+    // -1 when missing.
+    float ParseSummaryMean(const char* json, const char* name)
+    {
+        char key[64];
+        stbsp_snprintf(key, sizeof(key), "\"%s\": {", name);
+        const char* curr = strstr(json, key);
+        const char* frames = curr ? strstr(curr, "\"frames\": ") : nullptr;
+        const char* mean = curr ? strstr(curr, "\"mean\": ") : nullptr;
+
+        // No frames had a known value
+        if (!frames || !mean || strtoul(frames + strlen("\"frames\": "), nullptr, 10) == 0)
+            return -1.0f;
+
+        return strtof(mean + strlen("\"mean\": "), nullptr);
+    }
+
+    // Entries of the given array (see AppendEntries())
+    void ParseEntries(const char* json, const char* arrayName, SmallVector<BaselineEntry>& entries)
+    {
+        StackStr(key, n, "\"%s\": [", arrayName);
+        const char* curr = strstr(json, key);
+        if (!curr)
+            return;
+
+        curr += n;
+        const char* nameKey = "{\"name\": \"";
+        const size_t nameKeyLen = strlen(nameKey);
+        const char* meanKey = "\"meanMs\": ";
+
+        while (true)
+        {
+            while (*curr == ' ' || *curr == '\n' || *curr == '\r' || *curr == ',')
+                curr++;
+
+            // End of array
+            if (strncmp(curr, nameKey, nameKeyLen) != 0)
+                break;
+
+            BaselineEntry e;
+            curr = ParseString(curr + nameKeyLen, e.Name, sizeof(e.Name));
+            const char* mean = curr ? strstr(curr, meanKey) : nullptr;
+            if (!mean)
+                break;
+
+            e.MeanMs = strtof(mean + strlen(meanKey), nullptr);
+            entries.push_back(e);
+
+            curr = strchr(mean, '}');
+            if (!curr)
+                break;
+
+            curr++;
+        }
+    }
+
+    void AppendSummary(SmallVector<char>& json, const char* name, const BenchmarkRecorder::Summary& s)
+    {
+        AppendFormat(json, "    \"%s\": {\"frames\": %u, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, "
+            "\"p99\": %.4f, \"max\": %.4f}", name, s.Count, s.Mean, s.P50, s.P95, s.P99, s.Max);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// BenchmarkRecorder
+//--------------------------------------------------------------------------------------
+
+void BenchmarkRecorder::Reset(uint32_t numFrames)
+{
+    m_frames.clear();
+    m_frames.resize(numFrames);
+    m_passes.clear();
+    m_tasks.clear();
+    m_passRuns.clear();
+    m_comparisons.clear();
+    m_baselinePath = nullptr;
+    m_numRegressions = 0;
+}
+
+void BenchmarkRecorder::SetFrameTimes(uint32_t frame, float frameMs, float cpuMs)
+{
+    Assert(frame < m_frames.size(), "Frame index is out of bounds.");
+    m_frames[frame].FrameMs = frameMs;
+    m_frames[frame].CpuMs = cpuMs;
+}
+
+void BenchmarkRecorder::SetGpuTime(uint32_t frame, float gpuMs)
+{
+    Assert(frame < m_frames.size(), "Frame index is out of bounds.");
+    m_frames[frame].GpuMs = gpuMs;
+}
+
+void BenchmarkRecorder::AddPassTime(const char* name, float ms)
+{
+    Accumulate(m_passes, name, ms);
+}
+
+void BenchmarkRecorder::AddTaskTime(const char* name, float ms)
+{
+    Accumulate(m_tasks, name, ms);
+}
+
+void BenchmarkRecorder::Summarize(Summary& frame, Summary& cpu, Summary& gpu) const
+{
+    const uint32_t n = NumFrames();
+    frame = ::Summarize(n, [this](uint32_t i) { return m_frames[i].FrameMs; });
+    cpu = ::Summarize(n, [this](uint32_t i) { return m_frames[i].CpuMs; });
+    gpu = ::Summarize(n, [this](uint32_t i) { return m_frames[i].GpuMs; });
+}
+
+void BenchmarkRecorder::WriteJson(const char* path, const BenchmarkDesc& desc, const char* device,
+    uint16_t renderWidth, uint16_t renderHeight) const
+{
+    Summary frame;
+    Summary cpu;
+    Summary gpu;
+    Summarize(frame, cpu, gpu);
+
+    SmallVector<char> json;
+    AppendFormat(json, "{\n  \"cameraPath\": ");
+    AppendJsonString(json, desc.CameraPath);
+    AppendFormat(json, ",\n  \"integrator\": ");
+    AppendJsonString(json, desc.Integrator ? desc.Integrator : "default");
+    AppendFormat(json, ",\n  \"preset\": ");
+    AppendJsonString(json, desc.Preset ? desc.Preset : "none");
+    AppendFormat(json, ",\n  \"device\": ");
+    AppendJsonString(json, device);
+    AppendFormat(json, ",\n  \"displayResolution\": [%u, %u],\n  \"renderResolution\": [%u, %u],\n"
+        "  \"timestep\": %.6f,\n  \"warmupFrames\": %u,\n  \"seed\": %u,\n  \"frames\": %u,\n",
+        desc.Width, desc.Height, renderWidth, renderHeight, desc.Timestep, desc.NumWarmupFrames,
+        desc.Seed, NumFrames());
+
+    AppendFormat(json, "  \"summary\": {\n");
+    AppendSummary(json, "frameMs", frame);
+    AppendFormat(json, ",\n");
+    AppendSummary(json, "cpuMs", cpu);
+    AppendFormat(json, ",\n");
+    AppendSummary(json, "gpuMs", gpu);
+    AppendFormat(json, "\n  },\n  \"passes\": [");
+
+    AppendEntries(json, m_passes);
+    AppendFormat(json, "\n  ],\n  \"tasks\": [");
+    AppendEntries(json, m_tasks);
+    AppendFormat(json, "\n  ],\n");
+
+    if (m_baselinePath)
+    {
+        AppendFormat(json, "  \"baseline\": {\n    \"path\": ");
+        AppendJsonString(json, m_baselinePath);
+        AppendFormat(json, ",\n    \"tolerancePct\": %.2f,\n    \"regressions\": %u,\n    \"entries\": [", 
+            m_tolerancePct, m_numRegressions);
+
+        for (size_t i = 0; i < m_comparisons.size(); i++)
+        {
+            const Comparison& c = m_comparisons[i];
+            AppendFormat(json, "%s\n      {\"group\": \"%s\", \"name\": ", i == 0 ? "" : ",", c.Group);
+            AppendJsonString(json, c.Name);
+            AppendFormat(json, ", \"meanMs\": %.4f, \"baselineMs\": %.4f, \"changePct\": %.2f, "
+                "\"regression\": %s}", c.MeanMs, c.BaselineMs, 
+                c.BaselineMs > 0.0f ? (c.MeanMs / c.BaselineMs - 1.0f) * 100.0f : 0.0f, 
+                c.Regressed ? "true" : "false");
+        }
+
+        AppendFormat(json, "\n    ]\n  },\n");
+    }
+
+    // Unknown values are written as null
+    AppendFormat(json, "  \"perFrame\": [");
+    auto appendVal = [&json](float v, const char* sep)
+        {
+            if (v >= 0.0f)
+                AppendFormat(json, "%.4f%s", v, sep);
+            else
+                AppendFormat(json, "null%s", sep);
+        };
+
+    for (size_t i = 0; i < m_frames.size(); i++)
+    {
+        AppendFormat(json, "%s\n    [", i == 0 ? "" : ",");
+        appendVal(m_frames[i].FrameMs, ", ");
+        appendVal(m_frames[i].CpuMs, ", ");
+        appendVal(m_frames[i].GpuMs, "]");
+    }
+
+    AppendFormat(json, "\n  ],\n  \"perFrameColumns\": [\"frameMs\", \"cpuMs\", \"gpuMs\"]\n}\n");
+
+    Filesystem::WriteToFile(path, reinterpret_cast<uint8_t*>(json.data()), (uint32_t)json.size());
+}
+
+uint32_t BenchmarkRecorder::CompareToBaseline(const char* path, float tolerancePct)
+{
+    SmallVector<uint8_t> file;
+    Filesystem::LoadFromFile(path, file);
+    file.push_back('\0');
+    const char* json = reinterpret_cast<const char*>(file.data());
+
+    Check(strstr(json, "\"summary\": {"), "%s is not a benchmark result.", path);
+
+    m_baselinePath = path;
+    m_tolerancePct = tolerancePct;
+    m_comparisons.clear();
+    m_numRegressions = 0;
+
+    auto compare = [this, tolerancePct](const char* group, const char* name, float meanMs, float baselineMs)
+        {
+            if (meanMs < 0.0f || baselineMs < 0.0f)
+                return;
+
+            const float delta = meanMs - baselineMs;
+            const bool regressed = delta > baselineMs * tolerancePct * 0.01f && delta > MIN_REGRESSION_MS;
+
+            Comparison c;
+            c.Group = group;
+            const size_t n = Math::Min(strlen(name), (size_t)MAX_PASS_NAME_LENGTH - 1);
+            memcpy(c.Name, name, n);
+            c.Name[n] = '\0';
+            c.MeanMs = meanMs;
+            c.BaselineMs = baselineMs;
+            c.Regressed = regressed;
+            m_comparisons.push_back(c);
+
+            if (regressed)
+            {
+                LOG_UI_WARNING("Benchmark: REGRESSION in %s %s: %.4f ms, baseline %.4f ms (%+.1f%%)", group, 
+                    name, meanMs, baselineMs, baselineMs > 0.0f ? (meanMs / baselineMs - 1.0f) * 100.0f : 0.0f);
+                m_numRegressions++;
+            }
+        };
+
+    Summary frame;
+    Summary cpu;
+    Summary gpu;
+    Summarize(frame, cpu, gpu);
+
+    compare("total", "frameMs", frame.Count ? frame.Mean : -1.0f, ParseSummaryMean(json, "frameMs"));
+    compare("total", "cpuMs", cpu.Count ? cpu.Mean : -1.0f, ParseSummaryMean(json, "cpuMs"));
+    compare("total", "gpuMs", gpu.Count ? gpu.Mean : -1.0f, ParseSummaryMean(json, "gpuMs"));
+
+    // Entries that only exist on one side (e.g. a new pass) aren't compared
+    auto compareEntries = [&compare, json](const char* group, const char* arrayName, 
+        const SmallVector<Pass>& entries)
+        {
+            SmallVector<BaselineEntry> baseline;
+            ParseEntries(json, arrayName, baseline);
+
+            for (auto& p : entries)
+            {
+                for (auto& b : baseline)
+                {
+                    if (strcmp(p.Name, b.Name) == 0)
+                    {
+                        compare(group, p.Name, (float)(p.TotalMs / p.Count), b.MeanMs);
+                        break;
+                    }
+                }
+            }
+        };
+
+    compareEntries("pass", "passes", m_passes);
+    compareEntries("task", "tasks", m_tasks);
+
+    return m_numRegressions;
+}
+
+BenchmarkRecorder::Summary BenchmarkRecorder::AddPassRun(float sweepValue, Span<float> replayMs)
+{
+    PassRun run;
+    run.SweepValue = sweepValue;
+    run.Ms = ::Summarize((uint32_t)replayMs.size(), [replayMs](uint32_t i) { return replayMs[i]; });
+    run.MinMs = 0.0f;
+
+    if (!replayMs.empty())
+    {
+        run.MinMs = replayMs[0];
+        for (float ms : replayMs)
+            run.MinMs = Math::Min(run.MinMs, ms);
+    }
+
+    m_passRuns.push_back(run);
+
+    return run.Ms;
+}
+
+void BenchmarkRecorder::WritePassJson(const char* path, const BenchmarkDesc& desc, const char* device,
+    uint16_t renderWidth, uint16_t renderHeight) const
+{
+    SmallVector<char> json;
+    AppendFormat(json, "{\n  \"pass\": ");
+    AppendJsonString(json, desc.Pass);
+    AppendFormat(json, ",\n  \"cameraPath\": ");
+    AppendJsonString(json, desc.CameraPath);
+    AppendFormat(json, ",\n  \"integrator\": ");
+    AppendJsonString(json, desc.Integrator ? desc.Integrator : "default");
+    AppendFormat(json, ",\n  \"preset\": ");
+    AppendJsonString(json, desc.Preset ? desc.Preset : "none");
+    AppendFormat(json, ",\n  \"device\": ");
+    AppendJsonString(json, device);
+    AppendFormat(json, ",\n  \"displayResolution\": [%u, %u],\n  \"renderResolution\": [%u, %u],\n"
+        "  \"warmupFrames\": %u,\n  \"seed\": %u,\n  \"replays\": %u,\n  \"sweep\": ",
+        desc.Width, desc.Height, renderWidth, renderHeight, desc.NumWarmupFrames, desc.Seed, 
+        desc.NumPassReps);
+
+    if (desc.Sweep)
+        AppendJsonString(json, desc.Sweep);
+    else
+        AppendFormat(json, "null");
+
+    AppendFormat(json, ",\n  \"runs\": [");
+
+    for (size_t i = 0; i < m_passRuns.size(); i++)
+    {
+        const PassRun& r = m_passRuns[i];
+        AppendFormat(json, "%s\n    {", i == 0 ? "" : ",");
+
+        if (desc.Sweep)
+            AppendFormat(json, "\"value\": %g, ", r.SweepValue);
+
+        AppendFormat(json, "\"replays\": %u, \"meanMs\": %.4f, \"minMs\": %.4f, \"p50Ms\": %.4f, "
+            "\"p95Ms\": %.4f, \"maxMs\": %.4f}", r.Ms.Count, r.Ms.Mean, r.MinMs, r.Ms.P50, r.Ms.P95, 
+            r.Ms.Max);
+    }
+
+    AppendFormat(json, "\n  ]\n}\n");
+
+    Filesystem::WriteToFile(path, reinterpret_cast<uint8_t*>(json.data()), (uint32_t)json.size());
+}
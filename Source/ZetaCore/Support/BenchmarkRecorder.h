@@ -0,0 +1,108 @@
+#pragma once
+
+#include "../Utility/SmallVector.h"
+#include "../Utility/Span.h"
+
+namespace ZetaRay::App
+{
+    struct BenchmarkDesc;
+}
+
+namespace ZetaRay::Support
+{
+    // Timings for every frame of a benchmark run (see App::BenchmarkDesc). GPU timings of a
+    // frame are resolved a few frames after its CPU timings, so the two are set separately.
+    struct BenchmarkRecorder
+    {
+        static constexpr int MAX_PASS_NAME_LENGTH = 32;
+        // Differences that are smaller are never considered regressions, regardless of the
+        // tolerance. Avoids flagging noise in passes that only take a few microseconds.
+        static constexpr float MIN_REGRESSION_MS = 0.02f;
+
+        struct Summary
+        {
+            // Number of frames with a known value
+            uint32_t Count = 0;
+            float Mean = 0.0f;
+            float P50 = 0.0f;
+            float P95 = 0.0f;
+            float P99 = 0.0f;
+            float Max = 0.0f;
+        };
+
+        BenchmarkRecorder() = default;
+        ~BenchmarkRecorder() = default;
+
+        void Reset(uint32_t numFrames);
+        void SetFrameTimes(uint32_t frame, float frameMs, float cpuMs);
+        void SetGpuTime(uint32_t frame, float gpuMs);
+        // Passes are aggregated by name over all the frames
+        void AddPassTime(const char* name, float ms);
+        // Same for CPU tasks, ms is the total for all the tasks with this name in one frame
+        void AddTaskTime(const char* name, float ms);
+        ZetaInline uint32_t NumFrames() const { return (uint32_t)m_frames.size(); }
+
+        // Frame, CPU (critical path) and GPU times respectively
+        void Summarize(Summary& frame, Summary& cpu, Summary& gpu) const;
+        void WriteJson(const char* path, const App::BenchmarkDesc& desc, const char* device,
+            uint16_t renderWidth, uint16_t renderHeight) const;
+        // Compares mean frame, CPU and GPU times along with the mean time of every pass and 
+        // CPU task against the results of an earlier run (as written by WriteJson()). A 
+        // regression is when the mean is more than tolerancePct percent (and at least 
+        // MIN_REGRESSION_MS) slower. Each regression is logged. Results are included in the 
+        // JSON output. Returns the number of regressions.
+        uint32_t CompareToBaseline(const char* path, float tolerancePct);
+
+        // Pass benchmark mode (see BenchmarkDesc::Pass) -- GPU times of the replays with one 
+        // sweep value (or of the only run without a sweep). Count is the number of replays.
+        Summary AddPassRun(float sweepValue, Util::Span<float> replayMs);
+        ZetaInline uint32_t NumPassRuns() const { return (uint32_t)m_passRuns.size(); }
+        void WritePassJson(const char* path, const App::BenchmarkDesc& desc, const char* device,
+            uint16_t renderWidth, uint16_t renderHeight) const;
+
+    private:
+        struct Frame
+        {
+            // -1 when unknown
+            float FrameMs = -1.0f;
+            float CpuMs = -1.0f;
+            float GpuMs = -1.0f;
+        };
+
+        // Also used for CPU tasks
+        struct Pass
+        {
+            char Name[MAX_PASS_NAME_LENGTH];
+            double TotalMs;
+            float MinMs;
+            float MaxMs;
+            uint32_t Count;
+        };
+
+        struct Comparison
+        {
+            // "total", "pass" or "task"
+            const char* Group;
+            char Name[MAX_PASS_NAME_LENGTH];
+            float MeanMs;
+            float BaselineMs;
+            bool Regressed;
+        };
+
+        struct PassRun
+        {
+            float SweepValue;
+            float MinMs;
+            Summary Ms;
+        };
+
+        Util::SmallVector<Frame> m_frames;
+        Util::SmallVector<Pass> m_passes;
+        Util::SmallVector<Pass> m_tasks;
+        Util::SmallVector<Comparison> m_comparisons;
+        const char* m_baselinePath = nullptr;
+        float m_tolerancePct = 0.0f;
+        uint32_t m_numRegressions = 0;
+        Util::SmallVector<PassRun> m_passRuns;
+    };
+}
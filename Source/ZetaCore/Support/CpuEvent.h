@@ -0,0 +1,37 @@
+#pragma once
+
+// CPU-side event markers for PIX timing captures (and WPA via the PIX ETW provider).
+// Compiled in when ZETA_CPU_EVENTS is defined (CMake option of the same name), otherwise
+// the macros expand to nothing and their arguments aren't evaluated.
+//
+// Usage:
+//      ZETA_CPU_EVENT_SCOPE("RenderGraph::Build");
+//      ZETA_CPU_EVENT_SCOPE("glTF::Parse %s", path);
+//      ZETA_CPU_EVENT_COUNTER(L"VRAM Usage (MB)", usageMB);
+
+#ifdef ZETA_CPU_EVENTS
+
+#include "../Win32/Win32.h"
+#ifndef USE_PIX
+#define USE_PIX
+#endif
+#include <WinPixEventRuntime/pix3.h>
+
+namespace ZetaRay::Support
+{
+    // Same color for every event, PIX groups them by thread anyway
+    static constexpr UINT64 CPU_EVENT_COLOR = PIX_COLOR_INDEX(5);
+}
+
+// Event lasts until the end of the enclosing scope
+#define ZETA_CPU_EVENT_SCOPE(...) PIXScopedEvent(ZetaRay::Support::CPU_EVENT_COLOR, __VA_ARGS__)
+#define ZETA_CPU_EVENT_MARKER(...) PIXSetMarker(ZetaRay::Support::CPU_EVENT_COLOR, __VA_ARGS__)
+#define ZETA_CPU_EVENT_COUNTER(name, value) PIXReportCounter(name, (float)(value))
+
+#else
+
+#define ZETA_CPU_EVENT_SCOPE(...)
+#define ZETA_CPU_EVENT_MARKER(...)
+#define ZETA_CPU_EVENT_COUNTER(name, value)
+
+#endif
@@ -5,7 +5,10 @@
 
 namespace ZetaRay::Support
 {
-    template<size_t BlockSize>
+    // Memory is handed out in blocks of BaseBlockSize bytes. Block size can grow (up to 
+    // MAX_BLOCK_SIZE) when larger allocations are observed and shrinks back afterwards. 
+    // Blocks that haven't been used for a number of frames are freed.
+    template<size_t BaseBlockSize>
     struct FrameMemory
     {
         FrameMemory()
@@ -28,6 +31,7 @@ namespace ZetaRay::Support
         {
             void* Start;
             uintptr_t Offset;
+            size_t Size;
             int UsageCounter;
         };
 
@@ -37,8 +41,9 @@ namespace ZetaRay::Support
 
             if (!m_blocks[i].Start)
             {
-                m_blocks[i].Start = malloc(BLOCK_SIZE);
+                m_blocks[i].Start = malloc(m_blockSize);
                 m_blocks[i].Offset = 0;
+                m_blocks[i].Size = m_blockSize;
             }
 
             m_blocks[i].UsageCounter = NUM_FRAMES_TO_FREE_DELAY;
@@ -46,8 +51,14 @@ namespace ZetaRay::Support
             return m_blocks[i];
         }
 
-        void Reset()
+        // Must be called when there aren't any ongoing allocations. Blocks with a size 
+        // other than the new block size are freed and reallocated on next use.
+        void Reset(size_t newBlockSize = BaseBlockSize)
         {
+            Assert(newBlockSize >= BASE_BLOCK_SIZE && newBlockSize <= MAX_BLOCK_SIZE,
+                "Block size is out of range.");
+            m_blockSize = newBlockSize;
+
             for (int i = 0; i < NUM_BLOCKS; i++)
             {
                 m_blocks[i].Offset = 0;
@@ -56,7 +67,8 @@ namespace ZetaRay::Support
                     NUM_FRAMES_TO_FREE_DELAY :
                     m_blocks[i].UsageCounter - 1;
 
-                if (m_blocks[i].UsageCounter == 0)
+                if (m_blocks[i].Start && 
+                    (m_blocks[i].UsageCounter == 0 || m_blocks[i].Size != m_blockSize))
                 {
                     free(m_blocks[i].Start);
                     m_blocks[i].Start = nullptr;
@@ -64,23 +76,37 @@ namespace ZetaRay::Support
             }
         }
 
-        size_t TotalSize()
+        size_t TotalSize() const
         {
             size_t sum = 0;
 
             for (int i = 0; i < NUM_BLOCKS; i++)
             {
                 if (m_blocks[i].Start)
-                    sum += BLOCK_SIZE;
+                    sum += m_blocks[i].Size;
             }
 
             return sum;
         }
 
-        static constexpr int NUM_BLOCKS = MAX_NUM_THREADS * 2;
+        int NumAllocatedBlocks() const
+        {
+            int n = 0;
+
+            for (int i = 0; i < NUM_BLOCKS; i++)
+                n += m_blocks[i].Start != nullptr;
+
+            return n;
+        }
+
+        ZetaInline size_t BlockSize() const { return m_blockSize; }
+
+        static constexpr int NUM_BLOCKS = MAX_NUM_THREADS * 4;
         static constexpr int NUM_FRAMES_TO_FREE_DELAY = 10;
-        static constexpr size_t BLOCK_SIZE = BlockSize;
+        static constexpr size_t BASE_BLOCK_SIZE = BaseBlockSize;
+        static constexpr size_t MAX_BLOCK_SIZE = BaseBlockSize * 16;
 
         MemoryBlock m_blocks[NUM_BLOCKS];
+        size_t m_blockSize = BaseBlockSize;
     };
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "FrameTimeStats.h"
+#include <algorithm>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+
+namespace
+{
+    // Nearest rank, with a small tolerance so that e.g. p = 0.99 with 100 frames isn't 
+    // rounded up to the maximum due to floating-point error
+    ZetaInline int Rank(float p, int n)
+    {
+        const int k = (int)ceilf(p * n - 1e-3f) - 1;
+        return Math::Min(Math::Max(k, 0), n - 1);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// FrameTimeStats
+//--------------------------------------------------------------------------------------
+
+void FrameTimeStats::Add(float frameMs, float cpuMs, float gpuMs)
+{
+    const uint32_t idx = m_numAdded & (WINDOW_SIZE - 1);
+    m_frameTime[idx] = frameMs;
+    m_gpuBound[idx] = cpuMs < 0.0f || gpuMs < 0.0f ? -1 : (gpuMs > cpuMs ? 1 : 0);
+    m_numAdded++;
+}
+
+int FrameTimeStats::CopyWindow(float* sorted) const
+{
+    const int n = NumFrames();
+    memcpy(sorted, m_frameTime, sizeof(float) * n);
+
+    return n;
+}
+
+float FrameTimeStats::Percentile(float p) const
+{
+    float sorted[WINDOW_SIZE];
+    const int n = CopyWindow(sorted);
+    if (n == 0)
+        return 0.0f;
+
+    const int k = Rank(p, n);
+    std::nth_element(sorted, sorted + k, sorted + n);
+
+    return sorted[k];
+}
+
+bool FrameTimeStats::IsHitch(float frameMs, float minMs, float relToMedian) const
+{
+    if (NumFrames() < MIN_FRAMES_FOR_HITCH)
+        return false;
+
+    return frameMs > Math::Max(minMs, relToMedian * Percentile(0.5f));
+}
+
+FrameTimeStats::Summary FrameTimeStats::Compute() const
+{
+    Summary ret;
+    float sorted[WINDOW_SIZE];
+    const int n = CopyWindow(sorted);
+    if (n == 0)
+        return ret;
+
+    // Each nth_element() call partitions the range around the k'th element, so the
+    // next (larger) percentile only needs to search the upper part
+    auto select = [&sorted, n](float p, int begin)
+        {
+            const int k = Math::Max(Rank(p, n), begin);
+            std::nth_element(sorted + begin, sorted + k, sorted + n);
+
+            return k;
+        };
+
+    const int k50 = select(0.5f, 0);
+    ret.P50 = sorted[k50];
+    const int k95 = select(0.95f, k50);
+    ret.P95 = sorted[k95];
+    const int k99 = select(0.99f, k95);
+    ret.P99 = sorted[k99];
+    ret.Max = *std::max_element(sorted + k99, sorted + n);
+
+    int numKnown = 0;
+    int numGpuBound = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        numKnown += m_gpuBound[i] >= 0;
+        numGpuBound += m_gpuBound[i] == 1;
+    }
+
+    ret.GpuBoundFraction = numKnown ? (float)numGpuBound / numKnown : 0.0f;
+
+    return ret;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../Utility/Error.h"
+#include "../Math/Common.h"
+
+namespace ZetaRay::Support
+{
+    // Rolling statistics over the last WINDOW_SIZE frames. Averages hide stutters, so
+    // frame times are summarized by their percentiles, along with how often the GPU
+    // (rather than CPU) was the bottleneck.
+    struct FrameTimeStats
+    {
+        static constexpr int WINDOW_SIZE = 256;
+        static_assert(Math::IsPow2(WINDOW_SIZE), "Window size must be a power of two.");
+        // Too few samples for the median to be meaningful
+        static constexpr int MIN_FRAMES_FOR_HITCH = 30;
+
+        struct Summary
+        {
+            float P50 = 0.0f;
+            float P95 = 0.0f;
+            float P99 = 0.0f;
+            float Max = 0.0f;
+            // Fraction of the frames (with both CPU and GPU times known) where GPU took longer
+            float GpuBoundFraction = 0.0f;
+        };
+
+        FrameTimeStats() = default;
+        ~FrameTimeStats() = default;
+
+        // cpuMs is the CPU's critical path and gpuMs is the GPU's busy time for the same
+        // frame -- either can be negative when unknown
+        void Add(float frameMs, float cpuMs = -1.0f, float gpuMs = -1.0f);
+        // Returns true if given frame time is larger than both minMs and "relToMedian"
+        // times the median of the current window
+        bool IsHitch(float frameMs, float minMs, float relToMedian) const;
+        // Linear in the number of frames
+        Summary Compute() const;
+        // Nearest-rank percentile, p in [0, 1]
+        float Percentile(float p) const;
+        ZetaInline int NumFrames() const { return Math::Min(m_numAdded, (uint64_t)WINDOW_SIZE); }
+        ZetaInline uint64_t NumAdded() const { return m_numAdded; }
+
+    private:
+        // Copies the window to "sorted" and returns the number of frames
+        int CopyWindow(float* sorted) const;
+
+        float m_frameTime[WINDOW_SIZE] = { 0.0f };
+        // 1 if GPU bound, 0 if CPU bound, -1 if unknown
+        int8_t m_gpuBound[WINDOW_SIZE] = { 0 };
+        uint64_t m_numAdded = 0;
+    };
+}
@@ -0,0 +1,285 @@
+#include "InputRecording.h"
+#include "../App/Filesystem.h"
+
+using namespace ZetaRay;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+
+namespace
+{
+    struct RecordingHeader
+    {
+        static constexpr uint32_t MAGIC = 0x43455249;   // "IREC"
+        static constexpr uint32_t VERSION = 1;
+
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t FirstFrameNum;
+        float CameraPos[3];
+        float CameraViewDir[3];
+        uint32_t NumInitialParams;
+        uint32_t NumFrames;
+        uint32_t NumParamChanges;
+        uint32_t NumPicks;
+    };
+
+    template<typename T>
+    void Append(SmallVector<uint8_t>& out, const T* data, size_t n)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        out.append_range(bytes, bytes + n * sizeof(T));
+    }
+
+    template<typename T>
+    bool Read(Span<uint8_t> data, size_t& offset, SmallVector<T>& vec, size_t n)
+    {
+        if (data.size() - offset < n * sizeof(T))
+            return false;
+
+        vec.resize(n);
+        if (n)
+            memcpy(vec.data(), data.data() + offset, n * sizeof(T));
+
+        offset += n * sizeof(T);
+
+        return true;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// InputRecording
+//--------------------------------------------------------------------------------------
+
+InputRecording::ParamChange InputRecording::CaptureParam(const ParamVariant& p)
+{
+    ParamChange c;
+    c.ID = p.ID();
+    c.Type = p.GetType();
+    c.Float[0] = c.Float[1] = c.Float[2] = 0.0f;
+
+    switch (p.GetType())
+    {
+    case PARAM_TYPE::PT_float:
+        c.Float[0] = p.GetFloat().m_value;
+        break;
+    case PARAM_TYPE::PT_float2:
+        c.Float[0] = p.GetFloat2().m_value.x;
+        c.Float[1] = p.GetFloat2().m_value.y;
+        break;
+    case PARAM_TYPE::PT_float3:
+        c.Float[0] = p.GetFloat3().m_value.x;
+        c.Float[1] = p.GetFloat3().m_value.y;
+        c.Float[2] = p.GetFloat3().m_value.z;
+        break;
+    case PARAM_TYPE::PT_color:
+        c.Float[0] = p.GetColor().m_value.x;
+        c.Float[1] = p.GetColor().m_value.y;
+        c.Float[2] = p.GetColor().m_value.z;
+        break;
+    case PARAM_TYPE::PT_unit_dir:
+        c.Float[0] = p.GetUnitDir().m_pitch;
+        c.Float[1] = p.GetUnitDir().m_yaw;
+        break;
+    case PARAM_TYPE::PT_int:
+        c.Int = p.GetInt().m_value;
+        break;
+    case PARAM_TYPE::PT_bool:
+        c.Int = p.GetBool();
+        break;
+    case PARAM_TYPE::PT_enum:
+        c.Int = p.GetEnum().m_curr;
+        break;
+    default:
+        Assert(false, "Unknown parameter type.");
+    }
+
+    return c;
+}
+
+bool InputRecording::ApplyParam(const ParamChange& c, ParamVariant& p)
+{
+    if (c.ID != p.ID() || c.Type != p.GetType())
+        return false;
+
+    const ParamChange curr = CaptureParam(p);
+    if (memcmp(curr.Float, c.Float, sizeof(c.Float)) == 0)
+        return false;
+
+    switch (c.Type)
+    {
+    case PARAM_TYPE::PT_float:
+        p.SetFloat(c.Float[0]);
+        break;
+    case PARAM_TYPE::PT_float2:
+        p.SetFloat2(float2(c.Float[0], c.Float[1]));
+        break;
+    case PARAM_TYPE::PT_float3:
+        p.SetFloat3(float3(c.Float[0], c.Float[1], c.Float[2]));
+        break;
+    case PARAM_TYPE::PT_color:
+        p.SetColor(float3(c.Float[0], c.Float[1], c.Float[2]));
+        break;
+    case PARAM_TYPE::PT_unit_dir:
+        p.SetUnitDir(c.Float[0], c.Float[1]);
+        break;
+    case PARAM_TYPE::PT_int:
+        p.SetInt(c.Int);
+        break;
+    case PARAM_TYPE::PT_bool:
+        p.SetBool(c.Int != 0);
+        break;
+    case PARAM_TYPE::PT_enum:
+        p.SetEnum(c.Int);
+        break;
+    default:
+        Assert(false, "Unknown parameter type.");
+    }
+
+    return true;
+}
+
+void InputRecording::Begin(uint64_t frameNum, const float3& cameraPos, const float3& viewDir)
+{
+    m_initialParams.clear();
+    m_frames.clear();
+    m_paramChanges.clear();
+    m_picks.clear();
+    m_firstFrameNum = frameNum;
+    m_cameraPos = cameraPos;
+    m_cameraViewDir = viewDir;
+    m_nextFrame = 0;
+    m_nextParamChange = 0;
+    m_nextPick = 0;
+}
+
+void InputRecording::AddInitialParam(const ParamVariant& p)
+{
+    Assert(m_frames.empty(), "Initial parameters must be added before the first frame.");
+    m_initialParams.push_back(CaptureParam(p));
+}
+
+void InputRecording::AddFrame(float timestep, const float3& acceleration, int16_t dMouseX,
+    int16_t dMouseY)
+{
+    m_frames.push_back(Frame{ .Timestep = timestep,
+        .Acceleration = acceleration,
+        .dMouseX = dMouseX,
+        .dMouseY = dMouseY,
+        .NumParamChanges = 0,
+        .NumPicks = 0 });
+}
+
+void InputRecording::AddParamChange(const ParamVariant& p)
+{
+    Assert(!m_frames.empty(), "No frame has been added.");
+    Assert(m_frames.back().NumParamChanges < UINT16_MAX, "Too many parameter changes in one frame.");
+
+    m_paramChanges.push_back(CaptureParam(p));
+    m_frames.back().NumParamChanges++;
+}
+
+void InputRecording::AddPick(PICK_TYPE type, uint16_t x, uint16_t y)
+{
+    Assert(!m_frames.empty(), "No frame has been added.");
+    Assert(m_frames.back().NumPicks < UINT16_MAX, "Too many picks in one frame.");
+
+    m_picks.push_back(Pick{ .X = x, .Y = y, .Type = type });
+    m_frames.back().NumPicks++;
+}
+
+void InputRecording::Serialize(SmallVector<uint8_t>& out) const
+{
+    const RecordingHeader header{ .Magic = RecordingHeader::MAGIC,
+        .Version = RecordingHeader::VERSION,
+        .FirstFrameNum = m_firstFrameNum,
+        .CameraPos = { m_cameraPos.x, m_cameraPos.y, m_cameraPos.z },
+        .CameraViewDir = { m_cameraViewDir.x, m_cameraViewDir.y, m_cameraViewDir.z },
+        .NumInitialParams = (uint32_t)m_initialParams.size(),
+        .NumFrames = (uint32_t)m_frames.size(),
+        .NumParamChanges = (uint32_t)m_paramChanges.size(),
+        .NumPicks = (uint32_t)m_picks.size() };
+
+    out.clear();
+    out.reserve(sizeof(header) + m_initialParams.size() * sizeof(ParamChange) +
+        m_frames.size() * sizeof(Frame) + m_paramChanges.size() * sizeof(ParamChange) +
+        m_picks.size() * sizeof(Pick));
+
+    Append(out, &header, 1);
+    Append(out, m_initialParams.data(), m_initialParams.size());
+    Append(out, m_frames.data(), m_frames.size());
+    Append(out, m_paramChanges.data(), m_paramChanges.size());
+    Append(out, m_picks.data(), m_picks.size());
+}
+
+bool InputRecording::Deserialize(Span<uint8_t> data)
+{
+    RecordingHeader header;
+    if (data.size() < sizeof(header))
+        return false;
+
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.Magic != RecordingHeader::MAGIC || header.Version != RecordingHeader::VERSION)
+        return false;
+
+    size_t offset = sizeof(header);
+    if (!Read(data, offset, m_initialParams, header.NumInitialParams) ||
+        !Read(data, offset, m_frames, header.NumFrames) ||
+        !Read(data, offset, m_paramChanges, header.NumParamChanges) ||
+        !Read(data, offset, m_picks, header.NumPicks))
+    {
+        return false;
+    }
+
+    // Per-frame counts must add up to the totals
+    size_t numParamChanges = 0;
+    size_t numPicks = 0;
+    for (auto& f : m_frames)
+    {
+        numParamChanges += f.NumParamChanges;
+        numPicks += f.NumPicks;
+    }
+
+    if (numParamChanges != m_paramChanges.size() || numPicks != m_picks.size())
+        return false;
+
+    m_firstFrameNum = header.FirstFrameNum;
+    m_cameraPos = float3(header.CameraPos[0], header.CameraPos[1], header.CameraPos[2]);
+    m_cameraViewDir = float3(header.CameraViewDir[0], header.CameraViewDir[1], header.CameraViewDir[2]);
+    m_nextFrame = 0;
+    m_nextParamChange = 0;
+    m_nextPick = 0;
+
+    return true;
+}
+
+void InputRecording::Save(const char* path) const
+{
+    SmallVector<uint8_t> file;
+    Serialize(file);
+    Filesystem::WriteToFile(path, file.data(), (uint32_t)file.size());
+}
+
+bool InputRecording::Load(const char* path)
+{
+    SmallVector<uint8_t> file;
+    Filesystem::LoadFromFile(path, file);
+
+    return Deserialize(file);
+}
+
+bool InputRecording::NextFrame(Frame& frame, Span<ParamChange>& paramChanges,
+    Span<Pick>& picks)
+{
+    if (m_nextFrame == m_frames.size())
+        return false;
+
+    frame = m_frames[m_nextFrame++];
+    paramChanges = Span(m_paramChanges.data() + m_nextParamChange, frame.NumParamChanges);
+    picks = Span(m_picks.data() + m_nextPick, frame.NumPicks);
+    m_nextParamChange += frame.NumParamChanges;
+    m_nextPick += frame.NumPicks;
+
+    return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Param.h"
+#include "../Utility/SmallVector.h"
+#include "../Utility/Span.h"
+
+namespace ZetaRay::Support
+{
+    // Everything that drives an interactive session from one frame to the next --
+    // simulation timestep, camera motion, parameter changes and picks -- so that the
+    // session can be replayed deterministically, e.g. to reproduce a hitch on another
+    // machine. Stored as a compact binary file: header, parameter values at the start,
+    // one record per frame and then parameter changes and picks in frame order.
+    struct InputRecording
+    {
+        struct Frame
+        {
+            float Timestep;
+            Math::float3 Acceleration;
+            int16_t dMouseX;
+            int16_t dMouseY;
+            uint16_t NumParamChanges;
+            uint16_t NumPicks;
+        };
+
+        // Value of a parameter after it was changed, applied through the setter for its
+        // type. Float, float2, float3 and color use Float, unit direction uses (pitch, yaw)
+        // and int, bool and enum use Int.
+        struct ParamChange
+        {
+            uint64_t ID;
+            PARAM_TYPE Type;
+            union
+            {
+                float Float[3];
+                int32_t Int;
+            };
+        };
+
+        enum class PICK_TYPE : uint16_t
+        {
+            PICK,
+            MULTI_PICK,
+            CLEAR
+        };
+
+        struct Pick
+        {
+            uint16_t X;
+            uint16_t Y;
+            PICK_TYPE Type;
+        };
+
+        static ParamChange CaptureParam(const ParamVariant& p);
+        // Returns false when the value is not for this parameter or is the same as its
+        // current value, in which case nothing is changed
+        static bool ApplyParam(const ParamChange& c, ParamVariant& p);
+
+        InputRecording() = default;
+        ~InputRecording() = default;
+        InputRecording(const InputRecording&) = delete;
+        InputRecording& operator=(const InputRecording&) = delete;
+
+        // Recording. Camera is placed at the given pose (with zero velocity) once the
+        // recording starts and once again at the start of playback.
+        void Begin(uint64_t frameNum, const Math::float3& cameraPos, const Math::float3& viewDir);
+        // Only valid before the first frame
+        void AddInitialParam(const ParamVariant& p);
+        void AddFrame(float timestep, const Math::float3& acceleration, int16_t dMouseX,
+            int16_t dMouseY);
+        // Following are added to the last frame
+        void AddParamChange(const ParamVariant& p);
+        void AddPick(PICK_TYPE type, uint16_t x, uint16_t y);
+
+        void Serialize(Util::SmallVector<uint8_t>& out) const;
+        // Returns false when data isn't a valid recording
+        bool Deserialize(Util::Span<uint8_t> data);
+        void Save(const char* path) const;
+        bool Load(const char* path);
+
+        // Playback, in frame order. Returns false once all the frames have been played.
+        bool NextFrame(Frame& frame, Util::Span<ParamChange>& paramChanges,
+            Util::Span<Pick>& picks);
+        ZetaInline Util::Span<ParamChange> InitialParams() const { return m_initialParams; }
+        ZetaInline uint64_t FirstFrameNum() const { return m_firstFrameNum; }
+        ZetaInline const Math::float3& CameraPos() const { return m_cameraPos; }
+        ZetaInline const Math::float3& CameraViewDir() const { return m_cameraViewDir; }
+        ZetaInline size_t NumFrames() const { return m_frames.size(); }
+        // Index of the frame that NextFrame() returns next
+        ZetaInline size_t CurrFrame() const { return m_nextFrame; }
+
+    private:
+        Util::SmallVector<ParamChange> m_initialParams;
+        Util::SmallVector<Frame> m_frames;
+        Util::SmallVector<ParamChange> m_paramChanges;
+        Util::SmallVector<Pick> m_picks;
+        uint64_t m_firstFrameNum = 0;
+        Math::float3 m_cameraPos;
+        Math::float3 m_cameraViewDir;
+
+        size_t m_nextFrame = 0;
+        size_t m_nextParamChange = 0;
+        size_t m_nextPick = 0;
+    };
+}
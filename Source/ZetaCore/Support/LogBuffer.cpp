@@ -0,0 +1,230 @@
+#include "LogBuffer.h"
+#include "../App/Timer.h"
+#include "../Win32/Win32.h"
+#include <algorithm>
+
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+
+namespace
+{
+    // Appends to buffer when there's room left, but always returns the full length
+    // (same as snprintf)
+    template<typename T>
+    int Print(char* buffer, int size, int offset, const char* spec, T val)
+    {
+        const bool fits = buffer && offset < size;
+        return stbsp_snprintf(fits ? buffer + offset : nullptr, fits ? size - offset : 0,
+            spec, val);
+    }
+
+    ZetaInline int64_t SignExtend(uint64_t bits, int numBytes)
+    {
+        const int shift = 64 - numBytes * 8;
+        return (int64_t)(bits << shift) >> shift;
+    }
+
+    ZetaInline uint64_t ZeroExtend(uint64_t bits, int numBytes)
+    {
+        return numBytes == 8 ? bits : bits & ((1llu << (numBytes * 8)) - 1);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// LogBuffer
+//--------------------------------------------------------------------------------------
+
+LogBuffer::Entry* LogBuffer::Begin(LogMessage::MsgType t, const char* fmt)
+{
+    if (m_disabled || g_threadIdx < 0 || g_threadIdx >= MAX_NUM_THREADS)
+        return nullptr;
+
+    ThreadBuffer& buffer = m_buffers[g_threadIdx];
+    const uint64_t head = buffer.Head.load(std::memory_order_relaxed);
+
+    // Consumer hasn't caught up yet
+    if (head - buffer.Tail.load(std::memory_order_acquire) == NUM_ENTRIES_PER_THREAD)
+        return nullptr;
+
+    Entry& e = buffer.Entries[head & (NUM_ENTRIES_PER_THREAD - 1)];
+    e.Fmt = fmt;
+    e.Seq = m_nextSeq.fetch_add(1, std::memory_order_relaxed);
+    e.FrameIdx = (uint32_t)App::GetTimer().GetTotalFrameCount();
+    e.ThreadID = GetCurrentThreadId();
+    e.Type = t;
+    e.StringsSize = 0;
+    e.NumArgs = 0;
+
+    return &e;
+}
+
+void LogBuffer::End()
+{
+    ThreadBuffer& buffer = m_buffers[g_threadIdx];
+    const uint64_t head = buffer.Head.load(std::memory_order_relaxed);
+
+    // Publish
+    buffer.Head.store(head + 1, std::memory_order_release);
+}
+
+int LogBuffer::Format(const Entry& e, char* buffer, int size)
+{
+    int n = 0;
+    int currArg = 0;
+    const char* c = e.Fmt;
+
+    while (*c != '\0')
+    {
+        if (*c != '%')
+        {
+            if (buffer && n < size - 1)
+                buffer[n] = *c;
+
+            n++;
+            c++;
+            continue;
+        }
+
+        // Copy everything up to the conversion specifier, minus the length modifiers
+        // -- integers are always passed as 64-bit
+        char spec[32];
+        int specLen = 0;
+        spec[specLen++] = *c++;
+
+        while (*c != '\0' && strchr("-+ #0123456789.", *c) && specLen < (int)sizeof(spec) - 4)
+            spec[specLen++] = *c++;
+        while (*c != '\0' && strchr("hljztL", *c))
+            c++;
+
+        if (*c == '\0')
+            break;
+
+        const char conversion = *c++;
+
+        if (conversion == '%')
+        {
+            if (buffer && n < size - 1)
+                buffer[n] = '%';
+
+            n++;
+            continue;
+        }
+
+        Assert(currArg < e.NumArgs, "Format string %s expects more arguments.", e.Fmt);
+        if (currArg >= e.NumArgs)
+            break;
+
+        const uint64_t arg = e.Args[currArg];
+        const ARG_TYPE argType = e.ArgTypes[currArg];
+        const int argSize = argType == ARG_TYPE::INTEGER ? e.ArgSizes[currArg] : 8;
+        currArg++;
+
+        double argAsDouble;
+        memcpy(&argAsDouble, &arg, sizeof(double));
+
+        switch (conversion)
+        {
+        case 'd':
+        case 'i':
+            spec[specLen++] = 'l';
+            spec[specLen++] = 'l';
+            spec[specLen++] = conversion;
+            spec[specLen] = '\0';
+            n += Print(buffer, size, n, spec, argType == ARG_TYPE::FLOAT ?
+                (long long)argAsDouble : (long long)SignExtend(arg, argSize));
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'b':
+        case 'B':
+            spec[specLen++] = 'l';
+            spec[specLen++] = 'l';
+            spec[specLen++] = conversion;
+            spec[specLen] = '\0';
+            n += Print(buffer, size, n, spec, argType == ARG_TYPE::FLOAT ?
+                (unsigned long long)argAsDouble : (unsigned long long)ZeroExtend(arg, argSize));
+            break;
+        case 'c':
+            spec[specLen++] = conversion;
+            spec[specLen] = '\0';
+            n += Print(buffer, size, n, spec, (int)arg);
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            spec[specLen++] = conversion;
+            spec[specLen] = '\0';
+            n += Print(buffer, size, n, spec, argType == ARG_TYPE::FLOAT ?
+                argAsDouble : (double)SignExtend(arg, argSize));
+            break;
+        case 's':
+            spec[specLen++] = conversion;
+            spec[specLen] = '\0';
+            n += Print(buffer, size, n, spec, argType == ARG_TYPE::STRING ?
+                e.Strings + arg : "(invalid)");
+            break;
+        case 'p':
+            spec[specLen++] = conversion;
+            spec[specLen] = '\0';
+            n += Print(buffer, size, n, spec, reinterpret_cast<void*>((uintptr_t)arg));
+            break;
+        default:
+            Assert(false, "Unsupported conversion specifier %c in format string %s.",
+                conversion, e.Fmt);
+            break;
+        }
+    }
+
+    if (buffer && size > 0)
+        buffer[Math::Min(n, size - 1)] = '\0';
+
+    return n;
+}
+
+void LogBuffer::Drain(Vector<Message>& msgs, Vector<char>& text)
+{
+    const size_t first = msgs.size();
+
+    for (int t = 0; t < MAX_NUM_THREADS; t++)
+    {
+        ThreadBuffer& buffer = m_buffers[t];
+        const uint64_t head = buffer.Head.load(std::memory_order_acquire);
+        const uint64_t tail = buffer.Tail.load(std::memory_order_relaxed);
+
+        for (uint64_t i = tail; i < head; i++)
+        {
+            const Entry& e = buffer.Entries[i & (NUM_ENTRIES_PER_THREAD - 1)];
+            const int n = Format(e, nullptr, 0);
+            const size_t offset = text.size();
+
+            // Grow geometrically to avoid reallocating on every message
+            if (offset + n + 1 > text.capacity())
+                text.reserve(Math::Max(text.capacity() * 2, offset + n + 1));
+
+            text.resize(offset + n + 1);
+            Format(e, text.data() + offset, n + 1);
+
+            msgs.push_back(Message{ .Seq = e.Seq,
+                .Offset = (uint32_t)offset,
+                .FrameIdx = e.FrameIdx,
+                .ThreadID = e.ThreadID,
+                .Type = e.Type });
+        }
+
+        // Entries can be reused by the owner thread
+        buffer.Tail.store(head, std::memory_order_release);
+    }
+
+    std::sort(msgs.begin() + first, msgs.end(), [](const Message& a, const Message& b)
+        {
+            return a.Seq < b.Seq;
+        });
+}
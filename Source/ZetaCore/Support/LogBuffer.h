@@ -0,0 +1,159 @@
+#pragma once
+
+#include "../App/App.h"
+#include "../Utility/SmallVector.h"
+#include <atomic>
+#include <type_traits>
+#include <string.h>
+
+namespace ZetaRay::Support
+{
+    // Queue for log messages that defers formatting to the consumer. Producers only copy
+    // the format string pointer and arguments (strings are copied by value) into a ring
+    // buffer that belongs to the calling thread, so logging from worker threads doesn't
+    // take a lock or allocate. Main thread drains all the buffers once per frame.
+    struct LogBuffer
+    {
+        static constexpr int MAX_ARGS = 12;
+        static constexpr int STRING_CAPACITY = 320;
+        static constexpr uint32_t NUM_ENTRIES_PER_THREAD = 128;
+        static_assert(Math::IsPow2(NUM_ENTRIES_PER_THREAD), "Ring buffer size must be a power of two.");
+
+        enum class ARG_TYPE : uint8_t
+        {
+            INTEGER,
+            FLOAT,
+            STRING,
+            POINTER
+        };
+
+        struct alignas(64) Entry
+        {
+            // Must outlive the entry, e.g. a string literal
+            const char* Fmt;
+            // Orders messages across threads
+            uint64_t Seq;
+            // Integers are sign- or zero-extended, floats are stored as double and
+            // strings as offset into Strings
+            uint64_t Args[MAX_ARGS];
+            uint32_t FrameIdx;
+            uint32_t ThreadID;
+            App::LogMessage::MsgType Type;
+            uint16_t StringsSize;
+            uint8_t NumArgs;
+            ARG_TYPE ArgTypes[MAX_ARGS];
+            // Size of the original integer type
+            uint8_t ArgSizes[MAX_ARGS];
+            char Strings[STRING_CAPACITY];
+        };
+
+        static_assert(sizeof(Entry) == 512);
+
+        struct Message
+        {
+            uint64_t Seq;
+            // Offset of the formatted (null-terminated) message in the text buffer
+            uint32_t Offset;
+            uint32_t FrameIdx;
+            uint32_t ThreadID;
+            App::LogMessage::MsgType Type;
+        };
+
+        LogBuffer() = default;
+        ~LogBuffer() = default;
+        LogBuffer(const LogBuffer&) = delete;
+        LogBuffer& operator=(const LogBuffer&) = delete;
+
+        // Returns false when the message couldn't be queued -- calling thread doesn't have
+        // a ring buffer (g_threadIdx isn't set), the buffer is full, or the strings don't fit
+        // -- in which case caller should format it right away. Supports the subset of printf
+        // that's used for logging: flags, width and precision (but not '*') and length
+        // modifiers, which are ignored as argument types are known.
+        template<typename... Args>
+        bool Push(App::LogMessage::MsgType t, const char* fmt, Args... args)
+        {
+            static_assert(sizeof...(Args) <= MAX_ARGS, "Too many arguments.");
+
+            Entry* e = Begin(t, fmt);
+            if (!e)
+                return false;
+
+            // Entry isn't published unless every argument fits
+            if (!(Capture(*e, args) && ...))
+                return false;
+
+            End();
+            return true;
+        }
+
+        // Push() fails afterwards, e.g. when there isn't a consumer. Must be called before
+        // any thread starts logging.
+        void Disable() { m_disabled = true; }
+
+        // Formats all the queued messages, appending them to "msgs" in the order that they
+        // were logged and their text to "text". Must be called from one thread at a time.
+        void Drain(Util::Vector<Message>& msgs, Util::Vector<char>& text);
+        // Formats a single entry, same return value as snprintf
+        static int Format(const Entry& e, char* buffer, int size);
+
+    private:
+        struct alignas(64) ThreadBuffer
+        {
+            Entry Entries[NUM_ENTRIES_PER_THREAD];
+            // Only written by the owner thread
+            alignas(64) std::atomic_uint64_t Head = 0;
+            // Only written by the consumer
+            alignas(64) std::atomic_uint64_t Tail = 0;
+        };
+
+        // Returns the next free entry of the calling thread's buffer without publishing it
+        Entry* Begin(App::LogMessage::MsgType t, const char* fmt);
+        void End();
+
+        template<typename T>
+        static ZetaInline bool Capture(Entry& e, T arg)
+        {
+            const int i = e.NumArgs++;
+
+            if constexpr (std::is_integral_v<T> || std::is_enum_v<T>)
+            {
+                using I = typename std::conditional_t<std::is_enum_v<T>, std::underlying_type<T>, 
+                    std::type_identity<T>>::type;
+                e.Args[i] = std::is_signed_v<I> ? (uint64_t)(int64_t)(I)arg : (uint64_t)(I)arg;
+                e.ArgTypes[i] = ARG_TYPE::INTEGER;
+                e.ArgSizes[i] = sizeof(I);
+            }
+            else if constexpr (std::is_floating_point_v<T>)
+            {
+                const double d = (double)arg;
+                memcpy(&e.Args[i], &d, sizeof(double));
+                e.ArgTypes[i] = ARG_TYPE::FLOAT;
+            }
+            else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>)
+            {
+                const char* str = arg ? arg : "(null)";
+                const size_t len = strlen(str) + 1;
+                if (e.StringsSize + len > STRING_CAPACITY)
+                    return false;
+
+                memcpy(e.Strings + e.StringsSize, str, len);
+                e.Args[i] = e.StringsSize;
+                e.ArgTypes[i] = ARG_TYPE::STRING;
+                e.StringsSize += (uint16_t)len;
+            }
+            else if constexpr (std::is_pointer_v<T>)
+            {
+                e.Args[i] = (uint64_t)reinterpret_cast<uintptr_t>(arg);
+                e.ArgTypes[i] = ARG_TYPE::POINTER;
+            }
+            else
+                static_assert(sizeof(T) == 0, "Unsupported argument type.");
+
+            return true;
+        }
+
+        ThreadBuffer m_buffers[MAX_NUM_THREADS];
+        std::atomic_uint64_t m_nextSeq = 0;
+        bool m_disabled = false;
+    };
+}
@@ -16,6 +16,15 @@ namespace ZetaRay::Support
             { t.FreeAligned(mem, s, a) } -> std::same_as<void>;
         };
 
+    // Allocators that can resize an existing allocation, either in place or by moving 
+    // its contents (memcpy) to a new block
+    template<typename T>
+    concept ReallocatingAllocatorType = AllocatorType<T> &&
+        requires(T t, void* mem, size_t s, size_t a)
+        {
+            { t.ReallocateAligned(mem, s, s, a) } -> std::same_as<void*>;
+        };
+
     struct SystemAllocator
     {
         ZetaInline void* AllocateAligned(size_t size, size_t alignment)
@@ -27,5 +36,10 @@ namespace ZetaRay::Support
         {
             _aligned_free(mem);
         }
+
+        ZetaInline void* ReallocateAligned(void* mem, size_t oldSize, size_t newSize, size_t alignment)
+        {
+            return _aligned_realloc(mem, newSize, alignment);
+        }
     };
 }
@@ -1,8 +1,40 @@
 #include "MemoryArena.h"
+#include "../App/Log.h"
+#include "../Win32/Win32.h"
 
+using namespace ZetaRay;
 using namespace ZetaRay::Support;
 using namespace ZetaRay::Math;
 
+namespace
+{
+    // Large pages require SeLockMemoryPrivilege to be enabled for the process token
+    bool EnableLockMemoryPrivilege()
+    {
+        static const bool enabled = []()
+            {
+                HANDLE token;
+                if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+                    return false;
+
+                TOKEN_PRIVILEGES tp;
+                tp.PrivilegeCount = 1;
+                tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+                bool success = LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid) &&
+                    AdjustTokenPrivileges(token, FALSE, &tp, 0, nullptr, nullptr);
+                // AdjustTokenPrivileges() succeeds even when the privilege isn't held
+                success = success && (GetLastError() == ERROR_SUCCESS);
+
+                CloseHandle(token);
+
+                return success;
+            }();
+
+        return enabled;
+    }
+}
+
 //--------------------------------------------------------------------------------------
 // MemoryArena
 //--------------------------------------------------------------------------------------
@@ -11,11 +43,60 @@ MemoryArena::MemoryArena(size_t blockSize)
     : m_blockSize(blockSize)
 {}
 
+MemoryArena::MemoryArena(const VirtualArenaDesc& desc)
+    : m_blockSize(64 * 1024)
+{
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    const size_t pageSize = sysInfo.dwPageSize;
+
+    if (desc.LargePages)
+    {
+        const size_t largePageSize = GetLargePageMinimum();
+
+        if (largePageSize && EnableLockMemoryPrivilege())
+        {
+            const size_t size = AlignUp(desc.ReserveSize, largePageSize);
+            void* base = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, 
+                PAGE_READWRITE);
+
+            if (base)
+            {
+                m_vm.Base = reinterpret_cast<uint8_t*>(base);
+                m_vm.Reserved = size;
+                m_vm.Committed = size;
+                m_vm.CommitGranularity = largePageSize;
+                m_vm.LargePages = true;
+
+                return;
+            }
+        }
+
+        LOG_UI(WARNING, "Large pages are not available, falling back to regular pages.");
+    }
+
+    const size_t size = AlignUp(desc.ReserveSize, (size_t)sysInfo.dwAllocationGranularity);
+    void* base = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_READWRITE);
+    CheckWin32(base);
+
+    m_vm.Base = reinterpret_cast<uint8_t*>(base);
+    m_vm.Reserved = size;
+    m_vm.CommitGranularity = AlignUp(Max(desc.CommitGranularity, pageSize), pageSize);
+}
+
+MemoryArena::~MemoryArena()
+{
+    ReleaseVirtualRange();
+}
+
 MemoryArena::MemoryArena(MemoryArena&& other)
     : m_blockSize(other.m_blockSize)
 {
     m_blocks.swap(other.m_blocks);
 
+    m_vm = other.m_vm;
+    other.m_vm = VirtualRange();
+
 #ifndef NDEBUG
     m_numAllocs = other.m_numAllocs;
 #endif
@@ -28,6 +109,10 @@ MemoryArena& MemoryArena::operator=(MemoryArena&& other)
     m_blocks.swap(other.m_blocks);
     other.m_blocks.free_memory();
 
+    ReleaseVirtualRange();
+    m_vm = other.m_vm;
+    other.m_vm = VirtualRange();
+
 #ifndef NDEBUG
     m_numAllocs = other.m_numAllocs;
     other.m_numAllocs = 0;
@@ -38,6 +123,15 @@ MemoryArena& MemoryArena::operator=(MemoryArena&& other)
 
 void* MemoryArena::AllocateAligned(size_t size, size_t alignment)
 {
+    if (m_vm.Base)
+    {
+        void* mem = AllocateFromVirtualRange(size, alignment);
+        if (mem)
+            return mem;
+
+        // Reserved range is exhausted, fall back to heap blocks
+    }
+
     for (auto& block : m_blocks)
     {
         const uintptr_t start = reinterpret_cast<uintptr_t>(block.Start);
@@ -85,11 +179,25 @@ size_t MemoryArena::TotalSize() const
     for (auto& block : m_blocks)
         sum += block.Size;
 
-    return sum;
+    return sum + m_vm.Committed;
 }
 
 void MemoryArena::Reset()
 {
+    if (m_vm.Base)
+    {
+        // Keep the first granule committed, as arenas are typically reused for 
+        // similar workloads
+        if (!m_vm.LargePages && m_vm.Committed > m_vm.CommitGranularity)
+        {
+            CheckWin32(VirtualFree(m_vm.Base + m_vm.CommitGranularity, 
+                m_vm.Committed - m_vm.CommitGranularity, MEM_DECOMMIT));
+            m_vm.Committed = m_vm.CommitGranularity;
+        }
+
+        m_vm.Offset = 0;
+    }
+
     while (m_blocks.size() > 1)
         m_blocks.pop_back();
 
@@ -97,3 +205,41 @@ void MemoryArena::Reset()
         m_blocks[0].Offset = 0;
 }
 
+void* MemoryArena::AllocateFromVirtualRange(size_t size, size_t alignment)
+{
+    const uintptr_t start = reinterpret_cast<uintptr_t>(m_vm.Base);
+    const uintptr_t ret = AlignUp(start + m_vm.Offset, alignment);
+    const size_t newOffset = ret - start + size;
+
+    if (newOffset > m_vm.Reserved)
+        return nullptr;
+
+    if (newOffset > m_vm.Committed)
+    {
+        Assert(!m_vm.LargePages, "Large-page arenas are fully committed.");
+
+        const size_t newCommitted = Min(AlignUp(newOffset, m_vm.CommitGranularity), m_vm.Reserved);
+        void* mem = VirtualAlloc(m_vm.Base + m_vm.Committed, newCommitted - m_vm.Committed, 
+            MEM_COMMIT, PAGE_READWRITE);
+        CheckWin32(mem);
+
+        m_vm.Committed = newCommitted;
+    }
+
+    m_vm.Offset = newOffset;
+
+#ifndef NDEBUG
+    m_numAllocs++;
+#endif
+
+    return reinterpret_cast<void*>(ret);
+}
+
+void MemoryArena::ReleaseVirtualRange()
+{
+    if (m_vm.Base)
+    {
+        VirtualFree(m_vm.Base, 0, MEM_RELEASE);
+        m_vm = VirtualRange();
+    }
+}
@@ -4,20 +4,54 @@
 
 namespace ZetaRay::Support
 {
+    // Options for arenas that are backed by a single virtual address range rather than a 
+    // linked list of heap blocks
+    struct VirtualArenaDesc
+    {
+        // Size of the virtual address range that's reserved up front. Nothing is committed
+        // until it's needed. Allocations that don't fit fall back to heap blocks.
+        size_t ReserveSize;
+        // Memory is committed in multiples of this (rounded up to page size)
+        size_t CommitGranularity = 1024 * 1024;
+        // Large pages can't be committed gradually, so the whole range is committed at 
+        // creation. Requires the "Lock pages in memory" privilege -- falls back to regular 
+        // pages when unavailable.
+        bool LargePages = false;
+    };
+
     class MemoryArena
     {
     public:
         explicit MemoryArena(size_t blockSize = 64 * 1024);
-        ~MemoryArena() = default;
+        explicit MemoryArena(const VirtualArenaDesc& desc);
+        ~MemoryArena();
         MemoryArena(MemoryArena&&);
         MemoryArena& operator=(MemoryArena&&);
 
         void* AllocateAligned(size_t size, size_t alignment = alignof(std::max_align_t));
         void FreeAligned(void* pMem, size_t size, size_t alignment = alignof(std::max_align_t)) {};
         size_t TotalSize() const;
+        // For virtual arenas, decommits everything past the first commit granule with a 
+        // single call, regardless of how much was allocated
         void Reset();
 
+        ZetaInline bool IsVirtual() const { return m_vm.Base != nullptr; }
+        ZetaInline bool UsesLargePages() const { return m_vm.LargePages; }
+
     private:
+        struct VirtualRange
+        {
+            uint8_t* Base = nullptr;
+            size_t Reserved = 0;
+            size_t Committed = 0;
+            size_t Offset = 0;
+            size_t CommitGranularity = 0;
+            bool LargePages = false;
+        };
+
+        void* AllocateFromVirtualRange(size_t size, size_t alignment);
+        void ReleaseVirtualRange();
+
         struct MemoryBlock
         {
             MemoryBlock() = default;
@@ -65,6 +99,7 @@ namespace ZetaRay::Support
 
         const size_t m_blockSize;
         Util::SmallVector<MemoryBlock, SystemAllocator, 8> m_blocks;
+        VirtualRange m_vm;
 #ifndef NDEBUG
         uint32_t m_numAllocs = 0;
 #endif
@@ -28,6 +28,29 @@ namespace
 
         return ret;
     }
+
+    ZetaInline void* PopFront(void*& head)
+    {
+        void* oldHead = head;
+        memcpy(&head, oldHead, sizeof(void*));
+
+        return oldHead;
+    }
+
+    ZetaInline void PushFront(void*& head, void* chunk)
+    {
+        memcpy(chunk, &head, sizeof(void*));
+        head = chunk;
+    }
+
+    // Chunks that are moved between a thread cache and the shared pool at once. Capped 
+    // by the number of chunks per block so that refilling a cache for the larger pools
+    // doesn't allocate several blocks at a time.
+    ZetaInline uint32_t NumChunksPerBatch(size_t chunkSize, size_t blockSize, uint32_t maxBatchSize)
+    {
+        return (uint32_t)ZetaRay::Math::Min(ZetaRay::Math::Max(blockSize / chunkSize, (size_t)1), 
+            (size_t)maxBatchSize);
+    }
 }
 
 //--------------------------------------------------------------------------------------
@@ -39,8 +62,11 @@ MemoryPool::~MemoryPool()
     Clear();
 }
 
-void MemoryPool::Init()
+void MemoryPool::Init(bool threadLocalCache)
 {
+    m_useThreadCache = threadLocalCache;
+    memset(m_threadCaches, 0, sizeof(m_threadCaches));
+
     for (int i = 0; i < POOL_COUNT; i++)
     {
         m_currHead[i] = nullptr;
@@ -72,6 +98,8 @@ void MemoryPool::Clear()
     }
 
     memset(m_numMemoryBlocks, 0, sizeof(size_t) * POOL_COUNT);
+    // Cached chunks belonged to the blocks that were just freed
+    memset(m_threadCaches, 0, sizeof(m_threadCaches));
 }
 
 size_t MemoryPool::GetPoolIndexFromSize(size_t x)
@@ -85,6 +113,8 @@ size_t MemoryPool::GetPoolIndexFromSize(size_t x)
 
 void MemoryPool::MoveTo(MemoryPool& dest)
 {
+    FlushCaches();
+
     for (int poolIndex = 0; poolIndex < POOL_COUNT; poolIndex++)
     {
         void* curr = m_currHead[poolIndex];
@@ -143,20 +173,8 @@ void* MemoryPool::Allocate(size_t size)
 
     // Which memory pool does it live in?
     size_t poolIndex = GetPoolIndexFromSize(size);
-    size_t chunkSize = GetChunkSizeFromPoolIndex(poolIndex);
-
-    // No more chunks, add a new memory block
-    if (!m_currHead[poolIndex])
-        Grow(poolIndex);
-
-    Assert(m_currHead[poolIndex], "bug");
 
-    // Get the pointer to first entry in the linked list
-    void* oldHead = m_currHead[poolIndex];
-    // Update head of the linked list
-    memcpy(&m_currHead[poolIndex], m_currHead[poolIndex], sizeof(void*));
-
-    return oldHead;
+    return PopChunk(poolIndex);
 }
 
 void* MemoryPool::AllocateAligned(size_t size, size_t alignment)
@@ -197,17 +215,7 @@ void* MemoryPool::AllocateAligned(size_t size, size_t alignment)
         return _aligned_malloc(size, alignment);
     }
 
-    // If the pool for the requested size is empty or has become full, add a new memory block
-    if (!m_currHead[poolIndex])
-        Grow(poolIndex);
-
-    // Get the pointer to the first entry in the linked list
-    void* head = m_currHead[poolIndex];
-    void* oldHead = head;
-    void* newHead = *reinterpret_cast<void**>(head);
-
-    // Update head of the linked list
-    m_currHead[poolIndex] = newHead;
+    void* oldHead = PopChunk(poolIndex);
 
     // Align the return pointer
     uintptr_t aligned = reinterpret_cast<uintptr_t>(oldHead);
@@ -238,12 +246,7 @@ void MemoryPool::Free(void* mem, size_t size)
         }
 
         size_t poolIndex = GetPoolIndexFromSize(size);
-
-        // Set "mem"s next pointer to be current head of the linked list
-        memcpy(mem, &m_currHead[poolIndex], sizeof(void*));
-
-        // Update the head of linked list to point to "mem"
-        m_currHead[poolIndex] = mem;
+        PushChunk(poolIndex, mem);
     }
 }
 
@@ -270,11 +273,141 @@ void MemoryPool::FreeAligned(void* mem, size_t size, size_t alignment)
         uint8_t diff = *(reinterpret_cast<uint8_t*>(origMem - 1));
         origMem = diff > 0 ? origMem - diff : origMem - 256;
 
-        // Set "mem"s next pointer to be current head of the linked list
-        memcpy(reinterpret_cast<void*>(origMem), &m_currHead[poolIndex], sizeof(void*));
+        PushChunk(poolIndex, reinterpret_cast<void*>(origMem));
+    }
+}
+
+void* MemoryPool::PopChunk(size_t poolIndex)
+{
+    if (!m_useThreadCache)
+    {
+        // No more chunks, add a new memory block
+        if (!m_currHead[poolIndex])
+            Grow(poolIndex);
+
+        return PopFront(m_currHead[poolIndex]);
+    }
+
+    const int threadIdx = g_threadIdx;
+
+    // Threads that aren't part of the app's thread pools don't have a cache
+    if (threadIdx < 0 || threadIdx >= MAX_NUM_THREADS)
+    {
+        AcquireSRWLockExclusive(&m_lock);
+
+        if (!m_currHead[poolIndex])
+            Grow(poolIndex);
+
+        void* chunk = PopFront(m_currHead[poolIndex]);
+
+        ReleaseSRWLockExclusive(&m_lock);
+
+        return chunk;
+    }
+
+    ThreadCache& cache = m_threadCaches[threadIdx];
+    if (!cache.Head[poolIndex])
+        RefillCache(poolIndex, threadIdx);
+
+    Assert(cache.Head[poolIndex] && cache.Count[poolIndex], "bug");
+    cache.Count[poolIndex]--;
+
+    return PopFront(cache.Head[poolIndex]);
+}
 
-        // Update the head of linked list to point to "pMem"
-        m_currHead[poolIndex] = reinterpret_cast<void*>(origMem);
+void MemoryPool::PushChunk(size_t poolIndex, void* chunk)
+{
+    if (!m_useThreadCache)
+    {
+        PushFront(m_currHead[poolIndex], chunk);
+        return;
+    }
+
+    const int threadIdx = g_threadIdx;
+
+    if (threadIdx < 0 || threadIdx >= MAX_NUM_THREADS)
+    {
+        AcquireSRWLockExclusive(&m_lock);
+        PushFront(m_currHead[poolIndex], chunk);
+        ReleaseSRWLockExclusive(&m_lock);
+
+        return;
+    }
+
+    // Chunk may have been allocated by another thread -- that's fine as chunks of 
+    // the same pool are interchangeable
+    ThreadCache& cache = m_threadCaches[threadIdx];
+    PushFront(cache.Head[poolIndex], chunk);
+    cache.Count[poolIndex]++;
+
+    const uint32_t batchSize = NumChunksPerBatch(GetChunkSizeFromPoolIndex(poolIndex), BLOCK_SIZE, 
+        REFILL_BATCH_SIZE);
+    if (cache.Count[poolIndex] >= Math::Min(batchSize * 2, MAX_NUM_CACHED_CHUNKS))
+        DrainCache(poolIndex, threadIdx);
+}
+
+void MemoryPool::RefillCache(size_t poolIndex, int threadIdx)
+{
+    ThreadCache& cache = m_threadCaches[threadIdx];
+    const uint32_t batchSize = NumChunksPerBatch(GetChunkSizeFromPoolIndex(poolIndex), BLOCK_SIZE, 
+        REFILL_BATCH_SIZE);
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    for (uint32_t i = 0; i < batchSize; i++)
+    {
+        if (!m_currHead[poolIndex])
+            Grow(poolIndex);
+
+        PushFront(cache.Head[poolIndex], PopFront(m_currHead[poolIndex]));
+    }
+
+    ReleaseSRWLockExclusive(&m_lock);
+
+    cache.Count[poolIndex] += batchSize;
+}
+
+void MemoryPool::DrainCache(size_t poolIndex, int threadIdx)
+{
+    ThreadCache& cache = m_threadCaches[threadIdx];
+    const uint32_t batchSize = NumChunksPerBatch(GetChunkSizeFromPoolIndex(poolIndex), BLOCK_SIZE, 
+        REFILL_BATCH_SIZE);
+    Assert(cache.Count[poolIndex] >= batchSize, "bug");
+
+    // Detach the first batchSize chunks from the cache (outside the lock)
+    void* first = cache.Head[poolIndex];
+    void* last = first;
+
+    for (uint32_t i = 1; i < batchSize; i++)
+        memcpy(&last, last, sizeof(void*));
+
+    memcpy(&cache.Head[poolIndex], last, sizeof(void*));
+    cache.Count[poolIndex] -= batchSize;
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    memcpy(last, &m_currHead[poolIndex], sizeof(void*));
+    m_currHead[poolIndex] = first;
+
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void MemoryPool::FlushCaches()
+{
+    if (!m_useThreadCache)
+        return;
+
+    for (int t = 0; t < MAX_NUM_THREADS; t++)
+    {
+        ThreadCache& cache = m_threadCaches[t];
+
+        for (int poolIndex = 0; poolIndex < POOL_COUNT; poolIndex++)
+        {
+            while (cache.Head[poolIndex])
+                PushFront(m_currHead[poolIndex], PopFront(cache.Head[poolIndex]));
+
+            cache.Count[poolIndex] = 0;
+        }
     }
 }
 
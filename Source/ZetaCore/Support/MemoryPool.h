@@ -1,6 +1,7 @@
 #pragma once
 
-#include "Memory.h"
+#include "../App/App.h"
+#include "../Win32/Win32.h"
 
 namespace ZetaRay::Support
 {
@@ -24,6 +25,12 @@ namespace ZetaRay::Support
     //            ------------- m_numChunks ----------------
     //
     //                            ....
+    //
+    //     - Optionally, each thread (as identified by g_threadIdx) can be given a small 
+    //       front cache of free chunks per pool. Threads allocate from and free to their own 
+    //       cache without synchronization and only go to the shared pools (under a lock) 
+    //       to refill or drain their cache in batches. Without the cache, MemoryPool 
+    //       isn't thread-safe.
     class MemoryPool
     {
     public:
@@ -34,7 +41,8 @@ namespace ZetaRay::Support
         MemoryPool& operator=(MemoryPool&&) = delete;
 
         // Initialize the memory pool. Has to be called before any allocation/deallocation can take place
-        void Init();
+        void Init(bool threadLocalCache = false);
+        // Not thread-safe -- caller must make sure the pool isn't being used by other threads
         void Clear();
 
         void* AllocateAligned(size_t size, size_t alignment = alignof(std::max_align_t));
@@ -42,12 +50,26 @@ namespace ZetaRay::Support
 
         size_t TotalSize() const;
 
+        // Not thread-safe -- caller must make sure neither pool is being used by other threads
         void MoveTo(MemoryPool& mp);
 
+        ZetaInline bool HasThreadLocalCache() const { return m_useThreadCache; }
+
     private:
         void* Allocate(size_t size);
         void Free(void* pMem, size_t size);
 
+        // Pops a chunk from the calling thread's cache (if enabled) or the shared pool
+        void* PopChunk(size_t poolIndex);
+        // Pushes a chunk to the calling thread's cache (if enabled) or the shared pool
+        void PushChunk(size_t poolIndex, void* chunk);
+        // Moves REFILL_BATCH_SIZE chunks from the shared pool to given cache
+        void RefillCache(size_t poolIndex, int threadIdx);
+        // Returns REFILL_BATCH_SIZE chunks from given cache to the shared pool
+        void DrainCache(size_t poolIndex, int threadIdx);
+        // Returns all the cached chunks to the shared pools
+        void FlushCaches();
+
         // Given x, returns:
         //        0    -> 8 bytes allocator    when 0 < x <= 8
         //        1    -> 16 bytes allocator    when 8 < x <= 16
@@ -82,6 +104,21 @@ namespace ZetaRay::Support
 
         // Pointer to head of the linked list for each memory block
         void* m_currHead[POOL_COUNT] = { nullptr };
+
+        // Number of chunks that are moved between a thread cache and the shared pool at once
+        static constexpr uint32_t REFILL_BATCH_SIZE = 32;
+        // A cache that's grown to this many chunks returns a batch to the shared pool
+        static constexpr uint32_t MAX_NUM_CACHED_CHUNKS = REFILL_BATCH_SIZE * 2;
+
+        struct alignas(64) ThreadCache
+        {
+            void* Head[POOL_COUNT];
+            uint32_t Count[POOL_COUNT];
+        };
+
+        ThreadCache m_threadCaches[MAX_NUM_THREADS] = {};
+        SRWLOCK m_lock = SRWLOCK_INIT;
+        bool m_useThreadCache = false;
     };
 
     struct PoolAllocator
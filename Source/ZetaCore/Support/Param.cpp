@@ -1,4 +1,5 @@
 #include "Param.h"
+#include "../App/App.h"
 #include <xxHash/xxhash.h>
 #include <string.h>
 
@@ -40,6 +41,17 @@ void ParamVariant::InitCommon(const char* group, const char* subgroup,
     memcpy(m_name, name, lenName);
     m_name[lenName] = '\0';
 
+    m_id = ComputeID(m_group, m_subgroup, m_name);
+    m_callbackPending = false;
+}
+
+uint64_t ParamVariant::ComputeID(const char* group, const char* subgroup, const char* name)
+{
+    // Same truncation as InitCommon()
+    const size_t lenGroup = Min((int)strlen(group), (MAX_GROUP_LEN - 1));
+    const size_t lenSubgroup = Min((int)strlen(subgroup), (MAX_SUBGROUP_LEN - 1));
+    const size_t lenName = Min((int)strlen(name), (MAX_NAME_LEN - 1));
+
     constexpr int BUFF_SIZE = ParamVariant::MAX_GROUP_LEN + ParamVariant::MAX_SUBGROUP_LEN + 
         ParamVariant::MAX_NAME_LEN;
     char buff[BUFF_SIZE];
@@ -51,7 +63,23 @@ void ParamVariant::InitCommon(const char* group, const char* subgroup,
     ptr += lenSubgroup;
     memcpy(buff + ptr, name, lenName);
 
-    m_id = XXH3_64bits(buff, ptr + lenName);
+    return XXH3_64bits(buff, ptr + lenName);
+}
+
+void ParamVariant::QueueCallback()
+{
+    // Multiple changes in one frame result in one callback
+    if (m_callbackPending)
+        return;
+
+    m_callbackPending = true;
+    App::QueueParamCallback(m_id);
+}
+
+void ParamVariant::InvokeCallback()
+{
+    m_callbackPending = false;
+    m_dlg(*this);
 }
 
 void ParamVariant::InitFloat(const char* group, const char* subgroup, const char* name, 
@@ -171,7 +199,7 @@ void ParamVariant::SetFloat(float v)
 {
     Assert(m_type == PARAM_TYPE::PT_float, "Invalid union type.");
     m_float.m_value = v;
-    m_dlg(*this);
+    QueueCallback();
 }
 
 const Float2Param& ParamVariant::GetFloat2() const
@@ -188,7 +216,7 @@ void ParamVariant::SetFloat2(const float2& v)
     if (m_float2.m_keepNormalized)
         m_float2.m_value.normalize();
 
-    m_dlg(*this);
+    QueueCallback();
 }
 
 const Float3Param& ParamVariant::GetFloat3() const
@@ -205,7 +233,7 @@ void ParamVariant::SetFloat3(const float3& v)
     if (m_float3.m_keepNormalized)
         m_float3.m_value.normalize();
 
-    m_dlg(*this);
+    QueueCallback();
 }
 
 const UnitDirParam& ParamVariant::GetUnitDir() const
@@ -219,7 +247,7 @@ void ParamVariant::SetUnitDir(float pitch, float yaw)
     Assert(m_type == PARAM_TYPE::PT_unit_dir, "Invalid union type.");
     m_unitDir.m_pitch = pitch;
     m_unitDir.m_yaw = yaw;
-    m_dlg(*this);
+    QueueCallback();
 }
 
 const Float3Param& ParamVariant::GetColor() const
@@ -232,7 +260,7 @@ void ParamVariant::SetColor(const float3& v)
 {
     Assert(m_type == PARAM_TYPE::PT_color, "Invalid union type.");
     m_float3.m_value = v;
-    m_dlg(*this);
+    QueueCallback();
 }
 
 const IntParam& ParamVariant::GetInt() const
@@ -245,7 +273,7 @@ void ParamVariant::SetInt(int v)
 {
     Assert(m_type == PARAM_TYPE::PT_int, "Invalid union type.");
     m_int.m_value = v;
-    m_dlg(*this);
+    QueueCallback();
 }
 
 bool ParamVariant::GetBool() const
@@ -258,7 +286,7 @@ void ParamVariant::SetBool(bool v)
 {
     Assert(m_type == PARAM_TYPE::PT_bool, "Invalid union type.");
     m_bool = v;
-    m_dlg(*this);
+    QueueCallback();
 }
 
 const EnumParam& ParamVariant::GetEnum() const
@@ -272,7 +300,7 @@ void ParamVariant::SetEnum(int v)
     Assert(m_type == PARAM_TYPE::PT_enum, "Invalid union type.");
     Assert(v < m_enum.m_num, "Out-of-bound index.");
     m_enum.m_curr = v;
-    m_dlg(*this);
+    QueueCallback();
 }
 
 float3 UnitDirParam::GetDir() const
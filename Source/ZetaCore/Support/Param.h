@@ -216,6 +216,12 @@ namespace ZetaRay::Support
         const char* GetName() const { return m_name; }
         PARAM_TYPE GetType() const { return m_type; }
         uint64_t ID() const { return m_id; }
+        // Same as ID() of a param with the given names
+        static uint64_t ComputeID(const char* group, const char* subgroup, const char* name);
+
+        // Setters update the value and queue the callback, which App invokes once per frame 
+        // (see App::QueueParamCallback()). Registered params should only be modified through
+        // App::GetParams().
 
         const FloatParam& GetFloat() const;
         void SetFloat(float v);
@@ -241,13 +247,18 @@ namespace ZetaRay::Support
         const EnumParam& GetEnum() const;
         void SetEnum(int v);
 
+        // Called by App for params with a queued callback
+        void InvokeCallback();
+
     private:
+        void QueueCallback();
         void InitCommon(const char* group, const char* subgroup, const char* subsubgroup, 
             const char* name, fastdelegate::FastDelegate1<const ParamVariant&> dlg);
 
         fastdelegate::FastDelegate1<const ParamVariant&> m_dlg;
         uint64_t m_id;
         PARAM_TYPE m_type;
+        bool m_callbackPending;
         char m_group[MAX_GROUP_LEN];
         char m_subgroup[MAX_SUBGROUP_LEN];
         char m_subsubgroup[MAX_SUBSUBGROUP_LEN];
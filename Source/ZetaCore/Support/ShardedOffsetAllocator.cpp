@@ -0,0 +1,150 @@
+#include "ShardedOffsetAllocator.h"
+#include "../Utility/Error.h"
+#include "../Math/Common.h"
+
+using namespace ZetaRay::Support;
+
+//--------------------------------------------------------------------------------------
+// ShardedOffsetAllocator
+//--------------------------------------------------------------------------------------
+
+void ShardedOffsetAllocator::Init(uint32_t centralSize, uint32_t centralMaxNumAllocs, int numShards,
+    uint32_t shardSize, uint32_t shardMaxNumAllocs, uint32_t maxShardAllocSize)
+{
+    Assert(centralSize > 0, "Central region can't be empty.");
+    Assert(numShards >= 0 && numShards <= MAX_NUM_THREADS, "Invalid number of shards.");
+    Assert(centralMaxNumAllocs <= NODE_MASK && shardMaxNumAllocs <= NODE_MASK,
+        "Node index doesn't fit in the allocation handle.");
+    Assert((uint64_t)centralSize + (uint64_t)numShards * shardSize <= UINT32_MAX,
+        "Range size overflows 32 bits.");
+
+    m_centralSize = centralSize;
+    m_shardSize = numShards > 0 ? shardSize : 0;
+    m_maxShardAllocSize = maxShardAllocSize;
+    m_numShards = numShards;
+
+    m_central.Init(centralSize, centralMaxNumAllocs);
+
+    for (int i = 0; i < numShards; i++)
+    {
+        m_shards[i].Base = centralSize + i * shardSize;
+        m_shards[i].Allocator.Init(shardSize, shardMaxNumAllocs);
+    }
+}
+
+ShardedOffsetAllocator::Allocation ShardedOffsetAllocator::Encode(Allocation a, uint32_t shard,
+    uint32_t base)
+{
+    if (a.IsEmpty())
+        return a;
+
+    Assert(a.Internal <= NODE_MASK, "Node index doesn't fit in the allocation handle.");
+    a.Offset += base;
+    a.Internal |= shard << SHARD_SHIFT;
+
+    return a;
+}
+
+ShardedOffsetAllocator::Allocation ShardedOffsetAllocator::Decode(const Allocation& a, uint32_t base)
+{
+    return Allocation{ .Size = a.Size,
+        .Offset = a.Offset - base,
+        .Internal = a.Internal & NODE_MASK };
+}
+
+void ShardedOffsetAllocator::ApplyPendingFrees(Shard& shard)
+{
+    if (shard.NumPending.load(std::memory_order_acquire) == 0)
+        return;
+
+    AcquireSRWLockExclusive(&shard.PendingLock);
+
+    for (auto& a : shard.Pending)
+        shard.Allocator.Free(Decode(a, shard.Base));
+
+    shard.Pending.clear();
+    shard.NumPending.store(0, std::memory_order_relaxed);
+
+    ReleaseSRWLockExclusive(&shard.PendingLock);
+}
+
+ShardedOffsetAllocator::Allocation ShardedOffsetAllocator::Allocate(uint32_t size, uint32_t alignment)
+{
+    const int threadIdx = g_threadIdx;
+
+    // Shard bases are only as aligned as the shard size
+    if (threadIdx >= 0 && threadIdx < m_numShards && size <= m_maxShardAllocSize &&
+        m_shards[threadIdx].Base % alignment == 0)
+    {
+        Shard& shard = m_shards[threadIdx];
+
+        AcquireSRWLockExclusive(&shard.Lock);
+        ApplyPendingFrees(shard);
+        const Allocation a = shard.Allocator.Allocate(size, alignment);
+        ReleaseSRWLockExclusive(&shard.Lock);
+
+        if (!a.IsEmpty())
+            return Encode(a, threadIdx + 1, shard.Base);
+    }
+
+    AcquireSRWLockExclusive(&m_centralLock);
+    const Allocation a = m_central.Allocate(size, alignment);
+    ReleaseSRWLockExclusive(&m_centralLock);
+
+    return Encode(a, CENTRAL, 0);
+}
+
+void ShardedOffsetAllocator::Free(const Allocation& alloc)
+{
+    Assert(!alloc.IsEmpty(), "Invalid allocation.");
+    const uint32_t shardIdx = alloc.Internal >> SHARD_SHIFT;
+
+    if (shardIdx == CENTRAL)
+    {
+        AcquireSRWLockExclusive(&m_centralLock);
+        m_central.Free(Decode(alloc, 0));
+        ReleaseSRWLockExclusive(&m_centralLock);
+
+        return;
+    }
+
+    const int owner = (int)shardIdx - 1;
+    Assert(owner < m_numShards, "Invalid allocation.");
+    Shard& shard = m_shards[owner];
+
+    if (owner == g_threadIdx)
+    {
+        AcquireSRWLockExclusive(&shard.Lock);
+        shard.Allocator.Free(Decode(alloc, shard.Base));
+        ReleaseSRWLockExclusive(&shard.Lock);
+
+        return;
+    }
+
+    AcquireSRWLockExclusive(&shard.PendingLock);
+    shard.Pending.push_back(alloc);
+    shard.NumPending.store((uint32_t)shard.Pending.size(), std::memory_order_release);
+    ReleaseSRWLockExclusive(&shard.PendingLock);
+}
+
+ShardedOffsetAllocator::StorageReport ShardedOffsetAllocator::GetStorageReport()
+{
+    AcquireSRWLockShared(&m_centralLock);
+    StorageReport report = m_central.GetStorageReport();
+    ReleaseSRWLockShared(&m_centralLock);
+
+    for (int i = 0; i < m_numShards; i++)
+    {
+        Shard& shard = m_shards[i];
+
+        AcquireSRWLockExclusive(&shard.Lock);
+        ApplyPendingFrees(shard);
+        const StorageReport r = shard.Allocator.GetStorageReport();
+        ReleaseSRWLockExclusive(&shard.Lock);
+
+        report.TotalFreeSpace += r.TotalFreeSpace;
+        report.LargestFreeRegion = Math::Max(report.LargestFreeRegion, r.LargestFreeRegion);
+    }
+
+    return report;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "OffsetAllocator.h"
+#include "../App/App.h"
+#include "../Utility/SmallVector.h"
+#include "../Win32/Win32.h"
+#include <atomic>
+
+namespace ZetaRay::Support
+{
+    // Thread-safe variant of OffsetAllocator for a range that's sub-allocated from many
+    // threads at once:
+    //
+    //  - The range is split into a central region followed by one shard per thread (as
+    //    identified by g_threadIdx):
+    //
+    //        | central | shard 0 | shard 1 | ... | shard N - 1 |
+    //
+    //  - Small requests are served from the calling thread's shard. Its lock is only
+    //    contended by GetStorageReport(), so parallel callers don't serialize on each other.
+    //  - Requests that are larger than maxShardAllocSize, that the shard can't satisfy or
+    //    that come from threads without a shard go to the central region (under a lock).
+    //  - Frees from a thread other than the owner are queued and applied by the owning
+    //    thread on its next Allocate().
+    //
+    // Allocations are regular OffsetAllocator::Allocations with offsets relative to start
+    // of the whole range. The shard that owns each allocation is stored in the upper
+    // bits of Allocation::Internal.
+    class ShardedOffsetAllocator
+    {
+    public:
+        using Allocation = OffsetAllocator::Allocation;
+        using StorageReport = OffsetAllocator::StorageReport;
+
+        ShardedOffsetAllocator() = default;
+        ~ShardedOffsetAllocator() = default;
+
+        ShardedOffsetAllocator(ShardedOffsetAllocator&&) = delete;
+        ShardedOffsetAllocator& operator=(ShardedOffsetAllocator&&) = delete;
+
+        // Not thread-safe
+        void Init(uint32_t centralSize, uint32_t centralMaxNumAllocs, int numShards,
+            uint32_t shardSize, uint32_t shardMaxNumAllocs, uint32_t maxShardAllocSize);
+        Allocation Allocate(uint32_t size, uint32_t alignment = 1);
+        void Free(const Allocation& alloc);
+        // Also applies the pending frees of every shard
+        StorageReport GetStorageReport();
+        ZetaInline uint32_t TotalSize() const
+        {
+            return m_centralSize + m_numShards * m_shardSize;
+        }
+
+    private:
+        static constexpr uint32_t SHARD_SHIFT = 24;
+        static constexpr uint32_t NODE_MASK = (1u << SHARD_SHIFT) - 1;
+        // Shard index 0 is the central region
+        static constexpr uint32_t CENTRAL = 0;
+
+        struct alignas(64) Shard
+        {
+            OffsetAllocator Allocator;
+            uint32_t Base = 0;
+            SRWLOCK Lock = SRWLOCK_INIT;
+
+            // Frees from other threads
+            Util::SmallVector<Allocation> Pending;
+            std::atomic_uint32_t NumPending = 0;
+            SRWLOCK PendingLock = SRWLOCK_INIT;
+        };
+
+        static Allocation Encode(Allocation a, uint32_t shard, uint32_t base);
+        static Allocation Decode(const Allocation& a, uint32_t base);
+        // Caller must hold shard.Lock
+        static void ApplyPendingFrees(Shard& shard);
+
+        Shard m_shards[MAX_NUM_THREADS];
+        OffsetAllocator m_central;
+        SRWLOCK m_centralLock = SRWLOCK_INIT;
+        uint32_t m_centralSize = 0;
+        uint32_t m_shardSize = 0;
+        uint32_t m_maxShardAllocSize = 0;
+        int m_numShards = 0;
+    };
+}
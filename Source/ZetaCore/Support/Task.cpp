@@ -14,6 +14,8 @@ Task::Task(const char* name, TASK_PRIORITY priority, Function&& f)
     : m_dlg(ZetaMove(f)),
     m_priority(priority)
 {
+    SetName(name);
+
     if(m_priority == TASK_PRIORITY::NORMAL)
         m_signalHandle = App::RegisterTask();
 }
@@ -24,6 +26,8 @@ Task::Task(Task&& other)
     m_indegree(other.m_indegree),
     m_priority(other.m_priority)
 {
+    memcpy(m_name, other.m_name, MAX_NAME_LENGTH);
+
     //m_adjacentTailNodes.swap(other.m_adjacentTailNodes);
     m_adjacentTailNodes = ZetaMove(other.m_adjacentTailNodes);
     other.m_adjacentTailNodes.clear();
@@ -45,6 +49,7 @@ Task& Task::operator=(Task&& other)
     m_indegree = other.m_indegree;
     m_signalHandle = other.m_signalHandle;
     m_priority = other.m_priority;
+    memcpy(m_name, other.m_name, MAX_NAME_LENGTH);
     other.m_indegree = 0;
     other.m_signalHandle = -1;
 
@@ -58,34 +63,47 @@ void Task::Reset(const char* name, TASK_PRIORITY priority, Function&& f)
     m_priority = priority;
     m_indegree = 0;
     m_dlg = ZetaMove(f);
+    SetName(name);
 
     if(m_priority == TASK_PRIORITY::NORMAL)
         m_signalHandle = App::RegisterTask();
 }
 
+void Task::SetName(const char* name)
+{
+    const int len = name ? Min((int)strlen(name), MAX_NAME_LENGTH - 1) : 0;
+    if (len)
+        memcpy(m_name, name, len);
+
+    m_name[len] = '\0';
+}
+
 //--------------------------------------------------------------------------------------
 // TaskSet
 //--------------------------------------------------------------------------------------
 
-void TaskSet::AddOutgoingEdge(TaskHandle a, TaskHandle b)
+template<int MaxNumTasks>
+void TaskSetBase<MaxNumTasks>::AddOutgoingEdge(TaskHandle a, TaskHandle b)
 {
     Assert(a < m_currSize && b < m_currSize, "Invalid task handles.");
     TaskMetadata& ta = m_taskMetadata[a];
     TaskMetadata& tb = m_taskMetadata[b];
 
-    bool prev1 = _bittestandset((long*)&ta.SuccessorMask, b);
+    bool prev1 = ta.SuccessorMask.TestAndSet(b);
     Assert(!prev1, "Redundant call, edge already exists.");
 
-    bool prev2 = _bittestandset((long*)&tb.PredecessorMask, a);
+    bool prev2 = tb.PredecessorMask.TestAndSet(a);
     Assert(!prev2, "Redundant call, edge already exists.");
 
     m_tasks[a].m_adjacentTailNodes.push_back(m_tasks[b].m_signalHandle);
 }
 
-void TaskSet::AddOutgoingEdgeToAll(TaskHandle a)
+template<int MaxNumTasks>
+void TaskSetBase<MaxNumTasks>::AddOutgoingEdgeToAll(TaskHandle a)
 {
     Assert(a < m_currSize, "Invalid task handle.");
     TaskMetadata& ta = m_taskMetadata[a];
+    m_tasks[a].m_adjacentTailNodes.reserve(m_currSize - 1);
 
     for (int b = 0; b < m_currSize; b++)
     {
@@ -93,14 +111,15 @@ void TaskSet::AddOutgoingEdgeToAll(TaskHandle a)
             continue;
 
         TaskMetadata& tb = m_taskMetadata[b];
-        ta.SuccessorMask |= (1 << b);
-        tb.PredecessorMask |= (1 << a);
+        ta.SuccessorMask.Set(b);
+        tb.PredecessorMask.Set(a);
 
         m_tasks[a].m_adjacentTailNodes.push_back(m_tasks[b].m_signalHandle);
     }
 }
 
-void TaskSet::AddIncomingEdgeFromAll(TaskHandle a)
+template<int MaxNumTasks>
+void TaskSetBase<MaxNumTasks>::AddIncomingEdgeFromAll(TaskHandle a)
 {
     Assert(a < m_currSize, "Invalid task handle.");
     TaskMetadata& ta = m_taskMetadata[a];
@@ -111,14 +130,15 @@ void TaskSet::AddIncomingEdgeFromAll(TaskHandle a)
             continue;
 
         TaskMetadata& tb = m_taskMetadata[b];
-        ta.PredecessorMask |= (1 << b);
-        tb.SuccessorMask |= (1 << a);
+        ta.PredecessorMask.Set(b);
+        tb.SuccessorMask.Set(a);
 
         m_tasks[b].m_adjacentTailNodes.push_back(m_tasks[a].m_signalHandle);
     }
 }
 
-void TaskSet::Sort()
+template<int MaxNumTasks>
+void TaskSetBase<MaxNumTasks>::Sort()
 {
     Assert(!m_isSorted, "TaskSet is already sorted.");
     TopologicalSort();
@@ -127,7 +147,8 @@ void TaskSet::Sort()
     m_isSorted = true;
 }
 
-void TaskSet::Finalize(WaitObject* waitObj)
+template<int MaxNumTasks>
+void TaskSetBase<MaxNumTasks>::Finalize(WaitObject* waitObj)
 {
     Assert(!m_isFinalized && m_isSorted, "Finalize() shouldn't be called when TaskSet hasn't been sorted.");
 
@@ -161,124 +182,146 @@ void TaskSet::Finalize(WaitObject* waitObj)
 
         // ConnectTo(m_tasks[m_currSize]);
         Task& notifyTask = m_tasks[m_currSize - 1];
-        uint64_t mask = m_leafMask;
-        notifyTask.m_indegree += __popcnt((uint32_t)mask);
+        Bitset mask = m_leafMask;
+        notifyTask.m_indegree += mask.Count();
 
-        unsigned long idx;
-        while (_BitScanForward64(&idx, mask))
+        for (int idx = mask.FirstSetBit(); idx != -1; idx = mask.FirstSetBit())
         {
             Assert(idx < m_currSize, "Bug");
             m_tasks[idx].m_adjacentTailNodes.push_back(notifyTask.m_signalHandle);
 
-            mask &= ~(1llu << idx);
+            mask.Clear(idx);
         }
 
         App::TaskFinalizedCallback(notifyTask.m_signalHandle, notifyTask.m_indegree);
     }
 }
 
-void TaskSet::ComputeInOutMask()
+template<int MaxNumTasks>
+void TaskSetBase<MaxNumTasks>::ComputeInOutMask()
 {
     for (int i = 0; i < m_currSize; ++i)
     {
         if (m_taskMetadata[i].Indegree() == 0)
-            m_rootMask |= (1llu << i);
+            m_rootMask.Set(i);
 
         if (m_taskMetadata[i].Outdegree() == 0)
-            m_leafMask |= (1llu << i);
+            m_leafMask.Set(i);
     }
 }
 
-void TaskSet::TopologicalSort()
+template<int MaxNumTasks>
+void TaskSetBase<MaxNumTasks>::TopologicalOrder(const TaskMetadata* metadata, int n, int* sorted)
 {
-    // Find the root nodes
-    uint32_t rootMask = 0;
+    // In each iteration, points to remaining elements that have an indegree of zero
+    Bitset currMask;
+    int tempIndegree[MAX_NUM_TASKS];
 
-    for (int i = 0; i < m_currSize; ++i)
+    // Find the root nodes and make a temporary copy of indegrees for the duration 
+    // of topological sorting
+    for (int i = 0; i < n; ++i)
     {
-        if (m_taskMetadata[i].Indegree() == 0)
-            rootMask |= (1llu << i);
-    }
+        tempIndegree[i] = metadata[i].Indegree();
 
-    // In each iteration, points to remaining elements that have an indegree of zero
-    uint32_t currMask = rootMask;
-    size_t currIdx = 0;
-    int sorted[MAX_NUM_TASKS];
+        if (tempIndegree[i] == 0)
+            currMask.Set(i);
+    }
 
-    // Make a temporary copy for the duration of topological sorting
-    int tempIndegree[MAX_NUM_TASKS];
-    for (int i = 0; i < m_currSize; i++)
-        tempIndegree[i] = m_taskMetadata[i].Indegree();
+    int currIdx = 0;
 
     // Find all nodes with zero indegree
-    unsigned long zeroIndegreeIdx;
-    while (_BitScanForward64(&zeroIndegreeIdx, currMask))
+    for (int zeroIndegreeIdx = currMask.FirstSetBit(); zeroIndegreeIdx != -1; 
+        zeroIndegreeIdx = currMask.FirstSetBit())
     {
-        Assert(zeroIndegreeIdx < m_currSize, "Invalid index.");
-        TaskMetadata& t = m_taskMetadata[zeroIndegreeIdx];
-        uint32_t tails = t.SuccessorMask;
-        unsigned long tailIdx;
+        Assert(zeroIndegreeIdx < n, "Invalid index.");
+        Bitset tails = metadata[zeroIndegreeIdx].SuccessorMask;
 
         // For every tail-adjacent node
-        while (_BitScanForward64(&tailIdx, tails))
+        for (int tailIdx = tails.FirstSetBit(); tailIdx != -1; tailIdx = tails.FirstSetBit())
         {
-            Assert(tailIdx < m_currSize, "Invalid index.");
+            Assert(tailIdx < n, "Invalid index.");
 
             // Remove one edge
             tempIndegree[tailIdx] -= 1;
 
             // If tail node's indegree has become 0, add it to mask
             if (tempIndegree[tailIdx] == 0)
-                currMask |= (1 << tailIdx);
+                currMask.Set(tailIdx);
 
-            tails &= ~(1 << tailIdx);
+            tails.Clear(tailIdx);
         }
 
         // Save new position for current node
         sorted[currIdx++] = zeroIndegreeIdx;
 
         // Remove current node
-        currMask &= ~(1 << zeroIndegreeIdx);
+        currMask.Clear(zeroIndegreeIdx);
     }
 
-    Assert(currIdx == m_currSize, "Graph has a cycle.");
+    Assert(currIdx == n, "Graph has a cycle.");
 
-    for (int i = 0; i < m_currSize; i++)
+    for (int i = 0; i < n; i++)
         Assert(tempIndegree[i] == 0, "Graph has a cycle.");
+}
 
-    Task oldTaskArr[MAX_NUM_TASKS];
-    for (int i = 0; i < m_currSize; i++)
-        oldTaskArr[i] = ZetaMove(m_tasks[i]);
+template<int MaxNumTasks>
+void TaskSetBase<MaxNumTasks>::TopologicalSort()
+{
+    int sorted[MAX_NUM_TASKS];
+    TopologicalOrder(m_taskMetadata, m_currSize, sorted);
 
-    TaskMetadata oldTaskMetadata[MAX_NUM_TASKS];
-    memcpy(oldTaskMetadata, m_taskMetadata, m_currSize * sizeof(TaskMetadata));
+    // Apply the permutation in place by following its cycles -- avoids making a 
+    // temporary copy of all the tasks
+    Bitset visited;
 
     for (int i = 0; i < m_currSize; i++)
     {
-        m_tasks[i] = ZetaMove(oldTaskArr[sorted[i]]);
-        m_taskMetadata[i] = oldTaskMetadata[sorted[i]];
+        if (sorted[i] == i || visited.TestAndSet(i))
+            continue;
+
+        Task tempTask = ZetaMove(m_tasks[i]);
+        TaskMetadata tempMetadata = m_taskMetadata[i];
+        int j = i;
+
+        while (true)
+        {
+            const int k = sorted[j];
+            visited.Set(j);
+
+            if (k == i)
+            {
+                m_tasks[j] = ZetaMove(tempTask);
+                m_taskMetadata[j] = tempMetadata;
+                break;
+            }
+
+            m_tasks[j] = ZetaMove(m_tasks[k]);
+            m_taskMetadata[j] = m_taskMetadata[k];
+            j = k;
+        }
     }
 }
 
-void TaskSet::ConnectTo(TaskSet& other)
+template<int MaxNumTasks>
+template<int OtherMaxNumTasks>
+void TaskSetBase<MaxNumTasks>::ConnectTo(TaskSetBase<OtherMaxNumTasks>& other)
 {
     Assert(!m_isFinalized, "Calling this method on a finalized TaskSet is invalid.");
     Assert(!other.m_isFinalized, "Calling this method on a finalized TaskSet is invalid.");
 
-    uint64_t headMask = m_leafMask;
-    const uint64_t tailMask = other.m_rootMask;
+    Bitset headMask = m_leafMask;
+    const auto tailMask = other.m_rootMask;
+    const int numTails = tailMask.Count();
 
     // Connect every leaf of this TaskSet to every root of "other"
-    unsigned long headIdx;
-    while (_BitScanForward64(&headIdx, headMask))
+    for (int headIdx = headMask.FirstSetBit(); headIdx != -1; headIdx = headMask.FirstSetBit())
     {
         Assert(headIdx < m_currSize, "Bug");
         Assert(m_tasks[headIdx].m_adjacentTailNodes.empty(), "Leaf task should not have tail nodes.");
-        m_tasks[headIdx].m_adjacentTailNodes.reserve(__popcnt16(other.m_rootMask));
+        m_tasks[headIdx].m_adjacentTailNodes.reserve(numTails);
 
-        unsigned long tailIdx;
-        uint64_t tailMaskCopy = tailMask;
-        while (_BitScanForward64(&tailIdx, tailMaskCopy))
+        auto tailMaskCopy = tailMask;
+        for (int tailIdx = tailMaskCopy.FirstSetBit(); tailIdx != -1; tailIdx = tailMaskCopy.FirstSetBit())
         {
             Assert(tailIdx < other.m_currSize, "Index out of bound.");
 
@@ -286,44 +329,215 @@ void TaskSet::ConnectTo(TaskSet& other)
             other.m_tasks[tailIdx].m_indegree += 1;
             m_tasks[headIdx].m_adjacentTailNodes.push_back(other.m_tasks[tailIdx].m_signalHandle);
 
-            tailMaskCopy &= ~(1llu << tailIdx);
+            tailMaskCopy.Clear(tailIdx);
         }
 
-        headMask &= ~(1llu << headIdx);
+        headMask.Clear(headIdx);
     }
 }
 
-void TaskSet::ConnectTo(Task& other)
+template<int MaxNumTasks>
+void TaskSetBase<MaxNumTasks>::ConnectTo(Task& other)
 {
     Assert(!m_isFinalized, "Calling this method on a finalized TaskSet is invalid.");
 
-    uint64_t mask = m_leafMask;
+    Bitset mask = m_leafMask;
+    other.m_indegree += mask.Count();
 
-    unsigned long idx;
-    while (_BitScanForward64(&idx, mask))
+    for (int idx = mask.FirstSetBit(); idx != -1; idx = mask.FirstSetBit())
     {
         Assert(idx < m_currSize, "Bug");
         m_tasks[idx].m_adjacentTailNodes.push_back(other.m_signalHandle);
 
-        mask &= ~(1llu << idx);
+        mask.Clear(idx);
     }
-
-    other.m_indegree += __popcnt((uint32_t)mask);
 }
 
-void TaskSet::ConnectFrom(Task& other)
+template<int MaxNumTasks>
+void TaskSetBase<MaxNumTasks>::ConnectFrom(Task& other)
 {
     Assert(!m_isFinalized, "Calling this method on a finalized TaskSet is invalid.");
 
-    uint64_t mask = m_rootMask;
+    Bitset mask = m_rootMask;
 
-    unsigned long idx;
-    while (_BitScanForward64(&idx, mask))
+    for (int idx = mask.FirstSetBit(); idx != -1; idx = mask.FirstSetBit())
     {
         Assert(idx < m_currSize, "Invalid index.");
         m_tasks[idx].m_indegree += 1;
         other.m_adjacentTailNodes.push_back(m_tasks[idx].m_signalHandle);
 
-        mask &= ~(1llu << idx);
+        mask.Clear(idx);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// TaskSetTemplate
+//--------------------------------------------------------------------------------------
+
+template<int MaxNumTasks>
+typename TaskSetTemplateBase<MaxNumTasks>::TaskHandle TaskSetTemplateBase<MaxNumTasks>::AddTask(
+    const char* name, TaskFunc f, void* ctx, int idx)
+{
+    Assert(!m_isBuilt, "Calling AddTask() on a built TaskSetTemplate is not allowed.");
+    Assert(m_currSize < MAX_NUM_TASKS,
+        "Current implementation doesn't support more than %d tasks.", MAX_NUM_TASKS);
+
+    TemplateTask& t = m_tasks[m_currSize++];
+    t.Fn = f;
+    t.Ctx = ctx;
+    t.Idx = idx;
+
+    const int len = name ? Min((int)strlen(name), Task::MAX_NAME_LENGTH - 1) : 0;
+    if (len)
+        memcpy(t.Name, name, len);
+
+    t.Name[len] = '\0';
+
+    return (TaskHandle)(m_currSize - 1);
+}
+
+template<int MaxNumTasks>
+void TaskSetTemplateBase<MaxNumTasks>::AddOutgoingEdge(TaskHandle a, TaskHandle b)
+{
+    Assert(!m_isBuilt, "Calling AddOutgoingEdge() on a built TaskSetTemplate is not allowed.");
+    Assert(a < m_currSize && b < m_currSize, "Invalid task handles.");
+
+    bool prev1 = m_taskMetadata[a].SuccessorMask.TestAndSet(b);
+    Assert(!prev1, "Redundant call, edge already exists.");
+
+    bool prev2 = m_taskMetadata[b].PredecessorMask.TestAndSet(a);
+    Assert(!prev2, "Redundant call, edge already exists.");
+}
+
+template<int MaxNumTasks>
+void TaskSetTemplateBase<MaxNumTasks>::AddIncomingEdgeFromAll(TaskHandle a)
+{
+    Assert(!m_isBuilt, "Calling AddIncomingEdgeFromAll() on a built TaskSetTemplate is not allowed.");
+    Assert(a < m_currSize, "Invalid task handle.");
+
+    for (int b = 0; b < m_currSize; b++)
+    {
+        if (b == a)
+            continue;
+
+        m_taskMetadata[a].PredecessorMask.Set(b);
+        m_taskMetadata[b].SuccessorMask.Set(a);
+    }
+}
+
+template<int MaxNumTasks>
+void TaskSetTemplateBase<MaxNumTasks>::Build()
+{
+    Assert(!m_isBuilt, "TaskSetTemplate is already built.");
+
+    int sorted[MAX_NUM_TASKS];
+    TaskSetType::TopologicalOrder(m_taskMetadata, m_currSize, sorted);
+
+    // Unlike TaskSet, edges are kept as indices, so they need to be remapped to 
+    // sorted positions
+    int newPos[MAX_NUM_TASKS];
+    for (int i = 0; i < m_currSize; i++)
+        newPos[sorted[i]] = i;
+
+    TemplateTask oldTasks[MAX_NUM_TASKS];
+    TaskMetadata oldMetadata[MAX_NUM_TASKS];
+    memcpy(oldTasks, m_tasks, sizeof(TemplateTask) * m_currSize);
+    memcpy(oldMetadata, m_taskMetadata, sizeof(TaskMetadata) * m_currSize);
+
+    for (int i = 0; i < m_currSize; i++)
+    {
+        const int oldIdx = sorted[i];
+        m_tasks[i] = oldTasks[oldIdx];
+        m_taskMetadata[i] = TaskMetadata();
+
+        Bitset tails = oldMetadata[oldIdx].SuccessorMask;
+        for (int t = tails.FirstSetBit(); t != -1; t = tails.FirstSetBit())
+        {
+            m_taskMetadata[i].SuccessorMask.Set(newPos[t]);
+            tails.Clear(t);
+        }
+
+        Bitset heads = oldMetadata[oldIdx].PredecessorMask;
+        for (int h = heads.FirstSetBit(); h != -1; h = heads.FirstSetBit())
+        {
+            m_taskMetadata[i].PredecessorMask.Set(newPos[h]);
+            heads.Clear(h);
+        }
+
+        if (m_taskMetadata[i].Indegree() == 0)
+            m_rootMask.Set(i);
+
+        if (m_taskMetadata[i].Outdegree() == 0)
+            m_leafMask.Set(i);
     }
-}
\ No newline at end of file
+
+    m_isBuilt = true;
+}
+
+template<int MaxNumTasks>
+void TaskSetTemplateBase<MaxNumTasks>::Reset()
+{
+    for (int i = 0; i < m_currSize; i++)
+        m_taskMetadata[i] = TaskMetadata();
+
+    m_rootMask = Bitset();
+    m_leafMask = Bitset();
+    m_currSize = 0;
+    m_isBuilt = false;
+}
+
+template<int MaxNumTasks>
+void TaskSetTemplateBase<MaxNumTasks>::Instantiate(TaskSetType& ts, void* frameArgs) const
+{
+    Assert(m_isBuilt, "TaskSetTemplate hasn't been built.");
+    Assert(ts.m_currSize == 0 && !ts.m_isSorted, "TaskSet must be empty.");
+
+    // Signal handles are per-frame, so tasks still need to be registered every frame
+    for (int i = 0; i < m_currSize; i++)
+    {
+        const TemplateTask& t = m_tasks[i];
+        ts.m_tasks[i].Reset(t.Name, TASK_PRIORITY::NORMAL, 
+            [fn = t.Fn, ctx = t.Ctx, idx = t.Idx, frameArgs]()
+            {
+                fn(ctx, idx, frameArgs);
+            });
+    }
+
+    ts.m_currSize = m_currSize;
+
+    for (int i = 0; i < m_currSize; i++)
+    {
+        ts.m_taskMetadata[i] = m_taskMetadata[i];
+
+        Bitset tails = m_taskMetadata[i].SuccessorMask;
+        ts.m_tasks[i].m_adjacentTailNodes.reserve(m_taskMetadata[i].Outdegree());
+
+        for (int t = tails.FirstSetBit(); t != -1; t = tails.FirstSetBit())
+        {
+            ts.m_tasks[i].m_adjacentTailNodes.push_back(ts.m_tasks[t].m_signalHandle);
+            tails.Clear(t);
+        }
+    }
+
+    ts.m_rootMask = m_rootMask;
+    ts.m_leafMask = m_leafMask;
+    ts.m_isSorted = true;
+}
+
+//--------------------------------------------------------------------------------------
+// Explicit instantiations
+//--------------------------------------------------------------------------------------
+
+template struct ZetaRay::Support::TaskSetBase<TaskSet::MAX_NUM_TASKS>;
+template struct ZetaRay::Support::TaskSetBase<LargeTaskSet::MAX_NUM_TASKS>;
+template struct ZetaRay::Support::TaskSetTemplateBase<TaskSet::MAX_NUM_TASKS>;
+template struct ZetaRay::Support::TaskSetTemplateBase<LargeTaskSet::MAX_NUM_TASKS>;
+
+template void TaskSetBase<TaskSet::MAX_NUM_TASKS>::ConnectTo(
+    TaskSetBase<TaskSet::MAX_NUM_TASKS>&);
+template void TaskSetBase<TaskSet::MAX_NUM_TASKS>::ConnectTo(
+    TaskSetBase<LargeTaskSet::MAX_NUM_TASKS>&);
+template void TaskSetBase<LargeTaskSet::MAX_NUM_TASKS>::ConnectTo(
+    TaskSetBase<TaskSet::MAX_NUM_TASKS>&);
+template void TaskSetBase<LargeTaskSet::MAX_NUM_TASKS>::ConnectTo(
+    TaskSetBase<LargeTaskSet::MAX_NUM_TASKS>&);
@@ -3,7 +3,9 @@
 #include "../Utility/Span.h"
 #include "../Utility/Function.h"
 #include "../App/App.h"
+#include "CpuEvent.h"
 #include <atomic>
+#include <intrin.h>
 
 namespace ZetaRay::Support
 {
@@ -17,11 +19,18 @@ namespace ZetaRay::Support
     // Task
     //--------------------------------------------------------------------------------------
 
-    struct TaskSet;
+    template<int MaxNumTasks>
+    struct TaskSetBase;
+
+    template<int MaxNumTasks>
+    struct TaskSetTemplateBase;
 
     struct alignas(64) Task
     {
-        friend struct TaskSet;
+        template<int MaxNumTasks>
+        friend struct TaskSetBase;
+        template<int MaxNumTasks>
+        friend struct TaskSetTemplateBase;
         static constexpr int MAX_NAME_LENGTH = 64;
 
         Task() = default;
@@ -34,19 +43,24 @@ namespace ZetaRay::Support
         ZetaInline int GetSignalHandle() const { return m_signalHandle; }
         ZetaInline Util::Span<int> GetAdjacencies() { return Util::Span(m_adjacentTailNodes); }
         ZetaInline TASK_PRIORITY GetPriority() const { return m_priority; }
+        ZetaInline const char* GetName() const { return m_name; }
 
         ZetaInline void DoTask()
         {
             Assert(m_dlg.IsSet(), "Attempting to run an empty Function.");
+            ZETA_CPU_EVENT_SCOPE(m_name);
             m_dlg.Run();
         }
 
     private:
+        void SetName(const char* name);
+
         Util::Function m_dlg;
         Util::SmallVector<int, App::FrameAllocator, 3> m_adjacentTailNodes;
         int m_signalHandle = -1;
         int m_indegree = 0;
         TASK_PRIORITY m_priority;
+        char m_name[MAX_NAME_LENGTH] = { '\0' };
     };
 
     //--------------------------------------------------------------------------------------
@@ -86,17 +100,26 @@ namespace ZetaRay::Support
     // 3. Sort
     // 4. (Optional) Connect different TaskSets
     // 5. Finalize
-    struct TaskSet
+    //
+    // Dependency metadata is stored as bitsets with one bit per task, so the maximum 
+    // number of tasks is fixed at compile time. Member functions are explicitly 
+    // instantiated for TaskSet and LargeTaskSet in Task.cpp.
+    template<int MaxNumTasks>
+    struct TaskSetBase
     {
-        static constexpr int MAX_NUM_TASKS = 16;
+        template<int OtherMaxNumTasks>
+        friend struct TaskSetBase;
+        friend struct TaskSetTemplateBase<MaxNumTasks>;
+
+        static constexpr int MAX_NUM_TASKS = MaxNumTasks;
         using TaskHandle = int;
         static constexpr TaskHandle INVALID_TASK_HANDLE = -1;
 
-        TaskSet() = default;
-        ~TaskSet() = default;
+        TaskSetBase() = default;
+        ~TaskSetBase() = default;
 
-        TaskSet(const TaskSet&) = delete;
-        TaskSet& operator=(const TaskSet&) = delete;
+        TaskSetBase(const TaskSetBase&) = delete;
+        TaskSetBase& operator=(const TaskSetBase&) = delete;
 
         TaskHandle EmplaceTask(const char* name, Util::Function&& f)
         {
@@ -115,7 +138,8 @@ namespace ZetaRay::Support
         // Adds an edge from the given task to every other task that is currently is the TaskSet
         void AddOutgoingEdgeToAll(TaskHandle a);
         void AddIncomingEdgeFromAll(TaskHandle a);
-        void ConnectTo(TaskSet& other);
+        template<int OtherMaxNumTasks>
+        void ConnectTo(TaskSetBase<OtherMaxNumTasks>& other);
         void ConnectTo(Task& other);
         void ConnectFrom(Task& other);
 
@@ -126,28 +150,147 @@ namespace ZetaRay::Support
         ZetaInline Util::MutableSpan<Task> GetTasks() { return Util::MutableSpan(m_tasks, m_currSize); }
 
     private:
+        static constexpr int NUM_MASK_WORDS = (MaxNumTasks + 63) / 64;
+
+        struct Bitset
+        {
+            ZetaInline bool TestAndSet(int i)
+            {
+                const uint64_t bit = 1llu << (i & 63);
+                const bool prev = Words[i >> 6] & bit;
+                Words[i >> 6] |= bit;
+
+                return prev;
+            }
+            ZetaInline void Set(int i) { Words[i >> 6] |= (1llu << (i & 63)); }
+            ZetaInline void Clear(int i) { Words[i >> 6] &= ~(1llu << (i & 63)); }
+            ZetaInline int Count() const
+            {
+                int ret = 0;
+                for (int w = 0; w < NUM_MASK_WORDS; w++)
+                    ret += (int)__popcnt64(Words[w]);
+
+                return ret;
+            }
+            // Returns the index of the first set bit or -1 if there isn't any
+            ZetaInline int FirstSetBit() const
+            {
+                for (int w = 0; w < NUM_MASK_WORDS; w++)
+                {
+                    unsigned long idx;
+                    if (_BitScanForward64(&idx, Words[w]))
+                        return w * 64 + (int)idx;
+                }
+
+                return -1;
+            }
+
+            uint64_t Words[NUM_MASK_WORDS] = { 0 };
+        };
+
         struct TaskMetadata
         {
-            ZetaInline int Indegree() const { return __popcnt16(PredecessorMask); }
-            ZetaInline int Outdegree() const { return __popcnt16(SuccessorMask); }
+            ZetaInline int Indegree() const { return PredecessorMask.Count(); }
+            ZetaInline int Outdegree() const { return SuccessorMask.Count(); }
 
             // Index of adjacent tasks (i.e. this task has an edge to them)
-            uint16_t SuccessorMask = 0;
+            Bitset SuccessorMask;
 
             // Index of predecessor tasks (i.e. have an edge to this task)
-            uint16_t PredecessorMask = 0;
+            Bitset PredecessorMask;
         };
 
+        // Writes the task indices in topological order to "sorted"
+        static void TopologicalOrder(const TaskMetadata* metadata, int n, int* sorted);
         void ComputeInOutMask();
         void TopologicalSort();
 
         Task m_tasks[MAX_NUM_TASKS];
         TaskMetadata m_taskMetadata[MAX_NUM_TASKS];
 
-        uint16_t m_rootMask = 0;
-        uint16_t m_leafMask = 0;
-        uint8_t m_currSize = 0;
+        Bitset m_rootMask;
+        Bitset m_leafMask;
+        uint16_t m_currSize = 0;
         bool m_isSorted = false;
         bool m_isFinalized = false;
     };
+
+    // The common case -- small enough to live on the stack
+    struct TaskSet : public TaskSetBase<16>
+    {};
+
+    // For splitting work into hundreds of tasks. Larger than TaskSet, prefer allocating 
+    // it from the heap or frame memory.
+    struct LargeTaskSet : public TaskSetBase<256>
+    {};
+
+    //--------------------------------------------------------------------------------------
+    // TaskSetTemplate
+    //--------------------------------------------------------------------------------------
+
+    // Structure of a TaskSet that stays the same from one frame to the next. Tasks and 
+    // edges are recorded and sorted once, after which Instantiate() fills a TaskSet for 
+    // the current frame that's ready for ConnectTo() and Finalize(), without redoing the 
+    // edge bookkeeping and sorting. As Functions are consumed by running them, tasks are 
+    // function pointers instead, which are called with the context and index given to 
+    // AddTask() and the per-frame arguments given to Instantiate().
+    //
+    // Usage:
+    // 
+    // 1. Add tasks and edges (AddTask(), AddOutgoingEdge())
+    // 2. Build
+    // 3. Every frame, Instantiate() into an empty TaskSet
+    // 4. Once the structure changes, Reset() and go back to 1
+    template<int MaxNumTasks>
+    struct TaskSetTemplateBase
+    {
+        using TaskSetType = TaskSetBase<MaxNumTasks>;
+        using TaskHandle = typename TaskSetType::TaskHandle;
+        using TaskFunc = void (*)(void* ctx, int idx, void* frameArgs);
+        static constexpr int MAX_NUM_TASKS = MaxNumTasks;
+
+        TaskSetTemplateBase() = default;
+        ~TaskSetTemplateBase() = default;
+
+        TaskSetTemplateBase(const TaskSetTemplateBase&) = delete;
+        TaskSetTemplateBase& operator=(const TaskSetTemplateBase&) = delete;
+
+        TaskHandle AddTask(const char* name, TaskFunc f, void* ctx, int idx = 0);
+        // Same as the TaskSet versions. Handles are the ones returned by AddTask() and 
+        // are no longer meaningful after Build().
+        void AddOutgoingEdge(TaskHandle a, TaskHandle b);
+        void AddIncomingEdgeFromAll(TaskHandle a);
+        void Build();
+        void Reset();
+        ZetaInline bool IsBuilt() const { return m_isBuilt; }
+        ZetaInline int GetSize() const { return m_currSize; }
+        void Instantiate(TaskSetType& ts, void* frameArgs = nullptr) const;
+
+    private:
+        using TaskMetadata = typename TaskSetType::TaskMetadata;
+        using Bitset = typename TaskSetType::Bitset;
+
+        struct TemplateTask
+        {
+            TaskFunc Fn;
+            void* Ctx;
+            int Idx;
+            char Name[Task::MAX_NAME_LENGTH];
+        };
+
+        // In topological order after Build()
+        TemplateTask m_tasks[MAX_NUM_TASKS];
+        TaskMetadata m_taskMetadata[MAX_NUM_TASKS];
+
+        Bitset m_rootMask;
+        Bitset m_leafMask;
+        uint16_t m_currSize = 0;
+        bool m_isBuilt = false;
+    };
+
+    struct TaskSetTemplate : public TaskSetTemplateBase<TaskSet::MAX_NUM_TASKS>
+    {};
+
+    struct LargeTaskSetTemplate : public TaskSetTemplateBase<LargeTaskSet::MAX_NUM_TASKS>
+    {};
 }
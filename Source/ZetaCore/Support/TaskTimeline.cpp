@@ -0,0 +1,258 @@
+#include "TaskTimeline.h"
+#include "../App/Timer.h"
+#include "../App/Filesystem.h"
+#include "../App/Log.h"
+#include "../Win32/Win32.h"
+#include "../Utility/StringUtil.h"
+
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::App;
+
+//--------------------------------------------------------------------------------------
+// TaskTimeline
+//--------------------------------------------------------------------------------------
+
+int64_t TaskTimeline::Now()
+{
+    LARGE_INTEGER currCount;
+    QueryPerformanceCounter(&currCount);
+
+    return currCount.QuadPart;
+}
+
+void TaskTimeline::Write(ThreadBuffer& buffer, const char* name, EVENT_TYPE type, 
+    GPU_QUEUE queue, int64_t begin, int64_t end, uint64_t arg, uint64_t frameIdx)
+{
+    // Only the owning thread writes to the head
+    const uint64_t head = buffer.Head.load(std::memory_order_relaxed);
+    Event& e = buffer.Events[head & (NUM_EVENTS_PER_THREAD - 1)];
+    e.Begin = begin;
+    e.End = end;
+    e.Arg = arg;
+    e.FrameIdx = (uint32_t)frameIdx;
+    e.Type = type;
+    e.Queue = queue;
+
+    const int len = name ? Math::Min((int)strlen(name), MAX_NAME_LENGTH - 1) : 0;
+    if (len)
+        memcpy(e.Name, name, len);
+    e.Name[len] = '\0';
+
+    // Publish
+    buffer.Head.store(head + 1, std::memory_order_release);
+}
+
+void TaskTimeline::Record(const char* name, EVENT_TYPE type, int64_t begin, int64_t end)
+{
+    Assert(g_threadIdx >= 0 && g_threadIdx < MAX_NUM_THREADS, "Invalid thread index.");
+    Write(m_buffers[g_threadIdx], name, type, GPU_QUEUE::DIRECT, begin, end, 0, 
+        App::GetTimer().GetTotalFrameCount());
+}
+
+void TaskTimeline::RecordSubmit(const char* name, GPU_QUEUE queue, uint64_t fence)
+{
+    Assert(g_threadIdx >= 0 && g_threadIdx < MAX_NUM_THREADS, "Invalid thread index.");
+    const int64_t now = Now();
+    Write(m_buffers[g_threadIdx], name, EVENT_TYPE::SUBMIT, queue, now, now, fence, 
+        App::GetTimer().GetTotalFrameCount());
+}
+
+void TaskTimeline::RecordGpu(const char* name, EVENT_TYPE type, GPU_QUEUE queue, 
+    int64_t begin, int64_t end, uint64_t frameIdx)
+{
+    Assert(type == EVENT_TYPE::GPU || type == EVENT_TYPE::GPU_FRAME_END, "Invalid event type.");
+    Assert(queue < GPU_QUEUE::COUNT, "Invalid queue.");
+    Write(m_gpuBuffers[(int)queue], name, type, queue, begin, end, 0, frameIdx);
+}
+
+int64_t TaskTimeline::Copy(ThreadBuffer& buffer, int track, uint64_t firstFrame,
+    Vector<Event>& events, Vector<int>& eventTrack)
+{
+    const uint64_t head = buffer.Head.load(std::memory_order_acquire);
+    const uint64_t numEvents = Math::Min(head, (uint64_t)NUM_EVENTS_PER_THREAD);
+    const size_t offset = events.size();
+
+    for (uint64_t i = head - numEvents; i < head; i++)
+    {
+        events.push_back(buffer.Events[i & (NUM_EVENTS_PER_THREAD - 1)]);
+        eventTrack.push_back(track);
+    }
+
+    // The owner thread may have overwritten some of the events while they were
+    // being copied -- only the ones that are newer than (new head - ring size) are
+    // guaranteed to be intact.
+    const uint64_t newHead = buffer.Head.load(std::memory_order_acquire);
+    const uint64_t firstValid = newHead >= NUM_EVENTS_PER_THREAD ?
+        newHead - NUM_EVENTS_PER_THREAD + 1 : 0;
+    const uint64_t firstCopied = head - numEvents;
+    const size_t numTorn = (size_t)Math::Min(firstValid > firstCopied ?
+        firstValid - firstCopied : 0, numEvents);
+
+    // Startup is counted as frame 0, which is never exported, so it doubles as the
+    // invalid marker
+    for (size_t i = offset; i < offset + numTorn; i++)
+        events[i].FrameIdx = 0;
+
+    int64_t earliest = INT64_MAX;
+
+    for (size_t i = offset + numTorn; i < events.size(); i++)
+    {
+        if (events[i].FrameIdx >= firstFrame && events[i].FrameIdx != 0)
+            earliest = Math::Min(earliest, events[i].Begin);
+    }
+
+    return earliest;
+}
+
+void TaskTimeline::ExportChromeTrace(const char* path, uint64_t firstFrame,
+    Span<const char*> threadNames)
+{
+    const double countsToMicro = 1'000'000.0 / App::GetTimer().GetCounterFreq();
+    const int numThreads = Math::Min((int)threadNames.size(), MAX_NUM_THREADS);
+    // GPU queues come after all the CPU threads
+    constexpr int GPU_TRACK_OFFSET = MAX_NUM_THREADS;
+    constexpr const char* QUEUE_NAMES[(int)GPU_QUEUE::COUNT] = { "Direct", "Compute" };
+
+    // Make a copy of each buffer first so that timestamps can be made relative to the 
+    // earliest event
+    SmallVector<Event> events;
+    SmallVector<int> eventTrack;
+    int64_t earliest = INT64_MAX;
+
+    for (int t = 0; t < numThreads; t++)
+        earliest = Math::Min(earliest, Copy(m_buffers[t], t, firstFrame, events, eventTrack));
+
+    for (int q = 0; q < (int)GPU_QUEUE::COUNT; q++)
+    {
+        earliest = Math::Min(earliest, Copy(m_gpuBuffers[q], GPU_TRACK_OFFSET + q, firstFrame, 
+            events, eventTrack));
+    }
+
+    SmallVector<char> json;
+    AppendFormat(json, "{\"traceEvents\":[\n"
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},\n"
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}");
+
+    for (int t = 0; t < numThreads; t++)
+    {
+        AppendFormat(json, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+            "\"args\":{\"name\":\"%s\"}},\n"
+            "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+            "\"args\":{\"sort_index\":%d}}",
+            t, threadNames[t] ? threadNames[t] : "", t, t);
+    }
+
+    for (int q = 0; q < (int)GPU_QUEUE::COUNT; q++)
+    {
+        AppendFormat(json, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"%s Queue\"}}", q, QUEUE_NAMES[q]);
+    }
+
+    int numExported = 0;
+    int numGpuSpans = 0;
+
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        const Event& e = events[i];
+        if (e.FrameIdx < firstFrame || e.FrameIdx == 0)
+            continue;
+
+        const bool isGpu = eventTrack[i] >= GPU_TRACK_OFFSET;
+        const int pid = isGpu ? 1 : 0;
+        const int tid = isGpu ? eventTrack[i] - GPU_TRACK_OFFSET : eventTrack[i];
+        const double ts = (e.Begin - earliest) * countsToMicro;
+        const char* queue = QUEUE_NAMES[(int)e.Queue];
+
+        AppendFormat(json, ",\n{\"name\":");
+        AppendJsonString(json, e.Name);
+
+        switch (e.Type)
+        {
+        case EVENT_TYPE::TASK:
+        case EVENT_TYPE::WAIT:
+        case EVENT_TYPE::PRESENT:
+            AppendFormat(json, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":%d,\"tid\":%d,\"args\":{\"frame\":%u}}",
+                e.Type == EVENT_TYPE::TASK ? "Task" : (e.Type == EVENT_TYPE::WAIT ? "Wait" : "Present"), 
+                ts, (e.End - e.Begin) * countsToMicro, pid, tid, e.FrameIdx);
+            break;
+        case EVENT_TYPE::SUBMIT:
+            AppendFormat(json, ",\"cat\":\"Submit\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,"
+                "\"pid\":%d,\"tid\":%d,\"args\":{\"frame\":%u,\"queue\":\"%s\",\"fence\":%llu}}",
+                ts, pid, tid, e.FrameIdx, queue, e.Arg);
+            break;
+        case EVENT_TYPE::GPU:
+            AppendFormat(json, ",\"cat\":\"GPU\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":%d,\"tid\":%d,\"args\":{\"frame\":%u,\"queue\":\"%s\"}}",
+                ts, (e.End - e.Begin) * countsToMicro, pid, tid, e.FrameIdx, queue);
+            numGpuSpans++;
+            break;
+        case EVENT_TYPE::GPU_FRAME_END:
+            AppendFormat(json, ",\"cat\":\"GPU\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%.3f,"
+                "\"pid\":%d,\"tid\":%d,\"args\":{\"frame\":%u}}",
+                ts, pid, tid, e.FrameIdx);
+            break;
+        }
+
+        numExported++;
+    }
+
+    AppendFormat(json, "\n]}\n");
+
+    Filesystem::WriteToFile(path, reinterpret_cast<uint8_t*>(json.data()), (uint32_t)json.size());
+
+    LOG_UI(INFO, "Wrote %d timeline events (%d GPU spans) to %s.", numExported, numGpuSpans, path);
+}
+
+void TaskTimeline::SumTaskTimes(uint64_t frameIdx, Vector<TaskTime>& totals)
+{
+    const double countsToMs = 1000.0 / App::GetTimer().GetCounterFreq();
+    const size_t offset = totals.size();
+
+    for (int t = 0; t < MAX_NUM_THREADS; t++)
+    {
+        ThreadBuffer& buffer = m_buffers[t];
+        const uint64_t head = buffer.Head.load(std::memory_order_acquire);
+        const uint64_t numEvents = Math::Min(head, (uint64_t)NUM_EVENTS_PER_THREAD);
+
+        // Events of each thread are in order of recording, walk back from the newest one
+        for (uint64_t i = head; i > head - numEvents; i--)
+        {
+            const Event e = buffer.Events[(i - 1) & (NUM_EVENTS_PER_THREAD - 1)];
+
+            // Stop at torn events (see Copy())
+            const uint64_t newHead = buffer.Head.load(std::memory_order_acquire);
+            if (newHead - (i - 1) > NUM_EVENTS_PER_THREAD)
+                break;
+
+            if (e.FrameIdx < (uint32_t)frameIdx)
+                break;
+
+            if (e.FrameIdx != (uint32_t)frameIdx || e.Type != EVENT_TYPE::TASK)
+                continue;
+
+            const float ms = (float)((e.End - e.Begin) * countsToMs);
+            bool found = false;
+
+            // Number of distinct tasks is small
+            for (size_t j = offset; j < totals.size(); j++)
+            {
+                if (strcmp(totals[j].Name, e.Name) == 0)
+                {
+                    totals[j].Ms += ms;
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found)
+            {
+                TaskTime tt;
+                memcpy(tt.Name, e.Name, MAX_NAME_LENGTH);
+                tt.Ms = ms;
+                totals.push_back(tt);
+            }
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../App/App.h"
+#include "../Utility/Span.h"
+#include "../Utility/SmallVector.h"
+#include <atomic>
+
+namespace ZetaRay::Support
+{
+    // Records begin and end timestamps of the tasks (and waits) that ran on each
+    // thread. Every thread writes to its own ring buffer, so recording doesn't require
+    // any synchronization. Oldest events are overwritten once a buffer is full.
+    //
+    // GPU work (as measured by GpuTimer) is recorded to one additional ring buffer per
+    // queue, with timestamps converted to CPU time, so that both end up on the same 
+    // timeline.
+    struct TaskTimeline
+    {
+        enum class EVENT_TYPE : uint8_t
+        {
+            TASK,
+            WAIT,
+            PRESENT,
+            // Command list submission, Arg is the completion fence value
+            SUBMIT,
+            // Span of GPU work
+            GPU,
+            // GPU finished the frame
+            GPU_FRAME_END
+        };
+
+        enum class GPU_QUEUE : uint8_t
+        {
+            DIRECT,
+            COMPUTE,
+            COUNT
+        };
+
+        static constexpr int MAX_NAME_LENGTH = 32;
+        static constexpr uint32_t NUM_EVENTS_PER_THREAD = 2048;
+        static_assert(Math::IsPow2(NUM_EVENTS_PER_THREAD), "Ring buffer size must be a power of two.");
+
+        struct Event
+        {
+            int64_t Begin;
+            int64_t End;
+            uint64_t Arg;
+            uint32_t FrameIdx;
+            EVENT_TYPE Type;
+            GPU_QUEUE Queue;
+            char Name[MAX_NAME_LENGTH];
+        };
+
+        static_assert(sizeof(Event) == 64);
+
+        struct TaskTime
+        {
+            char Name[MAX_NAME_LENGTH];
+            float Ms;
+        };
+
+        TaskTimeline() = default;
+        ~TaskTimeline() = default;
+        TaskTimeline(const TaskTimeline&) = delete;
+        TaskTimeline& operator=(const TaskTimeline&) = delete;
+
+        // Returns current value of the performance counter
+        static int64_t Now();
+
+        // Must be called from the thread that the event belongs to
+        void Record(const char* name, EVENT_TYPE type, int64_t begin, int64_t end);
+        // Records a command list submission to given queue. Must be called from the 
+        // thread that submitted.
+        void RecordSubmit(const char* name, GPU_QUEUE queue, uint64_t fence);
+        // Records GPU work for frame "frameIdx", with begin and end in CPU ticks. Must be 
+        // called from one thread only (GpuTimer resolves on the main thread).
+        void RecordGpu(const char* name, EVENT_TYPE type, GPU_QUEUE queue, int64_t begin, 
+            int64_t end, uint64_t frameIdx);
+
+        // Writes events that were recorded from frame "firstFrame" onward as a Chrome
+        // trace (JSON) file, which can be viewed by chrome://tracing or Perfetto. CPU
+        // threads and GPU queues are exported as two separate processes. threadNames[i] 
+        // is used as the label for thread with g_threadIdx = i. Safe to call while other 
+        // threads are recording.
+        void ExportChromeTrace(const char* path, uint64_t firstFrame, Util::Span<const char*> threadNames);
+        // Appends the total duration of tasks (waits excluded) that finished during frame 
+        // "frameIdx", summed over all threads for tasks with the same name. Safe to call while 
+        // other threads are recording, but frame must be recent enough that its events are 
+        // still in the ring buffers.
+        void SumTaskTimes(uint64_t frameIdx, Util::Vector<TaskTime>& totals);
+
+    private:
+        struct alignas(64) ThreadBuffer
+        {
+            Event Events[NUM_EVENTS_PER_THREAD];
+            // Total number of events that have been recorded by this thread
+            std::atomic_uint64_t Head = 0;
+        };
+
+        static void Write(ThreadBuffer& buffer, const char* name, EVENT_TYPE type, GPU_QUEUE queue,
+            int64_t begin, int64_t end, uint64_t arg, uint64_t frameIdx);
+        // Copies the intact events of given buffer and returns the earliest Begin among the
+        // ones from frame "firstFrame" onward
+        static int64_t Copy(ThreadBuffer& buffer, int track, uint64_t firstFrame, 
+            Util::Vector<Event>& events, Util::Vector<int>& eventTrack);
+
+        ThreadBuffer m_buffers[MAX_NUM_THREADS];
+        ThreadBuffer m_gpuBuffers[(int)GPU_QUEUE::COUNT];
+    };
+}
@@ -1,4 +1,5 @@
 #include "ThreadPool.h"
+#include "TaskTimeline.h"
 #include "../App/Log.h"
 
 using namespace ZetaRay::Support;
@@ -6,45 +7,136 @@ using namespace ZetaRay::App;
 using namespace ZetaRay::Util;
 
 //--------------------------------------------------------------------------------------
-// ThreadPool
+// TaskDeque
 //--------------------------------------------------------------------------------------
 
-void ThreadPool::Init(int poolSize, int totalNumThreads, const wchar_t* threadNamePrefix, 
-    THREAD_PRIORITY priority, int threadIdxOffset)
+void TaskDeque::Init(uint32_t initialCapacity)
 {
-    m_threadPoolSize = poolSize;
-    m_totalNumThreads = totalNumThreads;
+    Assert(Math::IsPow2(initialCapacity), "Capacity must be a power of two.");
+    m_tasks.resize(initialCapacity);
+    m_front = 0;
+    m_size.store(0, std::memory_order_relaxed);
+}
 
-    // Tokens below have to conisder that threads outside this thread pool
-    // (e.g. the main thread) may also insert tasks and occasionally execute 
-    // tasks (for example when trying to pump the queue to empty it)
+void TaskDeque::GrowIfFull(uint32_t n)
+{
+    const uint32_t size = m_size.load(std::memory_order_relaxed);
+    const uint32_t capacity = (uint32_t)m_tasks.size();
+    if (size + n <= capacity)
+        return;
 
-    // Consumers
-    {
-        // +1 for main therad
-        uintptr_t curr = reinterpret_cast<uintptr_t>(m_consumerTokensMem);
-        for (int i = 0; i < m_totalNumThreads; i++)
-        {
-            new (reinterpret_cast<void*>(curr)) moodycamel::ConsumerToken(m_taskQueue);
-            curr += sizeof(moodycamel::ConsumerToken);
-        }
+    const uint32_t newCapacity = Math::NextPow2(size + n);
+    SmallVector<Task> newTasks;
+    newTasks.resize(newCapacity);
 
-        m_consumerTokens = reinterpret_cast<moodycamel::ConsumerToken*>(m_consumerTokensMem);
-    }
+    // Unwrap the ring buffer
+    for (uint32_t i = 0; i < size; i++)
+        newTasks[i] = ZetaMove(m_tasks[(m_front + i) & (capacity - 1)]);
+
+    m_tasks.swap(newTasks);
+    m_front = 0;
+}
+
+void TaskDeque::PushBack(Task&& t)
+{
+    AcquireSRWLockExclusive(&m_lock);
 
-    // Producers
+    GrowIfFull();
+    const uint32_t size = m_size.load(std::memory_order_relaxed);
+    const uint32_t mask = (uint32_t)m_tasks.size() - 1;
+    m_tasks[(m_front + size) & mask] = ZetaMove(t);
+    m_size.store(size + 1, std::memory_order_relaxed);
+
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+void TaskDeque::PushBack(MutableSpan<Task> tasks)
+{
+    const uint32_t n = (uint32_t)tasks.size();
+    if (n == 0)
+        return;
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    GrowIfFull(n);
+    const uint32_t size = m_size.load(std::memory_order_relaxed);
+    const uint32_t mask = (uint32_t)m_tasks.size() - 1;
+
+    for (uint32_t i = 0; i < n; i++)
+        m_tasks[(m_front + size + i) & mask] = ZetaMove(tasks[n - 1 - i]);
+
+    m_size.store(size + n, std::memory_order_relaxed);
+
+    ReleaseSRWLockExclusive(&m_lock);
+}
+
+bool TaskDeque::PopBack(Task& t)
+{
+    // Avoid taking the lock when there's nothing to do
+    if (IsEmpty())
+        return false;
+
+    AcquireSRWLockExclusive(&m_lock);
+
+    const uint32_t size = m_size.load(std::memory_order_relaxed);
+    if (size == 0)
     {
-        // +1 for main therad
-        uintptr_t curr = reinterpret_cast<uintptr_t>(m_producerTokensMem);
-        for (int i = 0; i < m_totalNumThreads; i++)
-        {
-            new (reinterpret_cast<void*>(curr)) moodycamel::ProducerToken(m_taskQueue);
-            curr += sizeof(moodycamel::ProducerToken);
-        }
+        ReleaseSRWLockExclusive(&m_lock);
+        return false;
+    }
+
+    const uint32_t mask = (uint32_t)m_tasks.size() - 1;
+    t = ZetaMove(m_tasks[(m_front + size - 1) & mask]);
+    m_size.store(size - 1, std::memory_order_relaxed);
+
+    ReleaseSRWLockExclusive(&m_lock);
+
+    return true;
+}
+
+bool TaskDeque::PopFront(Task& t)
+{
+    if (IsEmpty())
+        return false;
 
-        m_producerTokens = reinterpret_cast<moodycamel::ProducerToken*>(m_producerTokensMem);
+    AcquireSRWLockExclusive(&m_lock);
+
+    const uint32_t size = m_size.load(std::memory_order_relaxed);
+    if (size == 0)
+    {
+        ReleaseSRWLockExclusive(&m_lock);
+        return false;
     }
 
+    const uint32_t mask = (uint32_t)m_tasks.size() - 1;
+    t = ZetaMove(m_tasks[m_front]);
+    m_front = (m_front + 1) & mask;
+    m_size.store(size - 1, std::memory_order_relaxed);
+
+    ReleaseSRWLockExclusive(&m_lock);
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// ThreadPool
+//--------------------------------------------------------------------------------------
+
+void ThreadPool::Init(int poolSize, int totalNumThreads, const wchar_t* threadNamePrefix, 
+    THREAD_PRIORITY priority, int threadIdxOffset)
+{
+    Assert(totalNumThreads <= MAX_NUM_THREADS, "Number of threads exceeded MAX_NUM_THREADS.");
+    m_threadPoolSize = poolSize;
+    m_totalNumThreads = totalNumThreads;
+    m_threadIdxOffset = threadIdxOffset;
+    m_maxNumActiveThreads.store(poolSize, std::memory_order_relaxed);
+
+    // Deques have to conisder that threads outside this thread pool (e.g. the main 
+    // thread) may also insert tasks and occasionally execute tasks (for example 
+    // when trying to pump the queue to empty it)
+    for (int i = 0; i < m_totalNumThreads; i++)
+        m_deques[i].Init(INITIAL_DEQUE_CAPACITY);
+
     for (int i = 0; i < m_threadPoolSize; i++)
     {
         // g_threadIdx needs to be unique for all threads - threadIdxOffset is used
@@ -71,6 +163,8 @@ void ThreadPool::Shutdown()
     m_shutdown.store(true, std::memory_order_relaxed);
 
     // Upon observing shutdown flag to be true, all the threads are going to exit
+    m_idleWorkSource.store(nullptr, std::memory_order_relaxed);
+    WakeAll();
 
     for (int i = 0; i < m_threadPoolSize; i++)
     {
@@ -84,54 +178,160 @@ void ThreadPool::Shutdown()
 
 void ThreadPool::Enqueue(Task&& task)
 {
-    bool memAllocFailed = m_taskQueue.enqueue(m_producerTokens[g_threadIdx], ZetaMove(task));
-    Assert(memAllocFailed, "moodycamel::ConcurrentQueue couldn't allocate memory.");
-
     m_numTasksToFinishTarget.fetch_add(1, std::memory_order_relaxed);
     m_numTasksInQueue.fetch_add(1, std::memory_order_release);
+
+    m_deques[g_threadIdx].PushBack(ZetaMove(task));
+    NotifyNewTasks();
+}
+
+void ThreadPool::EnqueueUnparked(Task&& task)
+{
+    Assert(task.GetPriority() != TASK_PRIORITY::BACKGROUND, "Background tasks don't have dependencies.");
+
+    // Already counted towards m_numTasksToFinishTarget. Push to the back so that the 
+    // signaling thread picks it up next while the dependency's data is still in cache.
+    m_numTasksInQueue.fetch_add(1, std::memory_order_release);
+    m_deques[g_threadIdx].PushBack(ZetaMove(task));
+    NotifyNewTasks();
 }
 
 void ThreadPool::Enqueue(TaskSet&& ts)
 {
     Assert(ts.IsFinalized(), "Given TaskSet is not finalized.");
+    EnqueueSorted(ts.GetTasks());
+}
+
+void ThreadPool::Enqueue(LargeTaskSet&& ts)
+{
+    Assert(ts.IsFinalized(), "Given TaskSet is not finalized.");
+    EnqueueSorted(ts.GetTasks());
+}
 
-    m_numTasksToFinishTarget.fetch_add(ts.GetSize(), std::memory_order_relaxed);
-    m_numTasksInQueue.fetch_add(ts.GetSize(), std::memory_order_release);
-    auto tasks = ts.GetTasks();
+void ThreadPool::EnqueueSorted(MutableSpan<Task> tasks)
+{
+    m_numTasksToFinishTarget.fetch_add((int)tasks.size(), std::memory_order_relaxed);
+    m_numTasksInQueue.fetch_add((int)tasks.size(), std::memory_order_release);
 
-    bool memAllocFailed = m_taskQueue.enqueue_bulk(m_producerTokens[g_threadIdx],
-        std::make_move_iterator(tasks.data()), tasks.size());
-    Assert(memAllocFailed, "moodycamel::ConcurrentQueue couldn't allocate memory.");
+    // Tasks are in topological order, pushing them in reverse means the calling thread
+    // pops the root tasks first while other threads steal from the leaves
+    m_deques[g_threadIdx].PushBack(tasks);
+    WakeAll();
 }
 
-void ThreadPool::PumpUntilEmpty()
+void ThreadPool::NotifyNewTasks()
 {
-    Task task;
+    m_wakeEpoch.fetch_add(1, std::memory_order_release);
 
-    // "try_dequeue()" returning false doesn't guarantee that queue is empty
-    while (m_numTasksInQueue.load(std::memory_order_acquire) != 0)
+    // Parked threads would go back to sleep after being woken up, so wake up everyone 
+    // to make sure the notification isn't lost
+    if (m_maxNumActiveThreads.load(std::memory_order_relaxed) < m_threadPoolSize)
+        m_wakeEpoch.notify_all();
+    else
+        m_wakeEpoch.notify_one();
+}
+
+void ThreadPool::WakeAll()
+{
+    m_wakeEpoch.fetch_add(1, std::memory_order_release);
+    m_wakeEpoch.notify_all();
+}
+
+void ThreadPool::SetMaxNumActiveThreads(int n)
+{
+    n = Math::Min(n, m_threadPoolSize);
+    const int prev = m_maxNumActiveThreads.exchange(n, std::memory_order_relaxed);
+
+    if (n > prev)
+        WakeAll();
+}
+
+void ThreadPool::SetIdleWorkSource(ThreadPool* pool)
+{
+    Assert(pool != this, "Thread pool can't be its own source of idle work.");
+    const ThreadPool* prev = m_idleWorkSource.exchange(pool, std::memory_order_release);
+
+    if (pool && pool != prev)
+        WakeAll();
+}
+
+bool ThreadPool::TryDequeue(Task& task)
+{
+    // LIFO from own deque
+    if (m_deques[g_threadIdx].PopBack(task))
+        return true;
+
+    // Steal from the other end of other threads' deques. Start from the next thread 
+    // so that different thieves don't all go after the same victim.
+    for (int i = 1; i < m_totalNumThreads; i++)
     {
-        if (m_taskQueue.try_dequeue(m_consumerTokens[g_threadIdx], task))
-        {
-            m_numTasksInQueue.fetch_sub(1, std::memory_order_relaxed);
+        const int victim = (g_threadIdx + i) % m_totalNumThreads;
+        if (m_deques[victim].PopFront(task))
+            return true;
+    }
 
-            const int taskHandle = task.GetSignalHandle();
+    return false;
+}
+
+bool ThreadPool::TryRunTask(Task& task)
+{
+    const bool hasDependencies = task.GetPriority() != TASK_PRIORITY::BACKGROUND;
+    const int taskHandle = task.GetSignalHandle();
+
+    // Rather than blocking the calling thread on unfinished dependencies, park the task 
+    // and look for other work. It's enqueued again by the thread that finishes the last 
+    // dependency (unless that happened in the meantime).
+    if (hasDependencies && !App::AreAdjacentHeadNodesFinished(taskHandle) && 
+        App::TryParkTask(task))
+    {
+        return false;
+    }
+
+    const int64_t begin = TaskTimeline::Now();
+    task.DoTask();
+    App::GetTaskTimeline().Record(task.GetName(), TaskTimeline::EVENT_TYPE::TASK, begin, 
+        TaskTimeline::Now());
 
-            // Block if this task depends on other unfinished tasks
-            App::WaitForAdjacentHeadNodes(taskHandle);
+    // Signal dependent tasks that this task has finished
+    if (hasDependencies)
+    {
+        auto adjacencies = task.GetAdjacencies();
+        if (adjacencies.size() > 0)
+            App::SignalAdjacentTailNodes(adjacencies);
+    }
 
-            task.DoTask();
+    m_numTasksFinished.fetch_add(1, std::memory_order_release);
 
-            // Signal dependent tasks that this task has finished
-            auto adjacencies = task.GetAdjacencies();
-            if (adjacencies.size() > 0)
-                App::SignalAdjacentTailNodes(adjacencies);
+    return true;
+}
+
+void ThreadPool::PumpUntilEmpty()
+{
+    // Since tasks may be in transit between deques, TryDequeue() returning false 
+    // doesn't guarantee that queue is empty
+    while (m_numTasksInQueue.load(std::memory_order_acquire) != 0)
+    {
+        Task task;
 
-            m_numTasksFinished.fetch_add(1, std::memory_order_release);
+        if (TryDequeue(task))
+        {
+            m_numTasksInQueue.fetch_sub(1, std::memory_order_relaxed);
+            TryRunTask(task);
         }
     }
 }
 
+bool ThreadPool::PumpOnce()
+{
+    Task task;
+    if (!TryDequeue(task))
+        return false;
+
+    m_numTasksInQueue.fetch_sub(1, std::memory_order_relaxed);
+
+    return TryRunTask(task);
+}
+
 bool ThreadPool::TryFlush()
 {
     const bool success = m_numTasksFinished.load(std::memory_order_acquire) == 
@@ -159,6 +359,8 @@ void ThreadPool::WorkerThread(int idx)
 
     LOG_UI(INFO, "Thread %d waiting for tasks...\n", g_threadIdx);
 
+    const int localIdx = idx - m_threadIdxOffset;
+
     while (true)
     {
         Task task;
@@ -167,27 +369,28 @@ void ThreadPool::WorkerThread(int idx)
         if (m_shutdown.load(std::memory_order_acquire))
             break;
 
-        // block if there aren't any tasks
-        m_taskQueue.wait_dequeue(m_consumerTokens[g_threadIdx], task);
-        m_numTasksInQueue.fetch_sub(1, std::memory_order_acquire);
-
-        const int taskHandle = task.GetSignalHandle();
-
-        // Block if this task has unfinished dependencies
-        if(task.GetPriority() != TASK_PRIORITY::BACKGROUND)
-            App::WaitForAdjacentHeadNodes(taskHandle);
+        // Has to be read before looking for tasks, otherwise a notification that 
+        // arrives in between could be missed
+        const uint32_t epoch = m_wakeEpoch.load(std::memory_order_acquire);
+        const bool isActive = localIdx < m_maxNumActiveThreads.load(std::memory_order_relaxed);
 
-        task.DoTask();
-
-        // Signal dependent tasks that this task has finished
-        if (task.GetPriority() != TASK_PRIORITY::BACKGROUND)
+        if (isActive && TryDequeue(task))
         {
-            auto adjacencies = task.GetAdjacencies();
-            if (adjacencies.size() > 0)
-                App::SignalAdjacentTailNodes(adjacencies);
+            m_numTasksInQueue.fetch_sub(1, std::memory_order_acquire);
+            TryRunTask(task);
+
+            continue;
         }
 
-        m_numTasksFinished.fetch_add(1, std::memory_order_release);
+        // Nothing to do in this pool, help out the other one (if allowed)
+        ThreadPool* idleWorkSource = m_idleWorkSource.load(std::memory_order_acquire);
+        if (idleWorkSource && idleWorkSource->PumpOnce())
+            continue;
+
+        // Block if there aren't any tasks or this thread is parked. Tasks might be in 
+        // transit between deques while the counter is nonzero, in which case try again.
+        if (!isActive || m_numTasksInQueue.load(std::memory_order_acquire) == 0)
+            m_wakeEpoch.wait(epoch, std::memory_order_acquire);
     }
 
     LOG_UI(INFO, "Thread %d exiting...\n", g_threadIdx);
@@ -1,10 +1,42 @@
 #pragma once
 
 #include "Task.h"
-#include "concurrentqueue/blockingconcurrentqueue.h"
+#include "../Win32/Win32.h"
+#include <thread>
 
 namespace ZetaRay::Support
 {
+    // Task queue that is owned by a single thread. The owner pushes and pops from the
+    // back (LIFO), while other threads steal from the front (FIFO).
+    struct alignas(64) TaskDeque
+    {
+        TaskDeque() = default;
+        ~TaskDeque() = default;
+        TaskDeque(const TaskDeque&) = delete;
+        TaskDeque& operator=(const TaskDeque&) = delete;
+
+        void Init(uint32_t initialCapacity);
+
+        void PushBack(Task&& t);
+        // Tasks are pushed in reverse order, so that popping from the back returns
+        // them in the original (topologically sorted) order
+        void PushBack(Util::MutableSpan<Task> tasks);
+        bool PopBack(Task& t);
+        bool PopFront(Task& t);
+
+        ZetaInline bool IsEmpty() const { return m_size.load(std::memory_order_relaxed) == 0; }
+
+    private:
+        // Requires the lock to be held
+        void GrowIfFull(uint32_t n = 1);
+
+        // Ring buffer with power-of-two capacity
+        Util::SmallVector<Task> m_tasks;
+        uint32_t m_front = 0;
+        std::atomic_uint32_t m_size = 0;
+        SRWLOCK m_lock = SRWLOCK_INIT;
+    };
+
     class ThreadPool
     {
     public:
@@ -13,55 +45,74 @@ namespace ZetaRay::Support
         ThreadPool(const ThreadPool&) = delete;
         ThreadPool& operator=(const ThreadPool&) = delete;
 
-        void Init(int poolSize, int totalNumThreads, const wchar_t* threadNamePrefix, 
+        void Init(int poolSize, int totalNumThreads, const wchar_t* threadNamePrefix,
             App::THREAD_PRIORITY priority, int threadIdxOffset);
         void Start();
         void Shutdown();
 
         void Enqueue(TaskSet&& ts);
+        void Enqueue(LargeTaskSet&& ts);
         void Enqueue(Task&& t);
+        // For tasks that were already enqueued once and were parked on their dependencies
+        void EnqueueUnparked(Task&& t);
 
         // The calling thread dequeues task until task queue becomes empty
         void PumpUntilEmpty();
+        // The calling thread dequeues and runs at most one task. Returns true if a 
+        // task was executed.
+        bool PumpOnce();
         // Waits until all tasks are finished (!= empty queue)
         bool TryFlush();
 
+        // Only the first n threads of this pool are allowed to dequeue new tasks -- the 
+        // rest are parked until the limit is raised. Tasks that are already running
+        // aren't affected.
+        void SetMaxNumActiveThreads(int n);
+        // While set, threads of this pool that run out of work execute tasks from the 
+        // given pool. Pass nullptr to stop.
+        void SetIdleWorkSource(ThreadPool* pool);
+        // Wakes up all the threads that are blocked waiting for tasks
+        void WakeAll();
+
         ZetaInline bool AreAllTasksFinished() const
         {
-            const bool isEmpty = m_numTasksFinished.load(std::memory_order_acquire) == 
+            const bool isEmpty = m_numTasksFinished.load(std::memory_order_acquire) ==
                 m_numTasksToFinishTarget.load(std::memory_order_acquire);
             return isEmpty;
         }
 
         ZetaInline int ThreadPoolSize() const { return m_threadPoolSize; }
+        ZetaInline void* GetThreadHandle(int i) { return m_threadPool[i].native_handle(); }
 
     private:
+        static constexpr uint32_t INITIAL_DEQUE_CAPACITY = 64;
+
         void WorkerThread(int idx);
+        void EnqueueSorted(Util::MutableSpan<Task> tasks);
+        // First tries the calling thread's deque, then steals from the other threads
+        bool TryDequeue(Task& task);
+        // Runs the given task unless it has unfinished dependencies, in which case it's
+        // parked until the last dependency signals it. Returns true if task ran.
+        bool TryRunTask(Task& task);
+        void NotifyNewTasks();
 
         int m_threadPoolSize;
         int m_totalNumThreads;
+        int m_threadIdxOffset;
+        std::atomic_int32_t m_maxNumActiveThreads = MAX_NUM_THREADS;
+        std::atomic<ThreadPool*> m_idleWorkSource = nullptr;
+        // Worker threads block on this rather than the task counter, so that they can be 
+        // woken up for reasons other than new tasks (e.g. scheduling changes)
+        std::atomic_uint32_t m_wakeEpoch = 0;
         std::atomic_int32_t m_numTasksInQueue = 0;
         std::atomic_int32_t m_numTasksFinished = 0;
         std::atomic_int32_t m_numTasksToFinishTarget = 0;
 
         std::thread m_threadPool[MAX_NUM_THREADS];
 
-        // Concurrent task queue
-        // Source: https://github.com/cameron314/concurrentqueue
-        struct MyTraits : public moodycamel::ConcurrentQueueDefaultTraits
-        {
-            static const size_t BLOCK_SIZE = 256;
-        };
-
-        moodycamel::BlockingConcurrentQueue<Task, MyTraits> m_taskQueue;
-
-        alignas(alignof(moodycamel::ProducerToken)) uint8_t m_producerTokensMem[
-            sizeof(moodycamel::ProducerToken) * MAX_NUM_THREADS];
-        moodycamel::ProducerToken* m_producerTokens;
-
-        alignas(alignof(moodycamel::ConsumerToken)) uint8_t m_consumerTokensMem[
-            sizeof(moodycamel::ConsumerToken) * MAX_NUM_THREADS];
-        moodycamel::ConsumerToken* m_consumerTokens;
+        // One deque per thread that may insert tasks -- threads outside this thread pool
+        // (e.g. the main thread) may also insert tasks and occasionally execute tasks
+        TaskDeque m_deques[MAX_NUM_THREADS];
 
         std::atomic_bool m_start = false;
         std::atomic_bool m_shutdown = false;
@@ -0,0 +1,292 @@
+#pragma once
+
+#include "../Math/Common.h"
+#include "../Support/Memory.h"
+#include "../Utility/Optional.h"
+#include "../Utility/SmallVector.h"
+#include "../Win32/Win32.h"
+#include <atomic>
+
+namespace ZetaRay::Util
+{
+    // Hash table for read-mostly workloads -- open-set addressing with linear probing
+    //
+    //  - Readers are lock-free and may run concurrently with a writer. find() returns a
+    //    copy of the value, which is read under a per-entry sequence counter so that
+    //    readers never see a partially-written value.
+    //  - Writers are serialized. All the modifying calls must be made between begin_write()
+    //    and end_write() -- batching multiple modifications in one scope amortizes the
+    //    locking cost.
+    //  - As with HashTable, keys are assumed to be already hashed.
+    //  - Entries can't be removed. Tables that are replaced due to growth are kept around
+    //    (readers might still be probing them) and are freed with the hash table. Since
+    //    capacity doubles, that's less than the current table's size -- call reserve()
+    //    up front to avoid it altogether.
+    template<typename ValueType>
+    requires std::is_trivially_copyable_v<ValueType> && std::is_default_constructible_v<ValueType>
+    class ConcurrentHashTable
+    {
+    public:
+        ConcurrentHashTable() = default;
+        ~ConcurrentHashTable()
+        {
+            free_memory();
+        }
+
+        ConcurrentHashTable(const ConcurrentHashTable&) = delete;
+        ConcurrentHashTable& operator=(const ConcurrentHashTable&) = delete;
+
+        // Lock-free
+        Util::Optional<ValueType> find(uint64_t key) const
+        {
+            const Table* t = m_table.load(std::memory_order_acquire);
+            if (!t)
+                return {};
+
+            const size_t mask = t->NumSlots - 1;
+            size_t pos = key & mask;
+
+            for (size_t i = 0; i < t->NumSlots; i++)
+            {
+                const Slot& s = t->Slots[pos];
+                const uint64_t k = s.Key.load(std::memory_order_acquire);
+
+                if (k == key)
+                    return read_value(s);
+
+                if (k == NULL_KEY)
+                    return {};
+
+                pos = (pos + 1) & mask;     // Linear probing
+            }
+
+            return {};
+        }
+
+        ZetaInline size_t size() const
+        {
+            return m_numEntries.load(std::memory_order_relaxed);
+        }
+
+        ZetaInline bool empty() const
+        {
+            return size() == 0;
+        }
+
+        ZetaInline void begin_write()
+        {
+            AcquireSRWLockExclusive(&m_writeLock);
+        }
+
+        ZetaInline void end_write()
+        {
+            ReleaseSRWLockExclusive(&m_writeLock);
+        }
+
+        // Following must be called between begin_write() and end_write()
+
+        void reserve(size_t n)
+        {
+            const size_t numSlots = Math::NextPow2(Math::Max((size_t)Math::Ceil(n / MAX_LOAD),
+                MIN_NUM_SLOTS));
+            const Table* t = m_table.load(std::memory_order_relaxed);
+
+            if (!t || numSlots > t->NumSlots)
+                relocate(numSlots);
+        }
+
+        void insert_or_assign(uint64_t key, const ValueType& val)
+        {
+            Assert(key != NULL_KEY, "Invalid key.");
+
+            Table* t = m_table.load(std::memory_order_relaxed);
+            Slot* s = t ? find_slot(*t, key) : nullptr;
+
+            if (s && s->Key.load(std::memory_order_relaxed) == key)
+            {
+                write_value(*s, val);
+                return;
+            }
+
+            const size_t numEntries = m_numEntries.load(std::memory_order_relaxed);
+            if (!t || numEntries + 1 > t->NumSlots * MAX_LOAD)
+            {
+                relocate(t ? t->NumSlots << 1 : MIN_NUM_SLOTS);
+                t = m_table.load(std::memory_order_relaxed);
+                s = find_slot(*t, key);
+            }
+
+            // Value is written before the key is published, so readers that see the key
+            // also see the value
+            memcpy(&s->Val, &val, sizeof(ValueType));
+            s->Key.store(key, std::memory_order_release);
+            m_numEntries.store(numEntries + 1, std::memory_order_relaxed);
+        }
+
+        // Calls fn(ValueType&) to modify the value for given key in place. Returns false
+        // if key wasn't found.
+        template<typename Fn>
+        bool update(uint64_t key, Fn fn)
+        {
+            Table* t = m_table.load(std::memory_order_relaxed);
+            if (!t)
+                return false;
+
+            Slot* s = find_slot(*t, key);
+            if (s->Key.load(std::memory_order_relaxed) != key)
+                return false;
+
+            ValueType val;
+            memcpy(&val, &s->Val, sizeof(ValueType));
+            fn(val);
+            write_value(*s, val);
+
+            return true;
+        }
+
+        // Not thread-safe
+        void free_memory()
+        {
+            Table* t = m_table.load(std::memory_order_relaxed);
+            if (t)
+                free_table(t);
+
+            for (auto* r : m_retired)
+                free_table(r);
+
+            m_retired.free_memory();
+            m_table.store(nullptr, std::memory_order_relaxed);
+            m_numEntries.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        struct Slot
+        {
+            std::atomic_uint64_t Key;
+            // Odd while the value is being written
+            std::atomic_uint32_t Seq;
+            ValueType Val;
+        };
+
+        struct Table
+        {
+            size_t NumSlots;
+            Slot* Slots;
+        };
+
+        ZetaInline static ValueType read_value(const Slot& s)
+        {
+            ValueType ret;
+
+            while (true)
+            {
+                const uint32_t seq = s.Seq.load(std::memory_order_acquire);
+                if (seq & 0x1)
+                {
+                    _mm_pause();
+                    continue;
+                }
+
+                memcpy(&ret, &s.Val, sizeof(ValueType));
+                // Make sure the copy isn't reordered after the second read
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (s.Seq.load(std::memory_order_relaxed) == seq)
+                    return ret;
+            }
+        }
+
+        ZetaInline static void write_value(Slot& s, const ValueType& val)
+        {
+            const uint32_t seq = s.Seq.load(std::memory_order_relaxed);
+            s.Seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            memcpy(&s.Val, &val, sizeof(ValueType));
+
+            s.Seq.store(seq + 2, std::memory_order_release);
+        }
+
+        // Returns the slot with given key, or the empty slot where it should be inserted
+        static Slot* find_slot(const Table& t, uint64_t key)
+        {
+            const size_t mask = t.NumSlots - 1;
+            size_t pos = key & mask;
+
+            while (true)
+            {
+                Slot* s = t.Slots + pos;
+                const uint64_t k = s->Key.load(std::memory_order_relaxed);
+                if (k == key || k == NULL_KEY)
+                    return s;
+
+                pos = (pos + 1) & mask;
+            }
+        }
+
+        void relocate(size_t n)
+        {
+            Assert(Math::IsPow2(n), "n must be a power of two.");
+
+            Table* oldTable = m_table.load(std::memory_order_relaxed);
+            uint8_t* mem = reinterpret_cast<uint8_t*>(m_allocator.AllocateAligned(alloc_size(n), 
+                ALLOC_ALIGNMENT));
+
+            // Slots are stored right after the header
+            Table* newTable = reinterpret_cast<Table*>(mem);
+            newTable->NumSlots = n;
+            newTable->Slots = reinterpret_cast<Slot*>(mem + SLOTS_OFFSET);
+
+            for (size_t i = 0; i < n; i++)
+            {
+                Slot* s = new (newTable->Slots + i) Slot;
+                s->Key.store(NULL_KEY, std::memory_order_relaxed);
+                s->Seq.store(0, std::memory_order_relaxed);
+            }
+
+            // Reinsert all elements -- old table isn't modified after this point, so
+            // readers that are still probing it find consistent (if stale) values
+            if (oldTable)
+            {
+                for (size_t i = 0; i < oldTable->NumSlots; i++)
+                {
+                    const Slot& curr = oldTable->Slots[i];
+                    const uint64_t key = curr.Key.load(std::memory_order_relaxed);
+                    if (key == NULL_KEY)
+                        continue;
+
+                    Slot* s = find_slot(*newTable, key);
+                    memcpy(&s->Val, &curr.Val, sizeof(ValueType));
+                    s->Key.store(key, std::memory_order_relaxed);
+                }
+
+                m_retired.push_back(oldTable);
+            }
+
+            // Publish
+            m_table.store(newTable, std::memory_order_release);
+        }
+
+        void free_table(Table* t)
+        {
+            m_allocator.FreeAligned(t, alloc_size(t->NumSlots), ALLOC_ALIGNMENT);
+        }
+
+        ZetaInline static size_t alloc_size(size_t n)
+        {
+            return SLOTS_OFFSET + n * sizeof(Slot);
+        }
+
+        static constexpr size_t MIN_NUM_SLOTS = 16;
+        static constexpr float MAX_LOAD = 0.7f;
+        static constexpr uint64_t NULL_KEY = uint64_t(-1);
+        static constexpr size_t ALLOC_ALIGNMENT = alignof(Slot) > alignof(Table) ? alignof(Slot) : alignof(Table);
+        static constexpr size_t SLOTS_OFFSET = Math::AlignUp(sizeof(Table), alignof(Slot));
+
+        std::atomic<Table*> m_table = nullptr;
+        std::atomic_size_t m_numEntries = 0;
+        SRWLOCK m_writeLock = SRWLOCK_INIT;
+        Util::SmallVector<Table*> m_retired;
+        Support::SystemAllocator m_allocator;
+    };
+}
@@ -3,10 +3,12 @@
 #include "../Math/Common.h"
 #include "../Support/Memory.h"
 #include "../Utility/Optional.h"
+#include <intrin.h>
+#include <string.h>
 
 namespace ZetaRay::Util
 {
-    // Open-set addressing with linear probing
+    // Open-set addressing with linear probing over groups of buckets (similar to Swiss tables)
     // 
     //  - Assumes keys are already hashed; key itself is not stored, only its hash (uint64_t). Consequently,
     //    collisions on keys could lead to wrong results. By using a decent hash function, chances of 
@@ -66,11 +68,10 @@ namespace ZetaRay::Util
         }
 
         // Returns NULL if an element with the given key is not found.
-        // Note: in contrast to find(), find_entry() returns NULL only when the table is empty.
         Util::Optional<ValueType*> find(KeyType key) const
         {
             Entry* e = find_entry(key);
-            if (e && e->Key == key)
+            if (e)
                 return &e->Val;
 
             return {};
@@ -80,37 +81,13 @@ namespace ZetaRay::Util
         template<typename... Args>
         bool try_emplace(KeyType key, Args&&... args)
         {
-            Assert(key != NULL_KEY && key != TOMBSTONE_KEY, "Invalid key.");
-
-            Entry* elem = find_entry(key);
-            if (!elem || elem->Key != key)
-            {
-                if (elem && (elem->Key == TOMBSTONE_KEY))
-                {
-                    elem->Key = key;
-                    new (&elem->Val) ValueType(ZetaForward(args)...);
-                    m_numNonTombstoneEntries++;
-
-                    return true;
-                }
+            bool inserted;
+            Entry* elem = find_or_prepare_insert(key, inserted);
 
-                if (!m_beg || load_factor() >= MAX_LOAD || m_numEntries + 1 == bucket_count())
-                {
-                    relocate(Math::Max(bucket_count() << 1, MIN_NUM_BUCKETS));
-                    // Find the new position to construct this Entry
-                    elem = find_entry(key);
-                }
-
-                elem->Key = key;
+            if (inserted)
                 new (&elem->Val) ValueType(ZetaForward(args)...);
-                m_numEntries++;
-                m_numNonTombstoneEntries++;
-                Assert(m_numEntries < bucket_count(), "Load factor should never be 1.0.");
-
-                return true;
-            }
 
-            return false;
+            return inserted;
         }
 
         // Assign to the entry if already exists, otherwise inserts a new entry
@@ -118,31 +95,12 @@ namespace ZetaRay::Util
         {
             static_assert(std::is_copy_constructible_v<ValueType> || std::is_move_constructible_v<ValueType>,
                 "ValueType must be move-or-copy constructible.");
-            Assert(key != NULL_KEY && key != TOMBSTONE_KEY, "Invalid key.");
 
-            Entry* elem = find_entry(key);
-            if (!elem || elem->Key != key)
-            {
-                if (elem && elem->Key == TOMBSTONE_KEY)
-                {
-                    elem->Key = key;
-                    new (&elem->Val) ValueType(val);
-                    m_numNonTombstoneEntries++;
+            bool inserted;
+            Entry* elem = find_or_prepare_insert(key, inserted);
 
-                    return *elem;
-                }
-
-                if (!m_beg || load_factor() >= MAX_LOAD || m_numEntries + 1 == bucket_count())
-                {
-                    relocate(Math::Max(bucket_count() << 1, MIN_NUM_BUCKETS));
-                    elem = find_entry(key);
-                }
-
-                elem->Key = key;
-                m_numEntries++;
-                m_numNonTombstoneEntries++;
-                Assert(m_numEntries < bucket_count(), "Load factor should never be 1.0.");
-            }
+            if (!inserted)
+                elem->Val.~ValueType();
 
             new (&elem->Val) ValueType(val);
 
@@ -153,31 +111,12 @@ namespace ZetaRay::Util
         {
             static_assert(std::is_copy_constructible_v<ValueType> || std::is_move_constructible_v<ValueType>,
                 "ValueType must be move-or-copy constructible.");
-            Assert(key != NULL_KEY && key != TOMBSTONE_KEY, "Invalid key.");
 
-            Entry* elem = find_entry(key);
-            if (!elem || elem->Key != key)
-            {
-                if (elem && elem->Key == TOMBSTONE_KEY)
-                {
-                    elem->Key = key;
-                    new (&elem->Val) ValueType(ZetaForward(val));
-                    m_numNonTombstoneEntries++;
+            bool inserted;
+            Entry* elem = find_or_prepare_insert(key, inserted);
 
-                    return *elem;
-                }
-
-                if (!m_beg || load_factor() >= MAX_LOAD || m_numEntries + 1 == bucket_count())
-                {
-                    relocate(Math::Max(bucket_count() << 1, MIN_NUM_BUCKETS));
-                    elem = find_entry(key);
-                }
-
-                elem->Key = key;
-                m_numEntries++;
-                m_numNonTombstoneEntries++;
-                Assert(m_numEntries < bucket_count(), "Load factor should never be 1.0.");
-            }
+            if (!inserted)
+                elem->Val.~ValueType();
 
             new (&elem->Val) ValueType(ZetaForward(val));
 
@@ -187,14 +126,14 @@ namespace ZetaRay::Util
         ZetaInline size_t erase(KeyType key)
         {
             Entry* elem = find_entry(key);
-            if (!elem || elem->Key != key || elem->Key == TOMBSTONE_KEY)
+            if (!elem)
                 return 0;
 
-            elem->Key = TOMBSTONE_KEY;
+            m_ctrl[elem - m_beg] = CTRL_DELETED;
             Assert(m_numNonTombstoneEntries >= 1, "Invalid hash table state.");
             m_numNonTombstoneEntries--;
             if constexpr (!std::is_trivially_destructible_v<ValueType>)
-                elem->~Entry();
+                elem->Val.~ValueType();
 
             return 1;
         }
@@ -223,21 +162,10 @@ namespace ZetaRay::Util
 
         void clear()
         {
-            if constexpr (!std::is_trivially_destructible_v<ValueType>)
-            {
-                size_t i = 0;
-                
-                for (auto it = begin_it(); it < end_it(); it = next_it(it))
-                {
-                    it->~Entry();
-                    i++;
-                }
-                
-                Assert(i == m_numNonTombstoneEntries, "Number of cleared entries must match the number of entries.");
-            }
+            destruct_all();
 
-            for (Entry* curr = m_beg; curr != m_end; curr++)
-                curr->Key = NULL_KEY;
+            if (m_ctrl)
+                memset(m_ctrl, CTRL_EMPTY, bucket_count());
 
             m_numEntries = 0;
             m_numNonTombstoneEntries = 0;
@@ -246,33 +174,24 @@ namespace ZetaRay::Util
 
         void free_memory()
         {
-            if constexpr (!std::is_trivially_destructible_v<ValueType>)
-            {
-                size_t i = 0;
-
-                for (auto it = begin_it(); it < end_it(); it = next_it(it))
-                {
-                    it->~Entry();
-                    i++;
-                }
-
-                Assert(i == m_numNonTombstoneEntries, "Number of cleared entries must match the number of entries.");
-            }
+            destruct_all();
 
             // Free the previously allocated memory
             if(bucket_count())
-                m_allocator.FreeAligned(m_beg, bucket_count() * sizeof(Entry), alignof(Entry));
+                m_allocator.FreeAligned(m_beg, alloc_size(bucket_count()), ALLOC_ALIGNMENT);
 
             m_numEntries = 0;
             m_numNonTombstoneEntries = 0;
             m_beg = nullptr;
             m_end = nullptr;
+            m_ctrl = nullptr;
         }
 
         void swap(HashTable& other)
         {
             std::swap(m_beg, other.m_beg);
             std::swap(m_end, other.m_end);
+            std::swap(m_ctrl, other.m_ctrl);
             std::swap(m_numEntries, other.m_numEntries);
             std::swap(m_numNonTombstoneEntries, other.m_numNonTombstoneEntries);
             std::swap(m_allocator, other.m_allocator);
@@ -281,57 +200,27 @@ namespace ZetaRay::Util
         ValueType& operator[](KeyType key)
         {
             static_assert(std::is_default_constructible_v<ValueType>, "ValueType must be default-constructible");
-            Assert(key != NULL_KEY && key != TOMBSTONE_KEY, "Invalid key.");
-
-            Entry* elem = find_entry(key);
-            if (!elem || elem->Key != key)
-            {
-                if (elem && elem->Key == TOMBSTONE_KEY)
-                {
-                    elem->Key = key;
-                    new (&elem->Val) ValueType();
-                    m_numNonTombstoneEntries++;
 
-                    return elem->Val;
-                }
-
-                if (!m_beg || load_factor() >= MAX_LOAD || m_numEntries + 1 == bucket_count())
-                {
-                    relocate(Math::Max(bucket_count() << 1, MIN_NUM_BUCKETS));
-                    elem = find_entry(key);
-                }
+            bool inserted;
+            Entry* elem = find_or_prepare_insert(key, inserted);
 
-                elem->Key = key;
+            if (inserted)
                 new (&elem->Val) ValueType();
-                m_numEntries++;
-                m_numNonTombstoneEntries++;
-                Assert(m_numEntries < bucket_count(), "Load factor should never be 1.0.");
-            }
 
             return elem->Val;
         }
 
         ZetaInline Entry* begin_it()
         {
-            // When memory is allocated, but there hasn't been any insertions,
-            // m_beg != m_end, which would erroneously indicate table is non-mepty.
-            if (m_numEntries == 0)
+            if (m_numNonTombstoneEntries == 0)
                 return m_end;
 
-            auto it = m_beg;
-            while (it != m_end && (it->Key == NULL_KEY || it->Key == TOMBSTONE_KEY))
-                it++;
-
-            return it;
+            return next_occupied(0);
         }
 
         ZetaInline Entry* next_it(Entry* curr)
         {
-            Entry* next = curr + 1;
-            while (next != m_end && (next->Key == NULL_KEY || next->Key == TOMBSTONE_KEY))
-                next++;
-
-            return next;
+            return next_occupied(curr - m_beg + 1);
         }
 
         ZetaInline Entry* end_it()
@@ -340,34 +229,191 @@ namespace ZetaRay::Util
         }
 
     private:
+        // Bucket i's state is stored in a separate array of control bytes, m_ctrl[i]. Occupied 
+        // buckets store 7 bits of the key's hash, so probing compares a whole group of 
+        // control bytes at once (one SSE2 compare) and only touches the entries whose 
+        // control byte matched. Groups are aligned to GROUP_SIZE; tables with fewer buckets 
+        // than that are padded with sentinel control bytes.
+        static constexpr size_t GROUP_SIZE = 16;
+        static constexpr int8_t CTRL_EMPTY = -128;
+        static constexpr int8_t CTRL_DELETED = -2;
+        static constexpr int8_t CTRL_SENTINEL = -1;
+        static constexpr size_t ALLOC_ALIGNMENT = alignof(Entry) > GROUP_SIZE ? alignof(Entry) : GROUP_SIZE;
+
+        struct Group
+        {
+            explicit Group(const int8_t* ctrl)
+                : Ctrl(_mm_load_si128(reinterpret_cast<const __m128i*>(ctrl)))
+            {}
+
+            // Bit i is set when control byte i equals h
+            ZetaInline uint32_t Match(int8_t h) const
+            {
+                return _mm_movemask_epi8(_mm_cmpeq_epi8(Ctrl, _mm_set1_epi8(h)));
+            }
+
+            ZetaInline uint32_t MatchEmpty() const
+            {
+                return Match(CTRL_EMPTY);
+            }
+
+            // Empty or deleted (sentinels excluded)
+            ZetaInline uint32_t MatchFree() const
+            {
+                return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(CTRL_SENTINEL), Ctrl));
+            }
+
+            __m128i Ctrl;
+        };
+
+        ZetaInline static int8_t tag(KeyType key)
+        {
+            // Keys are already hashed, but bucket index uses the low bits -- mix so 
+            // that the tag is independent of the bucket index
+            return (int8_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> 57);
+        }
+
+        ZetaInline static size_t num_groups(size_t n)
+        {
+            return n < GROUP_SIZE ? 1 : n / GROUP_SIZE;
+        }
+
+        ZetaInline static size_t ctrl_offset(size_t n)
+        {
+            return Math::AlignUp(n * sizeof(Entry), GROUP_SIZE);
+        }
+
+        ZetaInline static size_t alloc_size(size_t n)
+        {
+            return ctrl_offset(n) + Math::Max(n, GROUP_SIZE);
+        }
+
+        // Returns NULL if key is not found
         Entry* find_entry(KeyType key) const
         {
             const size_t n = bucket_count();
             if (n == 0)
                 return nullptr;
 
-            const size_t origPos = key & (n - 1);    // == key % n (n is a power of two)
-            size_t nextPos = origPos;
-            Entry* curr = m_beg + origPos;
-            Entry* tombstone = nullptr;
+            const int8_t h = tag(key);
+            const size_t numGroups = num_groups(n);
+            size_t g = ((size_t)key & (n - 1)) / GROUP_SIZE;    // n is a power of two
 
-            // Which bucket the entry belongs to
-            while (curr->Key != key && curr->Key != NULL_KEY)
+            for (size_t i = 0; i < numGroups; i++)
             {
-                // Remember tombstone entries but keep probing
-                if (curr->Key == TOMBSTONE_KEY)
-                    tombstone = curr;
- 
-                nextPos++;                                  // Linear probing
-                nextPos = nextPos < n ? nextPos : 0;        // Wrap around to zero
-                curr = m_beg + nextPos;
-                Assert(nextPos != origPos, "infinite loop");    // Should never happen due to load_factor < 1
+                const Group group(m_ctrl + g * GROUP_SIZE);
+                uint32_t match = group.Match(h);
+                unsigned long lane;
+
+                while (_BitScanForward(&lane, match))
+                {
+                    Entry* e = m_beg + g * GROUP_SIZE + lane;
+                    if (e->Key == key)
+                        return e;
+
+                    match &= match - 1;
+                }
+
+                // Insertion would've stopped at this group
+                if (group.MatchEmpty())
+                    return nullptr;
+
+                g = g + 1 < numGroups ? g + 1 : 0;      // Linear probing over groups
             }
 
-            if (curr->Key == key)
-                return curr;
+            return nullptr;
+        }
+
+        // Returns index of the first empty or deleted bucket in key's probe sequence
+        size_t find_free_bucket(KeyType key) const
+        {
+            const size_t n = bucket_count();
+            const size_t pos = (size_t)key & (n - 1);
+            const size_t numGroups = num_groups(n);
+            size_t g = pos / GROUP_SIZE;
+            // In the first group, prefer buckets starting from key's position, so that 
+            // keys that land in the same group don't all pile up at its start
+            uint32_t startLane = (uint32_t)(pos & (GROUP_SIZE - 1));
+
+            for (size_t i = 0; i < numGroups; i++)
+            {
+                const uint32_t freeMask = Group(m_ctrl + g * GROUP_SIZE).MatchFree();
+
+                if (freeMask)
+                {
+                    const uint32_t rotated = ((freeMask >> startLane) | (freeMask << (GROUP_SIZE - startLane))) & 0xffff;
+                    unsigned long lane;
+                    _BitScanForward(&lane, rotated);
+
+                    return g * GROUP_SIZE + ((lane + startLane) & (GROUP_SIZE - 1));
+                }
+
+                startLane = 0;
+                g = g + 1 < numGroups ? g + 1 : 0;
+            }
 
-            return tombstone ? tombstone : curr;
+            Assert(false, "Hash table is full.");    // Should never happen due to load_factor < 1
+            return 0;
+        }
+
+        // Returns the entry for given key if it exists. Otherwise, returns a new entry with 
+        // its key set and an unconstructed value, and sets "inserted" to true.
+        Entry* find_or_prepare_insert(KeyType key, bool& inserted)
+        {
+            Assert(key != NULL_KEY && key != TOMBSTONE_KEY, "Invalid key.");
+
+            Entry* elem = find_entry(key);
+            inserted = elem == nullptr;
+            if (elem)
+                return elem;
+
+            size_t idx = m_beg ? find_free_bucket(key) : 0;
+
+            if (m_beg && m_ctrl[idx] == CTRL_DELETED)
+                m_numNonTombstoneEntries++;
+            else
+            {
+                if (!m_beg || load_factor() >= MAX_LOAD || m_numEntries + 1 == bucket_count())
+                {
+                    relocate(Math::Max(bucket_count() << 1, MIN_NUM_BUCKETS));
+                    // Find the new position to construct this Entry
+                    idx = find_free_bucket(key);
+                }
+
+                m_numEntries++;
+                m_numNonTombstoneEntries++;
+                Assert(m_numEntries < bucket_count(), "Load factor should never be 1.0.");
+            }
+
+            m_ctrl[idx] = tag(key);
+            m_beg[idx].Key = key;
+
+            return m_beg + idx;
+        }
+
+        ZetaInline Entry* next_occupied(size_t i) const
+        {
+            const size_t n = bucket_count();
+            while (i < n && m_ctrl[i] < 0)
+                i++;
+
+            return m_beg + i;
+        }
+
+        void destruct_all()
+        {
+            if constexpr (!std::is_trivially_destructible_v<ValueType>)
+            {
+                size_t i = 0;
+
+                for (auto it = begin_it(); it < end_it(); it = next_it(it))
+                {
+                    it->Val.~ValueType();
+                    i++;
+                }
+
+                Assert(i == m_numNonTombstoneEntries, "Number of cleared entries must match the number of entries.");
+            }
         }
 
         void relocate(size_t n)
@@ -375,56 +421,57 @@ namespace ZetaRay::Util
             Assert(Math::IsPow2(n), "n must be a power of two.");
             Assert(n > bucket_count(), "n must be greater than the current bucket count.");
             Entry* oldTable = m_beg;
+            const int8_t* oldCtrl = m_ctrl;
             const size_t oldBucketCount = bucket_count();
 
-            m_beg = reinterpret_cast<Entry*>(m_allocator.AllocateAligned(n * sizeof(Entry), alignof(Entry)));
+            uint8_t* mem = reinterpret_cast<uint8_t*>(m_allocator.AllocateAligned(alloc_size(n), ALLOC_ALIGNMENT));
+            m_beg = reinterpret_cast<Entry*>(mem);
             m_end = m_beg + n;  // Adjust end pointer
+            m_ctrl = reinterpret_cast<int8_t*>(mem + ctrl_offset(n));
             m_numEntries = 0;
-            m_numNonTombstoneEntries = 0;
 
             // Initialize new table
-            for (Entry* curr = m_beg; curr != m_beg + n; curr++)
-            {
-                if constexpr (!std::is_trivially_default_constructible_v<Entry>)
-                    new (curr) Entry;
-
-                curr->Key = NULL_KEY;
-            }
+            memset(m_ctrl, CTRL_EMPTY, n);
+            if (n < GROUP_SIZE)
+                memset(m_ctrl + n, CTRL_SENTINEL, GROUP_SIZE - n);
 
             // Reinsert all elements
-            for (Entry* curr = oldTable; curr < oldTable + oldBucketCount; curr++)
+            for (size_t i = 0; i < oldBucketCount; i++)
             {
-                if (curr->Key == NULL_KEY || curr->Key == TOMBSTONE_KEY)
+                if (oldCtrl[i] < 0)
                     continue;
 
-                Entry* elem = find_entry(curr->Key);
-                Assert(elem->Key == NULL_KEY, "duplicate keys.");
-                elem->Key = curr->Key;
-                elem->Val = ZetaMove(curr->Val);
+                Entry* curr = oldTable + i;
+                const size_t idx = find_free_bucket(curr->Key);
+                Assert(m_ctrl[idx] == CTRL_EMPTY, "duplicate keys.");
+
+                m_ctrl[idx] = oldCtrl[i];
+                m_beg[idx].Key = curr->Key;
+                new (&m_beg[idx].Val) ValueType(ZetaMove(curr->Val));
+
+                // Destruct previous element (if necessary)
+                if constexpr (!std::is_trivially_destructible_v<ValueType>)
+                    curr->Val.~ValueType();
+
                 m_numEntries++;
             }
 
             m_numNonTombstoneEntries = m_numEntries;
 
-            // Destruct previous elements (if necessary)
-            if constexpr (!std::is_trivially_destructible_v<Entry>)
-            {
-                for (Entry* curr = oldTable; curr < oldTable + oldBucketCount; curr++)
-                    curr->~Entry();
-            }
-
             // Free the previously allocated memory
             if(oldTable)
-                m_allocator.FreeAligned(oldTable, oldBucketCount * sizeof(Entry), alignof(Entry));
+                m_allocator.FreeAligned(oldTable, alloc_size(oldBucketCount), ALLOC_ALIGNMENT);
         }
 
         static constexpr size_t MIN_NUM_BUCKETS = 4;
         static constexpr float MAX_LOAD = 0.8f;
+        // Not valid as keys
         static constexpr KeyType NULL_KEY = KeyType(-1);
         static constexpr KeyType TOMBSTONE_KEY = KeyType(-2);
 
         Entry* m_beg = nullptr;        // Pointer to the beginning of memory block
         Entry* m_end = nullptr;        // Pointer to the end of memory block
+        int8_t* m_ctrl = nullptr;      // Control bytes, stored right after the entries
         size_t m_numEntries = 0;
         size_t m_numNonTombstoneEntries = 0;
 #if defined(ZETA_HAS_NO_UNIQUE_ADDRESS)
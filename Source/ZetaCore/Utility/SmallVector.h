@@ -6,6 +6,12 @@
 
 namespace ZetaRay::Util
 {
+    // Types that can be moved to a new address with memcpy, after which the source is 
+    // considered destroyed (its destructor isn't called). Can be specialized for types 
+    // that are relocatable, but not trivially copyable.
+    template<typename T>
+    inline constexpr bool is_trivially_relocatable_v = std::is_trivially_copyable_v<T>;
+
     //--------------------------------------------------------------------------------------
     // Vector
     // 
@@ -209,6 +215,23 @@ namespace ZetaRay::Util
             }
         }
 
+        // Same as resize(), except that newly added elements are left uninitialized. Meant 
+        // for when they're about to be overwritten anyway.
+        void resize_uninitialized(size_t n)
+        {
+            static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>, 
+                "T must be trivially copyable and trivially destructible.");
+
+            if (capacity() < n)
+            {
+                void* mem = relocate(n);
+                m_beg = reinterpret_cast<T*>(mem);
+                m_last = m_beg + n;
+            }
+
+            m_end = m_beg + n;
+        }
+
         // Note: "Val" is used to initialize the newly added elements (if any) and the 
         // existing elements aren't replaced by it. May have to change in the future.
         void resize(size_t n, const T& val)
@@ -314,9 +337,9 @@ namespace ZetaRay::Util
                 reserve(newCapacity);
             }
 
-            if constexpr (std::is_trivially_constructible_v<T>)
+            if constexpr (std::is_trivially_copyable_v<T>)
             {
-                memcpy(m_beg + oldSize, const_cast<T*>(beg), sizeof(T) * num);
+                memcpy(m_beg + oldSize, beg, sizeof(T) * num);
             }
             else if constexpr (std::is_move_constructible_v<T>)
             {
@@ -437,6 +460,23 @@ namespace ZetaRay::Util
 
         void* relocate(size_t n)
         {
+            // Allocator may be able to grow the existing block in place, otherwise it does
+            // the memcpy. When empty, there's nothing to preserve, so a fresh allocation is 
+            // cheaper.
+            if constexpr (is_trivially_relocatable_v<T> && Support::ReallocatingAllocatorType<Allocator>)
+            {
+                const size_t currCapacity = capacity();
+
+                if (currCapacity && !empty() && !has_inline_storage())
+                {
+                    void* mem = m_allocator.ReallocateAligned(m_beg, currCapacity * sizeof(T),
+                        n * sizeof(T), alignof(T));
+                    Assert(mem, "Reallocation failed.");
+
+                    return mem;
+                }
+            }
+
             // Allocate memory to accommodate the new size
             void* mem = m_allocator.AllocateAligned(n * sizeof(T), alignof(T));
             const size_t oldSize = size();
@@ -444,7 +484,7 @@ namespace ZetaRay::Util
             // Copy over the old elements
             if (oldSize > 0)
             {
-                if constexpr (std::is_trivially_copyable_v<T>)
+                if constexpr (is_trivially_relocatable_v<T>)
                 {
                     // TODO overlap leads to undefined behavior
                     memcpy(mem, m_beg, sizeof(T) * oldSize);
@@ -480,8 +520,8 @@ namespace ZetaRay::Util
                 else
                     Assert(false, "Calling reserve() for a non-copyable and non-movable type T when Vector is non-empty is invalid.");
 
-                // Destruct old elements
-                if constexpr (!std::is_trivially_destructible_v<T>)
+                // Destruct old elements (relocated elements are considered destroyed)
+                if constexpr (!is_trivially_relocatable_v<T> && !std::is_trivially_destructible_v<T>)
                 {
                     for (T* curr = m_beg; curr < m_end; curr++)
                         curr->~T();
@@ -522,7 +562,7 @@ namespace ZetaRay::Util
                 // Doesn't allocate if inline storage happens to be large enough
                 reserve(other.size());
 
-                if constexpr (std::is_trivially_copyable_v<T>)
+                if constexpr (is_trivially_relocatable_v<T>)
                 {
                     memcpy(m_beg, other.m_beg, sizeof(T) * other.size());
                 }
@@ -559,7 +599,11 @@ namespace ZetaRay::Util
                 m_end = m_beg + other.size();
                 Assert(size() == other.size(), "These must be equal.");
 
-                other.clear();
+                // Relocated elements are considered destroyed
+                if constexpr (is_trivially_relocatable_v<T>)
+                    other.m_end = other.m_beg;
+                else
+                    other.clear();
             }
         }
 
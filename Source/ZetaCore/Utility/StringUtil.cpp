@@ -0,0 +1,48 @@
+#include "StringUtil.h"
+#include "Error.h"
+#include <stdarg.h>
+
+using namespace ZetaRay::Util;
+
+void ZetaRay::Util::AppendFormat(Vector<char>& str, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    const int n = stbsp_vsnprintf(nullptr, 0, fmt, args);
+    va_end(args);
+
+    const size_t oldSize = str.size();
+    // Grow geometrically to avoid reallocating on every append
+    if (oldSize + n + 1 > str.capacity())
+        str.reserve(Math::Max(str.capacity() * 2, oldSize + n + 1));
+
+    // +1 for the null terminator, which is popped afterwards
+    str.resize(oldSize + n + 1);
+
+    va_start(args, fmt);
+    stbsp_vsnprintf(str.data() + oldSize, n + 1, fmt, args);
+    va_end(args);
+
+    str.pop_back();
+}
+
+void ZetaRay::Util::AppendJsonString(Vector<char>& str, const char* s)
+{
+    str.push_back('"');
+
+    for (const char* c = s ? s : ""; *c != '\0'; c++)
+    {
+        if ((unsigned char)*c < 0x20)
+        {
+            AppendFormat(str, "\\u%04x", (unsigned char)*c);
+            continue;
+        }
+
+        if (*c == '"' || *c == '\\')
+            str.push_back('\\');
+
+        str.push_back(*c);
+    }
+
+    str.push_back('"');
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "SmallVector.h"
+
+namespace ZetaRay::Util
+{
+    // Appends formatted text to the end of str. str isn't null-terminated afterwards.
+    void AppendFormat(Vector<char>& str, const char* fmt, ...);
+
+    // Appends s as a quoted JSON string. Quotes and backslashes are escaped, control 
+    // characters are written as \u00XX.
+    void AppendJsonString(Vector<char>& str, const char* s);
+}
@@ -2,6 +2,7 @@
 
 #include "../Win32/Win32.h"
 #include "Span.h"
+#include <atomic>
 
 namespace ZetaRay::Util
 {
@@ -92,4 +93,101 @@ namespace ZetaRay::Util
     private:
         SRWLOCK& m_lock;
     };
+
+    template<typename T>
+    struct SnapshotBuffer;
+
+    // Pins the snapshot that was current when it was created. The snapshot stays valid 
+    // (and unchanged) for the lifetime of the view.
+    template<typename T>
+    struct RSnapshotView
+    {
+        ~RSnapshotView()
+        {
+            m_numReaders.fetch_sub(1, std::memory_order_release);
+        }
+        RSnapshotView(RSnapshotView&&) = delete;
+        RSnapshotView& operator=(RSnapshotView&&) = delete;
+
+        const T& View() const { return m_view; }
+
+    private:
+        friend struct SnapshotBuffer<T>;
+
+        RSnapshotView(const T& t, std::atomic_uint32_t& numReaders)
+            : m_view(t),
+            m_numReaders(numReaders)
+        {}
+
+        const T& m_view;
+        std::atomic_uint32_t& m_numReaders;
+    };
+
+    // Double-buffered alternative to RSynchronizedView for data that is read far more 
+    // often than it's written. Readers never take a lock -- they pin the most recently 
+    // published copy by incrementing its reader count, which writers only ever read. 
+    // Writers are serialized by an SRWLOCK that readers don't touch, update the other 
+    // copy and then publish it. Before reusing a copy, the writer waits for its readers, 
+    // which by then are at least one publish old.
+    //
+    // A thread must not call Update() more than once while holding a view of the same 
+    // buffer, otherwise it waits for itself.
+    template<typename T>
+    struct SnapshotBuffer
+    {
+        RSnapshotView<T> Read()
+        {
+            while (true)
+            {
+                const int idx = m_front.load(std::memory_order_acquire);
+                m_slots[idx].NumReaders.fetch_add(1, std::memory_order_seq_cst);
+
+                // A writer may have started reusing this copy between the load and the 
+                // increment above, in which case it's no longer the front
+                if (m_front.load(std::memory_order_seq_cst) == idx)
+                    return RSnapshotView<T>(m_slots[idx].Value, m_slots[idx].NumReaders);
+
+                m_slots[idx].NumReaders.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        // Calls fn() with a copy of the current value and then publishes it
+        template<typename Fn>
+        void Update(Fn fn)
+        {
+            AcquireSRWLockExclusive(&m_writeLock);
+
+            const int front = m_front.load(std::memory_order_relaxed);
+            const int back = 1 - front;
+            // Readers are expected to be short-lived, but don't burn the writer's time 
+            // slice if one of them got preempted
+            for (int numSpins = 0; m_slots[back].NumReaders.load(std::memory_order_seq_cst) != 0; 
+                numSpins++)
+            {
+                if (numSpins < MAX_NUM_SPINS)
+                    _mm_pause();
+                else
+                    SwitchToThread();
+            }
+
+            m_slots[back].Value = m_slots[front].Value;
+            fn(m_slots[back].Value);
+            m_front.store(back, std::memory_order_seq_cst);
+
+            ReleaseSRWLockExclusive(&m_writeLock);
+        }
+
+    private:
+        static constexpr int MAX_NUM_SPINS = 64;
+
+        struct alignas(64) Slot
+        {
+            T Value;
+            std::atomic_uint32_t NumReaders = 0;
+        };
+
+        Slot m_slots[2];
+        alignas(64) std::atomic_int32_t m_front = 0;
+        SRWLOCK m_writeLock = SRWLOCK_INIT;
+    };
 }
\ No newline at end of file
@@ -5,11 +5,20 @@
 #include "../Support/Param.h"
 #include "../Support/Stat.h"
 #include "../Core/RendererCore.h"
+#include "../Core/RenderGraph.h"
 #include "../Scene/SceneCore.h"
 #include "../Scene/Camera.h"
+#include "../Scene/CameraPath.h"
 #include "../Support/ThreadPool.h"
+#include "../Support/TaskTimeline.h"
+#include "../Support/LogBuffer.h"
+#include "../Support/FrameTimeStats.h"
+#include "../Support/BenchmarkRecorder.h"
+#include "../Support/InputRecording.h"
 #include "../Assets/Font/Font.h"
 #include "../Assets/Font/IconsFontAwesome6.h"
+#include "../Utility/HashTable.h"
+#include <algorithm>
 
 #define XXH_STATIC_LINKING_ONLY
 #define XXH_IMPLEMENTATION 
@@ -39,16 +48,73 @@ namespace
         int NextFramHistIdx = 0;
     };
 
+    // A frame that took much longer than the recent median. GPU timings for it are
+    // resolved a few frames later, so the snapshot is written once they're available.
+    struct Hitch
+    {
+        static constexpr int NUM_TOP_PASSES = 4;
+
+        // 0 when there's no pending hitch
+        uint64_t Frame = 0;
+        float FrameMs;
+        float MedianMs;
+        float P99Ms;
+        float CpuMs;
+        // -1 when GPU timings for this frame weren't available
+        float GpuMs;
+        int NumPasses;
+        char PassNames[NUM_TOP_PASSES][ZetaRay::Core::GpuTimer::Timing::MAX_NAME_LENGTH];
+        float PassMs[NUM_TOP_PASSES];
+        // Index of the frame in the input recording that's being recorded or replayed, 
+        // -1 otherwise
+        int64_t InputFrame;
+    };
+
+    // State of a benchmark run (see BenchmarkDesc)
+    struct Benchmark
+    {
+        BenchmarkDesc Desc;
+        CameraPath Path;
+        BenchmarkRecorder Recorder;
+        // Frame when warm-up started, 0 while the scene is loading
+        uint64_t StartFrame = 0;
+        // First timed frame
+        uint64_t FirstRunFrame = 0;
+        uint64_t LastGpuFrame = 0;
+        bool Done = false;
+
+        // Pass benchmark (see BenchmarkDesc::Pass)
+        static constexpr int MAX_NUM_SWEEP_VALUES = 16;
+        static constexpr int MAX_SWEEP_PARAM_LEN = 128;
+
+        char SweepParam[MAX_SWEEP_PARAM_LEN];
+        float SweepValues[MAX_NUM_SWEEP_VALUES];
+        int NumSweepValues = 0;
+        // Restored once the sweep is done
+        float SweepOrigValue = 0.0f;
+        // Current sweep value, -1 before the first one
+        int CurrStep = -1;
+        // Replays of current step start in this frame
+        uint64_t StepCaptureFrame = 0;
+        uint64_t StepTimeoutFrame = 0;
+    };
+
+    // Node of an intrusive lock-free stack, see App::AddParam()
     struct ParamUpdate
     {
         enum OP_TYPE
         {
             ADD,
-            REMOVE
+            TRY_ADD,
+            REMOVE,
+            INVOKE_CALLBACK
         };
 
+        // Only used for ADD and TRY_ADD
         ZetaRay::Support::ParamVariant P;
+        uint64_t ID;
         OP_TYPE Op;
+        ParamUpdate* Next;
     };
 
     // Ref: https://github.com/ysc3839/win32-darkmode
@@ -117,8 +183,26 @@ namespace
 {
     struct FrameMemoryContext
     {
+        // Written by the owner thread, read by the main thread between frames
+        struct alignas(64) ThreadStats
+        {
+            // Current frame
+            size_t BytesAllocated;
+            size_t LargestRequest;
+            uint32_t NumFallbacks;
+            // Since startup
+            size_t PeakBytesAllocated;
+            uint32_t TotalNumFallbacks;
+        };
+
         alignas(64) int m_threadFrameAllocIndices[MAX_NUM_THREADS] = { -1 };
         std::atomic_int32_t m_currFrameAllocIndex;
+        ThreadStats m_threadStats[MAX_NUM_THREADS] = {};
+        // Number of consecutive frames where largest request would've fit in a block 
+        // half the current size
+        int m_numFramesUnderused = 0;
+        uint32_t m_lastFrameNumFallbacks = 0;
+        uint32_t m_totalNumFallbacks = 0;
     };
 
     struct AppData
@@ -130,38 +214,113 @@ namespace
         inline static constexpr const char* DXC_PATH = "..\\Tools\\dxc\\bin\\x64\\dxc.exe";
         inline static constexpr const char* RENDER_PASS_DIR = "..\\Source\\ZetaRenderPass";
         static constexpr int NUM_BACKGROUND_THREADS = 2;
-        static constexpr int MAX_NUM_TASKS_PER_FRAME = 256;
+        static constexpr int MAX_NUM_TASKS_PER_FRAME = 1024;
         static constexpr int CLIPBOARD_LEN = 128;
-        static constexpr int FRAME_ALLOCATOR_BLOCK_SIZE = FRAME_ALLOCATOR_MAX_ALLOCATION_SIZE;
+        static constexpr int FRAME_ALLOCATOR_BLOCK_SIZE = FRAME_ALLOCATOR_BASE_BLOCK_SIZE;
+        static constexpr int FRAME_ALLOCATOR_SHRINK_DELAY = 300;
+        static constexpr int NUM_TASK_TIMELINE_EXPORT_FRAMES = 8;
+        // Frames that are shorter are never considered hitches
+        static constexpr float HITCH_MIN_MS = 5.0f;
+        // Frames after a hitch during which no new one is reported
+        static constexpr int HITCH_COOLDOWN_FRAMES = 60;
+        // Enough for GPU timings of the hitch frame to be resolved
+        static constexpr int HITCH_SNAPSHOT_DELAY = Constants::NUM_BACK_BUFFERS + 2;
+        inline static constexpr const char* HITCH_LOG_PATH = "Hitches.log";
+        // Every log message is appended to it, truncated on startup
+        inline static constexpr const char* LOG_FILE_PATH = "ZetaRay.log";
+        // Upper bound on how long to wait for the GPU timings of the last benchmark frame
+        static constexpr int BENCHMARK_DRAIN_FRAMES = 2 * Constants::NUM_BACK_BUFFERS + 2;
+        // Frames between changing a swept parameter and capturing the pass inputs, so that
+        // shader reloads and temporal history settle
+        static constexpr int PASS_BENCHMARK_SETTLE_FRAMES = 16;
+        // Gives up on a step when the replays can't be timed (e.g. node doesn't exist)
+        static constexpr int PASS_BENCHMARK_TIMEOUT_FRAMES = 600;
+        // Time between keyframes when recording a camera path, in seconds
+        static constexpr double CAMERA_PATH_KEYFRAME_INTERVAL = 0.25;
+        inline static constexpr const char* CAMERA_PATH_RECORDING_PATH = "CameraPath.txt";
+        inline static constexpr const char* INPUT_RECORDING_PATH = "InputRecording.bin";
+        inline static const char* ThreadPlacementOptions[] = { "OS Default", "Preferred", "Pinned" };
+        static_assert((int)THREAD_PLACEMENT::COUNT == ZetaArrayLen(ThreadPlacementOptions), "enum <-> string mismatch.");
+
+        enum PARK_STATE : uint8_t
+        {
+            NONE,
+            PARKED,
+            READY
+        };
 
         struct alignas(64) TaskSignal
         {
             std::atomic_int32_t Indegree;
             std::atomic_bool BlockFlag;
+            // Parking thread and the thread that signals the last dependency race to
+            // set this -- whoever comes second enqueues the task
+            std::atomic<PARK_STATE> ParkState;
         };
 
         TaskSignal m_registeredTasks[MAX_NUM_TASKS_PER_FRAME];
+        Task m_parkedTasks[MAX_NUM_TASKS_PER_FRAME];
 
         FrameMemoryContext m_frameMemoryContext;
         Camera m_camera;
         FrameMemory<FRAME_ALLOCATOR_BLOCK_SIZE> m_frameMemory;
         ThreadPool m_workerThreadPool;
         ThreadPool m_backgroundThreadPool;
+        CpuInfo m_cpuInfo;
+        HANDLE m_mainThread = nullptr;
+        TaskTimeline m_taskTimeline;
         RendererCore m_renderer;
         Timer m_timer;
         SceneCore m_scene;
         Core::GpuMemory::Texture m_imguiFontTex;
         Core::DescriptorTable m_fontTexSRV;
+        // Sorted by group, subgroup, subsubgroup and name
         SmallVector<ParamVariant> m_params;
-        SmallVector<ParamUpdate, SystemAllocator, 32> m_paramsUpdates;
+        // Index into m_params for each param ID
+        HashTable<uint32_t> m_paramIndex;
+        // Most recent first
+        std::atomic<ParamUpdate*> m_paramUpdates = nullptr;
         SmallVector<ShaderReloadHandler> m_shaderReloadHandlers;
-        SmallVector<Stat, FrameAllocator> m_frameStats;
+        // Per-thread stats for the current frame, appended to without synchronization by
+        // the owning thread (indexed by g_threadIdx)
+        struct alignas(64) ThreadStatBuffer
+        {
+            SmallVector<Stat> Stats;
+        };
+        ThreadStatBuffer m_threadStatBuffers[MAX_NUM_THREADS];
+        // Stats from threads without a valid index, protected by m_statsLock
+        SmallVector<Stat> m_unindexedStats;
+        // Previous frame's stats, merged from the above at the start of every frame. 
+        // Double buffered so that the GUI always reads a complete snapshot.
+        SmallVector<Stat> m_statSnapshots[2];
+        int m_currStatSnapshot = 0;
         MemoryArena m_logStrArena;
         SmallVector<LogMessage> m_frameLogs;
+        LogBuffer m_logBuffer;
+        // Scratch space for draining m_logBuffer, reused every frame
+        SmallVector<LogBuffer::Message> m_drainedLogs;
+        SmallVector<char> m_drainedLogText;
+        // Lines that haven't been written to the log file yet, protected by m_logLock
+        SmallVector<char> m_logFileLines;
+        // Lines that the background task is writing
+        SmallVector<char> m_logFileWriteLines;
+        std::atomic_bool m_logFileWriteInFlight = false;
+        HeadlessDesc m_headless;
+        // Headless jobs that follow the current one (see App::QueueHeadlessJob())
+        SmallVector<HeadlessDesc> m_headlessJobs;
+        uint32_t m_nextHeadlessJob = 0;
+        std::atomic_bool m_headlessJobDone = false;
+        Benchmark m_benchmark;
+        CameraPath m_recordedPath;
+        double m_lastKeyframeTime = 0.0;
+        InputRecording m_inputRecording;
+        // Frame when replay started, 0 while the scene is loading
+        uint64_t m_replayStartFrame = 0;
+        // Not recorded, so that replays don't start recording
+        uint64_t m_recordInputParamID = 0;
 
         SRWLOCK m_stdOutLock = SRWLOCK_INIT;
         SRWLOCK m_paramLock = SRWLOCK_INIT;
-        SRWLOCK m_paramUpdateLock = SRWLOCK_INIT;
         SRWLOCK m_shaderReloadLock = SRWLOCK_INIT;
         SRWLOCK m_statsLock = SRWLOCK_INIT;
         SRWLOCK m_logLock = SRWLOCK_INIT;
@@ -169,6 +328,13 @@ namespace
         HWND m_hwnd;
         HWND m_imguiMouseHwnd;
         FrameTime m_frameTime;
+        FrameTimeStats m_frameTimeStats;
+        Hitch m_pendingHitch;
+        // Copy of the pending hitch that the background task writes out
+        Hitch m_hitchSnapshot;
+        std::atomic_bool m_hitchSnapshotInFlight = false;
+        uint64_t m_lastHitchFrame = 0;
+        uint32_t m_numHitches = 0;
         Motion m_frameMotion;
         std::atomic_int32_t m_currTaskSignalIdx = 0;
         int m_inMouseWheelMove = 0;
@@ -179,6 +345,14 @@ namespace
         float m_upscaleFactor = 1.0f;
         float m_queuedUpscaleFactor = 1.0f;
         float m_cameraAcceleration = 40.0f;
+        // Moving averages of the main thread's critical path (start of frame until render 
+        // submission) and frame time, in milliseconds
+        float m_criticalPathMsAvg = 0.0f;
+        float m_frameTimeMsAvg = 0.0f;
+        // Critical path of the last frame, -1 when unknown
+        float m_criticalPathMs = -1.0f;
+        // Frames longer than this times the median are reported as hitches
+        float m_hitchThreshold = 2.0f;
         RECT m_dpiChangeNewRect;
         uint16_t m_processorCoreCount = 0;
         uint16_t m_displayWidth;
@@ -192,14 +366,30 @@ namespace
         bool m_manuallyPaused = false;
         bool m_picked = false;
         bool m_multiPick = false;
+        bool m_clearPick = false;
         bool m_inSizeMove = false;
         bool m_minimized = false;
         bool m_isFullScreen = false;
         bool m_imguiMouseTracked = false;
         char m_clipboard[CLIPBOARD_LEN];
         bool m_isInitialized = false;
+        bool m_frameAwareBackgroundScheduling = true;
+        THREAD_PLACEMENT m_threadPlacement = THREAD_PLACEMENT::PREFERRED;
+        std::atomic_bool m_exportTaskTimeline = false;
+        std::atomic_bool m_inFrameCriticalPath = false;
         bool m_issueResize = false;
         bool m_dpiChanged = false;
+        bool m_isHeadless = false;
+        bool m_isBenchmark = false;
+        bool m_recordingCameraPath = false;
+        bool m_recordingInput = false;
+        // Recording starts at the beginning of the next frame
+        bool m_beginInputRecording = false;
+        bool m_replayingInput = false;
+        bool m_replayDone = false;
+        std::atomic_bool m_exitRequested = false;
+        // Returned by Run()
+        int m_exitCode = 0;
     };
 
     AppData* g_app = nullptr;
@@ -606,9 +796,186 @@ namespace ZetaRay::AppImpl
         ImNodes::GetIO().AltMouseButton = ImGuiMouseButton_Right;
     }
 
+    // Busy time of the GPU (across all queues) for the last resolved frame, -1 if unknown
+    float GpuBusyMs()
+    {
+        auto timings = g_app->m_renderer.GetGpuTimer().GetFrameTimings();
+        if (timings.empty())
+            return -1.0f;
+
+        // Begin and End are relative to the earliest query of the frame
+        double end = 0.0;
+        for (auto& t : timings)
+            end = Math::Max(end, t.End);
+
+        return (float)end;
+    }
+
+    void DetectHitch(float frameTimeMs)
+    {
+        auto& hitch = g_app->m_pendingHitch;
+        const uint64_t currFrame = g_app->m_timer.GetTotalFrameCount();
+
+        if (hitch.Frame != 0 || currFrame < g_app->m_lastHitchFrame + AppData::HITCH_COOLDOWN_FRAMES)
+            return;
+
+        if (!g_app->m_frameTimeStats.IsHitch(frameTimeMs, AppData::HITCH_MIN_MS, g_app->m_hitchThreshold))
+            return;
+
+        // Elapsed time is measured at the start of this frame, so it belongs to the previous one
+        hitch.Frame = currFrame - 1;
+        hitch.FrameMs = frameTimeMs;
+        hitch.MedianMs = g_app->m_frameTimeStats.Percentile(0.5f);
+        hitch.P99Ms = g_app->m_frameTimeStats.Percentile(0.99f);
+        hitch.CpuMs = g_app->m_criticalPathMs;
+        hitch.GpuMs = -1.0f;
+        hitch.NumPasses = 0;
+        hitch.InputFrame = -1;
+
+        if (g_app->m_replayingInput && g_app->m_replayStartFrame != 0)
+            hitch.InputFrame = (int64_t)hitch.Frame - (int64_t)g_app->m_replayStartFrame;
+        else if (g_app->m_recordingInput && !g_app->m_beginInputRecording)
+            hitch.InputFrame = (int64_t)(hitch.Frame - g_app->m_inputRecording.FirstFrameNum());
+
+        g_app->m_lastHitchFrame = hitch.Frame;
+        g_app->m_numHitches++;
+    }
+
+    void ExportTaskTimeline(const char* path, uint64_t firstFrame);
+
+    void UpdatePendingHitch()
+    {
+        auto& hitch = g_app->m_pendingHitch;
+        if (hitch.Frame == 0)
+            return;
+
+        // Capture the GPU timings if they're for the hitch frame
+        auto& gpuTimer = g_app->m_renderer.GetGpuTimer();
+        if (gpuTimer.GetLastFrameCompletion().FrameNum == hitch.Frame && hitch.GpuMs < 0.0f)
+        {
+            hitch.GpuMs = GpuBusyMs();
+
+            // Insertion sort into the (small) list of most expensive passes
+            for (auto& t : gpuTimer.GetFrameTimings())
+            {
+                int pos = hitch.NumPasses;
+                while (pos > 0 && hitch.PassMs[pos - 1] < (float)t.Delta)
+                    pos--;
+
+                if (pos == Hitch::NUM_TOP_PASSES)
+                    continue;
+
+                const int last = Math::Min(hitch.NumPasses, Hitch::NUM_TOP_PASSES - 1);
+                for (int i = last; i > pos; i--)
+                {
+                    hitch.PassMs[i] = hitch.PassMs[i - 1];
+                    memcpy(hitch.PassNames[i], hitch.PassNames[i - 1], sizeof(hitch.PassNames[i]));
+                }
+
+                hitch.PassMs[pos] = (float)t.Delta;
+                memcpy(hitch.PassNames[pos], t.Name, sizeof(hitch.PassNames[pos]));
+                hitch.NumPasses = Math::Min(hitch.NumPasses + 1, Hitch::NUM_TOP_PASSES);
+            }
+        }
+
+        const uint64_t currFrame = g_app->m_timer.GetTotalFrameCount();
+        if (currFrame < hitch.Frame + AppData::HITCH_SNAPSHOT_DELAY ||
+            g_app->m_hitchSnapshotInFlight.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        g_app->m_hitchSnapshot = hitch;
+        g_app->m_hitchSnapshotInFlight.store(true, std::memory_order_relaxed);
+
+        // Writing the trace isn't cheap and shouldn't cause another hitch
+        Task t("HitchSnapshot", TASK_PRIORITY::BACKGROUND, []()
+            {
+                const Hitch& hitch = g_app->m_hitchSnapshot;
+
+                StackStr(tracePath, n, "Hitch_%llu.json", hitch.Frame);
+                ExportTaskTimeline(tracePath, hitch.Frame > 1 ? hitch.Frame - 1 : 1);
+
+                char line[512];
+                int len = stbsp_snprintf(line, sizeof(line), "Frame %llu: %.2f ms (median: %.2f ms, p99: %.2f ms), "
+                    "CPU critical path: %.2f ms, GPU: ", hitch.Frame, hitch.FrameMs, hitch.MedianMs,
+                    hitch.P99Ms, hitch.CpuMs);
+
+                if (hitch.GpuMs >= 0.0f)
+                {
+                    len += stbsp_snprintf(line + len, sizeof(line) - len, "%.2f ms (dominated by %s)",
+                        hitch.GpuMs, hitch.GpuMs > hitch.CpuMs ? "GPU" : "CPU");
+
+                    for (int i = 0; i < hitch.NumPasses; i++)
+                    {
+                        len += stbsp_snprintf(line + len, sizeof(line) - len, "%s%s: %.2f ms", 
+                            i == 0 ? ", passes: " : ", ", hitch.PassNames[i], hitch.PassMs[i]);
+                    }
+                }
+                else
+                    len += stbsp_snprintf(line + len, sizeof(line) - len, "unavailable");
+
+                if (hitch.InputFrame >= 0)
+                {
+                    len += stbsp_snprintf(line + len, sizeof(line) - len, ", input recording frame: %lld",
+                        hitch.InputFrame);
+                }
+
+                len += stbsp_snprintf(line + len, sizeof(line) - len, ", trace: %s\n", tracePath);
+                Filesystem::AppendToFile(AppData::HITCH_LOG_PATH, reinterpret_cast<uint8_t*>(line), 
+                    (uint32_t)len);
+
+                LOG_UI_WARNING("Hitch in frame %llu (%.2f ms), see %s.", hitch.Frame, hitch.FrameMs, 
+                    AppData::HITCH_LOG_PATH);
+
+                g_app->m_hitchSnapshotInFlight.store(false, std::memory_order_release);
+            });
+
+        App::SubmitBackground(ZetaMove(t));
+        hitch.Frame = 0;
+    }
+
+    // Called at the start of a frame, when all the worker tasks from the previous 
+    // frame have finished
+    void MergeFrameStats()
+    {
+        const int next = 1 - g_app->m_currStatSnapshot;
+        auto& snapshot = g_app->m_statSnapshots[next];
+        snapshot.clear();
+
+        for (int i = 0; i < MAX_NUM_THREADS; i++)
+        {
+            auto& stats = g_app->m_threadStatBuffers[i].Stats;
+            snapshot.append_range(stats.begin(), stats.end());
+            stats.clear();
+        }
+
+        AcquireSRWLockExclusive(&g_app->m_statsLock);
+        snapshot.append_range(g_app->m_unindexedStats.begin(), g_app->m_unindexedStats.end());
+        g_app->m_unindexedStats.clear();
+        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+
+        g_app->m_currStatSnapshot = next;
+    }
+
+    template<typename... Args>
+    ZetaInline void AddStat(Args&&... args)
+    {
+        if (g_threadIdx >= 0 && g_threadIdx < MAX_NUM_THREADS)
+        {
+            g_app->m_threadStatBuffers[g_threadIdx].Stats.emplace_back(ZetaForward(args)...);
+            return;
+        }
+
+        AcquireSRWLockExclusive(&g_app->m_statsLock);
+        g_app->m_unindexedStats.emplace_back(ZetaForward(args)...);
+        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+    }
+
     void UpdateStats(size_t tempMemoryUsage)
     {
-        g_app->m_frameStats.free_memory();
+        MergeFrameStats();
+        auto& outStats = g_app->m_threadStatBuffers[g_threadIdx].Stats;
 
         const float frameTimeMs = g_app->m_timer.GetTotalFrameCount() > 1 ?
             (float)(g_app->m_timer.GetElapsedTime() * 1000.0f) :
@@ -627,163 +994,725 @@ namespace ZetaRay::AppImpl
             frameStats.FrameTimeHist[frameStats.HIST_LEN - 1] = frameTimeMs;
         }
 
-        DXGI_QUERY_VIDEO_MEMORY_INFO memoryInfo = {};
-        CheckHR(g_app->m_renderer.GetAdapter()->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &memoryInfo));
-
-        if (memoryInfo.CurrentUsage > memoryInfo.Budget)
-            LOG_UI_WARNING("VRAM usage exceeded available budget; performance can be severely impacted.");
+        // Crossing the budget is reported by GpuMemory
+        const GpuMemory::VideoMemoryInfo memoryInfo = GpuMemory::GetVideoMemoryInfo();
 
         float movingAvg = 0;
         constexpr int N = 8;
         for (int i = 0; i < N; i++)
             movingAvg += frameStats.FrameTimeHist[frameStats.HIST_LEN - 1 - i];
 
-        g_app->m_frameStats.emplace_back("Frame", "FPS", g_app->m_timer.GetFramesPerSecond());
-        g_app->m_frameStats.emplace_back("Frame", "Frame time", movingAvg / N);
-        g_app->m_frameStats.emplace_back("GPU", "VRAM Usage (MB)", memoryInfo.CurrentUsage >> 20);
-        g_app->m_frameStats.emplace_back("GPU", "VRAM Budget (MB)", memoryInfo.Budget >> 20);
-        g_app->m_frameStats.emplace_back("Frame", "Frame temp memory usage (kb)", tempMemoryUsage >> 10);
+        if (frameTimeMs > 0.0f)
+        {
+            // Tested against the window before this frame is added
+            DetectHitch(frameTimeMs);
+            // GPU time is from the last resolved frame, which lags behind by a few frames
+            g_app->m_frameTimeStats.Add(frameTimeMs, g_app->m_criticalPathMs, GpuBusyMs());
+        }
+
+        UpdatePendingHitch();
+
+        const FrameTimeStats::Summary summary = g_app->m_frameTimeStats.Compute();
+
+        outStats.emplace_back("Frame", "FPS", g_app->m_timer.GetFramesPerSecond());
+        outStats.emplace_back("Frame", "Frame time", movingAvg / N);
+        outStats.emplace_back("Frame", "Frame time p50 (ms)", summary.P50);
+        outStats.emplace_back("Frame", "Frame time p95 (ms)", summary.P95);
+        outStats.emplace_back("Frame", "Frame time p99 (ms)", summary.P99);
+        outStats.emplace_back("Frame", "Frame time max (ms)", summary.Max);
+        outStats.emplace_back("Frame", "GPU-bound frames (%)", summary.GpuBoundFraction * 100.0f);
+        outStats.emplace_back("Frame", "Hitches", g_app->m_numHitches);
+        outStats.emplace_back("GPU", "VRAM Usage (MB)", memoryInfo.CurrentUsage >> 20);
+        outStats.emplace_back("GPU", "VRAM Budget (MB)", memoryInfo.Budget >> 20);
+
+        const char* categoryNames[] = { "Textures (MB)", "Acceleration structures (MB)", 
+            "Render targets (MB)", "Buffers (MB)", "Upload (MB)", "Readback (MB)" };
+        static_assert(ZetaArrayLen(categoryNames) == (int)GpuMemory::MEMORY_CATEGORY::COUNT);
+
+        for (int i = 0; i < (int)GpuMemory::MEMORY_CATEGORY::COUNT; i++)
+        {
+            outStats.emplace_back("GPU Memory", categoryNames[i], 
+                memoryInfo.CategoryUsage[i] >> 20);
+        }
+        outStats.emplace_back("Frame", "Frame temp memory usage (kb)", tempMemoryUsage >> 10);
+
+        auto& frameMemCtx = g_app->m_frameMemoryContext;
+        outStats.emplace_back("Frame Memory", "Block size (kb)", 
+            (uint32_t)(g_app->m_frameMemory.BlockSize() >> 10));
+        outStats.emplace_back("Frame Memory", "#Blocks", 
+            (uint32_t)g_app->m_frameMemory.NumAllocatedBlocks());
+        outStats.emplace_back("Frame Memory", "Heap fallbacks (last frame)", 
+            frameMemCtx.m_lastFrameNumFallbacks);
+        outStats.emplace_back("Frame Memory", "Heap fallbacks (total)", 
+            frameMemCtx.m_totalNumFallbacks);
+
+        for (int i = 0; i < MAX_NUM_THREADS; i++)
+        {
+            const size_t peak = frameMemCtx.m_threadStats[i].PeakBytesAllocated;
+            if (peak == 0)
+                continue;
+
+            StackStr(name, n, "Thread %d peak (kb)", i);
+            outStats.emplace_back("Frame Memory", name, (uint32_t)(peak >> 10));
+        }
     }
 
-    void Update(TaskSet& sceneTS, TaskSet& sceneRendererTS, size_t tempMemoryUsage)
+    void UpdateBenchmark()
     {
-        UpdateStats(tempMemoryUsage);
+        auto& bench = g_app->m_benchmark;
+        const uint64_t currFrame = g_app->m_timer.GetTotalFrameCount();
 
-        ImGui_UpdateMouse();
-        ImGui_ProcessKeyEventsWorkarounds();
+        if (bench.Done)
+            return;
 
-        // Update OS mouse cursor with the cursor requested by imgui
-        ImGuiMouseCursor mouse_cursor = ImGui::GetIO().MouseDrawCursor ? ImGuiMouseCursor_None :
-            ImGui::GetMouseCursor();
-        if (g_app->m_imguiCursor != mouse_cursor)
+        if (bench.StartFrame == 0)
         {
-            g_app->m_imguiCursor = mouse_cursor;
-            ImGui_UpdateMouseCursor();
+            if (g_app->m_scene.IsLoading())
+                return;
+
+            bench.StartFrame = currFrame;
+            bench.FirstRunFrame = currFrame + bench.Desc.NumWarmupFrames;
+
+            LOG_UI(INFO, "Benchmark: scene loaded, warming up for %u frames...", bench.Desc.NumWarmupFrames);
         }
 
-        ImGui::NewFrame();
+        const uint64_t lastRunFrame = bench.FirstRunFrame + bench.Recorder.NumFrames() - 1;
 
-        if (!(GetAsyncKeyState(VK_LSHIFT) & (1 << 15)))
+        // Elapsed time and critical path belong to the previous frame
+        if (currFrame > bench.FirstRunFrame && currFrame - 1 <= lastRunFrame)
         {
-            float scale = g_app->m_inMouseWheelMove ? g_app->m_inMouseWheelMove * 20 : 1.0f;
-            scale = g_app->m_frameMotion.Acceleration.z != 0 || g_app->m_frameMotion.Acceleration.x != 0 ?
-                fabsf(scale) : scale;
+            bench.Recorder.SetFrameTimes((uint32_t)(currFrame - 1 - bench.FirstRunFrame),
+                (float)(g_app->m_timer.GetElapsedTime() * 1000.0), g_app->m_criticalPathMs);
 
-            if (g_app->m_inMouseWheelMove || (GetAsyncKeyState('W') & (1 << 16)))
-                g_app->m_frameMotion.Acceleration.z = 1;
-            if (GetAsyncKeyState('A') & (1 << 16))
-                g_app->m_frameMotion.Acceleration.x = -1;
-            if (!g_app->m_inMouseWheelMove && (GetAsyncKeyState('S') & (1 << 16)))
-                g_app->m_frameMotion.Acceleration.z = -1;
-            if (GetAsyncKeyState('D') & (1 << 16))
-                g_app->m_frameMotion.Acceleration.x = 1;
+            // All the tasks from previous frame have finished by now
+            SmallVector<TaskTimeline::TaskTime, FrameAllocator, 64> taskTimes;
+            g_app->m_taskTimeline.SumTaskTimes(currFrame - 1, taskTimes);
 
-            g_app->m_frameMotion.Acceleration.normalize();
-            g_app->m_frameMotion.Acceleration *= g_app->m_cameraAcceleration * scale;
+            for (auto& t : taskTimes)
+                bench.Recorder.AddTaskTime(t.Name, t.Ms);
         }
-        else
+
+        // GPU timings are resolved a few frames later. Only the last resolved frame is 
+        // available, so a frame may occasionally be missed.
+        auto& gpuTimer = g_app->m_renderer.GetGpuTimer();
+        const uint64_t gpuFrame = gpuTimer.GetLastFrameCompletion().FrameNum;
+
+        if (gpuFrame != bench.LastGpuFrame && gpuFrame >= bench.FirstRunFrame && gpuFrame <= lastRunFrame)
         {
-            if (g_app->m_inMouseWheelMove)
-                g_app->m_cameraAcceleration *= (1 + g_app->m_inMouseWheelMove * 0.1f);
-        }
+            bench.Recorder.SetGpuTime((uint32_t)(gpuFrame - bench.FirstRunFrame), GpuBusyMs());
 
-        g_app->m_inMouseWheelMove = 0;
-        g_app->m_frameMotion.dt = (float)g_app->m_timer.GetElapsedTime();
+            for (auto& t : gpuTimer.GetFrameTimings())
+                bench.Recorder.AddPassTime(t.Name, (float)t.Delta);
+        }
 
-        g_app->m_camera.Update(g_app->m_frameMotion);
+        bench.LastGpuFrame = gpuFrame;
 
-        if (g_app->m_picked)
+        // Done once the last frame's CPU and GPU timings are both in (or the latter timed out)
+        const bool gpuDone = gpuFrame != UINT64_MAX && gpuFrame >= lastRunFrame;
+        if (currFrame > lastRunFrame && (gpuDone || currFrame > lastRunFrame + AppData::BENCHMARK_DRAIN_FRAMES))
         {
-            if (g_app->m_multiPick)
-                g_app->m_scene.MultiPick(g_app->m_lastLMBClickPosX, g_app->m_lastLMBClickPosY);
-            else
-                g_app->m_scene.Pick(g_app->m_lastLMBClickPosX, g_app->m_lastLMBClickPosY);
+            const uint32_t numRegressions = bench.Desc.BaselinePath ?
+                bench.Recorder.CompareToBaseline(bench.Desc.BaselinePath, bench.Desc.TolerancePct) : 0;
 
-            g_app->m_picked = false;
-            g_app->m_multiPick = false;
+            bench.Recorder.WriteJson(bench.Desc.OutputPath, bench.Desc, g_app->m_renderer.GetDeviceDescription(),
+                g_app->m_renderer.GetRenderWidth(), g_app->m_renderer.GetRenderHeight());
+
+            BenchmarkRecorder::Summary frame;
+            BenchmarkRecorder::Summary cpu;
+            BenchmarkRecorder::Summary gpu;
+            bench.Recorder.Summarize(frame, cpu, gpu);
+
+            LOG_UI(INFO, "Benchmark: %u frames, frame time mean: %.2f ms, p99: %.2f ms, GPU mean: %.2f ms. "
+                "Results written to %s.", bench.Recorder.NumFrames(), frame.Mean, frame.P99, gpu.Mean,
+                bench.Desc.OutputPath);
+
+            if (bench.Desc.BaselinePath)
+            {
+                if (numRegressions)
+                {
+                    LOG_UI_WARNING("Benchmark: %u regression(s) compared to %s (tolerance: %.1f%%).",
+                        numRegressions, bench.Desc.BaselinePath, bench.Desc.TolerancePct);
+                    g_app->m_exitCode = 1;
+                }
+                else
+                {
+                    LOG_UI(INFO, "Benchmark: no regressions compared to %s (tolerance: %.1f%%).",
+                        bench.Desc.BaselinePath, bench.Desc.TolerancePct);
+                }
+            }
+
+            bench.Done = true;
+            App::RequestExit();
+
+            return;
+        }
+
+        // Camera stays at the start of the path during warm-up
+        const double t = currFrame > bench.FirstRunFrame ? 
+            (currFrame - bench.FirstRunFrame) * (double)bench.Desc.Timestep : 0.0;
+
+        auto& motion = g_app->m_frameMotion;
+        bench.Path.Sample((float)t, motion.Pos, motion.ViewDir);
+        motion.HasPose = true;
+
+        // Path is known ahead of time, so is where the camera is headed
+        for (int i = 0; i < NUM_PREDICTED_CAMERA_POSES; i++)
+        {
+            bench.Path.Sample((float)t + CAMERA_PREDICTION_TIMES[i], motion.FuturePos[i], 
+                motion.FutureViewDir[i]);
         }
 
-        g_app->m_scene.Update(g_app->m_timer.GetElapsedTime(), sceneTS, sceneRendererTS);
+        motion.HasFuturePoses = true;
     }
 
-    void OnWindowSizeChanged()
+    // Parameter groups are usually prefixed with an icon
+    bool MatchesParamName(const char* paramName, const char* name, size_t len)
     {
-        if (g_app->m_timer.GetTotalFrameCount() > 0)
-        {
-            RECT rect;
-            GetClientRect(g_app->m_hwnd, &rect);
+        const size_t paramLen = strlen(paramName);
+        if (paramLen < len || strncmp(paramName + paramLen - len, name, len) != 0)
+            return false;
 
-            const uint16_t newWidth = (uint16_t)(rect.right - rect.left);
-            const uint16_t newHeight = (uint16_t)(rect.bottom - rect.top);
+        return paramLen == len || paramName[paramLen - len - 1] == ' ';
+    }
 
-            if (newWidth == g_app->m_displayWidth && newHeight == g_app->m_displayHeight)
-                return;
+    // Sets the swept parameter to given value and returns its previous value
+    float SetSweepParam(float val)
+    {
+        const char* path = g_app->m_benchmark.SweepParam;
+        const char* groupEnd = strchr(path, '/');
+        const char* subgroupEnd = groupEnd ? strchr(groupEnd + 1, '/') : nullptr;
+        Check(subgroupEnd, "Invalid sweep parameter %s, expected <group>/<subgroup>/<name>.", path);
 
-            g_app->m_displayWidth = newWidth;
-            g_app->m_displayHeight = newHeight;
+        const char* subgroup = groupEnd + 1;
+        const char* name = subgroupEnd + 1;
+        auto params = App::GetParams();
 
-            const float renderWidth = g_app->m_displayWidth / g_app->m_upscaleFactor;
-            const float renderHeight = g_app->m_displayHeight / g_app->m_upscaleFactor;
+        for (ParamVariant& p : params.m_span)
+        {
+            if (!MatchesParamName(p.GetGroup(), path, groupEnd - path) ||
+                !MatchesParamName(p.GetSubGroup(), subgroup, subgroupEnd - subgroup) ||
+                !MatchesParamName(p.GetName(), name, strlen(name)))
+            {
+                continue;
+            }
 
-            // following order is important
-            g_app->m_renderer.OnWindowSizeChanged(g_app->m_hwnd, (uint16_t)renderWidth, (uint16_t)renderHeight,
-                g_app->m_displayWidth, g_app->m_displayHeight);
-            g_app->m_scene.OnWindowSizeChanged();
-            g_app->m_camera.OnWindowSizeChanged();
+            float prev = 0.0f;
 
-            ImGuiIO& io = ImGui::GetIO();
-            io.DisplaySize = ImVec2((float)g_app->m_displayWidth, (float)g_app->m_displayHeight);
+            switch (p.GetType())
+            {
+            case PARAM_TYPE::PT_bool:
+                prev = p.GetBool() ? 1.0f : 0.0f;
+                p.SetBool(val != 0.0f);
+                break;
+            case PARAM_TYPE::PT_int:
+                prev = (float)p.GetInt().m_value;
+                p.SetInt(Math::Min(Math::Max((int)val, p.GetInt().m_min), p.GetInt().m_max));
+                break;
+            case PARAM_TYPE::PT_enum:
+                Check((int)val >= 0 && (int)val < p.GetEnum().m_num, "Sweep value %d is out of range "
+                    "for enum parameter %s.", (int)val, path);
+                prev = (float)p.GetEnum().m_curr;
+                p.SetEnum((int)val);
+                break;
+            case PARAM_TYPE::PT_float:
+                prev = p.GetFloat().m_value;
+                p.SetFloat(Math::Min(Math::Max(val, p.GetFloat().m_min), p.GetFloat().m_max));
+                break;
+            default:
+                Check(false, "Sweep parameter %s must be a bool, int, enum or float.", path);
+            }
+
+            return prev;
         }
+
+        Check(false, "Sweep parameter %s was not found.", path);
+        return 0.0f;
     }
 
-    void OnKeyboard(UINT message, WPARAM wParam, LPARAM lParam)
+    // Measures one render node in isolation for every sweep value (see BenchmarkDesc::Pass)
+    void UpdatePassBenchmark()
     {
-        if (ImGui::GetCurrentContext() == nullptr)
+        auto& bench = g_app->m_benchmark;
+        const uint64_t currFrame = g_app->m_timer.GetTotalFrameCount();
+
+        if (bench.Done)
             return;
 
-        const bool is_key_down = (message == WM_KEYDOWN || message == WM_SYSKEYDOWN);
-        if (wParam < 256)
+        if (bench.StartFrame == 0)
         {
-            // Submit modifiers
-            ImGui_UpdateKeyModifiers();
+            if (g_app->m_scene.IsLoading())
+                return;
 
-            // Obtain virtual key code and convert to ImGuiKey
-            const ImGuiKey key = ImGui_VirtualKeyToImGuiKey(wParam, lParam);
-            const int vk = (int)wParam;
-            const int scancode = (int)LOBYTE(HIWORD(lParam));
+            bench.StartFrame = currFrame;
+            bench.FirstRunFrame = currFrame + bench.Desc.NumWarmupFrames;
 
-            // Special behavior for VK_SNAPSHOT / ImGuiKey_PrintScreen as Windows doesn't 
-            // emit the key down event.
-            if (key == ImGuiKey_PrintScreen && !is_key_down)
-                ImGui_AddKeyEvent(key, true, vk, scancode);
+            LOG_UI(INFO, "Pass benchmark: scene loaded, warming up for %u frames...", bench.Desc.NumWarmupFrames);
+        }
 
-            // Submit key event
-            if (key != ImGuiKey_None)
-                ImGui_AddKeyEvent(key, is_key_down, vk, scancode);
+        // Camera stays put throughout
+        if (bench.Desc.CameraPath)
+        {
+            auto& motion = g_app->m_frameMotion;
+            bench.Path.Sample(0.0f, motion.Pos, motion.ViewDir);
+            motion.HasPose = true;
+        }
 
-            // Submit individual left/right modifier events
-            if (vk == VK_SHIFT)
+        if (currFrame < bench.FirstRunFrame)
+            return;
+
+        auto& renderGraph = *g_app->m_scene.GetRenderGraph();
+        const int numSteps = Max(bench.NumSweepValues, 1);
+
+        if (bench.CurrStep >= 0)
+        {
+            // Waiting for the inputs to settle
+            if (!renderGraph.IsPassBenchmarkActive())
             {
-                // Important: Shift keys tend to get stuck when pressed together, missing key-up 
-                // events are corrected in ImGui_ImplWin32_ProcessKeyEventsWorkarounds()
-                if (ImGui_IsVkDown(VK_LSHIFT) == is_key_down)
-                    ImGui_AddKeyEvent(ImGuiKey_LeftShift, is_key_down, VK_LSHIFT, scancode);
-                if (ImGui_IsVkDown(VK_RSHIFT) == is_key_down)
-                    ImGui_AddKeyEvent(ImGuiKey_RightShift, is_key_down, VK_RSHIFT, scancode);
+                if (currFrame >= bench.StepCaptureFrame)
+                {
+                    renderGraph.BeginPassBenchmark(bench.Desc.Pass, Min((int)bench.Desc.NumPassReps, 
+                        RenderGraph::MAX_PASS_BENCHMARK_REPS_PER_FRAME));
+                    bench.StepTimeoutFrame = currFrame + AppData::PASS_BENCHMARK_TIMEOUT_FRAMES;
+                }
+
+                return;
             }
-            else if (vk == VK_CONTROL)
+
+            auto samples = renderGraph.GetPassBenchmarkSamples();
+            const bool timedOut = currFrame > bench.StepTimeoutFrame;
+            if (samples.size() < bench.Desc.NumPassReps && !timedOut)
+                return;
+
+            const float sweepVal = bench.NumSweepValues ? bench.SweepValues[bench.CurrStep] : 0.0f;
+            const size_t n = Min(samples.size(), (size_t)bench.Desc.NumPassReps);
+            const auto s = bench.Recorder.AddPassRun(sweepVal, Span(samples.data(), n));
+
+            if (s.Count < bench.Desc.NumPassReps)
             {
-                if (ImGui_IsVkDown(VK_LCONTROL) == is_key_down)
-                    ImGui_AddKeyEvent(ImGuiKey_LeftCtrl, is_key_down, VK_LCONTROL, scancode);
-                if (ImGui_IsVkDown(VK_RCONTROL) == is_key_down)
-                    ImGui_AddKeyEvent(ImGuiKey_RightCtrl, is_key_down, VK_RCONTROL, scancode);
+                LOG_UI_WARNING("Pass benchmark: only %u of %u replays of %s were timed.", s.Count, 
+                    bench.Desc.NumPassReps, bench.Desc.Pass);
             }
-            else if (vk == VK_MENU)
+
+            if (bench.NumSweepValues)
             {
-                if (ImGui_IsVkDown(VK_LMENU) == is_key_down)
-                    ImGui_AddKeyEvent(ImGuiKey_LeftAlt, is_key_down, VK_LMENU, scancode);
-                if (ImGui_IsVkDown(VK_RMENU) == is_key_down)
-                    ImGui_AddKeyEvent(ImGuiKey_RightAlt, is_key_down, VK_RMENU, scancode);
+                LOG_UI(INFO, "Pass benchmark: %s with %s = %g: mean %.4f ms, p50 %.4f ms, p95 %.4f ms",
+                    bench.Desc.Pass, bench.SweepParam, sweepVal, s.Mean, s.P50, s.P95);
+            }
+            else
+            {
+                LOG_UI(INFO, "Pass benchmark: %s: mean %.4f ms, p50 %.4f ms, p95 %.4f ms",
+                    bench.Desc.Pass, s.Mean, s.P50, s.P95);
+            }
+
+            renderGraph.EndPassBenchmark();
+        }
+
+        bench.CurrStep++;
+
+        if (bench.CurrStep == numSteps)
+        {
+            if (bench.NumSweepValues)
+                SetSweepParam(bench.SweepOrigValue);
+
+            bench.Recorder.WritePassJson(bench.Desc.OutputPath, bench.Desc, g_app->m_renderer.GetDeviceDescription(),
+                g_app->m_renderer.GetRenderWidth(), g_app->m_renderer.GetRenderHeight());
+            LOG_UI(INFO, "Pass benchmark: results written to %s.", bench.Desc.OutputPath);
+
+            bench.Done = true;
+            App::RequestExit();
+
+            return;
+        }
+
+        bench.StepCaptureFrame = currFrame;
+
+        if (bench.NumSweepValues)
+        {
+            const float prev = SetSweepParam(bench.SweepValues[bench.CurrStep]);
+            if (bench.CurrStep == 0)
+                bench.SweepOrigValue = prev;
+
+            bench.StepCaptureFrame += AppData::PASS_BENCHMARK_SETTLE_FRAMES;
+        }
+    }
+
+    // Adds the current camera pose to the path being recorded every few hundred milliseconds
+    void RecordCameraPath()
+    {
+        const double t = g_app->m_timer.GetTotalTime();
+        auto& path = g_app->m_recordedPath;
+
+        if (!path.Empty() && t - g_app->m_lastKeyframeTime < AppData::CAMERA_PATH_KEYFRAME_INTERVAL)
+            return;
+
+        path.Add((float)t, g_app->m_camera.GetPos(), g_app->m_camera.GetBasisZ());
+        g_app->m_lastKeyframeTime = t;
+    }
+
+    // Camera is placed at its current pose with zero velocity, so that it starts out the 
+    // same way during replay
+    void BeginInputRecording()
+    {
+        auto& rec = g_app->m_inputRecording;
+        rec.Begin(g_app->m_timer.GetTotalFrameCount(), g_app->m_camera.GetPos(), 
+            g_app->m_camera.GetBasisZ());
+
+        {
+            auto params = App::GetParams();
+
+            for (ParamVariant& p : params.m_span)
+            {
+                if (p.ID() != g_app->m_recordInputParamID)
+                    rec.AddInitialParam(p);
+            }
+        }
+
+        auto& motion = g_app->m_frameMotion;
+        motion.Pos = rec.CameraPos();
+        motion.ViewDir = rec.CameraViewDir();
+        motion.HasPose = true;
+
+        g_app->m_beginInputRecording = false;
+    }
+
+    // Called after the camera motion for this frame is known. Parameter changes are 
+    // recorded as their callbacks are invoked (see ApplyParamUpdates()).
+    void RecordInput()
+    {
+        if (g_app->m_beginInputRecording)
+            BeginInputRecording();
+
+        const auto& motion = g_app->m_frameMotion;
+        g_app->m_inputRecording.AddFrame((float)g_app->m_timer.GetSimulationDelta(), 
+            motion.Acceleration, motion.dMouse_x, motion.dMouse_y);
+    }
+
+    // Recorded changes queue the param callback even when the value is the same, as 
+    // that's what happened during recording
+    void ApplyRecordedParams(Span<InputRecording::ParamChange> changes, bool invokeUnchanged)
+    {
+        auto params = App::GetParams();
+        int numMissing = 0;
+
+        for (auto& c : changes)
+        {
+            auto idx = g_app->m_paramIndex.find(c.ID);
+            if (!idx)
+            {
+                numMissing++;
+                continue;
+            }
+
+            ParamVariant& p = params.m_span[*idx.value()];
+            if (!InputRecording::ApplyParam(c, p) && invokeUnchanged && c.Type == p.GetType())
+                App::QueueParamCallback(c.ID);
+        }
+
+        if (numMissing)
+            LOG_UI_WARNING("Replay: %d recorded parameter(s) don't exist.", numMissing);
+    }
+
+    void EndReplay()
+    {
+        const uint64_t currFrame = g_app->m_timer.GetTotalFrameCount();
+        const uint64_t firstFrame = Max(g_app->m_replayStartFrame, currFrame > 
+            AppData::NUM_TASK_TIMELINE_EXPORT_FRAMES ? currFrame - AppData::NUM_TASK_TIMELINE_EXPORT_FRAMES + 1 : 1);
+        StackStr(path, n, "Replay_%llu.json", currFrame);
+        ExportTaskTimeline(path, firstFrame);
+
+        LOG_UI(INFO, "Replay: %u frames done, %u hitch(es) (see %s), trace of the last frames: %s.", 
+            (uint32_t)g_app->m_inputRecording.NumFrames(), g_app->m_numHitches, AppData::HITCH_LOG_PATH, 
+            path);
+
+        g_app->m_replayDone = true;
+        App::RequestExit();
+    }
+
+    // Feeds the next frame of the input recording back in place of user input, once
+    // the scene has loaded
+    void ReplayInput()
+    {
+        auto& rec = g_app->m_inputRecording;
+        auto& motion = g_app->m_frameMotion;
+
+        motion.Acceleration = float3(0.0f);
+        motion.dMouse_x = 0;
+        motion.dMouse_y = 0;
+        g_app->m_picked = false;
+        g_app->m_multiPick = false;
+        g_app->m_clearPick = false;
+
+        if (g_app->m_replayDone)
+            return;
+
+        if (g_app->m_replayStartFrame == 0)
+        {
+            if (g_app->m_scene.IsLoading())
+                return;
+
+            g_app->m_replayStartFrame = g_app->m_timer.GetTotalFrameCount();
+            ApplyRecordedParams(rec.InitialParams(), false);
+
+            motion.Pos = rec.CameraPos();
+            motion.ViewDir = rec.CameraViewDir();
+            motion.HasPose = true;
+
+            LOG_UI(INFO, "Replay: scene loaded, replaying %u frames...", (uint32_t)rec.NumFrames());
+        }
+
+        InputRecording::Frame frame;
+        Span<InputRecording::ParamChange> paramChanges(nullptr, 0);
+        Span<InputRecording::Pick> picks(nullptr, 0);
+
+        if (!rec.NextFrame(frame, paramChanges, picks))
+        {
+            EndReplay();
+            return;
+        }
+
+        g_app->m_timer.SetFixedTimestep(frame.Timestep);
+        motion.Acceleration = frame.Acceleration;
+        motion.dMouse_x = frame.dMouseX;
+        motion.dMouse_y = frame.dMouseY;
+
+        ApplyRecordedParams(paramChanges, true);
+
+        for (auto& pick : picks)
+        {
+            if (pick.Type == InputRecording::PICK_TYPE::PICK)
+                g_app->m_scene.Pick(pick.X, pick.Y);
+            else if (pick.Type == InputRecording::PICK_TYPE::MULTI_PICK)
+                g_app->m_scene.MultiPick(pick.X, pick.Y);
+            else
+                g_app->m_scene.ClearPick();
+        }
+    }
+
+    // Camera pose of the given headless job, default camera unless HasCamera is set
+    void PlaceHeadlessCamera(const HeadlessDesc& job)
+    {
+        auto& motion = g_app->m_frameMotion;
+        motion.HasPose = true;
+        motion.Pos = job.HasCamera ? float3(job.CameraPos[0], job.CameraPos[1], job.CameraPos[2]) :
+            float3(0, 1.2f, -4.043f);
+        motion.ViewDir = job.HasCamera ? float3(job.CameraLookAt[0] - job.CameraPos[0],
+            job.CameraLookAt[1] - job.CameraPos[1], job.CameraLookAt[2] - job.CameraPos[2]) :
+            float3(0, 0, 1);
+        motion.ViewDir.normalize();
+    }
+
+    // Called at the start of the frame after the current job's output was written
+    void NextHeadlessJob()
+    {
+        if (g_app->m_nextHeadlessJob == g_app->m_headlessJobs.size())
+        {
+            App::RequestExit();
+            return;
+        }
+
+        g_app->m_headless = g_app->m_headlessJobs[g_app->m_nextHeadlessJob++];
+        PlaceHeadlessCamera(g_app->m_headless);
+        // Restart accumulation even when the camera didn't move
+        g_app->m_scene.SceneModified();
+
+        LOG_UI(INFO, "Headless job %u/%u: rendering at %u spp to %s", g_app->m_nextHeadlessJob + 1,
+            (uint32_t)g_app->m_headlessJobs.size() + 1, g_app->m_headless.NumSamples, 
+            g_app->m_headless.OutputPath);
+    }
+
+    void Update(TaskSet& sceneTS, TaskSet& sceneRendererTS, size_t tempMemoryUsage)
+    {
+        UpdateStats(tempMemoryUsage);
+
+        if (g_app->m_isBenchmark)
+        {
+            if (g_app->m_benchmark.Desc.Pass)
+                UpdatePassBenchmark();
+            else
+                UpdateBenchmark();
+        }
+
+        // No UI or user input, camera stays where it was placed
+        if (g_app->m_isHeadless)
+        {
+            if (g_app->m_headlessJobDone.load(std::memory_order_acquire))
+            {
+                g_app->m_headlessJobDone.store(false, std::memory_order_relaxed);
+                NextHeadlessJob();
+            }
+
+            g_app->m_frameMotion.dt = (float)g_app->m_timer.GetSimulationDelta();
+            g_app->m_camera.Update(g_app->m_frameMotion);
+            g_app->m_frameMotion.HasPose = false;
+            g_app->m_scene.Update(g_app->m_timer.GetSimulationDelta(), sceneTS, sceneRendererTS);
+
+            return;
+        }
+
+        ImGui_UpdateMouse();
+        ImGui_ProcessKeyEventsWorkarounds();
+
+        // Update OS mouse cursor with the cursor requested by imgui
+        ImGuiMouseCursor mouse_cursor = ImGui::GetIO().MouseDrawCursor ? ImGuiMouseCursor_None :
+            ImGui::GetMouseCursor();
+        if (g_app->m_imguiCursor != mouse_cursor)
+        {
+            g_app->m_imguiCursor = mouse_cursor;
+            ImGui_UpdateMouseCursor();
+        }
+
+        ImGui::NewFrame();
+
+        if (!(GetAsyncKeyState(VK_LSHIFT) & (1 << 15)))
+        {
+            float scale = g_app->m_inMouseWheelMove ? g_app->m_inMouseWheelMove * 20 : 1.0f;
+            scale = g_app->m_frameMotion.Acceleration.z != 0 || g_app->m_frameMotion.Acceleration.x != 0 ?
+                fabsf(scale) : scale;
+
+            if (g_app->m_inMouseWheelMove || (GetAsyncKeyState('W') & (1 << 16)))
+                g_app->m_frameMotion.Acceleration.z = 1;
+            if (GetAsyncKeyState('A') & (1 << 16))
+                g_app->m_frameMotion.Acceleration.x = -1;
+            if (!g_app->m_inMouseWheelMove && (GetAsyncKeyState('S') & (1 << 16)))
+                g_app->m_frameMotion.Acceleration.z = -1;
+            if (GetAsyncKeyState('D') & (1 << 16))
+                g_app->m_frameMotion.Acceleration.x = 1;
+
+            g_app->m_frameMotion.Acceleration.normalize();
+            g_app->m_frameMotion.Acceleration *= g_app->m_cameraAcceleration * scale;
+        }
+        else
+        {
+            if (g_app->m_inMouseWheelMove)
+                g_app->m_cameraAcceleration *= (1 + g_app->m_inMouseWheelMove * 0.1f);
+        }
+
+        g_app->m_inMouseWheelMove = 0;
+
+        // Replay sets the timestep, so this goes first
+        if (g_app->m_replayingInput)
+            ReplayInput();
+        else if (g_app->m_recordingInput)
+            RecordInput();
+
+        g_app->m_frameMotion.dt = (float)g_app->m_timer.GetSimulationDelta();
+
+        g_app->m_camera.Update(g_app->m_frameMotion);
+
+        if (g_app->m_recordingCameraPath)
+            RecordCameraPath();
+
+        if (g_app->m_picked)
+        {
+            const InputRecording::PICK_TYPE type = g_app->m_multiPick ? 
+                InputRecording::PICK_TYPE::MULTI_PICK : InputRecording::PICK_TYPE::PICK;
+
+            if (g_app->m_multiPick)
+                g_app->m_scene.MultiPick(g_app->m_lastLMBClickPosX, g_app->m_lastLMBClickPosY);
+            else
+                g_app->m_scene.Pick(g_app->m_lastLMBClickPosX, g_app->m_lastLMBClickPosY);
+
+            if (g_app->m_recordingInput)
+            {
+                g_app->m_inputRecording.AddPick(type, g_app->m_lastLMBClickPosX, 
+                    g_app->m_lastLMBClickPosY);
+            }
+
+            g_app->m_picked = false;
+            g_app->m_multiPick = false;
+        }
+
+        if (g_app->m_clearPick)
+        {
+            g_app->m_scene.ClearPick();
+
+            if (g_app->m_recordingInput)
+                g_app->m_inputRecording.AddPick(InputRecording::PICK_TYPE::CLEAR, 0, 0);
+
+            g_app->m_clearPick = false;
+        }
+
+        g_app->m_scene.Update(g_app->m_timer.GetSimulationDelta(), sceneTS, sceneRendererTS);
+    }
+
+    void OnWindowSizeChanged()
+    {
+        if (g_app->m_timer.GetTotalFrameCount() > 0)
+        {
+            RECT rect;
+            GetClientRect(g_app->m_hwnd, &rect);
+
+            const uint16_t newWidth = (uint16_t)(rect.right - rect.left);
+            const uint16_t newHeight = (uint16_t)(rect.bottom - rect.top);
+
+            if (newWidth == g_app->m_displayWidth && newHeight == g_app->m_displayHeight)
+                return;
+
+            g_app->m_displayWidth = newWidth;
+            g_app->m_displayHeight = newHeight;
+
+            const float renderWidth = g_app->m_displayWidth / g_app->m_upscaleFactor;
+            const float renderHeight = g_app->m_displayHeight / g_app->m_upscaleFactor;
+
+            // following order is important
+            g_app->m_renderer.OnWindowSizeChanged(g_app->m_hwnd, (uint16_t)renderWidth, (uint16_t)renderHeight,
+                g_app->m_displayWidth, g_app->m_displayHeight);
+            g_app->m_scene.OnWindowSizeChanged();
+            g_app->m_camera.OnWindowSizeChanged();
+
+            ImGuiIO& io = ImGui::GetIO();
+            io.DisplaySize = ImVec2((float)g_app->m_displayWidth, (float)g_app->m_displayHeight);
+        }
+    }
+
+    void OnKeyboard(UINT message, WPARAM wParam, LPARAM lParam)
+    {
+        if (ImGui::GetCurrentContext() == nullptr)
+            return;
+
+        const bool is_key_down = (message == WM_KEYDOWN || message == WM_SYSKEYDOWN);
+        if (wParam < 256)
+        {
+            // Submit modifiers
+            ImGui_UpdateKeyModifiers();
+
+            // Obtain virtual key code and convert to ImGuiKey
+            const ImGuiKey key = ImGui_VirtualKeyToImGuiKey(wParam, lParam);
+            const int vk = (int)wParam;
+            const int scancode = (int)LOBYTE(HIWORD(lParam));
+
+            // Special behavior for VK_SNAPSHOT / ImGuiKey_PrintScreen as Windows doesn't 
+            // emit the key down event.
+            if (key == ImGuiKey_PrintScreen && !is_key_down)
+                ImGui_AddKeyEvent(key, true, vk, scancode);
+
+            // Submit key event
+            if (key != ImGuiKey_None)
+                ImGui_AddKeyEvent(key, is_key_down, vk, scancode);
+
+            // Submit individual left/right modifier events
+            if (vk == VK_SHIFT)
+            {
+                // Important: Shift keys tend to get stuck when pressed together, missing key-up 
+                // events are corrected in ImGui_ImplWin32_ProcessKeyEventsWorkarounds()
+                if (ImGui_IsVkDown(VK_LSHIFT) == is_key_down)
+                    ImGui_AddKeyEvent(ImGuiKey_LeftShift, is_key_down, VK_LSHIFT, scancode);
+                if (ImGui_IsVkDown(VK_RSHIFT) == is_key_down)
+                    ImGui_AddKeyEvent(ImGuiKey_RightShift, is_key_down, VK_RSHIFT, scancode);
+            }
+            else if (vk == VK_CONTROL)
+            {
+                if (ImGui_IsVkDown(VK_LCONTROL) == is_key_down)
+                    ImGui_AddKeyEvent(ImGuiKey_LeftCtrl, is_key_down, VK_LCONTROL, scancode);
+                if (ImGui_IsVkDown(VK_RCONTROL) == is_key_down)
+                    ImGui_AddKeyEvent(ImGuiKey_RightCtrl, is_key_down, VK_RCONTROL, scancode);
+            }
+            else if (vk == VK_MENU)
+            {
+                if (ImGui_IsVkDown(VK_LMENU) == is_key_down)
+                    ImGui_AddKeyEvent(ImGuiKey_LeftAlt, is_key_down, VK_LMENU, scancode);
+                if (ImGui_IsVkDown(VK_RMENU) == is_key_down)
+                    ImGui_AddKeyEvent(ImGuiKey_RightAlt, is_key_down, VK_RMENU, scancode);
             }
         }
 
@@ -802,8 +1731,10 @@ namespace ZetaRay::AppImpl
                     AppImpl::OnActivated();
                 }
             }
+            else if (GetAsyncKeyState('T') & (1 << 16))
+                g_app->m_exportTaskTimeline.store(true, std::memory_order_relaxed);
             else if (GetAsyncKeyState(VK_ESCAPE) & (1 << 16))
-                g_app->m_scene.ClearPick();
+                g_app->m_clearPick = true;
         }
     }
 
@@ -952,6 +1883,9 @@ namespace ZetaRay::AppImpl
         }
     }
 
+    void DrainLogs();
+    void FlushLogFile(bool async);
+
     void OnDestroy()
     {
         App::FlushAllThreadPools();
@@ -972,43 +1906,242 @@ namespace ZetaRay::AppImpl
         g_app->m_workerThreadPool.Shutdown();
         g_app->m_backgroundThreadPool.Shutdown();
 
+        CloseHandle(g_app->m_mainThread);
+
+        // Render passes remove their params during shutdown
+        ParamUpdate* u = g_app->m_paramUpdates.exchange(nullptr);
+        while (u)
+        {
+            ParamUpdate* next = u->Next;
+            delete u;
+            u = next;
+        }
+
+        // Messages from the last frame and shutdown
+        DrainLogs();
+        FlushLogFile(false);
+
         delete g_app;
         g_app = nullptr;
     }
 
+    // Caller must hold m_logLock
+    void AppendToLogFile(const char* line)
+    {
+        auto& lines = g_app->m_logFileLines;
+        const size_t len = strlen(line);
+        const bool hasNewline = len > 0 && line[len - 1] == '\n';
+        const size_t oldSize = lines.size();
+        const size_t newSize = oldSize + len + (hasNewline ? 0 : 1);
+
+        // Grow geometrically to avoid reallocating on every message
+        if (newSize > lines.capacity())
+            lines.reserve(Math::Max(lines.capacity() * 2, newSize));
+
+        lines.resize(newSize);
+        memcpy(lines.data() + oldSize, line, len);
+
+        if (!hasNewline)
+            lines[newSize - 1] = '\n';
+    }
+
+    // Appends pending lines to the log file. When "async" is true, writing happens on a 
+    // background thread and is skipped while the previous write is still in progress. 
+    // Otherwise writes right away, which requires the thread pools to be idle.
+    void FlushLogFile(bool async)
+    {
+        if (async && g_app->m_logFileWriteInFlight.load(std::memory_order_acquire))
+            return;
+
+        // Buffer that was written last time is empty, but has kept its capacity
+        AcquireSRWLockExclusive(&g_app->m_logLock);
+        g_app->m_logFileWriteLines.swap(g_app->m_logFileLines);
+        ReleaseSRWLockExclusive(&g_app->m_logLock);
+
+        if (g_app->m_logFileWriteLines.empty())
+            return;
+
+        auto write = []()
+            {
+                auto& lines = g_app->m_logFileWriteLines;
+                Filesystem::AppendToFile(AppData::LOG_FILE_PATH, reinterpret_cast<uint8_t*>(lines.data()),
+                    (uint32_t)lines.size());
+                lines.clear();
+
+                g_app->m_logFileWriteInFlight.store(false, std::memory_order_release);
+            };
+
+        if (!async)
+        {
+            write();
+            return;
+        }
+
+        g_app->m_logFileWriteInFlight.store(true, std::memory_order_relaxed);
+
+        Task t("WriteLogFile", TASK_PRIORITY::BACKGROUND, write);
+        App::SubmitBackground(ZetaMove(t));
+    }
+
+    // Formats the messages that were queued since the last call and moves them to the
+    // UI list and the log file
+    void DrainLogs()
+    {
+        auto& msgs = g_app->m_drainedLogs;
+        auto& text = g_app->m_drainedLogText;
+        msgs.clear();
+        text.clear();
+
+        g_app->m_logBuffer.Drain(msgs, text);
+
+        if (msgs.empty())
+            return;
+
+        AcquireSRWLockExclusive(&g_app->m_logLock);
+
+        for (auto& m : msgs)
+        {
+            g_app->m_frameLogs.emplace_back(text.data() + m.Offset, m.Type, m.FrameIdx, m.ThreadID);
+            AppendToLogFile(g_app->m_frameLogs.back().Msg);
+        }
+
+        ReleaseSRWLockExclusive(&g_app->m_logLock);
+    }
+
+    void PushParamUpdate(ParamUpdate* u)
+    {
+        ParamUpdate* head = g_app->m_paramUpdates.load(std::memory_order_relaxed);
+
+        do
+        {
+            u->Next = head;
+        } while (!g_app->m_paramUpdates.compare_exchange_weak(head, u, std::memory_order_release,
+            std::memory_order_relaxed));
+    }
+
     void ApplyParamUpdates()
     {
-        AcquireSRWLockExclusive(&g_app->m_paramUpdateLock);
+        // Take the whole list, updates pushed after this are applied next frame
+        ParamUpdate* head = g_app->m_paramUpdates.exchange(nullptr, std::memory_order_acquire);
+        if (!head)
+            return;
+
+        // Reverse into the order they were pushed
+        ParamUpdate* ordered = nullptr;
+        while (head)
+        {
+            ParamUpdate* next = head->Next;
+            head->Next = ordered;
+            ordered = head;
+            head = next;
+        }
+
         AcquireSRWLockExclusive(&g_app->m_paramLock);
 
-        for (auto& p : g_app->m_paramsUpdates)
+        auto& params = g_app->m_params;
+        auto& index = g_app->m_paramIndex;
+        SmallVector<uint64_t, FrameAllocator> callbacks;
+        bool modified = false;
+        // Removed params are compacted away after all the updates in this batch
+        bool anyRemoved = false;
+
+        for (ParamUpdate* u = ordered; u; u = u->Next)
         {
-            if (p.Op == ParamUpdate::OP_TYPE::ADD)
-                g_app->m_params.push_back(p.P);
-            else if (p.Op == ParamUpdate::OP_TYPE::REMOVE)
+            if (u->Op == ParamUpdate::ADD || u->Op == ParamUpdate::TRY_ADD)
             {
-                size_t i = 0;
-                bool found = false;
-                while (i < g_app->m_params.size())
+                auto idx = index.find(u->ID);
+
+                if (!idx)
                 {
-                    if (g_app->m_params[i].ID() == p.P.ID())
-                    {
-                        found = true;
-                        break;
-                    }
+                    index.insert_or_assign(u->ID, (uint32_t)params.size());
+                    params.push_back(u->P);
+                    modified = true;
+                }
+                else if (u->Op == ParamUpdate::ADD)
+                {
+                    params[*idx.value()] = u->P;
+                    modified = true;
+                }
+            }
+            else if (u->Op == ParamUpdate::REMOVE)
+            {
+                if (index.erase(u->ID))
+                {
+                    anyRemoved = true;
+                    modified = true;
+                }
+            }
+            else
+                callbacks.push_back(u->ID);
+        }
+
+        while (ordered)
+        {
+            ParamUpdate* next = ordered->Next;
+            delete ordered;
+            ordered = next;
+        }
 
-                    i++;
+        if (modified)
+        {
+            // Removed IDs aren't in the index anymore, unless they were added back later in
+            // the same batch -- in which case the entry points to the new copy
+            if (anyRemoved)
+            {
+                size_t curr = 0;
+
+                for (size_t i = 0; i < params.size(); i++)
+                {
+                    auto idx = index.find(params[i].ID());
+                    if (idx && *idx.value() == i)
+                        params[curr++] = params[i];
                 }
 
-                if (found)
-                    g_app->m_params.erase_at_index(i);
+                params.resize(curr);
             }
+
+            std::sort(params.begin(), params.end(),
+                [](const ParamVariant& p1, const ParamVariant& p2)
+                {
+                    int res = strcmp(p1.GetGroup(), p2.GetGroup());
+                    if (res != 0)
+                        return res < 0;
+
+                    res = strcmp(p1.GetSubGroup(), p2.GetSubGroup());
+                    if (res != 0)
+                        return res < 0;
+
+                    res = strcmp(p1.GetSubSubGroup(), p2.GetSubSubGroup());
+                    if (res != 0)
+                        return res < 0;
+
+                    return strcmp(p1.GetName(), p2.GetName()) < 0;
+                });
+
+            index.clear();
+            for (size_t i = 0; i < params.size(); i++)
+                index.insert_or_assign(params[i].ID(), (uint32_t)i);
         }
 
-        g_app->m_paramsUpdates.clear();
+        // Runs with the lock held -- callbacks can queue more param updates (applied next
+        // frame), but must not call App::GetParams()
+        for (auto id : callbacks)
+        {
+            auto idx = index.find(id);
+            if (!idx)
+                continue;
+
+            // Runs after RecordInput() for this frame
+            if (g_app->m_recordingInput && !g_app->m_beginInputRecording && 
+                id != g_app->m_recordInputParamID)
+            {
+                g_app->m_inputRecording.AddParamChange(params[*idx.value()]);
+            }
+
+            params[*idx.value()].InvokeCallback();
+        }
 
         ReleaseSRWLockExclusive(&g_app->m_paramLock);
-        ReleaseSRWLockExclusive(&g_app->m_paramUpdateLock);
     }
 
     // Ref: https://github.com/ysc3839/win32-darkmode
@@ -1202,10 +2335,14 @@ namespace ZetaRay::AppImpl
             return 0;
 
         case WM_DESTROY:
+        {
+            // App data is released by OnDestroy()
+            const int exitCode = g_app->m_exitCode;
             AppImpl::OnDestroy();
-            PostQuitMessage(0);
+            PostQuitMessage(exitCode);
             return 0;
         }
+        }
 
         return DefWindowProc(hWnd, message, wParam, lParam);
     }
@@ -1245,8 +2382,17 @@ namespace ZetaRay::AppImpl
         const int monitorWidth = workingArea.right - workingArea.left;
         const int monitorHeight = workingArea.bottom - workingArea.top;
 
-        const int wndWidth = (int)((monitorWidth * g_app->m_dpi) / USER_DEFAULT_SCREEN_DPI);
-        const int wndHeight = (int)((monitorHeight * g_app->m_dpi) / USER_DEFAULT_SCREEN_DPI);
+        int wndWidth = (int)((monitorWidth * g_app->m_dpi) / USER_DEFAULT_SCREEN_DPI);
+        int wndHeight = (int)((monitorHeight * g_app->m_dpi) / USER_DEFAULT_SCREEN_DPI);
+
+        // Benchmark results are only comparable at the same resolution
+        if (g_app->m_isBenchmark)
+        {
+            RECT rect = { 0, 0, g_app->m_benchmark.Desc.Width, g_app->m_benchmark.Desc.Height };
+            CheckWin32(AdjustWindowRectExForDpi(&rect, WS_OVERLAPPEDWINDOW, FALSE, 0, g_app->m_dpi));
+            wndWidth = rect.right - rect.left;
+            wndHeight = rect.bottom - rect.top;
+        }
 
         SetWindowPos(g_app->m_hwnd, nullptr, 0, 0, wndWidth, wndHeight, 0);
         ShowWindow(g_app->m_hwnd, SW_SHOWNORMAL);
@@ -1257,6 +2403,166 @@ namespace ZetaRay::AppImpl
         g_app->m_cameraAcceleration = p.GetFloat().m_value;
     }
 
+    void SetFrameAwareBackgroundScheduling(const ParamVariant& p)
+    {
+        g_app->m_frameAwareBackgroundScheduling = p.GetBool();
+    }
+
+    void SetHitchThreshold(const ParamVariant& p)
+    {
+        g_app->m_hitchThreshold = p.GetFloat().m_value;
+    }
+
+    void SetRecordInput(const ParamVariant& p)
+    {
+        g_app->m_recordingInput = p.GetBool();
+
+        if (g_app->m_recordingInput)
+        {
+            g_app->m_beginInputRecording = true;
+            return;
+        }
+
+        // Toggled within the same frame
+        if (g_app->m_beginInputRecording)
+        {
+            g_app->m_beginInputRecording = false;
+            return;
+        }
+
+        g_app->m_inputRecording.Save(AppData::INPUT_RECORDING_PATH);
+        LOG_UI(INFO, "Input recording (%u frames) saved to %s.", 
+            (uint32_t)g_app->m_inputRecording.NumFrames(), AppData::INPUT_RECORDING_PATH);
+    }
+
+    void SetRecordCameraPath(const ParamVariant& p)
+    {
+        g_app->m_recordingCameraPath = p.GetBool();
+
+        if (g_app->m_recordingCameraPath)
+        {
+            g_app->m_recordedPath.Clear();
+            return;
+        }
+
+        if (g_app->m_recordedPath.NumKeyframes() < 2)
+        {
+            LOG_UI_WARNING("Camera path needs at least two keyframes, nothing was saved.");
+            return;
+        }
+
+        g_app->m_recordedPath.Save(AppData::CAMERA_PATH_RECORDING_PATH);
+        LOG_UI(INFO, "Camera path (%.2f s, %u keyframes) saved to %s.", g_app->m_recordedPath.Duration(),
+            (uint32_t)g_app->m_recordedPath.NumKeyframes(), AppData::CAMERA_PATH_RECORDING_PATH);
+    }
+
+    // Background threads stop picking up new tasks while the frame's critical path is 
+    // running. An exception is when the CPU is the bottleneck -- there's little idle time 
+    // left after frame submission, so keep one background thread around to avoid starvation.
+    void BeginFrameCriticalPath()
+    {
+        g_app->m_inFrameCriticalPath.store(true, std::memory_order_relaxed);
+        g_app->m_workerThreadPool.SetIdleWorkSource(nullptr);
+
+        if (!g_app->m_frameAwareBackgroundScheduling)
+        {
+            g_app->m_backgroundThreadPool.SetMaxNumActiveThreads(AppData::NUM_BACKGROUND_THREADS);
+            return;
+        }
+
+        constexpr float MAX_CRITICAL_PATH_FRACTION = 0.75f;
+        const bool isCpuBound = g_app->m_criticalPathMsAvg >=
+            MAX_CRITICAL_PATH_FRACTION * g_app->m_frameTimeMsAvg;
+        g_app->m_backgroundThreadPool.SetMaxNumActiveThreads(isCpuBound ? 1 : 0);
+    }
+
+    // Once the frame is submitted, background tasks can use all the background threads 
+    // along with any worker thread that is idle
+    void EndFrameCriticalPath()
+    {
+        constexpr float EMA_WEIGHT = 0.1f;
+        const float criticalPathMs = (float)(g_app->m_timer.GetTimeSinceLastTick() * 1000.0);
+        const float frameTimeMs = (float)(g_app->m_timer.GetElapsedTime() * 1000.0);
+
+        // Initialize with the first measurement
+        const bool firstFrame = g_app->m_frameTimeMsAvg == 0.0f;
+        g_app->m_criticalPathMs = criticalPathMs;
+        g_app->m_criticalPathMsAvg = firstFrame ? criticalPathMs :
+            g_app->m_criticalPathMsAvg + EMA_WEIGHT * (criticalPathMs - g_app->m_criticalPathMsAvg);
+        g_app->m_frameTimeMsAvg = firstFrame ? frameTimeMs :
+            g_app->m_frameTimeMsAvg + EMA_WEIGHT * (frameTimeMs - g_app->m_frameTimeMsAvg);
+
+        g_app->m_backgroundThreadPool.SetMaxNumActiveThreads(AppData::NUM_BACKGROUND_THREADS);
+
+        if (g_app->m_frameAwareBackgroundScheduling)
+            g_app->m_workerThreadPool.SetIdleWorkSource(&g_app->m_backgroundThreadPool);
+
+        g_app->m_inFrameCriticalPath.store(false, std::memory_order_relaxed);
+    }
+
+    // Main thread and worker threads go on the performance cores, background threads on the
+    // efficiency cores. There's nothing to do on non-hybrid CPUs.
+    void ApplyThreadPlacement()
+    {
+        if (!g_app->m_cpuInfo.IsHybrid())
+            return;
+
+        App::SetThreadPlacement(g_app->m_mainThread, g_app->m_threadPlacement, CORE_TYPE::PERFORMANCE, 0);
+
+        for (int i = 0; i < g_app->m_workerThreadPool.ThreadPoolSize(); i++)
+        {
+            App::SetThreadPlacement(g_app->m_workerThreadPool.GetThreadHandle(i), g_app->m_threadPlacement,
+                CORE_TYPE::PERFORMANCE, i + 1);
+        }
+
+        for (int i = 0; i < g_app->m_backgroundThreadPool.ThreadPoolSize(); i++)
+        {
+            App::SetThreadPlacement(g_app->m_backgroundThreadPool.GetThreadHandle(i), g_app->m_threadPlacement,
+                CORE_TYPE::EFFICIENCY, i);
+        }
+    }
+
+    void SetThreadPlacementMode(const ParamVariant& p)
+    {
+        g_app->m_threadPlacement = (THREAD_PLACEMENT)p.GetEnum().m_curr;
+        ApplyThreadPlacement();
+    }
+
+    // Writes the CPU and GPU timeline from frame "firstFrame" onward as a Chrome trace
+    void ExportTaskTimeline(const char* path, uint64_t firstFrame)
+    {
+        const int numThreads = g_app->m_processorCoreCount + AppData::NUM_BACKGROUND_THREADS;
+        char names[MAX_NUM_THREADS][32];
+        const char* namePtrs[MAX_NUM_THREADS];
+
+        for (int i = 0; i < numThreads; i++)
+        {
+            // Same order as g_threadIdx assignment in App::Init()
+            if (i == 0)
+                stbsp_snprintf(names[i], sizeof(names[i]), "Main");
+            else if (i < g_app->m_processorCoreCount)
+                stbsp_snprintf(names[i], sizeof(names[i]), "ZetaWorker_%d", i - 1);
+            else
+                stbsp_snprintf(names[i], sizeof(names[i]), "ZetaBackgroundWorker_%d", i - g_app->m_processorCoreCount);
+
+            namePtrs[i] = names[i];
+        }
+
+        g_app->m_taskTimeline.ExportChromeTrace(path, firstFrame,
+            Span<const char*>(namePtrs, numThreads));
+    }
+
+    // Last few frames
+    void ExportTaskTimeline()
+    {
+        const uint64_t currFrame = g_app->m_timer.GetTotalFrameCount();
+        const uint64_t firstFrame = currFrame > AppData::NUM_TASK_TIMELINE_EXPORT_FRAMES ?
+            currFrame - AppData::NUM_TASK_TIMELINE_EXPORT_FRAMES + 1 : 1;
+        StackStr(path, n, "TaskTimeline_%llu.json", currFrame);
+
+        ExportTaskTimeline(path, firstFrame);
+    }
+
     void ResizeIfQueued()
     {
         if (g_app->m_issueResize)
@@ -1296,6 +2602,68 @@ namespace ZetaRay::AppImpl
         }
     }
 
+    // Gathers per-thread statistics from the last frame and picks the block size for the
+    // next one. Block size grows right away to fit the largest request (heap fallbacks 
+    // included), but only shrinks after it's been mostly unused for a while.
+    size_t UpdateFrameAllocatorBlockSize()
+    {
+        auto& context = g_app->m_frameMemoryContext;
+        const size_t currBlockSize = g_app->m_frameMemory.BlockSize();
+        size_t largestRequest = 0;
+        uint32_t numFallbacks = 0;
+
+        for (int i = 0; i < MAX_NUM_THREADS; i++)
+        {
+            auto& stats = context.m_threadStats[i];
+            stats.PeakBytesAllocated = Max(stats.PeakBytesAllocated, stats.BytesAllocated);
+            stats.TotalNumFallbacks += stats.NumFallbacks;
+            largestRequest = Max(largestRequest, stats.LargestRequest);
+            numFallbacks += stats.NumFallbacks;
+
+            stats.BytesAllocated = 0;
+            stats.LargestRequest = 0;
+            stats.NumFallbacks = 0;
+        }
+
+        context.m_lastFrameNumFallbacks = numFallbacks;
+        context.m_totalNumFallbacks += numFallbacks;
+
+        using FrameMemoryType = decltype(g_app->m_frameMemory);
+        const size_t target = Min(Max(NextPow2(largestRequest), FrameMemoryType::BASE_BLOCK_SIZE),
+            FrameMemoryType::MAX_BLOCK_SIZE);
+
+        if (target > currBlockSize)
+        {
+            context.m_numFramesUnderused = 0;
+            LOG_UI(INFO, "Frame allocator block size increased to %llu KB.", target >> 10);
+
+            return target;
+        }
+
+        if (target < currBlockSize)
+        {
+            if (++context.m_numFramesUnderused >= AppData::FRAME_ALLOCATOR_SHRINK_DELAY)
+            {
+                context.m_numFramesUnderused = 0;
+                return currBlockSize >> 1;
+            }
+        }
+        else
+            context.m_numFramesUnderused = 0;
+
+        return currBlockSize;
+    }
+
+    // Sets the offset of every block to 0, essentially releasing the memory
+    void ResetFrameMemory(size_t newBlockSize)
+    {
+        g_app->m_frameMemoryContext.m_currFrameAllocIndex.store(0, std::memory_order_release);
+        for (int i = 0; i < MAX_NUM_THREADS; i++)
+            g_app->m_frameMemoryContext.m_threadFrameAllocIndices[i] = -1;
+
+        g_app->m_frameMemory.Reset(newBlockSize);
+    }
+
     template<size_t blockSize>
     ZetaInline void* AllocateFrameAllocator(FrameMemory<blockSize>& frameMemory, FrameMemoryContext& context,
         size_t size, size_t alignment)
@@ -1303,8 +2671,12 @@ namespace ZetaRay::AppImpl
         alignment = Math::Max(alignof(std::max_align_t), alignment);
 
         // at most alignment - 1 extra bytes are required
-        Assert(size + alignment - 1 <= frameMemory.BLOCK_SIZE,
-            "allocations larger than FrameMemory::BLOCK_SIZE are not possible with FrameAllocator.");
+        Assert(size + alignment - 1 <= frameMemory.BlockSize(),
+            "allocations larger than FrameMemory::BlockSize() are not possible with FrameAllocator.");
+
+        auto& stats = context.m_threadStats[g_threadIdx];
+        stats.BytesAllocated += size;
+        stats.LargestRequest = Math::Max(stats.LargestRequest, size + alignment - 1);
 
         // current memory block has enough space
         int allocIdx = context.m_threadFrameAllocIndices[g_threadIdx];
@@ -1318,7 +2690,7 @@ namespace ZetaRay::AppImpl
             const uintptr_t ret = Math::AlignUp(start + block.Offset, alignment);
             const uintptr_t startOffset = ret - start;
 
-            if (startOffset + size < frameMemory.BLOCK_SIZE)
+            if (startOffset + size <= block.Size)
             {
                 block.Offset = startOffset + size;
                 return reinterpret_cast<void*>(ret);
@@ -1335,7 +2707,7 @@ namespace ZetaRay::AppImpl
         const uintptr_t ret = Math::AlignUp(start, alignment);
         const uintptr_t startOffset = ret - start;
 
-        Assert(startOffset + size < frameMemory.BLOCK_SIZE, "should never happen.");
+        Assert(startOffset + size <= block.Size, "should never happen.");
         block.Offset = startOffset + size;
 
         return reinterpret_cast<void*>(ret);
@@ -1347,40 +2719,83 @@ namespace ZetaRay
     CpuInfo App::GetProcessorInfo()
     {
         DWORD buffSize = 0;
-        GetLogicalProcessorInformation(nullptr, &buffSize);
-        Assert(GetLastError() == ERROR_INSUFFICIENT_BUFFER, "GetLogicalProcessorInformation() failed.");
+        GetLogicalProcessorInformationEx(RelationAll, nullptr, &buffSize);
+        Assert(GetLastError() == ERROR_INSUFFICIENT_BUFFER, "GetLogicalProcessorInformationEx() failed.");
 
         SmallVector<unsigned char, SystemAllocator, 1024> buffer;
         buffer.resize(buffSize);
-        SYSTEM_LOGICAL_PROCESSOR_INFORMATION* dataPtr =
-            reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION*>(buffer.data());
 
-        bool rc = GetLogicalProcessorInformation(dataPtr, &buffSize);
-        Assert(rc, "GetLogicalProcessorInformation() failed.");
+        bool rc = GetLogicalProcessorInformationEx(RelationAll,
+            reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data()), &buffSize);
+        Assert(rc, "GetLogicalProcessorInformationEx() failed.");
 
-        const int n = buffSize / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
-        SYSTEM_LOGICAL_PROCESSOR_INFORMATION* curr = dataPtr;
-        //int logicalProcessorCount = 0;
+        // Entries have variable size
+        auto forEach = [&buffer, buffSize](LOGICAL_PROCESSOR_RELATIONSHIP relationship, auto&& fn)
+            {
+                DWORD offset = 0;
+                while (offset < buffSize)
+                {
+                    auto* curr = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+                    if (curr->Relationship == relationship)
+                        fn(*curr);
+
+                    offset += curr->Size;
+                }
+            };
 
         CpuInfo ret{};
+        int maxEfficiencyClass = 0;
+        int minEfficiencyClass = INT_MAX;
 
-        for (int i = 0; i < n; i++)
-        {
-            switch (curr->Relationship)
+        forEach(RelationProcessorCore, [&](const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& info)
+            {
+                maxEfficiencyClass = Max(maxEfficiencyClass, (int)info.Processor.EfficiencyClass);
+                minEfficiencyClass = Min(minEfficiencyClass, (int)info.Processor.EfficiencyClass);
+            });
+
+        // Efficiency class is always zero on non-hybrid CPUs
+        const bool isHybrid = maxEfficiencyClass != minEfficiencyClass;
+
+        forEach(RelationProcessorCore, [&](const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& info)
             {
-            case RelationProcessorCore:
                 ret.NumPhysicalCores++;
 
                 // A hyperthreaded core supplies more than one logical processor.
-                ret.NumLogicalCores += (int)__popcnt64(curr->ProcessorMask);
-                break;
+                const uint64_t mask = info.Processor.GroupMask[0].Group == 0 ? 
+                    (uint64_t)info.Processor.GroupMask[0].Mask : 0;
+                ret.NumLogicalCores += (int)__popcnt64(info.Processor.GroupMask[0].Mask);
 
-            default:
-                break;
-            }
+                if (!mask)
+                    return;
 
-            curr++;
-        }
+                const uint64_t primary = mask & (~mask + 1);
+
+                if (!isHybrid || info.Processor.EfficiencyClass == maxEfficiencyClass)
+                {
+                    ret.NumPerformanceCores++;
+                    ret.PerformanceCoreMask |= mask;
+                    ret.PerformanceCorePrimaryMask |= primary;
+                }
+                else
+                {
+                    ret.NumEfficiencyCores++;
+                    ret.EfficiencyCoreMask |= mask;
+                    ret.EfficiencyCorePrimaryMask |= primary;
+                }
+            });
+
+        forEach(RelationCache, [&](const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& info)
+            {
+                if (info.Cache.Type != CacheUnified && info.Cache.Type != CacheData)
+                    return;
+
+                ret.CacheLineSize = Max(ret.CacheLineSize, (uint32_t)info.Cache.LineSize);
+
+                if (info.Cache.Level == 2)
+                    ret.L2CacheSizeKB = Max(ret.L2CacheSizeKB, (uint32_t)(info.Cache.CacheSize >> 10));
+                else if (info.Cache.Level == 3)
+                    ret.L3CacheSizeKB += (uint32_t)(info.Cache.CacheSize >> 10);
+            });
 
         return ret;
     }
@@ -1400,6 +2815,46 @@ namespace ZetaRay
         }
     }
 
+    void App::SetThreadPlacement(void* handle, THREAD_PLACEMENT placement, CORE_TYPE coreType, int idx)
+    {
+        DWORD_PTR processMask;
+        DWORD_PTR systemMask;
+        CheckWin32(GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask));
+
+        if (placement == THREAD_PLACEMENT::OS_DEFAULT)
+        {
+            // Note: there's no way to reset the ideal processor, but it's just a hint
+            CheckWin32(SetThreadAffinityMask(handle, processMask));
+            return;
+        }
+
+        const CpuInfo& info = g_app->m_cpuInfo;
+        uint64_t coreMask = coreType == CORE_TYPE::PERFORMANCE ? info.PerformanceCoreMask :
+            info.EfficiencyCoreMask;
+        uint64_t primaryMask = coreType == CORE_TYPE::PERFORMANCE ? info.PerformanceCorePrimaryMask :
+            info.EfficiencyCorePrimaryMask;
+        coreMask &= processMask;
+        primaryMask &= processMask;
+
+        if (!primaryMask)
+        {
+            coreMask = processMask;
+            primaryMask = processMask;
+        }
+
+        // Find the idx'th core
+        idx = idx % (int)__popcnt64(primaryMask);
+        for (int i = 0; i < idx; i++)
+            primaryMask &= primaryMask - 1;
+
+        unsigned long processor;
+        _BitScanForward64(&processor, primaryMask);
+        CheckWin32(SetThreadIdealProcessor(handle, processor) != (DWORD)-1);
+
+        CheckWin32(SetThreadAffinityMask(handle,
+            placement == THREAD_PLACEMENT::PINNED ? (DWORD_PTR)coreMask : processMask));
+    }
+
     void App::SetThreadDesc(void* handle, wchar_t* buffer)
     {
         Assert(handle && buffer, "Invalid args.");
@@ -1420,24 +2875,31 @@ namespace ZetaRay
     }
 
     LogMessage::LogMessage(const char* msg, LogMessage::MsgType t)
+        : LogMessage(msg, t, (uint32_t)g_app->m_timer.GetTotalFrameCount(), GetCurrentThreadId())
+    {}
+
+    LogMessage::LogMessage(const char* msg, LogMessage::MsgType t, uint32_t frameIdx, 
+        uint32_t threadID)
     {
         const char* logType = t == MsgType::INFO ? "INFO" : "WARNING";
         Type = t;
 
         // Compute total size first (without the null terminator)
-        const int n = stbsp_snprintf(nullptr, 0, "[Frame %04d] [tid %05d] [%s] | %s",
-            g_app->m_timer.GetTotalFrameCount(), GetCurrentThreadId(), logType, msg);
+        const int n = stbsp_snprintf(nullptr, 0, "[Frame %04u] [tid %05u] [%s] | %s",
+            frameIdx, threadID, logType, msg);
 
         Msg = reinterpret_cast<char*>(g_app->m_logStrArena.AllocateAligned(n + 1, alignof(char)));
-        stbsp_snprintf(Msg, n + 1, "[Frame %04d] [tid %05d] [%s] | %s",
-            g_app->m_timer.GetTotalFrameCount(), GetCurrentThreadId(), logType, msg);
+        stbsp_snprintf(Msg, n + 1, "[Frame %04u] [tid %05u] [%s] | %s",
+            frameIdx, threadID, logType, msg);
     }
 
-    void App::Init(Scene::Renderer::Interface& rendererInterface, const char* name)
+    void App::Init(Scene::Renderer::Interface& rendererInterface, const char* name, 
+        const HeadlessDesc* headless, const BenchmarkDesc* benchmark, const char* inputReplay)
     {
         // check intrinsics support
         const auto supported = Common::CheckIntrinsicSupport();
         Check(supported & CPU_Intrinsic::AVX2, "AVX2 is not supported.");
+        Check(supported & CPU_Intrinsic::FMA, "FMA is not supported.");
         Check(supported & CPU_Intrinsic::F16C, "F16C is not supported.");
         Check(supported & CPU_Intrinsic::BMI1, "BMI1 is not supported.");
 
@@ -1452,13 +2914,131 @@ namespace ZetaRay
 
         g_app = new (std::nothrow) AppData;
 
-        CpuInfo cpuInfo = App::GetProcessorInfo();
-        g_app->m_processorCoreCount = (uint16)Min(cpuInfo.NumPhysicalCores,
+        if (Filesystem::Exists(AppData::LOG_FILE_PATH))
+            Filesystem::RemoveFile(AppData::LOG_FILE_PATH);
+
+        g_app->m_cpuInfo = App::GetProcessorInfo();
+        g_app->m_processorCoreCount = (uint16)Min(g_app->m_cpuInfo.NumPhysicalCores,
             (MAX_NUM_THREADS - AppData::NUM_BACKGROUND_THREADS));
+        // GetCurrentThread() returns a pseudo handle that can't be used from other threads
+        g_app->m_mainThread = OpenThread(THREAD_SET_INFORMATION | THREAD_QUERY_INFORMATION,
+            FALSE, GetCurrentThreadId());
+        CheckWin32(g_app->m_mainThread);
+
+        Check(!headless || !benchmark, "Headless and benchmark modes can't be combined.");
+        Check(!inputReplay || (!headless && !benchmark), "Input replay can't be combined with "
+            "headless or benchmark modes.");
+
+        if (headless)
+        {
+            Check(headless->OutputPath, "Output path is required in headless mode.");
+            Check(headless->Width > 0 && headless->Height > 0 && headless->NumSamples > 0,
+                "Invalid headless render settings.");
+
+            if (headless->IsTiled())
+            {
+                const size_t pathLen = strlen(headless->OutputPath);
+                Check(pathLen >= 4 && _stricmp(headless->OutputPath + pathLen - 4, ".exr") == 0,
+                    "Tiled rendering requires EXR output.");
+                Check(headless->TileSize + 2 * headless->TileApron <= UINT16_MAX, "Tile is too large.");
+                Check(headless->DenoiseCheckpoint == 0, "Denoising isn't supported with tiled rendering.");
+            }
+
+            if (headless->DenoiseCheckpoint)
+            {
+                const size_t pathLen = strlen(headless->OutputPath);
+                Check(pathLen >= 4 && _stricmp(headless->OutputPath + pathLen - 4, ".exr") == 0,
+                    "Denoising requires EXR output.");
+                Check(headless->DenoiseThreshold > 0.0f, "Invalid denoise threshold.");
+            }
+
+            g_app->m_headless = *headless;
+            g_app->m_isHeadless = true;
+            // Messages are printed right away, there's no UI to show them
+            g_app->m_logBuffer.Disable();
+            g_app->m_hwnd = nullptr;
+            g_app->m_dpi = USER_DEFAULT_SCREEN_DPI;
+        }
+        else
+        {
+            if (benchmark)
+            {
+                const bool passMode = benchmark->Pass != nullptr;
+                Check((benchmark->CameraPath || passMode) && benchmark->OutputPath, "Camera path and "
+                    "output path are required in benchmark mode.");
+                Check(benchmark->Timestep > 0.0f && benchmark->Width > 0 && benchmark->Height > 0,
+                    "Invalid benchmark settings.");
+                Check(!passMode || benchmark->NumPassReps > 0, "Invalid number of pass replays.");
+                Check(passMode || !benchmark->Sweep, "Parameter sweeps require a pass benchmark.");
+                Check(!passMode || !benchmark->BaselinePath, "Baseline comparison isn't supported for "
+                    "pass benchmarks.");
+
+                auto& bench = g_app->m_benchmark;
+                bench.Desc = *benchmark;
+
+                if (benchmark->CameraPath)
+                {
+                    bench.Path.Load(benchmark->CameraPath);
+                    Check(bench.Path.NumKeyframes() >= (passMode ? 1 : 2), "%s: benchmark requires a "
+                        "camera path with at least two keyframes.", benchmark->CameraPath);
+                }
+
+                if (passMode)
+                {
+                    bench.Recorder.Reset(0);
+
+                    if (benchmark->Sweep)
+                    {
+                        const char* values = strchr(benchmark->Sweep, '=');
+                        Check(values && values != benchmark->Sweep, "Invalid parameter sweep %s, expected "
+                            "<group>/<subgroup>/<name>=<v0>,<v1>,...", benchmark->Sweep);
+
+                        const size_t len = values - benchmark->Sweep;
+                        Check(len < Benchmark::MAX_SWEEP_PARAM_LEN, "Sweep parameter name is too long.");
+                        memcpy(bench.SweepParam, benchmark->Sweep, len);
+                        bench.SweepParam[len] = '\0';
+
+                        const char* curr = values + 1;
+                        while (*curr != '\0')
+                        {
+                            Check(bench.NumSweepValues < Benchmark::MAX_NUM_SWEEP_VALUES, "At most %d "
+                                "sweep values are supported.", Benchmark::MAX_NUM_SWEEP_VALUES);
+
+                            char* end;
+                            bench.SweepValues[bench.NumSweepValues++] = strtof(curr, &end);
+                            Check(end != curr && (*end == ',' || *end == '\0'), "Invalid sweep value in %s.",
+                                benchmark->Sweep);
+                            curr = *end == ',' ? end + 1 : end;
+                        }
+
+                        Check(bench.NumSweepValues > 0, "No sweep values were given in %s.", benchmark->Sweep);
+                    }
+                }
+                else
+                {
+                    // Every frame of the path, including both endpoints
+                    uint32_t numFrames = (uint32_t)(bench.Path.Duration() / benchmark->Timestep) + 1;
+                    numFrames = benchmark->NumFrames ? Min(numFrames, benchmark->NumFrames) : numFrames;
+                    bench.Recorder.Reset(numFrames);
+                }
+
+                g_app->m_isBenchmark = true;
+                g_app->m_timer.SetFixedTimestep(benchmark->Timestep);
+            }
+            else if (inputReplay)
+            {
+                Check(g_app->m_inputRecording.Load(inputReplay), "%s is not a valid input recording.", 
+                    inputReplay);
+                Check(g_app->m_inputRecording.NumFrames() > 0, "%s: input recording is empty.", 
+                    inputReplay);
+
+                g_app->m_replayingInput = true;
+            }
 
-        // create the window
-        AppImpl::CreateAppWindow(instance);
-        SetWindowTextA(g_app->m_hwnd, name ? name : "ZetaRay");
+            // create the window
+            AppImpl::CreateAppWindow(instance);
+            SetWindowTextA(g_app->m_hwnd, name ? name : "ZetaRay");
+        }
 
         // Initialize thread pools - totalNumThreads is passed to account for all the 
         // other threads that may insert tasks such as the main thread
@@ -1486,14 +3066,31 @@ namespace ZetaRay
             sizeof(int) * MAX_NUM_THREADS);
         g_app->m_frameMemoryContext.m_currFrameAllocIndex.store(0, std::memory_order_release);
 
+        AppImpl::ApplyThreadPlacement();
+
         g_app->m_workerThreadPool.Start();
         g_app->m_backgroundThreadPool.Start();
 
-        RECT rect;
-        GetClientRect(g_app->m_hwnd, &rect);
+        if (g_app->m_isHeadless && g_app->m_headless.IsTiled())
+        {
+            // Every tile is rendered at the same resolution, including the apron
+            const uint16_t tileDim = g_app->m_headless.TileSize + 2 * g_app->m_headless.TileApron;
+            g_app->m_displayWidth = tileDim;
+            g_app->m_displayHeight = tileDim;
+        }
+        else if (g_app->m_isHeadless)
+        {
+            g_app->m_displayWidth = g_app->m_headless.Width;
+            g_app->m_displayHeight = g_app->m_headless.Height;
+        }
+        else
+        {
+            RECT rect;
+            GetClientRect(g_app->m_hwnd, &rect);
 
-        g_app->m_displayWidth = (uint16_t)(rect.right - rect.left);
-        g_app->m_displayHeight = (uint16_t)(rect.bottom - rect.top);
+            g_app->m_displayWidth = (uint16_t)(rect.right - rect.left);
+            g_app->m_displayHeight = (uint16_t)(rect.bottom - rect.top);
+        }
 
         // initialize renderer
         const float renderWidth = g_app->m_displayWidth / g_app->m_upscaleFactor;
@@ -1507,8 +3104,20 @@ namespace ZetaRay
         // initialize camera
         g_app->m_frameMotion.Reset();
 
-        g_app->m_camera.Init(float3(0, 1.2f, -4.043f), App::GetRenderer().GetAspectRatio(),
-            Math::DegreesToRadians(60.0f), 0.2f, true, float3(0, 0, 1), false);
+        if (g_app->m_isHeadless && g_app->m_headless.HasCamera)
+        {
+            const float* pos = g_app->m_headless.CameraPos;
+            const float* lookAt = g_app->m_headless.CameraLookAt;
+
+            g_app->m_camera.Init(float3(pos[0], pos[1], pos[2]), App::GetRenderer().GetAspectRatio(),
+                Math::DegreesToRadians(g_app->m_headless.FovDegrees), 0.2f, true, 
+                float3(lookAt[0], lookAt[1], lookAt[2]), true);
+        }
+        else
+        {
+            g_app->m_camera.Init(float3(0, 1.2f, -4.043f), App::GetRenderer().GetAspectRatio(),
+                Math::DegreesToRadians(60.0f), 0.2f, true, float3(0, 0, 1), false);
+        }
 
         // scene can now be initialized
         g_app->m_scene.Init(rendererInterface);
@@ -1519,11 +3128,82 @@ namespace ZetaRay
             g_app->m_cameraAcceleration, 1.0f, 100.0f, 1.0f, "Motion");
         App::AddParam(acc);
 
+        if (!g_app->m_isHeadless && !g_app->m_isBenchmark)
+        {
+            ParamVariant recordPath;
+            recordPath.InitBool(ICON_FA_LANDMARK " Scene", "Camera", "Record Path",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&AppImpl::SetRecordCameraPath),
+                false, "Motion");
+            App::AddParam(recordPath);
+        }
+
+        if (!g_app->m_isHeadless && !g_app->m_isBenchmark && !g_app->m_replayingInput)
+        {
+            ParamVariant recordInput;
+            recordInput.InitBool(ICON_FA_MICROCHIP " CPU", "Profiling", "Record Input",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&AppImpl::SetRecordInput),
+                false);
+            g_app->m_recordInputParamID = recordInput.ID();
+            App::AddParam(recordInput);
+        }
+
+        ParamVariant hitchThresh;
+        hitchThresh.InitFloat(ICON_FA_MICROCHIP " CPU", "Profiling", "Hitch Threshold (x Median)",
+            fastdelegate::FastDelegate1<const ParamVariant&>(&AppImpl::SetHitchThreshold),
+            g_app->m_hitchThreshold, 1.25f, 10.0f, 0.25f);
+        App::AddParam(hitchThresh);
+
+        ParamVariant bgScheduling;
+        bgScheduling.InitBool(ICON_FA_MICROCHIP " CPU", "Scheduling", "Frame-Aware Background Tasks",
+            fastdelegate::FastDelegate1<const ParamVariant&>(&AppImpl::SetFrameAwareBackgroundScheduling),
+            g_app->m_frameAwareBackgroundScheduling);
+        App::AddParam(bgScheduling);
+
+        if (g_app->m_cpuInfo.IsHybrid())
+        {
+            ParamVariant placement;
+            placement.InitEnum(ICON_FA_MICROCHIP " CPU", "Scheduling", "Thread Placement",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&AppImpl::SetThreadPlacementMode),
+                AppData::ThreadPlacementOptions, ZetaArrayLen(AppData::ThreadPlacementOptions),
+                (int)g_app->m_threadPlacement);
+            App::AddParam(placement);
+        }
+
         g_app->m_isInitialized = true;
 
         LOG_UI(INFO, "Detected %d physical CPU cores", g_app->m_processorCoreCount);
-        LOG_UI(INFO, "Work area on the primary display monitor is %dx%d",
-            g_app->m_displayWidth, g_app->m_displayHeight);
+        if (g_app->m_cpuInfo.IsHybrid())
+        {
+            LOG_UI(INFO, "Hybrid CPU: %d performance cores, %d efficiency cores",
+                g_app->m_cpuInfo.NumPerformanceCores, g_app->m_cpuInfo.NumEfficiencyCores);
+        }
+        LOG_UI(INFO, "L2: %u KB, L3: %u KB, cache line: %u bytes", g_app->m_cpuInfo.L2CacheSizeKB,
+            g_app->m_cpuInfo.L3CacheSizeKB, g_app->m_cpuInfo.CacheLineSize);
+        if (g_app->m_isHeadless)
+        {
+            LOG_UI(INFO, "Headless mode: rendering %ux%u at %u spp to %s on %s", g_app->m_headless.Width, 
+                g_app->m_headless.Height, g_app->m_headless.NumSamples, g_app->m_headless.OutputPath,
+                g_app->m_renderer.GetDeviceDescription());
+        }
+        else
+        {
+            LOG_UI(INFO, "Work area on the primary display monitor is %dx%d",
+                g_app->m_displayWidth, g_app->m_displayHeight);
+        }
+        if (g_app->m_isBenchmark && g_app->m_benchmark.Desc.Pass)
+        {
+            LOG_UI(INFO, "Pass benchmark mode: %s (%u replays%s%s) at %ux%u, results are written to %s",
+                g_app->m_benchmark.Desc.Pass, g_app->m_benchmark.Desc.NumPassReps, 
+                g_app->m_benchmark.NumSweepValues ? " for every value of " : "",
+                g_app->m_benchmark.NumSweepValues ? g_app->m_benchmark.SweepParam : "",
+                g_app->m_displayWidth, g_app->m_displayHeight, g_app->m_benchmark.Desc.OutputPath);
+        }
+        else if (g_app->m_isBenchmark)
+        {
+            LOG_UI(INFO, "Benchmark mode: %s (%u frames) at %ux%u, results are written to %s",
+                g_app->m_benchmark.Desc.CameraPath, g_app->m_benchmark.Recorder.NumFrames(),
+                g_app->m_displayWidth, g_app->m_displayHeight, g_app->m_benchmark.Desc.OutputPath);
+        }
     }
 
     void App::InitBasic()
@@ -1533,29 +3213,59 @@ namespace ZetaRay
         g_app = new (std::nothrow) AppData;
 
         CpuInfo cpuInfo = App::GetProcessorInfo();
-        g_app->m_processorCoreCount = (uint16)Min(cpuInfo.NumPhysicalCores, MAX_NUM_THREADS);
+        g_app->m_processorCoreCount = (uint16)Min(cpuInfo.NumPhysicalCores, 
+            (MAX_NUM_THREADS - AppData::NUM_BACKGROUND_THREADS));
 
-        // Initialize thread pool
-        const int totalNumThreads = g_app->m_processorCoreCount;
+        // Initialize thread pools, same layout as Init()
+        const int totalNumThreads = g_app->m_processorCoreCount + AppData::NUM_BACKGROUND_THREADS;
         g_app->m_workerThreadPool.Init(g_app->m_processorCoreCount - 1,
             totalNumThreads,
             L"ZetaWorker",
             THREAD_PRIORITY::NORMAL,
             1);
 
+        g_app->m_backgroundThreadPool.Init(AppData::NUM_BACKGROUND_THREADS,
+            totalNumThreads,
+            L"ZetaBackgroundWorker",
+            THREAD_PRIORITY::BACKGROUND,
+            g_app->m_processorCoreCount);
+
         // main thread
         g_threadIdx = 0;
 
         g_app->m_workerThreadPool.Start();
+        g_app->m_backgroundThreadPool.Start();
+
+        memset(g_app->m_frameMemoryContext.m_threadFrameAllocIndices, -1,
+            sizeof(int) * MAX_NUM_THREADS);
+        g_app->m_frameMemoryContext.m_currFrameAllocIndex.store(0, std::memory_order_release);
 
         // renderer (for d3dDevice)
         g_app->m_renderer.InitBasic();
     }
 
+    void App::ResetFrameAllocator()
+    {
+        AppImpl::ResetFrameMemory(decltype(g_app->m_frameMemory)::BASE_BLOCK_SIZE);
+    }
+
+    void App::ResetTaskSignals()
+    {
+        Assert(g_app->m_workerThreadPool.AreAllTasksFinished(), 
+            "Task signals can't be reset while there are unfinished tasks.");
+        g_app->m_currTaskSignalIdx.store(0, std::memory_order_relaxed);
+    }
+
+    void App::SetMaxNumActiveWorkerThreads(int n)
+    {
+        g_app->m_workerThreadPool.SetMaxNumActiveThreads(n);
+    }
+
     void App::ShutdownBasic()
     {
         g_app->m_renderer.ShutdownBasic();
         g_app->m_workerThreadPool.Shutdown();
+        g_app->m_backgroundThreadPool.Shutdown();
 
         delete g_app;
         g_app = nullptr;
@@ -1569,8 +3279,30 @@ namespace ZetaRay
 
         while (true)
         {
+            if (g_app->m_exitRequested.load(std::memory_order_acquire))
+            {
+                // There's no window to receive WM_DESTROY in headless mode
+                if (g_app->m_isHeadless)
+                {
+                    const int exitCode = g_app->m_exitCode;
+                    AppImpl::OnDestroy();
+                    return exitCode;
+                }
+
+                // Goes through WM_DESTROY, after which WM_QUIT ends the loop
+                g_app->m_exitRequested.store(false, std::memory_order_relaxed);
+                PostMessageA(g_app->m_hwnd, WM_CLOSE, 0, 0);
+            }
+
             if (g_app->m_isActive && success)
+            {
                 g_app->m_renderer.WaitForSwapChainWaitableObject();
+                g_app->m_renderer.LatencySleep();
+            }
+
+            // Input is read from the messages below
+            LARGE_INTEGER inputSample;
+            QueryPerformanceCounter(&inputSample);
 
             // process messages
             while (PeekMessageA(&msg, nullptr, 0, 0, PM_REMOVE))
@@ -1598,20 +3330,24 @@ namespace ZetaRay
             // at this point, all worker tasks from previous frame are done (GPU may still 
             // be executing those though)
             g_app->m_currTaskSignalIdx.store(0, std::memory_order_relaxed);
+
+            if (g_app->m_exportTaskTimeline.exchange(false, std::memory_order_relaxed))
+                AppImpl::ExportTaskTimeline();
+
             const size_t tempMemoryUsed = g_app->m_frameMemory.TotalSize();
 
             // Skip first frame
             if (g_app->m_timer.GetTotalFrameCount() > 0)
-            {
-                g_app->m_frameMemoryContext.m_currFrameAllocIndex.store(0, std::memory_order_release);
-                for (int i = 0; i < MAX_NUM_THREADS; i++)
-                    g_app->m_frameMemoryContext.m_threadFrameAllocIndices[i] = -1;
-                g_app->m_frameMemory.Reset();        // set the offset to 0, essentially releasing the memory
-            }
+                AppImpl::ResetFrameMemory(AppImpl::UpdateFrameAllocatorBlockSize());
 
             g_app->m_renderer.BeginFrame();
             // Startup is counted as "frame" 0, so program loop starts from frame 1
             g_app->m_timer.Tick();
+            g_app->m_renderer.SetLatencyMarker(LATENCY_MARKER::INPUT_SAMPLE, inputSample.QuadPart);
+            g_app->m_renderer.SetLatencyMarker(LATENCY_MARKER::SIMULATION_START);
+            AppImpl::DrainLogs();
+            AppImpl::FlushLogFile(true);
+            AppImpl::BeginFrameCriticalPath();
             AppImpl::ResizeIfQueued();
             AppImpl::ChangeDPIIfQueued();
 
@@ -1621,7 +3357,7 @@ namespace ZetaRay
                 TaskSet sceneRendererTS;
                 AppImpl::Update(sceneTS, sceneRendererTS, tempMemoryUsed);
 
-                if (!g_app->m_paramsUpdates.empty())
+                if (g_app->m_paramUpdates.load(std::memory_order_relaxed))
                 {
                     sceneTS.EmplaceTask("ParamUpdates", []()
                         {
@@ -1679,6 +3415,7 @@ namespace ZetaRay
             }
 
             g_app->m_workerThreadPool.PumpUntilEmpty();
+            AppImpl::EndFrameCriticalPath();
         }
 
         return (int)msg.wParam;
@@ -1690,12 +3427,82 @@ namespace ZetaRay
         PostQuitMessage(0);
     }
 
+    void App::RequestExit()
+    {
+        g_app->m_exitRequested.store(true, std::memory_order_release);
+    }
+
+    const HeadlessDesc* App::GetHeadlessDesc()
+    {
+        return g_app->m_isHeadless ? &g_app->m_headless : nullptr;
+    }
+
+    void App::QueueHeadlessJob(const HeadlessDesc& job)
+    {
+        const HeadlessDesc& first = g_app->m_headless;
+        Check(g_app->m_isHeadless && !first.IsTiled(), "Jobs can only be queued in non-tiled headless mode.");
+        Check(job.OutputPath && job.NumSamples > 0, "Invalid headless job.");
+        Check(job.Width == first.Width && job.Height == first.Height && !job.IsTiled() &&
+            job.FovDegrees == first.FovDegrees && job.TargetRelError == first.TargetRelError && 
+            job.AdapterIndex == first.AdapterIndex && job.SampleStream == first.SampleStream &&
+            job.DenoiseCheckpoint == first.DenoiseCheckpoint && job.DenoiseThreshold == first.DenoiseThreshold,
+            "Queued headless jobs may only change the camera, number of samples and output path.");
+
+        g_app->m_headlessJobs.push_back(job);
+    }
+
+    void App::FinishHeadlessJob()
+    {
+        g_app->m_headlessJobDone.store(true, std::memory_order_release);
+    }
+
+    uint32_t App::GetHeadlessJobIndex()
+    {
+        return g_app->m_nextHeadlessJob;
+    }
+
+    const BenchmarkDesc* App::GetBenchmarkDesc()
+    {
+        return g_app->m_isBenchmark ? &g_app->m_benchmark.Desc : nullptr;
+    }
+
+    int64_t App::GetBenchmarkFrame()
+    {
+        if (!g_app->m_isBenchmark || g_app->m_benchmark.StartFrame == 0)
+            return -1;
+
+        return (int64_t)(g_app->m_timer.GetTotalFrameCount() - g_app->m_benchmark.StartFrame);
+    }
+
+    int64_t App::GetReplayFrame()
+    {
+        if (!g_app->m_replayingInput || g_app->m_replayStartFrame == 0)
+            return -1;
+
+        return (int64_t)(g_app->m_inputRecording.FirstFrameNum() + 
+            g_app->m_timer.GetTotalFrameCount() - g_app->m_replayStartFrame);
+    }
+
     void* App::AllocateFrameAllocator(size_t size, size_t alignment)
     {
         return AppImpl::AllocateFrameAllocator<>(g_app->m_frameMemory,
             g_app->m_frameMemoryContext, size, alignment);
     }
 
+    size_t App::GetFrameAllocatorMaxAllocationSize()
+    {
+        return g_app->m_frameMemory.BlockSize();
+    }
+
+    void App::RecordFrameAllocatorFallback(size_t size, size_t alignment)
+    {
+        alignment = Max(alignof(std::max_align_t), alignment);
+
+        auto& stats = g_app->m_frameMemoryContext.m_threadStats[g_threadIdx];
+        stats.NumFallbacks++;
+        stats.LargestRequest = Max(stats.LargestRequest, size + alignment - 1);
+    }
+
     int App::RegisterTask()
     {
         int idx = g_app->m_currTaskSignalIdx.fetch_add(1, std::memory_order_relaxed);
@@ -1713,6 +3520,7 @@ namespace ZetaRay
 
         g_app->m_registeredTasks[handle].Indegree.store(indegree, std::memory_order_release);
         g_app->m_registeredTasks[handle].BlockFlag.store(true, std::memory_order_release);
+        g_app->m_registeredTasks[handle].ParkState.store(AppData::NONE, std::memory_order_release);
     }
 
     void App::WaitForAdjacentHeadNodes(int handle)
@@ -1726,11 +3534,46 @@ namespace ZetaRay
 
         if (indegree != 0)
         {
+            const int64_t begin = TaskTimeline::Now();
             taskSignal.BlockFlag.wait(true, std::memory_order_acquire);
+            g_app->m_taskTimeline.Record("WaitForAdjacentHeadNodes", TaskTimeline::EVENT_TYPE::WAIT,
+                begin, TaskTimeline::Now());
+
             return;
         }
     }
 
+    bool App::AreAdjacentHeadNodesFinished(int handle)
+    {
+        const int c = g_app->m_currTaskSignalIdx.load(std::memory_order_relaxed);
+        Assert(handle >= 0 && handle < c, "Received handle %d while #handles for current frame is %d.", c);
+
+        // BlockFlag is only set for tasks with indegree > 0 and is cleared (with release 
+        // semantics) once the last dependency has finished
+        auto& taskSignal = g_app->m_registeredTasks[handle];
+        return !taskSignal.BlockFlag.load(std::memory_order_acquire);
+    }
+
+    bool App::TryParkTask(Task& task)
+    {
+        const int handle = task.GetSignalHandle();
+        const int c = g_app->m_currTaskSignalIdx.load(std::memory_order_relaxed);
+        Assert(handle >= 0 && handle < c, "Received handle %d while #handles for current frame is %d.", handle, c);
+
+        auto& taskSignal = g_app->m_registeredTasks[handle];
+        g_app->m_parkedTasks[handle] = ZetaMove(task);
+        const auto prev = taskSignal.ParkState.exchange(AppData::PARKED, std::memory_order_acq_rel);
+
+        // Last dependency finished in the meantime
+        if (prev == AppData::READY)
+        {
+            task = ZetaMove(g_app->m_parkedTasks[handle]);
+            return false;
+        }
+
+        return true;
+    }
+
     void App::SignalAdjacentTailNodes(Span<int> taskIDs)
     {
         for (auto handle : taskIDs)
@@ -1743,6 +3586,10 @@ namespace ZetaRay
             {
                 taskSignal.BlockFlag.store(false, std::memory_order_release);
                 taskSignal.BlockFlag.notify_one();
+
+                const auto prev = taskSignal.ParkState.exchange(AppData::READY, std::memory_order_acq_rel);
+                if (prev == AppData::PARKED)
+                    g_app->m_workerThreadPool.EnqueueUnparked(ZetaMove(g_app->m_parkedTasks[handle]));
             }
         }
     }
@@ -1759,11 +3606,23 @@ namespace ZetaRay
         g_app->m_workerThreadPool.Enqueue(ZetaMove(ts));
     }
 
+    void App::Submit(LargeTaskSet&& ts)
+    {
+        g_app->m_workerThreadPool.Enqueue(ZetaMove(ts));
+    }
+
     void App::SubmitBackground(Task&& t)
     {
         Assert(t.GetPriority() == TASK_PRIORITY::BACKGROUND,
             "Normal-priority task is not allowed to be executed on the background thread pool.");
         g_app->m_backgroundThreadPool.Enqueue(ZetaMove(t));
+
+        // Idle worker threads only block on their own pool, so they need to be woken up
+        if (g_app->m_frameAwareBackgroundScheduling && 
+            !g_app->m_inFrameCriticalPath.load(std::memory_order_relaxed))
+        {
+            g_app->m_workerThreadPool.WakeAll();
+        }
     }
 
     void App::FlushWorkerThreadPool()
@@ -1784,9 +3643,101 @@ namespace ZetaRay
             success = g_app->m_backgroundThreadPool.TryFlush();
     }
 
+    bool App::PumpWorkerThreadPoolOnce()
+    {
+        return g_app->m_workerThreadPool.PumpOnce();
+    }
+
+    void App::ParallelForImpl(size_t count, size_t grainSize, void* fn,
+        void (*call)(void* fn, size_t begin, size_t end))
+    {
+        if (count == 0)
+            return;
+
+        grainSize = Max(grainSize, 1llu);
+        const size_t maxNumChunks = CeilUnsignedIntDiv(count, grainSize);
+        // +1 for the calling thread. Runs serially when there's no thread pool (e.g. 
+        // unit tests).
+        const int numHelpers = g_app ? (int)Min(maxNumChunks - 1,
+            (size_t)g_app->m_workerThreadPool.ThreadPoolSize()) : 0;
+
+        if (numHelpers == 0)
+        {
+            call(fn, 0, count);
+            return;
+        }
+
+        struct alignas(64) Context
+        {
+            std::atomic_size_t NextItem;
+            std::atomic_int32_t NumPendingHelpers;
+            size_t Count;
+            size_t GrainSize;
+            size_t NumParticipants;
+            void* Fn;
+            void (*Call)(void*, size_t, size_t);
+
+            // Guided scheduling: each participant claims a fraction of remaining items,
+            // so chunks start out large and shrink to GrainSize towards the end
+            void ProcessChunks()
+            {
+                size_t begin = NextItem.load(std::memory_order_relaxed);
+
+                while (begin < Count)
+                {
+                    const size_t remaining = Count - begin;
+                    size_t chunk = Max(GrainSize, remaining / (2 * NumParticipants));
+                    chunk = Min(chunk, remaining);
+
+                    if (NextItem.compare_exchange_weak(begin, begin + chunk, 
+                        std::memory_order_relaxed))
+                    {
+                        Call(Fn, begin, begin + chunk);
+                        begin = NextItem.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+        };
+
+        Context ctx;
+        ctx.NextItem.store(0, std::memory_order_relaxed);
+        ctx.NumPendingHelpers.store(numHelpers, std::memory_order_relaxed);
+        ctx.Count = count;
+        ctx.GrainSize = grainSize;
+        ctx.NumParticipants = numHelpers + 1;
+        ctx.Fn = fn;
+        ctx.Call = call;
+
+        for (int i = 0; i < numHelpers; i++)
+        {
+            Task t("ParallelFor", TASK_PRIORITY::NORMAL, [&ctx]()
+                {
+                    ctx.ProcessChunks();
+                    ctx.NumPendingHelpers.fetch_sub(1, std::memory_order_release);
+                });
+
+            g_app->m_workerThreadPool.Enqueue(ZetaMove(t));
+        }
+
+        ctx.ProcessChunks();
+
+        // Context lives on this thread's stack, so every helper has to finish (even 
+        // if it has nothing left to do) before returning. Help out in the meantime.
+        while (ctx.NumPendingHelpers.load(std::memory_order_acquire) != 0)
+        {
+            if (!g_app->m_workerThreadPool.PumpOnce())
+                std::this_thread::yield();
+        }
+    }
+
     RendererCore& App::GetRenderer() { return g_app->m_renderer; }
     SceneCore& App::GetScene() { return g_app->m_scene; }
     const Camera& App::GetCamera() { return g_app->m_camera; }
+
+    void App::SetCameraTile(uint32_t fullWidth, uint32_t fullHeight, int offsetX, int offsetY)
+    {
+        g_app->m_camera.SetTile(fullWidth, fullHeight, offsetX, offsetY);
+    }
     int App::GetNumWorkerThreads() { return g_app->m_processorCoreCount; }
     int App::GetNumBackgroundThreads() { return AppData::NUM_BACKGROUND_THREADS; }
     uint32_t App::GetDPI() { return g_app->m_dpi; }
@@ -1794,6 +3745,8 @@ namespace ZetaRay
     float App::GetUpscalingFactor() { return g_app->m_upscaleFactor; }
     bool App::IsFullScreen() { return g_app->m_isFullScreen; }
     const App::Timer& App::GetTimer() { return g_app->m_timer; }
+    TaskTimeline& App::GetTaskTimeline() { return g_app->m_taskTimeline; }
+    void App::ExportTaskTimeline() { g_app->m_exportTaskTimeline.store(true, std::memory_order_relaxed); }
     const char* App::GetPSOCacheDir() { return AppData::PSO_CACHE_DIR; }
     const char* App::GetCompileShadersDir() { return AppData::COMPILED_SHADER_DIR; }
     const char* App::GetAssetDir() { return AppData::ASSET_DIR; }
@@ -1835,60 +3788,39 @@ namespace ZetaRay
         return SynchronizedMutableSpan<ShaderReloadHandler>(g_app->m_shaderReloadHandlers, g_app->m_shaderReloadLock);
     }
 
-    SynchronizedSpan<Stat> App::GetStats()
+    Span<Stat> App::GetStats()
     {
-        return SynchronizedSpan<Stat>(g_app->m_frameStats, g_app->m_statsLock);
+        return g_app->m_statSnapshots[g_app->m_currStatSnapshot];
     }
 
     void App::AddParam(ParamVariant& p)
     {
-        AcquireSRWLockExclusive(&g_app->m_paramUpdateLock);
-
-        g_app->m_paramsUpdates.push_back(ParamUpdate{
+        AppImpl::PushParamUpdate(new ParamUpdate{
             .P = p,
+            .ID = p.ID(),
             .Op = ParamUpdate::ADD });
-
-        ReleaseSRWLockExclusive(&g_app->m_paramUpdateLock);
     }
 
     void App::TryAddParam(ParamVariant& p)
     {
-        AcquireSRWLockExclusive(&g_app->m_paramUpdateLock);
-
-        // TODO Linear search can be slow if there are a lot of parameters
-        bool found = false;
-        for (auto& param : g_app->m_params)
-        {
-            if (param.ID() == p.ID())
-            {
-                found = true;
-                break;
-            }
-        }
-
-        if (!found)
-        {
-            g_app->m_paramsUpdates.push_back(ParamUpdate{
-                .P = p,
-                .Op = ParamUpdate::ADD });
-        }
-
-        ReleaseSRWLockExclusive(&g_app->m_paramUpdateLock);
+        AppImpl::PushParamUpdate(new ParamUpdate{
+            .P = p,
+            .ID = p.ID(),
+            .Op = ParamUpdate::TRY_ADD });
     }
 
     void App::RemoveParam(const char* group, const char* subgroup, const char* name)
     {
-        AcquireSRWLockExclusive(&g_app->m_paramUpdateLock);
-
-        // create a dummy ParamVariant (never exposed to outside)
-        ParamVariant dummy;
-        dummy.InitBool(group, subgroup, name, fastdelegate::FastDelegate1<const ParamVariant&>(), false);
-
-        g_app->m_paramsUpdates.push_back(ParamUpdate{
-            .P = dummy,
+        AppImpl::PushParamUpdate(new ParamUpdate{
+            .ID = ParamVariant::ComputeID(group, subgroup, name),
             .Op = ParamUpdate::REMOVE });
+    }
 
-        ReleaseSRWLockExclusive(&g_app->m_paramUpdateLock);
+    void App::QueueParamCallback(uint64_t id)
+    {
+        AppImpl::PushParamUpdate(new ParamUpdate{
+            .ID = id,
+            .Op = ParamUpdate::INVOKE_CALLBACK });
     }
 
     void App::AddShaderReloadHandler(const char* name, fastdelegate::FastDelegate0<> dlg)
@@ -1923,37 +3855,27 @@ namespace ZetaRay
 
     void App::AddFrameStat(const char* group, const char* name, int i)
     {
-        AcquireSRWLockExclusive(&g_app->m_statsLock);
-        g_app->m_frameStats.emplace_back(group, name, i);
-        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+        AppImpl::AddStat(group, name, i);
     }
 
     void App::AddFrameStat(const char* group, const char* name, uint32_t u)
     {
-        AcquireSRWLockExclusive(&g_app->m_statsLock);
-        g_app->m_frameStats.emplace_back(group, name, u);
-        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+        AppImpl::AddStat(group, name, u);
     }
 
     void App::AddFrameStat(const char* group, const char* name, float f)
     {
-        AcquireSRWLockExclusive(&g_app->m_statsLock);
-        g_app->m_frameStats.emplace_back(group, name, f);
-        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+        AppImpl::AddStat(group, name, f);
     }
 
     void App::AddFrameStat(const char* group, const char* name, uint64_t u)
     {
-        AcquireSRWLockExclusive(&g_app->m_statsLock);
-        g_app->m_frameStats.emplace_back(group, name, u);
-        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+        AppImpl::AddStat(group, name, u);
     }
 
     void App::AddFrameStat(const char* group, const char* name, uint32_t num, uint32_t total)
     {
-        AcquireSRWLockExclusive(&g_app->m_statsLock);
-        g_app->m_frameStats.emplace_back(group, name, num, total);
-        ReleaseSRWLockExclusive(&g_app->m_statsLock);
+        AppImpl::AddStat(group, name, num, total);
     }
 
     Span<float> App::GetFrameTimeHistory()
@@ -1964,11 +3886,38 @@ namespace ZetaRay
 
     void App::Log(const char* msg, LogMessage::MsgType t)
     {
+        // Nothing would display (or clear) the logs in headless mode
+        if (g_app->m_isHeadless)
+        {
+            const size_t len = strlen(msg);
+            const bool hasNewline = len > 0 && msg[len - 1] == '\n';
+
+            App::LockStdOut();
+            printf(hasNewline ? "%s%s" : "%s%s\n", t == LogMessage::WARNING ? "Warning: " : "", msg);
+            App::UnlockStdOut();
+
+            AcquireSRWLockExclusive(&g_app->m_logLock);
+            LogMessage line(msg, t);
+            AppendToLogFile(line.Msg);
+            ReleaseSRWLockExclusive(&g_app->m_logLock);
+
+            return;
+        }
+
+        if (g_app->m_logBuffer.Push(t, "%s", msg))
+            return;
+
         AcquireSRWLockExclusive(&g_app->m_logLock);
         g_app->m_frameLogs.emplace_back(msg, t);
+        AppendToLogFile(g_app->m_frameLogs.back().Msg);
         ReleaseSRWLockExclusive(&g_app->m_logLock);
     }
 
+    LogBuffer& App::GetLogBuffer()
+    {
+        return g_app->m_logBuffer;
+    }
+
     Util::RWSynchronizedView<Vector<App::LogMessage, SystemAllocator>> App::GetLogs()
     {
         return RWSynchronizedView<Vector<LogMessage>>(g_app->m_frameLogs, g_app->m_logLock);;
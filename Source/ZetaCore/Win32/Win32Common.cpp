@@ -39,7 +39,7 @@ uint32_t Common::CheckIntrinsicSupport()
     uint32_t ret = 0;
 
     // All x64 processors support SSE2,
-    // following code checks for SSE3, SSE4, AVX, F16C, AVX2 and BMI1 support
+    // following code checks for SSE3, SSE4, AVX, F16C, FMA, AVX2, BMI1 and AVX-512 support
 
     // EAX, EBX, ECX, EDX
     int cpuInfo[4] = { 0 };
@@ -53,6 +53,12 @@ uint32_t Common::CheckIntrinsicSupport()
         ret |= CPU_Intrinsic::AVX;
     if (cpuInfo[2] & (1 << 29))
         ret |= CPU_Intrinsic::F16C;
+    if (cpuInfo[2] & (1 << 12))
+        ret |= CPU_Intrinsic::FMA;
+
+    // OSXSAVE -- XGETBV is available and tells which register states the OS saves. 
+    // Bits 1, 2 and 5-7 are for XMM, YMM and ZMM.
+    const bool osZmmState = (cpuInfo[2] & (1 << 27)) && ((_xgetbv(0) & 0xe6) == 0xe6);
 
     memset(cpuInfo, 0, ZetaArrayLen(cpuInfo) * sizeof(int));
     __cpuid(cpuInfo, 0x7);
@@ -61,6 +67,8 @@ uint32_t Common::CheckIntrinsicSupport()
         ret |= CPU_Intrinsic::AVX2;
     if (cpuInfo[1] & (1 << 3))
         ret |= CPU_Intrinsic::BMI1;
+    if ((cpuInfo[1] & (1 << 16)) && osZmmState)
+        ret |= CPU_Intrinsic::AVX512;
 
     return ret;
 }
\ No newline at end of file
@@ -1,74 +1,252 @@
 #include "../App/Filesystem.h"
 #include "../Support/MemoryArena.h"
+#include "../Utility/SmallVector.h"
 #include "Win32.h"
 
+#if __has_include(<ioringapi.h>)
+#include <ioringapi.h>
+#if defined(NTDDI_WIN10_CO) && NTDDI_VERSION >= NTDDI_WIN10_CO
+#define ZETA_IORING_AVAILABLE
+#endif
+#endif
+
 using namespace ZetaRay::Util;
 using namespace ZetaRay::App;
 
-//--------------------------------------------------------------------------------------
-// Functions
-//--------------------------------------------------------------------------------------
-
-void Filesystem::LoadFromFile(const char* path, Vector<uint8_t>& fileData)
+namespace
 {
-    Assert(path, "path argument was NULL.");
+    // Larger reads are split into multiple reads of this size
+    static constexpr uint32_t READ_CHUNK_SIZE = 1024 * 1024;
+    static constexpr uint32_t MAX_READS_IN_FLIGHT = 64;
 
-    HANDLE h = CreateFileA(path,
-        GENERIC_READ,
-        FILE_SHARE_READ,
-        nullptr,
-        OPEN_EXISTING,
-        FILE_ATTRIBUTE_NORMAL, nullptr);
+#ifdef ZETA_IORING_AVAILABLE
+    // Resolved at runtime so that the program still starts on Windows 10
+    struct IoRingAPI
+    {
+        IoRingAPI()
+        {
+            HMODULE m = GetModuleHandleA("kernelbase.dll");
+            if (!m)
+                return;
+
+            Query = reinterpret_cast<decltype(&QueryIoRingCapabilities)>(
+                GetProcAddress(m, "QueryIoRingCapabilities"));
+            Create = reinterpret_cast<decltype(&CreateIoRing)>(GetProcAddress(m, "CreateIoRing"));
+            BuildRead = reinterpret_cast<decltype(&BuildIoRingReadFile)>(
+                GetProcAddress(m, "BuildIoRingReadFile"));
+            Submit = reinterpret_cast<decltype(&SubmitIoRing)>(GetProcAddress(m, "SubmitIoRing"));
+            Pop = reinterpret_cast<decltype(&PopIoRingCompletion)>(
+                GetProcAddress(m, "PopIoRingCompletion"));
+            Close = reinterpret_cast<decltype(&CloseIoRing)>(GetProcAddress(m, "CloseIoRing"));
+
+            if (!Query || !Create || !BuildRead || !Submit || !Pop || !Close)
+                return;
+
+            IORING_CAPABILITIES caps;
+            if (FAILED(Query(&caps)))
+                return;
+
+            MaxQueueSize = caps.MaxSubmissionQueueSize;
+            Available = MaxQueueSize > 0;
+        }
 
-    Check(h, "CreateFile() for path %s failed with the following error code: %d.", path, 
-        GetLastError());
+        decltype(&QueryIoRingCapabilities) Query = nullptr;
+        decltype(&CreateIoRing) Create = nullptr;
+        decltype(&BuildIoRingReadFile) BuildRead = nullptr;
+        decltype(&SubmitIoRing) Submit = nullptr;
+        decltype(&PopIoRingCompletion) Pop = nullptr;
+        decltype(&CloseIoRing) Close = nullptr;
+        uint32_t MaxQueueSize = 0;
+        bool Available = false;
+    };
+
+    const IoRingAPI& GetIoRingAPI()
+    {
+        static const IoRingAPI api;
+        return api;
+    }
+#endif
 
-    LARGE_INTEGER s;
-    bool success = GetFileSizeEx(h, &s);
-    Check(success, "GetFileSizeEx() for path %s failed with the following error code: %d.", 
-        path, GetLastError());
+    // Part of a ReadRequest
+    struct Read
+    {
+        OVERLAPPED Overlapped;
+        uint8_t* Dst;
+        uint64_t Offset;
+        uint32_t Size;
+        uint32_t RequestIdx;
+        bool Done;
+    };
+
+    struct ReadBatchImpl
+    {
+        MutableSpan<Filesystem::ReadRequest> Requests;
+        // One per request, invalid if file couldn't be opened
+        SmallVector<HANDLE> Files;
+        // Issued in order
+        SmallVector<Read> Reads;
+        uint32_t NextToIssue = 0;
+        uint32_t NumInFlight = 0;
+        uint32_t NumCompleted = 0;
+        uint32_t MaxInFlight = 0;
+        // Oldest read that hasn't completed yet
+        uint32_t OldestPending = 0;
+#ifdef ZETA_IORING_AVAILABLE
+        HIORING Ring = nullptr;
+#endif
+    };
+
+    void Complete(ReadBatchImpl& b, Read& r, bool success, uint32_t numRead)
+    {
+        // Short read means the range went past the end of file
+        if (!success || numRead != r.Size)
+            b.Requests[r.RequestIdx].Succeeded = false;
 
-    fileData.resize(s.QuadPart);
-    DWORD numRead;
-    success = ReadFile(h, fileData.data(), (DWORD)s.QuadPart, &numRead, nullptr);
+        r.Done = true;
+        b.NumInFlight--;
+        b.NumCompleted++;
+    }
 
-    Check(success, "ReadFile() for path %s failed with the following error code: %d.", 
-        path, GetLastError());
-    Check(numRead == (DWORD)s.QuadPart,
-        "ReadFile(): read %u bytes, requested size: %u", numRead, (DWORD)s.QuadPart);
+    void ProgressOverlapped(ReadBatchImpl& b, bool wait)
+    {
+        while (b.NextToIssue < b.Reads.size() && b.NumInFlight < b.MaxInFlight)
+        {
+            Read& r = b.Reads[b.NextToIssue++];
+            memset(&r.Overlapped, 0, sizeof(OVERLAPPED));
+            r.Overlapped.Offset = (DWORD)r.Offset;
+            r.Overlapped.OffsetHigh = (DWORD)(r.Offset >> 32);
+            // Reads from the same file can be in flight at the same time, so each one 
+            // needs its own event
+            r.Overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+            CheckWin32(r.Overlapped.hEvent);
+            b.NumInFlight++;
+
+            if (!ReadFile(b.Files[r.RequestIdx], r.Dst, r.Size, nullptr, &r.Overlapped) &&
+                GetLastError() != ERROR_IO_PENDING)
+            {
+                CloseHandle(r.Overlapped.hEvent);
+                Complete(b, r, false, 0);
+            }
+        }
 
-    CloseHandle(h);
-}
+        while (b.OldestPending < b.NextToIssue && b.Reads[b.OldestPending].Done)
+            b.OldestPending++;
 
-void Filesystem::LoadFromFile(const char* path, Vector<uint8_t, Support::ArenaAllocator>& fileData)
-{
-    Assert(path, "path argument was NULL.");
+        for (uint32_t i = b.OldestPending; i < b.NextToIssue; i++)
+        {
+            Read& r = b.Reads[i];
+            if (r.Done)
+                continue;
 
-    HANDLE h = CreateFileA(path,
-        GENERIC_READ,
-        FILE_SHARE_READ,
-        nullptr,
-        OPEN_EXISTING,
-        FILE_ATTRIBUTE_NORMAL, nullptr);
+            // Only block on the oldest one, the rest are polled
+            DWORD numRead = 0;
+            const bool block = wait && i == b.OldestPending;
+            const bool success = GetOverlappedResult(b.Files[r.RequestIdx], &r.Overlapped, 
+                &numRead, block);
 
-    Check(h, "CreateFile() for path %s failed with the following error code: %d.", 
-        path, GetLastError());
+            if (!success && GetLastError() == ERROR_IO_INCOMPLETE)
+                continue;
 
-    LARGE_INTEGER s;
-    bool success = GetFileSizeEx(h, &s);
-    Check(success, "GetFileSizeEx() for path %s failed with the following error code: %d.", 
-        path, GetLastError());
+            CloseHandle(r.Overlapped.hEvent);
+            Complete(b, r, success, numRead);
+        }
 
-    fileData.resize(s.QuadPart);
-    DWORD numRead;
-    success = ReadFile(h, fileData.data(), (DWORD)s.QuadPart, &numRead, nullptr);
+        while (b.OldestPending < b.NextToIssue && b.Reads[b.OldestPending].Done)
+            b.OldestPending++;
+    }
 
-    Check(success, "ReadFile() for path %s failed with the following error code: %d.", 
-        path, GetLastError());
-    Check(numRead == (DWORD)s.QuadPart,
-        "ReadFile(): read %u bytes, requested size: %u.", numRead, (DWORD)s.QuadPart);
+#ifdef ZETA_IORING_AVAILABLE
+    void ProgressIoRing(ReadBatchImpl& b, bool wait)
+    {
+        const IoRingAPI& api = GetIoRingAPI();
 
-    CloseHandle(h);
+        while (b.NextToIssue < b.Reads.size() && b.NumInFlight < b.MaxInFlight)
+        {
+            const uint32_t idx = b.NextToIssue++;
+            Read& r = b.Reads[idx];
+            b.NumInFlight++;
+
+            if (FAILED(api.BuildRead(b.Ring, IoRingHandleRefFromHandle(b.Files[r.RequestIdx]),
+                IoRingBufferRefFromPointer(r.Dst), r.Size, r.Offset, (UINT_PTR)idx, 
+                IOSQE_FLAGS_NONE)))
+            {
+                Complete(b, r, false, 0);
+            }
+        }
+
+        // Waiting for one completion is enough to make progress
+        UINT32 numSubmitted;
+        const bool block = wait && b.NumInFlight > 0;
+        const HRESULT hr = api.Submit(b.Ring, block ? 1 : 0, block ? INFINITE : 0, &numSubmitted);
+        Check(SUCCEEDED(hr), "SubmitIoRing() failed with the following error code: %d.", hr);
+
+        IORING_CQE cqe;
+        while (api.Pop(b.Ring, &cqe) == S_OK)
+        {
+            Read& r = b.Reads[cqe.UserData];
+            Complete(b, r, SUCCEEDED(cqe.ResultCode), (uint32_t)cqe.Information);
+        }
+    }
+#endif
+
+    void Progress(ReadBatchImpl& b, bool wait)
+    {
+#ifdef ZETA_IORING_AVAILABLE
+        if (b.Ring)
+        {
+            ProgressIoRing(b, wait);
+            return;
+        }
+#endif
+        ProgressOverlapped(b, wait);
+    }
+
+    struct DirectoryWatcherImpl
+    {
+        static constexpr uint32_t BUFFER_SIZE = 16 * 1024;
+
+        HANDLE Dir;
+        OVERLAPPED Overlapped;
+        // Contents aren't inspected, callers compare last write times of the files they 
+        // care about
+        alignas(DWORD) uint8_t Buffer[BUFFER_SIZE];
+    };
+
+    bool IssueDirectoryRead(DirectoryWatcherImpl& w)
+    {
+        ResetEvent(w.Overlapped.hEvent);
+
+        return ReadDirectoryChangesW(w.Dir, w.Buffer, DirectoryWatcherImpl::BUFFER_SIZE, TRUE,
+            FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+            nullptr, &w.Overlapped, nullptr);
+    }
+
+    template<typename Vec>
+    void LoadFromFileImpl(const char* path, Vec& fileData)
+    {
+        Assert(path, "path argument was NULL.");
+
+        const size_t size = Filesystem::GetFileSize(path);
+        Check(size != size_t(-1), "File %s was not found.", path);
+
+        fileData.resize(size);
+        Check(Filesystem::ReadFileRange(path, fileData.data(), 0, size), "Reading file %s failed.", 
+            path);
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------------------------
+
+void Filesystem::LoadFromFile(const char* path, Vector<uint8_t>& fileData)
+{
+    LoadFromFileImpl(path, fileData);
+}
+
+void Filesystem::LoadFromFile(const char* path, Vector<uint8_t, Support::ArenaAllocator>& fileData)
+{
+    LoadFromFileImpl(path, fileData);
 }
 
 void Filesystem::WriteToFile(const char* path, uint8_t* data, uint32_t sizeInBytes)
@@ -103,6 +281,32 @@ void Filesystem::WriteToFile(const char* path, uint8_t* data, uint32_t sizeInByt
     CloseHandle(h);
 }
 
+void Filesystem::AppendToFile(const char* path, uint8_t* data, uint32_t sizeInBytes)
+{
+    Assert(path, "path argument was NULL.");
+
+    HANDLE h = CreateFileA(path,
+        FILE_APPEND_DATA,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+
+    Check(h != INVALID_HANDLE_VALUE, 
+        "CreateFile() for path %s failed with the following error code: %d", path, GetLastError());
+
+    DWORD numWritten;
+    bool success = WriteFile(h, data, sizeInBytes, &numWritten, nullptr);
+
+    Check(success, "WriteFile() for path %s failed with the following error code: %d.", 
+        path, GetLastError());
+    Check(numWritten == (DWORD)sizeInBytes,
+        "WriteFile(): wrote %u bytes, requested size: %llu.", numWritten, sizeInBytes);
+
+    CloseHandle(h);
+}
+
 void Filesystem::RemoveFile(const char* path)
 {
     Assert(path, "path argument was NULL.");
@@ -134,11 +338,8 @@ size_t Filesystem::GetFileSize(const char* path)
     if (h == INVALID_HANDLE_VALUE)
     {
         auto e = GetLastError();
-        if (e == ERROR_FILE_NOT_FOUND)
-        {
-            CloseHandle(h);
+        if (e == ERROR_FILE_NOT_FOUND || e == ERROR_PATH_NOT_FOUND)
             return size_t(-1);
-        }
 
         Check(false, "CreateFile() for path %s failed with the following error code: %d.", 
             path, e);
@@ -152,6 +353,67 @@ size_t Filesystem::GetFileSize(const char* path)
     return s.QuadPart;
 }
 
+uint64_t Filesystem::GetLastWriteTime(const char* path)
+{
+    Assert(path, "path argument was NULL.");
+
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attr))
+        return 0;
+
+    return ((uint64_t)attr.ftLastWriteTime.dwHighDateTime << 32) | attr.ftLastWriteTime.dwLowDateTime;
+}
+
+bool Filesystem::MapFile(const char* path, MappedFile& f)
+{
+    Assert(path, "path argument was NULL.");
+    Assert(!f.Data, "File is already mapped.");
+
+    HANDLE h = CreateFileA(path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (h == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER s;
+    if (!GetFileSizeEx(h, &s) || s.QuadPart == 0)
+    {
+        CloseHandle(h);
+        return false;
+    }
+
+    HANDLE m = CreateFileMappingA(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    Check(m, "CreateFileMapping() for path %s failed with the following error code: %d.", 
+        path, GetLastError());
+
+    void* view = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    Check(view, "MapViewOfFile() for path %s failed with the following error code: %d.", 
+        path, GetLastError());
+
+    f.Data = reinterpret_cast<const uint8_t*>(view);
+    f.Size = s.QuadPart;
+    f.File = h;
+    f.Mapping = m;
+
+    return true;
+}
+
+void Filesystem::UnmapFile(MappedFile& f)
+{
+    if (!f.Data)
+        return;
+
+    UnmapViewOfFile(f.Data);
+    CloseHandle(f.Mapping);
+    CloseHandle(f.File);
+
+    f = MappedFile();
+}
+
 void Filesystem::CreateDirectoryIfNotExists(const char* path)
 {
     Assert(path, "path argument was NULL.");
@@ -192,3 +454,196 @@ bool Filesystem::IsDirectory(const char* path)
 
     return ret & FILE_ATTRIBUTE_DIRECTORY;
 }
+
+Filesystem::ReadBatch Filesystem::SubmitReads(MutableSpan<ReadRequest> requests)
+{
+    ReadBatchImpl* b = new (std::nothrow) ReadBatchImpl;
+    b->Requests = requests;
+    b->Files.resize(requests.size(), INVALID_HANDLE_VALUE);
+
+    for (uint32_t i = 0; i < (uint32_t)requests.size(); i++)
+    {
+        ReadRequest& req = requests[i];
+        Assert(req.Path && (req.Dst || req.Size == 0), "Invalid read request.");
+        req.Succeeded = true;
+
+        if (req.Size == 0)
+            continue;
+
+        HANDLE h = CreateFileA(req.Path,
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+
+        if (h == INVALID_HANDLE_VALUE)
+        {
+            req.Succeeded = false;
+            continue;
+        }
+
+        b->Files[i] = h;
+
+        for (size_t offset = 0; offset < req.Size; offset += READ_CHUNK_SIZE)
+        {
+            b->Reads.push_back(Read{ .Dst = reinterpret_cast<uint8_t*>(req.Dst) + offset,
+                .Offset = req.Offset + offset,
+                .Size = (uint32_t)Math::Min((size_t)READ_CHUNK_SIZE, req.Size - offset),
+                .RequestIdx = i,
+                .Done = false });
+        }
+    }
+
+    b->MaxInFlight = Math::Min((uint32_t)b->Reads.size(), MAX_READS_IN_FLIGHT);
+
+#ifdef ZETA_IORING_AVAILABLE
+    const IoRingAPI& api = GetIoRingAPI();
+    if (api.Available && b->MaxInFlight > 0)
+    {
+        b->MaxInFlight = Math::Min(b->MaxInFlight, api.MaxQueueSize);
+        IORING_CREATE_FLAGS flags = { IORING_CREATE_REQUIRED_FLAGS_NONE, IORING_CREATE_ADVISORY_FLAGS_NONE };
+
+        // Falls back to overlapped I/O
+        if (FAILED(api.Create(IORING_VERSION_1, flags, b->MaxInFlight, b->MaxInFlight * 2, &b->Ring)))
+            b->Ring = nullptr;
+    }
+#endif
+
+    Progress(*b, false);
+
+    return ReadBatch{ .Impl = b };
+}
+
+bool Filesystem::IsComplete(ReadBatch& batch)
+{
+    if (!batch.Impl)
+        return true;
+
+    ReadBatchImpl& b = *reinterpret_cast<ReadBatchImpl*>(batch.Impl);
+    if (b.NumCompleted < b.Reads.size())
+        Progress(b, false);
+
+    return b.NumCompleted == b.Reads.size();
+}
+
+bool Filesystem::Wait(ReadBatch& batch)
+{
+    if (!batch.Impl)
+        return true;
+
+    ReadBatchImpl* b = reinterpret_cast<ReadBatchImpl*>(batch.Impl);
+    while (b->NumCompleted < b->Reads.size())
+        Progress(*b, true);
+
+#ifdef ZETA_IORING_AVAILABLE
+    if (b->Ring)
+        GetIoRingAPI().Close(b->Ring);
+#endif
+
+    for (HANDLE h : b->Files)
+    {
+        if (h != INVALID_HANDLE_VALUE)
+            CloseHandle(h);
+    }
+
+    bool success = true;
+    for (auto& req : b->Requests)
+        success = success && req.Succeeded;
+
+    delete b;
+    batch.Impl = nullptr;
+
+    return success;
+}
+
+bool Filesystem::ReadFileRange(const char* path, void* dst, uint64_t offset, size_t size)
+{
+    ReadRequest req{ .Path = path,
+        .Dst = dst,
+        .Offset = offset,
+        .Size = size };
+    ReadBatch batch = SubmitReads(MutableSpan(&req, 1));
+
+    return Wait(batch);
+}
+
+Filesystem::DirectoryWatcher Filesystem::WatchDirectory(const char* path)
+{
+    Assert(path, "path argument was NULL.");
+
+    HANDLE h = CreateFileA(path,
+        FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+    if (h == INVALID_HANDLE_VALUE)
+        return DirectoryWatcher();
+
+    DirectoryWatcherImpl* w = new (std::nothrow) DirectoryWatcherImpl;
+    w->Dir = h;
+    memset(&w->Overlapped, 0, sizeof(w->Overlapped));
+    w->Overlapped.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    CheckWin32(w->Overlapped.hEvent);
+
+    if (!IssueDirectoryRead(*w))
+    {
+        CloseHandle(w->Overlapped.hEvent);
+        CloseHandle(h);
+        delete w;
+
+        return DirectoryWatcher();
+    }
+
+    return DirectoryWatcher{ .Impl = w };
+}
+
+bool Filesystem::PollChanges(DirectoryWatcher& watcher)
+{
+    if (!watcher.Impl)
+        return false;
+
+    DirectoryWatcherImpl& w = *reinterpret_cast<DirectoryWatcherImpl*>(watcher.Impl);
+    DWORD numBytes;
+
+    if (!GetOverlappedResult(w.Dir, &w.Overlapped, &numBytes, FALSE))
+    {
+        if (GetLastError() == ERROR_IO_INCOMPLETE)
+            return false;
+    }
+
+    // Zero bytes means that buffer overflowed and changes were dropped, which is still 
+    // a change. Either way, keep watching.
+    if (!IssueDirectoryRead(w))
+    {
+        // E.g. directory was deleted, nothing is pending
+        CloseHandle(w.Overlapped.hEvent);
+        CloseHandle(w.Dir);
+        delete &w;
+
+        watcher.Impl = nullptr;
+    }
+
+    return true;
+}
+
+void Filesystem::StopWatching(DirectoryWatcher& watcher)
+{
+    if (!watcher.Impl)
+        return;
+
+    DirectoryWatcherImpl* w = reinterpret_cast<DirectoryWatcherImpl*>(watcher.Impl);
+
+    // Buffer must stay valid until the pending read has been cancelled
+    DWORD numBytes;
+    if (CancelIoEx(w->Dir, &w->Overlapped) || GetLastError() != ERROR_NOT_FOUND)
+        GetOverlappedResult(w->Dir, &w->Overlapped, &numBytes, TRUE);
+
+    CloseHandle(w->Overlapped.hEvent);
+    CloseHandle(w->Dir);
+    delete w;
+
+    watcher.Impl = nullptr;
+}
@@ -80,6 +80,14 @@ void Timer::Tick()
     m_frameCount++;
 }
 
+double Timer::GetTimeSinceLastTick() const
+{
+    LARGE_INTEGER currCount;
+    CheckWin32(QueryPerformanceCounter(&currCount));
+
+    return (double)(currCount.QuadPart - m_last) / m_counterFreqSec;
+}
+
 //--------------------------------------------------------------------------------------
 // DeltaTimer
 //--------------------------------------------------------------------------------------
@@ -10,6 +10,8 @@
 #include <Model/glTF.h>
 #include <Default/DefaultRenderer.h>
 #include <App/Filesystem.h>
+#include <Display/EXR.h>
+#include <Support/MemoryArena.h>
 
 #if OPEN_CONSOLE == 1
 #include <fcntl.h>
@@ -30,6 +32,345 @@ extern "C"
     _declspec(dllexport) extern const char8_t* D3D12SDKPath = u8".\\D3D12\\";
 }
 
+namespace
+{
+    // Relative output paths are placed under outDir, which is created when needed
+    const char* InOutputDir(const char* outDir, const char* path, Support::MemoryArena& arena)
+    {
+        if (!outDir || !path || path[0] == '\\' || path[0] == '/' || (path[0] && path[1] == ':'))
+            return path;
+
+        App::Filesystem::CreateDirectoryIfNotExists(outDir);
+
+        const size_t dirLen = strlen(outDir);
+        const size_t pathLen = strlen(path);
+        char* joined = reinterpret_cast<char*>(arena.AllocateAligned(dirLen + pathLen + 2, alignof(char)));
+        memcpy(joined, outDir, dirLen);
+        joined[dirLen] = '\\';
+        memcpy(joined + dirLen + 1, path, pathLen + 1);
+
+        return joined;
+    }
+
+    // Headless options follow the scene path(s), e.g.
+    // --headless out.exr --spp 4096 --target-error 0.01 --res 1920x1080 --camera 0,1,-4,0,1,0 --fov 60
+    //   --tile 1024 --apron 32 --gpu 1 --stream 1 --denoise-every 64 --denoise-threshold 0.005 
+    //   --out-dir renders
+    //
+    // One sample per pixel is taken every frame, so --frames is the same as --spp.
+    void ParseHeadlessOptions(char* options, App::HeadlessDesc& desc, const char*& outDir)
+    {
+        char* context = nullptr;
+        char* token = strtok_s(options, " \t", &context);
+
+        while (token)
+        {
+            char* val = strtok_s(nullptr, " \t", &context);
+            Check(val, "Missing value for option %s\n", token);
+
+            if (strcmp(token, "--headless") == 0)
+                desc.OutputPath = val;
+            else if (strcmp(token, "--spp") == 0 || strcmp(token, "--frames") == 0)
+                desc.NumSamples = (uint32_t)strtoul(val, nullptr, 10);
+            else if (strcmp(token, "--target-error") == 0)
+                desc.TargetRelError = strtof(val, nullptr);
+            else if (strcmp(token, "--fov") == 0)
+                desc.FovDegrees = strtof(val, nullptr);
+            else if (strcmp(token, "--tile") == 0)
+            {
+                const unsigned long n = strtoul(val, nullptr, 10);
+                Check(n <= UINT16_MAX, "Invalid tile size: %s\n", val);
+                desc.TileSize = (uint16_t)n;
+            }
+            else if (strcmp(token, "--apron") == 0)
+            {
+                const unsigned long n = strtoul(val, nullptr, 10);
+                Check(n <= UINT16_MAX, "Invalid tile apron: %s\n", val);
+                desc.TileApron = (uint16_t)n;
+            }
+            else if (strcmp(token, "--res") == 0)
+            {
+                unsigned int w, h;
+                Check(sscanf_s(val, "%ux%u", &w, &h) == 2 && w <= UINT16_MAX && h <= UINT16_MAX, 
+                    "Invalid resolution: %s\n", val);
+                desc.Width = (uint16_t)w;
+                desc.Height = (uint16_t)h;
+            }
+            else if (strcmp(token, "--gpu") == 0)
+                desc.AdapterIndex = (int)strtol(val, nullptr, 10);
+            else if (strcmp(token, "--stream") == 0)
+                desc.SampleStream = (uint32_t)strtoul(val, nullptr, 10);
+            else if (strcmp(token, "--denoise-every") == 0)
+                desc.DenoiseCheckpoint = (uint32_t)strtoul(val, nullptr, 10);
+            else if (strcmp(token, "--denoise-threshold") == 0)
+                desc.DenoiseThreshold = strtof(val, nullptr);
+            else if (strcmp(token, "--out-dir") == 0)
+                outDir = val;
+            else if (strcmp(token, "--camera") == 0)
+            {
+                float* p = desc.CameraPos;
+                float* t = desc.CameraLookAt;
+                Check(sscanf_s(val, "%f,%f,%f,%f,%f,%f", &p[0], &p[1], &p[2], &t[0], &t[1], &t[2]) == 6,
+                    "Camera is expected as <pos_x>,<pos_y>,<pos_z>,<lookat_x>,<lookat_y>,<lookat_z>: %s\n", val);
+                desc.HasCamera = true;
+            }
+            else
+                Check(false, "Unknown option: %s\n", token);
+
+            token = strtok_s(nullptr, " \t", &context);
+        }
+
+        Check(desc.OutputPath, "Headless options require --headless <output.exr|output.png>\n");
+        Check(desc.SampleStream < 256, "Sample stream must be less than 256.\n");
+    }
+
+    // Benchmark options follow the scene path(s), e.g.
+    // --benchmark path.txt --benchmark-out results.json --integrator restir_gi --warmup 120 
+    //   --timestep 0.0166 --seed 0 --res 1920x1080 --preset medium --frames 600 --out-dir results
+    //
+    // Adding --baseline previous.json [--tolerance 5] compares against an earlier run, exit 
+    // code is non-zero when there were any regressions.
+    // 
+    // or for a single render pass (camera path is optional):
+    // --bench-pass DirectLighting --pass-reps 256 --sweep "Renderer/Light Sampling/Light BVH=0,1"
+    void ParseBenchmarkOptions(char* options, App::BenchmarkDesc& desc, const char*& outDir)
+    {
+        char* context = nullptr;
+        char* token = strtok_s(options, " \t", &context);
+
+        while (token)
+        {
+            char* val = strtok_s(nullptr, " \t", &context);
+            Check(val, "Missing value for option %s\n", token);
+
+            // Values with spaces (e.g. parameter names) can be quoted
+            if (*val == '"')
+            {
+                val++;
+                char* tokenEnd = val + strlen(val);
+                char* close = strchr(val, '"');
+
+                // Value was cut short at the first space
+                if (!close && context > tokenEnd)
+                {
+                    *tokenEnd = ' ';
+                    close = strchr(val, '"');
+                }
+
+                Check(close, "Unterminated quote in value of option %s\n", token);
+                *close = '\0';
+                context = close + 1;
+            }
+
+            if (strcmp(token, "--benchmark") == 0)
+                desc.CameraPath = val;
+            else if (strcmp(token, "--benchmark-out") == 0)
+                desc.OutputPath = val;
+            else if (strcmp(token, "--integrator") == 0)
+                desc.Integrator = val;
+            else if (strcmp(token, "--preset") == 0)
+                desc.Preset = val;
+            else if (strcmp(token, "--frames") == 0)
+                desc.NumFrames = (uint32_t)strtoul(val, nullptr, 10);
+            else if (strcmp(token, "--out-dir") == 0)
+                outDir = val;
+            else if (strcmp(token, "--warmup") == 0)
+                desc.NumWarmupFrames = (uint32_t)strtoul(val, nullptr, 10);
+            else if (strcmp(token, "--timestep") == 0)
+                desc.Timestep = strtof(val, nullptr);
+            else if (strcmp(token, "--seed") == 0)
+                desc.Seed = (uint32_t)strtoul(val, nullptr, 10);
+            else if (strcmp(token, "--res") == 0)
+            {
+                unsigned int w, h;
+                Check(sscanf_s(val, "%ux%u", &w, &h) == 2 && w <= UINT16_MAX && h <= UINT16_MAX, 
+                    "Invalid resolution: %s\n", val);
+                desc.Width = (uint16_t)w;
+                desc.Height = (uint16_t)h;
+            }
+            else if (strcmp(token, "--bench-pass") == 0)
+                desc.Pass = val;
+            else if (strcmp(token, "--pass-reps") == 0)
+                desc.NumPassReps = (uint32_t)strtoul(val, nullptr, 10);
+            else if (strcmp(token, "--sweep") == 0)
+                desc.Sweep = val;
+            else if (strcmp(token, "--baseline") == 0)
+                desc.BaselinePath = val;
+            else if (strcmp(token, "--tolerance") == 0)
+                desc.TolerancePct = strtof(val, nullptr);
+            else
+                Check(false, "Unknown option: %s\n", token);
+
+            token = strtok_s(nullptr, " \t", &context);
+        }
+
+        Check(desc.CameraPath || desc.Pass, "Benchmark options require --benchmark <camera-path.txt> "
+            "or --bench-pass <render-node>\n");
+        Check(!desc.CameraPath || App::Filesystem::Exists(desc.CameraPath), "Camera path was not found: %s\n", 
+            desc.CameraPath);
+        Check(!desc.Sweep || desc.Pass, "--sweep requires --bench-pass\n");
+        Check(!desc.BaselinePath || App::Filesystem::Exists(desc.BaselinePath), "Baseline was not found: %s\n",
+            desc.BaselinePath);
+        Check(!desc.BaselinePath || !desc.Pass, "--baseline can't be combined with --bench-pass\n");
+        Check(desc.TolerancePct >= 0.0f, "Invalid tolerance.\n");
+        Check(!desc.Pass || desc.NumPassReps > 0, "Invalid number of pass replays.\n");
+        Check(desc.Seed < 256, "Seed must be less than 256.\n");
+    }
+
+    // Averages renders of the same image, e.g. one per GPU with a different sample stream 
+    // each: --merge out.exr part0.exr part1.exr ...
+    void MergeRenders(char* args)
+    {
+        char* context = nullptr;
+        const char* outPath = strtok_s(args, " \t", &context);
+        Check(outPath, "Usage: ZetaLab --merge <output.exr> <input.exr> [<input.exr>...]\n");
+
+        Util::SmallVector<const char*> inPaths;
+        while (const char* path = strtok_s(nullptr, " \t", &context))
+            inPaths.push_back(path);
+
+        RenderPass::EXR::Merge(outPath, inPaths);
+        printf("Merged %u images into %s\n", (uint32_t)inPaths.size(), outPath);
+
+    // Scene path(s) followed by the options, as on the command line
+    struct Job
+    {
+        char* Scenes = nullptr;
+        App::HeadlessDesc Headless;
+        App::BenchmarkDesc Benchmark;
+        const char* InputReplay = nullptr;
+        bool IsHeadless = false;
+        bool IsBenchmark = false;
+    };
+
+    // Paths may contain spaces, so options are only recognized after the first " --". 
+    // Output paths are placed under outDir unless the job has its own --out-dir.
+    void ParseJob(char* cmdLine, const char* outDir, Support::MemoryArena& arena, Job& job)
+    {
+        job.Scenes = cmdLine;
+        char* options = strstr(cmdLine, " --");
+        if (!options)
+            return;
+
+        // Terminate the path list, trimming trailing whitespace
+        char* end = options;
+        while (end > cmdLine && (end[-1] == ' ' || end[-1] == '\t'))
+            end--;
+        *end = '\0';
+
+        // Rest of the line is the path to the input recording
+        if (strncmp(options + 1, "--replay ", 9) == 0)
+        {
+            const char* inputReplay = options + 10;
+            while (*inputReplay == ' ')
+                inputReplay++;
+
+            Check(*inputReplay, "Usage: --replay <input-recording.bin>");
+            Check(App::Filesystem::Exists(inputReplay), "Provided path was not found: %s\nExiting...\n", 
+                inputReplay);
+            job.InputReplay = inputReplay;
+        }
+        // Camera-path playback (or pass replays) in a window, measured rather than accumulated
+        else if (strstr(options + 1, "--benchmark ") || strstr(options + 1, "--bench-pass "))
+        {
+            ParseBenchmarkOptions(options + 1, job.Benchmark, outDir);
+            job.Benchmark.OutputPath = InOutputDir(outDir, job.Benchmark.OutputPath, arena);
+            job.IsBenchmark = true;
+        }
+        else
+        {
+            ParseHeadlessOptions(options + 1, job.Headless, outDir);
+            job.Headless.OutputPath = InOutputDir(outDir, job.Headless.OutputPath, arena);
+            job.IsHeadless = true;
+        }
+    }
+
+    // Batch files list one job per line, in the same format as the command line -- scene 
+    // path(s) followed by headless or benchmark options. Empty lines and lines that start 
+    // with '#' are skipped.
+    void ParseBatch(char* text, const char* outDir, Support::MemoryArena& arena, 
+        Util::SmallVector<Job>& jobs)
+    {
+        char* context = nullptr;
+        char* line = strtok_s(text, "\r\n", &context);
+
+        while (line)
+        {
+            while (*line == ' ' || *line == '\t')
+                line++;
+
+            if (*line != '\0' && *line != '#')
+            {
+                jobs.push_back(Job{});
+                Job& job = jobs.back();
+                ParseJob(line, outDir, arena, job);
+
+                Check(job.IsHeadless || job.IsBenchmark, "Batch job %u requires headless or benchmark "
+                    "options.\n", (uint32_t)jobs.size());
+            }
+
+            line = strtok_s(nullptr, "\r\n", &context);
+        }
+    }
+
+    // Consecutive headless renders of the same scene that only differ in camera, number of 
+    // samples and output path (see App::QueueHeadlessJob()) can run in the same process
+    bool CanShareProcess(const Job& a, const Job& b)
+    {
+        const App::HeadlessDesc& ha = a.Headless;
+        const App::HeadlessDesc& hb = b.Headless;
+
+        return a.IsHeadless && b.IsHeadless && strcmp(a.Scenes, b.Scenes) == 0 &&
+            !ha.IsTiled() && !hb.IsTiled() && ha.Width == hb.Width && ha.Height == hb.Height &&
+            ha.FovDegrees == hb.FovDegrees && ha.TargetRelError == hb.TargetRelError &&
+            ha.AdapterIndex == hb.AdapterIndex && ha.SampleStream == hb.SampleStream &&
+            ha.DenoiseCheckpoint == hb.DenoiseCheckpoint && ha.DenoiseThreshold == hb.DenoiseThreshold;
+    }
+
+    // Runs the jobs one process at a time, where every process runs the longest sequence 
+    // of jobs that can share it. Device, PSO library and scene are then only created once 
+    // per sequence. Returns the number of processes that failed.
+    int RunBatch(const char* batchPath, const char* outDir, Util::Span<Job> jobs)
+    {
+        char exePath[MAX_PATH];
+        CheckWin32(GetModuleFileNameA(nullptr, exePath, MAX_PATH));
+
+        int numFailed = 0;
+        size_t first = 0;
+
+        while (first < jobs.size())
+        {
+            size_t last = first;
+            while (last + 1 < jobs.size() && CanShareProcess(jobs[first], jobs[last + 1]))
+                last++;
+
+            char cmdLine[3 * MAX_PATH];
+            snprintf(cmdLine, sizeof(cmdLine), "\"%s\" --batch %s --jobs %zu-%zu%s%s", exePath, 
+                batchPath, first, last, outDir ? " --out-dir " : "", outDir ? outDir : "");
+
+            STARTUPINFOA si = {};
+            si.cb = sizeof(si);
+            PROCESS_INFORMATION pi;
+            CheckWin32(CreateProcessA(exePath, cmdLine, nullptr, nullptr, FALSE, 0, nullptr, 
+                nullptr, &si, &pi));
+
+            WaitForSingleObject(pi.hProcess, INFINITE);
+            DWORD exitCode = 1;
+            GetExitCodeProcess(pi.hProcess, &exitCode);
+            CloseHandle(pi.hThread);
+            CloseHandle(pi.hProcess);
+
+            printf("Batch: job(s) %zu-%zu of %zu %s (exit code: %lu)\n", first + 1, last + 1, 
+                jobs.size(), exitCode == 0 ? "done" : "failed", exitCode);
+
+            numFailed += exitCode != 0;
+            first = last + 1;
+        }
+
+        return numFailed;
+    }
+}
+
 int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ PSTR lpCmdLine, _In_ int nCmdShow)
 {
 #if OPEN_CONSOLE == 1
@@ -40,35 +381,147 @@ int WINAPI WinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _
     freopen_s(&fp, "CONOUT$", "w", stdout);
 #endif
 
-    Check(strlen(lpCmdLine), "Usage: ZetaLab <path-to-gltf>\n");
+    Check(strlen(lpCmdLine), "Usage: ZetaLab <path-to-gltf>[;<path-to-gltf>...] [--headless <output.exr|output.png> "
+        "[--spp|--frames <N>] [--target-error <e>] [--res <W>x<H>] [--camera <pos>,<lookat>] [--fov <degrees>] "
+        "[--tile <N> [--apron <N>]] [--gpu <idx>] [--stream <idx>] [--out-dir <dir>]] "
+        "[--benchmark <camera-path.txt> [--benchmark-out <results.json>] "
+        "[--integrator <path_tracing|restir_gi|restir_pt|probe_volume>] [--preset <low|medium|high>] [--warmup <N>] "
+        "[--frames <N>] [--timestep <s>] [--seed <N>] [--res <W>x<H>] [--out-dir <dir>] "
+        "[--baseline <results.json> [--tolerance <percent>]]] "
+        "[--bench-pass <render-node> [--pass-reps <N>] [--sweep \"<group>/<subgroup>/<param>=<v0>,<v1>,...\"] "
+        "[--benchmark <camera-path.txt>] [--benchmark-out <results.json>] [--warmup <N>] [--res <W>x<H>]] "
+        "[--replay <input-recording.bin>]\n"
+        "       ZetaLab --batch <jobs.txt> [--out-dir <dir>]\n");
 
+    if (strncmp(lpCmdLine, "--merge", 7) == 0)
     {
-        App::Filesystem::Path path(lpCmdLine);
-        Check(App::Filesystem::Exists(path.Get()), "Provided path was not found: %s\nExiting...\n", lpCmdLine);
+#if OPEN_CONSOLE == 0
+        if (AttachConsole(ATTACH_PARENT_PROCESS))
+        {
+            FILE* fp;
+            freopen_s(&fp, "CONOUT$", "w", stdout);
+        }
+#endif
+        MergeRenders(lpCmdLine + 7);
+        return 0;
+    }
 
-        App::DeltaTimer timer;
-        timer.Start();
+    // Strings that jobs refer to
+    Support::MemoryArena arena;
+    Util::SmallVector<uint8_t> batchFile;
+    Util::SmallVector<Job> batchJobs;
+    Job job;
+    // Headless jobs that run after the first one in this process
+    Util::Span<Job> queuedJobs(nullptr, 0);
 
-        auto rndIntrf = DefaultRenderer::InitAndGetInterface();
-        App::Init(rndIntrf);
+    // --batch <jobs.txt> [--out-dir <dir>], paths can't contain spaces. Every process that 
+    // runs the jobs gets the same arguments along with --jobs <first>-<last>.
+    if (strncmp(lpCmdLine, "--batch ", 8) == 0)
+    {
+#if OPEN_CONSOLE == 0
+        if (AttachConsole(ATTACH_PARENT_PROCESS))
+        {
+            FILE* fp;
+            freopen_s(&fp, "CONOUT$", "w", stdout);
+        }
+#endif
+        char* context = nullptr;
+        const char* batchPath = strtok_s(lpCmdLine + 8, " \t", &context);
+        const char* outDir = nullptr;
+        size_t firstJob = 0;
+        size_t lastJob = 0;
+        bool runJobs = false;
 
-        timer.End();
+        while (const char* token = strtok_s(nullptr, " \t", &context))
+        {
+            const char* val = strtok_s(nullptr, " \t", &context);
+            Check(val, "Missing value for option %s\n", token);
 
-        LOG_UI(INFO, "App initialization completed in %u[ms]\n", (uint32_t)timer.DeltaMilli());
+            if (strcmp(token, "--out-dir") == 0)
+                outDir = val;
+            else if (strcmp(token, "--jobs") == 0)
+            {
+                Check(sscanf_s(val, "%zu-%zu", &firstJob, &lastJob) == 2 && firstJob <= lastJob,
+                    "Invalid job range: %s\n", val);
+                runJobs = true;
+            }
+            else
+                Check(false, "Unknown option: %s\n", token);
+        }
 
-        // load the gltf model(s)
+        Check(batchPath && App::Filesystem::Exists(batchPath), "Batch file was not found: %s\n", 
+            batchPath ? batchPath : "");
+
+        App::Filesystem::LoadFromFile(batchPath, batchFile);
+        batchFile.push_back('\0');
+        ParseBatch(reinterpret_cast<char*>(batchFile.data()), outDir, arena, batchJobs);
+        Check(!batchJobs.empty(), "%s: no jobs were found.\n", batchPath);
+
+        if (!runJobs)
+        {
+            const int numFailed = RunBatch(batchPath, outDir, batchJobs);
+            printf("Batch: %zu job(s), %d process(es) failed\n", batchJobs.size(), numFailed);
+
+            return numFailed ? 1 : 0;
+        }
+
+        Check(lastJob < batchJobs.size(), "Invalid job range: %zu-%zu\n", firstJob, lastJob);
+        job = batchJobs[firstJob];
+        queuedJobs = Util::Span<Job>(batchJobs.data() + firstJob + 1, lastJob - firstJob);
+    }
+    else
+        ParseJob(lpCmdLine, nullptr, arena, job);
+
+#if OPEN_CONSOLE == 0
+    // Print the logs to the console that launched us, if any
+    if ((job.IsHeadless || job.IsBenchmark || job.InputReplay) && AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+        FILE* fp;
+        freopen_s(&fp, "CONOUT$", "w", stdout);
+    }
+#endif
+
+    {
+        // Multiple glTF files are separated by ';'
+        Util::SmallVector<Util::StrView> paths;
+        char* curr = job.Scenes;
+
+        while (*curr)
+        {
+            char* next = strchr(curr, ';');
+            if (next)
+                *next = '\0';
+
+            if (*curr)
+            {
+                Check(App::Filesystem::Exists(curr), "Provided path was not found: %s\nExiting...\n", curr);
+                paths.push_back(Util::StrView(curr));
+            }
+
+            if (!next)
+                break;
+
+            curr = next + 1;
+        }
+
+        App::DeltaTimer timer;
         timer.Start();
 
-        glTF::Load(path);
+        auto rndIntrf = DefaultRenderer::InitAndGetInterface();
+        App::Init(rndIntrf, nullptr, job.IsHeadless ? &job.Headless : nullptr, 
+            job.IsBenchmark ? &job.Benchmark : nullptr, job.InputReplay);
 
-        App::FlushWorkerThreadPool();
+        for (size_t i = 0; i < queuedJobs.size(); i++)
+            App::QueueHeadlessJob(queuedJobs[i].Headless);
 
         timer.End();
 
-        LOG_UI(INFO, "glTF scene loaded in %u[ms]\n", (uint32_t)timer.DeltaMilli());
-    }
+        LOG_UI(INFO, "App initialization completed in %u[ms]\n", (uint32_t)timer.DeltaMilli());
 
-    App::Run();
+        // load the gltf model(s) in the background, rendering starts right away. In headless
+        // mode, there's nothing to show in the meantime.
+        glTF::Load(paths, !job.IsHeadless);
+    }
 
-    return 0;
-}
\ No newline at end of file
+    return App::Run();
+}
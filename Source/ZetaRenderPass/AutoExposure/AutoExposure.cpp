@@ -43,10 +43,8 @@ void AutoExposure::InitPSOs()
 
     RenderPassBase::InitRenderPass("AutoExposure", flags);
 
-    m_psoLib.CompileComputePSO((int)SHADER::HISTOGRAM, m_rootSigObj.Get(),
-        COMPILED_CS[(int)SHADER::HISTOGRAM]);
-    m_psoLib.CompileComputePSO((int)SHADER::WEIGHTED_AVG, m_rootSigObj.Get(),
-        COMPILED_CS[(int)SHADER::WEIGHTED_AVG]);
+    // Wave-size specialization that matches the device is picked when the PSOs are created
+    // on first use
 }
 
 void AutoExposure::Init()
@@ -59,6 +57,7 @@ void AutoExposure::Init()
     m_cbHist.AdaptationRate = DefaultParamVals::AdaptationRate;
     m_cbHist.LowerPercentile = DefaultParamVals::LowerPercentile;
     m_cbHist.UpperPercentile = DefaultParamVals::UpperPercentile;
+    m_cbHist.Downsample = DefaultParamVals::Downsample;
 
     ParamVariant p1;
     p1.InitFloat(ICON_FA_FILM " Renderer", "Auto Exposure", "Min Lum", fastdelegate::MakeDelegate(this, &AutoExposure::MinLumCallback),
@@ -85,6 +84,16 @@ void AutoExposure::Init()
         DefaultParamVals::LumMapExp, 1e-1f, 1.0f, 1e-2f);
     App::AddParam(p3);
 
+    ParamVariant p4;
+    p4.InitBool(ICON_FA_FILM " Renderer", "Auto Exposure", "Single Pass", fastdelegate::MakeDelegate(this, &AutoExposure::SinglePassCallback),
+        DefaultParamVals::SinglePass);
+    App::AddParam(p4);
+
+    ParamVariant p7;
+    p7.InitBool(ICON_FA_FILM " Renderer", "Auto Exposure", "Downsample (Single Pass)", fastdelegate::MakeDelegate(this, &AutoExposure::DownsampleCallback),
+        DefaultParamVals::Downsample);
+    App::AddParam(p7);
+
     m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
     CreateResources();
 
@@ -114,24 +123,40 @@ void AutoExposure::Render(CommandList& cmdList)
     m_cbHist.InputDescHeapIdx = m_inputDesc[(int)SHADER_IN_DESC::COMPOSITED];
     m_cbHist.ExposureDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((uint32_t)DESC_TABLE::EXPOSURE_UAV);
 
+    // Downsampling only applies to the single-pass shader
+    const bool downsample = m_singlePass && m_cbHist.Downsample;
+    const uint32_t inputW = downsample ? CeilUnsignedIntDiv(w, 2u) : w;
+    const uint32_t inputH = downsample ? CeilUnsignedIntDiv(h, 2u) : h;
+    const uint32_t dispatchDimX = CeilUnsignedIntDiv(inputW, THREAD_GROUP_SIZE_HIST_X);
+    const uint32_t dispatchDimY = CeilUnsignedIntDiv(inputH, THREAD_GROUP_SIZE_HIST_Y);
+    m_cbHist.NumGroups = dispatchDimX * dispatchDimY;
+
     m_rootSig.SetRootUAV(2, m_hist.GpuVA());
     m_rootSig.SetRootConstants(0, sizeof(cbAutoExposureHist) / sizeof(DWORD), &m_cbHist);
     m_rootSig.End(computeCmdList);
 
-    const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, THREAD_GROUP_SIZE_HIST_X);
-    const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, THREAD_GROUP_SIZE_HIST_Y);
-
+    // Reset the histogram along with the group counter
     computeCmdList.ResourceBarrier(m_hist.Resource(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
-    computeCmdList.CopyBufferRegion(m_hist.Resource(), 0, m_zeroBuffer.Resource(), 0, HIST_BIN_COUNT * sizeof(uint32_t));
-    computeCmdList.ResourceBarrier(m_hist.Resource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    computeCmdList.CopyBufferRegion(m_hist.Resource(), 0, m_zeroBuffer.Resource(), 0, HIST_BUFFER_SIZE);
+    computeCmdList.DeferBarrier(m_hist.Resource(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    if (m_singlePass)
+    {
+        computeCmdList.SetPipelineState(GetPermutation(SHADER::SINGLE_PASS, SINGLE_PASS_PERMUTATIONS));
+        computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+
+        gpuTimer.EndQuery(computeCmdList, queryIdx);
+        computeCmdList.PIXEndEvent();
+
+        return;
+    }
 
-    computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::HISTOGRAM));
+    computeCmdList.SetPipelineState(GetPermutation(SHADER::HISTOGRAM, HISTOGRAM_PERMUTATIONS));
     computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 
-    auto uavBarrier = Direct3DUtil::UAVBarrier(m_hist.Resource());
-    computeCmdList.UAVBarrier(1, &uavBarrier);
+    computeCmdList.DeferUAVBarrier(m_hist.Resource());
 
-    computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::WEIGHTED_AVG));
+    computeCmdList.SetPipelineState(GetPermutation(SHADER::WEIGHTED_AVG, WEIGHTED_AVG_PERMUTATIONS));
     computeCmdList.Dispatch(1, 1, 1);
 
     gpuTimer.EndQuery(computeCmdList, queryIdx);
@@ -143,7 +168,7 @@ void AutoExposure::CreateResources()
     auto& renderer = App::GetRenderer();
 
     m_hist = GpuMemory::GetDefaultHeapBuffer("LogLumHistogram",
-        HIST_BIN_COUNT * sizeof(uint32_t),
+        HIST_BUFFER_SIZE,
         D3D12_RESOURCE_STATE_COMMON,
         true);
 
@@ -156,7 +181,7 @@ void AutoExposure::CreateResources()
 
     // create a zero-initialized buffer for resetting the counter
     m_zeroBuffer = GpuMemory::GetDefaultHeapBuffer("Zero",
-        HIST_BIN_COUNT * sizeof(uint32_t),
+        HIST_BUFFER_SIZE,
         D3D12_RESOURCE_STATE_COMMON,
         false,
         true);
@@ -189,8 +214,19 @@ void AutoExposure::UpperPercentileCallback(const Support::ParamVariant& p)
     m_cbHist.UpperPercentile = p.GetFloat().m_value;
 }
 
+void AutoExposure::SinglePassCallback(const Support::ParamVariant& p)
+{
+    m_singlePass = p.GetBool();
+}
+
+void AutoExposure::DownsampleCallback(const Support::ParamVariant& p)
+{
+    m_cbHist.Downsample = p.GetBool();
+}
+
 void AutoExposure::Reload()
 {
-    const int i = (int)SHADER::WEIGHTED_AVG;
-    m_psoLib.Reload(i, m_rootSigObj.Get(), "AutoExposure\\AutoExposure_WeightedAvg.hlsl");
+    m_psoLib.ReloadPermutations((int)SHADER::HISTOGRAM, m_rootSigObj.Get(), HISTOGRAM_PERMUTATIONS);
+    m_psoLib.ReloadPermutations((int)SHADER::WEIGHTED_AVG, m_rootSigObj.Get(), WEIGHTED_AVG_PERMUTATIONS);
+    m_psoLib.ReloadPermutations((int)SHADER::SINGLE_PASS, m_rootSigObj.Get(), SINGLE_PASS_PERMUTATIONS);
 }
@@ -11,11 +11,14 @@ namespace ZetaRay::Core
 
 namespace ZetaRay::RenderPass
 {
+    // Every shader is specialized for wave size and takes up two consecutive slots, see 
+    // AutoExposure::*_PERMUTATIONS
     enum class AUTO_EXPOSURE_SHADER
     {
         HISTOGRAM,
-        WEIGHTED_AVG,
-        COUNT
+        WEIGHTED_AVG = HISTOGRAM + 2,
+        SINGLE_PASS = WEIGHTED_AVG + 2,
+        COUNT = SINGLE_PASS + 2
     };
 
     struct AutoExposure final : public RenderPassBase<(int)AUTO_EXPOSURE_SHADER::COUNT>
@@ -64,11 +67,35 @@ namespace ZetaRay::RenderPass
             COUNT
         };
 
-        inline static constexpr const char* COMPILED_CS[(int)SHADER::COUNT] =
-        {
-            "AutoExposure_Histogram_cs.cso",
-            "AutoExposure_WeightedAvg_cs.cso"
-        };
+        // Wave64 specializations are precompiled (see ShaderPermutations.txt)
+        static constexpr Core::ShaderPermutationDesc HISTOGRAM_PERMUTATIONS = {
+            .PathToHlsl = "AutoExposure\\AutoExposure_Histogram.hlsl",
+            .Defines = { "WAVE_SIZE=64" },
+            .Suffixes = { "W64" },
+            .NumDefines = 1,
+            .Wave64DefineIdx = 0 };
+        static constexpr Core::ShaderPermutationDesc WEIGHTED_AVG_PERMUTATIONS = {
+            .PathToHlsl = "AutoExposure\\AutoExposure_WeightedAvg.hlsl",
+            .Defines = { "WAVE_SIZE=64" },
+            .Suffixes = { "W64" },
+            .NumDefines = 1,
+            .Wave64DefineIdx = 0 };
+        static constexpr Core::ShaderPermutationDesc SINGLE_PASS_PERMUTATIONS = {
+            .PathToHlsl = "AutoExposure\\AutoExposure_SinglePass.hlsl",
+            .Defines = { "WAVE_SIZE=64" },
+            .Suffixes = { "W64" },
+            .NumDefines = 1,
+            .Wave64DefineIdx = 0 };
+
+        static_assert((int)SHADER::WEIGHTED_AVG - (int)SHADER::HISTOGRAM == 
+            HISTOGRAM_PERMUTATIONS.NumPermutations(), "PSO slots don't match the number of permutations.");
+        static_assert((int)SHADER::SINGLE_PASS - (int)SHADER::WEIGHTED_AVG == 
+            WEIGHTED_AVG_PERMUTATIONS.NumPermutations(), "PSO slots don't match the number of permutations.");
+        static_assert((int)SHADER::COUNT - (int)SHADER::SINGLE_PASS == 
+            SINGLE_PASS_PERMUTATIONS.NumPermutations(), "PSO slots don't match the number of permutations.");
+
+        // Bins followed by the group counter of the single-pass shader
+        static constexpr uint32_t HIST_BUFFER_SIZE = (HIST_BIN_COUNT + 1) * sizeof(uint32_t);
 
         struct DefaultParamVals
         {
@@ -78,6 +105,8 @@ namespace ZetaRay::RenderPass
             static constexpr float AdaptationRate = 1.0f;
             static constexpr float LowerPercentile = 0.01f;
             static constexpr float UpperPercentile = 0.9f;
+            static constexpr bool SinglePass = false;
+            static constexpr bool Downsample = false;
         };
 
         void CreateResources();
@@ -86,7 +115,14 @@ namespace ZetaRay::RenderPass
         void LumMapExpCallback(const Support::ParamVariant& p);
         void LowerPercentileCallback(const Support::ParamVariant& p);
         void UpperPercentileCallback(const Support::ParamVariant& p);
+        void SinglePassCallback(const Support::ParamVariant& p);
+        void DownsampleCallback(const Support::ParamVariant& p);
         void Reload();
+        ZetaInline ID3D12PipelineState* GetPermutation(SHADER base, 
+            const Core::ShaderPermutationDesc& desc)
+        {
+            return m_psoLib.GetPermutation((uint32_t)base, 0, m_rootSigObj.Get(), desc);
+        }
 
         Core::GpuMemory::Texture m_exposure;
         Core::GpuMemory::Buffer m_counter;
@@ -96,6 +132,8 @@ namespace ZetaRay::RenderPass
         Core::DescriptorTable m_descTable;
         float m_minLum;
         float m_maxLum;
+        // Histogram and exposure in one dispatch
+        bool m_singlePass = DefaultParamVals::SinglePass;
         cbAutoExposureHist m_cbHist;
     };
 }
\ No newline at end of file
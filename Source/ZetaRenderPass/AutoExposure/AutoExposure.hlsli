@@ -0,0 +1,146 @@
+#ifndef AUTO_EXPOSURE_HLSLI
+#define AUTO_EXPOSURE_HLSLI
+
+#include "AutoExposure_Common.h"
+#include "../Common/Math.hlsli"
+
+#define SKIP_OUTSIDE_PERCENTILE_RANGE 0
+
+// Compiled for both 32- and 64-wide waves, see AutoExposure::*_PERMUTATIONS
+#ifndef WAVE_SIZE
+#define WAVE_SIZE 32
+#endif
+
+static const int NumWavesInGroup = HIST_BIN_COUNT / WAVE_SIZE;
+
+groupshared uint g_binSize[HIST_BIN_COUNT];
+groupshared float g_waveSum[NumWavesInGroup];
+
+#if SKIP_OUTSIDE_PERCENTILE_RANGE == 1
+groupshared uint g_waveSampleCount[NumWavesInGroup];
+#endif
+
+// Following functions assume that thread group has exactly HIST_BIN_COUNT threads, so 
+// that there's one thread per bin
+namespace AutoExposure
+{
+    uint LumToBin(float lum, ConstantBuffer<cbAutoExposureHist> g_local)
+    {
+        if (lum <= 1e-4f)
+            return 0;
+
+        float t = saturate((lum - g_local.MinLum) / g_local.LumRange);
+        t = pow(t, g_local.LumMapExp);
+        uint bin = (uint) (t * (HIST_BIN_COUNT - 2)) + 1;
+
+        return bin;
+    }
+
+    // Builds the group's histogram in g_binSize. bin is UINT32_MAX for threads that should 
+    // be skipped. Has to be called by every thread in the group.
+    void GroupHistogram(uint bin, uint Gidx)
+    {
+        g_binSize[Gidx] = 0;
+
+        GroupMemoryBarrierWithGroupSync();
+
+        const uint4 waveBinMask = WaveMatch(bin);
+        //const uint binSizeInWave = WaveMultiPrefixCountBits(true, waveBinMask);
+        const uint binSizeInWave = dot(1, countbits(waveBinMask));
+
+        // Add number of preceding bits (multiples of 32 bits). When mask is zero, firstbitlow 
+        // returns -1 and the following logical or doesn't change it (x | -1 = -1).
+        const uint4 firstSetLanes = firstbitlow(waveBinMask) | uint4(0x0, 0x20, 0x40, 0x60);
+        // min between uint(-1) and anything else returns the latter
+        const uint writerLane = min(min(min(firstSetLanes.x, firstSetLanes.y), firstSetLanes.z), firstSetLanes.w);
+
+        // Make sure threads outside the screen are skipped
+        if (writerLane == WaveGetLaneIndex() && bin != UINT32_MAX)
+            InterlockedAdd(g_binSize[bin], binSizeInWave);
+
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    // Average of the histogram in the [0, 1] mapped space. Every thread passes in the size 
+    // of its bin. Has to be called by every thread in the group.
+    float HistogramMean(uint binSize, uint Gidx, uint numSamples, 
+        ConstantBuffer<cbAutoExposureHist> g_local)
+    {
+        // Exclude the first (invalid) bin
+        const bool isFirstBin = (Gidx == 0);
+        binSize = isFirstBin ? 0 : binSize;
+        const uint wave = Gidx / WAVE_SIZE;
+
+        // Prefix sum for the whole group to calculate the percentiles up to each bin
+#if SKIP_OUTSIDE_PERCENTILE_RANGE == 1
+        uint binPercentile = WavePrefixSum(binSize) + binSize;
+
+        if (WaveGetLaneIndex() == WAVE_SIZE - 1)
+            g_waveSampleCount[wave] = binPercentile;
+#endif
+
+        GroupMemoryBarrierWithGroupSync();
+
+        // Add in the samples from previous waves
+#if SKIP_OUTSIDE_PERCENTILE_RANGE == 1
+        for (int w = 0; w < wave; w++)
+            binPercentile += g_waveSampleCount[w];
+
+        const uint lowerPercentileNumSamples = (uint)(numSamples * g_local.LowerPercentile);
+        const uint upperPercentileNumSamples = (uint)(numSamples * g_local.UpperPercentile);
+
+        // Exclude bins that don't fall in the intended range
+        bool skip = (binPercentile < lowerPercentileNumSamples) || (binPercentile > upperPercentileNumSamples);
+        skip = skip || isFirstBin;
+#else
+        bool skip = isFirstBin;
+#endif
+
+        // Skipped bins don't contribute to average
+        float val = skip ? 0 : binSize * (Gidx - 1 + 0.5f) / HIST_BIN_COUNT;
+        val = WaveActiveSum(val);
+
+        if (WaveIsFirstLane())
+            g_waveSum[wave] = val;
+
+        GroupMemoryBarrierWithGroupSync();
+
+        // Sum across the waves
+        float mean = Gidx < NumWavesInGroup ? g_waveSum[Gidx] : 0.0;
+        // There are at most 8 values to sum together, so one WaveActiveSum is enough
+        mean = WaveActiveSum(mean);
+        mean /= max(numSamples, 1);
+
+        return mean;
+    }
+
+    float ComputeAutoExposure(float avgLum)
+    {
+        const float S = 100.0f;
+        const float K = 12.5f;
+        const float EV100 = log2((avgLum * S) / K);
+        const float q = 0.65f;
+        const float luminanceMax = (78.0f / (q * S)) * pow(2.0f, EV100);
+        return 1 / luminanceMax;
+    }
+
+    // Maps histogram mean back to luminance, adapts it towards the previous frame's and 
+    // writes out the exposure
+    void WriteExposure(float mean, float dt, ConstantBuffer<cbAutoExposureHist> g_local)
+    {
+        // Do the inverse mapping
+        float result = pow(mean, 1.0 / g_local.LumMapExp);
+        result = result * g_local.LumRange + g_local.MinLum;
+
+        RWTexture2D<float2> g_out = ResourceDescriptorHeap[g_local.ExposureDescHeapIdx];
+        float prev = g_out[int2(0, 0)].y;
+
+        if (prev < 1e8f)
+            result = prev + (result - prev) * (1 - exp(-dt * 1000.0f * g_local.AdaptationRate));
+
+        float exposure = ComputeAutoExposure(result);
+        g_out[int2(0, 0)] = float2(exposure, result);
+    }
+}
+
+#endif
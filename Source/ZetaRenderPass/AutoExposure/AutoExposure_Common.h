@@ -7,6 +7,8 @@
 #define THREAD_GROUP_SIZE_HIST_Y 16u
 
 #define HIST_BIN_COUNT 256
+// Number of thread groups that have finished, stored after the bins (single-pass only)
+#define HIST_GROUP_COUNTER_OFFSET (HIST_BIN_COUNT * sizeof(uint32_t))
 
 struct cbAutoExposureHist
 {
@@ -18,6 +20,9 @@ struct cbAutoExposureHist
     float AdaptationRate;
     float LowerPercentile;
     float UpperPercentile;
+    // Single-pass only
+    uint32_t NumGroups;
+    uint32_t Downsample;
 };
 
 #endif // AUTO_EXPOSURE_H
\ No newline at end of file
@@ -1,12 +1,9 @@
 // Ref: https://alextardif.com/HistogramLuminance.html
 
-#include "AutoExposure_Common.h"
-#include "../Common/Math.hlsli"
+#include "AutoExposure.hlsli"
 #include "../Common/FrameConstants.h"
 #include "../Common/StaticTextureSamplers.hlsli"
 
-#define EPS 1e-4f
-
 //--------------------------------------------------------------------------------------
 // Root Signature
 //--------------------------------------------------------------------------------------
@@ -29,46 +26,20 @@ uint CalculateeBin(uint2 DTid)
     const float3 color = g_input[DTid].rgb;
     const float lum = Math::Luminance(color);
 
-    if (lum <= EPS)
-        return 0;
-
-    float t = saturate((lum - g_local.MinLum) / g_local.LumRange);
-    t = pow(t, g_local.LumMapExp);
-    uint bin = (uint) (t * (HIST_BIN_COUNT - 2)) + 1;
-
-    return bin;
+    return AutoExposure::LumToBin(lum, g_local);
 }
 
 //--------------------------------------------------------------------------------------
 // main
 //--------------------------------------------------------------------------------------
 
-groupshared uint g_binSize[HIST_BIN_COUNT];
-
+[WaveSize(WAVE_SIZE)]
 [numthreads(THREAD_GROUP_SIZE_HIST_X, THREAD_GROUP_SIZE_HIST_Y, 1)]
 void main(uint3 DTid : SV_DispatchThreadID, uint Gidx : SV_GroupIndex)
 {
-    g_binSize[Gidx] = 0;
-
-    GroupMemoryBarrierWithGroupSync();
-
     const uint bin = CalculateeBin(DTid.xy);
-    const uint4 waveBinMask = WaveMatch(bin);
-    //const uint binSizeInWave = WaveMultiPrefixCountBits(true, waveBinMask);
-    const uint binSizeInWave = dot(1, countbits(waveBinMask));
-
-    // Add number of preceding bits (multiples of 32 bits). When mask is zero, firstbitlow 
-    // returns -1 and the following logical or doesn't change it (x | -1 = -1).
-    const uint4 firstSetLanes = firstbitlow(waveBinMask) | uint4(0x0, 0x20, 0x40, 0x60);
-    // min between uint(-1) and anything else returns the latter
-    const uint writerLane = min(min(min(firstSetLanes.x, firstSetLanes.y), firstSetLanes.z), firstSetLanes.w);
-
-    // Make sure threads outside the screen are skipped
-    if (writerLane == WaveGetLaneIndex() && bin != UINT32_MAX)
-        InterlockedAdd(g_binSize[bin], binSizeInWave);
-
-    GroupMemoryBarrierWithGroupSync();
+    AutoExposure::GroupHistogram(bin, Gidx);
 
     const uint byteOffsetForBin = Gidx * sizeof(uint);
     g_hist.InterlockedAdd(byteOffsetForBin, g_binSize[Gidx]);
-}
\ No newline at end of file
+}
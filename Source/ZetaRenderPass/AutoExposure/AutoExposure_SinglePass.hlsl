@@ -0,0 +1,87 @@
+// Histogram and exposure in one dispatch -- every group adds its histogram to the global 
+// one and the last group to finish computes the exposure from it.
+// Ref: https://github.com/GPUOpen-Effects/FidelityFX-SPD
+
+#include "AutoExposure.hlsli"
+#include "../Common/FrameConstants.h"
+#include "../Common/StaticTextureSamplers.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b0);
+ConstantBuffer<cbAutoExposureHist> g_local : register(b1);
+globallycoherent RWByteAddressBuffer g_hist : register(u0);
+
+groupshared uint g_numGroupsDone;
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+uint2 InputDim()
+{
+    const uint2 renderDim = uint2(g_frame.RenderWidth, g_frame.RenderHeight);
+    return g_local.Downsample ? (renderDim + 1) >> 1 : renderDim;
+}
+
+uint CalculateBin(uint2 DTid)
+{
+    // Can't early exit for out-of-screen threads
+    if (any(DTid >= InputDim()))
+        return UINT32_MAX;
+
+    Texture2D<half4> g_input = ResourceDescriptorHeap[g_local.InputDescHeapIdx];
+    float3 color;
+
+    // Bilinear tap in the middle of each 2x2 block is their average
+    if (g_local.Downsample)
+    {
+        const float2 uv = (2 * DTid + 1) / float2(g_frame.RenderWidth, g_frame.RenderHeight);
+        color = g_input.SampleLevel(g_samLinearClamp, uv, 0).rgb;
+    }
+    else
+        color = g_input[DTid].rgb;
+
+    const float lum = Math::Luminance(color);
+
+    return AutoExposure::LumToBin(lum, g_local);
+}
+
+//--------------------------------------------------------------------------------------
+// main
+//--------------------------------------------------------------------------------------
+
+[WaveSize(WAVE_SIZE)]
+[numthreads(THREAD_GROUP_SIZE_HIST_X, THREAD_GROUP_SIZE_HIST_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID, uint Gidx : SV_GroupIndex)
+{
+    const uint bin = CalculateBin(DTid.xy);
+    AutoExposure::GroupHistogram(bin, Gidx);
+
+    const uint byteOffsetForBin = Gidx * sizeof(uint);
+    g_hist.InterlockedAdd(byteOffsetForBin, g_binSize[Gidx]);
+
+    // Make this group's additions visible to other groups before signaling that it's done
+    DeviceMemoryBarrierWithGroupSync();
+
+    if (Gidx == 0)
+        g_hist.InterlockedAdd(HIST_GROUP_COUNTER_OFFSET, 1, g_numGroupsDone);
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (g_numGroupsDone != g_local.NumGroups - 1)
+        return;
+
+    // This is the last group, so the global histogram is complete.
+    const uint binSize = g_hist.Load(byteOffsetForBin);
+    const uint numExcludedSamples = g_hist.Load(0);
+    const uint2 inputDim = InputDim();
+    const uint numSamples = inputDim.x * inputDim.y - numExcludedSamples;
+
+    const float mean = AutoExposure::HistogramMean(binSize, Gidx, numSamples, g_local);
+
+    if (Gidx == 0)
+        AutoExposure::WriteExposure(mean, g_frame.dt, g_local);
+}
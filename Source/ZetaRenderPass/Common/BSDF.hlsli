@@ -47,6 +47,20 @@
 #define ENERGY_PRESERVING_OREN_NAYAR 1
 #define APPROXIMATE_EON_MULTISCATTER 1
 
+// Store material colors (base color, metal Fr0, transmission and coat tints) in FP16 to
+// reduce register pressure. Everything that decides which lobe or direction is sampled
+// (roughness, eta, coat weight, Fresnel and pdfs) stays in FP32, so replaying a path
+// from shaders that don't set this follows the same lobes.
+#ifndef BSDF_FP16
+#define BSDF_FP16 0
+#endif
+
+#if BSDF_FP16 == 1
+typedef half3 bsdf_color;
+#else
+typedef float3 bsdf_color;
+#endif
+
 namespace BSDF
 {
     enum class LOBE : uint16_t
@@ -609,7 +623,7 @@ namespace BSDF
 
             si.metallic = metallic;
             si.alpha = roughness * roughness;
-            si.baseColor_Fr0_TrCol = baseColor;
+            si.baseColor_Fr0_TrCol = (bsdf_color)baseColor;
             si.specTr = specTr;
             si.trDepth = transmissionDepth;
             si.subsurface = subsurface;
@@ -629,7 +643,7 @@ namespace BSDF
 #endif
 
             si.coat_weight = coat_weight;
-            si.coat_color = coat_color;
+            si.coat_color = (bsdf_color)coat_color;
             si.coat_alpha = coat_roughness * coat_roughness;
             // TODO surrounding medium is assumed to be air
             si.coat_eta = eta_curr == ETA_AIR ? eta_coat / ETA_AIR : ETA_AIR / eta_coat;
@@ -846,7 +860,7 @@ namespace BSDF
         //  - Base color for dielectrics
         //  - Fresnel at normal incidence for metals
         //  - Transmission color for dielectrics with specular transmission
-        float3 baseColor_Fr0_TrCol;
+        bsdf_color baseColor_Fr0_TrCol;
         float eta;      // eta_i / eta_t
         bool specTr;
         bool metallic;
@@ -856,7 +870,7 @@ namespace BSDF
         half trDepth;
         half subsurface;
         float coat_weight;
-        float3 coat_color;
+        bsdf_color coat_color;
         float coat_alpha;
         float coat_eta;
     };
@@ -160,6 +160,40 @@ namespace Common
     {
         return (bitmask & flag) == flag;
     }
+
+    // Returns whether pixel should be fully resampled this frame when only one in every
+    // "interval" (1, 2 or 4) pixels is. Pixels are split into a checkerboard (2) or 2x2
+    // (4) pattern and the subsets are rotated every frame. To avoid visible structure,
+    // assignment of subsets to frames is permuted per 2x2 quad.
+    bool IsPixelScheduled(uint2 DTid, uint frameNum, uint interval)
+    {
+        if(interval <= 1)
+            return true;
+
+        const uint subset = interval == 2 ? (DTid.x ^ DTid.y) & 0x1 :
+            (DTid.x & 0x1) | ((DTid.y & 0x1) << 1);
+
+        const uint2 quad = DTid >> 1;
+        uint h = (quad.x * 0x8da6b343u) ^ (quad.y * 0xd8163841u);
+        h ^= h >> 16;
+
+        return ((subset + h) & (interval - 1)) == (frameNum & (interval - 1));
+    }
+
+    // Returns whether visibility of a pixel's reused (temporal) sample should be retraced 
+    // this frame when it's only retraced once every "interval" frames. Frames are staggered
+    // per pixel to spread the rays evenly. Pixels with more than one pixel of motion are 
+    // always revalidated.
+    bool IsVisibilityRevalidated(uint2 DTid, uint frameNum, uint interval, float2 motionVecPx)
+    {
+        if(interval <= 1 || dot(motionVecPx, motionVecPx) > 1.0f)
+            return true;
+
+        uint h = (DTid.x * 0x8da6b343u) ^ (DTid.y * 0xd8163841u);
+        h ^= h >> 16;
+
+        return ((h + frameNum) % interval) == 0;
+    }
 }
 
 #endif // COMMON_H
\ No newline at end of file
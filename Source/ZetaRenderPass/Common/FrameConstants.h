@@ -45,7 +45,8 @@ namespace ZetaRay
         float PlanetRadius;
         float SunCosAngularRadius;
         float SunSinAngularRadius;
-        float pad;
+        // Zero unless the light BVH is built with clustered leaves
+        uint32_t LightBVHLog2ClusterSize;
 
         float3_ SunDir;
         float SunIlluminance;
@@ -74,7 +75,7 @@ namespace ZetaRay
         float FocusDepth;
         float LensRadius;
         uint32_t DoF;
-        uint32_t pad2;
+        uint32_t VisibilityBuffer;
     };
 #ifdef __cplusplus
 }
@@ -2,6 +2,7 @@
 #define GBUFFERS_H
 
 #include "../../ZetaCore/Core/Material.h"
+#include "../GBuffer/GBufferRT_Common.h"
 
 enum GBUFFER_OFFSET
 {
@@ -28,6 +29,14 @@ enum GBUFFER_OFFSET
 #define GBUFFER_TRI_DIFF_GEO_A Texture2D<uint4> 
 #define GBUFFER_TRI_DIFF_GEO_B Texture2D<uint2> 
 
+#if PACKED_GBUFFER == 1
+// x: base color (RGB8) | subsurface (8), y: encoded normal (2 x 16)
+#define GBUFFER_PACKED_BASE_COLOR_NORMAL Texture2D<uint2>
+// x: flags (8) | roughness (8) | IOR (8) | coat weight (8)
+// y: coat color (RGB565) | coat roughness (8) | coat IOR (8)
+#define GBUFFER_PACKED_MATERIAL Texture2D<uint2>
+#endif
+
 namespace GBuffer
 {
     struct Flags
@@ -49,6 +58,15 @@ namespace GBuffer
         float ior;
     };
 
+    // Stored in TRI_DIFF_GEO_B in visibility-buffer mode
+    struct Visibility
+    {
+        uint meshIdx;
+        uint primIdx;
+        // Normals were reversed for double-sided meshes
+        bool flipped;
+    };
+
     float EncodeMetallic(float metalness, bool isTransmissive, float3 emissive, float trDepth,
         float subsurface, float coat_weight)
     {
@@ -118,6 +136,110 @@ namespace GBuffer
 
         return ret;
     }
+
+    uint2 EncodeVisibility(uint meshIdx, uint primIdx, bool flipped)
+    {
+        return uint2(meshIdx, primIdx | (uint(flipped) << 31));
+    }
+
+    uint ColorToRGB565(float3 c)
+    {
+        uint3 u = (uint3)mad(saturate(c), float3(31.0f, 63.0f, 31.0f), 0.5f);
+        return u.x | (u.y << 5) | (u.z << 11);
+    }
+
+    float3 RGB565ToColor(uint u)
+    {
+        return float3(u & 0x1f, (u >> 5) & 0x3f, (u >> 11) & 0x1f) / float3(31.0f, 63.0f, 31.0f);
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Loads with the same return values regardless of PACKED_GBUFFER
+    //--------------------------------------------------------------------------------------
+
+    // rgb: base color, a: subsurface
+    float4 LoadBaseColor(uint2 pixel, uint descHeapOffset)
+    {
+#if PACKED_GBUFFER == 1
+        GBUFFER_PACKED_BASE_COLOR_NORMAL g_packed = ResourceDescriptorHeap[descHeapOffset + 
+            GBUFFER_OFFSET::BASE_COLOR];
+        return Math::UnpackRGBA8(g_packed[pixel].x);
+#else
+        GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[descHeapOffset + 
+            GBUFFER_OFFSET::BASE_COLOR];
+        return g_baseColor[pixel];
+#endif
+    }
+
+    // Encoded normal, use Math::DecodeUnitVector() to decode
+    float2 LoadNormal(uint2 pixel, uint descHeapOffset)
+    {
+#if PACKED_GBUFFER == 1
+        GBUFFER_PACKED_BASE_COLOR_NORMAL g_packed = ResourceDescriptorHeap[descHeapOffset + 
+            GBUFFER_OFFSET::BASE_COLOR];
+        const uint n = g_packed[pixel].y;
+        return Math::DecodeUNorm2(uint16_t2(n & 0xffff, n >> 16));
+#else
+        GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[descHeapOffset + 
+            GBUFFER_OFFSET::NORMAL];
+        return g_normal[pixel];
+#endif
+    }
+
+    // x: encoded metallic along with flags, use DecodeMetallic() to decode, y: roughness
+    float2 LoadMetallicRoughness(uint2 pixel, uint descHeapOffset)
+    {
+#if PACKED_GBUFFER == 1
+        GBUFFER_PACKED_MATERIAL g_packed = ResourceDescriptorHeap[descHeapOffset + 
+            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
+        const uint x = g_packed[pixel].x;
+        return float2(Math::UNorm8ToFloat(x & 0xff), Math::UNorm8ToFloat((x >> 8) & 0xff));
+#else
+        GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[descHeapOffset + 
+            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
+        return g_metallicRoughness[pixel];
+#endif
+    }
+
+    // Encoded IOR, use DecodeIOR() to decode
+    float LoadIOR(uint2 pixel, uint descHeapOffset)
+    {
+#if PACKED_GBUFFER == 1
+        GBUFFER_PACKED_MATERIAL g_packed = ResourceDescriptorHeap[descHeapOffset + 
+            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
+        return Math::UNorm8ToFloat((g_packed[pixel].x >> 16) & 0xff);
+#else
+        GBUFFER_IOR g_ior = ResourceDescriptorHeap[descHeapOffset + GBUFFER_OFFSET::IOR];
+        return g_ior[pixel];
+#endif
+    }
+
+    // Packed coat, use UnpackCoat() to unpack
+    uint3 LoadCoat(uint2 pixel, uint descHeapOffset)
+    {
+#if PACKED_GBUFFER == 1
+        GBUFFER_PACKED_MATERIAL g_packed = ResourceDescriptorHeap[descHeapOffset + 
+            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
+        const uint2 p = g_packed[pixel];
+        const uint c = Math::Float3ToRGB8(RGB565ToColor(p.y & 0xffff));
+
+        // Same layout as the unpacked coat target
+        return uint3(c & 0xffff, (c >> 16) | ((p.x >> 24) << 8), p.y >> 16);
+#else
+        GBUFFER_COAT g_coat = ResourceDescriptorHeap[descHeapOffset + GBUFFER_OFFSET::COAT];
+        return g_coat[pixel].xyz;
+#endif
+    }
+
+    GBuffer::Visibility DecodeVisibility(uint2 packed)
+    {
+        GBuffer::Visibility ret;
+        ret.meshIdx = packed.x;
+        ret.primIdx = packed.y & 0x7fffffff;
+        ret.flipped = (packed.y >> 31) != 0;
+
+        return ret;
+    }
 }
 
 #endif
\ No newline at end of file
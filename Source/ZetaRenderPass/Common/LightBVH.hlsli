@@ -0,0 +1,220 @@
+#ifndef LIGHT_BVH_H
+#define LIGHT_BVH_H
+
+#include "LightSource.hlsli"
+
+// Light BVH over emissive triangles, built in PreLighting. Sampling traverses the tree
+// from the root and at every internal node, picks a child proportional to its importance
+// for the shading point, as described in [Conty Estevez & Kulla, "Importance Sampling of
+// Many Lights with Adaptive Tree Splitting", 2018].
+//
+// Tree is a complete binary tree with leaves sorted by Morton code of triangle centroids.
+// Number of leaves is the next power of two of number of emissive triangles, with the
+// extra leaves having zero flux.
+//
+// In clustered mode, each leaf instead covers a cluster of 2^log2ClusterSize consecutive
+// triangles in sorted order and a triangle within the cluster is picked proportional to 
+// its flux. That cuts the number of nodes (and traversal steps) by the cluster size. 
+// Triangle to leaf map is then laid out as:
+//  - Per triangle: index of its slot in sorted order (slot >> log2ClusterSize gives the leaf)
+//  - Per slot: triangle index (UINT32_MAX for padding) and flux (as uint)
+namespace LightBVH
+{
+    struct Sample
+    {
+        // Emissive triangle index
+        uint idx;
+        // Probability of sampling this triangle. Zero when there wasn't any light source with
+        // nonzero importance.
+        float pdf;
+    };
+
+    uint NumLeaves(uint numEmissives, uint log2ClusterSize)
+    {
+        const uint numClusters = (numEmissives + (1u << log2ClusterSize) - 1) >> log2ClusterSize;
+        return numClusters <= 1 ? 1 : 1u << (firstbithigh(numClusters - 1) + 1);
+    }
+
+    uint MemberOffset(uint numEmissives, uint slot)
+    {
+        return numEmissives + 2 * slot;
+    }
+
+    // cos(max(0, a - b))
+    float CosSubClamped(float sin_a, float cos_a, float sin_b, float cos_b)
+    {
+        return cos_a > cos_b ? 1.0f : mad(cos_a, cos_b, sin_a * sin_b);
+    }
+
+    // sin(max(0, a - b))
+    float SinSubClamped(float sin_a, float cos_a, float sin_b, float cos_b)
+    {
+        return cos_a > cos_b ? 0.0f : mad(sin_a, cos_b, -cos_a * sin_b);
+    }
+
+    float Importance(float3 pos, float3 normal, bool twoSidedReceiver, RT::LightBVHNode node)
+    {
+        if(node.Flux == 0)
+            return 0;
+
+        const float3 center = 0.5f * (node.BoundsMin + node.BoundsMax);
+        const float3 halfDiag = 0.5f * (node.BoundsMax - node.BoundsMin);
+        const float r2 = dot(halfDiag, halfDiag);
+        const float3 v = pos - center;
+        const float d2 = dot(v, v);
+        const float3 wi = d2 > 0 ? v * rsqrt(d2) : normal;
+
+        // Angle subtended by the bounding sphere -- everything is visible from inside
+        const float sinTheta_b2 = d2 > r2 ? r2 / d2 : 1.0f;
+        const float cosTheta_b = d2 > r2 ? sqrt(1 - sinTheta_b2) : -1.0f;
+        const float sinTheta_b = sqrt(sinTheta_b2);
+
+        // theta' = max(0, theta_w - theta_o - theta_b)
+        const float cosTheta_w = dot(node.Axis, wi);
+        const float sinTheta_w = sqrt(saturate(1 - cosTheta_w * cosTheta_w));
+        const float sinTheta_o = sqrt(saturate(1 - node.CosTheta_o * node.CosTheta_o));
+        const float cosTheta_x = CosSubClamped(sinTheta_w, cosTheta_w, sinTheta_o, node.CosTheta_o);
+        const float sinTheta_x = SinSubClamped(sinTheta_w, cosTheta_w, sinTheta_o, node.CosTheta_o);
+        const float cosThetap = CosSubClamped(sinTheta_x, cosTheta_x, sinTheta_b, cosTheta_b);
+
+        // Outside the emission cone (theta_e = pi / 2)
+        if(cosThetap <= 0)
+            return 0;
+
+        // Angle between the receiver normal and the closest direction towards the bounds
+        float cosTheta_i = dot(-wi, normal);
+        cosTheta_i = twoSidedReceiver ? abs(cosTheta_i) : cosTheta_i;
+        const float sinTheta_i = sqrt(saturate(1 - cosTheta_i * cosTheta_i));
+        const float cosThetap_i = CosSubClamped(sinTheta_i, cosTheta_i, sinTheta_b, cosTheta_b);
+
+        // Avoid very large values when shading point is close to the bounds
+        return node.Flux * cosThetap * max(cosThetap_i, 0) / max(d2, r2);
+    }
+
+    // Picks a member of the cluster at given leaf proportional to its flux
+    Sample SampleClusterMember(uint leafIdx, uint log2ClusterSize, float leafFlux, 
+        uint numEmissives, StructuredBuffer<uint> g_triToLeaf, inout RNG rng)
+    {
+        Sample ret;
+        ret.idx = UINT32_MAX;
+        ret.pdf = 0;
+
+        const uint firstSlot = leafIdx << log2ClusterSize;
+        const float u = rng.Uniform() * leafFlux;
+        float cdf = 0;
+
+        for(uint i = 0; i < (1u << log2ClusterSize); i++)
+        {
+            const uint offset = MemberOffset(numEmissives, firstSlot + i);
+            const float flux = asfloat(g_triToLeaf[offset + 1]);
+            if(flux == 0)
+                continue;
+
+            // Fall back to the last member with nonzero flux in case of rounding errors
+            ret.idx = g_triToLeaf[offset];
+            ret.pdf = flux / leafFlux;
+            cdf += flux;
+
+            if(u < cdf)
+                break;
+        }
+
+        return ret;
+    }
+
+    Sample SampleTriangle(float3 pos, float3 normal, bool twoSidedReceiver, uint numEmissives,
+        uint log2ClusterSize, StructuredBuffer<RT::LightBVHNode> g_bvh, 
+        StructuredBuffer<uint> g_triToLeaf, inout RNG rng)
+    {
+        const uint firstLeaf = NumLeaves(numEmissives, log2ClusterSize) - 1;
+        uint node = 0;
+        float pdf = 1;
+
+        while(node < firstLeaf)
+        {
+            const uint c0 = 2 * node + 1;
+            const float i0 = Importance(pos, normal, twoSidedReceiver, g_bvh[c0]);
+            const float i1 = Importance(pos, normal, twoSidedReceiver, g_bvh[c0 + 1]);
+            const float sum = i0 + i1;
+
+            if(sum == 0)
+            {
+                Sample ret;
+                ret.idx = 0;
+                ret.pdf = 0;
+
+                return ret;
+            }
+
+            // Same expressions as in TrianglePdf() so that both give the same values
+            const float p0 = i0 / sum;
+            const float p1 = i1 / sum;
+            const bool pickFirst = rng.Uniform() < p0;
+
+            node = pickFirst ? c0 : c0 + 1;
+            pdf *= pickFirst ? p0 : p1;
+        }
+
+        Sample ret;
+
+        if(log2ClusterSize > 0)
+        {
+            ret = SampleClusterMember(node - firstLeaf, log2ClusterSize, g_bvh[node].Flux, 
+                numEmissives, g_triToLeaf, rng);
+            ret.pdf *= pdf;
+        }
+        else
+        {
+            ret.idx = g_bvh[node].TriIdx;
+            ret.pdf = pdf;
+        }
+
+        ret.pdf = ret.idx == UINT32_MAX ? 0 : ret.pdf;
+        ret.idx = ret.idx == UINT32_MAX ? 0 : ret.idx;
+
+        return ret;
+    }
+
+    // Probability of SampleTriangle() returning the given triangle
+    float TrianglePdf(float3 pos, float3 normal, bool twoSidedReceiver, uint emissiveIdx,
+        uint numEmissives, uint log2ClusterSize, StructuredBuffer<RT::LightBVHNode> g_bvh,
+        StructuredBuffer<uint> g_triToLeaf)
+    {
+        const uint firstLeaf = NumLeaves(numEmissives, log2ClusterSize) - 1;
+        uint node;
+        float pdf;
+
+        if(log2ClusterSize > 0)
+        {
+            const uint slot = g_triToLeaf[emissiveIdx];
+            const float flux = asfloat(g_triToLeaf[MemberOffset(numEmissives, slot) + 1]);
+            node = firstLeaf + (slot >> log2ClusterSize);
+            const float leafFlux = g_bvh[node].Flux;
+            pdf = leafFlux > 0 ? flux / leafFlux : 0;
+        }
+        else
+        {
+            node = firstLeaf + g_triToLeaf[emissiveIdx];
+            pdf = 1;
+        }
+
+        // Walk up to the root
+        while(node > 0 && pdf > 0)
+        {
+            const uint sibling = (node & 0x1) ? node + 1 : node - 1;
+            const float i = Importance(pos, normal, twoSidedReceiver, g_bvh[node]);
+            const float i_s = Importance(pos, normal, twoSidedReceiver, g_bvh[sibling]);
+            const float sum = i + i_s;
+
+            if(sum == 0)
+                return 0;
+
+            pdf *= i / sum;
+            node = (node - 1) >> 1;
+        }
+
+        return pdf;
+    }
+}
+
+#endif
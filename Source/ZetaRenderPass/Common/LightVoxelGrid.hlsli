@@ -52,19 +52,47 @@ namespace LVG
         return true;
     }
 
+    // Voxels in cascade c are 2^c times as large as the ones in the first cascade
+    float3 CascadeExtents(float3 voxelExtents, uint cascade)
+    {
+        return voxelExtents * (float)(1u << cascade);
+    }
+
+    // Cascades are stacked along z, i.e. voxel (x, y, z) of cascade c is stored as voxel
+    // (x, y, c * gridDim.z + z)
+    uint FlattenVoxelIndex(uint3 voxelIdx, uint cascade, uint3 gridDim)
+    {
+        return FlattenVoxelIndex(uint3(voxelIdx.xy, cascade * gridDim.z + voxelIdx.z), gridDim);
+    }
+
     bool Sample(float3 pos, uint3 gridDim, float3 voxelExtents, uint numLightsPerVoxel, float3x4 view, 
         StructuredBuffer<RT::VoxelSample> g_voxel, out RT::VoxelSample s, inout RNG rng, float offset_y = 0, 
         bool jitter = true)
     {
-        float3 posJittered = jitter ? pos + (rng.Uniform3D() * 2 - 1) * voxelExtents : pos;
-        
-        int3 voxelIdx;
-        if(!MapPosToVoxel(posJittered, gridDim, voxelExtents, view, voxelIdx, offset_y))
+        // Same jitter relative to voxel size in every cascade
+        const float3 u = jitter ? rng.Uniform3D() * 2 - 1 : 0;
+        int3 voxelIdx = 0;
+        uint cascade = LVG_NUM_CASCADES;
+
+        [loop]
+        for(uint c = 0; c < LVG_NUM_CASCADES; c++)
+        {
+            const float3 posJittered = pos + u * CascadeExtents(voxelExtents, c);
+
+            if(MapPosToVoxel(posJittered, gridDim, CascadeExtents(voxelExtents, c), view, 
+                voxelIdx, offset_y))
+            {
+                cascade = c;
+                break;
+            }
+        }
+
+        if(cascade == LVG_NUM_CASCADES)
             return false;
         
-        uint start = FlattenVoxelIndex(voxelIdx, gridDim) * numLightsPerVoxel;
-        uint u = rng.UniformUintBounded_Faster(numLightsPerVoxel);
-        s = g_voxel[start + u];
+        uint start = FlattenVoxelIndex(voxelIdx, cascade, gridDim) * numLightsPerVoxel;
+        uint i = rng.UniformUintBounded_Faster(numLightsPerVoxel);
+        s = g_voxel[start + i];
         
         return true;
     }
@@ -626,6 +626,13 @@ namespace Math
         return u / float((1 << 16) - 1);
     }
 
+    uint16_t4 EncodeNormalized4(float4 u)
+    {
+        // [-1, 1] -> [0, 1]
+        u = saturate(mad(u, 0.5f, 0.5f));
+        return (uint16_t4)mad(u, float((1 << 16) - 1), 0.5f);
+    }
+
     float4 DecodeNormalized4(uint16_t4 u)
     {
         float4 decoded = u / float((1 << 16) - 1);
@@ -4,9 +4,133 @@
 #include "../../ZetaCore/RayTracing/RtCommon.h"
 #include "Math.hlsli"
 #include "Sampling.hlsli"
+#include "Common.hlsli"
+#include "GBuffers.hlsli"
+
+#if COMPACT_VERTEX == 1
+// 16 bytes, must match Core::CompactVertex
+struct PackedVertex
+{
+    // xyz: Quantized position, w: Tangent
+    int16_t4 PosQ_TangentU;
+    half2 TexUV;
+    uint16_t2 NormalL;
+};
+#else
+typedef Vertex PackedVertex;
+#endif
 
 namespace RT
 {
+    // Returns vertex indices of the given triangle, offset by base vertex of the mesh
+    uint3 LoadTriangleIndices(StructuredBuffer<uint> g_indices, MeshInstance meshData, uint primIdx)
+    {
+        const uint base = meshData.BaseIdxOffset & ~MESH_INSTANCE_16BIT_INDICES;
+        const uint tri = base + primIdx * 3;
+        uint3 idx;
+
+        if(meshData.BaseIdxOffset & MESH_INSTANCE_16BIT_INDICES)
+        {
+            // Two indices per uint, the three indices always span exactly two uints
+            uint w0 = g_indices[NonUniformResourceIndex(tri >> 1)];
+            uint w1 = g_indices[NonUniformResourceIndex((tri >> 1) + 1)];
+
+            idx = (tri & 0x1) ? uint3(w0 >> 16, w1 & 0xffff, w1 >> 16) :
+                uint3(w0 & 0xffff, w0 >> 16, w1 & 0xffff);
+        }
+        else
+        {
+            idx = uint3(g_indices[NonUniformResourceIndex(tri)], 
+                g_indices[NonUniformResourceIndex(tri + 1)], 
+                g_indices[NonUniformResourceIndex(tri + 2)]);
+        }
+
+        return idx + meshData.BaseVtxOffset;
+    }
+
+    Vertex UnpackVertex(PackedVertex v, MeshInstance meshData)
+    {
+#if COMPACT_VERTEX == 1
+        Vertex ret;
+        float3 posQ = max(float3(v.PosQ_TangentU.xyz) / 32767.0f, -1.0f);
+        ret.PosL = mad(posQ, meshData.PosExtents, meshData.PosCenter);
+        ret.TexUV = float2(v.TexUV);
+        ret.NormalL = v.NormalL;
+        // Expand 8-bit octahedral tangent to 16 bits
+        uint16_t t = asuint16(v.PosQ_TangentU.w);
+        ret.TangentU = uint16_t2(t & 0xff, t >> 8) * (uint16_t)257;
+
+        return ret;
+#else
+        return v;
+#endif
+    }
+
+    // Differential geometry of given triangle in world space, using either current or
+    // previous frame's transformation
+    Math::TriDifferentials ComputeTriDifferentials(MeshInstance meshData, uint primIdx,
+        bool curr, StructuredBuffer<PackedVertex> g_vertices, StructuredBuffer<uint> g_indices)
+    {
+        const uint3 idx = RT::LoadTriangleIndices(g_indices, meshData, primIdx);
+
+        Vertex V0 = RT::UnpackVertex(g_vertices[NonUniformResourceIndex(idx.x)], meshData);
+        Vertex V1 = RT::UnpackVertex(g_vertices[NonUniformResourceIndex(idx.y)], meshData);
+        Vertex V2 = RT::UnpackVertex(g_vertices[NonUniformResourceIndex(idx.z)], meshData);
+
+        float3 t = curr ? meshData.Translation : meshData.Translation - meshData.dTranslation;
+        float4 q = Math::DecodeNormalized4(curr ? meshData.Rotation : meshData.PrevRotation);
+        float3 s = curr ? meshData.Scale : meshData.PrevScale;
+        // Due to quantization, it's necessary to renormalize
+        q = normalize(q);
+
+        float3 v0W = Math::TransformTRS(V0.PosL, t, q, s);
+        float3 v1W = Math::TransformTRS(V1.PosL, t, q, s);
+        float3 v2W = Math::TransformTRS(V2.PosL, t, q, s);
+
+        const float3 scaleInv = 1.0f / s;
+        float3 n0W = normalize(Math::RotateVector(Math::DecodeOct32(V0.NormalL) * scaleInv, q));
+        float3 n1W = normalize(Math::RotateVector(Math::DecodeOct32(V1.NormalL) * scaleInv, q));
+        float3 n2W = normalize(Math::RotateVector(Math::DecodeOct32(V2.NormalL) * scaleInv, q));
+
+        return Math::TriDifferentials::Compute(v0W, v1W, v2W,
+            n0W, n1W, n2W,
+            V0.TexUV, V1.TexUV, V2.TexUV);
+    }
+
+    // Triangle differentials of the primary surface at given pixel. In visibility-buffer 
+    // mode, they're recomputed from the triangle's vertices. Mesh indices are assumed to 
+    // remain the same between frames.
+    Math::TriDifferentials LoadTriDifferentials(uint2 pixel, uint gbufferDescHeapOffset, 
+        bool curr, bool visibilityBuffer, StructuredBuffer<MeshInstance> g_meshes, 
+        StructuredBuffer<PackedVertex> g_vertices, StructuredBuffer<uint> g_indices)
+    {
+        GBUFFER_TRI_DIFF_GEO_B g_triB = ResourceDescriptorHeap[gbufferDescHeapOffset + 
+            GBUFFER_OFFSET::TRI_DIFF_GEO_B];
+        const uint2 packed_b = g_triB[pixel];
+
+        if(visibilityBuffer)
+        {
+            const GBuffer::Visibility vis = GBuffer::DecodeVisibility(packed_b);
+            const MeshInstance meshData = g_meshes[NonUniformResourceIndex(vis.meshIdx)];
+            Math::TriDifferentials ret = ComputeTriDifferentials(meshData, vis.primIdx, 
+                curr, g_vertices, g_indices);
+
+            if(vis.flipped)
+            {
+                ret.dndu *= -1;
+                ret.dndv *= -1;
+            }
+
+            return ret;
+        }
+
+        GBUFFER_TRI_DIFF_GEO_A g_triA = ResourceDescriptorHeap[gbufferDescHeapOffset + 
+            GBUFFER_OFFSET::TRI_DIFF_GEO_A];
+        const uint4 packed_a = g_triA[pixel];
+
+        return Math::TriDifferentials::Unpack(packed_a, packed_b);
+    }
+
     // Ref: T. Akenine-Moller, J. Nilsson, M. Andersson, C. Barre-Brisebois, R. Toth 
     // and T. Karras, "Texture Level of Detail Strategies for Real-Time Ray Tracing," in 
     // Ray Tracing Gems 1, 2019.
@@ -16,7 +16,7 @@ namespace RtRayQuery
     {
         template<bool ID, bool Curr>
         static Hit FindClosest(float3 pos, float3 normal, float3 wi, RaytracingAccelerationStructure g_bvh, 
-            StructuredBuffer<RT::MeshInstance> g_frameMeshData, StructuredBuffer<Vertex> g_vertices, 
+            StructuredBuffer<RT::MeshInstance> g_frameMeshData, StructuredBuffer<PackedVertex> g_vertices, 
             StructuredBuffer<uint> g_indices, bool transmissive)
         {
             Hit ret;
@@ -61,15 +61,14 @@ namespace RtRayQuery
                 ret.matIdx = meshData.MatIdx;
                 ret.meshIdx = meshIdx;
 
-                uint tri = rayQuery.CommittedPrimitiveIndex() * 3;
-                tri += meshData.BaseIdxOffset;
-                uint i0 = g_indices[NonUniformResourceIndex(tri)] + meshData.BaseVtxOffset;
-                uint i1 = g_indices[NonUniformResourceIndex(tri + 1)] + meshData.BaseVtxOffset;
-                uint i2 = g_indices[NonUniformResourceIndex(tri + 2)] + meshData.BaseVtxOffset;
+                const uint3 idx = RT::LoadTriangleIndices(g_indices, meshData, rayQuery.CommittedPrimitiveIndex());
+                uint i0 = idx.x;
+                uint i1 = idx.y;
+                uint i2 = idx.z;
 
-                Vertex V0 = g_vertices[NonUniformResourceIndex(i0)];
-                Vertex V1 = g_vertices[NonUniformResourceIndex(i1)];
-                Vertex V2 = g_vertices[NonUniformResourceIndex(i2)];
+                Vertex V0 = RT::UnpackVertex(g_vertices[NonUniformResourceIndex(i0)], meshData);
+                Vertex V1 = RT::UnpackVertex(g_vertices[NonUniformResourceIndex(i1)], meshData);
+                Vertex V2 = RT::UnpackVertex(g_vertices[NonUniformResourceIndex(i2)], meshData);
 
                 float3 t = Curr ? meshData.Translation : meshData.Translation - meshData.dTranslation;
                 float4 q = Math::DecodeNormalized4(Curr ? meshData.Rotation : meshData.PrevRotation);
@@ -122,8 +121,8 @@ namespace RtRayQuery
 
                 if(ID)
                 {
-                    uint3 key = uint3(rayQuery.CommittedGeometryIndex(), rayQuery.CommittedInstanceID(), 
-                        rayQuery.CommittedPrimitiveIndex());
+                    uint3 key = uint3(rayQuery.CommittedGeometryIndex() + rayQuery.CommittedInstanceID(), 
+                        0, rayQuery.CommittedPrimitiveIndex());
                     ret.ID = RNG::PCG3d(key).x;
                 }
 
@@ -207,7 +206,7 @@ namespace RtRayQuery
 
         template<bool Curr>
         Hit ToHitInfo(float3 wi, StructuredBuffer<RT::MeshInstance> g_frameMeshData, 
-            StructuredBuffer<Vertex> g_vertices, 
+            StructuredBuffer<PackedVertex> g_vertices, 
             StructuredBuffer<uint> g_indices)
         {
             Hit hitInfo;
@@ -222,15 +221,14 @@ namespace RtRayQuery
             hitInfo.meshIdx = meshIdx;
             hitInfo.matIdx = meshData.MatIdx;
 
-            uint tri = primIdx * 3;
-            tri += meshData.BaseIdxOffset;
-            uint i0 = g_indices[NonUniformResourceIndex(tri)] + meshData.BaseVtxOffset;
-            uint i1 = g_indices[NonUniformResourceIndex(tri + 1)] + meshData.BaseVtxOffset;
-            uint i2 = g_indices[NonUniformResourceIndex(tri + 2)] + meshData.BaseVtxOffset;
+            const uint3 idx = RT::LoadTriangleIndices(g_indices, meshData, primIdx);
+            uint i0 = idx.x;
+            uint i1 = idx.y;
+            uint i2 = idx.z;
 
-            Vertex V0 = g_vertices[NonUniformResourceIndex(i0)];
-            Vertex V1 = g_vertices[NonUniformResourceIndex(i1)];
-            Vertex V2 = g_vertices[NonUniformResourceIndex(i2)];
+            Vertex V0 = RT::UnpackVertex(g_vertices[NonUniformResourceIndex(i0)], meshData);
+            Vertex V1 = RT::UnpackVertex(g_vertices[NonUniformResourceIndex(i1)], meshData);
+            Vertex V2 = RT::UnpackVertex(g_vertices[NonUniformResourceIndex(i2)], meshData);
 
             float3 t = Curr ? meshData.Translation : meshData.Translation - meshData.dTranslation;
             float4 q = Math::DecodeNormalized4(Curr ? meshData.Rotation : meshData.PrevRotation);
@@ -282,7 +280,7 @@ namespace RtRayQuery
                 n0W, n1W, n2W,
                 V0.TexUV, V1.TexUV, V2.TexUV);
 
-            uint3 key = uint3(this.geoIdx, this.insID, this.primIdx);
+            uint3 key = uint3(this.geoIdx + this.insID, 0, this.primIdx);
             hitInfo.ID = RNG::PCG3d(key).x;
 
             return hitInfo;
@@ -395,8 +393,8 @@ namespace RtRayQuery
         // triangle intersection only when hit_t < t_max
         if (rayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
         {
-            uint3 key = uint3(rayQuery.CommittedGeometryIndex(), rayQuery.CommittedInstanceID(), 
-                rayQuery.CommittedPrimitiveIndex());
+            uint3 key = uint3(rayQuery.CommittedGeometryIndex() + rayQuery.CommittedInstanceID(), 
+                0, rayQuery.CommittedPrimitiveIndex());
             uint hash = RNG::PCG3d(key).x;
 
             return triID == hash;
@@ -43,7 +43,7 @@ void Compositing::InitPSOs()
     RenderPassBase::InitRenderPass("Compositing", flags, samplers);
 
     for (int i = 0; i < (int)SHADER::COUNT; i++)
-        m_psoLib.CompileComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
+        m_psoLib.EnqueueComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
 }
 
 void Compositing::Init()
@@ -72,9 +72,27 @@ void Compositing::Init()
         m_filterFirefly);
     App::AddParam(p9);
 
+    ParamVariant p10;
+    p10.InitBool(ICON_FA_FILM " Renderer", "Compositing", "Firefly Filter LDS Tiling",
+        fastdelegate::MakeDelegate(this, &Compositing::FireflyFilterTiledCallback),
+        m_fireflyFilterTiled);
+    App::AddParam(p10);
+
+    ParamVariant p11;
+    p11.InitBool(ICON_FA_FILM " Renderer", "Compositing", "Fused Firefly Filter",
+        fastdelegate::MakeDelegate(this, &Compositing::FusedFireflyFilterCallback),
+        m_fusedFireflyFilter);
+    App::AddParam(p11);
+
     App::AddShaderReloadHandler("Compositing", fastdelegate::MakeDelegate(this, &Compositing::ReloadCompositing));
 }
 
+void Compositing::SetDenoiserAuxEnablement(bool enable)
+{
+    SET_CB_FLAG(m_cbComposit, CB_COMPOSIT_FLAGS::DENOISER_AUX, enable);
+    CreateCompositTexture();
+}
+
 void Compositing::OnWindowResized()
 {
     CreateCompositTexture();
@@ -92,6 +110,8 @@ void Compositing::Render(CommandList& cmdList)
 
     computeCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
 
+    const bool fused = m_filterFirefly && m_fusedFireflyFilter;
+
     // compositing
     {
         computeCmdList.PIXBeginEvent("Compositing");
@@ -109,18 +129,21 @@ void Compositing::Render(CommandList& cmdList)
         }
 
         m_cbComposit.OutputUAVDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::LIGHT_ACCUM_UAV);
+        m_cbComposit.AlbedoUAVDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::ALBEDO_UAV);
+        m_cbComposit.NormalUAVDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::NORMAL_UAV);
 
         m_rootSig.SetRootConstants(0, sizeof(cbCompositing) / sizeof(DWORD), &m_cbComposit);
         m_rootSig.End(computeCmdList);
 
-        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::COMPOSIT));
+        const auto sh = fused ? SHADER::COMPOSIT_FIREFLY_FILTER : SHADER::COMPOSIT;
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
         computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 
         gpuTimer.EndQuery(computeCmdList, queryIdx);
         computeCmdList.PIXEndEvent();
     }
 
-    if (m_filterFirefly)
+    if (m_filterFirefly && !fused)
     {
         computeCmdList.PIXBeginEvent("FireflyFilter");
         const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "FireflyFilter");
@@ -128,7 +151,7 @@ void Compositing::Render(CommandList& cmdList)
         const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, FIREFLY_FILTER_THREAD_GROUP_DIM_X);
         const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, FIREFLY_FILTER_THREAD_GROUP_DIM_Y);
 
-        computeCmdList.UAVBarrier(m_compositTex.Resource());
+        computeCmdList.DeferUAVBarrier(m_compositTex.Resource());
 
         cbFireflyFilter cb;
         cb.CompositedUAVDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::LIGHT_ACCUM_UAV);
@@ -136,7 +159,8 @@ void Compositing::Render(CommandList& cmdList)
         m_rootSig.SetRootConstants(0, sizeof(cbFireflyFilter) / sizeof(DWORD), &cb);
         m_rootSig.End(computeCmdList);
 
-        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::FIREFLY_FILTER));
+        const auto sh = m_fireflyFilterTiled ? SHADER::FIREFLY_FILTER_TILED : SHADER::FIREFLY_FILTER;
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
         computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 
         gpuTimer.EndQuery(computeCmdList, queryIdx);
@@ -156,6 +180,29 @@ void Compositing::CreateCompositTexture()
         TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
 
     Direct3DUtil::CreateTexture2DUAV(m_compositTex, m_descTable.CPUHandle((int)DESC_TABLE::LIGHT_ACCUM_UAV));
+
+    if (!IS_CB_FLAG_SET(m_cbComposit, CB_COMPOSIT_FLAGS::DENOISER_AUX))
+    {
+        m_denoiserAux[0].Reset();
+        m_denoiserAux[1].Reset();
+
+        return;
+    }
+
+    m_denoiserAux[0] = GpuMemory::GetTexture2D("DenoiserAlbedo",
+        renderer.GetRenderWidth(), renderer.GetRenderHeight(),
+        ResourceFormats::DENOISER_AUX,
+        D3D12_RESOURCE_STATE_COMMON,
+        TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+    m_denoiserAux[1] = GpuMemory::GetTexture2D("DenoiserNormal",
+        renderer.GetRenderWidth(), renderer.GetRenderHeight(),
+        ResourceFormats::DENOISER_AUX,
+        D3D12_RESOURCE_STATE_COMMON,
+        TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+    Direct3DUtil::CreateTexture2DUAV(m_denoiserAux[0], m_descTable.CPUHandle((int)DESC_TABLE::ALBEDO_UAV));
+    Direct3DUtil::CreateTexture2DUAV(m_denoiserAux[1], m_descTable.CPUHandle((int)DESC_TABLE::NORMAL_UAV));
 }
 
 void Compositing::FireflyFilterCallback(const Support::ParamVariant& p)
@@ -163,6 +210,16 @@ void Compositing::FireflyFilterCallback(const Support::ParamVariant& p)
     m_filterFirefly = p.GetBool();
 }
 
+void Compositing::FireflyFilterTiledCallback(const Support::ParamVariant& p)
+{
+    m_fireflyFilterTiled = p.GetBool();
+}
+
+void Compositing::FusedFireflyFilterCallback(const Support::ParamVariant& p)
+{
+    m_fusedFireflyFilter = p.GetBool();
+}
+
 void Compositing::DirectCallback(const Support::ParamVariant& p)
 {
     m_directLighting = p.GetBool();
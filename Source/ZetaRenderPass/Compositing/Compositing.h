@@ -20,6 +20,8 @@ namespace ZetaRay::RenderPass
     {
         COMPOSIT,
         FIREFLY_FILTER,
+        FIREFLY_FILTER_TILED,
+        COMPOSIT_FIREFLY_FILTER,
         COUNT
     };
 
@@ -37,6 +39,8 @@ namespace ZetaRay::RenderPass
         enum class SHADER_OUT_RES
         {
             COMPOSITED,
+            DENOISER_ALBEDO,
+            DENOISER_NORMAL,
             COUNT
         };
 
@@ -46,6 +50,10 @@ namespace ZetaRay::RenderPass
         void InitPSOs();
         void Init();
         void SetInscatteringEnablement(bool enable) { SET_CB_FLAG(m_cbComposit, CB_COMPOSIT_FLAGS::INSCATTERING, enable); }
+        // Also writes the albedo and normal of primary surfaces, which are used as guides by 
+        // the offline denoiser
+        void SetDenoiserAuxEnablement(bool enable);
+        bool IsDenoiserAuxEnabled() const { return IS_CB_FLAG_SET(m_cbComposit, CB_COMPOSIT_FLAGS::DENOISER_AUX); }
         void SetVoxelGridDepth(float zNear, float zFar) { m_cbComposit.VoxelGridNearZ = zNear, m_cbComposit.VoxelGridFarZ = zFar; }
         void SetVoxelGridMappingExp(float exp) { m_cbComposit.DepthMappingExp = exp; }
         void SetGpuDescriptor(SHADER_IN_GPU_DESC input, uint32_t descHeapIdx)
@@ -77,8 +85,17 @@ namespace ZetaRay::RenderPass
         }
         const Core::GpuMemory::Texture & GetOutput(SHADER_OUT_RES out) const
         {
-            Assert((int)out < (int)SHADER_IN_GPU_DESC::COUNT, "out-of-bound access.");
-            return m_compositTex;
+            Assert((int)out < (int)SHADER_OUT_RES::COUNT, "out-of-bound access.");
+
+            switch (out)
+            {
+            case SHADER_OUT_RES::DENOISER_ALBEDO:
+                return m_denoiserAux[0];
+            case SHADER_OUT_RES::DENOISER_NORMAL:
+                return m_denoiserAux[1];
+            default:
+                return m_compositTex;
+            }
         }
         void OnWindowResized();
         void Render(Core::CommandList& cmdList);
@@ -94,32 +111,46 @@ namespace ZetaRay::RenderPass
         struct ResourceFormats
         {
             static constexpr DXGI_FORMAT LIGHT_ACCUM = DXGI_FORMAT_R32G32B32A32_FLOAT;
+            // Same as composited, so that all denoiser inputs can be read back together
+            static constexpr DXGI_FORMAT DENOISER_AUX = DXGI_FORMAT_R32G32B32A32_FLOAT;
         };
 
         enum class DESC_TABLE
         {
             LIGHT_ACCUM_UAV,
+            ALBEDO_UAV,
+            NORMAL_UAV,
             COUNT
         };
 
         inline static constexpr const char* COMPILED_CS[(int)SHADER::COUNT] = {
             "Compositing_cs.cso",
-            "FireflyFilter_cs.cso"
+            "FireflyFilter_cs.cso",
+            "FireflyFilter_Tiled_cs.cso",
+            "Compositing_FireflyFilter_cs.cso"
         };
 
         void CreateCompositTexture();
 
         // param callbacks
         void FireflyFilterCallback(const Support::ParamVariant& p);
+        void FireflyFilterTiledCallback(const Support::ParamVariant& p);
+        void FusedFireflyFilterCallback(const Support::ParamVariant& p);
         void DirectCallback(const Support::ParamVariant& p);
         void IndirectCallback(const Support::ParamVariant& p);
         // shader reload
         void ReloadCompositing();
 
         Core::GpuMemory::Texture m_compositTex;
+        // Albedo, normal
+        Core::GpuMemory::Texture m_denoiserAux[2];
         Core::DescriptorTable m_descTable;
         cbCompositing m_cbComposit;
         bool m_filterFirefly = false;
+        // Load each group's neighborhood into groupshared memory once
+        bool m_fireflyFilterTiled = false;
+        // Run the firefly filter as part of the compositing dispatch
+        bool m_fusedFireflyFilter = false;
         bool m_directLighting = true;
     };
 }
\ No newline at end of file
@@ -10,6 +10,15 @@
 ConstantBuffer<cbCompositing> g_local : register(b0);
 ConstantBuffer<cbFrameConstants> g_frame : register(b1);
 
+#ifdef FUSED_FIREFLY_FILTER
+#define FIREFLY_TILE_GROUP_DIM_X COMPOSITING_THREAD_GROUP_DIM_X
+#define FIREFLY_TILE_GROUP_DIM_Y COMPOSITING_THREAD_GROUP_DIM_Y
+#include "FireflyFilter.hlsli"
+
+// Number of pixels around the group that the firefly filter reads
+#define APRON_SIZE (2 * FIREFLY_TILE_DIM_X + 2 * FIREFLY_TILE_GROUP_DIM_Y)
+#endif
+
 //--------------------------------------------------------------------------------------
 // Helper Functions
 //--------------------------------------------------------------------------------------
@@ -23,28 +32,36 @@ float3 MapIdxToColor(uint i)
     return float3(r, g, b);
 }
 
-//--------------------------------------------------------------------------------------
-// Main
-//--------------------------------------------------------------------------------------
-
-[numthreads(COMPOSITING_THREAD_GROUP_DIM_X, COMPOSITING_THREAD_GROUP_DIM_Y, 1)]
-void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID, uint Gidx : SV_GroupIndex)
+#ifdef FUSED_FIREFLY_FILTER
+// Maps i in [0, APRON_SIZE) to position of an apron pixel relative to group's first pixel
+int2 ApronOffset(uint i)
 {
-    if (DTid.x >= g_frame.RenderWidth || DTid.y >= g_frame.RenderHeight)
-        return;
+    if (i < FIREFLY_TILE_DIM_X)
+        return int2(i - 1, -1);
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    GBuffer::Flags flags = GBuffer::DecodeMetallic(g_metallicRoughness[DTid.xy].x);
+    i -= FIREFLY_TILE_DIM_X;
+    if (i < FIREFLY_TILE_DIM_X)
+        return int2(i - 1, FIREFLY_TILE_GROUP_DIM_Y);
+
+    i -= FIREFLY_TILE_DIM_X;
+    if (i < FIREFLY_TILE_GROUP_DIM_Y)
+        return int2(-1, i);
+
+    return int2(FIREFLY_TILE_GROUP_DIM_X, i - FIREFLY_TILE_GROUP_DIM_Y);
+}
+#endif
+
+float3 Composite(uint2 DTid)
+{
+    GBuffer::Flags flags = GBuffer::DecodeMetallic(GBuffer::LoadMetallicRoughness(DTid, 
+        g_frame.CurrGBufferDescHeapOffset).x);
 
-    RWTexture2D<float4> g_composited = ResourceDescriptorHeap[g_local.OutputUAVDescHeapIdx];
     const bool accumulate = g_frame.Accumulate && g_frame.CameraStatic;
     
     if (flags.invalid && !accumulate)
     {
         const bool dirLighting = IS_CB_FLAG_SET(CB_COMPOSIT_FLAGS::SKY_DI) || IS_CB_FLAG_SET(CB_COMPOSIT_FLAGS::EMISSIVE_DI);
-        g_composited[DTid.xy].xyz = dirLighting ? Light::Le_SkyWithSunDisk(DTid.xy, g_frame) : 0;
-        return;
+        return dirLighting ? Light::Le_SkyWithSunDisk(DTid, g_frame) : 0;
     }
 
     const uint numFramesAccumulated = accumulate ? g_frame.NumFramesCameraStatic : 1;
@@ -53,19 +70,21 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID, uint
     if (IS_CB_FLAG_SET(CB_COMPOSIT_FLAGS::SKY_DI) && g_local.SkyDIDescHeapIdx != 0)
     {
         Texture2D<float4> g_sky = ResourceDescriptorHeap[g_local.SkyDIDescHeapIdx];
-        color = g_sky[DTid.xy].rgb;
+        color = g_sky[DTid].rgb;
     }
     else if (IS_CB_FLAG_SET(CB_COMPOSIT_FLAGS::EMISSIVE_DI) && g_local.EmissiveDIDescHeapIdx != 0)
     {
         Texture2D<float4> g_emissive = ResourceDescriptorHeap[g_local.EmissiveDIDescHeapIdx];
-        float3 le = g_emissive[DTid.xy].rgb;
+        float3 le = g_emissive[DTid].rgb;
         color += le;
     }
 
-    if (IS_CB_FLAG_SET(CB_COMPOSIT_FLAGS::INDIRECT) && !flags.emissive && g_local.IndirectDescHeapIdx != 0)
+    // Sky pixels don't receive indirect lighting -- integrators may skip them entirely
+    if (IS_CB_FLAG_SET(CB_COMPOSIT_FLAGS::INDIRECT) && !flags.invalid && !flags.emissive && 
+        g_local.IndirectDescHeapIdx != 0)
     {
         Texture2D<float4> g_indirect = ResourceDescriptorHeap[g_local.IndirectDescHeapIdx];
-        float3 li = g_indirect[DTid.xy].rgb;
+        float3 li = g_indirect[DTid].rgb;
         color += li;
     }
 
@@ -75,11 +94,11 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID, uint
     {
         GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
             GBUFFER_OFFSET::DEPTH];
-        const float z_view = g_depth[DTid.xy];
+        const float z_view = g_depth[DTid];
 
         if (z_view > 1e-4f)
         {
-            float2 posTS = (DTid.xy + 0.5f) / float2(g_frame.RenderWidth, g_frame.RenderHeight);
+            float2 posTS = (DTid + 0.5f) / float2(g_frame.RenderWidth, g_frame.RenderHeight);
             float p = pow(max(z_view - g_local.VoxelGridNearZ, 0.0f) / 
                 (g_local.VoxelGridFarZ - g_local.VoxelGridNearZ), 1.0f / g_local.DepthMappingExp);
         
@@ -122,5 +141,100 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID, uint
         // }
     }
 
+    return color;
+}
+
+// Albedo and normal of the primary surface, averaged over the same frames as the image 
+// so that both are antialiased the same way. Sky has no surface -- albedo is then one
+// so that denoiser keeps it as is.
+void WriteDenoiserAux(uint2 DTid)
+{
+    GBuffer::Flags flags = GBuffer::DecodeMetallic(GBuffer::LoadMetallicRoughness(DTid, 
+        g_frame.CurrGBufferDescHeapOffset).x);
+    float3 albedo = 1;
+    float3 normal = 0;
+
+    if (!flags.invalid)
+    {
+        albedo = GBuffer::LoadBaseColor(DTid, g_frame.CurrGBufferDescHeapOffset).rgb;
+        normal = Math::DecodeUnitVector(GBuffer::LoadNormal(DTid, g_frame.CurrGBufferDescHeapOffset));
+    }
+
+    RWTexture2D<float4> g_albedo = ResourceDescriptorHeap[g_local.AlbedoUAVDescHeapIdx];
+    RWTexture2D<float4> g_normal = ResourceDescriptorHeap[g_local.NormalUAVDescHeapIdx];
+
+    if (g_frame.Accumulate && g_frame.CameraStatic && g_frame.NumFramesCameraStatic > 1)
+    {
+        const float w = 1.0f / g_frame.NumFramesCameraStatic;
+        albedo = lerp(g_albedo[DTid].xyz, albedo, w);
+        normal = lerp(g_normal[DTid].xyz, normal, w);
+    }
+
+    g_albedo[DTid].xyz = albedo;
+    g_normal[DTid].xyz = normal;
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(COMPOSITING_THREAD_GROUP_DIM_X, COMPOSITING_THREAD_GROUP_DIM_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID, 
+    uint Gidx : SV_GroupIndex)
+{
+    RWTexture2D<float4> g_composited = ResourceDescriptorHeap[g_local.OutputUAVDescHeapIdx];
+
+#ifdef FUSED_FIREFLY_FILTER
+    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + GBUFFER_OFFSET::DEPTH];
+    const int2 renderDim = int2(g_frame.RenderWidth, g_frame.RenderHeight);
+    const bool inBounds = DTid.x < g_frame.RenderWidth && DTid.y < g_frame.RenderHeight;
+
+    // Composite group's pixels plus a one-pixel apron into groupshared memory, so that the 
+    // firefly filter doesn't need a separate dispatch. Apron pixels are also composited by 
+    // the neighboring groups.
+    float3 color = 0;
+    bool onSurface = false;
+
+    if (inBounds)
+    {
+        color = Composite(DTid.xy);
+        onSurface = g_depth[DTid.xy] != FLT_MAX;
+    }
+
+    g_tile[FireflyFilter::TileIndex(GTid.xy)] = half4(min(color, FLT16_MAX), onSurface);
+
+    if (Gidx < APRON_SIZE)
+    {
+        const int2 offset = ApronOffset(Gidx);
+        const int2 addr = int2(Gid.xy * uint2(COMPOSITING_THREAD_GROUP_DIM_X, COMPOSITING_THREAD_GROUP_DIM_Y)) + 
+            offset;
+        half4 val = 0;
+
+        if (all(addr >= 0) && all(addr < renderDim) && g_depth[addr] != FLT_MAX)
+            val = half4(min(Composite(addr), FLT16_MAX), 1);
+
+        g_tile[FireflyFilter::TileIndex(offset)] = val;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (!inBounds)
+        return;
+
+    if (onSurface)
+        color = FireflyFilter::FilterTiled(color, GTid.xy);
+
     g_composited[DTid.xy].xyz = color;
+
+    if (IS_CB_FLAG_SET(CB_COMPOSIT_FLAGS::DENOISER_AUX))
+        WriteDenoiserAux(DTid.xy);
+#else
+    if (DTid.x >= g_frame.RenderWidth || DTid.y >= g_frame.RenderHeight)
+        return;
+
+    g_composited[DTid.xy].xyz = Composite(DTid.xy);
+
+    if (IS_CB_FLAG_SET(CB_COMPOSIT_FLAGS::DENOISER_AUX))
+        WriteDenoiserAux(DTid.xy);
+#endif
 }
\ No newline at end of file
@@ -16,6 +16,8 @@ namespace CB_COMPOSIT_FLAGS
     static constexpr uint32_t INSCATTERING = 1 << 4;
     static constexpr uint32_t EMISSIVE_DI = 1 << 5;
     static constexpr uint32_t VISUALIZE_LVG = 1 << 6;
+    // Albedo and normal guide images for the offline denoiser
+    static constexpr uint32_t DENOISER_AUX = 1 << 7;
 };
 
 struct cbCompositing
@@ -25,6 +27,8 @@ struct cbCompositing
     uint32_t EmissiveDIDescHeapIdx;
     uint32_t IndirectDescHeapIdx;
     uint32_t OutputUAVDescHeapIdx;
+    uint32_t AlbedoUAVDescHeapIdx;
+    uint32_t NormalUAVDescHeapIdx;
 
     float DepthMappingExp;
     float VoxelGridNearZ;
@@ -0,0 +1,2 @@
+#define FUSED_FIREFLY_FILTER
+#include "Compositing.hlsl"
\ No newline at end of file
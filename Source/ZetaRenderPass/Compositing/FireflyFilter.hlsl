@@ -13,6 +13,12 @@
 ConstantBuffer<cbFireflyFilter> g_local : register(b0);
 ConstantBuffer<cbFrameConstants> g_frame : register(b1);
 
+#ifdef LDS_TILE
+#define FIREFLY_TILE_GROUP_DIM_X FIREFLY_FILTER_THREAD_GROUP_DIM_X
+#define FIREFLY_TILE_GROUP_DIM_Y FIREFLY_FILTER_THREAD_GROUP_DIM_Y
+#include "FireflyFilter.hlsli"
+#endif
+
 //--------------------------------------------------------------------------------------
 // Helper Functions
 //--------------------------------------------------------------------------------------
@@ -31,6 +37,30 @@ float GeometryTest(float sampleLinearDepth, float2 sampleUV, float3 centerNormal
     return weight;
 }
 
+#ifdef LDS_TILE
+// Every thread in the group has to call this, including the out-of-bounds ones
+void LoadTile(RWTexture2D<float4> g_input, int2 groupBase, uint Gidx)
+{
+    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + GBUFFER_OFFSET::DEPTH];
+    const int2 renderDim = int2(g_frame.RenderWidth, g_frame.RenderHeight);
+
+    for (uint i = Gidx; i < FIREFLY_TILE_DIM_X * FIREFLY_TILE_DIM_Y; 
+        i += FIREFLY_FILTER_THREAD_GROUP_DIM_X * FIREFLY_FILTER_THREAD_GROUP_DIM_Y)
+    {
+        const int2 addr = groupBase + int2(i % FIREFLY_TILE_DIM_X, i / FIREFLY_TILE_DIM_X) - 1;
+        half4 val = 0;
+
+        if (all(addr >= 0) && all(addr < renderDim) && g_depth[addr] != FLT_MAX)
+            val = half4(min(g_input[addr].rgb, FLT16_MAX), 1);
+
+        g_tile[i] = val;
+    }
+
+    // Also makes sure all the reads from g_input are done before it's written to below
+    GroupMemoryBarrierWithGroupSync();
+}
+#endif
+
 // Ref: P. Kozlowski and T. Cheblokov, "ReLAX: A Denoiser Tailored to Work with the ReSTIR Algorithm," GTC, 2021.
 float3 FilterFirefly(RWTexture2D<float4> g_input, float3 currColor, int2 DTid, int2 GTid, 
     float linearDepth, float3 normal, float3 pos)
@@ -94,15 +124,22 @@ float3 FilterFirefly(RWTexture2D<float4> g_input, float3 currColor, int2 DTid, i
 //--------------------------------------------------------------------------------------
 
 [numthreads(FIREFLY_FILTER_THREAD_GROUP_DIM_X, FIREFLY_FILTER_THREAD_GROUP_DIM_Y, 1)]
-void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID, uint Gidx : SV_GroupIndex)
+void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID, 
+    uint Gidx : SV_GroupIndex)
 {
+    RWTexture2D<float4> g_composited = ResourceDescriptorHeap[g_local.CompositedUAVDescHeapIdx];
+
+#ifdef LDS_TILE
+    LoadTile(g_composited, Gid.xy * uint2(FIREFLY_FILTER_THREAD_GROUP_DIM_X, FIREFLY_FILTER_THREAD_GROUP_DIM_Y), 
+        Gidx);
+#endif
+
     if (DTid.x >= g_frame.RenderWidth || DTid.y >= g_frame.RenderHeight)
         return;
 
     GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + GBUFFER_OFFSET::DEPTH];
     const float z_view = g_depth[DTid.xy];
     
-    RWTexture2D<float4> g_composited = ResourceDescriptorHeap[g_local.CompositedUAVDescHeapIdx];
     float3 color = g_composited[DTid.xy].rgb;
     
     if (z_view == FLT_MAX)
@@ -116,9 +153,13 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID, uint
         g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrViewInv, 
         g_frame.CurrCameraJitter);
     
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_normal[DTid.xy]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(DTid.xy, 
+        g_frame.CurrGBufferDescHeapOffset));
 
+#ifdef LDS_TILE
+    color = FireflyFilter::FilterTiled(color, GTid.xy);
+#else
     color = FilterFirefly(g_composited, color, DTid.xy, GTid.xy, z_view, normal, pos);
+#endif
     g_composited[DTid.xy].rgb = color;
 }
\ No newline at end of file
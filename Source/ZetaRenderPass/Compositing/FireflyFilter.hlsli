@@ -0,0 +1,72 @@
+#ifndef FIREFLY_FILTER_H
+#define FIREFLY_FILTER_H
+
+#include "../Common/Math.hlsli"
+
+// Firefly filter that reads the 3x3 neighborhood from a groupshared tile holding the
+// group's pixels plus a one-pixel apron. Filling the tile is left to the including shader.
+//
+// Thread group dimensions must be defined before including this file.
+#if !defined(FIREFLY_TILE_GROUP_DIM_X) || !defined(FIREFLY_TILE_GROUP_DIM_Y)
+#error FIREFLY_TILE_GROUP_DIM_X and FIREFLY_TILE_GROUP_DIM_Y must be defined.
+#endif
+
+#define FIREFLY_TILE_DIM_X (FIREFLY_TILE_GROUP_DIM_X + 2)
+#define FIREFLY_TILE_DIM_Y (FIREFLY_TILE_GROUP_DIM_Y + 2)
+
+// rgb: color, a: 1 if pixel is on a surface, 0 otherwise
+groupshared half4 g_tile[FIREFLY_TILE_DIM_X * FIREFLY_TILE_DIM_Y];
+
+namespace FireflyFilter
+{
+    uint TileIndex(int2 GTid)
+    {
+        return (GTid.y + 1) * FIREFLY_TILE_DIM_X + GTid.x + 1;
+    }
+
+    // Ref: P. Kozlowski and T. Cheblokov, "ReLAX: A Denoiser Tailored to Work with the ReSTIR Algorithm," GTC, 2021.
+    float3 FilterTiled(float3 currColor, int2 GTid)
+    {
+        float minLum = FLT_MAX;
+        float maxLum = 0.0;
+        float3 minColor = currColor;
+        float3 maxColor = 0.0.xxx;
+        float currLum = Math::Luminance(currColor);
+
+        [unroll]
+        for (int i = -1; i <= 1; i++)
+        {
+            [unroll]
+            for (int j = -1; j <= 1; j++)
+            {
+                if (i == 0 && j == 0)
+                    continue;
+
+                const half4 neighbor = g_tile[TileIndex(GTid + int2(j, i))];
+                if (neighbor.a == 0)
+                    continue;
+
+                float3 neighborColor = neighbor.rgb;
+                float neighborLum = Math::Luminance(neighborColor);
+
+                if (neighborLum < minLum)
+                {
+                    minLum = neighborLum;
+                    minColor = neighborColor;
+                }
+                else if (neighborLum > maxLum)
+                {
+                    maxLum = neighborLum;
+                    maxColor = neighborColor;
+                }
+            }
+        }
+
+        float3 ret = currLum < minLum ? minColor : (currLum > maxLum ? maxColor : currColor);
+        ret = minLum <= maxLum ? ret : currColor;
+
+        return ret;
+    }
+}
+
+#endif
@@ -0,0 +1,2 @@
+#define LDS_TILE
+#include "FireflyFilter.hlsl"
\ No newline at end of file
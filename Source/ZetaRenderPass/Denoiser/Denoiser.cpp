@@ -0,0 +1,241 @@
+#include "Denoiser.h"
+#include <Core/CommandList.h>
+#include <Support/Param.h>
+#include "../Assets/Font/IconsFontAwesome6.h"
+
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Core::GpuMemory;
+using namespace ZetaRay::Core::Direct3DUtil;
+using namespace ZetaRay::RenderPass;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Support;
+
+//--------------------------------------------------------------------------------------
+// Denoiser
+//--------------------------------------------------------------------------------------
+
+Denoiser::Denoiser()
+    : RenderPassBase(NUM_CBV, NUM_SRV, NUM_UAV, NUM_GLOBS, NUM_CONSTS)
+{
+    // frame constants
+    m_rootSig.InitAsCBV(0, 0, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        GlobalResource::FRAME_CONSTANTS_BUFFER);
+
+    // root constants
+    m_rootSig.InitAsConstants(1, NUM_CONSTS, 1);
+}
+
+void Denoiser::Init()
+{
+    constexpr D3D12_ROOT_SIGNATURE_FLAGS flags =
+        D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_MESH_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+    auto samplers = App::GetRenderer().GetStaticSamplers();
+    RenderPassBase::InitRenderPass("Denoiser", flags, samplers);
+
+    for (int i = 0; i < (int)SHADER::COUNT; i++)
+        m_psoLib.EnqueueComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
+
+    memset(&m_cbDenoiser, 0, sizeof(m_cbDenoiser));
+    m_cbDenoiser.MaxHistoryLen = DefaultParamVals::MAX_HISTORY_LEN;
+    m_cbDenoiser.LumSigma = DefaultParamVals::LUM_SIGMA;
+
+    m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
+    CreateResources();
+
+    ParamVariant maxHistoryLen;
+    maxHistoryLen.InitInt(ICON_FA_FILM " Renderer", "Denoiser", "Max History Length",
+        fastdelegate::MakeDelegate(this, &Denoiser::MaxHistoryLenCallback),
+        DefaultParamVals::MAX_HISTORY_LEN, 1, 64, 1);
+    App::AddParam(maxHistoryLen);
+
+    ParamVariant numIterations;
+    numIterations.InitInt(ICON_FA_FILM " Renderer", "Denoiser", "A-Trous Iterations",
+        fastdelegate::MakeDelegate(this, &Denoiser::NumIterationsCallback),
+        DefaultParamVals::NUM_ATROUS_ITERATIONS, 1, 5, 1);
+    App::AddParam(numIterations);
+
+    ParamVariant lumSigma;
+    lumSigma.InitFloat(ICON_FA_FILM " Renderer", "Denoiser", "Luminance Sigma",
+        fastdelegate::MakeDelegate(this, &Denoiser::LumSigmaCallback),
+        DefaultParamVals::LUM_SIGMA, 0.1f, 16.0f, 0.1f);
+    App::AddParam(lumSigma);
+
+    App::AddShaderReloadHandler("Denoiser (Temporal)", fastdelegate::MakeDelegate(this, &Denoiser::ReloadTemporalPass));
+    App::AddShaderReloadHandler("Denoiser (A-Trous)", fastdelegate::MakeDelegate(this, &Denoiser::ReloadATrousPass));
+
+    m_isTemporalValid = false;
+}
+
+void Denoiser::OnWindowResized()
+{
+    m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
+    CreateResources();
+
+    m_isTemporalValid = false;
+    m_currTemporalIdx = 0;
+}
+
+void Denoiser::Render(CommandList& cmdList)
+{
+    Assert(cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_DIRECT ||
+        cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_COMPUTE, "Invalid downcast");
+    ComputeCmdList& computeCmdList = static_cast<ComputeCmdList&>(cmdList);
+
+    auto& renderer = App::GetRenderer();
+    auto& gpuTimer = renderer.GetGpuTimer();
+    const uint32_t w = renderer.GetRenderWidth();
+    const uint32_t h = renderer.GetRenderHeight();
+    const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, DENOISER_GROUP_DIM_X);
+    const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, DENOISER_GROUP_DIM_Y);
+
+    Assert(m_cbDenoiser.SignalDescHeapIdx > 0, "Input SRV hasn't been set.");
+
+    computeCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
+
+    // Temporal accumulation
+    {
+        computeCmdList.PIXBeginEvent("Denoiser_Temporal");
+        const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "Denoiser_Temporal");
+
+        m_cbDenoiser.PrevHistoryDescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            (int)DESC_TABLE::HISTORY_0_UAV + 1 - m_currTemporalIdx);
+        m_cbDenoiser.CurrHistoryDescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            (int)DESC_TABLE::HISTORY_0_UAV + m_currTemporalIdx);
+        m_cbDenoiser.PrevMomentsDescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            (int)DESC_TABLE::MOMENTS_0_UAV + 1 - m_currTemporalIdx);
+        m_cbDenoiser.CurrMomentsDescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            (int)DESC_TABLE::MOMENTS_0_UAV + m_currTemporalIdx);
+        m_cbDenoiser.OutputDescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            (int)DESC_TABLE::FILTER_0_UAV);
+        SET_CB_FLAG(m_cbDenoiser, CB_DENOISER_FLAGS::TEMPORAL_VALID, m_isTemporalValid);
+
+        m_rootSig.SetRootConstants(0, NUM_CONSTS, &m_cbDenoiser);
+        m_rootSig.End(computeCmdList);
+
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::TEMPORAL));
+        computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+
+        gpuTimer.EndQuery(computeCmdList, queryIdx);
+        computeCmdList.PIXEndEvent();
+    }
+
+    // A-trous iterations with increasing step sizes
+    {
+        computeCmdList.PIXBeginEvent("Denoiser_ATrous");
+        const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "Denoiser_ATrous");
+
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::ATROUS));
+
+        for (int i = 0; i < m_numIterations; i++)
+        {
+            const int inIdx = i & 0x1;
+
+            // Wait for previous iteration's output. Color history is written by the
+            // temporal pass and then overwritten by the first iteration.
+            D3D12_TEXTURE_BARRIER barriers[2];
+            int numBarriers = 0;
+            barriers[numBarriers++] = UAVBarrier1(m_filter[inIdx].Resource());
+
+            if (i == 0)
+                barriers[numBarriers++] = UAVBarrier1(m_history[m_currTemporalIdx].Resource());
+
+            computeCmdList.ResourceBarrier(barriers, (UINT)numBarriers);
+
+            m_cbDenoiser.InputDescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+                (int)DESC_TABLE::FILTER_0_UAV + inIdx);
+            m_cbDenoiser.OutputDescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+                (int)DESC_TABLE::FILTER_0_UAV + 1 - inIdx);
+            m_cbDenoiser.Step = (uint16_t)(1 << i);
+            SET_CB_FLAG(m_cbDenoiser, CB_DENOISER_FLAGS::FEEDBACK, i == 0);
+            SET_CB_FLAG(m_cbDenoiser, CB_DENOISER_FLAGS::LAST_ITERATION, i == m_numIterations - 1);
+
+            m_rootSig.SetRootConstants(0, NUM_CONSTS, &m_cbDenoiser);
+            m_rootSig.End(computeCmdList);
+
+            computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+        }
+
+        gpuTimer.EndQuery(computeCmdList, queryIdx);
+        computeCmdList.PIXEndEvent();
+    }
+
+    m_isTemporalValid = true;
+    m_currTemporalIdx = 1 - m_currTemporalIdx;
+}
+
+void Denoiser::CreateResources()
+{
+    auto& renderer = App::GetRenderer();
+    const uint32_t w = renderer.GetRenderWidth();
+    const uint32_t h = renderer.GetRenderHeight();
+
+    // Internal textures are only ever accessed as UAV
+    for (int i = 0; i < 2; i++)
+    {
+        StackStr(historyName, n0, "Denoiser_History_%d", i);
+        m_history[i] = GpuMemory::GetTexture2D(historyName, w, h, ResourceFormats::HISTORY,
+            D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS,
+            TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+        StackStr(momentsName, n1, "Denoiser_Moments_%d", i);
+        m_moments[i] = GpuMemory::GetTexture2D(momentsName, w, h, ResourceFormats::MOMENTS,
+            D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS,
+            TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+        StackStr(filterName, n2, "Denoiser_Filter_%d", i);
+        m_filter[i] = GpuMemory::GetTexture2D(filterName, w, h, ResourceFormats::FILTER,
+            D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS,
+            TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+        Direct3DUtil::CreateTexture2DUAV(m_history[i], m_descTable.CPUHandle(
+            (int)DESC_TABLE::HISTORY_0_UAV + i));
+        Direct3DUtil::CreateTexture2DUAV(m_moments[i], m_descTable.CPUHandle(
+            (int)DESC_TABLE::MOMENTS_0_UAV + i));
+        Direct3DUtil::CreateTexture2DUAV(m_filter[i], m_descTable.CPUHandle(
+            (int)DESC_TABLE::FILTER_0_UAV + i));
+    }
+
+    m_final = GpuMemory::GetTexture2D("Denoiser_Final", w, h, ResourceFormats::FINAL,
+        D3D12_RESOURCE_STATE_COMMON,
+        TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+    Direct3DUtil::CreateTexture2DUAV(m_final, m_descTable.CPUHandle((int)DESC_TABLE::FINAL_UAV));
+
+    // Following never change, so can be set only once
+    m_cbDenoiser.FinalDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::FINAL_UAV);
+}
+
+void Denoiser::MaxHistoryLenCallback(const Support::ParamVariant& p)
+{
+    m_cbDenoiser.MaxHistoryLen = (uint16_t)p.GetInt().m_value;
+}
+
+void Denoiser::NumIterationsCallback(const Support::ParamVariant& p)
+{
+    m_numIterations = p.GetInt().m_value;
+}
+
+void Denoiser::LumSigmaCallback(const Support::ParamVariant& p)
+{
+    m_cbDenoiser.LumSigma = p.GetFloat().m_value;
+}
+
+void Denoiser::ReloadTemporalPass()
+{
+    const int i = (int)SHADER::TEMPORAL;
+    m_psoLib.Reload(i, m_rootSigObj.Get(), "Denoiser\\Denoiser_Temporal.hlsl");
+}
+
+void Denoiser::ReloadATrousPass()
+{
+    const int i = (int)SHADER::ATROUS;
+    m_psoLib.Reload(i, m_rootSigObj.Get(), "Denoiser\\Denoiser_ATrous.hlsl");
+}
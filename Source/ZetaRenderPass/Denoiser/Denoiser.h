@@ -0,0 +1,126 @@
+#pragma once
+
+#include "../RenderPass.h"
+#include <Core/GpuMemory.h>
+#include "Denoiser_Common.h"
+
+namespace ZetaRay::Core
+{
+    class CommandList;
+}
+
+namespace ZetaRay::Support
+{
+    struct ParamVariant;
+}
+
+namespace ZetaRay::RenderPass
+{
+    enum class DENOISER_SHADER
+    {
+        TEMPORAL,
+        ATROUS,
+        COUNT
+    };
+
+    // Spatiotemporal variance-guided filter (SVGF) for indirect lighting. Signal is
+    // demodulated by albedo and accumulated over time along with its luminance moments,
+    // then filtered by a few iterations of an edge-avoiding a-trous wavelet filter that
+    // is guided by the g-buffer and the estimated variance.
+    struct Denoiser final : public RenderPassBase<(int)DENOISER_SHADER::COUNT>
+    {
+        enum class SHADER_IN_DESC
+        {
+            SIGNAL,
+            COUNT
+        };
+
+        enum class SHADER_OUT_RES
+        {
+            DENOISED,
+            COUNT
+        };
+
+        Denoiser();
+        ~Denoiser() = default;
+
+        void Init();
+        void OnWindowResized();
+        void ResetTemporal() { m_isTemporalValid = false; }
+        void SetDescriptor(SHADER_IN_DESC i, uint32_t heapIdx)
+        {
+            Assert(i == SHADER_IN_DESC::SIGNAL, "Invalid shader input.");
+            m_cbDenoiser.SignalDescHeapIdx = heapIdx;
+        }
+        const Core::GpuMemory::Texture& GetOutput(SHADER_OUT_RES i) const
+        {
+            Assert(i == SHADER_OUT_RES::DENOISED, "Invalid shader output.");
+            return m_final;
+        }
+        void Render(Core::CommandList& cmdList);
+
+    private:
+        static constexpr int NUM_CBV = 1;
+        static constexpr int NUM_SRV = 0;
+        static constexpr int NUM_UAV = 0;
+        static constexpr int NUM_GLOBS = 1;
+        static constexpr int NUM_CONSTS = (int)(sizeof(cbDenoiser) / sizeof(DWORD));
+        using SHADER = DENOISER_SHADER;
+
+        struct ResourceFormats
+        {
+            static constexpr DXGI_FORMAT HISTORY = DXGI_FORMAT_R16G16B16A16_FLOAT;
+            static constexpr DXGI_FORMAT MOMENTS = DXGI_FORMAT_R32G32_FLOAT;
+            static constexpr DXGI_FORMAT FILTER = DXGI_FORMAT_R16G16B16A16_FLOAT;
+            // Same as integrators' output, which may hold accumulated sums
+            static constexpr DXGI_FORMAT FINAL = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        };
+
+        enum class DESC_TABLE
+        {
+            HISTORY_0_UAV,
+            HISTORY_1_UAV,
+            MOMENTS_0_UAV,
+            MOMENTS_1_UAV,
+            FILTER_0_UAV,
+            FILTER_1_UAV,
+            FINAL_UAV,
+            COUNT
+        };
+
+        struct DefaultParamVals
+        {
+            static constexpr int MAX_HISTORY_LEN = 32;
+            static constexpr int NUM_ATROUS_ITERATIONS = 4;
+            static constexpr float LUM_SIGMA = 4.0f;
+        };
+
+        inline static constexpr const char* COMPILED_CS[(int)SHADER::COUNT] = {
+            "Denoiser_Temporal_cs.cso",
+            "Denoiser_ATrous_cs.cso"
+        };
+
+        void CreateResources();
+        void MaxHistoryLenCallback(const Support::ParamVariant& p);
+        void NumIterationsCallback(const Support::ParamVariant& p);
+        void LumSigmaCallback(const Support::ParamVariant& p);
+
+        // shader reload
+        void ReloadTemporalPass();
+        void ReloadATrousPass();
+
+        // Texture2D<float4>: (demodulated color, history length)
+        Core::GpuMemory::Texture m_history[2];
+        // Texture2D<float2>: first and second moments of luminance
+        Core::GpuMemory::Texture m_moments[2];
+        // Texture2D<float4>: (demodulated color, variance), ping-pong between a-trous iterations
+        Core::GpuMemory::Texture m_filter[2];
+        Core::GpuMemory::Texture m_final;
+        Core::DescriptorTable m_descTable;
+
+        cbDenoiser m_cbDenoiser;
+        int m_numIterations = DefaultParamVals::NUM_ATROUS_ITERATIONS;
+        int m_currTemporalIdx = 0;
+        bool m_isTemporalValid = false;
+    };
+}
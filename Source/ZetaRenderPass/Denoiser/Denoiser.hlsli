@@ -0,0 +1,35 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include "Denoiser_Common.h"
+#include "../Common/Math.hlsli"
+#include "../Common/GBuffers.hlsli"
+#include "../Common/FrameConstants.h"
+
+namespace Denoiser
+{
+    // Indirect lighting is divided by this before filtering and multiplied by it
+    // afterwards. Since integrators output diffuse and specular combined, base color is
+    // used for both -- for metals it's the specular albedo and remodulation restores the
+    // (untinted) dielectric specular exactly anyway.
+    float3 Albedo(uint2 pixel, uint gbuffDescHeapOffset)
+    {
+        const float3 baseColor = GBuffer::LoadBaseColor(pixel, gbuffDescHeapOffset).rgb;
+        return max(baseColor, DENOISER_MIN_ALBEDO);
+    }
+
+    bool PlaneHeuristic(float3 samplePos, float3 normal, float3 pos, float linearDepth)
+    {
+        const float planeDist = abs(dot(normal, samplePos - pos));
+        return planeDist <= DENOISER_MAX_PLANE_DIST * linearDepth;
+    }
+
+    // When accumulating, integrators output running sums that are averaged during
+    // compositing, so the signal is passed through unchanged
+    bool IsAccumulating(ConstantBuffer<cbFrameConstants> frame)
+    {
+        return frame.Accumulate && frame.CameraStatic;
+    }
+}
+
+#endif
@@ -0,0 +1,161 @@
+// Refs:
+// 1. H. Dammertz, D. Sewtz, J. Hanika and H. Lensch, "Edge-Avoiding A-Trous Wavelet
+//    Transform for fast Global Illumination Filtering," High Performance Graphics, 2010.
+// 2. C. Schied et al., "Spatiotemporal Variance-Guided Filtering: Real-Time Reconstruction
+//    for Path-Traced Global Illumination," High Performance Graphics, 2017.
+
+#include "Denoiser.hlsli"
+#include "../Common/Common.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b0);
+ConstantBuffer<cbDenoiser> g_local : register(b1);
+
+// 1D B3-spline coefficients for offsets 0, 1 and 2
+static const float KERNEL[3] = { 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// Variance is prefiltered with a 3x3 Gaussian, which makes the luminance edge-stopping
+// function more robust
+float FilteredVariance(int2 DTid, RWTexture2D<float4> g_input)
+{
+    const float gaussian[2] = { 1.0f / 4.0f, 1.0f / 8.0f };
+    float sum = 0;
+    float weightSum = 0;
+
+    [unroll]
+    for (int i = -1; i <= 1; i++)
+    {
+        [unroll]
+        for (int j = -1; j <= 1; j++)
+        {
+            const int2 q = DTid + int2(j, i);
+
+            if (any(q < 0) || q.x >= (int)g_frame.RenderWidth || q.y >= (int)g_frame.RenderHeight)
+                continue;
+
+            const float w = gaussian[abs(i)] * gaussian[abs(j)];
+            sum += w * g_input[q].a;
+            weightSum += w;
+        }
+    }
+
+    return sum / weightSum;
+}
+
+float4 Filter(int2 DTid, float roughness, RWTexture2D<float4> g_input)
+{
+    const float4 center = g_input[DTid];
+    const float lum = Math::Luminance(center.rgb);
+    const float phi_l = g_local.LumSigma * sqrt(FilteredVariance(DTid, g_input)) + 1e-6f;
+
+    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
+        GBUFFER_OFFSET::DEPTH];
+    const float z_view = g_depth[DTid];
+    const float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
+    const float3 pos = Math::WorldPosFromScreenSpace(DTid, renderDim, z_view,
+        g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrViewInv,
+        g_frame.CurrCameraJitter);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(DTid,
+        g_frame.CurrGBufferDescHeapOffset));
+
+    float weightSum = KERNEL[0] * KERNEL[0];
+    float3 colorSum = weightSum * center.rgb;
+    // Variance of a weighted sum of (assumed) independent samples
+    float varianceSum = weightSum * weightSum * center.a;
+
+    [unroll]
+    for (int i = -2; i <= 2; i++)
+    {
+        [unroll]
+        for (int j = -2; j <= 2; j++)
+        {
+            if (i == 0 && j == 0)
+                continue;
+
+            const int2 q = DTid + int2(j, i) * g_local.Step;
+
+            if (any(q < 0) || q.x >= (int)g_frame.RenderWidth || q.y >= (int)g_frame.RenderHeight)
+                continue;
+
+            const float2 mr_q = GBuffer::LoadMetallicRoughness(q, g_frame.CurrGBufferDescHeapOffset);
+            const GBuffer::Flags flags_q = GBuffer::DecodeMetallic(mr_q.x);
+
+            if (flags_q.invalid || flags_q.emissive)
+                continue;
+
+            const float4 sample_q = g_input[q];
+            const float3 pos_q = Math::WorldPosFromScreenSpace(q, renderDim, g_depth[q],
+                g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrViewInv,
+                g_frame.CurrCameraJitter);
+            const float3 normal_q = Math::DecodeUnitVector(GBuffer::LoadNormal(q,
+                g_frame.CurrGBufferDescHeapOffset));
+
+            const float planeDist = abs(dot(normal, pos_q - pos));
+            const float w_z = exp(-planeDist / (DENOISER_MAX_PLANE_DIST * max(z_view, 1e-4f)));
+            const float w_n = pow(saturate(dot(normal_q, normal)), DENOISER_NORMAL_EXP);
+            const float w_l = exp(-abs(Math::Luminance(sample_q.rgb) - lum) / phi_l);
+            const float w_r = exp(-abs(mr_q.y - roughness) / DENOISER_MAX_ROUGHNESS_DIFF);
+            const float w = KERNEL[abs(i)] * KERNEL[abs(j)] * w_z * w_n * w_l * w_r;
+
+            colorSum += w * sample_q.rgb;
+            varianceSum += w * w * sample_q.a;
+            weightSum += w;
+        }
+    }
+
+    return float4(colorSum / weightSum, varianceSum / (weightSum * weightSum));
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(DENOISER_GROUP_DIM_X, DENOISER_GROUP_DIM_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_frame.RenderWidth || DTid.y >= g_frame.RenderHeight)
+        return;
+
+    // Already written by the temporal pass
+    if (Denoiser::IsAccumulating(g_frame))
+        return;
+
+    const float2 mr = GBuffer::LoadMetallicRoughness(DTid.xy, g_frame.CurrGBufferDescHeapOffset);
+    const GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
+
+    if (flags.invalid || flags.emissive)
+        return;
+
+    RWTexture2D<float4> g_input = ResourceDescriptorHeap[g_local.InputDescHeapIdx];
+    float4 filtered;
+
+    if (mr.y < DENOISER_GLOSSY_MAX_ROUGHNESS && g_local.Step > 1)
+        filtered = g_input[DTid.xy];
+    else
+        filtered = Filter(DTid.xy, mr.y, g_input);
+
+    if (IS_CB_FLAG_SET(CB_DENOISER_FLAGS::FEEDBACK))
+    {
+        RWTexture2D<float4> g_currHistory = ResourceDescriptorHeap[g_local.CurrHistoryDescHeapIdx];
+        g_currHistory[DTid.xy].rgb = filtered.rgb;
+    }
+
+    if (IS_CB_FLAG_SET(CB_DENOISER_FLAGS::LAST_ITERATION))
+    {
+        RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
+        g_final[DTid.xy].rgb = filtered.rgb * Denoiser::Albedo(DTid.xy,
+            g_frame.CurrGBufferDescHeapOffset);
+    }
+    else
+    {
+        RWTexture2D<float4> g_output = ResourceDescriptorHeap[g_local.OutputDescHeapIdx];
+        g_output[DTid.xy] = filtered;
+    }
+}
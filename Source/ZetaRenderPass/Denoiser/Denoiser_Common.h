@@ -0,0 +1,49 @@
+#ifndef DENOISER_COMMON_H
+#define DENOISER_COMMON_H
+
+#include "../../ZetaCore/Core/HLSLCompat.h"
+
+#define DENOISER_GROUP_DIM_X 8u
+#define DENOISER_GROUP_DIM_Y 8u
+
+// Signal is divided by surface albedo before filtering so that texture detail isn't
+// blurred, albedo is clamped to this value to avoid division by zero
+#define DENOISER_MIN_ALBEDO 1e-2f
+// Below this history length, variance is estimated spatially
+#define DENOISER_MIN_HISTORY_LEN_TEMPORAL_VARIANCE 4
+#define DENOISER_MAX_PLANE_DIST 0.01f
+#define DENOISER_MAX_ROUGHNESS_DIFF 0.1f
+#define DENOISER_MIN_NORMAL_COS_TEMPORAL 0.9f
+#define DENOISER_NORMAL_EXP 128.0f
+// A-trous filter only uses the first iteration for glossy surfaces, as indirect
+// specular of smoother surfaces varies too quickly for larger footprints
+#define DENOISER_GLOSSY_MAX_ROUGHNESS 0.2f
+
+namespace CB_DENOISER_FLAGS
+{
+    static constexpr uint32_t TEMPORAL_VALID = 1 << 0;
+    // Output of the first a-trous iteration is also used as color history for next frame
+    static constexpr uint32_t FEEDBACK = 1 << 1;
+    // Last a-trous iteration remodulates and writes to final output
+    static constexpr uint32_t LAST_ITERATION = 1 << 2;
+};
+
+struct cbDenoiser
+{
+    uint32_t SignalDescHeapIdx;
+    uint32_t PrevHistoryDescHeapIdx;
+    uint32_t CurrHistoryDescHeapIdx;
+    uint32_t PrevMomentsDescHeapIdx;
+
+    uint32_t CurrMomentsDescHeapIdx;
+    uint32_t InputDescHeapIdx;
+    uint32_t OutputDescHeapIdx;
+    uint32_t FinalDescHeapIdx;
+
+    float LumSigma;
+    uint16_t MaxHistoryLen;
+    uint16_t Step;
+    uint32_t Flags;
+};
+
+#endif
@@ -0,0 +1,236 @@
+// Refs:
+// 1. C. Schied et al., "Spatiotemporal Variance-Guided Filtering: Real-Time Reconstruction
+//    for Path-Traced Global Illumination," High Performance Graphics, 2017.
+
+#include "Denoiser.hlsli"
+#include "../Common/Common.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b0);
+ConstantBuffer<cbDenoiser> g_local : register(b1);
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+struct History
+{
+    float3 Color;
+    float2 Moments;
+    float Length;
+};
+
+// Bilinear fetch of previous frame's color and moments, where taps that belong to a
+// different surface are rejected
+bool Reproject(int2 DTid, float3 pos, float3 normal, float z_view, float roughness,
+    out History h)
+{
+    h.Color = 0;
+    h.Moments = 0;
+    h.Length = 0;
+
+    GBUFFER_MOTION_VECTOR g_motionVector = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
+        GBUFFER_OFFSET::MOTION_VECTOR];
+    const float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
+    const float2 currUV = (DTid + 0.5f) / renderDim;
+    const float2 prevUV = currUV - g_motionVector[DTid];
+
+    if (any(prevUV < 0.0f) || any(prevUV > 1.0f))
+        return false;
+
+    const float2 prevPixel = prevUV * renderDim - 0.5f;
+    const int2 topLeft = (int2)floor(prevPixel);
+    const float2 f = prevPixel - topLeft;
+    const float bilinearWeights[4] = { (1.0f - f.x) * (1.0f - f.y), f.x * (1.0f - f.y),
+        (1.0f - f.x) * f.y, f.x * f.y };
+    const int2 offsets[4] = { int2(0, 0), int2(1, 0), int2(0, 1), int2(1, 1) };
+
+    GBUFFER_DEPTH g_prevDepth = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
+        GBUFFER_OFFSET::DEPTH];
+    RWTexture2D<float4> g_prevHistory = ResourceDescriptorHeap[g_local.PrevHistoryDescHeapIdx];
+    RWTexture2D<float2> g_prevMoments = ResourceDescriptorHeap[g_local.PrevMomentsDescHeapIdx];
+    float weightSum = 0;
+
+    [unroll]
+    for (int i = 0; i < 4; i++)
+    {
+        const int2 q = topLeft + offsets[i];
+
+        if (any(q < 0) || q.x >= (int)g_frame.RenderWidth || q.y >= (int)g_frame.RenderHeight)
+            continue;
+
+        const float2 mr_q = GBuffer::LoadMetallicRoughness(q, g_frame.PrevGBufferDescHeapOffset);
+        const GBuffer::Flags flags_q = GBuffer::DecodeMetallic(mr_q.x);
+
+        if (flags_q.invalid || flags_q.emissive ||
+            abs(mr_q.y - roughness) > DENOISER_MAX_ROUGHNESS_DIFF)
+            continue;
+
+        const float z_q = g_prevDepth[q];
+        const float3 pos_q = Math::WorldPosFromScreenSpace(q, renderDim, z_q,
+            g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.PrevViewInv,
+            g_frame.PrevCameraJitter);
+
+        if (!Denoiser::PlaneHeuristic(pos_q, normal, pos, z_view))
+            continue;
+
+        const float3 normal_q = Math::DecodeUnitVector(GBuffer::LoadNormal(q,
+            g_frame.PrevGBufferDescHeapOffset));
+
+        if (dot(normal_q, normal) < DENOISER_MIN_NORMAL_COS_TEMPORAL)
+            continue;
+
+        const float w = bilinearWeights[i];
+        const float4 hist = g_prevHistory[q];
+
+        h.Color += w * hist.rgb;
+        h.Length += w * hist.a;
+        h.Moments += w * g_prevMoments[q];
+        weightSum += w;
+    }
+
+    if (weightSum < 1e-3f)
+        return false;
+
+    h.Color /= weightSum;
+    h.Moments /= weightSum;
+    h.Length /= weightSum;
+
+    return true;
+}
+
+// Used for pixels with a short history, where temporal moments aren't reliable yet
+float SpatialVariance(int2 DTid, float3 pos, float3 normal, float z_view,
+    Texture2D<float4> g_signal)
+{
+    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
+        GBUFFER_OFFSET::DEPTH];
+    const float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
+
+    float m1 = 0;
+    float m2 = 0;
+    float n = 0;
+
+    for (int i = -2; i <= 2; i++)
+    {
+        for (int j = -2; j <= 2; j++)
+        {
+            const int2 q = DTid + int2(j, i);
+
+            if (any(q < 0) || q.x >= (int)g_frame.RenderWidth || q.y >= (int)g_frame.RenderHeight)
+                continue;
+
+            const float2 mr_q = GBuffer::LoadMetallicRoughness(q, g_frame.CurrGBufferDescHeapOffset);
+            const GBuffer::Flags flags_q = GBuffer::DecodeMetallic(mr_q.x);
+
+            if (flags_q.invalid || flags_q.emissive)
+                continue;
+
+            const float3 pos_q = Math::WorldPosFromScreenSpace(q, renderDim, g_depth[q],
+                g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrViewInv,
+                g_frame.CurrCameraJitter);
+
+            if (!Denoiser::PlaneHeuristic(pos_q, normal, pos, z_view))
+                continue;
+
+            const float3 c_q = g_signal[q].rgb / Denoiser::Albedo(q, g_frame.CurrGBufferDescHeapOffset);
+            const float lum_q = Math::Luminance(c_q);
+
+            m1 += lum_q;
+            m2 += lum_q * lum_q;
+            n++;
+        }
+    }
+
+    // Center pixel always passes
+    m1 /= n;
+    m2 /= n;
+
+    return max(m2 - m1 * m1, 0.0f);
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(DENOISER_GROUP_DIM_X, DENOISER_GROUP_DIM_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_frame.RenderWidth || DTid.y >= g_frame.RenderHeight)
+        return;
+
+    RWTexture2D<float4> g_currHistory = ResourceDescriptorHeap[g_local.CurrHistoryDescHeapIdx];
+    RWTexture2D<float2> g_currMoments = ResourceDescriptorHeap[g_local.CurrMomentsDescHeapIdx];
+    RWTexture2D<float4> g_filtered = ResourceDescriptorHeap[g_local.OutputDescHeapIdx];
+
+    const float2 mr = GBuffer::LoadMetallicRoughness(DTid.xy, g_frame.CurrGBufferDescHeapOffset);
+    const GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
+
+    // Don't receive indirect lighting
+    if (flags.invalid || flags.emissive)
+    {
+        g_currHistory[DTid.xy] = 0;
+        g_currMoments[DTid.xy] = 0;
+        g_filtered[DTid.xy] = 0;
+
+        return;
+    }
+
+    Texture2D<float4> g_signal = ResourceDescriptorHeap[g_local.SignalDescHeapIdx];
+    const float3 signal = g_signal[DTid.xy].rgb;
+
+    // History becomes invalid once accumulation stops
+    if (Denoiser::IsAccumulating(g_frame))
+    {
+        RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
+        g_final[DTid.xy].rgb = signal;
+
+        g_currHistory[DTid.xy] = 0;
+        g_currMoments[DTid.xy] = 0;
+
+        return;
+    }
+
+    const float3 c = signal / Denoiser::Albedo(DTid.xy, g_frame.CurrGBufferDescHeapOffset);
+    const float lum = Math::Luminance(c);
+
+    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
+        GBUFFER_OFFSET::DEPTH];
+    const float z_view = g_depth[DTid.xy];
+    const float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
+    const float3 pos = Math::WorldPosFromScreenSpace(DTid.xy, renderDim, z_view,
+        g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrViewInv,
+        g_frame.CurrCameraJitter);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(DTid.xy,
+        g_frame.CurrGBufferDescHeapOffset));
+
+    History h;
+    const bool reprojected = IS_CB_FLAG_SET(CB_DENOISER_FLAGS::TEMPORAL_VALID) &&
+        Reproject(DTid.xy, pos, normal, z_view, mr.y, h);
+
+    // Exponential moving average, which starts out as a plain average so that newly
+    // disoccluded pixels converge quickly
+    const float len = reprojected ? min(h.Length + 1, (float)g_local.MaxHistoryLen) : 1.0f;
+    const float alpha = 1.0f / len;
+    const float2 moments = float2(lum, lum * lum);
+
+    const float3 color = reprojected ? lerp(h.Color, c, alpha) : c;
+    const float2 integratedMoments = reprojected ? lerp(h.Moments, moments, alpha) : moments;
+    float variance;
+
+    if (len >= DENOISER_MIN_HISTORY_LEN_TEMPORAL_VARIANCE)
+        variance = max(integratedMoments.y - integratedMoments.x * integratedMoments.x, 0.0f);
+    else
+    {
+        variance = SpatialVariance(DTid.xy, pos, normal, z_view, g_signal);
+        // Filter more aggressively until history builds up
+        variance *= DENOISER_MIN_HISTORY_LEN_TEMPORAL_VARIANCE / len;
+    }
+
+    g_currHistory[DTid.xy] = float4(color, len);
+    g_currMoments[DTid.xy] = integratedMoments;
+    g_filtered[DTid.xy] = float4(color, variance);
+}
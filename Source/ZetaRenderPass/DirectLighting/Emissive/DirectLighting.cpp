@@ -61,6 +61,24 @@ DirectLighting::DirectLighting()
     m_rootSig.InitAsBufferSRV(7, 5, 0,
         D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
         GlobalResource::RT_FRAME_MESH_INSTANCES_CURR);
+
+    // light BVH
+    m_rootSig.InitAsBufferSRV(8, 6, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        GlobalResource::LIGHT_BVH,
+        true);
+
+    // light BVH triangle to leaf map
+    m_rootSig.InitAsBufferSRV(9, 7, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        GlobalResource::LIGHT_BVH_TRI_TO_LEAF,
+        true);
+
+    // light voxel grid
+    m_rootSig.InitAsBufferSRV(10, 8, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        GlobalResource::LIGHT_VOXEL_GRID,
+        true);
 }
 
 void DirectLighting::InitPSOs()
@@ -78,22 +96,8 @@ void DirectLighting::InitPSOs()
     auto samplers = App::GetRenderer().GetStaticSamplers();
     RenderPassBase::InitRenderPass("DirectLighting", flags, samplers);
 
-    TaskSet ts;
-
     for (int i = 0; i < (int)SHADER::COUNT; i++)
-    {
-        StackStr(buff, n, "RDI_shader_%d", i);
-
-        ts.EmplaceTask(buff, [i, this]()
-            {
-                m_psoLib.CompileComputePSO_MT(i, m_rootSigObj.Get(),
-                    COMPILED_CS[i]);
-            });
-    }
-
-    ts.Sort();
-    ts.Finalize();
-    App::Submit(ZetaMove(ts));
+        m_psoLib.EnqueueComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
 }
 
 void DirectLighting::Init()
@@ -102,6 +106,8 @@ void DirectLighting::Init()
 
     memset(&m_cbSpatioTemporal, 0, sizeof(m_cbSpatioTemporal));
     m_cbSpatioTemporal.M_max = DefaultParamVals::M_MAX;
+    m_cbSpatioTemporal.ResamplingInterval = 1;
+    m_cbSpatioTemporal.ValidationInterval = DefaultParamVals::VALIDATION_INTERVAL;
     m_cbSpatioTemporal.Alpha_min = DefaultParamVals::ROUGHNESS_MIN * DefaultParamVals::ROUGHNESS_MIN;
     SET_CB_FLAG(m_cbSpatioTemporal, CB_RDI_FLAGS::STOCHASTIC_SPATIAL, true);
     SET_CB_FLAG(m_cbSpatioTemporal, CB_RDI_FLAGS::EXTRA_DISOCCLUSION_SAMPLING, true);
@@ -125,6 +131,12 @@ void DirectLighting::Init()
         m_cbSpatioTemporal.M_max, 1, 30, 1);
     App::AddParam(maxTemporalM);
 
+    ParamVariant validationInterval;
+    validationInterval.InitInt(ICON_FA_FILM " Renderer", "Direct Lighting (Emissive)", "Visibility Revalidation Interval",
+        fastdelegate::MakeDelegate(this, &DirectLighting::ValidationIntervalCallback),
+        (int)m_cbSpatioTemporal.ValidationInterval, 1, 8, 1);
+    App::AddParam(validationInterval);
+
     ParamVariant extraDissocclusion;
     extraDissocclusion.InitBool(ICON_FA_FILM " Renderer", "Direct Lighting (Emissive)", "Extra Sampling (Disocclusion)",
         fastdelegate::MakeDelegate(this, &DirectLighting::ExtraSamplesDisocclusionCallback), 
@@ -137,6 +149,12 @@ void DirectLighting::Init()
         IS_CB_FLAG_SET(m_cbSpatioTemporal, CB_RDI_FLAGS::STOCHASTIC_SPATIAL));
     App::AddParam(stochasticSpatial);
 
+    ParamVariant groupSharedSpatial;
+    groupSharedSpatial.InitBool(ICON_FA_FILM " Renderer", "Direct Lighting (Emissive)", "Group-Shared Spatial",
+        fastdelegate::MakeDelegate(this, &DirectLighting::GroupSharedSpatialCallback), 
+        m_groupSharedSpatial);
+    App::AddParam(groupSharedSpatial);
+
     ParamVariant alphaMin;
     alphaMin.InitFloat(ICON_FA_FILM " Renderer", "Direct Lighting (Emissive)", "Alpha_min",
         fastdelegate::MakeDelegate(this, &DirectLighting::AlphaMinCallback),
@@ -151,6 +169,7 @@ void DirectLighting::Init()
 
 void DirectLighting::OnWindowResized()
 {
+    m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
     CreateOutputs();
     m_isTemporalReservoirValid = false;
     m_currTemporalIdx = 0;
@@ -188,6 +207,11 @@ void DirectLighting::Render(CommandList& cmdList)
     SET_CB_FLAG(m_cbSpatioTemporal, CB_RDI_FLAGS::TEMPORAL_RESAMPLE, doTemporal);
     SET_CB_FLAG(m_cbSpatioTemporal, CB_RDI_FLAGS::SPATIAL_RESAMPLE, doSpatial);
 
+    // Moving geometry or lights may change visibility anywhere
+    const auto& scene = App::GetScene();
+    SET_CB_FLAG(m_cbSpatioTemporal, CB_RDI_FLAGS::REVALIDATE_ALL, scene.AreInstancesUpdated() ||
+        scene.AreEmissivePositionsUpdated());
+
     m_cbSpatioTemporal.DispatchDimX = (uint16_t)dispatchDimX;
     m_cbSpatioTemporal.DispatchDimY = (uint16_t)dispatchDimY;
     m_cbSpatioTemporal.NumGroupsInTile = RESTIR_DI_TILE_WIDTH * m_cbSpatioTemporal.DispatchDimY;
@@ -240,7 +264,9 @@ void DirectLighting::Render(CommandList& cmdList)
         m_rootSig.SetRootConstants(0, sizeof(m_cbSpatioTemporal) / sizeof(DWORD), &m_cbSpatioTemporal);
         m_rootSig.End(computeCmdList);
 
-        auto sh = m_preSampling ? SHADER::TEMPORAL_LIGHT_PRESAMPLING : SHADER::TEMPORAL;
+        auto sh = m_lightBVH ? SHADER::TEMPORAL_LIGHT_BVH :
+            (m_preSampling ? (m_useLVG ? SHADER::TEMPORAL_LVG : SHADER::TEMPORAL_LIGHT_PRESAMPLING) : 
+            SHADER::TEMPORAL);
         computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
         computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 
@@ -271,7 +297,8 @@ void DirectLighting::Render(CommandList& cmdList)
         m_rootSig.SetRootConstants(0, sizeof(m_cbSpatioTemporal) / sizeof(DWORD), &m_cbSpatioTemporal);
         m_rootSig.End(computeCmdList);
 
-        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::SPATIAL));
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO(m_groupSharedSpatial ? 
+            (int)SHADER::SPATIAL_GROUP_SHARED : (int)SHADER::SPATIAL));
         computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 
         gpuTimer.EndQuery(computeCmdList, queryIdx);
@@ -306,7 +333,7 @@ void DirectLighting::CreateOutputs()
 
     list.End();
 
-    m_resHeap = GpuMemory::GetResourceHeap(list.TotalSizeInBytes());
+    m_resHeap = GpuMemory::GetResourceHeap("DirectLighting", list.TotalSizeInBytes());
     auto allocs = list.AllocInfos();
     int currRes = 0;
 
@@ -389,6 +416,11 @@ void DirectLighting::MaxTemporalMCallback(const Support::ParamVariant& p)
     App::GetScene().SceneModified();
 }
 
+void DirectLighting::ValidationIntervalCallback(const Support::ParamVariant& p)
+{
+    m_cbSpatioTemporal.ValidationInterval = (uint32_t)p.GetInt().m_value;
+}
+
 void DirectLighting::ExtraSamplesDisocclusionCallback(const Support::ParamVariant& p)
 {
     SET_CB_FLAG(m_cbSpatioTemporal, CB_RDI_FLAGS::EXTRA_DISOCCLUSION_SAMPLING, p.GetBool());
@@ -401,6 +433,12 @@ void DirectLighting::StochasticSpatialCallback(const Support::ParamVariant& p)
     App::GetScene().SceneModified();
 }
 
+void DirectLighting::GroupSharedSpatialCallback(const Support::ParamVariant& p)
+{
+    m_groupSharedSpatial = p.GetBool();
+    App::GetScene().SceneModified();
+}
+
 void DirectLighting::AlphaMinCallback(const Support::ParamVariant& p)
 {
     float newVal = p.GetFloat().m_value;
@@ -411,6 +449,22 @@ void DirectLighting::AlphaMinCallback(const Support::ParamVariant& p)
 
 void DirectLighting::ReloadTemporal()
 {
+    if (m_lightBVH)
+    {
+        m_psoLib.Reload((int)SHADER::TEMPORAL_LIGHT_BVH, m_rootSigObj.Get(), 
+            "DirectLighting\\Emissive\\ReSTIR_DI_Temporal_LBVH.hlsl");
+
+        return;
+    }
+
+    if (m_preSampling && m_useLVG)
+    {
+        m_psoLib.Reload((int)SHADER::TEMPORAL_LVG, m_rootSigObj.Get(), 
+            "DirectLighting\\Emissive\\ReSTIR_DI_Temporal_LVG.hlsl");
+
+        return;
+    }
+
     const int i = m_preSampling ? (int)SHADER::TEMPORAL_LIGHT_PRESAMPLING :
         (int)SHADER::TEMPORAL;
 
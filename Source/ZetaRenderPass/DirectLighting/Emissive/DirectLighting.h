@@ -21,7 +21,10 @@ namespace ZetaRay::RenderPass
     {
         TEMPORAL,
         TEMPORAL_LIGHT_PRESAMPLING,
+        TEMPORAL_LIGHT_BVH,
+        TEMPORAL_LVG,
         SPATIAL,
+        SPATIAL_GROUP_SHARED,
         COUNT
     };
 
@@ -49,6 +52,31 @@ namespace ZetaRay::RenderPass
             m_cbSpatioTemporal.NumSampleSets = enabled ? (uint16_t)numSampleSets : 0;
             m_cbSpatioTemporal.SampleSetSize = enabled ? (uint16_t)sampleSetSize : 0;
         }
+        void SetLightBVH(bool enabled) { m_lightBVH = enabled; }
+        // Pixels are fully resampled once every "interval" (1, 2 or 4) frames, the rest 
+        // only reuse their temporal reservoir
+        void SetResamplingInterval(uint32_t interval)
+        {
+            Assert(interval == 1 || interval == 2 || interval == 4, "Invalid resampling interval.");
+            m_cbSpatioTemporal.ResamplingInterval = (uint16_t)interval;
+        }
+        // Initial light candidates are drawn from the light voxel grid cell that contains 
+        // each pixel, falling back to presampled sets outside the grid
+        void SetLightVoxelGridParams(bool enabled, const Math::uint3& dim, 
+            const Math::float3& extents, float offset_y)
+        {
+            Assert(!enabled || (dim.x > 0 && dim.y > 0 && dim.z > 0
+                && extents.x > 0 && extents.y > 0 && extents.z > 0), "LVG is enabled, but the dimension is invalid.");
+            Assert(!enabled || m_preSampling, "LVG can't be used while light presampling is disabled.");
+
+            m_useLVG = enabled;
+            m_cbSpatioTemporal.GridDim_xy = (dim.y << 16) | dim.x;
+            m_cbSpatioTemporal.GridDim_z = dim.z;
+
+            Math::half4 extH(extents.x, extents.y, extents.z, offset_y);
+            m_cbSpatioTemporal.Extents_xy = (extH.y << 16) | extH.x;
+            m_cbSpatioTemporal.Extents_z_Offset_y = (extH.w << 16) | extH.z;
+        }
         const Core::GpuMemory::Texture& GetOutput(SHADER_OUT_RES i) const
         {
             Assert(i == SHADER_OUT_RES::FINAL, "Invalid shader output.");
@@ -58,9 +86,9 @@ namespace ZetaRay::RenderPass
 
     private:
         static constexpr int NUM_CBV = 1;
-        static constexpr int NUM_SRV = 6;
+        static constexpr int NUM_SRV = 9;
         static constexpr int NUM_UAV = 0;
-        static constexpr int NUM_GLOBS = 7;
+        static constexpr int NUM_GLOBS = 10;
         static constexpr int NUM_CONSTS = (int)(sizeof(cb_ReSTIR_DI) / sizeof(DWORD));
         using SHADER = DIRECT_SHADER;
 
@@ -93,6 +121,8 @@ namespace ZetaRay::RenderPass
         struct DefaultParamVals
         {
             static constexpr int M_MAX = 20;
+            // Visibility of reused temporal samples is retraced every frame
+            static constexpr int VALIDATION_INTERVAL = 1;
             // Use half-vector copy for anything lower
             static constexpr float ROUGHNESS_MIN = 0.05f;
         };
@@ -100,7 +130,10 @@ namespace ZetaRay::RenderPass
         inline static constexpr const char* COMPILED_CS[(int)SHADER::COUNT] = {
             "ReSTIR_DI_Temporal_cs.cso",
             "ReSTIR_DI_Temporal_WPS_cs.cso",
-            "ReSTIR_DI_Spatial_cs.cso"
+            "ReSTIR_DI_Temporal_LBVH_cs.cso",
+            "ReSTIR_DI_Temporal_LVG_cs.cso",
+            "ReSTIR_DI_Spatial_cs.cso",
+            "ReSTIR_DI_Spatial_Shared_cs.cso"
         };
 
         struct Reservoir
@@ -121,8 +154,10 @@ namespace ZetaRay::RenderPass
         void TemporalResamplingCallback(const Support::ParamVariant& p);
         void SpatialResamplingCallback(const Support::ParamVariant& p);
         void MaxTemporalMCallback(const Support::ParamVariant& p);
+        void ValidationIntervalCallback(const Support::ParamVariant& p);
         void ExtraSamplesDisocclusionCallback(const Support::ParamVariant& p);
         void StochasticSpatialCallback(const Support::ParamVariant& p);
+        void GroupSharedSpatialCallback(const Support::ParamVariant& p);
         void AlphaMinCallback(const Support::ParamVariant& p);
 
         // shader reload
@@ -139,6 +174,11 @@ namespace ZetaRay::RenderPass
         bool m_temporalResampling = true;
         bool m_spatialResampling = true;
         bool m_preSampling = false;
+        bool m_lightBVH = false;
+        bool m_useLVG = false;
+        // Spatial neighbors are limited to the thread group's tile and read from group 
+        // shared memory
+        bool m_groupSharedSpatial = false;
 
         cb_ReSTIR_DI m_cbSpatioTemporal;
     };
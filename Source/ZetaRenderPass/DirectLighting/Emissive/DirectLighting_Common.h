@@ -16,6 +16,8 @@ namespace CB_RDI_FLAGS
     static constexpr uint32_t STOCHASTIC_SPATIAL = 1 << 2;
     static constexpr uint32_t EXTRA_DISOCCLUSION_SAMPLING = 1 << 3;
     static constexpr uint32_t RESET_TEMPORAL_TEXTURES = 1 << 4;
+    // Scene changed in a way that may affect visibility of every reused sample
+    static constexpr uint32_t REVALIDATE_ALL = 1 << 5;
 };
 
 struct cb_ReSTIR_DI
@@ -34,7 +36,17 @@ struct cb_ReSTIR_DI
     uint16_t DispatchDimX;
     uint16_t DispatchDimY;
     uint16_t NumGroupsInTile;
-    uint16_t pad;
+    // Every pixel is fully resampled once in this many frames
+    uint16_t ResamplingInterval;
+
+    // Light voxel grid -- extents and offset are stored as half
+    uint32_t Extents_xy;
+    uint32_t Extents_z_Offset_y;
+    uint32_t GridDim_xy;
+    uint32_t GridDim_z;
+
+    // Visibility of reused temporal samples is retraced once in this many frames
+    uint32_t ValidationInterval;
 };
 
 #endif
@@ -1,4 +1,8 @@
+#ifdef GROUP_SHARED_SPATIAL
+#include "SharedNeighbors.hlsli"
+#else
 #include "Resampling.hlsli"
+#endif
 #include "../../Common/Common.hlsli"
 #include "../../Common/BSDFSampling.hlsli"
 
@@ -39,12 +43,17 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     const uint2 swizzledGid = Gid.xy;
 #endif
 
+#ifdef GROUP_SHARED_SPATIAL
+    SharedNeighbors::Store(swizzledDTid, GTid.xy, g_local.CurrReservoir_A_DescHeapIdx, 
+        g_local.CurrReservoir_A_DescHeapIdx + 1, g_frame);
+    GroupMemoryBarrierWithGroupSync();
+#endif
+
     if (swizzledDTid.x >= g_frame.RenderWidth || swizzledDTid.y >= g_frame.RenderHeight)
         return;
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr = g_metallicRoughness[swizzledDTid];
+    const float2 mr = GBuffer::LoadMetallicRoughness(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
 
     if (flags.invalid)
@@ -69,9 +78,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         return;
     }
 
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_normal[swizzledDTid.xy]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(swizzledDTid.xy, 
+        g_frame.CurrGBufferDescHeapOffset));
 
     GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
         GBUFFER_OFFSET::DEPTH];
@@ -92,20 +100,15 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz, 
         g_frame.DoF, lensSample, g_frame.FocusDepth, origin);
 
-    GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
-    const float4 baseColor = flags.subsurface ? g_baseColor[swizzledDTid] :
-        float4(g_baseColor[swizzledDTid].rgb, 0);
+    float4 baseColor = GBuffer::LoadBaseColor(swizzledDTid, g_frame.CurrGBufferDescHeapOffset);
+    baseColor.a = flags.subsurface ? baseColor.a : 0;
 
     float eta_curr = ETA_AIR;
     float eta_next = DEFAULT_ETA_MAT;
 
     if(flags.transmissive)
     {
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
-
-        float ior = g_ior[swizzledDTid];
+        float ior = GBuffer::LoadIOR(swizzledDTid, g_frame.CurrGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
@@ -116,9 +119,7 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
 
     if(flags.coated)
     {
-        GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::COAT];
-        uint3 packed = g_coat[swizzledDTid].xyz;
+        uint3 packed = GBuffer::LoadCoat(swizzledDTid, g_frame.CurrGBufferDescHeapOffset);
 
         GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
         coat_weight = coat.weight;
@@ -174,10 +175,23 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         MIN_NUM_SPATIAL_SAMPLES;
     numSamples = !disoccluded ? numSamples : MAX_NUM_SPATIAL_SAMPLES;
 
-    RDI_Util::SpatialResample(swizzledDTid, numSamples, SPATIAL_SEARCH_RADIUS, pos, 
-        normal, z_view, mr.y, surface, g_local.Alpha_min, g_local.CurrReservoir_A_DescHeapIdx, 
-        g_local.CurrReservoir_A_DescHeapIdx + 1, g_frame, g_bvh, g_emissives, g_frameMeshData,
-        r, rng_thread);
+    // Pixels that aren't scheduled this frame keep their temporally reused reservoir
+    if(disoccluded || Common::IsPixelScheduled(swizzledDTid, g_frame.FrameNum, 
+        g_local.ResamplingInterval))
+    {
+#ifdef GROUP_SHARED_SPATIAL
+        const uint2 groupStart = swizzledGid * 
+            uint2(RESTIR_DI_TEMPORAL_GROUP_DIM_X, RESTIR_DI_TEMPORAL_GROUP_DIM_Y);
+        RDI_Util::SpatialResample_Shared(GTid.xy, groupStart, numSamples, pos, normal, z_view, 
+            mr.y, surface, g_local.Alpha_min, g_frame, g_bvh, g_emissives, g_frameMeshData, 
+            r, rng_thread);
+#else
+        RDI_Util::SpatialResample(swizzledDTid, numSamples, SPATIAL_SEARCH_RADIUS, pos, 
+            normal, z_view, mr.y, surface, g_local.Alpha_min, g_local.CurrReservoir_A_DescHeapIdx, 
+            g_local.CurrReservoir_A_DescHeapIdx + 1, g_frame, g_bvh, g_emissives, g_frameMeshData,
+            r, rng_thread);
+#endif
+    }
 
     float3 li = r.target * r.W;
     li = any(isnan(li)) ? 0 : li;
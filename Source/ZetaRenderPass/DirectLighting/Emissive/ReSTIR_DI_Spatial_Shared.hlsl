@@ -0,0 +1,2 @@
+#define GROUP_SHARED_SPATIAL
+#include "ReSTIR_DI_Spatial.hlsl"
\ No newline at end of file
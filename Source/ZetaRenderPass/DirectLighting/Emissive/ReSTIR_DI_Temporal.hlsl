@@ -1,6 +1,12 @@
 #include "Resampling.hlsli"
 #include "../../Common/Common.hlsli"
 #include "../../Common/BSDFSampling.hlsli"
+#ifdef USE_LIGHT_BVH
+#include "../../Common/LightBVH.hlsli"
+#endif
+#ifdef USE_LVG
+#include "../../Common/LightVoxelGrid.hlsli"
+#endif
 
 #define THREAD_GROUP_SWIZZLING 1
 
@@ -21,6 +27,13 @@ StructuredBuffer<RT::EmissiveLumenAliasTableEntry> g_aliasTable : register(t3);
 StructuredBuffer<RT::PresampledEmissiveTriangle> g_sampleSets : register(t4);
 #endif
 StructuredBuffer<RT::MeshInstance> g_frameMeshData : register(t5);
+#ifdef USE_LIGHT_BVH
+StructuredBuffer<RT::LightBVHNode> g_lightBVH : register(t6);
+StructuredBuffer<uint> g_lightBVHTriToLeaf : register(t7);
+#endif
+#ifdef USE_LVG
+StructuredBuffer<RT::VoxelSample> g_lvg : register(t8);
+#endif
 
 //--------------------------------------------------------------------------------------
 // Helper functions
@@ -78,7 +91,13 @@ Reservoir RIS_InitialCandidates(uint2 DTid, float3 pos, float3 normal, float rou
             // Light is backfacing
             if(dot(-wi, lightNormal) > 0)
             {
+#ifdef USE_LIGHT_BVH
+                const float lightSourcePdf = LightBVH::TrianglePdf(pos, normal, surface.Transmissive(),
+                    hitInfo.emissiveTriIdx, g_frame.NumEmissiveTriangles, 
+                    g_frame.LightBVHLog2ClusterSize, g_lightBVH, g_lightBVHTriToLeaf);
+#else
                 const float lightSourcePdf = g_aliasTable[hitInfo.emissiveTriIdx].CachedP_Orig;
+#endif
                 const float pdf_light = lightSourcePdf * (1.0f / (0.5f * twoArea));
 
                 // solid angle measure to area measure
@@ -112,27 +131,84 @@ Reservoir RIS_InitialCandidates(uint2 DTid, float3 pos, float3 normal, float rou
     }
 
     // light sampling
+#ifdef USE_LVG
+    const uint3 gridDim = uint3(g_local.GridDim_xy & 0xffff, g_local.GridDim_xy >> 16, g_local.GridDim_z);
+    const float3 gridExtents = asfloat16(uint16_t3(g_local.Extents_xy & 0xffff, g_local.Extents_xy >> 16, 
+        g_local.Extents_z_Offset_y & 0xffff));
+    const float gridOffset_y = asfloat16(uint16_t(g_local.Extents_z_Offset_y >> 16));
+#endif
+
     [loop]
     for (int s_l = 0; s_l < numLightSamples; s_l++)
     {
         // sample a light source relative to its power
 #ifdef USE_PRESAMPLED_SETS
-        RT::PresampledEmissiveTriangle tri = Light::SamplePresampledSet(sampleSetIdx, g_sampleSets, 
-            g_local.SampleSetSize, rng);
-
         Light::EmissiveTriSample lightSample;
-        lightSample.pos = tri.pos;
-        lightSample.normal = Math::DecodeOct32(tri.normal);
-        lightSample.bary = Math::DecodeUNorm2(tri.bary);
+        float3 le;
+        float pdf_light;
+        // Pdf of the light source for MIS. Differs from pdf_light for samples that were 
+        // resampled in a voxel, as the probability of drawing an arbitrary light from a 
+        // voxel isn't known, and for view-dependent presampling. MIS weights remain a 
+        // partition of unity as long as BSDF samples use the same pdf.
+        float pdf_mis;
+        uint emissiveIdx;
+        uint lightID;
+        bool doubleSided;
+
+#ifdef USE_LVG
+        RT::VoxelSample vs;
+        if(LVG::Sample(pos, gridDim, gridExtents, NUM_SAMPLES_PER_VOXEL, g_frame.CurrView, g_lvg, 
+            vs, rng, gridOffset_y))
+        {
+            lightSample.pos = vs.pos;
+            lightSample.normal = Math::DecodeOct32(vs.normal);
+            lightSample.bary = Math::DecodeUNorm2(vs.bary);
+
+            le = vs.le;
+            pdf_light = vs.pdf;
+            pdf_mis = vs.sourcePdf;
+            emissiveIdx = vs.idx;
+            lightID = vs.ID;
+            doubleSided = vs.twoSided;
+        }
+        else
+#endif
+        {
+            RT::PresampledEmissiveTriangle tri = Light::SamplePresampledSet(sampleSetIdx, g_sampleSets, 
+                g_local.SampleSetSize, rng);
+
+            lightSample.pos = tri.pos;
+            lightSample.normal = Math::DecodeOct32(tri.normal);
+            lightSample.bary = Math::DecodeUNorm2(tri.bary);
+
+            le = tri.le;
+            pdf_light = tri.pdf;
+            pdf_mis = tri.sourcePdf;
+            emissiveIdx = tri.idx;
+            lightID = tri.ID;
+            doubleSided = tri.twoSided;
+        }
 
-        float3 le = tri.le;
-        const float pdf_light = tri.pdf;
-        const uint emissiveIdx = tri.idx;
-        const uint lightID = tri.ID;
-        const bool doubleSided = tri.twoSided;
+        // Voxels where no light was accepted have an invalid sample
+        pdf_light = lightID == UINT32_MAX ? 0 : pdf_light;
 
-        if(tri.twoSided && dot(pos - tri.pos, lightSample.normal) < 0)
+        if(doubleSided && dot(pos - lightSample.pos, lightSample.normal) < 0)
             lightSample.normal = -lightSample.normal;
+#elif defined(USE_LIGHT_BVH)
+        // Pdf is zero when no light source could contribute to this point
+        LightBVH::Sample entry = LightBVH::SampleTriangle(pos, normal, surface.Transmissive(),
+            g_frame.NumEmissiveTriangles, g_frame.LightBVHLog2ClusterSize, g_lightBVH, 
+            g_lightBVHTriToLeaf, rng);
+        RT::EmissiveTriangle tri = g_emissives[entry.idx];
+        Light::EmissiveTriSample lightSample = Light::EmissiveTriSample::get(pos, tri, rng);
+
+        float3 le = entry.pdf > 0 ? Light::Le_EmissiveTriangle(tri, lightSample.bary, 
+            g_frame.EmissiveMapsDescHeapOffset) : 0;
+        const float pdf_light = entry.pdf * lightSample.pdf;
+        const float pdf_mis = pdf_light;
+        const uint emissiveIdx = entry.idx;
+        const uint lightID = tri.ID;
+        const bool doubleSided = tri.IsDoubleSided();
 #else
         Light::AliasTableSample entry = Light::AliasTableSample::get(g_aliasTable, 
             g_frame.NumEmissiveTriangles, rng);
@@ -141,6 +217,7 @@ Reservoir RIS_InitialCandidates(uint2 DTid, float3 pos, float3 normal, float rou
 
         float3 le = Light::Le_EmissiveTriangle(tri, lightSample.bary, g_frame.EmissiveMapsDescHeapOffset);
         const float pdf_light = entry.pdf * lightSample.pdf;
+        const float pdf_mis = pdf_light;
         const uint emissiveIdx = entry.idx;
         const uint lightID = tri.ID;
         const bool doubleSided = tri.IsDoubleSided();
@@ -155,7 +232,7 @@ Reservoir RIS_InitialCandidates(uint2 DTid, float3 pos, float3 normal, float rou
         surface.SetWi(wi, normal);
 
         // skip backfacing lights
-        if(dot(lightSample.normal, -wi) > 0)
+        if(dot(lightSample.normal, -wi) > 0 && pdf_light > 0)
         {
             target = le * BSDF::Unified(surface).f * dwdA;
             if (dot(target, target) > 0)
@@ -165,11 +242,12 @@ Reservoir RIS_InitialCandidates(uint2 DTid, float3 pos, float3 normal, float rou
             }
         }
 
-        // pdf_light in m_i's numerator and w_i's denominator cancel out
-        const float denom = numLightSamples * pdf_light + 
+        // pdf_light in m_i's numerator and w_i's denominator cancel out (unless the 
+        // sample came from the light voxel grid)
+        const float denom = numLightSamples * pdf_mis + 
             numBsdfSamples * BSDF::BSDFSamplerPdf_NoDiffuse(normal, surface, wi) * dwdA;
-        const float m_l = denom > 0 ? 1.0f / denom : 0;
-        const float w_l = m_l * Math::Luminance(target);
+        const float m_l = denom > 0 ? (pdf_mis / max(pdf_light, 1e-6f)) / denom : 0;
+        const float w_l = pdf_light > 0 ? m_l * Math::Luminance(target) : 0;
 
         if (r.Update(w_l, le, emissiveIdx, lightSample.bary, rng))
         {
@@ -196,8 +274,8 @@ Reservoir EstimateDirectLighting(uint2 DTid, float3 pos, float3 normal, float z_
         2 : 
         1;
 
-    Reservoir r = RIS_InitialCandidates(DTid, pos, normal, roughness, surface, sampleSetIdx,
-        numBsdfSamples, rng_thread);
+    Reservoir r = Reservoir::Init();
+    bool scheduled = Common::IsPixelScheduled(DTid, g_frame.FrameNum, g_local.ResamplingInterval);
 
     if (IS_CB_FLAG_SET(CB_RDI_FLAGS::TEMPORAL_RESAMPLE)) 
     {
@@ -210,12 +288,27 @@ Reservoir EstimateDirectLighting(uint2 DTid, float3 pos, float3 normal, float z_
         TemporalCandidate temporalCandidate = FindTemporalCandidate(DTid, pos, 
             normal, z_view, roughness, surface, prevUV, g_frame, rng_thread);
 
+        // Pixels that aren't scheduled this frame only reuse their previous reservoir,
+        // unless it's not available (e.g. disocclusion). Visibility of the shifted
+        // sample is rechecked during temporal resampling.
+        scheduled = scheduled || !temporalCandidate.valid;
+
+        if (scheduled)
+        {
+            r = RIS_InitialCandidates(DTid, pos, normal, roughness, surface, sampleSetIdx,
+                numBsdfSamples, rng_thread);
+        }
+
         if (temporalCandidate.valid)
         {
+            const bool revalidate = IS_CB_FLAG_SET(CB_RDI_FLAGS::REVALIDATE_ALL) ||
+                Common::IsVisibilityRevalidated(DTid, g_frame.FrameNum, g_local.ValidationInterval,
+                motionVec * float2(g_frame.RenderWidth, g_frame.RenderHeight));
+
             TemporalResample1(pos, normal, surface, g_local.Alpha_min, 
                 temporalCandidate, g_local.PrevReservoir_A_DescHeapIdx, 
                 g_local.PrevReservoir_A_DescHeapIdx + 1, g_frame, 
-                g_bvh, g_bvh_prev, g_emissives, g_frameMeshData,
+                g_bvh, g_bvh_prev, g_emissives, g_frameMeshData, revalidate,
                 r, rng_thread);
         }
 
@@ -226,6 +319,11 @@ Reservoir EstimateDirectLighting(uint2 DTid, float3 pos, float3 normal, float z_
             r.WriteTarget(DTid, g_local.TargetDescHeapIdx);
         }
     }
+    else
+    {
+        r = RIS_InitialCandidates(DTid, pos, normal, roughness, surface, sampleSetIdx,
+            numBsdfSamples, rng_thread);
+    }
 
     if (IS_CB_FLAG_SET(CB_RDI_FLAGS::TEMPORAL_RESAMPLE) ||
         IS_CB_FLAG_SET(CB_RDI_FLAGS::RESET_TEMPORAL_TEXTURES)) 
@@ -264,9 +362,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     if (swizzledDTid.x >= g_frame.RenderWidth || swizzledDTid.y >= g_frame.RenderHeight)
         return;
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr = g_metallicRoughness[swizzledDTid];
+    const float2 mr = GBuffer::LoadMetallicRoughness(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
 
     RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
@@ -302,9 +399,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         return;
     }
 
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_normal[swizzledDTid.xy]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(swizzledDTid.xy, 
+        g_frame.CurrGBufferDescHeapOffset));
 
     GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
         GBUFFER_OFFSET::DEPTH];
@@ -325,20 +421,15 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz, 
         g_frame.DoF, lensSample, g_frame.FocusDepth, origin);
 
-    GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
-    const float4 baseColor = flags.subsurface ? g_baseColor[swizzledDTid] :
-        float4(g_baseColor[swizzledDTid].rgb, 0);
+    float4 baseColor = GBuffer::LoadBaseColor(swizzledDTid, g_frame.CurrGBufferDescHeapOffset);
+    baseColor.a = flags.subsurface ? baseColor.a : 0;
 
     float eta_curr = ETA_AIR;
     float eta_next = DEFAULT_ETA_MAT;
 
     if(flags.transmissive)
     {
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
-
-        float ior = g_ior[swizzledDTid];
+        float ior = GBuffer::LoadIOR(swizzledDTid, g_frame.CurrGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
@@ -349,9 +440,7 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
 
     if(flags.coated)
     {
-        GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::COAT];
-        uint3 packed = g_coat[swizzledDTid].xyz;
+        uint3 packed = GBuffer::LoadCoat(swizzledDTid, g_frame.CurrGBufferDescHeapOffset);
 
         GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
         coat_weight = coat.weight;
@@ -0,0 +1,2 @@
+#define USE_LIGHT_BVH
+#include "ReSTIR_DI_Temporal.hlsl"
\ No newline at end of file
@@ -0,0 +1,3 @@
+#define USE_PRESAMPLED_SETS
+#define USE_LVG
+#include "ReSTIR_DI_Temporal.hlsl"
\ No newline at end of file
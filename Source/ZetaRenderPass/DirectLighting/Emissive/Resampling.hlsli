@@ -45,9 +45,8 @@ namespace RDI_Util
         const float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
         const int2 prevPixel = prevUV * renderDim;
 
-        GBUFFER_METALLIC_ROUGHNESS g_prevMR = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-        const float2 prevMR = g_prevMR[prevPixel];
+        const float2 prevMR = GBuffer::LoadMetallicRoughness(prevPixel, 
+            g_frame.PrevGBufferDescHeapOffset);
         GBuffer::Flags prevFlags = GBuffer::DecodeMetallic(prevMR.x);
 
         if(prevFlags.invalid || 
@@ -78,25 +77,19 @@ namespace RDI_Util
         if(!RDI_Util::PlaneHeuristic(prevPos, normal, pos, prevViewDepth, MAX_PLANE_DIST_REUSE))
             return candidate;
 
-        GBUFFER_NORMAL g_prevNormal = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::NORMAL];
-        const float3 prevNormal = Math::DecodeUnitVector(g_prevNormal[prevPixel]);
+        const float3 prevNormal = Math::DecodeUnitVector(GBuffer::LoadNormal(prevPixel, 
+            g_frame.PrevGBufferDescHeapOffset));
             
         float prevEta_next = DEFAULT_ETA_MAT;
 
         if(prevFlags.transmissive)
         {
-            GBUFFER_IOR g_prevIOR = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-                GBUFFER_OFFSET::IOR];
-
-            float ior = g_prevIOR[prevPixel];
+            float ior = GBuffer::LoadIOR(prevPixel, g_frame.PrevGBufferDescHeapOffset);
             prevEta_next = GBuffer::DecodeIOR(ior);
         }
 
-        GBUFFER_BASE_COLOR g_prevBaseColor = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::BASE_COLOR];
-        const float4 prevBaseColor = prevFlags.subsurface ? g_prevBaseColor[prevPixel] :
-            float4(g_prevBaseColor[prevPixel].rgb, 0);
+        float4 prevBaseColor = GBuffer::LoadBaseColor(prevPixel, g_frame.PrevGBufferDescHeapOffset);
+        prevBaseColor.a = prevFlags.subsurface ? prevBaseColor.a : 0;
 
         float prev_coat_weight = 0;
         float3 prev_coat_color = 0.0f;
@@ -105,9 +98,7 @@ namespace RDI_Util
 
         if(prevFlags.coated)
         {
-            GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-                GBUFFER_OFFSET::COAT];
-            uint3 packed = g_coat[prevPixel].xyz;
+            uint3 packed = GBuffer::LoadCoat(prevPixel, g_frame.PrevGBufferDescHeapOffset);
 
             GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
             prev_coat_weight = coat.weight;
@@ -207,7 +198,8 @@ namespace RDI_Util
         BSDF::ShadingData surface, float3 wh, ConstantBuffer<cbFrameConstants> g_frame,
         RaytracingAccelerationStructure g_bvh,
         StructuredBuffer<RT::EmissiveTriangle> g_emissives,
-        StructuredBuffer<RT::MeshInstance> g_frameMeshData)
+        StructuredBuffer<RT::MeshInstance> g_frameMeshData,
+        bool testVisibility)
     {
         if(!IsShiftInvertible(r_prev, surface, alpha_min))
             return 0;
@@ -264,7 +256,7 @@ namespace RDI_Util
         }
 
         target_offset *= BSDF::Unified(surface).f;
-        if(!r_prev.halfVectorCopyShift && dot(target_offset, target_offset) > 0)
+        if(testVisibility && !r_prev.halfVectorCopyShift && dot(target_offset, target_offset) > 0)
         {
             target_offset *= RtRayQuery::Visibility_Segment(pos, wi_offset, t_offset, normal, 
                 lightID, g_bvh, surface.Transmissive());
@@ -278,7 +270,7 @@ namespace RDI_Util
         uint prevReservoir_B_DescHeapIdx, ConstantBuffer<cbFrameConstants> g_frame, 
         RaytracingAccelerationStructure g_bvh, RaytracingAccelerationStructure g_bvh_prev,
         StructuredBuffer<RT::EmissiveTriangle> g_emissives,
-        StructuredBuffer<RT::MeshInstance> g_frameMeshData,
+        StructuredBuffer<RT::MeshInstance> g_frameMeshData, bool revalidate,
         inout Reservoir r_curr, inout RNG rng)
     {
         Reservoir r_prev = Reservoir::Load(candidate.posSS,
@@ -311,8 +303,9 @@ namespace RDI_Util
             float jacobian = whdotwo_prev > 0 ? whdotwo_curr / whdotwo_prev : 0;
             jacobian = r_prev.halfVectorCopyShift ? jacobian : 1;
 
+            // When not revalidated, previous sample is assumed to still be visible
             const float3 target_curr = OffsetPathTarget_TtC(r_prev, pos, normal, alpha_min, surface,
-                wh_curr, g_frame, g_bvh, g_emissives, g_frameMeshData);
+                wh_curr, g_frame, g_bvh, g_emissives, g_frameMeshData, revalidate);
             const float targetLum_curr = Math::Luminance(target_curr);
 
             // w_prev becomes zero and only M needs to be updated, which is done at the end anyway
@@ -383,14 +376,8 @@ namespace RDI_Util
             half2(0.341006, 0.827133)
         };
 
-        GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::NORMAL];
         GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
             GBUFFER_OFFSET::DEPTH];
-        GBUFFER_METALLIC_ROUGHNESS g_mr = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-        GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::BASE_COLOR];
 
         // rotate sample sequence per pixel
         const float u0 = rng.Uniform();
@@ -424,7 +411,8 @@ namespace RDI_Util
 
             if (Math::IsWithinBounds(posSS_i, renderDim))
             {
-                const float2 mr_i = g_mr[posSS_i];
+                const float2 mr_i = GBuffer::LoadMetallicRoughness(posSS_i, 
+                    g_frame.CurrGBufferDescHeapOffset);
                 GBuffer::Flags flags_i = GBuffer::DecodeMetallic(mr_i.x);
 
                 if(flags_i.invalid || flags_i.emissive)
@@ -468,18 +456,17 @@ namespace RDI_Util
 
         for (int i = 0; i < k; i++)
         {
-            const float3 sampleNormal = Math::DecodeUnitVector(g_normal[samplePosSS[i]]);
-            const float4 sampleBaseColor = sampleSubsurf[i] ? g_baseColor[samplePosSS[i]] :
-                float4(g_baseColor[samplePosSS[i]].rgb, 0);
+            const float3 sampleNormal = Math::DecodeUnitVector(GBuffer::LoadNormal(samplePosSS[i], 
+                g_frame.CurrGBufferDescHeapOffset));
+            float4 sampleBaseColor = GBuffer::LoadBaseColor(samplePosSS[i], 
+                g_frame.CurrGBufferDescHeapOffset);
+            sampleBaseColor.a = sampleSubsurf[i] ? sampleBaseColor.a : 0;
 
             float sampleEta_next = DEFAULT_ETA_MAT;
 
             if(sampleTr[i])
             {
-                GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-                    GBUFFER_OFFSET::IOR];
-
-                float ior = g_ior[samplePosSS[i]];
+                float ior = GBuffer::LoadIOR(samplePosSS[i], g_frame.CurrGBufferDescHeapOffset);
                 sampleEta_next = GBuffer::DecodeIOR(ior);
             }
 
@@ -490,9 +477,7 @@ namespace RDI_Util
 
             if(sampleCoated[i])
             {
-                GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-                    GBUFFER_OFFSET::COAT];
-                uint3 packed = g_coat[samplePosSS[i]].xyz;
+                uint3 packed = GBuffer::LoadCoat(samplePosSS[i], g_frame.CurrGBufferDescHeapOffset);
 
                 GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
                 sample_coat_weight = coat.weight;
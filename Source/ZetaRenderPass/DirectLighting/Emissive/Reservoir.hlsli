@@ -137,8 +137,11 @@ namespace RDI_Util
             Texture2D<uint4> g_reservoir_A = ResourceDescriptorHeap[inputAIdx];
             Texture2D<float2> g_reservoir_B = ResourceDescriptorHeap[inputBIdx];
 
-            const uint4 resA = g_reservoir_A[DTid];
-            const float2 resB = g_reservoir_B[DTid];
+            return Decode(g_reservoir_A[DTid], g_reservoir_B[DTid]);
+        }
+
+        static Reservoir Decode(uint4 resA, float2 resB)
+        {
             const float3 le = asfloat16(uint16_t3(resA.y & 0xffff, resA.y >> 16, resA.z & 0xffff));
             const uint16_t2 bary_or_wh = uint16_t2(resA.x & 0xffff, resA.x >> 16);
             const uint metadata = resA.z >> 16;
@@ -0,0 +1,217 @@
+#ifndef RESTIR_DI_SHARED_NEIGHBORS_H
+#define RESTIR_DI_SHARED_NEIGHBORS_H
+
+#include "Resampling.hlsli"
+
+// Spatial resampling where neighbors are restricted to the thread group's own tile.
+// Every thread loads reservoir and surface of its pixel once and publishes it to group
+// shared memory, so the spatial candidates of all the threads in the group are served
+// from there rather than each thread fetching them from the reservoir and GBuffer
+// textures.
+
+#define NUM_SHARED_NEIGHBORS (RESTIR_DI_TEMPORAL_GROUP_DIM_X * RESTIR_DI_TEMPORAL_GROUP_DIM_Y)
+// Offsets (before wrapping around the tile) are scaled by this much
+#define SHARED_NEIGHBOR_RADIUS 6.0f
+
+groupshared float3 g_neighborPos[NUM_SHARED_NEIGHBORS];
+groupshared float3 g_neighborWo[NUM_SHARED_NEIGHBORS];
+groupshared float2 g_neighborNormal[NUM_SHARED_NEIGHBORS];
+groupshared uint2 g_neighborBaseColor[NUM_SHARED_NEIGHBORS];
+// Roughness as half | IOR as unorm8 << 16 | flags << 24
+groupshared uint g_neighborMaterial[NUM_SHARED_NEIGHBORS];
+groupshared uint4 g_neighborReservoir_A[NUM_SHARED_NEIGHBORS];
+groupshared float2 g_neighborReservoir_B[NUM_SHARED_NEIGHBORS];
+
+namespace RDI_Util
+{
+    namespace SharedNeighbors
+    {
+        static const uint VALID = 1u << 0;
+        static const uint METALLIC = 1u << 1;
+        static const uint TRANSMISSIVE = 1u << 2;
+        static const uint SUBSURFACE = 1u << 3;
+        static const uint COATED = 1u << 4;
+
+        uint Index(uint2 GTid)
+        {
+            return GTid.y * RESTIR_DI_TEMPORAL_GROUP_DIM_X + GTid.x;
+        }
+
+        // Has to be called by every thread in the group, including the ones that are
+        // outside the screen, before any neighbor is read
+        void Store(uint2 DTid, uint2 GTid, uint reservoir_A_DescHeapIdx,
+            uint reservoir_B_DescHeapIdx, ConstantBuffer<cbFrameConstants> g_frame)
+        {
+            const uint idx = Index(GTid);
+            const uint2 renderDim = uint2(g_frame.RenderWidth, g_frame.RenderHeight);
+
+            if(!Math::IsWithinBounds(DTid, renderDim))
+            {
+                g_neighborMaterial[idx] = 0;
+                return;
+            }
+
+            const float2 mr = GBuffer::LoadMetallicRoughness(DTid, g_frame.CurrGBufferDescHeapOffset);
+            const GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
+
+            if(flags.invalid || flags.emissive)
+            {
+                g_neighborMaterial[idx] = 0;
+                return;
+            }
+
+            GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
+                GBUFFER_OFFSET::DEPTH];
+            const float depth = g_depth[DTid];
+
+            float2 lensSample = 0;
+            float3 origin = g_frame.CameraPos;
+            if(g_frame.DoF)
+            {
+                RNG rngDoF = RNG::Init(RNG::PCG3d(DTid.xyx).zy, g_frame.FrameNum);
+                lensSample = Sampling::UniformSampleDiskConcentric(rngDoF.Uniform2D());
+                lensSample *= g_frame.LensRadius;
+            }
+
+            const float3 pos = Math::WorldPosFromScreenSpace2(DTid, renderDim, depth,
+                g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrCameraJitter,
+                g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz,
+                g_frame.DoF, lensSample, g_frame.FocusDepth, origin);
+
+            const float ior = flags.transmissive ?
+                GBuffer::LoadIOR(DTid, g_frame.CurrGBufferDescHeapOffset) : 0;
+
+            uint material = VALID;
+            material |= flags.metallic ? METALLIC : 0;
+            material |= flags.transmissive ? TRANSMISSIVE : 0;
+            material |= flags.subsurface ? SUBSURFACE : 0;
+            material |= flags.coated ? COATED : 0;
+            material = (material << 24) | ((uint)round(saturate(ior) * 255.0f) << 16) |
+                f32tof16(mr.y);
+
+            const float4 baseColor = GBuffer::LoadBaseColor(DTid, g_frame.CurrGBufferDescHeapOffset);
+            const uint4 baseColorH = f32tof16(baseColor);
+
+            Texture2D<uint4> g_reservoir_A = ResourceDescriptorHeap[reservoir_A_DescHeapIdx];
+            Texture2D<float2> g_reservoir_B = ResourceDescriptorHeap[reservoir_B_DescHeapIdx];
+
+            g_neighborPos[idx] = pos;
+            g_neighborWo[idx] = normalize(origin - pos);
+            g_neighborNormal[idx] = GBuffer::LoadNormal(DTid, g_frame.CurrGBufferDescHeapOffset);
+            g_neighborBaseColor[idx] = uint2(baseColorH.x | (baseColorH.y << 16),
+                baseColorH.z | (baseColorH.w << 16));
+            g_neighborMaterial[idx] = material;
+            g_neighborReservoir_A[idx] = g_reservoir_A[DTid];
+            g_neighborReservoir_B[idx] = g_reservoir_B[DTid];
+        }
+    }
+
+    // Same as SpatialResample(), except that neighbors are taken from the group's tile
+    // (offsets wrap around its edges), so they're all read from group shared memory
+    void SpatialResample_Shared(uint2 GTid, uint2 groupStart, int numSamples, float3 pos,
+        float3 normal, float z_view, float roughness, BSDF::ShadingData surface, float alpha_min,
+        ConstantBuffer<cbFrameConstants> g_frame,
+        RaytracingAccelerationStructure g_bvh,
+        StructuredBuffer<RT::EmissiveTriangle> g_emissives,
+        StructuredBuffer<RT::MeshInstance> g_frameMeshData,
+        inout Reservoir r, inout RNG rng)
+    {
+        // rotate sample sequence per pixel
+        const float u0 = rng.Uniform();
+        const int offset = (int)(rng.UniformUintBounded_Faster(8));
+        const float theta = u0 * TWO_PI;
+        const float sinTheta = sin(theta);
+        const float cosTheta = cos(theta);
+
+        // Group dimensions are powers of two
+        const int2 groupDim = int2(RESTIR_DI_TEMPORAL_GROUP_DIM_X, RESTIR_DI_TEMPORAL_GROUP_DIM_Y);
+        PairwiseMIS pairwiseMIS = PairwiseMIS::Init((uint16_t)numSamples, r);
+
+        uint16_t sampleIdx[MAX_NUM_SPATIAL_SAMPLES];
+        uint16_t k = 0;
+
+        [loop]
+        for (int i = 0; i < numSamples; i++)
+        {
+            // Golden angle spacing, so that successive samples cover different parts of
+            // the tile
+            const float r_i = SHARED_NEIGHBOR_RADIUS * sqrt((i + 0.5f) / MAX_NUM_SPATIAL_SAMPLES);
+            const float phi = (offset + i) * 2.39996323f;
+            float2 rotated;
+            rotated.x = r_i * cos(phi) * cosTheta - r_i * sin(phi) * sinTheta;
+            rotated.y = r_i * cos(phi) * sinTheta + r_i * sin(phi) * cosTheta;
+
+            const int2 local_i = ((int2)GTid + (int2)round(rotated)) & (groupDim - 1);
+            if (all(local_i == (int2)GTid))
+                continue;
+
+            const uint idx = SharedNeighbors::Index(local_i);
+            const uint material = g_neighborMaterial[idx];
+            if (!((material >> 24) & SharedNeighbors::VALID))
+                continue;
+
+            const float roughness_i = f16tof32(material & 0xffff);
+            bool valid = PlaneHeuristic(g_neighborPos[idx], normal, pos, z_view);
+            valid = valid && (abs(roughness_i - roughness) < MAX_ROUGHNESS_DIFF_REUSE);
+
+            if (!valid)
+                continue;
+
+            sampleIdx[k++] = (uint16_t)idx;
+        }
+
+        pairwiseMIS.k = k;
+
+        for (int i = 0; i < k; i++)
+        {
+            const uint idx = sampleIdx[i];
+            const uint material = g_neighborMaterial[idx];
+            const uint flags = material >> 24;
+            const bool tr = flags & SharedNeighbors::TRANSMISSIVE;
+
+            const float3 sampleNormal = Math::DecodeUnitVector(g_neighborNormal[idx]);
+            const uint2 baseColorH = g_neighborBaseColor[idx];
+            float4 sampleBaseColor = f16tof32(uint4(baseColorH.x & 0xffff, baseColorH.x >> 16,
+                baseColorH.y & 0xffff, baseColorH.y >> 16));
+            sampleBaseColor.a = (flags & SharedNeighbors::SUBSURFACE) ? sampleBaseColor.a : 0;
+
+            const float sampleEta_next = tr ?
+                GBuffer::DecodeIOR(((material >> 16) & 0xff) / 255.0f) : DEFAULT_ETA_MAT;
+
+            float sample_coat_weight = 0;
+            float3 sample_coat_color = 0.0f;
+            float sample_coat_roughness = 0;
+            float sample_coat_ior = DEFAULT_ETA_COAT;
+
+            // Rare, so not worth the extra group shared memory
+            if(flags & SharedNeighbors::COATED)
+            {
+                const uint2 posSS_i = groupStart + uint2(idx % RESTIR_DI_TEMPORAL_GROUP_DIM_X,
+                    idx / RESTIR_DI_TEMPORAL_GROUP_DIM_X);
+                uint3 packed = GBuffer::LoadCoat(posSS_i, g_frame.CurrGBufferDescHeapOffset);
+
+                GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
+                sample_coat_weight = coat.weight;
+                sample_coat_color = coat.color;
+                sample_coat_roughness = coat.roughness;
+                sample_coat_ior = coat.ior;
+            }
+
+            BSDF::ShadingData surface_i = BSDF::ShadingData::Init(sampleNormal, g_neighborWo[idx],
+                flags & SharedNeighbors::METALLIC, f16tof32(material & 0xffff), sampleBaseColor.xyz,
+                ETA_AIR, sampleEta_next, tr, false, (half)sampleBaseColor.w, sample_coat_weight,
+                sample_coat_color, sample_coat_roughness, sample_coat_ior);
+
+            Reservoir r_spatial = Reservoir::Decode(g_neighborReservoir_A[idx],
+                g_neighborReservoir_B[idx]);
+
+            pairwiseMIS.Stream(r, pos, normal, surface, r_spatial, g_neighborPos[idx], sampleNormal,
+                surface_i, alpha_min, g_frame, g_bvh, g_emissives, g_frameMeshData, rng);
+        }
+
+        pairwiseMIS.End(r, rng);
+        r = pairwiseMIS.r_s;
+    }
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SKY_DI_REDUCED_RESOLUTION_H
+#define SKY_DI_REDUCED_RESOLUTION_H
+
+#include "SkyDI_Common.h"
+#include "../../Common/FrameConstants.h"
+
+// In half-resolution mode, one pixel in every 2x2 quad is resampled in each frame, with
+// the phase alternating every frame. Glossy surfaces, where sky lighting isn't low
+// frequency, are resampled at full resolution.
+namespace SkyDI_Util
+{
+    uint2 HalfResOffset(uint frameNum)
+    {
+        // (0, 0), (1, 1), (1, 0), (0, 1)
+        const uint i = frameNum & 0x3;
+        return uint2(i == 1 || i == 2, i == 1 || i == 3);
+    }
+
+    // Returns whether given pixel was resampled (and its reservoir updated) in given frame
+    bool IsResampled(int2 pixel, float roughness, uint frameNum)
+    {
+        return all((pixel & 0x1) == (int2)HalfResOffset(frameNum)) || 
+            (roughness < SKY_DI_HALF_RES_MAX_ROUGHNESS);
+    }
+
+    // Pixel in the same quad that was resampled regardless of roughness
+    int2 NearestResampledPixel(int2 pixel, uint frameNum)
+    {
+        return (pixel & ~0x1) | (int2)HalfResOffset(frameNum);
+    }
+
+    void WriteOutput(uint2 DTid, float3 ld, ConstantBuffer<cbFrameConstants> g_frame, 
+        ConstantBuffer<cb_SkyDI> g_local)
+    {
+        ld = any(isnan(ld)) ? 0 : ld;
+
+        // Accumulation is done after upsampling
+        if(g_local.Flags & CB_SKY_DI_FLAGS::HALF_RES)
+        {
+            RWTexture2D<float4> g_sparse = ResourceDescriptorHeap[g_local.SparseDescHeapIdx];
+            g_sparse[DTid].rgb = ld;
+
+            return;
+        }
+
+        RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
+
+        if(g_frame.Accumulate && g_frame.CameraStatic && g_frame.NumFramesCameraStatic > 1)
+        {
+            float3 prev = g_final[DTid].rgb;
+            g_final[DTid].rgb = prev + ld;
+        }
+        else
+            g_final[DTid].rgb = ld;
+    }
+}
+
+#endif
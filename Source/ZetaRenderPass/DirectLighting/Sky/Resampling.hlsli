@@ -3,6 +3,7 @@
 
 #include "Params.hlsli"
 #include "PairwiseMIS.hlsli"
+#include "ReducedResolution.hlsli"
 #include "../../Common/GBuffers.hlsli"
 #include "../../Common/BSDFSampling.hlsli"
 
@@ -35,7 +36,8 @@ namespace SkyDI_Util
     }
 
     TemporalCandidate FindTemporalCandidate(uint2 DTid, float3 pos, float3 normal, float z_view, 
-        float roughness, BSDF::ShadingData surface, ConstantBuffer<cbFrameConstants> g_frame)
+        float roughness, BSDF::ShadingData surface, bool halfRes, 
+        ConstantBuffer<cbFrameConstants> g_frame)
     {
         TemporalCandidate candidate = TemporalCandidate::Init();
 
@@ -45,14 +47,25 @@ namespace SkyDI_Util
         const float2 motionVec = g_motionVector[DTid];
         const float2 currUV = (DTid + 0.5f) / renderDim;
         const float2 prevUV = currUV - motionVec;
-        const int2 prevPixel = prevUV * renderDim;
+        int2 prevPixel = prevUV * renderDim;
 
         if (any(prevUV < 0.0f.xx) || any(prevUV > 1.0f.xx))
             return candidate;
 
-        GBUFFER_METALLIC_ROUGHNESS g_prevMR = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-        const float2 prevMR = g_prevMR[prevPixel];
+        float2 prevMR = GBuffer::LoadMetallicRoughness(prevPixel, 
+            g_frame.PrevGBufferDescHeapOffset);
+
+        // Only reservoirs that were resampled in previous frame are up to date
+        if(halfRes && !IsResampled(prevPixel, prevMR.y, g_frame.FrameNum - 1))
+        {
+            prevPixel = NearestResampledPixel(prevPixel, g_frame.FrameNum - 1);
+
+            if(prevPixel.x >= renderDim.x || prevPixel.y >= renderDim.y)
+                return candidate;
+
+            prevMR = GBuffer::LoadMetallicRoughness(prevPixel, g_frame.PrevGBufferDescHeapOffset);
+        }
+
         GBuffer::Flags prevFlags = GBuffer::DecodeMetallic(prevMR.x);
 
         // Skip if not on the same surface
@@ -85,25 +98,19 @@ namespace SkyDI_Util
         if(!PlaneHeuristic(prevPos, normal, pos, z_view, MAX_PLANE_DIST_REUSE))
             return candidate;
 
-        GBUFFER_NORMAL g_prevNormal = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::NORMAL];
-        const float3 prevNormal = Math::DecodeUnitVector(g_prevNormal[prevPixel]);
+        const float3 prevNormal = Math::DecodeUnitVector(GBuffer::LoadNormal(prevPixel, 
+            g_frame.PrevGBufferDescHeapOffset));
 
         float prevEta_next = DEFAULT_ETA_MAT;
 
         if(prevFlags.transmissive)
         {
-            GBUFFER_IOR g_prevIOR = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-                GBUFFER_OFFSET::IOR];
-
-            float ior = g_prevIOR[prevPixel];
+            float ior = GBuffer::LoadIOR(prevPixel, g_frame.PrevGBufferDescHeapOffset);
             prevEta_next = GBuffer::DecodeIOR(ior);
         }
 
-        GBUFFER_BASE_COLOR g_prevBaseColor = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::BASE_COLOR];
-        const float4 prevBaseColor = prevFlags.subsurface ? g_prevBaseColor[prevPixel] :
-            float4(g_prevBaseColor[prevPixel].rgb, 0);
+        float4 prevBaseColor = GBuffer::LoadBaseColor(prevPixel, g_frame.PrevGBufferDescHeapOffset);
+        prevBaseColor.a = prevFlags.subsurface ? prevBaseColor.a : 0;
 
         float prev_coat_weight = 0;
         float3 prev_coat_color = 0.0f;
@@ -112,9 +119,7 @@ namespace SkyDI_Util
 
         if(prevFlags.coated)
         {
-            GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-                GBUFFER_OFFSET::COAT];
-            uint3 packed = g_coat[prevPixel].xyz;
+            uint3 packed = GBuffer::LoadCoat(prevPixel, g_frame.PrevGBufferDescHeapOffset);
 
             GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
             prev_coat_weight = coat.weight;
@@ -249,8 +254,8 @@ namespace SkyDI_Util
     void SpatialResample(uint2 DTid, float3 pos, float3 normal, float z_view, 
         float roughness, BSDF::ShadingData surface, uint reservoir_A_DescHeapIdx, 
         uint reservoir_B_DescHeapIdx, uint reservoir_C_DescHeapIdx, float alpha_min, 
-        RaytracingAccelerationStructure g_bvh, ConstantBuffer<cbFrameConstants> g_frame, 
-        inout Reservoir r_c, inout RNG rng)
+        bool halfRes, RaytracingAccelerationStructure g_bvh, 
+        ConstantBuffer<cbFrameConstants> g_frame, inout Reservoir r_c, inout RNG rng)
     {
         static const half2 k_samples[16] =
         {
@@ -274,8 +279,6 @@ namespace SkyDI_Util
 
         GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
             GBUFFER_OFFSET::DEPTH];
-        GBUFFER_METALLIC_ROUGHNESS g_mr = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
 
         // rotate sample sequence per pixel
         const float u0 = rng.Uniform();
@@ -305,11 +308,25 @@ namespace SkyDI_Util
             rotated.x = dot(sampleUV, float2(cosTheta, -sinTheta));
             rotated.y = dot(sampleUV, float2(sinTheta, cosTheta));
             rotated *= SPATIAL_SEARCH_RADIUS;
-            const int2 posSS_i = round(float2(DTid) + rotated);
+            int2 posSS_i = round(float2(DTid) + rotated);
 
             if (Math::IsWithinBounds(posSS_i, (int2)renderDim))
             {
-                const float2 mr_i = g_mr[posSS_i];
+                float2 mr_i = GBuffer::LoadMetallicRoughness(posSS_i, 
+                    g_frame.CurrGBufferDescHeapOffset);
+
+                // Only reservoirs that were resampled in this frame are up to date
+                if(halfRes && !IsResampled(posSS_i, mr_i.y, g_frame.FrameNum))
+                {
+                    posSS_i = NearestResampledPixel(posSS_i, g_frame.FrameNum);
+
+                    if (!Math::IsWithinBounds(posSS_i, (int2)renderDim) || 
+                        all(posSS_i == (int2)DTid))
+                        continue;
+
+                    mr_i = GBuffer::LoadMetallicRoughness(posSS_i, g_frame.CurrGBufferDescHeapOffset);
+                }
+
                 GBuffer::Flags flags_i = GBuffer::DecodeMetallic(mr_i.x);
 
                 if (flags_i.invalid || flags_i.emissive)
@@ -353,23 +370,18 @@ namespace SkyDI_Util
 
         for (int i = 0; i < k; i++)
         {
-            GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-                GBUFFER_OFFSET::NORMAL];
-            const float3 sampleNormal = Math::DecodeUnitVector(g_normal[samplePosSS[i]]);
+            const float3 sampleNormal = Math::DecodeUnitVector(GBuffer::LoadNormal(samplePosSS[i], 
+                g_frame.CurrGBufferDescHeapOffset));
 
-            GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-                GBUFFER_OFFSET::BASE_COLOR];
-            const float4 sampleBaseColor = sampleSubsurf[i] ? g_baseColor[samplePosSS[i]] :
-                float4(g_baseColor[samplePosSS[i]].rgb, 0);
+            float4 sampleBaseColor = GBuffer::LoadBaseColor(samplePosSS[i], 
+                g_frame.CurrGBufferDescHeapOffset);
+            sampleBaseColor.a = sampleSubsurf[i] ? sampleBaseColor.a : 0;
 
             float sampleEta_next = DEFAULT_ETA_MAT;
 
             if(sampleTr[i])
             {
-                GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-                    GBUFFER_OFFSET::IOR];
-
-                float ior = g_ior[samplePosSS[i]];
+                float ior = GBuffer::LoadIOR(samplePosSS[i], g_frame.CurrGBufferDescHeapOffset);
                 sampleEta_next = GBuffer::DecodeIOR(ior);
             }
 
@@ -380,9 +392,7 @@ namespace SkyDI_Util
 
             if(sampleCoated[i])
             {
-                GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-                    GBUFFER_OFFSET::COAT];
-                uint3 packed = g_coat[samplePosSS[i]].xyz;
+                uint3 packed = GBuffer::LoadCoat(samplePosSS[i], g_frame.CurrGBufferDescHeapOffset);
 
                 GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
                 sample_coat_weight = coat.weight;
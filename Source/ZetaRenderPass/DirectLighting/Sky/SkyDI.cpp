@@ -54,23 +54,13 @@ void SkyDI::InitPSOs()
     auto samplers = App::GetRenderer().GetStaticSamplers();
     RenderPassBase::InitRenderPass("SkyDI", flags, samplers);
 
-    TaskSet ts;
-
     for (int i = 0; i < (int)SHADER::COUNT; i++)
     {
-        StackStr(buff, n, "SkyDI_shader_%d", i);
-
-        ts.EmplaceTask(buff, [i, this]()
-            {
-                m_psoLib.CompileComputePSO_MT(i, m_rootSigObj.Get(),
-                    COMPILED_CS[i]);
-            });
+        if (i != (int)SHADER::SKY_DI_UPSAMPLE || m_halfRes)
+            m_psoLib.EnqueueComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
+        else
+            m_psoLib.DeferComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
     }
-
-    WaitObject waitObj;
-    ts.Sort();
-    ts.Finalize(&waitObj);
-    App::Submit(ZetaMove(ts));
 }
 
 void SkyDI::Init()
@@ -79,11 +69,15 @@ void SkyDI::Init()
 
     memset(&m_cbSpatioTemporal, 0, sizeof(m_cbSpatioTemporal));
     m_cbSpatioTemporal.M_max = DefaultParamVals::M_MAX_SKY | (DefaultParamVals::M_MAX_SUN << 16);
+    m_cbSpatioTemporal.ResamplingInterval = 1;
     m_cbSpatioTemporal.Alpha_min = DefaultParamVals::ROUGHNESS_MIN * DefaultParamVals::ROUGHNESS_MIN;
 
     m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
     CreateOutputs();
 
+    if (m_halfRes)
+        CreateReducedResResources();
+
     ParamVariant doTemporal;
     doTemporal.InitBool(ICON_FA_FILM " Renderer", "Direct Lighting (Sky)", "Temporal Resample",
         fastdelegate::MakeDelegate(this, &SkyDI::TemporalResamplingCallback), m_temporalResampling);
@@ -112,15 +106,26 @@ void SkyDI::Init()
         DefaultParamVals::ROUGHNESS_MIN, 0.0f, 1.0f, 1e-2f);
     App::AddParam(alphaMin);
 
+    ParamVariant halfRes;
+    halfRes.InitBool(ICON_FA_FILM " Renderer", "Direct Lighting (Sky)", "Half Resolution",
+        fastdelegate::MakeDelegate(this, &SkyDI::HalfResCallback), m_halfRes);
+    App::AddParam(halfRes);
+
     App::AddShaderReloadHandler("SkyDI (Temporal)", fastdelegate::MakeDelegate(this, &SkyDI::ReloadTemporalPass));
     App::AddShaderReloadHandler("SkyDI (Spatial)", fastdelegate::MakeDelegate(this, &SkyDI::ReloadSpatialPass));
+    App::AddShaderReloadHandler("SkyDI (Upsample)", fastdelegate::MakeDelegate(this, &SkyDI::ReloadUpsamplePass));
 
     m_isTemporalReservoirValid = false;
 }
 
 void SkyDI::OnWindowResized()
 {
+    m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
     CreateOutputs();
+
+    if (m_halfRes)
+        CreateReducedResResources();
+
     m_isTemporalReservoirValid = false;
     m_currTemporalIdx = 0;
 }
@@ -145,14 +150,18 @@ void SkyDI::Render(CommandList& cmdList)
 
     computeCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
 
-    const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, SKY_DI_GROUP_DIM_X);
-    const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, SKY_DI_GROUP_DIM_Y);
+    // In half-resolution mode, there's one thread per 2x2 quad
+    const uint32_t resampledW = m_halfRes ? CeilUnsignedIntDiv(w, 2u) : w;
+    const uint32_t resampledH = m_halfRes ? CeilUnsignedIntDiv(h, 2u) : h;
+    const uint32_t dispatchDimX = CeilUnsignedIntDiv(resampledW, SKY_DI_GROUP_DIM_X);
+    const uint32_t dispatchDimY = CeilUnsignedIntDiv(resampledH, SKY_DI_GROUP_DIM_Y);
 
     const bool doTemporal = m_isTemporalReservoirValid && m_temporalResampling;
     const bool doSpatial = doTemporal && m_spatialResampling;
 
     SET_CB_FLAG(m_cbSpatioTemporal, CB_SKY_DI_FLAGS::TEMPORAL_RESAMPLE, doTemporal);
     SET_CB_FLAG(m_cbSpatioTemporal, CB_SKY_DI_FLAGS::SPATIAL_RESAMPLE, doSpatial);
+    SET_CB_FLAG(m_cbSpatioTemporal, CB_SKY_DI_FLAGS::HALF_RES, m_halfRes);
 
     m_cbSpatioTemporal.DispatchDimX = (uint16_t)dispatchDimX;
     m_cbSpatioTemporal.DispatchDimY = (uint16_t)dispatchDimY;
@@ -248,6 +257,23 @@ void SkyDI::Render(CommandList& cmdList)
         cmdList.PIXEndEvent();
     }
 
+    // Fill in the pixels that weren't resampled this frame
+    if (m_halfRes)
+    {
+        computeCmdList.PIXBeginEvent("SkyDI_Upsample");
+        const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "SkyDI_Upsample");
+
+        auto barrier = UAVBarrier1(m_sparse.Resource());
+        computeCmdList.ResourceBarrier(barrier);
+
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::SKY_DI_UPSAMPLE));
+        computeCmdList.Dispatch(CeilUnsignedIntDiv(w, SKY_DI_GROUP_DIM_X),
+            CeilUnsignedIntDiv(h, SKY_DI_GROUP_DIM_Y), 1);
+
+        gpuTimer.EndQuery(computeCmdList, queryIdx);
+        cmdList.PIXEndEvent();
+    }
+
     m_isTemporalReservoirValid = true;
     m_currTemporalIdx = 1 - m_currTemporalIdx;
     SET_CB_FLAG(m_cbSpatioTemporal, CB_SKY_DI_FLAGS::RESET_TEMPORAL_TEXTURES, false);
@@ -277,7 +303,7 @@ void SkyDI::CreateOutputs()
 
     list.End();
 
-    m_resHeap = GpuMemory::GetResourceHeap(list.TotalSizeInBytes());
+    m_resHeap = GpuMemory::GetResourceHeap("SkyDI", list.TotalSizeInBytes());
     auto allocs = list.AllocInfos();
     int currRes = 0;
 
@@ -347,6 +373,24 @@ void SkyDI::CreateOutputs()
         int)DESC_TABLE::FINAL_UAV);
 }
 
+void SkyDI::CreateReducedResResources()
+{
+    auto& renderer = App::GetRenderer();
+    const auto w = renderer.GetRenderWidth();
+    const auto h = renderer.GetRenderHeight();
+
+    // Only ever accessed as UAV
+    m_sparse = GpuMemory::GetTexture2D("SkyDI_Sparse",
+        w, h,
+        ResourceFormats::SPARSE,
+        D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS,
+        TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+    Direct3DUtil::CreateTexture2DUAV(m_sparse, m_descTable.CPUHandle((int)DESC_TABLE::SPARSE_UAV));
+    m_cbSpatioTemporal.SparseDescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+        (int)DESC_TABLE::SPARSE_UAV);
+}
+
 void SkyDI::TemporalResamplingCallback(const Support::ParamVariant& p)
 {
     m_temporalResampling = p.GetBool();
@@ -378,6 +422,20 @@ void SkyDI::AlphaMinCallback(const Support::ParamVariant& p)
     App::GetScene().SceneModified();
 }
 
+void SkyDI::HalfResCallback(const Support::ParamVariant& p)
+{
+    m_halfRes = p.GetBool();
+
+    if (!m_halfRes)
+        m_sparse.Reset();
+    else if (!m_sparse.IsInitialized())
+        CreateReducedResResources();
+
+    // Reservoirs of pixels that aren't resampled anymore are outdated
+    ResetTemporal();
+    App::GetScene().SceneModified();
+}
+
 void SkyDI::ReloadTemporalPass()
 {
     const int i = (int)SHADER::SKY_DI_TEMPORAL;
@@ -389,3 +447,9 @@ void SkyDI::ReloadSpatialPass()
     const int i = (int)SHADER::SKY_DI_SPATIAL;
     m_psoLib.Reload(i, m_rootSigObj.Get(), "DirectLighting\\Sky\\SkyDI_Spatial.hlsl");
 }
+
+void SkyDI::ReloadUpsamplePass()
+{
+    const int i = (int)SHADER::SKY_DI_UPSAMPLE;
+    m_psoLib.Reload(i, m_rootSigObj.Get(), "DirectLighting\\Sky\\SkyDI_Upsample.hlsl");
+}
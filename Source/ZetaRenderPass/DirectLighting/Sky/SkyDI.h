@@ -20,6 +20,7 @@ namespace ZetaRay::RenderPass
     {
         SKY_DI_TEMPORAL,
         SKY_DI_SPATIAL,
+        SKY_DI_UPSAMPLE,
         COUNT
     };
 
@@ -38,6 +39,13 @@ namespace ZetaRay::RenderPass
         void Init();
         void OnWindowResized();
         void ResetTemporal();
+        // Pixels are fully resampled once every "interval" (1, 2 or 4) frames, the rest 
+        // only reuse their temporal reservoir
+        void SetResamplingInterval(uint32_t interval)
+        {
+            Assert(interval == 1 || interval == 2 || interval == 4, "Invalid resampling interval.");
+            m_cbSpatioTemporal.ResamplingInterval = (uint16_t)interval;
+        }
         const Core::GpuMemory::Texture& GetOutput(SHADER_OUT_RES i) const
         {
             Assert(i == SHADER_OUT_RES::DENOISED, "Invalid shader output.");
@@ -60,6 +68,7 @@ namespace ZetaRay::RenderPass
             static constexpr DXGI_FORMAT RESERVOIR_C = DXGI_FORMAT_R32G32_FLOAT;
             static constexpr DXGI_FORMAT TARGET = DXGI_FORMAT_R16G16B16A16_FLOAT;
             static constexpr DXGI_FORMAT FINAL = DXGI_FORMAT_R32G32B32A32_FLOAT;
+            static constexpr DXGI_FORMAT SPARSE = DXGI_FORMAT_R16G16B16A16_FLOAT;
         };
 
         enum class DESC_TABLE
@@ -79,6 +88,7 @@ namespace ZetaRay::RenderPass
             RESERVOIR_1_C_UAV,
             TARGET_UAV,
             FINAL_UAV,
+            SPARSE_UAV,
             //
             COUNT
         };
@@ -89,11 +99,13 @@ namespace ZetaRay::RenderPass
             static constexpr int M_MAX_SUN = 3;
             // Use half-vector copy for anything lower
             static constexpr float ROUGHNESS_MIN = 0.35f;
+            static constexpr bool HALF_RES = false;
         };
 
         inline static constexpr const char* COMPILED_CS[(int)SHADER::COUNT] = {
             "SkyDI_Temporal_cs.cso",
-            "SkyDI_Spatial_cs.cso"
+            "SkyDI_Spatial_cs.cso",
+            "SkyDI_Upsample_cs.cso"
         };
 
         struct Reservoir
@@ -111,25 +123,31 @@ namespace ZetaRay::RenderPass
         };
 
         void CreateOutputs();
+        void CreateReducedResResources();
 
         void TemporalResamplingCallback(const Support::ParamVariant& p);
         void SpatialResamplingCallback(const Support::ParamVariant& p);
         void MaxMSkyCallback(const Support::ParamVariant& p);
         void MaxMSunCallback(const Support::ParamVariant& p);
         void AlphaMinCallback(const Support::ParamVariant& p);
+        void HalfResCallback(const Support::ParamVariant& p);
 
         // shader reload
         void ReloadTemporalPass();
         void ReloadSpatialPass();
+        void ReloadUpsamplePass();
 
         Reservoir m_reservoir[2];
         Core::GpuMemory::ResourceHeap m_resHeap;
         Core::GpuMemory::Texture m_target;
         Core::GpuMemory::Texture m_final;
+        // Output of resampled pixels in half-resolution mode
+        Core::GpuMemory::Texture m_sparse;
         int m_currTemporalIdx = 0;
         bool m_temporalResampling = true;
         bool m_spatialResampling = true;
         bool m_isTemporalReservoirValid = false;
+        bool m_halfRes = DefaultParamVals::HALF_RES;
 
         Core::DescriptorTable m_descTable;
 
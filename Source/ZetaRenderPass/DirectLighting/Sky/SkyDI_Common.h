@@ -9,11 +9,18 @@
 #define SKY_DI_TILE_WIDTH 8
 #define SKY_DI_LOG2_TILE_WIDTH 3
 
+// Half resolution -- surfaces with lower roughness are always resampled at full resolution
+#define SKY_DI_HALF_RES_MAX_ROUGHNESS 0.25f
+#define SKY_DI_UPSAMPLE_DEPTH_SIGMA 0.02f
+#define SKY_DI_UPSAMPLE_NORMAL_EXP 16
+#define SKY_DI_UPSAMPLE_ROUGHNESS_SIGMA 0.1f
+
 namespace CB_SKY_DI_FLAGS
 {
     static constexpr uint32_t TEMPORAL_RESAMPLE = 1 << 0;
     static constexpr uint32_t SPATIAL_RESAMPLE = 1 << 1;
     static constexpr uint32_t RESET_TEMPORAL_TEXTURES = 1 << 2;
+    static constexpr uint32_t HALF_RES = 1 << 3;
 };
 
 struct cb_SkyDI
@@ -29,7 +36,11 @@ struct cb_SkyDI
     uint16_t DispatchDimX;
     uint16_t DispatchDimY;
     uint16_t NumGroupsInTile;
-    uint16_t pad;
+    // Every pixel is fully resampled once in this many frames
+    uint16_t ResamplingInterval;
+
+    // Half resolution -- output of resampled pixels before upsampling
+    uint32_t SparseDescHeapIdx;
 };
 
 #endif
@@ -120,12 +120,20 @@ Reservoir RIS_InitialCandidates(uint2 DTid, float3 pos, float3 normal,
 Reservoir InitialCandidatesAndTemporalReuse(uint2 DTid, float3 pos, float3 normal, float z_view, 
     float roughness, BSDF::ShadingData surface, inout RNG rng)
 {
-    Reservoir r = RIS_InitialCandidates(DTid, pos, normal, surface, rng);
+    Reservoir r = Reservoir::Init();
 
     if (IS_CB_FLAG_SET(CB_SKY_DI_FLAGS::TEMPORAL_RESAMPLE)) 
     {
         TemporalCandidate candidate = FindTemporalCandidate(DTid, pos, normal, z_view, 
-            roughness, surface, g_frame);
+            roughness, surface, IS_CB_FLAG_SET(CB_SKY_DI_FLAGS::HALF_RES), g_frame);
+
+        // Pixels that aren't scheduled this frame only reuse their previous reservoir,
+        // unless it's not available (e.g. disocclusion)
+        if(!candidate.valid || Common::IsPixelScheduled(DTid, g_frame.FrameNum, 
+            g_local.ResamplingInterval))
+        {
+            r = RIS_InitialCandidates(DTid, pos, normal, surface, rng);
+        }
 
         if(candidate.valid)
         {
@@ -140,6 +148,8 @@ Reservoir InitialCandidatesAndTemporalReuse(uint2 DTid, float3 pos, float3 norma
         if(IS_CB_FLAG_SET(CB_SKY_DI_FLAGS::SPATIAL_RESAMPLE))
             r.WriteTarget(DTid, g_local.TargetDescHeapIdx);
     }
+    else
+        r = RIS_InitialCandidates(DTid, pos, normal, surface, rng);
 
     if (IS_CB_FLAG_SET(CB_SKY_DI_FLAGS::TEMPORAL_RESAMPLE) || 
         IS_CB_FLAG_SET(CB_SKY_DI_FLAGS::RESET_TEMPORAL_TEXTURES))
@@ -155,34 +165,15 @@ Reservoir InitialCandidatesAndTemporalReuse(uint2 DTid, float3 pos, float3 norma
     return r;
 }
 
-//--------------------------------------------------------------------------------------
-// Main
-//--------------------------------------------------------------------------------------
-
-[numthreads(SKY_DI_GROUP_DIM_X, SKY_DI_GROUP_DIM_Y, 1)]
-void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID)
+// Initial candidates and temporal resampling for given pixel, sky and emissive pixels
+// are written to output directly
+void TemporalResamplePixel(uint2 DTid)
 {
-#if THREAD_GROUP_SWIZZLING
-    uint16_t2 swizzledGid;
-
-    uint2 swizzledDTid = Common::SwizzleThreadGroup(DTid, Gid, GTid, 
-        uint16_t2(SKY_DI_GROUP_DIM_X, SKY_DI_GROUP_DIM_Y),
-        g_local.DispatchDimX, 
-        SKY_DI_TILE_WIDTH, 
-        SKY_DI_LOG2_TILE_WIDTH, 
-        g_local.NumGroupsInTile,
-        swizzledGid);
-#else
-    const uint2 swizzledDTid = DTid.xy;
-    const uint2 swizzledGid = Gid.xy;
-#endif
-
-    if (swizzledDTid.x >= g_frame.RenderWidth || swizzledDTid.y >= g_frame.RenderHeight)
+    if (DTid.x >= g_frame.RenderWidth || DTid.y >= g_frame.RenderHeight)
         return;
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr = g_metallicRoughness[swizzledDTid];
+    const float2 mr = GBuffer::LoadMetallicRoughness(DTid, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
 
     RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
@@ -191,12 +182,12 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     {
         if(g_frame.Accumulate && g_frame.CameraStatic)
         {
-            float3 prev = g_final[swizzledDTid].rgb;
-            g_final[swizzledDTid].xyz = prev * (g_frame.NumFramesCameraStatic > 1) + 
-                Light::Le_SkyWithSunDisk(swizzledDTid, g_frame);
+            float3 prev = g_final[DTid].rgb;
+            g_final[DTid].xyz = prev * (g_frame.NumFramesCameraStatic > 1) + 
+                Light::Le_SkyWithSunDisk(DTid, g_frame);
         }
         else
-            g_final[swizzledDTid].xyz = 0;
+            g_final[DTid].xyz = 0;
 
         return;
     }
@@ -205,58 +196,52 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     {
         GBUFFER_EMISSIVE_COLOR g_emissiveColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
             GBUFFER_OFFSET::EMISSIVE_COLOR];
-        float3 le = g_emissiveColor[swizzledDTid].rgb;
+        float3 le = g_emissiveColor[DTid].rgb;
 
         RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
 
         if(g_frame.Accumulate && g_frame.CameraStatic)
         {
-            float3 prev = g_final[swizzledDTid].rgb;
-            g_final[swizzledDTid].rgb = prev + le;
+            float3 prev = g_final[DTid].rgb;
+            g_final[DTid].rgb = prev + le;
         }
         else
-            g_final[swizzledDTid].rgb = le;
+            g_final[DTid].rgb = le;
 
         return;
     }
 
     GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
         GBUFFER_OFFSET::DEPTH];
-    const float z_view = g_depth[swizzledDTid];
+    const float z_view = g_depth[DTid];
     
     float2 lensSample = 0;
     float3 origin = g_frame.CameraPos;
     if(g_frame.DoF)
     {
-        RNG rngDoF = RNG::Init(RNG::PCG3d(swizzledDTid.xyx).zy, g_frame.FrameNum);
+        RNG rngDoF = RNG::Init(RNG::PCG3d(DTid.xyx).zy, g_frame.FrameNum);
         lensSample = Sampling::UniformSampleDiskConcentric(rngDoF.Uniform2D());
         lensSample *= g_frame.LensRadius;
     }
 
     const float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
-    const float3 pos = Math::WorldPosFromScreenSpace2(swizzledDTid, renderDim, z_view, 
+    const float3 pos = Math::WorldPosFromScreenSpace2(DTid, renderDim, z_view, 
         g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrCameraJitter, 
         g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz, 
         g_frame.DoF, lensSample, g_frame.FocusDepth, origin);
 
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_normal[swizzledDTid]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(DTid, 
+        g_frame.CurrGBufferDescHeapOffset));
 
-    GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
-    const float4 baseColor = flags.subsurface ? g_baseColor[swizzledDTid] :
-        float4(g_baseColor[swizzledDTid].rgb, 0);
+    float4 baseColor = GBuffer::LoadBaseColor(DTid, g_frame.CurrGBufferDescHeapOffset);
+    baseColor.a = flags.subsurface ? baseColor.a : 0;
 
     float eta_curr = ETA_AIR;
     float eta_next = DEFAULT_ETA_MAT;
 
     if(flags.transmissive)
     {
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
-
-        float ior = g_ior[swizzledDTid];
+        float ior = GBuffer::LoadIOR(DTid, g_frame.CurrGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
@@ -267,9 +252,7 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
 
     if(flags.coated)
     {
-        GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::COAT];
-        uint3 packed = g_coat[swizzledDTid].xyz;
+        uint3 packed = GBuffer::LoadCoat(DTid, g_frame.CurrGBufferDescHeapOffset);
 
         GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
         coat_weight = coat.weight;
@@ -283,22 +266,57 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         baseColor.xyz, eta_curr, eta_next, flags.transmissive, flags.trDepthGt0, (half)baseColor.w,
         coat_weight, coat_color, coat_roughness, coat_ior);
 
-    RNG rng = RNG::Init(RNG::PCG3d(swizzledDTid.yxx).yz, g_frame.FrameNum);
+    RNG rng = RNG::Init(RNG::PCG3d(DTid.yxx).yz, g_frame.FrameNum);
 
-    SkyDI_Util::Reservoir r = InitialCandidatesAndTemporalReuse(swizzledDTid, pos, normal, 
+    SkyDI_Util::Reservoir r = InitialCandidatesAndTemporalReuse(DTid, pos, normal, 
         z_view, mr.y, surface, rng);
 
     if(!IS_CB_FLAG_SET(CB_SKY_DI_FLAGS::SPATIAL_RESAMPLE) || !IS_CB_FLAG_SET(CB_SKY_DI_FLAGS::TEMPORAL_RESAMPLE))
+        WriteOutput(DTid, r.target * r.W, g_frame, g_local);
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(SKY_DI_GROUP_DIM_X, SKY_DI_GROUP_DIM_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID)
+{
+#if THREAD_GROUP_SWIZZLING
+    uint16_t2 swizzledGid;
+
+    uint2 swizzledDTid = Common::SwizzleThreadGroup(DTid, Gid, GTid, 
+        uint16_t2(SKY_DI_GROUP_DIM_X, SKY_DI_GROUP_DIM_Y),
+        g_local.DispatchDimX, 
+        SKY_DI_TILE_WIDTH, 
+        SKY_DI_LOG2_TILE_WIDTH, 
+        g_local.NumGroupsInTile,
+        swizzledGid);
+#else
+    const uint2 swizzledDTid = DTid.xy;
+    const uint2 swizzledGid = Gid.xy;
+#endif
+
+    if(!IS_CB_FLAG_SET(CB_SKY_DI_FLAGS::HALF_RES))
+    {
+        TemporalResamplePixel(swizzledDTid);
+        return;
+    }
+
+    // One thread per 2x2 quad -- besides the pixel that's resampled in this frame, glossy
+    // surfaces are always resampled
+    [loop]
+    for(uint i = 0; i < 4; i++)
     {
-        float3 ld = r.target * r.W;
-        ld = any(isnan(ld)) ? 0 : ld;
+        const uint2 pixel = 2 * swizzledDTid + uint2(i & 0x1, i >> 1);
+        if (pixel.x >= g_frame.RenderWidth || pixel.y >= g_frame.RenderHeight)
+            continue;
 
-        if(g_frame.Accumulate && g_frame.CameraStatic && g_frame.NumFramesCameraStatic > 1)
-        {
-            float3 prev = g_final[swizzledDTid].rgb;
-            g_final[swizzledDTid].rgb = prev + ld;
-        }
-        else
-            g_final[swizzledDTid].rgb = ld;
+        const float2 mr = GBuffer::LoadMetallicRoughness(pixel, g_frame.CurrGBufferDescHeapOffset);
+        GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
+
+        // Sky and emissive pixels aren't upsampled
+        if(flags.invalid || flags.emissive || IsResampled(pixel, mr.y, g_frame.FrameNum))
+            TemporalResamplePixel(pixel);
     }
 }
\ No newline at end of file
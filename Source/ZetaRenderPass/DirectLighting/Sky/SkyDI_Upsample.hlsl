@@ -0,0 +1,121 @@
+#include "ReducedResolution.hlsli"
+#include "../../Common/Common.hlsli"
+#include "../../Common/GBuffers.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b0);
+ConstantBuffer<cb_SkyDI> g_local : register(b1);
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// Joint bilateral upsampling -- weighted average of neighboring pixels that were resampled
+// this frame, where neighbors on a different surface (according to depth, normal and
+// roughness) are rejected
+float3 Upsample(int2 DTid, float z_view, float3 normal, float roughness)
+{
+    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
+        GBUFFER_OFFSET::DEPTH];
+    RWTexture2D<float4> g_sparse = ResourceDescriptorHeap[g_local.SparseDescHeapIdx];
+
+    float3 weightedSum = 0;
+    float weightSum = 0;
+    // Used when geometry weights all go to zero
+    float3 fallbackSum = 0;
+    float numFallback = 0;
+
+    [unroll]
+    for(int i = -1; i <= 1; i++)
+    {
+        [unroll]
+        for(int j = -1; j <= 1; j++)
+        {
+            const int2 q = DTid + int2(j, i);
+
+            if(any(q < 0) || q.x >= (int)g_frame.RenderWidth || q.y >= (int)g_frame.RenderHeight)
+                continue;
+
+            const float2 mr_q = GBuffer::LoadMetallicRoughness(q, g_frame.CurrGBufferDescHeapOffset);
+            const GBuffer::Flags flags_q = GBuffer::DecodeMetallic(mr_q.x);
+            if(flags_q.invalid || flags_q.emissive)
+                continue;
+
+            if(!SkyDI_Util::IsResampled(q, mr_q.y, g_frame.FrameNum))
+                continue;
+
+            const float3 ld_q = g_sparse[q].rgb;
+            const float z_q = g_depth[q];
+            const float3 normal_q = Math::DecodeUnitVector(GBuffer::LoadNormal(q,
+                g_frame.CurrGBufferDescHeapOffset));
+
+            const float w_z = exp(-abs(z_q - z_view) / (SKY_DI_UPSAMPLE_DEPTH_SIGMA *
+                max(z_view, 1e-4f)));
+            const float w_n = pow(saturate(dot(normal_q, normal)), SKY_DI_UPSAMPLE_NORMAL_EXP);
+            const float w_r = exp(-abs(mr_q.y - roughness) / SKY_DI_UPSAMPLE_ROUGHNESS_SIGMA);
+            // Prefer direct neighbors over diagonal ones
+            const float w_d = (i == 0 || j == 0) ? 1.0f : 0.5f;
+            const float w = w_z * w_n * w_r * w_d;
+
+            weightedSum += w * ld_q;
+            weightSum += w;
+            fallbackSum += ld_q;
+            numFallback++;
+        }
+    }
+
+    if(weightSum > 1e-6f)
+        return weightedSum / weightSum;
+
+    return numFallback > 0 ? fallbackSum / numFallback : 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(SKY_DI_GROUP_DIM_X, SKY_DI_GROUP_DIM_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_frame.RenderWidth || DTid.y >= g_frame.RenderHeight)
+        return;
+
+    const float2 mr = GBuffer::LoadMetallicRoughness(DTid.xy, g_frame.CurrGBufferDescHeapOffset);
+    const GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
+
+    // Already written by the temporal pass
+    if (flags.invalid || flags.emissive)
+        return;
+
+    float3 ld;
+
+    if(SkyDI_Util::IsResampled(DTid.xy, mr.y, g_frame.FrameNum))
+    {
+        RWTexture2D<float4> g_sparse = ResourceDescriptorHeap[g_local.SparseDescHeapIdx];
+        ld = g_sparse[DTid.xy].rgb;
+    }
+    else
+    {
+        GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
+            GBUFFER_OFFSET::DEPTH];
+
+        const float z_view = g_depth[DTid.xy];
+        const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(DTid.xy,
+            g_frame.CurrGBufferDescHeapOffset));
+
+        ld = Upsample(DTid.xy, z_view, normal, mr.y);
+    }
+
+    RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
+
+    if(g_frame.Accumulate && g_frame.CameraStatic && g_frame.NumFramesCameraStatic > 1)
+    {
+        float3 prev = g_final[DTid.xy].rgb;
+        g_final[DTid.xy].rgb = prev + ld;
+    }
+    else
+        g_final[DTid.xy].rgb = ld;
+}
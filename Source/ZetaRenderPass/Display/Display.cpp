@@ -1,12 +1,15 @@
 #include "Display.h"
+#include "EXR.h"
 #include <Core/CommandList.h>
 #include <Core/RenderGraph.h>
 #include <Scene/SceneCore.h>
+#include <RayTracing/RtCommon.h>
 #include <Scene/Camera.h>
 #include <Support/Param.h>
 #include <Support/Task.h>
 #include <Math/MatrixFuncs.h>
 #include <App/Log.h>
+#include <App/Filesystem.h>
 #include "../Assets/Font/IconsFontAwesome6.h"
 
 #if defined(__clang__)
@@ -28,6 +31,32 @@ using namespace ZetaRay::Math;
 using namespace ZetaRay::Util;
 using namespace ZetaRay::Core::Direct3DUtil;
 
+namespace
+{
+    // View frustum in world space
+    v_ViewFrustum CameraFrustumWorldSpace()
+    {
+        const auto& camera = App::GetCamera();
+        auto& frustum = camera.GetCameraFrustumViewSpace();
+        auto viewInv = camera.GetViewInv();
+
+        // Transform view frustum from view space into world space
+        v_float4x4 vM = load4x4(const_cast<float4x4a&>(viewInv));
+        v_ViewFrustum vFrustum(const_cast<ViewFrustum&>(frustum));
+
+        return transform(vM, vFrustum);
+    }
+
+    bool IsInsideFrustum(const v_ViewFrustum& vFrustum, uint64_t ID)
+    {
+        v_AABB vBox(App::GetScene().GetAABB(ID));
+        v_float4x4 vW = load4x3(App::GetScene().GetToWorld(ID));
+        vBox = transform(vW, vBox);
+
+        return instersectFrustumVsAABB(vFrustum, vBox) != COLLISION_TYPE::DISJOINT;
+    }
+}
+
 //--------------------------------------------------------------------------------------
 // DisplayPass
 //--------------------------------------------------------------------------------------
@@ -91,6 +120,12 @@ void DisplayPass::Init()
         m_cbLocal.AutoExposure);
     App::AddParam(p3);
 
+    ParamVariant p5;
+    p5.InitBool(ICON_FA_FILM " Renderer", "Display", "Fused Pick Outline", 
+        fastdelegate::MakeDelegate(this, &DisplayPass::FusedPickOutlineCallback),
+        m_fusedPickOutline);
+    App::AddParam(p5);
+
     if (m_cbLocal.Tonemapper != (uint16_t)Tonemapper::AgX_DEFAULT &&
         m_cbLocal.Tonemapper != (uint16_t)Tonemapper::AgX_GOLDEN &&
         m_cbLocal.Tonemapper != (uint16_t)Tonemapper::AgX_PUNCHY)
@@ -133,17 +168,16 @@ void DisplayPass::Init()
     m_rtvDescTable = renderer.GetRtvDescriptorHeap().Allocate(1);
     Direct3DUtil::CreateRTV(m_pickMask, m_rtvDescTable.CPUHandle(0));
     Direct3DUtil::CreateTexture2DSRV(m_pickMask, m_descTable.CPUHandle(DESC_TABLE::PICK_MASK_SRV));
+
+    // Nothing to record without a window
+    if (!renderer.IsHeadless())
+        m_videoRecorder.Init();
 }
 
-void DisplayPass::SetPickData(const Core::RenderNodeHandle& producerHandle,
-    Core::GpuMemory::ReadbackHeapBuffer* readback,
-    fastdelegate::FastDelegate0<> dlg)
+void DisplayPass::Shutdown()
 {
-    Assert(producerHandle.IsValid(), "Invalid handle.");
-    Assert(readback, "Readback buffer was NULL.");
-    m_producerHandle = producerHandle.Val;
-    m_readback = readback;
-    m_pickDlg = dlg;
+    if (m_videoRecorder.IsInitialized())
+        m_videoRecorder.Shutdown();
 }
 
 void DisplayPass::ClearPick()
@@ -151,14 +185,71 @@ void DisplayPass::ClearPick()
     App::RemoveParam(ICON_FA_FILM " Renderer", "Display", "Wireframe");
 }
 
-void DisplayPass::CaptureScreen()
+void DisplayPass::CaptureScreen(const char* path, const Texture* hdrSource, 
+    fastdelegate::FastDelegate0<> onWritten)
 {
     Assert(!m_captureScreen, "Duplicate call.");
 
-    auto& renderer = App::GetRenderer();
-    auto* device = renderer.GetDevice();
-    auto& backBuffer = renderer.GetCurrentBackBuffer();
-    auto desc = backBuffer.Desc();
+    const size_t pathLen = path ? strlen(path) : 0;
+    Check(pathLen < MAX_PATH, "Capture path is too long.");
+    m_captureHdr = pathLen >= 4 && _stricmp(path + pathLen - 4, ".exr") == 0;
+    Check(!m_captureHdr || hdrSource, "Capturing to EXR requires an HDR source.");
+
+    if (path)
+        memcpy(m_capturePath, path, pathLen + 1);
+    else
+        m_capturePath[0] = '\0';
+
+    m_onCaptureWritten = onWritten;
+    m_onCaptureReadback.clear();
+
+    const Texture* source = m_captureHdr ? hdrSource : &App::GetRenderer().GetCurrentBackBuffer();
+    PrepareScreenCapture(Span<const Texture*>(&source, 1));
+}
+
+void DisplayPass::CaptureScreenToMemory(const Texture* hdrSource, 
+    fastdelegate::FastDelegate1<const ScreenCapture&> onReadback)
+{
+    Assert(!m_captureScreen, "Duplicate call.");
+    Assert(onReadback, "Invalid delegate.");
+
+    m_captureHdr = hdrSource != nullptr;
+    m_onCaptureWritten.clear();
+    m_onCaptureReadback = onReadback;
+
+    const Texture* source = m_captureHdr ? hdrSource : &App::GetRenderer().GetCurrentBackBuffer();
+    PrepareScreenCapture(Span<const Texture*>(&source, 1));
+}
+
+void DisplayPass::CaptureScreenToMemory(Span<const Texture*> hdrSources,
+    fastdelegate::FastDelegate1<const ScreenCapture&> onReadback)
+{
+    Assert(!m_captureScreen, "Duplicate call.");
+    Assert(onReadback, "Invalid delegate.");
+    Assert(!hdrSources.empty(), "At least one source is required.");
+
+    m_captureHdr = true;
+    m_onCaptureWritten.clear();
+    m_onCaptureReadback = onReadback;
+
+    PrepareScreenCapture(hdrSources);
+}
+
+void DisplayPass::PrepareScreenCapture(Span<const Texture*> sources)
+{
+    Check(sources.size() <= MAX_NUM_CAPTURE_SOURCES, "Too many capture sources.");
+
+    auto* device = App::GetRenderer().GetDevice();
+    auto desc = sources[0]->Desc();
+
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        Assert(i == 0 || (sources[i]->Desc().Width == desc.Width && sources[i]->Desc().Height == desc.Height &&
+            sources[i]->Desc().Format == desc.Format), "All capture sources must have the same size and format.");
+        m_captureSources[i] = const_cast<Texture*>(sources[i])->Resource();
+    }
+
+    m_numCaptureSources = (uint32_t)sources.size();
 
     UINT64 totalResourceSize = 0;
     UINT64 rowSizeInBytes = 0;
@@ -172,7 +263,10 @@ void DisplayPass::CaptureScreen()
     // aligned to D3D12_TEXTURE_DATA_PITCH_ALIGNMENT."
     const uint32_t rowPitch = (uint32_t)Math::AlignUp(rowSizeInBytes, 
         (uint64_t)D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
-    const uint32_t sizeInBytes = rowPitch * desc.Height;
+    // Each image starts at a properly aligned offset
+    m_captureImageStride = (uint32_t)Math::AlignUp((uint64_t)rowPitch * desc.Height,
+        (uint64_t)D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+    const uint32_t sizeInBytes = m_captureImageStride * m_numCaptureSources;
     m_screenCaptureReadback = GpuMemory::GetReadbackHeapBuffer(sizeInBytes);
 
     m_backBufferFoorprint.Format = desc.Format;
@@ -200,6 +294,25 @@ void DisplayPass::Render(CommandList& cmdList)
     const uint32_t queryIdx = gpuTimer.BeginQuery(directCmdList, "Display");
 
     directCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
+
+    D3D12_VIEWPORT viewports[1] = { renderer.GetDisplayViewport() };
+    D3D12_RECT scissors[1] = { renderer.GetDisplayScissor() };
+    directCmdList.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    directCmdList.RSSetViewportsScissorsRects(1, viewports, scissors);
+
+    auto pickView = scene.GetPickedInstances();
+    Span<uint64_t> picks = pickView.View();
+    m_cbLocal.PickOutline = (uint16_t)PickOutline::NONE;
+
+    // When fused, masks have to be drawn before the display shader, which then outlines 
+    // them in the same draw
+    if (m_fusedPickOutline && !picks.empty() && DrawPickMasks(directCmdList, picks))
+    {
+        m_cbLocal.PickOutline = m_wireframe ? (uint16_t)PickOutline::WIREFRAME : 
+            (uint16_t)PickOutline::EDGES;
+        m_cbLocal.PickMaskDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::PICK_MASK_SRV);
+    }
+
     directCmdList.SetPipelineState(m_psoLib.GetPSO((int)DISPLAY_SHADER::DISPLAY));
 
     m_cbLocal.LUTDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::TONEMAPPER_LUT_SRV);
@@ -207,65 +320,48 @@ void DisplayPass::Render(CommandList& cmdList)
     m_rootSig.SetRootConstants(0, sizeof(cbDisplayPass) / sizeof(DWORD), &m_cbLocal);
     m_rootSig.End(directCmdList);
 
-    if (RenderNodeHandle(m_producerHandle).IsValid())
-    {
-        const uint64_t fence = scene.GetRenderGraph()->GetCompletionFence(
-            RenderNodeHandle(m_producerHandle));
-        Assert(fence != UINT64_MAX, "Invalid fence value.");
-
-        // Wait on a background thread for GPU to finish copying to readback buffer
-        Task t("WaitForGBuffer", TASK_PRIORITY::BACKGROUND, [this, fence]()
-            {
-                //HANDLE fenceEvent = CreateEventA(nullptr, false, false, nullptr);
-                //CheckWin32(fenceEvent);
-
-                App::GetRenderer().WaitForDirectQueueFenceCPU(fence);
-                //App::GetRenderer().WaitForDirectQueueFenceCPU(fence, fenceEvent);
-                //CloseHandle(fenceEvent);
-
-                ReadbackPickIdx();
-            });
-
-        App::SubmitBackground(ZetaMove(t));
-
-        m_producerHandle = RenderNodeHandle::INVALID_HANDLE;
-        m_pickDlg();
-    }
-
-    D3D12_VIEWPORT viewports[1] = { renderer.GetDisplayViewport() };
-    D3D12_RECT scissors[1] = { renderer.GetDisplayScissor() };
-    directCmdList.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    directCmdList.RSSetViewportsScissorsRects(1, viewports, scissors);
     Assert(m_cpuDescs[(int)SHADER_IN_CPU_DESC::RTV].ptr > 0, "RTV hasn't been set.");
     directCmdList.OMSetRenderTargets(1, &m_cpuDescs[(int)SHADER_IN_CPU_DESC::RTV], true, nullptr);
     directCmdList.DrawInstanced(3, 1, 0, 0);
 
-    if (auto picks = scene.GetPickedInstances().m_span; !picks.empty())
+    if (!m_fusedPickOutline && !picks.empty())
         DrawPicked(directCmdList, picks);
 
+    // Before the GUI is drawn on top
+    if (m_videoRecorder.IsRecording())
+        m_videoRecorder.Record(directCmdList);
+
     if (m_captureScreen)
     {
-        ID3D12Resource* backbuffer = const_cast<Texture&>(renderer.GetCurrentBackBuffer()).Resource();
-        directCmdList.ResourceBarrier(backbuffer,
-            D3D12_RESOURCE_STATE_RENDER_TARGET,
-            D3D12_RESOURCE_STATE_COPY_SOURCE);
-
-        D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
-        srcLocation.pResource = backbuffer;
-        srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-        srcLocation.SubresourceIndex = 0;
+        // HDR source is an input to this pass
+        const D3D12_RESOURCE_STATES sourceState = m_captureHdr ? 
+            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE :
+            D3D12_RESOURCE_STATE_RENDER_TARGET;
 
-        D3D12_TEXTURE_COPY_LOCATION dstLocation = {};
-        dstLocation.pResource = m_screenCaptureReadback.Resource();
-        dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-        dstLocation.PlacedFootprint.Footprint = m_backBufferFoorprint;
-
-        // Copy the texture
-        directCmdList.CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
-
-        directCmdList.ResourceBarrier(backbuffer,
-            D3D12_RESOURCE_STATE_COPY_SOURCE,
-            D3D12_RESOURCE_STATE_RENDER_TARGET);
+        for (uint32_t i = 0; i < m_numCaptureSources; i++)
+        {
+            directCmdList.ResourceBarrier(m_captureSources[i],
+                sourceState,
+                D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+            D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
+            srcLocation.pResource = m_captureSources[i];
+            srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+            srcLocation.SubresourceIndex = 0;
+
+            D3D12_TEXTURE_COPY_LOCATION dstLocation = {};
+            dstLocation.pResource = m_screenCaptureReadback.Resource();
+            dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+            dstLocation.PlacedFootprint.Offset = (UINT64)i * m_captureImageStride;
+            dstLocation.PlacedFootprint.Footprint = m_backBufferFoorprint;
+
+            // Copy the texture
+            directCmdList.CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
+
+            directCmdList.ResourceBarrier(m_captureSources[i],
+                D3D12_RESOURCE_STATE_COPY_SOURCE,
+                sourceState);
+        }
 
         // Wait on a background thread for GPU to finish copying to readback buffer
         Task t("WaitForCapture", TASK_PRIORITY::BACKGROUND, [this]()
@@ -286,6 +382,53 @@ void DisplayPass::Render(CommandList& cmdList)
         m_captureScreen = false;
     }
 
+    // Without the GUI pass, this is the last pass that renders to the back buffer
+    if (renderer.IsHeadless())
+    {
+        directCmdList.ResourceBarrier(const_cast<Texture&>(renderer.GetCurrentBackBuffer()).Resource(),
+            D3D12_RESOURCE_STATE_RENDER_TARGET,
+            D3D12_RESOURCE_STATE_PRESENT);
+    }
+
+    gpuTimer.EndQuery(directCmdList, queryIdx);
+    directCmdList.PIXEndEvent();
+}
+
+void DisplayPass::RenderInterpolated(CommandList& cmdList)
+{
+    Assert(cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_DIRECT, "Invalid downcast");
+    GraphicsCmdList& directCmdList = static_cast<GraphicsCmdList&>(cmdList);
+
+    Assert(m_interpolatedSrvDescHeapIdx != UINT32_MAX, "Gpu Desc Idx hasn't been set.");
+    Assert(m_cpuDescs[(int)SHADER_IN_CPU_DESC::INTERPOLATED_RTV].ptr > 0, "RTV hasn't been set.");
+
+    auto& renderer = App::GetRenderer();
+    auto& gpuTimer = renderer.GetGpuTimer();
+
+    directCmdList.PIXBeginEvent("DisplayInterpolated");
+    const uint32_t queryIdx = gpuTimer.BeginQuery(directCmdList, "DisplayInterpolated");
+
+    directCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
+
+    D3D12_VIEWPORT viewports[1] = { renderer.GetDisplayViewport() };
+    D3D12_RECT scissors[1] = { renderer.GetDisplayScissor() };
+    directCmdList.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    directCmdList.RSSetViewportsScissorsRects(1, viewports, scissors);
+
+    directCmdList.SetPipelineState(m_psoLib.GetPSO((int)DISPLAY_SHADER::DISPLAY));
+
+    // Pick outlines are only drawn on real frames
+    cbDisplayPass cb = m_cbLocal;
+    cb.PickOutline = (uint16_t)PickOutline::NONE;
+    cb.LUTDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::TONEMAPPER_LUT_SRV);
+    cb.InputDescHeapIdx = m_interpolatedSrvDescHeapIdx;
+    m_rootSig.SetRootConstants(0, sizeof(cbDisplayPass) / sizeof(DWORD), &cb);
+    m_rootSig.End(directCmdList);
+
+    directCmdList.OMSetRenderTargets(1, &m_cpuDescs[(int)SHADER_IN_CPU_DESC::INTERPOLATED_RTV], 
+        true, nullptr);
+    directCmdList.DrawInstanced(3, 1, 0, 0);
+
     gpuTimer.EndQuery(directCmdList, queryIdx);
     directCmdList.PIXEndEvent();
 }
@@ -293,59 +436,16 @@ void DisplayPass::Render(CommandList& cmdList)
 void DisplayPass::DrawPicked(GraphicsCmdList& cmdList, Span<uint64_t> picks)
 {
     Assert(!picks.empty(), "Invalid argument.");
-    const auto& camera = App::GetCamera();
-    auto& frustum = camera.GetCameraFrustumViewSpace();
-    auto viewInv = camera.GetViewInv();
-
-    // Transform view frustum from view space into world space
-    v_float4x4 vM = load4x4(const_cast<float4x4a&>(viewInv));
-    v_ViewFrustum vFrustum(const_cast<ViewFrustum&>(frustum));
-    vFrustum = transform(vM, vFrustum);
+    const v_ViewFrustum vFrustum = CameraFrustumWorldSpace();
 
     for (auto ID : picks)
     {
-        v_AABB vBox(App::GetScene().GetAABB(ID));
-        v_float4x4 vW = load4x3(App::GetScene().GetToWorld(ID));
-        vBox = transform(vW, vBox);
-
         // Skip if outside the view frustum
-        if (instersectFrustumVsAABB(vFrustum, vBox) == COLLISION_TYPE::DISJOINT)
+        if (!IsInsideFrustum(vFrustum, ID))
             continue;
 
         // Draw mask
         {
-            auto& scene = App::GetScene();
-            auto meshID = scene.GetInstanceMeshID(ID);
-            auto* mesh = scene.GetMesh(meshID).value();
-            float4x3 toWorld = scene.GetToWorld(ID);
-
-            const Camera& cam = App::GetCamera();
-            v_float4x4 vView = load4x4(const_cast<float4x4a&>(cam.GetCurrView()));
-            v_float4x4 vProj = load4x4(const_cast<float4x4a&>(cam.GetProj()));
-            v_float4x4 vVP = mul(vView, vProj);
-            v_float4x4 vW2 = load4x3(toWorld);
-            v_float4x4 vWVP = mul(vW2, vVP);
-            float4x4a wvp = store(vWVP);
-
-            cbDrawPicked cb;
-            cb.row0 = wvp.m[0];
-            cb.row1 = wvp.m[1];
-            cb.row2 = wvp.m[2];
-            cb.row3 = wvp.m[3];
-
-            const Buffer& sceneVB = App::GetScene().GetMeshVB();
-            const Buffer& sceneIB = App::GetScene().GetMeshIB();
-
-            D3D12_VERTEX_BUFFER_VIEW vbv;
-            vbv.StrideInBytes = sizeof(Vertex);
-            vbv.BufferLocation = sceneVB.GpuVA() + mesh->m_vtxBuffStartOffset * sizeof(Vertex);
-            vbv.SizeInBytes = mesh->m_numVertices * sizeof(Vertex);
-
-            D3D12_INDEX_BUFFER_VIEW ibv;
-            ibv.Format = DXGI_FORMAT_R32_UINT;
-            ibv.BufferLocation = sceneIB.GpuVA() + mesh->m_idxBuffStartOffset * sizeof(uint32);
-            ibv.SizeInBytes = mesh->m_numIndices * sizeof(uint32);
-
             auto layoutToRT = TextureBarrier(m_pickMask.Resource(),
                 D3D12_BARRIER_SYNC_NONE,
                 D3D12_BARRIER_SYNC_DRAW,
@@ -358,20 +458,12 @@ void DisplayPass::DrawPicked(GraphicsCmdList& cmdList, Span<uint64_t> picks)
             auto* pso = m_wireframe ? m_psoLib.GetPSO((int)DISPLAY_SHADER::DRAW_PICKED_WIREFRAME) :
                 m_psoLib.GetPSO((int)DISPLAY_SHADER::DRAW_PICKED);
             cmdList.SetPipelineState(pso);
-            cmdList.IASetVertexAndIndexBuffers(vbv, ibv);
             auto cpuHandle = m_rtvDescTable.CPUHandle(0);
             cmdList.OMSetRenderTargets(1, &cpuHandle, true, nullptr);
 
             cmdList.ClearRenderTargetView(cpuHandle, 0, 0, 0, 0);
 
-            m_rootSig.SetRootConstants(0, sizeof(cbDrawPicked) / sizeof(uint32), &cb);
-            m_rootSig.End(cmdList);
-
-            cmdList.DrawIndexedInstanced(mesh->m_numIndices,
-                1,
-                0,
-                0,
-                0);
+            DrawMask(cmdList, ID);
         }
 
         // Sobel
@@ -400,6 +492,110 @@ void DisplayPass::DrawPicked(GraphicsCmdList& cmdList, Span<uint64_t> picks)
     }
 }
 
+bool DisplayPass::DrawPickMasks(GraphicsCmdList& cmdList, Span<uint64_t> picks)
+{
+    Assert(!picks.empty(), "Invalid argument.");
+    const v_ViewFrustum vFrustum = CameraFrustumWorldSpace();
+    bool layoutIsRT = false;
+
+    // All the picks share the same mask, which is then outlined once by the display shader
+    for (auto ID : picks)
+    {
+        if (!IsInsideFrustum(vFrustum, ID))
+            continue;
+
+        if (!layoutIsRT)
+        {
+            auto layoutToRT = TextureBarrier(m_pickMask.Resource(),
+                D3D12_BARRIER_SYNC_NONE,
+                D3D12_BARRIER_SYNC_DRAW,
+                D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE,
+                D3D12_BARRIER_LAYOUT_RENDER_TARGET,
+                D3D12_BARRIER_ACCESS_NO_ACCESS,
+                D3D12_BARRIER_ACCESS_RENDER_TARGET);
+            cmdList.ResourceBarrier(layoutToRT);
+
+            auto* pso = m_wireframe ? m_psoLib.GetPSO((int)DISPLAY_SHADER::DRAW_PICKED_WIREFRAME) :
+                m_psoLib.GetPSO((int)DISPLAY_SHADER::DRAW_PICKED);
+            cmdList.SetPipelineState(pso);
+            auto cpuHandle = m_rtvDescTable.CPUHandle(0);
+            cmdList.OMSetRenderTargets(1, &cpuHandle, true, nullptr);
+
+            cmdList.ClearRenderTargetView(cpuHandle, 0, 0, 0, 0);
+            layoutIsRT = true;
+        }
+
+        DrawMask(cmdList, ID);
+    }
+
+    if (layoutIsRT)
+    {
+        auto syncDrawAndLayoutToRead = TextureBarrier(m_pickMask.Resource(),
+            D3D12_BARRIER_SYNC_DRAW,
+            D3D12_BARRIER_SYNC_PIXEL_SHADING,
+            D3D12_BARRIER_LAYOUT_RENDER_TARGET,
+            D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE,
+            D3D12_BARRIER_ACCESS_RENDER_TARGET,
+            D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+        cmdList.ResourceBarrier(syncDrawAndLayoutToRead);
+    }
+
+    return layoutIsRT;
+}
+
+void DisplayPass::DrawMask(GraphicsCmdList& cmdList, uint64_t ID)
+{
+    auto& scene = App::GetScene();
+    auto meshID = scene.GetInstanceMeshID(ID);
+    auto* mesh = scene.GetMesh(meshID).value();
+    float4x3 toWorld = scene.GetToWorld(ID);
+
+    const Camera& cam = App::GetCamera();
+    v_float4x4 vView = load4x4(const_cast<float4x4a&>(cam.GetCurrView()));
+    v_float4x4 vProj = load4x4(const_cast<float4x4a&>(cam.GetProj()));
+    v_float4x4 vVP = mul(vView, vProj);
+    v_float4x4 vW2 = load4x3(toWorld);
+#if COMPACT_VERTEX == 1
+    // Vertex positions are quantized relative to mesh's AABB
+    const float3 e = mesh->QuantizationExtents();
+    const float3 c = mesh->m_AABB.Center;
+    v_float4x4 vDequant = mul(scale(e.x, e.y, e.z), translate(c.x, c.y, c.z));
+    vW2 = mul(vDequant, vW2);
+#endif
+    v_float4x4 vWVP = mul(vW2, vVP);
+    float4x4a wvp = store(vWVP);
+
+    cbDrawPicked cb;
+    cb.row0 = wvp.m[0];
+    cb.row1 = wvp.m[1];
+    cb.row2 = wvp.m[2];
+    cb.row3 = wvp.m[3];
+
+    const Buffer& sceneVB = App::GetScene().GetMeshVB();
+    const Buffer& sceneIB = App::GetScene().GetMeshIB();
+
+    D3D12_VERTEX_BUFFER_VIEW vbv;
+    vbv.StrideInBytes = sizeof(RT::GpuVertex);
+    vbv.BufferLocation = sceneVB.GpuVA() + mesh->m_vtxBuffStartOffset * sizeof(RT::GpuVertex);
+    vbv.SizeInBytes = mesh->m_numVertices * sizeof(RT::GpuVertex);
+
+    D3D12_INDEX_BUFFER_VIEW ibv;
+    ibv.Format = mesh->Uses16BitIndices() ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    ibv.BufferLocation = sceneIB.GpuVA() + mesh->m_gpuIdxBuffOffset * mesh->IndexSizeInBytes();
+    ibv.SizeInBytes = mesh->m_numIndices * mesh->IndexSizeInBytes();
+
+    cmdList.IASetVertexAndIndexBuffers(vbv, ibv);
+
+    m_rootSig.SetRootConstants(0, sizeof(cbDrawPicked) / sizeof(uint32), &cb);
+    m_rootSig.End(cmdList);
+
+    cmdList.DrawIndexedInstanced(mesh->m_numIndices,
+        1,
+        0,
+        0,
+        0);
+}
+
 void DisplayPass::CreatePSOs()
 {
     // Display
@@ -418,7 +614,7 @@ void DisplayPass::CreatePSOs()
         // disable triangle culling
         psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 
-        m_psoLib.CompileGraphicsPSO((int)DISPLAY_SHADER::DISPLAY,
+        m_psoLib.EnqueueGraphicsPSO((int)DISPLAY_SHADER::DISPLAY,
             psoDesc,
             m_rootSigObj.Get(),
             COMPILED_VS[(int)DISPLAY_SHADER::DISPLAY],
@@ -427,16 +623,16 @@ void DisplayPass::CreatePSOs()
 
     // Draw mask
     {
+        // Only position is needed for drawing the mask
         D3D12_INPUT_ELEMENT_DESC inputElements[] =
         {
+#if COMPACT_VERTEX == 1
+            { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, 
+                D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+#else
             { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, 
-                D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-            { "TEXUV", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, 
-                D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-            { "NORMAL", 0, DXGI_FORMAT_R16G16_SINT, 0, D3D12_APPEND_ALIGNED_ELEMENT, 
-                D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-            { "TANGENT", 0, DXGI_FORMAT_R16G16_SINT, 0, D3D12_APPEND_ALIGNED_ELEMENT, 
                 D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+#endif
         };
 
         D3D12_INPUT_LAYOUT_DESC inputLayout = D3D12_INPUT_LAYOUT_DESC{ .pInputElementDescs = inputElements, 
@@ -454,7 +650,7 @@ void DisplayPass::CreatePSOs()
         psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
         psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS;
 
-        m_psoLib.CompileGraphicsPSO((int)DISPLAY_SHADER::DRAW_PICKED,
+        m_psoLib.EnqueueGraphicsPSO((int)DISPLAY_SHADER::DRAW_PICKED,
             psoDesc,
             m_rootSigObj.Get(),
             COMPILED_VS[(int)DISPLAY_SHADER::DRAW_PICKED],
@@ -462,7 +658,7 @@ void DisplayPass::CreatePSOs()
 
         psoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
 
-        m_psoLib.CompileGraphicsPSO((int)DISPLAY_SHADER::DRAW_PICKED_WIREFRAME,
+        m_psoLib.EnqueueGraphicsPSO((int)DISPLAY_SHADER::DRAW_PICKED_WIREFRAME,
             psoDesc,
             m_rootSigObj.Get(),
             COMPILED_VS[(int)DISPLAY_SHADER::DRAW_PICKED],
@@ -483,7 +679,7 @@ void DisplayPass::CreatePSOs()
         // disable triangle culling
         psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 
-        m_psoLib.CompileGraphicsPSO((int)DISPLAY_SHADER::SOBEL,
+        m_psoLib.EnqueueGraphicsPSO((int)DISPLAY_SHADER::SOBEL,
             psoDesc,
             m_rootSigObj.Get(),
             COMPILED_VS[(int)DISPLAY_SHADER::SOBEL],
@@ -491,19 +687,14 @@ void DisplayPass::CreatePSOs()
     }
 }
 
-void DisplayPass::ReadbackPickIdx()
+void DisplayPass::OnPickReadback(Span<uint8_t> data)
 {
-    Assert(m_readback, "Readback buffer hasn't been set.");
+    Assert(data.size() == sizeof(uint32), "Unexpected readback size.");
     auto& scene = App::GetScene();
-    auto pickWasDisabled = scene.GetPickedInstances().m_span.empty();
-    m_readback->Map();
+    auto pickWasDisabled = scene.GetPickedInstances().View().empty();
 
-    uint32* data = reinterpret_cast<uint32*>(m_readback->MappedMemory());
     uint32 rtMeshIdx;
-    memcpy(&rtMeshIdx, data, sizeof(uint32));
-
-    m_readback->Unmap();
-    m_readback = nullptr;
+    memcpy(&rtMeshIdx, data.data(), sizeof(uint32));
 
     if (rtMeshIdx == UINT32_MAX)
         return;
@@ -526,24 +717,54 @@ void DisplayPass::ReadbackScreenCapture()
     Assert(m_screenCaptureReadback.IsInitialized(), "Readback buffer hasn't been initialized.");
 
     m_screenCaptureReadback.Map();
-    uint32_t* data = reinterpret_cast<uint32_t*>(m_screenCaptureReadback.MappedMemory());
+    uint8_t* data = reinterpret_cast<uint8_t*>(m_screenCaptureReadback.MappedMemory());
 
-    SYSTEMTIME st;
-    GetLocalTime(&st);
-    StackStr(currTime, N1, "%u_%u_%u_%u_%u_%u", st.wYear, st.wMonth, st.wDay, 
-        st.wHour, st.wMinute, st.wSecond);
+    if (m_onCaptureReadback)
+    {
+        ScreenCapture capture{ .Data = data,
+            .Width = m_backBufferFoorprint.Width,
+            .Height = m_backBufferFoorprint.Height,
+            .RowPitch = m_backBufferFoorprint.RowPitch,
+            .NumImages = m_numCaptureSources,
+            .ImageStride = m_captureImageStride };
+        m_onCaptureReadback(capture);
 
-    uint32_t hash = Util::XXH3_64_To_32(XXH3_64bits(currTime, N1));
-    StackStr(filename, N2, "capture_%u.png", hash);
+        m_screenCaptureReadback.Unmap();
+        m_screenCaptureReadback.Reset(false);
 
-    int res = stbi_write_png(filename, m_backBufferFoorprint.Width, m_backBufferFoorprint.Height,
-        4, data, m_backBufferFoorprint.RowPitch);
-    Check(res != 0, "stbi_write_png() failed.");
+        return;
+    }
+
+    if (m_capturePath[0] == '\0')
+    {
+        SYSTEMTIME st;
+        GetLocalTime(&st);
+        StackStr(currTime, N1, "%u_%u_%u_%u_%u_%u", st.wYear, st.wMonth, st.wDay, 
+            st.wHour, st.wMinute, st.wSecond);
+
+        uint32_t hash = Util::XXH3_64_To_32(XXH3_64bits(currTime, N1));
+        stbsp_snprintf(m_capturePath, MAX_PATH, "capture_%u.png", hash);
+    }
+
+    if (m_captureHdr)
+    {
+        EXR::Write(m_capturePath, m_backBufferFoorprint.Width, m_backBufferFoorprint.Height,
+            data, m_backBufferFoorprint.RowPitch);
+    }
+    else
+    {
+        int res = stbi_write_png(m_capturePath, m_backBufferFoorprint.Width, m_backBufferFoorprint.Height,
+            4, data, m_backBufferFoorprint.RowPitch);
+        Check(res != 0, "stbi_write_png() failed.");
+    }
 
     m_screenCaptureReadback.Unmap();
     m_screenCaptureReadback.Reset(false);
 
-    LOG_UI_INFO("Screenshot saved to: %s.\n", filename);
+    LOG_UI_INFO("Screenshot saved to: %s.\n", m_capturePath);
+
+    if (m_onCaptureWritten)
+        m_onCaptureWritten();
 }
 
 void DisplayPass::DisplayOptionCallback(const ParamVariant& p)
@@ -617,3 +838,8 @@ void DisplayPass::WireframeCallback(const Support::ParamVariant& p)
 {
     m_wireframe = p.GetBool();
 }
+
+void DisplayPass::FusedPickOutlineCallback(const Support::ParamVariant& p)
+{
+    m_fusedPickOutline = p.GetBool();
+}
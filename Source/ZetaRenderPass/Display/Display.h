@@ -4,17 +4,12 @@
 #include <Core/GpuMemory.h>
 #include <Scene/SceneCommon.h>
 #include "Display_Common.h"
+#include "../VideoRecorder/VideoRecorder.h"
 
 namespace ZetaRay::Core
 {
     class CommandList;
     class GraphicsCmdList;
-    struct RenderNodeHandle;
-}
-
-namespace ZetaRay::Core::GpuMemory
-{
-    struct ReadbackHeapBuffer;
 }
 
 namespace ZetaRay::Support
@@ -33,11 +28,30 @@ namespace ZetaRay::RenderPass
         COUNT
     };
 
+    // Pixels of a screen capture that was read back to memory (see DisplayPass). When 
+    // several sources were captured together, their images follow one another.
+    struct ScreenCapture
+    {
+        ZetaInline const uint8_t* Image(uint32_t i) const
+        {
+            Assert(i < NumImages, "Out-of-bound access.");
+            return Data + (size_t)i * ImageStride;
+        }
+
+        const uint8_t* Data;
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t RowPitch;
+        uint32_t NumImages;
+        uint32_t ImageStride;
+    };
+
     struct DisplayPass final : public RenderPassBase<(int)DISPLAY_SHADER::COUNT>
     {
         enum class SHADER_IN_CPU_DESC
         {
             RTV,
+            INTERPOLATED_RTV,
             COUNT
         };
 
@@ -45,6 +59,7 @@ namespace ZetaRay::RenderPass
         {
             COMPOSITED,
             EXPOSURE,
+            INTERPOLATED,
             COUNT
         };
 
@@ -53,6 +68,8 @@ namespace ZetaRay::RenderPass
 
         void InitPSOs();
         void Init();
+        // Finalizes the video that's being recorded, if any
+        void Shutdown();
         void SetCpuDescriptor(SHADER_IN_CPU_DESC i, D3D12_CPU_DESCRIPTOR_HANDLE h)
         {
             Assert((int)i < (int)SHADER_IN_CPU_DESC::COUNT, "out-of-bound access.");
@@ -69,22 +86,42 @@ namespace ZetaRay::RenderPass
             case SHADER_IN_GPU_DESC::EXPOSURE:
                 m_cbLocal.ExposureDescHeapIdx = dechHeapIdx;
                 break;
+            case SHADER_IN_GPU_DESC::INTERPOLATED:
+                m_interpolatedSrvDescHeapIdx = dechHeapIdx;
+                break;
             default:
                 break;
             }
         }
-        void SetPickData(const Core::RenderNodeHandle& producerHandle, 
-            Core::GpuMemory::ReadbackHeapBuffer* readback,
-            fastdelegate::FastDelegate0<> dlg);
+        // Readback callback for the picked RT mesh index
+        void OnPickReadback(Util::Span<uint8_t> data);
         void ClearPick();
-        void CaptureScreen();
+        // Copies the back buffer once it's rendered this frame and writes it to disk as PNG on 
+        // a background thread. When the path ends in .exr, the given linear HDR texture is 
+        // written instead. Without a path, a unique name in the working directory is used. 
+        // onWritten is called from the background thread after the file is written.
+        void CaptureScreen(const char* path = nullptr, const Core::GpuMemory::Texture* hdrSource = nullptr,
+            fastdelegate::FastDelegate0<> onWritten = fastdelegate::FastDelegate0<>());
+        // Same as above, except that nothing is written to disk. onReadback is called from the 
+        // background thread with the captured pixels (of the back buffer, or hdrSource when 
+        // given), which are only valid during the call.
+        void CaptureScreenToMemory(const Core::GpuMemory::Texture* hdrSource, 
+            fastdelegate::FastDelegate1<const ScreenCapture&> onReadback);
+        // Captures several HDR textures of the same size and format in the same frame, e.g. 
+        // an image along with its auxiliary buffers. Sources are expected to be inputs to 
+        // this pass.
+        void CaptureScreenToMemory(Util::Span<const Core::GpuMemory::Texture*> hdrSources,
+            fastdelegate::FastDelegate1<const ScreenCapture&> onReadback);
         void Render(Core::CommandList& cmdList);
+        // Tonemaps the interpolated frame (see FrameInterpolation) into its back buffer
+        void RenderInterpolated(Core::CommandList& cmdList);
 
     private:
         static constexpr int NUM_CBV = 1;
         static constexpr int NUM_SRV = 0;
         static constexpr int NUM_UAV = 0;
         static constexpr int NUM_GLOBS = 1;
+        static constexpr int MAX_NUM_CAPTURE_SOURCES = 3;
         static constexpr int NUM_CONSTS = (int)Math::Max((sizeof(cbDisplayPass) / sizeof(DWORD)),
             sizeof(cbDrawPicked) / sizeof(DWORD));
 
@@ -121,8 +158,12 @@ namespace ZetaRay::RenderPass
         };
 
         void DrawPicked(Core::GraphicsCmdList& cmdList, Util::Span<uint64_t> picks);
+        // Draws the masks of all the visible picks into the same texture. Returns false if 
+        // none was visible.
+        bool DrawPickMasks(Core::GraphicsCmdList& cmdList, Util::Span<uint64_t> picks);
+        void DrawMask(Core::GraphicsCmdList& cmdList, uint64_t ID);
         void CreatePSOs();
-        void ReadbackPickIdx();
+        void PrepareScreenCapture(Util::Span<const Core::GpuMemory::Texture*> sources);
         void ReadbackScreenCapture();
 
         // parameter callbacks
@@ -133,22 +174,34 @@ namespace ZetaRay::RenderPass
         void AutoExposureCallback(const Support::ParamVariant& p);
         void RoughnessThCallback(const Support::ParamVariant& p);
         void WireframeCallback(const Support::ParamVariant& p);
+        void FusedPickOutlineCallback(const Support::ParamVariant& p);
 
         Core::GpuMemory::Texture m_lut;
         Core::DescriptorTable m_descTable;
         D3D12_CPU_DESCRIPTOR_HANDLE m_cpuDescs[(int)SHADER_IN_CPU_DESC::COUNT] = { 0 };
         cbDisplayPass m_cbLocal;
         uint32_t m_compositedSrvDescHeapIdx = UINT32_MAX;
+        uint32_t m_interpolatedSrvDescHeapIdx = UINT32_MAX;
         Core::DescriptorTable m_rtvDescTable;
         // Picking data
-        int m_producerHandle = -1;
-        Core::GpuMemory::ReadbackHeapBuffer* m_readback = nullptr;
-        fastdelegate::FastDelegate0<> m_pickDlg;
         Core::GpuMemory::Texture m_pickMask;
         bool m_wireframe = false;
+        // Outline the picks in the display shader instead of a separate Sobel draw per pick
+        bool m_fusedPickOutline = false;
         // Screen capture data
         Core::GpuMemory::ReadbackHeapBuffer m_screenCaptureReadback;
         D3D12_SUBRESOURCE_FOOTPRINT m_backBufferFoorprint;
+        // Back buffer unless capturing to EXR
+        ID3D12Resource* m_captureSources[MAX_NUM_CAPTURE_SOURCES] = { nullptr };
+        uint32_t m_numCaptureSources = 0;
+        // Offset between consecutive images in the readback buffer
+        uint32_t m_captureImageStride = 0;
+        fastdelegate::FastDelegate0<> m_onCaptureWritten;
+        fastdelegate::FastDelegate1<const ScreenCapture&> m_onCaptureReadback;
+        char m_capturePath[MAX_PATH] = { '\0' };
         bool m_captureScreen = false;
+        bool m_captureHdr = false;
+        // Continuous capture of the back buffer to video
+        VideoRecorder m_videoRecorder;
     };
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "../Common/Math.hlsli"
 #include "../Common/FrameConstants.h"
 #include "../Common/GBuffers.hlsli"
+#include "Sobel.hlsli"
 
 //--------------------------------------------------------------------------------------
 // Root Signature
@@ -43,6 +44,16 @@ float4 mainPS(VSOut psin) : SV_Target
 {
     const float2 uv = psin.PosSS.xy / float2(g_frame.DisplayWidth, g_frame.DisplayHeight);
 
+    if(g_local.PickOutline != (int) PickOutline::NONE)
+    {
+        Texture2D<float> g_mask = ResourceDescriptorHeap[g_local.PickMaskDescHeapIdx];
+        const int2 renderDim = int2(g_frame.RenderWidth, g_frame.RenderHeight);
+        const bool wireframe = g_local.PickOutline == (int) PickOutline::WIREFRAME;
+
+        if(Sobel::IsOnOutline(int2(psin.PosSS.xy), g_mask, renderDim, wireframe))
+            return float4(Sobel::OUTLINE_COLOR, 1);
+    }
+
     Texture2D<float4> g_composited = ResourceDescriptorHeap[g_local.InputDescHeapIdx];
     // float3 composited = g_composited[psin.PosSS.xy].rgb;
     float3 composited = g_composited.SampleLevel(g_samPointClamp, uv, 0).rgb;
@@ -53,6 +64,10 @@ float4 mainPS(VSOut psin) : SV_Target
     if(g_local.DisplayOption != (int)DisplayOption::DEFAULT && z == FLT_MAX)
         return 0;
 
+    // Point sampling equivalent for g-buffer targets that can't be sampled
+    const uint2 gbufferPixel = min(uint2(uv * float2(g_frame.RenderWidth, g_frame.RenderHeight)), 
+        uint2(g_frame.RenderWidth - 1, g_frame.RenderHeight - 1));
+
     if(g_local.AutoExposure)
     {
         Texture2D<float2> g_exposure = ResourceDescriptorHeap[g_local.ExposureDescHeapIdx];
@@ -83,22 +98,17 @@ float4 mainPS(VSOut psin) : SV_Target
     }
     else if (g_local.DisplayOption == (int) DisplayOption::NORMAL)
     {
-        GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + GBUFFER_OFFSET::NORMAL];
-        float2 encodedNormal = g_normal.SampleLevel(g_samPointClamp, uv, 0);
+        float2 encodedNormal = GBuffer::LoadNormal(gbufferPixel, g_frame.CurrGBufferDescHeapOffset);
         display = Math::DecodeUnitVector(encodedNormal.xy);
         display = display * 0.5 + 0.5;
     }
     else if (g_local.DisplayOption == (int) DisplayOption::BASE_COLOR)
     {
-        GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::BASE_COLOR];
-        display = g_baseColor.SampleLevel(g_samPointClamp, uv, 0).xyz;
+        display = GBuffer::LoadBaseColor(gbufferPixel, g_frame.CurrGBufferDescHeapOffset).xyz;
     }
     else if (g_local.DisplayOption == (int) DisplayOption::METALNESS_ROUGHNESS)
     {
-        GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-        float2 mr = g_metallicRoughness.SampleLevel(g_samPointClamp, uv, 0);
+        float2 mr = GBuffer::LoadMetallicRoughness(gbufferPixel, g_frame.CurrGBufferDescHeapOffset);
         GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
         mr.x = flags.metallic;
 
@@ -106,43 +116,33 @@ float4 mainPS(VSOut psin) : SV_Target
     }
     else if (g_local.DisplayOption == (int) DisplayOption::COAT_WEIGHT)
     {
-        GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-        float2 mr = g_metallicRoughness.SampleLevel(g_samPointClamp, uv, 0);
+        float2 mr = GBuffer::LoadMetallicRoughness(gbufferPixel, g_frame.CurrGBufferDescHeapOffset);
         GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
         display = 0;
 
         if(flags.coated)
         {
-            GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-                GBUFFER_OFFSET::COAT];
-            uint3 packed = g_coat[psin.PosSS.xy].xyz;
+            uint3 packed = GBuffer::LoadCoat(gbufferPixel, g_frame.CurrGBufferDescHeapOffset);
             GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
             display = coat.weight;
         }
     }
     else if (g_local.DisplayOption == (int) DisplayOption::COAT_COLOR)
     {
-        GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-        float2 mr = g_metallicRoughness.SampleLevel(g_samPointClamp, uv, 0);
+        float2 mr = GBuffer::LoadMetallicRoughness(gbufferPixel, g_frame.CurrGBufferDescHeapOffset);
         GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
         display = 0;
 
         if(flags.coated)
         {
-            GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-                GBUFFER_OFFSET::COAT];
-            uint3 packed = g_coat[psin.PosSS.xy].xyz;
+            uint3 packed = GBuffer::LoadCoat(gbufferPixel, g_frame.CurrGBufferDescHeapOffset);
             GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
             display = coat.color;
         }
     }
     else if (g_local.DisplayOption == (int) DisplayOption::ROUGHNESS_TH)
     {
-        GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-        float r = g_metallicRoughness.SampleLevel(g_samPointClamp, uv, 0).y;
+        float r = GBuffer::LoadMetallicRoughness(gbufferPixel, g_frame.CurrGBufferDescHeapOffset).y;
 
         display = (r >= g_local.RoughnessTh) * float3(0.26, 0.014, 0.021);
     }
@@ -150,22 +150,16 @@ float4 mainPS(VSOut psin) : SV_Target
     {
         GBUFFER_EMISSIVE_COLOR g_emissiveColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
             GBUFFER_OFFSET::EMISSIVE_COLOR];
-        GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::BASE_COLOR];
 
-        GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-        float m = g_metallicRoughness.SampleLevel(g_samPointClamp, uv, 0).x;
+        float m = GBuffer::LoadMetallicRoughness(gbufferPixel, g_frame.CurrGBufferDescHeapOffset).x;
         GBuffer::Flags flags = GBuffer::DecodeMetallic(m);
 
         display = flags.emissive ? g_emissiveColor.SampleLevel(g_samPointClamp, uv, 0).rgb :
-            g_baseColor.SampleLevel(g_samPointClamp, uv, 0).xyz * 0.005;
+            GBuffer::LoadBaseColor(gbufferPixel, g_frame.CurrGBufferDescHeapOffset).xyz * 0.005;
     }
     else if (g_local.DisplayOption == (int) DisplayOption::TRANSMISSION)
     {
-        GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-        float m = g_metallicRoughness.SampleLevel(g_samPointClamp, uv, 0).x;
+        float m = GBuffer::LoadMetallicRoughness(gbufferPixel, g_frame.CurrGBufferDescHeapOffset).x;
         GBuffer::Flags flags = GBuffer::DecodeMetallic(m);
 
         display = float3(flags.transmissive, !flags.transmissive, 0);
@@ -29,16 +29,27 @@ enum class Tonemapper
     COUNT
 };
 
+// Outline of picked objects that is drawn by the display pass itself, rather than 
+// by a separate Sobel draw
+enum class PickOutline
+{
+    NONE,
+    EDGES,
+    WIREFRAME,
+    COUNT
+};
+
 struct cbDisplayPass
 {
     uint16_t DisplayOption;
     uint16_t Tonemapper;
     uint16_t AutoExposure;
-    uint16_t pad;
+    uint16_t PickOutline;
 
     uint32_t InputDescHeapIdx;
     uint32_t ExposureDescHeapIdx;
     uint32_t LUTDescHeapIdx;
+    uint32_t PickMaskDescHeapIdx;
 
     float Saturation;
     float AgXExp;
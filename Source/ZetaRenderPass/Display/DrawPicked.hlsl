@@ -8,9 +8,6 @@
 struct VSIn
 {
     float3 PosL : POSITION;
-    float2 TexUV : TEXUV;
-    int2 NormalL : NORMAL;
-    int2 TangentU : TANGENT;
 };
 
 struct VSOut
@@ -0,0 +1,298 @@
+#include "EXR.h"
+#include <App/Filesystem.h>
+#include <Math/Color.h>
+#include <Utility/SmallVector.h>
+#include <Utility/Error.h>
+
+using namespace ZetaRay::RenderPass;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    static constexpr size_t MAX_HEADER_SIZE = 512;
+    static constexpr uint32_t MAGIC_NUMBER = 20000630;
+    static constexpr size_t CHANNEL_LIST_SIZE = 3 * 18 + 1;
+    static constexpr uint32_t MERGE_ROWS_PER_CHUNK = 64;
+
+    struct MergeInput
+    {
+        App::Filesystem::MappedFile File;
+        const uint64_t* OffsetTable;
+    };
+
+    ZetaInline void Append(uint8_t* dst, size_t& offset, const void* src, size_t n)
+    {
+        memcpy(dst + offset, src, n);
+        offset += n;
+    }
+
+    // Every scanline is a block -- y coordinate, size in bytes, and then all the pixels of 
+    // each channel in turn
+    ZetaInline uint32_t LineDataSize(uint32_t width)
+    {
+        return width * 3 * sizeof(uint16_t);
+    }
+
+    ZetaInline size_t BlockSize(uint32_t width)
+    {
+        return 2 * sizeof(int32_t) + LineDataSize(width);
+    }
+
+    // Channels have to be sorted by name. Each entry is name, pixel type (HALF), 
+    // pLinear + reserved, x sampling and y sampling.
+    void EncodeChannelList(uint8_t* chlist)
+    {
+        size_t chlistSize = 0;
+        for (const char* c : { "B", "G", "R" })
+        {
+            const int32_t desc[4] = { 1, 0, 1, 1 };
+            Append(chlist, chlistSize, c, 2);
+            Append(chlist, chlistSize, desc, sizeof(desc));
+        }
+        chlist[chlistSize++] = '\0';
+    }
+
+    // Writes the header followed by the offset table and returns the number of bytes written
+    size_t EncodeHeader(uint32_t width, uint32_t height, uint8_t* dst)
+    {
+        uint8_t header[MAX_HEADER_SIZE];
+        size_t headerSize = 0;
+
+        auto writeAttrib = [&header, &headerSize](const char* name, const char* type, 
+            uint32_t size, const void* val)
+            {
+                Append(header, headerSize, name, strlen(name) + 1);
+                Append(header, headerSize, type, strlen(type) + 1);
+                Append(header, headerSize, &size, sizeof(size));
+                Append(header, headerSize, val, size);
+            };
+
+        const uint32_t magicAndVersion[2] = { MAGIC_NUMBER, 2 };
+        Append(header, headerSize, magicAndVersion, sizeof(magicAndVersion));
+
+        uint8_t chlist[CHANNEL_LIST_SIZE];
+        EncodeChannelList(chlist);
+
+        const uint8_t compression = 0;
+        const int32_t window[4] = { 0, 0, (int32_t)width - 1, (int32_t)height - 1 };
+        const uint8_t lineOrder = 0;
+        const float pixelAspectRatio = 1.0f;
+        const float screenWindowCenter[2] = { 0.0f, 0.0f };
+        const float screenWindowWidth = 1.0f;
+
+        writeAttrib("channels", "chlist", sizeof(chlist), chlist);
+        writeAttrib("compression", "compression", sizeof(compression), &compression);
+        writeAttrib("dataWindow", "box2i", sizeof(window), window);
+        writeAttrib("displayWindow", "box2i", sizeof(window), window);
+        writeAttrib("lineOrder", "lineOrder", sizeof(lineOrder), &lineOrder);
+        writeAttrib("pixelAspectRatio", "float", sizeof(pixelAspectRatio), &pixelAspectRatio);
+        writeAttrib("screenWindowCenter", "v2f", sizeof(screenWindowCenter), screenWindowCenter);
+        writeAttrib("screenWindowWidth", "float", sizeof(screenWindowWidth), &screenWindowWidth);
+        header[headerSize++] = '\0';
+
+        size_t offset = 0;
+        Append(dst, offset, header, headerSize);
+
+        const size_t offsetTableSize = height * sizeof(uint64_t);
+        const size_t blockSize = BlockSize(width);
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            const uint64_t blockOffset = headerSize + offsetTableSize + y * blockSize;
+            Append(dst, offset, &blockOffset, sizeof(blockOffset));
+        }
+
+        return offset;
+    }
+
+    // Only accepts the layout that EncodeHeader() writes. Returns the offset of the offset table.
+    size_t DecodeHeader(const App::Filesystem::MappedFile& f, uint32_t& width, uint32_t& height)
+    {
+        const uint8_t* p = f.Data;
+        const uint8_t* end = f.Data + f.Size;
+        if (f.Size < 2 * sizeof(uint32_t))
+            return 0;
+
+        uint32_t magic;
+        memcpy(&magic, p, sizeof(magic));
+        if (magic != MAGIC_NUMBER)
+            return 0;
+
+        p += 2 * sizeof(uint32_t);
+
+        uint8_t expectedChlist[CHANNEL_LIST_SIZE];
+        EncodeChannelList(expectedChlist);
+        int32_t window[4] = { 0, 0, -1, -1 };
+        bool validChannels = false;
+        bool uncompressed = false;
+
+        while (p < end && *p != '\0')
+        {
+            const char* name = reinterpret_cast<const char*>(p);
+            p += strnlen(name, end - p) + 1;
+            const char* type = reinterpret_cast<const char*>(p);
+            p += strnlen(type, end - p) + 1;
+
+            uint32_t size;
+            if (p + sizeof(size) > end)
+                return 0;
+
+            memcpy(&size, p, sizeof(size));
+            p += sizeof(size);
+
+            if (p + size > end)
+                return 0;
+
+            if (strcmp(name, "channels") == 0)
+                validChannels = size == CHANNEL_LIST_SIZE && memcmp(p, expectedChlist, size) == 0;
+            else if (strcmp(name, "compression") == 0)
+                uncompressed = size == 1 && *p == 0;
+            else if (strcmp(name, "dataWindow") == 0 && size == sizeof(window))
+                memcpy(window, p, sizeof(window));
+
+            p += size;
+        }
+
+        if (p >= end || !validChannels || !uncompressed || window[0] != 0 || window[1] != 0 ||
+            window[2] < 0 || window[3] < 0)
+        {
+            return 0;
+        }
+
+        width = window[2] + 1;
+        height = window[3] + 1;
+        const size_t offsetTable = p + 1 - f.Data;
+
+        if (offsetTable + height * (sizeof(uint64_t) + BlockSize(width)) > f.Size)
+            return 0;
+
+        return offsetTable;
+    }
+
+    void EncodeScanlines(uint32_t width, uint32_t firstRow, uint32_t numRows, const uint8_t* data,
+        uint32_t rowPitch, uint8_t* dst)
+    {
+        const uint32_t lineDataSize = LineDataSize(width);
+        size_t offset = 0;
+
+        for (uint32_t y = 0; y < numRows; y++)
+        {
+            const int32_t blockHeader[2] = { (int32_t)(firstRow + y), (int32_t)lineDataSize };
+            Append(dst, offset, blockHeader, sizeof(blockHeader));
+
+            const float4* row = reinterpret_cast<const float4*>(data + y * rowPitch);
+            uint16_t* b = reinterpret_cast<uint16_t*>(dst + offset);
+            uint16_t* g = b + width;
+            uint16_t* r = g + width;
+
+            RGBAToPlanarHalf(Span(row, width), MutableSpan(r, width), MutableSpan(g, width),
+                MutableSpan(b, width));
+
+            offset += lineDataSize;
+        }
+    }
+}
+
+void EXR::Write(const char* path, uint32_t width, uint32_t height, const uint8_t* data, 
+    uint32_t rowPitch)
+{
+    const size_t fileSize = MAX_HEADER_SIZE + height * (sizeof(uint64_t) + BlockSize(width));
+    Check(fileSize <= UINT32_MAX, "Image is too large.");
+
+    SmallVector<uint8_t> file;
+    file.resize_uninitialized(fileSize);
+
+    const size_t headerSize = EncodeHeader(width, height, file.data());
+    EncodeScanlines(width, 0, height, data, rowPitch, file.data() + headerSize);
+
+    const size_t size = headerSize + height * BlockSize(width);
+    App::Filesystem::WriteToFile(path, file.data(), (uint32_t)size);
+}
+
+void EXR::BeginFile(const char* path, uint32_t width, uint32_t height)
+{
+    const size_t maxSize = MAX_HEADER_SIZE + height * sizeof(uint64_t);
+    Check(maxSize <= UINT32_MAX, "Image is too large.");
+
+    SmallVector<uint8_t> header;
+    header.resize_uninitialized(maxSize);
+
+    const size_t headerSize = EncodeHeader(width, height, header.data());
+    App::Filesystem::WriteToFile(path, header.data(), (uint32_t)headerSize);
+}
+
+void EXR::AppendScanlines(const char* path, uint32_t width, uint32_t firstRow, uint32_t numRows,
+    const uint8_t* data, uint32_t rowPitch)
+{
+    const size_t size = numRows * BlockSize(width);
+    Check(size <= UINT32_MAX, "Too many scanlines in one call.");
+
+    SmallVector<uint8_t> blocks;
+    blocks.resize_uninitialized(size);
+
+    EncodeScanlines(width, firstRow, numRows, data, rowPitch, blocks.data());
+    App::Filesystem::AppendToFile(path, blocks.data(), (uint32_t)size);
+}
+
+void EXR::Merge(const char* outPath, Span<const char*> inPaths)
+{
+    Check(!inPaths.empty(), "No images to merge.");
+
+    SmallVector<MergeInput> inputs;
+    inputs.resize(inPaths.size());
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    for (size_t i = 0; i < inPaths.size(); i++)
+    {
+        Check(App::Filesystem::MapFile(inPaths[i], inputs[i].File), "Couldn't open %s.", inPaths[i]);
+
+        uint32_t w;
+        uint32_t h;
+        const size_t offsetTable = DecodeHeader(inputs[i].File, w, h);
+        Check(offsetTable, "Unsupported EXR file: %s.", inPaths[i]);
+        Check(i == 0 || (w == width && h == height), "Image sizes don't match: %s.", inPaths[i]);
+
+        inputs[i].OffsetTable = reinterpret_cast<const uint64_t*>(inputs[i].File.Data + offsetTable);
+        width = w;
+        height = h;
+    }
+
+    BeginFile(outPath, width, height);
+
+    SmallVector<float4> rows;
+    rows.resize(width * MERGE_ROWS_PER_CHUNK);
+    const float weight = 1.0f / inputs.size();
+    const size_t blockSize = BlockSize(width);
+
+    for (uint32_t y0 = 0; y0 < height; y0 += MERGE_ROWS_PER_CHUNK)
+    {
+        const uint32_t numRows = Min(MERGE_ROWS_PER_CHUNK, height - y0);
+        memset(rows.data(), 0, rows.size() * sizeof(float4));
+
+        for (const MergeInput& input : inputs)
+        {
+            for (uint32_t y = 0; y < numRows; y++)
+            {
+                const uint64_t blockOffset = input.OffsetTable[y0 + y];
+                Check(blockOffset + blockSize <= input.File.Size, "Invalid scanline offset.");
+
+                const uint16_t* b = reinterpret_cast<const uint16_t*>(input.File.Data + blockOffset + 
+                    2 * sizeof(int32_t));
+                const uint16_t* g = b + width;
+                const uint16_t* r = g + width;
+                float4* row = rows.data() + y * width;
+
+                AccumulatePlanarHalf(Span(r, width), Span(g, width), Span(b, width), weight,
+                    MutableSpan(row, width));
+            }
+        }
+
+        AppendScanlines(outPath, width, y0, numRows, reinterpret_cast<uint8_t*>(rows.data()), 
+            width * sizeof(float4));
+    }
+
+    for (MergeInput& input : inputs)
+        App::Filesystem::UnmapFile(input.File);
+}
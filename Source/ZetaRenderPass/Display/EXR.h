@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Utility/Span.h>
+
+// Writes the RGB channels of R32G32B32A32_FLOAT images as scanline OpenEXR files with 
+// half-float channels and no compression. Without compression, every scanline block has 
+// the same size, so the offset table is known upfront and large images can be streamed 
+// to disk a few rows at a time.
+// Ref: https://openexr.com/en/latest/OpenEXRFileLayout.html
+namespace ZetaRay::RenderPass::EXR
+{
+    void Write(const char* path, uint32_t width, uint32_t height, const uint8_t* data, 
+        uint32_t rowPitch);
+
+    // Creates the file with the header and the scanline offset table. Scanlines are then 
+    // expected to be appended in order, top to bottom.
+    void BeginFile(const char* path, uint32_t width, uint32_t height);
+    void AppendScanlines(const char* path, uint32_t width, uint32_t firstRow, uint32_t numRows, 
+        const uint8_t* data, uint32_t rowPitch);
+
+    // Averages images of the same size that were written by this module and streams the
+    // result to outPath
+    void Merge(const char* outPath, Util::Span<const char*> inPaths);
+}
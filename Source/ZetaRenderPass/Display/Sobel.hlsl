@@ -2,6 +2,7 @@
 #include "../Common/Math.hlsli"
 #include "../Common/FrameConstants.h"
 #include "../Common/GBuffers.hlsli"
+#include "Sobel.hlsli"
 
 //--------------------------------------------------------------------------------------
 // Root Signature
@@ -24,55 +25,6 @@ struct VSOut
 // Vertex Shader
 //--------------------------------------------------------------------------------------
 
-float Sobel(int2 DTid, Texture2D<float> g_mask)
-{
-    float3 gradientX = -1.0f * g_mask[int2(DTid.x - 1, DTid.y - 1)] -
-        2.0f * g_mask[int2(DTid.x - 1, DTid.y)] -
-        1.0f * g_mask[int2(DTid.x - 1, DTid.y + 1)] +
-        1.0f * g_mask[int2(DTid.x + 1, DTid.y - 1)] +
-        2.0f * g_mask[int2(DTid.x + 1, DTid.y)] +
-        1.0f * g_mask[int2(DTid.x + 1, DTid.y + 1)];
-
-    float3 gradientY = 1.0f * g_mask[int2(DTid.x - 1, DTid.y - 1)] +
-        2.0f * g_mask[int2(DTid.x, DTid.y - 1)] +
-        1.0f * g_mask[int2(DTid.x + 1, DTid.y - 1)] -
-        1.0f * g_mask[int2(DTid.x - 1, DTid.y + 1)] -
-        2.0f * g_mask[int2(DTid.x, DTid.y + 1)] -
-        1.0f * g_mask[int2(DTid.x + 1, DTid.y + 1)];
-
-    float3 gradientMagnitude = sqrt(gradientX * gradientX + gradientY * gradientY);
-    float lum = Math::Luminance(gradientMagnitude);
-
-    return lum;
-}
-
-bool CheckNeighborHood(int2 DTid, Texture2D<float> g_mask)
-{
-    int2 renderDim = int2(g_frame.RenderWidth, g_frame.RenderHeight);
-
-    [unroll]
-    for(int i = 0; i < 3; i++)
-    {
-        [unroll]
-        for(int j = 0; j < 3; j++)
-        {
-            int2 addr = int2(DTid.x - 1 + i, DTid.y - 1 + j);
-            if(!Math::IsWithinBounds(addr, renderDim))
-                continue;
-
-            float m = g_mask[addr];
-            if(m > 0)
-                return true;
-        }
-    }
-
-    return false;
-}
-
-//--------------------------------------------------------------------------------------
-// Vertex Shader
-//--------------------------------------------------------------------------------------
-
 VSOut mainVS(uint vertexID : SV_VertexID)
 {
     VSOut vsout;
@@ -91,17 +43,10 @@ float4 mainPS(VSOut psin) : SV_Target
 {
     int2 DTid = psin.PosSS.xy;
     Texture2D<float> g_mask = ResourceDescriptorHeap[g_local.MaskDescHeapIdx];
-    uint maskCenter = g_local.Wireframe ? g_mask[DTid] : 0;
-    uint mask = g_local.Wireframe ? maskCenter : CheckNeighborHood(DTid, g_mask);
-
-    // Return if mask is zero - pixel is not part of the object
-    clip(mask == 1 ? 1 : -1);
-
-    float lum = g_local.Wireframe ? 1 : Sobel(DTid, g_mask);
+    const int2 renderDim = int2(g_frame.RenderWidth, g_frame.RenderHeight);
 
     // Return if pixel is not on the outline
-    // clip(lum - 1e-7);
-    clip(lum > 0 ? 1 : -1);
+    clip(Sobel::IsOnOutline(DTid, g_mask, renderDim, g_local.Wireframe) ? 1 : -1);
 
-    return float4(0.913098693, 0.332451582, 0.048171822, 1);
+    return float4(Sobel::OUTLINE_COLOR, 1);
 }
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef SOBEL_H
+#define SOBEL_H
+
+#include "../Common/Math.hlsli"
+
+namespace Sobel
+{
+    static const float3 OUTLINE_COLOR = float3(0.913098693, 0.332451582, 0.048171822);
+
+    float Gradient(int2 DTid, Texture2D<float> g_mask)
+    {
+        float3 gradientX = -1.0f * g_mask[int2(DTid.x - 1, DTid.y - 1)] -
+            2.0f * g_mask[int2(DTid.x - 1, DTid.y)] -
+            1.0f * g_mask[int2(DTid.x - 1, DTid.y + 1)] +
+            1.0f * g_mask[int2(DTid.x + 1, DTid.y - 1)] +
+            2.0f * g_mask[int2(DTid.x + 1, DTid.y)] +
+            1.0f * g_mask[int2(DTid.x + 1, DTid.y + 1)];
+
+        float3 gradientY = 1.0f * g_mask[int2(DTid.x - 1, DTid.y - 1)] +
+            2.0f * g_mask[int2(DTid.x, DTid.y - 1)] +
+            1.0f * g_mask[int2(DTid.x + 1, DTid.y - 1)] -
+            1.0f * g_mask[int2(DTid.x - 1, DTid.y + 1)] -
+            2.0f * g_mask[int2(DTid.x, DTid.y + 1)] -
+            1.0f * g_mask[int2(DTid.x + 1, DTid.y + 1)];
+
+        float3 gradientMagnitude = sqrt(gradientX * gradientX + gradientY * gradientY);
+        float lum = Math::Luminance(gradientMagnitude);
+
+        return lum;
+    }
+
+    bool CheckNeighborHood(int2 DTid, Texture2D<float> g_mask, int2 renderDim)
+    {
+        [unroll]
+        for(int i = 0; i < 3; i++)
+        {
+            [unroll]
+            for(int j = 0; j < 3; j++)
+            {
+                int2 addr = int2(DTid.x - 1 + i, DTid.y - 1 + j);
+                if(!Math::IsWithinBounds(addr, renderDim))
+                    continue;
+
+                float m = g_mask[addr];
+                if(m > 0)
+                    return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Returns whether given pixel is on the outline of the picked object's mask. In 
+    // wireframe mode, the mask is drawn as is.
+    bool IsOnOutline(int2 DTid, Texture2D<float> g_mask, int2 renderDim, bool wireframe)
+    {
+        uint maskCenter = wireframe ? g_mask[DTid] : 0;
+        uint mask = wireframe ? maskCenter : CheckNeighborHood(DTid, g_mask, renderDim);
+
+        // Pixel is not part of the object
+        if(mask != 1)
+            return false;
+
+        float lum = wireframe ? 1 : Gradient(DTid, g_mask);
+
+        return lum > 0;
+    }
+}
+
+#endif
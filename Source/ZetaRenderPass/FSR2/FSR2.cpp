@@ -354,10 +354,11 @@ namespace
         D3D12_RESOURCE_BARRIER barriers[g_fsr2Data->MAX_BARRIERS];
         int currBarrierIdx = 0;
 
-        g_fsr2Data->m_passes[pass].SrvTableGpu = renderer.GetGpuDescriptorHeap().Allocate(
+        // Tables are rewritten for every job, so they're only needed for this frame
+        g_fsr2Data->m_passes[pass].SrvTableGpu = renderer.GetGpuDescriptorHeap().AllocateTransient(
             g_fsr2Data->m_passes[pass].SrvTableGpuNumDescs);
 
-        g_fsr2Data->m_passes[pass].UavTableGpu = renderer.GetGpuDescriptorHeap().Allocate(
+        g_fsr2Data->m_passes[pass].UavTableGpu = renderer.GetGpuDescriptorHeap().AllocateTransient(
             g_fsr2Data->m_passes[pass].UavTableGpuNumDescs);
 
         // UAVs
@@ -867,6 +868,9 @@ namespace
             auto* device = App::GetRenderer().GetDevice();
             CheckHR(device->CreateRootSignature(0, outBlob->GetBufferPointer(), outBlob->GetBufferSize(),
                 IID_PPV_ARGS(g_fsr2Data->m_passes[pass].RootSig.GetAddressOf())));
+
+            PipelineStateLibrary::TagRootSignature(g_fsr2Data->m_passes[pass].RootSig.Get(),
+                outBlob->GetBufferPointer(), outBlob->GetBufferSize());
         }
 
         // output
@@ -1049,8 +1053,11 @@ void FSR2Pass::Activate()
 
     FfxFsr2ContextDescription ctxDesc;
     ctxDesc.flags = g_fsr2Data->FLAGS;
-    ctxDesc.maxRenderSize.width = renderer.GetRenderWidth();
-    ctxDesc.maxRenderSize.height = renderer.GetRenderHeight();
+    // Render resolution never exceeds the display resolution. Sizing the internal resources
+    // for it means that the context is only recreated when the display size changes, not 
+    // every time render resolution does (e.g. with dynamic resolution).
+    ctxDesc.maxRenderSize.width = renderer.GetDisplayWidth();
+    ctxDesc.maxRenderSize.height = renderer.GetDisplayHeight();
     ctxDesc.displaySize.width = renderer.GetDisplayWidth();
     ctxDesc.displaySize.height = renderer.GetDisplayHeight();
     ctxDesc.callbacks = fsr2Interface;
@@ -1232,7 +1239,7 @@ void FSR2Pass::Render(CommandList& cmdList)
     params.reset = g_fsr2Data->m_reset;
     params.enableSharpening = false;
     params.sharpness = 0.0f;
-    params.frameTimeDelta = (float)(App::GetTimer().GetElapsedTime() * 1000);
+    params.frameTimeDelta = (float)(App::GetTimer().GetSimulationDelta() * 1000);
     params.preExposure = 1.0f;
     params.renderSize.width = App::GetRenderer().GetRenderWidth();
     params.renderSize.height = App::GetRenderer().GetRenderHeight();
@@ -0,0 +1,150 @@
+#include "FrameInterpolation.h"
+#include <Core/CommandList.h>
+#include <Scene/SceneRenderer.h>
+
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Core::GpuMemory;
+using namespace ZetaRay::RenderPass;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Scene;
+
+//--------------------------------------------------------------------------------------
+// FrameInterpolation
+//--------------------------------------------------------------------------------------
+
+FrameInterpolation::FrameInterpolation()
+    : RenderPassBase(NUM_CBV, NUM_SRV, NUM_UAV, NUM_GLOBS, NUM_CONSTS)
+{
+    // frame constants
+    m_rootSig.InitAsCBV(0, 0, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        GlobalResource::FRAME_CONSTANTS_BUFFER);
+
+    // root constants
+    m_rootSig.InitAsConstants(1, NUM_CONSTS, 1);
+}
+
+FrameInterpolation::~FrameInterpolation()
+{
+    Reset();
+}
+
+void FrameInterpolation::Init()
+{
+    constexpr D3D12_ROOT_SIGNATURE_FLAGS flags =
+        D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_MESH_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+    auto samplers = App::GetRenderer().GetStaticSamplers();
+    RenderPassBase::InitRenderPass("FrameInterpolation", flags, samplers);
+
+    m_psoLib.EnqueueComputePSO(0, m_rootSigObj.Get(), COMPILED_CS[0]);
+
+    m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
+    CreateResources();
+
+    m_isHistoryValid = false;
+}
+
+void FrameInterpolation::Reset()
+{
+    if (IsInitialized())
+    {
+        m_interpolated.Reset();
+        m_history[0].Reset();
+        m_history[1].Reset();
+        m_descTable.Reset();
+
+        RenderPassBase::Reset(true);
+    }
+}
+
+void FrameInterpolation::OnWindowResized()
+{
+    // Outputs are display-sized, so changes in render resolution don't affect them
+    auto& renderer = App::GetRenderer();
+    const D3D12_RESOURCE_DESC desc = m_interpolated.Desc();
+    if (desc.Width == renderer.GetDisplayWidth() && desc.Height == renderer.GetDisplayHeight())
+        return;
+
+    m_descTable = renderer.GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
+    CreateResources();
+    m_isHistoryValid = false;
+}
+
+void FrameInterpolation::Render(CommandList& cmdList)
+{
+    Assert(cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_DIRECT ||
+        cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_COMPUTE, "Invalid downcast");
+    ComputeCmdList& computeCmdList = static_cast<ComputeCmdList&>(cmdList);
+
+    auto& renderer = App::GetRenderer();
+    auto& gpuTimer = renderer.GetGpuTimer();
+    const int outIdx = renderer.GlobalIdxForDoubleBufferedResources();
+    const uint32_t w = renderer.GetDisplayWidth();
+    const uint32_t h = renderer.GetDisplayHeight();
+
+    Assert(m_inputDesc[(int)SHADER_IN_DESC::SIGNAL] > 0, "Input SRV hasn't been set.");
+    m_localCB.InputDescHeapIdx = m_inputDesc[(int)SHADER_IN_DESC::SIGNAL];
+    m_localCB.PrevHistoryDescHeapIdx = m_descTable.GPUDescriptorHeapIndex() + (outIdx == 0 ?
+        (int)DESC_TABLE::HISTORY_A_SRV : (int)DESC_TABLE::HISTORY_B_SRV);
+    m_localCB.CurrHistoryDescHeapIdx = m_descTable.GPUDescriptorHeapIndex() + (outIdx == 0 ?
+        (int)DESC_TABLE::HISTORY_B_UAV : (int)DESC_TABLE::HISTORY_A_UAV);
+    m_localCB.OutputDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::INTERPOLATED_UAV);
+    m_localCB.HistoryIsValid = m_isHistoryValid;
+
+    computeCmdList.PIXBeginEvent("FrameInterpolation");
+    const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "FrameInterpolation");
+
+    computeCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
+
+    m_rootSig.SetRootConstants(0, NUM_CONSTS, &m_localCB);
+    m_rootSig.End(computeCmdList);
+
+    computeCmdList.SetPipelineState(m_psoLib.GetPSO(0));
+    computeCmdList.Dispatch(CeilUnsignedIntDiv(w, FRAME_INTERPOLATION_GROUP_DIM_X),
+        CeilUnsignedIntDiv(h, FRAME_INTERPOLATION_GROUP_DIM_Y), 1);
+
+    gpuTimer.EndQuery(computeCmdList, queryIdx);
+    computeCmdList.PIXEndEvent();
+
+    m_isHistoryValid = true;
+}
+
+void FrameInterpolation::CreateResources()
+{
+    auto& renderer = App::GetRenderer();
+
+    m_interpolated = GpuMemory::GetTexture2D("FrameInterpolation_Out",
+        renderer.GetDisplayWidth(), renderer.GetDisplayHeight(),
+        DXGI_FORMAT_R16G16B16A16_FLOAT,
+        D3D12_RESOURCE_STATE_COMMON,
+        TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+    m_history[0] = GpuMemory::GetTexture2D("FrameInterpolation_History_A",
+        renderer.GetDisplayWidth(), renderer.GetDisplayHeight(),
+        DXGI_FORMAT_R16G16B16A16_FLOAT,
+        D3D12_RESOURCE_STATE_COMMON,
+        TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+    m_history[1] = GpuMemory::GetTexture2D("FrameInterpolation_History_B",
+        renderer.GetDisplayWidth(), renderer.GetDisplayHeight(),
+        DXGI_FORMAT_R16G16B16A16_FLOAT,
+        D3D12_RESOURCE_STATE_COMMON,
+        TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+    // SRVs
+    Direct3DUtil::CreateTexture2DSRV(m_history[0], m_descTable.CPUHandle((int)DESC_TABLE::HISTORY_A_SRV));
+    Direct3DUtil::CreateTexture2DSRV(m_history[1], m_descTable.CPUHandle((int)DESC_TABLE::HISTORY_B_SRV));
+
+    // UAVs
+    Direct3DUtil::CreateTexture2DUAV(m_history[0], m_descTable.CPUHandle((int)DESC_TABLE::HISTORY_A_UAV));
+    Direct3DUtil::CreateTexture2DUAV(m_history[1], m_descTable.CPUHandle((int)DESC_TABLE::HISTORY_B_UAV));
+    Direct3DUtil::CreateTexture2DUAV(m_interpolated, m_descTable.CPUHandle((int)DESC_TABLE::INTERPOLATED_UAV));
+}
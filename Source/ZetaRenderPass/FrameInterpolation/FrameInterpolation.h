@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../RenderPass.h"
+#include <Core/GpuMemory.h>
+#include "FrameInterpolation_Common.h"
+
+namespace ZetaRay::Core
+{
+    class CommandList;
+}
+
+namespace ZetaRay::RenderPass
+{
+    // Generates a frame halfway between the previous and current frames, which is then 
+    // presented before the current one (see RendererCore::SetFrameInterpolation()). Runs on 
+    // display-resolution HDR input, prior to tonemapping.
+    struct FrameInterpolation final : public RenderPassBase<1>
+    {
+        enum class SHADER_IN_DESC
+        {
+            SIGNAL,
+            COUNT
+        };
+
+        enum class SHADER_OUT_RES
+        {
+            INTERPOLATED,
+            HISTORY_A,
+            HISTORY_B,
+            COUNT
+        };
+
+        FrameInterpolation();
+        ~FrameInterpolation();
+
+        void Init();
+        void Reset();
+        void OnWindowResized();
+        void SetDescriptor(SHADER_IN_DESC i, uint32_t heapIdx)
+        {
+            Assert((int)i < (int)SHADER_IN_DESC::COUNT, "out-of-bound access.");
+            m_inputDesc[(int)i] = heapIdx;
+        }
+        Core::GpuMemory::Texture& GetOutput(SHADER_OUT_RES i)
+        {
+            Assert((int)i < (int)SHADER_OUT_RES::COUNT, "out-of-bound access.");
+            return i == SHADER_OUT_RES::INTERPOLATED ? m_interpolated : 
+                m_history[(int)i - (int)SHADER_OUT_RES::HISTORY_A];
+        }
+        void Render(Core::CommandList& cmdList);
+
+    private:
+        static constexpr int NUM_CBV = 1;
+        static constexpr int NUM_SRV = 0;
+        static constexpr int NUM_UAV = 0;
+        static constexpr int NUM_GLOBS = 1;
+        static constexpr int NUM_CONSTS = sizeof(cbFrameInterpolation) / sizeof(DWORD);
+
+        enum class DESC_TABLE
+        {
+            HISTORY_A_SRV,
+            HISTORY_A_UAV,
+            HISTORY_B_SRV,
+            HISTORY_B_UAV,
+            INTERPOLATED_UAV,
+            COUNT
+        };
+
+        inline static constexpr const char* COMPILED_CS[] = { "FrameInterpolation_cs.cso" };
+
+        void CreateResources();
+
+        Core::GpuMemory::Texture m_interpolated;
+        // Copy of the input, ping-ponged between frames
+        Core::GpuMemory::Texture m_history[2];
+        uint32_t m_inputDesc[(int)SHADER_IN_DESC::COUNT] = { 0 };
+        cbFrameInterpolation m_localCB;
+        Core::DescriptorTable m_descTable;
+        bool m_isHistoryValid = false;
+    };
+}
\ No newline at end of file
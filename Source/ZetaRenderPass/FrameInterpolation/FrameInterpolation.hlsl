@@ -0,0 +1,74 @@
+// Interpolates a frame halfway between the previous and current frames. Both frames are 
+// fetched along the current frame's motion vectors, then blended unless they disagree too 
+// much (e.g. disocclusions), in which case current frame is used.
+
+#include "FrameInterpolation_Common.h"
+#include "../Common/Math.hlsli"
+#include "../Common/GBuffers.hlsli"
+#include "../Common/StaticTextureSamplers.hlsli"
+#include "../Common/FrameConstants.h"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b0);
+ConstantBuffer<cbFrameInterpolation> g_local : register(b1);
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(FRAME_INTERPOLATION_GROUP_DIM_X, FRAME_INTERPOLATION_GROUP_DIM_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_frame.DisplayWidth || DTid.y >= g_frame.DisplayHeight)
+        return;
+
+    const float2 uv = (DTid.xy + 0.5f) / float2(g_frame.DisplayWidth, g_frame.DisplayHeight);
+
+    Texture2D<float4> g_input = ResourceDescriptorHeap[g_local.InputDescHeapIdx];
+    RWTexture2D<float4> g_currHistory = ResourceDescriptorHeap[g_local.CurrHistoryDescHeapIdx];
+    RWTexture2D<float4> g_out = ResourceDescriptorHeap[g_local.OutputDescHeapIdx];
+
+    // Input could be at render resolution when there's no upscaling
+    const float3 color = g_input.SampleLevel(g_samPointClamp, uv, 0).rgb;
+
+    // Keep a copy of current frame for next frame's interpolation
+    g_currHistory[DTid.xy] = float4(color, 1);
+
+    if (!g_local.HistoryIsValid)
+    {
+        g_out[DTid.xy] = float4(color, 1);
+        return;
+    }
+
+    // Motion vectors are defined at current frame's positions. As the surface that's visible 
+    // at uv halfway between the two frames is at uv + 0.5 * mv in current frame, refine 
+    // once using motion vector at that position.
+    GBUFFER_MOTION_VECTOR g_motionVector = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
+        GBUFFER_OFFSET::MOTION_VECTOR];
+    float2 mv = g_motionVector.SampleLevel(g_samPointClamp, uv, 0);
+    mv = g_motionVector.SampleLevel(g_samPointClamp, uv + 0.5f * mv, 0);
+
+    const float2 currUV = uv + 0.5f * mv;
+    const float2 prevUV = uv - 0.5f * mv;
+
+    const float3 curr = g_input.SampleLevel(g_samLinearClamp, currUV, 0).rgb;
+    float3 ret = curr;
+
+    if (all(prevUV >= 0) && all(prevUV <= 1))
+    {
+        Texture2D<float4> g_prevHistory = ResourceDescriptorHeap[g_local.PrevHistoryDescHeapIdx];
+        const float3 prev = g_prevHistory.SampleLevel(g_samLinearClamp, prevUV, 0).rgb;
+
+        const float lumCurr = Math::Luminance(curr);
+        const float lumPrev = Math::Luminance(prev);
+        const float relDiff = abs(lumCurr - lumPrev) / max(lumCurr + lumPrev, 1e-4f);
+        const float w = 0.5f * saturate(1.0f - 2.0f * relDiff);
+
+        ret = lerp(curr, prev, w);
+    }
+
+    g_out[DTid.xy] = float4(ret, 1);
+}
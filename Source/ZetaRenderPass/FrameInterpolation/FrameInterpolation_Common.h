@@ -0,0 +1,16 @@
+#ifndef FRAME_INTERPOLATION_H
+#define FRAME_INTERPOLATION_H
+
+#define FRAME_INTERPOLATION_GROUP_DIM_X 8u
+#define FRAME_INTERPOLATION_GROUP_DIM_Y 8u
+
+struct cbFrameInterpolation
+{
+    uint32_t InputDescHeapIdx;
+    uint32_t PrevHistoryDescHeapIdx;
+    uint32_t CurrHistoryDescHeapIdx;
+    uint32_t OutputDescHeapIdx;
+    uint32_t HistoryIsValid;
+};
+
+#endif
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <Support/Param.h>
 #include <App/Filesystem.h>
 #include <Scene/SceneCore.h>
+#include <Scene/TextureFeedback.h>
 
 using namespace ZetaRay::Core;
 using namespace ZetaRay::Core::Direct3DUtil;
@@ -57,6 +58,10 @@ GBufferRT::GBufferRT()
     // pick buffer
     m_rootSig.InitAsBufferUAV(7, 0, 0,
         D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, nullptr, true);
+
+    // texture streaming feedback
+    m_rootSig.InitAsBufferUAV(8, 1, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, nullptr, true);
 }
 
 void GBufferRT::InitPSOs()
@@ -74,8 +79,11 @@ void GBufferRT::InitPSOs()
     auto samplers = App::GetRenderer().GetStaticSamplers();
     RenderPassBase::InitRenderPass("GBuffer", flags, samplers);
 
-    for (int i = 0; i < (int)GBUFFER_SHADER::COUNT; i++)
-        m_psoLib.CompileComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
+    m_psoLib.EnqueueComputePSO((int)GBUFFER_SHADER::GBUFFER, m_rootSigObj.Get(), 
+        COMPILED_CS[(int)GBUFFER_SHADER::GBUFFER]);
+    // Only needed with raster primary visibility
+    m_psoLib.DeferComputePSO((int)GBUFFER_SHADER::GBUFFER_RASTER, m_rootSigObj.Get(), 
+        COMPILED_CS[(int)GBUFFER_SHADER::GBUFFER_RASTER]);
 }
 
 void GBufferRT::Init()
@@ -84,6 +92,7 @@ void GBufferRT::Init()
 
     memset(&m_cbLocal, 0, sizeof(m_cbLocal));
     m_cbLocal.PickedPixelX = UINT16_MAX;
+    m_cbLocal.TriIDsDescHeapIdx = UINT32_MAX;
 
     //ParamVariant p1;
     //p1.InitEnum("Renderer", "G-Buffer", "Mipmap Selection", fastdelegate::MakeDelegate(this, &GBufferRT::MipmapSelectionCallback),
@@ -91,7 +100,9 @@ void GBufferRT::Init()
     //App::AddParam(p1);
 
     m_pickedInstance = GpuMemory::GetDefaultHeapBuffer("PickIdx", sizeof(uint32), false, true);
-    m_readbackBuffer = GpuMemory::GetReadbackHeapBuffer(sizeof(uint32));
+    // Entries are tagged with the frame number, so the buffer only needs to be cleared once
+    m_texFeedback = GpuMemory::GetDefaultHeapBuffer("TextureFeedback", 
+        TEX_FEEDBACK_NUM_ENTRIES * sizeof(uint32_t), false, true, true);
 
     App::AddShaderReloadHandler("GBuffer", fastdelegate::MakeDelegate(this, &GBufferRT::ReloadShader));
 }
@@ -133,10 +144,22 @@ void GBufferRT::Render(CommandList& cmdList)
         m_rootSig.SetRootUAV(7, m_pickedInstance.GpuVA());
     }
 
+    // Previous frame's feedback was copied to the readback buffer
+    auto feedbackBarrier = BufferBarrier(m_texFeedback.Resource(),
+        D3D12_BARRIER_SYNC_COPY,
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_ACCESS_COPY_SOURCE,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS);
+    computeCmdList.ResourceBarrier(feedbackBarrier);
+
+    m_rootSig.SetRootUAV(8, m_texFeedback.GpuVA());
+
     m_rootSig.SetRootConstants(0, sizeof(m_cbLocal) / sizeof(DWORD), &m_cbLocal);
     m_rootSig.End(computeCmdList);
 
-    computeCmdList.SetPipelineState(m_psoLib.GetPSO(0));
+    const auto shader = m_cbLocal.TriIDsDescHeapIdx != UINT32_MAX ? GBUFFER_SHADER::GBUFFER_RASTER :
+        GBUFFER_SHADER::GBUFFER;
+    computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)shader));
     computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 
     if (hasPick)
@@ -148,11 +171,24 @@ void GBufferRT::Render(CommandList& cmdList)
             D3D12_BARRIER_ACCESS_COPY_SOURCE);
         computeCmdList.ResourceBarrier(syncWrite);
 
-        computeCmdList.CopyBufferRegion(m_readbackBuffer.Resource(),
-            0,
-            m_pickedInstance.Resource(),
-            0,
-            sizeof(uint32));
+        Assert(!m_pickDlg.empty(), "Pick callback hasn't been set.");
+        GpuMemory::EnqueueReadback(computeCmdList, m_pickedInstance.Resource(), 0, 
+            sizeof(uint32), m_pickDlg);
+
+        ClearPick();
+    }
+
+    auto feedbackWrite = BufferBarrier(m_texFeedback.Resource(),
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_SYNC_COPY,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+        D3D12_BARRIER_ACCESS_COPY_SOURCE);
+    computeCmdList.ResourceBarrier(feedbackWrite);
+
+    if (!m_texFeedbackDlg.empty())
+    {
+        GpuMemory::EnqueueReadback(computeCmdList, m_texFeedback.Resource(), 0,
+            TEX_FEEDBACK_NUM_ENTRIES * sizeof(uint32_t), m_texFeedbackDlg);
     }
 
     gpuTimer.EndQuery(computeCmdList, queryIdx);
@@ -161,6 +197,14 @@ void GBufferRT::Render(CommandList& cmdList)
 
 void GBufferRT::ReloadShader()
 {
-    m_psoLib.Reload((int)GBUFFER_SHADER::GBUFFER, m_rootSigObj.Get(), 
-        "GBuffer\\GBufferRT_Inline.hlsl");
+    if (m_cbLocal.TriIDsDescHeapIdx != UINT32_MAX)
+    {
+        m_psoLib.Reload((int)GBUFFER_SHADER::GBUFFER_RASTER, m_rootSigObj.Get(), 
+            "GBuffer\\GBufferRT_Raster.hlsl");
+    }
+    else
+    {
+        m_psoLib.Reload((int)GBUFFER_SHADER::GBUFFER, m_rootSigObj.Get(), 
+            "GBuffer\\GBufferRT_Inline.hlsl");
+    }
 }
@@ -19,6 +19,8 @@ namespace ZetaRay::RenderPass
     enum class GBUFFER_SHADER
     {
         GBUFFER,
+        // Primary hits come from GBufferRaster
+        GBUFFER_RASTER,
         COUNT
     };
 
@@ -38,29 +40,38 @@ namespace ZetaRay::RenderPass
             m_cbLocal.PickedPixelX = pixelX;
             m_cbLocal.PickedPixelY = pixelY;
         }
+        // Builds the g-buffers from the given triangle IDs (see GBufferRaster) instead of 
+        // tracing primary rays. Pass UINT32_MAX to go back to tracing.
+        ZetaInline void SetRasterTriangleIDs(uint32_t descHeapIdx) { m_cbLocal.TriIDsDescHeapIdx = descHeapIdx; }
         ZetaInline bool HasPendingPick() const { return m_cbLocal.PickedPixelX != UINT16_MAX; }
         ZetaInline void ClearPick()
         {
             m_cbLocal.PickedPixelX = UINT16_MAX;
         }
-        Core::GpuMemory::ReadbackHeapBuffer& GetPickReadbackBuffer() { return m_readbackBuffer; }
+        // Receives the picked RT mesh index (UINT32_MAX if nothing was hit)
+        ZetaInline void SetPickCallback(Core::GpuMemory::ReadbackCallback dlg) { m_pickDlg = dlg; }
+        // Receives the texture streaming feedback every frame
+        ZetaInline void SetTextureFeedbackCallback(Core::GpuMemory::ReadbackCallback dlg) { m_texFeedbackDlg = dlg; }
         void Render(Core::CommandList& cmdList);
 
     private:
         static constexpr int NUM_CBV = 1;
         static constexpr int NUM_SRV = 5;
-        static constexpr int NUM_UAV = 1;
+        static constexpr int NUM_UAV = 2;
         static constexpr int NUM_GLOBS = 6;
         static constexpr int NUM_CONSTS = (int)(sizeof(cbGBufferRt) / sizeof(DWORD));
 
         inline static constexpr const char* COMPILED_CS[(int)GBUFFER_SHADER::COUNT] = {
-            "GBufferRT_Inline_cs.cso"
+            "GBufferRT_Inline_cs.cso",
+            "GBufferRT_Raster_cs.cso"
         };
 
         void ReloadShader();
 
         Core::GpuMemory::Buffer m_pickedInstance;
-        Core::GpuMemory::ReadbackHeapBuffer m_readbackBuffer;
+        Core::GpuMemory::ReadbackCallback m_pickDlg;
+        Core::GpuMemory::Buffer m_texFeedback;
+        Core::GpuMemory::ReadbackCallback m_texFeedbackDlg;
         //ComPtr<ID3D12StateObject> m_rtPSO;
         //ShaderTable m_shaderTable;
         cbGBufferRt m_cbLocal;
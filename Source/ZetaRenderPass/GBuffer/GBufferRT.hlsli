@@ -3,6 +3,7 @@
 #include "../Common/StaticTextureSamplers.hlsli"
 #include "../Common/GBuffers.hlsli"
 #include "../Common/RT.hlsli"
+#include "../../ZetaCore/Scene/TextureFeedback.h"
 
 namespace GBufferRT
 {
@@ -102,13 +103,40 @@ namespace GBufferRT
     void WriteToGBuffers(uint2 DTid, float t, float3 normal, float3 baseColor, float flags, 
         float roughness,float3 emissive, float2 motionVec, bool transmissive, float ior, 
         float subsurface, float coat_weight, float3 coat_color, float coat_roughness,
-        float coat_ior, float3 dpdu, float3 dpdv, float3 dndu, float3 dndv, 
+        float coat_ior, float3 dpdu, float3 dpdv, float3 dndu, float3 dndv, uint meshIdx,
+        uint primIdx, bool flipped, ConstantBuffer<cbFrameConstants> g_frame, 
         ConstantBuffer<cbGBufferRt> g_local)
     {
         RWTexture2D<float> g_outDepth = 
             ResourceDescriptorHeap[g_local.UavTableDescHeapIdx + (int)UAV_DESC_TABLE::DEPTH];
         g_outDepth[DTid] = t;
 
+#if PACKED_GBUFFER == 1
+        RWTexture2D<uint2> g_outBaseColorNormal = ResourceDescriptorHeap[g_local.UavTableDescHeapIdx + 
+            (int)UAV_DESC_TABLE::BASE_COLOR];
+        const uint baseColor_rgba8 = Math::Float3ToRGB8(baseColor) | 
+            (Math::FloatToUNorm8(subsurface) << 24);
+        g_outBaseColorNormal[DTid] = uint2(baseColor_rgba8, Math::EncodeOct32u(normal));
+
+        // Unused fields are set to zero, so the whole texel is written every frame
+        uint2 material = uint2((uint)mad(flags, 255.0f, 0.5f) | 
+            (Math::FloatToUNorm8(roughness) << 8), 0);
+
+        if(transmissive)
+            material.x |= Math::FloatToUNorm8(GBuffer::EncodeIOR(ior)) << 16;
+
+        if(coat_weight > 0)
+        {
+            material.x |= Math::FloatToUNorm8(coat_weight) << 24;
+            material.y = GBuffer::ColorToRGB565(coat_color) | 
+                (Math::FloatToUNorm8(coat_roughness) << 16) |
+                (Math::FloatToUNorm8(GBuffer::EncodeIOR(coat_ior)) << 24);
+        }
+
+        RWTexture2D<uint2> g_outMaterial = ResourceDescriptorHeap[g_local.UavTableDescHeapIdx + 
+            (int)UAV_DESC_TABLE::METALLIC_ROUGHNESS];
+        g_outMaterial[DTid] = material;
+#else
         RWTexture2D<float2> g_outNormal = 
             ResourceDescriptorHeap[g_local.UavTableDescHeapIdx + (int)UAV_DESC_TABLE::NORMAL];
         g_outNormal[DTid] = Math::EncodeUnitVector(normal);
@@ -154,15 +182,24 @@ namespace GBufferRT
 
             g_outCoat[DTid].xyz = packed;
         }
+#endif
 
         RWTexture2D<float2> g_outMotion = 
             ResourceDescriptorHeap[g_local.UavTableDescHeapIdx + (int)UAV_DESC_TABLE::MOTION_VECTOR];
         g_outMotion[DTid] = motionVec;
 
-        RWTexture2D<uint4> g_outTriGeo_A = 
-            ResourceDescriptorHeap[g_local.UavTableDescHeapIdx + (int)UAV_DESC_TABLE::TRI_DIFF_GEO_A];
         RWTexture2D<uint2> g_outTriGeo_B = 
             ResourceDescriptorHeap[g_local.UavTableDescHeapIdx + (int)UAV_DESC_TABLE::TRI_DIFF_GEO_B];
+
+        // Consumers recompute triangle differentials from the triangle ID
+        if(g_frame.VisibilityBuffer)
+        {
+            g_outTriGeo_B[DTid] = GBuffer::EncodeVisibility(meshIdx, primIdx, flipped);
+            return;
+        }
+
+        RWTexture2D<uint4> g_outTriGeo_A = 
+            ResourceDescriptorHeap[g_local.UavTableDescHeapIdx + (int)UAV_DESC_TABLE::TRI_DIFF_GEO_A];
         uint3 dpdu_h = asuint16(half3(dpdu));
         uint3 dpdv_h = asuint16(half3(dpdv));
         uint3 dndu_h = asuint16(half3(dndu));
@@ -177,8 +214,9 @@ namespace GBufferRT
 
     void ApplyTextureMaps(uint2 DTid, float z_view, float3 wo, float2 uv, uint matIdx, 
         float3 geoNormal, float3 tangent, float2 motionVec, float4 grads, float3 dpdu, 
-        float3 dpdv, float3 dndu, float3 dndv, ConstantBuffer<cbFrameConstants> g_frame, 
-        ConstantBuffer<cbGBufferRt> g_local, StructuredBuffer<Material> g_materials)
+        float3 dpdv, float3 dndu, float3 dndv, uint meshIdx, uint primIdx, 
+        ConstantBuffer<cbFrameConstants> g_frame, ConstantBuffer<cbGBufferRt> g_local, 
+        StructuredBuffer<Material> g_materials)
     {
         const Material mat = g_materials[NonUniformResourceIndex(matIdx)];
         // Apply negative mip bias when upscaling
@@ -216,7 +254,8 @@ namespace GBufferRT
         }
 
         // reverse normal for double-sided meshes if facing away from camera
-        if (mat.DoubleSided() && dot(wo, geoNormal) < 0)
+        const bool flipped = mat.DoubleSided() && dot(wo, geoNormal) < 0;
+        if (flipped)
         {
             shadingNormal *= -1;
             dndu *= -1;
@@ -278,6 +317,43 @@ namespace GBufferRT
         WriteToGBuffers(DTid, z_view, shadingNormal, baseColor.rgb, encoded, 
             roughness, emissiveColor, motionVec, transmissive, ior, subsurface, 
             coat_weight, coat_color, coat_roughness, coat_ior,
-            dpdu, dpdv, dndu, dndv, g_local);
+            dpdu, dpdv, dndu, dndv, meshIdx, primIdx, flipped, g_frame, g_local);
+    }
+
+    // Records the resolution that's needed for each of the material's textures given the 
+    // uv footprint at this pixel. Higher values win -- see TextureFeedback.h.
+    void WriteTextureFeedback(uint matIdx, float4 grads, ConstantBuffer<cbFrameConstants> g_frame, StructuredBuffer<Material> g_materials, 
+        RWStructuredBuffer<uint> g_texFeedback)
+    {
+        const Material mat = g_materials[NonUniformResourceIndex(matIdx)];
+        grads *= g_frame.CameraRayUVGradsScale;
+
+        // Same as the anisotropic filtering footprint -- minor axis, but limited to 
+        // max anisotropy of 16
+        float lenX = length(grads.xy);
+        float lenY = length(grads.zw);
+        float g = max(min(lenX, lenY), max(lenX, lenY) / 16.0f);
+        g = max(g, 1e-6f);
+        uint log2Width = (uint)clamp(ceil(-log2(g)), 0.0f, (float)TEX_FEEDBACK_VALUE_MASK);
+        uint value = ((g_frame.FrameNum & TEX_FEEDBACK_FRAME_MASK) << TEX_FEEDBACK_NUM_VALUE_BITS) | log2Width;
+
+        const uint32_t baseColorTex = mat.GetBaseColorTex();
+        const uint32_t normalTex = mat.GetNormalTex();
+        const uint32_t metallicRoughnessTex = mat.GetMetallicRoughnessTex();
+        const uint32_t emissiveTex = mat.GetEmissiveTex();
+
+        // Slots past the initial descriptor table sizes don't have feedback entries 
+        // (INVALID_ID is out of range as well)
+        if (baseColorTex < TEX_FEEDBACK_NORMAL_OFFSET - TEX_FEEDBACK_BASE_COLOR_OFFSET)
+            InterlockedMax(g_texFeedback[TEX_FEEDBACK_BASE_COLOR_OFFSET + baseColorTex], value);
+        if (normalTex < TEX_FEEDBACK_METALLIC_ROUGHNESS_OFFSET - TEX_FEEDBACK_NORMAL_OFFSET)
+            InterlockedMax(g_texFeedback[TEX_FEEDBACK_NORMAL_OFFSET + normalTex], value);
+        if (metallicRoughnessTex < TEX_FEEDBACK_EMISSIVE_OFFSET - TEX_FEEDBACK_METALLIC_ROUGHNESS_OFFSET)
+        {
+            InterlockedMax(g_texFeedback[TEX_FEEDBACK_METALLIC_ROUGHNESS_OFFSET + metallicRoughnessTex], 
+                value);
+        }
+        if (emissiveTex < TEX_FEEDBACK_NUM_ENTRIES - TEX_FEEDBACK_EMISSIVE_OFFSET)
+            InterlockedMax(g_texFeedback[TEX_FEEDBACK_EMISSIVE_OFFSET + emissiveTex], value);
     }
 }
\ No newline at end of file
@@ -9,6 +9,13 @@
 #define GBUFFER_RT_TILE_WIDTH 16
 #define GBUFFER_RT_LOG2_TILE_WIDTH 4
 
+// When enabled, base color and normal are bit-packed into the BASE_COLOR target, while 
+// metallic-roughness, IOR and coat are bit-packed into the METALLIC_ROUGHNESS target 
+// (both R32G32_UINT). NORMAL, IOR and COAT targets aren't allocated. Coat color is 
+// stored as RGB565. Shaders should go through the GBuffer::Load*() functions in 
+// GBuffers.hlsli, which hide the layout.
+#define PACKED_GBUFFER 0
+
 enum class UAV_DESC_TABLE
 {
     BASE_COLOR,
@@ -27,6 +34,8 @@ enum class UAV_DESC_TABLE
 struct cbGBufferRt
 {
     uint32_t UavTableDescHeapIdx;
+    // Output of GBufferRaster, only used by the raster variant
+    uint32_t TriIDsDescHeapIdx;
 
     uint16_t PickedPixelX;
     uint16_t PickedPixelY;
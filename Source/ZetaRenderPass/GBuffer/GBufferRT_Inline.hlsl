@@ -10,10 +10,11 @@ ConstantBuffer<cbFrameConstants> g_frame : register(b0);
 ConstantBuffer<cbGBufferRt> g_local : register(b1);
 RaytracingAccelerationStructure g_bvh : register(t0);
 StructuredBuffer<RT::MeshInstance> g_frameMeshData : register(t1);
-StructuredBuffer<Vertex> g_sceneVertices : register(t2);
+StructuredBuffer<PackedVertex> g_sceneVertices : register(t2);
 StructuredBuffer<uint> g_sceneIndices : register(t3);
 StructuredBuffer<Material> g_materials : register(t4);
 RWStructuredBuffer<uint> g_pick : register(u0);
+RWStructuredBuffer<uint> g_texFeedback : register(u1);
 
 //--------------------------------------------------------------------------------------
 // Helper functions
@@ -32,6 +33,7 @@ struct RayPayload
     float3 dndu;
     float3 dndv;
     uint hitMeshIdx;
+    uint primIdx;
 };
 
 bool TestOpacity(uint geoIdx, uint instanceID, uint primIdx, float2 bary)
@@ -46,15 +48,14 @@ bool TestOpacity(uint geoIdx, uint instanceID, uint primIdx, float2 bary)
 
     if(meshData.BaseColorTex != UINT16_MAX)
     {
-        uint tri = primIdx * 3;
-        tri += meshData.BaseIdxOffset;
-        uint i0 = g_sceneIndices[NonUniformResourceIndex(tri)] + meshData.BaseVtxOffset;
-        uint i1 = g_sceneIndices[NonUniformResourceIndex(tri + 1)] + meshData.BaseVtxOffset;
-        uint i2 = g_sceneIndices[NonUniformResourceIndex(tri + 2)] + meshData.BaseVtxOffset;
+        const uint3 idx = RT::LoadTriangleIndices(g_sceneIndices, meshData, primIdx);
+        uint i0 = idx.x;
+        uint i1 = idx.y;
+        uint i2 = idx.z;
 
-        Vertex V0 = g_sceneVertices[NonUniformResourceIndex(i0)];
-        Vertex V1 = g_sceneVertices[NonUniformResourceIndex(i1)];
-        Vertex V2 = g_sceneVertices[NonUniformResourceIndex(i2)];
+        Vertex V0 = RT::UnpackVertex(g_sceneVertices[NonUniformResourceIndex(i0)], meshData);
+        Vertex V1 = RT::UnpackVertex(g_sceneVertices[NonUniformResourceIndex(i1)], meshData);
+        Vertex V2 = RT::UnpackVertex(g_sceneVertices[NonUniformResourceIndex(i2)], meshData);
 
         float2 uv = V0.TexUV + bary.x * (V1.TexUV - V0.TexUV) + bary.y * (V2.TexUV - V0.TexUV);
 
@@ -69,6 +70,155 @@ bool TestOpacity(uint geoIdx, uint instanceID, uint primIdx, float2 bary)
     return true;
 }
 
+RayPayload BuildPayload(float3 origin, float3 dir, uint meshIdx, uint primIdx, float2 bary, 
+    float t)
+{
+    RayPayload payload;
+    const RT::MeshInstance meshData = g_frameMeshData[NonUniformResourceIndex(meshIdx)];
+
+    payload.t = t;
+    payload.matIdx = meshData.MatIdx;
+    payload.hitMeshIdx = meshIdx;
+    payload.primIdx = primIdx;
+
+    const uint3 idx = RT::LoadTriangleIndices(g_sceneIndices, meshData, primIdx);
+    uint i0 = idx.x;
+    uint i1 = idx.y;
+    uint i2 = idx.z;
+
+    Vertex V0 = RT::UnpackVertex(g_sceneVertices[NonUniformResourceIndex(i0)], meshData);
+    Vertex V1 = RT::UnpackVertex(g_sceneVertices[NonUniformResourceIndex(i1)], meshData);
+    Vertex V2 = RT::UnpackVertex(g_sceneVertices[NonUniformResourceIndex(i2)], meshData);
+
+    float4 q = Math::DecodeNormalized4(meshData.Rotation);
+    // due to quantization, it's necessary to renormalize
+    q = normalize(q);
+
+    // texture UV coords
+    float2 uv = V0.TexUV + bary.x * (V1.TexUV - V0.TexUV) + bary.y * (V2.TexUV - V0.TexUV);
+    payload.uv = uv;
+
+    // normal
+    float3 v0_n = Math::DecodeOct32(V0.NormalL);
+    float3 v1_n = Math::DecodeOct32(V1.NormalL);
+    float3 v2_n = Math::DecodeOct32(V2.NormalL);
+    float3 normal = v0_n + bary.x * (v1_n - v0_n) + bary.y * (v2_n - v0_n);
+    // transform normal using the inverse transpose
+    // (M^-1)^T = ((RS)^-1)^T
+    //          = (S^-1 R^-1)^T
+    //          = (R^T)^T (S^-1)^T
+    //          = R S^-1
+    const float3 scaleInv = 1.0f / meshData.Scale;
+    normal *= scaleInv;
+    normal = Math::RotateVector(normal, q);
+    normal = normalize(normal);
+    payload.normal = normal;
+
+    // tangent vector
+    float3 v0_t = Math::DecodeOct32(V0.TangentU);
+    float3 v1_t = Math::DecodeOct32(V1.TangentU);
+    float3 v2_t = Math::DecodeOct32(V2.TangentU);
+    float3 tangent = v0_t + bary.x * (v1_t - v0_t) + bary.y * (v2_t - v0_t);
+    tangent *= meshData.Scale;
+    tangent = Math::RotateVector(tangent, q);
+    tangent = normalize(tangent);
+    payload.tangent = tangent;
+
+    // triangle geometry differentials are needed for ray differentials
+    float3 v0W = Math::TransformTRS(V0.PosL, meshData.Translation, q, meshData.Scale);
+    float3 v1W = Math::TransformTRS(V1.PosL, meshData.Translation, q, meshData.Scale);
+    float3 v2W = Math::TransformTRS(V2.PosL, meshData.Translation, q, meshData.Scale);
+
+    float3 n0W = v0_n * scaleInv;
+    n0W = Math::RotateVector(n0W, q);
+    n0W = normalize(n0W);
+
+    float3 n1W = v1_n * scaleInv;
+    n1W = Math::RotateVector(n1W, q);
+    n1W = normalize(n1W);
+
+    float3 n2W = v2_n * scaleInv;
+    n2W = Math::RotateVector(n2W, q);
+    n2W = normalize(n2W);
+
+    Math::TriDifferentials triDiffs = Math::TriDifferentials::Compute(v0W, v1W, v2W, 
+        n0W, n1W, n2W,
+        V0.TexUV, V1.TexUV, V2.TexUV);
+
+    payload.dpdu = triDiffs.dpdu;
+    payload.dpdv = triDiffs.dpdv;
+    payload.dndu = triDiffs.dndu;
+    payload.dndv = triDiffs.dndv;
+    
+    // motion vector
+    float3 hitPos = mad(dir, t, origin);
+    float3 posL = Math::InverseTransformTRS(hitPos, meshData.Translation, q, meshData.Scale);
+    float3 prevTranslation = meshData.Translation - meshData.dTranslation;
+    float4 q_prev = Math::DecodeNormalized4(meshData.PrevRotation);
+    // due to quantization, it's necessary to renormalize
+    q_prev = normalize(q_prev);
+    float3 pos_prev = Math::TransformTRS(posL, prevTranslation, q_prev, meshData.PrevScale);
+    float3 posV_prev = mul(g_frame.PrevView, float4(pos_prev, 1.0f));
+    float2 posNDC_prev = posV_prev.xy / (posV_prev.z * g_frame.TanHalfFOV);
+    posNDC_prev.x /= g_frame.AspectRatio;
+    payload.prevPosNDC = posNDC_prev;
+
+    return payload;
+}
+
+#ifdef PRIMARY_HIT_RASTER
+// Visible triangle was found by GBufferRaster, hit distance and barycentrics are recomputed
+// by intersecting the camera ray with it
+RayPayload TracePrimaryHit(float3 origin, float3 dir, uint2 DTid)
+{
+    RayPayload payload;
+    payload.t = FLT_MAX;
+
+    Texture2D<uint2> g_triIDs = ResourceDescriptorHeap[g_local.TriIDsDescHeapIdx];
+    const uint2 triID = g_triIDs[DTid];
+
+    // Zero marks empty pixels
+    if (triID.x == 0)
+        return payload;
+
+    const uint meshIdx = triID.x - 1;
+    const uint primIdx = triID.y;
+    const RT::MeshInstance meshData = g_frameMeshData[NonUniformResourceIndex(meshIdx)];
+
+    const uint3 idx = RT::LoadTriangleIndices(g_sceneIndices, meshData, primIdx);
+    Vertex V0 = RT::UnpackVertex(g_sceneVertices[NonUniformResourceIndex(idx.x)], meshData);
+    Vertex V1 = RT::UnpackVertex(g_sceneVertices[NonUniformResourceIndex(idx.y)], meshData);
+    Vertex V2 = RT::UnpackVertex(g_sceneVertices[NonUniformResourceIndex(idx.z)], meshData);
+
+    float4 q = Math::DecodeNormalized4(meshData.Rotation);
+    // due to quantization, it's necessary to renormalize
+    q = normalize(q);
+
+    float3 v0W = Math::TransformTRS(V0.PosL, meshData.Translation, q, meshData.Scale);
+    float3 v1W = Math::TransformTRS(V1.PosL, meshData.Translation, q, meshData.Scale);
+    float3 v2W = Math::TransformTRS(V2.PosL, meshData.Translation, q, meshData.Scale);
+
+    // Ref: T. Moller and B. Trumbore, "Fast, Minimum Storage Ray/Triangle Intersection," 
+    // Journal of Graphics Tools, 1997.
+    const float3 e1 = v1W - v0W;
+    const float3 e2 = v2W - v0W;
+    const float3 p = cross(dir, e2);
+    const float det = dot(e1, p);
+
+    // Triangle is seen edge-on
+    if (det == 0)
+        return payload;
+
+    const float invDet = 1.0f / det;
+    const float3 s = origin - v0W;
+    const float3 r = cross(s, e1);
+    // Pixel center is inside the rasterized triangle, clamp to counter numerical error
+    const float2 bary = saturate(float2(dot(s, p), dot(dir, r)) * invDet);
+    const float t = max(dot(e2, r) * invDet, 0);
+
+    return BuildPayload(origin, dir, meshIdx, primIdx, bary, t);
+}
+#else
 RayPayload TracePrimaryHit(float3 origin, float3 dir)
 {
     RayDesc cameraRay;
@@ -99,103 +249,16 @@ RayPayload TracePrimaryHit(float3 origin, float3 dir)
 
     if (rayQuery.CommittedStatus() == COMMITTED_TRIANGLE_HIT)
     {
-        uint meshIdx = rayQuery.CommittedGeometryIndex() + rayQuery.CommittedInstanceID();
-        uint primIdx = rayQuery.CommittedPrimitiveIndex();
-        float2 bary = rayQuery.CommittedTriangleBarycentrics();
-
-        const RT::MeshInstance meshData = g_frameMeshData[NonUniformResourceIndex(meshIdx)];
-
-        payload.t = rayQuery.CommittedRayT();
-        payload.matIdx = meshData.MatIdx;
-        payload.hitMeshIdx = meshIdx;
-
-        uint tri = primIdx * 3;
-        tri += meshData.BaseIdxOffset;
-        uint i0 = g_sceneIndices[NonUniformResourceIndex(tri)] + meshData.BaseVtxOffset;
-        uint i1 = g_sceneIndices[NonUniformResourceIndex(tri + 1)] + meshData.BaseVtxOffset;
-        uint i2 = g_sceneIndices[NonUniformResourceIndex(tri + 2)] + meshData.BaseVtxOffset;
-
-        Vertex V0 = g_sceneVertices[NonUniformResourceIndex(i0)];
-        Vertex V1 = g_sceneVertices[NonUniformResourceIndex(i1)];
-        Vertex V2 = g_sceneVertices[NonUniformResourceIndex(i2)];
-
-        float4 q = Math::DecodeNormalized4(meshData.Rotation);
-        // due to quantization, it's necessary to renormalize
-        q = normalize(q);
-
-        // texture UV coords
-        float2 uv = V0.TexUV + bary.x * (V1.TexUV - V0.TexUV) + bary.y * (V2.TexUV - V0.TexUV);
-        payload.uv = uv;
-
-        // normal
-        float3 v0_n = Math::DecodeOct32(V0.NormalL);
-        float3 v1_n = Math::DecodeOct32(V1.NormalL);
-        float3 v2_n = Math::DecodeOct32(V2.NormalL);
-        float3 normal = v0_n + bary.x * (v1_n - v0_n) + bary.y * (v2_n - v0_n);
-        // transform normal using the inverse transpose
-        // (M^-1)^T = ((RS)^-1)^T
-        //          = (S^-1 R^-1)^T
-        //          = (R^T)^T (S^-1)^T
-        //          = R S^-1
-        const float3 scaleInv = 1.0f / meshData.Scale;
-        normal *= scaleInv;
-        normal = Math::RotateVector(normal, q);
-        normal = normalize(normal);
-        payload.normal = normal;
-
-        // tangent vector
-        float3 v0_t = Math::DecodeOct32(V0.TangentU);
-        float3 v1_t = Math::DecodeOct32(V1.TangentU);
-        float3 v2_t = Math::DecodeOct32(V2.TangentU);
-        float3 tangent = v0_t + bary.x * (v1_t - v0_t) + bary.y * (v2_t - v0_t);
-        tangent *= meshData.Scale;
-        tangent = Math::RotateVector(tangent, q);
-        tangent = normalize(tangent);
-        payload.tangent = tangent;
-
-        // triangle geometry differentials are needed for ray differentials
-        float3 v0W = Math::TransformTRS(V0.PosL, meshData.Translation, q, meshData.Scale);
-        float3 v1W = Math::TransformTRS(V1.PosL, meshData.Translation, q, meshData.Scale);
-        float3 v2W = Math::TransformTRS(V2.PosL, meshData.Translation, q, meshData.Scale);
-
-        float3 n0W = v0_n * scaleInv;
-        n0W = Math::RotateVector(n0W, q);
-        n0W = normalize(n0W);
-
-        float3 n1W = v1_n * scaleInv;
-        n1W = Math::RotateVector(n1W, q);
-        n1W = normalize(n1W);
-
-        float3 n2W = v2_n * scaleInv;
-        n2W = Math::RotateVector(n2W, q);
-        n2W = normalize(n2W);
-
-        Math::TriDifferentials triDiffs = Math::TriDifferentials::Compute(v0W, v1W, v2W, 
-            n0W, n1W, n2W,
-            V0.TexUV, V1.TexUV, V2.TexUV);
-
-        payload.dpdu = triDiffs.dpdu;
-        payload.dpdv = triDiffs.dpdv;
-        payload.dndu = triDiffs.dndu;
-        payload.dndv = triDiffs.dndv;
-        
-        // motion vector
-        float3 hitPos = mad(rayQuery.WorldRayDirection(), rayQuery.CommittedRayT(), 
-            rayQuery.WorldRayOrigin());
-        float3 posL = Math::InverseTransformTRS(hitPos, meshData.Translation, q, meshData.Scale);
-        float3 prevTranslation = meshData.Translation - meshData.dTranslation;
-        float4 q_prev = Math::DecodeNormalized4(meshData.PrevRotation);
-        // due to quantization, it's necessary to renormalize
-        q_prev = normalize(q_prev);
-        float3 pos_prev = Math::TransformTRS(posL, prevTranslation, q_prev, meshData.PrevScale);
-        float3 posV_prev = mul(g_frame.PrevView, float4(pos_prev, 1.0f));
-        float2 posNDC_prev = posV_prev.xy / (posV_prev.z * g_frame.TanHalfFOV);
-        posNDC_prev.x /= g_frame.AspectRatio;
-        payload.prevPosNDC = posNDC_prev;
+        payload = BuildPayload(rayQuery.WorldRayOrigin(), rayQuery.WorldRayDirection(),
+            rayQuery.CommittedGeometryIndex() + rayQuery.CommittedInstanceID(),
+            rayQuery.CommittedPrimitiveIndex(),
+            rayQuery.CommittedTriangleBarycentrics(),
+            rayQuery.CommittedRayT());
     }
 
     return payload;
 }
+#endif
 
 //--------------------------------------------------------------------------------------
 // Main
@@ -236,7 +299,11 @@ void main(uint3 DTid : SV_DispatchThreadID)
         mad(rayDirCS.y, g_frame.CurrView[1].xyz, rayDirCS.z * g_frame.CurrView[2].xyz));
     rayDir = normalize(rayDir);
 
+#ifdef PRIMARY_HIT_RASTER
+    RayPayload rayPayload = TracePrimaryHit(rayOrigin, rayDir, DTid.xy);
+#else
     RayPayload rayPayload = TracePrimaryHit(rayOrigin, rayDir);
+#endif
 
     if(g_local.PickedPixelX == DTid.x && g_local.PickedPixelY == DTid.y)
         g_pick[0] = rayPayload.t != FLT_MAX ? rayPayload.hitMeshIdx : UINT32_MAX;
@@ -247,9 +314,15 @@ void main(uint3 DTid : SV_DispatchThreadID)
         RWTexture2D<float> g_depth = ResourceDescriptorHeap[g_local.UavTableDescHeapIdx + (int)UAV_DESC_TABLE::DEPTH];
         g_depth[DTid.xy] = FLT_MAX;
 
+#if PACKED_GBUFFER == 1
+        RWTexture2D<uint2> g_material = 
+            ResourceDescriptorHeap[g_local.UavTableDescHeapIdx + (int)UAV_DESC_TABLE::METALLIC_ROUGHNESS];
+        g_material[DTid.xy] = uint2(4, 0);
+#else
         RWTexture2D<float2> g_metallicRoughness = 
             ResourceDescriptorHeap[g_local.UavTableDescHeapIdx + (int)UAV_DESC_TABLE::METALLIC_ROUGHNESS];
         g_metallicRoughness[DTid.xy].x = 4.0f / 255.0f;
+#endif
 
         // just the camera motion
         RWTexture2D<float2> g_outMotion = 
@@ -282,6 +355,16 @@ void main(uint3 DTid : SV_DispatchThreadID)
 
     GBufferRT::ApplyTextureMaps(DTid.xy, z, wo, rayPayload.uv, rayPayload.matIdx, 
         rayPayload.normal, rayPayload.tangent, motionVec, grads, rayPayload.dpdu, 
-        rayPayload.dpdv, rayPayload.dndu, rayPayload.dndv, g_frame, 
-        g_local, g_materials);
+        rayPayload.dpdv, rayPayload.dndu, rayPayload.dndv, rayPayload.hitMeshIdx, 
+        rayPayload.primIdx, g_frame, g_local, g_materials);
+
+    // Texture streaming feedback -- one pixel per tile, rotated every frame
+    const uint2 feedbackPixel = uint2(g_frame.FrameNum & (TEX_FEEDBACK_TILE_DIM - 1),
+        (g_frame.FrameNum >> TEX_FEEDBACK_LOG2_TILE_DIM) & (TEX_FEEDBACK_TILE_DIM - 1));
+
+    if (all((DTid.xy & (TEX_FEEDBACK_TILE_DIM - 1)) == feedbackPixel))
+    {
+        GBufferRT::WriteTextureFeedback(rayPayload.matIdx, grads, g_frame, g_materials, 
+            g_texFeedback);
+    }
 }
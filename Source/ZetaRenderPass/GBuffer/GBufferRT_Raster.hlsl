@@ -0,0 +1,3 @@
+// Primary hits are read from the triangle IDs that GBufferRaster wrote rather than traced
+#define PRIMARY_HIT_RASTER
+#include "GBufferRT_Inline.hlsl"
@@ -0,0 +1,218 @@
+#include "GBufferRaster.h"
+#include <Core/CommandList.h>
+#include <Scene/SceneCore.h>
+#include <RayTracing/RtAccelerationStructure.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Core::Direct3DUtil;
+using namespace ZetaRay::Core::GpuMemory;
+using namespace ZetaRay::RenderPass;
+using namespace ZetaRay::Scene;
+using namespace ZetaRay::RT;
+using namespace ZetaRay::App;
+using namespace ZetaRay::Util;
+
+//--------------------------------------------------------------------------------------
+// GBufferRaster
+//--------------------------------------------------------------------------------------
+
+GBufferRaster::GBufferRaster()
+    : RenderPassBase(NUM_CBV, NUM_SRV, NUM_UAV, NUM_GLOBS, NUM_CONSTS)
+{
+    // frame constants
+    m_rootSig.InitAsCBV(0, 0, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        GlobalResource::FRAME_CONSTANTS_BUFFER);
+
+    // root constants
+    m_rootSig.InitAsConstants(1, NUM_CONSTS, 1);
+
+    // draws
+    m_rootSig.InitAsBufferSRV(2, 0, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, nullptr, true);
+
+    // mesh buffer
+    m_rootSig.InitAsBufferSRV(3, 1, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        GlobalResource::RT_FRAME_MESH_INSTANCES_CURR);
+
+    // scene VB
+    m_rootSig.InitAsBufferSRV(4, 2, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC,
+        GlobalResource::SCENE_VERTEX_BUFFER);
+
+    // scene meshlets
+    m_rootSig.InitAsBufferSRV(5, 3, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC,
+        GlobalResource::SCENE_MESHLETS);
+
+    // scene meshlet data
+    m_rootSig.InitAsBufferSRV(6, 4, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC,
+        GlobalResource::SCENE_MESHLET_DATA);
+}
+
+void GBufferRaster::Init()
+{
+    auto& renderer = App::GetRenderer();
+    Assert(renderer.IsMeshShaderSupported(), "Mesh shaders are not supported.");
+
+    constexpr D3D12_ROOT_SIGNATURE_FLAGS flags =
+        D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+    auto samplers = renderer.GetStaticSamplers();
+    RenderPassBase::InitRenderPass("GBufferRaster", flags, samplers);
+
+    DXGI_FORMAT rtvFormats[1] = { TRIANGLE_IDS_FORMAT };
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = Direct3DUtil::GetPSODesc(nullptr,
+        1, rtvFormats, DEPTH_FORMAT);
+
+    // reverse z
+    psoDesc.DepthStencilState.DepthEnable = true;
+    psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+    psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER;
+
+    // Primary rays hit both sides of every triangle. Back-facing meshlets of single-sided
+    // materials are rejected in the amplification shader instead.
+    psoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+
+    m_psoLib.CompileMeshPSO(0, psoDesc, m_rootSigObj.Get(), COMPILED_AS, COMPILED_MS,
+        COMPILED_PS);
+
+    m_rtvDescTable = renderer.GetRtvDescriptorHeap().Allocate(1);
+    m_dsvDescTable = renderer.GetDsvDescriptorHeap().Allocate(1);
+    m_descTable = renderer.GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
+
+    CreateResources();
+}
+
+void GBufferRaster::OnWindowResized()
+{
+    m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
+    CreateResources();
+}
+
+void GBufferRaster::CreateResources()
+{
+    auto& renderer = App::GetRenderer();
+    const uint32_t w = renderer.GetRenderWidth();
+    const uint32_t h = renderer.GetRenderHeight();
+
+    // Zero marks pixels that no triangle covers
+    D3D12_CLEAR_VALUE clearVal;
+    clearVal.Format = TRIANGLE_IDS_FORMAT;
+    clearVal.Color[0] = 0;
+    clearVal.Color[1] = 0;
+    clearVal.Color[2] = 0;
+    clearVal.Color[3] = 0;
+    m_triIDs = GpuMemory::GetTexture2D("GBufferRaster_TriIDs", w, h, TRIANGLE_IDS_FORMAT,
+        D3D12_RESOURCE_STATE_COMMON, TEXTURE_FLAGS::ALLOW_RENDER_TARGET, 1, &clearVal);
+
+    D3D12_CLEAR_VALUE depthClearVal;
+    depthClearVal.Format = DEPTH_FORMAT;
+    depthClearVal.DepthStencil.Depth = 0.0f;
+    depthClearVal.DepthStencil.Stencil = 0;
+    // Only used by this pass, so it stays in the depth-write state
+    m_depth = GpuMemory::GetTexture2D("GBufferRaster_Depth", w, h, DEPTH_FORMAT,
+        D3D12_RESOURCE_STATE_DEPTH_WRITE, TEXTURE_FLAGS::ALLOW_DEPTH_STENCIL, 1, &depthClearVal);
+
+    Direct3DUtil::CreateRTV(m_triIDs, m_rtvDescTable.CPUHandle(0));
+    Direct3DUtil::CreateDSV(m_depth, m_dsvDescTable.CPUHandle(0));
+    Direct3DUtil::CreateTexture2DSRV(m_triIDs, m_descTable.CPUHandle(
+        (int)DESC_TABLE::TRIANGLE_IDS_SRV));
+}
+
+void GBufferRaster::Update(const TLAS& tlas)
+{
+    const SceneCore& scene = App::GetScene();
+    const uint32_t numInstances = tlas.NumFrameMeshInstances();
+    m_draws.clear();
+
+    for (uint32_t i = 0; i < numInstances; i++)
+    {
+        const uint64_t meshID = tlas.FrameMeshInstanceMeshID(i);
+        const auto mesh = scene.GetMesh(meshID);
+        if (!mesh || mesh.value()->m_numMeshlets == 0)
+            continue;
+
+        const Model::TriangleMesh& m = *mesh.value();
+        const auto mat = scene.GetMaterial(m.m_materialID);
+        uint32_t flags = 0;
+
+        if (mat)
+        {
+            flags |= !mat.value()->DoubleSided() ? GBUFFER_RASTER_DRAW_CONE_CULL : 0;
+            flags |= mat.value()->GetAlphaMode() != Material::ALPHA_MODE::OPAQUE_ ?
+                GBUFFER_RASTER_DRAW_ALPHA_TEST : 0;
+        }
+
+        for (uint32_t j = 0; j < m.m_numMeshlets; j += GBUFFER_RASTER_AS_GROUP_SIZE)
+        {
+            const uint32_t n = Math::Min(m.m_numMeshlets - j, (uint32_t)GBUFFER_RASTER_AS_GROUP_SIZE);
+
+            m_draws.push_back(GBufferRasterDraw{ .MeshInstanceIdx = i,
+                .FirstMeshlet = m.m_meshletOffset + j,
+                .NumMeshlets_Flags = n | flags });
+        }
+    }
+
+    if (m_draws.empty())
+        return;
+
+    const uint32_t sizeInBytes = (uint32_t)(m_draws.size() * sizeof(GBufferRasterDraw));
+    m_drawBuffer = GpuMemory::AllocateFrameUpload(sizeInBytes, sizeof(uint32_t));
+    memcpy(m_drawBuffer.MappedMemory, m_draws.data(), sizeInBytes);
+}
+
+void GBufferRaster::Render(CommandList& cmdList)
+{
+    Assert(cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_DIRECT, "Invalid downcast");
+    GraphicsCmdList& directCmdList = static_cast<GraphicsCmdList&>(cmdList);
+
+    auto& renderer = App::GetRenderer();
+    auto& gpuTimer = renderer.GetGpuTimer();
+
+    directCmdList.PIXBeginEvent("GBufferRaster");
+    const uint32_t queryIdx = gpuTimer.BeginQuery(directCmdList, "GBufferRaster");
+
+    auto rtv = m_rtvDescTable.CPUHandle(0);
+    auto dsv = m_dsvDescTable.CPUHandle(0);
+    directCmdList.OMSetRenderTargets(1, &rtv, true, &dsv);
+    directCmdList.ClearRenderTargetView(rtv, 0, 0, 0, 0);
+    directCmdList.ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 0.0f);
+
+    if (!m_draws.empty())
+    {
+        D3D12_VIEWPORT viewports[1] = { renderer.GetRenderViewport() };
+        D3D12_RECT scissors[1] = { renderer.GetRenderScissor() };
+        directCmdList.RSSetViewportsScissorsRects(1, viewports, scissors);
+
+        directCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
+        directCmdList.SetPipelineState(m_psoLib.GetPSO(0));
+        m_rootSig.SetRootSRV(2, m_drawBuffer.GpuVA);
+
+        // One amplification shader group per draw, split to stay within the dispatch limit
+        const uint32_t numDraws = (uint32_t)m_draws.size();
+        constexpr uint32_t MAX_NUM_GROUPS = D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION;
+
+        for (uint32_t i = 0; i < numDraws; i += MAX_NUM_GROUPS)
+        {
+            cbGBufferRaster cb;
+            cb.FirstDraw = i;
+            cb.NumDraws = Math::Min(numDraws - i, MAX_NUM_GROUPS);
+
+            m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
+            m_rootSig.End(directCmdList);
+
+            directCmdList.DispatchMesh(cb.NumDraws, 1, 1);
+        }
+    }
+
+    gpuTimer.EndQuery(directCmdList, queryIdx);
+    directCmdList.PIXEndEvent();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../RenderPass.h"
+#include <Core/GpuMemory.h>
+#include <Utility/SmallVector.h>
+#include "GBufferRaster_Common.h"
+
+namespace ZetaRay::Core
+{
+    class CommandList;
+}
+
+namespace ZetaRay::RT
+{
+    struct TLAS;
+}
+
+namespace ZetaRay::RenderPass
+{
+    // Rasterizes the meshlets of all frame mesh instances with mesh shaders and writes the
+    // visible triangle of every pixel (mesh index + 1 and primitive index, zero for empty
+    // pixels). Amplification shader culls meshlets against the view frustum and, for
+    // single-sided materials, their normal cones. Camera jitter is matched to the primary
+    // rays of GBufferRT, which then builds the g-buffers from the triangle IDs.
+    struct GBufferRaster final : public RenderPassBase<1>
+    {
+        enum class DESC_TABLE
+        {
+            TRIANGLE_IDS_SRV,
+            COUNT
+        };
+
+        GBufferRaster();
+        ~GBufferRaster() = default;
+
+        GBufferRaster(GBufferRaster&&) = delete;
+        GBufferRaster& operator=(GBufferRaster&&) = delete;
+
+        void Init();
+        void OnWindowResized();
+        // Gathers the meshlets of current frame's mesh instances, must be called after
+        // TLAS has been updated for this frame
+        void Update(const RT::TLAS& tlas);
+        ZetaInline Core::GpuMemory::Texture& GetTriangleIDs() { return m_triIDs; }
+        ZetaInline uint32_t TriangleIDsDescHeapIdx() const
+        {
+            return m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::TRIANGLE_IDS_SRV);
+        }
+        void Render(Core::CommandList& cmdList);
+
+    private:
+        static constexpr int NUM_CBV = 1;
+        static constexpr int NUM_SRV = 5;
+        static constexpr int NUM_UAV = 0;
+        static constexpr int NUM_GLOBS = 4;
+        static constexpr int NUM_CONSTS = (int)(sizeof(cbGBufferRaster) / sizeof(DWORD));
+        static constexpr DXGI_FORMAT TRIANGLE_IDS_FORMAT = DXGI_FORMAT_R32G32_UINT;
+        static constexpr DXGI_FORMAT DEPTH_FORMAT = DXGI_FORMAT_D32_FLOAT;
+
+        inline static constexpr const char* COMPILED_AS = "GBufferRaster_as.cso";
+        inline static constexpr const char* COMPILED_MS = "GBufferRaster_ms.cso";
+        inline static constexpr const char* COMPILED_PS = "GBufferRaster_ps.cso";
+
+        void CreateResources();
+
+        Core::GpuMemory::Texture m_triIDs;
+        Core::GpuMemory::Texture m_depth;
+        Core::DescriptorTable m_descTable;
+        Core::DescriptorTable m_rtvDescTable;
+        Core::DescriptorTable m_dsvDescTable;
+        Util::SmallVector<GBufferRasterDraw> m_draws;
+        Core::GpuMemory::FrameUploadAllocation m_drawBuffer;
+    };
+}
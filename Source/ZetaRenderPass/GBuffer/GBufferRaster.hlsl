@@ -0,0 +1,212 @@
+#include "GBufferRaster_Common.h"
+#include "../Common/FrameConstants.h"
+#include "../Common/StaticTextureSamplers.hlsli"
+#include "../Common/RT.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b0);
+ConstantBuffer<cbGBufferRaster> g_local : register(b1);
+StructuredBuffer<GBufferRasterDraw> g_draws : register(t0);
+StructuredBuffer<RT::MeshInstance> g_frameMeshData : register(t1);
+StructuredBuffer<PackedVertex> g_sceneVertices : register(t2);
+StructuredBuffer<RT::Meshlet> g_meshlets : register(t3);
+StructuredBuffer<uint> g_meshletData : register(t4);
+
+//--------------------------------------------------------------------------------------
+// Types
+//--------------------------------------------------------------------------------------
+
+struct Payload
+{
+    uint MeshInstanceIdx;
+    uint Flags;
+    uint MeshletIdx[GBUFFER_RASTER_AS_GROUP_SIZE];
+};
+
+struct VertexOut
+{
+    float4 PosH : SV_Position;
+    float2 UV : TEXCOORD0;
+};
+
+struct PrimitiveOut
+{
+    uint MeshIdx : MESH_IDX;
+    uint PrimIdx : PRIM_IDX;
+    uint AlphaTest : ALPHA_TEST;
+};
+
+groupshared Payload g_payload;
+groupshared uint g_numVisible;
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+bool IsMeshletVisible(RT::Meshlet meshlet, RT::MeshInstance meshData, bool coneCull)
+{
+    float4 q = Math::DecodeNormalized4(meshData.Rotation);
+    // due to quantization, it's necessary to renormalize
+    q = normalize(q);
+    const float3 scale = meshData.Scale;
+
+    const float3 centerW = Math::TransformTRS(meshlet.Center, meshData.Translation, q, scale);
+    const float radius = meshlet.Radius * max(abs(scale.x), max(abs(scale.y), abs(scale.z)));
+    const float3 centerV = mul(g_frame.CurrView, float4(centerW, 1.0f));
+
+    // Near plane
+    if (centerV.z + radius < g_frame.CameraNear)
+        return false;
+
+    // Side planes pass through the camera, so for a symmetric frustum only the side
+    // that's closer to the center needs to be tested. Frustum is slightly enlarged to
+    // account for camera jitter.
+    const float tanX = g_frame.AspectRatio * g_frame.TanHalfFOV * (1.0f + 2.0f / g_frame.RenderWidth);
+    const float tanY = g_frame.TanHalfFOV * (1.0f + 2.0f / g_frame.RenderHeight);
+    const float dx = (abs(centerV.x) - tanX * centerV.z) * rsqrt(1.0f + tanX * tanX);
+    const float dy = (abs(centerV.y) - tanY * centerV.z) * rsqrt(1.0f + tanY * tanY);
+
+    if (dx > radius || dy > radius)
+        return false;
+
+    // Normal cone is only valid under rotation and positive uniform scaling
+    const bool uniformScale = scale.x > 0 && all(abs(scale - scale.x) <= 1e-3f * scale.x);
+
+    if (coneCull && uniformScale && meshlet.ConeCutoff < 1.0f)
+    {
+        const float3 axis = Math::RotateVector(Math::DecodeOct32(meshlet.ConeAxis), q);
+        const float3 toCenter = centerW - g_frame.CameraPos;
+
+        if (dot(toCenter, axis) >= meshlet.ConeCutoff * length(toCenter) + radius)
+            return false;
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Amplification shader -- one group per draw, one thread per meshlet
+//--------------------------------------------------------------------------------------
+
+[numthreads(GBUFFER_RASTER_AS_GROUP_SIZE, 1, 1)]
+void mainAS(uint Gid : SV_GroupID, uint GTid : SV_GroupThreadID)
+{
+    const GBufferRasterDraw draw = g_draws[g_local.FirstDraw + Gid];
+    const uint numMeshlets = draw.NumMeshlets_Flags & 0xffff;
+
+    if (GTid == 0)
+    {
+        g_numVisible = 0;
+        g_payload.MeshInstanceIdx = draw.MeshInstanceIdx;
+        g_payload.Flags = draw.NumMeshlets_Flags;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (GTid < numMeshlets)
+    {
+        const uint meshletIdx = draw.FirstMeshlet + GTid;
+        const RT::Meshlet meshlet = g_meshlets[meshletIdx];
+        const RT::MeshInstance meshData = g_frameMeshData[draw.MeshInstanceIdx];
+
+        const bool coneCull = (draw.NumMeshlets_Flags & GBUFFER_RASTER_DRAW_CONE_CULL) != 0;
+
+        if (IsMeshletVisible(meshlet, meshData, coneCull))
+        {
+            // Wave intrinsics would assume a minimum wave size of 32
+            uint slot;
+            InterlockedAdd(g_numVisible, 1, slot);
+            g_payload.MeshletIdx[slot] = meshletIdx;
+        }
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    DispatchMesh(g_numVisible, 1, 1, g_payload);
+}
+
+//--------------------------------------------------------------------------------------
+// Mesh shader -- one group per meshlet
+//--------------------------------------------------------------------------------------
+
+[outputtopology("triangle")]
+[numthreads(GBUFFER_RASTER_MS_GROUP_SIZE, 1, 1)]
+void mainMS(uint Gid : SV_GroupID, uint GTid : SV_GroupThreadID, in payload Payload p,
+    out vertices VertexOut verts[MESHLET_MAX_VERTICES],
+    out indices uint3 tris[MESHLET_MAX_TRIANGLES],
+    out primitives PrimitiveOut prims[MESHLET_MAX_TRIANGLES])
+{
+    const RT::MeshInstance meshData = g_frameMeshData[p.MeshInstanceIdx];
+    const RT::Meshlet meshlet = g_meshlets[p.MeshletIdx[Gid]];
+
+    SetMeshOutputCounts(meshlet.NumVerts, meshlet.NumTris);
+
+    if (GTid < meshlet.NumVerts)
+    {
+        const uint vtxIdx = meshData.BaseVtxOffset + g_meshletData[meshlet.DataOffset + GTid];
+        const Vertex V = RT::UnpackVertex(g_sceneVertices[vtxIdx], meshData);
+
+        float4 q = Math::DecodeNormalized4(meshData.Rotation);
+        // due to quantization, it's necessary to renormalize
+        q = normalize(q);
+
+        const float3 posW = Math::TransformTRS(V.PosL, meshData.Translation, q, meshData.Scale);
+        const float3 posV = mul(g_frame.CurrView, float4(posW, 1.0f));
+
+        // Pixel centers have to line up with the jittered primary rays (see
+        // RT::GeneratePinholeCameraRay_CS()). Depth is reversed, with the near plane at 1.
+        const float2 jitterNDC = 2.0f * g_frame.CurrCameraJitter /
+            float2(g_frame.RenderWidth, g_frame.RenderHeight);
+
+        float4 posH;
+        posH.x = posV.x / (g_frame.AspectRatio * g_frame.TanHalfFOV) - jitterNDC.x * posV.z;
+        posH.y = posV.y / g_frame.TanHalfFOV + jitterNDC.y * posV.z;
+        posH.z = g_frame.CameraNear;
+        posH.w = posV.z;
+
+        verts[GTid].PosH = posH;
+        verts[GTid].UV = V.TexUV;
+    }
+
+    if (GTid < meshlet.NumTris)
+    {
+        const uint tri = g_meshletData[meshlet.DataOffset + meshlet.NumVerts + GTid];
+        tris[GTid] = uint3(tri & 0xff, (tri >> 8) & 0xff, (tri >> 16) & 0xff);
+
+        prims[GTid].MeshIdx = p.MeshInstanceIdx;
+        prims[GTid].PrimIdx = meshlet.FirstTri + GTid;
+        prims[GTid].AlphaTest = (p.Flags & GBUFFER_RASTER_DRAW_ALPHA_TEST) != 0;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Pixel shader
+//--------------------------------------------------------------------------------------
+
+uint2 mainPS(VertexOut vsOut, PrimitiveOut primOut) : SV_Target
+{
+    // Same as opacity test of primary rays in GBufferRT
+    if (primOut.AlphaTest)
+    {
+        const RT::MeshInstance meshData = g_frameMeshData[primOut.MeshIdx];
+        float2 alphaFactor_cutoff = Math::UnpackRG(meshData.AlphaFactor_Cutoff);
+        float alpha = alphaFactor_cutoff.x;
+
+        if (meshData.BaseColorTex != UINT16_MAX)
+        {
+            uint descHeapIdx = NonUniformResourceIndex(g_frame.BaseColorMapsDescHeapOffset +
+                meshData.BaseColorTex);
+            BASE_COLOR_MAP g_baseCol = ResourceDescriptorHeap[descHeapIdx];
+            alpha *= g_baseCol.SampleLevel(g_samLinearWrap, vsOut.UV, 0).a;
+        }
+
+        if (alphaFactor_cutoff.y == 1.0 || alpha < alphaFactor_cutoff.y)
+            discard;
+    }
+
+    // Zero is reserved for empty pixels
+    return uint2(primOut.MeshIdx + 1, primOut.PrimIdx);
+}
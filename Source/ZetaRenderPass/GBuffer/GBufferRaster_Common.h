@@ -0,0 +1,33 @@
+#ifndef GBUFFER_RASTER_COMMON_H
+#define GBUFFER_RASTER_COMMON_H
+
+#include "../../ZetaCore/Core/HLSLCompat.h"
+
+// Each amplification shader group culls the meshlets of one draw, so at most this
+// many meshlets are assigned to every draw
+#define GBUFFER_RASTER_AS_GROUP_SIZE 32
+#define GBUFFER_RASTER_MS_GROUP_SIZE 128
+
+// Set on GBufferRasterDraw::NumMeshlets_Flags when the material is single-sided and
+// meshlets can be culled using their normal cones
+#define GBUFFER_RASTER_DRAW_CONE_CULL (1u << 16)
+// Set when the instance isn't opaque and pixels need to be alpha tested
+#define GBUFFER_RASTER_DRAW_ALPHA_TEST (1u << 17)
+
+struct GBufferRasterDraw
+{
+    // Index into frame mesh instances
+    uint32_t MeshInstanceIdx;
+    // Index into scene meshlet buffer
+    uint32_t FirstMeshlet;
+    // Low 16 bits give the number of meshlets, followed by GBUFFER_RASTER_DRAW_* flags
+    uint32_t NumMeshlets_Flags;
+};
+
+struct cbGBufferRaster
+{
+    uint32_t FirstDraw;
+    uint32_t NumDraws;
+};
+
+#endif
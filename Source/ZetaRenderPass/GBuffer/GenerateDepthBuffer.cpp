@@ -27,7 +27,7 @@ GenerateRasterDepth::GenerateRasterDepth()
 
     RenderPassBase::InitRenderPass("RasterDepth", D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED);
 
-    m_psoLib.CompileComputePSO(0, m_rootSigObj.Get(), COMPILED_CS);
+    m_psoLib.EnqueueComputePSO(0, m_rootSigObj.Get(), COMPILED_CS);
     m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate(1);
 }
 
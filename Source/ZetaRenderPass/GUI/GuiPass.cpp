@@ -13,6 +13,7 @@
 #include <ImGui/implot.h>
 #include <ImGui/ImGuizmo.h>
 #include <algorithm>
+#include <xxHash/xxhash.h>
 
 #include "../Assets/Font/IconsFontAwesome6.h"
 
@@ -31,13 +32,7 @@ namespace
 {
     void AddParamRange(MutableSpan<ParamVariant> params, int offset, int count)
     {
-        // Sort by name among current subgroup
-        std::sort(params.begin() + offset, params.begin() + offset + count, 
-            [](const ParamVariant& p1, const ParamVariant& p2)
-            {
-                return strcmp(p1.GetName(), p2.GetName()) < 0;
-            });
-
+        // Already sorted by name
         for (int p = offset; p < offset + count; p++)
         {
             ParamVariant& param = params[p];
@@ -336,7 +331,7 @@ void GuiPass::Init()
         psoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
         psoDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_ALWAYS;
 
-        m_psoLib.CompileGraphicsPSO(0, psoDesc, m_rootSigObj.Get(), COMPILED_VS[0], COMPILED_PS[0]);
+        m_psoLib.EnqueueGraphicsPSO(0, psoDesc, m_rootSigObj.Get(), COMPILED_VS[0], COMPILED_PS[0]);
     }
 
     auto* ctx = ImGui::GetCurrentContext();
@@ -349,52 +344,109 @@ void GuiPass::OnWindowResized()
     m_appWndSizeChanged = true;
 }
 
-void GuiPass::UpdateBuffers()
+bool GuiPass::UpdateBuffers(GraphicsCmdList& cmdList)
 {
     ImDrawData* draw_data = ImGui::GetDrawData();
-    const int currOutIdx = App::GetRenderer().GetCurrentBackBufferIndex();
 
     // Avoid rendering when minimized
-    if (draw_data->DisplaySize.x <= 0.0f || draw_data->DisplaySize.y <= 0.0f)
-        return;
-
-    auto& fr = m_imguiFrameBuffs[currOutIdx];
-
-    // Create and grow vertex/index buffers if needed
-    if (!fr.VertexBuffer.IsInitialized() || fr.NumVertices < draw_data->TotalVtxCount)
+    if (draw_data->DisplaySize.x <= 0.0f || draw_data->DisplaySize.y <= 0.0f || 
+        draw_data->TotalVtxCount == 0)
     {
-        fr.NumVertices = draw_data->TotalVtxCount + 5000;
-        fr.VertexBuffer = GpuMemory::GetUploadHeapBuffer(fr.NumVertices * sizeof(ImDrawVert));
+        return false;
     }
 
-    // Upload vertex data into a single contiguous GPU buffer
-    uint32_t offset = 0;
+    // Display position offsets the scissor rectangles
+    uint64_t hash = XXH3_64bits(&draw_data->DisplayPos, sizeof(draw_data->DisplayPos));
 
     for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
-        fr.VertexBuffer.Copy(offset, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), 
-            cmd_list->VtxBuffer.Data);
-        offset += cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+        hash = XXH3_64bits_withSeed(cmd_list->VtxBuffer.Data, 
+            cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), hash);
+        hash = XXH3_64bits_withSeed(cmd_list->IdxBuffer.Data, 
+            cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), hash);
+        // ImDrawCmd is zero-initialized, so padding doesn't affect the hash
+        hash = XXH3_64bits_withSeed(cmd_list->CmdBuffer.Data, 
+            cmd_list->CmdBuffer.Size * sizeof(ImDrawCmd), hash);
     }
 
-    if (!fr.IndexBuffer.IsInitialized() || fr.NumIndices < draw_data->TotalIdxCount)
+    if (hash == m_drawDataHash && m_geometry.IsInitialized())
+        return true;
+
+    m_drawDataHash = hash;
+    m_vtxBufferSize = draw_data->TotalVtxCount * sizeof(ImDrawVert);
+    m_idxBufferSize = draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+    const uint32_t sizeInBytes = m_vtxBufferSize + m_idxBufferSize;
+
+    if (sizeInBytes > m_geometryCapacity)
     {
-        //SafeRelease(fr->IndexBuffer);
-        fr.NumIndices = draw_data->TotalIdxCount + 10000;
-        fr.IndexBuffer = GpuMemory::GetUploadHeapBuffer(fr.NumIndices * sizeof(ImDrawIdx));
+        // Previous buffer might still be in use by the frames in flight -- its release is 
+        // deferred
+        m_geometryCapacity = Math::Max(sizeInBytes, m_geometryCapacity * 2);
+        m_geometry = GpuMemory::GetDefaultHeapBuffer("ImGuiGeometry", m_geometryCapacity,
+            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER, 
+            false);
     }
 
-    // Upload index data into a single contiguous GPU buffer
-    offset = 0;
+    auto staging = GpuMemory::AllocateFrameUpload(sizeInBytes, alignof(ImDrawVert));
+
+    // Upload vertex and index data into single contiguous GPU buffers
+    uint8_t* vtxDst = reinterpret_cast<uint8_t*>(staging.MappedMemory);
+    uint8_t* idxDst = vtxDst + m_vtxBufferSize;
 
     for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
-        fr.IndexBuffer.Copy(offset, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), 
-            cmd_list->IdxBuffer.Data);
-        offset += cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+        const size_t vtxSize = cmd_list->VtxBuffer.Size * sizeof(ImDrawVert);
+        const size_t idxSize = cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx);
+
+        memcpy(vtxDst, cmd_list->VtxBuffer.Data, vtxSize);
+        memcpy(idxDst, cmd_list->IdxBuffer.Data, idxSize);
+        vtxDst += vtxSize;
+        idxDst += idxSize;
+    }
+
+    cmdList.DeferBarrier(m_geometry.Resource(),
+        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER,
+        D3D12_RESOURCE_STATE_COPY_DEST);
+    cmdList.CopyBufferRegion(m_geometry.Resource(), 0, staging.Res, staging.Offset, sizeInBytes);
+    // Submitted along with the first draw
+    cmdList.DeferBarrier(m_geometry.Resource(),
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER | D3D12_RESOURCE_STATE_INDEX_BUFFER);
+
+    // Render command lists
+    // (Because we merged all buffers into a single one, we maintain our own offset into them)
+    m_drawCmds.clear();
+    int global_vtx_offset = 0;
+    int global_idx_offset = 0;
+    ImVec2 clip_off = draw_data->DisplayPos;
+
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+        const ImDrawList* cmd_list = draw_data->CmdLists[n];
+        for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+        {
+            const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+
+            // Project scissor/clipping rectangles into framebuffer space
+            ImVec2 clip_min(pcmd->ClipRect.x - clip_off.x, pcmd->ClipRect.y - clip_off.y);
+            ImVec2 clip_max(pcmd->ClipRect.z - clip_off.x, pcmd->ClipRect.w - clip_off.y);
+            if (clip_max.x <= clip_min.x || clip_max.y <= clip_min.y)
+                continue;
+
+            m_drawCmds.push_back(DrawCmd{
+                .Scissor = { (LONG)clip_min.x, (LONG)clip_min.y, (LONG)clip_max.x, (LONG)clip_max.y },
+                .IndexCount = pcmd->ElemCount,
+                .StartIndex = pcmd->IdxOffset + global_idx_offset,
+                .BaseVertex = (int)pcmd->VtxOffset + global_vtx_offset });
+        }
+
+        global_idx_offset += cmd_list->IdxBuffer.Size;
+        global_vtx_offset += cmd_list->VtxBuffer.Size;
     }
+
+    return true;
 }
 
 void GuiPass::Render(CommandList& cmdList)
@@ -414,13 +466,18 @@ void GuiPass::Render(CommandList& cmdList)
     RenderUI();
 
     ImGui::Render();
-    UpdateBuffers();
 
-    const int currBackBuffIdx = renderer.GetCurrentBackBufferIndex();
+    if (!UpdateBuffers(directCmdList))
+    {
+        gpuTimer.EndQuery(directCmdList, queryIdx);
+        TransitionBackBuffersToPresent(directCmdList);
+        directCmdList.PIXEndEvent();
+
+        return;
+    }
 
     // Rendering
     ImDrawData* draw_data = ImGui::GetDrawData();
-    auto& fr = m_imguiFrameBuffs[currBackBuffIdx];
 
     // Setup desired DX state
     // Setup orthographic projection matrix into our constant buffer
@@ -454,67 +511,64 @@ void GuiPass::Render(CommandList& cmdList)
 
     // Bind shader and vertex buffers
     unsigned int stride = sizeof(ImDrawVert);
-    unsigned int offset = 0;
     D3D12_VERTEX_BUFFER_VIEW vbv{};
-    vbv.BufferLocation = fr.VertexBuffer.GpuVA() + offset;
-    vbv.SizeInBytes = fr.NumVertices * stride;
+    vbv.BufferLocation = m_geometry.GpuVA();
+    vbv.SizeInBytes = m_vtxBufferSize;
     vbv.StrideInBytes = stride;
 
     D3D12_INDEX_BUFFER_VIEW ibv{};
-    ibv.BufferLocation = fr.IndexBuffer.GpuVA();
-    ibv.SizeInBytes = fr.NumIndices * sizeof(ImDrawIdx);
+    ibv.BufferLocation = m_geometry.GpuVA() + m_vtxBufferSize;
+    ibv.SizeInBytes = m_idxBufferSize;
     ibv.Format = sizeof(ImDrawIdx) == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 
     directCmdList.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     directCmdList.IASetVertexAndIndexBuffers(vbv, ibv);
 
     Assert(m_cpuDescriptors[SHADER_IN_CPU_DESC::RTV].ptr > 0, "RTV hasn't been set.");
-    directCmdList.OMSetRenderTargets(1, &m_cpuDescriptors[SHADER_IN_CPU_DESC::RTV], true, nullptr);
 
     // Setup blend factor
     directCmdList.OMSetBlendFactor(0.0f, 0.0f, 0.0f, 0.0f);
 
-    // Render command lists
-    // (Because we merged all buffers into a single one, we maintain our own offset into them)
-    int global_vtx_offset = 0;
-    int global_idx_offset = 0;
-    ImVec2 clip_off = draw_data->DisplayPos;
+    // Same draw data for both current and interpolated frames
+    const int numRTVs = m_cpuDescriptors[SHADER_IN_CPU_DESC::INTERPOLATED_RTV].ptr > 0 ? 2 : 1;
 
-    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    for (int rtv = 0; rtv < numRTVs; rtv++)
     {
-        const ImDrawList* cmd_list = draw_data->CmdLists[n];
-        for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
-        {
-            const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
-
-            // Project scissor/clipping rectangles into framebuffer space
-            ImVec2 clip_min(pcmd->ClipRect.x - clip_off.x, pcmd->ClipRect.y - clip_off.y);
-            ImVec2 clip_max(pcmd->ClipRect.z - clip_off.x, pcmd->ClipRect.w - clip_off.y);
-            if (clip_max.x <= clip_min.x || clip_max.y <= clip_min.y)
-                continue;
+        directCmdList.OMSetRenderTargets(1, &m_cpuDescriptors[rtv], true, nullptr);
 
+        for (auto& cmd : m_drawCmds)
+        {
             // Apply Scissor/clipping rectangle, Bind texture, Draw
-            const D3D12_RECT r = { (LONG)clip_min.x, (LONG)clip_min.y, (LONG)clip_max.x, (LONG)clip_max.y };
-            directCmdList.RSSetScissorRects(1, &r);
-
-            directCmdList.DrawIndexedInstanced(pcmd->ElemCount, 1,
-                pcmd->IdxOffset + global_idx_offset,
-                pcmd->VtxOffset + global_vtx_offset,
-                0);
+            directCmdList.RSSetScissorRects(1, &cmd.Scissor);
+            directCmdList.DrawIndexedInstanced(cmd.IndexCount, 1, cmd.StartIndex, cmd.BaseVertex, 0);
         }
-
-        global_idx_offset += cmd_list->IdxBuffer.Size;
-        global_vtx_offset += cmd_list->VtxBuffer.Size;
     }
 
     gpuTimer.EndQuery(directCmdList, queryIdx);
+    TransitionBackBuffersToPresent(directCmdList);
+    directCmdList.PIXEndEvent();
+}
+
+void GuiPass::TransitionBackBuffersToPresent(GraphicsCmdList& cmdList)
+{
+    auto& renderer = App::GetRenderer();
+    D3D12_RESOURCE_BARRIER barriers[2];
+    int numBarriers = 0;
 
-    // HACK this is the last RenderPass, transition to PRESENT can be done here
-    directCmdList.ResourceBarrier(const_cast<Texture&>(renderer.GetCurrentBackBuffer()).Resource(),
+    barriers[numBarriers++] = Direct3DUtil::TransitionBarrier(
+        const_cast<Texture&>(renderer.GetCurrentBackBuffer()).Resource(),
         D3D12_RESOURCE_STATE_RENDER_TARGET,
         D3D12_RESOURCE_STATE_PRESENT);
 
-    directCmdList.PIXEndEvent();
+    if (m_cpuDescriptors[SHADER_IN_CPU_DESC::INTERPOLATED_RTV].ptr > 0)
+    {
+        barriers[numBarriers++] = Direct3DUtil::TransitionBarrier(
+            const_cast<Texture&>(renderer.GetInterpolatedBackBuffer()).Resource(),
+            D3D12_RESOURCE_STATE_RENDER_TARGET,
+            D3D12_RESOURCE_STATE_PRESENT);
+    }
+
+    cmdList.ResourceBarrier(barriers, numBarriers);
 }
 
 void GuiPass::RenderUI()
@@ -530,15 +584,16 @@ void GuiPass::RenderUI()
         float4x4a W;
         uint64_t firstPicked = Scene::INVALID_INSTANCE;
 
-        if (auto picks = scene.GetPickedInstances(); !picks.m_span.empty())
+        if (auto pickView = scene.GetPickedInstances(); !pickView.View().empty())
         {
-            firstPicked = picks.m_span[0];
+            Span<uint64_t> picks = pickView.View();
+            firstPicked = picks[0];
 
             W = float4x4a(scene.GetToWorld(firstPicked));
             instanceMesh = *scene.GetInstanceMesh(firstPicked).value();
 
             if (m_gizmoActive)
-                RenderGizmo(picks.m_span, instanceMesh, W);
+                RenderGizmo(picks, instanceMesh, W);
         }
 
         RenderSettings(firstPicked, instanceMesh, W);
@@ -562,7 +617,7 @@ void GuiPass::RenderToolbar()
     ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(1, 1));
 
     ImGui::SetNextWindowPos(ImVec2((float)5.0f, m_headerWndHeight + 10.0f), ImGuiCond_Always);
-    ImGui::SetNextWindowSize(ImVec2(60.0f, 250.0f), ImGuiCond_Always);
+    ImGui::SetNextWindowSize(ImVec2(60.0f, 295.0f), ImGuiCond_Always);
 
     ImGui::Begin("Toolbar", nullptr, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoTitleBar |
         ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoBackground);
@@ -659,6 +714,10 @@ void GuiPass::RenderToolbar()
         App::GetScene().CaptureScreen();
     ImGui::SetItemTooltip("Take Screenshot");
 
+    if (ImGui::Button(ICON_FA_CHART_GANTT "##6", ImVec2(40.0f, 40.0f)))
+        App::ExportTaskTimeline();
+    ImGui::SetItemTooltip("Export CPU/GPU Timeline of Last Few Frames (T)");
+
     ImGui::PopStyleColor(3);
     ImGui::PopStyleVar(2);
 
@@ -793,7 +852,7 @@ void GuiPass::RenderProfiler()
                 }
             };
 
-        for (auto s : App::GetStats().m_span)
+        for (auto s : App::GetStats())
             func(s);
 
         ImGui::SeparatorText("Scene");
@@ -837,6 +896,9 @@ void GuiPass::RenderProfiler()
 
         GpuTimingsTab();
     }
+
+    if (ImGui::CollapsingHeader(ICON_FA_MEMORY "  GPU Memory", ImGuiTreeNodeFlags_None))
+        GpuMemoryTab();
 }
 
 void GuiPass::RenderLogWindow()
@@ -857,7 +919,9 @@ void GuiPass::RenderLogWindow()
 
     m_logWndHeightPct = ImGui::GetWindowHeight() / (float)displayHeight;
 
-    auto& frameLogs = App::GetLogs().View();
+    // Keep the view (and the lock) alive while the logs are being drawn
+    auto logView = App::GetLogs();
+    auto& frameLogs = logView.View();
     ImGui::Text("#Items: %d\t", (int)frameLogs.size());
     ImGui::SameLine();
 
@@ -966,7 +1030,8 @@ void GuiPass::RenderMainHeader()
     // Open the logs tabs whene there are new warnings
     if(!m_logsTabOpen)
     {
-        auto& logs = App::GetLogs().View();
+        auto logView = App::GetLogs();
+        auto& logs = logView.View();
         const int numLogs = (int)logs.size();
 
         if (numLogs != m_prevNumLogs)
@@ -1115,47 +1180,40 @@ void GuiPass::CameraTab()
     {
         auto params = App::GetParams();
 
-        // Partition by "Scene"
-        auto firstNonScene = std::partition(params.m_span.begin(), params.m_span.end(), 
-            [](const ParamVariant& p)
-            {
-                return strcmp(p.GetGroup(), ICON_FA_LANDMARK " Scene") == 0;
-            });
-        // Partition by "Camera"
-        auto firstNonCamera = std::partition(params.m_span.begin(), firstNonScene, 
-            [](const ParamVariant& p)
+        // Params are sorted by group, subgroup, subsubgroup and name, so camera params are
+        // one contiguous range that's already sorted by subsubgroup
+        auto isCameraParam = [](const ParamVariant& p)
             {
-                return strcmp(p.GetSubGroup(), "Camera") == 0;
-            });
-        const int numCameraParams = (int)(firstNonCamera - params.m_span.data());
+                return strcmp(p.GetGroup(), ICON_FA_LANDMARK " Scene") == 0 &&
+                    strcmp(p.GetSubGroup(), "Camera") == 0;
+            };
+        auto firstCamera = std::find_if(params.m_span.begin(), params.m_span.end(), isCameraParam);
+        auto firstNonCamera = std::find_if_not(firstCamera, params.m_span.end(), isCameraParam);
+        const int numCameraParams = (int)(firstNonCamera - firstCamera);
         if (numCameraParams == 0)
             return;
 
-        std::sort(params.m_span.begin(), firstNonCamera,
-            [](const ParamVariant& p1, const ParamVariant& p2)
-            {
-                return strcmp(p1.GetSubSubGroup(), p2.GetSubSubGroup()) < 0;
-            });
+        MutableSpan<ParamVariant> cameraParams(firstCamera, numCameraParams);
 
         char curr[ParamVariant::MAX_SUBSUBGROUP_LEN];
-        size_t len = strlen(params.m_span[0].GetSubSubGroup());
-        memcpy(curr, params.m_span[0].GetSubSubGroup(), len);
+        size_t len = strlen(cameraParams[0].GetSubSubGroup());
+        memcpy(curr, cameraParams[0].GetSubSubGroup(), len);
         curr[len] = '\0';
         int beg = 0;
         int i = 0;
 
         for (i = 0; i < numCameraParams; i++)
         {
-            if (strcmp(params.m_span[i].GetSubSubGroup(), curr) != 0)
+            if (strcmp(cameraParams[i].GetSubSubGroup(), curr) != 0)
             {
                 if (ImGui::TreeNodeEx(curr))
                 {
-                    AddParamRange(params.m_span, beg, (int)(i - beg));
+                    AddParamRange(cameraParams, beg, (int)(i - beg));
                     ImGui::TreePop();
                 }
 
-                len = strlen(params.m_span[i].GetSubSubGroup());
-                memcpy(curr, params.m_span[i].GetSubSubGroup(), len);
+                len = strlen(cameraParams[i].GetSubSubGroup());
+                memcpy(curr, cameraParams[i].GetSubSubGroup(), len);
                 curr[len] = '\0';
                 beg = i;
             }
@@ -1163,7 +1221,7 @@ void GuiPass::CameraTab()
 
         if (ImGui::TreeNodeEx(curr))
         {
-            AddParamRange(params.m_span, beg, i - beg);
+            AddParamRange(cameraParams, beg, i - beg);
             ImGui::TreePop();
         }
     }
@@ -1176,13 +1234,7 @@ void GuiPass::ParameterTab()
 
     ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x * 0.55f);
 
-    // Sort by group
-    std::sort(params.m_span.begin(), params.m_span.end(), 
-        [](const ParamVariant& p1, const ParamVariant& p2)
-        {
-            return strcmp(p1.GetGroup(), p2.GetGroup()) < 0;
-        });
-
+    // Params are already sorted by group, subgroup, subsubgroup and name (see App::GetParams())
     for (int currGroupIdx = 0; currGroupIdx < (int)params.m_span.size();)
     {
         ParamVariant& currParam_g = params.m_span[currGroupIdx];
@@ -1200,13 +1252,6 @@ void GuiPass::ParameterTab()
         {
             char currSubGroup[ParamVariant::MAX_SUBGROUP_LEN];
 
-            // Sort by subgroup among current group
-            std::sort(params.m_span.begin() + currGroupIdx, params.m_span.begin() + nextGroupIdx,
-                [](const ParamVariant& p1, const ParamVariant& p2)
-                {
-                    return strcmp(p1.GetSubGroup(), p2.GetSubGroup()) < 0;
-                });
-
             // Add the parameters in this subgroup
             for (int currSubgroupIdx = currGroupIdx; currSubgroupIdx < nextGroupIdx;)
             {
@@ -1243,13 +1288,6 @@ void GuiPass::ParameterTab()
                         }
                     }
 
-                    // Sort by subsubgroup among current subgroup
-                    std::sort(params.m_span.begin() + currSubgroupIdx, params.m_span.begin() + nextSubgroupIdx,
-                        [](const ParamVariant& p1, const ParamVariant& p2)
-                        {
-                            return strcmp(p1.GetSubSubGroup(), p2.GetSubSubGroup()) < 0;
-                        });
-
                     if (hasSubsubgroups)
                     {
                         for (int currSubsubgroupIdx = currSubgroupIdx; currSubsubgroupIdx < nextSubgroupIdx;)
@@ -1366,6 +1404,97 @@ void GuiPass::GpuTimingsTab()
     }
 }
 
+void GuiPass::GpuMemoryTab()
+{
+    constexpr float MB = 1024.0f * 1024.0f;
+    const auto memInfo = GpuMemory::GetVideoMemoryInfo();
+
+    ImGui::Text("VRAM: %.1f / %.1f MB", memInfo.CurrentUsage / MB, memInfo.Budget / MB);
+    ImGui::SameLine();
+    if (ImGui::Button(ICON_FA_FLOPPY_DISK "  Dump to File"))
+        GpuMemory::WriteMemoryReport("GpuMemory.txt");
+
+    for (int i = 0; i < (int)MEMORY_CATEGORY::COUNT; i++)
+    {
+        ImGui::Text("\t%s: %.1f MB", GpuMemory::GetMemoryCategoryName((MEMORY_CATEGORY)i),
+            memInfo.CategoryUsage[i] / MB);
+    }
+
+    SmallVector<ResourceInfo> resources;
+    SmallVector<OwnerInfo> owners;
+    GpuMemory::GetResourceInfos(resources);
+    GpuMemory::GetOwnerInfos(resources, owners);
+
+    ImGui::SeparatorText("Owners");
+
+    constexpr ImGuiTableFlags flags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg | 
+        ImGuiTableFlags_PadOuterX | ImGuiTableFlags_Borders | ImGuiTableFlags_Resizable | 
+        ImGuiTableFlags_SizingStretchProp;
+
+    const float TEXT_BASE_HEIGHT = ImGui::GetTextLineHeightWithSpacing();
+    ImVec2 outer_size = ImVec2(0, TEXT_BASE_HEIGHT * 16);
+    if (ImGui::BeginTable("gpu_memory", 2, flags, outer_size))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+
+        ImGui::TableSetupColumn("\t\tName", ImGuiTableColumnFlags_None);
+        ImGui::TableSetupColumn("\t\tSize (MB)", ImGuiTableColumnFlags_None);
+        ImGui::TableHeadersRow();
+
+        for (auto& owner : owners)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            const bool open = ImGui::TreeNodeEx(owner.Name, ImGuiTreeNodeFlags_SpanFullWidth, 
+                "%s (%u)", owner.Name, owner.NumResources);
+
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("\t\t\t%.2f", owner.SizeInBytes / MB);
+
+            if (!open)
+                continue;
+
+            for (auto& r : resources)
+            {
+                if (strcmp(r.Owner, owner.Name) != 0)
+                    continue;
+
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("\t%s%s", r.Name, r.Kind == RESOURCE_KIND::PLACED ? " (placed)" : "");
+
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("\t\t\t%.2f", r.SizeInBytes / MB);
+            }
+
+            ImGui::TreePop();
+        }
+
+        ImGui::EndTable();
+    }
+
+    SmallVector<AllocatorInfo> allocators;
+    GpuMemory::GetAllocatorInfos(allocators);
+
+    ImGui::SeparatorText("Allocators");
+
+    for (auto& a : allocators)
+    {
+        const uint32_t used = a.Size - a.Free;
+        ImGui::Text("\t%s: %u / %u %s", a.Name, used, a.Size, a.Unit);
+
+        // Fraction of free space that can't be used for the largest possible allocation
+        if (a.LargestFreeRegion && a.Free)
+        {
+            ImGui::SameLine();
+            ImGui::Text("(fragmentation: %.1f%%)", 
+                100.0f * (1.0f - (float)a.LargestFreeRegion / a.Free));
+        }
+    }
+
+    ImGui::Text("");
+}
+
 void GuiPass::ShaderReloadTab()
 {
     auto handlers = App::GetShaderReloadHandlers();
@@ -9,6 +9,7 @@
 namespace ZetaRay::Core
 {
     class CommandList;
+    class GraphicsCmdList;
 }
 
 namespace ZetaRay::Model
@@ -23,6 +24,8 @@ namespace ZetaRay::RenderPass
         enum SHADER_IN_CPU_DESC
         {
             RTV,
+            // Optional, UI is drawn on the interpolated frame as well when set
+            INTERPOLATED_RTV,
             COUNT
         };
 
@@ -48,8 +51,12 @@ namespace ZetaRay::RenderPass
         inline static constexpr const char* COMPILED_VS[] = { "ImGui_vs.cso" };
         inline static constexpr const char* COMPILED_PS[] = { "ImGui_ps.cso" };
 
-        void UpdateBuffers();
+        // Returns false when there's nothing to draw. Geometry and draw commands are only 
+        // re-uploaded and rebuilt when the draw data has changed since the last frame.
+        bool UpdateBuffers(Core::GraphicsCmdList& cmdList);
         void RenderUI();
+        // HACK this is the last RenderPass, transition to PRESENT can be done here
+        void TransitionBackBuffersToPresent(Core::GraphicsCmdList& cmdList);
         void RenderSettings(uint64 pickedID, const Model::TriangleMesh& mesh, 
             const Math::float4x4a& W);
         void RenderProfiler();
@@ -62,19 +69,12 @@ namespace ZetaRay::RenderPass
         void CameraTab();
         void ParameterTab();
         void GpuTimingsTab();
+        void GpuMemoryTab();
         void ShaderReloadTab();
         void PickedMaterial(uint64 pickedID);
         void PickedWorldTransform(uint64 pickedID, const Model::TriangleMesh& mesh, 
             const Math::float4x4a& W);
 
-        struct ImGuiFrameBufferData
-        {
-            Core::GpuMemory::UploadHeapBuffer IndexBuffer;
-            Core::GpuMemory::UploadHeapBuffer VertexBuffer;
-            int NumIndices = 10000;
-            int NumVertices = 5000;
-        };
-
         struct alignas(32) RenderPassTiming
         {
             RenderPassTiming()
@@ -89,7 +89,22 @@ namespace ZetaRay::RenderPass
         };
 
         Util::SmallVector<RenderPassTiming, Support::SystemAllocator, 32> m_gpuTimings;
-        ImGuiFrameBufferData m_imguiFrameBuffs[Core::Constants::NUM_BACK_BUFFERS];
+        struct DrawCmd
+        {
+            D3D12_RECT Scissor;
+            uint32_t IndexCount;
+            uint32_t StartIndex;
+            int BaseVertex;
+        };
+
+        // Vertices followed by indices. Staged through the frame upload ring whenever the 
+        // draw data changes and grown geometrically.
+        Core::GpuMemory::Buffer m_geometry;
+        uint32_t m_geometryCapacity = 0;
+        uint32_t m_vtxBufferSize = 0;
+        uint32_t m_idxBufferSize = 0;
+        uint64_t m_drawDataHash = 0;
+        Util::SmallVector<DrawCmd, Support::SystemAllocator, 64> m_drawCmds;
         D3D12_CPU_DESCRIPTOR_HANDLE m_cpuDescriptors[SHADER_IN_CPU_DESC::COUNT] = { 0 };
 
         int m_currShader = -1;
@@ -3,6 +3,7 @@
 #include <Core/SharedShaderResources.h>
 #include <Support/Param.h>
 #include <Scene/SceneCore.h>
+#include <Scene/Camera.h>
 #include <Support/Task.h>
 #include "../Assets/Font/IconsFontAwesome6.h"
 
@@ -94,9 +95,21 @@ IndirectLighting::IndirectLighting()
         D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
         nullptr,
         true);
+
+    // light BVH
+    m_rootSig.InitAsBufferSRV(11, 9, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        GlobalResource::LIGHT_BVH,
+        true);
+
+    // light BVH triangle to leaf map
+    m_rootSig.InitAsBufferSRV(12, 10, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        GlobalResource::LIGHT_BVH_TRI_TO_LEAF,
+        true);
 }
 
-void IndirectLighting::InitPSOs()
+void IndirectLighting::InitPSOs(INTEGRATOR method)
 {
     constexpr D3D12_ROOT_SIGNATURE_FLAGS flags =
         D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED |
@@ -112,42 +125,49 @@ void IndirectLighting::InitPSOs()
     auto samplers = App::GetRenderer().GetStaticSamplers();
     RenderPassBase::InitRenderPass("IndirectLighting", flags, samplers);
 
-    constexpr int NumTaskSets = CeilUnsignedIntDiv((int)SHADER::COUNT,
-        TaskSet::MAX_NUM_TASKS);
-    TaskSet ts[NumTaskSets];
-    int i = 0;
-
-    for (int t = 0; t < NumTaskSets; t++)
+    // Permutations are created on first use. Only the current integrator's shaders are 
+    // needed for the first frame, the rest are built in the background.
+    for (int i = 0; i < NUM_NON_PERMUTED; i++)
     {
-        for (; i < Min(TaskSet::MAX_NUM_TASKS * (t + 1), (int)SHADER::COUNT); i++)
-        {
-            StackStr(buff, n, "IndirectShader_%d", i);
-
-            ts[t].EmplaceTask(buff, [i, this]()
-                {
-                    m_psoLib.CompileComputePSO_MT(i, m_rootSigObj.Get(),
-                        COMPILED_CS[i]);
-                });
-        }
-
-        ts[t].Sort();
-        ts[t].Finalize();
-        App::Submit(ZetaMove(ts[t]));
+        const INTEGRATOR integrator = i <= (int)SHADER::PATH_TRACER_WORK_LIST ? INTEGRATOR::PATH_TRACING :
+            i <= (int)SHADER::ReSTIR_GI_UPSAMPLE ? INTEGRATOR::ReSTIR_GI : 
+            i < (int)SHADER::PROBE_VOLUME_UPDATE ? INTEGRATOR::ReSTIR_PT :
+            INTEGRATOR::PROBE_VOLUME;
+
+        // Only needed when the radiance cache is enabled
+        if (integrator == method && i != (int)SHADER::RADIANCE_CACHE_RESOLVE)
+            m_psoLib.EnqueueComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
+        else
+            m_psoLib.DeferComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
     }
 }
 
 void IndirectLighting::Init(INTEGRATOR method)
 {
-    InitPSOs();
+    InitPSOs(method);
+
+    auto& shared = App::GetRenderer().GetSharedShaderResources();
+    m_bvhCurr = shared.GetDefaultHeapBufferHandle(GlobalResource::RT_SCENE_BVH_CURR);
+    m_bvhPrev = shared.GetDefaultHeapBufferHandle(GlobalResource::RT_SCENE_BVH_PREV);
+    m_meshInstancesCurr = shared.GetDefaultHeapBufferHandle(GlobalResource::RT_FRAME_MESH_INSTANCES_CURR);
+    m_meshInstancesPrev = shared.GetDefaultHeapBufferHandle(GlobalResource::RT_FRAME_MESH_INSTANCES_PREV);
+    m_lvg = shared.GetDefaultHeapBufferHandle(GlobalResource::LIGHT_VOXEL_GRID);
 
     memset(&m_cbRGI, 0, sizeof(m_cbRGI));
     memset(&m_cbRPT_PathTrace, 0, sizeof(m_cbRPT_PathTrace));
     memset(&m_cbRPT_Reuse, 0, sizeof(m_cbRPT_Reuse));
     m_cbRGI.M_max = DefaultParamVals::M_MAX;
+    m_cbRGI.ResamplingInterval = 1;
+    m_cbRGI.ValidationInterval = DefaultParamVals::VALIDATION_INTERVAL;
     m_cbRPT_PathTrace.Alpha_min = m_cbRPT_Reuse.Alpha_min =
         DefaultParamVals::ROUGHNESS_MIN * DefaultParamVals::ROUGHNESS_MIN;
     m_cbRGI.MaxNonTrBounces = DefaultParamVals::MAX_NON_TR_BOUNCES;
     m_cbRGI.MaxGlossyTrBounces = DefaultParamVals::MAX_GLOSSY_TR_BOUNCES;
+    m_cbRGI.TargetRelError = DefaultParamVals::TARGET_REL_ERROR;
+    m_cbRGI.RadianceCacheCellSize = DefaultParamVals::RADIANCE_CACHE_CELL_SIZE;
+    m_cbRGI.RadianceCacheSpread = DefaultParamVals::RADIANCE_CACHE_SPREAD;
+    m_cbRGI.ProbeSpacing = DefaultParamVals::PROBE_SPACING;
+    m_cbRGI.ProbeHysteresis = DefaultParamVals::PROBE_HYSTERESIS;
     m_cbRPT_PathTrace.TexFilterDescHeapIdx = EnumToSamplerIdx(DefaultParamVals::TEX_FILTER);
     m_cbRPT_PathTrace.Packed = m_cbRPT_Reuse.Packed = DefaultParamVals::MAX_NON_TR_BOUNCES |
         (DefaultParamVals::MAX_GLOSSY_TR_BOUNCES << PACKED_INDEX::NUM_GLOSSY_BOUNCES) |
@@ -157,6 +177,7 @@ void IndirectLighting::Init(INTEGRATOR method)
     m_cbRGI.TexFilterDescHeapIdx = m_cbRPT_PathTrace.TexFilterDescHeapIdx;
 
     SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::RUSSIAN_ROULETTE, DefaultParamVals::RUSSIAN_ROULETTE);
+    SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::REORDER_THREADS, DefaultParamVals::REORDER_THREADS);
     SET_CB_FLAG(m_cbRPT_PathTrace, CB_IND_FLAGS::RUSSIAN_ROULETTE, DefaultParamVals::RUSSIAN_ROULETTE);
     SET_CB_FLAG(m_cbRPT_Reuse, CB_IND_FLAGS::RUSSIAN_ROULETTE, DefaultParamVals::RUSSIAN_ROULETTE);
     SET_CB_FLAG(m_cbRPT_PathTrace, CB_IND_FLAGS::SORT_TEMPORAL, true);
@@ -194,6 +215,13 @@ void IndirectLighting::Init(INTEGRATOR method)
         Params::TextureFilter, ZetaArrayLen(Params::TextureFilter), (uint32)DefaultParamVals::TEX_FILTER);
     App::AddParam(texFilter);
 
+    // Path tracing and ReSTIR GI only
+    ParamVariant reorder;
+    reorder.InitBool(ICON_FA_FILM " Renderer", "Indirect Lighting", "Reorder Threads",
+        fastdelegate::MakeDelegate(this, &IndirectLighting::ReorderThreadsCallback),
+        DefaultParamVals::REORDER_THREADS, "Path Sampling");
+    App::AddParam(reorder);
+
     m_method = method;
     m_doTemporalResampling = method == INTEGRATOR::PATH_TRACING ? false : m_doTemporalResampling;
 
@@ -207,16 +235,36 @@ void IndirectLighting::OnWindowResized()
     ResetIntegrator(true, true);
     m_isTemporalReservoirValid = false;
     m_currTemporalIdx = 0;
+    m_framesSinceReset = 0;
 }
 
 void IndirectLighting::ResetTemporal()
 {
     m_isTemporalReservoirValid = false;
     m_currTemporalIdx = 0;
+    m_framesSinceReset = 0;
     SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES, true);
     SET_CB_FLAG(m_cbRPT_PathTrace, CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES, true);
 }
 
+void IndirectLighting::SetAdaptiveSampling(bool enabled, float targetRelError)
+{
+    m_cbRGI.TargetRelError = targetRelError;
+
+    if (enabled == m_adaptiveSampling)
+        return;
+
+    m_adaptiveSampling = enabled;
+
+    if (m_method == INTEGRATOR::PATH_TRACING)
+    {
+        if (m_adaptiveSampling)
+            CreateAdaptiveSamplingResources();
+        else
+            ReleaseAdaptiveSamplingResources();
+    }
+}
+
 void IndirectLighting::SetMethod(INTEGRATOR method)
 {
     const auto old = m_method;
@@ -229,6 +277,10 @@ void IndirectLighting::SetMethod(INTEGRATOR method)
             ReleaseReSTIR_GI();
         else if (old == INTEGRATOR::ReSTIR_PT)
             ReleaseReSTIR_PT();
+        else if (old == INTEGRATOR::PATH_TRACING)
+            ReleasePathTracer();
+        else if (old == INTEGRATOR::PROBE_VOLUME)
+            ReleaseProbeVolume();
 
         ResetIntegrator(false, false);
     }
@@ -236,6 +288,10 @@ void IndirectLighting::SetMethod(INTEGRATOR method)
 
 void IndirectLighting::RenderPathTracer(Core::ComputeCmdList& computeCmdList)
 {
+    static_assert(RESTIR_GI_TEMPORAL_GROUP_DIM_X == TILE_CLASS_TILE_DIM &&
+        RESTIR_GI_TEMPORAL_GROUP_DIM_Y == TILE_CLASS_TILE_DIM, 
+        "Thread group dimensions don't match the tiles.");
+
     auto& renderer = App::GetRenderer();
     auto& gpuTimer = renderer.GetGpuTimer();
     const uint32_t w = renderer.GetRenderWidth();
@@ -250,28 +306,78 @@ void IndirectLighting::RenderPathTracer(Core::ComputeCmdList& computeCmdList)
 
     Assert(!m_preSampling || m_cbRGI.SampleSetSize_NumSampleSets, "Presampled set params haven't been set.");
 
-    const auto& bvh = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-        GlobalResource::RT_SCENE_BVH_CURR);
-    const auto& meshInstances = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-        GlobalResource::RT_FRAME_MESH_INSTANCES_CURR);
+    const auto* bvh = m_bvhCurr.Get();
+    const auto* meshInstances = m_meshInstancesCurr.Get();
 
     m_rootSig.SetRootSRV(2, bvh->GpuVA());
     m_rootSig.SetRootSRV(3, meshInstances->GpuVA());
 
     m_cbRGI.FinalDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RGI::FINAL_UAV);
-    m_rootSig.SetRootConstants(0, sizeof(m_cbRGI) / sizeof(DWORD), &m_cbRGI);
+    SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::ADAPTIVE_SAMPLING, m_adaptiveSampling);
+    SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::TILE_LIST, !m_adaptiveSampling);
+    m_cbRGI.TileListDescHeapIdx = m_tileClassification.TileListDescHeapIdx();
+    BeginRadianceCache(computeCmdList);
+
+    // List the pixels that haven't converged yet
+    if (m_adaptiveSampling)
+    {
+        // Previous frame's path tracing might still be reading the work list
+        auto toCopyDest = BufferBarrier(m_ptWorkList.Resource(),
+            D3D12_BARRIER_SYNC_EXECUTE_INDIRECT | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_SYNC_COPY,
+            D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT | D3D12_BARRIER_ACCESS_SHADER_RESOURCE,
+            D3D12_BARRIER_ACCESS_COPY_DEST);
+        computeCmdList.ResourceBarrier(toCopyDest);
+
+        computeCmdList.CopyBufferRegion(m_ptWorkList.Resource(), 0, m_ptWorkListInit.Resource(), 0,
+            PATH_TRACER_WORK_LIST_HEADER_SIZE * sizeof(uint32_t));
+
+        auto toUav = BufferBarrier(m_ptWorkList.Resource(),
+            D3D12_BARRIER_SYNC_COPY,
+            D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_ACCESS_COPY_DEST,
+            D3D12_BARRIER_ACCESS_UNORDERED_ACCESS);
+        computeCmdList.ResourceBarrier(toUav);
+
+        m_cbRGI.WorkListDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RGI::PT_WORK_LIST_UAV);
+        m_rootSig.SetRootConstants(m_cbRGI);
+        m_rootSig.End(computeCmdList);
+
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::PATH_TRACER_WORK_LIST));
+        computeCmdList.Dispatch(CeilUnsignedIntDiv(w, RESTIR_GI_TEMPORAL_GROUP_DIM_X),
+            CeilUnsignedIntDiv(h, RESTIR_GI_TEMPORAL_GROUP_DIM_Y), 1);
+
+        auto toIndirectArgs = BufferBarrier(m_ptWorkList.Resource(),
+            D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_SYNC_EXECUTE_INDIRECT | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+            D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT | D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+        computeCmdList.ResourceBarrier(toIndirectArgs);
+
+        m_cbRGI.WorkListDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RGI::PT_WORK_LIST_SRV);
+    }
+
+    m_rootSig.SetRootConstants(m_cbRGI);
     m_rootSig.End(computeCmdList);
 
     auto sh = App::GetScene().EmissiveLighting() ? SHADER::PATH_TRACER_WoPS :
         SHADER::PATH_TRACER;
-    if (m_preSampling)
+    if (m_useLightBVH)
+        sh = SHADER::PATH_TRACER_LBVH;
+    else if (m_preSampling)
         sh = SHADER::PATH_TRACER_WPS;
 
     computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
-    computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+
+    if (m_adaptiveSampling)
+        computeCmdList.DispatchIndirect(m_ptWorkList.Resource());
+    else
+        m_tileClassification.DispatchTiles(computeCmdList, TILE_CATEGORY::SURFACE);
 
     gpuTimer.EndQuery(computeCmdList, queryIdx);
     computeCmdList.PIXEndEvent();
+
+    ResolveRadianceCache(computeCmdList);
 }
 
 void IndirectLighting::RenderReSTIR_GI(ComputeCmdList& computeCmdList)
@@ -309,11 +415,18 @@ void IndirectLighting::RenderReSTIR_GI(ComputeCmdList& computeCmdList)
 
         computeCmdList.ResourceBarrier(textureBarriers.data(), (UINT)textureBarriers.size());
 
-        const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, RESTIR_GI_TEMPORAL_GROUP_DIM_X);
-        const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, RESTIR_GI_TEMPORAL_GROUP_DIM_Y);
+        // One thread per traced pixel
+        const uint32_t tracedW = m_rgiResolution == RESTIR_GI_RESOLUTION::FULL ? w : CeilUnsignedIntDiv(w, 2u);
+        const uint32_t tracedH = m_rgiResolution == RESTIR_GI_RESOLUTION::HALF ? CeilUnsignedIntDiv(h, 2u) : h;
+        const uint32_t dispatchDimX = CeilUnsignedIntDiv(tracedW, RESTIR_GI_TEMPORAL_GROUP_DIM_X);
+        const uint32_t dispatchDimY = CeilUnsignedIntDiv(tracedH, RESTIR_GI_TEMPORAL_GROUP_DIM_Y);
         m_cbRGI.DispatchDimX_NumGroupsInTile = ((RESTIR_GI_TEMPORAL_TILE_WIDTH * dispatchDimY) << 16) | dispatchDimX;
 
         SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::TEMPORAL_RESAMPLE, m_doTemporalResampling && m_isTemporalReservoirValid);
+        // Moving geometry or lights may change visibility anywhere
+        const auto& scene = App::GetScene();
+        SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::REVALIDATE_ALL, scene.AreInstancesUpdated() || 
+            scene.AreEmissivePositionsUpdated());
         //SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::SPATIAL_RESAMPLE, m_doSpatialResampling && m_isTemporalReservoirValid);
         Assert(!m_preSampling || m_cbRGI.SampleSetSize_NumSampleSets, "Presampled set params haven't been set.");
 
@@ -332,31 +445,31 @@ void IndirectLighting::RenderReSTIR_GI(ComputeCmdList& computeCmdList)
         m_cbRGI.CurrReservoir_C_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)uavCIdx);
 
         m_cbRGI.FinalDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RGI::FINAL_UAV);
+        m_cbRGI.Resolution = (uint32_t)m_rgiResolution;
+        m_cbRGI.SparseDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RGI::SPARSE_UAV);
 
-        const auto& bvh = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_SCENE_BVH_CURR);
-        const auto& meshInstances = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_FRAME_MESH_INSTANCES_CURR);
+        const auto* bvh = m_bvhCurr.Get();
+        const auto* meshInstances = m_meshInstancesCurr.Get();
 
         m_rootSig.SetRootSRV(2, bvh->GpuVA());
         m_rootSig.SetRootSRV(3, meshInstances->GpuVA());
 
         if (m_useLVG)
         {
-            SharedShaderResources& shared = App::GetRenderer().GetSharedShaderResources();
-            constexpr auto id = GlobalResource::LIGHT_VOXEL_GRID;
-            const auto idHash = XXH3_64bits(id, strlen(id));
-
-            auto* lvg = shared.GetDefaultHeapBuffer(idHash);
+            auto* lvg = m_lvg.Get();
             m_rootSig.SetRootSRV(8, lvg->GpuVA());
         }
 
-        m_rootSig.SetRootConstants(0, sizeof(m_cbRGI) / sizeof(DWORD), &m_cbRGI);
+        BeginRadianceCache(computeCmdList);
+
+        m_rootSig.SetRootConstants(m_cbRGI);
         m_rootSig.End(computeCmdList);
 
         auto sh = App::GetScene().EmissiveLighting() ? SHADER::ReSTIR_GI_WoPS :
             SHADER::ReSTIR_GI;
-        if (m_preSampling)
+        if (m_useLightBVH)
+            sh = SHADER::ReSTIR_GI_LBVH;
+        else if (m_preSampling)
             sh = m_useLVG ? SHADER::ReSTIR_GI_LVG : SHADER::ReSTIR_GI_WPS;
 
         computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
@@ -365,10 +478,163 @@ void IndirectLighting::RenderReSTIR_GI(ComputeCmdList& computeCmdList)
         gpuTimer.EndQuery(computeCmdList, queryIdx);
         computeCmdList.PIXEndEvent();
     }
+
+    // Fill in the pixels that weren't traced this frame
+    if (m_rgiResolution != RESTIR_GI_RESOLUTION::FULL)
+    {
+        computeCmdList.PIXBeginEvent("ReSTIR_GI_Upsample");
+        const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "ReSTIR_GI_Upsample");
+
+        auto barrier = UAVBarrier1(m_rgiSparse.Resource());
+        computeCmdList.ResourceBarrier(barrier);
+
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::ReSTIR_GI_UPSAMPLE));
+        computeCmdList.Dispatch(CeilUnsignedIntDiv(w, RESTIR_GI_TEMPORAL_GROUP_DIM_X),
+            CeilUnsignedIntDiv(h, RESTIR_GI_TEMPORAL_GROUP_DIM_Y), 1);
+
+        gpuTimer.EndQuery(computeCmdList, queryIdx);
+        computeCmdList.PIXEndEvent();
+    }
+
+    ResolveRadianceCache(computeCmdList);
+}
+
+void IndirectLighting::BeginRadianceCache(ComputeCmdList& computeCmdList)
+{
+    const bool enabled = m_radianceCache[(int)m_method];
+    SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::RADIANCE_CACHE, enabled);
+
+    if (!enabled)
+        return;
+
+    // Wait for the previous frame's resolve
+    ID3D12Resource* buffers[] = { m_rcKeys.Resource(), m_rcAccum.Resource(), m_rcResolved.Resource() };
+
+    for (auto* buffer : buffers)
+    {
+        computeCmdList.DeferBarrier(BufferBarrier(buffer,
+            D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+            D3D12_BARRIER_ACCESS_UNORDERED_ACCESS));
+    }
+}
+
+void IndirectLighting::ResolveRadianceCache(ComputeCmdList& computeCmdList)
+{
+    if (!m_radianceCache[(int)m_method])
+        return;
+
+    auto& gpuTimer = App::GetRenderer().GetGpuTimer();
+
+    computeCmdList.PIXBeginEvent("RadianceCache");
+    const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "RadianceCache");
+
+    ID3D12Resource* buffers[] = { m_rcKeys.Resource(), m_rcAccum.Resource(), m_rcResolved.Resource() };
+
+    for (auto* buffer : buffers)
+    {
+        computeCmdList.DeferBarrier(BufferBarrier(buffer,
+            D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+            D3D12_BARRIER_ACCESS_UNORDERED_ACCESS));
+    }
+
+    // Root constants from the path tracing pass are still bound
+    computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::RADIANCE_CACHE_RESOLVE));
+    computeCmdList.Dispatch(RADIANCE_CACHE_NUM_CELLS / RADIANCE_CACHE_RESOLVE_GROUP_DIM_X, 1, 1);
+
+    gpuTimer.EndQuery(computeCmdList, queryIdx);
+    computeCmdList.PIXEndEvent();
+}
+
+void IndirectLighting::RenderProbeVolume(ComputeCmdList& computeCmdList)
+{
+    auto& renderer = App::GetRenderer();
+    auto& gpuTimer = renderer.GetGpuTimer();
+    const uint32_t w = renderer.GetRenderWidth();
+    const uint32_t h = renderer.GetRenderHeight();
+
+    // Keep the camera at the center. Probes are addressed by their world-space grid
+    // coordinates, so as the volume scrolls, only the probes that entered it start over.
+    const float3 cameraPos = App::GetCamera().GetPos();
+    const float spacing = m_cbRGI.ProbeSpacing;
+    m_cbRGI.ProbeVolumeMin_x = (int32_t)floorf(cameraPos.x / spacing) - PROBE_VOLUME_DIM_X / 2;
+    m_cbRGI.ProbeVolumeMin_y = (int32_t)floorf(cameraPos.y / spacing) - PROBE_VOLUME_DIM_Y / 2;
+    m_cbRGI.ProbeVolumeMin_z = (int32_t)floorf(cameraPos.z / spacing) - PROBE_VOLUME_DIM_Z / 2;
+
+    const uint32_t numProbes = Min((uint32_t)m_probesPerFrame, (uint32_t)PROBE_VOLUME_NUM_PROBES);
+    m_cbRGI.FirstProbe_NumProbesToUpdate = (numProbes << 16) | m_firstProbe;
+    m_cbRGI.FinalDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RGI::FINAL_UAV);
+    // Probes are cleared rather than updated
+    const bool reset = IS_CB_FLAG_SET(m_cbRGI, CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES);
+
+    const auto* bvh = m_bvhCurr.Get();
+    const auto* meshInstances = m_meshInstancesCurr.Get();
+
+    m_rootSig.SetRootSRV(2, bvh->GpuVA());
+    m_rootSig.SetRootSRV(3, meshInstances->GpuVA());
+    m_rootSig.SetRootConstants(m_cbRGI);
+    m_rootSig.End(computeCmdList);
+
+    ID3D12Resource* probeTextures[] = { m_probeSH[0].Resource(), m_probeSH[1].Resource(),
+        m_probeSH[2].Resource(), m_probeMeta.Resource() };
+    D3D12_TEXTURE_BARRIER barriers[ZetaArrayLen(probeTextures)];
+
+    for (int i = 0; i < ZetaArrayLen(probeTextures); i++)
+    {
+        barriers[i] = TextureBarrier(probeTextures[i],
+            D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_LAYOUT_COMMON,
+            D3D12_BARRIER_LAYOUT_COMMON,
+            D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+            D3D12_BARRIER_ACCESS_UNORDERED_ACCESS);
+    }
+
+    // Update
+    {
+        computeCmdList.PIXBeginEvent("ProbeVolume_Update");
+        const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "ProbeVolume_Update");
+
+        // Previous frame's sample pass might still be reading the probes
+        computeCmdList.ResourceBarrier(barriers, ZetaArrayLen(barriers));
+
+        auto sh = App::GetScene().EmissiveLighting() ? SHADER::PROBE_VOLUME_UPDATE_WoPS :
+            SHADER::PROBE_VOLUME_UPDATE;
+        if (m_useLightBVH)
+            sh = SHADER::PROBE_VOLUME_UPDATE_LBVH;
+
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
+        // One group per updated probe, or one thread per probe when clearing
+        computeCmdList.Dispatch(reset ? PROBE_VOLUME_NUM_PROBES / PROBE_VOLUME_NUM_RAYS : numProbes, 1, 1);
+
+        gpuTimer.EndQuery(computeCmdList, queryIdx);
+        computeCmdList.PIXEndEvent();
+    }
+
+    // Sample
+    {
+        computeCmdList.PIXBeginEvent("ProbeVolume_Sample");
+        const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "ProbeVolume_Sample");
+
+        computeCmdList.ResourceBarrier(barriers, ZetaArrayLen(barriers));
+
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::PROBE_VOLUME_SAMPLE));
+        computeCmdList.Dispatch(CeilUnsignedIntDiv(w, PROBE_VOLUME_SAMPLE_GROUP_DIM_X),
+            CeilUnsignedIntDiv(h, PROBE_VOLUME_SAMPLE_GROUP_DIM_Y), 1);
+
+        gpuTimer.EndQuery(computeCmdList, queryIdx);
+        computeCmdList.PIXEndEvent();
+    }
+
+    if (!reset)
+        m_firstProbe = (m_firstProbe + numProbes) % PROBE_VOLUME_NUM_PROBES;
 }
 
 void IndirectLighting::ReSTIR_PT_Temporal(ComputeCmdList& computeCmdList,
-    Span<ID3D12Resource*> currReservoirs)
+    RootSignature& rootSig, cb_ReSTIR_PT_Reuse& cbReuse, Span<ID3D12Resource*> currReservoirs)
 {
     Assert(currReservoirs.size() == Reservoir_RPT::NUM, "Invalid #reservoirs.");
     auto& renderer = App::GetRenderer();
@@ -380,6 +646,12 @@ void IndirectLighting::ReSTIR_PT_Temporal(ComputeCmdList& computeCmdList,
     computeCmdList.PIXBeginEvent("ReSTIR_PT_Temporal");
     const uint32_t allQueryIdx = gpuTimer.BeginQuery(computeCmdList, "ReSTIR_PT_Temporal");
 
+    const bool indirect = m_gpuDrivenDispatch && IS_CB_FLAG_SET(cbReuse, CB_IND_FLAGS::SORT_TEMPORAL);
+    SET_CB_FLAG(cbReuse, CB_IND_FLAGS::INDIRECT_DISPATCH, indirect);
+
+    if (indirect)
+        ResetWorkLists(computeCmdList);
+
     // Sort - TtC
     {
 #ifndef NDEBUG
@@ -391,14 +663,17 @@ void IndirectLighting::ReSTIR_PT_Temporal(ComputeCmdList& computeCmdList,
         cb_ReSTIR_PT_Sort cb;
         cb.DispatchDimX = dispatchDimX;
         cb.DispatchDimY = dispatchDimY;
-        cb.Reservoir_A_DescHeapIdx = m_cbRPT_Reuse.PrevReservoir_A_DescHeapIdx;
+        cb.Reservoir_A_DescHeapIdx = cbReuse.PrevReservoir_A_DescHeapIdx;
         cb.MapDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RPT::THREAD_MAP_NtC_UAV);
-        cb.Flags = m_cbRPT_Reuse.Flags;
+        cb.WorkListDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RPT::WORK_LIST_UAV);
+        cb.NumWorkGroups = cbReuse.NumWorkGroups;
+        cb.Flags = cbReuse.Flags;
 
-        m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
-        m_rootSig.End(computeCmdList);
+        rootSig.SetRootConstants(cb);
+        rootSig.End(computeCmdList);
 
-        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::ReSTIR_PT_SORT_TtC));
+        computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_SORT, RPT_PERMUTATION::TtC, 
+            RPT_SORT_PERMUTATIONS));
         computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 #ifndef NDEBUG
         computeCmdList.PIXEndEvent();
@@ -426,14 +701,17 @@ void IndirectLighting::ReSTIR_PT_Temporal(ComputeCmdList& computeCmdList,
         cb_ReSTIR_PT_Sort cb;
         cb.DispatchDimX = dispatchDimX;
         cb.DispatchDimY = dispatchDimY;
-        cb.Reservoir_A_DescHeapIdx = m_cbRPT_PathTrace.Reservoir_A_DescHeapIdx;
+        cb.Reservoir_A_DescHeapIdx = cbReuse.Reservoir_A_DescHeapIdx;
         cb.MapDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RPT::THREAD_MAP_CtN_UAV);
-        cb.Flags = m_cbRPT_Reuse.Flags;
+        cb.WorkListDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RPT::WORK_LIST_UAV);
+        cb.NumWorkGroups = cbReuse.NumWorkGroups;
+        cb.Flags = cbReuse.Flags;
 
-        m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
-        m_rootSig.End(computeCmdList);
+        rootSig.SetRootConstants(cb);
+        rootSig.End(computeCmdList);
 
-        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::ReSTIR_PT_SORT_CtT));
+        computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_SORT, 0, 
+            RPT_SORT_PERMUTATIONS));
         computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 #ifndef NDEBUG
         computeCmdList.PIXEndEvent();
@@ -447,6 +725,9 @@ void IndirectLighting::ReSTIR_PT_Temporal(ComputeCmdList& computeCmdList,
         barriers[(int)SHIFT::NtC] = TextureBarrier_UavToSrvWithSync(m_threadMap[(int)SHIFT::NtC].Resource());
 
         computeCmdList.ResourceBarrier(barriers, ZetaArrayLen(barriers));
+
+        if (indirect)
+            WorkListsToIndirectArgs(computeCmdList);
     }
 
     // Replay - CtT
@@ -454,27 +735,24 @@ void IndirectLighting::ReSTIR_PT_Temporal(ComputeCmdList& computeCmdList,
 #ifndef NDEBUG
         computeCmdList.PIXBeginEvent("ReSTIR_PT_Replay_CtT");
 #endif
-        const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, RESTIR_PT_REPLAY_GROUP_DIM_X);
-        const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, RESTIR_PT_REPLAY_GROUP_DIM_Y);
-
-        m_cbRPT_Reuse.RBufferA_CtN_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+        cbReuse.RBufferA_CtN_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
             (int)DESC_TABLE_RPT::RBUFFER_A_CtN_UAV);
-        m_cbRPT_Reuse.RBufferA_NtC_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+        cbReuse.RBufferA_NtC_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
             (int)DESC_TABLE_RPT::RBUFFER_A_NtC_UAV);
 
-        const auto& bvh = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_SCENE_BVH_PREV);
-        const auto& meshInstances = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_FRAME_MESH_INSTANCES_PREV);
+        const auto* bvh = m_bvhPrev.Get();
+        const auto* meshInstances = m_meshInstancesPrev.Get();
 
-        m_rootSig.SetRootSRV(2, bvh->GpuVA());
-        m_rootSig.SetRootSRV(3, meshInstances->GpuVA());
-        m_rootSig.SetRootConstants(0, sizeof(m_cbRPT_Reuse) / sizeof(DWORD), &m_cbRPT_Reuse);
-        m_rootSig.End(computeCmdList);
+        rootSig.SetRootSRV(2, bvh->GpuVA());
+        rootSig.SetRootSRV(3, meshInstances->GpuVA());
+        rootSig.SetRootConstants(cbReuse);
+        rootSig.End(computeCmdList);
 
-        auto sh = emissive ? SHADER::ReSTIR_PT_REPLAY_CtT_E : SHADER::ReSTIR_PT_REPLAY_CtT;
-        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
-        computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+        const uint32_t key = emissive ? RPT_PERMUTATION::REPLAY_EMISSIVE : 0;
+        computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_REPLAY, key, 
+            RPT_REPLAY_PERMUTATIONS));
+        DispatchReuse(computeCmdList, cbReuse, SHIFT::CtN, RESTIR_PT_REPLAY_GROUP_DIM_X, 
+            RESTIR_PT_REPLAY_GROUP_DIM_Y);
 #ifndef NDEBUG
         computeCmdList.PIXEndEvent();
 #endif
@@ -485,30 +763,27 @@ void IndirectLighting::ReSTIR_PT_Temporal(ComputeCmdList& computeCmdList,
 #ifndef NDEBUG
         computeCmdList.PIXBeginEvent("ReSTIR_PT_Replay_TtC");
 #endif
-        const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, RESTIR_PT_REPLAY_GROUP_DIM_X);
-        const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, RESTIR_PT_REPLAY_GROUP_DIM_Y);
-
-        const auto& bvh = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_SCENE_BVH_CURR);
-        const auto& meshInstances = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_FRAME_MESH_INSTANCES_CURR);
-
-        m_rootSig.SetRootSRV(2, bvh->GpuVA());
-        m_rootSig.SetRootSRV(3, meshInstances->GpuVA());
-        m_rootSig.End(computeCmdList);
-
-        auto sh = emissive ? SHADER::ReSTIR_PT_REPLAY_TtC_E : SHADER::ReSTIR_PT_REPLAY_TtC;
-        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
-        computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+        const auto* bvh = m_bvhCurr.Get();
+        const auto* meshInstances = m_meshInstancesCurr.Get();
+
+        rootSig.SetRootSRV(2, bvh->GpuVA());
+        rootSig.SetRootSRV(3, meshInstances->GpuVA());
+        rootSig.End(computeCmdList);
+
+        const uint32_t key = RPT_PERMUTATION::TtC | (emissive ? RPT_PERMUTATION::REPLAY_EMISSIVE : 0);
+        computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_REPLAY, key, 
+            RPT_REPLAY_PERMUTATIONS));
+        DispatchReuse(computeCmdList, cbReuse, SHIFT::NtC, RESTIR_PT_REPLAY_GROUP_DIM_X, 
+            RESTIR_PT_REPLAY_GROUP_DIM_Y);
 #ifndef NDEBUG
         computeCmdList.PIXEndEvent();
 #endif
     }
 
     // Set SRVs for replay buffers
-    m_cbRPT_Reuse.RBufferA_CtN_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+    cbReuse.RBufferA_CtN_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
         (int)DESC_TABLE_RPT::RBUFFER_A_CtN_SRV);
-    m_cbRPT_Reuse.RBufferA_NtC_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+    cbReuse.RBufferA_NtC_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
         (int)DESC_TABLE_RPT::RBUFFER_A_NtC_SRV);
 
     // r-buffers into SRV
@@ -537,21 +812,21 @@ void IndirectLighting::ReSTIR_PT_Temporal(ComputeCmdList& computeCmdList,
 #endif
         const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, RESTIR_PT_TEMPORAL_GROUP_DIM_X);
         const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, RESTIR_PT_TEMPORAL_GROUP_DIM_Y);
-        m_cbRPT_Reuse.DispatchDimX_NumGroupsInTile = ((RESTIR_PT_TILE_WIDTH * dispatchDimY) << 16) | dispatchDimX;
+        cbReuse.DispatchDimX_NumGroupsInTile = ((RESTIR_PT_TILE_WIDTH * dispatchDimY) << 16) | dispatchDimX;
 
-        const auto& bvh = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_SCENE_BVH_PREV);
-        const auto& meshInstances = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_FRAME_MESH_INSTANCES_PREV);
+        const auto* bvh = m_bvhPrev.Get();
+        const auto* meshInstances = m_meshInstancesPrev.Get();
 
-        m_rootSig.SetRootSRV(2, bvh->GpuVA());
-        m_rootSig.SetRootSRV(3, meshInstances->GpuVA());
-        m_rootSig.SetRootConstants(0, sizeof(m_cbRPT_Reuse) / sizeof(DWORD), &m_cbRPT_Reuse);
-        m_rootSig.End(computeCmdList);
+        rootSig.SetRootSRV(2, bvh->GpuVA());
+        rootSig.SetRootSRV(3, meshInstances->GpuVA());
+        rootSig.SetRootConstants(cbReuse);
+        rootSig.End(computeCmdList);
 
-        auto sh = emissive ? SHADER::ReSTIR_PT_RECONNECT_CtT_E : SHADER::ReSTIR_PT_RECONNECT_CtT;
-        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
-        computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+        const uint32_t key = emissive ? RPT_PERMUTATION::RECONNECT_EMISSIVE : 0;
+        computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_RECONNECT_CtT, key, 
+            RPT_RECONNECT_CtT_PERMUTATIONS));
+        DispatchReuse(computeCmdList, cbReuse, SHIFT::CtN, RESTIR_PT_TEMPORAL_GROUP_DIM_X, 
+            RESTIR_PT_TEMPORAL_GROUP_DIM_Y);
 #ifndef NDEBUG
         computeCmdList.PIXEndEvent();
 #endif
@@ -571,21 +846,18 @@ void IndirectLighting::ReSTIR_PT_Temporal(ComputeCmdList& computeCmdList,
 
         computeCmdList.ResourceBarrier(uavBarriers, ZetaArrayLen(uavBarriers));
 
-        const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, RESTIR_PT_TEMPORAL_GROUP_DIM_X);
-        const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, RESTIR_PT_TEMPORAL_GROUP_DIM_Y);
+        const auto* bvh = m_bvhCurr.Get();
+        const auto* meshInstances = m_meshInstancesCurr.Get();
 
-        const auto& bvh = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_SCENE_BVH_CURR);
-        const auto& meshInstances = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_FRAME_MESH_INSTANCES_CURR);
+        rootSig.SetRootSRV(2, bvh->GpuVA());
+        rootSig.SetRootSRV(3, meshInstances->GpuVA());
+        rootSig.End(computeCmdList);
 
-        m_rootSig.SetRootSRV(2, bvh->GpuVA());
-        m_rootSig.SetRootSRV(3, meshInstances->GpuVA());
-        m_rootSig.End(computeCmdList);
-
-        auto sh = emissive ? SHADER::ReSTIR_PT_RECONNECT_TtC_E : SHADER::ReSTIR_PT_RECONNECT_TtC;
-        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
-        computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+        const uint32_t key = emissive ? RPT_PERMUTATION::RECONNECT_EMISSIVE : 0;
+        computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_RECONNECT_TtC, key, 
+            RPT_RECONNECT_TtC_PERMUTATIONS));
+        DispatchReuse(computeCmdList, cbReuse, SHIFT::NtC, RESTIR_PT_TEMPORAL_GROUP_DIM_X, 
+            RESTIR_PT_TEMPORAL_GROUP_DIM_Y);
 #ifndef NDEBUG
         computeCmdList.PIXEndEvent();
 #endif
@@ -596,6 +868,7 @@ void IndirectLighting::ReSTIR_PT_Temporal(ComputeCmdList& computeCmdList,
 }
 
 void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
+    RootSignature& rootSig, cb_ReSTIR_PT_Reuse& cbReuse, 
     Span<ID3D12Resource*> currTemporalReservoirs,
     Span<ID3D12Resource*> prevTemporalReservoirs)
 {
@@ -613,10 +886,15 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
     computeCmdList.PIXBeginEvent("ReSTIR_PT_Spatial");
     const uint32_t allQueryIdx = gpuTimer.BeginQuery(computeCmdList, "ReSTIR_PT_Spatial");
 
-    for (int pass = 0; pass < m_numSpatialPasses; pass++)
+    const bool indirect = m_gpuDrivenDispatch && IS_CB_FLAG_SET(cbReuse, CB_IND_FLAGS::SORT_SPATIAL);
+    SET_CB_FLAG(cbReuse, CB_IND_FLAGS::INDIRECT_DISPATCH, indirect);
+
+    const int numPasses = m_rptFrame.NumSpatialPasses;
+
+    for (int pass = 0; pass < numPasses; pass++)
     {
-        m_cbRPT_Reuse.Packed = m_cbRPT_Reuse.Packed & ~0xf000;
-        m_cbRPT_Reuse.Packed |= ((m_numSpatialPasses << 14) | (pass << 12));
+        cbReuse.Packed = cbReuse.Packed & ~0xf000;
+        cbReuse.Packed |= ((numPasses << 14) | (pass << 12));
 
         // Search for reusable spatial neighbor
         {
@@ -629,12 +907,13 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
             cb_ReSTIR_PT_SpatialSearch cb;
             cb.DispatchDimX_NumGroupsInTile = ((RESTIR_PT_TILE_WIDTH * dispatchDimY) << 16) | dispatchDimX;
             cb.OutputDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RPT::SPATIAL_NEIGHBOR_UAV);
-            cb.Flags = m_cbRPT_Reuse.Flags;
+            cb.Flags = cbReuse.Flags;
 
-            m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
-            m_rootSig.End(computeCmdList);
+            rootSig.SetRootConstants(cb);
+            rootSig.End(computeCmdList);
 
-            computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::ReSTIR_PT_SPATIAL_SEARCH));
+            computeCmdList.SetPipelineState(m_psoLib.GetPSO(m_groupSharedSpatial ? 
+                (int)SHADER::ReSTIR_PT_SPATIAL_SEARCH_SHARED : (int)SHADER::ReSTIR_PT_SPATIAL_SEARCH));
             computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 #ifndef NDEBUG
             computeCmdList.PIXEndEvent();
@@ -671,7 +950,7 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
             }
 
             // Thread maps into UAV
-            if (IS_CB_FLAG_SET(m_cbRPT_Reuse, CB_IND_FLAGS::SORT_SPATIAL))
+            if (IS_CB_FLAG_SET(cbReuse, CB_IND_FLAGS::SORT_SPATIAL))
             {
                 barriers.push_back(TextureBarrier_SrvToUavWithSync(m_threadMap[(int)SHIFT::NtC].Resource()));
                 barriers.push_back(TextureBarrier_SrvToUavWithSync(m_threadMap[(int)SHIFT::CtN].Resource()));
@@ -682,14 +961,14 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
 
             computeCmdList.ResourceBarrier(barriers.data(), (UINT)barriers.size());
 
-            // Update layout
-            m_reservoir_RPT[m_currTemporalIdx].Layout = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE;
-            m_reservoir_RPT[1 - m_currTemporalIdx].Layout = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS;
-            m_currTemporalIdx = 1 - m_currTemporalIdx;
+            // Layouts are updated in ReSTIR_PT_PathTrace()
         }
 
+        if (indirect)
+            ResetWorkLists(computeCmdList);
+
         // Sort - CtS
-        if (IS_CB_FLAG_SET(m_cbRPT_Reuse, CB_IND_FLAGS::SORT_SPATIAL))
+        if (IS_CB_FLAG_SET(cbReuse, CB_IND_FLAGS::SORT_SPATIAL))
         {
 #ifndef NDEBUG
             computeCmdList.PIXBeginEvent("ReSTIR_PT_Sort_CtS");
@@ -700,14 +979,17 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
             cb_ReSTIR_PT_Sort cb;
             cb.DispatchDimX = dispatchDimX;
             cb.DispatchDimY = dispatchDimY;
-            cb.Reservoir_A_DescHeapIdx = m_cbRPT_Reuse.Reservoir_A_DescHeapIdx;
+            cb.Reservoir_A_DescHeapIdx = cbReuse.Reservoir_A_DescHeapIdx;
             cb.MapDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RPT::THREAD_MAP_CtN_UAV);
-            cb.Flags = m_cbRPT_Reuse.Flags;
+            cb.WorkListDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RPT::WORK_LIST_UAV);
+            cb.NumWorkGroups = cbReuse.NumWorkGroups;
+            cb.Flags = cbReuse.Flags;
 
-            m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
-            m_rootSig.End(computeCmdList);
+            rootSig.SetRootConstants(cb);
+            rootSig.End(computeCmdList);
 
-            computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::ReSTIR_PT_SORT_CtS));
+            computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_SORT, RPT_PERMUTATION::CtS, 
+                RPT_SORT_PERMUTATIONS));
             computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 #ifndef NDEBUG
             computeCmdList.PIXEndEvent();
@@ -715,7 +997,7 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
         }
 
         // Sort - StC
-        if (IS_CB_FLAG_SET(m_cbRPT_Reuse, CB_IND_FLAGS::SORT_SPATIAL))
+        if (IS_CB_FLAG_SET(cbReuse, CB_IND_FLAGS::SORT_SPATIAL))
         {
 #ifndef NDEBUG
             computeCmdList.PIXBeginEvent("ReSTIR_PT_Sort_StC");
@@ -726,15 +1008,18 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
             cb_ReSTIR_PT_Sort cb;
             cb.DispatchDimX = dispatchDimX;
             cb.DispatchDimY = dispatchDimY;
-            cb.Reservoir_A_DescHeapIdx = m_cbRPT_Reuse.Reservoir_A_DescHeapIdx;
+            cb.Reservoir_A_DescHeapIdx = cbReuse.Reservoir_A_DescHeapIdx;
             cb.SpatialNeighborHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RPT::SPATIAL_NEIGHBOR_SRV);
             cb.MapDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RPT::THREAD_MAP_NtC_UAV);
-            cb.Flags = m_cbRPT_Reuse.Flags;
+            cb.WorkListDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RPT::WORK_LIST_UAV);
+            cb.NumWorkGroups = cbReuse.NumWorkGroups;
+            cb.Flags = cbReuse.Flags;
 
-            m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
-            m_rootSig.End(computeCmdList);
+            rootSig.SetRootConstants(cb);
+            rootSig.End(computeCmdList);
 
-            computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::ReSTIR_PT_SORT_StC));
+            computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_SORT, RPT_PERMUTATION::StC, 
+                RPT_SORT_PERMUTATIONS));
             computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 #ifndef NDEBUG
             computeCmdList.PIXEndEvent();
@@ -747,7 +1032,7 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
             computeCmdList.PIXBeginEvent("ReSTIR_PT_Replay_CtS");
 #endif
             // Thread maps into SRV
-            if (IS_CB_FLAG_SET(m_cbRPT_Reuse, CB_IND_FLAGS::SORT_SPATIAL))
+            if (IS_CB_FLAG_SET(cbReuse, CB_IND_FLAGS::SORT_SPATIAL))
             {
                 D3D12_TEXTURE_BARRIER barriers[(int)SHIFT::COUNT];
                 barriers[(int)SHIFT::CtN] = TextureBarrier_UavToSrvWithSync(m_threadMap[(int)SHIFT::CtN].Resource());
@@ -756,20 +1041,22 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
                 computeCmdList.ResourceBarrier(barriers, ZetaArrayLen(barriers));
             }
 
-            const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, RESTIR_PT_REPLAY_GROUP_DIM_X);
-            const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, RESTIR_PT_REPLAY_GROUP_DIM_Y);
+            if (indirect)
+                WorkListsToIndirectArgs(computeCmdList);
 
-            m_cbRPT_Reuse.RBufferA_CtN_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            cbReuse.RBufferA_CtN_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
                 (int)DESC_TABLE_RPT::RBUFFER_A_CtN_UAV);
-            m_cbRPT_Reuse.RBufferA_NtC_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            cbReuse.RBufferA_NtC_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
                 (int)DESC_TABLE_RPT::RBUFFER_A_NtC_UAV);
 
-            m_rootSig.SetRootConstants(0, sizeof(m_cbRPT_Reuse) / sizeof(DWORD), &m_cbRPT_Reuse);
-            m_rootSig.End(computeCmdList);
+            rootSig.SetRootConstants(cbReuse);
+            rootSig.End(computeCmdList);
 
-            auto sh = emissive ? SHADER::ReSTIR_PT_REPLAY_CtS_E : SHADER::ReSTIR_PT_REPLAY_CtS;
-            computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
-            computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+            const uint32_t key = RPT_PERMUTATION::CtS | (emissive ? RPT_PERMUTATION::REPLAY_EMISSIVE : 0);
+            computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_REPLAY, key, 
+                RPT_REPLAY_PERMUTATIONS));
+            DispatchReuse(computeCmdList, cbReuse, SHIFT::CtN, RESTIR_PT_REPLAY_GROUP_DIM_X, 
+                RESTIR_PT_REPLAY_GROUP_DIM_Y);
 #ifndef NDEBUG
             computeCmdList.PIXEndEvent();
 #endif
@@ -780,12 +1067,11 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
 #ifndef NDEBUG
             computeCmdList.PIXBeginEvent("ReSTIR_PT_Replay_StC");
 #endif
-            const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, RESTIR_PT_REPLAY_GROUP_DIM_X);
-            const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, RESTIR_PT_REPLAY_GROUP_DIM_Y);
-
-            auto sh = emissive ? SHADER::ReSTIR_PT_REPLAY_StC_E : SHADER::ReSTIR_PT_REPLAY_StC;
-            computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
-            computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+            const uint32_t key = RPT_PERMUTATION::StC | (emissive ? RPT_PERMUTATION::REPLAY_EMISSIVE : 0);
+            computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_REPLAY, key, 
+                RPT_REPLAY_PERMUTATIONS));
+            DispatchReuse(computeCmdList, cbReuse, SHIFT::NtC, RESTIR_PT_REPLAY_GROUP_DIM_X, 
+                RESTIR_PT_REPLAY_GROUP_DIM_Y);
 #ifndef NDEBUG
             computeCmdList.PIXEndEvent();
 #endif
@@ -810,9 +1096,9 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
             computeCmdList.ResourceBarrier(barriers, ZetaArrayLen(barriers));
 
             // Set SRVs for replay buffers
-            m_cbRPT_Reuse.RBufferA_CtN_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            cbReuse.RBufferA_CtN_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
                 (int)DESC_TABLE_RPT::RBUFFER_A_CtN_SRV);
-            m_cbRPT_Reuse.RBufferA_NtC_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            cbReuse.RBufferA_NtC_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
                 (int)DESC_TABLE_RPT::RBUFFER_A_NtC_SRV);
         }
 
@@ -824,13 +1110,15 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
             const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, RESTIR_PT_SPATIAL_GROUP_DIM_X);
             const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, RESTIR_PT_SPATIAL_GROUP_DIM_Y);
 
-            m_cbRPT_Reuse.DispatchDimX_NumGroupsInTile = ((RESTIR_PT_TILE_WIDTH * dispatchDimY) << 16) | dispatchDimX;
-            m_rootSig.SetRootConstants(0, sizeof(m_cbRPT_Reuse) / sizeof(DWORD), &m_cbRPT_Reuse);
-            m_rootSig.End(computeCmdList);
+            cbReuse.DispatchDimX_NumGroupsInTile = ((RESTIR_PT_TILE_WIDTH * dispatchDimY) << 16) | dispatchDimX;
+            rootSig.SetRootConstants(cbReuse);
+            rootSig.End(computeCmdList);
 
-            auto sh = emissive ? SHADER::ReSTIR_PT_RECONNECT_CtS_E : SHADER::ReSTIR_PT_RECONNECT_CtS;
-            computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
-            computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+            const uint32_t key = emissive ? RPT_PERMUTATION::RECONNECT_EMISSIVE : 0;
+            computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_RECONNECT_CtS, key, 
+                RPT_RECONNECT_CtS_PERMUTATIONS));
+            DispatchReuse(computeCmdList, cbReuse, SHIFT::CtN, RESTIR_PT_SPATIAL_GROUP_DIM_X, 
+                RESTIR_PT_SPATIAL_GROUP_DIM_Y);
 #ifndef NDEBUG
             computeCmdList.PIXEndEvent();
 #endif
@@ -845,27 +1133,26 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
             D3D12_TEXTURE_BARRIER uavBarrier = UAVBarrier1(outputs[1]);
             computeCmdList.ResourceBarrier(uavBarrier);
 
-            const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, RESTIR_PT_SPATIAL_GROUP_DIM_X);
-            const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, RESTIR_PT_SPATIAL_GROUP_DIM_Y);
-
-            auto sh = emissive ? SHADER::ReSTIR_PT_RECONNECT_StC_E : SHADER::ReSTIR_PT_RECONNECT_StC;
-            computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
-            computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+            const uint32_t key = emissive ? RPT_PERMUTATION::RECONNECT_EMISSIVE : 0;
+            computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_RECONNECT_StC, key, 
+                RPT_RECONNECT_StC_PERMUTATIONS));
+            DispatchReuse(computeCmdList, cbReuse, SHIFT::NtC, RESTIR_PT_SPATIAL_GROUP_DIM_X, 
+                RESTIR_PT_SPATIAL_GROUP_DIM_Y);
 #ifndef NDEBUG
             computeCmdList.PIXEndEvent();
 #endif
         }
 
         // Prepare for next iteration (if any)
-        if (pass == 0 && m_numSpatialPasses == 2)
+        if (pass == 0 && numPasses == 2)
         {
             // Spatial neighbor idx into UAV
             auto barrier = TextureBarrier_SrvToUavWithSync(m_spatialNeighbor.Resource());
             computeCmdList.ResourceBarrier(barrier);
 
             // Swap input and output reservoirs
-            std::swap(m_cbRPT_Reuse.PrevReservoir_A_DescHeapIdx,
-                m_cbRPT_Reuse.Reservoir_A_DescHeapIdx);
+            std::swap(cbReuse.PrevReservoir_A_DescHeapIdx,
+                cbReuse.Reservoir_A_DescHeapIdx);
             std::swap(inputs, outputs);
         }
     }
@@ -874,7 +1161,62 @@ void IndirectLighting::ReSTIR_PT_Spatial(ComputeCmdList& computeCmdList,
     computeCmdList.PIXEndEvent();
 }
 
-void IndirectLighting::RenderReSTIR_PT(Core::ComputeCmdList& computeCmdList)
+void IndirectLighting::ResetWorkLists(ComputeCmdList& computeCmdList)
+{
+    // Previous reuse pass might still be reading the work lists
+    auto toCopyDest = BufferBarrier(m_rptWorkList.Resource(),
+        D3D12_BARRIER_SYNC_EXECUTE_INDIRECT | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_SYNC_COPY,
+        D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT | D3D12_BARRIER_ACCESS_SHADER_RESOURCE,
+        D3D12_BARRIER_ACCESS_COPY_DEST);
+    computeCmdList.ResourceBarrier(toCopyDest);
+
+    // Only the thread group counts need to be reset
+    computeCmdList.CopyBufferRegion(m_rptWorkList.Resource(), 0, m_rptWorkListInit.Resource(), 0,
+        RESTIR_PT_WORK_LIST_HEADER_SIZE * sizeof(uint32_t));
+
+    auto toUav = BufferBarrier(m_rptWorkList.Resource(),
+        D3D12_BARRIER_SYNC_COPY,
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_ACCESS_COPY_DEST,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS);
+    computeCmdList.ResourceBarrier(toUav);
+}
+
+void IndirectLighting::WorkListsToIndirectArgs(ComputeCmdList& computeCmdList)
+{
+    auto barrier = BufferBarrier(m_rptWorkList.Resource(),
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_SYNC_EXECUTE_INDIRECT | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+        D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT | D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+    computeCmdList.ResourceBarrier(barrier);
+}
+
+void IndirectLighting::DispatchReuse(ComputeCmdList& computeCmdList, const cb_ReSTIR_PT_Reuse& cbReuse,
+    SHIFT shift, uint32_t groupDimX, uint32_t groupDimY)
+{
+    if (IS_CB_FLAG_SET(cbReuse, CB_IND_FLAGS::INDIRECT_DISPATCH))
+    {
+        Assert(groupDimY == RESTIR_PT_REPLAY_GROUP_DIM_Y && 
+            (groupDimX == RESTIR_PT_REPLAY_GROUP_DIM_X || groupDimX == RESTIR_PT_REPLAY_GROUP_DIM_X / 2),
+            "Thread group dimensions don't match the work list.");
+
+        // Arguments for (8 x 8) thread groups come after the ones for (16 x 8) groups
+        const uint32_t argsOffset = (uint32_t)shift * RESTIR_PT_WORK_LIST_ARGS_SIZE +
+            (groupDimX == RESTIR_PT_REPLAY_GROUP_DIM_X ? 0 : 3);
+        computeCmdList.DispatchIndirect(m_rptWorkList.Resource(), argsOffset * sizeof(uint32_t));
+
+        return;
+    }
+
+    auto& renderer = App::GetRenderer();
+    const uint32_t dispatchDimX = CeilUnsignedIntDiv(renderer.GetRenderWidth(), groupDimX);
+    const uint32_t dispatchDimY = CeilUnsignedIntDiv(renderer.GetRenderHeight(), groupDimY);
+    computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+}
+
+void IndirectLighting::ReSTIR_PT_PathTrace(ComputeCmdList& computeCmdList)
 {
     auto& renderer = App::GetRenderer();
     auto& gpuTimer = renderer.GetGpuTimer();
@@ -902,8 +1244,18 @@ void IndirectLighting::RenderReSTIR_PT(Core::ComputeCmdList& computeCmdList)
     auto uavAIdx = m_currTemporalIdx == 1 ? DESC_TABLE_RPT::RESERVOIR_1_A_UAV :
         DESC_TABLE_RPT::RESERVOIR_0_A_UAV;
 
+    // Right after history was reset, spatial reuse makes up for the missing or short 
+    // history. In the first frame, it takes the place of temporal reuse.
+    const bool warmup = m_doTemporalResampling && m_framesSinceReset < m_warmupFrames;
     const bool doTemporal = m_doTemporalResampling && m_isTemporalReservoirValid;
-    const bool doSpatial = (m_numSpatialPasses > 0) && doTemporal;
+    const int numSpatialPasses = warmup ? MAX_NUM_SPATIAL_PASSES : m_numSpatialPasses;
+    const bool doSpatial = (numSpatialPasses > 0) && (doTemporal || warmup);
+
+    m_rptFrame.DoTemporal = doTemporal;
+    m_rptFrame.DoSpatial = doSpatial;
+    m_rptFrame.NumSpatialPasses = doSpatial ? numSpatialPasses : 0;
+    memcpy(m_rptFrame.CurrReservoirs, currReservoirs, sizeof(currReservoirs));
+    memcpy(m_rptFrame.PrevReservoirs, prevReservoirs, sizeof(prevReservoirs));
 
     // Initial candidates
     {
@@ -925,17 +1277,19 @@ void IndirectLighting::RenderReSTIR_PT(Core::ComputeCmdList& computeCmdList)
             m_reservoir_RPT[m_currTemporalIdx].Layout = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS;
         }
 
-        if (doTemporal)
+        // Temporal reservoirs into SRV. Without temporal reuse, spatial reuse still 
+        // writes its outputs to them.
+        if ((doTemporal || doSpatial) &&
+            m_reservoir_RPT[1 - m_currTemporalIdx].Layout == D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS)
         {
-            // Temporal reservoirs into SRV
-            if (m_reservoir_RPT[1 - m_currTemporalIdx].Layout == D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS)
-            {
-                for (int i = 0; i < ZetaArrayLen(prevReservoirs); i++)
-                    textureBarriers.push_back(TextureBarrier_UavToSrvNoSync(prevReservoirs[i]));
+            for (int i = 0; i < ZetaArrayLen(prevReservoirs); i++)
+                textureBarriers.push_back(TextureBarrier_UavToSrvNoSync(prevReservoirs[i]));
 
-                m_reservoir_RPT[1 - m_currTemporalIdx].Layout = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE;
-            }
+            m_reservoir_RPT[1 - m_currTemporalIdx].Layout = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE;
+        }
 
+        if (doTemporal)
+        {
             // r-buffers into UAV
             for (int i = 0; i < (int)SHIFT::COUNT; i++)
             {
@@ -948,11 +1302,11 @@ void IndirectLighting::RenderReSTIR_PT(Core::ComputeCmdList& computeCmdList)
             // Thread maps into UAV
             textureBarriers.push_back(TextureBarrier_SrvToUavNoSync(m_threadMap[(int)SHIFT::CtN].Resource()));
             textureBarriers.push_back(TextureBarrier_SrvToUavNoSync(m_threadMap[(int)SHIFT::NtC].Resource()));
-
-            if (doSpatial)
-                textureBarriers.push_back(TextureBarrier_SrvToUavNoSync(m_spatialNeighbor.Resource()));
         }
 
+        if (doSpatial)
+            textureBarriers.push_back(TextureBarrier_SrvToUavNoSync(m_spatialNeighbor.Resource()));
+
         if (!textureBarriers.empty())
             computeCmdList.ResourceBarrier(textureBarriers.data(), (UINT)textureBarriers.size());
 
@@ -968,39 +1322,80 @@ void IndirectLighting::RenderReSTIR_PT(Core::ComputeCmdList& computeCmdList)
         m_cbRPT_PathTrace.DispatchDimX_NumGroupsInTile = ((RESTIR_PT_TILE_WIDTH * dispatchDimY) << 16) | dispatchDimX;
         m_cbRPT_PathTrace.Reservoir_A_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)uavAIdx);
 
-        const auto& bvh = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_SCENE_BVH_CURR);
-        const auto& meshInstances = renderer.GetSharedShaderResources().GetDefaultHeapBuffer(
-            GlobalResource::RT_FRAME_MESH_INSTANCES_CURR);
+        const auto* bvh = m_bvhCurr.Get();
+        const auto* meshInstances = m_meshInstancesCurr.Get();
 
         m_rootSig.SetRootSRV(2, bvh->GpuVA());
         m_rootSig.SetRootSRV(3, meshInstances->GpuVA());
-        m_rootSig.SetRootConstants(0, sizeof(m_cbRPT_PathTrace) / sizeof(DWORD), &m_cbRPT_PathTrace);
+        m_rootSig.SetRootConstants(m_cbRPT_PathTrace);
         m_rootSig.End(computeCmdList);
 
-        auto sh = App::GetScene().EmissiveLighting() ? SHADER::ReSTIR_PT_PATH_TRACE_WoPS :
-            SHADER::ReSTIR_PT_PATH_TRACE;
-        sh = m_preSampling ? SHADER::ReSTIR_PT_PATH_TRACE_WPS : sh;
+        uint32_t key = App::GetScene().EmissiveLighting() ? RPT_PERMUTATION::PT_EMISSIVE : 0;
+        key |= m_preSampling ? RPT_PERMUTATION::PT_EMISSIVE | RPT_PERMUTATION::PT_PRESAMPLED_SETS : 0;
+        key |= m_fp16BSDF ? RPT_PERMUTATION::PT_FP16_BSDF : 0;
 
-        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
+        computeCmdList.SetPipelineState(GetPermutation(SHADER::ReSTIR_PT_PATH_TRACE, key, 
+            RPT_PATH_TRACE_PERMUTATIONS));
         computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
 
         gpuTimer.EndQuery(computeCmdList, queryIdx);
         computeCmdList.PIXEndEvent();
     }
 
-    if (doTemporal)
+    // Constants for the resampling passes. Since reservoir descriptors were allocated 
+    // consecutively, filling just the heap index for A is enough.
+    m_rptFrame.CB = m_cbRPT_Reuse;
+    m_rptFrame.CB.PrevReservoir_A_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)srvAIdx);
+    m_rptFrame.CB.Reservoir_A_DescHeapIdx = m_cbRPT_PathTrace.Reservoir_A_DescHeapIdx;
+
+    // Match the state that temporal resampling leaves behind, so that spatial resampling
+    // can be recorded independently
     {
-        // Since reservoir descriptors were allocated consecutively, filling just
-        // the heap index for A is enough
-        m_cbRPT_Reuse.PrevReservoir_A_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)srvAIdx);
-        m_cbRPT_Reuse.Reservoir_A_DescHeapIdx = m_cbRPT_PathTrace.Reservoir_A_DescHeapIdx;
+        const uint32_t dispatchDimX = CeilUnsignedIntDiv(w, RESTIR_PT_TEMPORAL_GROUP_DIM_X);
+        const uint32_t dispatchDimY = CeilUnsignedIntDiv(h, RESTIR_PT_TEMPORAL_GROUP_DIM_Y);
 
-        ReSTIR_PT_Temporal(computeCmdList, currReservoirs);
+        m_rptFrame.CB.DispatchDimX_NumGroupsInTile = ((RESTIR_PT_TILE_WIDTH * dispatchDimY) << 16) | dispatchDimX;
+        m_rptFrame.CB.RBufferA_CtN_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            (int)DESC_TABLE_RPT::RBUFFER_A_CtN_SRV);
+        m_rptFrame.CB.RBufferA_NtC_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            (int)DESC_TABLE_RPT::RBUFFER_A_NtC_SRV);
     }
 
+    // Spatial passes alternate between the two sets of reservoirs
     if (doSpatial)
-        ReSTIR_PT_Spatial(computeCmdList, currReservoirs, prevReservoirs);
+    {
+        for (int pass = 0; pass < numSpatialPasses; pass++)
+        {
+            m_reservoir_RPT[m_currTemporalIdx].Layout = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE;
+            m_reservoir_RPT[1 - m_currTemporalIdx].Layout = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS;
+            m_currTemporalIdx = 1 - m_currTemporalIdx;
+        }
+    }
+}
+
+void IndirectLighting::RenderReSTIR_PT(ComputeCmdList& computeCmdList)
+{
+    ReSTIR_PT_PathTrace(computeCmdList);
+
+    cb_ReSTIR_PT_Reuse cbReuse = m_rptFrame.CB;
+
+    if (m_rptFrame.DoTemporal)
+        ReSTIR_PT_Temporal(computeCmdList, m_rootSig, cbReuse, m_rptFrame.CurrReservoirs);
+
+    if (m_rptFrame.DoSpatial)
+    {
+        ReSTIR_PT_Spatial(computeCmdList, m_rootSig, cbReuse, m_rptFrame.CurrReservoirs, 
+            m_rptFrame.PrevReservoirs);
+    }
+}
+
+void IndirectLighting::EndFrame()
+{
+    m_isTemporalReservoirValid = true;
+    m_currTemporalIdx = 1 - m_currTemporalIdx;
+    m_framesSinceReset = Min(m_framesSinceReset + 1, m_warmupFrames);
+    SET_CB_FLAG(m_cbRPT_PathTrace, CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES, false);
+    SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES, false);
 }
 
 void IndirectLighting::Render(CommandList& cmdList)
@@ -1009,19 +1404,67 @@ void IndirectLighting::Render(CommandList& cmdList)
         cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_COMPUTE, "Invalid downcast");
     ComputeCmdList& computeCmdList = static_cast<ComputeCmdList&>(cmdList);
 
+    // Sets its own root signature, so has to come first
+    if (m_method == INTEGRATOR::PATH_TRACING && !m_adaptiveSampling)
+        m_tileClassification.Classify(computeCmdList);
+
     computeCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
 
     if (m_method == INTEGRATOR::ReSTIR_PT)
         RenderReSTIR_PT(computeCmdList);
     else if (m_method == INTEGRATOR::ReSTIR_GI)
         RenderReSTIR_GI(computeCmdList);
+    else if (m_method == INTEGRATOR::PROBE_VOLUME)
+        RenderProbeVolume(computeCmdList);
     else
         RenderPathTracer(computeCmdList);
 
-    m_isTemporalReservoirValid = true;
-    m_currTemporalIdx = 1 - m_currTemporalIdx;
-    SET_CB_FLAG(m_cbRPT_PathTrace, CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES, false);
-    SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES, false);
+    EndFrame();
+}
+
+void IndirectLighting::RenderSubCmdList(CommandList& cmdList, int subCmdListIdx)
+{
+    Assert(m_method == INTEGRATOR::ReSTIR_PT, "Invalid call.");
+    Assert(subCmdListIdx < NUM_RPT_SUB_CMD_LISTS, "Invalid sub command list index.");
+    Assert(cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_DIRECT ||
+        cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_COMPUTE, "Invalid downcast");
+    ComputeCmdList& computeCmdList = static_cast<ComputeCmdList&>(cmdList);
+
+    // Path tracing is recorded first and sets up the per-frame state
+    if (subCmdListIdx == 0)
+    {
+        computeCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
+        ReSTIR_PT_PathTrace(computeCmdList);
+        EndFrame();
+
+        return;
+    }
+
+    const bool temporal = subCmdListIdx == 1;
+    if ((temporal && !m_rptFrame.DoTemporal) || (!temporal && !m_rptFrame.DoSpatial))
+        return;
+
+    // Temporal and spatial resampling are recorded in parallel, each with its own copy
+    // of the root signature and constants
+    RootSignature rootSig(m_rootSig);
+    cb_ReSTIR_PT_Reuse cbReuse = m_rptFrame.CB;
+    computeCmdList.SetRootSignature(rootSig, m_rootSigObj.Get());
+
+    // Root descriptors are reset by SetRootSignature(). Some of the dispatches rely on the
+    // ones that were set by the preceding passes.
+    const auto* bvh = m_bvhCurr.Get();
+    const auto* meshInstances = m_meshInstancesCurr.Get();
+
+    rootSig.SetRootSRV(2, bvh->GpuVA());
+    rootSig.SetRootSRV(3, meshInstances->GpuVA());
+
+    if (temporal)
+        ReSTIR_PT_Temporal(computeCmdList, rootSig, cbReuse, m_rptFrame.CurrReservoirs);
+    else
+    {
+        ReSTIR_PT_Spatial(computeCmdList, rootSig, cbReuse, m_rptFrame.CurrReservoirs, 
+            m_rptFrame.PrevReservoirs);
+    }
 }
 
 void IndirectLighting::SwitchToReSTIR_PT(bool skipNonResources)
@@ -1043,10 +1486,16 @@ void IndirectLighting::SwitchToReSTIR_PT(bool skipNonResources)
         (int)SHIFT::COUNT * RBuffer::NUM;
     PlacedResourceList<N> list;
 
+    // Compact layout stores weights and targets at half precision
+    const DXGI_FORMAT formatB = m_compactReservoirs ? ResourceFormats_RPT::RESERVOIR_B_COMPACT :
+        ResourceFormats_RPT::RESERVOIR_B;
+    const DXGI_FORMAT formatTarget = m_compactReservoirs ? ResourceFormats_RPT::TARGET_COMPACT :
+        ResourceFormats_RPT::TARGET;
+
     for (int i = 0; i < 2; i++)
     {
         list.PushTex2D(ResourceFormats_RPT::RESERVOIR_A, w, h, TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
-        list.PushTex2D(ResourceFormats_RPT::RESERVOIR_B, w, h, TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+        list.PushTex2D(formatB, w, h, TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
         list.PushTex2D(ResourceFormats_RPT::RESERVOIR_C, w, h, TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
         list.PushTex2D(ResourceFormats_RPT::RESERVOIR_D, w, h, TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
         list.PushTex2D(ResourceFormats_RPT::RESERVOIR_E, w, h, TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
@@ -1058,7 +1507,7 @@ void IndirectLighting::SwitchToReSTIR_PT(bool skipNonResources)
         list.PushTex2D(ResourceFormats_RPT::THREAD_MAP, w, h, TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
 
     list.PushTex2D(ResourceFormats_RPT::SPATIAL_NEIGHBOR, w, h, TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
-    list.PushTex2D(ResourceFormats_RPT::TARGET, w, h, TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+    list.PushTex2D(formatTarget, w, h, TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
 
     for (int i = 0; i < (int)SHIFT::COUNT; i++)
     {
@@ -1070,7 +1519,7 @@ void IndirectLighting::SwitchToReSTIR_PT(bool skipNonResources)
 
     list.End();
 
-    m_resHeap = GpuMemory::GetResourceHeap(list.TotalSizeInBytes());
+    m_resHeap = GpuMemory::GetResourceHeap("ReSTIR_PT_Reservoirs", list.TotalSizeInBytes());
     auto allocs = list.AllocInfos();
     int currRes = 0;
     const auto initState0 = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS;
@@ -1102,7 +1551,7 @@ void IndirectLighting::SwitchToReSTIR_PT(bool skipNonResources)
             "RPT_Reservoir", i, "A", allocs[currRes++],
             (int)DESC_TABLE_RPT::RESERVOIR_0_A_SRV, (int)DESC_TABLE_RPT::RESERVOIR_0_A_UAV,
             descOffset, state);
-        func(m_reservoir_RPT[i].B, ResourceFormats_RPT::RESERVOIR_B,
+        func(m_reservoir_RPT[i].B, formatB,
             "RPT_Reservoir", i, "B", allocs[currRes++],
             (int)DESC_TABLE_RPT::RESERVOIR_0_B_SRV, (int)DESC_TABLE_RPT::RESERVOIR_0_B_UAV,
             descOffset, state);
@@ -1149,7 +1598,7 @@ void IndirectLighting::SwitchToReSTIR_PT(bool skipNonResources)
         0, D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE);
 
     // Target
-    func(m_rptTarget, ResourceFormats_RPT::TARGET, "RPT_Target", 0, "",
+    func(m_rptTarget, formatTarget, "RPT_Target", 0, "",
         allocs[currRes++], -1, (int)DESC_TABLE_RPT::TARGET_UAV, 0,
         D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS);
 
@@ -1198,6 +1647,37 @@ void IndirectLighting::SwitchToReSTIR_PT(bool skipNonResources)
     // Final
     Direct3DUtil::CreateTexture2DUAV(m_final, m_descTable.CPUHandle((int)DESC_TABLE_RPT::FINAL_UAV));
 
+    // Work lists
+    {
+        const uint32_t numWorkGroups = CeilUnsignedIntDiv(w, RESTIR_PT_REPLAY_GROUP_DIM_X) *
+            CeilUnsignedIntDiv(h, RESTIR_PT_REPLAY_GROUP_DIM_Y);
+        const uint32_t numElements = RESTIR_PT_WORK_LIST_HEADER_SIZE + numWorkGroups * (int)SHIFT::COUNT;
+
+        m_rptWorkList = GpuMemory::GetDefaultHeapBuffer("RPT_WorkList", numElements * sizeof(uint32_t),
+            D3D12_RESOURCE_STATE_COMMON, true);
+        m_cbRPT_Reuse.NumWorkGroups = numWorkGroups;
+
+        Direct3DUtil::CreateBufferSRV(m_rptWorkList, m_descTable.CPUHandle((int)DESC_TABLE_RPT::WORK_LIST_SRV),
+            sizeof(uint32_t), numElements);
+        Direct3DUtil::CreateBufferUAV(m_rptWorkList, m_descTable.CPUHandle((int)DESC_TABLE_RPT::WORK_LIST_UAV),
+            sizeof(uint32_t), numElements);
+        m_cbRPT_Reuse.WorkListDescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+            (int)DESC_TABLE_RPT::WORK_LIST_SRV);
+
+        if (!m_rptWorkListInit.IsInitialized())
+        {
+            static_assert((int)SHIFT::COUNT * RESTIR_PT_WORK_LIST_ARGS_SIZE <= RESTIR_PT_WORK_LIST_HEADER_SIZE);
+
+            // Thread group counts start at zero, (8 x 8) groups cover each listed group with Y = 2
+            uint32_t args[RESTIR_PT_WORK_LIST_HEADER_SIZE] = { 
+                0, 1, 1, 0, 2, 1,       // CtN
+                0, 1, 1, 0, 2, 1 };     // NtC
+
+            m_rptWorkListInit = GpuMemory::GetDefaultHeapBufferAndInit("RPT_WorkListInit",
+                sizeof(args), false, MemoryRegion{ .Data = args, .SizeInBytes = sizeof(args) });
+        }
+    }
+
     // Following never change, so can be set only once
     m_cbRPT_PathTrace.TargetDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RPT::TARGET_UAV);
     m_cbRPT_Reuse.ThreadMap_NtC_DescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
@@ -1237,7 +1717,7 @@ void IndirectLighting::SwitchToReSTIR_PT(bool skipNonResources)
         ParamVariant doSpatial;
         doSpatial.InitInt(ICON_FA_FILM " Renderer", "Indirect Lighting", "Spatial Resample",
             fastdelegate::MakeDelegate(this, &IndirectLighting::SpatialResamplingCallback),
-            m_numSpatialPasses, 0, 2, 1, "Reuse");
+            m_numSpatialPasses, 0, MAX_NUM_SPATIAL_PASSES, 1, "Reuse");
         App::AddParam(doSpatial);
 
         ParamVariant sortTemporal;
@@ -1250,12 +1730,42 @@ void IndirectLighting::SwitchToReSTIR_PT(bool skipNonResources)
             fastdelegate::MakeDelegate(this, &IndirectLighting::SortSpatialCallback), true, "Reuse");
         App::AddParam(sortSpatial);
 
+        ParamVariant gpuDrivenDispatch;
+        gpuDrivenDispatch.InitBool(ICON_FA_FILM " Renderer", "Indirect Lighting", "GPU-Driven Dispatch",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::GpuDrivenDispatchCallback), 
+            m_gpuDrivenDispatch, "Reuse");
+        App::AddParam(gpuDrivenDispatch);
+
+        ParamVariant groupSharedSpatial;
+        groupSharedSpatial.InitBool(ICON_FA_FILM " Renderer", "Indirect Lighting", "Group-Shared Spatial",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::GroupSharedSpatialCallback), 
+            m_groupSharedSpatial, "Reuse");
+        App::AddParam(groupSharedSpatial);
+
+        ParamVariant compact;
+        compact.InitBool(ICON_FA_FILM " Renderer", "Indirect Lighting", "Compact Reservoirs",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::CompactReservoirsCallback), 
+            m_compactReservoirs, "Reuse");
+        App::AddParam(compact);
+
+        ParamVariant fp16BSDF;
+        fp16BSDF.InitBool(ICON_FA_FILM " Renderer", "Indirect Lighting", "FP16 BSDF",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::FP16BSDFCallback), 
+            m_fp16BSDF, "Path Sampling");
+        App::AddParam(fp16BSDF);
+
         ParamVariant doTemporal;
         doTemporal.InitBool(ICON_FA_FILM " Renderer", "Indirect Lighting", "Temporal Resample",
             fastdelegate::MakeDelegate(this, &IndirectLighting::TemporalResamplingCallback),
             m_doTemporalResampling, "Reuse");
         App::AddParam(doTemporal);
 
+        ParamVariant warmup;
+        warmup.InitInt(ICON_FA_FILM " Renderer", "Indirect Lighting", "Warm-up Frames",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::WarmupFramesCallback),
+            m_warmupFrames, 0, 16, 1, "Reuse");
+        App::AddParam(warmup);
+
         ParamVariant maxTemporalM;
         maxTemporalM.InitInt(ICON_FA_FILM " Renderer", "Indirect Lighting", "M_max (Temporal)",
             fastdelegate::MakeDelegate(this, &IndirectLighting::M_maxTCallback),
@@ -1298,6 +1808,8 @@ void IndirectLighting::ReleaseReSTIR_PT()
 
     m_spatialNeighbor.Reset();
     m_rptTarget.Reset();
+    m_rptWorkList.Reset();
+    m_rptWorkListInit.Reset();
     m_resHeap.Reset();
 
     // Remove parameters and shader reload handlers
@@ -1313,7 +1825,11 @@ void IndirectLighting::ReleaseReSTIR_PT()
     App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Spatial Resample");
     App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Sort (Temporal)");
     App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Sort (Spatial)");
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "GPU-Driven Dispatch");
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Compact Reservoirs");
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "FP16 BSDF");
     App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Temporal Resample");
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Warm-up Frames");
     App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Boiling Suppression");
     App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Lower M-cap Disoccluded");
 }
@@ -1341,7 +1857,7 @@ void IndirectLighting::SwitchToReSTIR_GI(bool skipNonResources)
 
     list.End();
 
-    m_resHeap = GpuMemory::GetResourceHeap(list.TotalSizeInBytes());
+    m_resHeap = GpuMemory::GetResourceHeap("ReSTIR_GI_Reservoirs", list.TotalSizeInBytes());
     auto allocs = list.AllocInfos();
     int currRes = 0;
 
@@ -1380,6 +1896,12 @@ void IndirectLighting::SwitchToReSTIR_GI(bool skipNonResources)
     // Final
     Direct3DUtil::CreateTexture2DUAV(m_final, m_descTable.CPUHandle((int)DESC_TABLE_RGI::FINAL_UAV));
 
+    if (m_rgiResolution != RESTIR_GI_RESOLUTION::FULL)
+        CreateReducedResResources();
+
+    if (m_radianceCache[(int)INTEGRATOR::ReSTIR_GI])
+        CreateRadianceCacheResources();
+
     SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::STOCHASTIC_MULTI_BOUNCE, DefaultParamVals::STOCHASTIC_MULTI_BOUNCE);
 
     // Add ReSTIR GI parameters and shader reload handlers
@@ -1391,6 +1913,12 @@ void IndirectLighting::SwitchToReSTIR_GI(bool skipNonResources)
             DefaultParamVals::STOCHASTIC_MULTI_BOUNCE, "Path Sampling");
         App::AddParam(stochasticMultibounce);
 
+        ParamVariant resolution;
+        resolution.InitEnum(ICON_FA_FILM " Renderer", "Indirect Lighting", "Resolution",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::ResolutionCallback),
+            Params::Resolution, ZetaArrayLen(Params::Resolution), (uint32)m_rgiResolution, "Path Sampling");
+        App::AddParam(resolution);
+
         ParamVariant doTemporal;
         doTemporal.InitBool(ICON_FA_FILM " Renderer", "Indirect Lighting", "Temporal Resample",
             fastdelegate::MakeDelegate(this, &IndirectLighting::TemporalResamplingCallback),
@@ -1409,6 +1937,14 @@ void IndirectLighting::SwitchToReSTIR_GI(bool skipNonResources)
             DefaultParamVals::BOILING_SUPPRESSION, "Reuse");
         App::AddParam(suppressOutliers);
 
+        ParamVariant validationInterval;
+        validationInterval.InitInt(ICON_FA_FILM " Renderer", "Indirect Lighting", "Visibility Revalidation Interval",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::ValidationIntervalCallback),
+            (int)m_cbRGI.ValidationInterval, 1, 8, 1, "Reuse");
+        App::AddParam(validationInterval);
+
+        AddRadianceCacheParams();
+
         App::AddShaderReloadHandler("ReSTIR_GI", fastdelegate::MakeDelegate(this, &IndirectLighting::ReloadRGI));
     }
 }
@@ -1423,17 +1959,252 @@ void IndirectLighting::ReleaseReSTIR_GI()
     }
 
     m_resHeap.Reset();
+    m_rgiSparse.Reset();
+    ReleaseRadianceCacheResources();
+    RemoveRadianceCacheParams();
 
     App::RemoveShaderReloadHandler("ReSTIR_GI");
     App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Stochastic Multi-bounce");
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Resolution");
     App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "M_max (Temporal)");
     App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Boiling Suppression");
     App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Temporal Resample");
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Visibility Revalidation Interval");
+}
+
+void IndirectLighting::CreateReducedResResources()
+{
+    auto& renderer = App::GetRenderer();
+    const auto w = renderer.GetRenderWidth();
+    const auto h = renderer.GetRenderHeight();
+
+    // Only ever accessed as UAV
+    m_rgiSparse = GpuMemory::GetTexture2D("RGI_Sparse",
+        w, h,
+        ResourceFormats_RGI::SPARSE,
+        D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS,
+        TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+    Direct3DUtil::CreateTexture2DUAV(m_rgiSparse, m_descTable.CPUHandle((int)DESC_TABLE_RGI::SPARSE_UAV));
 }
 
 void IndirectLighting::SwitchToPathTracer(bool skipNonResources)
 {
     Direct3DUtil::CreateTexture2DUAV(m_final, m_descTable.CPUHandle((int)DESC_TABLE_RGI::FINAL_UAV));
+
+    if (m_adaptiveSampling)
+        CreateAdaptiveSamplingResources();
+
+    if (!m_tileClassification.IsInitialized())
+        m_tileClassification.Init();
+    else
+        m_tileClassification.OnWindowResized();
+
+    if (m_radianceCache[(int)INTEGRATOR::PATH_TRACING])
+        CreateRadianceCacheResources();
+
+    if (!skipNonResources)
+    {
+        ParamVariant adaptive;
+        adaptive.InitBool(ICON_FA_FILM " Renderer", "Indirect Lighting", "Adaptive Sampling",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::AdaptiveSamplingCallback),
+            m_adaptiveSampling, "Path Sampling");
+        App::AddParam(adaptive);
+
+        ParamVariant targetError;
+        targetError.InitFloat(ICON_FA_FILM " Renderer", "Indirect Lighting", "Target Rel. Error",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::TargetRelErrorCallback),
+            m_cbRGI.TargetRelError, 0.001f, 0.2f, 0.001f, "Path Sampling");
+        App::AddParam(targetError);
+
+        AddRadianceCacheParams();
+    }
+}
+
+void IndirectLighting::ReleasePathTracer()
+{
+    ReleaseAdaptiveSamplingResources();
+    m_tileClassification.Release();
+    ReleaseRadianceCacheResources();
+
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Adaptive Sampling");
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Target Rel. Error");
+    RemoveRadianceCacheParams();
+}
+
+void IndirectLighting::SwitchToProbeVolume(bool skipNonResources)
+{
+    Direct3DUtil::CreateTexture2DUAV(m_final, m_descTable.CPUHandle((int)DESC_TABLE_RGI::FINAL_UAV));
+
+    // Doesn't depend on the render resolution, so survives resizes
+    if (!m_probeMeta.IsInitialized())
+    {
+        const char* names[] = { "ProbeVolume_R", "ProbeVolume_G", "ProbeVolume_B" };
+        static_assert(ZetaArrayLen(names) == ZetaArrayLen(m_probeSH), "Mismatched array lengths.");
+
+        for (int i = 0; i < ZetaArrayLen(m_probeSH); i++)
+        {
+            m_probeSH[i] = GpuMemory::GetTexture3D(names[i],
+                PROBE_VOLUME_DIM_X, PROBE_VOLUME_DIM_Y, PROBE_VOLUME_DIM_Z,
+                ResourceFormats_RGI::PROBE_SH,
+                D3D12_RESOURCE_STATE_COMMON,
+                TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+        }
+
+        m_probeMeta = GpuMemory::GetTexture3D("ProbeVolume_Meta",
+            PROBE_VOLUME_DIM_X, PROBE_VOLUME_DIM_Y, PROBE_VOLUME_DIM_Z,
+            ResourceFormats_RGI::PROBE_META,
+            D3D12_RESOURCE_STATE_COMMON,
+            TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+        // Initial contents are undefined
+        SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES, true);
+        m_firstProbe = 0;
+    }
+
+    for (int i = 0; i < ZetaArrayLen(m_probeSH); i++)
+    {
+        Direct3DUtil::CreateTexture3DUAV(m_probeSH[i],
+            m_descTable.CPUHandle((int)DESC_TABLE_RGI::PROBE_VOLUME_R_UAV + i));
+    }
+
+    Direct3DUtil::CreateTexture3DUAV(m_probeMeta, m_descTable.CPUHandle((int)DESC_TABLE_RGI::PROBE_VOLUME_META_UAV));
+    m_cbRGI.ProbeVolumeDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RGI::PROBE_VOLUME_R_UAV);
+
+    if (!skipNonResources)
+    {
+        ParamVariant spacing;
+        spacing.InitFloat(ICON_FA_FILM " Renderer", "Indirect Lighting", "Probe Spacing",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::ProbeSpacingCallback),
+            m_cbRGI.ProbeSpacing, 0.1f, 10.0f, 0.1f, "Probe Volume");
+        App::AddParam(spacing);
+
+        ParamVariant perFrame;
+        perFrame.InitInt(ICON_FA_FILM " Renderer", "Indirect Lighting", "Probes Updated / Frame",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::ProbesPerFrameCallback),
+            m_probesPerFrame, 64, PROBE_VOLUME_NUM_PROBES, 64, "Probe Volume");
+        App::AddParam(perFrame);
+
+        ParamVariant hysteresis;
+        hysteresis.InitFloat(ICON_FA_FILM " Renderer", "Indirect Lighting", "Hysteresis",
+            fastdelegate::MakeDelegate(this, &IndirectLighting::ProbeHysteresisCallback),
+            m_cbRGI.ProbeHysteresis, 0.0f, 0.999f, 0.01f, "Probe Volume");
+        App::AddParam(hysteresis);
+    }
+}
+
+void IndirectLighting::ReleaseProbeVolume()
+{
+    for (int i = 0; i < ZetaArrayLen(m_probeSH); i++)
+        m_probeSH[i].Reset();
+
+    m_probeMeta.Reset();
+
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Probe Spacing");
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Probes Updated / Frame");
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Hysteresis");
+}
+
+void IndirectLighting::CreateAdaptiveSamplingResources()
+{
+    auto& renderer = App::GetRenderer();
+    const auto w = renderer.GetRenderWidth();
+    const auto h = renderer.GetRenderHeight();
+
+    // Contents don't matter -- moments are reset whenever accumulation restarts
+    m_ptMoments = GpuMemory::GetTexture2D("PT_Moments",
+        w, h,
+        ResourceFormats_RGI::PT_MOMENTS,
+        D3D12_RESOURCE_STATE_COMMON,
+        TEXTURE_FLAGS::ALLOW_UNORDERED_ACCESS);
+
+    Direct3DUtil::CreateTexture2DUAV(m_ptMoments, m_descTable.CPUHandle((int)DESC_TABLE_RGI::PT_MOMENTS_UAV));
+    m_cbRGI.MomentsDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RGI::PT_MOMENTS_UAV);
+
+    const uint32_t numElements = PATH_TRACER_WORK_LIST_HEADER_SIZE + w * h;
+    m_ptWorkList = GpuMemory::GetDefaultHeapBuffer("PT_WorkList", numElements * sizeof(uint32_t),
+        D3D12_RESOURCE_STATE_COMMON, true);
+
+    Direct3DUtil::CreateBufferSRV(m_ptWorkList, m_descTable.CPUHandle((int)DESC_TABLE_RGI::PT_WORK_LIST_SRV),
+        sizeof(uint32_t), numElements);
+    Direct3DUtil::CreateBufferUAV(m_ptWorkList, m_descTable.CPUHandle((int)DESC_TABLE_RGI::PT_WORK_LIST_UAV),
+        sizeof(uint32_t), numElements);
+
+    if (!m_ptWorkListInit.IsInitialized())
+    {
+        // Number of thread groups along Y and number of pixels start at zero
+        uint32_t args[PATH_TRACER_WORK_LIST_HEADER_SIZE] = { PATH_TRACER_WORK_LIST_DISPATCH_DIM_X, 0, 1, 0 };
+
+        m_ptWorkListInit = GpuMemory::GetDefaultHeapBufferAndInit("PT_WorkListInit",
+            sizeof(args), false, MemoryRegion{ .Data = args, .SizeInBytes = sizeof(args) });
+    }
+}
+
+void IndirectLighting::ReleaseAdaptiveSamplingResources()
+{
+    m_ptMoments.Reset();
+    m_ptWorkList.Reset();
+    m_ptWorkListInit.Reset();
+}
+
+void IndirectLighting::CreateRadianceCacheResources()
+{
+    constexpr uint32_t N = RADIANCE_CACHE_NUM_CELLS;
+
+    // Doesn't depend on the render resolution, so survives resizes
+    if (!m_rcKeys.IsInitialized())
+    {
+        m_rcKeys = GpuMemory::GetDefaultHeapBuffer("RadianceCache_Keys", N * sizeof(uint32_t),
+            D3D12_RESOURCE_STATE_COMMON, true, true);
+        m_rcAccum = GpuMemory::GetDefaultHeapBuffer("RadianceCache_Accum", N * sizeof(uint32_t) * 4,
+            D3D12_RESOURCE_STATE_COMMON, true, true);
+        m_rcResolved = GpuMemory::GetDefaultHeapBuffer("RadianceCache_Resolved", N * sizeof(uint32_t) * 2,
+            D3D12_RESOURCE_STATE_COMMON, true, true);
+    }
+
+    Direct3DUtil::CreateBufferUAV(m_rcKeys, m_descTable.CPUHandle((int)DESC_TABLE_RGI::RADIANCE_CACHE_KEYS_UAV),
+        sizeof(uint32_t), N);
+    Direct3DUtil::CreateBufferUAV(m_rcAccum, m_descTable.CPUHandle((int)DESC_TABLE_RGI::RADIANCE_CACHE_ACCUM_UAV),
+        sizeof(uint32_t) * 4, N);
+    Direct3DUtil::CreateBufferUAV(m_rcResolved, m_descTable.CPUHandle((int)DESC_TABLE_RGI::RADIANCE_CACHE_RESOLVED_UAV),
+        sizeof(uint32_t) * 2, N);
+
+    m_cbRGI.RadianceCacheDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE_RGI::RADIANCE_CACHE_KEYS_UAV);
+}
+
+void IndirectLighting::ReleaseRadianceCacheResources()
+{
+    m_rcKeys.Reset();
+    m_rcAccum.Reset();
+    m_rcResolved.Reset();
+}
+
+void IndirectLighting::AddRadianceCacheParams()
+{
+    ParamVariant enable;
+    enable.InitBool(ICON_FA_FILM " Renderer", "Indirect Lighting", "Radiance Cache",
+        fastdelegate::MakeDelegate(this, &IndirectLighting::RadianceCacheCallback),
+        m_radianceCache[(int)m_method], "Radiance Cache");
+    App::AddParam(enable);
+
+    ParamVariant cellSize;
+    cellSize.InitFloat(ICON_FA_FILM " Renderer", "Indirect Lighting", "Cell Size",
+        fastdelegate::MakeDelegate(this, &IndirectLighting::RadianceCacheCellSizeCallback),
+        m_cbRGI.RadianceCacheCellSize, 0.005f, 1.0f, 0.005f, "Radiance Cache");
+    App::AddParam(cellSize);
+
+    ParamVariant spread;
+    spread.InitFloat(ICON_FA_FILM " Renderer", "Indirect Lighting", "Path Spread",
+        fastdelegate::MakeDelegate(this, &IndirectLighting::RadianceCacheSpreadCallback),
+        m_cbRGI.RadianceCacheSpread, 0.0f, 16.0f, 0.25f, "Radiance Cache");
+    App::AddParam(spread);
+}
+
+void IndirectLighting::RemoveRadianceCacheParams()
+{
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Radiance Cache");
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Cell Size");
+    App::RemoveParam(ICON_FA_FILM " Renderer", "Indirect Lighting", "Path Spread");
 }
 
 void IndirectLighting::ResetIntegrator(bool resetAllResources, bool skipNonResources)
@@ -1458,11 +2229,14 @@ void IndirectLighting::ResetIntegrator(bool resetAllResources, bool skipNonResou
         SwitchToReSTIR_PT(skipNonResources);
     else if (m_method == INTEGRATOR::ReSTIR_GI)
         SwitchToReSTIR_GI(skipNonResources);
+    else if (m_method == INTEGRATOR::PROBE_VOLUME)
+        SwitchToProbeVolume(skipNonResources);
     else
         SwitchToPathTracer(skipNonResources);
 
     m_isTemporalReservoirValid = false;
     m_currTemporalIdx = 0;
+    m_framesSinceReset = 0;
 }
 
 void IndirectLighting::MaxNonTrBouncesCallback(const Support::ParamVariant& p)
@@ -1517,6 +2291,12 @@ void IndirectLighting::SpatialResamplingCallback(const Support::ParamVariant& p)
     App::GetScene().SceneModified();
 }
 
+void IndirectLighting::WarmupFramesCallback(const Support::ParamVariant& p)
+{
+    m_warmupFrames = p.GetInt().m_value;
+    m_framesSinceReset = Min(m_framesSinceReset, m_warmupFrames);
+}
+
 void IndirectLighting::M_maxTCallback(const Support::ParamVariant& p)
 {
     auto newM = (uint16_t)p.GetInt().m_value;
@@ -1560,6 +2340,30 @@ void IndirectLighting::SortSpatialCallback(const Support::ParamVariant& p)
     SET_CB_FLAG(m_cbRPT_Reuse, CB_IND_FLAGS::SORT_SPATIAL, p.GetBool());
 }
 
+void IndirectLighting::GpuDrivenDispatchCallback(const Support::ParamVariant& p)
+{
+    m_gpuDrivenDispatch = p.GetBool();
+}
+
+void IndirectLighting::GroupSharedSpatialCallback(const Support::ParamVariant& p)
+{
+    m_groupSharedSpatial = p.GetBool();
+}
+
+void IndirectLighting::CompactReservoirsCallback(const Support::ParamVariant& p)
+{
+    m_compactReservoirs = p.GetBool();
+
+    // Reservoir formats have changed, recreate ReSTIR PT's resources while keeping 
+    // the parameters
+    ResetIntegrator(false, true);
+}
+
+void IndirectLighting::FP16BSDFCallback(const Support::ParamVariant& p)
+{
+    m_fp16BSDF = p.GetBool();
+}
+
 void IndirectLighting::TexFilterCallback(const Support::ParamVariant& p)
 {
     auto newVal = EnumToSamplerIdx((TEXTURE_FILTER)p.GetEnum().m_curr);
@@ -1572,6 +2376,94 @@ void IndirectLighting::TexFilterCallback(const Support::ParamVariant& p)
     App::GetScene().SceneModified();
 }
 
+void IndirectLighting::ReorderThreadsCallback(const Support::ParamVariant& p)
+{
+    SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::REORDER_THREADS, p.GetBool());
+}
+
+void IndirectLighting::AdaptiveSamplingCallback(const Support::ParamVariant& p)
+{
+    m_adaptiveSampling = p.GetBool();
+
+    if (m_adaptiveSampling)
+        CreateAdaptiveSamplingResources();
+    else
+        ReleaseAdaptiveSamplingResources();
+
+    // Restart accumulation so that moments start from a clean state
+    App::GetScene().SceneModified();
+}
+
+void IndirectLighting::TargetRelErrorCallback(const Support::ParamVariant& p)
+{
+    m_cbRGI.TargetRelError = p.GetFloat().m_value;
+}
+
+void IndirectLighting::ResolutionCallback(const Support::ParamVariant& p)
+{
+    const auto newVal = (RESTIR_GI_RESOLUTION)p.GetEnum().m_curr;
+    if (newVal == m_rgiResolution)
+        return;
+
+    m_rgiResolution = newVal;
+
+    if (m_rgiResolution == RESTIR_GI_RESOLUTION::FULL)
+        m_rgiSparse.Reset();
+    else if (!m_rgiSparse.IsInitialized())
+        CreateReducedResResources();
+
+    // Reservoirs of pixels that aren't traced anymore are outdated
+    ResetTemporal();
+    App::GetScene().SceneModified();
+}
+
+void IndirectLighting::RadianceCacheCallback(const Support::ParamVariant& p)
+{
+    Assert(m_method != INTEGRATOR::ReSTIR_PT, "Radiance cache isn't supported for ReSTIR PT.");
+    m_radianceCache[(int)m_method] = p.GetBool();
+
+    if (m_radianceCache[(int)m_method])
+        CreateRadianceCacheResources();
+    else
+        ReleaseRadianceCacheResources();
+
+    App::GetScene().SceneModified();
+}
+
+void IndirectLighting::RadianceCacheCellSizeCallback(const Support::ParamVariant& p)
+{
+    m_cbRGI.RadianceCacheCellSize = p.GetFloat().m_value;
+
+    // Existing cells were keyed with the old size
+    SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES, true);
+    App::GetScene().SceneModified();
+}
+
+void IndirectLighting::RadianceCacheSpreadCallback(const Support::ParamVariant& p)
+{
+    m_cbRGI.RadianceCacheSpread = p.GetFloat().m_value;
+    App::GetScene().SceneModified();
+}
+
+void IndirectLighting::ProbeSpacingCallback(const Support::ParamVariant& p)
+{
+    m_cbRGI.ProbeSpacing = p.GetFloat().m_value;
+
+    // Probes were placed with the old spacing
+    SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES, true);
+    App::GetScene().SceneModified();
+}
+
+void IndirectLighting::ProbesPerFrameCallback(const Support::ParamVariant& p)
+{
+    m_probesPerFrame = p.GetInt().m_value;
+}
+
+void IndirectLighting::ProbeHysteresisCallback(const Support::ParamVariant& p)
+{
+    m_cbRGI.ProbeHysteresis = p.GetFloat().m_value;
+}
+
 void IndirectLighting::BoilingSuppressionCallback(const Support::ParamVariant& p)
 {
     SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::BOILING_SUPPRESSION, p.GetBool());
@@ -1581,6 +2473,11 @@ void IndirectLighting::BoilingSuppressionCallback(const Support::ParamVariant& p
     App::GetScene().SceneModified();
 }
 
+void IndirectLighting::ValidationIntervalCallback(const Support::ParamVariant& p)
+{
+    m_cbRGI.ValidationInterval = (uint32_t)p.GetInt().m_value;
+}
+
 void IndirectLighting::PathRegularizationCallback(const Support::ParamVariant& p)
 {
     SET_CB_FLAG(m_cbRGI, CB_IND_FLAGS::PATH_REGULARIZATION, p.GetBool());
@@ -1609,7 +2506,12 @@ void IndirectLighting::ReloadRGI()
         p = "IndirectLighting\\ReSTIR_GI\\Variants\\ReSTIR_GI_WoPS.hlsl";
         sh = SHADER::ReSTIR_GI_WoPS;
 
-        if (m_preSampling)
+        if (m_useLightBVH)
+        {
+            p = "IndirectLighting\\ReSTIR_GI\\Variants\\ReSTIR_GI_LBVH.hlsl";
+            sh = SHADER::ReSTIR_GI_LBVH;
+        }
+        else if (m_preSampling)
         {
             p = "IndirectLighting\\ReSTIR_GI\\Variants\\ReSTIR_GI_WPS.hlsl";
             sh = SHADER::ReSTIR_GI_WPS;
@@ -1628,167 +2530,37 @@ void IndirectLighting::ReloadRGI()
 
 void IndirectLighting::ReloadRPT_PathTrace()
 {
-    auto sh = SHADER::ReSTIR_PT_PATH_TRACE;
-    const char* p = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_PathTrace.hlsl";
-
-    if (App::GetScene().EmissiveLighting())
-    {
-        p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_PathTrace_WoPS.hlsl";
-        sh = SHADER::ReSTIR_PT_PATH_TRACE_WoPS;
-
-        if (m_preSampling)
-        {
-            p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_PathTrace_WPS.hlsl";
-            sh = SHADER::ReSTIR_PT_PATH_TRACE_WPS;
-        }
-    }
-
-    const int i = (int)sh;
-    m_psoLib.Reload(i, m_rootSigObj.Get(), p);
+    m_psoLib.ReloadPermutations((int)SHADER::ReSTIR_PT_PATH_TRACE, m_rootSigObj.Get(), 
+        RPT_PATH_TRACE_PERMUTATIONS);
 }
 
 void IndirectLighting::ReloadRPT_Temporal()
 {
-    TaskSet ts;
-
-    ts.EmplaceTask("Reload_Reconnect_CtT", [this]()
-        {
-            auto sh = SHADER::ReSTIR_PT_RECONNECT_CtT;
-            const char* p = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_Reconnect_CtT.hlsl";
-
-            if (App::GetScene().EmissiveLighting())
-            {
-                sh = SHADER::ReSTIR_PT_RECONNECT_CtT_E;
-                p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_Reconnect_CtT_E.hlsl";
-            }
-
-            const int i = (int)sh;
-            m_psoLib.Reload(i, m_rootSigObj.Get(), p, false);
-        });
-
-    ts.EmplaceTask("Reload_Reconnect_TtC", [this]()
-        {
-            auto sh = SHADER::ReSTIR_PT_RECONNECT_TtC;
-            const char* p = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_Reconnect_TtC.hlsl";
-
-            if (App::GetScene().EmissiveLighting())
-            {
-                sh = SHADER::ReSTIR_PT_RECONNECT_TtC_E;
-                p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_Reconnect_TtC_E.hlsl";
-            }
-
-            const int i = (int)sh;
-            m_psoLib.Reload(i, m_rootSigObj.Get(), p, false);
-        });
-
-    ts.EmplaceTask("Reload_Replay_CtT", [this]()
-        {
-            auto sh = SHADER::ReSTIR_PT_REPLAY_CtT;
-            const char* p = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_Replay.hlsl";
-
-            if (App::GetScene().EmissiveLighting())
-            {
-                sh = SHADER::ReSTIR_PT_REPLAY_CtT_E;
-                p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_Replay_E.hlsl";
-            }
-
-            const int i = (int)sh;
-            m_psoLib.Reload(i, m_rootSigObj.Get(), p, false);
-        });
-
-    WaitObject waitObj;
-    ts.Sort();
-    ts.Finalize(&waitObj);
-    App::Submit(ZetaMove(ts));
-
-    auto sh = SHADER::ReSTIR_PT_REPLAY_TtC;
-    const char* p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_Replay_TtC.hlsl";
-
-    if (App::GetScene().EmissiveLighting())
-    {
-        sh = SHADER::ReSTIR_PT_REPLAY_TtC_E;
-        p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_Replay_TtC_E.hlsl";
-    }
-
-    const int i = (int)sh;
-    m_psoLib.Reload(i, m_rootSigObj.Get(), p, false);
-
-    waitObj.Wait();
+    // Only the permutations that have been used so far are recompiled
+    m_psoLib.ReloadPermutations((int)SHADER::ReSTIR_PT_RECONNECT_CtT, m_rootSigObj.Get(), 
+        RPT_RECONNECT_CtT_PERMUTATIONS);
+    m_psoLib.ReloadPermutations((int)SHADER::ReSTIR_PT_RECONNECT_TtC, m_rootSigObj.Get(), 
+        RPT_RECONNECT_TtC_PERMUTATIONS);
+    m_psoLib.ReloadPermutations((int)SHADER::ReSTIR_PT_REPLAY, m_rootSigObj.Get(), 
+        RPT_REPLAY_PERMUTATIONS);
 }
 
 void IndirectLighting::ReloadRPT_Spatial()
 {
-    TaskSet ts;
-
-    ts.EmplaceTask("Reload_Reconnect_CtS", [this]()
-        {
-            auto sh = SHADER::ReSTIR_PT_RECONNECT_CtS;
-            const char* p = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_Reconnect_CtS.hlsl";
-
-            if (App::GetScene().EmissiveLighting())
-            {
-                sh = SHADER::ReSTIR_PT_RECONNECT_CtS_E;
-                p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_Reconnect_CtS_E.hlsl";
-            }
-
-            const int i = (int)sh;
-            m_psoLib.Reload(i, m_rootSigObj.Get(), p, false);
-        });
-
-    ts.EmplaceTask("Reload_Reconnect_StC", [this]()
-        {
-            auto sh = SHADER::ReSTIR_PT_RECONNECT_StC;
-            const char* p = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_Reconnect_StC.hlsl";
-
-            if (App::GetScene().EmissiveLighting())
-            {
-                sh = SHADER::ReSTIR_PT_RECONNECT_StC_E;
-                p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_Reconnect_StC_E.hlsl";
-            }
-
-            const int i = (int)sh;
-            m_psoLib.Reload(i, m_rootSigObj.Get(), p, false);
-        });
-
-    ts.EmplaceTask("Reload_Replay_CtS", [this]()
-        {
-            auto sh = SHADER::ReSTIR_PT_REPLAY_CtS;
-            const char* p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_Replay_CtS.hlsl";
-
-            if (App::GetScene().EmissiveLighting())
-            {
-                sh = SHADER::ReSTIR_PT_REPLAY_CtS_E;
-                p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_Replay_CtS_E.hlsl";
-            }
-
-            const int i = (int)sh;
-            m_psoLib.Reload(i, m_rootSigObj.Get(), p, false);
-        });
-
-    WaitObject waitObj;
-    ts.Sort();
-    ts.Finalize(&waitObj);
-    App::Submit(ZetaMove(ts));
-
-    auto sh = SHADER::ReSTIR_PT_REPLAY_StC;
-    const char* p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_Replay_StC.hlsl";
-
-    if (App::GetScene().EmissiveLighting())
-    {
-        sh = SHADER::ReSTIR_PT_REPLAY_StC_E;
-        p = "IndirectLighting\\ReSTIR_PT\\Variants\\ReSTIR_PT_Replay_StC_E.hlsl";
-    }
-
-    const int i = (int)sh;
-    m_psoLib.Reload(i, m_rootSigObj.Get(), p, false);
-
-    waitObj.Wait();
+    m_psoLib.ReloadPermutations((int)SHADER::ReSTIR_PT_RECONNECT_CtS, m_rootSigObj.Get(), 
+        RPT_RECONNECT_CtS_PERMUTATIONS);
+    m_psoLib.ReloadPermutations((int)SHADER::ReSTIR_PT_RECONNECT_StC, m_rootSigObj.Get(), 
+        RPT_RECONNECT_StC_PERMUTATIONS);
+    m_psoLib.ReloadPermutations((int)SHADER::ReSTIR_PT_REPLAY, m_rootSigObj.Get(), 
+        RPT_REPLAY_PERMUTATIONS);
 }
 
 void IndirectLighting::ReloadRPT_SpatialSearch()
 {
-    const int i = (int)SHADER::ReSTIR_PT_SPATIAL_SEARCH;
-    m_psoLib.Reload(i, m_rootSigObj.Get(), 
+    const int i = m_groupSharedSpatial ? (int)SHADER::ReSTIR_PT_SPATIAL_SEARCH_SHARED :
+        (int)SHADER::ReSTIR_PT_SPATIAL_SEARCH;
+    m_psoLib.Reload(i, m_rootSigObj.Get(), m_groupSharedSpatial ?
+        "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_SpatialSearch_Shared.hlsl" :
         "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_SpatialSearch.hlsl");
 }
 
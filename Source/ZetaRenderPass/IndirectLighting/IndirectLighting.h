@@ -3,6 +3,7 @@
 #include "../RenderPass.h"
 #include <Core/GpuMemory.h>
 #include "IndirectLighting_Common.h"
+#include "../TileClassification/TileClassification.h"
 
 namespace ZetaRay::Core
 {
@@ -22,35 +23,31 @@ namespace ZetaRay::RenderPass
         PATH_TRACER,
         PATH_TRACER_WoPS,
         PATH_TRACER_WPS,
+        PATH_TRACER_LBVH,
+        PATH_TRACER_WORK_LIST,
         ReSTIR_GI,
         ReSTIR_GI_WoPS,
         ReSTIR_GI_WPS,
         ReSTIR_GI_LVG,
-        ReSTIR_PT_PATH_TRACE,
-        ReSTIR_PT_PATH_TRACE_WoPS,
-        ReSTIR_PT_PATH_TRACE_WPS,
-        ReSTIR_PT_SORT_CtT,
-        ReSTIR_PT_SORT_TtC,
-        ReSTIR_PT_SORT_CtS,
-        ReSTIR_PT_SORT_StC,
-        ReSTIR_PT_REPLAY_CtT,
-        ReSTIR_PT_REPLAY_CtT_E,
-        ReSTIR_PT_REPLAY_TtC,
-        ReSTIR_PT_REPLAY_TtC_E,
-        ReSTIR_PT_REPLAY_CtS,
-        ReSTIR_PT_REPLAY_CtS_E,
-        ReSTIR_PT_REPLAY_StC,
-        ReSTIR_PT_REPLAY_StC_E,
-        ReSTIR_PT_RECONNECT_CtT,
-        ReSTIR_PT_RECONNECT_CtT_E,
-        ReSTIR_PT_RECONNECT_TtC,
-        ReSTIR_PT_RECONNECT_TtC_E,
-        ReSTIR_PT_RECONNECT_CtS,
-        ReSTIR_PT_RECONNECT_CtS_E,
-        ReSTIR_PT_RECONNECT_StC,
-        ReSTIR_PT_RECONNECT_StC_E,
+        ReSTIR_GI_LBVH,
+        ReSTIR_GI_UPSAMPLE,
         ReSTIR_PT_SPATIAL_SEARCH,
-        COUNT
+        ReSTIR_PT_SPATIAL_SEARCH_SHARED,
+        RADIANCE_CACHE_RESOLVE,
+        PROBE_VOLUME_UPDATE,
+        PROBE_VOLUME_UPDATE_WoPS,
+        PROBE_VOLUME_UPDATE_LBVH,
+        PROBE_VOLUME_SAMPLE,
+        // Shader permutations -- each one takes up 2^(#defines) consecutive slots starting 
+        // from its base shader. See IndirectLighting::RPT_*_PERMUTATIONS.
+        ReSTIR_PT_PATH_TRACE,
+        ReSTIR_PT_SORT = ReSTIR_PT_PATH_TRACE + 8,
+        ReSTIR_PT_REPLAY = ReSTIR_PT_SORT + 8,
+        ReSTIR_PT_RECONNECT_CtT = ReSTIR_PT_REPLAY + 16,
+        ReSTIR_PT_RECONNECT_TtC = ReSTIR_PT_RECONNECT_CtT + 2,
+        ReSTIR_PT_RECONNECT_CtS = ReSTIR_PT_RECONNECT_TtC + 2,
+        ReSTIR_PT_RECONNECT_StC = ReSTIR_PT_RECONNECT_CtS + 2,
+        COUNT = ReSTIR_PT_RECONNECT_StC + 2
     };
 
     struct IndirectLighting final : public RenderPassBase<(int)INDIRECT_SHADER::COUNT>
@@ -66,13 +63,15 @@ namespace ZetaRay::RenderPass
             PATH_TRACING,
             ReSTIR_GI,
             ReSTIR_PT,
+            // Diffuse-only irradiance probes, see PROBE_VOLUME_* in IndirectLighting_Common.h
+            PROBE_VOLUME,
             COUNT
         };
 
         IndirectLighting();
         ~IndirectLighting() = default;
 
-        void InitPSOs();
+        void InitPSOs(INTEGRATOR method);
         void Init(INTEGRATOR method);
         void OnWindowResized();
         void ResetTemporal();
@@ -100,18 +99,36 @@ namespace ZetaRay::RenderPass
             m_cbRGI.Extents_xy = (extH.y << 16) | extH.x;
             m_cbRGI.Extents_z_Offset_y = (extH.w << 16) | extH.z;
         }
+        // Only used by path tracing and ReSTIR GI. ReSTIR PT's shift mapping needs light 
+        // source pdfs that don't depend on the shading point, so it keeps using the alias table.
+        void SetLightBVH(bool enabled) { m_useLightBVH = enabled; }
+        // ReSTIR GI only. Pixels are fully resampled once every "interval" (1, 2 or 4) 
+        // frames, the rest only reuse their temporal reservoir.
+        void SetResamplingInterval(uint32_t interval)
+        {
+            Assert(interval == 1 || interval == 2 || interval == 4, "Invalid resampling interval.");
+            m_cbRGI.ResamplingInterval = interval;
+        }
+        // Path tracing only. Corresponding UI params aren't updated.
+        void SetAdaptiveSampling(bool enabled, float targetRelError);
         const Core::GpuMemory::Texture& GetOutput(SHADER_OUT_RES i) const
         {
             Assert(i == SHADER_OUT_RES::FINAL, "Invalid shader output.");
             return m_final;
         }
         void Render(Core::CommandList& cmdList);
+        // ReSTIR PT can be recorded into multiple command lists -- path tracing, temporal
+        // resampling and spatial resampling (see RenderGraph::RegisterRenderPass())
+        static constexpr int NUM_RPT_SUB_CMD_LISTS = 3;
+        void RenderSubCmdList(Core::CommandList& cmdList, int subCmdListIdx);
+        ZetaInline INTEGRATOR GetMethod() const { return m_method; }
 
     private:
+        static constexpr int MAX_NUM_SPATIAL_PASSES = 2;
         static constexpr int NUM_CBV = 1;
-        static constexpr int NUM_SRV = 9;
+        static constexpr int NUM_SRV = 11;
         static constexpr int NUM_UAV = 0;
-        static constexpr int NUM_GLOBS = 10;
+        static constexpr int NUM_GLOBS = 12;
         static constexpr int NUM_CONSTS = (int)Math::Max(sizeof(cb_ReSTIR_GI) / sizeof(DWORD),
             Math::Max(sizeof(cb_ReSTIR_PT_PathTrace) / sizeof(DWORD),
                       sizeof(cb_ReSTIR_PT_Reuse) / sizeof(DWORD)));
@@ -119,10 +136,21 @@ namespace ZetaRay::RenderPass
 
         struct ResourceFormats_RGI
         {
+#if RESTIR_GI_COMPACT_RESERVOIRS == 1
+            static constexpr DXGI_FORMAT RESERVOIR_A = DXGI_FORMAT_R32G32B32A32_UINT;
+            static constexpr DXGI_FORMAT RESERVOIR_B = DXGI_FORMAT_R11G11B10_FLOAT;
+            static constexpr DXGI_FORMAT RESERVOIR_C = DXGI_FORMAT_R32G32_UINT;
+#else
             static constexpr DXGI_FORMAT RESERVOIR_A = DXGI_FORMAT_R32G32B32A32_FLOAT;
             static constexpr DXGI_FORMAT RESERVOIR_B = DXGI_FORMAT_R16G16B16A16_FLOAT;
             static constexpr DXGI_FORMAT RESERVOIR_C = DXGI_FORMAT_R32G32B32A32_FLOAT;
+#endif
+            // Holds running sums when accumulating, which compact formats can't represent
             static constexpr DXGI_FORMAT FINAL = DXGI_FORMAT_R32G32B32A32_FLOAT;
+            static constexpr DXGI_FORMAT PT_MOMENTS = DXGI_FORMAT_R32G32B32A32_FLOAT;
+            static constexpr DXGI_FORMAT SPARSE = DXGI_FORMAT_R16G16B16A16_FLOAT;
+            static constexpr DXGI_FORMAT PROBE_SH = DXGI_FORMAT_R16G16B16A16_FLOAT;
+            static constexpr DXGI_FORMAT PROBE_META = DXGI_FORMAT_R32_UINT;
         };
 
         struct ResourceFormats_RPT
@@ -141,6 +169,9 @@ namespace ZetaRay::RenderPass
             static constexpr DXGI_FORMAT RBUFFER_C = DXGI_FORMAT_R32G32B32A32_UINT;
             static constexpr DXGI_FORMAT RBUFFER_D = DXGI_FORMAT_R16_UINT;
             static constexpr DXGI_FORMAT TARGET = DXGI_FORMAT_R32G32B32A32_FLOAT;
+            // Compact layout
+            static constexpr DXGI_FORMAT RESERVOIR_B_COMPACT = DXGI_FORMAT_R16G16_FLOAT;
+            static constexpr DXGI_FORMAT TARGET_COMPACT = DXGI_FORMAT_R16G16B16A16_FLOAT;
         };
 
         enum class DESC_TABLE_RGI
@@ -161,6 +192,21 @@ namespace ZetaRay::RenderPass
             //
             FINAL_UAV,
             //
+            PT_MOMENTS_UAV,
+            PT_WORK_LIST_SRV,
+            PT_WORK_LIST_UAV,
+            //
+            SPARSE_UAV,
+            //
+            RADIANCE_CACHE_KEYS_UAV,
+            RADIANCE_CACHE_ACCUM_UAV,
+            RADIANCE_CACHE_RESOLVED_UAV,
+            //
+            PROBE_VOLUME_R_UAV,
+            PROBE_VOLUME_G_UAV,
+            PROBE_VOLUME_B_UAV,
+            PROBE_VOLUME_META_UAV,
+            //
             COUNT
         };
 
@@ -221,6 +267,9 @@ namespace ZetaRay::RenderPass
             SPATIAL_NEIGHBOR_SRV,
             SPATIAL_NEIGHBOR_UAV,
             //
+            WORK_LIST_SRV,
+            WORK_LIST_UAV,
+            //
             TARGET_UAV,
             //
             FINAL_UAV,
@@ -231,6 +280,8 @@ namespace ZetaRay::RenderPass
         struct DefaultParamVals
         {
             static constexpr int M_MAX = 10;
+            // Visibility of reused temporal samples is retraced every frame
+            static constexpr int VALIDATION_INTERVAL = 1;
             static constexpr int M_MAX_SPATIAL = 8;
             static constexpr int MAX_NON_TR_BOUNCES = 3;
             static constexpr int MAX_GLOSSY_TR_BOUNCES = 4;
@@ -241,6 +292,21 @@ namespace ZetaRay::RenderPass
             static constexpr float ROUGHNESS_MIN = 0.175f;
             static constexpr float D_MIN = 1e-4f;
             static constexpr TEXTURE_FILTER TEX_FILTER = TEXTURE_FILTER::ANISOTROPIC_4X;
+            static constexpr bool GPU_DRIVEN_DISPATCH = true;
+            static constexpr bool COMPACT_RESERVOIRS = false;
+            static constexpr bool FP16_BSDF = false;
+            static constexpr int WARMUP_FRAMES = 4;
+            static constexpr bool ADAPTIVE_SAMPLING = false;
+            static constexpr float TARGET_REL_ERROR = 0.02f;
+            static constexpr bool REORDER_THREADS = false;
+            static constexpr RESTIR_GI_RESOLUTION RGI_RESOLUTION = RESTIR_GI_RESOLUTION::FULL;
+            static constexpr bool RADIANCE_CACHE = false;
+            static constexpr float RADIANCE_CACHE_CELL_SIZE = 0.05f;
+            static constexpr float RADIANCE_CACHE_SPREAD = 2.0f;
+            static constexpr float PROBE_SPACING = 1.0f;
+            // Whole volume is refreshed once every 16 frames
+            static constexpr int PROBES_PER_FRAME = 1024;
+            static constexpr float PROBE_HYSTERESIS = 0.97f;
         };
 
         struct Params
@@ -252,42 +318,95 @@ namespace ZetaRay::RenderPass
             inline static const char* TextureFilter[] = { "Mip 0", "Tri-linear", "Anisotropic (2x)", 
                 "Anisotropic (4x)", "Anisotropic (16x)" };
             static_assert((int)TEXTURE_FILTER::COUNT == ZetaArrayLen(TextureFilter), "enum <-> strings mismatch.");
+
+            inline static const char* Resolution[] = { "Full", "Checkerboard", "Half" };
+            static_assert((int)RESTIR_GI_RESOLUTION::COUNT == ZetaArrayLen(Resolution), "enum <-> strings mismatch.");
         };
 
-        inline static constexpr const char* COMPILED_CS[(int)SHADER::COUNT] = {
+        // Shaders without permutations
+        static constexpr int NUM_NON_PERMUTED = (int)SHADER::ReSTIR_PT_PATH_TRACE;
+
+        inline static constexpr const char* COMPILED_CS[NUM_NON_PERMUTED] = {
             "PathTracer_cs.cso",
             "PathTracer_WoPS_cs.cso",
             "PathTracer_WPS_cs.cso",
+            "PathTracer_LBVH_cs.cso",
+            "PathTracer_WorkList_cs.cso",
             "ReSTIR_GI_cs.cso",
             "ReSTIR_GI_WoPS_cs.cso",
             "ReSTIR_GI_WPS_cs.cso",
             "ReSTIR_GI_LVG_cs.cso",
-            "ReSTIR_PT_PathTrace_cs.cso",
-            "ReSTIR_PT_PathTrace_WoPS_cs.cso",
-            "ReSTIR_PT_PathTrace_WPS_cs.cso",
-            "ReSTIR_PT_Sort_cs.cso",
-            "ReSTIR_PT_Sort_TtC_cs.cso",
-            "ReSTIR_PT_Sort_CtS_cs.cso",
-            "ReSTIR_PT_Sort_StC_cs.cso",
-            "ReSTIR_PT_Replay_cs.cso",
-            "ReSTIR_PT_Replay_E_cs.cso",
-            "ReSTIR_PT_Replay_TtC_cs.cso",
-            "ReSTIR_PT_Replay_TtC_E_cs.cso",
-            "ReSTIR_PT_Replay_CtS_cs.cso",
-            "ReSTIR_PT_Replay_CtS_E_cs.cso",
-            "ReSTIR_PT_Replay_StC_cs.cso",
-            "ReSTIR_PT_Replay_StC_E_cs.cso",
-            "ReSTIR_PT_Reconnect_CtT_cs.cso",
-            "ReSTIR_PT_Reconnect_CtT_E_cs.cso",
-            "ReSTIR_PT_Reconnect_TtC_cs.cso",
-            "ReSTIR_PT_Reconnect_TtC_E_cs.cso",
-            "ReSTIR_PT_Reconnect_CtS_cs.cso",
-            "ReSTIR_PT_Reconnect_CtS_E_cs.cso",
-            "ReSTIR_PT_Reconnect_StC_cs.cso",
-            "ReSTIR_PT_Reconnect_StC_E_cs.cso",
-            "ReSTIR_PT_SpatialSearch_cs.cso"
+            "ReSTIR_GI_LBVH_cs.cso",
+            "ReSTIR_GI_Upsample_cs.cso",
+            "ReSTIR_PT_SpatialSearch_cs.cso",
+            "ReSTIR_PT_SpatialSearch_Shared_cs.cso",
+            "RadianceCache_Resolve_cs.cso",
+            "ProbeVolume_Update_cs.cso",
+            "ProbeVolume_Update_WoPS_cs.cso",
+            "ProbeVolume_Update_LBVH_cs.cso",
+            "ProbeVolume_Sample_cs.cso"
         };
 
+        // Permutation keys, bit i corresponds to Defines[i] of the respective desc
+        struct RPT_PERMUTATION
+        {
+            // Path trace
+            static constexpr uint32_t PT_EMISSIVE = 1 << 0;
+            static constexpr uint32_t PT_PRESAMPLED_SETS = 1 << 1;
+            static constexpr uint32_t PT_FP16_BSDF = 1 << 2;
+            // Sort & replay (no bits set means current to temporal)
+            static constexpr uint32_t TtC = 1 << 0;
+            static constexpr uint32_t CtS = 1 << 1;
+            static constexpr uint32_t StC = 1 << 2;
+            static constexpr uint32_t REPLAY_EMISSIVE = 1 << 3;
+            // Reconnect
+            static constexpr uint32_t RECONNECT_EMISSIVE = 1 << 0;
+        };
+
+        // Precompiled permutations are listed in ShaderPermutations.txt
+        static constexpr Core::ShaderPermutationDesc RPT_PATH_TRACE_PERMUTATIONS = {
+            .PathToHlsl = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_PathTrace.hlsl",
+            .Defines = { "NEE_EMISSIVE=1", "USE_PRESAMPLED_SETS", "BSDF_FP16=1" },
+            .Suffixes = { "E", "PS", "H" },
+            .NumDefines = 3 };
+        static constexpr Core::ShaderPermutationDesc RPT_SORT_PERMUTATIONS = {
+            .PathToHlsl = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_Sort.hlsl",
+            .Defines = { "TEMPORAL_TO_CURRENT", "CURRENT_TO_SPATIAL", "SPATIAL_TO_CURRENT" },
+            .Suffixes = { "TtC", "CtS", "StC" },
+            .NumDefines = 3 };
+        static constexpr Core::ShaderPermutationDesc RPT_REPLAY_PERMUTATIONS = {
+            .PathToHlsl = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_Replay.hlsl",
+            .Defines = { "TEMPORAL_TO_CURRENT", "CURRENT_TO_SPATIAL", "SPATIAL_TO_CURRENT", "NEE_EMISSIVE=1" },
+            .Suffixes = { "TtC", "CtS", "StC", "E" },
+            .NumDefines = 4 };
+        static constexpr Core::ShaderPermutationDesc RPT_RECONNECT_CtT_PERMUTATIONS = {
+            .PathToHlsl = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_Reconnect_CtT.hlsl",
+            .Defines = { "NEE_EMISSIVE=1" },
+            .Suffixes = { "E" },
+            .NumDefines = 1 };
+        static constexpr Core::ShaderPermutationDesc RPT_RECONNECT_TtC_PERMUTATIONS = {
+            .PathToHlsl = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_Reconnect_TtC.hlsl",
+            .Defines = { "NEE_EMISSIVE=1" },
+            .Suffixes = { "E" },
+            .NumDefines = 1 };
+        static constexpr Core::ShaderPermutationDesc RPT_RECONNECT_CtS_PERMUTATIONS = {
+            .PathToHlsl = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_Reconnect_CtS.hlsl",
+            .Defines = { "NEE_EMISSIVE=1" },
+            .Suffixes = { "E" },
+            .NumDefines = 1 };
+        static constexpr Core::ShaderPermutationDesc RPT_RECONNECT_StC_PERMUTATIONS = {
+            .PathToHlsl = "IndirectLighting\\ReSTIR_PT\\ReSTIR_PT_Reconnect_StC.hlsl",
+            .Defines = { "NEE_EMISSIVE=1" },
+            .Suffixes = { "E" },
+            .NumDefines = 1 };
+
+        static_assert((int)SHADER::ReSTIR_PT_SORT - (int)SHADER::ReSTIR_PT_PATH_TRACE == 
+            RPT_PATH_TRACE_PERMUTATIONS.NumPermutations(), "PSO slots don't match the number of permutations.");
+        static_assert((int)SHADER::ReSTIR_PT_REPLAY - (int)SHADER::ReSTIR_PT_SORT == 
+            RPT_SORT_PERMUTATIONS.NumPermutations(), "PSO slots don't match the number of permutations.");
+        static_assert((int)SHADER::ReSTIR_PT_RECONNECT_CtT - (int)SHADER::ReSTIR_PT_REPLAY == 
+            RPT_REPLAY_PERMUTATIONS.NumPermutations(), "PSO slots don't match the number of permutations.");
+
         struct Reservoir_RGI
         {
             static constexpr int NUM = 3;
@@ -339,20 +458,59 @@ namespace ZetaRay::RenderPass
             Core::GpuMemory::Texture D;
         };
 
+        // Per-frame state that's set by ReSTIR PT path tracing and used by the resampling passes
+        struct ReSTIR_PT_Frame
+        {
+            ID3D12Resource* CurrReservoirs[Reservoir_RPT::NUM];
+            ID3D12Resource* PrevReservoirs[Reservoir_RPT::NUM];
+            cb_ReSTIR_PT_Reuse CB;
+            int NumSpatialPasses = 0;
+            bool DoTemporal = false;
+            bool DoSpatial = false;
+        };
+
         void ResetIntegrator(bool resetAllResources, bool skipNonResources);
         void SwitchToReSTIR_PT(bool skipNonResources);
         void ReleaseReSTIR_PT();
         void SwitchToReSTIR_GI(bool skipNonResources);
         void ReleaseReSTIR_GI();
+        void CreateReducedResResources();
         void SwitchToPathTracer(bool skipNonResources);
+        void ReleasePathTracer();
+        void CreateAdaptiveSamplingResources();
+        void ReleaseAdaptiveSamplingResources();
+        // Path tracing and ReSTIR GI only. ReSTIR PT's shift mappings need to replay the 
+        // full path, which cache lookups would break.
+        void CreateRadianceCacheResources();
+        void ReleaseRadianceCacheResources();
+        void AddRadianceCacheParams();
+        void RemoveRadianceCacheParams();
+        // Called before and after the integrator's path tracing pass respectively
+        void BeginRadianceCache(Core::ComputeCmdList& computeCmdList);
+        void ResolveRadianceCache(Core::ComputeCmdList& computeCmdList);
+        void SwitchToProbeVolume(bool skipNonResources);
+        void ReleaseProbeVolume();
         void RenderPathTracer(Core::ComputeCmdList& computeCmdList);
         void RenderReSTIR_GI(Core::ComputeCmdList& computeCmdList);
         void RenderReSTIR_PT(Core::ComputeCmdList& computeCmdList);
+        // Updates a subset of the probes, then shades every pixel from the probes
+        void RenderProbeVolume(Core::ComputeCmdList& computeCmdList);
+        void ReSTIR_PT_PathTrace(Core::ComputeCmdList& computeCmdList);
         void ReSTIR_PT_Temporal(Core::ComputeCmdList& computeCmdList, 
+            Core::RootSignature& rootSig, cb_ReSTIR_PT_Reuse& cbReuse,
             Util::Span<ID3D12Resource*> currReservoirs);
         void ReSTIR_PT_Spatial(Core::ComputeCmdList& computeCmdList, 
+            Core::RootSignature& rootSig, cb_ReSTIR_PT_Reuse& cbReuse,
             Util::Span<ID3D12Resource*> currReservoirs,
             Util::Span<ID3D12Resource*> prevReservoirs);
+        // When sorting is enabled, sort passes also append the (16 x 8) thread groups that have 
+        // work to per-shift lists, which replay and reconnect passes then consume through 
+        // ExecuteIndirect rather than covering the whole screen
+        void ResetWorkLists(Core::ComputeCmdList& computeCmdList);
+        void WorkListsToIndirectArgs(Core::ComputeCmdList& computeCmdList);
+        void DispatchReuse(Core::ComputeCmdList& computeCmdList, const cb_ReSTIR_PT_Reuse& cbReuse,
+            SHIFT shift, uint32_t groupDimX, uint32_t groupDimY);
+        void EndFrame();
 
         // param callbacks
         void MaxNonTrBouncesCallback(const Support::ParamVariant& p);
@@ -364,14 +522,36 @@ namespace ZetaRay::RenderPass
         void M_maxTCallback(const Support::ParamVariant& p);
         void M_maxSCallback(const Support::ParamVariant& p);
         void BoilingSuppressionCallback(const Support::ParamVariant& p);
+        void ValidationIntervalCallback(const Support::ParamVariant& p);
         void PathRegularizationCallback(const Support::ParamVariant& p);
         void AlphaMinCallback(const Support::ParamVariant& p);
         void DebugViewCallback(const Support::ParamVariant& p);
         void SortTemporalCallback(const Support::ParamVariant& p);
         void SortSpatialCallback(const Support::ParamVariant& p);
+        void GpuDrivenDispatchCallback(const Support::ParamVariant& p);
+        void GroupSharedSpatialCallback(const Support::ParamVariant& p);
+        void CompactReservoirsCallback(const Support::ParamVariant& p);
+        void FP16BSDFCallback(const Support::ParamVariant& p);
+        void WarmupFramesCallback(const Support::ParamVariant& p);
         void TexFilterCallback(const Support::ParamVariant& p);
+        void ReorderThreadsCallback(const Support::ParamVariant& p);
+        void AdaptiveSamplingCallback(const Support::ParamVariant& p);
+        void TargetRelErrorCallback(const Support::ParamVariant& p);
+        void ResolutionCallback(const Support::ParamVariant& p);
+        void RadianceCacheCallback(const Support::ParamVariant& p);
+        void RadianceCacheCellSizeCallback(const Support::ParamVariant& p);
+        void RadianceCacheSpreadCallback(const Support::ParamVariant& p);
+        void ProbeSpacingCallback(const Support::ParamVariant& p);
+        void ProbesPerFrameCallback(const Support::ParamVariant& p);
+        void ProbeHysteresisCallback(const Support::ParamVariant& p);
 
         // shader reload
+        ZetaInline ID3D12PipelineState* GetPermutation(SHADER base, uint32_t key,
+            const Core::ShaderPermutationDesc& desc)
+        {
+            return m_psoLib.GetPermutation((uint32_t)base, key, m_rootSigObj.Get(), desc);
+        }
+
         void ReloadRGI();
         void ReloadRPT_PathTrace();
         void ReloadRPT_Temporal();
@@ -387,18 +567,65 @@ namespace ZetaRay::RenderPass
         Core::GpuMemory::Texture m_spatialNeighbor;
         Core::GpuMemory::Texture m_rptTarget;
         Core::GpuMemory::Texture m_final;
+        // Shared scene buffers that are bound every frame
+        Core::SharedResourceHandle<Core::GpuMemory::Buffer> m_bvhCurr;
+        Core::SharedResourceHandle<Core::GpuMemory::Buffer> m_bvhPrev;
+        Core::SharedResourceHandle<Core::GpuMemory::Buffer> m_meshInstancesCurr;
+        Core::SharedResourceHandle<Core::GpuMemory::Buffer> m_meshInstancesPrev;
+        Core::SharedResourceHandle<Core::GpuMemory::Buffer> m_lvg;
+        Core::GpuMemory::Buffer m_rptWorkList;
+        Core::GpuMemory::Buffer m_rptWorkListInit;
+        // Skips tiles that are all sky or emissive when path tracing every pixel
+        TileClassification m_tileClassification;
+        // Texture2D<float4>: (sum of luminance, sum of squared luminance, #samples)
+        Core::GpuMemory::Texture m_ptMoments;
+        Core::GpuMemory::Buffer m_ptWorkList;
+        Core::GpuMemory::Buffer m_ptWorkListInit;
+        // Texture2D<half4>: this frame's estimates for traced pixels in reduced-resolution ReSTIR GI
+        Core::GpuMemory::Texture m_rgiSparse;
+        // StructuredBuffer<uint>: checksum of the key (zero for empty cells)
+        Core::GpuMemory::Buffer m_rcKeys;
+        // StructuredBuffer<uint4>: this frame's training samples (fixed-point radiance, #samples)
+        Core::GpuMemory::Buffer m_rcAccum;
+        // StructuredBuffer<uint2>: cached radiance (see RadianceCache.hlsli)
+        Core::GpuMemory::Buffer m_rcResolved;
+        // Texture3D<half4>: L1 SH coefficients of incident radiance per color channel
+        Core::GpuMemory::Texture m_probeSH[3];
+        // Texture3D<uint>: (#updates, tag) of every probe (see ProbeVolume.hlsli)
+        Core::GpuMemory::Texture m_probeMeta;
 
         int m_currTemporalIdx = 0;
         int m_numSpatialPasses = 1;
+        // For this many frames after temporal history is reset (camera cut, integrator 
+        // switch, etc.), ReSTIR PT runs the maximum number of spatial passes. In the first 
+        // frame, where there's no history, spatial reuse runs without temporal reuse.
+        int m_warmupFrames = DefaultParamVals::WARMUP_FRAMES;
+        int m_framesSinceReset = 0;
+        int m_probesPerFrame = DefaultParamVals::PROBES_PER_FRAME;
+        // Round robin over the probe volume
+        uint32_t m_firstProbe = 0;
         bool m_isTemporalReservoirValid = false;
         bool m_isDnsrTemporalCacheValid = false;
         bool m_doTemporalResampling = true;
         bool m_preSampling = false;
         bool m_useLVG = false;
+        bool m_useLightBVH = false;
+        bool m_gpuDrivenDispatch = DefaultParamVals::GPU_DRIVEN_DISPATCH;
+        // Spatial search is limited to the thread group's tile and reads from group shared memory
+        bool m_groupSharedSpatial = false;
+        bool m_compactReservoirs = DefaultParamVals::COMPACT_RESERVOIRS;
+        // ReSTIR PT path tracing stores material colors and path throughput in FP16
+        bool m_fp16BSDF = DefaultParamVals::FP16_BSDF;
+        bool m_adaptiveSampling = DefaultParamVals::ADAPTIVE_SAMPLING;
+        RESTIR_GI_RESOLUTION m_rgiResolution = DefaultParamVals::RGI_RESOLUTION;
+        // Toggled separately for path tracing and ReSTIR GI
+        bool m_radianceCache[(int)INTEGRATOR::ReSTIR_PT] = { DefaultParamVals::RADIANCE_CACHE, 
+            DefaultParamVals::RADIANCE_CACHE };
         INTEGRATOR m_method = INTEGRATOR::COUNT;
 
         cb_ReSTIR_GI m_cbRGI;
         cb_ReSTIR_PT_PathTrace m_cbRPT_PathTrace;
         cb_ReSTIR_PT_Reuse m_cbRPT_Reuse;
+        ReSTIR_PT_Frame m_rptFrame;
     };
 }
\ No newline at end of file
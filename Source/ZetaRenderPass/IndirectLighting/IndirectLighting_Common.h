@@ -9,6 +9,11 @@
 #define RESTIR_GI_TEMPORAL_TILE_WIDTH 16
 #define RESTIR_GI_TEMPORAL_LOG2_TILE_WIDTH 4
 
+// Store ReSTIR GI reservoirs in compact formats: sample positions as octahedral direction 
+// & distance relative to camera, radiance as R11G11B10 and 16-bit weights (see 
+// ReSTIR_GI/Reservoir.hlsli). Reduces reservoir size from 40 to 28 bytes per pixel.
+#define RESTIR_GI_COMPACT_RESERVOIRS 0
+
 #define RESTIR_PT_PATH_TRACE_GROUP_DIM_X 16u
 #define RESTIR_PT_PATH_TRACE_GROUP_DIM_Y 8u
 
@@ -31,6 +36,66 @@
 #define RESTIR_PT_SPATIAL_GROUP_DIM_X 8u
 #define RESTIR_PT_SPATIAL_GROUP_DIM_Y 8u
 
+// Work lists for GPU-driven dispatch of replay and reconnect passes. For each shift,
+// first RESTIR_PT_WORK_LIST_ARGS_SIZE uints are dispatch arguments for (16 x 8) and
+// (8 x 8) thread groups, followed by the dispatch headers for other shifts. Then, starting
+// from RESTIR_PT_WORK_LIST_HEADER_SIZE, each shift has a list of (16 x 8) thread groups 
+// (packed as x | y << 16) that have at least one pixel to process.
+#define RESTIR_PT_WORK_LIST_ARGS_SIZE 6
+#define RESTIR_PT_WORK_LIST_HEADER_SIZE 16
+
+// Adaptive sampling for path tracing -- while accumulating, pixels whose estimated relative 
+// error is below the target stop receiving new paths. Work list starts with the dispatch 
+// arguments and number of pixels, followed by pixels that need more samples (packed as 
+// x | y << 16). Thread groups launched by ExecuteIndirect process consecutive pixels from 
+// the list, with a fixed number of groups along X.
+#define PATH_TRACER_WORK_LIST_HEADER_SIZE 4
+#define PATH_TRACER_WORK_LIST_NUM_PIXELS 3
+#define PATH_TRACER_WORK_LIST_DISPATCH_DIM_X 256u
+#define PATH_TRACER_ADAPTIVE_MIN_SAMPLES 16
+
+// Reduced-resolution ReSTIR GI -- every frame, reservoirs are only updated for a subset of 
+// pixels (alternating between frames) and an edge-aware upsampling pass fills in the rest
+#define RESTIR_GI_UPSAMPLE_DEPTH_SIGMA 0.02f
+#define RESTIR_GI_UPSAMPLE_NORMAL_EXP 16
+
+// World-space radiance cache (path tracing and ReSTIR GI) -- hash grid with linear probing. 
+// One pixel out of every (TRAINING_BLOCK_DIM x TRAINING_BLOCK_DIM) block traces a full 
+// training path and records the radiance found at its first MAX_TRAINING_VERTICES vertices, 
+// which are blended into the cached radiance by the resolve pass. Radiance is accumulated 
+// as fixed point and clamped to MAX_RADIANCE.
+#define RADIANCE_CACHE_NUM_CELLS (1u << 20)
+#define RADIANCE_CACHE_NUM_PROBES 8
+#define RADIANCE_CACHE_TRAINING_BLOCK_DIM 4
+#define RADIANCE_CACHE_LOG2_TRAINING_BLOCK_DIM 2
+#define RADIANCE_CACHE_MAX_TRAINING_VERTICES 4
+#define RADIANCE_CACHE_MAX_ACCUM_FRAMES 32
+#define RADIANCE_CACHE_MAX_STALE_FRAMES 64
+#define RADIANCE_CACHE_MIN_FRAMES 2
+#define RADIANCE_CACHE_FIXED_POINT_SCALE 256.0f
+#define RADIANCE_CACHE_MAX_RADIANCE 256.0f
+#define RADIANCE_CACHE_RESOLVE_GROUP_DIM_X 256u
+
+// Irradiance probe volume -- a (DIM_X x DIM_Y x DIM_Z) grid of probes that follows the 
+// camera, each storing incident radiance projected onto L1 SH (one 3D texture per color 
+// channel). Probes are addressed toroidally by their world-space grid coordinates, so when 
+// the volume scrolls, only probes that entered it lose their history. Every frame, a 
+// budgeted number of probes (round robin) trace NUM_RAYS paths and blend the result into 
+// their coefficients. Dimensions must be powers of two.
+#define PROBE_VOLUME_DIM_X 32
+#define PROBE_VOLUME_DIM_Y 16
+#define PROBE_VOLUME_DIM_Z 32
+#define PROBE_VOLUME_LOG2_DIM_X 5
+#define PROBE_VOLUME_LOG2_DIM_Y 4
+#define PROBE_VOLUME_LOG2_DIM_Z 5
+#define PROBE_VOLUME_NUM_PROBES (PROBE_VOLUME_DIM_X * PROBE_VOLUME_DIM_Y * PROBE_VOLUME_DIM_Z)
+#define PROBE_VOLUME_NUM_RAYS 64u
+#define PROBE_VOLUME_MAX_ACCUM_UPDATES 64
+#define PROBE_VOLUME_SAMPLE_GROUP_DIM_X 8u
+#define PROBE_VOLUME_SAMPLE_GROUP_DIM_Y 8u
+// Lookup position is offset along the normal by this times probe spacing
+#define PROBE_VOLUME_NORMAL_BIAS 0.25f
+
 namespace CB_IND_FLAGS
 {
     static constexpr uint32_t TEMPORAL_RESAMPLE = 1 << 0;
@@ -42,6 +107,13 @@ namespace CB_IND_FLAGS
     static constexpr uint32_t SORT_TEMPORAL = 1 << 6;
     static constexpr uint32_t SORT_SPATIAL = 1 << 7;
     static constexpr uint32_t RESET_TEMPORAL_TEXTURES = 1 << 8;
+    static constexpr uint32_t INDIRECT_DISPATCH = 1 << 9;
+    static constexpr uint32_t ADAPTIVE_SAMPLING = 1 << 10;
+    static constexpr uint32_t REORDER_THREADS = 1 << 11;
+    static constexpr uint32_t TILE_LIST = 1 << 12;
+    static constexpr uint32_t RADIANCE_CACHE = 1 << 13;
+    // Scene changed in a way that may affect visibility of every reused sample
+    static constexpr uint32_t REVALIDATE_ALL = 1 << 14;
 };
 
 namespace PACKED_INDEX
@@ -66,6 +138,16 @@ enum class RPT_DEBUG_VIEW
     COUNT
 };
 
+enum class RESTIR_GI_RESOLUTION
+{
+    FULL,
+    // One out of every two pixels in a checkerboard pattern
+    CHECKERBOARD,
+    // One out of every 2x2 block of pixels
+    HALF,
+    COUNT
+};
+
 enum class TEXTURE_FILTER
 {
     MIP0,
@@ -99,6 +181,44 @@ struct cb_ReSTIR_GI
     uint32_t MaxNonTrBounces;
     uint32_t MaxGlossyTrBounces;
     uint32_t TexFilterDescHeapIdx;
+
+    // Path tracing with adaptive sampling
+    uint32_t MomentsDescHeapIdx;
+    uint32_t WorkListDescHeapIdx;
+    float TargetRelError;
+
+    // Path tracing without adaptive sampling, only tiles with surface pixels are launched
+    uint32_t TileListDescHeapIdx;
+
+    // Reduced resolution
+    uint32_t Resolution;
+    uint32_t SparseDescHeapIdx;
+
+    // Radiance cache -- descriptors for keys, accumulated samples and resolved radiance 
+    // are allocated consecutively
+    uint32_t RadianceCacheDescHeapIdx;
+    // Size of the cells that are closer than 1 unit to the camera, doubles with every 
+    // doubling of distance
+    float RadianceCacheCellSize;
+    // Paths terminate into the cache once their spread is larger than this times cell size
+    float RadianceCacheSpread;
+
+    // Every pixel is fully resampled once in this many frames
+    uint32_t ResamplingInterval;
+    // Visibility of reused temporal samples is retraced once in this many frames
+    uint32_t ValidationInterval;
+
+    // Irradiance probes -- descriptors for R, G, B coefficients and metadata are allocated 
+    // consecutively
+    uint32_t ProbeVolumeDescHeapIdx;
+    // World-space grid coordinates of the probe at the volume's minimum corner
+    int32_t ProbeVolumeMin_x;
+    int32_t ProbeVolumeMin_y;
+    int32_t ProbeVolumeMin_z;
+    float ProbeSpacing;
+    // Probes [first, first + num) of the volume (wrapping around) are updated this frame
+    uint32_t FirstProbe_NumProbesToUpdate;
+    float ProbeHysteresis;
 };
 
 struct cb_ReSTIR_PT_PathTrace
@@ -140,6 +260,9 @@ struct cb_ReSTIR_PT_Reuse
  
     uint32_t Packed;
     float Alpha_min;
+
+    uint32_t WorkListDescHeapIdx;
+    uint32_t NumWorkGroups;
 };
 
 struct cb_ReSTIR_PT_Sort
@@ -151,6 +274,8 @@ struct cb_ReSTIR_PT_Sort
 
     uint32_t DispatchDimX;
     uint32_t DispatchDimY;
+    uint32_t WorkListDescHeapIdx;
+    uint32_t NumWorkGroups;
 };
 
 struct cb_ReSTIR_PT_SpatialSearch
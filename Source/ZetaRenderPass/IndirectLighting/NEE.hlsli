@@ -3,6 +3,7 @@
 
 #include "../Common/GBuffers.hlsli"
 #include "../Common/LightVoxelGrid.hlsli"
+#include "../Common/LightBVH.hlsli"
 #include "../Common/RayQuery.hlsli"
 #include "../Common/BSDFSampling.hlsli"
 
@@ -12,15 +13,18 @@ namespace ReSTIR_Util
     {
         RaytracingAccelerationStructure bvh;
         StructuredBuffer<RT::MeshInstance> frameMeshData;
-        StructuredBuffer<Vertex> vertices;
+        StructuredBuffer<PackedVertex> vertices;
         StructuredBuffer<uint> indices;
         StructuredBuffer<Material> materials;
         StructuredBuffer<RT::EmissiveTriangle> emissives;
         StructuredBuffer<RT::PresampledEmissiveTriangle> sampleSets;
         StructuredBuffer<RT::EmissiveLumenAliasTableEntry> aliasTable;
         StructuredBuffer<RT::VoxelSample> lvg;
+        StructuredBuffer<RT::LightBVHNode> lightBVH;
+        StructuredBuffer<uint> lightBVHTriToLeaf;
         uint16 maxNumBounces;
         uint16 sampleSetSize;
+        uint16 lightBVHLog2ClusterSize;
         uint16_t3 gridDim;
         half3 extents;
         half offset_y;
@@ -175,7 +179,20 @@ namespace ReSTIR_Util
 
             if(tri.twoSided && dot(pos - tri.pos, lightSample.normal) < 0)
                 lightSample.normal *= -1;
-#else
+#elif defined(USE_LIGHT_BVH)
+            LightBVH::Sample entry = LightBVH::SampleTriangle(pos, normal, surface.Transmissive(),
+                numEmissives, globals.lightBVHLog2ClusterSize, globals.lightBVH, 
+                globals.lightBVHTriToLeaf, rng);
+            // No light source can contribute to this point
+            if(entry.pdf == 0)
+                continue;
+
+            RT::EmissiveTriangle tri = globals.emissives[entry.idx];
+            Light::EmissiveTriSample lightSample = Light::EmissiveTriSample::get(pos, tri, rng);
+
+            float3 le = Light::Le_EmissiveTriangle(tri, lightSample.bary, emissiveMapsDescHeapOffset);
+            const float lightPdf = entry.pdf * lightSample.pdf;
+            const uint lightID = tri.ID;
             Light::AliasTableSample entry = Light::AliasTableSample::get(globals.aliasTable, 
                 numEmissives, rng);
             RT::EmissiveTriangle tri = globals.emissives[entry.idx];
@@ -7,6 +7,10 @@
 #include "../../Common/Common.hlsli"
 
 #define THREAD_GROUP_SWIZZLING 1
+#define THREAD_REORDER_GROUP_SIZE (RESTIR_GI_TEMPORAL_GROUP_DIM_X * RESTIR_GI_TEMPORAL_GROUP_DIM_Y)
+
+#include "../ThreadReorder.hlsli"
+#include "../../TileClassification/TileClassification.hlsli"
 
 using namespace RtRayQuery;
 
@@ -18,13 +22,17 @@ ConstantBuffer<cbFrameConstants> g_frame : register(b0);
 ConstantBuffer<cb_ReSTIR_GI> g_local : register(b1);
 RaytracingAccelerationStructure g_bvh : register(t0);
 StructuredBuffer<RT::MeshInstance> g_frameMeshData : register(t1);
-StructuredBuffer<Vertex> g_vertices : register(t2);
+StructuredBuffer<PackedVertex> g_vertices : register(t2);
 StructuredBuffer<uint> g_indices : register(t3);
 StructuredBuffer<Material> g_materials : register(t4);
 #if NEE_EMISSIVE == 1
 StructuredBuffer<RT::EmissiveTriangle> g_emissives : register(t5);
 StructuredBuffer<RT::PresampledEmissiveTriangle> g_sampleSets : register(t6);
 StructuredBuffer<RT::EmissiveLumenAliasTableEntry> g_aliasTable : register(t7);
+#ifdef USE_LIGHT_BVH
+StructuredBuffer<RT::LightBVHNode> g_lightBVH : register(t9);
+StructuredBuffer<uint> g_lightBVHTriToLeaf : register(t10);
+#endif
 #endif
 
 //--------------------------------------------------------------------------------------
@@ -48,6 +56,11 @@ ReSTIR_Util::Globals InitGlobals(bool transmissive)
     globals.sampleSets = g_sampleSets;
     globals.aliasTable = g_aliasTable;
     globals.sampleSetSize = (uint16_t)(g_local.SampleSetSize_NumSampleSets & 0xffff);
+#ifdef USE_LIGHT_BVH
+    globals.lightBVH = g_lightBVH;
+    globals.lightBVHTriToLeaf = g_lightBVHTriToLeaf;
+    globals.lightBVHLog2ClusterSize = (uint16_t)g_frame.LightBVHLog2ClusterSize;
+#endif
 #endif
 
     return globals;
@@ -71,14 +84,9 @@ float3 EstimateIndirectLighting(uint2 DTid, float3 origin, float2 lensSample, fl
     if(!hitInfo.hit)
         return 0;
 
-    GBUFFER_TRI_DIFF_GEO_A g_triA = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::TRI_DIFF_GEO_A];
-    GBUFFER_TRI_DIFF_GEO_B g_triB = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::TRI_DIFF_GEO_B];
-    const uint4 packed_a = g_triA[DTid];
-    const uint2 packed_b = g_triB[DTid];
-
-    Math::TriDifferentials triDiffs = Math::TriDifferentials::Unpack(packed_a, packed_b);
+    Math::TriDifferentials triDiffs = RT::LoadTriDifferentials(DTid, 
+        g_frame.CurrGBufferDescHeapOffset, true, g_frame.VisibilityBuffer, g_frameMeshData, 
+        g_vertices, g_indices);
     float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
 
     RT::RayDifferentials rd = RT::RayDifferentials::Init(DTid, renderDim, 
@@ -96,8 +104,10 @@ float3 EstimateIndirectLighting(uint2 DTid, float3 origin, float2 lensSample, fl
         dpdx, dpdy, dot(bsdfSample.wi, normal) < 0, surface.eta);
 
     SamplerState samp = SamplerDescriptorHeap[g_local.TexFilterDescHeapIdx];
+    RadianceCache::Params rc = RadianceCache::Params::Init(g_local, DTid, g_frame.FrameNum,
+        g_frame.CameraPos);
     float3 li = ReSTIR_RT::PathTrace(pos, normal, ior, sampleSetIdx, bsdfSample, 
-        hitInfo, rd, g_frame, globals, samp, rngThread, rngGroup);
+        hitInfo, rd, g_frame, globals, rc, samp, rngThread, rngGroup);
 
     if(dot(li, li) > 0)
     {
@@ -113,7 +123,8 @@ float3 EstimateIndirectLighting(uint2 DTid, float3 origin, float2 lensSample, fl
 //--------------------------------------------------------------------------------------
 
 [numthreads(RESTIR_GI_TEMPORAL_GROUP_DIM_X, RESTIR_GI_TEMPORAL_GROUP_DIM_Y, 1)]
-void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID)
+void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID,
+    uint Gidx : SV_GroupIndex)
 {
 #if THREAD_GROUP_SWIZZLING == 1
     uint16_t2 swizzledGid;
@@ -126,16 +137,56 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         uint16_t(g_local.DispatchDimX_NumGroupsInTile >> 16),
         swizzledGid);
 #else
-    const uint2 swizzledDTid = DTid.xy;
-    const uint2 swizzledGid = Gid.xy;
+    uint2 swizzledDTid = DTid.xy;
+    uint2 swizzledGid = Gid.xy;
 #endif
+
+    // Launched through ExecuteIndirect -- every group processes one of the tiles that 
+    // have at least one surface pixel. Sky and emissive pixels don't need path tracing.
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::TILE_LIST))
+    {
+        uint2 tile;
+        if(!TileClassification::GroupToTile(Gid.xy, TILE_CATEGORY::SURFACE, 
+            g_local.TileListDescHeapIdx, tile))
+        {
+            return;
+        }
+
+        swizzledDTid = tile * uint2(RESTIR_GI_TEMPORAL_GROUP_DIM_X, RESTIR_GI_TEMPORAL_GROUP_DIM_Y) + 
+            GTid.xy;
+        swizzledGid = (uint16_t2)tile;
+    }
+
+    // Launched through ExecuteIndirect -- every thread processes one pixel from the
+    // work list
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::ADAPTIVE_SAMPLING))
+    {
+        StructuredBuffer<uint> g_workList = ResourceDescriptorHeap[g_local.WorkListDescHeapIdx];
+        const uint idx = (Gid.y * PATH_TRACER_WORK_LIST_DISPATCH_DIM_X + Gid.x) * 
+            RESTIR_GI_TEMPORAL_GROUP_DIM_X * RESTIR_GI_TEMPORAL_GROUP_DIM_Y + Gidx;
+
+        // Threads past the end still have to take part in reordering
+        const uint packed = idx < g_workList[PATH_TRACER_WORK_LIST_NUM_PIXELS] ?
+            g_workList[PATH_TRACER_WORK_LIST_HEADER_SIZE + idx] : 
+            (ThreadReorder::NO_PIXEL.x | (ThreadReorder::NO_PIXEL.y << 16));
+        swizzledDTid = uint2(packed & 0xffff, packed >> 16);
+    }
+
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::REORDER_THREADS))
+        swizzledDTid = ThreadReorder::Reorder(swizzledDTid, Gidx, g_frame);
+
+    // Work list pixels in the same group may come from anywhere on screen
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::ADAPTIVE_SAMPLING))
+    {
+        swizzledGid = (uint16_t2)(swizzledDTid / uint2(RESTIR_GI_TEMPORAL_GROUP_DIM_X, 
+            RESTIR_GI_TEMPORAL_GROUP_DIM_Y));
+    }
     
     if (swizzledDTid.x >= g_frame.RenderWidth || swizzledDTid.y >= g_frame.RenderHeight)
         return;
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr = g_metallicRoughness[swizzledDTid];
+    const float2 mr = GBuffer::LoadMetallicRoughness(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
 
     RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
@@ -167,23 +218,18 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz, 
         g_frame.DoF, lensSample, g_frame.FocusDepth, origin);
 
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_normal[swizzledDTid.xy]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(swizzledDTid.xy, 
+        g_frame.CurrGBufferDescHeapOffset));
 
-    GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
-    const float3 baseColor = g_baseColor[swizzledDTid].rgb;
+    const float3 baseColor = GBuffer::LoadBaseColor(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset).rgb;
 
     float eta_curr = ETA_AIR;
     float eta_next = DEFAULT_ETA_MAT;
 
     if(flags.transmissive)
     {
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
-
-        float ior = g_ior[swizzledDTid];
+        float ior = GBuffer::LoadIOR(swizzledDTid, g_frame.CurrGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
@@ -202,11 +248,22 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         normal, eta_next, surface, globals, rngThread, rngGroup);
     li = any(isnan(li)) ? 0 : li;
 
-    if(g_frame.Accumulate && g_frame.CameraStatic)
+    const bool accumulate = g_frame.Accumulate && g_frame.CameraStatic;
+
+    if(accumulate)
     {
         float3 prev = g_final[swizzledDTid].rgb;
         g_final[swizzledDTid].rgb = prev + li;
     }
     else
         g_final[swizzledDTid].rgb = li;
+
+    // Moments of luminance for estimating the per-pixel variance
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::ADAPTIVE_SAMPLING))
+    {
+        RWTexture2D<float4> g_moments = ResourceDescriptorHeap[g_local.MomentsDescHeapIdx];
+        const float lum = Math::Luminance(li);
+        const float3 prev = accumulate ? g_moments[swizzledDTid].xyz : 0;
+        g_moments[swizzledDTid].xyz = prev + float3(lum, lum * lum, 1);
+    }
 }
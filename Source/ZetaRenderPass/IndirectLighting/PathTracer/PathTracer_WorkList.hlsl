@@ -0,0 +1,91 @@
+#include "../IndirectLighting_Common.h"
+#include "../../Common/Common.hlsli"
+#include "../../Common/GBuffers.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b0);
+ConstantBuffer<cb_ReSTIR_GI> g_local : register(b1);
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+bool IsConverged(uint2 DTid)
+{
+    // Output is reset every frame when not accumulating
+    if(!g_frame.Accumulate || !g_frame.CameraStatic || g_frame.NumFramesCameraStatic <= 1)
+        return false;
+
+    // (sum of luminance, sum of squared luminance, number of samples)
+    RWTexture2D<float4> g_moments = ResourceDescriptorHeap[g_local.MomentsDescHeapIdx];
+    const float3 moments = g_moments[DTid].xyz;
+    const float n = moments.z;
+
+    if(n < PATH_TRACER_ADAPTIVE_MIN_SAMPLES)
+        return false;
+
+    const float mean = moments.x / n;
+    const float variance = max(moments.y / n - mean * mean, 0) * n / (n - 1);
+
+    // Standard error of the mean relative to the mean
+    return sqrt(variance / n) <= g_local.TargetRelError * mean;
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(RESTIR_GI_TEMPORAL_GROUP_DIM_X, RESTIR_GI_TEMPORAL_GROUP_DIM_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    bool active = false;
+
+    if (DTid.x < g_frame.RenderWidth && DTid.y < g_frame.RenderHeight)
+    {
+        const GBuffer::Flags flags = GBuffer::DecodeMetallic(GBuffer::LoadMetallicRoughness(DTid.xy, 
+            g_frame.CurrGBufferDescHeapOffset).x);
+
+        // Path tracer doesn't need to run for these or they would be reset to zero
+        if(!flags.invalid && !flags.emissive)
+        {
+            active = !IsConverged(DTid.xy);
+
+            // Compositing divides the accumulated sum by the number of frames, so converged
+            // pixels add their current estimate in place of a new sample
+            if(!active)
+            {
+                RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
+                const float3 sum = g_final[DTid.xy].rgb;
+                g_final[DTid.xy].rgb = sum + sum / (g_frame.NumFramesCameraStatic - 1);
+            }
+        }
+    }
+
+    const uint numActive = WaveActiveCountBits(active);
+    if(numActive == 0)
+        return;
+
+    RWStructuredBuffer<uint> g_workList = ResourceDescriptorHeap[g_local.WorkListDescHeapIdx];
+    uint slot = 0;
+
+    // One atomic per wave
+    if(WaveIsFirstLane())
+    {
+        InterlockedAdd(g_workList[PATH_TRACER_WORK_LIST_NUM_PIXELS], numActive, slot);
+
+        const uint numPixelsPerRow = PATH_TRACER_WORK_LIST_DISPATCH_DIM_X *
+            RESTIR_GI_TEMPORAL_GROUP_DIM_X * RESTIR_GI_TEMPORAL_GROUP_DIM_Y;
+        InterlockedMax(g_workList[1], (slot + numActive + numPixelsPerRow - 1) / numPixelsPerRow);
+    }
+
+    slot = WaveReadLaneFirst(slot);
+
+    if(active)
+    {
+        g_workList[PATH_TRACER_WORK_LIST_HEADER_SIZE + slot + WavePrefixCountBits(active)] =
+            DTid.x | (DTid.y << 16);
+    }
+}
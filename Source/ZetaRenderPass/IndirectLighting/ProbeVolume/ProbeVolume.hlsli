@@ -0,0 +1,71 @@
+#ifndef PROBE_VOLUME_H
+#define PROBE_VOLUME_H
+
+#include "../IndirectLighting_Common.h"
+#include "../../Common/SH.hlsli"
+
+namespace ProbeVolume
+{
+    static const int3 DIM = int3(PROBE_VOLUME_DIM_X, PROBE_VOLUME_DIM_Y, PROBE_VOLUME_DIM_Z);
+    static const int3 LOG2_DIM = int3(PROBE_VOLUME_LOG2_DIM_X, PROBE_VOLUME_LOG2_DIM_Y,
+        PROBE_VOLUME_LOG2_DIM_Z);
+
+    struct Probe
+    {
+        // World-space grid coordinates
+        int3 coord;
+        // Toroidal address in the probe textures
+        uint3 texel;
+        // Identifies which of the world coordinates mapping to the same texel is stored there
+        uint tag;
+    };
+
+    Probe GetProbe(int3 coord)
+    {
+        Probe ret;
+        ret.coord = coord;
+        ret.texel = (uint3)(coord & (DIM - 1));
+        const uint3 t = (uint3)(coord >> LOG2_DIM) & 0xff;
+        ret.tag = t.x | (t.y << 8) | (t.z << 16);
+
+        return ret;
+    }
+
+    // Maps index in [0, #probes) to the probe's world-space grid coordinates
+    int3 IndexToCoord(uint idx, int3 volumeMin)
+    {
+        const uint3 local = uint3(idx & (DIM.x - 1),
+            (idx >> LOG2_DIM.x) & (DIM.y - 1),
+            idx >> (LOG2_DIM.x + LOG2_DIM.y));
+
+        return volumeMin + (int3)local;
+    }
+
+    float3 ProbePos(int3 coord, float spacing)
+    {
+        return (float3)coord * spacing;
+    }
+
+    // Metadata is (#updates, tag) packed as updates | tag << 8
+    uint NumUpdates(uint meta, Probe p)
+    {
+        return (meta >> 8) == p.tag ? meta & 0xff : 0;
+    }
+
+    uint EncodeMeta(uint numUpdates, Probe p)
+    {
+        return numUpdates | (p.tag << 8);
+    }
+
+    // Irradiance for given normal, assuming coefficients are projection of incident radiance.
+    // Convolution with clamped cosine lobe becomes a per-band scale factor.
+    float3 Irradiance(float4 shR, float4 shG, float4 shB, float3 normal)
+    {
+        const float4 y = ProjectToSH1(normal, 1.0f) * float4(LAMBDA_LxCOS_THETA_SH[0],
+            LAMBDA_LxCOS_THETA_SH[1], LAMBDA_LxCOS_THETA_SH[1], LAMBDA_LxCOS_THETA_SH[1]);
+
+        return max(float3(dot(shR, y), dot(shG, y), dot(shB, y)), 0);
+    }
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include "ProbeVolume.hlsli"
+#include "../../Common/Common.hlsli"
+#include "../../Common/FrameConstants.h"
+#include "../../Common/GBuffers.hlsli"
+#include "../../Common/Sampling.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b0);
+ConstantBuffer<cb_ReSTIR_GI> g_local : register(b1);
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// Trilinear interpolation of the eight surrounding probes. Probes behind the surface
+// are down-weighted and probes without history are skipped.
+float3 Irradiance(float3 pos, float3 normal)
+{
+    RWTexture3D<float4> g_probeR = ResourceDescriptorHeap[g_local.ProbeVolumeDescHeapIdx];
+    RWTexture3D<float4> g_probeG = ResourceDescriptorHeap[g_local.ProbeVolumeDescHeapIdx + 1];
+    RWTexture3D<float4> g_probeB = ResourceDescriptorHeap[g_local.ProbeVolumeDescHeapIdx + 2];
+    RWTexture3D<uint> g_meta = ResourceDescriptorHeap[g_local.ProbeVolumeDescHeapIdx + 3];
+
+    const float spacing = g_local.ProbeSpacing;
+    const float3 p = mad(normal, PROBE_VOLUME_NORMAL_BIAS * spacing, pos);
+    const float3 g = p / spacing;
+    const float3 base = floor(g);
+    const float3 t = g - base;
+
+    const int3 volumeMin = int3(g_local.ProbeVolumeMin_x, g_local.ProbeVolumeMin_y,
+        g_local.ProbeVolumeMin_z);
+    const int3 volumeMax = volumeMin + ProbeVolume::DIM - 1;
+
+    float4 shR = 0;
+    float4 shG = 0;
+    float4 shB = 0;
+    float weightSum = 0;
+
+    [unroll]
+    for(int i = 0; i < 8; i++)
+    {
+        const int3 offset = int3(i & 0x1, (i >> 1) & 0x1, i >> 2);
+        // Outside the volume, clamp to its boundary
+        const int3 coord = clamp((int3)base + offset, volumeMin, volumeMax);
+        const ProbeVolume::Probe probe = ProbeVolume::GetProbe(coord);
+
+        if(ProbeVolume::NumUpdates(g_meta[probe.texel], probe) == 0)
+            continue;
+
+        const float3 tri = select(offset == 0, 1.0f - t, t);
+        float w = tri.x * tri.y * tri.z;
+
+        // Smooth backface test
+        const float3 toProbe = ProbeVolume::ProbePos(coord, spacing) - p;
+        const float d = length(toProbe);
+        const float wrap = d > 1e-4f ? 0.5f * (dot(toProbe / d, normal) + 1.0f) : 1.0f;
+        w *= mad(wrap, wrap, 0.2f);
+
+        shR += w * g_probeR[probe.texel];
+        shG += w * g_probeG[probe.texel];
+        shB += w * g_probeB[probe.texel];
+        weightSum += w;
+    }
+
+    if(weightSum < 1e-6f)
+        return 0;
+
+    return ProbeVolume::Irradiance(shR / weightSum, shG / weightSum, shB / weightSum, normal);
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Indirect diffuse lighting from the probe volume. Glossy surfaces only receive the
+// diffuse part.
+[numthreads(PROBE_VOLUME_SAMPLE_GROUP_DIM_X, PROBE_VOLUME_SAMPLE_GROUP_DIM_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_frame.RenderWidth || DTid.y >= g_frame.RenderHeight)
+        return;
+
+    const GBuffer::Flags flags = GBuffer::DecodeMetallic(GBuffer::LoadMetallicRoughness(DTid.xy,
+        g_frame.CurrGBufferDescHeapOffset).x);
+
+    RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
+    const bool accumulate = g_frame.Accumulate && g_frame.CameraStatic;
+
+    if (flags.invalid || flags.emissive)
+    {
+        if(!accumulate)
+            g_final[DTid.xy].rgb = 0;
+
+        return;
+    }
+
+    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
+        GBUFFER_OFFSET::DEPTH];
+    const float z_view = g_depth[DTid.xy];
+
+    float2 lensSample = 0;
+    float3 origin = g_frame.CameraPos;
+    if(g_frame.DoF)
+    {
+        RNG rngDoF = RNG::Init(RNG::PCG3d(DTid.xyx).zy, g_frame.FrameNum);
+        lensSample = Sampling::UniformSampleDiskConcentric(rngDoF.Uniform2D());
+        lensSample *= g_frame.LensRadius;
+    }
+
+    const float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
+    const float3 pos = Math::WorldPosFromScreenSpace2(DTid.xy, renderDim, z_view,
+        g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrCameraJitter,
+        g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz,
+        g_frame.DoF, lensSample, g_frame.FocusDepth, origin);
+
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(DTid.xy,
+        g_frame.CurrGBufferDescHeapOffset));
+    const float3 baseColor = GBuffer::LoadBaseColor(DTid.xy,
+        g_frame.CurrGBufferDescHeapOffset).rgb;
+
+    // Lambertian
+    const float3 diffuseReflectance = flags.metallic ? 0.0f : baseColor;
+    float3 li = diffuseReflectance * Irradiance(pos, normal) * ONE_OVER_PI;
+    if(any(isnan(li)))
+        li = 0;
+
+    if(accumulate)
+    {
+        float3 prev = g_final[DTid.xy].rgb;
+        g_final[DTid.xy].rgb = prev + li;
+    }
+    else
+        g_final[DTid.xy].rgb = li;
+}
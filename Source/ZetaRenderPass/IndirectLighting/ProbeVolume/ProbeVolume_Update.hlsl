@@ -0,0 +1,204 @@
+#ifndef NEE_EMISSIVE
+#define NEE_EMISSIVE 0
+#endif
+
+#include "../PathTracer/Params.hlsli"
+#include "../ReSTIR_GI/PathTracing.hlsli"
+#include "ProbeVolume.hlsli"
+
+// Squared must match PROBE_VOLUME_NUM_RAYS
+#define NUM_RAYS_PER_AXIS 8
+
+using namespace RtRayQuery;
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b0);
+ConstantBuffer<cb_ReSTIR_GI> g_local : register(b1);
+RaytracingAccelerationStructure g_bvh : register(t0);
+StructuredBuffer<RT::MeshInstance> g_frameMeshData : register(t1);
+StructuredBuffer<PackedVertex> g_vertices : register(t2);
+StructuredBuffer<uint> g_indices : register(t3);
+StructuredBuffer<Material> g_materials : register(t4);
+#if NEE_EMISSIVE == 1
+StructuredBuffer<RT::EmissiveTriangle> g_emissives : register(t5);
+StructuredBuffer<RT::PresampledEmissiveTriangle> g_sampleSets : register(t6);
+StructuredBuffer<RT::EmissiveLumenAliasTableEntry> g_aliasTable : register(t7);
+#ifdef USE_LIGHT_BVH
+StructuredBuffer<RT::LightBVHNode> g_lightBVH : register(t9);
+StructuredBuffer<uint> g_lightBVHTriToLeaf : register(t10);
+#endif
+#endif
+
+static const uint NUM_RAYS = NUM_RAYS_PER_AXIS * NUM_RAYS_PER_AXIS;
+
+// One set of L1 coefficients per color channel and thread
+groupshared float4 g_shR[NUM_RAYS];
+groupshared float4 g_shG[NUM_RAYS];
+groupshared float4 g_shB[NUM_RAYS];
+
+//--------------------------------------------------------------------------------------
+// Utility Functions
+//--------------------------------------------------------------------------------------
+
+ReSTIR_Util::Globals InitGlobals()
+{
+    ReSTIR_Util::Globals globals;
+    globals.bvh = g_bvh;
+    globals.frameMeshData = g_frameMeshData;
+    globals.vertices = g_vertices;
+    globals.indices = g_indices;
+    globals.materials = g_materials;
+    globals.maxNumBounces = (uint16_t)g_local.MaxNonTrBounces;
+    globals.russianRoulette = IS_CB_FLAG_SET(CB_IND_FLAGS::RUSSIAN_ROULETTE);
+
+#if NEE_EMISSIVE == 1
+    globals.emissives = g_emissives;
+    globals.sampleSets = g_sampleSets;
+    globals.aliasTable = g_aliasTable;
+    globals.sampleSetSize = (uint16_t)(g_local.SampleSetSize_NumSampleSets & 0xffff);
+#ifdef USE_LIGHT_BVH
+    globals.lightBVH = g_lightBVH;
+    globals.lightBVHTriToLeaf = g_lightBVHTriToLeaf;
+    globals.lightBVHLog2ClusterSize = (uint16_t)g_frame.LightBVHLog2ClusterSize;
+#endif
+#endif
+
+    return globals;
+}
+
+// Radiance arriving at the probe from direction wi. Probe rays are the equivalent of
+// first indirect bounce for pixels, so path length matches the other integrators.
+float3 IncidentRadiance(float3 pos, float3 wi, ReSTIR_Util::Globals globals,
+    inout RNG rngThread, inout RNG rngGroup)
+{
+    Hit hitInfo = Hit::FindClosest<false, true>(pos, wi, wi, globals.bvh,
+        globals.frameMeshData, globals.vertices, globals.indices, false);
+
+    // Sky is part of direct lighting
+    if(!hitInfo.hit)
+        return 0;
+
+    BSDF::BSDFSample bsdfSample = BSDF::BSDFSample::Init();
+    bsdfSample.wi = wi;
+    bsdfSample.lobe = BSDF::LOBE::DIFFUSE_R;
+    bsdfSample.pdf = ONE_OVER_4_PI;
+    bsdfSample.bsdfOverPdf = 1;
+
+    // Probes aren't tied to a pixel footprint, use the coarsest mip
+    RT::RayDifferentials rd = RT::RayDifferentials::Init();
+
+    RadianceCache::Params rc;
+    rc.enabled = false;
+    rc.train = false;
+    rc.descHeapIdx = 0;
+    rc.cellSize = 0;
+    rc.spread = 0;
+    rc.cameraPos = g_frame.CameraPos;
+
+    SamplerState samp = SamplerDescriptorHeap[g_local.TexFilterDescHeapIdx];
+    // Use the same sample set for all the threads in this group
+    const uint sampleSetIdx = rngGroup.UniformUintBounded_Faster(g_local.SampleSetSize_NumSampleSets >> 16);
+
+    return ReSTIR_RT::PathTrace(pos, wi, ETA_AIR, sampleSetIdx, bsdfSample,
+        hitInfo, rd, g_frame, globals, rc, samp, rngThread, rngGroup);
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Every group updates one probe, with one ray per thread
+[numthreads(PROBE_VOLUME_NUM_RAYS, 1, 1)]
+void main(uint3 Gid : SV_GroupID, uint Gidx : SV_GroupIndex)
+{
+    RWTexture3D<float4> g_probeR = ResourceDescriptorHeap[g_local.ProbeVolumeDescHeapIdx];
+    RWTexture3D<float4> g_probeG = ResourceDescriptorHeap[g_local.ProbeVolumeDescHeapIdx + 1];
+    RWTexture3D<float4> g_probeB = ResourceDescriptorHeap[g_local.ProbeVolumeDescHeapIdx + 2];
+    RWTexture3D<uint> g_meta = ResourceDescriptorHeap[g_local.ProbeVolumeDescHeapIdx + 3];
+
+    // Invalidate every probe, rather than updating. Covers the whole volume with one
+    // probe per thread.
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES))
+    {
+        const uint idx = Gid.x * PROBE_VOLUME_NUM_RAYS + Gidx;
+        if(idx < PROBE_VOLUME_NUM_PROBES)
+        {
+            const uint3 texel = uint3(idx & (PROBE_VOLUME_DIM_X - 1),
+                (idx >> PROBE_VOLUME_LOG2_DIM_X) & (PROBE_VOLUME_DIM_Y - 1),
+                idx >> (PROBE_VOLUME_LOG2_DIM_X + PROBE_VOLUME_LOG2_DIM_Y));
+            g_meta[texel] = 0;
+        }
+
+        return;
+    }
+
+    const uint firstProbe = g_local.FirstProbe_NumProbesToUpdate & 0xffff;
+    const uint probeIdx = (firstProbe + Gid.x) & (PROBE_VOLUME_NUM_PROBES - 1);
+    const int3 volumeMin = int3(g_local.ProbeVolumeMin_x, g_local.ProbeVolumeMin_y,
+        g_local.ProbeVolumeMin_z);
+    const ProbeVolume::Probe probe = ProbeVolume::GetProbe(ProbeVolume::IndexToCoord(probeIdx,
+        volumeMin));
+    const float3 pos = ProbeVolume::ProbePos(probe.coord, g_local.ProbeSpacing);
+
+    // Per-group RNG
+    RNG rngGroup = RNG::Init(uint2(probeIdx ^ 61, Gid.x), g_frame.FrameNum);
+    // Per-thread RNG
+    RNG rngThread = RNG::Init(uint2(probeIdx ^ 511, Gidx ^ 31), g_frame.FrameNum);
+
+    // Stratified directions over the sphere
+    const uint2 stratum = uint2(Gidx % NUM_RAYS_PER_AXIS, Gidx / NUM_RAYS_PER_AXIS);
+    const float2 u = ((float2)stratum + rngThread.Uniform2D()) / NUM_RAYS_PER_AXIS;
+    const float3 wi = Sampling::UniformSampleSphere(u);
+
+    ReSTIR_Util::Globals globals = InitGlobals();
+    float3 li = IncidentRadiance(pos, wi, globals, rngThread, rngGroup);
+    if(any(isnan(li)))
+        li = 0;
+
+    // Monte Carlo projection onto SH with uniform sphere sampling (pdf = 1 / 4pi)
+    const float4 y = ProjectToSH1(wi, 4.0f * PI / NUM_RAYS);
+    g_shR[Gidx] = y * li.r;
+    g_shG[Gidx] = y * li.g;
+    g_shB[Gidx] = y * li.b;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for(uint s = NUM_RAYS / 2; s > 0; s >>= 1)
+    {
+        if(Gidx < s)
+        {
+            g_shR[Gidx] += g_shR[Gidx + s];
+            g_shG[Gidx] += g_shG[Gidx + s];
+            g_shB[Gidx] += g_shB[Gidx + s];
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if(Gidx != 0)
+        return;
+
+    // Exponential moving average that starts out as a cumulative average
+    const uint n = min(ProbeVolume::NumUpdates(g_meta[probe.texel], probe) + 1,
+        PROBE_VOLUME_MAX_ACCUM_UPDATES);
+    const float alpha = max(1.0f - g_local.ProbeHysteresis, 1.0f / n);
+
+    // Previous texels may hold garbage
+    if(n == 1)
+    {
+        g_probeR[probe.texel] = g_shR[0];
+        g_probeG[probe.texel] = g_shG[0];
+        g_probeB[probe.texel] = g_shB[0];
+    }
+    else
+    {
+        g_probeR[probe.texel] = lerp(g_probeR[probe.texel], g_shR[0], alpha);
+        g_probeG[probe.texel] = lerp(g_probeG[probe.texel], g_shG[0], alpha);
+        g_probeB[probe.texel] = lerp(g_probeB[probe.texel], g_shB[0], alpha);
+    }
+
+    g_meta[probe.texel] = ProbeVolume::EncodeMeta(n, probe);
+}
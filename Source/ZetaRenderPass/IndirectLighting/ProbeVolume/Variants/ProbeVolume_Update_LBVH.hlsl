@@ -0,0 +1,3 @@
+#define USE_LIGHT_BVH
+#define NEE_EMISSIVE 1
+#include "../ProbeVolume_Update.hlsl"
\ No newline at end of file
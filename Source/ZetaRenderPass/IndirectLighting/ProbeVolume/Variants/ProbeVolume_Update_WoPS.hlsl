@@ -0,0 +1,2 @@
+#define NEE_EMISSIVE 1
+#include "../ProbeVolume_Update.hlsl"
\ No newline at end of file
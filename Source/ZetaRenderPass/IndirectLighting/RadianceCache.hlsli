@@ -0,0 +1,150 @@
+#ifndef RADIANCE_CACHE_H
+#define RADIANCE_CACHE_H
+
+#include "IndirectLighting_Common.h"
+#include "../Common/Sampling.hlsli"
+
+// Refs:
+// 1. P. Bekaert, "Hierarchical and Stochastic Algorithms for Radiosity," Ph.D. thesis, 1999.
+// 2. T. Muller, F. Rousselle, J. Novak and A. Keller, "Real-time Neural Radiance Caching for 
+//    Path Tracing," ACM Transactions on Graphics, 2021.
+
+namespace RadianceCache
+{
+    static const uint INVALID_CELL = UINT32_MAX;
+
+    struct Params
+    {
+        static Params Init(ConstantBuffer<cb_ReSTIR_GI> g_local, uint2 DTid, uint frameNum,
+            float3 cameraPos)
+        {
+            Params ret;
+            // Cells that are about to be cleared shouldn't be used
+            ret.enabled = (g_local.Flags & CB_IND_FLAGS::RADIANCE_CACHE) &&
+                !(g_local.Flags & CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES);
+            ret.descHeapIdx = g_local.RadianceCacheDescHeapIdx;
+            ret.cellSize = g_local.RadianceCacheCellSize;
+            ret.spread = g_local.RadianceCacheSpread;
+            ret.cameraPos = cameraPos;
+
+            // One random pixel in every block trains the cache
+            const uint2 block = DTid >> RADIANCE_CACHE_LOG2_TRAINING_BLOCK_DIM;
+            const uint selected = RNG::PCG(block.x ^ RNG::PCG(block.y ^ RNG::PCG(frameNum))) &
+                (RADIANCE_CACHE_TRAINING_BLOCK_DIM * RADIANCE_CACHE_TRAINING_BLOCK_DIM - 1);
+            const uint2 local = DTid & (RADIANCE_CACHE_TRAINING_BLOCK_DIM - 1);
+            ret.train = ret.enabled &&
+                (selected == local.y * RADIANCE_CACHE_TRAINING_BLOCK_DIM + local.x);
+
+            return ret;
+        }
+
+        float3 cameraPos;
+        float cellSize;
+        float spread;
+        uint descHeapIdx;
+        bool enabled;
+        bool train;
+    };
+
+    // Returns the cell size for given position. Cells are keyed by quantized position,
+    // level of detail and dominant axis of the normal.
+    float Key(float3 pos, float3 normal, Params p, out uint hash, out uint checksum)
+    {
+        const float d = length(pos - p.cameraPos);
+        const uint lod = (uint)clamp(floor(log2(max(d, 1.0f))), 0, 15);
+        const float cellSize = p.cellSize * exp2((float)lod);
+        const uint3 c = asuint((int3)floor(pos / cellSize));
+
+        const float3 a = abs(normal);
+        const uint axis = a.x >= max(a.y, a.z) ? 0 : (a.y >= a.z ? 1 : 2);
+        const uint n = axis * 2 + (normal[axis] < 0);
+
+        hash = RNG::PCG(c.x ^ RNG::PCG(c.y ^ RNG::PCG(c.z ^ RNG::PCG(lod | (n << 4)))));
+        // Independent hash for detecting collisions, zero is reserved for empty cells
+        checksum = max(RNG::PCG3d(uint3(c.x ^ (lod << 24), c.y ^ (n << 24), c.z)).x, 1);
+
+        return cellSize;
+    }
+
+    uint Insert(uint hash, uint checksum, Params p)
+    {
+        RWStructuredBuffer<uint> g_keys = ResourceDescriptorHeap[p.descHeapIdx];
+
+        for(uint i = 0; i < RADIANCE_CACHE_NUM_PROBES; i++)
+        {
+            const uint idx = (hash + i) & (RADIANCE_CACHE_NUM_CELLS - 1);
+            uint prev;
+            InterlockedCompareExchange(g_keys[idx], 0, checksum, prev);
+
+            if(prev == 0 || prev == checksum)
+                return idx;
+        }
+
+        return INVALID_CELL;
+    }
+
+    uint Find(uint hash, uint checksum, Params p)
+    {
+        RWStructuredBuffer<uint> g_keys = ResourceDescriptorHeap[p.descHeapIdx];
+
+        // Evicted cells leave holes behind, so keep probing past empty ones
+        for(uint i = 0; i < RADIANCE_CACHE_NUM_PROBES; i++)
+        {
+            const uint idx = (hash + i) & (RADIANCE_CACHE_NUM_CELLS - 1);
+            if(g_keys[idx] == checksum)
+                return idx;
+        }
+
+        return INVALID_CELL;
+    }
+
+    void AddSample(uint cell, float3 radiance, Params p)
+    {
+        RWStructuredBuffer<uint4> g_accum = ResourceDescriptorHeap[p.descHeapIdx + 1];
+
+        const uint3 q = (uint3)mad(min(radiance, RADIANCE_CACHE_MAX_RADIANCE),
+            RADIANCE_CACHE_FIXED_POINT_SCALE, 0.5f);
+        InterlockedAdd(g_accum[cell].x, q.x);
+        InterlockedAdd(g_accum[cell].y, q.y);
+        InterlockedAdd(g_accum[cell].z, q.z);
+        InterlockedAdd(g_accum[cell].w, 1);
+    }
+
+    // Resolved cell: (r | g << 16, b | #accumulated frames << 16 | #stale frames << 24)
+    uint2 EncodeResolved(float3 radiance, uint numFrames, uint numStaleFrames)
+    {
+        const uint3 h = f32tof16(radiance);
+        return uint2(h.x | (h.y << 16), h.z | (numFrames << 16) | (numStaleFrames << 24));
+    }
+
+    float3 DecodeResolved(uint2 packed, out uint numFrames, out uint numStaleFrames)
+    {
+        numFrames = (packed.y >> 16) & 0xff;
+        numStaleFrames = packed.y >> 24;
+
+        return f16tof32(uint3(packed.x & 0xffff, packed.x >> 16, packed.y & 0xffff));
+    }
+
+    bool Lookup(uint hash, uint checksum, Params p, out float3 radiance)
+    {
+        radiance = 0;
+        const uint cell = Find(hash, checksum, p);
+        if(cell == INVALID_CELL)
+            return false;
+
+        RWStructuredBuffer<uint2> g_resolved = ResourceDescriptorHeap[p.descHeapIdx + 2];
+        uint numFrames;
+        uint numStaleFrames;
+        radiance = DecodeResolved(g_resolved[cell], numFrames, numStaleFrames);
+
+        return numFrames >= RADIANCE_CACHE_MIN_FRAMES;
+    }
+
+    // Path spread increment for a path segment (Bekaert's heuristic)
+    float Spread(float t, float pdf, float cosTheta)
+    {
+        return sqrt(t * t / max(pdf * cosTheta, 1e-6f));
+    }
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "RadianceCache.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cb_ReSTIR_GI> g_local : register(b1);
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Blends this frame's training samples into the cached radiance and evicts the cells that
+// haven't been trained for a while
+[numthreads(RADIANCE_CACHE_RESOLVE_GROUP_DIM_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if(DTid.x >= RADIANCE_CACHE_NUM_CELLS)
+        return;
+
+    RWStructuredBuffer<uint> g_keys = ResourceDescriptorHeap[g_local.RadianceCacheDescHeapIdx];
+    RWStructuredBuffer<uint4> g_accum = ResourceDescriptorHeap[g_local.RadianceCacheDescHeapIdx + 1];
+    RWStructuredBuffer<uint2> g_resolved = ResourceDescriptorHeap[g_local.RadianceCacheDescHeapIdx + 2];
+
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES))
+    {
+        g_keys[DTid.x] = 0;
+        g_accum[DTid.x] = 0;
+        g_resolved[DTid.x] = 0;
+
+        return;
+    }
+
+    if(g_keys[DTid.x] == 0)
+        return;
+
+    const uint4 accum = g_accum[DTid.x];
+    uint numFrames;
+    uint numStaleFrames;
+    float3 radiance = RadianceCache::DecodeResolved(g_resolved[DTid.x], numFrames, numStaleFrames);
+
+    if(accum.w == 0)
+    {
+        numStaleFrames++;
+
+        if(numStaleFrames > RADIANCE_CACHE_MAX_STALE_FRAMES)
+        {
+            g_keys[DTid.x] = 0;
+            g_resolved[DTid.x] = 0;
+        }
+        else
+            g_resolved[DTid.x] = RadianceCache::EncodeResolved(radiance, numFrames, numStaleFrames);
+
+        return;
+    }
+
+    // Exponential moving average once enough frames have been accumulated
+    const float3 sampleMean = (float3)accum.xyz / (RADIANCE_CACHE_FIXED_POINT_SCALE * accum.w);
+    numFrames = min(numFrames + 1, RADIANCE_CACHE_MAX_ACCUM_FRAMES);
+    radiance = lerp(radiance, sampleMean, 1.0f / numFrames);
+
+    g_resolved[DTid.x] = RadianceCache::EncodeResolved(radiance, numFrames, 0);
+    g_accum[DTid.x] = 0;
+}
@@ -153,12 +153,7 @@ namespace RGI_Util
             half2(-0.875, 0.7777777777777777)
         };
 
-        GBUFFER_NORMAL g_prevNormal = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + GBUFFER_OFFSET::NORMAL];
         GBUFFER_DEPTH g_prevDepth = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + GBUFFER_OFFSET::DEPTH];
-        GBUFFER_METALLIC_ROUGHNESS g_prevMetallicRoughness = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-        GBUFFER_BASE_COLOR g_prevBaseColor = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::BASE_COLOR];
 
         // rotate sample sequence per pixel
         const float u0 = rng.Uniform();
@@ -197,13 +192,15 @@ namespace RGI_Util
                     g_frame.PrevCameraJitter, g_frame.CameraNear);
                 bool valid = PlaneHeuristic(posW_i, normal, posW, z_view);
 
-                const float2 mr_i = g_prevMetallicRoughness[posSS_i];
+                const float2 mr_i = GBuffer::LoadMetallicRoughness(posSS_i, 
+                    g_frame.PrevGBufferDescHeapOffset);
                 
                 bool metallic_i;
                 bool emissive_i;
                 GBuffer::DecodeMetallicEmissive(mr_i.x, metallic_i, emissive_i);
 
-                const float3 normal_i = Math::DecodeUnitVector(g_prevNormal[samplePosSS[i]]);
+                const float3 normal_i = Math::DecodeUnitVector(GBuffer::LoadNormal(samplePosSS[i], 
+                    g_frame.PrevGBufferDescHeapOffset));
 
                 // normal heuristic
                 const float normalSimilarity = dot(normal_i, normal);
@@ -234,7 +231,8 @@ namespace RGI_Util
 
         for (int i = 0; i < k; i++)
         {
-            const float3 sampleBaseColor = g_prevBaseColor[samplePosSS[i]].rgb;
+            const float3 sampleBaseColor = GBuffer::LoadBaseColor(samplePosSS[i], 
+                g_frame.PrevGBufferDescHeapOffset).rgb;
 
             const float3 wo_i = normalize(prevCameraPos - samplePosW[i]);
             BSDF::ShadingData surface_i = BSDF::ShadingData::Init(sampleNormal[i], wo_i,
@@ -242,7 +240,8 @@ namespace RGI_Util
 
             Reservoir neighbor = PartialReadReservoir_Reuse(samplePosSS[i],
                 prevReservoir_A_DescHeapIdx,
-                prevReservoir_B_DescHeapIdx);
+                prevReservoir_B_DescHeapIdx,
+                prevCameraPos);
             PartialReadReservoir_ReuseRest(samplePosSS[i], prevReservoir_C_DescHeapIdx, neighbor);
 
             pairwiseMIS.Stream(r, posW, normal, z_view, surface, neighbor, samplePosW[i], 
@@ -4,13 +4,14 @@
 #include "../IndirectLighting_Common.h"
 #include "../../Common/BSDFSampling.hlsli"
 #include "ReSTIR_GI_NEE.hlsli"
+#include "../RadianceCache.hlsli"
 
 namespace ReSTIR_RT
 {
     float3 PathTrace(float3 pos, float3 normal, float ior, uint sampleSetIdx, 
         BSDF::BSDFSample bsdfSample, RtRayQuery::Hit hitInfo, RT::RayDifferentials rd,
         ConstantBuffer<cbFrameConstants> g_frame, ReSTIR_Util::Globals globals,
-        SamplerState samp, inout RNG rngThread, inout RNG rngGroup)
+        RadianceCache::Params rc, SamplerState samp, inout RNG rngThread, inout RNG rngGroup)
     {
         float3 li = 0.0;
         float3 throughput = 1.0f;
@@ -18,9 +19,53 @@ namespace ReSTIR_RT
         int bounce = 0;
         bool inTranslucentMedium = dot(normal, bsdfSample.wi) < 0;
 
+        // Radiance cache -- training paths record (cell, throughput, li) at their first few 
+        // vertices so that radiance leaving each one can be recovered at the end. Other paths 
+        // terminate into the cache once their footprint is large relative to the cell size.
+        float pathSpread = 0;
+        uint trainCells[RADIANCE_CACHE_MAX_TRAINING_VERTICES];
+        float3 trainThroughputs[RADIANCE_CACHE_MAX_TRAINING_VERTICES];
+        float3 trainLi[RADIANCE_CACHE_MAX_TRAINING_VERTICES];
+        int numTrainVertices = 0;
+
         while(true)
         {
             float3 hitPos = mad(hitInfo.t, bsdfSample.wi, pos);
+
+            if(rc.enabled)
+            {
+                uint hash;
+                uint checksum;
+                const float cellSize = RadianceCache::Key(hitPos, hitInfo.normal, rc, hash, checksum);
+
+                if(rc.train)
+                {
+                    const uint cell = numTrainVertices < RADIANCE_CACHE_MAX_TRAINING_VERTICES ?
+                        RadianceCache::Insert(hash, checksum, rc) : RadianceCache::INVALID_CELL;
+
+                    if(cell != RadianceCache::INVALID_CELL)
+                    {
+                        trainCells[numTrainVertices] = cell;
+                        trainThroughputs[numTrainVertices] = throughput;
+                        trainLi[numTrainVertices] = li;
+                        numTrainVertices++;
+                    }
+                }
+                else
+                {
+                    pathSpread += RadianceCache::Spread(hitInfo.t, bsdfSample.pdf, 
+                        abs(dot(hitInfo.normal, bsdfSample.wi)));
+
+                    // Cached radiance includes direct lighting at this vertex
+                    float3 lc;
+                    if((pathSpread >= rc.spread * cellSize) && 
+                        RadianceCache::Lookup(hash, checksum, rc, lc))
+                    {
+                        li += throughput * lc;
+                        break;
+                    }
+                }
+            }
             float3 dpdx;
             float3 dpdy;
             rd.dpdx_dpdy(hitPos, hitInfo.normal, dpdx, dpdy);
@@ -95,6 +140,14 @@ namespace ReSTIR_RT
                 dpdx, dpdy, transmitted, surface.eta);
         }
 
+        // Radiance leaving each training vertex towards the previous one
+        for(int i = 0; i < numTrainVertices; i++)
+        {
+            const float3 t = trainThroughputs[i];
+            const float3 lo = select(t > 0, (li - trainLi[i]) / max(t, 1e-6), 0);
+            RadianceCache::AddSample(trainCells[i], lo, rc);
+        }
+
         return li;
     }
 }
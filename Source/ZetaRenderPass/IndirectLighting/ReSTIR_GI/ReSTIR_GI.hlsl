@@ -6,6 +6,9 @@
 #include "../../Common/Common.hlsli"
 
 #define THREAD_GROUP_SWIZZLING 1
+#define THREAD_REORDER_GROUP_SIZE (RESTIR_GI_TEMPORAL_GROUP_DIM_X * RESTIR_GI_TEMPORAL_GROUP_DIM_Y)
+
+#include "../ThreadReorder.hlsli"
 
 //--------------------------------------------------------------------------------------
 // Root Signature
@@ -15,7 +18,7 @@ ConstantBuffer<cbFrameConstants> g_frame : register(b0);
 ConstantBuffer<cb_ReSTIR_GI> g_local : register(b1);
 RaytracingAccelerationStructure g_bvh : register(t0);
 StructuredBuffer<RT::MeshInstance> g_frameMeshData : register(t1);
-StructuredBuffer<Vertex> g_vertices : register(t2);
+StructuredBuffer<PackedVertex> g_vertices : register(t2);
 StructuredBuffer<uint> g_indices : register(t3);
 StructuredBuffer<Material> g_materials : register(t4);
 #if NEE_EMISSIVE == 1
@@ -23,6 +26,10 @@ StructuredBuffer<RT::EmissiveTriangle> g_emissives : register(t5);
 StructuredBuffer<RT::PresampledEmissiveTriangle> g_sampleSets : register(t6);
 StructuredBuffer<RT::EmissiveLumenAliasTableEntry> g_aliasTable : register(t7);
 StructuredBuffer<RT::VoxelSample> g_lvg : register(t8);
+#ifdef USE_LIGHT_BVH
+StructuredBuffer<RT::LightBVHNode> g_lightBVH : register(t9);
+StructuredBuffer<uint> g_lightBVHTriToLeaf : register(t10);
+#endif
 #endif
 
 //--------------------------------------------------------------------------------------
@@ -46,6 +53,11 @@ ReSTIR_Util::Globals InitGlobals(bool transmissive)
     globals.sampleSets = g_sampleSets;
     globals.aliasTable = g_aliasTable;
     globals.sampleSetSize = (uint16_t)(g_local.SampleSetSize_NumSampleSets & 0xffff);
+#ifdef USE_LIGHT_BVH
+    globals.lightBVH = g_lightBVH;
+    globals.lightBVHTriToLeaf = g_lightBVHTriToLeaf;
+    globals.lightBVHLog2ClusterSize = (uint16_t)g_frame.LightBVHLog2ClusterSize;
+#endif
     globals.lvg = g_lvg;
     globals.gridDim = uint16_t3(g_local.GridDim_xy & 0xffff, g_local.GridDim_xy >> 16, (uint16_t)g_local.GridDim_z);
     globals.extents = asfloat16(uint16_t3(g_local.Extents_xy & 0xffff, g_local.Extents_xy >> 16, 
@@ -62,7 +74,8 @@ ReSTIR_Util::Globals InitGlobals(bool transmissive)
 //--------------------------------------------------------------------------------------
 
 [numthreads(RESTIR_GI_TEMPORAL_GROUP_DIM_X, RESTIR_GI_TEMPORAL_GROUP_DIM_Y, 1)]
-void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID)
+void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID,
+    uint Gidx : SV_GroupIndex)
 {
 #if THREAD_GROUP_SWIZZLING == 1
     uint16_t2 swizzledGid;
@@ -75,22 +88,31 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         uint16_t(g_local.DispatchDimX_NumGroupsInTile >> 16),
         swizzledGid);
 #else
-    const uint2 swizzledDTid = DTid.xy;
+    uint2 swizzledDTid = DTid.xy;
     const uint2 swizzledGid = Gid.xy;
 #endif
+
+    const RESTIR_GI_RESOLUTION res = (RESTIR_GI_RESOLUTION)g_local.Resolution;
+    swizzledDTid = RGI_Util::TracedPixel(swizzledDTid, res, g_frame.FrameNum);
+
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::REORDER_THREADS))
+        swizzledDTid = ThreadReorder::Reorder(swizzledDTid, Gidx, g_frame);
     
     if (swizzledDTid.x >= g_frame.RenderWidth || swizzledDTid.y >= g_frame.RenderHeight)
         return;
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr = g_metallicRoughness[swizzledDTid];
+    const float2 mr = GBuffer::LoadMetallicRoughness(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
 
     RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
 
     if (flags.invalid || flags.emissive)
     {
+        // Handled by the upsampling pass
+        if(res != RESTIR_GI_RESOLUTION::FULL)
+            return;
+
         if(!g_frame.Accumulate || !g_frame.CameraStatic)
             g_final[swizzledDTid].rgb = 0;
     
@@ -116,23 +138,18 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz, 
         g_frame.DoF, lensSample, g_frame.FocusDepth, origin);
 
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_normal[swizzledDTid.xy]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(swizzledDTid.xy, 
+        g_frame.CurrGBufferDescHeapOffset));
 
-    GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
-    const float3 baseColor = g_baseColor[swizzledDTid].rgb;
+    const float3 baseColor = GBuffer::LoadBaseColor(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset).rgb;
 
     float eta_curr = ETA_AIR;
     float eta_next = DEFAULT_ETA_MAT;
 
     if(flags.transmissive)
     {
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
-
-        float ior = g_ior[swizzledDTid];
+        float ior = GBuffer::LoadIOR(swizzledDTid, g_frame.CurrGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
@@ -154,7 +171,13 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         float3 li = r.target_z * r.W;
         li = any(isnan(li)) ? 0 : li;
 
-        if(g_frame.Accumulate && g_frame.CameraStatic)
+        // Upsampling pass needs this frame's estimates and takes care of accumulation
+        if(res != RESTIR_GI_RESOLUTION::FULL)
+        {
+            RWTexture2D<float4> g_sparse = ResourceDescriptorHeap[g_local.SparseDescHeapIdx];
+            g_sparse[swizzledDTid].rgb = li;
+        }
+        else if(g_frame.Accumulate && g_frame.CameraStatic)
         {
             float3 prev = g_final[swizzledDTid].rgb;
             g_final[swizzledDTid].rgb = prev + li;
@@ -47,9 +47,17 @@ namespace RGI_Util
                 lightNormal = emissive.IsDoubleSided() && dot(-wi, lightNormal) < 0 ? 
                     -lightNormal : lightNormal;
 
+#if defined(USE_LIGHT_BVH)
+                const float lightSourcePdf = numLightSamples > 0 ?
+                    LightBVH::TrianglePdf(pos, normal, surface.Transmissive(), 
+                        hitInfo.emissiveTriIdx, numEmissives, globals.lightBVHLog2ClusterSize, 
+                        globals.lightBVH, globals.lightBVHTriToLeaf) : 
+                    0;
+#else
                 const float lightSourcePdf = numLightSamples > 0 ?
                     globals.aliasTable[hitInfo.emissiveTriIdx].CachedP_Orig : 
                     0;
+#endif
                 const float lightPdf = lightSourcePdf * (2.0f / twoArea);
 
                 // Solid angle measure to area measure
@@ -76,12 +84,29 @@ namespace RGI_Util
 
             float3 le = tri.le;
             const float lightPdf = tri.pdf;
+            // Presampled sets can be drawn from a different distribution than the one
+            // BSDF samples use for MIS
+            const float lightPdf_mis = tri.sourcePdf;
             const uint emissiveIdx = tri.idx;
             const uint lightID = tri.ID;
 
             if(tri.twoSided && dot(pos - tri.pos, lightSample.normal) < 0)
                 lightSample.normal *= -1;
-#else
+#elif defined(USE_LIGHT_BVH)
+            LightBVH::Sample entry = LightBVH::SampleTriangle(pos, normal, surface.Transmissive(),
+                numEmissives, globals.lightBVHLog2ClusterSize, globals.lightBVH, 
+                globals.lightBVHTriToLeaf, rng);
+            // No light source can contribute to this point
+            if(entry.pdf == 0)
+                continue;
+
+            RT::EmissiveTriangle tri = globals.emissives[entry.idx];
+            Light::EmissiveTriSample lightSample = Light::EmissiveTriSample::get(pos, tri, rng);
+
+            float3 le = Light::Le_EmissiveTriangle(tri, lightSample.bary, emissiveMapsDescHeapOffset);
+            const float lightPdf = entry.pdf * lightSample.pdf;
+            const float lightPdf_mis = lightPdf;
+            const uint lightID = tri.ID;
             Light::AliasTableSample entry = Light::AliasTableSample::get(globals.aliasTable, 
                 numEmissives, rng);
             RT::EmissiveTriangle tri = globals.emissives[entry.idx];
@@ -89,6 +114,7 @@ namespace RGI_Util
 
             float3 le = Light::Le_EmissiveTriangle(tri, lightSample.bary, emissiveMapsDescHeapOffset);
             const float lightPdf = entry.pdf * lightSample.pdf;
+            const float lightPdf_mis = lightPdf;
             const uint lightID = tri.ID;
 #endif
 
@@ -111,7 +137,8 @@ namespace RGI_Util
                     BSDF::BSDFSamplerPdf(normal, surface, wi, rng);
                 bsdfPdf *= dwdA;
 
-                ret.ld += RT::PowerHeuristic(lightPdf, bsdfPdf, le, numLightSamples);
+                le *= lightPdf > 0 ? lightPdf_mis / lightPdf : 0;
+                ret.ld += RT::PowerHeuristic(lightPdf_mis, bsdfPdf, le, numLightSamples);
             }
         }
 
@@ -134,7 +161,7 @@ namespace RGI_Util
             float lightPdf;
             uint lightID;
 
-            if(LVG::Sample(pos, globals.gridDim, globals.extents, 64, view, globals.lvg, s, rng, (float)globals.offset_y))
+            if(LVG::Sample(pos, globals.gridDim, globals.extents, NUM_SAMPLES_PER_VOXEL, view, globals.lvg, s, rng, (float)globals.offset_y))
             {
                 lightSample.pos = s.pos;
                 lightSample.normal = Math::DecodeOct32(s.normal);
@@ -0,0 +1,125 @@
+#include "ReducedResolution.hlsli"
+#include "../../Common/Common.hlsli"
+#include "../../Common/GBuffers.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b0);
+ConstantBuffer<cb_ReSTIR_GI> g_local : register(b1);
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// Weighted average of neighboring pixels that were traced this frame, where neighbors
+// on a different surface (according to depth and normal) are rejected
+float3 Upsample(int2 DTid, float z_view, float3 normal, RESTIR_GI_RESOLUTION res)
+{
+    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
+        GBUFFER_OFFSET::DEPTH];
+    RWTexture2D<float4> g_sparse = ResourceDescriptorHeap[g_local.SparseDescHeapIdx];
+
+    float3 weightedSum = 0;
+    float weightSum = 0;
+    // Used when geometry weights all go to zero
+    float3 fallbackSum = 0;
+    float numFallback = 0;
+
+    [unroll]
+    for(int i = -1; i <= 1; i++)
+    {
+        [unroll]
+        for(int j = -1; j <= 1; j++)
+        {
+            const int2 q = DTid + int2(j, i);
+
+            if(any(q < 0) || q.x >= (int)g_frame.RenderWidth || q.y >= (int)g_frame.RenderHeight)
+                continue;
+
+            if(!RGI_Util::IsTraced(q, res, g_frame.FrameNum))
+                continue;
+
+            const GBuffer::Flags flags_q = GBuffer::DecodeMetallic(GBuffer::LoadMetallicRoughness(q, 
+                g_frame.CurrGBufferDescHeapOffset).x);
+            if(flags_q.invalid || flags_q.emissive)
+                continue;
+
+            const float3 li_q = g_sparse[q].rgb;
+            const float z_q = g_depth[q];
+            const float3 normal_q = Math::DecodeUnitVector(GBuffer::LoadNormal(q, 
+                g_frame.CurrGBufferDescHeapOffset));
+
+            const float w_z = exp(-abs(z_q - z_view) / (RESTIR_GI_UPSAMPLE_DEPTH_SIGMA *
+                max(z_view, 1e-4f)));
+            const float w_n = pow(saturate(dot(normal_q, normal)), RESTIR_GI_UPSAMPLE_NORMAL_EXP);
+            // Prefer direct neighbors over diagonal ones
+            const float w_d = (i == 0 || j == 0) ? 1.0f : 0.5f;
+            const float w = w_z * w_n * w_d;
+
+            weightedSum += w * li_q;
+            weightSum += w;
+            fallbackSum += li_q;
+            numFallback++;
+        }
+    }
+
+    if(weightSum > 1e-6f)
+        return weightedSum / weightSum;
+
+    return numFallback > 0 ? fallbackSum / numFallback : 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(RESTIR_GI_TEMPORAL_GROUP_DIM_X, RESTIR_GI_TEMPORAL_GROUP_DIM_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_frame.RenderWidth || DTid.y >= g_frame.RenderHeight)
+        return;
+
+    const GBuffer::Flags flags = GBuffer::DecodeMetallic(GBuffer::LoadMetallicRoughness(DTid.xy, 
+        g_frame.CurrGBufferDescHeapOffset).x);
+
+    RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.FinalDescHeapIdx];
+    const bool accumulate = g_frame.Accumulate && g_frame.CameraStatic;
+
+    if (flags.invalid || flags.emissive)
+    {
+        if(!accumulate)
+            g_final[DTid.xy].rgb = 0;
+
+        return;
+    }
+
+    const RESTIR_GI_RESOLUTION res = (RESTIR_GI_RESOLUTION)g_local.Resolution;
+    float3 li;
+
+    if(RGI_Util::IsTraced(DTid.xy, res, g_frame.FrameNum))
+    {
+        RWTexture2D<float4> g_sparse = ResourceDescriptorHeap[g_local.SparseDescHeapIdx];
+        li = g_sparse[DTid.xy].rgb;
+    }
+    else
+    {
+        GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
+            GBUFFER_OFFSET::DEPTH];
+
+        const float z_view = g_depth[DTid.xy];
+        const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(DTid.xy, 
+            g_frame.CurrGBufferDescHeapOffset));
+
+        li = Upsample(DTid.xy, z_view, normal, res);
+    }
+
+    if(accumulate)
+    {
+        float3 prev = g_final[DTid.xy].rgb;
+        g_final[DTid.xy].rgb = prev + li;
+    }
+    else
+        g_final[DTid.xy].rgb = li;
+}
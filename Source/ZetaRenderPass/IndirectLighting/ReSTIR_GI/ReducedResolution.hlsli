@@ -0,0 +1,53 @@
+#ifndef RESTIR_GI_REDUCED_RESOLUTION_H
+#define RESTIR_GI_REDUCED_RESOLUTION_H
+
+#include "../IndirectLighting_Common.h"
+
+// Pixels that are traced in each frame of reduced-resolution modes. Phase alternates every
+// frame, so that after two (checkerboard) or four (half) frames every pixel has been traced.
+namespace RGI_Util
+{
+    uint2 HalfResOffset(uint frameNum)
+    {
+        // (0, 0), (1, 1), (1, 0), (0, 1)
+        const uint i = frameNum & 0x3;
+        return uint2(i == 1 || i == 2, i == 1 || i == 3);
+    }
+
+    // Maps dispatch thread ID to the pixel that it traces
+    uint2 TracedPixel(uint2 DTid, RESTIR_GI_RESOLUTION res, uint frameNum)
+    {
+        if(res == RESTIR_GI_RESOLUTION::CHECKERBOARD)
+            return uint2(2 * DTid.x + ((DTid.y + frameNum) & 0x1), DTid.y);
+
+        if(res == RESTIR_GI_RESOLUTION::HALF)
+            return 2 * DTid + HalfResOffset(frameNum);
+
+        return DTid;
+    }
+
+    bool IsTraced(int2 pixel, RESTIR_GI_RESOLUTION res, uint frameNum)
+    {
+        if(res == RESTIR_GI_RESOLUTION::CHECKERBOARD)
+            return (pixel.x & 0x1) == ((pixel.y + frameNum) & 0x1);
+
+        if(res == RESTIR_GI_RESOLUTION::HALF)
+            return all((pixel & 0x1) == HalfResOffset(frameNum));
+
+        return true;
+    }
+
+    // Closest pixel that was traced in given frame -- reservoirs for other pixels are outdated
+    int2 NearestTracedPixel(int2 pixel, RESTIR_GI_RESOLUTION res, uint frameNum)
+    {
+        if(res == RESTIR_GI_RESOLUTION::CHECKERBOARD)
+            return int2((pixel.x & ~0x1) | ((pixel.y + frameNum) & 0x1), pixel.y);
+
+        if(res == RESTIR_GI_RESOLUTION::HALF)
+            return (pixel & ~0x1) | (int2)HalfResOffset(frameNum);
+
+        return pixel;
+    }
+}
+
+#endif
@@ -4,6 +4,8 @@
 #include "Params.hlsli"
 #include "PathTracing.hlsli"
 #include "Reservoir.hlsli"
+#include "ReducedResolution.hlsli"
+#include "../../Common/Common.hlsli"
 
 namespace RGI_Util
 {
@@ -38,7 +40,7 @@ namespace RGI_Util
     RGI_Util::Reservoir RIS_InitialCandidates(uint2 DTid, float3 origin, float2 lensSample,
         float3 primaryPos, float3 primaryNormal, float ior, BSDF::ShadingData primarySurface, 
         uint sampleSetIdx, ConstantBuffer<cbFrameConstants> g_frame, ReSTIR_Util::Globals globals, 
-        SamplerState samp, inout RNG rngThread, inout RNG rngGroup)
+        RadianceCache::Params rc, SamplerState samp, inout RNG rngThread, inout RNG rngGroup)
     {
         RGI_Util::Reservoir r = RGI_Util::Reservoir::Init();
 
@@ -47,14 +49,9 @@ namespace RGI_Util
         if(bsdfSample.pdf == 0)
             return r;
 
-        GBUFFER_TRI_DIFF_GEO_A g_triA = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::TRI_DIFF_GEO_A];
-        GBUFFER_TRI_DIFF_GEO_B g_triB = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::TRI_DIFF_GEO_B];
-        const uint4 packed_a = g_triA[DTid];
-        const uint2 packed_b = g_triB[DTid];
-
-        Math::TriDifferentials triDiffs = Math::TriDifferentials::Unpack(packed_a, packed_b);
+        Math::TriDifferentials triDiffs = RT::LoadTriDifferentials(DTid, 
+            g_frame.CurrGBufferDescHeapOffset, true, g_frame.VisibilityBuffer, g_frameMeshData, 
+            g_vertices, g_indices);
         float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
 
         RT::RayDifferentials rd = RT::RayDifferentials::Init(DTid, renderDim, 
@@ -83,7 +80,7 @@ namespace RGI_Util
 
         // Path tracing loop to find incident radiance from sample point towards primary surface
         float3 lo = ReSTIR_RT::PathTrace(primaryPos, primaryNormal, ior, sampleSetIdx, bsdfSample, 
-            hitInfo, rd, g_frame, globals, samp, rngThread, rngGroup);
+            hitInfo, rd, g_frame, globals, rc, samp, rngThread, rngGroup);
 
         // target = lo * BSDF(wi, wo) * |ndotwi|
         // source = P(wi)
@@ -117,8 +114,8 @@ namespace RGI_Util
 
     template<int N>
     TemporalSamples<N> FindTemporalCandidate(uint2 DTid, float3 posW, float3 normal, float viewZ, 
-        float roughness, bool transmissive, float2 prevUV, ConstantBuffer<cbFrameConstants> g_frame, 
-        inout RNG rng)
+        float roughness, bool transmissive, float2 prevUV, RESTIR_GI_RESOLUTION res, 
+        ConstantBuffer<cbFrameConstants> g_frame, inout RNG rng)
     {
         TemporalSamples<N> candidate = RGI_Util::TemporalSamples<N>::Init();
 
@@ -127,12 +124,6 @@ namespace RGI_Util
 
         GBUFFER_DEPTH g_prevDepth = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + 
             GBUFFER_OFFSET::DEPTH];
-        GBUFFER_NORMAL g_prevNormal = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::NORMAL];
-        GBUFFER_METALLIC_ROUGHNESS g_prevMR = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
 
         const float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
         int2 prevPixel = prevUV * renderDim;
@@ -147,6 +138,8 @@ namespace RGI_Util
             const float cosTheta = cos(theta);
             const float2 offset = TEMPORAL_SEARCH_RADIUS * float2(sinTheta, cosTheta);
             int2 samplePosSS = prevPixel + (i > 0) * offset;
+            // Only reservoirs that were traced in previous frame are up to date
+            samplePosSS = RGI_Util::NearestTracedPixel(samplePosSS, res, g_frame.FrameNum - 1);
 
             if(samplePosSS.x >= renderDim.x || samplePosSS.y >= renderDim.y)
                 continue;
@@ -154,7 +147,8 @@ namespace RGI_Util
             if(i > 0 && samplePosSS.x == DTid.x && samplePosSS.y == DTid.y)
                 continue;
 
-            const float2 prevMR = g_prevMR[samplePosSS];
+            const float2 prevMR = GBuffer::LoadMetallicRoughness(samplePosSS, 
+                g_frame.PrevGBufferDescHeapOffset);
             GBuffer::Flags prevFlags = GBuffer::DecodeMetallic(prevMR.x);
 
             if(prevFlags.emissive)
@@ -181,7 +175,8 @@ namespace RGI_Util
             if(!RGI_Util::PlaneHeuristic(prevPos, normal, posW, viewZ, tolerance))
                 continue;
 
-            const float3 prevNormal = Math::DecodeUnitVector(g_prevNormal[samplePosSS]);
+            const float3 prevNormal = Math::DecodeUnitVector(GBuffer::LoadNormal(samplePosSS, 
+                g_frame.PrevGBufferDescHeapOffset));
             candidate.valid[curr] = dot(prevNormal, normal) > 0.1;
 
             if(roughness < 0.5)
@@ -194,7 +189,7 @@ namespace RGI_Util
 
             if(prevFlags.transmissive)
             {
-                float ior = g_ior[samplePosSS];
+                float ior = GBuffer::LoadIOR(samplePosSS, g_frame.PrevGBufferDescHeapOffset);
                 prevEta_mat = GBuffer::DecodeIOR(ior);
             }
 
@@ -232,10 +227,8 @@ namespace RGI_Util
         float t = length(wi);
         wi /= max(t, 1e-6);
 
-        GBUFFER_BASE_COLOR g_prevBaseColor = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::BASE_COLOR];
-
-        const float3 baseColor_prev = g_prevBaseColor[candidate.posSS].rgb;
+        const float3 baseColor_prev = GBuffer::LoadBaseColor(candidate.posSS, 
+            g_frame.PrevGBufferDescHeapOffset).rgb;
         float3 camPos_prev = float3(g_frame.PrevViewInv._m03, g_frame.PrevViewInv._m13, 
             g_frame.PrevViewInv._m23);
         if(g_frame.DoF)
@@ -297,11 +290,14 @@ namespace RGI_Util
     void TemporalResample1(float3 posW, float3 normal, float roughness, BSDF::ShadingData surface, 
         uint prevReservoir_A_DescHeapIdx, uint prevReservoir_B_DescHeapIdx, uint prevReservoir_C_DescHeapIdx,
         TemporalSampleData candidate, ConstantBuffer<cbFrameConstants> g_frame, 
-        RaytracingAccelerationStructure g_bvh, inout Reservoir r, inout RNG rng)
+        RaytracingAccelerationStructure g_bvh, bool revalidate, inout Reservoir r, inout RNG rng)
     {
+        const float3 prevCameraPos = float3(g_frame.PrevViewInv._m03, g_frame.PrevViewInv._m13, 
+            g_frame.PrevViewInv._m23);
         Reservoir r_prev = PartialReadReservoir_Reuse(candidate.posSS,
             prevReservoir_A_DescHeapIdx,
-            prevReservoir_B_DescHeapIdx);
+            prevReservoir_B_DescHeapIdx,
+            prevCameraPos);
 
         const uint16_t M_new = (uint16_t)(r.M + r_prev.M);
 
@@ -346,7 +342,12 @@ namespace RGI_Util
         // Target at current pixel with temporal reservoir's sample
         if(targetLum_curr > 1e-6)
         {
-            if(RtRayQuery::Visibility_Segment(posW, wi, t, normal, r_prev.ID, g_bvh, surface.Transmissive()))
+            // Otherwise, trust that it's still visible (it was, the last time it was checked)
+            bool visible = true;
+            if(revalidate)
+                visible = RtRayQuery::Visibility_Segment(posW, wi, t, normal, r_prev.ID, g_bvh, surface.Transmissive());
+
+            if(visible)
             {
                 PartialReadReservoir_ReuseRest(candidate.posSS, prevReservoir_C_DescHeapIdx, r_prev);
 
@@ -371,16 +372,19 @@ namespace RGI_Util
     void TemporalResample2(float3 posW, float3 normal, float roughness, BSDF::ShadingData surface, 
         uint prevReservoir_A_DescHeapIdx, uint prevReservoir_B_DescHeapIdx, uint prevReservoir_C_DescHeapIdx,
         TemporalSampleData candidate[2], ConstantBuffer<cbFrameConstants> g_frame, RaytracingAccelerationStructure g_bvh, 
-        inout Reservoir r, inout RNG rng)
+        bool revalidate, inout Reservoir r, inout RNG rng)
     {
         uint16_t M_new = (uint16_t)r.M;
         Reservoir r_prev[2];
+        const float3 prevCameraPos = float3(g_frame.PrevViewInv._m03, g_frame.PrevViewInv._m13, 
+            g_frame.PrevViewInv._m23);
 
         for (int k = 0; k < 2; k++)
         {
             r_prev[k] = PartialReadReservoir_Reuse(candidate[k].posSS,
                 prevReservoir_A_DescHeapIdx,
-                prevReservoir_B_DescHeapIdx);
+                prevReservoir_B_DescHeapIdx,
+                prevCameraPos);
 
             M_new += r_prev[k].M;
         }
@@ -422,7 +426,11 @@ namespace RGI_Util
             if(targetLum_curr < 1e-5f)
                 continue;
 
-            if(RtRayQuery::Visibility_Segment(posW, wi, t, normal, r_prev[i].ID, g_bvh, surface.Transmissive()))
+            bool visible = true;
+            if(revalidate)
+                visible = RtRayQuery::Visibility_Segment(posW, wi, t, normal, r_prev[i].ID, g_bvh, surface.Transmissive());
+
+            if(visible)
             {
                 PartialReadReservoir_ReuseRest(candidate[i].posSS, prevReservoir_C_DescHeapIdx, r_prev[i]);
 
@@ -541,11 +549,16 @@ namespace RGI_Util
         ConstantBuffer<cb_ReSTIR_GI> g_local, 
         ReSTIR_Util::Globals globals, inout RNG rngThread, inout RNG rngGroup)
     {
-        // Artifacts become noticeable in motion for specular surfaces
+        RadianceCache::Params rc = RadianceCache::Params::Init(g_local, DTid, g_frame.FrameNum,
+            g_frame.CameraPos);
+
+        // Artifacts become noticeable in motion for specular surfaces. Training paths need 
+        // every bounce.
         if(IS_CB_FLAG_SET(CB_IND_FLAGS::STOCHASTIC_MULTI_BOUNCE) && 
             (roughness >= 0.1 || g_frame.CameraStatic))
         {
-            globals.maxNumBounces = rngGroup.Uniform() < 0.5 ? (uint16_t)1 : 
+            const bool truncate = rngGroup.Uniform() < 0.5;
+            globals.maxNumBounces = truncate && !rc.train ? (uint16_t)1 : 
                 globals.maxNumBounces;
         }
 
@@ -553,9 +566,7 @@ namespace RGI_Util
         const uint sampleSetIdx = rngGroup.UniformUintBounded_Faster(g_local.SampleSetSize_NumSampleSets >> 16);
         SamplerState samp = SamplerDescriptorHeap[g_local.TexFilterDescHeapIdx];
 
-        RGI_Util::Reservoir r = RGI_Util::RIS_InitialCandidates(DTid, origin, lensSample, 
-            pos, normal, ior, surface, sampleSetIdx, g_frame, globals, samp, 
-            rngThread, rngGroup);
+        RGI_Util::Reservoir r = RGI_Util::Reservoir::Init();
 
         if (IS_CB_FLAG_SET(CB_IND_FLAGS::TEMPORAL_RESAMPLE))
         {            
@@ -567,39 +578,59 @@ namespace RGI_Util
             const float2 currUV = (DTid + 0.5f) / renderDim;
             const float2 prevSurfaceUV = currUV - motionVec;
             float2 prevUV = prevSurfaceUV;
-            float3 reflectedPos = r.pos;
 
             TemporalSamples<2> candidate = RGI_Util::FindTemporalCandidate<2>(DTid, pos, normal, 
-                z_view, roughness, surface.specTr, prevUV, g_frame, rngThread);
+                z_view, roughness, surface.specTr, prevUV, (RESTIR_GI_RESOLUTION)g_local.Resolution, 
+                g_frame, rngThread);
+
+            // Pixels that aren't scheduled this frame only reuse their previous reservoir,
+            // unless it's not available (e.g. disocclusion). Training paths are always traced.
+            const bool reusable = candidate.valid[0] || (candidate.valid[1] && roughness > 0.05);
+
+            if (!reusable || rc.train || Common::IsPixelScheduled(DTid, g_frame.FrameNum, 
+                g_local.ResamplingInterval))
+            {
+                r = RGI_Util::RIS_InitialCandidates(DTid, origin, lensSample, pos, normal, 
+                    ior, surface, sampleSetIdx, g_frame, globals, rc, samp, rngThread, rngGroup);
+            }
 
             // candidate.valid[0] = candidate.valid[0] && !r.IsValid();
 
+            const bool revalidate = IS_CB_FLAG_SET(CB_IND_FLAGS::REVALIDATE_ALL) ||
+                Common::IsVisibilityRevalidated(DTid, g_frame.FrameNum, g_local.ValidationInterval,
+                motionVec * renderDim);
+
             // Skip temporal resampling if no valid sample is found
             if (candidate.valid[1] && roughness > 0.05)
             {
                 RGI_Util::TemporalResample2(pos, normal, roughness, surface,
                     g_local.PrevReservoir_A_DescHeapIdx, g_local.PrevReservoir_B_DescHeapIdx, 
                     g_local.PrevReservoir_C_DescHeapIdx, candidate.data, g_frame, 
-                    globals.bvh, r, rngThread);
+                    globals.bvh, revalidate, r, rngThread);
             }
             else if (candidate.valid[0])
             {
                  RGI_Util::TemporalResample1(pos, normal, roughness, surface,
                      g_local.PrevReservoir_A_DescHeapIdx, g_local.PrevReservoir_B_DescHeapIdx, 
                      g_local.PrevReservoir_C_DescHeapIdx, candidate.data[0], g_frame, 
-                     globals.bvh, r, rngThread);
+                     globals.bvh, revalidate, r, rngThread);
             }
 
             if(IS_CB_FLAG_SET(CB_IND_FLAGS::BOILING_SUPPRESSION))
                 SuppressOutlierReservoirs(r);
         }
+        else
+        {
+            r = RGI_Util::RIS_InitialCandidates(DTid, origin, lensSample, pos, normal, ior, 
+                surface, sampleSetIdx, g_frame, globals, rc, samp, rngThread, rngGroup);
+        }
 
         if (IS_CB_FLAG_SET(CB_IND_FLAGS::TEMPORAL_RESAMPLE) ||
             IS_CB_FLAG_SET(CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES))
         {
             RGI_Util::WriteReservoir(DTid, r, g_local.CurrReservoir_A_DescHeapIdx,
                 g_local.CurrReservoir_B_DescHeapIdx, g_local.CurrReservoir_C_DescHeapIdx, 
-                g_local.M_max);
+                g_local.M_max, g_frame.CameraPos);
         }
 
         // if (IS_CB_FLAG_SET(CB_IND_FLAGS::SPATIAL_RESAMPLE))
@@ -78,7 +78,73 @@ namespace RGI_Util
         half M;
     };
 
-    Reservoir PartialReadReservoir_Reuse(uint2 DTid, uint inputAIdx, uint inputBIdx)
+#if RESTIR_GI_COMPACT_RESERVOIRS == 1
+    // Layout:
+    //  - A (uint4): octahedral direction from camera to sample position, distance to camera,
+    //    hit ID and M
+    //  - B (R11G11B10): Lo
+    //  - C (uint2): w_sum & W as 16-bit floats, octahedral normal
+    //
+    // Positions are relative to the camera that wrote them, which for reads (all of
+    // which are from the previous frame's reservoirs) is the previous frame's camera.
+    Reservoir PartialReadReservoir_Reuse(uint2 DTid, uint inputAIdx, uint inputBIdx, 
+        float3 prevCameraPos)
+    {
+        Texture2D<uint4> g_reservoir_A = ResourceDescriptorHeap[inputAIdx];
+        Texture2D<float3> g_reservoir_B = ResourceDescriptorHeap[inputBIdx];
+        const uint4 resA = g_reservoir_A[DTid];
+
+        float3 wi = Math::DecodeOct32(Math::UnpackUintToUint16(resA.x));
+        float3 pos = mad(asfloat(resA.y), wi, prevCameraPos);
+        float3 Lo = g_reservoir_B[DTid];
+        uint16_t M = (uint16_t)resA.w;
+
+        return Reservoir::Init(pos, M, Lo, resA.z);
+    }
+
+    void PartialReadReservoir_ReuseRest(uint2 DTid, uint inputCIdx, inout Reservoir r)
+    {
+        Texture2D<uint2> g_reservoir_C = ResourceDescriptorHeap[inputCIdx];
+        const uint2 resC = g_reservoir_C[DTid];
+        r.w_sum = f16tof32(resC.x);
+        r.W = f16tof32(resC.x >> 16);
+        r.normal = Math::DecodeOct32(Math::UnpackUintToUint16(resC.y));
+    }
+
+    float3 PartialReadReservoir_Pos(uint2 DTid, uint inputAIdx, float3 prevCameraPos)
+    {
+        Texture2D<uint4> g_reservoir_A = ResourceDescriptorHeap[inputAIdx];
+        const uint2 resA = g_reservoir_A[DTid].xy;
+        float3 wi = Math::DecodeOct32(Math::UnpackUintToUint16(resA.x));
+
+        return mad(asfloat(resA.y), wi, prevCameraPos);
+    }
+
+    void WriteReservoir(uint2 DTid, Reservoir r, uint outputAIdx, uint outputBIdx, uint outputCIdx, 
+        float M_max, float3 cameraPos)
+    {
+        RWTexture2D<uint4> g_outReservoir_A = ResourceDescriptorHeap[outputAIdx];
+        RWTexture2D<float3> g_outReservoir_B = ResourceDescriptorHeap[outputBIdx];
+        RWTexture2D<uint2> g_outReservoir_C = ResourceDescriptorHeap[outputCIdx];
+
+        // Position of invalid reservoirs is never used
+        const float3 toPos = r.IsValid() ? r.pos - cameraPos : float3(0, 0, 1);
+        const float dist = length(toPos);
+        const float3 wi = dist > 0 ? toPos / dist : float3(0, 0, 1);
+        const uint M_clamped = (uint)min(r.M, (half)M_max);
+
+        uint4 outA = uint4(Math::EncodeOct32u(wi), asuint(dist), r.ID, M_clamped);
+        // 16-bit floats, clamped to avoid infinities
+        uint weights = f32tof16(min(r.w_sum, FLT16_MAX)) | (f32tof16(min(r.W, FLT16_MAX)) << 16);
+        uint2 outC = uint2(weights, Math::EncodeOct32u(r.normal));
+
+        g_outReservoir_A[DTid] = outA;
+        g_outReservoir_B[DTid] = r.Lo;
+        g_outReservoir_C[DTid] = outC;
+    }
+#else
+    Reservoir PartialReadReservoir_Reuse(uint2 DTid, uint inputAIdx, uint inputBIdx, 
+        float3 prevCameraPos)
     {
         Texture2D<float4> g_reservoir_A = ResourceDescriptorHeap[inputAIdx];
         Texture2D<half4> g_reservoir_B = ResourceDescriptorHeap[inputBIdx];
@@ -105,13 +171,14 @@ namespace RGI_Util
         r.normal = Math::DecodeOct32(ns);
     }
 
-    float3 PartialReadReservoir_Pos(uint2 DTid, uint inputAIdx)
+    float3 PartialReadReservoir_Pos(uint2 DTid, uint inputAIdx, float3 prevCameraPos)
     {
         Texture2D<float4> g_reservoir_A = ResourceDescriptorHeap[inputAIdx];
         return g_reservoir_A[DTid].xyz;
     }
 
-    void WriteReservoir(uint2 DTid, Reservoir r, uint outputAIdx, uint outputBIdx, uint outputCIdx, float M_max)
+    void WriteReservoir(uint2 DTid, Reservoir r, uint outputAIdx, uint outputBIdx, uint outputCIdx, 
+        float M_max, float3 cameraPos)
     {
         RWTexture2D<float4> g_outReservoir_A = ResourceDescriptorHeap[outputAIdx];
         RWTexture2D<half4> g_outReservoir_B = ResourceDescriptorHeap[outputBIdx];
@@ -129,6 +196,7 @@ namespace RGI_Util
         g_outReservoir_B[DTid] = outB;
         g_outReservoir_C[DTid].xyz = outC;
     }
+#endif
 }
 
 #endif
\ No newline at end of file
@@ -19,7 +19,7 @@ ConstantBuffer<cbFrameConstants> g_frame : register(b0);
 ConstantBuffer<cb_ReSTIR_PT_PathTrace> g_local : register(b1);
 RaytracingAccelerationStructure g_bvh : register(t0);
 StructuredBuffer<RT::MeshInstance> g_frameMeshData : register(t1);
-StructuredBuffer<Vertex> g_vertices : register(t2);
+StructuredBuffer<PackedVertex> g_vertices : register(t2);
 StructuredBuffer<uint> g_indices : register(t3);
 StructuredBuffer<Material> g_materials : register(t4);
 #if NEE_EMISSIVE == 1
@@ -103,7 +103,7 @@ void MaybeSetCase2OrCase3(int16 pathVertex, float3 pos, float3 normal, float t,
 
 template<bool Emissive>
 void EstimateDirectAndUpdateRC(int16 pathVertex, float3 pos, Hit hitInfo, 
-    BSDF::ShadingData surface, PrevHit prevHit, float3 throughput, float3 throughput_k, 
+    BSDF::ShadingData surface, PrevHit prevHit, bsdf_color throughput, bsdf_color throughput_k, 
     uint sampleSetIdx, Globals globals, inout float3 li, inout BSDF::BSDFSample bsdfSample, 
     out Hit_Emissive nextHit, inout Reconnection rc, inout Reservoir r, inout RNG rngNEE, 
     inout RNG rngReplay)
@@ -124,12 +124,12 @@ void EstimateDirectAndUpdateRC(int16 pathVertex, float3 pos, Hit hitInfo,
 
         if(nextHit.HitWasEmissive())
         {
-            const float3 fOverPdf = throughput * ls_b.ld;
+            const float3 fOverPdf = (float3)throughput * ls_b.ld;
             li += fOverPdf;
 
             // Case 1: For path x_0, ..., x_k, x_{k + 1}, ..., L is the radiance reflected from 
             // x_{k + 1} towards x_k. If connection becomes case 2 or case 3, it is overwritten.
-            rc.L = half3(ls_b.ld * throughput_k);
+            rc.L = half3(ls_b.ld * (float3)throughput_k);
 
             MaybeSetCase2OrCase3(pathVertex, pos, hitInfo.normal, hitInfo.t, hitInfo.ID, 
                 hitInfo.meshIdx, surface, prevHit, ls_b, /*unused*/ 0, rc);
@@ -149,7 +149,7 @@ void EstimateDirectAndUpdateRC(int16 pathVertex, float3 pos, Hit hitInfo,
                 surface, sampleSetIdx, g_frame.NumEmissiveTriangles, nextBounce, globals, 
                 g_frame.EmissiveMapsDescHeapOffset, rngNEE);
 
-            const float3 fOverPdf = throughput * ls.ld;
+            const float3 fOverPdf = (float3)throughput * ls.ld;
             li += fOverPdf;
 
             // Different (sub)path
@@ -158,7 +158,7 @@ void EstimateDirectAndUpdateRC(int16 pathVertex, float3 pos, Hit hitInfo,
 
             // Case 1: For path x_0, ..., x_k, x_{k + 1}, ..., L is the radiance reflected from 
             // x_{k + 1} towards x_k. If connection becomes case 2 or case 3, it is overwritten.
-            rc.L = half3(ls.ld * throughput_k);
+            rc.L = half3(ls.ld * (float3)throughput_k);
 
             MaybeSetCase2OrCase3(pathVertex, pos, hitInfo.normal, hitInfo.t, hitInfo.ID, 
                 hitInfo.meshIdx, surface, prevHit, ls, seed_nee, rc);
@@ -176,12 +176,12 @@ void EstimateDirectAndUpdateRC(int16 pathVertex, float3 pos, Hit hitInfo,
         DirectLightingEstimate ls = RPT_Util::NEE_NonEmissive(pos, hitInfo.normal, surface, 
             g_frame, globals.bvh, rngNEE);
 
-        const float3 fOverPdf = throughput * ls.ld;
+        const float3 fOverPdf = (float3)throughput * ls.ld;
         li += fOverPdf;
 
         // Case 1: For path x_0, ..., x_k, x_{k + 1}, ..., L is the radiance reflected from 
         // x_{k + 1} towards x_k. If connection becomes case 2 or case 3, it is overwritten.
-        rc.L = half3(ls.ld * throughput_k);
+        rc.L = half3(ls.ld * (float3)throughput_k);
 
         MaybeSetCase2OrCase3(pathVertex, pos, hitInfo.normal, hitInfo.t, hitInfo.ID, 
             hitInfo.meshIdx, surface, prevHit, ls, seed_nee, rc);
@@ -200,7 +200,9 @@ RPT_Util::Reservoir PathTrace(float3 pos, float3 normal, float ior, BSDF::Shadin
     RPT_Util::Reservoir r = RPT_Util::Reservoir::Init();
     li = 0.0;
     int16 bounce = 0;
-    float3 throughput = bsdfSample.bsdfOverPdf;
+    // Path throughput is stored with the same precision as material colors (FP16 with 
+    // BSDF_FP16). Contributions that are derived from it are computed in FP32.
+    bsdf_color throughput = (bsdf_color)bsdfSample.bsdfOverPdf;
     PrevHit prevHit = PrevHit::Init(BSDF::LobeAlpha(surface, bsdfSample.lobe), 
         bsdfSample.lobe, bsdfSample.wi, bsdfSample.pdf);
 
@@ -208,7 +210,7 @@ RPT_Util::Reservoir PathTrace(float3 pos, float3 normal, float ior, BSDF::Shadin
     // current medium continues to be air
     float eta_curr = dot(normal, bsdfSample.wi) < 0 ? ior : ETA_AIR;
     // Product of f / p terms from x_{k + 1} onwards. Needed for case 1 connections.
-    float3 throughput_k = 1;
+    bsdf_color throughput_k = 1;
     // Note: skip the first bounce for a milder impacet. May have to change in the future.
     // bool anyGlossyBounces = bsdfSample.lobe != BSDF::LOBE::DIFFUSE_R;
     // bool anyGlossyBounces = false;
@@ -270,7 +272,7 @@ RPT_Util::Reservoir PathTrace(float3 pos, float3 normal, float ior, BSDF::Shadin
         {
             float3 extCoeff = -log(surface.baseColor_Fr0_TrCol) / surface.trDepth;
             tr = exp(-hitInfo.t * extCoeff);
-            throughput *= tr;
+            throughput *= (bsdf_color)tr;
         }
 
         // Direct lighting
@@ -302,8 +304,9 @@ RPT_Util::Reservoir PathTrace(float3 pos, float3 normal, float ior, BSDF::Shadin
                 if(rngGroup.Uniform() < p_terminate)
                     break;
                 
-                throughput /= (1 - p_terminate);
-                throughput_k /= (reconnection.k <= bounce) ? (1 - p_terminate) : 1;
+                const float invSurvival = 1 / (1 - p_terminate);
+                throughput *= (bsdf_color)invSurvival;
+                throughput_k *= (reconnection.k <= bounce) ? (bsdf_color)invSurvival : 1;
             }
         }
 
@@ -335,10 +338,10 @@ RPT_Util::Reservoir PathTrace(float3 pos, float3 normal, float ior, BSDF::Shadin
 
         // Update path throughput starting from vertex after reconnection 
         if(reconnection.k <= bounce)
-            throughput_k *= bsdfSample.bsdfOverPdf * tr;
+            throughput_k *= (bsdf_color)(bsdfSample.bsdfOverPdf * tr);
 
         bool transmitted = dot(normal, bsdfSample.wi) < 0;
-        throughput *= bsdfSample.bsdfOverPdf;
+        throughput *= (bsdf_color)bsdfSample.bsdfOverPdf;
         // anyGlossyBounces = anyGlossyBounces || (bsdfSample.lobe != BSDF::LOBE::DIFFUSE_R);
 
         eta_curr = transmitted ? (eta_curr == ETA_AIR ? eta_next : ETA_AIR) : eta_curr;
@@ -378,14 +381,9 @@ RPT_Util::Reservoir RIS_InitialCandidates(uint2 DTid, uint2 Gid, float3 origin,
         return RPT_Util::Reservoir::Init();
     }
 
-    GBUFFER_TRI_DIFF_GEO_A g_triA = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::TRI_DIFF_GEO_A];
-    GBUFFER_TRI_DIFF_GEO_B g_triB = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::TRI_DIFF_GEO_B];
-    const uint4 packed_a = g_triA[DTid];
-    const uint2 packed_b = g_triB[DTid];
-
-    Math::TriDifferentials triDiffs = Math::TriDifferentials::Unpack(packed_a, packed_b);
+    Math::TriDifferentials triDiffs = RT::LoadTriDifferentials(DTid, 
+        g_frame.CurrGBufferDescHeapOffset, true, g_frame.VisibilityBuffer, g_frameMeshData, 
+        g_vertices, g_indices);
     float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
 
     RT::RayDifferentials rd = RT::RayDifferentials::Init(DTid, renderDim, 
@@ -440,9 +438,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     if (swizzledDTid.x >= g_frame.RenderWidth || swizzledDTid.y >= g_frame.RenderHeight)
         return;
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr = g_metallicRoughness[swizzledDTid];
+    const float2 mr = GBuffer::LoadMetallicRoughness(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
     
     RWTexture2D<float4> g_final = ResourceDescriptorHeap[g_local.Final];
@@ -475,24 +472,18 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz, 
         g_frame.DoF, lensSample, g_frame.FocusDepth, origin);
 
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_normal[swizzledDTid]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset));
 
-    GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
-    const float4 baseColor = flags.subsurface ? g_baseColor[swizzledDTid] :
-        float4(g_baseColor[swizzledDTid].rgb, 0);
+    float4 baseColor = GBuffer::LoadBaseColor(swizzledDTid, g_frame.CurrGBufferDescHeapOffset);
+    baseColor.a = flags.subsurface ? baseColor.a : 0;
 
     float eta_curr = ETA_AIR;
     float eta_next = DEFAULT_ETA_MAT;
 
     if(flags.transmissive)
     {
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
-
-        float ior = g_ior[swizzledDTid];
+        float ior = GBuffer::LoadIOR(swizzledDTid, g_frame.CurrGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
@@ -503,9 +494,7 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
 
     if(flags.coated)
     {
-        GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::COAT];
-        uint3 packed = g_coat[swizzledDTid].xyz;
+        uint3 packed = GBuffer::LoadCoat(swizzledDTid, g_frame.CurrGBufferDescHeapOffset);
 
         GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
         coat_weight = coat.weight;
@@ -532,8 +521,12 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     // could become < 1.
     r.W = targetLum > 0 ? max(r.w_sum / targetLum, 1.0f) : 0;
 
-    if(IS_CB_FLAG_SET(CB_IND_FLAGS::TEMPORAL_RESAMPLE) || 
-        IS_CB_FLAG_SET(CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES))
+    // Spatial resampling can run without temporal resampling (e.g. in the first frame 
+    // after a camera cut)
+    const bool resample = IS_CB_FLAG_SET(CB_IND_FLAGS::TEMPORAL_RESAMPLE) ||
+        IS_CB_FLAG_SET(CB_IND_FLAGS::SPATIAL_RESAMPLE);
+
+    if(resample || IS_CB_FLAG_SET(CB_IND_FLAGS::RESET_TEMPORAL_TEXTURES))
     {
         r.Write<NEE_EMISSIVE>(swizzledDTid, g_local.Reservoir_A_DescHeapIdx, 
             g_local.Reservoir_A_DescHeapIdx + 1, g_local.Reservoir_A_DescHeapIdx + 2, 
@@ -541,7 +534,7 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
             g_local.Reservoir_A_DescHeapIdx + 5, g_local.Reservoir_A_DescHeapIdx + 6);
     }
 
-    if(IS_CB_FLAG_SET(CB_IND_FLAGS::TEMPORAL_RESAMPLE))
+    if(resample)
         r.WriteTarget(swizzledDTid, g_local.TargetDescHeapIdx);
     else
     {
@@ -18,7 +18,7 @@ ConstantBuffer<cbFrameConstants> g_frame : register(b0);
 ConstantBuffer<cb_ReSTIR_PT_Reuse> g_local : register(b1);
 RaytracingAccelerationStructure g_bvh : register(t0);
 StructuredBuffer<RT::MeshInstance> g_frameMeshData : register(t1);
-StructuredBuffer<Vertex> g_vertices : register(t2);
+StructuredBuffer<PackedVertex> g_vertices : register(t2);
 StructuredBuffer<uint> g_indices : register(t3);
 StructuredBuffer<Material> g_materials : register(t4);
 
@@ -46,16 +46,8 @@ ReSTIR_Util::Globals InitGlobals(bool transmissive)
 OffsetPath ShiftCurrentToSpatial(uint2 DTid, uint2 samplePosSS, Reconnection rc_curr,
     Globals globals)
 {
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
     GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
         GBUFFER_OFFSET::DEPTH];
-    GBUFFER_METALLIC_ROUGHNESS g_mr = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
-    GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::IOR];
 
     const float depth_n = g_depth[samplePosSS];
 
@@ -74,17 +66,19 @@ OffsetPath ShiftCurrentToSpatial(uint2 DTid, uint2 samplePosSS, Reconnection rc_
         g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz, 
         g_frame.DoF, lensSample_n, g_frame.FocusDepth, origin_n);
 
-    const float2 mr_n = g_mr[samplePosSS];
+    const float2 mr_n = GBuffer::LoadMetallicRoughness(samplePosSS, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags_n = GBuffer::DecodeMetallic(mr_n.x);
 
-    float3 normal_n = Math::DecodeUnitVector(g_normal[samplePosSS]);
-    float4 baseColor_n = flags_n.subsurface ? g_baseColor[samplePosSS] : 
-        float4(g_baseColor[samplePosSS].rgb, 0);
+    float3 normal_n = Math::DecodeUnitVector(GBuffer::LoadNormal(samplePosSS, 
+        g_frame.CurrGBufferDescHeapOffset));
+    float4 baseColor_n = GBuffer::LoadBaseColor(samplePosSS, g_frame.CurrGBufferDescHeapOffset);
+    baseColor_n.a = flags_n.subsurface ? baseColor_n.a : 0;
     float eta_next = DEFAULT_ETA_MAT;
 
     if(flags_n.transmissive)
     {
-        float ior = g_ior[samplePosSS];
+        float ior = GBuffer::LoadIOR(samplePosSS, g_frame.CurrGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
@@ -95,9 +89,7 @@ OffsetPath ShiftCurrentToSpatial(uint2 DTid, uint2 samplePosSS, Reconnection rc_
 
     if(flags_n.coated)
     {
-        GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::COAT];
-        uint3 packed = g_coat[DTid.xy].xyz;
+        uint3 packed = GBuffer::LoadCoat(DTid.xy, g_frame.CurrGBufferDescHeapOffset);
 
         GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
         coat_weight = coat.weight;
@@ -116,14 +108,9 @@ OffsetPath ShiftCurrentToSpatial(uint2 DTid, uint2 samplePosSS, Reconnection rc_
 
     if(rc_curr.k == 2)
     {
-        GBUFFER_TRI_DIFF_GEO_A g_triA = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::TRI_DIFF_GEO_A];
-        GBUFFER_TRI_DIFF_GEO_B g_triB = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::TRI_DIFF_GEO_B];
-        const uint4 packed_a = g_triA[samplePosSS];
-        const uint2 packed_b = g_triB[samplePosSS];
-
-        triDiffs = Math::TriDifferentials::Unpack(packed_a, packed_b);
+        triDiffs = RT::LoadTriDifferentials(samplePosSS, 
+            g_frame.CurrGBufferDescHeapOffset, true, g_frame.VisibilityBuffer, g_frameMeshData, 
+            g_vertices, g_indices);
         float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
 
         rd = RT::RayDifferentials::Init(samplePosSS, renderDim, g_frame.TanHalfFOV, 
@@ -164,6 +151,13 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     const uint2 swizzledGid = Gid.xy;
 #endif
 
+    // Only thread groups that sort found to have work were launched
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::INDIRECT_DISPATCH))
+    {
+        swizzledDTid = RPT_Util::WorkGroupDTid(Gid.xy, GTid.xy, RESTIR_PT_SPATIAL_GROUP_DIM_X, 
+            RPT_Util::WORK_LIST_CtN, g_local.NumWorkGroups, g_local.WorkListDescHeapIdx);
+    }
+
     if (swizzledDTid.x >= g_frame.RenderWidth || swizzledDTid.y >= g_frame.RenderHeight)
         return;
 
@@ -182,9 +176,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     if(samplePos.x == UINT8_MAX)
         return;
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr = g_metallicRoughness[swizzledDTid];
+    const float2 mr = GBuffer::LoadMetallicRoughness(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
 
     if (flags.invalid || flags.emissive)
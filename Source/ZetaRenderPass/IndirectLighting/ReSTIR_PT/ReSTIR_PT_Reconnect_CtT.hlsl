@@ -18,7 +18,7 @@ ConstantBuffer<cbFrameConstants> g_frame : register(b0);
 ConstantBuffer<cb_ReSTIR_PT_Reuse> g_local : register(b1);
 RaytracingAccelerationStructure g_bvh : register(t0);
 StructuredBuffer<RT::MeshInstance> g_frameMeshData : register(t1);
-StructuredBuffer<Vertex> g_vertices : register(t2);
+StructuredBuffer<PackedVertex> g_vertices : register(t2);
 StructuredBuffer<uint> g_indices : register(t3);
 StructuredBuffer<Material> g_materials : register(t4);
 
@@ -52,21 +52,15 @@ OffsetPath ShiftCurrentToTemporal(uint2 DTid, uint2 prevPosSS, float3 origin,
 
     if(prevFlags.transmissive)
     {
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
-
-        float ior = g_ior[prevPosSS];
+        float ior = GBuffer::LoadIOR(prevPosSS, g_frame.PrevGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
-    GBUFFER_NORMAL g_prevNormal = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_prevNormal[prevPosSS]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(prevPosSS, 
+        g_frame.PrevGBufferDescHeapOffset));
 
-    GBUFFER_BASE_COLOR g_prevBaseColor = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
-    const float4 baseColor = prevFlags.subsurface ? g_prevBaseColor[prevPosSS] :
-        float4(g_prevBaseColor[prevPosSS].rgb, 0);
+    const float4 baseColor_sss = GBuffer::LoadBaseColor(prevPosSS, g_frame.PrevGBufferDescHeapOffset);
+    const float4 baseColor = prevFlags.subsurface ? baseColor_sss : float4(baseColor_sss.rgb, 0);
 
     float coat_weight = 0;
     float3 coat_color = 0.0f;
@@ -75,9 +69,7 @@ OffsetPath ShiftCurrentToTemporal(uint2 DTid, uint2 prevPosSS, float3 origin,
 
     if(prevFlags.coated)
     {
-        GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::COAT];
-        uint3 packed = g_coat[DTid.xy].xyz;
+        uint3 packed = GBuffer::LoadCoat(DTid.xy, g_frame.PrevGBufferDescHeapOffset);
 
         GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
         coat_weight = coat.weight;
@@ -97,14 +89,9 @@ OffsetPath ShiftCurrentToTemporal(uint2 DTid, uint2 prevPosSS, float3 origin,
 
     if(rc_curr.k == 2)
     {
-        GBUFFER_TRI_DIFF_GEO_A g_triA = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::TRI_DIFF_GEO_A];
-        GBUFFER_TRI_DIFF_GEO_B g_triB = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::TRI_DIFF_GEO_B];
-        const uint4 packed_a = g_triA[prevPosSS];
-        const uint2 packed_b = g_triB[prevPosSS];
-
-        triDiffs = Math::TriDifferentials::Unpack(packed_a, packed_b);
+        triDiffs = RT::LoadTriDifferentials(prevPosSS, 
+            g_frame.PrevGBufferDescHeapOffset, false, g_frame.VisibilityBuffer, g_frameMeshData, 
+            g_vertices, g_indices);
         float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
 
         rd = RT::RayDifferentials::Init(prevPosSS, renderDim, g_frame.TanHalfFOV, 
@@ -144,6 +131,13 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     uint2 swizzledDTid = DTid.xy;
     const uint2 swizzledGid = Gid.xy;
 #endif
+
+    // Only thread groups that sort found to have work were launched
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::INDIRECT_DISPATCH))
+    {
+        swizzledDTid = RPT_Util::WorkGroupDTid(Gid.xy, GTid.xy, RESTIR_PT_TEMPORAL_GROUP_DIM_X, 
+            RPT_Util::WORK_LIST_CtN, g_local.NumWorkGroups, g_local.WorkListDescHeapIdx);
+    }
     
     if (swizzledDTid.x >= g_frame.RenderWidth || swizzledDTid.y >= g_frame.RenderHeight)
         return;
@@ -157,9 +151,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
             return;
     }
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr = g_metallicRoughness[swizzledDTid];
+    const float2 mr = GBuffer::LoadMetallicRoughness(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
 
     if (flags.invalid || flags.emissive)
@@ -204,9 +197,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz, 
         g_frame.DoF, lensSample, g_frame.FocusDepth, origin);
 
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_normal[swizzledDTid]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset));
 
     float2 lensSample_t = 0;
     float3 origin_t = float3(g_frame.PrevViewInv._m03, g_frame.PrevViewInv._m13, 
@@ -227,9 +219,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     if(!RPT_Util::PlaneHeuristic(prevPos, normal, pos, z_view, MAX_PLANE_DIST_REUSE))
         return;
 
-    GBUFFER_METALLIC_ROUGHNESS g_prevMR = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 prevMR = g_prevMR[prevPixel];
+    const float2 prevMR = GBuffer::LoadMetallicRoughness(prevPixel, 
+        g_frame.PrevGBufferDescHeapOffset);
     GBuffer::Flags prevFlags = GBuffer::DecodeMetallic(prevMR.x);
 
     // No temporal history
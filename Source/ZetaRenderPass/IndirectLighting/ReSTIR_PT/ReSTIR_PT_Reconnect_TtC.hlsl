@@ -18,7 +18,7 @@ ConstantBuffer<cbFrameConstants> g_frame : register(b0);
 ConstantBuffer<cb_ReSTIR_PT_Reuse> g_local : register(b1);
 RaytracingAccelerationStructure g_bvh : register(t0);
 StructuredBuffer<RT::MeshInstance> g_frameMeshData : register(t1);
-StructuredBuffer<Vertex> g_vertices : register(t2);
+StructuredBuffer<PackedVertex> g_vertices : register(t2);
 StructuredBuffer<uint> g_indices : register(t3);
 StructuredBuffer<Material> g_materials : register(t4);
 
@@ -47,19 +47,14 @@ OffsetPath ShiftTemporalToCurrent(uint2 DTid, float3 origin, float2 lensSample,
     float3 pos, float3 normal, GBuffer::Flags flags, float roughness, Reconnection rc_prev, 
     Globals globals)
 {
-    GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
-    const float4 baseColor = flags.subsurface ? g_baseColor[DTid] : 
-        float4(g_baseColor[DTid].rgb, 0);
+    float4 baseColor = GBuffer::LoadBaseColor(DTid, g_frame.CurrGBufferDescHeapOffset);
+    baseColor.a = flags.subsurface ? baseColor.a : 0;
 
     float eta_next = DEFAULT_ETA_MAT;
 
     if(flags.transmissive)
     {
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
-
-        float ior = g_ior[DTid];
+        float ior = GBuffer::LoadIOR(DTid, g_frame.CurrGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
@@ -70,9 +65,7 @@ OffsetPath ShiftTemporalToCurrent(uint2 DTid, float3 origin, float2 lensSample,
 
     if(flags.coated)
     {
-        GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::COAT];
-        uint3 packed = g_coat[DTid].xyz;
+        uint3 packed = GBuffer::LoadCoat(DTid, g_frame.CurrGBufferDescHeapOffset);
 
         GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
         coat_weight = coat.weight;
@@ -91,14 +84,9 @@ OffsetPath ShiftTemporalToCurrent(uint2 DTid, float3 origin, float2 lensSample,
 
     if(rc_prev.k == 2)
     {
-        GBUFFER_TRI_DIFF_GEO_A g_triA = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::TRI_DIFF_GEO_A];
-        GBUFFER_TRI_DIFF_GEO_B g_triB = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-            GBUFFER_OFFSET::TRI_DIFF_GEO_B];
-        const uint4 packed_a = g_triA[DTid];
-        const uint2 packed_b = g_triB[DTid];
-
-        triDiffs = Math::TriDifferentials::Unpack(packed_a, packed_b);
+        triDiffs = RT::LoadTriDifferentials(DTid, 
+            g_frame.CurrGBufferDescHeapOffset, true, g_frame.VisibilityBuffer, g_frameMeshData, 
+            g_vertices, g_indices);
         float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
 
         rd = RT::RayDifferentials::Init(DTid, renderDim, g_frame.TanHalfFOV, 
@@ -139,6 +127,13 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     const uint2 swizzledGid = Gid.xy;
 #endif
 
+    // Only thread groups that sort found to have work were launched
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::INDIRECT_DISPATCH))
+    {
+        swizzledDTid = RPT_Util::WorkGroupDTid(Gid.xy, GTid.xy, RESTIR_PT_TEMPORAL_GROUP_DIM_X, 
+            RPT_Util::WORK_LIST_NtC, g_local.NumWorkGroups, g_local.WorkListDescHeapIdx);
+    }
+
     if (swizzledDTid.x >= g_frame.RenderWidth || swizzledDTid.y >= g_frame.RenderHeight)
         return;
 
@@ -151,9 +146,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
             return;
     }
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[
-        g_frame.CurrGBufferDescHeapOffset + GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr = g_metallicRoughness[swizzledDTid];
+    const float2 mr = GBuffer::LoadMetallicRoughness(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
 
     if (flags.invalid || flags.emissive)
@@ -219,9 +213,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz, 
         g_frame.DoF, lensSample, g_frame.FocusDepth, origin);
 
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_normal[swizzledDTid]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset));
 
     float2 lensSample_t = 0;
     float3 origin_t = float3(g_frame.PrevViewInv._m03, g_frame.PrevViewInv._m13, 
@@ -250,9 +243,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         return;
     }
 
-    GBUFFER_METALLIC_ROUGHNESS g_prevMR = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 prevMR = g_prevMR[prevPixel];
+    const float2 prevMR = GBuffer::LoadMetallicRoughness(prevPixel, 
+        g_frame.PrevGBufferDescHeapOffset);
     GBuffer::Flags prevFlags = GBuffer::DecodeMetallic(prevMR.x);
 
     // Skip if not on the same surface
@@ -22,7 +22,7 @@ ConstantBuffer<cbFrameConstants> g_frame : register(b0);
 ConstantBuffer<cb_ReSTIR_PT_Reuse> g_local : register(b1);
 RaytracingAccelerationStructure g_bvh : register(t0);
 StructuredBuffer<RT::MeshInstance> g_frameMeshData : register(t1);
-StructuredBuffer<Vertex> g_vertices : register(t2);
+StructuredBuffer<PackedVertex> g_vertices : register(t2);
 StructuredBuffer<uint> g_indices : register(t3);
 StructuredBuffer<Material> g_materials : register(t4);
 
@@ -55,21 +55,15 @@ OffsetPathContext ReplayCurrentInTemporalDomain(uint2 prevPosSS, float3 origin,
 
     if(prevFlags.transmissive)
     {
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
-
-        float ior = g_ior[prevPosSS];
+        float ior = GBuffer::LoadIOR(prevPosSS, g_frame.PrevGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
-    GBUFFER_NORMAL g_prevNormal = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_prevNormal[prevPosSS]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(prevPosSS, 
+        g_frame.PrevGBufferDescHeapOffset));
 
-    GBUFFER_BASE_COLOR g_prevBaseColor = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
-    const float4 baseColor = prevFlags.subsurface ? g_prevBaseColor[prevPosSS] : 
-        float4(g_prevBaseColor[prevPosSS].rgb, 0);
+    float4 baseColor = GBuffer::LoadBaseColor(prevPosSS, g_frame.PrevGBufferDescHeapOffset);
+    baseColor.a = prevFlags.subsurface ? baseColor.a : 0;
 
     float coat_weight = 0;
     float3 coat_color = 0.0f;
@@ -78,9 +72,7 @@ OffsetPathContext ReplayCurrentInTemporalDomain(uint2 prevPosSS, float3 origin,
 
     if(prevFlags.coated)
     {
-        GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-            GBUFFER_OFFSET::COAT];
-        uint3 packed = g_coat[prevPosSS].xyz;
+        uint3 packed = GBuffer::LoadCoat(prevPosSS, g_frame.PrevGBufferDescHeapOffset);
 
         GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
         coat_weight = coat.weight;
@@ -95,14 +87,9 @@ OffsetPathContext ReplayCurrentInTemporalDomain(uint2 prevPosSS, float3 origin,
         prevFlags.trDepthGt0, (half)baseColor.a, coat_weight, coat_color,
         coat_roughness, coat_ior);
 
-    GBUFFER_TRI_DIFF_GEO_A g_triA = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::TRI_DIFF_GEO_A];
-    GBUFFER_TRI_DIFF_GEO_B g_triB = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::TRI_DIFF_GEO_B];
-    const uint4 packed_a = g_triA[prevPosSS];
-    const uint2 packed_b = g_triB[prevPosSS];
-
-    Math::TriDifferentials triDiffs = Math::TriDifferentials::Unpack(packed_a, packed_b);
+    Math::TriDifferentials triDiffs = RT::LoadTriDifferentials(prevPosSS, 
+        g_frame.PrevGBufferDescHeapOffset, false, g_frame.VisibilityBuffer, g_frameMeshData, 
+        g_vertices, g_indices);
     float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
 
     RT::RayDifferentials rd = RT::RayDifferentials::Init(prevPosSS, renderDim, 
@@ -127,14 +114,8 @@ OffsetPathContext ReplayCurrentInTemporalDomain(uint2 prevPosSS, float3 origin,
 OffsetPathContext ReplayCurrentInSpatialDomain(uint2 samplePosSS, RPT_Util::Reconnection rc_curr,
     ReSTIR_Util::Globals globals)
 {
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
     GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
         GBUFFER_OFFSET::DEPTH];
-    GBUFFER_METALLIC_ROUGHNESS g_mr = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
 
     const float depth_n = g_depth[samplePosSS];
 
@@ -153,20 +134,19 @@ OffsetPathContext ReplayCurrentInSpatialDomain(uint2 samplePosSS, RPT_Util::Reco
         g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz, 
         g_frame.DoF, lensSample_n, g_frame.FocusDepth, origin_n);
 
-    const float2 mr_n = g_mr[samplePosSS];
+    const float2 mr_n = GBuffer::LoadMetallicRoughness(samplePosSS, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags_n = GBuffer::DecodeMetallic(mr_n.x);
 
-    float3 normal_n = Math::DecodeUnitVector(g_normal[samplePosSS]);
-    float4 baseColor_n = flags_n.subsurface ? g_baseColor[samplePosSS] : 
-        float4(g_baseColor[samplePosSS].rgb, 0);
+    float3 normal_n = Math::DecodeUnitVector(GBuffer::LoadNormal(samplePosSS, 
+        g_frame.CurrGBufferDescHeapOffset));
+    float4 baseColor_n = GBuffer::LoadBaseColor(samplePosSS, g_frame.CurrGBufferDescHeapOffset);
+    baseColor_n.a = flags_n.subsurface ? baseColor_n.a : 0;
     float eta_next = DEFAULT_ETA_MAT;
 
     if(flags_n.transmissive)
     {
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
-
-        float ior = g_ior[samplePosSS];
+        float ior = GBuffer::LoadIOR(samplePosSS, g_frame.CurrGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
@@ -177,9 +157,7 @@ OffsetPathContext ReplayCurrentInSpatialDomain(uint2 samplePosSS, RPT_Util::Reco
 
     if(flags_n.coated)
     {
-        GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::COAT];
-        uint3 packed = g_coat[samplePosSS].xyz;
+        uint3 packed = GBuffer::LoadCoat(samplePosSS, g_frame.CurrGBufferDescHeapOffset);
 
         GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
         coat_weight = coat.weight;
@@ -193,14 +171,9 @@ OffsetPathContext ReplayCurrentInSpatialDomain(uint2 samplePosSS, RPT_Util::Reco
         mr_n.y, baseColor_n.rgb, ETA_AIR, eta_next, flags_n.transmissive, flags_n.trDepthGt0,
         (half)baseColor_n.a, coat_weight, coat_color, coat_roughness, coat_ior);
 
-    GBUFFER_TRI_DIFF_GEO_A g_triA = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::TRI_DIFF_GEO_A];
-    GBUFFER_TRI_DIFF_GEO_B g_triB = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::TRI_DIFF_GEO_B];
-    const uint4 packed_a = g_triA[samplePosSS];
-    const uint2 packed_b = g_triB[samplePosSS];
-
-    Math::TriDifferentials triDiffs = Math::TriDifferentials::Unpack(packed_a, packed_b);
+    Math::TriDifferentials triDiffs = RT::LoadTriDifferentials(samplePosSS, 
+        g_frame.CurrGBufferDescHeapOffset, true, g_frame.VisibilityBuffer, g_frameMeshData, 
+        g_vertices, g_indices);
 
     RT::RayDifferentials rd = RT::RayDifferentials::Init(samplePosSS, renderDim, 
         g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrCameraJitter, 
@@ -219,19 +192,15 @@ OffsetPathContext ReplayCurrentInSpatialDomain(uint2 samplePosSS, RPT_Util::Reco
 OffsetPathContext ReplayInCurrent(uint2 DTid, float3 origin, float2 lensSample, float3 pos, 
     float3 normal, GBuffer::Flags flags, float roughness, Reconnection rc, Globals globals)
 {
-    GBUFFER_BASE_COLOR g_baseColor = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::BASE_COLOR];
-    const float4 baseColor = flags.subsurface ? g_baseColor[DTid] : float4(g_baseColor[DTid].rgb, 0);
+    float4 baseColor = GBuffer::LoadBaseColor(DTid, g_frame.CurrGBufferDescHeapOffset);
+    baseColor.a = flags.subsurface ? baseColor.a : 0;
 
     float eta_curr = ETA_AIR;
     float eta_next = DEFAULT_ETA_MAT;
 
     if(flags.transmissive)
     {
-        GBUFFER_IOR g_ior = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::IOR];
-
-        float ior = g_ior[DTid];
+        float ior = GBuffer::LoadIOR(DTid, g_frame.CurrGBufferDescHeapOffset);
         eta_next = GBuffer::DecodeIOR(ior);
     }
 
@@ -242,9 +211,7 @@ OffsetPathContext ReplayInCurrent(uint2 DTid, float3 origin, float2 lensSample,
 
     if(flags.coated)
     {
-        GBUFFER_COAT g_coat = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-            GBUFFER_OFFSET::COAT];
-        uint3 packed = g_coat[DTid.xy].xyz;
+        uint3 packed = GBuffer::LoadCoat(DTid.xy, g_frame.CurrGBufferDescHeapOffset);
 
         GBuffer::Coat coat = GBuffer::UnpackCoat(packed);
         coat_weight = coat.weight;
@@ -258,14 +225,9 @@ OffsetPathContext ReplayInCurrent(uint2 DTid, float3 origin, float2 lensSample,
         roughness, baseColor.rgb, eta_curr, eta_next, flags.transmissive, flags.trDepthGt0, 
         (half)baseColor.a, coat_weight, coat_color, coat_roughness, coat_ior);
 
-    GBUFFER_TRI_DIFF_GEO_A g_triA = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::TRI_DIFF_GEO_A];
-    GBUFFER_TRI_DIFF_GEO_B g_triB = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::TRI_DIFF_GEO_B];
-    const uint4 packed_a = g_triA[DTid];
-    const uint2 packed_b = g_triB[DTid];
-
-    Math::TriDifferentials triDiffs = Math::TriDifferentials::Unpack(packed_a, packed_b);
+    Math::TriDifferentials triDiffs = RT::LoadTriDifferentials(DTid, 
+        g_frame.CurrGBufferDescHeapOffset, true, g_frame.VisibilityBuffer, g_frameMeshData, 
+        g_vertices, g_indices);
     float2 renderDim = float2(g_frame.RenderWidth, g_frame.RenderHeight);
 
     RT::RayDifferentials rd = RT::RayDifferentials::Init(DTid, renderDim, 
@@ -304,6 +266,19 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     const uint2 swizzledGid = Gid.xy;
 #endif
 
+#if defined (TEMPORAL_TO_CURRENT) || defined (SPATIAL_TO_CURRENT)
+    const uint workList = RPT_Util::WORK_LIST_NtC;
+#else
+    const uint workList = RPT_Util::WORK_LIST_CtN;
+#endif
+
+    // Only thread groups that sort found to have work were launched
+    if(IS_CB_FLAG_SET(CB_IND_FLAGS::INDIRECT_DISPATCH))
+    {
+        swizzledDTid = RPT_Util::WorkGroupDTid(Gid.xy, GTid.xy, RESTIR_PT_REPLAY_GROUP_DIM_X, 
+            workList, g_local.NumWorkGroups, g_local.WorkListDescHeapIdx);
+    }
+
 #if defined (TEMPORAL_TO_CURRENT) || defined (CURRENT_TO_TEMPORAL)
     if(IS_CB_FLAG_SET(CB_IND_FLAGS::SORT_TEMPORAL))
 #else
@@ -328,9 +303,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     if (swizzledDTid.x >= g_frame.RenderWidth || swizzledDTid.y >= g_frame.RenderHeight)
         return;
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr = g_metallicRoughness[swizzledDTid];
+    const float2 mr = GBuffer::LoadMetallicRoughness(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
 
     if (flags.invalid || flags.emissive)
@@ -355,9 +329,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         g_frame.CurrView[0].xyz, g_frame.CurrView[1].xyz, g_frame.CurrView[2].xyz, 
         g_frame.DoF, lensSample, g_frame.FocusDepth, origin);
 
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_normal[swizzledDTid]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset));
 
 #if defined (TEMPORAL_TO_CURRENT) || defined(CURRENT_TO_TEMPORAL)
     // Check if there is valid history data for temporal reuse
@@ -399,9 +372,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     if(!RPT_Util::PlaneHeuristic(pos_n, normal, pos, z_view, 0.01))
         return;
 
-    GBUFFER_METALLIC_ROUGHNESS g_prevMR = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr_n = g_prevMR[prevPixel];
+    const float2 mr_n = GBuffer::LoadMetallicRoughness(prevPixel, 
+        g_frame.PrevGBufferDescHeapOffset);
     GBuffer::Flags flags_n = GBuffer::DecodeMetallic(mr_n.x);
 
     // No temporal history
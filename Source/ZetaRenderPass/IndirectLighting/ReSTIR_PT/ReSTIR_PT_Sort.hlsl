@@ -9,6 +9,12 @@
 
 static const uint16_t2 GroupDim = uint16_t2(RESTIR_PT_SORT_GROUP_DIM_X, RESTIR_PT_SORT_GROUP_DIM_Y);
 
+#if defined (TEMPORAL_TO_CURRENT) || defined (SPATIAL_TO_CURRENT)
+static const uint WORK_LIST = RPT_Util::WORK_LIST_NtC;
+#else
+static const uint WORK_LIST = RPT_Util::WORK_LIST_CtN;
+#endif
+
 //--------------------------------------------------------------------------------------
 // Root Signature
 //--------------------------------------------------------------------------------------
@@ -25,9 +31,7 @@ RPT_Util::SHIFT_ERROR FindNeighbor(uint2 DTid, out int2 neighborPixel)
     if (DTid.x >= g_frame.RenderWidth || DTid.y >= g_frame.RenderHeight)
         return RPT_Util::SHIFT_ERROR::INVALID_PIXEL;
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float m = g_metallicRoughness[DTid].x;
+    const float m = GBuffer::LoadMetallicRoughness(DTid, g_frame.CurrGBufferDescHeapOffset).x;
     GBuffer::Flags flags = GBuffer::DecodeMetallic(m);
 
     if (flags.invalid || flags.emissive)
@@ -88,7 +92,16 @@ void WriteOutput(uint2 Gid, uint2 DTid, uint2 mappedGTid, uint result)
 #endif
 
     if (mappedDTid.x < g_frame.RenderWidth && mappedDTid.y < g_frame.RenderHeight)
+    {
         RPT_Util::EncodeSorted(DTid, mappedDTid, g_local.MapDescHeapIdx, error);
+
+        if(IS_CB_FLAG_SET(CB_IND_FLAGS::INDIRECT_DISPATCH) && !error)
+        {
+            uint groupIdx = (mappedGTid.y / RESTIR_PT_REPLAY_GROUP_DIM_Y) * 2 + 
+                (mappedGTid.x / RESTIR_PT_REPLAY_GROUP_DIM_X);
+            InterlockedOr(g_workMask, 1u << groupIdx);
+        }
+    }
 }
 
 //--------------------------------------------------------------------------------------
@@ -99,6 +112,23 @@ void WriteOutput(uint2 Gid, uint2 DTid, uint2 mappedGTid, uint result)
 groupshared uint4 g_count;
 // No reconnection 
 groupshared uint g_skip;
+// Every bit corresponds to one of the (16 x 8) replay thread groups covered by this 
+// thread group that has at least one pixel to process
+groupshared uint g_workMask;
+
+void AppendWorkGroups(uint2 Gid, uint Gidx)
+{
+    if(!IS_CB_FLAG_SET(CB_IND_FLAGS::INDIRECT_DISPATCH))
+        return;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if(Gidx == 0)
+    {
+        RPT_Util::AppendWorkGroups(Gid, g_workMask, WORK_LIST, g_local.NumWorkGroups, 
+            g_local.WorkListDescHeapIdx);
+    }
+}
 
 [numthreads(RESTIR_PT_SORT_GROUP_DIM_X, RESTIR_PT_SORT_GROUP_DIM_Y, 1)]
 void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint Gidx : SV_GroupIndex, uint3 GTid : SV_GroupThreadID)
@@ -107,6 +137,7 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint Gidx :
     {
         g_count = 0.xxxx;
         g_skip = 0;
+        g_workMask = 0;
     }
 
     GroupMemoryBarrierWithGroupSync();
@@ -301,6 +332,7 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint Gidx :
         for(int i = 0; i < 4; i++)
             WriteOutput(Gid.xy, dtID[i], gtID[i], result[i]);
 
+        AppendWorkGroups(Gid.xy, Gidx);
         return;
     }
 
@@ -365,4 +397,6 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint Gidx :
             WriteOutput(Gid.xy, dtID[i], mappedGTid, result[i]);
         }
     }
+
+    AppendWorkGroups(Gid.xy, Gidx);
 }
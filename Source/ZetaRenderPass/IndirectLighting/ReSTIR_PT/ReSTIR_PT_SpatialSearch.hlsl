@@ -4,6 +4,9 @@
 
 #define THREAD_GROUP_SWIZZLING 1
 #define SPATIAL_SEARCH_RADIUS 15
+#define NUM_SHARED_NEIGHBORS (RESTIR_PT_SPATIAL_SEARCH_GROUP_DIM_X * RESTIR_PT_SPATIAL_SEARCH_GROUP_DIM_Y)
+// Offsets (before wrapping around the tile) are scaled by this much
+#define SHARED_NEIGHBOR_RADIUS 6
 
 using namespace RPT_Util;
 
@@ -14,6 +17,13 @@ using namespace RPT_Util;
 ConstantBuffer<cbFrameConstants> g_frame : register(b0);
 ConstantBuffer<cb_ReSTIR_PT_SpatialSearch> g_local : register(b1);
 
+#ifdef GROUP_SHARED_SPATIAL
+groupshared float3 g_neighborPos[NUM_SHARED_NEIGHBORS];
+groupshared float2 g_neighborNormal[NUM_SHARED_NEIGHBORS];
+// Roughness as half | valid << 16 | metallic << 17 | transmissive << 18
+groupshared uint g_neighborMaterial[NUM_SHARED_NEIGHBORS];
+#endif
+
 //--------------------------------------------------------------------------------------
 // Utility Functions
 //--------------------------------------------------------------------------------------
@@ -21,12 +31,8 @@ ConstantBuffer<cb_ReSTIR_PT_SpatialSearch> g_local : register(b1);
 int2 FindSpatialNeighbor(uint2 DTid, float3 pos, float3 normal, bool metallic, float roughness,
     bool transmissive, float viewDepth, float radius, inout RNG rng)
 {
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
     GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
         GBUFFER_OFFSET::DEPTH];
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
 
     // rotate sample sequence per pixel
     const float u0 = rng.Uniform();
@@ -52,7 +58,8 @@ int2 FindSpatialNeighbor(uint2 DTid, float3 pos, float3 normal, bool metallic, f
         if(samplePosSS.x == DTid.x && samplePosSS.y == DTid.y)
             continue;
 
-        const float2 sampleMR = g_metallicRoughness[samplePosSS];
+        const float2 sampleMR = GBuffer::LoadMetallicRoughness(samplePosSS, 
+            g_frame.CurrGBufferDescHeapOffset);
         GBuffer::Flags sampleFlags = GBuffer::DecodeMetallic(sampleMR.x);
 
         if(sampleFlags.invalid || sampleFlags.emissive)
@@ -68,7 +75,8 @@ int2 FindSpatialNeighbor(uint2 DTid, float3 pos, float3 normal, bool metallic, f
         const float3 samplePos = Math::WorldPosFromScreenSpace(samplePosSS, renderDim,
             sampleDepth, g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrViewInv, 
             g_frame.CurrCameraJitter);
-        const float3 sampleNormal = Math::DecodeUnitVector(g_normal[samplePosSS]);
+        const float3 sampleNormal = Math::DecodeUnitVector(GBuffer::LoadNormal(samplePosSS, 
+            g_frame.CurrGBufferDescHeapOffset));
 
         if (!RPT_Util::PlaneHeuristic(samplePos, normal, pos, viewDepth, 0.01))
             continue;
@@ -81,6 +89,92 @@ int2 FindSpatialNeighbor(uint2 DTid, float3 pos, float3 normal, bool metallic, f
     return UINT16_MAX;
 }
 
+#ifdef GROUP_SHARED_SPATIAL
+// Every thread in the group publishes its surface so that the candidates of all the 
+// threads in the group are served from group shared memory. Must be called by every 
+// thread, including the ones that are outside the screen.
+void StoreSurface(uint2 DTid, uint2 GTid)
+{
+    const uint idx = GTid.y * RESTIR_PT_SPATIAL_SEARCH_GROUP_DIM_X + GTid.x;
+    const int2 renderDim = int2((int)g_frame.RenderWidth, (int)g_frame.RenderHeight);
+
+    if (!Math::IsWithinBounds((int2)DTid, renderDim))
+    {
+        g_neighborMaterial[idx] = 0;
+        return;
+    }
+
+    const float2 mr = GBuffer::LoadMetallicRoughness(DTid, g_frame.CurrGBufferDescHeapOffset);
+    GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
+
+    if (flags.invalid || flags.emissive)
+    {
+        g_neighborMaterial[idx] = 0;
+        return;
+    }
+
+    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
+        GBUFFER_OFFSET::DEPTH];
+    const float depth = g_depth[DTid];
+
+    g_neighborPos[idx] = Math::WorldPosFromScreenSpace(DTid, renderDim, depth, 
+        g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrViewInv, 
+        g_frame.CurrCameraJitter);
+    g_neighborNormal[idx] = GBuffer::LoadNormal(DTid, g_frame.CurrGBufferDescHeapOffset);
+    g_neighborMaterial[idx] = f32tof16(mr.y) | (1u << 16) | ((uint)flags.metallic << 17) | 
+        ((uint)flags.transmissive << 18);
+}
+
+// Same as FindSpatialNeighbor(), except that candidates are limited to the group's tile 
+// (offsets wrap around its edges)
+int2 FindSpatialNeighbor_Shared(uint2 GTid, uint2 groupStart, float3 pos, float3 normal, 
+    bool metallic, float roughness, bool transmissive, float viewDepth, inout RNG rng)
+{
+    const float u0 = rng.Uniform();
+    const uint offset = rng.UniformUint();
+    const float theta = u0 * TWO_PI;
+    const float sinTheta = sin(theta);
+    const float cosTheta = cos(theta);
+    // Group dimensions are powers of two
+    const int2 groupDim = int2(RESTIR_PT_SPATIAL_SEARCH_GROUP_DIM_X, RESTIR_PT_SPATIAL_SEARCH_GROUP_DIM_Y);
+    const uint material = ((uint)metallic << 17) | ((uint)transmissive << 18);
+
+    [loop]
+    for (uint i = 0; i < 3; i++)
+    {
+        const float2 sampleUV = k_samples[(offset + i) & (SAMPLE_SET_SIZE - 1)];
+        float2 rotated = float2(
+            dot(sampleUV, float2(cosTheta, -sinTheta)),
+            dot(sampleUV, float2(sinTheta, cosTheta)));
+        rotated *= SHARED_NEIGHBOR_RADIUS;
+        const int2 local = ((int2)GTid + (int2)round(rotated)) & (groupDim - 1);
+
+        if (local.x == GTid.x && local.y == GTid.y)
+            continue;
+
+        const uint idx = local.y * RESTIR_PT_SPATIAL_SEARCH_GROUP_DIM_X + local.x;
+        const uint sampleMaterial = g_neighborMaterial[idx];
+
+        // Also rejects invalid and emissive
+        if ((sampleMaterial & 0x70000) != (material | (1u << 16)))
+            continue;
+        if(abs(f16tof32(sampleMaterial & 0xffff) - roughness) > MAX_ROUGHNESS_DIFF_SPATIAL_REUSE)
+            continue;
+
+        const float3 sampleNormal = Math::DecodeUnitVector(g_neighborNormal[idx]);
+
+        if (!RPT_Util::PlaneHeuristic(g_neighborPos[idx], normal, pos, viewDepth, 0.01))
+            continue;
+        if(dot(sampleNormal, normal) < MIN_NORMAL_SIMILARITY_SPATIAL_REUSE)
+            continue;
+
+        return (int2)groupStart + local;
+    }
+
+    return UINT16_MAX;
+}
+#endif
+
 //--------------------------------------------------------------------------------------
 // Main
 //--------------------------------------------------------------------------------------
@@ -103,12 +197,16 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
     const uint2 swizzledGid = Gid.xy;
 #endif
 
+#ifdef GROUP_SHARED_SPATIAL
+    StoreSurface(swizzledDTid, GTid.xy);
+    GroupMemoryBarrierWithGroupSync();
+#endif
+
     if (swizzledDTid.x >= g_frame.RenderWidth || swizzledDTid.y >= g_frame.RenderHeight)
         return;
 
-    GBUFFER_METALLIC_ROUGHNESS g_metallicRoughness = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset +
-        GBUFFER_OFFSET::METALLIC_ROUGHNESS];
-    const float2 mr = g_metallicRoughness[swizzledDTid];
+    const float2 mr = GBuffer::LoadMetallicRoughness(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset);
     GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
 
     if (flags.invalid || flags.emissive)
@@ -122,9 +220,8 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         g_frame.TanHalfFOV, g_frame.AspectRatio, g_frame.CurrViewInv, 
         g_frame.CurrCameraJitter);
 
-    GBUFFER_NORMAL g_normal = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + 
-        GBUFFER_OFFSET::NORMAL];
-    const float3 normal = Math::DecodeUnitVector(g_normal[swizzledDTid]);
+    const float3 normal = Math::DecodeUnitVector(GBuffer::LoadNormal(swizzledDTid, 
+        g_frame.CurrGBufferDescHeapOffset));
 
     // const uint16 passIdx = uint16((g_local.Packed >> 12) & 0x3);
     const uint16 passIdx = 0;
@@ -132,8 +229,15 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid :
         g_frame.FrameNum);
     const uint16_t scale = (uint16_t)1;
 
+#ifdef GROUP_SHARED_SPATIAL
+    const uint2 groupStart = swizzledGid * 
+        uint2(RESTIR_PT_SPATIAL_SEARCH_GROUP_DIM_X, RESTIR_PT_SPATIAL_SEARCH_GROUP_DIM_Y);
+    const int2 neighbor = FindSpatialNeighbor_Shared(GTid.xy, groupStart, pos, normal, 
+        flags.metallic, mr.y, flags.transmissive, viewDepth, rng);
+#else
     const int2 neighbor = FindSpatialNeighbor(swizzledDTid, pos, normal, flags.metallic, 
         mr.y, flags.transmissive, viewDepth, SPATIAL_SEARCH_RADIUS * scale, rng);
+#endif
 
     // [-R_max, +R_max]
     int2 mapped = neighbor - (int2)swizzledDTid;
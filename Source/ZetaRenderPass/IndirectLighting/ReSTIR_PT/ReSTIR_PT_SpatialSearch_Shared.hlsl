@@ -0,0 +1,2 @@
+#define GROUP_SHARED_SPATIAL
+#include "ReSTIR_PT_SpatialSearch.hlsl"
\ No newline at end of file
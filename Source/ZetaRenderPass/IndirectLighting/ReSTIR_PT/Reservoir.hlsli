@@ -188,7 +188,8 @@ namespace RPT_Util
             Reservoir ret;
             ret.UnpackMetadata(g_inA[DTid].xyz);
 
-            float2 inB = g_inB[DTid];
+            // Weights might have overflowed when stored at half precision (compact layout)
+            float2 inB = Math::Sanitize(g_inB[DTid]);
             ret.w_sum = inB.x;
             ret.W = inB.y;
 
@@ -229,7 +230,8 @@ namespace RPT_Util
             Reservoir ret;
             ret.UnpackMetadata(g_inA[DTid].xyz);
 
-            float2 inB = g_inB[DTid];
+            // Weights might have overflowed when stored at half precision (compact layout)
+            float2 inB = Math::Sanitize(g_inB[DTid]);
             ret.w_sum = inB.x;
             ret.W = inB.y;
 
@@ -249,19 +251,19 @@ namespace RPT_Util
         void LoadTarget(uint2 DTid, uint uavIdx)
         {
             RWTexture2D<float4> g_target = ResourceDescriptorHeap[uavIdx];
-            this.target = g_target[DTid].xyz;
+            this.target = Math::Sanitize(g_target[DTid].xyz);
         }
 
         void LoadWSum(uint2 DTid, uint inputBIdx)
         {
             RWTexture2D<float2> g_inB = ResourceDescriptorHeap[inputBIdx];
-            this.w_sum = g_inB[DTid].x;
+            this.w_sum = Math::Sanitize(g_inB[DTid].x);
         }
 
         static float LoadW(uint2 DTid, uint inputBIdx)
         {
             RWTexture2D<float2> g_inB = ResourceDescriptorHeap[inputBIdx];
-            return g_inB[DTid].y;
+            return Math::Sanitize(g_inB[DTid].y);
         }
 
         void WriteCase1(uint2 DTid, RWTexture2D<uint4> g_outC, RWTexture2D<uint4> g_outD, 
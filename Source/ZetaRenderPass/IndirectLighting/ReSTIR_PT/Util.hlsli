@@ -41,6 +41,54 @@ namespace RPT_Util
         return (int2)DTid + decodedI;
     }
 
+    // Must match SHIFT in IndirectLighting.h
+    static const uint WORK_LIST_CtN = 0;
+    static const uint WORK_LIST_NtC = 1;
+
+    // Each sort thread group covers a (32 x 32) tile, which contains (2 x 4) replay thread 
+    // groups. Bits of groupMask are set for the groups that have work.
+    void AppendWorkGroups(uint2 sortGid, uint groupMask, uint workList, uint numWorkGroups, 
+        uint descHeapIdx)
+    {
+        if(groupMask == 0)
+            return;
+
+        RWStructuredBuffer<uint> g_workList = ResourceDescriptorHeap[descHeapIdx];
+        const uint argsOffset = workList * RESTIR_PT_WORK_LIST_ARGS_SIZE;
+        const uint count = countbits(groupMask);
+
+        uint slot;
+        InterlockedAdd(g_workList[argsOffset], count, slot);
+        // (8 x 8) groups use the same list with Y = 2
+        InterlockedAdd(g_workList[argsOffset + 3], count);
+
+        const uint2 firstGroup = sortGid * uint2(2, 4);
+        uint offset = RESTIR_PT_WORK_LIST_HEADER_SIZE + workList * numWorkGroups + slot;
+
+        while(groupMask != 0)
+        {
+            const uint i = firstbitlow(groupMask);
+            groupMask &= groupMask - 1;
+
+            const uint2 groupID = firstGroup + uint2(i & 0x1, i >> 1);
+            g_workList[offset++] = groupID.x | (groupID.y << 16);
+        }
+    }
+
+    // Maps thread group launched by ExecuteIndirect to its pixel. For (8 x 8) thread 
+    // groups, Gid.y selects the left or right half of the listed (16 x 8) group.
+    uint2 WorkGroupDTid(uint2 Gid, uint2 GTid, uint groupDimX, uint workList, 
+        uint numWorkGroups, uint descHeapIdx)
+    {
+        StructuredBuffer<uint> g_workList = ResourceDescriptorHeap[descHeapIdx];
+        const uint packed = g_workList[RESTIR_PT_WORK_LIST_HEADER_SIZE + 
+            workList * numWorkGroups + Gid.x];
+        const uint2 groupID = uint2(packed & 0xffff, packed >> 16);
+
+        return groupID * uint2(RESTIR_PT_REPLAY_GROUP_DIM_X, RESTIR_PT_REPLAY_GROUP_DIM_Y) + 
+            uint2(Gid.y * groupDimX, 0) + GTid;
+    }
+
     void SuppressOutlierReservoirs(inout RPT_Util::Reservoir r)
     {
         float waveSum = WaveActiveSum(r.w_sum);
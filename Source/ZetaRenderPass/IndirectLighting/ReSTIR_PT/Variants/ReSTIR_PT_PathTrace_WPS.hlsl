@@ -1,3 +0,0 @@
-#define NEE_EMISSIVE 1
-#define USE_PRESAMPLED_SETS
-#include "../ReSTIR_PT_PathTrace.hlsl"
\ No newline at end of file
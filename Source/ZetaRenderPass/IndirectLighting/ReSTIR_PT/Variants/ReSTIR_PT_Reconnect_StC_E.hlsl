@@ -1,2 +0,0 @@
-#define NEE_EMISSIVE 1
-#include "../ReSTIR_PT_Reconnect_StC.hlsl"
\ No newline at end of file
@@ -1,2 +0,0 @@
-#define CURRENT_TO_SPATIAL
-#include "../ReSTIR_PT_Replay.hlsl"
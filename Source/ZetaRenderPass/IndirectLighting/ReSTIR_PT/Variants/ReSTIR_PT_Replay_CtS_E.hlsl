@@ -1,3 +0,0 @@
-#define NEE_EMISSIVE 1
-#define CURRENT_TO_SPATIAL
-#include "../ReSTIR_PT_Replay.hlsl"
@@ -1,3 +0,0 @@
-#define NEE_EMISSIVE 1
-#define TEMPORAL_TO_CURRENT
-#include "../ReSTIR_PT_Replay.hlsl"
@@ -1,2 +0,0 @@
-#define SPATIAL_TO_CURRENT
-#include "../ReSTIR_PT_Sort.hlsl"
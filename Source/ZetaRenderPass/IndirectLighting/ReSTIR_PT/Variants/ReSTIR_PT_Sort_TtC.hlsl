@@ -1,2 +0,0 @@
-#define TEMPORAL_TO_CURRENT
-#include "../ReSTIR_PT_Sort.hlsl"
@@ -0,0 +1,77 @@
+#ifndef THREAD_REORDER_H
+#define THREAD_REORDER_H
+
+#include "../Common/GBuffers.hlsli"
+
+// Reorders pixels within each thread group by their primary surface's material class, so
+// that threads in the same wave take similar paths through the BSDF and bounce loops.
+// Pixels never leave their group, so per-pixel results stay the same.
+//
+// Thread group size must be defined before including this file.
+#ifndef THREAD_REORDER_GROUP_SIZE
+#error THREAD_REORDER_GROUP_SIZE must be defined.
+#endif
+
+namespace ThreadReorder
+{
+    // Inactive threads (out of bounds, invalid or emissive pixels) are grouped last
+    static const uint KEY_DIFFUSE = 0;
+    static const uint KEY_GLOSSY = 1;
+    static const uint KEY_TRANSMISSIVE = 2;
+    static const uint KEY_INACTIVE = 3;
+    static const uint NUM_KEYS = 4;
+
+    // Pixel that doesn't belong to the render target
+    static const uint2 NO_PIXEL = uint2(0xffff, 0xffff);
+}
+
+groupshared uint g_reorderCount[ThreadReorder::NUM_KEYS];
+groupshared uint g_reorderPixel[THREAD_REORDER_GROUP_SIZE];
+
+namespace ThreadReorder
+{
+    uint Key(uint2 pixel, ConstantBuffer<cbFrameConstants> g_frame)
+    {
+        if(pixel.x >= g_frame.RenderWidth || pixel.y >= g_frame.RenderHeight)
+            return KEY_INACTIVE;
+
+        const float2 mr = GBuffer::LoadMetallicRoughness(pixel, g_frame.CurrGBufferDescHeapOffset);
+        const GBuffer::Flags flags = GBuffer::DecodeMetallic(mr.x);
+
+        if(flags.invalid || flags.emissive)
+            return KEY_INACTIVE;
+        if(flags.transmissive)
+            return KEY_TRANSMISSIVE;
+
+        return flags.metallic || mr.y < 0.3f ? KEY_GLOSSY : KEY_DIFFUSE;
+    }
+
+    // Counting sort of pixels in the group. Has to be called by every thread in the group.
+    uint2 Reorder(uint2 pixel, uint Gidx, ConstantBuffer<cbFrameConstants> g_frame)
+    {
+        const uint key = Key(pixel, g_frame);
+
+        if(Gidx < NUM_KEYS)
+            g_reorderCount[Gidx] = 0;
+
+        GroupMemoryBarrierWithGroupSync();
+
+        uint slot;
+        InterlockedAdd(g_reorderCount[key], 1, slot);
+
+        GroupMemoryBarrierWithGroupSync();
+
+        uint offset = 0;
+        for(uint k = 0; k < key; k++)
+            offset += g_reorderCount[k];
+
+        g_reorderPixel[offset + slot] = pixel.x | (pixel.y << 16);
+
+        GroupMemoryBarrierWithGroupSync();
+
+        const uint packed = g_reorderPixel[Gidx];
+        return uint2(packed & 0xffff, packed >> 16);
+    }
+}
+
+#endif
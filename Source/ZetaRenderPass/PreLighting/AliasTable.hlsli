@@ -0,0 +1,81 @@
+#ifndef ALIAS_TABLE_H
+#define ALIAS_TABLE_H
+
+#include "PreLighting_Common.h"
+
+// Alias table is built with a parallel version of the sweeping construction from 
+// [Hübschle-Schneider & Sanders, "Parallel Weighted Random Sampling", 2019]:
+//
+//  1. Normalize weights to w, so that mean becomes 1
+//  2. Split items into light (w < 1) and heavy (w >= 1), both in original order, 
+//     while computing exclusive prefix sums of deficits (1 - w) of light items, dL, 
+//     and surpluses (w - 1) of heavy items, dH
+//  3. Current heavy item fills light items until its residual drops below 1, at which 
+//     point it becomes light itself and is filled by the next heavy item. Residual of 
+//     heavy j after filling the first i light items is 1 + dH[j + 1] - dL[i], and light 
+//     i is taken before heavy j iff dL[i] <= dH[j + 1]. Therefore, the sweep is a merge 
+//     of two sorted sequences that can be split into independent pieces with binary 
+//     searches.
+//
+// Prefix sums are in 64-bit fixed point, so that residuals are exact regardless of 
+// the number of items.
+namespace AliasTable
+{
+    static const float FIXED_POINT_ONE = (float)ALIAS_TABLE_FIXED_POINT_ONE;
+
+    struct Header
+    {
+        static Header Load(RWByteAddressBuffer scratch)
+        {
+            Header ret;
+            ret.TotalPower = asfloat(scratch.Load(0));
+            ret.NumLight = scratch.Load(4);
+            ret.NumHeavy = scratch.Load(8);
+
+            return ret;
+        }
+
+        float TotalPower;
+        uint NumLight;
+        uint NumHeavy;
+    };
+
+    // Returns true if item is light. q is set to its deficit (light) or surplus (heavy)
+    // in fixed point.
+    bool Classify(float power, float totalPower, uint numTris, out uint64_t q)
+    {
+        // Sample uniformly when there's no power
+        const float w = totalPower > 0 ? power * ((float)numTris / totalPower) : 1.0f;
+
+        if (w < 1)
+        {
+            q = (uint64_t)mad(1.0f - w, FIXED_POINT_ONE, 0.5f);
+            return true;
+        }
+
+        q = (uint64_t)mad(w - 1.0f, FIXED_POINT_ONE, 0.5f);
+        return false;
+    }
+
+    float ProbOrig(float power, float totalPower, uint numTris)
+    {
+        return totalPower > 0 ? power / totalPower : 1.0f / (float)numTris;
+    }
+
+    uint BlockStatsOffset(uint block)
+    {
+        return ALIAS_TABLE_BLOCK_STATS_OFFSET + block * ALIAS_TABLE_BLOCK_STATS_STRIDE;
+    }
+
+    uint IndexOffset(uint numBlocks)
+    {
+        return ALIAS_TABLE_INDEX_OFFSET(numBlocks);
+    }
+
+    uint PrefixOffset(uint numTris, uint numBlocks)
+    {
+        return ALIAS_TABLE_PREFIX_OFFSET(numTris, numBlocks);
+    }
+}
+
+#endif
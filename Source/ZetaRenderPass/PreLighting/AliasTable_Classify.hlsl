@@ -0,0 +1,75 @@
+#include "AliasTable.hlsli"
+
+#define NUM_WAVES (ALIAS_TABLE_GROUP_DIM_X / ALIAS_TABLE_WAVE_LEN)
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbAliasTable> g_local : register(b0);
+RWStructuredBuffer<float> g_power : register(u0);
+RWStructuredBuffer<RT::EmissiveLumenAliasTableEntry> g_aliasTable : register(u1);
+RWByteAddressBuffer g_scratch : register(u2);
+
+groupshared uint g_numLight[NUM_WAVES];
+groupshared uint64_t g_deficit[NUM_WAVES];
+groupshared uint64_t g_surplus[NUM_WAVES];
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Computes number of light items along with total deficit and surplus per block
+[WaveSize(ALIAS_TABLE_WAVE_LEN)]
+[numthreads(ALIAS_TABLE_GROUP_DIM_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint Gidx : SV_GroupIndex)
+{
+    const float totalPower = asfloat(g_scratch.Load(0));
+    const bool valid = DTid.x < g_local.NumTriangles;
+
+    uint64_t q = 0;
+    bool light = false;
+
+    if (valid)
+    {
+        const float power = g_power[DTid.x];
+        light = AliasTable::Classify(power, totalPower, g_local.NumTriangles, q);
+
+        g_aliasTable[DTid.x].CachedP_Orig = AliasTable::ProbOrig(power, totalPower, 
+            g_local.NumTriangles);
+    }
+
+    const uint numLight = WaveActiveCountBits(valid && light);
+    const uint64_t deficit = WaveActiveSum(light ? q : 0);
+    const uint64_t surplus = WaveActiveSum(light ? 0 : q);
+
+    if (WaveIsFirstLane())
+    {
+        const uint wave = Gidx / ALIAS_TABLE_WAVE_LEN;
+        g_numLight[wave] = numLight;
+        g_deficit[wave] = deficit;
+        g_surplus[wave] = surplus;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (Gidx == 0)
+    {
+        uint blockNumLight = 0;
+        uint64_t blockDeficit = 0;
+        uint64_t blockSurplus = 0;
+
+        [unroll]
+        for (int i = 0; i < NUM_WAVES; i++)
+        {
+            blockNumLight += g_numLight[i];
+            blockDeficit += g_deficit[i];
+            blockSurplus += g_surplus[i];
+        }
+
+        const uint offset = AliasTable::BlockStatsOffset(Gid.x);
+        g_scratch.Store(offset, blockNumLight);
+        g_scratch.Store<uint64_t>(offset + 8, blockDeficit);
+        g_scratch.Store<uint64_t>(offset + 16, blockSurplus);
+    }
+}
@@ -0,0 +1,116 @@
+#include "AliasTable.hlsli"
+
+#define NUM_WAVES (ALIAS_TABLE_SCAN_GROUP_DIM_X / ALIAS_TABLE_WAVE_LEN)
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbAliasTable> g_local : register(b0);
+RWByteAddressBuffer g_scratch : register(u2);
+
+groupshared uint g_waveNumLight[NUM_WAVES];
+groupshared uint64_t g_waveDeficit[NUM_WAVES];
+groupshared uint64_t g_waveSurplus[NUM_WAVES];
+groupshared uint g_tileNumLight;
+groupshared uint64_t g_tileDeficit;
+groupshared uint64_t g_tileSurplus;
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Single group that replaces per-block stats with their exclusive prefix sums
+[WaveSize(ALIAS_TABLE_WAVE_LEN)]
+[numthreads(ALIAS_TABLE_SCAN_GROUP_DIM_X, 1, 1)]
+void main(uint Gidx : SV_GroupIndex)
+{
+    const uint wave = Gidx / ALIAS_TABLE_WAVE_LEN;
+    uint carryNumLight = 0;
+    uint64_t carryDeficit = 0;
+    uint64_t carrySurplus = 0;
+
+    for (uint tile = 0; tile < g_local.NumBlocks; tile += ALIAS_TABLE_SCAN_GROUP_DIM_X)
+    {
+        const uint block = tile + Gidx;
+        const uint offset = AliasTable::BlockStatsOffset(block);
+        uint numLight = 0;
+        uint64_t deficit = 0;
+        uint64_t surplus = 0;
+
+        if (block < g_local.NumBlocks)
+        {
+            numLight = g_scratch.Load(offset);
+            deficit = g_scratch.Load<uint64_t>(offset + 8);
+            surplus = g_scratch.Load<uint64_t>(offset + 16);
+        }
+
+        const uint prefixNumLight = WavePrefixSum(numLight);
+        const uint64_t prefixDeficit = WavePrefixSum(deficit);
+        const uint64_t prefixSurplus = WavePrefixSum(surplus);
+
+        if (WaveGetLaneIndex() == ALIAS_TABLE_WAVE_LEN - 1)
+        {
+            g_waveNumLight[wave] = prefixNumLight + numLight;
+            g_waveDeficit[wave] = prefixDeficit + deficit;
+            g_waveSurplus[wave] = prefixSurplus + surplus;
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+
+        // Exclusive scan over wave totals
+        if (wave == 0)
+        {
+            const uint n = Gidx < NUM_WAVES ? g_waveNumLight[Gidx] : 0;
+            const uint64_t d = Gidx < NUM_WAVES ? g_waveDeficit[Gidx] : 0;
+            const uint64_t s = Gidx < NUM_WAVES ? g_waveSurplus[Gidx] : 0;
+
+            const uint pn = WavePrefixSum(n);
+            const uint64_t pd = WavePrefixSum(d);
+            const uint64_t ps = WavePrefixSum(s);
+
+            if (Gidx < NUM_WAVES)
+            {
+                g_waveNumLight[Gidx] = pn;
+                g_waveDeficit[Gidx] = pd;
+                g_waveSurplus[Gidx] = ps;
+            }
+
+            if (Gidx == ALIAS_TABLE_WAVE_LEN - 1)
+            {
+                g_tileNumLight = pn + n;
+                g_tileDeficit = pd + d;
+                g_tileSurplus = ps + s;
+            }
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+
+        if (block < g_local.NumBlocks)
+        {
+            g_scratch.Store(offset, carryNumLight + g_waveNumLight[wave] + prefixNumLight);
+            g_scratch.Store<uint64_t>(offset + 8, carryDeficit + g_waveDeficit[wave] + prefixDeficit);
+            g_scratch.Store<uint64_t>(offset + 16, carrySurplus + g_waveSurplus[wave] + prefixSurplus);
+        }
+
+        carryNumLight += g_tileNumLight;
+        carryDeficit += g_tileDeficit;
+        carrySurplus += g_tileSurplus;
+
+        // Wave totals are overwritten in next iteration
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (Gidx == 0)
+    {
+        const uint numLight = carryNumLight;
+        const uint numHeavy = g_local.NumTriangles - numLight;
+        g_scratch.Store(4, numLight);
+        g_scratch.Store(8, numHeavy);
+
+        // Totals go after the last element of each prefix sum
+        const uint prefixOffset = AliasTable::PrefixOffset(g_local.NumTriangles, g_local.NumBlocks);
+        g_scratch.Store<uint64_t>(prefixOffset + numLight * 8, carryDeficit);
+        g_scratch.Store<uint64_t>(prefixOffset + (numLight + 1 + numHeavy) * 8, carrySurplus);
+    }
+}
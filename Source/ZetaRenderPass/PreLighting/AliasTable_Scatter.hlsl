@@ -0,0 +1,94 @@
+#include "AliasTable.hlsli"
+
+#define NUM_WAVES (ALIAS_TABLE_GROUP_DIM_X / ALIAS_TABLE_WAVE_LEN)
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbAliasTable> g_local : register(b0);
+RWStructuredBuffer<float> g_power : register(u0);
+RWByteAddressBuffer g_scratch : register(u2);
+
+groupshared uint g_waveNumLight[NUM_WAVES];
+groupshared uint64_t g_waveDeficit[NUM_WAVES];
+groupshared uint64_t g_waveSurplus[NUM_WAVES];
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Writes the light and heavy item indices along with prefix sums of their deficits 
+// and surpluses
+[WaveSize(ALIAS_TABLE_WAVE_LEN)]
+[numthreads(ALIAS_TABLE_GROUP_DIM_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint Gidx : SV_GroupIndex)
+{
+    const AliasTable::Header header = AliasTable::Header::Load(g_scratch);
+    const bool valid = DTid.x < g_local.NumTriangles;
+
+    uint64_t q = 0;
+    bool light = false;
+
+    if (valid)
+    {
+        light = AliasTable::Classify(g_power[DTid.x], header.TotalPower, 
+            g_local.NumTriangles, q);
+    }
+
+    const uint isLight = valid && light;
+    const uint64_t deficit = light ? q : 0;
+    const uint64_t surplus = light ? 0 : q;
+
+    uint prefixNumLight = WavePrefixSum(isLight);
+    uint64_t prefixDeficit = WavePrefixSum(deficit);
+    uint64_t prefixSurplus = WavePrefixSum(surplus);
+
+    const uint wave = Gidx / ALIAS_TABLE_WAVE_LEN;
+
+    if (WaveGetLaneIndex() == ALIAS_TABLE_WAVE_LEN - 1)
+    {
+        g_waveNumLight[wave] = prefixNumLight + isLight;
+        g_waveDeficit[wave] = prefixDeficit + deficit;
+        g_waveSurplus[wave] = prefixSurplus + surplus;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (!valid)
+        return;
+
+    [unroll]
+    for (int i = 0; i < NUM_WAVES; i++)
+    {
+        if (i < wave)
+        {
+            prefixNumLight += g_waveNumLight[i];
+            prefixDeficit += g_waveDeficit[i];
+            prefixSurplus += g_waveSurplus[i];
+        }
+    }
+
+    const uint blockOffset = AliasTable::BlockStatsOffset(Gid.x);
+    const uint blockNumLight = g_scratch.Load(blockOffset);
+    const uint indexOffset = AliasTable::IndexOffset(g_local.NumBlocks);
+    const uint prefixOffset = AliasTable::PrefixOffset(g_local.NumTriangles, g_local.NumBlocks);
+
+    if (light)
+    {
+        const uint l = blockNumLight + prefixNumLight;
+        const uint64_t blockDeficit = g_scratch.Load<uint64_t>(blockOffset + 8);
+
+        g_scratch.Store(indexOffset + l * 4, DTid.x);
+        g_scratch.Store<uint64_t>(prefixOffset + l * 8, blockDeficit + prefixDeficit);
+    }
+    else
+    {
+        const uint h = (Gid.x * ALIAS_TABLE_GROUP_DIM_X - blockNumLight) + (Gidx - prefixNumLight);
+        const uint64_t blockSurplus = g_scratch.Load<uint64_t>(blockOffset + 16);
+
+        g_scratch.Store(indexOffset + (header.NumLight + h) * 4, DTid.x);
+        g_scratch.Store<uint64_t>(prefixOffset + (header.NumLight + 1 + h) * 8, 
+            blockSurplus + prefixSurplus);
+    }
+}
@@ -0,0 +1,44 @@
+#include "AliasTable.hlsli"
+
+#define NUM_WAVES (ALIAS_TABLE_SCAN_GROUP_DIM_X / ALIAS_TABLE_WAVE_LEN)
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbAliasTable> g_local : register(b0);
+RWStructuredBuffer<float> g_power : register(u0);
+RWByteAddressBuffer g_scratch : register(u2);
+
+groupshared float g_waveSums[NUM_WAVES];
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Single group that sums up the power of all triangles
+[WaveSize(ALIAS_TABLE_WAVE_LEN)]
+[numthreads(ALIAS_TABLE_SCAN_GROUP_DIM_X, 1, 1)]
+void main(uint Gidx : SV_GroupIndex)
+{
+    float sum = 0;
+
+    for (uint i = Gidx; i < g_local.NumTriangles; i += ALIAS_TABLE_SCAN_GROUP_DIM_X)
+        sum += g_power[i];
+
+    sum = WaveActiveSum(sum);
+
+    if (WaveIsFirstLane())
+        g_waveSums[Gidx / ALIAS_TABLE_WAVE_LEN] = sum;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (Gidx < ALIAS_TABLE_WAVE_LEN)
+    {
+        sum = Gidx < NUM_WAVES ? g_waveSums[Gidx] : 0;
+        sum = WaveActiveSum(sum);
+
+        if (Gidx == 0)
+            g_scratch.Store(0, asuint(sum));
+    }
+}
@@ -0,0 +1,123 @@
+#include "AliasTable.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbAliasTable> g_local : register(b0);
+RWStructuredBuffer<RT::EmissiveLumenAliasTableEntry> g_aliasTable : register(u1);
+RWByteAddressBuffer g_scratch : register(u2);
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+struct Sweep
+{
+    // Exclusive prefix sum of deficits of the first i light items
+    uint64_t DeficitSum(uint i)
+    {
+        return g_scratch.Load<uint64_t>(prefixOffset + i * 8);
+    }
+
+    // Exclusive prefix sum of surpluses of the first j heavy items
+    uint64_t SurplusSum(uint j)
+    {
+        return g_scratch.Load<uint64_t>(prefixOffset + (numLight + 1 + j) * 8);
+    }
+
+    uint Light(uint i)
+    {
+        return g_scratch.Load(indexOffset + i * 4);
+    }
+
+    uint Heavy(uint j)
+    {
+        return g_scratch.Load(indexOffset + (numLight + j) * 4);
+    }
+
+    uint indexOffset;
+    uint prefixOffset;
+    uint numLight;
+    uint numHeavy;
+};
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Every thread sweeps over a contiguous range of steps, where each step finalizes
+// exactly one (light or heavy) item
+[numthreads(ALIAS_TABLE_SWEEP_GROUP_DIM_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    const uint numSteps = g_local.NumTriangles;
+    const uint firstStep = DTid.x * ALIAS_TABLE_SWEEP_STEPS_PER_THREAD;
+
+    if (firstStep >= numSteps)
+        return;
+
+    const uint lastStep = min(firstStep + ALIAS_TABLE_SWEEP_STEPS_PER_THREAD, numSteps);
+    const AliasTable::Header header = AliasTable::Header::Load(g_scratch);
+
+    Sweep sweep;
+    sweep.indexOffset = AliasTable::IndexOffset(g_local.NumBlocks);
+    sweep.prefixOffset = AliasTable::PrefixOffset(g_local.NumTriangles, g_local.NumBlocks);
+    sweep.numLight = header.NumLight;
+    sweep.numHeavy = header.NumHeavy;
+
+    // Number of light items among the first firstStep steps of the merge
+    uint lo = firstStep > sweep.numHeavy ? firstStep - sweep.numHeavy : 0;
+    uint hi = min(firstStep, sweep.numLight);
+
+    while (lo < hi)
+    {
+        const uint mid = (lo + hi) >> 1;
+
+        if (sweep.DeficitSum(mid) <= sweep.SurplusSum(firstStep - mid))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    uint i = lo;
+    uint j = firstStep - lo;
+
+    for (uint step = firstStep; step < lastStep; step++)
+    {
+        uint idx;
+        uint alias;
+        float pCurr;
+
+        const uint64_t dL = sweep.DeficitSum(i);
+
+        if (i < sweep.numLight && (j == sweep.numHeavy || dL <= sweep.SurplusSum(j + 1)))
+        {
+            idx = sweep.Light(i);
+
+            // Only possible due to round-off errors
+            const bool noneLeft = j == sweep.numHeavy;
+            const uint64_t deficit = sweep.DeficitSum(i + 1) - dL;
+            alias = noneLeft ? idx : sweep.Heavy(j);
+            pCurr = noneLeft ? 1.0f : 1.0f - (float)deficit / AliasTable::FIXED_POINT_ONE;
+
+            i++;
+        }
+        else
+        {
+            idx = sweep.Heavy(j);
+
+            const bool isLast = j + 1 == sweep.numHeavy;
+            const int64_t residual = (int64_t)ALIAS_TABLE_FIXED_POINT_ONE + 
+                (int64_t)sweep.SurplusSum(j + 1) - (int64_t)dL;
+            alias = isLast ? idx : sweep.Heavy(j + 1);
+            pCurr = isLast ? 1.0f : saturate((float)residual / AliasTable::FIXED_POINT_ONE);
+
+            j++;
+        }
+
+        g_aliasTable[idx].P_Curr = pCurr;
+        g_aliasTable[idx].Alias = alias;
+        g_aliasTable[idx].CachedP_Alias = g_aliasTable[alias].CachedP_Orig;
+    }
+}
@@ -11,6 +11,7 @@ ConstantBuffer<cbLVG> g_local : register(b0);
 ConstantBuffer<cbFrameConstants> g_frame : register(b1);
 StructuredBuffer<RT::EmissiveTriangle> g_emissives : register(t0);
 StructuredBuffer<RT::EmissiveLumenAliasTableEntry> g_aliasTable : register(t1);
+StructuredBuffer<uint> g_voxelList : register(t3);
 RWStructuredBuffer<RT::VoxelSample> g_voxel : register(u0);
 
 //--------------------------------------------------------------------------------------
@@ -57,22 +58,39 @@ groupshared uint16_t g_waveNumLights[MaxNumWaves];
 void main(uint3 Gid : SV_GroupID, uint Gidx : SV_GroupIndex)
 {
     const uint3 gridDim = uint3(g_local.GridDim_x, g_local.GridDim_y, g_local.GridDim_z);   
-    const uint gridStart = LVG::FlattenVoxelIndex(Gid, gridDim);
+    // Cascades are stacked along z
+    uint3 voxelIdx = Gid;
+
+    // Partial rebuild -- groups are dispatched along x, one per listed voxel
+    if(g_local.NumVoxels)
+    {
+        const uint v = g_voxelList[Gid.x];
+        const uint numVoxelsXY = gridDim.x * gridDim.y;
+        voxelIdx = uint3(v % gridDim.x, (v % numVoxelsXY) / gridDim.x, v / numVoxelsXY);
+    }
+
+    const uint gridStart = LVG::FlattenVoxelIndex(voxelIdx, gridDim);
+    const uint cascade = voxelIdx.z / gridDim.z;
+    voxelIdx.z -= cascade * gridDim.z;
 
     // if (gridStart * NUM_SAMPLES_PER_VOXEL + Gidx >= g_local.NumTotalSamples)
     //     return;
 
-    const float3 extents = float3(g_local.Extents_x, g_local.Extents_y, g_local.Extents_z);
+    const float3 extents = LVG::CascadeExtents(float3(g_local.Extents_x, g_local.Extents_y, 
+        g_local.Extents_z), cascade);
     RNG rng = RNG::Init(gridStart * NUM_SAMPLES_PER_VOXEL + Gidx, g_frame.FrameNum);
-    const float3 voxelCenter = LVG::VoxelCenter(Gid, gridDim, extents, g_frame.CurrViewInv, g_local.Offset_y);
+    const float3 voxelCenter = LVG::VoxelCenter(voxelIdx, gridDim, extents, g_frame.CurrViewInv, g_local.Offset_y);
 
     RT::VoxelSample r;
     r.pos = FLT_MAX;
     r.normal = 0;
     r.le = 0;
     r.pdf = 0;
+    r.sourcePdf = 0;
     r.twoSided = false;
     r.ID = UINT32_MAX;
+    r.idx = UINT32_MAX;
+    r.bary = 0;
 
     float w_sum = 0;
     float target_z = 0;
@@ -128,6 +146,9 @@ void main(uint3 Gid : SV_GroupID, uint Gidx : SV_GroupIndex)
             r.le = half3(le);
             r.twoSided = tri.IsDoubleSided();
             r.ID = tri.ID;
+            r.idx = entry.idx;
+            r.bary = Math::EncodeAsUNorm2(lightSample.bary);
+            r.sourcePdf = lightPdf;
             target_z = target;
         }
 
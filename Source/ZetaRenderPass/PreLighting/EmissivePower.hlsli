@@ -0,0 +1,28 @@
+#ifndef EMISSIVE_POWER_H
+#define EMISSIVE_POWER_H
+
+#include "../Common/LightSource.hlsli"
+
+namespace EmissivePower
+{
+    float TriangleArea(float3 vtx0, float3 vtx1, float3 vtx2)
+    {
+        return 0.5f * length(cross(vtx1 - vtx0, vtx2 - vtx0));
+    }
+
+    // texAvg: Average of the emissive texture over the triangle (one when untextured)
+    float Estimate(RT::EmissiveTriangle tri, float3 texAvg)
+    {
+        const float3 emissiveFactor = tri.GetFactor();
+        const float emissiveStrength = (float)tri.GetStrength();
+        const float3 le = texAvg * emissiveFactor * emissiveStrength;
+
+        const float3 vtx1 = Light::DecodeEmissiveTriV1(tri);
+        const float3 vtx2 = Light::DecodeEmissiveTriV2(tri);
+        const float surfaceArea = TriangleArea(tri.Vtx0, vtx1, vtx2);
+
+        return Math::Luminance(le) * PI * surfaceArea;
+    }
+}
+
+#endif
@@ -0,0 +1,28 @@
+#include "PreLighting_Common.h"
+#include "../Common/FrameConstants.h"
+#include "EmissivePower.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b1);
+StructuredBuffer<RT::EmissiveTriangle> g_emissvies : register(t0);
+RWStructuredBuffer<float> g_power : register(u0);
+RWStructuredBuffer<float3> g_texAvg : register(u1);
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Same as EstimateTriEmissivePower, except that texture averages from an earlier 
+// estimation (or the disk cache) are reused, so no textures are sampled
+[numthreads(ESTIMATE_TRI_POWER_GROUP_DIM_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_frame.NumEmissiveTriangles)
+        return;
+
+    const RT::EmissiveTriangle tri = g_emissvies[DTid.x];
+    g_power[DTid.x] = EmissivePower::Estimate(tri, g_texAvg[DTid.x]);
+}
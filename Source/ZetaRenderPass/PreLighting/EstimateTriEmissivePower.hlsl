@@ -1,6 +1,6 @@
 #include "PreLighting_Common.h"
 #include "../Common/GBuffers.hlsli"
-#include "../Common/LightSource.hlsli"
+#include "EmissivePower.hlsli"
 
 #define NUM_SAMPLES_PER_LANE (ESTIMATE_TRI_POWER_NUM_SAMPLES_PER_TRI / ESTIMATE_TRI_POWER_WAVE_LEN)
 
@@ -12,15 +12,7 @@ ConstantBuffer<cbFrameConstants> g_frame : register(b1);
 StructuredBuffer<RT::EmissiveTriangle> g_emissvies : register(t0);
 StructuredBuffer<float2> g_halton : register(t2);
 RWStructuredBuffer<float> g_power : register(u0);
-
-//--------------------------------------------------------------------------------------
-// Helper functions
-//--------------------------------------------------------------------------------------
-
-float TriangleArea(float3 vtx0, float3 vtx1, float3 vtx2)
-{
-    return 0.5f * length(cross(vtx1 - vtx0, vtx2 - vtx0));
-}
+RWStructuredBuffer<float3> g_texAvg : register(u1);
 
 //--------------------------------------------------------------------------------------
 // Main
@@ -40,7 +32,7 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint Gidx :
     const RT::EmissiveTriangle tri = g_emissvies[triIdx];
     uint emissiveTex = tri.GetTex();
 
-    float3 power = 0.0f;
+    float3 sum = 0.0f;
     const bool hasTexture = emissiveTex != Material::INVALID_ID;
 
     if(hasTexture)
@@ -58,22 +50,18 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint Gidx :
             float2 texUV = (1.0f - bary.x - bary.y) * tri.UV0 + bary.x * tri.UV1 + bary.y * tri.UV2;
             float3 le = g_emissiveMap.SampleLevel(g_samLinearWrap, texUV, 0).rgb;
             
-            power += le;
+            sum += le;
         }
     }
 
-    power = hasTexture ? WaveActiveSum(power) : ESTIMATE_TRI_POWER_NUM_SAMPLES_PER_TRI;
-
-    const float3 emissiveFactor = tri.GetFactor();
-    const float emissiveStrength = (float)tri.GetStrength();
-    power = power * emissiveFactor * emissiveStrength;
-
-    const float3 vtx1 = Light::DecodeEmissiveTriV1(tri);
-    const float3 vtx2 = Light::DecodeEmissiveTriV2(tri);
-    const float surfaceArea = TriangleArea(tri.Vtx0, vtx1, vtx2);
-    const float pdf = surfaceArea > 0 ? 1.0f / surfaceArea : 0;
-    float mcEstimate = pdf > 0 ? Math::Luminance(power) * PI / (pdf * ESTIMATE_TRI_POWER_NUM_SAMPLES_PER_TRI) : 0;
+    // Average of the emissive texture over the triangle. It doesn't depend on emissive
+    // factor and strength, so it's kept around (and cached on disk) to recompute the
+    // power when those change.
+    const float3 texAvg = hasTexture ? WaveActiveSum(sum) / ESTIMATE_TRI_POWER_NUM_SAMPLES_PER_TRI : 1.0f;
 
     if (laneIdx == 0)
-        g_power[triIdx] = mcEstimate;
-}
\ No newline at end of file
+    {
+        g_texAvg[triIdx] = texAvg;
+        g_power[triIdx] = EmissivePower::Estimate(tri, texAvg);
+    }
+}
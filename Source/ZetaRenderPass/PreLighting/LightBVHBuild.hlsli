@@ -0,0 +1,164 @@
+#ifndef LIGHT_BVH_BUILD_H
+#define LIGHT_BVH_BUILD_H
+
+#include "PreLighting_Common.h"
+#include "../Common/LightBVH.hlsli"
+
+// Light BVH is built in the following steps:
+//
+//  1. Compute bounds of triangle centroids
+//  2. Compute Morton code of each triangle's centroid
+//  3. Sort triangles by their Morton codes (bitonic sort)
+//  4. Initialize leaves (complete binary tree in implicit layout, so sorted order
+//     directly gives the tree topology). In clustered mode, every leaf covers a range
+//     of consecutive sorted triangles.
+//  5. Refit internal nodes, one level at a time from the bottom up
+//
+// When emissive positions change, only the last two steps are repeated.
+namespace LightBVHBuild
+{
+    float3 Centroid(RT::EmissiveTriangle tri)
+    {
+        const float3 vtx1 = Light::DecodeEmissiveTriV1(tri);
+        const float3 vtx2 = Light::DecodeEmissiveTriV2(tri);
+
+        return (tri.Vtx0 + vtx1 + vtx2) / 3.0f;
+    }
+
+    // Inserts two zero bits after each of the lower 10 bits
+    uint ExpandBits(uint x)
+    {
+        x = (x * 0x00010001u) & 0xFF0000FFu;
+        x = (x * 0x00000101u) & 0x0F00F00Fu;
+        x = (x * 0x00000011u) & 0xC30C30C3u;
+        x = (x * 0x00000005u) & 0x49249249u;
+
+        return x;
+    }
+
+    // p is expected to be in [0, 1]^3
+    uint MortonCode(float3 p)
+    {
+        const uint3 q = (uint3)clamp(p * 1024.0f, 0.0f, 1023.0f);
+        return (ExpandBits(q.x) << 2) | (ExpandBits(q.y) << 1) | ExpandBits(q.z);
+    }
+
+    uint KeyOffset(uint leaf)
+    {
+        return LIGHT_BVH_KEYS_OFFSET + leaf * 8;
+    }
+
+    RT::LightBVHNode EmptyNode()
+    {
+        RT::LightBVHNode ret;
+        ret.BoundsMin = 0;
+        ret.Flux = 0;
+        ret.BoundsMax = 0;
+        ret.TriIdx = UINT32_MAX;
+        ret.Axis = float3(0, 1, 0);
+        ret.CosTheta_o = 1;
+
+        return ret;
+    }
+
+    RT::LightBVHNode Leaf(RT::EmissiveTriangle tri, uint triIdx, float flux)
+    {
+        const float3 vtx1 = Light::DecodeEmissiveTriV1(tri);
+        const float3 vtx2 = Light::DecodeEmissiveTriV2(tri);
+        const float3 n = cross(vtx1 - tri.Vtx0, vtx2 - tri.Vtx0);
+
+        // Degenerate triangles are never sampled
+        if(dot(n, n) == 0)
+        {
+            RT::LightBVHNode ret = EmptyNode();
+            ret.TriIdx = triIdx;
+
+            return ret;
+        }
+
+        RT::LightBVHNode ret;
+        ret.BoundsMin = min(tri.Vtx0, min(vtx1, vtx2));
+        ret.Flux = flux;
+        ret.BoundsMax = max(tri.Vtx0, max(vtx1, vtx2));
+        ret.TriIdx = triIdx;
+        ret.Axis = normalize(n);
+        // Double-sided triangles emit in every direction
+        ret.CosTheta_o = tri.IsDoubleSided() ? -1.0f : 1.0f;
+
+        return ret;
+    }
+
+    // Smallest cone that bounds both cones (Ref: pbrt-v4, DirectionCone::Union())
+    void UnionCones(float3 axis_a, float cosTheta_a, float3 axis_b, float cosTheta_b,
+        out float3 axis, out float cosTheta)
+    {
+        // Make sure a is the wider one
+        if(cosTheta_b < cosTheta_a)
+        {
+            float3 tempAxis = axis_a;
+            axis_a = axis_b;
+            axis_b = tempAxis;
+
+            float tempCos = cosTheta_a;
+            cosTheta_a = cosTheta_b;
+            cosTheta_b = tempCos;
+        }
+
+        const float theta_a = acos(clamp(cosTheta_a, -1.0f, 1.0f));
+        const float theta_b = acos(clamp(cosTheta_b, -1.0f, 1.0f));
+        const float theta_d = acos(clamp(dot(axis_a, axis_b), -1.0f, 1.0f));
+
+        // a already contains b
+        if(min(theta_d + theta_b, PI) <= theta_a)
+        {
+            axis = axis_a;
+            cosTheta = cosTheta_a;
+
+            return;
+        }
+
+        // Small margin to account for rounding errors -- cones must be conservative
+        const float theta_o = 0.5f * (theta_a + theta_d + theta_b) + 1e-4f;
+        const float3 w_r = cross(axis_a, axis_b);
+
+        if(theta_o >= PI || dot(w_r, w_r) == 0)
+        {
+            axis = axis_a;
+            cosTheta = -1.0f;
+
+            return;
+        }
+
+        // Rotate axis of a towards axis of b
+        const float theta_r = theta_o - theta_a;
+        const float3 towardsB = cross(normalize(w_r), axis_a);
+        axis = normalize(axis_a * cos(theta_r) + towardsB * sin(theta_r));
+        cosTheta = cos(theta_o);
+    }
+
+    RT::LightBVHNode Merge(RT::LightBVHNode a, RT::LightBVHNode b)
+    {
+        if(b.Flux == 0)
+        {
+            a.TriIdx = UINT32_MAX;
+            return a;
+        }
+
+        if(a.Flux == 0)
+        {
+            b.TriIdx = UINT32_MAX;
+            return b;
+        }
+
+        RT::LightBVHNode ret;
+        ret.BoundsMin = min(a.BoundsMin, b.BoundsMin);
+        ret.Flux = a.Flux + b.Flux;
+        ret.BoundsMax = max(a.BoundsMax, b.BoundsMax);
+        ret.TriIdx = UINT32_MAX;
+        UnionCones(a.Axis, a.CosTheta_o, b.Axis, b.CosTheta_o, ret.Axis, ret.CosTheta_o);
+
+        return ret;
+    }
+}
+
+#endif
@@ -0,0 +1,59 @@
+#include "LightBVHBuild.hlsli"
+
+#define NUM_WAVES (LIGHT_BVH_BOUNDS_GROUP_DIM_X / LIGHT_BVH_WAVE_LEN)
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbLightBVH> g_local : register(b0);
+StructuredBuffer<RT::EmissiveTriangle> g_emissives : register(t0);
+RWByteAddressBuffer g_scratch : register(u2);
+
+groupshared float3 g_waveMin[NUM_WAVES];
+groupshared float3 g_waveMax[NUM_WAVES];
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Single group that computes the bounds of all triangle centroids
+[WaveSize(LIGHT_BVH_WAVE_LEN)]
+[numthreads(LIGHT_BVH_BOUNDS_GROUP_DIM_X, 1, 1)]
+void main(uint Gidx : SV_GroupIndex)
+{
+    float3 minPos = FLT_MAX;
+    float3 maxPos = -FLT_MAX;
+
+    for (uint i = Gidx; i < g_local.NumTriangles; i += LIGHT_BVH_BOUNDS_GROUP_DIM_X)
+    {
+        const float3 c = LightBVHBuild::Centroid(g_emissives[i]);
+        minPos = min(minPos, c);
+        maxPos = max(maxPos, c);
+    }
+
+    minPos = WaveActiveMin(minPos);
+    maxPos = WaveActiveMax(maxPos);
+
+    if (WaveIsFirstLane())
+    {
+        g_waveMin[Gidx / LIGHT_BVH_WAVE_LEN] = minPos;
+        g_waveMax[Gidx / LIGHT_BVH_WAVE_LEN] = maxPos;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (Gidx < LIGHT_BVH_WAVE_LEN)
+    {
+        minPos = Gidx < NUM_WAVES ? g_waveMin[Gidx] : FLT_MAX;
+        maxPos = Gidx < NUM_WAVES ? g_waveMax[Gidx] : -FLT_MAX;
+        minPos = WaveActiveMin(minPos);
+        maxPos = WaveActiveMax(maxPos);
+
+        if (Gidx == 0)
+        {
+            g_scratch.Store3(0, asuint(minPos));
+            g_scratch.Store3(16, asuint(maxPos));
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#include "LightBVHBuild.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbLightBVH> g_local : register(b0);
+StructuredBuffer<RT::EmissiveTriangle> g_emissives : register(t0);
+RWStructuredBuffer<float> g_power : register(u0);
+RWStructuredBuffer<RT::LightBVHNode> g_nodes : register(u1);
+RWByteAddressBuffer g_scratch : register(u2);
+RWStructuredBuffer<uint> g_triToLeaf : register(u3);
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// Leaf is the union of its cluster members. Members are written to the triangle to leaf
+// map (see LightBVH::MemberOffset()), so that refitting doesn't need the sorted keys.
+RT::LightBVHNode ClusterLeaf(uint leafIdx)
+{
+    const uint clusterSize = 1u << g_local.Log2ClusterSize;
+    const uint firstSlot = leafIdx << g_local.Log2ClusterSize;
+    RT::LightBVHNode ret = LightBVHBuild::EmptyNode();
+
+    for (uint i = 0; i < clusterSize; i++)
+    {
+        const uint slot = firstSlot + i;
+        const uint offset = LightBVH::MemberOffset(g_local.NumTriangles, slot);
+        uint triIdx;
+        float flux;
+
+        if (g_local.RefitOnly)
+        {
+            triIdx = g_triToLeaf[offset];
+            flux = asfloat(g_triToLeaf[offset + 1]);
+        }
+        else
+        {
+            triIdx = g_scratch.Load2(LightBVHBuild::KeyOffset(slot)).y;
+            flux = triIdx == UINT32_MAX ? 0 : g_power[triIdx];
+
+            if (triIdx != UINT32_MAX)
+                g_triToLeaf[triIdx] = slot;
+        }
+
+        RT::LightBVHNode member = LightBVHBuild::EmptyNode();
+        if (triIdx != UINT32_MAX)
+            member = LightBVHBuild::Leaf(g_emissives[triIdx], triIdx, flux);
+
+        // Flux of degenerate triangles is zero, so they're never sampled
+        if (!g_local.RefitOnly)
+        {
+            g_triToLeaf[offset] = triIdx;
+            g_triToLeaf[offset + 1] = asuint(member.Flux);
+        }
+
+        ret = LightBVHBuild::Merge(ret, member);
+    }
+
+    ret.TriIdx = firstSlot;
+
+    return ret;
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(LIGHT_BVH_GROUP_DIM_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_local.NumLeaves)
+        return;
+
+    const uint nodeIdx = g_local.NumLeaves - 1 + DTid.x;
+
+    if (g_local.Log2ClusterSize > 0)
+    {
+        g_nodes[nodeIdx] = ClusterLeaf(DTid.x);
+        return;
+    }
+
+    // Triangle order and power don't change when only positions are updated
+    if (g_local.RefitOnly)
+    {
+        const RT::LightBVHNode leaf = g_nodes[nodeIdx];
+        if (leaf.TriIdx == UINT32_MAX)
+            return;
+
+        g_nodes[nodeIdx] = LightBVHBuild::Leaf(g_emissives[leaf.TriIdx], leaf.TriIdx, leaf.Flux);
+        return;
+    }
+
+    const uint triIdx = g_scratch.Load2(LightBVHBuild::KeyOffset(DTid.x)).y;
+
+    if (triIdx == UINT32_MAX)
+    {
+        g_nodes[nodeIdx] = LightBVHBuild::EmptyNode();
+        return;
+    }
+
+    g_nodes[nodeIdx] = LightBVHBuild::Leaf(g_emissives[triIdx], triIdx, g_power[triIdx]);
+    g_triToLeaf[triIdx] = DTid.x;
+}
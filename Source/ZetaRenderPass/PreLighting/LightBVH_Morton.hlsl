@@ -0,0 +1,36 @@
+#include "LightBVHBuild.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbLightBVH> g_local : register(b0);
+StructuredBuffer<RT::EmissiveTriangle> g_emissives : register(t0);
+RWByteAddressBuffer g_scratch : register(u2);
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(LIGHT_BVH_GROUP_DIM_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_local.NumKeys)
+        return;
+
+    // Padding keys have the largest key, so they end up at the end after sorting
+    uint2 keyVal = UINT32_MAX;
+
+    if (DTid.x < g_local.NumTriangles)
+    {
+        const float3 minPos = asfloat(g_scratch.Load3(0));
+        const float3 maxPos = asfloat(g_scratch.Load3(16));
+        const float3 extents = max(maxPos - minPos, 1e-6f);
+
+        const float3 c = LightBVHBuild::Centroid(g_emissives[DTid.x]);
+        keyVal.x = LightBVHBuild::MortonCode((c - minPos) / extents);
+        keyVal.y = DTid.x;
+    }
+
+    g_scratch.Store2(LightBVHBuild::KeyOffset(DTid.x), keyVal);
+}
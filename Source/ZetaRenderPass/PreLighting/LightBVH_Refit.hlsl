@@ -0,0 +1,23 @@
+#include "LightBVHBuild.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbLightBVH> g_local : register(b0);
+RWStructuredBuffer<RT::LightBVHNode> g_nodes : register(u1);
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Updates one level of the tree from its children
+[numthreads(LIGHT_BVH_GROUP_DIM_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_local.LevelSize)
+        return;
+
+    const uint nodeIdx = g_local.LevelStart + DTid.x;
+    g_nodes[nodeIdx] = LightBVHBuild::Merge(g_nodes[2 * nodeIdx + 1], g_nodes[2 * nodeIdx + 2]);
+}
@@ -0,0 +1,91 @@
+#include "LightBVHBuild.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbLightBVH> g_local : register(b0);
+RWByteAddressBuffer g_scratch : register(u2);
+
+groupshared uint2 g_keys[LIGHT_BVH_SORT_BLOCK_SIZE];
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// Ties are broken by triangle index, so that the build is deterministic
+bool Greater(uint2 a, uint2 b)
+{
+    return a.x > b.x || (a.x == b.x && a.y > b.y);
+}
+
+void CompareExchange(uint t, uint blockStart, uint k, uint j)
+{
+    const uint i0 = ((t & ~(j - 1)) << 1) | (t & (j - 1));
+    const uint i1 = i0 + j;
+    const bool ascending = ((blockStart + i0) & k) == 0;
+
+    const uint2 a = g_keys[i0];
+    const uint2 b = g_keys[i1];
+
+    if (Greater(a, b) == ascending)
+    {
+        g_keys[i0] = b;
+        g_keys[i1] = a;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Steps of bitonic sort that only compare keys within the same block. When K is 0, each
+// block is fully sorted, otherwise, bitonic sequences of size K that were partially merged 
+// by LightBVH_SortStep are merged for the remaining distances.
+[numthreads(LIGHT_BVH_SORT_GROUP_DIM_X, 1, 1)]
+void main(uint3 Gid : SV_GroupID, uint Gidx : SV_GroupIndex)
+{
+    const uint blockSize = min(g_local.NumKeys, LIGHT_BVH_SORT_BLOCK_SIZE);
+    const uint blockStart = Gid.x * LIGHT_BVH_SORT_BLOCK_SIZE;
+    // Number of keys is a power of two, so either both keys that a thread loads are 
+    // valid or neither is
+    const bool active = 2 * Gidx < blockSize;
+
+    if (active)
+    {
+        g_keys[2 * Gidx] = g_scratch.Load2(LightBVHBuild::KeyOffset(blockStart + 2 * Gidx));
+        g_keys[2 * Gidx + 1] = g_scratch.Load2(LightBVHBuild::KeyOffset(blockStart + 2 * Gidx + 1));
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (g_local.SortK == 0)
+    {
+        for (uint k = 2; k <= blockSize; k <<= 1)
+        {
+            for (uint j = k >> 1; j > 0; j >>= 1)
+            {
+                if (active)
+                    CompareExchange(Gidx, blockStart, k, j);
+
+                GroupMemoryBarrierWithGroupSync();
+            }
+        }
+    }
+    else
+    {
+        for (uint j = blockSize >> 1; j > 0; j >>= 1)
+        {
+            if (active)
+                CompareExchange(Gidx, blockStart, g_local.SortK, j);
+
+            GroupMemoryBarrierWithGroupSync();
+        }
+    }
+
+    if (active)
+    {
+        g_scratch.Store2(LightBVHBuild::KeyOffset(blockStart + 2 * Gidx), g_keys[2 * Gidx]);
+        g_scratch.Store2(LightBVHBuild::KeyOffset(blockStart + 2 * Gidx + 1), g_keys[2 * Gidx + 1]);
+    }
+}
@@ -0,0 +1,35 @@
+#include "LightBVHBuild.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbLightBVH> g_local : register(b0);
+RWByteAddressBuffer g_scratch : register(u2);
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// One step of bitonic sort for distances that span more than one block
+[numthreads(LIGHT_BVH_GROUP_DIM_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= (g_local.NumKeys >> 1))
+        return;
+
+    const uint j = g_local.SortJ;
+    const uint i0 = ((DTid.x & ~(j - 1)) << 1) | (DTid.x & (j - 1));
+    const uint i1 = i0 + j;
+    const bool ascending = (i0 & g_local.SortK) == 0;
+
+    const uint2 a = g_scratch.Load2(LightBVHBuild::KeyOffset(i0));
+    const uint2 b = g_scratch.Load2(LightBVHBuild::KeyOffset(i1));
+    const bool greater = a.x > b.x || (a.x == b.x && a.y > b.y);
+
+    if (greater == ascending)
+    {
+        g_scratch.Store2(LightBVHBuild::KeyOffset(i0), b);
+        g_scratch.Store2(LightBVHBuild::KeyOffset(i1), a);
+    }
+}
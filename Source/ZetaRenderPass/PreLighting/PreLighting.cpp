@@ -3,16 +3,17 @@
 #include <Support/Param.h>
 #include <Math/Sampling.h>
 #include <Scene/SceneCore.h>
-#include <Core/RenderGraph.h>
+#include <Scene/Camera.h>
+#include <Math/CollisionFuncs.h>
 #include <Core/SharedShaderResources.h>
-#include <Math/Sampling.h>
-#include <Support/Task.h>
-#include <App/Timer.h>
 #include <App/Log.h>
+#include <App/Path.h>
+#include <App/Filesystem.h>
 
 using namespace ZetaRay;
 using namespace ZetaRay::Core;
 using namespace ZetaRay::Core::GpuMemory;
+using namespace ZetaRay::Core::Direct3DUtil;
 using namespace ZetaRay::RenderPass;
 using namespace ZetaRay::Math;
 using namespace ZetaRay::Scene;
@@ -23,138 +24,32 @@ using namespace ZetaRay::Math;
 
 namespace
 {
-    // Ref: https://www.keithschwarz.com/darts-dice-coins/
-    void BuildAliasTable(MutableSpan<float> probs, MutableSpan<RT::EmissiveLumenAliasTableEntry> table)
+    // Texture averages of all the emissive triangles, see PreLighting::m_triTexAvg
+    struct TexAvgCacheHeader
     {
-        const int64_t N = probs.size();
-        const float oneDivN = 1.0f / N;
-        AliasTable_Normalize(probs);
-
-        for (int64_t i = 0; i < N; i++)
-        {
-            table[i].CachedP_Orig = probs[i] * oneDivN;
-#ifndef NDEBUG
-            table[i].Alias = UINT32_MAX;
-#endif
-        }
-
-        struct TempAllocator
-        {
-            void* AllocateAligned(size_t size, size_t alignment)
-            {
-                m_offset += size;
-                Assert(m_offset <= m_sizeInBytes, "bug");
-
-                return m_memPtr;
-            }
-
-            ZetaInline void FreeAligned(void* mem, size_t size, size_t alignment)
-            {}
-
-            void* m_memPtr;
-            size_t m_sizeInBytes;
-            size_t m_offset = 0;
-        };
-
-        const size_t sizeInBytes = N * sizeof(uint32_t);
-        const size_t totalSizeInBytes = 2 * sizeInBytes;
-        App::OneTimeFrameAllocatorWithFallback allocator;
-        void* mem = allocator.AllocateAligned(totalSizeInBytes);
-
-        TempAllocator tempAllocator1{
-            .m_memPtr = mem,
-            .m_sizeInBytes = sizeInBytes };
-        TempAllocator tempAllocator2{
-            .m_memPtr = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(mem) + sizeInBytes),
-            .m_sizeInBytes = sizeInBytes };
-
-        // maintain an index buffer since original ordering of elements must be preserved
-        SmallVector<uint32_t, TempAllocator> larger(tempAllocator1);
-        larger.reserve(N);
-
-        SmallVector<uint32_t, TempAllocator> smaller(tempAllocator2);
-        smaller.reserve(N);
-
-        for (int64_t i = 0; i < N; i++)
-        {
-            if (probs[i] < 1.0f)
-                smaller.push_back((uint32_t)i);
-            else
-                larger.push_back((uint32_t)i);
-        }
-
-#ifndef NDEBUG
-        int64_t numInsertions = 0;
-#endif
-
-        // in each iteration, pick two probabilities such that one is smaller than 1.0 and the other larger 
-        // than 1.0. Use the latter to bring up the former to 1.0.
-        while (!smaller.empty() && !larger.empty())
-        {
-            const uint32_t smallerIdx = smaller.back();
-            smaller.pop_back();
-            const float smallerProb = probs[smallerIdx];
+        static constexpr uint32_t MAGIC = 0x58455445;   // "ETEX"
+        static constexpr uint32_t VERSION = 1;
 
-            const uint32_t largerIdx = larger.back();
-            float largerProb = probs[largerIdx];
-            Assert(largerProb >= 1.0f, "should be >= 1.0");
-
-            RT::EmissiveLumenAliasTableEntry& e = table[smallerIdx];
-            Assert(e.Alias == uint32_t(-1), "Every element must be inserted exactly one time.");
-            e.Alias = largerIdx;
-            e.P_Curr = smallerProb;
-
-            // = largerProb - (1.0f - smallerProb);
-            largerProb = (smallerProb + largerProb) - 1.0f;
-            probs[largerIdx] = largerProb;
-
-            if (largerProb < 1.0f)
-            {
-                larger.pop_back();
-                smaller.push_back(largerIdx);
-            }
-
-#ifndef NDEBUG
-            numInsertions++;
-#endif
-        }
-
-        while (!larger.empty())
-        {
-            size_t idx = larger.back();
-            larger.pop_back();
-            //Assert(fabsf(1.0f - probs[idx]) <= 0.1f, "This should be ~1.0.");
-
-            // alias should point to itself
-            table[idx].Alias = (uint32_t)idx;
-            table[idx].P_Curr = 1.0f;
-
-#ifndef NDEBUG
-            numInsertions++;
-#endif
-        }
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t Key;
+        uint64_t NumTriangles;
+    };
 
-        while (!smaller.empty())
-        {
-            size_t idx = smaller.back();
-            smaller.pop_back();
-            //Assert(fabsf(1.0f - probs[idx]) <= 0.1f, "This should be ~1.0.");
-
-            // alias should point to itself
-            table[idx].Alias = (uint32_t)idx;
-            table[idx].P_Curr = 1.0f;
-
-#ifndef NDEBUG
-            numInsertions++;
-#endif
-        }
-
-        Assert(numInsertions == N, "Some elements were not inserted.");
-
-        for (int64_t i = 0; i < N; i++)
-            table[i].CachedP_Alias = table[table[i].Alias].CachedP_Orig;
+    void TexAvgCachePath(uint64_t key, Filesystem::Path& path)
+    {
+        StackStr(filename, n, "EmissiveTexAvg_%016llx.cache", key);
+        path.Reset(App::GetPSOCacheDir());
+        path.Append(filename);
+    }
 
-        allocator.FreeAligned(mem, sizeInBytes);
+    // Voxel that contains the given (camera-space) coordinate along one axis, without any 
+    // clamping. Matches LVG::MapPosToVoxel() -- along y, voxel index increases in the 
+    // opposite direction of camera space.
+    ZetaInline int VoxelCoord(float p, float extent, int dim, bool flip)
+    {
+        const int v = (int)floorf(p / (2.0f * extent));
+        return flip ? (dim >> 1) - 1 - v : (dim >> 1) + v;
     }
 }
 
@@ -173,9 +68,9 @@ PreLighting::PreLighting()
         D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
         GlobalResource::FRAME_CONSTANTS_BUFFER);
 
-    // emissive triangles
+    // emissive triangles -- positions are updated in place at the start of the pass
     m_rootSig.InitAsBufferSRV(2, 0, 0,
-        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE,
         GlobalResource::EMISSIVE_TRIANGLE_BUFFER,
         true);
 
@@ -185,17 +80,47 @@ PreLighting::PreLighting()
         GlobalResource::EMISSIVE_TRIANGLE_ALIAS_TABLE,
         true);
 
-    // halton
+    // halton/object-space emissive triangles
     m_rootSig.InitAsBufferSRV(4, 2, 0,
         D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC,
         nullptr,
         true);
 
-    // tri power/sample sets
+    // tri power/sample sets/emissive triangles
     m_rootSig.InitAsBufferUAV(5, 0, 0,
         D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE,
         nullptr,
         true);
+
+    // alias table (build)
+    m_rootSig.InitAsBufferUAV(6, 1, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE,
+        nullptr,
+        true);
+
+    // alias table/light BVH scratch
+    m_rootSig.InitAsBufferUAV(7, 2, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE,
+        nullptr,
+        true);
+
+    // light BVH triangle to leaf map
+    m_rootSig.InitAsBufferUAV(8, 3, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE,
+        nullptr,
+        true);
+
+    // voxels to rebuild/emissive position updates
+    m_rootSig.InitAsBufferSRV(9, 3, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC,
+        nullptr,
+        true);
+
+    // view-dependent alias table
+    m_rootSig.InitAsBufferSRV(10, 4, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        nullptr,
+        true);
 }
 
 void PreLighting::InitPSOs()
@@ -213,21 +138,8 @@ void PreLighting::InitPSOs()
     auto samplers = App::GetRenderer().GetStaticSamplers();
     RenderPassBase::InitRenderPass("PreLighting", flags, samplers);
 
-    TaskSet ts;
-
     for (int i = 0; i < (int)SHADER::COUNT; i++)
-    {
-        StackStr(buff, n, "PreLighting_shader_%d", i);
-
-        ts.EmplaceTask(buff, [i, this]()
-            {
-                m_psoLib.CompileComputePSO_MT(i, m_rootSigObj.Get(), COMPILED_CS[i]);
-            });
-    }
-
-    ts.Sort();
-    ts.Finalize();
-    App::Submit(ZetaMove(ts));
+        m_psoLib.EnqueueComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
 }
 
 void PreLighting::Init()
@@ -252,20 +164,59 @@ void PreLighting::Init()
 void PreLighting::Update()
 {
     m_estimatePowerThisFrame = false;
+    m_buildAliasTableThisFrame = false;
+    m_buildLightBVHThisFrame = false;
+    m_refitLightBVHThisFrame = false;
     m_doPresamplingThisFrame = false;
+    m_buildLVGThisFrame = false;
+    m_buildViewAliasTableThisFrame = false;
+    m_numEmissivePosUpdates = 0;
     m_currNumTris = (uint32_t)App::GetScene().NumEmissiveTriangles();
     m_useLVG = m_useLVG && (m_currNumTris >= m_minNumLightsForPresampling);
 
     if (m_currNumTris == 0)
         return;
 
+    auto posUpdates = App::GetScene().EmissivePositionUpdates();
+
+    if (!posUpdates.empty())
+    {
+        const uint32_t sizeInBytes = (uint32_t)(posUpdates.size() * sizeof(RT::EmissivePositionUpdate));
+        m_emissivePosUpdates = GpuMemory::AllocateFrameUpload(sizeInBytes, sizeof(uint32_t));
+        memcpy(m_emissivePosUpdates.MappedMemory, posUpdates.data(), sizeInBytes);
+        m_numEmissivePosUpdates = (uint32_t)posUpdates.size();
+    }
+
     const bool isLVGAllocated = m_lvg.IsInitialized();
     if ((m_useLVG && !isLVGAllocated) || (!m_useLVG && isLVGAllocated))
         ToggleLVG();
 
-    if (App::GetScene().AreEmissiveMaterialsStale())
+    auto& r = App::GetRenderer().GetSharedShaderResources();
+
+    if (!m_useLightBVH && m_lightBVH.IsInitialized())
+    {
+        r.RemoveDefaultHeapBuffer(GlobalResource::LIGHT_BVH, m_lightBVH);
+        r.RemoveDefaultHeapBuffer(GlobalResource::LIGHT_BVH_TRI_TO_LEAF, m_lightBVHTriToLeaf);
+
+        m_lightBVH.Reset();
+        m_lightBVHTriToLeaf.Reset();
+        m_lightBVHNumLeaves = 0;
+        m_lightBVHLog2ClusterSize = 0;
+    }
+
+    m_buildAliasTableThisFrame = App::GetScene().AreEmissiveMaterialsStale();
+    // Triangle order depends on emissive positions at the time of build, but as long as 
+    // the movement is limited, refitting keeps the tree quality reasonable
+    const uint32_t log2ClusterSize = m_lightBVHClusters ? LIGHT_BVH_LOG2_CLUSTER_SIZE : 0;
+    m_buildLightBVHThisFrame = m_useLightBVH && (m_buildAliasTableThisFrame || 
+        m_lightBVHNumLeaves == 0 || m_lightBVHLog2ClusterSize != log2ClusterSize);
+    m_refitLightBVHThisFrame = m_useLightBVH && !m_buildLightBVHThisFrame &&
+        App::GetScene().AreEmissivePositionsUpdated();
+    // Both alias table and light BVH are built from triangle powers
+    m_estimatePowerThisFrame = m_buildAliasTableThisFrame || m_buildLightBVHThisFrame;
+
+    if (m_estimatePowerThisFrame)
     {
-        m_estimatePowerThisFrame = true;
         const size_t currPowerBuffLen = m_triPower.IsInitialized() ? 
             m_triPower.Desc().Width / sizeof(float) : 0;
 
@@ -278,21 +229,93 @@ void PreLighting::Update()
                 sizeInBytes,
                 D3D12_RESOURCE_STATE_COMMON,
                 true);
+        }
+
+        UpdateTexAvgCache();
+    }
 
-            // Readback buffer to read results on CPU
-            m_readback = GpuMemory::GetReadbackHeapBuffer(sizeInBytes);
+    if (m_buildLightBVHThisFrame)
+    {
+        const uint32_t numClusters = CeilUnsignedIntDiv(m_currNumTris, 1u << log2ClusterSize);
+        m_lightBVHLog2ClusterSize = log2ClusterSize;
+        m_lightBVHNumLeaves = (uint32_t)NextPow2(numClusters);
+        const uint32_t numKeys = m_lightBVHNumLeaves << log2ClusterSize;
+        const uint32_t numNodes = 2 * m_lightBVHNumLeaves - 1;
+        const size_t currNumNodes = m_lightBVH.IsInitialized() ?
+            m_lightBVH.Desc().Width / sizeof(RT::LightBVHNode) : 0;
+
+        if (currNumNodes < numNodes)
+        {
+            m_lightBVH = GpuMemory::GetDefaultHeapBuffer("LightBVH",
+                numNodes * sizeof(RT::LightBVHNode),
+                D3D12_RESOURCE_STATE_COMMON,
+                true);
+
+            r.InsertOrAssignDefaultHeapBuffer(GlobalResource::LIGHT_BVH, m_lightBVH);
         }
 
-        return;
+        // Clustered leaves also store their members (triangle index and flux) here, see
+        // LightBVH.hlsli
+        const uint32_t triToLeafLen = m_currNumTris + (log2ClusterSize ? 2 * numKeys : 0);
+        const size_t currTriToLeafLen = m_lightBVHTriToLeaf.IsInitialized() ?
+            m_lightBVHTriToLeaf.Desc().Width / sizeof(uint32_t) : 0;
+
+        if (currTriToLeafLen < triToLeafLen)
+        {
+            m_lightBVHTriToLeaf = GpuMemory::GetDefaultHeapBuffer("LightBVHTriToLeaf",
+                triToLeafLen * sizeof(uint32_t),
+                D3D12_RESOURCE_STATE_COMMON,
+                true);
+
+            r.InsertOrAssignDefaultHeapBuffer(GlobalResource::LIGHT_BVH_TRI_TO_LEAF, 
+                m_lightBVHTriToLeaf);
+        }
+
+        // Only needed during the build -- released afterwards
+        m_lightBVHScratch = GpuMemory::GetDefaultHeapBuffer("LightBVHScratch",
+            LIGHT_BVH_SCRATCH_SIZE(numKeys),
+            D3D12_RESOURCE_STATE_COMMON,
+            true);
+    }
+
+    if (m_buildAliasTableThisFrame)
+    {
+        const size_t currAliasTableLen = m_aliasTable.IsInitialized() ?
+            m_aliasTable.Desc().Width / sizeof(RT::EmissiveLumenAliasTableEntry) : 0;
+
+        if (currAliasTableLen < m_currNumTris)
+        {
+            const uint32_t sizeInBytes = m_currNumTris * sizeof(RT::EmissiveLumenAliasTableEntry);
+            m_aliasTable = GpuMemory::GetDefaultHeapBuffer("AliasTable",
+                sizeInBytes,
+                D3D12_RESOURCE_STATE_COMMON,
+                true);
+
+            r.InsertOrAssignDefaultHeapBuffer(
+                GlobalResource::EMISSIVE_TRIANGLE_ALIAS_TABLE, m_aliasTable);
+        }
+
+        // Only needed during the build -- released afterwards
+        const uint32_t numBlocks = CeilUnsignedIntDiv(m_currNumTris, ALIAS_TABLE_GROUP_DIM_X);
+        m_aliasTableScratch = GpuMemory::GetDefaultHeapBuffer("AliasTableScratch",
+            ALIAS_TABLE_SCRATCH_SIZE(m_currNumTris, numBlocks),
+            D3D12_RESOURCE_STATE_COMMON,
+            true);
+
+        // Alias table is ready in the same frame, so presampling can go ahead
     }
 
+    if (m_useLVG)
+        UpdateLVG();
+
     // Skip light presampling when number of emissives is low
     Assert(m_minNumLightsForPresampling != UINT32_MAX, 
         "Light presampling is enabled, but presampling params haven't been set.");
     if (m_currNumTris < m_minNumLightsForPresampling)
         return;
 
-    if (App::GetScene().EmissiveLighting())
+    // Light BVH replaces presampled sets when enabled
+    if (App::GetScene().EmissiveLighting() && !m_useLightBVH)
     {
         m_doPresamplingThisFrame = true;
 
@@ -307,11 +330,12 @@ void PreLighting::Update()
                 D3D12_RESOURCE_STATE_COMMON,
                 true);
 
-            auto& r = App::GetRenderer().GetSharedShaderResources();
             r.InsertOrAssignDefaultHeapBuffer(GlobalResource::PRESAMPLED_EMISSIVE_SETS, 
                 m_sampleSets);
         }
     }
+
+    UpdateViewAliasTable();
 }
 
 void PreLighting::Render(CommandList& cmdList)
@@ -327,43 +351,123 @@ void PreLighting::Render(CommandList& cmdList)
 
     computeCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
 
+    // Everything else reads the emissive positions, so this has to come first
+    if (m_numEmissivePosUpdates)
+    {
+        Assert(m_numEmissivePosUpdates <= D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION, 
+            "#blocks exceeded maximum allowed.");
+
+        computeCmdList.PIXBeginEvent("UpdateEmissivePositions");
+        const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "UpdateEmissivePositions");
+
+        auto& scene = App::GetScene();
+        const Buffer& emissives = scene.GetEmissiveTriangleBuffer();
+
+        m_rootSig.SetRootSRV(4, scene.GetEmissiveObjSpaceTriangleBuffer().GpuVA());
+        m_rootSig.SetRootSRV(9, m_emissivePosUpdates.GpuVA);
+        m_rootSig.SetRootUAV(5, emissives.GpuVA());
+        m_rootSig.End(computeCmdList);
+
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::UPDATE_EMISSIVE_POSITIONS));
+        computeCmdList.Dispatch(m_numEmissivePosUpdates, 1, 1);
+
+        // Rest of this pass and the lighting passes read the new positions
+        auto barrier = BufferBarrier(emissives.Resource(),
+            D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+            D3D12_BARRIER_SYNC_ALL_SHADING,
+            D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+            D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+
+        computeCmdList.ResourceBarrier(barrier);
+
+        gpuTimer.EndQuery(computeCmdList, queryIdx);
+        computeCmdList.PIXEndEvent();
+    }
+
     if (m_estimatePowerThisFrame)
     {
-        Assert(m_readback.IsInitialized(), "no readback buffer.");
-        Assert(!m_readback.IsMapped(), "readback buffer can't be mapped while in use by the GPU.");
         Assert(m_triPower.IsInitialized(), "Tri emissive power buffer hasn't been initialized.");
 
-        const uint32_t dispatchDimX = CeilUnsignedIntDiv(m_currNumTris, ESTIMATE_TRI_POWER_NUM_TRIS_PER_GROUP);
+        // Without texture sampling, one thread per triangle suffices
+        const uint32_t dispatchDimX = m_sampleEmissiveTexThisFrame ?
+            CeilUnsignedIntDiv(m_currNumTris, ESTIMATE_TRI_POWER_NUM_TRIS_PER_GROUP) :
+            CeilUnsignedIntDiv(m_currNumTris, ESTIMATE_TRI_POWER_GROUP_DIM_X);
         Assert(dispatchDimX <= D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION, "#blocks exceeded maximum allowed.");
 
         computeCmdList.PIXBeginEvent("EstimateTriPower");
         const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "EstimateTriPower");
 
-        computeCmdList.ResourceBarrier(m_triPower.Resource(),
-            D3D12_RESOURCE_STATE_COPY_SOURCE,
-            D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
-
         m_rootSig.SetRootSRV(4, m_halton.GpuVA());
         m_rootSig.SetRootUAV(5, m_triPower.GpuVA());
+        m_rootSig.SetRootUAV(6, m_triTexAvg.GpuVA());
 
         m_rootSig.End(computeCmdList);
 
-        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::ESTIMATE_TRIANGLE_POWER));
+        const auto sh = m_sampleEmissiveTexThisFrame ? SHADER::ESTIMATE_TRIANGLE_POWER :
+            SHADER::EMISSIVE_POWER_FROM_TEX_AVG;
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
         computeCmdList.Dispatch(dispatchDimX, 1, 1);
 
-        // copy results to readback buffer, so alias table can be computed on the cpu
-        computeCmdList.ResourceBarrier(m_triPower.Resource(),
-            D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-            D3D12_RESOURCE_STATE_COPY_SOURCE);
+        // Write the texture averages to the disk cache once they're ready
+        if (m_sampleEmissiveTexThisFrame)
+        {
+            auto barrier = BufferBarrier(m_triTexAvg.Resource(),
+                D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+                D3D12_BARRIER_SYNC_COPY,
+                D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+                D3D12_BARRIER_ACCESS_COPY_SOURCE);
+
+            computeCmdList.ResourceBarrier(barrier);
 
-        computeCmdList.CopyBufferRegion(m_readback.Resource(),
-            0,
-            m_triPower.Resource(),
-            0,
-            m_currNumTris * sizeof(float));
+            GpuMemory::EnqueueReadback(computeCmdList, m_triTexAvg.Resource(), 0,
+                m_currNumTris * sizeof(float3),
+                fastdelegate::MakeDelegate(this, &PreLighting::TexAvgReadbackCallback));
+        }
 
         gpuTimer.EndQuery(computeCmdList, queryIdx);
         computeCmdList.PIXEndEvent();
+
+        if (m_buildAliasTableThisFrame)
+        {
+            BuildAliasTable(computeCmdList, m_triPower, m_aliasTable, m_aliasTableScratch, 
+                "AliasTable");
+        }
+    }
+
+    if (m_buildLightBVHThisFrame || m_refitLightBVHThisFrame)
+        BuildLightBVH(computeCmdList);
+
+    // Needs the global alias table, so has to come after its build
+    if (m_buildViewAliasTableThisFrame)
+    {
+        const uint32_t dispatchDimX = CeilUnsignedIntDiv(m_currNumTris, VIEW_IMPORTANCE_GROUP_DIM_X);
+        Assert(dispatchDimX <= D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION, "#blocks exceeded maximum allowed.");
+
+        computeCmdList.PIXBeginEvent("ViewEmissiveImportance");
+        const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "ViewEmissiveImportance");
+
+        m_rootSig.SetRootUAV(5, m_viewPower.GpuVA());
+        m_rootSig.End(computeCmdList);
+
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::VIEW_EMISSIVE_IMPORTANCE));
+        computeCmdList.Dispatch(dispatchDimX, 1, 1);
+
+        gpuTimer.EndQuery(computeCmdList, queryIdx);
+        computeCmdList.PIXEndEvent();
+
+        BuildAliasTable(computeCmdList, m_viewPower, m_viewAliasTable, m_viewAliasTableScratch, 
+            "ViewAliasTable");
+    }
+
+    // Even though at this point this command list hasn't been submitted yet (only 
+    // recorded), it's safe to release the buffers here -- this is because resource 
+    // deallocation and signalling the related fence happens at the end of frame when 
+    // all command lists have been submitted
+    if (m_estimatePowerThisFrame)
+    {
+        m_triPower.Reset();
+        m_aliasTableScratch.Reset();
+        m_lightBVHScratch.Reset();
     }
 
     if (m_doPresamplingThisFrame)
@@ -390,9 +494,14 @@ void PreLighting::Render(CommandList& cmdList)
 
         cbPresampling cb;
         cb.NumTotalSamples = numSamples;
+        cb.ViewDependent = m_viewDependentPresampling && m_viewAliasTableValid;
 
         m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
         m_rootSig.SetRootUAV(5, m_sampleSets.GpuVA());
+
+        if (cb.ViewDependent)
+            m_rootSig.SetRootSRV(10, m_viewAliasTable.GpuVA());
+
         m_rootSig.End(computeCmdList);
 
         computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::PRESAMPLING));
@@ -414,14 +523,30 @@ void PreLighting::Render(CommandList& cmdList)
         cb.Extents_x = m_voxelExtents.x;
         cb.Extents_y = m_voxelExtents.y;
         cb.Extents_z = m_voxelExtents.z;
-        cb.NumTotalSamples = NUM_SAMPLES_PER_VOXEL * m_voxelGridDim.x * m_voxelGridDim.y * m_voxelGridDim.z;
+        cb.Offset_y = m_yOffset;
+        cb.NumTotalSamples = NUM_SAMPLES_PER_VOXEL * m_voxelGridDim.x * m_voxelGridDim.y * m_voxelGridDim.z *
+            LVG_NUM_CASCADES;
+        cb.NumVoxels = m_lvgNumVoxelsToBuild;
 
         m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
         m_rootSig.SetRootUAV(5, m_lvg.GpuVA());
+
+        if (m_lvgNumVoxelsToBuild)
+            m_rootSig.SetRootSRV(9, m_lvgVoxelList.GpuVA);
+
         m_rootSig.End(computeCmdList);
 
         computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::BUILD_LIGHT_VOXEL_GRID));
-        computeCmdList.Dispatch(m_voxelGridDim.x, m_voxelGridDim.y, m_voxelGridDim.z);
+
+        // One group per voxel, cascades are stacked along z
+        if (m_lvgNumVoxelsToBuild)
+        {
+            Assert(m_lvgNumVoxelsToBuild <= D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION, 
+                "#blocks exceeded maximum allowed.");
+            computeCmdList.Dispatch(m_lvgNumVoxelsToBuild, 1, 1);
+        }
+        else
+            computeCmdList.Dispatch(m_voxelGridDim.x, m_voxelGridDim.y, m_voxelGridDim.z * LVG_NUM_CASCADES);
 
         gpuTimer.EndQuery(computeCmdList, queryIdx);
         cmdList.PIXEndEvent();
@@ -434,7 +559,7 @@ void PreLighting::ToggleLVG()
     {
         Assert(!m_lvg.IsInitialized(), "Redundant call.");
         const size_t sizeInBytes = NUM_SAMPLES_PER_VOXEL * m_voxelGridDim.x * m_voxelGridDim.y * m_voxelGridDim.z *
-            sizeof(RT::VoxelSample);
+            LVG_NUM_CASCADES * sizeof(RT::VoxelSample);
 
         m_lvg = GpuMemory::GetDefaultHeapBuffer("LVG",
             (uint32_t)sizeInBytes,
@@ -443,6 +568,7 @@ void PreLighting::ToggleLVG()
 
         auto& r = App::GetRenderer().GetSharedShaderResources();
         r.InsertOrAssignDefaultHeapBuffer(GlobalResource::LIGHT_VOXEL_GRID, m_lvg);
+        m_lvgValid = false;
 
 
 
@@ -463,123 +589,447 @@ void PreLighting::ToggleLVG()
     }
 }
 
-void PreLighting::ReleaseTriPowerBufferAndReadback()
+void PreLighting::UpdateLVG()
 {
-    m_triPower.Reset();
-    m_readback.Reset();
-    m_buildLVGThisFrame = m_useLVG;
+    auto& scene = App::GetScene();
+    m_lvgNumVoxelsToBuild = 0;
+
+    // Contents are discarded once emissives are disabled
+    if (!scene.EmissiveLighting())
+    {
+        m_lvgValid = false;
+        return;
+    }
+
+    m_buildLVGThisFrame = true;
+
+    const uint32_t numVoxelsPerCascade = m_voxelGridDim.x * m_voxelGridDim.y * m_voxelGridDim.z;
+    const uint32_t numVoxels = numVoxelsPerCascade * LVG_NUM_CASCADES;
+    const float4x4a& view = App::GetCamera().GetCurrView();
+    auto changed = scene.ChangedEmissiveInstances();
+
+    // Voxels are placed relative to the camera, so camera movement invalidates the 
+    // whole grid. Same goes for emissive changes that aren't tied to particular 
+    // instances (e.g. first build).
+    if (!m_lvgValid || 
+        memcmp(&view, &m_lvgView, sizeof(view)) != 0 ||
+        (m_buildAliasTableThisFrame && changed.empty()))
+    {
+        m_lvgView = view;
+        m_lvgValid = true;
+        m_lvgRefreshOffset = 0;
+
+        return;
+    }
+
+    SmallVector<uint32_t, App::FrameAllocator> voxels;
+    SmallVector<uint64_t, App::FrameAllocator> added;
+    added.resize(CeilUnsignedIntDiv(numVoxels, 64u), 0);
+
+    auto addVoxel = [&voxels, &added](uint32_t v)
+        {
+            const uint64_t bit = 1llu << (v & 63);
+            if (added[v >> 6] & bit)
+                return;
+
+            added[v >> 6] |= bit;
+            voxels.push_back(v);
+        };
+
+    const v_float4x4 vView = load4x4(view);
+    const int dimX = (int)m_voxelGridDim.x;
+    const int dimY = (int)m_voxelGridDim.y;
+    const int dimZ = (int)m_voxelGridDim.z;
+
+    for (auto id : changed)
+    {
+        // Both the old and the new position of moved instances are affected
+        const v_AABB vBoxL(scene.GetAABB(id));
+        v_AABB vBoxW = transform(load4x3(scene.GetToWorld(id)), vBoxL);
+
+        if (auto prev = scene.GetPrevToWorld(id); prev)
+            vBoxW = unionAABB(vBoxW, transform(load4x3(*prev.value()), vBoxL));
+
+        const AABB boxV = store(transform(vView, vBoxW));
+        float3 lo = boxV.Center - boxV.Extents;
+        float3 hi = boxV.Center + boxV.Extents;
+        lo.y -= m_yOffset;
+        hi.y -= m_yOffset;
+
+        for (int c = 0; c < LVG_NUM_CASCADES; c++)
+        {
+            const float3 ext = m_voxelExtents * (float)(1 << c);
+            const uint32_t cascadeStart = c * numVoxelsPerCascade;
+
+            const int xBeg = Max(VoxelCoord(lo.x, ext.x, dimX, false) - LVG_DIRTY_MARGIN, 0);
+            const int xEnd = Min(VoxelCoord(hi.x, ext.x, dimX, false) + LVG_DIRTY_MARGIN, dimX - 1);
+            const int yBeg = Max(VoxelCoord(hi.y, ext.y, dimY, true) - LVG_DIRTY_MARGIN, 0);
+            const int yEnd = Min(VoxelCoord(lo.y, ext.y, dimY, true) + LVG_DIRTY_MARGIN, dimY - 1);
+            const int zBeg = Max(VoxelCoord(lo.z, ext.z, dimZ, false) - LVG_DIRTY_MARGIN, 0);
+            const int zEnd = Min(VoxelCoord(hi.z, ext.z, dimZ, false) + LVG_DIRTY_MARGIN, dimZ - 1);
+
+            // Empty ranges when the instance is outside this cascade
+            for (int z = zBeg; z <= zEnd; z++)
+            {
+                for (int y = yBeg; y <= yEnd; y++)
+                {
+                    for (int x = xBeg; x <= xEnd; x++)
+                        addVoxel(cascadeStart + z * dimX * dimY + y * dimX + x);
+                }
+            }
+        }
+    }
+
+    // Rest of the grid is refreshed over multiple frames, which also takes care of far 
+    // away voxels whose sample distribution depends on changed emissives
+    const uint32_t refreshSize = CeilUnsignedIntDiv(numVoxels, LVG_REFRESH_PERIOD);
+    for (uint32_t i = 0; i < refreshSize; i++)
+        addVoxel((m_lvgRefreshOffset + i) % numVoxels);
+
+    m_lvgRefreshOffset = (m_lvgRefreshOffset + refreshSize) % numVoxels;
+
+    // Not worth it when most of the grid has to be rebuilt anyway
+    if (voxels.size() >= numVoxels / 2)
+        return;
+
+    const uint32_t sizeInBytes = (uint32_t)(voxels.size() * sizeof(uint32_t));
+    m_lvgVoxelList = GpuMemory::AllocateFrameUpload(sizeInBytes, sizeof(uint32_t));
+    memcpy(m_lvgVoxelList.MappedMemory, voxels.data(), sizeInBytes);
+    m_lvgNumVoxelsToBuild = (uint32_t)voxels.size();
 }
 
-void PreLighting::ReloadBuildLVG()
+void PreLighting::UpdateTexAvgCache()
 {
-    const int i = (int)SHADER::BUILD_LIGHT_VOXEL_GRID;
-    m_psoLib.Reload(i, m_rootSigObj.Get(), "PreLighting\\BuildLightVoxelGrid.hlsl");
+    m_sampleEmissiveTexThisFrame = false;
+
+    // Emissive textures don't change after load, so when only emissive factor or strength
+    // have changed, existing texture averages are reused
+    if (m_triTexAvg.IsInitialized() && m_texAvgNumTris == m_currNumTris)
+        return;
+
+    m_texAvgNumTris = m_currNumTris;
+    const uint64_t key = App::GetScene().EmissiveCacheKey();
+    const uint32_t sizeInBytes = m_currNumTris * sizeof(float3);
+
+    Filesystem::Path path;
+    TexAvgCachePath(key, path);
+
+    const size_t fileSize = Filesystem::GetFileSize(path.Get());
+    if (fileSize == sizeof(TexAvgCacheHeader) + sizeInBytes)
+    {
+        TexAvgCacheHeader header;
+        Vector<uint8_t, SystemAllocator> data;
+        data.resize_uninitialized(sizeInBytes);
+
+        bool valid = Filesystem::ReadFileRange(path.Get(), &header, 0, sizeof(header));
+        valid = valid && header.Magic == TexAvgCacheHeader::MAGIC &&
+            header.Version == TexAvgCacheHeader::VERSION &&
+            header.Key == key &&
+            header.NumTriangles == m_currNumTris;
+        valid = valid && Filesystem::ReadFileRange(path.Get(), data.data(), sizeof(header), 
+            sizeInBytes);
+
+        if (valid)
+        {
+            m_triTexAvg = GpuMemory::GetDefaultHeapBufferAndInit("TriEmissiveTexAvg",
+                sizeInBytes,
+                true,
+                MemoryRegion{ .Data = data.data(), .SizeInBytes = sizeInBytes });
+
+            return;
+        }
+
+        LOG_UI_WARNING("Emissive texture average cache %s is stale or corrupted, ignoring.", 
+            path.Get());
+    }
+
+    m_triTexAvg = GpuMemory::GetDefaultHeapBuffer("TriEmissiveTexAvg",
+        sizeInBytes,
+        D3D12_RESOURCE_STATE_COMMON,
+        true);
+
+    m_sampleEmissiveTexThisFrame = true;
+    m_texAvgCacheKey = key;
 }
 
-//--------------------------------------------------------------------------------------
-// EmissiveTriangleAliasTable
-//--------------------------------------------------------------------------------------
+void PreLighting::TexAvgReadbackCallback(Span<uint8_t> data)
+{
+    const TexAvgCacheHeader header{ .Magic = TexAvgCacheHeader::MAGIC,
+        .Version = TexAvgCacheHeader::VERSION,
+        .Key = m_texAvgCacheKey,
+        .NumTriangles = data.size() / sizeof(float3) };
+
+    Vector<uint8_t, SystemAllocator> file;
+    file.resize(sizeof(header) + data.size());
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(header), data.data(), data.size());
 
-void EmissiveTriangleAliasTable::Update(ReadbackHeapBuffer* readback)
+    Filesystem::Path path;
+    TexAvgCachePath(m_texAvgCacheKey, path);
+    Filesystem::WriteToFile(path.Get(), file.data(), (uint32_t)file.size());
+
+    LOG_UI_INFO("Wrote emissive texture average cache %s (%llu MB).", path.Get(),
+        data.size() / (1024 * 1024));
+
+    m_texAvgCacheKey = 0;
+}
+
+void PreLighting::UpdateViewAliasTable()
 {
-    Assert(readback, "Readback buffer was NULL.");
-    m_readback = readback;
+    if (!m_doPresamplingThisFrame || !m_viewDependentPresampling)
+    {
+        if (m_viewAliasTable.IsInitialized())
+        {
+            m_viewPower.Reset();
+            m_viewAliasTable.Reset();
+            m_viewAliasTableScratch.Reset();
+        }
 
-    const size_t currBuffLen = m_aliasTable.IsInitialized() ? 
-        m_aliasTable.Desc().Width / sizeof(float) : 0;
-    m_currNumTris = (uint32_t)App::GetScene().NumEmissiveTriangles();
-    Assert(m_currNumTris, "redundant call.");
+        m_viewAliasTableValid = false;
+        return;
+    }
 
-    if (currBuffLen < m_currNumTris)
+    // Importance only changes when the camera or emissives do
+    const float4x4a& view = App::GetCamera().GetCurrView();
+    m_buildViewAliasTableThisFrame = !m_viewAliasTableValid ||
+        m_buildAliasTableThisFrame ||
+        App::GetScene().AreEmissivePositionsUpdated() ||
+        memcmp(&view, &m_viewAliasTableView, sizeof(view)) != 0;
+
+    if (!m_buildViewAliasTableThisFrame)
+        return;
+
+    m_viewAliasTableView = view;
+    m_viewAliasTableValid = true;
+
+    const size_t currLen = m_viewAliasTable.IsInitialized() ?
+        m_viewAliasTable.Desc().Width / sizeof(RT::EmissiveLumenAliasTableEntry) : 0;
+
+    // Unlike the global alias table, rebuilt as the camera moves, so buffers are kept around
+    if (currLen < m_currNumTris)
     {
-        m_aliasTable = GpuMemory::GetDefaultHeapBuffer("AliasTable",
+        m_viewPower = GpuMemory::GetDefaultHeapBuffer("ViewTriPower",
+            m_currNumTris * sizeof(float),
+            D3D12_RESOURCE_STATE_COMMON,
+            true);
+
+        m_viewAliasTable = GpuMemory::GetDefaultHeapBuffer("ViewAliasTable",
             m_currNumTris * sizeof(RT::EmissiveLumenAliasTableEntry),
             D3D12_RESOURCE_STATE_COMMON,
-            false);
+            true);
 
-        auto& r = App::GetRenderer().GetSharedShaderResources();
-        r.InsertOrAssignDefaultHeapBuffer(
-            GlobalResource::EMISSIVE_TRIANGLE_ALIAS_TABLE, m_aliasTable);
+        const uint32_t numBlocks = CeilUnsignedIntDiv(m_currNumTris, ALIAS_TABLE_GROUP_DIM_X);
+        m_viewAliasTableScratch = GpuMemory::GetDefaultHeapBuffer("ViewAliasTableScratch",
+            ALIAS_TABLE_SCRATCH_SIZE(m_currNumTris, numBlocks),
+            D3D12_RESOURCE_STATE_COMMON,
+            true);
     }
 }
 
-void EmissiveTriangleAliasTable::SetEmissiveTriPassHandle(RenderNodeHandle& emissiveTriHandle)
+void PreLighting::BuildAliasTable(ComputeCmdList& computeCmdList, Buffer& power, 
+    Buffer& aliasTable, Buffer& scratch, const char* name)
 {
-    Assert(emissiveTriHandle.IsValid(), "invalid handle.");
-    m_emissiveTriHandle = emissiveTriHandle.Val;
-}
+    Assert(scratch.IsInitialized(), "Alias table scratch buffer hasn't been initialized.");
+    auto& gpuTimer = App::GetRenderer().GetGpuTimer();
 
-void EmissiveTriangleAliasTable::Render(CommandList& cmdList)
-{
-    Assert(m_readback, "Readback buffer hasn't been set.");
-    Assert(cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_DIRECT ||
-        cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_COMPUTE, "Invalid downcast");
-    ComputeCmdList& computeCmdList = static_cast<ComputeCmdList&>(cmdList);
+    computeCmdList.PIXBeginEvent(name);
+    const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, name);
 
-    auto& renderer = App::GetRenderer();
+    const uint32_t numBlocks = CeilUnsignedIntDiv(m_currNumTris, ALIAS_TABLE_GROUP_DIM_X);
+    Assert(numBlocks <= D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION, "#blocks exceeded maximum allowed.");
+    const uint32_t numSweepThreads = CeilUnsignedIntDiv(m_currNumTris, ALIAS_TABLE_SWEEP_STEPS_PER_THREAD);
+    const uint32_t numSweepGroups = CeilUnsignedIntDiv(numSweepThreads, ALIAS_TABLE_SWEEP_GROUP_DIM_X);
 
-    m_fence = m_fence == UINT64_MAX ?
-        App::GetScene().GetRenderGraph()->GetCompletionFence(RenderNodeHandle(m_emissiveTriHandle)) :
-        m_fence;
-    Assert(m_fence != UINT64_MAX, "Invalid fence value.");
+    cbAliasTable cb;
+    cb.NumTriangles = m_currNumTris;
+    cb.NumBlocks = numBlocks;
 
-    // For 1st frame, wait until GPU finishes copying data to readback buffer. For subsequent
-    // frames, check the fence and defer to next frame if not ready.
-    if(App::GetTimer().GetTotalFrameCount() <= 1)
-        renderer.WaitForDirectQueueFenceCPU(m_fence);
-    else if (!renderer.IsDirectQueueFenceComplete(m_fence))
+    m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
+    m_rootSig.SetRootUAV(5, power.GpuVA());
+    m_rootSig.SetRootUAV(6, aliasTable.GpuVA());
+    m_rootSig.SetRootUAV(7, scratch.GpuVA());
+    m_rootSig.End(computeCmdList);
+
+    // Every pass reads what the previous ones wrote
+    auto uavBarriers = [&power, &aliasTable, &scratch, &computeCmdList]()
+        {
+            D3D12_BUFFER_BARRIER barriers[3];
+            ID3D12Resource* resources[3] = { power.Resource(), aliasTable.Resource(),
+                scratch.Resource() };
+
+            for (int i = 0; i < ZetaArrayLen(barriers); i++)
+            {
+                barriers[i] = BufferBarrier(resources[i],
+                    D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+                    D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+                    D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+                    D3D12_BARRIER_ACCESS_UNORDERED_ACCESS);
+            }
+
+            computeCmdList.ResourceBarrier(barriers, ZetaArrayLen(barriers));
+        };
+
+    const struct
     {
-        LOG_UI_INFO("Alias table - fence hasn't passed, returning...");
-        return;
+        SHADER Shader;
+        uint32_t NumGroups;
+    } passes[] = {
+        { SHADER::ALIAS_TABLE_SUM, 1 },
+        { SHADER::ALIAS_TABLE_CLASSIFY, numBlocks },
+        { SHADER::ALIAS_TABLE_SCAN, 1 },
+        { SHADER::ALIAS_TABLE_SCATTER, numBlocks },
+        { SHADER::ALIAS_TABLE_SWEEP, numSweepGroups }
+    };
+
+    for (auto& pass : passes)
+    {
+        uavBarriers();
+
+        computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)pass.Shader));
+        computeCmdList.Dispatch(pass.NumGroups, 1, 1);
     }
 
-    // Try to use frame allocator first, if it fails (allocation size exceeded per-frame max),
-    // use malloc instead
-    SmallVector<RT::EmissiveLumenAliasTableEntry, App::OneTimeFrameAllocatorWithFallback> table;
-    table.resize(m_currNumTris);
+    // Alias table is read by presampling and the lighting passes from here on
+    auto barrier = BufferBarrier(aliasTable.Resource(),
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+        D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+    computeCmdList.ResourceBarrier(barrier);
 
-    App::DeltaTimer timer;
-    timer.Start();
+    gpuTimer.EndQuery(computeCmdList, queryIdx);
+    computeCmdList.PIXEndEvent();
+}
 
+void PreLighting::BuildLightBVH(ComputeCmdList& computeCmdList)
+{
+    Assert(m_lightBVH.IsInitialized(), "Light BVH hasn't been initialized.");
+    Assert(!m_buildLightBVHThisFrame || m_lightBVHScratch.IsInitialized(), 
+        "Light BVH scratch buffer hasn't been initialized.");
+    auto& gpuTimer = App::GetRenderer().GetGpuTimer();
+
+    const bool build = m_buildLightBVHThisFrame;
+    const char* name = build ? "LightBVH" : "LightBVH_Refit";
+    computeCmdList.PIXBeginEvent(name);
+    const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, name);
+
+    const uint32_t numLeaves = m_lightBVHNumLeaves;
+    const uint32_t numKeys = numLeaves << m_lightBVHLog2ClusterSize;
+    const uint32_t numLeafGroups = CeilUnsignedIntDiv(numLeaves, LIGHT_BVH_GROUP_DIM_X);
+    const uint32_t numKeyGroups = CeilUnsignedIntDiv(numKeys, LIGHT_BVH_GROUP_DIM_X);
+    Assert(numKeyGroups <= D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION, "#blocks exceeded maximum allowed.");
+
+    cbLightBVH cb;
+    cb.NumTriangles = m_currNumTris;
+    cb.NumLeaves = numLeaves;
+    cb.NumKeys = numKeys;
+    cb.Log2ClusterSize = m_lightBVHLog2ClusterSize;
+    cb.SortK = 0;
+    cb.SortJ = 0;
+    cb.LevelStart = 0;
+    cb.LevelSize = 0;
+    cb.RefitOnly = !build;
+
+    m_rootSig.SetRootUAV(6, m_lightBVH.GpuVA());
+    m_rootSig.SetRootUAV(8, m_lightBVHTriToLeaf.GpuVA());
+
+    if (build)
     {
-        // Safe to map, related fence has passed
-        m_readback->Map();
+        m_rootSig.SetRootUAV(5, m_triPower.GpuVA());
+        m_rootSig.SetRootUAV(7, m_lightBVHScratch.GpuVA());
+    }
 
-        float* data = reinterpret_cast<float*>(m_readback->MappedMemory());
-        BuildAliasTable(MutableSpan(data, m_currNumTris), table);
+    // Every pass reads what the previous ones wrote
+    auto uavBarriers = [this, build, &computeCmdList]()
+        {
+            D3D12_BUFFER_BARRIER barriers[4];
+            ID3D12Resource* resources[4] = { m_lightBVH.Resource(), m_lightBVHTriToLeaf.Resource(),
+                build ? m_lightBVHScratch.Resource() : nullptr, build ? m_triPower.Resource() : nullptr };
+            const int numBarriers = build ? 4 : 1;
 
-        // Unmapping happens automatically when readback buffer is released
-        //m_readback->Unmap();
+            for (int i = 0; i < numBarriers; i++)
+            {
+                barriers[i] = BufferBarrier(resources[i],
+                    D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+                    D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+                    D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+                    D3D12_BARRIER_ACCESS_UNORDERED_ACCESS);
+            }
+
+            computeCmdList.ResourceBarrier(barriers, numBarriers);
+        };
+
+    auto dispatch = [this, &cb, &computeCmdList, &uavBarriers](SHADER shader, uint32_t numGroups)
+        {
+            uavBarriers();
+
+            m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
+            m_rootSig.End(computeCmdList);
+
+            computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)shader));
+            computeCmdList.Dispatch(numGroups, 1, 1);
+        };
+
+    // Sort triangles by Morton code of their centroids. Sorted order directly gives the 
+    // leaves (or clusters) of the (implicit) tree.
+    if (build)
+    {
+        dispatch(SHADER::LIGHT_BVH_BOUNDS, 1);
+        dispatch(SHADER::LIGHT_BVH_MORTON, numKeyGroups);
+
+        if (numKeys > 1)
+        {
+            // Bitonic sort -- steps that fit in a block are done in shared memory
+            const uint32_t numSortGroups = Max(numKeys / LIGHT_BVH_SORT_BLOCK_SIZE, 1u);
+            const uint32_t numStepGroups = CeilUnsignedIntDiv(numKeys / 2, LIGHT_BVH_GROUP_DIM_X);
+            dispatch(SHADER::LIGHT_BVH_SORT, numSortGroups);
+
+            for (uint32_t k = 2 * LIGHT_BVH_SORT_BLOCK_SIZE; k <= numKeys; k <<= 1)
+            {
+                cb.SortK = k;
+
+                for (uint32_t j = k >> 1; j >= LIGHT_BVH_SORT_BLOCK_SIZE; j >>= 1)
+                {
+                    cb.SortJ = j;
+                    dispatch(SHADER::LIGHT_BVH_SORT_STEP, numStepGroups);
+                }
+
+                dispatch(SHADER::LIGHT_BVH_SORT, numSortGroups);
+            }
+        }
     }
 
-    timer.End();
-    LOG_UI_INFO("Alias table - computation took %u [us].", (uint32_t)timer.DeltaMicro());
+    dispatch(SHADER::LIGHT_BVH_LEAVES, numLeafGroups);
 
-    auto& gpuTimer = renderer.GetGpuTimer();
-    const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "UploadAliasTable");
-    computeCmdList.PIXBeginEvent("UploadAliasTable");
-
-    // Schedule a copy
-    const uint32_t sizeInBytes = sizeof(RT::EmissiveLumenAliasTableEntry) * m_currNumTris;
-    m_aliasTableUpload = GpuMemory::GetUploadHeapBuffer(sizeInBytes);
-    m_aliasTableUpload.Copy(0, sizeInBytes, table.data());
-    computeCmdList.CopyBufferRegion(m_aliasTable.Resource(),
-        0,
-        m_aliasTableUpload.Resource(),
-        m_aliasTableUpload.Offset(),
-        sizeInBytes);
-
-    computeCmdList.ResourceBarrier(m_aliasTable.Resource(),
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    // Internal nodes, one level at a time from the bottom up
+    for (uint32_t levelSize = numLeaves >> 1; levelSize > 0; levelSize >>= 1)
+    {
+        cb.LevelStart = levelSize - 1;
+        cb.LevelSize = levelSize;
+        dispatch(SHADER::LIGHT_BVH_REFIT, CeilUnsignedIntDiv(levelSize, LIGHT_BVH_GROUP_DIM_X));
+    }
+
+    // Light BVH is read by the lighting passes from here on
+    D3D12_BUFFER_BARRIER barriers[2];
+    barriers[0] = BufferBarrier(m_lightBVH.Resource(),
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+        D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+    barriers[1] = BufferBarrier(m_lightBVHTriToLeaf.Resource(),
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+        D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+    computeCmdList.ResourceBarrier(barriers, build ? 2 : 1);
 
     gpuTimer.EndQuery(computeCmdList, queryIdx);
-    cmdList.PIXEndEvent();
-
-    // Even though at this point this command list hasn't been submitted yet (only recorded),
-    // it's safe to release the buffers here -- this is because resource deallocation
-    // and signalling the related fence happens at the end of frame when all command 
-    // lists have been submitted
-    m_releaseDlg();
-    m_fence = UINT64_MAX;
+    computeCmdList.PIXEndEvent();
+}
+
+void PreLighting::ReloadBuildLVG()
+{
+    const int i = (int)SHADER::BUILD_LIGHT_VOXEL_GRID;
+    m_psoLib.Reload(i, m_rootSigObj.Get(), "PreLighting\\BuildLightVoxelGrid.hlsl");
+    m_lvgValid = false;
 }
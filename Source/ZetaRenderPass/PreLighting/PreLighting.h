@@ -7,7 +7,7 @@
 namespace ZetaRay::Core
 {
     class CommandList;
-    struct RenderNodeHandle;
+    class ComputeCmdList;
 }
 
 namespace ZetaRay::Support
@@ -19,7 +19,21 @@ namespace ZetaRay::RenderPass
 {
     enum class PRE_LIGHTING_SHADER
     {
+        UPDATE_EMISSIVE_POSITIONS,
         ESTIMATE_TRIANGLE_POWER,
+        EMISSIVE_POWER_FROM_TEX_AVG,
+        ALIAS_TABLE_SUM,
+        ALIAS_TABLE_CLASSIFY,
+        ALIAS_TABLE_SCAN,
+        ALIAS_TABLE_SCATTER,
+        ALIAS_TABLE_SWEEP,
+        LIGHT_BVH_BOUNDS,
+        LIGHT_BVH_MORTON,
+        LIGHT_BVH_SORT,
+        LIGHT_BVH_SORT_STEP,
+        LIGHT_BVH_LEAVES,
+        LIGHT_BVH_REFIT,
+        VIEW_EMISSIVE_IMPORTANCE,
         PRESAMPLING,
         BUILD_LIGHT_VOXEL_GRID,
         COUNT
@@ -46,84 +60,123 @@ namespace ZetaRay::RenderPass
             m_voxelExtents = extents;
             m_yOffset = offset_y;
         }
-        const Core::GpuMemory::Buffer& GetTriEmissivePowerBuffer() { return m_triPower; }
+        void SetLightBVH(bool enabled) { m_useLightBVH = enabled; }
+        // Leaves of the light BVH are clusters of triangles rather than single triangles
+        void SetLightBVHClusters(bool enabled) { m_lightBVHClusters = enabled; }
+        // Presampled sets favor emissives that are close to the view
+        void SetViewDependentPresampling(bool enabled) { m_viewDependentPresampling = enabled; }
+        // Built on the GPU in the same frame that emissives change
+        const Core::GpuMemory::Buffer& GetEmissiveAliasTable() { return m_aliasTable; }
         const Core::GpuMemory::Buffer& GePresampledSets() { return m_sampleSets; }
         const Core::GpuMemory::Buffer& GetLightVoxelGrid() { return m_lvg; }
-        Core::GpuMemory::ReadbackHeapBuffer& GetLumenReadbackBuffer() { return m_readback; }
-        // Releasing the power buffer and its readback buffer should happen after the alias table 
-        // has been calculated. Delegate that to code that does that calculation.
-        auto GetReleaseBuffersDlg() { return fastdelegate::MakeDelegate(this, &PreLighting::ReleaseTriPowerBufferAndReadback); };
+        // Built on the GPU when emissives change or the light BVH is enabled and refit 
+        // when emissive positions change
+        const Core::GpuMemory::Buffer& GetLightBVH() { return m_lightBVH; }
+        const Core::GpuMemory::Buffer& GetLightBVHTriToLeaf() { return m_lightBVHTriToLeaf; }
+        bool IsLightBVHUpdated() const { return m_buildLightBVHThisFrame || m_refitLightBVHThisFrame; }
+        // Triangles of moved emissive instances are transformed in place at the start of 
+        // the pass
+        bool AreEmissivePositionsUpdated() const { return m_numEmissivePosUpdates > 0; }
+        // Cluster size of the light BVH that's used this frame, zero when leaves are triangles
+        uint32_t GetLightBVHLog2ClusterSize() const { return m_useLightBVH ? m_lightBVHLog2ClusterSize : 0; }
 
         void Update();
         void Render(Core::CommandList& cmdList);
 
     private:
         static constexpr int NUM_CBV = 1;
-        static constexpr int NUM_SRV = 3;
-        static constexpr int NUM_UAV = 1;
+        static constexpr int NUM_SRV = 5;
+        static constexpr int NUM_UAV = 4;
         static constexpr int NUM_GLOBS = 3;
         static constexpr int NUM_CONSTS = (int)Math::Max(sizeof(cbPresampling) / sizeof(DWORD), 
-            Math::Max(sizeof(cbLVG) / sizeof(DWORD), sizeof(cbCurvature) / sizeof(DWORD)));
+            Math::Max(sizeof(cbLVG) / sizeof(DWORD), Math::Max(sizeof(cbCurvature) / sizeof(DWORD),
+            Math::Max(sizeof(cbAliasTable) / sizeof(DWORD), sizeof(cbLightBVH) / sizeof(DWORD)))));
         using SHADER = PRE_LIGHTING_SHADER;
+        // Voxels within this many voxels of a changed emissive instance are rebuilt
+        static constexpr int LVG_DIRTY_MARGIN = 1;
+        // Whole grid is refreshed over this many frames even when nothing changes
+        static constexpr uint32_t LVG_REFRESH_PERIOD = 8;
 
         inline static constexpr const char* COMPILED_CS[(int)SHADER::COUNT] = {
+            "UpdateEmissivePositions_cs.cso",
             "EstimateTriEmissivePower_cs.cso",
+            "EmissivePowerFromTexAvg_cs.cso",
+            "AliasTable_Sum_cs.cso",
+            "AliasTable_Classify_cs.cso",
+            "AliasTable_Scan_cs.cso",
+            "AliasTable_Scatter_cs.cso",
+            "AliasTable_Sweep_cs.cso",
+            "LightBVH_Bounds_cs.cso",
+            "LightBVH_Morton_cs.cso",
+            "LightBVH_Sort_cs.cso",
+            "LightBVH_SortStep_cs.cso",
+            "LightBVH_Leaves_cs.cso",
+            "LightBVH_Refit_cs.cso",
+            "ViewEmissiveImportance_cs.cso",
             "PresampleEmissives_cs.cso",
             "BuildLightVoxelGrid_cs.cso"
         };
 
+        void UpdateTexAvgCache();
+        void TexAvgReadbackCallback(Util::Span<uint8_t> data);
         void ToggleLVG();
-        void ReleaseTriPowerBufferAndReadback();
+        void UpdateLVG();
+        void UpdateViewAliasTable();
+        void BuildAliasTable(Core::ComputeCmdList& computeCmdList, Core::GpuMemory::Buffer& power,
+            Core::GpuMemory::Buffer& aliasTable, Core::GpuMemory::Buffer& scratch, const char* name);
+        void BuildLightBVH(Core::ComputeCmdList& computeCmdList);
         void ReloadBuildLVG();
 
         Core::GpuMemory::Buffer m_halton;
         Core::GpuMemory::Buffer m_triPower;
-        Core::GpuMemory::ReadbackHeapBuffer m_readback;
+        // Average of the emissive texture over each triangle -- kept around so that 
+        // changes to emissive factor or strength don't need any texture sampling
+        Core::GpuMemory::Buffer m_triTexAvg;
+        Core::GpuMemory::Buffer m_aliasTable;
+        Core::GpuMemory::Buffer m_aliasTableScratch;
         Core::GpuMemory::Buffer m_sampleSets;
+        Core::GpuMemory::Buffer m_viewPower;
+        Core::GpuMemory::Buffer m_viewAliasTable;
+        Core::GpuMemory::Buffer m_viewAliasTableScratch;
         Core::GpuMemory::Buffer m_lvg;
+        Core::GpuMemory::FrameUploadAllocation m_lvgVoxelList;
+        Core::GpuMemory::FrameUploadAllocation m_emissivePosUpdates;
+        Core::GpuMemory::Buffer m_lightBVH;
+        Core::GpuMemory::Buffer m_lightBVHTriToLeaf;
+        Core::GpuMemory::Buffer m_lightBVHScratch;
         uint32_t m_currNumTris = 0;
+        uint32_t m_numEmissivePosUpdates = 0;
+        uint32_t m_texAvgNumTris = 0;
+        // Nonzero while the texture averages are waiting to be written to the disk cache
+        uint64_t m_texAvgCacheKey = 0;
+        uint32_t m_lightBVHNumLeaves = 0;
+        uint32_t m_lightBVHLog2ClusterSize = 0;
         uint32_t m_minNumLightsForPresampling = UINT32_MAX;
         uint32_t m_numSampleSets = 0;
         uint32_t m_sampleSetSize = 0;
         Math::uint3 m_voxelGridDim;
         Math::float3 m_voxelExtents;
         float m_yOffset = 0.0;
+        // View matrix at the time of last full LVG build
+        Math::float4x4a m_lvgView;
+        // View matrix at the time of last view-dependent alias table build
+        Math::float4x4a m_viewAliasTableView;
+        // Zero rebuilds the whole grid
+        uint32_t m_lvgNumVoxelsToBuild = 0;
+        uint32_t m_lvgRefreshOffset = 0;
         bool m_estimatePowerThisFrame;
+        bool m_sampleEmissiveTexThisFrame = false;
         bool m_doPresamplingThisFrame;
         bool m_buildLVGThisFrame = false;
         bool m_useLVG = false;
-    };
-
-    struct EmissiveTriangleAliasTable
-    {
-        enum class SHADER_OUT_RES
-        {
-            ALIAS_TABLE,
-            COUNT
-        };
-
-        EmissiveTriangleAliasTable() = default;
-        ~EmissiveTriangleAliasTable() = default;
-
-        ZetaInline Core::GpuMemory::Buffer& GetOutput(SHADER_OUT_RES i)
-        {
-            Assert((int)i < (int)SHADER_OUT_RES::COUNT, "out-of-bound access.");
-            return m_aliasTable;
-        }
-        ZetaInline void SetReleaseBuffersDlg(fastdelegate::FastDelegate0<> dlg) { m_releaseDlg = dlg; }
-        ZetaInline bool HasPendingRender() { return m_fence != UINT64_MAX; }
-
-        void Update(Core::GpuMemory::ReadbackHeapBuffer* readback);
-        void SetEmissiveTriPassHandle(Core::RenderNodeHandle& emissiveTriHandle);
-        void Render(Core::CommandList& cmdList);
-
-    private:
-        Core::GpuMemory::Buffer m_aliasTable;
-        Core::GpuMemory::UploadHeapBuffer m_aliasTableUpload;
-        Core::GpuMemory::ReadbackHeapBuffer* m_readback = nullptr;
-        fastdelegate::FastDelegate0<> m_releaseDlg;
-        uint32_t m_currNumTris = 0;
-        int m_emissiveTriHandle = -1;
-        uint64_t m_fence = UINT64_MAX;
+        bool m_lvgValid = false;
+        bool m_buildAliasTableThisFrame;
+        bool m_buildLightBVHThisFrame = false;
+        bool m_refitLightBVHThisFrame = false;
+        bool m_useLightBVH = false;
+        bool m_lightBVHClusters = false;
+        bool m_viewDependentPresampling = false;
+        bool m_viewAliasTableValid = false;
+        bool m_buildViewAliasTableThisFrame = false;
     };
 }
\ No newline at end of file
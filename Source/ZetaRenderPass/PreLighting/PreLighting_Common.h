@@ -11,11 +11,96 @@
 
 #define PRESAMPLE_EMISSIVE_GROUP_DIM_X 64u
 
-#define NUM_SAMPLES_PER_VOXEL 64
+// Triangles of moved emissive instances are transformed on the GPU, one group per instance
+#define EMISSIVE_POS_UPDATE_GROUP_DIM_X 64u
+
+// View-dependent presampling -- probabilities from the global alias table are scaled by
+// per-triangle importance relative to the camera and a second alias table is built from
+// the results
+#define VIEW_IMPORTANCE_GROUP_DIM_X 256u
+// Fraction of presampled lights that are still drawn from the global alias table, so
+// that off-screen and occluded emissives remain reachable
+#define VIEW_IMPORTANCE_GLOBAL_FRACTION 0.25f
+// Weight of emissives that are far outside the view frustum
+#define VIEW_IMPORTANCE_OUTSIDE_WEIGHT 0.05f
+// Falloff rate of the weight with (NDC) distance from the frustum
+#define VIEW_IMPORTANCE_FRUSTUM_FALLOFF 4.0f
+// Weight of emissives that are behind previous frame's depth buffer
+#define VIEW_IMPORTANCE_OCCLUDED_WEIGHT 0.25f
+#define VIEW_IMPORTANCE_DEPTH_TOLERANCE 0.05f
+// Distance from the camera after which weight falls off with inverse squared distance
+#define VIEW_IMPORTANCE_FALLOFF_DIST 10.0f
+
+// Alias table is built on the GPU from the estimated triangle powers
+#define ALIAS_TABLE_GROUP_DIM_X 256u
+#define ALIAS_TABLE_WAVE_LEN 32
+#define ALIAS_TABLE_SCAN_GROUP_DIM_X 1024u
+#define ALIAS_TABLE_SWEEP_GROUP_DIM_X 64u
+#define ALIAS_TABLE_SWEEP_STEPS_PER_THREAD 32u
+// Deficits and surpluses are accumulated as 64-bit fixed point with 24 fractional bits
+#define ALIAS_TABLE_FIXED_POINT_ONE (1u << 24)
+
+// Scratch buffer layout:
+//  - Header: total power, number of light items, number of heavy items
+//  - Per block of ALIAS_TABLE_GROUP_DIM_X items: number of light items, deficit sum 
+//    and surplus sum (exclusive prefix sums after the scan pass)
+//  - Indices of light items in original order, followed by heavy items
+//  - Exclusive prefix sums of deficits of light items (plus the total), followed by
+//    the same for surpluses of heavy items
+#define ALIAS_TABLE_BLOCK_STATS_OFFSET 16u
+#define ALIAS_TABLE_BLOCK_STATS_STRIDE 24u
+#define ALIAS_TABLE_INDEX_OFFSET(numBlocks) (ALIAS_TABLE_BLOCK_STATS_OFFSET + ALIAS_TABLE_BLOCK_STATS_STRIDE * (numBlocks))
+#define ALIAS_TABLE_PREFIX_OFFSET(numTris, numBlocks) ((ALIAS_TABLE_INDEX_OFFSET(numBlocks) + 4u * (numTris) + 7u) & ~7u)
+#define ALIAS_TABLE_SCRATCH_SIZE(numTris, numBlocks) (ALIAS_TABLE_PREFIX_OFFSET(numTris, numBlocks) + 8u * ((numTris) + 2u))
+
+// Light BVH is built on the GPU from the estimated triangle powers and refit when emissive
+// positions change
+#define LIGHT_BVH_GROUP_DIM_X 256u
+#define LIGHT_BVH_BOUNDS_GROUP_DIM_X 1024u
+#define LIGHT_BVH_WAVE_LEN 32
+#define LIGHT_BVH_SORT_GROUP_DIM_X 1024u
+// Every sort group sorts two keys per thread in shared memory
+#define LIGHT_BVH_SORT_BLOCK_SIZE (2u * LIGHT_BVH_SORT_GROUP_DIM_X)
+// In clustered mode, every leaf holds this many consecutive (in Morton order) triangles
+#define LIGHT_BVH_LOG2_CLUSTER_SIZE 3
+
+// Scratch buffer layout:
+//  - Bounds of triangle centroids (min followed by max), padded to 32 bytes
+//  - Per key (one per leaf or one per cluster member): Morton code of triangle centroid 
+//    and triangle index
+#define LIGHT_BVH_KEYS_OFFSET 32u
+#define LIGHT_BVH_SCRATCH_SIZE(numKeys) (LIGHT_BVH_KEYS_OFFSET + 8u * (numKeys))
 
 struct cbPresampling
 {
     uint32_t NumTotalSamples;
+    // Draw from a mixture of the global and the view-dependent alias tables
+    uint32_t ViewDependent;
+};
+
+struct cbAliasTable
+{
+    uint32_t NumTriangles;
+    uint32_t NumBlocks;
+};
+
+struct cbLightBVH
+{
+    uint32_t NumTriangles;
+    uint32_t NumLeaves;
+    // Number of sorted keys, NumLeaves << Log2ClusterSize
+    uint32_t NumKeys;
+    // Zero when every leaf is a single triangle
+    uint32_t Log2ClusterSize;
+    // Bitonic sort -- size of bitonic sequences that are being merged and distance
+    // between compared keys. K = 0 sorts each block independently.
+    uint32_t SortK;
+    uint32_t SortJ;
+    // Refit -- range of nodes at the level that's being updated
+    uint32_t LevelStart;
+    uint32_t LevelSize;
+    // Leaves keep their triangle and flux, only the bounds and normal cone are updated
+    uint32_t RefitOnly;
 };
 
 struct cbCurvature
@@ -33,6 +118,8 @@ struct cbLVG
     uint32_t GridDim_y;
     uint32_t GridDim_z;
     uint32_t NumTotalSamples;
+    // When nonzero, only voxels in the voxel list are rebuilt
+    uint32_t NumVoxels;
 };
 
 #endif
\ No newline at end of file
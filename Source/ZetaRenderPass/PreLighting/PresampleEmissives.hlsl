@@ -10,6 +10,7 @@ ConstantBuffer<cbPresampling> g_local : register(b0);
 ConstantBuffer<cbFrameConstants> g_frame : register(b1);
 StructuredBuffer<RT::EmissiveTriangle> g_emissives : register(t0);
 StructuredBuffer<RT::EmissiveLumenAliasTableEntry> g_aliasTable : register(t1);
+StructuredBuffer<RT::EmissiveLumenAliasTableEntry> g_viewAliasTable : register(t4);
 RWStructuredBuffer<RT::PresampledEmissiveTriangle> g_sampleSets : register(u0);
 
 //--------------------------------------------------------------------------------------
@@ -24,8 +25,36 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint Gidx :
 
     RNG rng = RNG::Init(DTid.x, g_frame.FrameNum);
 
-    Light::AliasTableSample entry = Light::AliasTableSample::get(g_aliasTable, 
-        g_frame.NumEmissiveTriangles, rng);
+    Light::AliasTableSample entry;
+    float sourcePdf;
+    float pdf;
+
+    // Defensive mixture of the global and the view-dependent distributions. Lighting 
+    // passes use the global one for MIS with BSDF sampling (sourcePdf).
+    if (g_local.ViewDependent)
+    {
+        if (rng.Uniform() < VIEW_IMPORTANCE_GLOBAL_FRACTION)
+        {
+            entry = Light::AliasTableSample::get(g_aliasTable, g_frame.NumEmissiveTriangles, rng);
+            sourcePdf = entry.pdf;
+            pdf = g_viewAliasTable[entry.idx].CachedP_Orig;
+        }
+        else
+        {
+            entry = Light::AliasTableSample::get(g_viewAliasTable, g_frame.NumEmissiveTriangles, rng);
+            sourcePdf = g_aliasTable[entry.idx].CachedP_Orig;
+            pdf = entry.pdf;
+        }
+
+        pdf = VIEW_IMPORTANCE_GLOBAL_FRACTION * sourcePdf + (1.0f - VIEW_IMPORTANCE_GLOBAL_FRACTION) * pdf;
+    }
+    else
+    {
+        entry = Light::AliasTableSample::get(g_aliasTable, g_frame.NumEmissiveTriangles, rng);
+        sourcePdf = entry.pdf;
+        pdf = entry.pdf;
+    }
+
     RT::EmissiveTriangle tri = g_emissives[entry.idx];
     Light::EmissiveTriSample lightSample = Light::EmissiveTriSample::get(/*unused*/ 0, tri, rng, false);
 
@@ -35,11 +64,12 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint Gidx :
     s.pos = lightSample.pos;
     s.normal = Math::EncodeOct32(lightSample.normal);
     s.le = half3(le);
-    s.bary = Math::EncodeAsUNorm2(lightSample.bary);;
+    s.bary = Math::EncodeAsUNorm2(lightSample.bary);
     s.twoSided = tri.IsDoubleSided();
     s.idx = entry.idx;
     s.ID = tri.ID;
-    s.pdf = entry.pdf * lightSample.pdf;
+    s.pdf = pdf * lightSample.pdf;
+    s.sourcePdf = sourcePdf * lightSample.pdf;
 
     g_sampleSets[DTid.x] = s;
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "PreLighting_Common.h"
+#include "../Common/Sampling.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+StructuredBuffer<RT::EmissiveTriangleObjSpace> g_objSpaceTris : register(t2);
+StructuredBuffer<RT::EmissivePositionUpdate> g_updates : register(t3);
+RWStructuredBuffer<RT::EmissiveTriangle> g_emissives : register(u0);
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+float3 TransformPoint(float3 M[4], float3 p)
+{
+    return mad(p.x, M[0], mad(p.y, M[1], mad(p.z, M[2], M[3])));
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// One group per instance. Only the position and ID fields are written, the rest don't 
+// change with the transform.
+[numthreads(EMISSIVE_POS_UPDATE_GROUP_DIM_X, 1, 1)]
+void main(uint3 Gid : SV_GroupID, uint GIndex : SV_GroupIndex)
+{
+    const RT::EmissivePositionUpdate u = g_updates[Gid.x];
+
+    for (uint t = GIndex; t < u.NumTriangles; t += EMISSIVE_POS_UPDATE_GROUP_DIM_X)
+    {
+        const uint triIdx = u.BaseTriOffset + t;
+        const RT::EmissiveTriangleObjSpace objTri = g_objSpaceTris[triIdx];
+
+        // Same as EmissiveTriangle::DecodeVertices()
+        float3 v0 = objTri.Vtx0;
+        float3 v1 = mad(Math::DecodeOct32(objTri.V0V1), objTri.EdgeLengths.x, v0);
+        float3 v2 = mad(Math::DecodeOct32(objTri.V0V2), objTri.EdgeLengths.y, v0);
+
+        v0 = TransformPoint(u.M, v0);
+        v1 = TransformPoint(u.M, v1);
+        v2 = TransformPoint(u.M, v2);
+
+        g_emissives[triIdx].Vtx0 = v0;
+
+        // Same as EmissiveTriangle::StoreVertices()
+#if ENCODE_EMISSIVE_POS == 1
+        const float3 e0 = v1 - v0;
+        const float3 e1 = v2 - v0;
+        const float2 edgeLengths = float2(length(e0), length(e1));
+
+        g_emissives[triIdx].V0V1 = Math::EncodeOct32(e0 / edgeLengths.x);
+        g_emissives[triIdx].V0V2 = Math::EncodeOct32(e1 / edgeLengths.y);
+        g_emissives[triIdx].EdgeLengths = half2(edgeLengths);
+#else
+        g_emissives[triIdx].Vtx1 = v1;
+        g_emissives[triIdx].Vtx2 = v2;
+#endif
+
+        // Same as SceneCore::UpdateEmissivePositions()
+        g_emissives[triIdx].ID = RNG::PCG3d(uint3(u.RtInstanceID, 0, objTri.PrimIdx)).x;
+    }
+}
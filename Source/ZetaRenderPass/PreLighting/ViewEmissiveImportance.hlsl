@@ -0,0 +1,100 @@
+#include "PreLighting_Common.h"
+#include "../Common/FrameConstants.h"
+#include "../Common/GBuffers.hlsli"
+#include "../Common/LightSource.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbFrameConstants> g_frame : register(b1);
+StructuredBuffer<RT::EmissiveTriangle> g_emissives : register(t0);
+StructuredBuffer<RT::EmissiveLumenAliasTableEntry> g_aliasTable : register(t1);
+RWStructuredBuffer<float> g_power : register(u0);
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// Emissives just outside the view can still light visible surfaces, so rather than
+// rejecting them outright, weight falls off with distance (in NDC units) of their
+// bounding sphere from the frustum
+float FrustumWeight(float3 posV, float radius)
+{
+    if(posV.z + radius <= 0)
+        return VIEW_IMPORTANCE_OUTSIDE_WEIGHT;
+
+    const float z = max(posV.z, radius);
+    const float2 scale = float2(1.0f / g_frame.AspectRatio, 1.0f) / (z * g_frame.TanHalfFOV);
+    const float2 ndc = posV.xy * scale;
+    const float2 excess = max(abs(ndc) - 1.0f - radius * scale, 0.0f);
+    const float e = max(excess.x, excess.y);
+
+    return lerp(VIEW_IMPORTANCE_OUTSIDE_WEIGHT, 1.0f, exp(-VIEW_IMPORTANCE_FRUSTUM_FALLOFF * e));
+}
+
+float DistanceWeight(float dist, float radius)
+{
+    const float d = max(dist - radius, 0.0f) / VIEW_IMPORTANCE_FALLOFF_DIST;
+    return 1.0f / max(d * d, 1.0f);
+}
+
+// Tests the centroid against previous frame's depth buffer. Single tap, so it only
+// catches emissives that are hidden behind large occluders (e.g. inside other
+// buildings).
+float OcclusionWeight(float3 pos, float radius)
+{
+    const float3 posV = mul(g_frame.PrevView, float4(pos, 1.0f));
+    if(posV.z <= radius)
+        return 1.0f;
+
+    float2 ndc = posV.xy / (posV.z * g_frame.TanHalfFOV);
+    ndc.x /= g_frame.AspectRatio;
+
+    // Nothing to test against
+    if(any(abs(ndc) > 1.0f))
+        return 1.0f;
+
+    const float2 uv = Math::UVFromNDC(ndc);
+    const uint2 renderDim = uint2(g_frame.RenderWidth, g_frame.RenderHeight);
+    const uint2 pixel = min((uint2)(uv * renderDim), renderDim - 1);
+
+    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.PrevGBufferDescHeapOffset +
+        GBUFFER_OFFSET::DEPTH];
+    const float z_occluder = g_depth[pixel];
+
+    return posV.z - radius > z_occluder * (1.0f + VIEW_IMPORTANCE_DEPTH_TOLERANCE) ?
+        VIEW_IMPORTANCE_OCCLUDED_WEIGHT : 1.0f;
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+// Scales probability of every emissive triangle in the global alias table by its
+// importance relative to the camera. Alias table that's built from the results is only
+// used for presampling.
+[numthreads(VIEW_IMPORTANCE_GROUP_DIM_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_frame.NumEmissiveTriangles)
+        return;
+
+    const RT::EmissiveTriangle tri = g_emissives[DTid.x];
+    const float3 vtx0 = tri.Vtx0;
+    const float3 vtx1 = Light::DecodeEmissiveTriV1(tri);
+    const float3 vtx2 = Light::DecodeEmissiveTriV2(tri);
+
+    const float3 centroid = (vtx0 + vtx1 + vtx2) / 3.0f;
+    const float3 d0 = vtx0 - centroid;
+    const float3 d1 = vtx1 - centroid;
+    const float3 d2 = vtx2 - centroid;
+    const float radius = sqrt(max(dot(d0, d0), max(dot(d1, d1), dot(d2, d2))));
+
+    const float3 posV = mul(g_frame.CurrView, float4(centroid, 1.0f));
+    float w = FrustumWeight(posV, radius);
+    w *= DistanceWeight(length(posV), radius);
+    w *= OcclusionWeight(centroid, radius);
+
+    g_power[DTid.x] = g_aliasTable[DTid.x].CachedP_Orig * w;
+}
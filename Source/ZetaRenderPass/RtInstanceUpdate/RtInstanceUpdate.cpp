@@ -0,0 +1,84 @@
+#include "RtInstanceUpdate.h"
+#include <Core/CommandList.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::RenderPass;
+using namespace ZetaRay::Math;
+
+//--------------------------------------------------------------------------------------
+// RtInstanceUpdate
+//--------------------------------------------------------------------------------------
+
+RtInstanceUpdate::RtInstanceUpdate()
+    : RenderPassBase(NUM_CBV, NUM_SRV, NUM_UAV, NUM_GLOBS, NUM_CONSTS)
+{
+    // root constants
+    m_rootSig.InitAsConstants(0, NUM_CONSTS, 0);
+
+    // transform updates
+    m_rootSig.InitAsBufferSRV(1, 0, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        nullptr,
+        true);
+
+    // TLAS instances
+    m_rootSig.InitAsBufferUAV(2, 0, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE,
+        nullptr,
+        true);
+
+    // frame mesh instances
+    m_rootSig.InitAsBufferUAV(3, 1, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE,
+        nullptr,
+        true);
+}
+
+void RtInstanceUpdate::InitPSOs()
+{
+    constexpr D3D12_ROOT_SIGNATURE_FLAGS flags =
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_MESH_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+    RenderPassBase::InitRenderPass("RtInstanceUpdate", flags);
+
+    for (int i = 0; i < (int)SHADER::COUNT; i++)
+        m_psoLib.EnqueueComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
+}
+
+void RtInstanceUpdate::Init()
+{
+    InitPSOs();
+}
+
+void RtInstanceUpdate::Dispatch(ComputeCmdList& cmdList, const RT::InstanceTransformUpdateArgs& args)
+{
+    Assert(args.NumUpdates, "Redundant call.");
+
+    const uint32_t dispatchDimX = CeilUnsignedIntDiv(args.NumUpdates, RT_INSTANCE_UPDATE_GROUP_DIM_X);
+    Assert(dispatchDimX <= D3D12_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION, "#blocks exceeded maximum allowed.");
+
+    cmdList.PIXBeginEvent("RtInstanceUpdate");
+
+    cmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
+
+    cbInstanceUpdate cb;
+    cb.NumUpdates = args.NumUpdates;
+
+    m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
+    m_rootSig.SetRootSRV(1, args.Updates);
+    m_rootSig.SetRootUAV(2, args.TLASInstances->GetGPUVirtualAddress());
+    m_rootSig.SetRootUAV(3, args.MeshInstances->GetGPUVirtualAddress());
+    m_rootSig.End(cmdList);
+
+    cmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::UPDATE));
+    cmdList.Dispatch(dispatchDimX, 1, 1);
+
+    cmdList.PIXEndEvent();
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../RenderPass.h"
+#include <RayTracing/RtAccelerationStructure.h>
+#include "RtInstanceUpdate_Common.h"
+
+namespace ZetaRay::Core
+{
+    class ComputeCmdList;
+}
+
+namespace ZetaRay::RenderPass
+{
+    enum class RT_INSTANCE_UPDATE_SHADER
+    {
+        UPDATE,
+        COUNT
+    };
+
+    // Writes new world transforms to TLAS instance descs and frame mesh instances. Called
+    // by TLAS while recording the AS build, see RT::TLAS::SetInstanceTransformUpdateDlg().
+    struct RtInstanceUpdate final : public RenderPassBase<(int)RT_INSTANCE_UPDATE_SHADER::COUNT>
+    {
+        RtInstanceUpdate();
+        ~RtInstanceUpdate() = default;
+
+        void InitPSOs();
+        void Init();
+        auto GetInstanceTransformUpdateDlg() { return fastdelegate::MakeDelegate(this, &RtInstanceUpdate::Dispatch); }
+
+    private:
+        static constexpr int NUM_CBV = 0;
+        static constexpr int NUM_SRV = 1;
+        static constexpr int NUM_UAV = 2;
+        static constexpr int NUM_GLOBS = 0;
+        static constexpr int NUM_CONSTS = (int)(sizeof(cbInstanceUpdate) / sizeof(DWORD));
+        using SHADER = RT_INSTANCE_UPDATE_SHADER;
+
+        inline static constexpr const char* COMPILED_CS[(int)SHADER::COUNT] = {
+            "RtInstanceUpdate_cs.cso"
+        };
+
+        void Dispatch(Core::ComputeCmdList& cmdList, const RT::InstanceTransformUpdateArgs& args);
+    };
+}
\ No newline at end of file
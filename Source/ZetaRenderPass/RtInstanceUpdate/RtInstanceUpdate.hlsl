@@ -0,0 +1,100 @@
+#include "RtInstanceUpdate_Common.h"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbInstanceUpdate> g_local : register(b0);
+StructuredBuffer<RT::InstanceTransformUpdate> g_updates : register(t0);
+RWByteAddressBuffer g_tlasInstances : register(u0);
+RWStructuredBuffer<RT::MeshInstance> g_meshInstances : register(u1);
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// Same as quaternionFromRotationMat1() in MatrixFuncs.h
+float4 QuaternionFromRotationMat(float3 row0, float3 row1, float3 row2)
+{
+    if (row2.z < 0)
+    {
+        if (row1.y >= row0.x)
+        {
+            float t = 1 - row0.x + row1.y - row2.z;
+            float4 q = float4(row0.y + row1.x, t, row1.z + row2.y, row2.x - row0.z);
+            return normalize(q * (0.5f / sqrt(t)));
+        }
+
+        float t = 1 + row0.x - row1.y - row2.z;
+        float4 q = float4(t, row0.y + row1.x, row2.x + row0.z, row1.z - row2.y);
+        return normalize(q * (0.5f / sqrt(t)));
+    }
+
+    if (row0.x >= -row1.y)
+    {
+        float t = 1 + row0.x + row1.y + row2.z;
+        float4 q = float4(row1.z - row2.y, row2.x - row0.z, row0.y - row1.x, t);
+        return normalize(q * (0.5f / sqrt(t)));
+    }
+
+    float t = 1 - row0.x - row1.y + row2.z;
+    float4 q = float4(row2.x + row0.z, row1.z + row2.y, t, row0.y - row1.x);
+    return normalize(q * (0.5f / sqrt(t)));
+}
+
+// Same as decomposeSRT() in MatrixFuncs.h, doesn't support negative scaling
+void DecomposeSRT(float3 M[4], out float3 s, out float4 q, out float3 t)
+{
+    t = M[3];
+    // For "row" matrices, singular values are the row lengths
+    s = float3(length(M[0]), length(M[1]), length(M[2]));
+    q = QuaternionFromRotationMat(M[0] / s.x, M[1] / s.y, M[2] / s.z);
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(RT_INSTANCE_UPDATE_GROUP_DIM_X, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= g_local.NumUpdates)
+        return;
+
+    const RT::InstanceTransformUpdate u = g_updates[DTid.x];
+
+    // TLAS instance desc starts with a 3x4 row-major transform, which is the transpose 
+    // of the 4x3 world transform
+    if (u.TLASInstanceIdx != UINT32_MAX)
+    {
+        const uint offset = u.TLASInstanceIdx * TLAS_INSTANCE_DESC_SIZE;
+
+        [unroll]
+        for (int r = 0; r < 3; r++)
+        {
+            float4 row = float4(u.M[0][r], u.M[1][r], u.M[2][r], u.M[3][r]);
+            g_tlasInstances.Store4(offset + r * 16, asuint(row));
+        }
+    }
+
+    float3 s;
+    float4 q;
+    float3 t;
+    DecomposeSRT(u.M, s, q, t);
+
+    float3 s_prev;
+    float4 q_prev;
+    float3 t_prev;
+    DecomposeSRT(u.PrevM, s_prev, q_prev, t_prev);
+
+    // Rest of the fields don't change with the transform
+    RT::MeshInstance meshInstance = g_meshInstances[u.MeshInstanceIdx];
+    meshInstance.Rotation = Math::EncodeNormalized4(q);
+    meshInstance.Scale = half3(s);
+    meshInstance.Translation = t;
+    meshInstance.PrevRotation = Math::EncodeNormalized4(q_prev);
+    meshInstance.PrevScale = half3(s_prev);
+    meshInstance.dTranslation = half3(t - t_prev);
+
+    g_meshInstances[u.MeshInstanceIdx] = meshInstance;
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef RT_INSTANCE_UPDATE_COMMON_H
+#define RT_INSTANCE_UPDATE_COMMON_H
+
+#include "../../ZetaCore/Core/HLSLCompat.h"
+#include "../../ZetaCore/RayTracing/RtCommon.h"
+
+#define RT_INSTANCE_UPDATE_GROUP_DIM_X 64u
+// sizeof(D3D12_RAYTRACING_INSTANCE_DESC)
+#define TLAS_INSTANCE_DESC_SIZE 64
+
+struct cbInstanceUpdate
+{
+    uint32_t NumUpdates;
+};
+
+#endif
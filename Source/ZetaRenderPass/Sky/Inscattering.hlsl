@@ -22,6 +22,7 @@ RaytracingAccelerationStructure g_bvh : register(t0, space0);
 
 groupshared float3 g_waveTr[WAVE_SIZE];
 groupshared float3 g_waveLs[WAVE_SIZE];
+groupshared uint g_reprojectionFailed;
 
 static const float Halton[8] = { 0.5f, 0.25f, 0.75f, 0.125f, 0.625f, 0.375f, 0.875f, 0.0625f };
 
@@ -63,6 +64,33 @@ float Visibility(float3 pos, float3 wi)
     return 1.0f;
 }
 
+// Returns false when given position falls outside previous frame's voxel grid
+bool Reproject(float3 pos, out float3 Ls)
+{
+    Ls = 0;
+
+    const float3 posVS = mul(g_frame.PrevView, float4(pos, 1.0f));
+    if (posVS.z <= 0 || posVS.z > g_local.VoxelGridFarZ)
+        return false;
+
+    float2 posNDC = posVS.xy / (posVS.z * g_frame.TanHalfFOV);
+    posNDC.x /= g_frame.AspectRatio;
+    posNDC.y = -posNDC.y;
+    const float2 posUV = mad(posNDC, 0.5f, 0.5f);
+
+    if (any(posUV < 0.0f) || any(posUV > 1.0f))
+        return false;
+
+    // same mapping as the one used for sampling the voxel grid during compositing
+    const float p = pow(max(posVS.z - g_local.VoxelGridNearZ, 0.0f) / 
+        (g_local.VoxelGridFarZ - g_local.VoxelGridNearZ), 1.0f / g_local.DepthMappingExp);
+
+    Texture3D<half4> g_history = ResourceDescriptorHeap[g_local.VoxelGridHistoryDescHeapIdx];
+    Ls = g_history.SampleLevel(g_samLinearClamp, float3(posUV, p), 0.0f).rgb;
+
+    return true;
+}
+
 void ComputeVoxelData(in float3 pos, in float3 sigma_t_rayleigh, in float sigma_t_mie, 
     in float3 sigma_t_ozone, out float3 LoTranmittance, out float3 density)
 {
@@ -148,6 +176,35 @@ void main(uint Gidx : SV_GroupIndex, uint3 Gid : SV_GroupID)
 
     // sample position
     const float sliceStartT = currSliceStartLinearDepth / rayDirVS.z;
+
+    RWTexture3D<half4> g_voxelGrid = ResourceDescriptorHeap[g_local.VoxelGridDescHeapIdx];    
+
+    // When time slicing, only columns belonging to current slice are updated. The rest 
+    // are reprojected from previous frame, unless some voxel in the column moved outside 
+    // previous frame's grid, in which case the whole column has to be recomputed.
+    const float3 voxelCenter = g_frame.CameraPos + rayDirWS * (sliceStartT + 0.5f * ds);
+
+    if (g_local.NumTimeSlices > 1 && ((Gid.x + Gid.y) % g_local.NumTimeSlices) != g_local.CurrTimeSlice)
+    {
+        if (Gidx == 0)
+            g_reprojectionFailed = 0;
+
+        GroupMemoryBarrierWithGroupSync();
+
+        float3 Ls_prev;
+        if (!Reproject(voxelCenter, Ls_prev))
+            g_reprojectionFailed = 1;
+
+        GroupMemoryBarrierWithGroupSync();
+
+        // uniform across the group
+        if (!g_reprojectionFailed)
+        {
+            g_voxelGrid[voxelID].xyz = half3(Ls_prev);
+            return;
+        }
+    }
+
     const float offset = Halton[g_frame.FrameNum & 7];
     float3 voxelPos = g_frame.CameraPos + rayDirWS * (sliceStartT + offset * ds);
 
@@ -197,9 +254,14 @@ void main(uint Gidx : SV_GroupIndex, uint3 Gid : SV_GroupID)
 
     Ls = Ls * totalTr + prevLs;
 
-    RWTexture3D<half4> g_voxelGrid = ResourceDescriptorHeap[g_local.VoxelGridDescHeapIdx];    
-
     // R11G11B10 doesn't have a sign bit
-    Ls = max(Ls, 0.0f);
-    g_voxelGrid[voxelID].xyz = half3(Ls * g_frame.SunIlluminance);
+    Ls = max(Ls, 0.0f) * g_frame.SunIlluminance;
+
+    // Sample positions are jittered every frame, so blending with the history 
+    // accumulates them over time. Voxels that weren't in the previous grid start over.
+    float3 Ls_prev;
+    if (g_local.TemporalBlendAlpha < 1.0f && Reproject(voxelCenter, Ls_prev))
+        Ls = lerp(Ls_prev, Ls, g_local.TemporalBlendAlpha);
+
+    g_voxelGrid[voxelID].xyz = half3(Ls);
 }
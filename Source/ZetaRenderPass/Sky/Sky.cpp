@@ -2,6 +2,7 @@
 #include <Core/CommandList.h>
 #include <Scene/SceneCore.h>
 #include <Support/Param.h>
+#include <Core/Direct3DUtil.h>
 
 using namespace ZetaRay::Core;
 using namespace ZetaRay::Core::GpuMemory;
@@ -49,9 +50,21 @@ void Sky::Init(int lutWidth, int lutHeight, bool doInscattering)
     auto samplers = renderer.GetStaticSamplers();
     RenderPassBase::InitRenderPass("Sky", flags, samplers);
 
-    m_psoLib.CompileComputePSO((int)SHADER::SKY_LUT, m_rootSigObj.Get(),
+    m_psoLib.EnqueueComputePSO((int)SHADER::SKY_LUT, m_rootSigObj.Get(),
         COMPILED_CS[(int)SHADER::SKY_LUT]);
 
+    // Inscattering is off by default, don't hold up the first frame for it
+    if (doInscattering)
+    {
+        m_psoLib.EnqueueComputePSO((int)SHADER::INSCATTERING, m_rootSigObj.Get(),
+            COMPILED_CS[(int)SHADER::INSCATTERING]);
+    }
+    else
+    {
+        m_psoLib.DeferComputePSO((int)SHADER::INSCATTERING, m_rootSigObj.Get(),
+            COMPILED_CS[(int)SHADER::INSCATTERING]);
+    }
+
     m_descTable = renderer.GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
 
     m_localCB.DepthMappingExp = DefaultParamVals::DEPTH_MAP_EXP;
@@ -59,6 +72,9 @@ void Sky::Init(int lutWidth, int lutHeight, bool doInscattering)
     m_localCB.VoxelGridFarZ = DefaultParamVals::VOXEL_GRID_FAR_Z;
     m_localCB.NumVoxelsX = DefaultParamVals::NUM_VOXELS_X;
     m_localCB.NumVoxelsY = DefaultParamVals::NUM_VOXELS_Y;
+    m_localCB.NumTimeSlices = 1;
+    m_localCB.CurrTimeSlice = 0;
+    m_localCB.TemporalBlendAlpha = 1.0f;
 
     CreateSkyviewLUT();
     App::AddShaderReloadHandler("SkyViewLUT", fastdelegate::MakeDelegate(this, &Sky::ReloadSkyLUTShader));
@@ -97,21 +113,31 @@ void Sky::SetInscatteringEnablement(bool b)
             DefaultParamVals::VOXEL_GRID_FAR_Z, 10.0f, 200.0f, 1.0f);
         App::AddParam(voxelGridFarZ);
 
-        //App::AddShaderReloadHandler("Inscattering", fastdelegate::MakeDelegate(this, &Sky::ReloadInscatteringShader));
+        ParamVariant timeSlices;
+        timeSlices.InitInt("Renderer", "Inscattering", "Time Slices",
+            fastdelegate::MakeDelegate(this, &Sky::NumTimeSlicesCallback),
+            DefaultParamVals::NUM_TIME_SLICES, 1, INSCATTERING_MAX_TIME_SLICES, 1);
+        App::AddParam(timeSlices);
 
-        if (!m_psoLib.GetPSO((int)SHADER::INSCATTERING))
-        {
-            m_psoLib.CompileComputePSO((int)SHADER::INSCATTERING, m_rootSigObj.Get(),
-                COMPILED_CS[(int)SHADER::INSCATTERING]);
-        }
+        ParamVariant temporalBlend;
+        temporalBlend.InitFloat("Renderer", "Inscattering", "Temporal Blend",
+            fastdelegate::MakeDelegate(this, &Sky::TemporalBlendCallback),
+            DefaultParamVals::TEMPORAL_BLEND_ALPHA, 0.05f, 1.0f, 0.05f);
+        App::AddParam(temporalBlend);
+
+        //App::AddShaderReloadHandler("Inscattering", fastdelegate::MakeDelegate(this, &Sky::ReloadInscatteringShader));
     }
     else
     {
         m_voxelGrid.Reset();
+        m_voxelGridHistory.Reset();
+        m_voxelGridHistoryValid = false;
 
         App::RemoveParam("Renderer", "Inscattering", "DepthMapExp");
         App::RemoveParam("Renderer", "Inscattering", "VoxelGridNearZ");
         App::RemoveParam("Renderer", "Inscattering", "VoxelGridFarZ");
+        App::RemoveParam("Renderer", "Inscattering", "Time Slices");
+        App::RemoveParam("Renderer", "Inscattering", "Temporal Blend");
 
         //App::RemoveShaderReloadHandler("Inscattering");
     }
@@ -126,6 +152,13 @@ void Sky::Render(CommandList& cmdList)
     auto& renderer = App::GetRenderer();
     auto& gpuTimer = renderer.GetGpuTimer();
 
+    // Reprojection needs a valid history, otherwise the whole grid is updated
+    const bool timeSliced = m_doInscattering && m_numTimeSlices > 1 && m_voxelGridHistoryValid;
+    const bool blend = m_doInscattering && m_temporalBlendAlpha < 1.0f && m_voxelGridHistoryValid;
+    m_localCB.NumTimeSlices = timeSliced ? m_numTimeSlices : 1;
+    m_localCB.CurrTimeSlice = timeSliced ? m_timeSliceCounter++ % m_numTimeSlices : 0;
+    m_localCB.TemporalBlendAlpha = blend ? m_temporalBlendAlpha : 1.0f;
+
     computeCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
     m_rootSig.SetRootConstants(0, sizeof(m_localCB) / sizeof(DWORD), &m_localCB);
     m_rootSig.End(computeCmdList);
@@ -133,6 +166,7 @@ void Sky::Render(CommandList& cmdList)
     //
     // Sky LUT
     //
+    if (m_lutDirty)
     {
         computeCmdList.PIXBeginEvent("SkyViewLUT");
         const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "SkyViewLUT");
@@ -145,6 +179,8 @@ void Sky::Render(CommandList& cmdList)
 
         gpuTimer.EndQuery(computeCmdList, queryIdx);
         computeCmdList.PIXEndEvent();
+
+        m_lutDirty = false;
     }
 
     //
@@ -155,11 +191,33 @@ void Sky::Render(CommandList& cmdList)
         computeCmdList.PIXBeginEvent("InscatteringVoxelGrid");
         const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "InscatteringVoxelGrid");
 
+        // Voxel grid still contains previous frame's results, copy it to history so that 
+        // reprojection doesn't read voxels that have already been overwritten
+        if (timeSliced || blend)
+        {
+            D3D12_RESOURCE_BARRIER barriers[2];
+            barriers[0] = Direct3DUtil::TransitionBarrier(m_voxelGrid.Resource(),
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+            barriers[1] = Direct3DUtil::TransitionBarrier(m_voxelGridHistory.Resource(),
+                D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+            computeCmdList.ResourceBarrier(barriers, ZetaArrayLen(barriers));
+
+            computeCmdList.CopyResource(m_voxelGridHistory.Resource(), m_voxelGrid.Resource());
+
+            barriers[0] = Direct3DUtil::TransitionBarrier(m_voxelGrid.Resource(),
+                D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+            barriers[1] = Direct3DUtil::TransitionBarrier(m_voxelGridHistory.Resource(),
+                D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            computeCmdList.ResourceBarrier(barriers, ZetaArrayLen(barriers));
+        }
+
         computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::INSCATTERING));
         computeCmdList.Dispatch(m_localCB.NumVoxelsX, m_localCB.NumVoxelsY, 1);
 
         gpuTimer.EndQuery(computeCmdList, queryIdx);
         computeCmdList.PIXEndEvent();
+
+        m_voxelGridHistoryValid = true;
     }
 }
 
@@ -205,21 +263,45 @@ void Sky::CreateVoxelGrid()
     device->CreateUnorderedAccessView(m_voxelGrid.Resource(), nullptr, &uavDesc, 
         m_descTable.CPUHandle((int)DESC_TABLE::VOXEL_GRID_UAV));
     m_localCB.VoxelGridDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::VOXEL_GRID_UAV);    
+
+    m_voxelGridHistory = GpuMemory::GetTexture3D("InscatteringVoxelGridHistory",
+        m_localCB.NumVoxelsX, m_localCB.NumVoxelsY, INSCATTERING_THREAD_GROUP_SIZE_X,
+        ResourceFormats::INSCATTERING_VOXEL_GRID,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+    Direct3DUtil::CreateTexture3DSRV(m_voxelGridHistory, 
+        m_descTable.CPUHandle((int)DESC_TABLE::VOXEL_GRID_HISTORY_SRV));
+    m_localCB.VoxelGridHistoryDescHeapIdx = m_descTable.GPUDescriptorHeapIndex(
+        (int)DESC_TABLE::VOXEL_GRID_HISTORY_SRV);
+    m_voxelGridHistoryValid = false;
 }
 
 void Sky::DepthMapExpCallback(const ParamVariant& p)
 {
     m_localCB.DepthMappingExp = p.GetFloat().m_value;
+    m_voxelGridHistoryValid = false;
 }
 
 void Sky::VoxelGridNearZCallback(const ParamVariant& p)
 {
     m_localCB.VoxelGridNearZ = p.GetFloat().m_value;
+    m_voxelGridHistoryValid = false;
 }
 
 void Sky::VoxelGridFarZCallback(const ParamVariant& p)
 {
     m_localCB.VoxelGridFarZ = p.GetFloat().m_value;
+    m_voxelGridHistoryValid = false;
+}
+
+void Sky::NumTimeSlicesCallback(const ParamVariant& p)
+{
+    m_numTimeSlices = p.GetInt().m_value;
+}
+
+void Sky::TemporalBlendCallback(const ParamVariant& p)
+{
+    m_temporalBlendAlpha = p.GetFloat().m_value;
 }
 
 void Sky::ReloadInscatteringShader()
@@ -230,4 +312,5 @@ void Sky::ReloadInscatteringShader()
 void Sky::ReloadSkyLUTShader()
 {
     m_psoLib.Reload((int)SHADER::SKY_LUT, m_rootSigObj.Get(), "Sky\\SkyViewLUT.hlsl");
+    m_lutDirty = true;
 }
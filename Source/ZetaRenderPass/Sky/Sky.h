@@ -38,6 +38,13 @@ namespace ZetaRay::RenderPass
         void Init(int lutWidth, int lutHeight, bool doInscattering);
         bool IsInscatteringEnabled() { return m_doInscattering; }
         void SetInscatteringEnablement(bool b);
+        // Sky-view LUT only depends on the sun and atmosphere parameters, so it's 
+        // regenerated only after this is called. Inscattering history is discarded as well.
+        void SetSkyChanged()
+        {
+            m_lutDirty = true;
+            m_voxelGridHistoryValid = false;
+        }
         Math::uint3 GetVoxelGridDim() const
         { 
             return Math::uint3(m_localCB.NumVoxelsX, m_localCB.NumVoxelsY,
@@ -80,12 +87,15 @@ namespace ZetaRay::RenderPass
             static constexpr float DEPTH_MAP_EXP = 2.0f;
             static constexpr float VOXEL_GRID_NEAR_Z = 0.5f;
             static constexpr float VOXEL_GRID_FAR_Z = 30.0f;
+            static constexpr int NUM_TIME_SLICES = 4;
+            static constexpr float TEMPORAL_BLEND_ALPHA = 0.5f;
         };
 
         enum class DESC_TABLE
         {
             SKY_LUT_UAV,
             VOXEL_GRID_UAV,
+            VOXEL_GRID_HISTORY_SRV,
             COUNT
         };
 
@@ -99,6 +109,8 @@ namespace ZetaRay::RenderPass
         void DepthMapExpCallback(const Support::ParamVariant& p);
         void VoxelGridNearZCallback(const Support::ParamVariant& p);
         void VoxelGridFarZCallback(const Support::ParamVariant& p);
+        void NumTimeSlicesCallback(const Support::ParamVariant& p);
+        void TemporalBlendCallback(const Support::ParamVariant& p);
 
         // shader reload
         void ReloadInscatteringShader();
@@ -106,8 +118,14 @@ namespace ZetaRay::RenderPass
 
         Core::GpuMemory::Texture m_lut;
         Core::GpuMemory::Texture m_voxelGrid;
+        Core::GpuMemory::Texture m_voxelGridHistory;
         Core::DescriptorTable m_descTable;
         cbSky m_localCB;
         bool m_doInscattering = false;
+        bool m_lutDirty = true;
+        bool m_voxelGridHistoryValid = false;
+        int m_numTimeSlices = DefaultParamVals::NUM_TIME_SLICES;
+        float m_temporalBlendAlpha = DefaultParamVals::TEMPORAL_BLEND_ALPHA;
+        uint32_t m_timeSliceCounter = 0;
     };
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 #define INSCATTERING_THREAD_GROUP_SIZE_X 128u
 #define INSCATTERING_THREAD_GROUP_SIZE_Y 1
 #define INSCATTERING_THREAD_GROUP_SIZE_Z 1
+#define INSCATTERING_MAX_TIME_SLICES 8
 
 struct cbSky
 {
@@ -22,14 +23,24 @@ struct cbSky
     float VoxelGridNearZ;
     float VoxelGridFarZ;
 
+    // Voxel columns are split into this many sets, one of which is updated each 
+    // frame, while the rest are reprojected from previous frame
+    uint32_t NumTimeSlices;
+    uint32_t CurrTimeSlice;
+    // Weight of the newly computed value when blending with the reprojected history, 
+    // 1 disables blending
+    float TemporalBlendAlpha;
+
     // 
     // Resources
     //
 
     // RWTexture3D<half4>
     // RWTexture2D<float4>
+    // Texture3D<half4>
     uint32_t LutDescHeapIdx;
     uint32_t VoxelGridDescHeapIdx;
+    uint32_t VoxelGridHistoryDescHeapIdx;
 };
 
 #endif
\ No newline at end of file
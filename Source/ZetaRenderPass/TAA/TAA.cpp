@@ -47,7 +47,8 @@ void TAA::Init()
     auto samplers = App::GetRenderer().GetStaticSamplers();
     RenderPassBase::InitRenderPass("TAA", flags, samplers);
 
-    m_psoLib.CompileComputePSO(0, m_rootSigObj.Get(), COMPILED_CS[0]);
+    for (int i = 0; i < (int)SHADER::COUNT; i++)
+        m_psoLib.EnqueueComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
 
     m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
     CreateResources();
@@ -59,6 +60,11 @@ void TAA::Init()
         DefaultParamVals::BlendWeight, 0.0f, 1.0f, 0.1f);
     App::AddParam(blendWeight);
 
+    ParamVariant ldsTiling;
+    ldsTiling.InitBool(ICON_FA_FILM " Renderer", "TAA", "LDS Tiling", fastdelegate::MakeDelegate(this, &TAA::LDSTilingCallback),
+        DefaultParamVals::LDSTiling);
+    App::AddParam(ldsTiling);
+
     m_isTemporalTexValid = false;
     //App::AddShaderReloadHandler("TAA", fastdelegate::MakeDelegate(this, &TAA::ReloadShader));
 }
@@ -68,6 +74,7 @@ void TAA::Reset()
     if (IsInitialized())
     {
         App::RemoveParam("Renderer", "TAA", "BlendWeight");
+        App::RemoveParam("Renderer", "TAA", "LDS Tiling");
         // App::RemoveShaderReloadHandler("TAA");
 
         m_antiAliased[0].Reset();
@@ -80,6 +87,7 @@ void TAA::Reset()
 
 void TAA::OnWindowResized()
 {
+    m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
     CreateResources();
     m_isTemporalTexValid = false;
 }
@@ -112,7 +120,8 @@ void TAA::Render(CommandList& cmdList)
     m_rootSig.SetRootConstants(0, sizeof(cbTAA) / sizeof(DWORD), &m_localCB);
     m_rootSig.End(computeCmdList);
 
-    computeCmdList.SetPipelineState(m_psoLib.GetPSO(0));
+    const auto sh = m_ldsTiling ? SHADER::TAA_TILED : SHADER::TAA;
+    computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)sh));
     computeCmdList.Dispatch(CeilUnsignedIntDiv(w, TAA_THREAD_GROUP_SIZE_X), 
         CeilUnsignedIntDiv(h, TAA_THREAD_GROUP_SIZE_Y), 1);
 
@@ -152,7 +161,12 @@ void TAA::BlendWeightCallback(const ParamVariant& p)
     m_localCB.BlendWeight = p.GetFloat().m_value;
 }
 
+void TAA::LDSTilingCallback(const ParamVariant& p)
+{
+    m_ldsTiling = p.GetBool();
+}
+
 void TAA::ReloadShader()
 {
-    m_psoLib.Reload(0, m_rootSigObj.Get(), "TAA\\TAA.hlsl");
+    m_psoLib.Reload((int)SHADER::TAA, m_rootSigObj.Get(), "TAA\\TAA.hlsl");
 }
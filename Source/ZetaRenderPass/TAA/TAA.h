@@ -16,7 +16,14 @@ namespace ZetaRay::Support
 
 namespace ZetaRay::RenderPass
 {
-    struct TAA final : public RenderPassBase<1>
+    enum class TAA_SHADER
+    {
+        TAA,
+        TAA_TILED,
+        COUNT
+    };
+
+    struct TAA final : public RenderPassBase<(int)TAA_SHADER::COUNT>
     {
         enum class SHADER_IN_DESC
         {
@@ -55,6 +62,7 @@ namespace ZetaRay::RenderPass
         static constexpr int NUM_UAV = 0;
         static constexpr int NUM_GLOBS = 1;
         static constexpr int NUM_CONSTS = sizeof(cbTAA) / sizeof(DWORD);
+        using SHADER = RenderPass::TAA_SHADER;
 
         enum class DESC_TABLE
         {
@@ -65,15 +73,20 @@ namespace ZetaRay::RenderPass
             COUNT
         };
 
-        inline static constexpr const char* COMPILED_CS[] = { "TAA_cs.cso" };
+        inline static constexpr const char* COMPILED_CS[(int)SHADER::COUNT] = {
+            "TAA_cs.cso",
+            "TAA_Tiled_cs.cso"
+        };
 
         struct DefaultParamVals
         {
             static constexpr float BlendWeight = 0.1f;
+            static constexpr bool LDSTiling = false;
         };
 
         void CreateResources();
         void BlendWeightCallback(const Support::ParamVariant& p);
+        void LDSTilingCallback(const Support::ParamVariant& p);
         void ReloadShader();
 
         // ping-pong between input & output
@@ -82,5 +95,7 @@ namespace ZetaRay::RenderPass
         cbTAA m_localCB;
         Core::DescriptorTable m_descTable;
         bool m_isTemporalTexValid;
+        // Load each group's neighborhood into groupshared memory once
+        bool m_ldsTiling = DefaultParamVals::LDSTiling;
     };
 }
\ No newline at end of file
@@ -21,6 +21,16 @@
 ConstantBuffer<cbFrameConstants> g_frame : register(b0);
 ConstantBuffer<cbTAA> g_local : register(b1);
 
+#ifdef LDS_TILE
+#define TILE_DIM_X (TAA_THREAD_GROUP_SIZE_X + 2)
+#define TILE_DIM_Y (TAA_THREAD_GROUP_SIZE_Y + 2)
+
+// Group's pixels plus a one-pixel apron. rgb: color, a: 1 if pixel is inside the render 
+// target, 0 otherwise
+groupshared half4 g_tileColor[TILE_DIM_X * TILE_DIM_Y];
+groupshared float g_tileDepth[TILE_DIM_X * TILE_DIM_Y];
+#endif
+
 //--------------------------------------------------------------------------------------
 // Helper functions
 //--------------------------------------------------------------------------------------
@@ -61,21 +71,53 @@ float3 ClipAABB(float3 aabbMin, float3 aabbMax, float3 histSample)
         return histSample; // point inside aabb
 }
 
+#ifdef LDS_TILE
+// Every thread in the group has to call this, including the out-of-bounds ones
+void LoadTile(Texture2D<float4> g_currSignal, GBUFFER_DEPTH g_depth, int2 groupBase, uint Gidx)
+{
+    const int2 renderDim = int2(g_frame.RenderWidth, g_frame.RenderHeight);
+
+    for (uint i = Gidx; i < TILE_DIM_X * TILE_DIM_Y; i += TAA_THREAD_GROUP_SIZE_X * TAA_THREAD_GROUP_SIZE_Y)
+    {
+        const int2 addr = groupBase + int2(i % TILE_DIM_X, i / TILE_DIM_X) - 1;
+        half4 color = 0;
+        float depth = FLT_MAX;
+
+        if (all(addr >= 0) && all(addr < renderDim))
+        {
+            color = half4(min(max(g_currSignal[addr].rgb, 0.0.xxx), FLT16_MAX), 1);
+            depth = g_depth[addr];
+        }
+
+        g_tileColor[i] = color;
+        g_tileDepth[i] = depth;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+}
+#endif
+
 //--------------------------------------------------------------------------------------
 // Main
 //--------------------------------------------------------------------------------------
 
 [numthreads(TAA_THREAD_GROUP_SIZE_X, TAA_THREAD_GROUP_SIZE_Y, TAA_THREAD_GROUP_SIZE_Z)]
-void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID)
+void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID, 
+    uint Gidx : SV_GroupIndex)
 {
+    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + GBUFFER_OFFSET::DEPTH];
+    Texture2D<float4> g_currSignal = ResourceDescriptorHeap[g_local.InputDescHeapIdx];
+
+#ifdef LDS_TILE
+    LoadTile(g_currSignal, g_depth, Gid.xy * uint2(TAA_THREAD_GROUP_SIZE_X, TAA_THREAD_GROUP_SIZE_Y), Gidx);
+#endif
+
     if(DTid.x >= g_frame.RenderWidth || DTid.y >= g_frame.RenderHeight)
         return;
 
-    GBUFFER_DEPTH g_depth = ResourceDescriptorHeap[g_frame.CurrGBufferDescHeapOffset + GBUFFER_OFFSET::DEPTH];
     const float depth = g_depth[DTid.xy];
 
     RWTexture2D<float4> g_antiAliased = ResourceDescriptorHeap[g_local.CurrOutputDescHeapIdx];
-    Texture2D<float4> g_currSignal = ResourceDescriptorHeap[g_local.InputDescHeapIdx];
     const float3 currColor = g_currSignal[DTid.xy].rgb;
 
     if (!g_local.TemporalIsValid || depth == FLT_MAX)
@@ -105,11 +147,20 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID)
             if(i == 0 && j == 0)
                 continue;
 
+#ifdef LDS_TILE
+            const int tileIdx = (GTid.y + 1 + j) * TILE_DIM_X + GTid.x + 1 + i;
+            const half4 neighbor = g_tileColor[tileIdx];
+            if (neighbor.a == 0)
+                continue;
+
+            float3 neighborColor = neighbor.rgb;
+#else
             int2 neighborAddrr = DTid.xy + int2(i, j);
             if (any(neighborAddrr < 0) || any(neighborAddrr >= int2(g_frame.RenderWidth, g_frame.RenderHeight)))
                 continue;
 
             float3 neighborColor = max(g_currSignal[neighborAddrr].rgb, 0.0.xxx);
+#endif
             
             float weight = Mitchell1D(i, 0.33f, 0.33f) * Mitchell1D(j, 0.33f, 0.33f);
             weight *= 1.0 / (1.0 + Math::Luminance(neighborColor));
@@ -123,7 +174,11 @@ void main(uint3 DTid : SV_DispatchThreadID, uint3 GTid : SV_GroupThreadID)
             // motion vector signal might be aliased -- prefilter it by selecting the motion vector
             // of the neighborhood pixel that is closest to the camera.
 #if DEPTH_DILATION
+#ifdef LDS_TILE
+            float neighborDepth = g_tileDepth[tileIdx];
+#else
             float neighborDepth = g_depth[neighborAddrr];
+#endif
             if (neighborDepth < closestDepth)
             {
                 closestDepth = neighborDepth;
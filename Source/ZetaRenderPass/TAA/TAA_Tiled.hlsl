@@ -0,0 +1,2 @@
+#define LDS_TILE
+#include "TAA.hlsl"
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "TileClassification.h"
+#include <Core/CommandList.h>
+#include <Scene/SceneRenderer.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Core::GpuMemory;
+using namespace ZetaRay::Core::Direct3DUtil;
+using namespace ZetaRay::RenderPass;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Scene;
+
+//--------------------------------------------------------------------------------------
+// TileClassification
+//--------------------------------------------------------------------------------------
+
+TileClassification::TileClassification()
+    : RenderPassBase(NUM_CBV, NUM_SRV, NUM_UAV, NUM_GLOBS, NUM_CONSTS)
+{
+    // root constants
+    m_rootSig.InitAsConstants(0, NUM_CONSTS, 0);
+
+    // frame constants
+    m_rootSig.InitAsCBV(1, 1, 0,
+        D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE,
+        GlobalResource::FRAME_CONSTANTS_BUFFER);
+}
+
+void TileClassification::Init()
+{
+    constexpr D3D12_ROOT_SIGNATURE_FLAGS flags =
+        D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_MESH_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+    RenderPassBase::InitRenderPass("TileClassification", flags);
+
+    // Consumers may create it after startup (e.g. when switching integrators), in which 
+    // case it's built on first use
+    for (int i = 0; i < (int)SHADER::COUNT; i++)
+        m_psoLib.DeferComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
+
+    CreateTileList();
+}
+
+void TileClassification::OnWindowResized()
+{
+    CreateTileList();
+}
+
+void TileClassification::Release()
+{
+    m_tileList.Reset();
+    m_tileListInit.Reset();
+}
+
+void TileClassification::CreateTileList()
+{
+    auto& renderer = App::GetRenderer();
+    const uint32_t w = renderer.GetRenderWidth();
+    const uint32_t h = renderer.GetRenderHeight();
+    const uint32_t numTilesX = CeilUnsignedIntDiv(w, TILE_CLASS_TILE_DIM);
+    const uint32_t numTilesY = CeilUnsignedIntDiv(h, TILE_CLASS_TILE_DIM);
+    const uint32_t maxNumTiles = numTilesX * numTilesY;
+    const uint32_t numElements = TILE_CLASS_HEADER_SIZE + TILE_CATEGORY::COUNT * maxNumTiles;
+
+    // GPU might still be reading the old list, it's released once GPU is done
+    m_descTable = renderer.GetGpuDescriptorHeap().Allocate((int)DESC_TABLE::COUNT);
+
+    m_tileList = GpuMemory::GetDefaultHeapBuffer("TileList", numElements * sizeof(uint32_t),
+        D3D12_RESOURCE_STATE_COMMON, true);
+
+    Direct3DUtil::CreateBufferSRV(m_tileList, m_descTable.CPUHandle((int)DESC_TABLE::TILE_LIST_SRV),
+        sizeof(uint32_t), numElements);
+    Direct3DUtil::CreateBufferUAV(m_tileList, m_descTable.CPUHandle((int)DESC_TABLE::TILE_LIST_UAV),
+        sizeof(uint32_t), numElements);
+
+    // Number of thread groups along Y and number of tiles start at zero
+    uint32_t header[TILE_CLASS_HEADER_SIZE] = { 0 };
+
+    for (uint32_t c = 0; c < TILE_CATEGORY::COUNT; c++)
+    {
+        uint32_t* args = header + c * TILE_CLASS_HEADER_SIZE_PER_CATEGORY;
+        args[0] = TILE_CLASS_LIST_DISPATCH_DIM_X;
+        args[2] = 1;
+        args[TILE_CLASS_LIST_OFFSET] = TILE_CLASS_HEADER_SIZE + c * maxNumTiles;
+    }
+
+    m_tileListInit = GpuMemory::GetDefaultHeapBufferAndInit("TileListInit",
+        sizeof(header), false, MemoryRegion{ .Data = header, .SizeInBytes = sizeof(header) });
+}
+
+void TileClassification::Classify(ComputeCmdList& computeCmdList)
+{
+    auto& renderer = App::GetRenderer();
+    auto& gpuTimer = renderer.GetGpuTimer();
+    const uint32_t w = renderer.GetRenderWidth();
+    const uint32_t h = renderer.GetRenderHeight();
+
+    computeCmdList.PIXBeginEvent("TileClassification");
+    const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "TileClassification");
+
+    // Previous frame's consumers might still be reading the lists
+    auto toCopyDest = BufferBarrier(m_tileList.Resource(),
+        D3D12_BARRIER_SYNC_EXECUTE_INDIRECT | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_SYNC_COPY,
+        D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT | D3D12_BARRIER_ACCESS_SHADER_RESOURCE,
+        D3D12_BARRIER_ACCESS_COPY_DEST);
+    computeCmdList.ResourceBarrier(toCopyDest);
+
+    computeCmdList.CopyBufferRegion(m_tileList.Resource(), 0, m_tileListInit.Resource(), 0,
+        TILE_CLASS_HEADER_SIZE * sizeof(uint32_t));
+
+    auto toUav = BufferBarrier(m_tileList.Resource(),
+        D3D12_BARRIER_SYNC_COPY,
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_ACCESS_COPY_DEST,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS);
+    computeCmdList.ResourceBarrier(toUav);
+
+    computeCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
+    computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::CLASSIFY));
+
+    cbTileClassification cb;
+    cb.TileListDescHeapIdx = m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::TILE_LIST_UAV);
+    m_rootSig.SetRootConstants(0, NUM_CONSTS, &cb);
+    m_rootSig.End(computeCmdList);
+
+    computeCmdList.Dispatch(CeilUnsignedIntDiv(w, TILE_CLASS_TILE_DIM),
+        CeilUnsignedIntDiv(h, TILE_CLASS_TILE_DIM), 1);
+
+    auto toIndirectArgs = BufferBarrier(m_tileList.Resource(),
+        D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_SYNC_EXECUTE_INDIRECT | D3D12_BARRIER_SYNC_COMPUTE_SHADING,
+        D3D12_BARRIER_ACCESS_UNORDERED_ACCESS,
+        D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT | D3D12_BARRIER_ACCESS_SHADER_RESOURCE);
+    computeCmdList.ResourceBarrier(toIndirectArgs);
+
+    gpuTimer.EndQuery(computeCmdList, queryIdx);
+    computeCmdList.PIXEndEvent();
+}
+
+void TileClassification::DispatchTiles(ComputeCmdList& computeCmdList, uint32_t category)
+{
+    Assert(category < TILE_CATEGORY::COUNT, "Invalid tile category.");
+
+    computeCmdList.DispatchIndirect(m_tileList.Resource(),
+        category * TILE_CLASS_HEADER_SIZE_PER_CATEGORY * sizeof(uint32_t));
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../RenderPass.h"
+#include <Core/GpuMemory.h>
+#include "TileClassification_Common.h"
+
+namespace ZetaRay::Core
+{
+    class ComputeCmdList;
+}
+
+namespace ZetaRay::RenderPass
+{
+    enum class TILE_CLASSIFICATION_SHADER
+    {
+        CLASSIFY,
+        COUNT
+    };
+
+    // Classifies screen tiles (TILE_CLASS_TILE_DIM x TILE_CLASS_TILE_DIM pixels) by the kinds 
+    // of GBuffer pixels they contain (see TILE_CATEGORY). Every tile is appended to the list 
+    // of each category that it has at least one pixel of, along with dispatch arguments for 
+    // one thread group per tile. Passes that only need to process some kinds of pixels can 
+    // then skip the other tiles -- DispatchTiles() launches the groups and shaders find their 
+    // tile with TileClassification::GroupToTile() (TileClassification.hlsli). Owned by the 
+    // passes that use it and has to run after the GBuffer pass.
+    struct TileClassification final : public RenderPassBase<(int)TILE_CLASSIFICATION_SHADER::COUNT>
+    {
+        TileClassification();
+        ~TileClassification() = default;
+
+        void Init();
+        void OnWindowResized();
+        // Releases the lists, Init() or OnWindowResized() recreates them
+        void Release();
+        // Sets its own root signature, so callers have to set theirs afterwards
+        void Classify(Core::ComputeCmdList& computeCmdList);
+        // Launches one thread group per tile of the given category. Has to be called after
+        // Classify() for the same frame.
+        void DispatchTiles(Core::ComputeCmdList& computeCmdList, uint32_t category);
+        // StructuredBuffer<uint>, see TileClassification_Common.h for the layout
+        ZetaInline uint32_t TileListDescHeapIdx() const
+        {
+            return m_descTable.GPUDescriptorHeapIndex((int)DESC_TABLE::TILE_LIST_SRV);
+        }
+
+    private:
+        static constexpr int NUM_CBV = 1;
+        static constexpr int NUM_SRV = 0;
+        static constexpr int NUM_UAV = 0;
+        static constexpr int NUM_GLOBS = 1;
+        static constexpr int NUM_CONSTS = (int)(sizeof(cbTileClassification) / sizeof(DWORD));
+        using SHADER = TILE_CLASSIFICATION_SHADER;
+
+        inline static constexpr const char* COMPILED_CS[(int)SHADER::COUNT] = {
+            "TileClassification_cs.cso"
+        };
+
+        enum class DESC_TABLE
+        {
+            TILE_LIST_SRV,
+            TILE_LIST_UAV,
+            COUNT
+        };
+
+        void CreateTileList();
+
+        Core::GpuMemory::Buffer m_tileList;
+        // Initial header, copied to the tile list before classification. Offsets of the 
+        // lists depend on the number of tiles, so it's recreated along with the list.
+        Core::GpuMemory::Buffer m_tileListInit;
+        Core::DescriptorTable m_descTable;
+    };
+}
@@ -0,0 +1,58 @@
+#include "TileClassification_Common.h"
+#include "../Common/FrameConstants.h"
+#include "../Common/GBuffers.hlsli"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbTileClassification> g_local : register(b0);
+ConstantBuffer<cbFrameConstants> g_frame : register(b1);
+
+groupshared uint g_tileMask;
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(TILE_CLASS_TILE_DIM, TILE_CLASS_TILE_DIM, 1)]
+void main(uint3 DTid : SV_DispatchThreadID, uint3 Gid : SV_GroupID, uint Gidx : SV_GroupIndex)
+{
+    if(Gidx == 0)
+        g_tileMask = 0;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    uint mask = 0;
+
+    if (DTid.x < g_frame.RenderWidth && DTid.y < g_frame.RenderHeight)
+    {
+        const GBuffer::Flags flags = GBuffer::DecodeMetallic(GBuffer::LoadMetallicRoughness(DTid.xy, 
+            g_frame.CurrGBufferDescHeapOffset).x);
+
+        const uint category = flags.invalid ? TILE_CATEGORY::SKY : 
+            (flags.emissive ? TILE_CATEGORY::EMISSIVE : TILE_CATEGORY::SURFACE);
+        mask = 1u << category;
+    }
+
+    // One shared memory atomic per wave
+    mask = WaveActiveBitOr(mask);
+    if(WaveIsFirstLane())
+        InterlockedOr(g_tileMask, mask);
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // One thread per category appends the tile to its list
+    if(Gidx >= TILE_CATEGORY::COUNT || !(g_tileMask & (1u << Gidx)))
+        return;
+
+    RWStructuredBuffer<uint> g_tileList = ResourceDescriptorHeap[g_local.TileListDescHeapIdx];
+    const uint header = Gidx * TILE_CLASS_HEADER_SIZE_PER_CATEGORY;
+
+    uint slot;
+    InterlockedAdd(g_tileList[header + TILE_CLASS_NUM_TILES], 1, slot);
+    // Number of thread groups along Y
+    InterlockedMax(g_tileList[header + 1], slot / TILE_CLASS_LIST_DISPATCH_DIM_X + 1);
+
+    g_tileList[g_tileList[header + TILE_CLASS_LIST_OFFSET] + slot] = Gid.x | (Gid.y << 16);
+}
@@ -0,0 +1,28 @@
+#ifndef TILE_CLASSIFICATION_H
+#define TILE_CLASSIFICATION_H
+
+#include "TileClassification_Common.h"
+
+namespace TileClassification
+{
+    // Maps a thread group that was launched by TileClassification::DispatchTiles() to its 
+    // tile. Returns false for the groups past the end of the list, which have nothing to 
+    // process.
+    bool GroupToTile(uint2 Gid, uint category, uint tileListDescHeapIdx, out uint2 tile)
+    {
+        StructuredBuffer<uint> g_tileList = ResourceDescriptorHeap[tileListDescHeapIdx];
+        const uint header = category * TILE_CLASS_HEADER_SIZE_PER_CATEGORY;
+        const uint idx = Gid.y * TILE_CLASS_LIST_DISPATCH_DIM_X + Gid.x;
+        tile = 0;
+
+        if(idx >= g_tileList[header + TILE_CLASS_NUM_TILES])
+            return false;
+
+        const uint packed = g_tileList[g_tileList[header + TILE_CLASS_LIST_OFFSET] + idx];
+        tile = uint2(packed & 0xffff, packed >> 16);
+
+        return true;
+    }
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TILE_CLASSIFICATION_COMMON_H
+#define TILE_CLASSIFICATION_COMMON_H
+
+#include "../../ZetaCore/Core/HLSLCompat.h"
+
+// Tiles are classified by one thread group each, and passes that consume the lists launch
+// one thread group per tile, so their group dimensions have to match
+#define TILE_CLASS_TILE_DIM 8u
+
+// For each category, dispatch arguments (x, y, z) followed by number of tiles and offset
+// of its tile list (in uints). Lists (tiles packed as x | y << 16) start after the header.
+#define TILE_CLASS_HEADER_SIZE_PER_CATEGORY 8
+#define TILE_CLASS_NUM_TILES 3
+#define TILE_CLASS_LIST_OFFSET 4
+
+// Thread groups of every list are laid out as rows with a fixed number of groups along X
+#define TILE_CLASS_LIST_DISPATCH_DIM_X 256u
+
+namespace TILE_CATEGORY
+{
+    // Tile has at least one pixel of the given kind
+    static constexpr uint32_t SURFACE = 0;
+    static constexpr uint32_t EMISSIVE = 1;
+    static constexpr uint32_t SKY = 2;
+    static constexpr uint32_t COUNT = 3;
+};
+
+#define TILE_CLASS_HEADER_SIZE (TILE_CATEGORY::COUNT * TILE_CLASS_HEADER_SIZE_PER_CATEGORY)
+
+struct cbTileClassification
+{
+    uint32_t TileListDescHeapIdx;
+};
+
+#endif
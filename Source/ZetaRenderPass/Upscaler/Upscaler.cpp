@@ -0,0 +1,60 @@
+#include "Upscaler.h"
+
+using namespace ZetaRay;
+using namespace ZetaRay::RenderPass;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Core::GpuMemory;
+
+namespace
+{
+    static_assert((int)Upscaler::SHADER_IN_RES::COUNT == (int)FSR2Pass::SHADER_IN_RES::COUNT, 
+        "Upscaler and FSR2 inputs must match.");
+    static_assert((int)Upscaler::SHADER_OUT_RES::COUNT == (int)FSR2Pass::SHADER_OUT_RES::COUNT, 
+        "Upscaler and FSR2 outputs must match.");
+}
+
+//--------------------------------------------------------------------------------------
+// Upscaler
+//--------------------------------------------------------------------------------------
+
+void Upscaler::Init()
+{
+    m_fsr2.Init();
+}
+
+bool Upscaler::IsInitialized()
+{
+    return m_fsr2.IsInitialized();
+}
+
+void Upscaler::Activate()
+{
+    m_fsr2.Activate();
+}
+
+void Upscaler::OnWindowResized()
+{
+    m_fsr2.OnWindowResized();
+}
+
+void Upscaler::SetInput(SHADER_IN_RES i, ID3D12Resource* res)
+{
+    Assert((int)i < (int)SHADER_IN_RES::COUNT, "out-of-bound access.");
+    m_fsr2.SetInput((FSR2Pass::SHADER_IN_RES)i, res);
+}
+
+const Texture& Upscaler::GetOutput(SHADER_OUT_RES res)
+{
+    Assert((int)res < (int)SHADER_OUT_RES::COUNT, "out-of-bound access.");
+    return m_fsr2.GetOutput((FSR2Pass::SHADER_OUT_RES)res);
+}
+
+void Upscaler::Reset()
+{
+    m_fsr2.Reset();
+}
+
+void Upscaler::Render(CommandList& cmdList)
+{
+    m_fsr2.Render(cmdList);
+}
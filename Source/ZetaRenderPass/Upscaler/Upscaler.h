@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../FSR2/FSR2.h"
+
+namespace ZetaRay::RenderPass
+{
+    // Temporal upscaler interface. Takes color, depth, motion vectors and exposure (jitter 
+    // comes from the camera) and writes to a display-sized output. FSR2 is currently the 
+    // only backend.
+    struct Upscaler
+    {
+        enum class SHADER_IN_RES
+        {
+            COLOR,
+            DEPTH,
+            MOTION_VECTOR,
+            EXPOSURE,
+            COUNT
+        };
+
+        enum class SHADER_OUT_RES
+        {
+            UPSCALED,
+            COUNT
+        };
+
+        Upscaler() = default;
+        ~Upscaler() = default;
+
+        Upscaler(Upscaler&&) = delete;
+        Upscaler& operator=(Upscaler&&) = delete;
+
+        void Init();
+        bool IsInitialized();
+        void Activate();
+        void OnWindowResized();
+        void SetInput(SHADER_IN_RES i, ID3D12Resource* res);
+        const Core::GpuMemory::Texture& GetOutput(SHADER_OUT_RES res);
+        const char* GetBackendName() const { return "FSR2"; }
+
+        void Reset();
+        void Render(Core::CommandList& cmdList);
+
+    private:
+        FSR2Pass m_fsr2;
+    };
+}
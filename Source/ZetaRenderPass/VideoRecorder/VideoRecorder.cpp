@@ -0,0 +1,409 @@
+#include "VideoRecorder.h"
+#include <Core/CommandList.h>
+#include <Core/RenderGraph.h>
+#include <Scene/SceneCore.h>
+#include <Support/Param.h>
+#include <Support/Task.h>
+#include <App/Common.h>
+#include <App/Timer.h>
+#include <App/Log.h>
+#include "../Assets/Font/IconsFontAwesome6.h"
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::App;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Core::GpuMemory;
+using namespace ZetaRay::RenderPass;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Util;
+
+//--------------------------------------------------------------------------------------
+// VideoRecorder
+//--------------------------------------------------------------------------------------
+
+VideoRecorder::VideoRecorder()
+    : RenderPassBase(NUM_CBV, NUM_SRV, NUM_UAV, NUM_GLOBS, NUM_CONSTS)
+{
+    // root constants
+    m_rootSig.InitAsConstants(0, NUM_CONSTS, 0);
+
+    // NV12 output
+    m_rootSig.InitAsBufferUAV(1, 0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE);
+}
+
+void VideoRecorder::InitPSOs()
+{
+    constexpr D3D12_ROOT_SIGNATURE_FLAGS flags =
+        D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_VERTEX_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_AMPLIFICATION_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_MESH_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS |
+        D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+    RenderPassBase::InitRenderPass("VideoRecorder", flags);
+
+    for (int i = 0; i < (int)SHADER::COUNT; i++)
+        m_psoLib.EnqueueComputePSO(i, m_rootSigObj.Get(), COMPILED_CS[i]);
+}
+
+void VideoRecorder::Init()
+{
+    InitPSOs();
+
+    // One SRV per back buffer, so that descriptors aren't overwritten while in use
+    m_descTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate(Constants::NUM_BACK_BUFFERS);
+
+    ParamVariant p;
+    p.InitBool(ICON_FA_FILM " Renderer", "Display", "Record Video",
+        fastdelegate::MakeDelegate(this, &VideoRecorder::RecordCallback),
+        false);
+    App::AddParam(p);
+}
+
+void VideoRecorder::Shutdown()
+{
+    m_recording.store(false, std::memory_order_relaxed);
+
+    // GPU has been flushed at this point, so the pending frames are waiting for the encoder
+    int32_t numPending = m_numPending.load(std::memory_order_acquire);
+    while (numPending > 0)
+    {
+        m_numPending.wait(numPending, std::memory_order_acquire);
+        numPending = m_numPending.load(std::memory_order_acquire);
+    }
+
+    AcquireSRWLockExclusive(&m_encodeLock);
+    if (m_sinkWriter)
+        Finalize();
+    ReleaseSRWLockExclusive(&m_encodeLock);
+
+    for (int i = 0; i < NUM_READBACK_BUFFERS; i++)
+        m_slots[i].Readback.Reset(false);
+
+    m_nv12.Reset(false);
+
+    if (m_mfInitialized)
+    {
+        MFShutdown();
+        m_mfInitialized = false;
+    }
+}
+
+void VideoRecorder::Begin(const char* path)
+{
+    if (m_recording.load(std::memory_order_relaxed))
+        return;
+
+    // Previous video might still be finalizing
+    AcquireSRWLockExclusive(&m_encodeLock);
+    const bool busy = m_sinkWriter != nullptr;
+    ReleaseSRWLockExclusive(&m_encodeLock);
+
+    if (busy)
+    {
+        LOG_UI_WARNING("Previous video is still being written, try again later.\n");
+        return;
+    }
+
+    if (!m_mfInitialized)
+    {
+        CheckHR(MFStartup(MF_VERSION, MFSTARTUP_LITE));
+        m_mfInitialized = true;
+    }
+
+    const size_t pathLen = path ? strlen(path) : 0;
+    Check(pathLen < MAX_PATH, "Video path is too long.");
+
+    if (path)
+        memcpy(m_path, path, pathLen + 1);
+    else
+    {
+        SYSTEMTIME st;
+        GetLocalTime(&st);
+        StackStr(currTime, N1, "%u_%u_%u_%u_%u_%u", st.wYear, st.wMonth, st.wDay,
+            st.wHour, st.wMinute, st.wSecond);
+
+        uint32_t hash = Util::XXH3_64_To_32(XXH3_64bits(currTime, N1));
+        stbsp_snprintf(m_path, MAX_PATH, "capture_%u.mp4", hash);
+    }
+
+    auto& renderer = App::GetRenderer();
+    const auto desc = const_cast<Texture&>(renderer.GetCurrentBackBuffer()).Desc();
+    m_backBufferWidth = (uint32_t)desc.Width;
+    m_backBufferHeight = desc.Height;
+
+    // Encoder requires even dimensions, the shader writes blocks of 4x2 pixels
+    const uint32_t width = m_backBufferWidth & ~(VIDEO_RECORDER_BLOCK_DIM_X - 1);
+    const uint32_t height = m_backBufferHeight & ~(VIDEO_RECORDER_BLOCK_DIM_Y - 1);
+
+    if (width != m_width || height != m_height || !m_nv12.IsInitialized())
+    {
+        m_width = width;
+        m_height = height;
+        const uint32_t sizeInBytes = m_width * m_height * 3 / 2;
+
+        m_nv12 = GpuMemory::GetDefaultHeapBuffer("VideoNV12", sizeInBytes,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS, true);
+
+        for (int i = 0; i < NUM_READBACK_BUFFERS; i++)
+            m_slots[i].Readback = GpuMemory::GetReadbackHeapBuffer(sizeInBytes);
+    }
+
+    CreateSinkWriter();
+
+    m_startTime = App::GetTimer().GetTotalTime();
+    m_lastTimestamp = -1;
+    m_nextSlot = 0;
+    m_nextToEncode = 0;
+    m_numFrames = 0;
+    m_numDropped = 0;
+    m_recording.store(true, std::memory_order_relaxed);
+
+    LOG_UI_INFO("Recording video (%ux%u) to %s...\n", m_width, m_height, m_path);
+}
+
+void VideoRecorder::End()
+{
+    if (!m_recording.load(std::memory_order_relaxed))
+        return;
+
+    m_recording.store(false, std::memory_order_seq_cst);
+
+    // Whichever of this task and the last pending frame sees the other one done finalizes
+    Task t("FinalizeVideo", TASK_PRIORITY::BACKGROUND, [this]()
+        {
+            AcquireSRWLockExclusive(&m_encodeLock);
+            if (m_numPending.load(std::memory_order_seq_cst) == 0 && m_sinkWriter)
+                Finalize();
+            ReleaseSRWLockExclusive(&m_encodeLock);
+        });
+
+    App::SubmitBackground(ZetaMove(t));
+}
+
+void VideoRecorder::Record(CommandList& cmdList)
+{
+    if (!m_recording.load(std::memory_order_relaxed))
+        return;
+
+    auto& renderer = App::GetRenderer();
+    Texture& backBuffer = const_cast<Texture&>(renderer.GetCurrentBackBuffer());
+    const auto desc = backBuffer.Desc();
+
+    if ((uint32_t)desc.Width != m_backBufferWidth || desc.Height != m_backBufferHeight)
+    {
+        LOG_UI_WARNING("Window was resized, recording stopped.\n");
+        End();
+
+        return;
+    }
+
+    // Video has to follow the real frame times, which vary
+    const double elapsed = App::GetTimer().GetTotalTime() - m_startTime;
+    const int64_t timestamp = Math::Max((int64_t)(elapsed * 1e7), m_lastTimestamp + 1);
+
+    // Encoder is falling behind, drop the frame rather than waiting for it
+    Slot& slot = m_slots[m_nextSlot];
+    if (slot.State.load(std::memory_order_acquire) != SLOT_STATE::FREE)
+    {
+        m_numDropped++;
+        return;
+    }
+
+    Assert(cmdList.GetType() == D3D12_COMMAND_LIST_TYPE_DIRECT, "Invalid downcast");
+    ComputeCmdList& computeCmdList = static_cast<ComputeCmdList&>(cmdList);
+
+    auto& gpuTimer = renderer.GetGpuTimer();
+
+    computeCmdList.PIXBeginEvent("VideoRecorder");
+    const uint32_t queryIdx = gpuTimer.BeginQuery(computeCmdList, "VideoRecorder");
+
+    // Swap chain buffers are UNORM (rendered to through sRGB RTVs), so the values read
+    // are gamma encoded
+    const int backBuffIdx = renderer.GetCurrentBackBufferIndex();
+    Direct3DUtil::CreateTexture2DSRV(backBuffer, m_descTable.CPUHandle(backBuffIdx),
+        DXGI_FORMAT_R8G8B8A8_UNORM);
+
+    computeCmdList.ResourceBarrier(backBuffer.Resource(),
+        D3D12_RESOURCE_STATE_RENDER_TARGET,
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+    computeCmdList.SetRootSignature(m_rootSig, m_rootSigObj.Get());
+    computeCmdList.SetPipelineState(m_psoLib.GetPSO((int)SHADER::RGB_TO_NV12));
+
+    cbVideoRecorder cb;
+    cb.InputDescHeapIdx = m_descTable.GPUDescriptorHeapIndex(backBuffIdx);
+    cb.Width = m_width;
+    cb.Height = m_height;
+
+    m_rootSig.SetRootConstants(0, sizeof(cb) / sizeof(DWORD), &cb);
+    m_rootSig.SetRootUAV(1, m_nv12.GpuVA());
+    m_rootSig.End(computeCmdList);
+
+    const uint32_t dispatchDimX = CeilUnsignedIntDiv(m_width / VIDEO_RECORDER_BLOCK_DIM_X,
+        VIDEO_RECORDER_GROUP_DIM_X);
+    const uint32_t dispatchDimY = CeilUnsignedIntDiv(m_height / VIDEO_RECORDER_BLOCK_DIM_Y,
+        VIDEO_RECORDER_GROUP_DIM_Y);
+    computeCmdList.Dispatch(dispatchDimX, dispatchDimY, 1);
+
+    D3D12_RESOURCE_BARRIER barriers[2];
+    barriers[0] = Direct3DUtil::TransitionBarrier(backBuffer.Resource(),
+        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+        D3D12_RESOURCE_STATE_RENDER_TARGET);
+    barriers[1] = Direct3DUtil::TransitionBarrier(m_nv12.Resource(),
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        D3D12_RESOURCE_STATE_COPY_SOURCE);
+    computeCmdList.ResourceBarrier(barriers, ZetaArrayLen(barriers));
+
+    computeCmdList.CopyBufferRegion(slot.Readback.Resource(), 0, m_nv12.Resource(), 0,
+        m_width * m_height * 3 / 2);
+
+    computeCmdList.ResourceBarrier(m_nv12.Resource(),
+        D3D12_RESOURCE_STATE_COPY_SOURCE,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    gpuTimer.EndQuery(computeCmdList, queryIdx);
+    computeCmdList.PIXEndEvent();
+
+    slot.Timestamp = timestamp;
+    slot.State.store(SLOT_STATE::IN_FLIGHT, std::memory_order_relaxed);
+    m_numPending.fetch_add(1, std::memory_order_relaxed);
+    m_lastTimestamp = timestamp;
+    m_numFrames++;
+
+    // Wait on a background thread for GPU to finish copying to readback buffer
+    const int slotIdx = m_nextSlot;
+    Task t("WaitForVideoFrame", TASK_PRIORITY::BACKGROUND, [this, slotIdx]()
+        {
+            WaitObject waitObj;
+            App::GetScene().GetRenderGraph()->SetFrameSubmissionWaitObj(waitObj);
+            waitObj.Wait();
+
+            const uint64_t fence = App::GetScene().GetRenderGraph()->GetFrameCompletionFence();
+            Assert(fence != UINT64_MAX, "Invalid fence value.");
+
+            App::GetRenderer().WaitForDirectQueueFenceCPU(fence);
+            OnFrameReadback(slotIdx);
+        });
+
+    App::SubmitBackground(ZetaMove(t));
+
+    m_nextSlot = (m_nextSlot + 1) % NUM_READBACK_BUFFERS;
+}
+
+void VideoRecorder::CreateSinkWriter()
+{
+    Assert(!m_sinkWriter, "Sink writer hasn't been released.");
+
+    wchar_t widePath[MAX_PATH];
+    Common::CharToWideStr(m_path, widePath);
+
+    // Allows the hardware encoder to be used
+    ComPtr<IMFAttributes> attribs;
+    CheckHR(MFCreateAttributes(attribs.GetAddressOf(), 1));
+    CheckHR(attribs->SetUINT32(MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS, TRUE));
+
+    CheckHR(MFCreateSinkWriterFromURL(widePath, nullptr, attribs.Get(), &m_sinkWriter));
+
+    ComPtr<IMFMediaType> outType;
+    CheckHR(MFCreateMediaType(outType.GetAddressOf()));
+    CheckHR(outType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+    CheckHR(outType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_H264));
+    CheckHR(outType->SetUINT32(MF_MT_AVG_BITRATE, BIT_RATE));
+    CheckHR(outType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+    CheckHR(MFSetAttributeSize(outType.Get(), MF_MT_FRAME_SIZE, m_width, m_height));
+    CheckHR(MFSetAttributeRatio(outType.Get(), MF_MT_FRAME_RATE, FRAME_RATE, 1));
+    CheckHR(MFSetAttributeRatio(outType.Get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1));
+    CheckHR(m_sinkWriter->AddStream(outType.Get(), &m_streamIdx));
+
+    ComPtr<IMFMediaType> inType;
+    CheckHR(MFCreateMediaType(inType.GetAddressOf()));
+    CheckHR(inType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+    CheckHR(inType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12));
+    CheckHR(inType->SetUINT32(MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive));
+    CheckHR(inType->SetUINT32(MF_MT_DEFAULT_STRIDE, m_width));
+    CheckHR(MFSetAttributeSize(inType.Get(), MF_MT_FRAME_SIZE, m_width, m_height));
+    CheckHR(MFSetAttributeRatio(inType.Get(), MF_MT_FRAME_RATE, FRAME_RATE, 1));
+    CheckHR(MFSetAttributeRatio(inType.Get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1));
+    CheckHR(m_sinkWriter->SetInputMediaType(m_streamIdx, inType.Get(), nullptr));
+
+    CheckHR(m_sinkWriter->BeginWriting());
+}
+
+void VideoRecorder::OnFrameReadback(int slotIdx)
+{
+    m_slots[slotIdx].State.store(SLOT_STATE::READY, std::memory_order_release);
+
+    AcquireSRWLockExclusive(&m_encodeLock);
+    EncodeReadyFrames();
+    ReleaseSRWLockExclusive(&m_encodeLock);
+}
+
+void VideoRecorder::EncodeReadyFrames()
+{
+    const uint32_t sizeInBytes = m_width * m_height * 3 / 2;
+
+    // GPU finishes the copies in order, but the waiting tasks may not
+    while (m_slots[m_nextToEncode].State.load(std::memory_order_acquire) == SLOT_STATE::READY)
+    {
+        Slot& slot = m_slots[m_nextToEncode];
+
+        ComPtr<IMFMediaBuffer> buffer;
+        CheckHR(MFCreateMemoryBuffer(sizeInBytes, buffer.GetAddressOf()));
+
+        BYTE* dst;
+        CheckHR(buffer->Lock(&dst, nullptr, nullptr));
+
+        slot.Readback.Map();
+        memcpy(dst, slot.Readback.MappedMemory(), sizeInBytes);
+        slot.Readback.Unmap();
+
+        CheckHR(buffer->Unlock());
+        CheckHR(buffer->SetCurrentLength(sizeInBytes));
+
+        ComPtr<IMFSample> sample;
+        CheckHR(MFCreateSample(sample.GetAddressOf()));
+        CheckHR(sample->AddBuffer(buffer.Get()));
+        CheckHR(sample->SetSampleTime(slot.Timestamp));
+        CheckHR(sample->SetSampleDuration(10'000'000 / FRAME_RATE));
+        CheckHR(m_sinkWriter->WriteSample(m_streamIdx, sample.Get()));
+
+        slot.State.store(SLOT_STATE::FREE, std::memory_order_release);
+        m_nextToEncode = (m_nextToEncode + 1) % NUM_READBACK_BUFFERS;
+
+        m_numPending.fetch_sub(1, std::memory_order_seq_cst);
+        m_numPending.notify_all();
+    }
+
+    if (!m_recording.load(std::memory_order_seq_cst) &&
+        m_numPending.load(std::memory_order_relaxed) == 0 && m_sinkWriter)
+    {
+        Finalize();
+    }
+}
+
+void VideoRecorder::Finalize()
+{
+    Assert(m_sinkWriter, "Sink writer hasn't been created.");
+
+    CheckHR(m_sinkWriter->Finalize());
+    m_sinkWriter->Release();
+    m_sinkWriter = nullptr;
+
+    LOG_UI_INFO("Video saved to: %s (%u frames, %u dropped).\n", m_path, m_numFrames, m_numDropped);
+}
+
+void VideoRecorder::RecordCallback(const ParamVariant& p)
+{
+    if (p.GetBool())
+        Begin();
+    else
+        End();
+}
\ No newline at end of file
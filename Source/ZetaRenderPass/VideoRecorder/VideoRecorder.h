@@ -0,0 +1,114 @@
+#pragma once
+
+#include "../RenderPass.h"
+#include <Core/GpuMemory.h>
+#include "VideoRecorder_Common.h"
+#include <atomic>
+
+struct IMFSinkWriter;
+
+namespace ZetaRay::Core
+{
+    class CommandList;
+    class ComputeCmdList;
+}
+
+namespace ZetaRay::Support
+{
+    struct ParamVariant;
+}
+
+namespace ZetaRay::RenderPass
+{
+    enum class VIDEO_RECORDER_SHADER
+    {
+        RGB_TO_NV12,
+        COUNT
+    };
+
+    // Records the back buffer to an H.264 video. Every frame, the back buffer is converted to
+    // NV12 on the GPU and copied to one of a ring of readback buffers. A background task waits
+    // for the copy and hands the frame to the Media Foundation sink writer, which uses the
+    // hardware encoder when available, so the render thread never waits on the GPU or the
+    // encoder. When all the readback buffers are in use (encoder is falling behind), the frame
+    // is dropped rather than stalling.
+    struct VideoRecorder final : public RenderPassBase<(int)VIDEO_RECORDER_SHADER::COUNT>
+    {
+        VideoRecorder();
+        ~VideoRecorder() = default;
+
+        void InitPSOs();
+        void Init();
+        // Waits for pending frames and finalizes the video, if any
+        void Shutdown();
+        // Starts recording to the given path (.mp4). Without a path, a unique name in the
+        // working directory is used.
+        void Begin(const char* path = nullptr);
+        void End();
+        ZetaInline bool IsRecording() const { return m_recording.load(std::memory_order_relaxed); }
+        // Records the current back buffer, which is expected to be in render target state
+        void Record(Core::CommandList& cmdList);
+
+    private:
+        static constexpr int NUM_CBV = 0;
+        static constexpr int NUM_SRV = 0;
+        static constexpr int NUM_UAV = 1;
+        static constexpr int NUM_GLOBS = 0;
+        static constexpr int NUM_CONSTS = (int)(sizeof(cbVideoRecorder) / sizeof(DWORD));
+        static constexpr int NUM_READBACK_BUFFERS = 3;
+        static constexpr uint32_t FRAME_RATE = 60;
+        static constexpr uint32_t BIT_RATE = 20'000'000;
+        using SHADER = VIDEO_RECORDER_SHADER;
+
+        inline static constexpr const char* COMPILED_CS[(int)SHADER::COUNT] = {
+            "VideoRecorder_cs.cso"
+        };
+
+        enum class SLOT_STATE
+        {
+            FREE,
+            // Copy was recorded, waiting for GPU
+            IN_FLIGHT,
+            // Copy has finished, waiting for encoder
+            READY
+        };
+
+        struct Slot
+        {
+            Core::GpuMemory::ReadbackHeapBuffer Readback;
+            // In 100-nanosecond units, relative to start of recording
+            int64_t Timestamp;
+            std::atomic<SLOT_STATE> State = SLOT_STATE::FREE;
+        };
+
+        void CreateSinkWriter();
+        void OnFrameReadback(int slotIdx);
+        // Encodes ready frames in the order they were recorded. Has to be called with
+        // m_encodeLock held.
+        void EncodeReadyFrames();
+        void Finalize();
+        void RecordCallback(const Support::ParamVariant& p);
+
+        Core::GpuMemory::Buffer m_nv12;
+        Core::DescriptorTable m_descTable;
+        Slot m_slots[NUM_READBACK_BUFFERS];
+        IMFSinkWriter* m_sinkWriter = nullptr;
+        DWORD m_streamIdx = 0;
+        SRWLOCK m_encodeLock = SRWLOCK_INIT;
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+        uint32_t m_backBufferWidth = 0;
+        uint32_t m_backBufferHeight = 0;
+        double m_startTime = 0.0;
+        int64_t m_lastTimestamp = -1;
+        // Next slot to record into / encode from
+        int m_nextSlot = 0;
+        int m_nextToEncode = 0;
+        std::atomic_int32_t m_numPending = 0;
+        uint32_t m_numFrames = 0;
+        uint32_t m_numDropped = 0;
+        char m_path[MAX_PATH] = { '\0' };
+        std::atomic_bool m_recording = false;
+        bool m_mfInitialized = false;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "VideoRecorder_Common.h"
+
+//--------------------------------------------------------------------------------------
+// Root Signature
+//--------------------------------------------------------------------------------------
+
+ConstantBuffer<cbVideoRecorder> g_local : register(b0);
+// NV12: luma plane (Width x Height) followed by interleaved chroma (Width x Height / 2)
+RWByteAddressBuffer g_nv12 : register(u0);
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// BT.709 in limited range. Back buffer is already gamma encoded, so its values can be 
+// used directly.
+float Luma(float3 rgb)
+{
+    return 16.0f + 219.0f * dot(rgb, float3(0.2126f, 0.7152f, 0.0722f));
+}
+
+float2 Chroma(float3 rgb)
+{
+    const float y = dot(rgb, float3(0.2126f, 0.7152f, 0.0722f));
+    return 128.0f + 224.0f * float2((rgb.b - y) / 1.8556f, (rgb.r - y) / 1.5748f);
+}
+
+uint Pack(float4 v)
+{
+    const uint4 b = (uint4)round(clamp(v, 0, 255));
+    return b.x | (b.y << 8) | (b.z << 16) | (b.w << 24);
+}
+
+//--------------------------------------------------------------------------------------
+// Main
+//--------------------------------------------------------------------------------------
+
+[numthreads(VIDEO_RECORDER_GROUP_DIM_X, VIDEO_RECORDER_GROUP_DIM_Y, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    const uint2 topLeft = DTid.xy * uint2(VIDEO_RECORDER_BLOCK_DIM_X, VIDEO_RECORDER_BLOCK_DIM_Y);
+    if (topLeft.x >= g_local.Width || topLeft.y >= g_local.Height)
+        return;
+
+    Texture2D<float4> g_input = ResourceDescriptorHeap[g_local.InputDescHeapIdx];
+    float3 rgb[2][4];
+
+    [unroll]
+    for (int i = 0; i < 2; i++)
+    {
+        [unroll]
+        for (int j = 0; j < 4; j++)
+            rgb[i][j] = g_input[topLeft + uint2(j, i)].rgb;
+    }
+
+    [unroll]
+    for (int r = 0; r < 2; r++)
+    {
+        const float4 y = float4(Luma(rgb[r][0]), Luma(rgb[r][1]), Luma(rgb[r][2]), Luma(rgb[r][3]));
+        g_nv12.Store((topLeft.y + r) * g_local.Width + topLeft.x, Pack(y));
+    }
+
+    // Chroma is subsampled by averaging each 2x2 quad
+    const float3 left = (rgb[0][0] + rgb[0][1] + rgb[1][0] + rgb[1][1]) * 0.25f;
+    const float3 right = (rgb[0][2] + rgb[0][3] + rgb[1][2] + rgb[1][3]) * 0.25f;
+    const uint chromaOffset = g_local.Width * g_local.Height + (topLeft.y >> 1) * g_local.Width + topLeft.x;
+    g_nv12.Store(chromaOffset, Pack(float4(Chroma(left), Chroma(right))));
+}
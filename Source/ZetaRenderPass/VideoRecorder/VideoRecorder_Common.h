@@ -0,0 +1,22 @@
+#ifndef VIDEO_RECORDER_COMMON_H
+#define VIDEO_RECORDER_COMMON_H
+
+#include "../../ZetaCore/Core/HLSLCompat.h"
+
+#define VIDEO_RECORDER_GROUP_DIM_X 8u
+#define VIDEO_RECORDER_GROUP_DIM_Y 8u
+
+// Every thread converts a block of 4x2 pixels, which gives one 32-bit store per row for 
+// luma and one for the interleaved chroma
+#define VIDEO_RECORDER_BLOCK_DIM_X 4u
+#define VIDEO_RECORDER_BLOCK_DIM_Y 2u
+
+struct cbVideoRecorder
+{
+    uint32_t InputDescHeapIdx;
+    // Video dimensions, multiple of block dimensions
+    uint32_t Width;
+    uint32_t Height;
+};
+
+#endif
@@ -1,11 +1,14 @@
 #include "DefaultRenderer.h"
 #include "DefaultRendererImpl.h"
 #include <App/Timer.h>
+#include <App/Log.h>
+#include <Core/RendererCore.h>
 #include <Core/SharedShaderResources.h>
 #include <Support/Task.h>
 #include <Support/Param.h>
 #include <Math/MatrixFuncs.h>
 #include <Scene/Camera.h>
+#include <Display/EXR.h>
 #include "../Assets/Font/IconsFontAwesome6.h"
 
 using namespace ZetaRay;
@@ -22,20 +25,54 @@ using namespace ZetaRay::RenderPass;
 namespace
 {
     Data* g_data = nullptr;
+
+    // Returns GPU time of the last resolved frame (in ms), taken as the busier of the direct and 
+    // compute queues. Render graph node queries already cover all the work when node profiling 
+    // is enabled, so other queries are skipped to avoid counting the same work twice.
+    float GpuFrameTimeMs(Span<GpuTimer::Timing> timings, bool nodeTimings)
+    {
+        const size_t prefixLen = strlen(RenderGraph::NODE_TIMING_PREFIX);
+        double direct = 0.0;
+        double compute = 0.0;
+
+        for (const GpuTimer::Timing& t : timings)
+        {
+            const bool isNode = strncmp(t.Name, RenderGraph::NODE_TIMING_PREFIX, prefixLen) == 0;
+            if (isNode != nodeTimings)
+                continue;
+
+            if (t.ExecutionQueue == D3D12_COMMAND_LIST_TYPE_DIRECT)
+                direct += t.Delta;
+            else
+                compute += t.Delta;
+        }
+
+        return (float)(Max(direct, compute) * 1000.0);
+    }
 }
 
 //--------------------------------------------------------------------------------------
 // DefaultRenderer::Common
 //--------------------------------------------------------------------------------------
 
-void Common::UpdateFrameConstants(cbFrameConstants& frameConsts, Buffer& frameConstsBuff,
+void Common::UpdateFrameConstants(cbFrameConstants& frameConsts, Buffer* frameConstsBuffs,
     const GBufferData& gbuffData, const PathTracerData& rtData)
 {
     auto& renderer = App::GetRenderer();
     const int currIdx = renderer.GlobalIdxForDoubleBufferedResources();
 
     frameConsts.FrameNum = (uint32_t)App::GetTimer().GetTotalFrameCount();
-    frameConsts.dt = (float)App::GetTimer().GetElapsedTime();
+    // Random numbers are seeded with the frame number, so offsetting it gives every 
+    // sample stream its own sequence
+    if (const HeadlessDesc* headless = App::GetHeadlessDesc())
+        frameConsts.FrameNum += headless->SampleStream << 24;
+    // Benchmark runs shouldn't depend on how many frames it took for the scene to load
+    else if (const int64_t benchFrame = App::GetBenchmarkFrame(); benchFrame >= 0)
+        frameConsts.FrameNum = (uint32_t)benchFrame + (App::GetBenchmarkDesc()->Seed << 24);
+    // Replays use the same random numbers as the recorded session
+    else if (const int64_t replayFrame = App::GetReplayFrame(); replayFrame >= 0)
+        frameConsts.FrameNum = (uint32_t)replayFrame;
+    frameConsts.dt = (float)App::GetTimer().GetSimulationDelta();
     frameConsts.RenderWidth = renderer.GetRenderWidth();
     frameConsts.RenderHeight = renderer.GetRenderHeight();
     frameConsts.DisplayWidth = renderer.GetDisplayWidth();
@@ -81,6 +118,7 @@ void Common::UpdateFrameConstants(cbFrameConstants& frameConsts, Buffer& frameCo
     // Frame g-buffer SRV descriptor table
     frameConsts.CurrGBufferDescHeapOffset = gbuffData.SrvDescTable[currIdx].GPUDescriptorHeapIndex();
     frameConsts.PrevGBufferDescHeapOffset = gbuffData.SrvDescTable[1 - currIdx].GPUDescriptorHeapIndex();
+    frameConsts.VisibilityBuffer = gbuffData.VisibilityBuffer;
 
     // Sky-view LUT SRV
     frameConsts.EnvMapDescHeapOffset = rtData.ConstDescTable.GPUDescriptorHeapIndex(
@@ -103,12 +141,37 @@ void Common::UpdateFrameConstants(cbFrameConstants& frameConsts, Buffer& frameCo
 
     frameConsts.NumEmissiveTriangles = (uint32_t)App::GetScene().NumEmissiveTriangles();
     frameConsts.OneDivNumEmissiveTriangles = 1.0f / frameConsts.NumEmissiveTriangles;
+    frameConsts.LightBVHLog2ClusterSize = rtData.PreLightingPass.GetLightBVHLog2ClusterSize();
 
-    if (!frameConstsBuff.IsInitialized())
+    constexpr size_t sizeInBytes = AlignUp(sizeof(cbFrameConstants), 
+        (size_t)D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+    // Written directly to video memory. Frames in flight might still be reading their 
+    // copies, which are reused once the frame that is NUM_BACK_BUFFERS frames behind has
+    // finished (same as the frame upload ring).
+    if (renderer.IsGpuUploadHeapSupported())
     {
-        constexpr size_t sizeInBytes = AlignUp(sizeof(cbFrameConstants), 
-            (size_t)D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+        const auto slot = App::GetTimer().GetTotalFrameCount() % (uint64_t)Constants::NUM_BACK_BUFFERS;
+        Buffer& frameConstsBuff = frameConstsBuffs[slot];
+
+        if (!frameConstsBuff.IsInitialized())
+        {
+            frameConstsBuff = GpuMemory::GetGpuUploadHeapBuffer(GlobalResource::FRAME_CONSTANTS_BUFFER,
+                (uint32_t)sizeInBytes);
+        }
+
+        memcpy(frameConstsBuff.MappedMemory(), &frameConsts, sizeof(cbFrameConstants));
+
+        renderer.GetSharedShaderResources().InsertOrAssignDefaultHeapBuffer(GlobalResource::FRAME_CONSTANTS_BUFFER,
+            frameConstsBuff);
 
+        return;
+    }
+
+    Buffer& frameConstsBuff = frameConstsBuffs[0];
+
+    if (!frameConstsBuff.IsInitialized())
+    {
         frameConstsBuff = GpuMemory::GetDefaultHeapBufferAndInit(GlobalResource::FRAME_CONSTANTS_BUFFER,
             (uint32_t)sizeInBytes,
             false,
@@ -135,6 +198,20 @@ namespace ZetaRay::DefaultRenderer
         g_data->m_settings.Inscattering = p.GetBool();
     }
 
+    void ApplyAA(AA u, float upscaleFactor)
+    {
+        g_data->PendingAA = u;
+
+        if (u == AA::UPSCALER && !g_data->m_postProcessorData.UpscalerPass.IsInitialized())
+            g_data->m_postProcessorData.UpscalerPass.Init();
+
+        App::SetUpscaleFactor(u == AA::UPSCALER ? upscaleFactor : 1.0f);
+
+        g_data->m_dynamicRes.AvgGpuFrameTimeMs = 0.0f;
+        g_data->m_dynamicRes.NumFramesSinceChange = 0;
+        g_data->m_sceneChanged = true;
+    }
+
     void SetAA(const ParamVariant& p)
     {
         const int e = p.GetEnum().m_curr;
@@ -144,27 +221,280 @@ namespace ZetaRay::DefaultRenderer
         if (u == g_data->m_settings.AntiAliasing)
             return;
 
-        float newUpscaleFactor;
-        g_data->PendingAA = u;
+        ApplyAA(u, 1.5f);
+    }
 
-        switch (u)
+    void SetDynamicResolution(const ParamVariant& p)
+    {
+        auto& drs = g_data->m_dynamicRes;
+        drs.Enabled = p.GetBool();
+        drs.AvgGpuFrameTimeMs = 0.0f;
+        drs.NumFramesSinceChange = 0;
+
+        // Go back to the default upscale factor
+        if (!drs.Enabled && g_data->PendingAA == AA::UPSCALER)
+            App::SetUpscaleFactor(1.5f);
+    }
+
+    void SetTargetFrameRate(const ParamVariant& p)
+    {
+        g_data->m_dynamicRes.TargetFrameTimeMs = 1000.0f / p.GetFloat().m_value;
+    }
+
+    void UpdateDynamicResolution()
+    {
+        auto& drs = g_data->m_dynamicRes;
+        auto& gpuTimer = App::GetRenderer().GetGpuTimer();
+        const uint64_t resolvedFrame = gpuTimer.GetNumResolvedFrames();
+
+        // Nothing new since last time
+        if (resolvedFrame == drs.LastResolvedFrame)
+            return;
+
+        drs.LastResolvedFrame = resolvedFrame;
+        auto timings = gpuTimer.GetFrameTimings();
+        if (timings.empty())
+            return;
+
+        const float frameTimeMs = GpuFrameTimeMs(timings, 
+            g_data->m_renderGraph.IsNodeProfilingEnabled());
+        if (frameTimeMs == 0.0f)
+            return;
+
+        drs.AvgGpuFrameTimeMs = drs.AvgGpuFrameTimeMs == 0.0f ? frameTimeMs :
+            drs.AvgGpuFrameTimeMs + DynamicResolution::EMA_ALPHA * (frameTimeMs - drs.AvgGpuFrameTimeMs);
+
+        // Give the moving average time to settle after a resolution change
+        if (++drs.NumFramesSinceChange < DynamicResolution::MIN_FRAMES_BETWEEN_CHANGES)
+            return;
+
+        const float ratio = drs.AvgGpuFrameTimeMs / drs.TargetFrameTimeMs;
+        if (ratio >= DynamicResolution::LOWER_THRESHOLD && ratio <= DynamicResolution::UPPER_THRESHOLD)
+            return;
+
+        // Cost is roughly proportional to number of pixels, i.e. square of the upscale factor
+        const float currFactor = App::GetUpscalingFactor();
+        float newFactor = currFactor * sqrtf(ratio);
+        newFactor = roundf(newFactor / DynamicResolution::UPSCALE_FACTOR_STEP) * 
+            DynamicResolution::UPSCALE_FACTOR_STEP;
+        newFactor = Min(Max(newFactor, DynamicResolution::MIN_UPSCALE_FACTOR), 
+            DynamicResolution::MAX_UPSCALE_FACTOR);
+
+        if (newFactor != currFactor)
         {
-        case AA::FSR2:
-            if (!g_data->m_postProcessorData.Fsr2Pass.IsInitialized())
-                g_data->m_postProcessorData.Fsr2Pass.Init();
-
-            newUpscaleFactor = 1.5f;
-            break;
-        case AA::NONE:
-        case AA::TAA:
-        default:
-            newUpscaleFactor = 1.0f;
-            break;
+            App::SetUpscaleFactor(newFactor);
+            drs.NumFramesSinceChange = 0;
         }
+    }
 
-        App::SetUpscaleFactor(newUpscaleFactor);
+    void SetHeadlessTile(const HeadlessDesc& headless, uint32_t tile)
+    {
+        const auto& tiles = g_data->m_headlessTiles;
+        const int tileX = (int)(tile % tiles.NumTilesX);
+        const int tileY = (int)(tile / tiles.NumTilesX);
+
+        // Render target includes the apron on every side. Camera change restarts accumulation.
+        App::SetCameraTile(headless.Width, headless.Height, 
+            tileX * headless.TileSize - headless.TileApron,
+            tileY * headless.TileSize - headless.TileApron);
+    }
 
-        g_data->m_sceneChanged = true;
+    void InitHeadlessTiles(const HeadlessDesc& headless)
+    {
+        auto& tiles = g_data->m_headlessTiles;
+        tiles.NumTilesX = (headless.Width + headless.TileSize - 1) / headless.TileSize;
+        tiles.NumTilesY = (headless.Height + headless.TileSize - 1) / headless.TileSize;
+        tiles.CurrTile = 0;
+        tiles.Row.resize_uninitialized((size_t)headless.Width * headless.TileSize * sizeof(float4));
+
+        EXR::BeginFile(headless.OutputPath, headless.Width, headless.Height);
+        SetHeadlessTile(headless, 0);
+
+        LOG_UI(INFO, "Rendering %ux%u tiles of size %u (+%u apron)", tiles.NumTilesX, tiles.NumTilesY, 
+            headless.TileSize, headless.TileApron);
+    }
+
+    // Called from a background thread
+    void OnHeadlessTileReadback(const ScreenCapture& capture)
+    {
+        const HeadlessDesc& headless = *App::GetHeadlessDesc();
+        auto& tiles = g_data->m_headlessTiles;
+        const uint32_t tileX = tiles.CurrTile % tiles.NumTilesX;
+        const uint32_t tileY = tiles.CurrTile / tiles.NumTilesX;
+        const uint32_t x0 = tileX * headless.TileSize;
+        const uint32_t y0 = tileY * headless.TileSize;
+        // Tiles on the right and bottom edges may extend past the image
+        const uint32_t w = Min((uint32_t)headless.TileSize, headless.Width - x0);
+        const uint32_t h = Min((uint32_t)headless.TileSize, headless.Height - y0);
+        const uint32_t rowPitch = headless.Width * sizeof(float4);
+
+        // Crop the apron
+        for (uint32_t y = 0; y < h; y++)
+        {
+            const uint8_t* src = capture.Data + (headless.TileApron + y) * capture.RowPitch + 
+                headless.TileApron * sizeof(float4);
+            memcpy(tiles.Row.data() + y * rowPitch + x0 * sizeof(float4), src, w * sizeof(float4));
+        }
+
+        if (tileX == tiles.NumTilesX - 1)
+            EXR::AppendScanlines(headless.OutputPath, headless.Width, y0, h, tiles.Row.data(), rowPitch);
+
+        tiles.ReadbackDone.store(true, std::memory_order_release);
+    }
+
+    // Renders tiles one at a time, moving on to the next one after the previous one has been 
+    // read back. This way, readback buffer is never in use by two captures at the same time.
+    void UpdateHeadlessTiled(const HeadlessDesc& headless)
+    {
+        auto& tiles = g_data->m_headlessTiles;
+
+        if (tiles.CaptureIssued)
+        {
+            if (!tiles.ReadbackDone.load(std::memory_order_acquire))
+                return;
+
+            tiles.ReadbackDone.store(false, std::memory_order_relaxed);
+            tiles.CaptureIssued = false;
+
+            if (++tiles.CurrTile == tiles.NumTilesX * tiles.NumTilesY)
+            {
+                LOG_UI(INFO, "Image saved to: %s.", headless.OutputPath);
+                App::RequestExit();
+            }
+            else
+                SetHeadlessTile(headless, tiles.CurrTile);
+
+            return;
+        }
+
+        if (g_data->m_frameConstants.NumFramesCameraStatic < headless.NumSamples)
+            return;
+
+        const Texture& composited = g_data->m_postProcessorData.CompositingPass.GetOutput(
+            Compositing::SHADER_OUT_RES::COMPOSITED);
+        g_data->m_postProcessorData.DisplayPass.CaptureScreenToMemory(&composited, 
+            fastdelegate::FastDelegate1<const ScreenCapture&>(&OnHeadlessTileReadback));
+        tiles.CaptureIssued = true;
+
+        LOG_UI(INFO, "Tile %u/%u done after %.2f [s]", tiles.CurrTile + 1, tiles.NumTilesX * tiles.NumTilesY,
+            (float)App::GetTimer().GetTotalTime());
+    }
+
+    // Called from a background thread
+    void OnHeadlessDenoiseReadback(const ScreenCapture& capture)
+    {
+        const HeadlessDesc& headless = *App::GetHeadlessDesc();
+        auto& denoise = g_data->m_headlessDenoise;
+        const float change = HeadlessDenoiser::Denoise(capture);
+        const bool converged = change < headless.DenoiseThreshold;
+
+        if (change != FLT_MAX)
+        {
+            LOG_UI(INFO, "Denoised checkpoint at %u samples per pixel, relative change: %.4f", 
+                denoise.CheckpointSamples, change);
+        }
+
+        denoise.Finished = converged || denoise.FinalCheckpoint;
+
+        if (denoise.Finished)
+        {
+            HeadlessDenoiser::Write(headless.OutputPath);
+            LOG_UI(INFO, "Denoised image (%u samples per pixel) saved to: %s.", denoise.CheckpointSamples,
+                headless.OutputPath);
+        }
+
+        denoise.CheckpointDone.store(true, std::memory_order_release);
+
+        if (denoise.Finished)
+            App::FinishHeadlessJob();
+    }
+
+    // Accumulated image is denoised every DenoiseCheckpoint samples, until the denoised 
+    // image stops changing or the requested number of samples is reached
+    void UpdateHeadlessDenoise(const HeadlessDesc& headless)
+    {
+        auto& denoise = g_data->m_headlessDenoise;
+
+        if (denoise.CheckpointIssued)
+        {
+            if (!denoise.CheckpointDone.load(std::memory_order_acquire))
+                return;
+
+            denoise.CheckpointDone.store(false, std::memory_order_relaxed);
+            denoise.CheckpointIssued = false;
+
+            if (denoise.Finished)
+            {
+                g_data->m_headlessCaptureIssued = true;
+                return;
+            }
+        }
+
+        const uint32_t numSamples = g_data->m_frameConstants.NumFramesCameraStatic;
+        denoise.FinalCheckpoint = numSamples >= headless.NumSamples;
+
+        if (numSamples < denoise.NextCheckpoint && !denoise.FinalCheckpoint)
+            return;
+
+        // Rendering keeps going while the previous checkpoint is denoised, so checkpoints 
+        // may be further apart than requested
+        denoise.NextCheckpoint = numSamples + headless.DenoiseCheckpoint;
+        denoise.CheckpointSamples = numSamples;
+
+        const auto& compositing = g_data->m_postProcessorData.CompositingPass;
+        const Texture* sources[] = {
+            &compositing.GetOutput(Compositing::SHADER_OUT_RES::COMPOSITED),
+            &compositing.GetOutput(Compositing::SHADER_OUT_RES::DENOISER_ALBEDO),
+            &compositing.GetOutput(Compositing::SHADER_OUT_RES::DENOISER_NORMAL) };
+        g_data->m_postProcessorData.DisplayPass.CaptureScreenToMemory(sources,
+            fastdelegate::FastDelegate1<const ScreenCapture&>(&OnHeadlessDenoiseReadback));
+        denoise.CheckpointIssued = true;
+    }
+
+    // Writes the result to disk once the requested number of samples have been 
+    // accumulated. Capture is issued before rendering starts, so it includes this frame.
+    void UpdateHeadless(const HeadlessDesc& headless)
+    {
+        if (headless.IsTiled())
+        {
+            UpdateHeadlessTiled(headless);
+            return;
+        }
+
+        // Next queued job has started
+        if (g_data->m_headlessJob != App::GetHeadlessJobIndex())
+        {
+            g_data->m_headlessJob = App::GetHeadlessJobIndex();
+            g_data->m_headlessCaptureIssued = false;
+
+            auto& denoise = g_data->m_headlessDenoise;
+            denoise.NextCheckpoint = headless.DenoiseCheckpoint;
+            denoise.CheckpointIssued = false;
+            denoise.CheckpointDone.store(false, std::memory_order_relaxed);
+            HeadlessDenoiser::Reset();
+        }
+
+        if (g_data->m_settings.HeadlessDenoise && !g_data->m_headlessCaptureIssued)
+        {
+            UpdateHeadlessDenoise(headless);
+            return;
+        }
+
+        if (g_data->m_headlessCaptureIssued || 
+            g_data->m_frameConstants.NumFramesCameraStatic < headless.NumSamples)
+        {
+            return;
+        }
+
+        // No AA in headless mode, so display and compositing outputs match
+        const Texture& composited = g_data->m_postProcessorData.CompositingPass.GetOutput(
+            Compositing::SHADER_OUT_RES::COMPOSITED);
+        g_data->m_postProcessorData.DisplayPass.CaptureScreen(headless.OutputPath, &composited, 
+            fastdelegate::FastDelegate0<>(&App::FinishHeadlessJob));
+        g_data->m_headlessCaptureIssued = true;
+
+        LOG_UI(INFO, "Accumulated %u samples per pixel in %.2f [s]", headless.NumSamples,
+            (float)App::GetTimer().GetTotalTime());
     }
 
     void SetSunDir(const ParamVariant& p)
@@ -173,12 +503,14 @@ namespace ZetaRay::DefaultRenderer
         float yaw = p.GetUnitDir().m_yaw;
         g_data->m_frameConstants.SunDir = -Math::SphericalToCartesian(pitch, yaw);
         g_data->m_sunMoved = true;
+        g_data->m_pathTracerData.SkyPass.SetSkyChanged();
     }
 
     void SetSunLux(const ParamVariant& p)
     {
         g_data->m_frameConstants.SunIlluminance = p.GetFloat().m_value;
         g_data->m_sunMoved = true;
+        g_data->m_pathTracerData.SkyPass.SetSkyChanged();
     }
 
     void SetSunAngularDiameter(const ParamVariant& p)
@@ -192,42 +524,49 @@ namespace ZetaRay::DefaultRenderer
     {
         g_data->m_frameConstants.RayleighSigmaSColor = p.GetFloat3().m_value;
         g_data->m_sceneChanged = true;
+        g_data->m_pathTracerData.SkyPass.SetSkyChanged();
     }
 
     void SetRayleighSigmaSScale(const ParamVariant& p)
     {
         g_data->m_frameConstants.RayleighSigmaSScale = p.GetFloat().m_value;
         g_data->m_sceneChanged = true;
+        g_data->m_pathTracerData.SkyPass.SetSkyChanged();
     }
 
     void SetMieSigmaS(const ParamVariant& p)
     {
         g_data->m_frameConstants.MieSigmaS = p.GetFloat().m_value;
         g_data->m_sceneChanged = true;
+        g_data->m_pathTracerData.SkyPass.SetSkyChanged();
     }
 
     void SetMieSigmaA(const ParamVariant& p)
     {
         g_data->m_frameConstants.MieSigmaA = p.GetFloat().m_value;
         g_data->m_sceneChanged = true;
+        g_data->m_pathTracerData.SkyPass.SetSkyChanged();
     }
 
     void SetOzoneSigmaAColor(const ParamVariant& p)
     {
         g_data->m_frameConstants.OzoneSigmaAColor = p.GetColor().m_value;
         g_data->m_sceneChanged = true;
+        g_data->m_pathTracerData.SkyPass.SetSkyChanged();
     }
 
     void SetOzoneSigmaAScale(const ParamVariant& p)
     {
         g_data->m_frameConstants.OzoneSigmaAScale = p.GetFloat().m_value;
         g_data->m_sceneChanged = true;
+        g_data->m_pathTracerData.SkyPass.SetSkyChanged();
     }
 
     void SetgForPhaseHG(const ParamVariant& p)
     {
         g_data->m_frameConstants.g = p.GetFloat().m_value;
         g_data->m_sceneChanged = true;
+        g_data->m_pathTracerData.SkyPass.SetSkyChanged();
     }
 
     void SetAccumulation(const ParamVariant& p)
@@ -250,6 +589,177 @@ namespace ZetaRay::DefaultRenderer
         g_data->m_frameConstants.DoF = p.GetEnum().m_curr;
         g_data->m_sceneChanged = true;
     }
+
+    void SetAutoAsyncCompute(const ParamVariant& p)
+    {
+        g_data->m_renderGraph.SetAutoAsyncCompute(p.GetBool());
+    }
+
+    void SetNodeProfiling(const ParamVariant& p)
+    {
+        g_data->m_renderGraph.SetNodeProfiling(p.GetBool());
+    }
+
+    void SetAsyncASBuild(const ParamVariant& p)
+    {
+        g_data->m_settings.AsyncASBuild = p.GetBool();
+    }
+
+    void SetLightBVH(const ParamVariant& p)
+    {
+        g_data->m_settings.UseLightBVH = p.GetBool();
+        g_data->m_sceneChanged = true;
+    }
+
+    void SetLightBVHClusters(const ParamVariant& p)
+    {
+        g_data->m_settings.LightBVHClusters = p.GetBool();
+        g_data->m_sceneChanged = true;
+    }
+
+    void SetLVG(const ParamVariant& p)
+    {
+        g_data->m_settings.UseLVG = p.GetBool();
+        g_data->m_sceneChanged = true;
+    }
+
+    void SetViewDependentPresampling(const ParamVariant& p)
+    {
+        g_data->m_settings.ViewDependentPresampling = p.GetBool();
+    }
+
+    void SetSparseResampling(const ParamVariant& p)
+    {
+        const int e = p.GetEnum().m_curr;
+        Assert(e < (int)(ZetaArrayLen(SparseResamplingOptions)), "Invalid enum value.");
+        g_data->m_settings.ResamplingInterval = 1u << e;
+    }
+
+    void SetPerformanceTier(const ParamVariant& p);
+
+    // Params for the settings that are overridden by performance tiers. Readding them 
+    // replaces the old ones, so that UI shows the new values.
+    void AddTierDependentParams()
+    {
+        ParamVariant tier;
+        tier.InitEnum(ICON_FA_FILM " Renderer", "Performance", "Tier",
+            fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetPerformanceTier),
+            PerfTierOptions, ZetaArrayLen(PerfTierOptions), (int)g_data->m_perfTier.Tier);
+        App::AddParam(tier);
+
+        ParamVariant aa;
+        aa.InitEnum(ICON_FA_FILM " Renderer", "Anti-Aliasing", "Method",
+            fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetAA),
+            AAOptions, ZetaArrayLen(AAOptions), (int)g_data->PendingAA);
+        App::AddParam(aa);
+
+        ParamVariant integrator;
+        integrator.InitEnum(ICON_FA_FILM " Renderer", "Indirect Lighting", "Integrator",
+            fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetIndirect),
+            IndirectOptions, ZetaArrayLen(IndirectOptions), (int)g_data->m_settings.Indirect);
+        App::AddParam(integrator);
+
+        ParamVariant lvg;
+        lvg.InitBool(ICON_FA_FILM " Renderer", "Light Sampling", "Light Voxel Grid",
+            fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetLVG),
+            g_data->m_settings.UseLVG);
+        App::AddParam(lvg);
+
+        ParamVariant sparse;
+        sparse.InitEnum(ICON_FA_FILM " Renderer", "Light Sampling", "Sparse Resampling",
+            fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetSparseResampling),
+            SparseResamplingOptions, ZetaArrayLen(SparseResamplingOptions), 
+            (int)(g_data->m_settings.ResamplingInterval >> 1));
+        App::AddParam(sparse);
+    }
+
+    // Called before the passes are initialized during startup, the rest are applied in 
+    // the next update
+    void ApplyPerformanceTier(bool initialized)
+    {
+        const PerformanceTier::Preset& preset = PerformanceTier::PRESETS[(int)g_data->m_perfTier.Tier];
+        auto& settings = g_data->m_settings;
+
+        if (settings.Indirect != preset.Indirect)
+        {
+            settings.Indirect = preset.Indirect;
+            if (initialized)
+                g_data->m_pathTracerData.IndirecLightingPass.SetMethod(settings.Indirect);
+        }
+
+        settings.ResamplingInterval = preset.ResamplingInterval;
+        settings.UseLVG = preset.UseLVG;
+        // LVG buffer is only allocated when LVG is toggled, so grid can't be resized afterwards
+        if (!initialized)
+            settings.VoxelGridDim = preset.VoxelGridDim;
+
+        if (preset.AntiAliasing != g_data->PendingAA || 
+            (preset.AntiAliasing == AA::UPSCALER && preset.UpscaleFactor != App::GetUpscalingFactor()))
+        {
+            ApplyAA(preset.AntiAliasing, preset.UpscaleFactor);
+        }
+
+        g_data->m_sceneChanged = true;
+
+        if (initialized)
+            AddTierDependentParams();
+    }
+
+    void SetPerformanceTier(const ParamVariant& p)
+    {
+        const int e = p.GetEnum().m_curr;
+        Assert(e < (int)PERF_TIER::COUNT, "Invalid enum value.");
+
+        // Manual choice takes precedence over calibration
+        g_data->m_perfTier.Tier = (PERF_TIER)e;
+        g_data->m_perfTier.Calibrating = false;
+        PerfTier::Save(g_data->m_perfTier);
+
+        ApplyPerformanceTier(true);
+    }
+
+    void UpdatePerfTierCalibration()
+    {
+        auto& perfTier = g_data->m_perfTier;
+        auto& gpuTimer = App::GetRenderer().GetGpuTimer();
+        const uint64_t resolvedFrame = gpuTimer.GetNumResolvedFrames();
+
+        if (resolvedFrame == perfTier.LastResolvedFrame)
+            return;
+
+        perfTier.LastResolvedFrame = resolvedFrame;
+        auto timings = gpuTimer.GetFrameTimings();
+        if (timings.empty())
+            return;
+
+        const float frameTimeMs = GpuFrameTimeMs(timings, 
+            g_data->m_renderGraph.IsNodeProfilingEnabled());
+        if (frameTimeMs == 0.0f)
+            return;
+
+        if (PerfTier::Calibrate(perfTier, frameTimeMs))
+            ApplyPerformanceTier(true);
+    }
+
+    void SetVisibilityBuffer(const ParamVariant& p)
+    {
+        // G-buffers are recreated during next update
+        g_data->m_settings.VisibilityBuffer = p.GetBool();
+        g_data->m_pathTracerData.IndirecLightingPass.ResetTemporal();
+        g_data->m_sceneChanged = true;
+    }
+
+    void SetRasterVisibility(const ParamVariant& p)
+    {
+        g_data->m_settings.RasterVisibility = p.GetBool();
+    }
+
+    void SetDenoiseIndirect(const ParamVariant& p)
+    {
+        // History is outdated when denoiser was turned off in-between
+        g_data->m_settings.DenoiseIndirect = p.GetBool();
+        g_data->m_pathTracerData.IndirectDenoiserPass.ResetTemporal();
+    }
 }
 
 namespace ZetaRay::DefaultRenderer
@@ -259,6 +769,63 @@ namespace ZetaRay::DefaultRenderer
         Assert(g_data->PendingAA == g_data->m_settings.AntiAliasing, "These must match.");
         memset(&g_data->m_frameConstants, 0, sizeof(cbFrameConstants));
 
+        // Offline rendering with progressive accumulation
+        if (const HeadlessDesc* headless = App::GetHeadlessDesc())
+        {
+            g_data->m_settings.Indirect = IndirectLighting::INTEGRATOR::PATH_TRACING;
+            g_data->m_settings.AntiAliasing = AA::NONE;
+            g_data->PendingAA = AA::NONE;
+
+            if (headless->IsTiled())
+                InitHeadlessTiles(*headless);
+
+            if (headless->DenoiseCheckpoint)
+            {
+                if (HeadlessDenoiser::IsAvailable())
+                {
+                    g_data->m_settings.HeadlessDenoise = true;
+                    g_data->m_headlessDenoise.NextCheckpoint = headless->DenoiseCheckpoint;
+                }
+                else
+                    LOG_UI(WARNING, "Built without Open Image Denoise (ZETA_OIDN), denoising is ignored.");
+            }
+        }
+        else if (const BenchmarkDesc* benchmark = App::GetBenchmarkDesc())
+        {
+            // Measurements should be repeatable, so tiers are never calibrated and only 
+            // applied when asked for
+            if (benchmark->Preset)
+            {
+                int t = 0;
+                while (t < ZetaArrayLen(PerfTierOptions) && _stricmp(benchmark->Preset, PerfTierOptions[t]) != 0)
+                    t++;
+
+                Check(t < ZetaArrayLen(PerfTierOptions), "Unknown preset: %s.", benchmark->Preset);
+                g_data->m_perfTier.Tier = (PERF_TIER)t;
+                ApplyPerformanceTier(false);
+            }
+
+            if (benchmark->Integrator)
+            {
+                // Same camera path can be measured with each integrator
+                const char* integrators[] = { "path_tracing", "restir_gi", "restir_pt",
+                    "probe_volume" };
+                static_assert(ZetaArrayLen(integrators) == (int)IndirectLighting::INTEGRATOR::COUNT, 
+                    "enum <-> string mismatch.");
+                int i = 0;
+                while (i < ZetaArrayLen(integrators) && _stricmp(benchmark->Integrator, integrators[i]) != 0)
+                    i++;
+
+                Check(i < ZetaArrayLen(integrators), "Unknown integrator: %s.", benchmark->Integrator);
+                g_data->m_settings.Indirect = (IndirectLighting::INTEGRATOR)i;
+            }
+        }
+        else
+        {
+            PerfTier::Init(g_data->m_perfTier);
+            ApplyPerformanceTier(false);
+        }
+
         g_data->m_renderGraph.Reset();
 
         const Camera& cam = App::GetCamera();
@@ -307,24 +874,28 @@ namespace ZetaRay::DefaultRenderer
         g_data->m_frameConstants.MieSigmaA = Defaults::SIGMA_A_MIE;
         g_data->m_frameConstants.MieSigmaS = Defaults::SIGMA_S_MIE;
 
+        // Every pass is initialized by a separate task, so that they can create their resources 
+        // and PSOs in parallel while the scene is loading
         TaskSet ts;
-        ts.EmplaceTask("GBuffer_Init", []()
-            {
-                GBuffer::Init(g_data->m_settings, g_data->m_gbuffData);
-            });
-        ts.EmplaceTask("PathTracer_Init", []()
-            {
-                PathTracer::Init(g_data->m_settings, g_data->m_pathTracerData);
-            });
-        ts.EmplaceTask("PostProcessor_Init", []()
+        GBuffer::Init(g_data->m_settings, g_data->m_gbuffData, ts);
+        PathTracer::Init(g_data->m_settings, g_data->m_pathTracerData, ts);
+        PostProcessor::Init(g_data->m_settings, g_data->m_postProcessorData, ts);
+
+        // Render passes only queue their PSOs during initialization, compile all of them 
+        // together once every pass is done
+        auto buildPSOs = ts.EmplaceTask("BuildPSOs", []()
             {
-                PostProcessor::Init(g_data->m_settings, g_data->m_postProcessorData);
+                PipelineStateLibrary::BuildQueuedPSOs();
             });
+        ts.AddIncomingEdgeFromAll(buildPSOs);
 
         ts.Sort();
         ts.Finalize();
         App::Submit(ZetaMove(ts));
 
+        GpuMemory::RegisterMemoryPressureCallback(fastdelegate::MakeDelegate(
+            &g_data->m_pathTracerData.RtAS, &RT::TLAS::OnMemoryPressure));
+
         // Render settings
         {
             //ParamVariant enableInscattering;
@@ -333,11 +904,19 @@ namespace ZetaRay::DefaultRenderer
             //    g_data->m_settings.Inscattering);
             //App::AddParam(enableInscattering);
 
-            ParamVariant p;
-            p.InitEnum(ICON_FA_FILM " Renderer", "Anti-Aliasing", "Method",
-                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetAA),
-                AAOptions, ZetaArrayLen(AAOptions), (int)g_data->m_settings.AntiAliasing);
-            App::AddParam(p);
+            AddTierDependentParams();
+
+            ParamVariant drs;
+            drs.InitBool(ICON_FA_FILM " Renderer", "Anti-Aliasing", "Dynamic Resolution (Upscaler)",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetDynamicResolution),
+                g_data->m_dynamicRes.Enabled);
+            App::AddParam(drs);
+
+            ParamVariant targetFps;
+            targetFps.InitFloat(ICON_FA_FILM " Renderer", "Anti-Aliasing", "Target FPS",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetTargetFrameRate),
+                1000.0f / g_data->m_dynamicRes.TargetFrameTimeMs, 30.0f, 240.0f, 1.0f);
+            App::AddParam(targetFps);
 
             ParamVariant p1;
             p1.InitBool(ICON_FA_FILM " Renderer", "Compositing", "Accumulate",
@@ -345,20 +924,72 @@ namespace ZetaRay::DefaultRenderer
                 g_data->m_frameConstants.Accumulate);
             App::AddParam(p1);
 
-            ParamVariant p2;
-            p2.InitEnum(ICON_FA_FILM " Renderer", "Indirect Lighting", "Integrator",
-                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetIndirect),
-                IndirectOptions, ZetaArrayLen(IndirectOptions), (int)g_data->m_settings.Indirect);
-            App::AddParam(p2);
-
             ParamVariant p3;
             p3.InitEnum(ICON_FA_LANDMARK " Scene", "Camera", "Type",
                 fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetLensType),
                 LensTypes, ZetaArrayLen(LensTypes), 0, "Lens");
             App::AddParam(p3);
 
+            ParamVariant p4;
+            p4.InitBool(ICON_FA_FILM " Renderer", "Render Graph", "Auto Async Compute",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetAutoAsyncCompute),
+                g_data->m_renderGraph.IsAutoAsyncComputeEnabled());
+            App::AddParam(p4);
+
+            ParamVariant p5;
+            p5.InitBool(ICON_FA_FILM " Renderer", "Render Graph", "Profile Render Nodes",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetNodeProfiling),
+                g_data->m_renderGraph.IsNodeProfilingEnabled());
+            App::AddParam(p5);
+
+            ParamVariant p6;
+            p6.InitBool(ICON_FA_FILM " Renderer", "Render Graph", "Async Compute AS Build",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetAsyncASBuild),
+                g_data->m_settings.AsyncASBuild);
+            App::AddParam(p6);
+
+            ParamVariant p7;
+            p7.InitBool(ICON_FA_FILM " Renderer", "Light Sampling", "Light BVH",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetLightBVH),
+                g_data->m_settings.UseLightBVH);
+            App::AddParam(p7);
+
+            ParamVariant p8;
+            p8.InitBool(ICON_FA_FILM " Renderer", "GBuffer", "Visibility Buffer",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetVisibilityBuffer),
+                g_data->m_settings.VisibilityBuffer);
+            App::AddParam(p8);
+
+            if (App::GetRenderer().IsMeshShaderSupported())
+            {
+                ParamVariant p9;
+                p9.InitBool(ICON_FA_FILM " Renderer", "GBuffer", "Raster Primary Visibility",
+                    fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetRasterVisibility),
+                    g_data->m_settings.RasterVisibility);
+                App::AddParam(p9);
+            }
+
+            ParamVariant p11;
+            p11.InitBool(ICON_FA_FILM " Renderer", "Light Sampling", "View-Dependent Presampling",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetViewDependentPresampling),
+                g_data->m_settings.ViewDependentPresampling);
+            App::AddParam(p11);
+
+            ParamVariant p12;
+            p12.InitBool(ICON_FA_FILM " Renderer", "Light Sampling", "Light BVH Clusters",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetLightBVHClusters),
+                g_data->m_settings.LightBVHClusters);
+            App::AddParam(p12);
+
+            ParamVariant p13;
+            p13.InitBool(ICON_FA_FILM " Renderer", "Denoiser", "Denoise Indirect",
+                fastdelegate::FastDelegate1<const ParamVariant&>(&DefaultRenderer::SetDenoiseIndirect),
+                g_data->m_settings.DenoiseIndirect);
+            App::AddParam(p13);
+
             const auto& scene = App::GetScene();
-            g_data->m_settings.LightPresampling = scene.EmissiveLighting() && 
+            g_data->m_settings.LightPresampling = !g_data->m_settings.UseLightBVH &&
+                scene.EmissiveLighting() && 
                 (scene.NumEmissiveTriangles() >= Defaults::MIN_NUM_LIGHTS_PRESAMPLING);
             g_data->m_settings.UseLVG = g_data->m_settings.UseLVG && g_data->m_settings.LightPresampling;
         }
@@ -433,10 +1064,24 @@ namespace ZetaRay::DefaultRenderer
     void Update(TaskSet& ts)
     {
         g_data->m_settings.AntiAliasing = g_data->PendingAA;
+
+        if (g_data->m_settings.AntiAliasing == AA::UPSCALER && g_data->m_dynamicRes.Enabled)
+            UpdateDynamicResolution();
+
+        if (g_data->m_perfTier.Calibrating && g_data->m_pathTracerData.RtAS.IsReady())
+            UpdatePerfTierCalibration();
+
+        // Samples are only counted once the scene can be ray traced
+        const HeadlessDesc* headless = App::GetHeadlessDesc();
+        if (headless && !g_data->m_pathTracerData.RtAS.IsReady())
+            g_data->m_sceneChanged = true;
+
         const auto frame = App::GetTimer().GetTotalFrameCount();
         const auto& scene = App::GetScene();
 
-        g_data->m_settings.LightPresampling = scene.EmissiveLighting() && 
+        // Light BVH replaces presampled sets when enabled
+        g_data->m_settings.LightPresampling = !g_data->m_settings.UseLightBVH &&
+            scene.EmissiveLighting() && 
             App::GetScene().NumEmissiveTriangles() >= Defaults::MIN_NUM_LIGHTS_PRESAMPLING;
 
         if (frame <= 1)
@@ -447,6 +1092,7 @@ namespace ZetaRay::DefaultRenderer
 
                 // Move the sun below the horizon when there are emissives
                 g_data->m_frameConstants.SunDir = float3(0.0f, 1.0f, 0.0f);
+                g_data->m_pathTracerData.SkyPass.SetSkyChanged();
 
                 // HACK UI params can't be modified from outside - remove then readd
                 App::RemoveParam(ICON_FA_LANDMARK " Scene", "Sun", "(-)Dir");
@@ -470,6 +1116,14 @@ namespace ZetaRay::DefaultRenderer
                 Defaults::NUM_SAMPLE_SETS, Defaults::SAMPLE_SET_SIZE);
             g_data->m_pathTracerData.IndirecLightingPass.SetLightPresamplingParams(true,
                 Defaults::NUM_SAMPLE_SETS, Defaults::SAMPLE_SET_SIZE);
+
+            // Light voxel grid is resampled from the alias table and falls back to 
+            // presampled sets outside the grid
+            const auto& s = g_data->m_settings;
+            g_data->m_pathTracerData.PreLightingPass.SetLightVoxelGridParams(s.UseLVG,
+                s.VoxelGridDim, s.VoxelExtents, s.VoxelGridyOffset);
+            g_data->m_pathTracerData.IndirecLightingPass.SetLightVoxelGridParams(s.UseLVG,
+                s.VoxelGridDim, s.VoxelExtents, s.VoxelGridyOffset);
         }
         else
         {
@@ -477,16 +1131,28 @@ namespace ZetaRay::DefaultRenderer
                 Defaults::MIN_NUM_LIGHTS_PRESAMPLING, 0, 0);
             g_data->m_pathTracerData.IndirecLightingPass.SetLightPresamplingParams(false,
                 0, 0);
+
+            const auto& s = g_data->m_settings;
+            g_data->m_pathTracerData.PreLightingPass.SetLightVoxelGridParams(false,
+                s.VoxelGridDim, s.VoxelExtents, s.VoxelGridyOffset);
+            g_data->m_pathTracerData.IndirecLightingPass.SetLightVoxelGridParams(false,
+                s.VoxelGridDim, s.VoxelExtents, s.VoxelGridyOffset);
         }
 
         auto h0 = ts.EmplaceTask("SceneRenderer::UpdatePasses", []()
             {
-                GBuffer::Update(g_data->m_gbuffData);
+                GBuffer::Update(g_data->m_settings, g_data->m_gbuffData, 
+                    g_data->m_frameConstants.DoF != 0);
                 PathTracer::Update(g_data->m_settings, g_data->m_renderGraph, g_data->m_pathTracerData);
                 PostProcessor::Update(g_data->m_settings, g_data->m_postProcessorData, g_data->m_gbuffData,
                     g_data->m_pathTracerData);
+                // Passes that were initialized during update (e.g. after a setting change)
+                PipelineStateLibrary::BuildQueuedPSOs();
                 Common::UpdateFrameConstants(g_data->m_frameConstants, g_data->m_frameConstantsBuff, g_data->m_gbuffData, 
                     g_data->m_pathTracerData);
+
+                if (const HeadlessDesc* headless = App::GetHeadlessDesc())
+                    UpdateHeadless(*headless);
             });
 
         auto h3 = ts.EmplaceTask("SceneRenderer::RenderGraph", []()
@@ -518,7 +1184,13 @@ namespace ZetaRay::DefaultRenderer
 
     void Shutdown()
     {
+        GpuMemory::UnregisterMemoryPressureCallback(fastdelegate::MakeDelegate(
+            &g_data->m_pathTracerData.RtAS, &RT::TLAS::OnMemoryPressure));
+
+        // Frames that are still being encoded need the render graph
+        g_data->m_postProcessorData.DisplayPass.Shutdown();
         g_data->m_renderGraph.Shutdown();
+        HeadlessDenoiser::Shutdown();
 
         // At this point, GPU has been flushed, so extra synchronization is not needed
         delete g_data;
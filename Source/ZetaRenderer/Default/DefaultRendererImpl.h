@@ -2,8 +2,10 @@
 
 #include <Scene/SceneCore.h>
 #include <Core/RenderGraph.h>
+#include <Support/Task.h>
 #include <Common/FrameConstants.h>
 #include <GBuffer/GBufferRT.h>
+#include <GBuffer/GBufferRaster.h>
 #include <Compositing/Compositing.h>
 #include <TAA/TAA.h>
 #include <AutoExposure/AutoExposure.h>
@@ -11,11 +13,14 @@
 #include <GUI/GuiPass.h>
 #include <Sky/Sky.h>
 #include <RayTracing/RtAccelerationStructure.h>
-#include <FSR2/FSR2.h>
+#include <Upscaler/Upscaler.h>
+#include <FrameInterpolation/FrameInterpolation.h>
 #include <DirectLighting/Emissive/DirectLighting.h>
 #include <DirectLighting/Sky/SkyDI.h>
 #include <PreLighting/PreLighting.h>
+#include <RtInstanceUpdate/RtInstanceUpdate.h>
 #include <IndirectLighting/IndirectLighting.h>
+#include <Denoiser/Denoiser.h>
 
 //--------------------------------------------------------------------------------------
 // DefaultRenderer
@@ -47,18 +52,23 @@ namespace ZetaRay::DefaultRenderer
     {
         NONE,
         TAA,
-        FSR2,
+        UPSCALER,
         COUNT
     };
 
-    inline static const char* AAOptions[] = { "None", "TAA", "AMD FSR 2.2 (Quality)" };
+    inline static const char* AAOptions[] = { "None", "TAA", "Upscaler (Quality)" };
     static_assert((int)AA::COUNT == ZetaArrayLen(AAOptions), "enum <-> string mismatch.");
 
-    inline static const char* IndirectOptions[] = { "Path Tracing", "ReSTIR GI", "ReSTIR PT" };
+    inline static const char* IndirectOptions[] = { "Path Tracing", "ReSTIR GI", "ReSTIR PT",
+        "Irradiance Probes" };
     static_assert((int)RenderPass::IndirectLighting::INTEGRATOR::COUNT == ZetaArrayLen(IndirectOptions), "enum <-> string mismatch.");
 
     inline static const char* LensTypes[] = { "Pinhole", "Thin Lens" };
 
+    // Fraction of pixels that are fully resampled every frame by ReSTIR DI, sky DI and 
+    // ReSTIR GI. Option i corresponds to resampling interval 2^i.
+    inline static const char* SparseResamplingOptions[] = { "Off", "1/2 Pixels (Checkerboard)", "1/4 Pixels (2x2)" };
+
     static constexpr auto DEFAULT_AA = AA::NONE;
 
     struct alignas(64) RenderSettings
@@ -69,12 +79,152 @@ namespace ZetaRay::DefaultRenderer
 
         // Presampled sets
         bool LightPresampling = false;
+        // Favor emissives that are visible and close to the camera when presampling. Not 
+        // used with ReSTIR PT, as its shifts need light pdfs that don't change between frames.
+        bool ViewDependentPresampling = true;
 
         // LVG
         bool UseLVG = false;
         Math::uint3 VoxelGridDim = Defaults::VOXEL_GRID_DIM;
         Math::float3 VoxelExtents = Defaults::VOXEL_EXTENTS;
         float VoxelGridyOffset = 0.1f;
+
+        // Sample emissives from a light BVH instead of the alias table (or presampled sets)
+        bool UseLightBVH = false;
+        // Every light BVH leaf holds a cluster of triangles, so that highly tessellated
+        // emissive meshes need fewer nodes
+        bool LightBVHClusters = false;
+
+        // Record BLAS & TLAS builds on the async. compute queue
+        bool AsyncASBuild = true;
+
+        // Store triangle IDs instead of triangle differential geometry in the g-buffer
+        bool VisibilityBuffer = false;
+
+        // Find primary hits by rasterizing meshlets with mesh shaders instead of tracing 
+        // camera rays. Ignored when mesh shaders aren't supported or with thin lens.
+        bool RasterVisibility = false;
+
+        // Filter indirect lighting with a spatiotemporal denoiser before compositing
+        bool DenoiseIndirect = false;
+
+        // Denoise headless renders at checkpoints (see App::HeadlessDesc::DenoiseCheckpoint), 
+        // compositing then also writes the denoiser's guide images
+        bool HeadlessDenoise = false;
+
+        // Pixels are fully resampled once every this many frames, the rest only reuse 
+        // their temporal reservoirs
+        uint32_t ResamplingInterval = 1;
+    };
+
+    // Adjusts the upscale factor to keep GPU frame time close to a target. Only used with the 
+    // upscaler. As render targets are recreated on every change, steps are quantized and rate limited.
+    struct DynamicResolution
+    {
+        static constexpr float MIN_UPSCALE_FACTOR = 1.0f;
+        static constexpr float MAX_UPSCALE_FACTOR = 2.0f;
+        static constexpr float UPSCALE_FACTOR_STEP = 0.125f;
+        static constexpr int MIN_FRAMES_BETWEEN_CHANGES = 90;
+        // Weight of the latest frame in the moving average of GPU frame time
+        static constexpr float EMA_ALPHA = 0.1f;
+        // Resolution changes only when avg. frame time / target falls outside the range
+        static constexpr float LOWER_THRESHOLD = 0.85f;
+        static constexpr float UPPER_THRESHOLD = 1.05f;
+
+        bool Enabled = false;
+        float TargetFrameTimeMs = 1000.0f / 60.0f;
+        float AvgGpuFrameTimeMs = 0.0f;
+        uint64_t LastResolvedFrame = 0;
+        int NumFramesSinceChange = 0;
+    };
+
+    // Renderer defaults that are scaled to the GPU. On first launch, tier is picked from the 
+    // adapter's VRAM and optionally refined by measuring GPU frame time of the first few 
+    // frames (calibration). The result is stored in a config file, which is used as long as 
+    // the adapter doesn't change.
+    enum class PERF_TIER : uint8_t
+    {
+        LOW,
+        MEDIUM,
+        HIGH,
+        COUNT
+    };
+
+    inline static const char* PerfTierOptions[] = { "Low", "Medium", "High" };
+    static_assert((int)PERF_TIER::COUNT == ZetaArrayLen(PerfTierOptions), "enum <-> string mismatch.");
+
+    struct PerformanceTier
+    {
+        // Settings that every tier overrides. High matches the renderer's defaults.
+        struct Preset
+        {
+            RenderPass::IndirectLighting::INTEGRATOR Indirect;
+            AA AntiAliasing;
+            float UpscaleFactor;
+            uint32_t ResamplingInterval;
+            bool UseLVG;
+            Math::uint3 VoxelGridDim;
+        };
+
+        inline static constexpr Preset PRESETS[(int)PERF_TIER::COUNT] =
+        {
+            { RenderPass::IndirectLighting::INTEGRATOR::ReSTIR_GI, AA::UPSCALER, 2.0f, 2, true, Math::uint3(16, 8, 20) },
+            { RenderPass::IndirectLighting::INTEGRATOR::ReSTIR_PT, AA::UPSCALER, 1.5f, 1, true, Defaults::VOXEL_GRID_DIM },
+            { RenderPass::IndirectLighting::INTEGRATOR::ReSTIR_PT, DEFAULT_AA, 1.0f, 1, false, Defaults::VOXEL_GRID_DIM }
+        };
+
+        // In MB of dedicated video memory
+        static constexpr uint64_t MIN_VRAM_MEDIUM = 6 * 1024;
+        static constexpr uint64_t MIN_VRAM_HIGH = 10 * 1024;
+
+        static constexpr bool CALIBRATE_ON_FIRST_LAUNCH = true;
+        // Calibration starts once the scene can be ray traced and after this many frames
+        static constexpr int NUM_CALIBRATION_WARMUP_FRAMES = 60;
+        static constexpr int NUM_CALIBRATION_FRAMES = 120;
+        static constexpr float TARGET_FRAME_TIME_MS = 1000.0f / 60.0f;
+        // Tier goes down when avg. frame time / target is above the former, and up when 
+        // it's below the latter
+        static constexpr float DOWNGRADE_THRESHOLD = 1.25f;
+        static constexpr float UPGRADE_THRESHOLD = 0.5f;
+
+        PERF_TIER Tier = PERF_TIER::HIGH;
+        bool Calibrating = false;
+        // Once calibration moves down, it doesn't move back up and vice versa
+        int LastStep = 0;
+        int NumFrames = 0;
+        double SumFrameTimeMs = 0.0;
+        uint64_t LastResolvedFrame = 0;
+    };
+
+    // Tiled headless rendering (see App::HeadlessDesc::TileSize). Tiles are rendered in 
+    // row-major order and every row of tiles is appended to the output file once its last 
+    // tile has been read back.
+    struct HeadlessTiles
+    {
+        uint32_t NumTilesX = 0;
+        uint32_t NumTilesY = 0;
+        uint32_t CurrTile = 0;
+        // Cropped R32G32B32A32_FLOAT pixels for the current row of tiles
+        Util::SmallVector<uint8_t> Row;
+        // Set from the background thread once current tile has been read back
+        std::atomic_bool ReadbackDone = false;
+        bool CaptureIssued = false;
+    };
+
+    // Denoising of headless renders (see App::HeadlessDesc::DenoiseCheckpoint). At most one 
+    // checkpoint is in flight -- rendering continues while it's denoised on a background thread.
+    struct HeadlessDenoise
+    {
+        uint32_t NextCheckpoint = 0;
+        // Number of samples per pixel in the checkpoint that's in flight
+        uint32_t CheckpointSamples = 0;
+        // Set from the background thread once current checkpoint has been denoised
+        std::atomic_bool CheckpointDone = false;
+        // Set before CheckpointDone when the denoised image was written to disk
+        bool Finished = false;
+        bool CheckpointIssued = false;
+        // Reached the requested number of samples, so write the result regardless
+        bool FinalCheckpoint = false;
     };
 
     struct alignas(64) GBufferData
@@ -90,15 +240,24 @@ namespace ZetaRay::DefaultRenderer
             COAT,
             DEPTH,
             TRI_DIFF_GEO_A,
+            // Mesh and triangle index in visibility-buffer mode
             TRI_DIFF_GEO_B,
             COUNT
         };
 
+        // With PACKED_GBUFFER, NORMAL, IOR and COAT are packed into BASE_COLOR and 
+        // METALLIC_ROUGHNESS and aren't allocated
         inline static const DXGI_FORMAT GBUFFER_FORMAT[GBUFFER::COUNT] =
         {
+#if PACKED_GBUFFER == 1
+            DXGI_FORMAT_R32G32_UINT,
+            DXGI_FORMAT_R16G16_UNORM,
+            DXGI_FORMAT_R32G32_UINT,
+#else
             DXGI_FORMAT_R8G8B8A8_UNORM,
             DXGI_FORMAT_R16G16_UNORM,
             DXGI_FORMAT_R8G8_UNORM,
+#endif
             DXGI_FORMAT_R16G16_SNORM,
             DXGI_FORMAT_UNKNOWN,
             DXGI_FORMAT_R8_UNORM,
@@ -117,15 +276,22 @@ namespace ZetaRay::DefaultRenderer
         Core::GpuMemory::Texture IORBuffer[2];
         Core::GpuMemory::Texture CoatBuffer[2];
         Core::GpuMemory::Texture Depth[2];
+        // Not allocated in visibility-buffer mode
         Core::GpuMemory::Texture TriDiffGeo_A[2];
         Core::GpuMemory::Texture TriDiffGeo_B[2];
         Core::GpuMemory::ResourceHeap ResHeap;
+        bool VisibilityBuffer = false;
 
         Core::DescriptorTable SrvDescTable[2];
         Core::DescriptorTable UavDescTable[2];
 
         RenderPass::GBufferRT GBufferPass;
         Core::RenderNodeHandle GBufferPassHandle;
+
+        // Only initialized once raster primary visibility is used
+        RenderPass::GBufferRaster RasterPass;
+        Core::RenderNodeHandle RasterPassHandle;
+        bool RasterVisibility = false;
     };
 
     struct alignas(64) PostProcessData
@@ -136,8 +302,8 @@ namespace ZetaRay::DefaultRenderer
 
         RenderPass::TAA TaaPass;
         Core::RenderNodeHandle TaaHandle;
-        RenderPass::FSR2Pass Fsr2Pass;
-        Core::RenderNodeHandle Fsr2Handle;
+        RenderPass::Upscaler UpscalerPass;
+        Core::RenderNodeHandle UpscalerHandle;
 
         RenderPass::AutoExposure AutoExposurePass;
         Core::RenderNodeHandle AutoExposureHandle;
@@ -145,6 +311,10 @@ namespace ZetaRay::DefaultRenderer
         RenderPass::DisplayPass DisplayPass;
         Core::RenderNodeHandle DisplayHandle;
 
+        RenderPass::FrameInterpolation FrameInterpolationPass;
+        Core::RenderNodeHandle FrameInterpolationHandle;
+        Core::RenderNodeHandle DisplayInterpolatedHandle;
+
         RenderPass::GuiPass GuiPass;
         Core::RenderNodeHandle GuiHandle;
 
@@ -157,7 +327,8 @@ namespace ZetaRay::DefaultRenderer
         };
 
         Core::DescriptorTable WindowSizeConstSRVs;
-        Core::DescriptorTable TaaOrFsr2OutSRV;
+        Core::DescriptorTable TaaOrUpscalerOutSRV;
+        Core::DescriptorTable InterpolatedSRV;
     };
 
     struct alignas(64) PathTracerData
@@ -167,6 +338,8 @@ namespace ZetaRay::DefaultRenderer
 
         // Scene BVH
         RT::TLAS RtAS;
+        // Applies instance transform updates to TLAS instances on the GPU
+        RenderPass::RtInstanceUpdate RtInstanceUpdatePass;
 
         // Render Passes
         Core::RenderNodeHandle RtASBuildHandle;
@@ -180,15 +353,15 @@ namespace ZetaRay::DefaultRenderer
         RenderPass::PreLighting PreLightingPass;
         Core::RenderNodeHandle PreLightingPassHandle;
 
-        RenderPass::EmissiveTriangleAliasTable EmissiveAliasTable;
-        Core::RenderNodeHandle EmissiveAliasTableHandle;
-
         RenderPass::DirectLighting DirecLightingPass;
         Core::RenderNodeHandle DirecLightingHandle;
 
         RenderPass::IndirectLighting IndirecLightingPass;
         Core::RenderNodeHandle IndirecLightingHandle;
 
+        RenderPass::Denoiser IndirectDenoiserPass;
+        Core::RenderNodeHandle IndirectDenoiserHandle;
+
         // Reflectance look up texture
         Core::GpuMemory::Texture m_rhoLUT;
 
@@ -198,6 +371,7 @@ namespace ZetaRay::DefaultRenderer
             SKY_DI,
             EMISSIVE_DI,
             INDIRECT,
+            DENOISED_INDIRECT,
             COUNT
         };
 
@@ -215,7 +389,9 @@ namespace ZetaRay::DefaultRenderer
     struct PrivateData
     {
         Core::RenderGraph m_renderGraph;
-        Core::GpuMemory::Buffer m_frameConstantsBuff;
+        // Only the first one is used, unless GPU upload heaps are supported, in which case
+        // there's one per frame in flight that CPU writes to directly
+        Core::GpuMemory::Buffer m_frameConstantsBuff[Core::Constants::NUM_BACK_BUFFERS];
 
         cbFrameConstants m_frameConstants;
         RenderSettings m_settings;
@@ -224,9 +400,16 @@ namespace ZetaRay::DefaultRenderer
         PostProcessData m_postProcessorData;
         PathTracerData m_pathTracerData;
 
+        DynamicResolution m_dynamicRes;
+        PerformanceTier m_perfTier;
         AA PendingAA = DEFAULT_AA;
         bool m_sunMoved = false;
         bool m_sceneChanged = false;
+        bool m_headlessCaptureIssued = false;
+        // Index of the headless job that m_headlessCaptureIssued refers to
+        uint32_t m_headlessJob = 0;
+        HeadlessTiles m_headlessTiles;
+        HeadlessDenoise m_headlessDenoise;
     };
 }
 
@@ -238,7 +421,7 @@ using Data = ZetaRay::DefaultRenderer::PrivateData;
 
 namespace ZetaRay::DefaultRenderer::Common
 {
-    void UpdateFrameConstants(cbFrameConstants& frameConsts, Core::GpuMemory::Buffer& frameConstsBuff,
+    void UpdateFrameConstants(cbFrameConstants& frameConsts, Core::GpuMemory::Buffer* frameConstsBuffs,
         const GBufferData& gbuffData, const PathTracerData& rtData);
 }
 
@@ -248,11 +431,12 @@ namespace ZetaRay::DefaultRenderer::Common
 
 namespace ZetaRay::DefaultRenderer::GBuffer
 {
-    void Init(const RenderSettings& settings, GBufferData& data);
-    void CreateGBuffers(GBufferData& data);
+    // Adds the tasks that initialize every pass to ts, independent ones can run in parallel
+    void Init(const RenderSettings& settings, GBufferData& data, Support::TaskSet& ts);
+    void CreateGBuffers(const RenderSettings& settings, GBufferData& data);
     void OnWindowSizeChanged(const RenderSettings& settings, GBufferData& data);
 
-    void Update(GBufferData& gbuffData);
+    void Update(const RenderSettings& settings, GBufferData& gbuffData, bool thinLens);
     void Register(GBufferData& data, const PathTracerData& rayTracerData, Core::RenderGraph& renderGraph);
     void AddAdjacencies(GBufferData& data, const PathTracerData& pathTracerData,
         Core::RenderGraph& renderGraph);
@@ -264,7 +448,7 @@ namespace ZetaRay::DefaultRenderer::GBuffer
 
 namespace ZetaRay::DefaultRenderer::PathTracer
 {
-    void Init(const RenderSettings& settings, PathTracerData& data);
+    void Init(const RenderSettings& settings, PathTracerData& data, Support::TaskSet& ts);
     void OnWindowSizeChanged(const RenderSettings& settings, PathTracerData& data);
 
     void Update(const RenderSettings& settings, Core::RenderGraph& renderGraph, PathTracerData& data);
@@ -279,7 +463,7 @@ namespace ZetaRay::DefaultRenderer::PathTracer
 
 namespace ZetaRay::DefaultRenderer::PostProcessor
 {
-    void Init(const RenderSettings& settings, PostProcessData& data);
+    void Init(const RenderSettings& settings, PostProcessData& data, Support::TaskSet& ts);
     void OnWindowSizeChanged(const RenderSettings& settings, PostProcessData& data,
         const PathTracerData& pathTracerData);
 
@@ -293,4 +477,38 @@ namespace ZetaRay::DefaultRenderer::PostProcessor
     void AddAdjacencies(const RenderSettings& settings, PostProcessData& data, 
         const GBufferData& gbufferData,const PathTracerData& pathTracerData,
         Core::RenderGraph& renderGraph);
-}
\ No newline at end of file
+}
+
+//--------------------------------------------------------------------------------------
+// HeadlessDenoiser
+//--------------------------------------------------------------------------------------
+
+namespace ZetaRay::DefaultRenderer::HeadlessDenoiser
+{
+    // Whether this build includes Open Image Denoise (ZETA_OIDN)
+    bool IsAvailable();
+    // Denoises the first image of the capture, guided by the albedo and normal images that 
+    // follow it. Returns the relative change from the previously denoised image, or FLT_MAX 
+    // when there wasn't one. Called from a background thread.
+    float Denoise(const RenderPass::ScreenCapture& capture);
+    // Writes the last denoised image to disk as EXR
+    void Write(const char* path);
+    // Forgets the previously denoised image, e.g. when the next headless job starts
+    void Reset();
+    void Shutdown();
+}
+
+//--------------------------------------------------------------------------------------
+// PerfTier
+//--------------------------------------------------------------------------------------
+
+namespace ZetaRay::DefaultRenderer::PerfTier
+{
+    // Loads the tier from the config file, or when it's missing (or was written for a 
+    // different adapter), picks one from device capabilities and starts calibration
+    void Init(PerformanceTier& data);
+    // Returns true when calibration has moved to a different tier. Finishes calibration, and 
+    // saves the config, when current tier is fast enough (or can't go any lower).
+    bool Calibrate(PerformanceTier& data, float gpuFrameTimeMs);
+    void Save(const PerformanceTier& data);
+}
@@ -13,7 +13,7 @@ using namespace ZetaRay::DefaultRenderer;
 // GBuffer
 //--------------------------------------------------------------------------------------
 
-void GBuffer::Init(const RenderSettings& settings, GBufferData& data)
+void GBuffer::Init(const RenderSettings& settings, GBufferData& data, Support::TaskSet& ts)
 {
     for (int i = 0; i < 2; i++)
     {
@@ -23,14 +23,24 @@ void GBuffer::Init(const RenderSettings& settings, GBufferData& data)
             GBufferData::COUNT);
     }
 
-    CreateGBuffers(data);
+    ts.EmplaceTask("GBuffer_Resources", [&settings, &data]()
+        {
+            CreateGBuffers(settings, data);
+        });
 
-    data.GBufferPass.Init();
+    ts.EmplaceTask("GBuffer_Pass", [&data]()
+        {
+            data.GBufferPass.Init();
+            data.GBufferPass.SetTextureFeedbackCallback(fastdelegate::MakeDelegate(&App::GetScene(), 
+                &SceneCore::OnTextureFeedbackReadback));
+        });
 }
 
-void GBuffer::CreateGBuffers(GBufferData& data)
+void GBuffer::CreateGBuffers(const RenderSettings& settings, GBufferData& data)
 {
     auto& renderer = App::GetRenderer();
+    // Views are copied to the shader-visible tables in one batch at the end
+    auto& staging = renderer.GetDescriptorStagingHeap();
     const int width = renderer.GetRenderWidth();
     const int height = renderer.GetRenderHeight();
 
@@ -42,6 +52,10 @@ void GBuffer::CreateGBuffers(GBufferData& data)
         DXGI_FORMAT_R9G9B9E5_SHAREDEXP :
         DXGI_FORMAT_R11G11B10_FLOAT;
 
+    // In visibility-buffer mode, triangle differential geometry is recomputed from 
+    // the triangle IDs in TRI_DIFF_GEO_B when needed
+    data.VisibilityBuffer = settings.VisibilityBuffer;
+
     // Except emissive and motion vector, everything is double-buffered
     constexpr int N = 2 * (GBufferData::COUNT - 2) + 2;
     PlacedResourceList<N> list;
@@ -49,9 +63,11 @@ void GBuffer::CreateGBuffers(GBufferData& data)
     // Base color
     for (int i = 0; i < 2; i++)
         list.PushTex2D(GBufferData::GBUFFER_FORMAT[GBufferData::GBUFFER::BASE_COLOR], width, height, texFlags);
+#if PACKED_GBUFFER == 0
     // Normal
     for (int i = 0; i < 2; i++)
         list.PushTex2D(GBufferData::GBUFFER_FORMAT[GBufferData::GBUFFER::NORMAL], width, height, texFlags);
+#endif
     // Metallic-roughness
     for (int i = 0; i < 2; i++)
         list.PushTex2D(GBufferData::GBUFFER_FORMAT[GBufferData::GBUFFER::METALLIC_ROUGHNESS], width, height, texFlags);
@@ -59,15 +75,20 @@ void GBuffer::CreateGBuffers(GBufferData& data)
     list.PushTex2D(GBufferData::GBUFFER_FORMAT[GBufferData::GBUFFER::MOTION_VECTOR], width, height, texFlags);
     // Emissive color
     list.PushTex2D(emissiveColFormat, width, height, texFlags);
+#if PACKED_GBUFFER == 0
     // IOR
     for (int i = 0; i < 2; i++)
         list.PushTex2D(GBufferData::GBUFFER_FORMAT[GBufferData::GBUFFER::IOR], width, height, texFlags);
     // Coat
     for (int i = 0; i < 2; i++)
         list.PushTex2D(GBufferData::GBUFFER_FORMAT[GBufferData::GBUFFER::COAT], width, height, texFlags);
+#endif
     // Triangle differential geometry - A
-    for (int i = 0; i < 2; i++)
-        list.PushTex2D(GBufferData::GBUFFER_FORMAT[GBufferData::GBUFFER::TRI_DIFF_GEO_A], width, height, texFlags);
+    if (!data.VisibilityBuffer)
+    {
+        for (int i = 0; i < 2; i++)
+            list.PushTex2D(GBufferData::GBUFFER_FORMAT[GBufferData::GBUFFER::TRI_DIFF_GEO_A], width, height, texFlags);
+    }
     // Triangle differential geometry - B
     for (int i = 0; i < 2; i++)
         list.PushTex2D(GBufferData::GBUFFER_FORMAT[GBufferData::GBUFFER::TRI_DIFF_GEO_B], width, height, texFlags);
@@ -77,7 +98,7 @@ void GBuffer::CreateGBuffers(GBufferData& data)
 
     list.End();
 
-    data.ResHeap = GpuMemory::GetResourceHeap(list.TotalSizeInBytes());
+    data.ResHeap = GpuMemory::GetResourceHeap("GBuffer", list.TotalSizeInBytes());
     auto allocs = list.AllocInfos();
     int currRes = 0;
 
@@ -96,14 +117,15 @@ void GBuffer::CreateGBuffers(GBufferData& data)
                 texFlags));
 
             // UAV
-            Direct3DUtil::CreateTexture2DUAV(data.BaseColor[i], data.UavDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DUAV(data.BaseColor[i], staging.Stage(data.UavDescTable[i], 
                 GBufferData::GBUFFER::BASE_COLOR));
             // SRV
-            Direct3DUtil::CreateTexture2DSRV(data.BaseColor[i], data.SrvDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DSRV(data.BaseColor[i], staging.Stage(data.SrvDescTable[i], 
                 GBufferData::GBUFFER::BASE_COLOR));
         }
     }
 
+#if PACKED_GBUFFER == 0
     // Normal
     {
         for (int i = 0; i < 2; i++)
@@ -119,14 +141,16 @@ void GBuffer::CreateGBuffers(GBufferData& data)
                 texFlags));
 
             // UAV
-            Direct3DUtil::CreateTexture2DUAV(data.Normal[i], data.UavDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DUAV(data.Normal[i], staging.Stage(data.UavDescTable[i], 
                 GBufferData::GBUFFER::NORMAL));
             // SRV
-            Direct3DUtil::CreateTexture2DSRV(data.Normal[i], data.SrvDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DSRV(data.Normal[i], staging.Stage(data.SrvDescTable[i], 
                 GBufferData::GBUFFER::NORMAL));
         }
     }
 
+#endif
+
     // Metallic-roughness
     {
         for (int i = 0; i < 2; i++)
@@ -142,10 +166,10 @@ void GBuffer::CreateGBuffers(GBufferData& data)
                 texFlags));
 
             // UAV
-            Direct3DUtil::CreateTexture2DUAV(data.MetallicRoughness[i], data.UavDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DUAV(data.MetallicRoughness[i], staging.Stage(data.UavDescTable[i], 
                 GBufferData::GBUFFER::METALLIC_ROUGHNESS));
             // SRV
-            Direct3DUtil::CreateTexture2DSRV(data.MetallicRoughness[i], data.SrvDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DSRV(data.MetallicRoughness[i], staging.Stage(data.SrvDescTable[i], 
                 GBufferData::GBUFFER::METALLIC_ROUGHNESS));
         }
     }
@@ -161,14 +185,14 @@ void GBuffer::CreateGBuffers(GBufferData& data)
             texFlags));
 
         //UAV
-        Direct3DUtil::CreateTexture2DUAV(data.MotionVec, data.UavDescTable[0].CPUHandle(
+        Direct3DUtil::CreateTexture2DUAV(data.MotionVec, staging.Stage(data.UavDescTable[0], 
             GBufferData::GBUFFER::MOTION_VECTOR));
-        Direct3DUtil::CreateTexture2DUAV(data.MotionVec, data.UavDescTable[1].CPUHandle(
+        Direct3DUtil::CreateTexture2DUAV(data.MotionVec, staging.Stage(data.UavDescTable[1], 
             GBufferData::GBUFFER::MOTION_VECTOR));
         // SRV
-        Direct3DUtil::CreateTexture2DSRV(data.MotionVec, data.SrvDescTable[0].CPUHandle(
+        Direct3DUtil::CreateTexture2DSRV(data.MotionVec, staging.Stage(data.SrvDescTable[0], 
             GBufferData::GBUFFER::MOTION_VECTOR));
-        Direct3DUtil::CreateTexture2DSRV(data.MotionVec, data.SrvDescTable[1].CPUHandle(
+        Direct3DUtil::CreateTexture2DSRV(data.MotionVec, staging.Stage(data.SrvDescTable[1], 
             GBufferData::GBUFFER::MOTION_VECTOR));
     }
 
@@ -183,17 +207,18 @@ void GBuffer::CreateGBuffers(GBufferData& data)
             texFlags));
 
         //UAV
-        Direct3DUtil::CreateTexture2DUAV(data.EmissiveColor, data.UavDescTable[0].CPUHandle(
+        Direct3DUtil::CreateTexture2DUAV(data.EmissiveColor, staging.Stage(data.UavDescTable[0], 
             GBufferData::GBUFFER::EMISSIVE_COLOR));
-        Direct3DUtil::CreateTexture2DUAV(data.EmissiveColor, data.UavDescTable[1].CPUHandle(
+        Direct3DUtil::CreateTexture2DUAV(data.EmissiveColor, staging.Stage(data.UavDescTable[1], 
             GBufferData::GBUFFER::EMISSIVE_COLOR));
         // SRV
-        Direct3DUtil::CreateTexture2DSRV(data.EmissiveColor, data.SrvDescTable[0].CPUHandle(
+        Direct3DUtil::CreateTexture2DSRV(data.EmissiveColor, staging.Stage(data.SrvDescTable[0], 
             GBufferData::GBUFFER::EMISSIVE_COLOR));
-        Direct3DUtil::CreateTexture2DSRV(data.EmissiveColor, data.SrvDescTable[1].CPUHandle(
+        Direct3DUtil::CreateTexture2DSRV(data.EmissiveColor, staging.Stage(data.SrvDescTable[1], 
             GBufferData::GBUFFER::EMISSIVE_COLOR));
     }
 
+#if PACKED_GBUFFER == 0
     // IOR
     {
         for (int i = 0; i < 2; i++)
@@ -209,10 +234,10 @@ void GBuffer::CreateGBuffers(GBufferData& data)
                 texFlags));
 
             // UAV
-            Direct3DUtil::CreateTexture2DUAV(data.IORBuffer[i], data.UavDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DUAV(data.IORBuffer[i], staging.Stage(data.UavDescTable[i], 
                 GBufferData::GBUFFER::IOR));
             // SRV
-            Direct3DUtil::CreateTexture2DSRV(data.IORBuffer[i], data.SrvDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DSRV(data.IORBuffer[i], staging.Stage(data.SrvDescTable[i], 
                 GBufferData::GBUFFER::IOR));
         }
     }
@@ -232,17 +257,19 @@ void GBuffer::CreateGBuffers(GBufferData& data)
                 texFlags));
 
             // UAV
-            Direct3DUtil::CreateTexture2DUAV(data.CoatBuffer[i], data.UavDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DUAV(data.CoatBuffer[i], staging.Stage(data.UavDescTable[i], 
                 GBufferData::GBUFFER::COAT));
             // SRV
-            Direct3DUtil::CreateTexture2DSRV(data.CoatBuffer[i], data.SrvDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DSRV(data.CoatBuffer[i], staging.Stage(data.SrvDescTable[i], 
                 GBufferData::GBUFFER::COAT));
         }
     }
 
+#endif
+
     // Triangle differential geometry
     {
-        for (int i = 0; i < 2; i++)
+        for (int i = 0; i < 2 && !data.VisibilityBuffer; i++)
         {
             StackStr(nameA, nA, "TriDiffGeoA_%d", i);
 
@@ -256,10 +283,10 @@ void GBuffer::CreateGBuffers(GBufferData& data)
 
             // UAV
             Direct3DUtil::CreateTexture2DUAV(data.TriDiffGeo_A[i],
-                data.UavDescTable[i].CPUHandle(GBufferData::GBUFFER::TRI_DIFF_GEO_A));
+                staging.Stage(data.UavDescTable[i], GBufferData::GBUFFER::TRI_DIFF_GEO_A));
             // SRV
             Direct3DUtil::CreateTexture2DSRV(data.TriDiffGeo_A[i],
-                data.SrvDescTable[i].CPUHandle(GBufferData::GBUFFER::TRI_DIFF_GEO_A));
+                staging.Stage(data.SrvDescTable[i], GBufferData::GBUFFER::TRI_DIFF_GEO_A));
         }
 
         for (int i = 0; i < 2; i++)
@@ -276,10 +303,10 @@ void GBuffer::CreateGBuffers(GBufferData& data)
 
             // UAV
             Direct3DUtil::CreateTexture2DUAV(data.TriDiffGeo_B[i],
-                data.UavDescTable[i].CPUHandle(GBufferData::GBUFFER::TRI_DIFF_GEO_B));
+                staging.Stage(data.UavDescTable[i], GBufferData::GBUFFER::TRI_DIFF_GEO_B));
             // SRV
             Direct3DUtil::CreateTexture2DSRV(data.TriDiffGeo_B[i],
-                data.SrvDescTable[i].CPUHandle(GBufferData::GBUFFER::TRI_DIFF_GEO_B));
+                staging.Stage(data.SrvDescTable[i], GBufferData::GBUFFER::TRI_DIFF_GEO_B));
         }
     }
 
@@ -298,27 +325,64 @@ void GBuffer::CreateGBuffers(GBufferData& data)
                 texFlagsDepth));
 
             // UAV
-            Direct3DUtil::CreateTexture2DUAV(data.Depth[i], data.UavDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DUAV(data.Depth[i], staging.Stage(data.UavDescTable[i], 
                 GBufferData::GBUFFER::DEPTH));
             // SRV
-            Direct3DUtil::CreateTexture2DSRV(data.Depth[i], data.SrvDescTable[i].CPUHandle(
+            Direct3DUtil::CreateTexture2DSRV(data.Depth[i], staging.Stage(data.SrvDescTable[i], 
                 GBufferData::GBUFFER::DEPTH),
                 DXGI_FORMAT_R32_FLOAT);
         }
     }
+
+    staging.Flush();
 }
 
 void GBuffer::OnWindowSizeChanged(const RenderSettings& settings, GBufferData& data)
 {
-    GBuffer::CreateGBuffers(data);
+    for (int i = 0; i < 2; i++)
+    {
+        data.SrvDescTable[i] = App::GetRenderer().GetGpuDescriptorHeap().Allocate(
+            GBufferData::COUNT);
+        data.UavDescTable[i] = App::GetRenderer().GetGpuDescriptorHeap().Allocate(
+            GBufferData::COUNT);
+    }
+
+    GBuffer::CreateGBuffers(settings, data);
+
+    if (data.RasterPass.IsInitialized())
+        data.RasterPass.OnWindowResized();
 }
 
-void GBuffer::Update(GBufferData& gbufferData)
+void GBuffer::Update(const RenderSettings& settings, GBufferData& gbufferData, bool thinLens)
 {
     const int outIdx = App::GetRenderer().GlobalIdxForDoubleBufferedResources();
 
+    if (settings.VisibilityBuffer != gbufferData.VisibilityBuffer)
+    {
+        // Previous frame might still be referencing the old descriptors
+        for (int i = 0; i < 2; i++)
+        {
+            gbufferData.SrvDescTable[i] = App::GetRenderer().GetGpuDescriptorHeap().Allocate(
+                GBufferData::COUNT);
+            gbufferData.UavDescTable[i] = App::GetRenderer().GetGpuDescriptorHeap().Allocate(
+                GBufferData::COUNT);
+        }
+
+        GBuffer::CreateGBuffers(settings, gbufferData);
+    }
+
     gbufferData.GBufferPass.SetGBufferUavDescTableGpuHeapIdx(
         gbufferData.UavDescTable[outIdx].GPUDescriptorHeapIndex(GBufferData::GBUFFER::BASE_COLOR));
+
+    // Rasterization can't match the camera rays of a thin lens
+    gbufferData.RasterVisibility = settings.RasterVisibility && !thinLens &&
+        App::GetRenderer().IsMeshShaderSupported();
+
+    if (gbufferData.RasterVisibility && !gbufferData.RasterPass.IsInitialized())
+        gbufferData.RasterPass.Init();
+
+    gbufferData.GBufferPass.SetRasterTriangleIDs(gbufferData.RasterVisibility ?
+        gbufferData.RasterPass.TriangleIDsDescHeapIdx() : UINT32_MAX);
 }
 
 void GBuffer::Register(GBufferData& data, const PathTracerData& pathTracerData, RenderGraph& renderGraph)
@@ -331,19 +395,38 @@ void GBuffer::Register(GBufferData& data, const PathTracerData& pathTracerData,
     fastdelegate::FastDelegate1<CommandList&> dlg = fastdelegate::MakeDelegate(&data.GBufferPass, &GBufferRT::Render);
     data.GBufferPassHandle = renderGraph.RegisterRenderPass("GBuffer", RENDER_NODE_TYPE::COMPUTE, dlg);
 
+    // Raster primary visibility
+    if (data.RasterVisibility)
+    {
+        // TLAS has been updated for this frame by now
+        data.RasterPass.Update(pathTracerData.RtAS);
+
+        fastdelegate::FastDelegate1<CommandList&> rasterDlg = fastdelegate::MakeDelegate(&data.RasterPass, 
+            &GBufferRaster::Render);
+        data.RasterPassHandle = renderGraph.RegisterRenderPass("GBufferRaster", RENDER_NODE_TYPE::RENDER, 
+            rasterDlg);
+
+        Texture& triIDs = data.RasterPass.GetTriangleIDs();
+        renderGraph.RegisterResource(triIDs.Resource(), triIDs.ID());
+    }
+
     const D3D12_RESOURCE_STATES initDepthState = D3D12_RESOURCE_STATE_COMMON;
 
     // Register current and previous frame's g-buffers
     for (int i = 0; i < 2; i++)
     {
-        renderGraph.RegisterResource(data.Normal[i].Resource(), data.Normal[i].ID());
         renderGraph.RegisterResource(data.Depth[i].Resource(), data.Depth[i].ID(), initDepthState);
         renderGraph.RegisterResource(data.MetallicRoughness[i].Resource(), data.MetallicRoughness[i].ID());
         renderGraph.RegisterResource(data.BaseColor[i].Resource(), data.BaseColor[i].ID());
+#if PACKED_GBUFFER == 0
+        renderGraph.RegisterResource(data.Normal[i].Resource(), data.Normal[i].ID());
         renderGraph.RegisterResource(data.IORBuffer[i].Resource(), data.IORBuffer[i].ID());
         renderGraph.RegisterResource(data.CoatBuffer[i].Resource(), data.CoatBuffer[i].ID());
-        renderGraph.RegisterResource(data.TriDiffGeo_A[i].Resource(), data.TriDiffGeo_A[i].ID());
+#endif
         renderGraph.RegisterResource(data.TriDiffGeo_B[i].Resource(), data.TriDiffGeo_B[i].ID());
+
+        if (!data.VisibilityBuffer)
+            renderGraph.RegisterResource(data.TriDiffGeo_A[i].Resource(), data.TriDiffGeo_A[i].ID());
     }
 
     renderGraph.RegisterResource(data.MotionVec.Resource(), data.MotionVec.ID());
@@ -367,11 +450,30 @@ void GBuffer::AddAdjacencies(GBufferData& data, const PathTracerData& pathTracer
         D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
 
     renderGraph.AddOutput(data.GBufferPassHandle, data.BaseColor[outIdx].ID(), gbufferOutState);
-    renderGraph.AddOutput(data.GBufferPassHandle, data.Normal[outIdx].ID(), gbufferOutState);
     renderGraph.AddOutput(data.GBufferPassHandle, data.MetallicRoughness[outIdx].ID(), gbufferOutState);
     renderGraph.AddOutput(data.GBufferPassHandle, data.MotionVec.ID(), gbufferOutState);
     renderGraph.AddOutput(data.GBufferPassHandle, data.EmissiveColor.ID(), gbufferOutState);
+#if PACKED_GBUFFER == 0
+    renderGraph.AddOutput(data.GBufferPassHandle, data.Normal[outIdx].ID(), gbufferOutState);
     renderGraph.AddOutput(data.GBufferPassHandle, data.IORBuffer[outIdx].ID(), gbufferOutState);
     renderGraph.AddOutput(data.GBufferPassHandle, data.CoatBuffer[outIdx].ID(), gbufferOutState);
+#endif
     renderGraph.AddOutput(data.GBufferPassHandle, data.Depth[outIdx].ID(), depthBuffOutState);
+    renderGraph.AddOutput(data.GBufferPassHandle, data.TriDiffGeo_B[outIdx].ID(), gbufferOutState);
+
+    if (!data.VisibilityBuffer)
+        renderGraph.AddOutput(data.GBufferPassHandle, data.TriDiffGeo_A[outIdx].ID(), gbufferOutState);
+
+    if (data.RasterVisibility)
+    {
+        const uint64_t triIDs = data.RasterPass.GetTriangleIDs().ID();
+
+        // Frame mesh instances are written along with the TLAS
+        renderGraph.AddInput(data.RasterPassHandle,
+            pathTracerData.RtAS.GetTLAS().ID(),
+            D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
+        renderGraph.AddOutput(data.RasterPassHandle, triIDs, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+        renderGraph.AddInput(data.GBufferPassHandle, triIDs, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    }
 }
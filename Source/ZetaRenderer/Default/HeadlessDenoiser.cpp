@@ -0,0 +1,200 @@
+#include "DefaultRendererImpl.h"
+#include <Math/Color.h>
+#include <Display/EXR.h>
+
+#ifdef ZETA_OIDN
+#include <OpenImageDenoise/oidn.hpp>
+#endif
+
+using namespace ZetaRay;
+using namespace ZetaRay::DefaultRenderer;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::RenderPass;
+
+#ifdef ZETA_OIDN
+
+namespace
+{
+    // Images are copied to device buffers (rather than shared with host memory) so that
+    // any device type works, including GPUs
+    struct OidnData
+    {
+        oidn::DeviceRef Device;
+        oidn::FilterRef Filter;
+        oidn::BufferRef Color;
+        oidn::BufferRef Albedo;
+        oidn::BufferRef Normal;
+        oidn::BufferRef Output;
+        // Last two denoised images, R32G32B32A32_FLOAT with the readback's row pitch
+        SmallVector<uint8_t> Denoised[2];
+        SmallVector<float> Lum[2];
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        uint32_t RowPitch = 0;
+        int Curr = 0;
+        bool HasPrev = false;
+    };
+
+    OidnData* g_oidn = nullptr;
+
+    void CheckOidnError()
+    {
+        const char* msg = nullptr;
+        const oidn::Error err = g_oidn->Device.getError(msg);
+        Check(err == oidn::Error::None, "Open Image Denoise error: %s", msg ? msg : "unknown");
+    }
+
+    void CreateFilter(uint32_t width, uint32_t height, uint32_t rowPitch)
+    {
+        auto& d = *g_oidn;
+
+        if (!d.Device)
+        {
+            // Picks the fastest supported device
+            d.Device = oidn::newDevice();
+            d.Device.commit();
+            CheckOidnError();
+        }
+
+        const size_t imageSize = (size_t)rowPitch * height;
+        d.Color = d.Device.newBuffer(imageSize);
+        d.Albedo = d.Device.newBuffer(imageSize);
+        d.Normal = d.Device.newBuffer(imageSize);
+        d.Output = d.Device.newBuffer(imageSize);
+
+        // Alpha is skipped by the pixel stride
+        constexpr size_t pixelStride = sizeof(float4);
+        d.Filter = d.Device.newFilter("RT");
+        d.Filter.setImage("color", d.Color, oidn::Format::Float3, width, height, 0, pixelStride, rowPitch);
+        d.Filter.setImage("albedo", d.Albedo, oidn::Format::Float3, width, height, 0, pixelStride, rowPitch);
+        d.Filter.setImage("normal", d.Normal, oidn::Format::Float3, width, height, 0, pixelStride, rowPitch);
+        d.Filter.setImage("output", d.Output, oidn::Format::Float3, width, height, 0, pixelStride, rowPitch);
+        d.Filter.set("hdr", true);
+        // Guides are from primary hits and averaged over all the samples, so they're
+        // practically noise-free
+        d.Filter.set("cleanAux", true);
+        d.Filter.set("quality", oidn::Quality::High);
+        d.Filter.commit();
+        CheckOidnError();
+
+        for (int i = 0; i < 2; i++)
+        {
+            d.Denoised[i].resize(imageSize);
+            d.Lum[i].resize(width);
+        }
+
+        d.Width = width;
+        d.Height = height;
+        d.RowPitch = rowPitch;
+        d.HasPrev = false;
+    }
+
+    // Mean absolute difference in luminance, relative to mean luminance of the current image
+    float RelativeChange(const uint8_t* curr, const uint8_t* prev)
+    {
+        auto& d = *g_oidn;
+        double sumDiff = 0.0;
+        double sumLum = 0.0;
+
+        for (uint32_t y = 0; y < d.Height; y++)
+        {
+            const size_t offset = (size_t)y * d.RowPitch;
+            Math::Luminance(Span<float4>(reinterpret_cast<const float4*>(curr + offset), d.Width), d.Lum[0]);
+            Math::Luminance(Span<float4>(reinterpret_cast<const float4*>(prev + offset), d.Width), d.Lum[1]);
+
+            for (uint32_t x = 0; x < d.Width; x++)
+            {
+                sumDiff += fabsf(d.Lum[0][x] - d.Lum[1][x]);
+                sumLum += d.Lum[0][x];
+            }
+        }
+
+        return (float)(sumDiff / Max(sumLum, 1e-6));
+    }
+}
+
+bool HeadlessDenoiser::IsAvailable()
+{
+    return true;
+}
+
+float HeadlessDenoiser::Denoise(const ScreenCapture& capture)
+{
+    Assert(capture.NumImages == 3, "Expected color, albedo and normal images.");
+
+    if (!g_oidn)
+        g_oidn = new OidnData;
+
+    auto& d = *g_oidn;
+
+    if (d.Width != capture.Width || d.Height != capture.Height || d.RowPitch != capture.RowPitch)
+        CreateFilter(capture.Width, capture.Height, capture.RowPitch);
+
+    const size_t imageSize = (size_t)capture.RowPitch * capture.Height;
+    d.Color.write(0, imageSize, capture.Image(0));
+    d.Albedo.write(0, imageSize, capture.Image(1));
+    d.Normal.write(0, imageSize, capture.Image(2));
+
+    d.Filter.execute();
+    CheckOidnError();
+
+    d.Output.read(0, imageSize, d.Denoised[d.Curr].data());
+
+    const float change = d.HasPrev ?
+        RelativeChange(d.Denoised[d.Curr].data(), d.Denoised[1 - d.Curr].data()) :
+        FLT_MAX;
+
+    d.Curr = 1 - d.Curr;
+    d.HasPrev = true;
+
+    return change;
+}
+
+void HeadlessDenoiser::Write(const char* path)
+{
+    Assert(g_oidn && g_oidn->HasPrev, "Nothing has been denoised.");
+    const auto& d = *g_oidn;
+
+    EXR::Write(path, d.Width, d.Height, d.Denoised[1 - d.Curr].data(), d.RowPitch);
+}
+
+void HeadlessDenoiser::Reset()
+{
+    if (g_oidn)
+        g_oidn->HasPrev = false;
+}
+
+void HeadlessDenoiser::Shutdown()
+{
+    delete g_oidn;
+    g_oidn = nullptr;
+}
+
+#else
+
+bool HeadlessDenoiser::IsAvailable()
+{
+    return false;
+}
+
+float HeadlessDenoiser::Denoise(const ScreenCapture&)
+{
+    Assert(false, "Built without Open Image Denoise.");
+    return FLT_MAX;
+}
+
+void HeadlessDenoiser::Write(const char*)
+{
+    Assert(false, "Built without Open Image Denoise.");
+}
+
+void HeadlessDenoiser::Reset()
+{
+}
+
+void HeadlessDenoiser::Shutdown()
+{
+}
+
+#endif
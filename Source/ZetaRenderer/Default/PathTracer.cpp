@@ -1,5 +1,4 @@
 #include "DefaultRendererImpl.h"
-#include <App/Timer.h>
 
 using namespace ZetaRay::Math;
 using namespace ZetaRay::RenderPass;
@@ -11,11 +10,32 @@ using namespace ZetaRay::Core::GpuMemory;
 using namespace ZetaRay::Core::Direct3DUtil;
 using namespace ZetaRay::Scene;
 
+namespace
+{
+    RenderNodeHandle RegisterIndirectLighting(PathTracerData& data, RenderGraph& renderGraph)
+    {
+        // ReSTIR PT is split into multiple command lists that are recorded in parallel
+        if (data.IndirecLightingPass.GetMethod() == IndirectLighting::INTEGRATOR::ReSTIR_PT)
+        {
+            fastdelegate::FastDelegate2<CommandList&, int> dlg = fastdelegate::MakeDelegate(
+                &data.IndirecLightingPass, &IndirectLighting::RenderSubCmdList);
+
+            return renderGraph.RegisterRenderPass("Indirect", RENDER_NODE_TYPE::COMPUTE, dlg,
+                IndirectLighting::NUM_RPT_SUB_CMD_LISTS);
+        }
+
+        fastdelegate::FastDelegate1<CommandList&> dlg = fastdelegate::MakeDelegate(
+            &data.IndirecLightingPass, &IndirectLighting::Render);
+
+        return renderGraph.RegisterRenderPass("Indirect", RENDER_NODE_TYPE::COMPUTE, dlg);
+    }
+}
+
 //--------------------------------------------------------------------------------------
 // PathTracer
 //--------------------------------------------------------------------------------------
 
-void PathTracer::Init(const RenderSettings& settings, PathTracerData& data)
+void PathTracer::Init(const RenderSettings& settings, PathTracerData& data, Support::TaskSet& ts)
 {
     // Allocate descriptor tables
     data.WndConstDescTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate(
@@ -23,43 +43,66 @@ void PathTracer::Init(const RenderSettings& settings, PathTracerData& data)
     data.ConstDescTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate(
         (int)PathTracerData::DESC_TABLE_CONST::COUNT);
 
-    // Inscattering + sku-view lut
-    data.SkyPass.Init(PathTracerData::SKY_LUT_WIDTH, PathTracerData::SKY_LUT_HEIGHT, 
-        settings.Inscattering);
+    // Passes are independent of each other, each one only writes to its own descriptors
+    ts.EmplaceTask("Sky_Init", [&settings, &data]()
+        {
+            // Inscattering + sku-view lut
+            data.SkyPass.Init(PathTracerData::SKY_LUT_WIDTH, PathTracerData::SKY_LUT_HEIGHT, 
+                settings.Inscattering);
 
-    Direct3DUtil::CreateTexture2DSRV(data.SkyPass.GetOutput(Sky::SHADER_OUT_RES::SKY_VIEW_LUT),
-        data.ConstDescTable.CPUHandle((int)PathTracerData::DESC_TABLE_CONST::ENV_MAP_SRV));
+            Direct3DUtil::CreateTexture2DSRV(data.SkyPass.GetOutput(Sky::SHADER_OUT_RES::SKY_VIEW_LUT),
+                data.ConstDescTable.CPUHandle((int)PathTracerData::DESC_TABLE_CONST::ENV_MAP_SRV));
 
-    if (settings.Inscattering)
-    {
-        Direct3DUtil::CreateTexture3DSRV(data.SkyPass.GetOutput(Sky::SHADER_OUT_RES::INSCATTERING),
-            data.ConstDescTable.CPUHandle((int)PathTracerData::DESC_TABLE_CONST::INSCATTERING_SRV));
-    }
+            if (settings.Inscattering)
+            {
+                Direct3DUtil::CreateTexture3DSRV(data.SkyPass.GetOutput(Sky::SHADER_OUT_RES::INSCATTERING),
+                    data.ConstDescTable.CPUHandle((int)PathTracerData::DESC_TABLE_CONST::INSCATTERING_SRV));
+            }
+        });
 
-    data.PreLightingPass.Init();
+    ts.EmplaceTask("PreLighting_Init", [&data]()
+        {
+            data.PreLightingPass.Init();
+        });
 
-    {
-        data.IndirecLightingPass.Init(settings.Indirect);
+    ts.EmplaceTask("RtInstanceUpdate_Init", [&data]()
+        {
+            data.RtInstanceUpdatePass.Init();
+            data.RtAS.SetInstanceTransformUpdateDlg(data.RtInstanceUpdatePass.GetInstanceTransformUpdateDlg());
+        });
 
-        const Texture& indirectFinal = data.IndirecLightingPass.GetOutput(
-            IndirectLighting::SHADER_OUT_RES::FINAL);
-        Direct3DUtil::CreateTexture2DSRV(indirectFinal, data.WndConstDescTable.CPUHandle(
-            (int)PathTracerData::DESC_TABLE_WND_SIZE_CONST::INDIRECT));
-    }
+    ts.EmplaceTask("IndirectLighting_Init", [&settings, &data]()
+        {
+            data.IndirecLightingPass.Init(settings.Indirect);
+
+            // Pixels that have reached the target error stop being sampled
+            const App::HeadlessDesc* headless = App::GetHeadlessDesc();
+            if (headless && headless->TargetRelError > 0)
+                data.IndirecLightingPass.SetAdaptiveSampling(true, headless->TargetRelError);
 
-    App::Filesystem::Path p(App::GetAssetDir());
-    p.Append("LUT\\rho.dds");
-    auto err = GpuMemory::GetTexture3DFromDisk(p.Get(), data.m_rhoLUT);
-    Check(err == LOAD_DDS_RESULT::SUCCESS, "Error loading DDS texture from path %s: %d",
-        p.Get(), err);
+            const Texture& indirectFinal = data.IndirecLightingPass.GetOutput(
+                IndirectLighting::SHADER_OUT_RES::FINAL);
+            Direct3DUtil::CreateTexture2DSRV(indirectFinal, data.WndConstDescTable.CPUHandle(
+                (int)PathTracerData::DESC_TABLE_WND_SIZE_CONST::INDIRECT));
+        });
 
-    const DescriptorTable& table = App::GetRenderer().ReservedDescTable();
-    Direct3DUtil::CreateTexture3DSRV(data.m_rhoLUT, table.CPUHandle(0));
+    ts.EmplaceTask("RhoLUT_Load", [&data]()
+        {
+            App::Filesystem::Path p(App::GetAssetDir());
+            p.Append("LUT\\rho.dds");
+            auto err = GpuMemory::GetTexture3DFromDisk(p.Get(), data.m_rhoLUT);
+            Check(err == LOAD_DDS_RESULT::SUCCESS, "Error loading DDS texture from path %s: %d",
+                p.Get(), err);
+
+            const DescriptorTable& table = App::GetRenderer().ReservedDescTable();
+            Direct3DUtil::CreateTexture3DSRV(data.m_rhoLUT, table.CPUHandle(0));
+        });
 }
 
 void PathTracer::OnWindowSizeChanged(const RenderSettings& settings, PathTracerData& data)
 {
-    // GPU is flushed after resize, safe to reuse descriptors
+    data.WndConstDescTable = App::GetRenderer().GetGpuDescriptorHeap().Allocate(
+        (int)PathTracerData::DESC_TABLE_WND_SIZE_CONST::COUNT);
 
     data.PreLightingPass.OnWindowResized();
 
@@ -90,6 +133,16 @@ void PathTracer::OnWindowSizeChanged(const RenderSettings& settings, PathTracerD
         CreateTexture2DSRV(indirectFinal, data.WndConstDescTable.CPUHandle(
             (int)PathTracerData::DESC_TABLE_WND_SIZE_CONST::INDIRECT));
     }
+
+    if (data.IndirectDenoiserPass.IsInitialized())
+    {
+        data.IndirectDenoiserPass.OnWindowResized();
+
+        const Texture& t = data.IndirectDenoiserPass.GetOutput(
+            Denoiser::SHADER_OUT_RES::DENOISED);
+        CreateTexture2DSRV(t, data.WndConstDescTable.CPUHandle(
+            (int)PathTracerData::DESC_TABLE_WND_SIZE_CONST::DENOISED_INDIRECT));
+    }
 }
 
 void PathTracer::Update(const RenderSettings& settings, Core::RenderGraph& renderGraph, 
@@ -118,11 +171,41 @@ void PathTracer::Update(const RenderSettings& settings, Core::RenderGraph& rende
             (int)PathTracerData::DESC_TABLE_WND_SIZE_CONST::SKY_DI));
     }
 
+    if (settings.DenoiseIndirect)
+    {
+        if (!data.IndirectDenoiserPass.IsInitialized())
+        {
+            data.IndirectDenoiserPass.Init();
+
+            const Texture& t = data.IndirectDenoiserPass.GetOutput(
+                Denoiser::SHADER_OUT_RES::DENOISED);
+            CreateTexture2DSRV(t, data.WndConstDescTable.CPUHandle(
+                (int)PathTracerData::DESC_TABLE_WND_SIZE_CONST::DENOISED_INDIRECT));
+        }
+
+        // Descriptor table is reallocated when window is resized
+        data.IndirectDenoiserPass.SetDescriptor(Denoiser::SHADER_IN_DESC::SIGNAL,
+            data.WndConstDescTable.GPUDescriptorHeapIndex(
+                (int)PathTracerData::DESC_TABLE_WND_SIZE_CONST::INDIRECT));
+    }
+
     data.RtAS.Update();
 
+    // Light BVH is only useful for emissive lighting
+    const bool useLightBVH = settings.UseLightBVH && emissiveLighting;
+    data.PreLightingPass.SetLightBVH(useLightBVH);
+    data.PreLightingPass.SetLightBVHClusters(settings.LightBVHClusters);
+    data.PreLightingPass.SetViewDependentPresampling(settings.ViewDependentPresampling &&
+        settings.Indirect != IndirectLighting::INTEGRATOR::ReSTIR_PT);
+    data.IndirecLightingPass.SetLightBVH(useLightBVH);
+    data.IndirecLightingPass.SetResamplingInterval(settings.ResamplingInterval);
+
+    if (data.SkyDI_Pass.IsInitialized())
+        data.SkyDI_Pass.SetResamplingInterval(settings.ResamplingInterval);
+
+    // Recomputes alias table only if there are stale emissives
     data.PreLightingPass.Update();
 
-    // Recompute alias table only if there are stale emissives
     if (numEmissives > 0)
     {
         if (emissiveLighting && !data.DirecLightingPass.IsInitialized())
@@ -137,11 +220,12 @@ void PathTracer::Update(const RenderSettings& settings, Core::RenderGraph& rende
                 Defaults::NUM_SAMPLE_SETS, Defaults::SAMPLE_SET_SIZE);
         }
 
-        if (App::GetScene().AreEmissiveMaterialsStale())
+        if (data.DirecLightingPass.IsInitialized())
         {
-            auto& readback = data.PreLightingPass.GetLumenReadbackBuffer();
-            data.EmissiveAliasTable.Update(&readback);
-            data.EmissiveAliasTable.SetReleaseBuffersDlg(data.PreLightingPass.GetReleaseBuffersDlg());
+            data.DirecLightingPass.SetLightBVH(useLightBVH);
+            data.DirecLightingPass.SetResamplingInterval(settings.ResamplingInterval);
+            data.DirecLightingPass.SetLightVoxelGridParams(settings.UseLVG && settings.LightPresampling,
+                settings.VoxelGridDim, settings.VoxelExtents, settings.VoxelGridyOffset);
         }
     }
 }
@@ -149,18 +233,22 @@ void PathTracer::Update(const RenderSettings& settings, Core::RenderGraph& rende
 void PathTracer::Register(const RenderSettings& settings, PathTracerData& data, 
     RenderGraph& renderGraph)
 {
-    // Rt AS rebuild/update
+    // Rt AS rebuild/update. Doesn't depend on anything else from this frame, so on the
+    // async. compute queue it can overlap the previous frame's post-processing, with 
+    // consumers waiting on its completion fence.
     {
         fastdelegate::FastDelegate1<CommandList&> dlg1 = fastdelegate::MakeDelegate(
             &data.RtAS, &TLAS::Render);
         data.RtASBuildHandle = renderGraph.RegisterRenderPass("RT_AS_Build", 
-            RENDER_NODE_TYPE::COMPUTE, dlg1);
+            settings.AsyncASBuild ? RENDER_NODE_TYPE::ASYNC_COMPUTE : RENDER_NODE_TYPE::COMPUTE, 
+            dlg1);
+        // Compaction readback
+        renderGraph.KeepAlive(data.RtASBuildHandle);
     }
 
     const bool tlasReady = data.RtAS.IsReady();
     const bool numEmissives = App::GetScene().NumEmissiveInstances();
     const bool emissiveLighting = App::GetScene().EmissiveLighting();
-    const auto frame = App::GetTimer().GetTotalFrameCount();
 
     // Sky-view lut + inscattering
     if (tlasReady)
@@ -199,115 +287,98 @@ void PathTracer::Register(const RenderSettings& settings, PathTracerData& data,
             &PreLighting::Render);
         data.PreLightingPassHandle = renderGraph.RegisterRenderPass("PreLighting", 
             RENDER_NODE_TYPE::COMPUTE, dlg1);
+        // Alias table is consumed outside of render graph in later frames
+        renderGraph.KeepAlive(data.PreLightingPassHandle);
 
-        // Read back emissive lumen buffer and compute alias table on CPU
+        // Alias table is rebuilt on the GPU whenever emissives change
         if (App::GetScene().AreEmissiveMaterialsStale())
         {
-            auto& triPowerBuffer = data.PreLightingPass.GetTriEmissivePowerBuffer();
-            renderGraph.RegisterResource(const_cast<Buffer&>(triPowerBuffer).Resource(),
-                triPowerBuffer.ID(), D3D12_RESOURCE_STATE_COPY_SOURCE, false);
-
-            fastdelegate::FastDelegate1<CommandList&> dlg2 = fastdelegate::MakeDelegate(&data.EmissiveAliasTable,
-                &EmissiveTriangleAliasTable::Render);
-            data.EmissiveAliasTableHandle = renderGraph.RegisterRenderPass("EmissiveAliasTable", 
-                RENDER_NODE_TYPE::COMPUTE, dlg2);
-
-            auto& aliasTable = data.EmissiveAliasTable.GetOutput(
-                EmissiveTriangleAliasTable::SHADER_OUT_RES::ALIAS_TABLE);
-            renderGraph.RegisterResource(aliasTable.Resource(), aliasTable.ID(), 
-                D3D12_RESOURCE_STATE_COMMON, false);
-
-            data.EmissiveAliasTable.SetEmissiveTriPassHandle(data.PreLightingPassHandle);
+            auto& aliasTable = data.PreLightingPass.GetEmissiveAliasTable();
+            renderGraph.RegisterResource(const_cast<Buffer&>(aliasTable).Resource(), 
+                aliasTable.ID(), D3D12_RESOURCE_STATE_COMMON, false);
         }
-        // Since alias table is computed on CPU, instead of waiting for GPU to finish
-        // computation and causing a hitch, defer computation to next frame(s) at
-        // the expense of some lag
-        else if (data.EmissiveAliasTable.HasPendingRender())
+
+        // Same for the light BVH, which is also refit when emissive positions change
+        if (data.PreLightingPass.IsLightBVHUpdated())
         {
-            fastdelegate::FastDelegate1<CommandList&> dlg2 = fastdelegate::MakeDelegate(&data.EmissiveAliasTable,
-                &EmissiveTriangleAliasTable::Render);
-            data.EmissiveAliasTableHandle = renderGraph.RegisterRenderPass("EmissiveAliasTable",
-                RENDER_NODE_TYPE::COMPUTE, dlg2);
+            auto& lightBVH = data.PreLightingPass.GetLightBVH();
+            renderGraph.RegisterResource(const_cast<Buffer&>(lightBVH).Resource(), 
+                lightBVH.ID(), D3D12_RESOURCE_STATE_COMMON, false);
+        }
 
-            // Refer to notes in lines 413-415
-            if (settings.LightPresampling)
-            {
-                auto& aliasTable = data.EmissiveAliasTable.GetOutput(
-                    EmissiveTriangleAliasTable::SHADER_OUT_RES::ALIAS_TABLE);
-                renderGraph.RegisterResource(aliasTable.Resource(), aliasTable.ID(),
-                    D3D12_RESOURCE_STATE_COMMON, false);
-            }
+        // Emissive triangles of moved instances are transformed in place
+        if (data.PreLightingPass.AreEmissivePositionsUpdated())
+        {
+            auto& emissives = App::GetScene().GetEmissiveTriangleBuffer();
+            renderGraph.RegisterResource(const_cast<Buffer&>(emissives).Resource(), 
+                emissives.ID(), D3D12_RESOURCE_STATE_COMMON, false);
         }
 
         if (tlasReady)
         {
-            // At frame 1 (app startup is counted as "frame" 0, so program
-            // loop starts from frame 1):
-            // 1. Power of each emissive triangle is estimated (1)
-            // 2. Results of step 1 are read back on CPU and alias table is built (1)
-            // 3. Alias table is uploaded to GPU
-            // 4. If light presampling is enabled, presampled sets are built each frame 
-            //    using the alias table starting from next frame (2 - one frame of delay)
-            // 
-            // In conclusion, when light presampling is enabled, shaders that depend on it 
-            // shouldn't execute in frame 1.
-            const bool presampledSetsBuiltOnce = frame > 1;
-
-            if (!settings.LightPresampling || presampledSetsBuiltOnce)
+            // When emissives change, power of each emissive triangle is estimated, alias 
+            // table is built and (if light presampling is enabled) presampled sets are 
+            // built from it, all in the same frame on the GPU. Therefore, shaders that 
+            // depend on them can execute in that frame too.
+            // Pre lighting
+            if (settings.LightPresampling && emissiveLighting)
             {
-                // Pre lighting
-                if (settings.LightPresampling && presampledSetsBuiltOnce && emissiveLighting)
-                {
-                    auto& presampled = data.PreLightingPass.GePresampledSets();
-                    renderGraph.RegisterResource(const_cast<Buffer&>(presampled).Resource(), 
-                        presampled.ID(), D3D12_RESOURCE_STATE_COMMON);
-
-                    if (settings.UseLVG)
-                    {
-                        auto& lvg = data.PreLightingPass.GetLightVoxelGrid();
-                        renderGraph.RegisterResource(const_cast<Buffer&>(lvg).Resource(), lvg.ID(),
-                            D3D12_RESOURCE_STATE_COMMON);
-                    }
-                }
+                auto& presampled = data.PreLightingPass.GePresampledSets();
+                renderGraph.RegisterResource(const_cast<Buffer&>(presampled).Resource(), 
+                    presampled.ID(), D3D12_RESOURCE_STATE_COMMON);
 
-                // Direct lighting
-                if (emissiveLighting)
+                if (settings.UseLVG)
                 {
-                    fastdelegate::FastDelegate1<CommandList&> dlg3 = fastdelegate::MakeDelegate(&data.DirecLightingPass,
-                        &DirectLighting::Render);
-                    data.DirecLightingHandle = renderGraph.RegisterRenderPass("DirectLighting", 
-                        RENDER_NODE_TYPE::COMPUTE, dlg3);
-
-                    Texture& td = const_cast<Texture&>(data.DirecLightingPass.GetOutput(
-                        DirectLighting::SHADER_OUT_RES::FINAL));
-                    renderGraph.RegisterResource(td.Resource(), td.ID());
+                    auto& lvg = data.PreLightingPass.GetLightVoxelGrid();
+                    renderGraph.RegisterResource(const_cast<Buffer&>(lvg).Resource(), lvg.ID(),
+                        D3D12_RESOURCE_STATE_COMMON);
                 }
+            }
 
-                // Indirect lighting
-                fastdelegate::FastDelegate1<CommandList&> dlg2 = fastdelegate::MakeDelegate(
-                    &data.IndirecLightingPass, &IndirectLighting::Render);
-                data.IndirecLightingHandle = renderGraph.RegisterRenderPass("Indirect", 
-                    RENDER_NODE_TYPE::COMPUTE, dlg2);
-
-                Texture& ti = const_cast<Texture&>(data.IndirecLightingPass.GetOutput(
-                    IndirectLighting::SHADER_OUT_RES::FINAL));
-                renderGraph.RegisterResource(ti.Resource(), ti.ID());
+            // Direct lighting
+            if (emissiveLighting)
+            {
+                fastdelegate::FastDelegate1<CommandList&> dlg3 = fastdelegate::MakeDelegate(&data.DirecLightingPass,
+                    &DirectLighting::Render);
+                data.DirecLightingHandle = renderGraph.RegisterRenderPass("DirectLighting", 
+                    RENDER_NODE_TYPE::COMPUTE, dlg3);
+
+                Texture& td = const_cast<Texture&>(data.DirecLightingPass.GetOutput(
+                    DirectLighting::SHADER_OUT_RES::FINAL));
+                renderGraph.RegisterResource(td.Resource(), td.ID());
             }
+
+            // Indirect lighting
+            data.IndirecLightingHandle = RegisterIndirectLighting(data, renderGraph);
+
+            Texture& ti = const_cast<Texture&>(data.IndirecLightingPass.GetOutput(
+                IndirectLighting::SHADER_OUT_RES::FINAL));
+            renderGraph.RegisterResource(ti.Resource(), ti.ID());
         }
     }
     // Indirect lighting
     else if (tlasReady)
     {
-        fastdelegate::FastDelegate1<CommandList&> dlg2 = fastdelegate::MakeDelegate(
-            &data.IndirecLightingPass, &IndirectLighting::Render);
-        data.IndirecLightingHandle = renderGraph.RegisterRenderPass("Indirect", 
-            RENDER_NODE_TYPE::COMPUTE, dlg2);
+        data.IndirecLightingHandle = RegisterIndirectLighting(data, renderGraph);
 
         Texture& t = const_cast<Texture&>(data.IndirecLightingPass.GetOutput(
             IndirectLighting::SHADER_OUT_RES::FINAL));
         renderGraph.RegisterResource(t.Resource(), t.ID());
     }
 
+    // Indirect lighting denoiser
+    if (tlasReady && settings.DenoiseIndirect)
+    {
+        fastdelegate::FastDelegate1<CommandList&> dlg = fastdelegate::MakeDelegate(
+            &data.IndirectDenoiserPass, &Denoiser::Render);
+        data.IndirectDenoiserHandle = renderGraph.RegisterRenderPass("IndirectDenoiser", 
+            RENDER_NODE_TYPE::COMPUTE, dlg);
+
+        Texture& t = const_cast<Texture&>(data.IndirectDenoiserPass.GetOutput(
+            Denoiser::SHADER_OUT_RES::DENOISED));
+        renderGraph.RegisterResource(t.Resource(), t.ID());
+    }
+
     // Sky DI
     if (!emissiveLighting && tlasReady)
     {
@@ -330,7 +401,6 @@ void PathTracer::AddAdjacencies(const RenderSettings& settings, PathTracerData&
     const auto tlasID = tlasReady ? data.RtAS.GetTLAS().ID() : Buffer::INVALID_ID;
     const auto numEmissives = App::GetScene().NumEmissiveInstances();
     const auto emissiveLighting = App::GetScene().EmissiveLighting();
-    const auto frame = App::GetTimer().GetTotalFrameCount();
 
     // Rt AS
     if (tlasReady)
@@ -364,9 +434,7 @@ void PathTracer::AddAdjacencies(const RenderSettings& settings, PathTracerData&
     handles.reserve(3);
     handles.push_back(data.IndirecLightingHandle);
     
-    // When light presampling is enabled, sample sets are available starting frame frame 2
-    const bool presampledSetsBuiltOnce = frame > 1;
-    if (emissiveLighting && (!settings.LightPresampling || presampledSetsBuiltOnce))
+    if (emissiveLighting)
         handles.push_back(data.DirecLightingHandle);
 
     if(!emissiveLighting)
@@ -377,61 +445,78 @@ void PathTracer::AddAdjacencies(const RenderSettings& settings, PathTracerData&
         // Pre lighting
         if (App::GetScene().AreEmissiveMaterialsStale())
         {
-            const auto& triPowerBuffer = data.PreLightingPass.GetTriEmissivePowerBuffer();
+            renderGraph.AddOutput(data.PreLightingPassHandle,
+                data.PreLightingPass.GetEmissiveAliasTable().ID(),
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        }
+
+        if (data.PreLightingPass.IsLightBVHUpdated())
+        {
+            const uint32_t lightBVH = data.PreLightingPass.GetLightBVH().ID();
 
             renderGraph.AddOutput(data.PreLightingPassHandle,
-                triPowerBuffer.ID(),
-                D3D12_RESOURCE_STATE_COPY_SOURCE);
+                lightBVH,
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-            renderGraph.AddInput(data.EmissiveAliasTableHandle,
-                triPowerBuffer.ID(),
-                D3D12_RESOURCE_STATE_COPY_SOURCE);
+            // Similar to alias table, prelighting transitions the light BVH to shader 
+            // resource itself after the build
+            if (tlasReady && emissiveLighting)
+            {
+                renderGraph.AddInput(data.DirecLightingHandle,
+                    lightBVH,
+                    D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-            renderGraph.AddOutput(data.EmissiveAliasTableHandle,
-                data.EmissiveAliasTable.GetOutput(EmissiveTriangleAliasTable::SHADER_OUT_RES::ALIAS_TABLE).ID(),
-                D3D12_RESOURCE_STATE_COPY_DEST);
+                renderGraph.AddInput(data.IndirecLightingHandle,
+                    lightBVH,
+                    D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+            }
         }
-        // Tri lumen buffer was recomputed last frame, but the results weren't ready yet. Now
-        // in this frame, alias table pass has no dependencies, but prelighting should run
-        // after it so the new alias table is used as early as possible for presampling.
-        else if (settings.LightPresampling && data.EmissiveAliasTable.HasPendingRender())
+
+        if (data.PreLightingPass.AreEmissivePositionsUpdated())
         {
-            const uint32_t aliasTable = data.EmissiveAliasTable.GetOutput(
-                EmissiveTriangleAliasTable::SHADER_OUT_RES::ALIAS_TABLE).ID();
+            const uint32_t emissives = App::GetScene().GetEmissiveTriangleBuffer().ID();
 
-            renderGraph.AddOutput(data.EmissiveAliasTableHandle,
-                aliasTable,
-                D3D12_RESOURCE_STATE_COPY_DEST);
+            renderGraph.AddOutput(data.PreLightingPassHandle,
+                emissives,
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-            renderGraph.AddInput(data.PreLightingPassHandle,
-                aliasTable,
-                D3D12_RESOURCE_STATE_COPY_DEST);
+            // Same as light BVH, transitioned to shader resource by prelighting itself
+            if (tlasReady && emissiveLighting)
+            {
+                renderGraph.AddInput(data.DirecLightingHandle,
+                    emissives,
+                    D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+                renderGraph.AddInput(data.IndirecLightingHandle,
+                    emissives,
+                    D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+            }
         }
 
         // Direct + indirect lighting
         if (tlasReady && emissiveLighting)
         {
-            // Lighting passes should run after alias table when it's recomputed
-            if (!settings.LightPresampling && 
-                (App::GetScene().AreEmissiveMaterialsStale() || data.EmissiveAliasTable.HasPendingRender()))
+            // Lighting passes should run after alias table when it's recomputed. Prelighting
+            // transitions it to shader resource itself once the build has finished (so that
+            // presampling can read it), hence the expected state.
+            if (!settings.LightPresampling && App::GetScene().AreEmissiveMaterialsStale())
             {
-                const uint32_t aliasTable = data.EmissiveAliasTable.GetOutput(
-                    EmissiveTriangleAliasTable::SHADER_OUT_RES::ALIAS_TABLE).ID();
+                const uint32_t aliasTable = data.PreLightingPass.GetEmissiveAliasTable().ID();
 
                 renderGraph.AddInput(data.DirecLightingHandle,
                     aliasTable,
-                    D3D12_RESOURCE_STATE_COPY_DEST);
+                    D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
                 renderGraph.AddInput(data.IndirecLightingHandle,
                     aliasTable,
-                    D3D12_RESOURCE_STATE_COPY_DEST);
+                    D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
                 renderGraph.AddOutput(data.DirecLightingHandle,
                     data.DirecLightingPass.GetOutput(DirectLighting::SHADER_OUT_RES::FINAL).ID(),
                     D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
             }
             // Lighting passes should run after light presampling pass
-            else if(settings.LightPresampling && presampledSetsBuiltOnce)
+            else if(settings.LightPresampling)
             {
                 const uint32_t presampled = data.PreLightingPass.GePresampledSets().ID();
 
@@ -445,6 +530,10 @@ void PathTracer::AddAdjacencies(const RenderSettings& settings, PathTracerData&
                         data.PreLightingPass.GetLightVoxelGrid().ID(),
                         D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
+                    renderGraph.AddInput(data.DirecLightingHandle,
+                        data.PreLightingPass.GetLightVoxelGrid().ID(),
+                        D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
                     renderGraph.AddInput(data.IndirecLightingHandle,
                         data.PreLightingPass.GetLightVoxelGrid().ID(),
                         D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
@@ -484,14 +573,17 @@ void PathTracer::AddAdjacencies(const RenderSettings& settings, PathTracerData&
                 gbuffData.BaseColor[1 - outIdx].ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
+#if PACKED_GBUFFER == 0
             renderGraph.AddInput(handles[i],
                 gbuffData.Normal[1 - outIdx].ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+#endif
 
             renderGraph.AddInput(handles[i],
                 gbuffData.MetallicRoughness[1 - outIdx].ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
+#if PACKED_GBUFFER == 0
             renderGraph.AddInput(handles[i],
                 gbuffData.IORBuffer[1 - outIdx].ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
@@ -499,19 +591,25 @@ void PathTracer::AddAdjacencies(const RenderSettings& settings, PathTracerData&
             renderGraph.AddInput(handles[i],
                 gbuffData.CoatBuffer[1 - outIdx].ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+#endif
 
-            renderGraph.AddInput(handles[i],
-                gbuffData.TriDiffGeo_A[1 - outIdx].ID(),
-                D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            if (!gbuffData.VisibilityBuffer)
+            {
+                renderGraph.AddInput(handles[i],
+                    gbuffData.TriDiffGeo_A[1 - outIdx].ID(),
+                    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            }
 
             renderGraph.AddInput(handles[i],
                 gbuffData.TriDiffGeo_B[1 - outIdx].ID(),
                 D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
             // Current g-buffers
+#if PACKED_GBUFFER == 0
             renderGraph.AddInput(handles[i],
                 gbuffData.Normal[outIdx].ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+#endif
 
             renderGraph.AddInput(handles[i],
                 gbuffData.MetallicRoughness[outIdx].ID(),
@@ -529,6 +627,7 @@ void PathTracer::AddAdjacencies(const RenderSettings& settings, PathTracerData&
                 gbuffData.BaseColor[outIdx].ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
+#if PACKED_GBUFFER == 0
             renderGraph.AddInput(handles[i],
                 gbuffData.IORBuffer[outIdx].ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
@@ -536,10 +635,14 @@ void PathTracer::AddAdjacencies(const RenderSettings& settings, PathTracerData&
             renderGraph.AddInput(handles[i],
                 gbuffData.CoatBuffer[outIdx].ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+#endif
 
-            renderGraph.AddInput(handles[i],
-                gbuffData.TriDiffGeo_A[outIdx].ID(),
-                D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            if (!gbuffData.VisibilityBuffer)
+            {
+                renderGraph.AddInput(handles[i],
+                    gbuffData.TriDiffGeo_A[outIdx].ID(),
+                    D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            }
 
             renderGraph.AddInput(handles[i],
                 gbuffData.TriDiffGeo_B[outIdx].ID(),
@@ -552,6 +655,45 @@ void PathTracer::AddAdjacencies(const RenderSettings& settings, PathTracerData&
             D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     }
 
+    // Indirect lighting denoiser -- reprojects using current and previous g-buffers
+    if (tlasReady && settings.DenoiseIndirect)
+    {
+        const RenderNodeHandle h = data.IndirectDenoiserHandle;
+
+        renderGraph.AddInput(h,
+            data.IndirecLightingPass.GetOutput(IndirectLighting::SHADER_OUT_RES::FINAL).ID(),
+            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+        for (int i = 0; i < 2; i++)
+        {
+            renderGraph.AddInput(h,
+                gbuffData.Depth[i].ID(),
+                D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+
+#if PACKED_GBUFFER == 0
+            renderGraph.AddInput(h,
+                gbuffData.Normal[i].ID(),
+                D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+#endif
+
+            renderGraph.AddInput(h,
+                gbuffData.MetallicRoughness[i].ID(),
+                D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+        }
+
+        renderGraph.AddInput(h,
+            gbuffData.BaseColor[outIdx].ID(),
+            D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+
+        renderGraph.AddInput(h,
+            gbuffData.MotionVec.ID(),
+            D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+
+        renderGraph.AddOutput(h,
+            data.IndirectDenoiserPass.GetOutput(Denoiser::SHADER_OUT_RES::DENOISED).ID(),
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    }
+
     // Sky DI
     if (!emissiveLighting && tlasReady)
     {
@@ -0,0 +1,167 @@
+#include "DefaultRendererImpl.h"
+#include <App/Log.h>
+#include <App/Path.h>
+#include <App/Filesystem.h>
+#include <Core/RendererCore.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::DefaultRenderer;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Support;
+
+namespace
+{
+    struct PerfTierConfig
+    {
+        static constexpr uint32_t MAGIC = 0x52454954;   // "TIER"
+        static constexpr uint32_t VERSION = 1;
+
+        uint32_t Magic;
+        uint32_t Version;
+        // Adapter that the tier was chosen for
+        uint32_t VendorID;
+        uint32_t DeviceID;
+        uint64_t DedicatedVideoMemory;
+        uint32_t Tier;
+        uint32_t Calibrated;
+    };
+
+    void ConfigPath(App::Filesystem::Path& path)
+    {
+        path.Reset(App::GetPSOCacheDir());
+        path.Append("PerformanceTier.cfg");
+    }
+
+    PERF_TIER TierFromDeviceCaps(const DeviceObjects& device)
+    {
+        const uint64_t vramMB = device.m_dedicatedVideoMemory / (1024 * 1024);
+
+        if (vramMB >= PerformanceTier::MIN_VRAM_HIGH)
+            return PERF_TIER::HIGH;
+        if (vramMB >= PerformanceTier::MIN_VRAM_MEDIUM)
+            return PERF_TIER::MEDIUM;
+
+        return PERF_TIER::LOW;
+    }
+
+    void ResetMeasurement(PerformanceTier& data)
+    {
+        data.NumFrames = 0;
+        data.SumFrameTimeMs = 0.0;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// PerfTier
+//--------------------------------------------------------------------------------------
+
+void PerfTier::Init(PerformanceTier& data)
+{
+    const DeviceObjects& device = App::GetRenderer().GetDeviceObjects();
+
+    App::Filesystem::Path path;
+    ConfigPath(path);
+
+    if (App::Filesystem::Exists(path.Get()) &&
+        App::Filesystem::GetFileSize(path.Get()) == sizeof(PerfTierConfig))
+    {
+        Vector<uint8_t, SystemAllocator> file;
+        App::Filesystem::LoadFromFile(path.Get(), file);
+
+        PerfTierConfig config;
+        memcpy(&config, file.data(), sizeof(config));
+
+        if (config.Magic == PerfTierConfig::MAGIC &&
+            config.Version == PerfTierConfig::VERSION &&
+            config.VendorID == device.m_vendorID &&
+            config.DeviceID == device.m_deviceID &&
+            config.DedicatedVideoMemory == device.m_dedicatedVideoMemory &&
+            config.Tier < (uint32_t)PERF_TIER::COUNT)
+        {
+            data.Tier = (PERF_TIER)config.Tier;
+            // Calibration didn't get to finish last time
+            data.Calibrating = PerformanceTier::CALIBRATE_ON_FIRST_LAUNCH && !config.Calibrated;
+
+            LOG_UI_INFO("Performance tier: %s (from %s).", PerfTierOptions[config.Tier], path.Get());
+
+            return;
+        }
+    }
+
+    data.Tier = TierFromDeviceCaps(device);
+    data.Calibrating = PerformanceTier::CALIBRATE_ON_FIRST_LAUNCH;
+    data.LastStep = 0;
+    ResetMeasurement(data);
+
+    LOG_UI_INFO("Performance tier: %s (%s, %llu MB VRAM, wave size %u-%u).",
+        PerfTierOptions[(int)data.Tier], device.m_deviceName,
+        device.m_dedicatedVideoMemory / (1024 * 1024), device.m_waveLaneCountMin,
+        device.m_waveLaneCountMax);
+
+    Save(data);
+}
+
+bool PerfTier::Calibrate(PerformanceTier& data, float gpuFrameTimeMs)
+{
+    Assert(data.Calibrating, "Calibration is not in progress.");
+
+    // Skip the frames right after a (tier) change, as resources are recreated and
+    // temporal history is invalid
+    if (++data.NumFrames <= PerformanceTier::NUM_CALIBRATION_WARMUP_FRAMES)
+        return false;
+
+    data.SumFrameTimeMs += gpuFrameTimeMs;
+
+    if (data.NumFrames < PerformanceTier::NUM_CALIBRATION_WARMUP_FRAMES +
+        PerformanceTier::NUM_CALIBRATION_FRAMES)
+    {
+        return false;
+    }
+
+    const float avgMs = (float)(data.SumFrameTimeMs / PerformanceTier::NUM_CALIBRATION_FRAMES);
+    const float ratio = avgMs / PerformanceTier::TARGET_FRAME_TIME_MS;
+    const PERF_TIER prevTier = data.Tier;
+    ResetMeasurement(data);
+
+    if (ratio > PerformanceTier::DOWNGRADE_THRESHOLD && data.Tier != PERF_TIER::LOW)
+    {
+        data.Tier = (PERF_TIER)((int)data.Tier - 1);
+        // Went up a tier and it was too slow, done
+        data.Calibrating = data.LastStep != 1;
+        data.LastStep = -1;
+    }
+    else if (ratio < PerformanceTier::UPGRADE_THRESHOLD && data.Tier != PERF_TIER::HIGH &&
+        data.LastStep != -1)
+    {
+        data.Tier = (PERF_TIER)((int)data.Tier + 1);
+        data.LastStep = 1;
+    }
+    else
+        data.Calibrating = false;
+
+    LOG_UI_INFO("Performance tier calibration: %.2f ms at %s%s%s.", avgMs,
+        PerfTierOptions[(int)prevTier], data.Tier != prevTier ? ", switching to " : "",
+        data.Tier != prevTier ? PerfTierOptions[(int)data.Tier] : "");
+
+    Save(data);
+
+    return data.Tier != prevTier;
+}
+
+void PerfTier::Save(const PerformanceTier& data)
+{
+    const DeviceObjects& device = App::GetRenderer().GetDeviceObjects();
+
+    PerfTierConfig config{ .Magic = PerfTierConfig::MAGIC,
+        .Version = PerfTierConfig::VERSION,
+        .VendorID = device.m_vendorID,
+        .DeviceID = device.m_deviceID,
+        .DedicatedVideoMemory = device.m_dedicatedVideoMemory,
+        .Tier = (uint32_t)data.Tier,
+        .Calibrated = !data.Calibrating };
+
+    App::Filesystem::Path path;
+    ConfigPath(path);
+    App::Filesystem::WriteToFile(path.Get(), reinterpret_cast<uint8_t*>(&config), sizeof(config));
+}
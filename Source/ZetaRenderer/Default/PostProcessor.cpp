@@ -11,14 +11,39 @@ using namespace ZetaRay::Core::GpuMemory;
 // PostProcessor
 //--------------------------------------------------------------------------------------
 
-void PostProcessor::Init(const RenderSettings& settings, PostProcessData& data)
+void PostProcessor::Init(const RenderSettings& settings, PostProcessData& data, Support::TaskSet& ts)
 {
-    data.AutoExposurePass.Init();
-    data.DisplayPass.Init();
-    data.GuiPass.Init();
-    data.CompositingPass.Init();
+    auto autoExposure = ts.EmplaceTask("AutoExposure_Init", [&data]()
+        {
+            data.AutoExposurePass.Init();
+        });
 
-    UpdateWndDependentDescriptors(settings, data);
+    ts.EmplaceTask("Display_Init", [&data]()
+        {
+            data.DisplayPass.Init();
+        });
+
+    ts.EmplaceTask("GUI_Init", [&data]()
+        {
+            data.GuiPass.Init();
+        });
+
+    auto compositing = ts.EmplaceTask("Compositing_Init", [&settings, &data]()
+        {
+            data.CompositingPass.Init();
+
+            if (settings.HeadlessDenoise)
+                data.CompositingPass.SetDenoiserAuxEnablement(true);
+        });
+
+    // Needs the outputs of auto exposure and compositing
+    auto descriptors = ts.EmplaceTask("PostProcessor_Descriptors", [&settings, &data]()
+        {
+            UpdateWndDependentDescriptors(settings, data);
+        });
+
+    ts.AddOutgoingEdge(autoExposure, descriptors);
+    ts.AddOutgoingEdge(compositing, descriptors);
 }
 
 void PostProcessor::UpdateWndDependentDescriptors(const RenderSettings& settings, 
@@ -44,35 +69,51 @@ void PostProcessor::UpdateFrameDescriptors(const RenderSettings& settings, PostP
     {
         const int outIdx = App::GetRenderer().GlobalIdxForDoubleBufferedResources();
 
-        data.TaaOrFsr2OutSRV = App::GetRenderer().GetGpuDescriptorHeap().Allocate(1);
+        data.TaaOrUpscalerOutSRV = App::GetRenderer().GetGpuDescriptorHeap().Allocate(1);
 
         // Due to ping-ponging, TAA's output texture changes every frame
         const TAA::SHADER_OUT_RES taaOutIdx = outIdx == 0 ? TAA::SHADER_OUT_RES::OUTPUT_B : 
             TAA::SHADER_OUT_RES::OUTPUT_A;
         Texture& taaOut = data.TaaPass.GetOutput(taaOutIdx);
-        Direct3DUtil::CreateTexture2DSRV(taaOut, data.TaaOrFsr2OutSRV.CPUHandle(0));
+        Direct3DUtil::CreateTexture2DSRV(taaOut, data.TaaOrUpscalerOutSRV.CPUHandle(0));
+    }
+
+    if (App::GetRenderer().IsFrameInterpolationEnabled())
+    {
+        data.InterpolatedSRV = App::GetRenderer().GetGpuDescriptorHeap().Allocate(1);
+
+        const Texture& interpolated = data.FrameInterpolationPass.GetOutput(
+            FrameInterpolation::SHADER_OUT_RES::INTERPOLATED);
+        Direct3DUtil::CreateTexture2DSRV(interpolated, data.InterpolatedSRV.CPUHandle(0));
     }
 }
 
 void PostProcessor::UpdatePasses(const RenderSettings& settings, PostProcessData& data)
 {
-    if (settings.AntiAliasing != AA::FSR2 && data.Fsr2Pass.IsInitialized())
-        data.Fsr2Pass.Reset();
+    if (settings.AntiAliasing != AA::UPSCALER && data.UpscalerPass.IsInitialized())
+        data.UpscalerPass.Reset();
 
     if (settings.AntiAliasing != AA::TAA && data.TaaPass.IsInitialized())
         data.TaaPass.Reset();
 
     if (settings.AntiAliasing == AA::TAA && !data.TaaPass.IsInitialized())
         data.TaaPass.Init();
-    else if (settings.AntiAliasing == AA::FSR2 && !data.Fsr2Pass.IsInitialized())
+    else if (settings.AntiAliasing == AA::UPSCALER && !data.UpscalerPass.IsInitialized())
     {
-        data.Fsr2Pass.Activate();
+        data.UpscalerPass.Activate();
 
-        data.TaaOrFsr2OutSRV = App::GetRenderer().GetGpuDescriptorHeap().Allocate(1);
+        data.TaaOrUpscalerOutSRV = App::GetRenderer().GetGpuDescriptorHeap().Allocate(1);
 
-        const Texture& upscaled = data.Fsr2Pass.GetOutput(FSR2Pass::SHADER_OUT_RES::UPSCALED);
-        Direct3DUtil::CreateTexture2DSRV(upscaled, data.TaaOrFsr2OutSRV.CPUHandle(0));
+        const Texture& upscaled = data.UpscalerPass.GetOutput(Upscaler::SHADER_OUT_RES::UPSCALED);
+        Direct3DUtil::CreateTexture2DSRV(upscaled, data.TaaOrUpscalerOutSRV.CPUHandle(0));
     }
+
+    const bool interpolate = App::GetRenderer().IsFrameInterpolationEnabled();
+
+    if (!interpolate && data.FrameInterpolationPass.IsInitialized())
+        data.FrameInterpolationPass.Reset();
+    else if (interpolate && !data.FrameInterpolationPass.IsInitialized())
+        data.FrameInterpolationPass.Init();
 }
 
 void PostProcessor::OnWindowSizeChanged(const RenderSettings& settings, PostProcessData& data,
@@ -83,8 +124,11 @@ void PostProcessor::OnWindowSizeChanged(const RenderSettings& settings, PostProc
 
     if (settings.AntiAliasing == AA::TAA)
         data.TaaPass.OnWindowResized();
-    else if (settings.AntiAliasing == AA::FSR2)
-        data.Fsr2Pass.OnWindowResized();
+    else if (settings.AntiAliasing == AA::UPSCALER)
+        data.UpscalerPass.OnWindowResized();
+
+    if (data.FrameInterpolationPass.IsInitialized())
+        data.FrameInterpolationPass.OnWindowResized();
 
     UpdateWndDependentDescriptors(settings, data);
 }
@@ -116,9 +160,11 @@ void PostProcessor::Update(const RenderSettings& settings, PostProcessData& data
         }
 
         // Indirect lighting
+        const auto indirectSrv = settings.DenoiseIndirect ?
+            PathTracerData::DESC_TABLE_WND_SIZE_CONST::DENOISED_INDIRECT :
+            PathTracerData::DESC_TABLE_WND_SIZE_CONST::INDIRECT;
         data.CompositingPass.SetGpuDescriptor(Compositing::SHADER_IN_GPU_DESC::INDIRECT,
-            rtData.WndConstDescTable.GPUDescriptorHeapIndex(
-                (int)PathTracerData::DESC_TABLE_WND_SIZE_CONST::INDIRECT));
+            rtData.WndConstDescTable.GPUDescriptorHeapIndex((int)indirectSrv));
 
         if (settings.Inscattering)
         {
@@ -152,40 +198,52 @@ void PostProcessor::Update(const RenderSettings& settings, PostProcessData& data
     data.AutoExposurePass.SetDescriptor(AutoExposure::SHADER_IN_DESC::COMPOSITED,
         data.WindowSizeConstSRVs.GPUDescriptorHeapIndex((int)compositedSrv));
 
+    // Input to Display
+    uint32_t displayInputSrv = data.WindowSizeConstSRVs.GPUDescriptorHeapIndex((int)compositedSrv);
+
     // TAA
     if (settings.AntiAliasing == AA::TAA)
     {
         data.TaaPass.SetDescriptor(TAA::SHADER_IN_DESC::SIGNAL,
             data.WindowSizeConstSRVs.GPUDescriptorHeapIndex((int)compositedSrv));
 
-        // Display
-        data.DisplayPass.SetGpuDescriptor(DisplayPass::SHADER_IN_GPU_DESC::COMPOSITED, 
-            data.TaaOrFsr2OutSRV.GPUDescriptorHeapIndex(0));
+        displayInputSrv = data.TaaOrUpscalerOutSRV.GPUDescriptorHeapIndex(0);
     }
-    // FSR2
-    else if (settings.AntiAliasing == AA::FSR2)
+    // Upscaler
+    else if (settings.AntiAliasing == AA::UPSCALER)
     {
         Texture& composited = const_cast<Texture&>(data.CompositingPass.GetOutput(
             Compositing::SHADER_OUT_RES::COMPOSITED));
 
-        data.Fsr2Pass.SetInput(FSR2Pass::SHADER_IN_RES::DEPTH, 
+        data.UpscalerPass.SetInput(Upscaler::SHADER_IN_RES::DEPTH, 
             const_cast<Texture&>(gbuffData.Depth[outIdx]).Resource());
-        data.Fsr2Pass.SetInput(FSR2Pass::SHADER_IN_RES::MOTION_VECTOR, 
+        data.UpscalerPass.SetInput(Upscaler::SHADER_IN_RES::MOTION_VECTOR, 
             const_cast<Texture&>(gbuffData.MotionVec).Resource());
-        data.Fsr2Pass.SetInput(FSR2Pass::SHADER_IN_RES::COLOR, composited.Resource());
-        data.Fsr2Pass.SetInput(FSR2Pass::SHADER_IN_RES::EXPOSURE, 
+        data.UpscalerPass.SetInput(Upscaler::SHADER_IN_RES::COLOR, composited.Resource());
+        data.UpscalerPass.SetInput(Upscaler::SHADER_IN_RES::EXPOSURE, 
             const_cast<Texture&>(exposureTex).Resource());
 
-        // Display
-        data.DisplayPass.SetGpuDescriptor(DisplayPass::SHADER_IN_GPU_DESC::COMPOSITED, 
-            data.TaaOrFsr2OutSRV.GPUDescriptorHeapIndex(0));
+        displayInputSrv = data.TaaOrUpscalerOutSRV.GPUDescriptorHeapIndex(0);
     }
-    else
+
+    // Display
+    data.DisplayPass.SetGpuDescriptor(DisplayPass::SHADER_IN_GPU_DESC::COMPOSITED, displayInputSrv);
+
+    // Frame interpolation
+    if (App::GetRenderer().IsFrameInterpolationEnabled())
     {
-        // Display
-        data.DisplayPass.SetGpuDescriptor(DisplayPass::SHADER_IN_GPU_DESC::COMPOSITED,
-            data.WindowSizeConstSRVs.GPUDescriptorHeapIndex((int)compositedSrv));
+        auto interpolatedRTV = App::GetRenderer().GetInterpolatedBackBufferRTV();
+
+        data.FrameInterpolationPass.SetDescriptor(FrameInterpolation::SHADER_IN_DESC::SIGNAL, 
+            displayInputSrv);
+        data.DisplayPass.SetGpuDescriptor(DisplayPass::SHADER_IN_GPU_DESC::INTERPOLATED,
+            data.InterpolatedSRV.GPUDescriptorHeapIndex(0));
+        data.DisplayPass.SetCpuDescriptor(DisplayPass::SHADER_IN_CPU_DESC::INTERPOLATED_RTV, 
+            interpolatedRTV);
+        data.GuiPass.SetCPUDescriptor(GuiPass::SHADER_IN_CPU_DESC::INTERPOLATED_RTV, interpolatedRTV);
     }
+    else
+        data.GuiPass.SetCPUDescriptor(GuiPass::SHADER_IN_CPU_DESC::INTERPOLATED_RTV, { 0 });
 }
 
 void PostProcessor::Register(const RenderSettings& settings, PostProcessData& data, 
@@ -197,6 +255,16 @@ void PostProcessor::Register(const RenderSettings& settings, PostProcessData& da
             Compositing::SHADER_OUT_RES::COMPOSITED));
         renderGraph.RegisterResource(lightAccum.Resource(), lightAccum.ID());
 
+        if (settings.HeadlessDenoise)
+        {
+            for (int i = (int)Compositing::SHADER_OUT_RES::DENOISER_ALBEDO;
+                i <= (int)Compositing::SHADER_OUT_RES::DENOISER_NORMAL; i++)
+            {
+                Texture& t = const_cast<Texture&>(data.CompositingPass.GetOutput((Compositing::SHADER_OUT_RES)i));
+                renderGraph.RegisterResource(t.Resource(), t.ID());
+            }
+        }
+
         fastdelegate::FastDelegate1<CommandList&> dlg = fastdelegate::MakeDelegate(&data.CompositingPass,
             &Compositing::Render);
         data.CompositingHandle = renderGraph.RegisterRenderPass("Compositing", 
@@ -217,15 +285,16 @@ void PostProcessor::Register(const RenderSettings& settings, PostProcessData& da
         Texture& taaB = data.TaaPass.GetOutput(TAA::SHADER_OUT_RES::OUTPUT_B);
         renderGraph.RegisterResource(taaB.Resource(), taaB.ID());
     }
-    // FSR2
-    else if (settings.AntiAliasing == AA::FSR2)
+    // Upscaler
+    else if (settings.AntiAliasing == AA::UPSCALER)
     {
-        fastdelegate::FastDelegate1<CommandList&> dlg = fastdelegate::MakeDelegate(&data.Fsr2Pass,
-            &FSR2Pass::Render);
+        fastdelegate::FastDelegate1<CommandList&> dlg = fastdelegate::MakeDelegate(&data.UpscalerPass,
+            &Upscaler::Render);
 
-        data.Fsr2Handle = renderGraph.RegisterRenderPass("FSR2", RENDER_NODE_TYPE::COMPUTE, dlg);
+        data.UpscalerHandle = renderGraph.RegisterRenderPass(data.UpscalerPass.GetBackendName(), 
+            RENDER_NODE_TYPE::COMPUTE, dlg);
 
-        const Texture& upscaled = data.Fsr2Pass.GetOutput(FSR2Pass::SHADER_OUT_RES::UPSCALED);
+        const Texture& upscaled = data.UpscalerPass.GetOutput(Upscaler::SHADER_OUT_RES::UPSCALED);
         renderGraph.RegisterResource(const_cast<Texture&>(upscaled).Resource(), upscaled.ID());
     }
 
@@ -248,18 +317,43 @@ void PostProcessor::Register(const RenderSettings& settings, PostProcessData& da
             &DisplayPass::Render);
         data.DisplayHandle = renderGraph.RegisterRenderPass("DisplayPass", RENDER_NODE_TYPE::RENDER, dlg);
 
-        // When there's a pending pick in this frame, DisplayPass::Render() will call the delegate
-        // below to clear it later in the same frame
+        // G-Buffer pass reads back the picked index and clears the pick in the same frame -- 
+        // result is passed to the delegate below once the GPU is done
         if (gbufferData.GBufferPass.HasPendingPick())
         {
-            auto pickDlg = fastdelegate::MakeDelegate(&gbufferData.GBufferPass, &GBufferRT::ClearPick);
-            auto& readback = gbufferData.GBufferPass.GetPickReadbackBuffer();
+            auto pickDlg = fastdelegate::MakeDelegate(&data.DisplayPass, &DisplayPass::OnPickReadback);
+            gbufferData.GBufferPass.SetPickCallback(pickDlg);
+        }
+    }
+
+    // Frame interpolation
+    if (App::GetRenderer().IsFrameInterpolationEnabled())
+    {
+        fastdelegate::FastDelegate1<CommandList&> dlg = fastdelegate::MakeDelegate(
+            &data.FrameInterpolationPass, &FrameInterpolation::Render);
+        data.FrameInterpolationHandle = renderGraph.RegisterRenderPass("FrameInterpolation", 
+            RENDER_NODE_TYPE::ASYNC_COMPUTE, dlg);
 
-            data.DisplayPass.SetPickData(gbufferData.GBufferPassHandle, &readback, pickDlg);
+        for (int i = 0; i < (int)FrameInterpolation::SHADER_OUT_RES::COUNT; i++)
+        {
+            Texture& t = data.FrameInterpolationPass.GetOutput((FrameInterpolation::SHADER_OUT_RES)i);
+            renderGraph.RegisterResource(t.Resource(), t.ID());
         }
+
+        fastdelegate::FastDelegate1<CommandList&> displayDlg = fastdelegate::MakeDelegate(
+            &data.DisplayPass, &DisplayPass::RenderInterpolated);
+        data.DisplayInterpolatedHandle = renderGraph.RegisterRenderPass("DisplayInterpolated", 
+            RENDER_NODE_TYPE::RENDER, displayDlg);
+
+        const Texture& interpBackbuff = App::GetRenderer().GetInterpolatedBackBuffer();
+        renderGraph.RegisterResource(const_cast<Texture&>(interpBackbuff).Resource(), 
+            interpBackbuff.ID());
+
+        renderGraph.RegisterResource(nullptr, RenderGraph::DUMMY_RES::RES_2);
     }
 
-    // ImGui
+    // ImGui (there's no UI in headless mode)
+    if (!App::GetRenderer().IsHeadless())
     {
         fastdelegate::FastDelegate1<CommandList&> dlg = fastdelegate::MakeDelegate(&data.GuiPass, 
             &GuiPass::Render);
@@ -292,9 +386,11 @@ void PostProcessor::AddAdjacencies(const RenderSettings& settings, PostProcessDa
             gbuffData.BaseColor[outIdx].ID(),
             D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
+#if PACKED_GBUFFER == 0
         renderGraph.AddInput(data.CompositingHandle,
             gbuffData.Normal[outIdx].ID(),
             D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+#endif
 
         renderGraph.AddInput(data.CompositingHandle,
             gbuffData.Depth[outIdx].ID(),
@@ -304,6 +400,7 @@ void PostProcessor::AddAdjacencies(const RenderSettings& settings, PostProcessDa
             gbuffData.MetallicRoughness[outIdx].ID(),
             D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
+#if PACKED_GBUFFER == 0
         renderGraph.AddInput(data.CompositingHandle,
             gbuffData.IORBuffer[outIdx].ID(),
             D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
@@ -311,6 +408,7 @@ void PostProcessor::AddAdjacencies(const RenderSettings& settings, PostProcessDa
         renderGraph.AddInput(data.CompositingHandle,
             gbuffData.CoatBuffer[outIdx].ID(),
             D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+#endif
 
         if (tlasReady)
         {
@@ -330,8 +428,11 @@ void PostProcessor::AddAdjacencies(const RenderSettings& settings, PostProcessDa
             }
 
             // Indirect lighting
+            const uint32_t indirectID = settings.DenoiseIndirect ?
+                rtData.IndirectDenoiserPass.GetOutput(Denoiser::SHADER_OUT_RES::DENOISED).ID() :
+                rtData.IndirecLightingPass.GetOutput(IndirectLighting::SHADER_OUT_RES::FINAL).ID();
             renderGraph.AddInput(data.CompositingHandle,
-                rtData.IndirecLightingPass.GetOutput(IndirectLighting::SHADER_OUT_RES::FINAL).ID(),
+                indirectID,
                 D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
             // Inscattering
@@ -348,6 +449,24 @@ void PostProcessor::AddAdjacencies(const RenderSettings& settings, PostProcessDa
         data.CompositingPass.GetOutput(Compositing::SHADER_OUT_RES::COMPOSITED).ID(),
         D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
+    // Guide images are read back along with the composited image in Display
+    if (settings.HeadlessDenoise)
+    {
+        for (int i = (int)Compositing::SHADER_OUT_RES::DENOISER_ALBEDO;
+            i <= (int)Compositing::SHADER_OUT_RES::DENOISER_NORMAL; i++)
+        {
+            const uint32_t id = data.CompositingPass.GetOutput((Compositing::SHADER_OUT_RES)i).ID();
+
+            renderGraph.AddOutput(data.CompositingHandle,
+                id,
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+            renderGraph.AddInput(data.DisplayHandle,
+                id,
+                D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        }
+    }
+
     // TAA
     if (tlasReady)
     {
@@ -381,29 +500,29 @@ void PostProcessor::AddAdjacencies(const RenderSettings& settings, PostProcessDa
                 taaCurrOut.ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
         }
-        // FSR2
-        else if (settings.AntiAliasing == AA::FSR2)
+        // Upscaler
+        else if (settings.AntiAliasing == AA::UPSCALER)
         {
-            renderGraph.AddInput(data.Fsr2Handle,
+            renderGraph.AddInput(data.UpscalerHandle,
                 gbuffData.Depth[outIdx].ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
-            renderGraph.AddInput(data.Fsr2Handle,
+            renderGraph.AddInput(data.UpscalerHandle,
                 composited.ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
-            renderGraph.AddInput(data.Fsr2Handle,
+            renderGraph.AddInput(data.UpscalerHandle,
                 gbuffData.MotionVec.ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
-            renderGraph.AddInput(data.Fsr2Handle,
+            renderGraph.AddInput(data.UpscalerHandle,
                 exposureTex.ID(),
                 D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
-            const Texture& upscaled = data.Fsr2Pass.GetOutput(FSR2Pass::SHADER_OUT_RES::UPSCALED);
+            const Texture& upscaled = data.UpscalerPass.GetOutput(Upscaler::SHADER_OUT_RES::UPSCALED);
             Assert(upscaled.IsInitialized(), "Upscaled output hasn't been initialized.");
 
-            renderGraph.AddOutput(data.Fsr2Handle,
+            renderGraph.AddOutput(data.UpscalerHandle,
                 upscaled.ID(),
                 D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
@@ -436,17 +555,21 @@ void PostProcessor::AddAdjacencies(const RenderSettings& settings, PostProcessDa
             gbuffData.BaseColor[outIdx].ID(),
             D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
+#if PACKED_GBUFFER == 0
         renderGraph.AddInput(data.DisplayHandle,
             gbuffData.Normal[outIdx].ID(),
             D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+#endif
 
         renderGraph.AddInput(data.DisplayHandle,
             gbuffData.MetallicRoughness[outIdx].ID(),
             D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
+#if PACKED_GBUFFER == 0
         renderGraph.AddInput(data.DisplayHandle,
             gbuffData.CoatBuffer[outIdx].ID(),
             D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+#endif
 
         renderGraph.AddInput(data.DisplayHandle,
             gbuffData.EmissiveColor.ID(),
@@ -468,11 +591,87 @@ void PostProcessor::AddAdjacencies(const RenderSettings& settings, PostProcessDa
         D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
     // Due to blending, ImGui should go last
-    renderGraph.AddInput(data.GuiHandle,
-        RenderGraph::DUMMY_RES::RES_1,
-        D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    if (!App::GetRenderer().IsHeadless())
+    {
+        renderGraph.AddInput(data.GuiHandle,
+            RenderGraph::DUMMY_RES::RES_1,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-    renderGraph.AddOutput(data.GuiHandle,
-        App::GetRenderer().GetCurrentBackBuffer().ID(),
-        D3D12_RESOURCE_STATE_RENDER_TARGET);
+        renderGraph.AddOutput(data.GuiHandle,
+            App::GetRenderer().GetCurrentBackBuffer().ID(),
+            D3D12_RESOURCE_STATE_RENDER_TARGET);
+    }
+
+    // Frame interpolation
+    if (App::GetRenderer().IsFrameInterpolationEnabled())
+    {
+        // Same input as Display
+        uint64_t inputID = composited.ID();
+
+        if (settings.AntiAliasing == AA::TAA)
+        {
+            inputID = data.TaaPass.GetOutput(outIdx == 0 ? TAA::SHADER_OUT_RES::OUTPUT_B :
+                TAA::SHADER_OUT_RES::OUTPUT_A).ID();
+        }
+        else if (settings.AntiAliasing == AA::UPSCALER)
+            inputID = data.UpscalerPass.GetOutput(Upscaler::SHADER_OUT_RES::UPSCALED).ID();
+
+        const Texture& prevHistory = data.FrameInterpolationPass.GetOutput(outIdx == 0 ?
+            FrameInterpolation::SHADER_OUT_RES::HISTORY_A : FrameInterpolation::SHADER_OUT_RES::HISTORY_B);
+        const Texture& currHistory = data.FrameInterpolationPass.GetOutput(outIdx == 0 ?
+            FrameInterpolation::SHADER_OUT_RES::HISTORY_B : FrameInterpolation::SHADER_OUT_RES::HISTORY_A);
+        const Texture& interpolated = data.FrameInterpolationPass.GetOutput(
+            FrameInterpolation::SHADER_OUT_RES::INTERPOLATED);
+        const Texture& interpBackbuff = App::GetRenderer().GetInterpolatedBackBuffer();
+
+        renderGraph.AddInput(data.FrameInterpolationHandle,
+            inputID,
+            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+        renderGraph.AddInput(data.FrameInterpolationHandle,
+            gbuffData.MotionVec.ID(),
+            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+        renderGraph.AddInput(data.FrameInterpolationHandle,
+            prevHistory.ID(),
+            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+        renderGraph.AddOutput(data.FrameInterpolationHandle,
+            currHistory.ID(),
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+        renderGraph.AddOutput(data.FrameInterpolationHandle,
+            interpolated.ID(),
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+        // Display
+        renderGraph.AddInput(data.DisplayInterpolatedHandle,
+            interpolated.ID(),
+            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+        renderGraph.AddInput(data.DisplayInterpolatedHandle,
+            gbuffData.Depth[outIdx].ID(),
+            D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+
+        renderGraph.AddInput(data.DisplayInterpolatedHandle,
+            exposureTex.ID(),
+            D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+        renderGraph.AddOutput(data.DisplayInterpolatedHandle,
+            interpBackbuff.ID(),
+            D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+        // ImGui draws on the interpolated frame too
+        renderGraph.AddOutput(data.DisplayInterpolatedHandle,
+            RenderGraph::DUMMY_RES::RES_2,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+        renderGraph.AddInput(data.GuiHandle,
+            RenderGraph::DUMMY_RES::RES_2,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+        renderGraph.AddOutput(data.GuiHandle,
+            interpBackbuff.ID(),
+            D3D12_RESOURCE_STATE_RENDER_TARGET);
+    }
 }
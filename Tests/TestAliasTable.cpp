@@ -2,6 +2,7 @@
 #include <Utility/SmallVector.h>
 #include <Utility/RNG.h>
 #include <App/App.h>
+#include <App/Timer.h>
 #include <doctest/doctest.h>
 
 using namespace ZetaRay;
@@ -119,4 +120,99 @@ TEST_SUITE("AliasTable")
         INFO("Test statistic: ", chiSquared, ", critical value: ", criticalValue);
         CHECK(chiSquared <= criticalValue);
     }
-};
\ No newline at end of file
+
+    TEST_CASE("ParallelReturnedPdfMatchesOriginal")
+    {
+        int unused;
+        RNG rng(reinterpret_cast<uintptr_t>(&unused));
+        INFO("RNG seed: ", reinterpret_cast<uintptr_t>(&unused));
+
+        // Large enough to be split into multiple pieces
+        const uint32_t n = 200'000 + rng.UniformUintBounded(100'000);
+        SmallVector<float> vals;
+        vals.resize(n);
+
+        for (uint32_t i = 0; i < n; i++)
+            vals[i] = rng.Uniform() * 100.0f;
+
+        SmallVector<double> valsNormalized;
+        valsNormalized.resize(n);
+        double sum = 0.0;
+
+        for (uint32_t i = 0; i < n; i++)
+            sum += vals[i];
+
+        for (uint32_t i = 0; i < n; i++)
+            valsNormalized[i] = vals[i] / sum;
+
+        SmallVector<AliasTableEntry> table;
+        table.resize(n);
+        AliasTable_BuildParallel(vals, table);
+
+        // Probability of picking each item, summed over all the buckets
+        SmallVector<double> p;
+        p.resize(n, 0.0);
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            INFO("Invalid entry ", i);
+            REQUIRE(table[i].Alias < n);
+            REQUIRE(table[i].P_Curr >= 0.0f);
+            REQUIRE(table[i].P_Curr <= 1.0f);
+
+            p[i] += table[i].P_Curr / (double)n;
+            p[table[i].Alias] += (1.0 - table[i].P_Curr) / (double)n;
+        }
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            INFO("Density mismatch at ", i, ", got ", p[i], ", expected ", valsNormalized[i]);
+            CHECK(fabs(p[i] - valsNormalized[i]) < 1e-3 * valsNormalized[i] + 1e-9);
+        }
+    }
+
+    TEST_CASE("Throughput")
+    {
+        RNG rng(0x9e3779b9);
+        const uint32_t n = 1 << 22;
+
+        SmallVector<float> vals;
+        vals.resize(n);
+
+        // Skewed distribution, similar to emissive triangle power
+        for (uint32_t i = 0; i < n; i++)
+        {
+            const float u = rng.Uniform();
+            vals[i] = u * u * u * 1000.0f;
+        }
+
+        SmallVector<float> valsCopy = vals;
+
+        SmallVector<AliasTableEntry> table;
+        table.resize(n);
+
+        App::DeltaTimer timer;
+        timer.Start();
+        AliasTable_Build(vals, table);
+        timer.End();
+        const double serialMs = timer.DeltaMilli();
+
+        SmallVector<AliasTableEntry> tableParallel;
+        tableParallel.resize(n);
+
+        timer.Start();
+        AliasTable_BuildParallel(valsCopy, tableParallel);
+        timer.End();
+        const double parallelMs = timer.DeltaMilli();
+
+        MESSAGE("Alias table (", n, " items) -- serial: ", serialMs, " ms (", 
+            n / (serialMs * 1e3), " M/s), parallel: ", parallelMs, " ms (", 
+            n / (parallelMs * 1e3), " M/s)");
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            INFO("Original probabilities don't match for ", i);
+            CHECK(fabsf(table[i].P_Orig - tableParallel[i].P_Orig) <= 1e-5f * table[i].P_Orig);
+        }
+    }
+};
@@ -0,0 +1,45 @@
+#include <Scene/CameraPath.h>
+#include <doctest/doctest.h>
+
+using namespace ZetaRay::Scene;
+using namespace ZetaRay::Math;
+
+TEST_SUITE("CameraPath")
+{
+    TEST_CASE("Sample")
+    {
+        CameraPath path;
+        path.Add(1.0f, float3(0.0f, 0.0f, 0.0f), float3(0.0f, 0.0f, 2.0f));
+        path.Add(2.0f, float3(1.0f, 0.0f, 0.0f), float3(1.0f, 0.0f, 0.0f));
+        path.Add(3.0f, float3(2.0f, 0.0f, 0.0f), float3(1.0f, 0.0f, 0.0f));
+        path.Add(4.0f, float3(3.0f, 0.0f, 0.0f), float3(1.0f, 0.0f, 0.0f));
+
+        // Time of the first keyframe is treated as zero
+        CHECK(path.Duration() == doctest::Approx(3.0f));
+
+        float3 pos;
+        float3 dir;
+
+        // Passes through the keyframes
+        path.Sample(1.0f, pos, dir);
+        CHECK(pos.x == doctest::Approx(1.0f));
+        CHECK(dir.x == doctest::Approx(1.0f));
+
+        // Evenly spaced keyframes on a line stay on the line
+        path.Sample(1.5f, pos, dir);
+        CHECK(pos.x == doctest::Approx(1.5f));
+        CHECK(pos.y == doctest::Approx(0.0f));
+
+        // Directions are normalized
+        path.Sample(0.5f, pos, dir);
+        CHECK(dir.x == doctest::Approx(dir.z));
+        CHECK(dir.dot(dir) == doctest::Approx(1.0f));
+
+        // Clamped to the endpoints
+        path.Sample(-1.0f, pos, dir);
+        CHECK(pos.x == doctest::Approx(0.0f));
+        CHECK(dir.z == doctest::Approx(1.0f));
+        path.Sample(10.0f, pos, dir);
+        CHECK(pos.x == doctest::Approx(3.0f));
+    }
+}
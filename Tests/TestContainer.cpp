@@ -1,8 +1,11 @@
 #include <Utility/SmallVector.h>
 #include <Utility/HashTable.h>
+#include <Utility/ConcurrentHashTable.h>
+#include <Utility/SynchronizedView.h>
 #include <App/App.h>
 #include <Support/MemoryArena.h>
 #include <doctest/doctest.h>
+#include <thread>
 
 using namespace ZetaRay::Util;
 using namespace ZetaRay::Support;
@@ -10,6 +13,52 @@ using namespace ZetaRay::Math;
 using namespace ZetaRay::Support;
 using namespace ZetaRay::App;
 
+namespace
+{
+    // Not trivially copyable, but opts into relocation below. Counts moves and
+    // destructor calls, so tests can check that growth doesn't go through either.
+    struct CountedRelocatable
+    {
+        CountedRelocatable() = default;
+        explicit CountedRelocatable(int v)
+            : Ptr(new int(v))
+        {}
+        CountedRelocatable(CountedRelocatable&& other)
+            : Ptr(other.Ptr)
+        {
+            other.Ptr = nullptr;
+            NumMoves++;
+        }
+        CountedRelocatable& operator=(CountedRelocatable&& other)
+        {
+            std::swap(Ptr, other.Ptr);
+            NumMoves++;
+            return *this;
+        }
+        ~CountedRelocatable()
+        {
+            delete Ptr;
+            NumDestructs++;
+        }
+
+        static void ResetCounters()
+        {
+            NumMoves = 0;
+            NumDestructs = 0;
+        }
+
+        int* Ptr = nullptr;
+        inline static int NumMoves = 0;
+        inline static int NumDestructs = 0;
+    };
+}
+
+namespace ZetaRay::Util
+{
+    template<>
+    inline constexpr bool is_trivially_relocatable_v<CountedRelocatable> = true;
+}
+
 TEST_SUITE("SmallVector")
 {
     TEST_CASE("Basic")
@@ -50,6 +99,121 @@ TEST_SUITE("SmallVector")
         CHECK(vec3.capacity() == 20);
     }
 
+    TEST_CASE("Relocation")
+    {
+        // Owns heap memory, so it isn't trivially copyable, but it can be memcpy'd
+        struct Relocatable
+        {
+            Relocatable() = default;
+            explicit Relocatable(int v)
+                : Ptr(new int(v))
+            {}
+            Relocatable(Relocatable&& other)
+                : Ptr(other.Ptr)
+            {
+                other.Ptr = nullptr;
+            }
+            Relocatable& operator=(Relocatable&& other)
+            {
+                std::swap(Ptr, other.Ptr);
+                return *this;
+            }
+            ~Relocatable()
+            {
+                delete Ptr;
+            }
+
+            int* Ptr = nullptr;
+        };
+
+        static_assert(!is_trivially_relocatable_v<Relocatable>);
+
+        SmallVector<Relocatable> vec1;
+        for (int i = 0; i < 100; i++)
+            vec1.emplace_back(i);
+
+        for (int i = 0; i < 100; i++)
+            CHECK(*vec1[i].Ptr == i);
+
+        static_assert(!std::is_trivially_copyable_v<CountedRelocatable>);
+        static_assert(is_trivially_relocatable_v<CountedRelocatable>);
+
+        // Growth through the allocator's reallocation
+        {
+            CountedRelocatable::ResetCounters();
+            SmallVector<CountedRelocatable> vec;
+            for (int i = 0; i < 100; i++)
+                vec.emplace_back(i);
+
+            CHECK(CountedRelocatable::NumMoves == 0);
+            CHECK(CountedRelocatable::NumDestructs == 0);
+
+            bool valid = true;
+            for (int i = 0; i < 100; i++)
+                valid = valid && (*vec[i].Ptr == i);
+
+            CHECK(valid);
+        }
+
+        // Each element is destroyed exactly once, by the vector itself
+        CHECK(CountedRelocatable::NumDestructs == 100);
+        CHECK(CountedRelocatable::NumMoves == 0);
+
+        // Growth through memcpy -- from inline storage and with an allocator that can't 
+        // reallocate
+        {
+            MemoryArena ma(1024);
+            ArenaAllocator aa(ma);
+
+            CountedRelocatable::ResetCounters();
+            SmallVector<CountedRelocatable, ArenaAllocator, 4> vec(aa);
+            for (int i = 0; i < 50; i++)
+                vec.emplace_back(i);
+
+            CHECK(!vec.has_inline_storage());
+            CHECK(CountedRelocatable::NumMoves == 0);
+            CHECK(CountedRelocatable::NumDestructs == 0);
+
+            bool valid = true;
+            for (int i = 0; i < 50; i++)
+                valid = valid && (*vec[i].Ptr == i);
+
+            CHECK(valid);
+        }
+
+        CHECK(CountedRelocatable::NumDestructs == 50);
+        CHECK(CountedRelocatable::NumMoves == 0);
+
+        // Heap growth goes through the allocator's reallocation
+        SmallVector<uint64_t> vec2;
+        for (uint64_t i = 0; i < 1000; i++)
+            vec2.push_back(i);
+
+        bool valid = true;
+        for (uint64_t i = 0; i < 1000; i++)
+            valid = valid && (vec2[i] == i);
+
+        CHECK(valid);
+
+        const uint64_t vals[] = { 1000, 1001, 1002 };
+        vec2.append_range(vals, vals + 3);
+        CHECK(vec2.size() == 1003);
+        CHECK(vec2.back() == 1002);
+
+        SmallVector<uint64_t, SystemAllocator, 4> vec3;
+        vec3.push_back(1);
+        vec3.push_back(2);
+        vec3.resize_uninitialized(50);
+        CHECK(vec3.size() == 50);
+        CHECK(!vec3.has_inline_storage());
+        CHECK(vec3[0] == 1);
+        CHECK(vec3[1] == 2);
+
+        vec3.resize_uninitialized(10);
+        CHECK(vec3.size() == 10);
+        CHECK(vec3.capacity() == 50);
+    }
+
     TEST_CASE("Move constructor-HeapHeap")
     {
         MemoryArena ma(8);
@@ -396,4 +560,224 @@ TEST_SUITE("HashTable")
 
         CHECK(i == 2);
     }
-};
\ No newline at end of file
+
+    TEST_CASE("Probing")
+    {
+        HashTable<uint64_t> table;
+        constexpr uint64_t N = 5000;
+
+        // Keys that share the low bits end up in the same group and overflow into 
+        // the following groups
+        for (uint64_t i = 0; i < N; i++)
+            table[i << 16] = i;
+
+        CHECK(table.size() == N);
+
+        for (uint64_t i = 0; i < N; i++)
+        {
+            auto entry = table.find(i << 16);
+            CHECK(entry);
+            CHECK(*entry.value() == i);
+        }
+
+        CHECK(!table.find(1));
+        CHECK(!table.find(N << 16));
+
+        for (uint64_t i = 0; i < N; i += 2)
+            CHECK(table.erase(i << 16) == 1);
+
+        CHECK(table.size() == N / 2);
+
+        for (uint64_t i = 0; i < N; i++)
+            CHECK((bool)table.find(i << 16) == (bool)(i & 0x1));
+
+        size_t numIterated = 0;
+        for (auto it = table.begin_it(); it < table.end_it(); it = table.next_it(it))
+        {
+            CHECK((it->Val & 0x1) == 1);
+            numIterated++;
+        }
+
+        CHECK(numIterated == N / 2);
+    }
+};
+
+TEST_SUITE("ConcurrentHashTable")
+{
+    struct Pair
+    {
+        uint32_t A;
+        uint32_t B;
+    };
+
+    TEST_CASE("Basic")
+    {
+        ConcurrentHashTable<Pair> table;
+        CHECK(table.empty());
+        CHECK(!table.find(1));
+
+        table.begin_write();
+        for (uint64_t i = 0; i < 100; i++)
+            table.insert_or_assign(i, Pair{ .A = (uint32_t)i, .B = (uint32_t)i * 2 });
+        table.end_write();
+
+        CHECK(table.size() == 100);
+
+        for (uint64_t i = 0; i < 100; i++)
+        {
+            auto p = table.find(i);
+            CHECK(p);
+            CHECK(p.value().A == i);
+            CHECK(p.value().B == i * 2);
+        }
+
+        table.begin_write();
+        CHECK(table.update(5, [](Pair& p) { p.A = 500; }));
+        CHECK(!table.update(1000, [](Pair& p) { p.A = 0; }));
+        table.insert_or_assign(6, Pair{ .A = 600, .B = 0 });
+        table.end_write();
+
+        CHECK(table.size() == 100);
+        CHECK(table.find(5).value().A == 500);
+        CHECK(table.find(5).value().B == 10);
+        CHECK(table.find(6).value().A == 600);
+    }
+
+    TEST_CASE("ConcurrentReaders")
+    {
+        ConcurrentHashTable<Pair> table;
+        constexpr uint32_t N = 20000;
+        std::atomic_bool done = false;
+        std::atomic_bool valid = true;
+
+        table.begin_write();
+        table.insert_or_assign(0, Pair{ .A = 0, .B = 0 });
+        table.end_write();
+
+        // Readers should never observe a torn value (A != B) or lose an existing key
+        // while the writer keeps inserting and growing the table
+        auto reader = [&]()
+            {
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    auto p = table.find(0);
+                    if (!p || p.value().A != p.value().B)
+                        valid.store(false, std::memory_order_relaxed);
+                }
+            };
+
+        std::thread r1(reader);
+        std::thread r2(reader);
+
+        for (uint32_t i = 1; i < N; i++)
+        {
+            table.begin_write();
+            table.insert_or_assign(i, Pair{ .A = i, .B = i });
+            table.update(0, [i](Pair& p) { p.A = i; p.B = i; });
+            table.end_write();
+        }
+
+        done.store(true, std::memory_order_relaxed);
+        r1.join();
+        r2.join();
+
+        CHECK(valid.load());
+        CHECK(table.size() == N);
+    }
+}
+
+TEST_SUITE("SnapshotBuffer")
+{
+    TEST_CASE("Basic")
+    {
+        SnapshotBuffer<SmallVector<uint32_t>> buffer;
+        CHECK(buffer.Read().View().empty());
+
+        buffer.Update([](SmallVector<uint32_t>& v) { v.push_back(1); });
+
+        {
+            auto view = buffer.Read();
+            CHECK(view.View().size() == 1);
+
+            // Pinned snapshot doesn't change
+            buffer.Update([](SmallVector<uint32_t>& v) { v.push_back(2); });
+            CHECK(view.View().size() == 1);
+            CHECK(buffer.Read().View().size() == 2);
+        }
+
+        buffer.Update([](SmallVector<uint32_t>& v) { v.clear(); });
+        CHECK(buffer.Read().View().empty());
+    }
+
+    TEST_CASE("ConcurrentReaders")
+    {
+        SnapshotBuffer<SmallVector<uint32_t>> buffer;
+        constexpr uint32_t N = 2000;
+        std::atomic_bool done = false;
+        std::atomic_bool valid = true;
+
+        // Every published snapshot is [0, 1, ..., n - 1], readers should never observe
+        // a partially updated one
+        auto reader = [&]()
+            {
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    {
+                        auto view = buffer.Read();
+                        auto& v = view.View();
+
+                        for (uint32_t i = 0; i < v.size(); i++)
+                        {
+                            if (v[i] != i)
+                                valid.store(false, std::memory_order_relaxed);
+                        }
+                    }
+
+                    // Like the real readers, don't hold a view all the time
+                    std::this_thread::yield();
+                }
+            };
+
+        std::thread r1(reader);
+        std::thread r2(reader);
+
+        for (uint32_t i = 0; i < N; i++)
+            buffer.Update([i](SmallVector<uint32_t>& v) { v.push_back(i); });
+
+        done.store(true, std::memory_order_relaxed);
+        r1.join();
+        r2.join();
+
+        CHECK(valid.load());
+        CHECK(buffer.Read().View().size() == N);
+    }
+}
+
+TEST_SUITE("MemoryArena")
+{
+    TEST_CASE("Virtual")
+    {
+        MemoryArena ma(VirtualArenaDesc{ .ReserveSize = 1024 * 1024, .CommitGranularity = 64 * 1024 });
+        CHECK(ma.IsVirtual());
+        CHECK(ma.TotalSize() == 0);
+
+        auto* a = reinterpret_cast<uint8_t*>(ma.AllocateAligned(100));
+        auto* b = reinterpret_cast<uint8_t*>(ma.AllocateAligned(100 * 1024, 256));
+        CHECK((reinterpret_cast<uintptr_t>(b) & 255) == 0);
+        CHECK(b > a);
+        memset(b, 0xff, 100 * 1024);
+        CHECK(ma.TotalSize() == 128 * 1024);
+
+        // Exceeds the reserved range, served from a heap block
+        void* c = ma.AllocateAligned(2 * 1024 * 1024);
+        CHECK(c);
+
+        ma.Reset();
+        // First granule stays committed
+        CHECK(ma.AllocateAligned(100) == a);
+
+        MemoryArena moved(ZetaMove(ma));
+        CHECK(moved.IsVirtual());
+        CHECK(!ma.IsVirtual());
+    }
+}
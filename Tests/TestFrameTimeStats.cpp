@@ -0,0 +1,69 @@
+#include <Support/FrameTimeStats.h>
+#include <doctest/doctest.h>
+
+using namespace ZetaRay::Support;
+
+TEST_SUITE("FrameTimeStats")
+{
+    TEST_CASE("Percentiles")
+    {
+        FrameTimeStats stats;
+        CHECK(stats.Compute().P50 == 0.0f);
+
+        // 1, 2, ..., 100 in shuffled order
+        for (int i = 0; i < 100; i++)
+            stats.Add((float)((i * 37) % 100 + 1));
+
+        FrameTimeStats::Summary s = stats.Compute();
+        CHECK(s.P50 == 50.0f);
+        CHECK(s.P95 == 95.0f);
+        CHECK(s.P99 == 99.0f);
+        CHECK(s.Max == 100.0f);
+        CHECK(stats.Percentile(0.95f) == 95.0f);
+    }
+
+    TEST_CASE("Rolling window")
+    {
+        FrameTimeStats stats;
+
+        for (int i = 0; i < FrameTimeStats::WINDOW_SIZE; i++)
+            stats.Add(100.0f);
+
+        // Old frames are overwritten
+        for (int i = 0; i < FrameTimeStats::WINDOW_SIZE; i++)
+            stats.Add(10.0f);
+
+        CHECK(stats.NumFrames() == FrameTimeStats::WINDOW_SIZE);
+        CHECK(stats.NumAdded() == 2 * FrameTimeStats::WINDOW_SIZE);
+        CHECK(stats.Compute().Max == 10.0f);
+    }
+
+    TEST_CASE("Hitch")
+    {
+        FrameTimeStats stats;
+
+        for (int i = 0; i < FrameTimeStats::MIN_FRAMES_FOR_HITCH - 1; i++)
+            stats.Add(16.0f);
+
+        // Not enough frames yet
+        CHECK(!stats.IsHitch(100.0f, 0.0f, 2.0f));
+
+        stats.Add(16.0f);
+        CHECK(stats.IsHitch(100.0f, 0.0f, 2.0f));
+        CHECK(!stats.IsHitch(30.0f, 0.0f, 2.0f));
+        CHECK(!stats.IsHitch(100.0f, 200.0f, 2.0f));
+    }
+
+    TEST_CASE("Bound")
+    {
+        FrameTimeStats stats;
+        stats.Add(16.0f, 10.0f, 15.0f);
+        stats.Add(16.0f, 15.0f, 10.0f);
+        stats.Add(16.0f, 15.0f, 14.0f);
+        stats.Add(16.0f, 10.0f, 12.0f);
+        // Unknown, not counted
+        stats.Add(16.0f);
+
+        CHECK(stats.Compute().GpuBoundFraction == doctest::Approx(0.5f));
+    }
+}
@@ -0,0 +1,84 @@
+#include <Support/InputRecording.h>
+#include <doctest/doctest.h>
+
+using namespace ZetaRay::Support;
+using namespace ZetaRay::Math;
+using namespace ZetaRay::Util;
+
+TEST_SUITE("InputRecording")
+{
+    TEST_CASE("RoundTrip")
+    {
+        ParamVariant p;
+        p.InitFloat("Group", "Subgroup", "Name", {}, 0.5f, 0.0f, 1.0f, 0.1f);
+
+        InputRecording rec;
+        rec.Begin(100, float3(1.0f, 2.0f, 3.0f), float3(0.0f, 0.0f, 1.0f));
+        rec.AddInitialParam(p);
+        rec.AddFrame(1.0f / 60, float3(0.0f, 0.0f, 1.0f), 4, -2);
+        rec.AddFrame(1.0f / 30, float3(0.0f), 0, 0);
+        rec.AddParamChange(p);
+        rec.AddPick(InputRecording::PICK_TYPE::PICK, 10, 20);
+        rec.AddPick(InputRecording::PICK_TYPE::CLEAR, 0, 0);
+        rec.AddFrame(1.0f / 60, float3(0.0f), 1, 1);
+
+        SmallVector<uint8_t> data;
+        rec.Serialize(data);
+
+        InputRecording loaded;
+        REQUIRE(loaded.Deserialize(data));
+        CHECK(loaded.FirstFrameNum() == 100);
+        CHECK(loaded.NumFrames() == 3);
+        CHECK(loaded.CameraPos().y == 2.0f);
+        REQUIRE(loaded.InitialParams().size() == 1);
+        CHECK(loaded.InitialParams()[0].ID == p.ID());
+        CHECK(loaded.InitialParams()[0].Float[0] == 0.5f);
+
+        InputRecording::Frame frame;
+        Span<InputRecording::ParamChange> changes(nullptr, 0);
+        Span<InputRecording::Pick> picks(nullptr, 0);
+
+        REQUIRE(loaded.NextFrame(frame, changes, picks));
+        CHECK(frame.dMouseX == 4);
+        CHECK(frame.dMouseY == -2);
+        CHECK(frame.Acceleration.z == 1.0f);
+        CHECK(changes.empty());
+        CHECK(picks.empty());
+
+        // Changes and picks belong to the frame that was added before them
+        REQUIRE(loaded.NextFrame(frame, changes, picks));
+        CHECK(frame.Timestep == 1.0f / 30);
+        REQUIRE(changes.size() == 1);
+        CHECK(changes[0].Type == PARAM_TYPE::PT_float);
+        REQUIRE(picks.size() == 2);
+        CHECK(picks[0].X == 10);
+        CHECK(picks[0].Y == 20);
+        CHECK(picks[1].Type == InputRecording::PICK_TYPE::CLEAR);
+
+        REQUIRE(loaded.NextFrame(frame, changes, picks));
+        CHECK(changes.empty());
+        CHECK(!loaded.NextFrame(frame, changes, picks));
+
+        // Unchanged values leave the parameter alone
+        CHECK(!InputRecording::ApplyParam(loaded.InitialParams()[0], p));
+    }
+
+    TEST_CASE("Invalid")
+    {
+        InputRecording rec;
+        rec.Begin(1, float3(0.0f), float3(0.0f, 0.0f, 1.0f));
+        rec.AddFrame(1.0f / 60, float3(0.0f), 0, 0);
+        rec.AddPick(InputRecording::PICK_TYPE::PICK, 1, 1);
+
+        SmallVector<uint8_t> data;
+        rec.Serialize(data);
+
+        InputRecording loaded;
+        SmallVector<uint8_t> truncated;
+        truncated.append_range(data.data(), data.data() + data.size() - 1);
+        CHECK(!loaded.Deserialize(truncated));
+
+        data[0] ^= 0xff;
+        CHECK(!loaded.Deserialize(data));
+    }
+}
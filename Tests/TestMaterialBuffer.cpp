@@ -0,0 +1,67 @@
+#include <Scene/Asset.h>
+#include <doctest/doctest.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Scene::Internal;
+
+TEST_SUITE("MaterialBuffer")
+{
+    TEST_CASE("SlotReuseAfterFence")
+    {
+        MaterialBuffer buffer;
+        Material mat;
+
+        buffer.Add(10, mat);
+        buffer.Add(11, mat);
+
+        uint32_t idx10;
+        uint32_t idx11;
+        REQUIRE(buffer.Get(10, &idx10));
+        REQUIRE(buffer.Get(11, &idx11));
+        CHECK(idx10 == 0);
+        CHECK(idx11 == 1);
+
+        buffer.Remove(10, 5);
+        CHECK(!buffer.Get(10));
+        CHECK(buffer.NumMaterials() == 1);
+
+        // GPU might still be reading the slot
+        buffer.Add(12, mat);
+        uint32_t idx12;
+        REQUIRE(buffer.Get(12, &idx12));
+        CHECK(idx12 == 2);
+
+        buffer.Recycle(4);
+        buffer.Add(13, mat);
+        uint32_t idx13;
+        REQUIRE(buffer.Get(13, &idx13));
+        CHECK(idx13 == 3);
+
+        // Fence has been passed, freed slot is reused first-fit
+        buffer.Recycle(5);
+        buffer.Add(14, mat);
+        uint32_t idx14;
+        REQUIRE(buffer.Get(14, &idx14));
+        CHECK(idx14 == idx10);
+    }
+
+    TEST_CASE("IDReuseBeforeFence")
+    {
+        MaterialBuffer buffer;
+        Material mat;
+
+        buffer.Add(7, mat);
+        buffer.Remove(7, 3);
+
+        // Same ID can be added again right away, but gets a different slot
+        buffer.Add(7, mat);
+        uint32_t idx;
+        REQUIRE(buffer.Get(7, &idx));
+        CHECK(idx == 1);
+
+        buffer.Recycle(3);
+        buffer.Add(8, mat);
+        REQUIRE(buffer.Get(8, &idx));
+        CHECK(idx == 0);
+    }
+}
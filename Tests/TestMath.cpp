@@ -1,6 +1,8 @@
 #include <Math/CollisionFuncs.h>
 #include <Math/Quaternion.h>
 #include <Math/MatrixFuncs.h>
+#include <Math/BatchFuncs.h>
+#include <Math/Color.h>
 #include <Utility/RNG.h>
 #include <Math/Sampling.h>
 #include <doctest/doctest.h>
@@ -506,4 +508,307 @@ TEST_CASE("Octahedral Encoding")
 
         CHECK(mse <= 1e-6f);
     }
-}
\ No newline at end of file
+}
+
+namespace
+{
+    float4x3 RandomSRT(RNG& rng)
+    {
+        float4 q(rng.Uniform() - 0.5f, rng.Uniform() - 0.5f, rng.Uniform() - 0.5f, rng.Uniform() - 0.5f);
+        q.normalize();
+
+        const v_float4x4 vS = scale(0.5f + rng.Uniform(), 0.5f + rng.Uniform(), 0.5f + rng.Uniform());
+        const v_float4x4 vR = rotationMatFromQuat(loadFloat4(q));
+        const v_float4x4 vT = translate(rng.Uniform() * 10.0f, rng.Uniform() * 10.0f, rng.Uniform() * 10.0f);
+
+        return float4x3(store(mul(mul(vS, vR), vT)));
+    }
+
+    bool Equal(const float3& a, const float3& b, float eps)
+    {
+        return fabsf(a.x - b.x) <= eps && fabsf(a.y - b.y) <= eps && fabsf(a.z - b.z) <= eps;
+    }
+}
+
+TEST_CASE("Batch Transforms")
+{
+    RNG rng(17);
+    INFO("Batch width: ", BatchWidth());
+
+    // Not a multiple of the vector width, so that remainder is handled by the scalar path
+    constexpr int N = 37;
+    const float4x3 M = RandomSRT(rng);
+    const v_float4x4 vM = load4x3(M);
+
+    SUBCASE("Points")
+    {
+        float3 points[N];
+        float3 out[N];
+        for (auto& p : points)
+            p = float3(rng.Uniform() * 10.0f, rng.Uniform() * 10.0f, rng.Uniform() * 10.0f);
+
+        TransformPoints(M, points, out);
+
+        for (int i = 0; i < N; i++)
+        {
+            const float3 expected = storeFloat3(mul(vM, _mm_setr_ps(points[i].x, points[i].y, points[i].z, 1.0f)));
+            CHECK(Equal(out[i], expected, 1e-4f));
+        }
+    }
+
+    SUBCASE("AABBs")
+    {
+        AABB boxes[N];
+        AABB out[N];
+        for (auto& b : boxes)
+        {
+            b = AABB(float3(rng.Uniform() * 10.0f, rng.Uniform() * 10.0f, rng.Uniform() * 10.0f),
+                float3(rng.Uniform(), rng.Uniform(), rng.Uniform()));
+        }
+
+        TransformAABBs(M, boxes, out);
+
+        for (int i = 0; i < N; i++)
+        {
+            const AABB expected = store(transform(vM, v_AABB(boxes[i])));
+            CHECK(Equal(out[i].Center, expected.Center, 1e-4f));
+            CHECK(Equal(out[i].Extents, expected.Extents, 1e-4f));
+        }
+    }
+
+    SUBCASE("AABBs, one transformation each")
+    {
+        float4x3 Ms[N];
+        AABB boxes[N];
+        AABB out[N];
+        for (int i = 0; i < N; i++)
+        {
+            Ms[i] = RandomSRT(rng);
+            boxes[i] = AABB(float3(rng.Uniform() * 10.0f, rng.Uniform() * 10.0f, rng.Uniform() * 10.0f),
+                float3(rng.Uniform(), rng.Uniform(), rng.Uniform()));
+        }
+
+        transformAABBs(Ms, boxes, out);
+
+        for (int i = 0; i < N; i++)
+        {
+            const AABB expected = store(transform(load4x3(Ms[i]), v_AABB(boxes[i])));
+            CHECK(Equal(out[i].Center, expected.Center, 1e-4f));
+            CHECK(Equal(out[i].Extents, expected.Extents, 1e-4f));
+        }
+    }
+
+    SUBCASE("MulAffine")
+    {
+        float4x3 A[N];
+        float4x3 B[N];
+        float4x3 out[N];
+        for (int i = 0; i < N; i++)
+        {
+            A[i] = RandomSRT(rng);
+            B[i] = RandomSRT(rng);
+        }
+
+        MulAffine(A, B, out);
+
+        for (int i = 0; i < N; i++)
+        {
+            const float4x3 expected(store(mul(load4x3(A[i]), load4x3(B[i]))));
+
+            for (int r = 0; r < 4; r++)
+                CHECK(Equal(out[i].m[r], expected.m[r], 1e-4f));
+        }
+    }
+
+    SUBCASE("DecomposeSRT")
+    {
+        float4x3 Ms[N];
+        float3 s[N];
+        float4 r[N];
+        float3 t[N];
+        for (auto& m : Ms)
+            m = RandomSRT(rng);
+
+        DecomposeSRT(Ms, s, r, t);
+
+        for (int i = 0; i < N; i++)
+        {
+            float4a es;
+            float4a er;
+            float4a et;
+            decomposeSRT(load4x3(Ms[i]), es, er, et);
+
+            CHECK(Equal(s[i], es.xyz(), 1e-4f));
+            CHECK(Equal(t[i], et.xyz(), 1e-4f));
+            CHECK(Equal(float3(r[i].x, r[i].y, r[i].z), er.xyz(), 1e-4f));
+            CHECK(fabsf(r[i].w - er.w) <= 1e-4f);
+        }
+    }
+}
+
+TEST_CASE("AABBvsFrustum Batch")
+{
+    ViewFrustum q(DirectX::XM_PIDIV4, 1920.0f / 1080.0f, 1.0f, 1000.0f);
+    v_ViewFrustum vf(q);
+    RNG rng(23);
+
+    // Crosses a word boundary and leaves a partial group of 8 at the end
+    constexpr int N = 141;
+    AABB boxes[N];
+    for (auto& b : boxes)
+    {
+        // Frustum is looking down +z
+        b = AABB(float3(-500.0f + rng.Uniform() * 1000.0f, -500.0f + rng.Uniform() * 1000.0f,
+            -200.0f + rng.Uniform() * 1200.0f),
+            float3(0.1f + rng.Uniform() * 50.0f, 0.1f + rng.Uniform() * 50.0f, 0.1f + rng.Uniform() * 50.0f));
+    }
+
+    uint64_t visibility[(N + 63) / 64];
+    intersectFrustumVsAABBs(vf, boxes, visibility);
+
+    for (int i = 0; i < N; i++)
+    {
+        const bool expected = instersectFrustumVsAABB(vf, v_AABB(boxes[i])) != COLLISION_TYPE::DISJOINT;
+        const bool visible = (visibility[i / 64] >> (i & 63)) & 0x1;
+
+        INFO("Box: ", i);
+        CHECK(visible == expected);
+    }
+
+    // Bits past the last box are cleared
+    CHECK((visibility[N / 64] >> (N & 63)) == 0);
+}
+
+TEST_CASE("Batch Color Conversions")
+{
+    RNG rng(29);
+
+    // Not a multiple of 8, so that the partial last group is covered
+    constexpr int N = 61;
+
+    SUBCASE("sRGB")
+    {
+        float in[N];
+        float linear[N];
+        float sRGB[N];
+        for (int i = 0; i < N; i++)
+            in[i] = i == 0 ? 0.0f : (i == 1 ? 1.0f : rng.Uniform());
+
+        sRGBToLinear(in, linear);
+        LinearTosRGB(linear, sRGB);
+
+        for (int i = 0; i < N; i++)
+        {
+            const float expected = sRGBToLinear(float3(in[i])).x;
+            INFO("Input: ", in[i]);
+            CHECK(fabsf(linear[i] - expected) <= 1e-5f * Max(expected, 1.0f));
+            CHECK(fabsf(sRGB[i] - in[i]) <= 1e-5f);
+        }
+    }
+
+    SUBCASE("Half")
+    {
+        float in[N];
+        uint16_t h[N];
+        float out[N];
+        for (auto& f : in)
+            f = (rng.Uniform() - 0.5f) * 1000.0f;
+
+        FloatToHalf(in, h);
+        HalfToFloat(h, out);
+
+        for (int i = 0; i < N; i++)
+        {
+            CHECK(h[i] == Math::FloatToHalf(in[i]));
+            CHECK(out[i] == Math::HalfToFloat(h[i]));
+        }
+    }
+
+    SUBCASE("Planar Half")
+    {
+        float4 in[N];
+        float4 out[N];
+        uint16_t r[N];
+        uint16_t g[N];
+        uint16_t b[N];
+
+        for (int i = 0; i < N; i++)
+        {
+            in[i] = float4(rng.Uniform() * 10.0f, rng.Uniform(), rng.Uniform() * 100.0f, 1.0f);
+            out[i] = float4(1.0f, 2.0f, 3.0f, 4.0f);
+        }
+
+        RGBAToPlanarHalf(in, r, g, b);
+        AccumulatePlanarHalf(r, g, b, 0.5f, out);
+
+        for (int i = 0; i < N; i++)
+        {
+            CHECK(r[i] == Math::FloatToHalf(in[i].x));
+            CHECK(g[i] == Math::FloatToHalf(in[i].y));
+            CHECK(b[i] == Math::FloatToHalf(in[i].z));
+            CHECK(out[i].x == doctest::Approx(1.0f + 0.5f * Math::HalfToFloat(r[i])));
+            CHECK(out[i].y == doctest::Approx(2.0f + 0.5f * Math::HalfToFloat(g[i])));
+            CHECK(out[i].z == doctest::Approx(3.0f + 0.5f * Math::HalfToFloat(b[i])));
+            CHECK(out[i].w == 4.0f);
+        }
+    }
+
+    SUBCASE("RGBE")
+    {
+        float3 in[N];
+        uint32_t rgbe[N];
+        float3 out[N];
+        for (auto& c : in)
+            c = float3(rng.Uniform() * 100.0f, rng.Uniform() * 0.01f, rng.Uniform());
+        in[3] = float3(0.0f);
+
+        FloatToRGBE(in, rgbe);
+        RGBEToFloat(rgbe, out);
+
+        CHECK(rgbe[3] == 0);
+
+        for (int i = 0; i < N; i++)
+        {
+            // Reference encoding from Graphics Gems II
+            const float maxC = Max(Max(in[i].x, in[i].y), in[i].z);
+            uint32_t expected = 0;
+
+            if (maxC >= 1e-32f)
+            {
+                int e;
+                const float scale = frexpf(maxC, &e) * 256.0f / maxC;
+                expected = uint32_t(in[i].x * scale) | (uint32_t(in[i].y * scale) << 8) |
+                    (uint32_t(in[i].z * scale) << 16) | (uint32_t(e + 128) << 24);
+            }
+
+            CHECK(rgbe[i] == expected);
+
+            // Mantissa of largest channel has at least 7 bits
+            const float3 diff = out[i] - in[i];
+            CHECK(Max(Max(fabsf(diff.x), fabsf(diff.y)), fabsf(diff.z)) <= maxC / 128.0f);
+        }
+    }
+
+    SUBCASE("Luminance")
+    {
+        float3 in[N];
+        float4 in4[N];
+        float out[N];
+        float out4[N];
+        for (int i = 0; i < N; i++)
+        {
+            in[i] = float3(rng.Uniform(), rng.Uniform(), rng.Uniform());
+            in4[i] = float4(in[i].x, in[i].y, in[i].z, 1.0f);
+        }
+
+        Luminance(in, out);
+        Luminance(in4, out4);
+
+        for (int i = 0; i < N; i++)
+        {
+            const float expected = 0.2126f * in[i].x + 0.7152f * in[i].y + 0.0722f * in[i].z;
+            CHECK(out[i] == doctest::Approx(expected));
+            CHECK(out4[i] == doctest::Approx(expected));
+        }
+    }
+}
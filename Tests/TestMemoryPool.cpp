@@ -0,0 +1,214 @@
+#include <Support/MemoryPool.h>
+#include <Math/Common.h>
+#include <doctest/doctest.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace ZetaRay::Support;
+
+namespace
+{
+    // Allocates, touches and frees a mix of small allocations, similar to containers
+    // that grow and shrink within a task
+    template<typename Alloc, typename Free>
+    void RunWorkload(int numIters, Alloc alloc, Free free)
+    {
+        constexpr int NUM_LIVE = 64;
+        constexpr size_t SIZES[] = { 8, 24, 64, 100, 256, 1000 };
+        void* live[NUM_LIVE] = { nullptr };
+        size_t liveSize[NUM_LIVE] = { 0 };
+
+        for (int i = 0; i < numIters; i++)
+        {
+            const int slot = (i * 7) % NUM_LIVE;
+            if (live[slot])
+                free(live[slot], liveSize[slot]);
+
+            const size_t size = SIZES[i % ZetaArrayLen(SIZES)];
+            live[slot] = alloc(size);
+            liveSize[slot] = size;
+            memset(live[slot], i & 0xff, size);
+        }
+
+        for (int i = 0; i < NUM_LIVE; i++)
+        {
+            if (live[i])
+                free(live[i], liveSize[i]);
+        }
+    }
+
+    template<typename Fn>
+    double TimeThreads(int numThreads, Fn fn)
+    {
+        std::vector<std::thread> threads;
+        const auto begin = std::chrono::high_resolution_clock::now();
+
+        for (int t = 0; t < numThreads; t++)
+        {
+            threads.emplace_back([t, &fn]()
+                {
+                    g_threadIdx = t;
+                    fn();
+                    g_threadIdx = -1;
+                });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        const auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>(end - begin).count();
+    }
+}
+
+TEST_SUITE("MemoryPool")
+{
+    TEST_CASE("Basic")
+    {
+        MemoryPool mp;
+        mp.Init();
+
+        void* a = mp.AllocateAligned(8);
+        void* b = mp.AllocateAligned(8);
+        CHECK(a != b);
+
+        mp.FreeAligned(b, 8);
+        // Free list is LIFO
+        CHECK(mp.AllocateAligned(8) == b);
+
+        void* c = mp.AllocateAligned(24, 64);
+        CHECK((reinterpret_cast<uintptr_t>(c) & 63) == 0);
+        mp.FreeAligned(c, 24, 64);
+
+        mp.FreeAligned(a, 8);
+        mp.FreeAligned(b, 8);
+    }
+
+    TEST_CASE("ThreadCache")
+    {
+        MemoryPool mp;
+        mp.Init(true);
+        CHECK(mp.HasThreadLocalCache());
+
+        constexpr int NUM_THREADS = 4;
+        constexpr int NUM_ALLOCS = 1000;
+        std::vector<std::thread> threads;
+        std::atomic_bool allValid = true;
+
+        for (int t = 0; t < NUM_THREADS; t++)
+        {
+            threads.emplace_back([&mp, &allValid, t]()
+                {
+                    g_threadIdx = t;
+                    std::vector<uint32_t*> allocs;
+
+                    for (int i = 0; i < NUM_ALLOCS; i++)
+                    {
+                        auto* p = reinterpret_cast<uint32_t*>(mp.AllocateAligned(sizeof(uint32_t) * 4));
+                        p[0] = t;
+                        p[3] = i;
+                        allocs.push_back(p);
+                    }
+
+                    // Any other thread writing to the same chunk would have overwritten these
+                    bool valid = true;
+                    for (int i = 0; i < NUM_ALLOCS; i++)
+                        valid = valid && allocs[i][0] == (uint32_t)t && allocs[i][3] == (uint32_t)i;
+
+                    for (auto* p : allocs)
+                        mp.FreeAligned(p, sizeof(uint32_t) * 4);
+
+                    g_threadIdx = -1;
+                    if (!valid)
+                        allValid.store(false, std::memory_order_relaxed);
+                });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        CHECK(allValid.load());
+
+        // Threads without an index go straight to the shared pool
+        void* a = mp.AllocateAligned(16);
+        CHECK(a);
+        mp.FreeAligned(a, 16);
+
+        // Cached chunks are returned before moving
+        MemoryPool dest;
+        dest.Init(true);
+        mp.MoveTo(dest);
+    }
+
+    // Run with --no-skip to include
+    TEST_CASE("Benchmark" * doctest::skip())
+    {
+        constexpr int NUM_ITERS = 1'000'000;
+        const int numThreads = ZetaRay::Math::Min((int)std::thread::hardware_concurrency(),
+            MAX_NUM_THREADS);
+
+        // Current path -- one shared pool, which has to be externally synchronized when
+        // it's used from multiple threads
+        double sharedMs;
+        {
+            MemoryPool mp;
+            mp.Init();
+            std::mutex lock;
+
+            sharedMs = TimeThreads(numThreads, [&]()
+                {
+                    RunWorkload(NUM_ITERS,
+                        [&](size_t s) { std::lock_guard<std::mutex> g(lock); return mp.AllocateAligned(s); },
+                        [&](void* p, size_t s) { std::lock_guard<std::mutex> g(lock); mp.FreeAligned(p, s); });
+                });
+        }
+
+        double cachedMs;
+        {
+            MemoryPool mp;
+            mp.Init(true);
+
+            cachedMs = TimeThreads(numThreads, [&]()
+                {
+                    RunWorkload(NUM_ITERS,
+                        [&](size_t s) { return mp.AllocateAligned(s); },
+                        [&](void* p, size_t s) { mp.FreeAligned(p, s); });
+                });
+        }
+
+        // Single-threaded overhead of the cache
+        double singleMs;
+        {
+            MemoryPool mp;
+            mp.Init();
+
+            singleMs = TimeThreads(1, [&]()
+                {
+                    RunWorkload(NUM_ITERS,
+                        [&](size_t s) { return mp.AllocateAligned(s); },
+                        [&](void* p, size_t s) { mp.FreeAligned(p, s); });
+                });
+        }
+
+        double singleCachedMs;
+        {
+            MemoryPool mp;
+            mp.Init(true);
+
+            singleCachedMs = TimeThreads(1, [&]()
+                {
+                    RunWorkload(NUM_ITERS,
+                        [&](size_t s) { return mp.AllocateAligned(s); },
+                        [&](void* p, size_t s) { mp.FreeAligned(p, s); });
+                });
+        }
+
+        MESSAGE(numThreads, " threads, shared pool + lock: ", sharedMs, " ms, thread cache: ",
+            cachedMs, " ms");
+        MESSAGE("1 thread, no cache: ", singleMs, " ms, thread cache: ", singleCachedMs, " ms");
+    }
+}
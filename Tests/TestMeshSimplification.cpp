@@ -0,0 +1,47 @@
+#include <Model/Mesh.h>
+#include <Utility/SmallVector.h>
+#include <doctest/doctest.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Model;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+
+TEST_SUITE("MeshSimplification")
+{
+    TEST_CASE("VertexClustering")
+    {
+        SmallVector<Vertex> vertices;
+        SmallVector<uint32_t> indices;
+        PrimitiveMesh::ComputeGrid(vertices, indices, 10.0f, 10.0f, 65, 65);
+
+        const TriangleMesh mesh(vertices, 0, 0, (uint32_t)indices.size(), 0);
+        const size_t numTris = indices.size() / 3;
+
+        SmallVector<uint32_t> lod;
+        MeshSimplification::VertexClustering(vertices, indices, mesh.m_AABB, 16, lod);
+        const size_t numLodTris = lod.size() / 3;
+
+        INFO("Simplified mesh should have between zero and a quarter of the triangles.");
+        CHECK(numLodTris > 0);
+        CHECK(numLodTris <= numTris / 4);
+        CHECK(lod.size() % 3 == 0);
+
+        bool valid = true;
+        for (size_t t = 0; t < lod.size(); t += 3)
+        {
+            valid = valid && lod[t] < vertices.size() && lod[t + 1] < vertices.size() && 
+                lod[t + 2] < vertices.size();
+            valid = valid && lod[t] != lod[t + 1] && lod[t + 1] != lod[t + 2] && 
+                lod[t] != lod[t + 2];
+        }
+
+        INFO("Indices should refer to the source vertices and triangles shouldn't be degenerate.");
+        CHECK(valid);
+
+        // Finer grid than the mesh itself keeps every triangle
+        MeshSimplification::VertexClustering(vertices, indices, mesh.m_AABB, 256, lod);
+        CHECK(lod.size() == indices.size());
+    }
+}
@@ -0,0 +1,69 @@
+#include <Model/Mesh.h>
+#include <Utility/SmallVector.h>
+#include <doctest/doctest.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Model;
+using namespace ZetaRay::Util;
+using namespace ZetaRay::Math;
+
+TEST_SUITE("Meshlets")
+{
+    TEST_CASE("Build")
+    {
+        SmallVector<Vertex> vertices;
+        SmallVector<uint32_t> indices;
+        PrimitiveMesh::ComputeSphere(vertices, indices, 2.0f, 32);
+        const uint32_t numTris = (uint32_t)(indices.size() / 3);
+
+        SmallVector<RT::Meshlet> meshlets;
+        SmallVector<uint32_t> data;
+        Meshlets::Build(vertices, indices, meshlets, data);
+        REQUIRE(meshlets.size() > 1);
+
+        bool withinLimits = true;
+        bool contiguous = true;
+        bool matches = true;
+        uint32_t nextTri = 0;
+
+        for (auto& m : meshlets)
+        {
+            withinLimits = withinLimits && m.NumVerts <= MESHLET_MAX_VERTICES && 
+                m.NumTris > 0 && m.NumTris <= MESHLET_MAX_TRIANGLES;
+            contiguous = contiguous && m.FirstTri == nextTri;
+            nextTri += m.NumTris;
+
+            for (uint32_t t = 0; t < m.NumTris; t++)
+            {
+                const uint32_t packed = data[m.DataOffset + m.NumVerts + t];
+
+                for (int j = 0; j < 3; j++)
+                {
+                    const uint32_t local = (packed >> (j * 8)) & 0xff;
+                    matches = matches && local < m.NumVerts && 
+                        data[m.DataOffset + local] == indices[(m.FirstTri + t) * 3 + j];
+                }
+            }
+        }
+
+        INFO("Meshlets should cover the triangles in order and decode to the source indices.");
+        CHECK(withinLimits);
+        CHECK(contiguous);
+        CHECK(nextTri == numTris);
+        CHECK(matches);
+
+        bool bounded = true;
+        for (auto& m : meshlets)
+        {
+            for (uint32_t i = 0; i < m.NumVerts; i++)
+            {
+                const float3 d = vertices[data[m.DataOffset + i]].Position - m.Center;
+                bounded = bounded && d.length() <= m.Radius + 1e-5f;
+            }
+        }
+
+        INFO("Bounding spheres should contain the meshlet vertices.");
+        CHECK(bounded);
+    }
+}
@@ -0,0 +1,71 @@
+#include <Core/ShaderArchive.h>
+#include <doctest/doctest.h>
+
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Util;
+
+TEST_SUITE("ShaderArchive")
+{
+    TEST_CASE("BuildAndFind")
+    {
+        const uint8_t cs[] = { 1, 2, 3, 4, 5 };
+        const uint8_t ps[] = { 6, 7, 8 };
+        const uint8_t vs[37] = { 9 };
+
+        const ShaderArchive::Shader shaders[] = {
+            { .Name = "Compositing_cs.cso", .Bytecode = Span<const uint8_t>(cs, sizeof(cs)) },
+            { .Name = "GUI_ps.cso", .Bytecode = Span<const uint8_t>(ps, sizeof(ps)) },
+            { .Name = "GUI_vs.cso", .Bytecode = Span<const uint8_t>(vs, sizeof(vs)) } };
+
+        SmallVector<uint8_t> data;
+        REQUIRE(ShaderArchive::Build(shaders, data));
+
+        ShaderArchive archive;
+        REQUIRE(archive.Open(Span<const uint8_t>(data.data(), data.size())));
+        CHECK(archive.NumShaders() == 3);
+
+        for (auto& s : shaders)
+        {
+            Span<const uint8_t> bytecode(nullptr, 0);
+            uint64_t hash = 0;
+            REQUIRE(archive.Find(s.Name, bytecode, hash));
+
+            // Bytecode is returned in place
+            CHECK(bytecode.data() >= data.begin());
+            CHECK(bytecode.data() + bytecode.size() <= data.end());
+            CHECK(((uintptr_t)bytecode.data() & 15) == 0);
+            REQUIRE(bytecode.size() == s.Bytecode.size());
+            CHECK(memcmp(bytecode.data(), s.Bytecode.data(), bytecode.size()) == 0);
+            CHECK(hash == ShaderArchive::HashBytecode(s.Bytecode));
+        }
+
+        CHECK(!archive.Contains("Missing_cs.cso"));
+
+        archive.Close();
+        CHECK(!archive.IsOpen());
+        CHECK(!archive.Contains("GUI_ps.cso"));
+    }
+
+    TEST_CASE("Invalid")
+    {
+        const uint8_t cs[] = { 1, 2, 3, 4 };
+        const ShaderArchive::Shader shaders[] = {
+            { .Name = "A_cs.cso", .Bytecode = Span<const uint8_t>(cs, sizeof(cs)) },
+            { .Name = "A_cs.cso", .Bytecode = Span<const uint8_t>(cs, sizeof(cs)) } };
+
+        SmallVector<uint8_t> data;
+        CHECK(!ShaderArchive::Build(shaders, data));
+
+        REQUIRE(ShaderArchive::Build(Span<const ShaderArchive::Shader>(shaders, 1), data));
+
+        ShaderArchive archive;
+
+        // Truncated in the middle of the TOC
+        CHECK(!archive.Open(Span<const uint8_t>(data.data(), 24)));
+        CHECK(!archive.IsOpen());
+
+        // Wrong magic
+        data[0] ^= 0xff;
+        CHECK(!archive.Open(Span<const uint8_t>(data.data(), data.size())));
+    }
+}
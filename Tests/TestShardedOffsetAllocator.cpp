@@ -0,0 +1,164 @@
+#include <Support/ShardedOffsetAllocator.h>
+#include <doctest/doctest.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace ZetaRay::Support;
+
+TEST_SUITE("ShardedOffsetAllocator")
+{
+    TEST_CASE("ShardSelection")
+    {
+        ShardedOffsetAllocator allocator;
+        allocator.Init(1024, 16, 2, 256, 8, 64);
+        CHECK(allocator.TotalSize() == 1024 + 2 * 256);
+
+        // No shard for threads outside the thread pools
+        auto a = allocator.Allocate(16);
+        REQUIRE(!a.IsEmpty());
+        CHECK(a.Offset < 1024);
+
+        g_threadIdx = 1;
+
+        auto b = allocator.Allocate(16, 16);
+        REQUIRE(!b.IsEmpty());
+        CHECK(b.Offset >= 1024 + 256);
+        CHECK(b.Offset < 1024 + 2 * 256);
+        CHECK((b.Offset & 15) == 0);
+
+        // Too large for a shard
+        auto c = allocator.Allocate(128);
+        REQUIRE(!c.IsEmpty());
+        CHECK(c.Offset + c.Size <= 1024);
+
+        // Shard full, falls back to the central region
+        auto d = allocator.Allocate(64);
+        auto e = allocator.Allocate(64);
+        auto f = allocator.Allocate(64);
+        auto g = allocator.Allocate(64);
+        REQUIRE(!g.IsEmpty());
+        CHECK(g.Offset < 1024);
+
+        // Cross-thread frees are applied on the owner's next allocation
+        g_threadIdx = 0;
+        allocator.Free(b);
+        allocator.Free(d);
+
+        g_threadIdx = 1;
+        auto h = allocator.Allocate(64);
+        REQUIRE(!h.IsEmpty());
+        CHECK(h.Offset >= 1024 + 256);
+
+        g_threadIdx = -1;
+        for (auto& x : { a, c, e, f, g, h })
+            allocator.Free(x);
+
+        auto report = allocator.GetStorageReport();
+        CHECK(report.TotalFreeSpace == allocator.TotalSize());
+        CHECK(report.LargestFreeRegion == 1024);
+    }
+
+    TEST_CASE("Concurrent")
+    {
+        constexpr int NUM_THREADS = 4;
+        constexpr int NUM_ITERS = 4000;
+
+        ShardedOffsetAllocator allocator;
+        allocator.Init(64 * 1024, 256, NUM_THREADS, 16 * 1024, 64, 1024);
+
+        // Number of live allocations that cover each byte
+        std::unique_ptr<std::atomic_uint8_t[]> coverage(new std::atomic_uint8_t[allocator.TotalSize()]);
+        for (uint32_t i = 0; i < allocator.TotalSize(); i++)
+            coverage[i].store(0, std::memory_order_relaxed);
+
+        // Allocations that are freed by some other thread
+        std::vector<ShardedOffsetAllocator::Allocation> handOff;
+        std::mutex handOffLock;
+        std::atomic_int numOverlaps = 0;
+
+        auto release = [&](const ShardedOffsetAllocator::Allocation& a)
+            {
+                for (uint32_t i = a.Offset; i < a.Offset + a.Size; i++)
+                    coverage[i].fetch_sub(1, std::memory_order_relaxed);
+
+                allocator.Free(a);
+            };
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < NUM_THREADS; t++)
+        {
+            threads.emplace_back([&, t]()
+                {
+                    g_threadIdx = t;
+                    std::vector<ShardedOffsetAllocator::Allocation> live;
+                    uint32_t rng = 0x9e3779b9u * (t + 1);
+
+                    for (int i = 0; i < NUM_ITERS; i++)
+                    {
+                        rng = rng * 1664525u + 1013904223u;
+                        const uint32_t size = 1 + ((rng >> 8) % ((rng & 0x7) == 0 ? 4096 : 512));
+                        const uint32_t alignment = 1u << ((rng >> 4) & 0x7);
+
+                        auto a = allocator.Allocate(size, alignment);
+                        if (!a.IsEmpty())
+                        {
+                            if (a.Offset % alignment != 0)
+                                numOverlaps.fetch_add(1, std::memory_order_relaxed);
+
+                            for (uint32_t j = a.Offset; j < a.Offset + a.Size; j++)
+                            {
+                                if (coverage[j].fetch_add(1, std::memory_order_relaxed) != 0)
+                                    numOverlaps.fetch_add(1, std::memory_order_relaxed);
+                            }
+
+                            live.push_back(a);
+                        }
+
+                        if (live.size() > 24)
+                        {
+                            if (rng & 0x100)
+                            {
+                                std::scoped_lock lock(handOffLock);
+                                handOff.push_back(live.back());
+                            }
+                            else
+                                release(live.back());
+
+                            live.pop_back();
+                        }
+
+                        if ((i & 0x3f) == 0)
+                        {
+                            std::vector<ShardedOffsetAllocator::Allocation> toFree;
+                            {
+                                std::scoped_lock lock(handOffLock);
+                                toFree.swap(handOff);
+                            }
+
+                            for (auto& x : toFree)
+                                release(x);
+                        }
+                    }
+
+                    for (auto& x : live)
+                        release(x);
+
+                    g_threadIdx = -1;
+                });
+        }
+
+        for (auto& t : threads)
+            t.join();
+
+        for (auto& x : handOff)
+            release(x);
+
+        CHECK(numOverlaps.load() == 0);
+
+        auto report = allocator.GetStorageReport();
+        CHECK(report.TotalFreeSpace == allocator.TotalSize());
+    }
+}
@@ -0,0 +1,118 @@
+#include <Model/glTFParser.h>
+#include <doctest/doctest.h>
+#include <string>
+#include <vector>
+
+using namespace ZetaRay;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    std::string MakeDocument(int numNodes, const char* extraNodeProperty = "")
+    {
+        std::string json = "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+            "\"meshes\":[{\"name\":\"m0\"},{\"name\":\"m1\"}],\"nodes\":[{\"name\":\"root\",\"children\":[";
+        for (int i = 1; i < numNodes; i++)
+        {
+            json += std::to_string(i);
+            json += i + 1 < numNodes ? "," : "";
+        }
+        json += "]}";
+
+        for (int i = 1; i < numNodes; i++)
+        {
+            json += ",\n  { \"name\" : \"n\\u00e9\\\"" + std::to_string(i) + "\"";
+
+            if (i % 3 == 0)
+                json += ", \"mesh\": " + std::to_string(i % 2);
+            if (i % 4 == 0)
+                json += ", \"translation\": [1.5, -2, 3e-1], \"rotation\":[0,0.7071068,0,0.7071068]";
+            else if (i % 4 == 1)
+                json += ", \"matrix\":[2,0,0,0,0,2,0,0,0,0,2,0,1,2,3,1]";
+            if (i % 5 == 0)
+                json += ", \"unknown\": {\"a\":[1,{\"b\":\"}]\"}]}";
+
+            json += extraNodeProperty;
+            json += "}";
+        }
+
+        json += "]}";
+        return json;
+    }
+
+    void CheckSame(const cgltf_data& a, const cgltf_data& b)
+    {
+        REQUIRE(a.nodes_count == b.nodes_count);
+
+        for (size_t i = 0; i < a.nodes_count; i++)
+        {
+            const cgltf_node& na = a.nodes[i];
+            const cgltf_node& nb = b.nodes[i];
+
+            CHECK(std::string(na.name) == std::string(nb.name));
+            CHECK((na.mesh ? na.mesh - a.meshes : -1) == (nb.mesh ? nb.mesh - b.meshes : -1));
+            CHECK((na.parent ? na.parent - a.nodes : -1) == (nb.parent ? nb.parent - b.nodes : -1));
+            REQUIRE(na.children_count == nb.children_count);
+
+            for (size_t j = 0; j < na.children_count; j++)
+                CHECK(na.children[j] - a.nodes == nb.children[j] - b.nodes);
+
+            CHECK(na.has_translation == nb.has_translation);
+            CHECK(na.has_rotation == nb.has_rotation);
+            CHECK(na.has_scale == nb.has_scale);
+            CHECK(na.has_matrix == nb.has_matrix);
+            CHECK(memcmp(na.translation, nb.translation, sizeof(na.translation)) == 0);
+            CHECK(memcmp(na.rotation, nb.rotation, sizeof(na.rotation)) == 0);
+            CHECK(memcmp(na.scale, nb.scale, sizeof(na.scale)) == 0);
+            CHECK(memcmp(na.matrix, nb.matrix, sizeof(na.matrix)) == 0);
+        }
+
+        REQUIRE(a.scene);
+        REQUIRE(a.scene->nodes_count == 1);
+        CHECK(a.scene->nodes[0] == &a.nodes[0]);
+    }
+}
+
+TEST_SUITE("glTFParser")
+{
+    TEST_CASE("MatchesCgltf")
+    {
+        cgltf_options options{};
+
+        for (const char* extra : { "", ", \"extras\":{\"k\":1}" })
+        {
+            const std::string json = MakeDocument(300, extra);
+            std::vector<uint8_t> doc(json.begin(), json.end());
+
+            cgltf_data* expected = nullptr;
+            REQUIRE(cgltf_parse(&options, json.data(), json.size(), &expected) == cgltf_result_success);
+
+            cgltf_data* parsed = nullptr;
+            REQUIRE(glTF::Parse(options, MutableSpan(doc.data(), doc.size()), &parsed, 1) ==
+                cgltf_result_success);
+
+            CheckSame(*parsed, *expected);
+
+            cgltf_free(parsed);
+            cgltf_free(expected);
+        }
+    }
+
+    TEST_CASE("InvalidReferences")
+    {
+        cgltf_options options{};
+
+        // Mesh out of range, child out of range, child with two parents
+        for (const char* node : { "{\"mesh\":2}", "{\"children\":[5]}", "{\"children\":[1]}" })
+        {
+            std::string json = "{\"asset\":{\"version\":\"2.0\"},\"meshes\":[{},{}],\"nodes\":[{\"children\":[1]},";
+            json += node;
+            json += "]}";
+            std::vector<uint8_t> doc(json.begin(), json.end());
+
+            cgltf_data* parsed = nullptr;
+            CHECK(glTF::Parse(options, MutableSpan(doc.data(), doc.size()), &parsed, 1) ==
+                cgltf_result_invalid_gltf);
+        }
+    }
+}
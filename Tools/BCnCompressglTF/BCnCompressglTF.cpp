@@ -2,7 +2,11 @@
 #include <App/Common.h>
 #include <Support/MemoryArena.h>
 #include <algorithm>
+#include <atomic>
+#include <thread>
 #include <Utility/Utility.h>
+#include <Utility/HashTable.h>
+#include <xxHash/xxhash.h>
 #include "TexConv/texconv.h"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -27,7 +31,10 @@ namespace
     using ArenaPathNoInline = Filesystem::FilePath<ArenaAllocator, 0>;
 
     static constexpr int DEFAULT_MAX_TEX_RES = 4096;
+    // Leeway for downsampling and BC7 error before a masked material is considered opaque
+    static constexpr float OPAQUE_ALPHA_MARGIN = 4.0f / 255.0f;
     static constexpr const char* COMPRESSED_DIR_NAME = "compressed";
+    static constexpr const char* CACHE_MANIFEST_NAME = "manifest.txt";
 
     namespace TEX_CONV_ARGV_NO_OVERWRITE_SRGB
     {
@@ -228,22 +235,118 @@ namespace
         }
     }
 
-    bool ConvertTextures(TEXTURE_TYPE texType, const ArenaPath& glTFPath, 
+    // Compressed textures are keyed by a hash of the source image contents and the 
+    // compression options. Manifest in the compressed directory maps every key to the 
+    // DDS file that was produced for it, so unchanged textures are reused (also across 
+    // glTFs that share the directory), while changed ones are recompressed even if 
+    // their DDS exists.
+    struct TextureCache
+    {
+        explicit TextureCache(MemoryArena& arena)
+            : Entries(ArenaAllocator(arena)),
+            FileOwners(ArenaAllocator(arena))
+        {}
+
+        void Insert(uint64_t key, const char* filename)
+        {
+            Entries.insert_or_assign(key, filename);
+            // Older entries for the same file are stale from now on
+            FileOwners.insert_or_assign(XXH3_64bits(filename, strlen(filename)), key);
+        }
+
+        // Key -> DDS file name (relative to the compressed directory)
+        HashTable<const char*, uint64_t, ArenaAllocator> Entries;
+        // DDS file name -> key of its latest contents
+        HashTable<uint64_t, uint64_t, ArenaAllocator> FileOwners;
+    };
+
+    // One "<key> <filename>" line per texture
+    void LoadCacheManifest(const ArenaPath& compressedDir, TextureCache& cache, MemoryArena& arena)
+    {
+        ArenaPath manifestPath(compressedDir.GetView(), arena);
+        manifestPath.Append(CACHE_MANIFEST_NAME);
+
+        if (!Filesystem::Exists(manifestPath.Get()))
+            return;
+
+        SmallVector<uint8_t, ArenaAllocator> data(arena);
+        Filesystem::LoadFromFile(manifestPath.Get(), data);
+
+        const char* curr = reinterpret_cast<const char*>(data.data());
+        const char* end = curr + data.size();
+
+        while (curr < end)
+        {
+            const char* lineEnd = curr;
+            while (lineEnd < end && *lineEnd != '\n')
+                lineEnd++;
+
+            char* keyEnd;
+            const uint64_t key = strtoull(curr, &keyEnd, 16);
+
+            if (keyEnd != curr && keyEnd + 1 < lineEnd && *keyEnd == ' ')
+            {
+                const char* fn = keyEnd + 1;
+                const size_t len = lineEnd - fn - (lineEnd[-1] == '\r' ? 1 : 0);
+                char* filename = reinterpret_cast<char*>(arena.AllocateAligned(len + 1, 1));
+                memcpy(filename, fn, len);
+                filename[len] = '\0';
+
+                cache.Insert(key, filename);
+            }
+
+            curr = lineEnd + 1;
+        }
+    }
+
+    void WriteCacheManifest(const ArenaPath& compressedDir, TextureCache& cache, MemoryArena& arena)
+    {
+        SmallVector<char, ArenaAllocator> text(arena);
+        char line[MAX_PATH + 32];
+
+        for (auto it = cache.Entries.begin_it(); it < cache.Entries.end_it(); 
+            it = cache.Entries.next_it(it))
+        {
+            auto owner = cache.FileOwners.find(XXH3_64bits(it->Val, strlen(it->Val)));
+            if (!owner || *owner.value() != it->Key)
+                continue;
+
+            const int len = stbsp_snprintf(line, sizeof(line), "%016llx %s\n", it->Key, it->Val);
+            text.append_range(line, line + len);
+        }
+
+        ArenaPath manifestPath(compressedDir.GetView(), arena);
+        manifestPath.Append(CACHE_MANIFEST_NAME);
+        Filesystem::WriteToFile(manifestPath.Get(), reinterpret_cast<uint8_t*>(text.data()), 
+            (uint32_t)text.size());
+    }
+
+    // Command line for one TexConv() invocation, all allocated from the arena upfront 
+    // so that conversions can run on any thread
+    struct ConversionJob
+    {
+        wchar_t* Args[MAX_NUM_ARGS];
+        int NumArgs;
+        const char* SrcURI;
+    };
+
+    // Appends a conversion job for every image that needs to be (re)compressed and 
+    // changes the image URIs to point to the compressed textures
+    void PrepareConversions(TEXTURE_TYPE texType, const ArenaPath& glTFPath, 
         const ArenaPath& compressedDir, const char* compressedDirName,
-        cgltf_data& model, Span<int> textureMaps, MemoryArena& arena, ID3D11Device* device, 
-        bool srgb, bool forceOverwrite, int maxRes, Span<int> toSkip)
+        cgltf_data& model, Span<int> textureMaps, MemoryArena& arena, bool srgb, 
+        bool forceOverwrite, int maxRes, Span<int> toSkip, TextureCache& cache,
+        SmallVector<ConversionJob, ArenaAllocator>& jobs)
     {
-        const char* formatStr = srgb ?
-            (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE_SRGB::CMD : TEX_CONV_ARGV_NO_OVERWRITE_SRGB::CMD) :
-            (texType == METALNESS_ROUGHNESS ?
-                (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE_SWIZZLE::CMD : TEX_CONV_ARGV_NO_OVERWRITE_SWIZZLE::CMD) :
-                (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE::CMD : TEX_CONV_ARGV_NO_OVERWRITE::CMD));
-
-        const int numArgs = srgb ?
-            (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE_SRGB::NUM_ARGS : TEX_CONV_ARGV_NO_OVERWRITE_SRGB::NUM_ARGS) :
-            (texType == METALNESS_ROUGHNESS ?
-                (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE_SWIZZLE::NUM_ARGS : TEX_CONV_ARGV_NO_OVERWRITE_SWIZZLE::NUM_ARGS) :
-                (forceOverwrite ? TEX_CONV_ARGV_OVERWRITE::NUM_ARGS : TEX_CONV_ARGV_NO_OVERWRITE::NUM_ARGS));
+        // Whether an existing DDS is still valid is decided by the cache, so outputs are 
+        // always overwritten
+        const char* formatStr = srgb ? TEX_CONV_ARGV_OVERWRITE_SRGB::CMD :
+            (texType == METALNESS_ROUGHNESS ? TEX_CONV_ARGV_OVERWRITE_SWIZZLE::CMD : 
+                TEX_CONV_ARGV_OVERWRITE::CMD);
+
+        const int numArgs = srgb ? TEX_CONV_ARGV_OVERWRITE_SRGB::NUM_ARGS :
+            (texType == METALNESS_ROUGHNESS ? TEX_CONV_ARGV_OVERWRITE_SWIZZLE::NUM_ARGS : 
+                TEX_CONV_ARGV_OVERWRITE::NUM_ARGS);
 
         const char* texFormat = GetTexFormat(texType);
 
@@ -272,31 +375,53 @@ namespace
             filename[fnLen + 3] = 's';
             filename[fnLen + 4] = '\0';
 
-            ArenaPath ddsPath(compressedDir.GetView(), arena);
-            ddsPath.Append(filename.data());
+            Filesystem::Path imgPath(glTFPath.GetView());
+            imgPath.Directory();
+            imgPath.Append(model.images[tex].uri);
 
-            if (forceOverwrite || !Filesystem::Exists(ddsPath.Get()))
-            {
-                Filesystem::Path imgPath(glTFPath.GetView());
-                imgPath.Directory();
-                imgPath.Append(model.images[tex].uri);
+            // DirectXTex expects backslashes
+            imgPath.ConvertToBackslashes();
+
+            int x;
+            int y;
+            int comp;
+            Check(stbi_info(imgPath.Get(), &x, &y, &comp), "stbi_info() for path %s failed: %s",
+                imgPath.Get(), stbi_failure_reason());
+
+            int w = Min(x, maxRes);
+            int h = Min(y, maxRes);
+
+            // Direct3D requires BC image to be multiple of 4 in width & height
+            w = (int)AlignUp(w, 4);
+            h = (int)AlignUp(h, 4);
 
-                // DirectXTex expects backslashes
-                imgPath.ConvertToBackslashes();
+            // Everything that affects the output, other than the source image -- output 
+            // size, format and the TexConv options
+            char options[256];
+            const int optionsLen = stbsp_snprintf(options, sizeof(options), "%d %d %s %s", 
+                w, h, texFormat, formatStr);
 
-                int x;
-                int y;
-                int comp;
-                Check(stbi_info(imgPath.Get(), &x, &y, &comp), "stbi_info() for path %s failed: %s",
-                    imgPath.Get(), stbi_failure_reason());
+            Filesystem::MappedFile src;
+            Check(Filesystem::MapFile(imgPath.Get(), src), "Reading image %s failed.", imgPath.Get());
+            const uint64_t key = XXH3_64bits_withSeed(src.Data, src.Size, 
+                XXH3_64bits(options, Min(optionsLen, (int)sizeof(options) - 1)));
+            Filesystem::UnmapFile(src);
 
-                int w = Min(x, maxRes);
-                int h = Min(y, maxRes);
+            const char* cached = nullptr;
+            if (!forceOverwrite)
+            {
+                if (auto it = cache.Entries.find(key); it)
+                {
+                    ArenaPath cachedPath(compressedDir.GetView(), arena);
+                    cachedPath.Append(*it.value());
 
-                // Direct3D requires BC image to be multiple of 4 in width & height
-                w = (int)AlignUp(w, 4);
-                h = (int)AlignUp(h, 4);
+                    if (Filesystem::Exists(cachedPath.Get()))
+                        cached = *it.value();
+                }
+            }
 
+            if (!cached)
+            {
                 // Returns length without the null terminatir
                 const int len = stbsp_snprintf(nullptr, 0, formatStr, w, h, texFormat,
                     compressedDir.GetView().data(), imgPath.Get());
@@ -310,13 +435,17 @@ namespace
                 wchar_t* wideBuffer = reinterpret_cast<wchar_t*>(arena.AllocateAligned(wideStrLen));
                 Common::CharToWideStr(buffer, MutableSpan(wideBuffer, wideStrLen));
 
+                jobs.emplace_back();
+                ConversionJob& job = jobs.back();
+                job.NumArgs = numArgs;
+                job.SrcURI = model.images[tex].uri;
+
                 wchar_t* ptr = wideBuffer;
-                wchar_t* args[MAX_NUM_ARGS];
                 int currArg = 0;
 
                 while (ptr != wideBuffer + wideStrLen)
                 {
-                    args[currArg] = ptr;
+                    job.Args[currArg] = ptr;
 
                     // spaces are valid for last argument (file path)
                     while ((currArg == numArgs - 1 || *ptr != ' ') && *ptr != '\0')
@@ -326,16 +455,20 @@ namespace
                     currArg++;
                 }
 
-                auto success = TexConv(numArgs, args, device);
-
-                if (success != 0)
-                {
-                    printf("TexConv for path %s failed. Exiting...\n", model.images[tex].uri);
-                    return false;
-                }
+                // Later textures with the same contents and options reuse this one
+                char* fn = reinterpret_cast<char*>(arena.AllocateAligned(fnLen + 5, 1));
+                memcpy(fn, filename.data(), fnLen + 5);
+                cache.Insert(key, fn);
             }
             else
-                printf("Compressed texture already exists in the path %s. Skipping...\n", ddsPath.Get());
+            {
+                printf("Compressed texture for %s is up to date (%s). Skipping...\n", 
+                    model.images[tex].uri, cached);
+
+                // Possibly produced for a different source file with the same contents
+                filename.resize(strlen(cached) + 1);
+                memcpy(filename.data(), cached, filename.size());
+            }
 
             // Modify URI to dds path. URI paths are relative to gltf file.
             ArenaPathNoInline ddsPathRelglTF(compressedDirName, arena);
@@ -344,8 +477,126 @@ namespace
 
             model.images[tex].uri = ddsPathRelglTF.Get();
         }
+    }
+
+    // Runs the conversions on a pool of threads. Loading, mip generation, CPU codecs and 
+    // writing the output run concurrently, while GPU (BC7) compression is serialized 
+    // inside TexConv() -- with enough threads, there's always one waiting to feed the GPU.
+    bool RunConversions(Span<ConversionJob> jobs, ID3D11Device* device)
+    {
+        if (jobs.empty())
+            return true;
+
+        const int numThreads = (int)Min(Max(std::thread::hardware_concurrency(), 1u), 
+            (uint32_t)jobs.size());
+        std::atomic_int32_t nextJob = 0;
+        std::atomic_bool failed = false;
+
+        auto worker = [&jobs, &nextJob, &failed, device]()
+            {
+                // WIC needs COM on every thread
+                auto hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+                Check(SUCCEEDED(hr), "CoInitializeEx() failed with code %x.", hr);
+
+                while (!failed.load(std::memory_order_relaxed))
+                {
+                    const int idx = nextJob.fetch_add(1, std::memory_order_relaxed);
+                    if (idx >= (int)jobs.size())
+                        break;
+
+                    const ConversionJob& job = jobs[idx];
+                    // TexConv() doesn't modify the arguments
+                    if (TexConv(job.NumArgs, const_cast<wchar_t**>(job.Args), device) != 0)
+                    {
+                        printf("TexConv for path %s failed. Exiting...\n", job.SrcURI);
+                        failed.store(true, std::memory_order_relaxed);
+                    }
+                }
+
+                CoUninitialize();
+            };
+
+        SmallVector<std::thread> threads;
+        threads.reserve(numThreads - 1);
+
+        for (int i = 0; i < numThreads - 1; i++)
+            threads.emplace_back(worker);
+
+        worker();
+
+        for (auto& t : threads)
+            t.join();
+
+        return !failed.load(std::memory_order_relaxed);
+    }
+
+    // Alpha-tested materials whose every texel passes the alpha test are changed to 
+    // opaque, so that their geometry is marked opaque in the BLAS and alpha evaluation 
+    // during ray traversal is skipped. Must be called before image URIs are modified.
+    int MarkOpaqueAlphaTestedMaterials(const ArenaPath& glTFPath, cgltf_data& model, 
+        MemoryArena& arena)
+    {
+        // Minimum alpha for every base-color image, loaded on demand
+        SmallVector<float, ArenaAllocator> minAlpha(arena);
+        minAlpha.resize(model.images_count, -1.0f);
+        int numConverted = 0;
+
+        for (size_t i = 0; i < model.materials_count; i++)
+        {
+            cgltf_material& mat = model.materials[i];
+            if (mat.alpha_mode != cgltf_alpha_mode_mask || !mat.has_pbr_metallic_roughness)
+                continue;
+
+            const cgltf_pbr_metallic_roughness& pbr = mat.pbr_metallic_roughness;
+            float alpha = pbr.base_color_factor[3];
+
+            if (cgltf_texture* tex = pbr.base_color_texture.texture; tex && tex->image)
+            {
+                const int imgIdx = (int)(tex->image - model.images);
+                Assert(imgIdx < model.images_count, "Invalid image index.");
+
+                if (minAlpha[imgIdx] < 0.0f)
+                {
+                    Filesystem::Path imgPath(glTFPath.GetView());
+                    imgPath.Directory();
+                    imgPath.Append(model.images[imgIdx].uri);
+
+                    int x;
+                    int y;
+                    int comp;
+                    uint8_t* pixels = stbi_load(imgPath.Get(), &x, &y, &comp, 0);
+                    if (!pixels)
+                    {
+                        printf("Loading image %s failed: %s
+", imgPath.Get(), stbi_failure_reason());
+                        minAlpha[imgIdx] = 0.0f;
+                        continue;
+                    }
+
+                    // Without an alpha channel, alpha is one
+                    uint8_t minVal = 255;
+                    if (comp == 2 || comp == 4)
+                    {
+                        const size_t numTexels = (size_t)x * y;
+                        for (size_t t = 0; t < numTexels && minVal; t++)
+                            minVal = Min(minVal, pixels[t * comp + comp - 1]);
+                    }
+
+                    stbi_image_free(pixels);
+                    minAlpha[imgIdx] = minVal / 255.0f;
+                }
+
+                alpha *= minAlpha[imgIdx];
+            }
+
+            if (alpha >= mat.alpha_cutoff + OPAQUE_ALPHA_MARGIN)
+            {
+                mat.alpha_mode = cgltf_alpha_mode_opaque;
+                numConverted++;
+            }
+        }
 
-        return true;
+        return numConverted;
     }
 
     void WriteModifiedglTF(cgltf_data& model, const ArenaPath& gltfPath, MemoryArena& arena)
@@ -396,7 +647,11 @@ int main(int argc, char* argv[])
         return 0;
     }
 
-    MemoryArena arena(64 * 1024);
+    // Holds the decoded URIs, paths, cache manifest and conversion jobs for the whole run. 
+    // One reserved range replaces thousands of chained 64 KB blocks for scenes with 
+    // many textures. Should it ever run out, allocations fall back to heap blocks.
+    MemoryArena arena(VirtualArenaDesc{ .ReserveSize = 256 * 1024 * 1024,
+        .CommitGranularity = 1024 * 1024 });
     ArenaPath gltfPath(argv[1], arena);
     if (!Filesystem::Exists(gltfPath.Get()))
     {
@@ -613,26 +868,33 @@ int main(int argc, char* argv[])
     compressedDir.Directory().Append(COMPRESSED_DIR_NAME);
     Filesystem::CreateDirectoryIfNotExists(compressedDir.Get());
 
-    if (!ConvertTextures(TEXTURE_TYPE::BASE_COLOR, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
-        *model, baseColorMaps, arena, device.Get(), true, forceOverwrite, maxRes, skip))
-    {
-        return 0;
-    }
-    if (!ConvertTextures(TEXTURE_TYPE::NORMAL_MAP, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
-        *model, normalMaps, arena, device.Get(), false, forceOverwrite, maxRes, skip))
-    {
-        return 0;
-    }
-    if (!ConvertTextures(TEXTURE_TYPE::METALNESS_ROUGHNESS, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
-        *model, metalnessRoughnessMaps, arena, device.Get(), false, forceOverwrite, maxRes, skip))
-    {
-        return 0;
-    }
-    if (!ConvertTextures(TEXTURE_TYPE::EMISSIVE, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
-        *model, emissiveMaps, arena, device.Get(), true, forceOverwrite, maxRes, skip))
-    {
+    const int numOpaque = MarkOpaqueAlphaTestedMaterials(gltfPath, *model, arena);
+    if (numOpaque)
+        printf("%d alpha-tested material(s) always pass the alpha test and were changed to opaque...\n", numOpaque);
+
+    // Gather all the conversions first, so that textures of every type are compressed 
+    // concurrently
+    SmallVector<ConversionJob, ArenaAllocator> jobs(arena);
+    jobs.reserve(model->images_count);
+
+    TextureCache cache(arena);
+    LoadCacheManifest(compressedDir, cache, arena);
+
+    PrepareConversions(TEXTURE_TYPE::BASE_COLOR, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
+        *model, baseColorMaps, arena, true, forceOverwrite, maxRes, skip, cache, jobs);
+    PrepareConversions(TEXTURE_TYPE::NORMAL_MAP, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
+        *model, normalMaps, arena, false, forceOverwrite, maxRes, skip, cache, jobs);
+    PrepareConversions(TEXTURE_TYPE::METALNESS_ROUGHNESS, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
+        *model, metalnessRoughnessMaps, arena, false, forceOverwrite, maxRes, skip, cache, jobs);
+    PrepareConversions(TEXTURE_TYPE::EMISSIVE, gltfPath, compressedDir, COMPRESSED_DIR_NAME,
+        *model, emissiveMaps, arena, true, forceOverwrite, maxRes, skip, cache, jobs);
+
+    printf("Compressing %llu texture(s)...\n", jobs.size());
+
+    if (!RunConversions(jobs, device.Get()))
         return 0;
-    }
+
+    WriteCacheManifest(compressedDir, cache, arena);
 
     WriteModifiedglTF(*model, gltfPath, arena);
 
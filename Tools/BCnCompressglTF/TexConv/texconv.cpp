@@ -18,6 +18,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <mutex>
 #include <set>
 
 #include <wrl\client.h>
@@ -442,6 +443,11 @@ namespace
 
 namespace
 {
+    // TexConv() may be called from multiple threads with the same device. The immediate 
+    // context isn't thread-safe, so GPU compression is serialized while everything else 
+    // (loading, mip generation, CPU codecs, saving) runs concurrently.
+    std::mutex s_gpuCompressMutex;
+
     inline HANDLE safe_handle(HANDLE h) noexcept { return (h == INVALID_HANDLE_VALUE) ? nullptr : h; }
 
     struct find_closer { void operator()(HANDLE h) noexcept { assert(h != INVALID_HANDLE_VALUE); if (h) FindClose(h); } };
@@ -3091,6 +3097,7 @@ int TexConv(int argc, wchar_t* argv[], ID3D11Device* device)
 
                 if (bc6hbc7)
                 {
+                    std::lock_guard<std::mutex> lock(s_gpuCompressMutex);
                     hr = Compress(device, img, nimg, info, tformat, dwCompress | dwSRGB, alphaWeight, *timage);
                 }
                 else
@@ -0,0 +1,80 @@
+#include <Core/ShaderArchive.h>
+#include <App/Path.h>
+#include <Win32/Win32.h>
+#include <stdio.h>
+
+using namespace ZetaRay;
+using namespace ZetaRay::App;
+using namespace ZetaRay::Core;
+using namespace ZetaRay::Util;
+
+namespace
+{
+    struct CompiledShader
+    {
+        char Name[MAX_PATH];
+        SmallVector<uint8_t> Bytecode;
+    };
+}
+
+// Packs every .cso file in the given directory into a shader archive. Runs as part of the
+// build after the shaders are compiled, see ZetaRenderPass/CMakeLists.txt.
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        printf("Usage: PackShaders <path to compiled shaders directory> <path to output archive>\n");
+        return 1;
+    }
+
+    Filesystem::Path pattern(argv[1]);
+    pattern.Append("*.cso");
+
+    WIN32_FIND_DATAA data;
+    HANDLE h = FindFirstFileA(pattern.Get(), &data);
+    if (h == INVALID_HANDLE_VALUE)
+    {
+        printf("No compiled shaders were found in %s.\n", argv[1]);
+        return 1;
+    }
+
+    SmallVector<CompiledShader> compiled;
+
+    do
+    {
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            continue;
+
+        Filesystem::Path csoPath(argv[1]);
+        csoPath.Append(data.cFileName);
+
+        compiled.emplace_back();
+        CompiledShader& cs = compiled.back();
+        strcpy_s(cs.Name, data.cFileName);
+        Filesystem::LoadFromFile(csoPath.Get(), cs.Bytecode);
+    } while (FindNextFileA(h, &data));
+
+    FindClose(h);
+
+    SmallVector<ShaderArchive::Shader> shaders;
+    shaders.resize(compiled.size());
+
+    for (size_t i = 0; i < compiled.size(); i++)
+    {
+        shaders[i] = ShaderArchive::Shader{ .Name = compiled[i].Name,
+            .Bytecode = Span<const uint8_t>(compiled[i].Bytecode.data(), compiled[i].Bytecode.size()) };
+    }
+
+    SmallVector<uint8_t> archive;
+    if (!ShaderArchive::Build(shaders, archive))
+    {
+        printf("Shader name hash collision, rename one of the shaders.\n");
+        return 1;
+    }
+
+    Filesystem::WriteToFile(argv[2], archive.data(), (uint32_t)archive.size());
+    printf("Packed %u shaders (%u KB) into %s.\n", (uint32_t)shaders.size(),
+        (uint32_t)(archive.size() / 1024), argv[2]);
+
+    return 0;
+}
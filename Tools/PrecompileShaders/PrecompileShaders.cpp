@@ -56,6 +56,9 @@ int main(int argc, char* argv[])
     g_data->gbuffer.InitPSOs();
     g_data->display.InitPSOs();
 
+    // Passes above only queue their PSOs; compile all of them in parallel
+    PipelineStateLibrary::BuildQueuedPSOs();
+
     App::FlushWorkerThreadPool();
 
     delete g_data;